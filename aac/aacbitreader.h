@@ -0,0 +1,212 @@
+#ifndef TAG_PARSER_AACBITREADER_H
+#define TAG_PARSER_AACBITREADER_H
+
+// NOTE: The AAC parser is still WIP. It does not work yet and its API/ABI may change even in patch releases.
+
+#include "../global.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+
+namespace TagParser {
+
+/// \cond
+
+/*!
+ * \brief The AacBitReader class reads bits from a buffer via a 64-bit cache.
+ *
+ * It provides the same interface as CppUtilities::BitReader (where used by the AAC parser) but the bits are taken from
+ * a cache which is refilled with up to 8 bytes at once. So reading a few bits is just a shift of the cache and peeking
+ * bits for table-driven Huffman decoding does not need to copy the reader.
+ *
+ * \remarks At most 57 bits can be read or shown at once.
+ */
+class TAG_PARSER_EXPORT AacBitReader {
+public:
+    AacBitReader(const char *buffer, std::size_t bufferSize);
+    AacBitReader(const char *buffer, const char *end);
+
+    template <typename intType> intType readBits(std::uint8_t bitCount);
+    std::uint8_t readBit();
+    template <typename intType> intType showBits(std::uint8_t bitCount);
+    std::uint64_t peekBits(std::uint8_t bitCount);
+    void skipBits(std::size_t bitCount);
+    void align();
+    std::size_t bitsAvailable() const;
+    void reset(const char *buffer, std::size_t bufferSize);
+    void reset(const char *buffer, const char *end);
+
+private:
+    void ensureBits(std::uint8_t bitCount);
+    void refill();
+    [[noreturn]] static void throwEndOfBuffer();
+
+    const char *m_buffer;
+    const char *m_end;
+    std::uint64_t m_cache;
+    std::uint8_t m_cacheBits;
+};
+
+/*!
+ * \brief Constructs a new reader for the specified \a buffer.
+ */
+inline AacBitReader::AacBitReader(const char *buffer, std::size_t bufferSize)
+    : AacBitReader(buffer, buffer + bufferSize)
+{
+}
+
+/*!
+ * \brief Constructs a new reader for the specified \a buffer.
+ */
+inline AacBitReader::AacBitReader(const char *buffer, const char *end)
+    : m_buffer(buffer)
+    , m_end(end)
+    , m_cache(0)
+    , m_cacheBits(0)
+{
+}
+
+/*!
+ * \brief Moves bytes from the buffer into the cache until it holds more than 56 bits or the buffer is exhausted.
+ * \remarks The cache is MSB-aligned so the next bit is always the most significant bit.
+ */
+inline void AacBitReader::refill()
+{
+    for (; m_cacheBits <= 56 && m_buffer != m_end; m_cacheBits += 8) {
+        m_cache |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(*m_buffer++)) << (56 - m_cacheBits);
+    }
+}
+
+/*!
+ * \brief Ensures the cache holds at least the specified number of bits.
+ * \throws Throws std::ios_base::failure if the end of the buffer has been reached.
+ */
+inline void AacBitReader::ensureBits(std::uint8_t bitCount)
+{
+    if (m_cacheBits < bitCount) {
+        refill();
+        if (m_cacheBits < bitCount) {
+            throwEndOfBuffer();
+        }
+    }
+}
+
+/*!
+ * \brief Throws an exception because the end of the buffer has been exceeded (same as CppUtilities::BitReader).
+ */
+inline void AacBitReader::throwEndOfBuffer()
+{
+    throw std::ios_base::failure("end of buffer exceeded");
+}
+
+/*!
+ * \brief Reads the specified number of bits from the buffer advancing the current position by \a bitCount bits.
+ * \throws Throws std::ios_base::failure if the end of the buffer is exceeded.
+ */
+template <typename intType> intType AacBitReader::readBits(std::uint8_t bitCount)
+{
+    if (!bitCount) {
+        return intType(0);
+    }
+    ensureBits(bitCount);
+    const auto value = m_cache >> (64 - bitCount);
+    m_cache <<= bitCount;
+    m_cacheBits = static_cast<std::uint8_t>(m_cacheBits - bitCount);
+    return static_cast<intType>(value);
+}
+
+/*!
+ * \brief Reads the one bit from the buffer advancing the current position by one bit.
+ * \throws Throws std::ios_base::failure if the end of the buffer is exceeded.
+ */
+inline std::uint8_t AacBitReader::readBit()
+{
+    return readBits<std::uint8_t>(1);
+}
+
+/*!
+ * \brief Reads the specified number of bits from the buffer without advancing the current position.
+ * \throws Throws std::ios_base::failure if the end of the buffer is exceeded.
+ */
+template <typename intType> intType AacBitReader::showBits(std::uint8_t bitCount)
+{
+    ensureBits(bitCount);
+    return static_cast<intType>(peekBits(bitCount));
+}
+
+/*!
+ * \brief Returns the specified number of bits without advancing the current position.
+ * \remarks Unlike showBits() this does not throw when reaching the end of the buffer; missing bits are zero. This is
+ *          used for table lookups where the actual code length is only known after the lookup (and checked via
+ *          skipBits()).
+ */
+inline std::uint64_t AacBitReader::peekBits(std::uint8_t bitCount)
+{
+    if (m_cacheBits < bitCount) {
+        refill();
+    }
+    return bitCount ? m_cache >> (64 - bitCount) : 0;
+}
+
+/*!
+ * \brief Skips the specified number of bits without reading them.
+ * \throws Throws std::ios_base::failure if the end of the buffer is exceeded.
+ */
+inline void AacBitReader::skipBits(std::size_t bitCount)
+{
+    if (bitCount <= m_cacheBits) {
+        m_cache = bitCount < 64 ? m_cache << bitCount : 0;
+        m_cacheBits = static_cast<std::uint8_t>(m_cacheBits - bitCount);
+        return;
+    }
+    bitCount -= m_cacheBits;
+    m_cache = 0;
+    m_cacheBits = 0;
+    if (bitCount / 8 > static_cast<std::size_t>(m_end - m_buffer)) {
+        throwEndOfBuffer();
+    }
+    m_buffer += bitCount / 8;
+    readBits<std::uint8_t>(static_cast<std::uint8_t>(bitCount % 8));
+}
+
+/*!
+ * \brief Re-establishes alignment.
+ */
+inline void AacBitReader::align()
+{
+    skipBits(m_cacheBits % 8);
+}
+
+/*!
+ * \brief Returns the number of bits which can be read until the end of the buffer is reached.
+ */
+inline std::size_t AacBitReader::bitsAvailable() const
+{
+    return m_cacheBits + static_cast<std::size_t>(m_end - m_buffer) * 8;
+}
+
+/*!
+ * \brief Resets the reader to read from the specified \a buffer.
+ */
+inline void AacBitReader::reset(const char *buffer, std::size_t bufferSize)
+{
+    reset(buffer, buffer + bufferSize);
+}
+
+/*!
+ * \brief Resets the reader to read from the specified \a buffer.
+ */
+inline void AacBitReader::reset(const char *buffer, const char *end)
+{
+    m_buffer = buffer;
+    m_end = end;
+    m_cache = 0;
+    m_cacheBits = 0;
+}
+
+/// \endcond
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_AACBITREADER_H
@@ -7,8 +7,7 @@
 
 #include "../exceptions.h"
 
-#include <c++utilities/io/bitreader.h>
-
+#include <array>
 #include <istream>
 #include <limits>
 
@@ -231,6 +230,12 @@ AacDrcInfo::AacDrcInfo()
  * \brief Constructs a new PS info object.
  */
 AacPsInfo::AacPsInfo()
+    : headerRead(0)
+    , use34HybridBands(0)
+    , enableIID(0)
+    , iidMode(0)
+    , iidParCount(0)
+    , iidopdParCount(0)
 {
 }
 
@@ -238,6 +243,12 @@ AacPsInfo::AacPsInfo()
  * \brief Constructs a new DRM-PS info object.
  */
 AacDrmPsInfo::AacDrmPsInfo()
+    : headerRead(0)
+    , use34HybridBands(0)
+    , enableIID(0)
+    , iidMode(0)
+    , iidParCount(0)
+    , iidopdParCount(0)
 {
 }
 
@@ -500,6 +511,7 @@ AacIcsInfo::AacIcsInfo()
     , tnsDataPresent(0)
     , gainControlPresent(0)
     , predictorDataPresent(0)
+    , sbr(nullptr)
     , reorderedSpectralDataLength(0)
     , longestCodewordLength(0)
     , sfConcealment(0)
@@ -953,7 +965,7 @@ std::int16_t AacFrameElementParser::sbrHuffmanDec(SbrHuffTab table)
     return index + 64;
 }
 
-void AacFrameElementParser::parseSbrGrid(std::shared_ptr<AacSbrInfo> &sbr, std::uint8_t channel)
+void AacFrameElementParser::parseSbrGrid(AacSbrInfo *sbr, std::uint8_t channel)
 {
     std::uint8_t tmp, bsEnvCount;
     //byte bsRelCount0, bsRelCount1;
@@ -1026,7 +1038,7 @@ void AacFrameElementParser::parseSbrGrid(std::shared_ptr<AacSbrInfo> &sbr, std::
     // TODO: envelope time border vector, noise floor time border vector
 }
 
-void AacFrameElementParser::parseSbrDtdf(std::shared_ptr<AacSbrInfo> &sbr, std::uint8_t channel)
+void AacFrameElementParser::parseSbrDtdf(AacSbrInfo *sbr, std::uint8_t channel)
 {
     for (std::uint8_t i = 0; i < sbr->le[channel]; ++i) {
         sbr->bsDfEnv[channel][i] = m_reader.readBit();
@@ -1036,14 +1048,14 @@ void AacFrameElementParser::parseSbrDtdf(std::shared_ptr<AacSbrInfo> &sbr, std::
     }
 }
 
-void AacFrameElementParser::parseInvfMode(std::shared_ptr<AacSbrInfo> &sbr, std::uint8_t channel)
+void AacFrameElementParser::parseInvfMode(AacSbrInfo *sbr, std::uint8_t channel)
 {
     for (std::uint8_t i = 0; i < sbr->nq; ++i) {
         sbr->bsInvfMode[channel][i] = m_reader.readBits<std::uint8_t>(2);
     }
 }
 
-void AacFrameElementParser::parseSbrEnvelope(std::shared_ptr<AacSbrInfo> &sbr, std::uint8_t channel)
+void AacFrameElementParser::parseSbrEnvelope(AacSbrInfo *sbr, std::uint8_t channel)
 {
     std::int8_t delta;
     //SbrHuffTab tHuff;
@@ -1099,7 +1111,7 @@ void AacFrameElementParser::parseSbrEnvelope(std::shared_ptr<AacSbrInfo> &sbr, s
     // TODO: extract envelope data
 }
 
-void AacFrameElementParser::parseSbrNoise(std::shared_ptr<AacSbrInfo> &sbr, std::uint8_t channel)
+void AacFrameElementParser::parseSbrNoise(AacSbrInfo *sbr, std::uint8_t channel)
 {
     std::int8_t delta;
     //SbrHuffTab tHuff;
@@ -1132,14 +1144,14 @@ void AacFrameElementParser::parseSbrNoise(std::shared_ptr<AacSbrInfo> &sbr, std:
     // TODO: extract noise floor data
 }
 
-void AacFrameElementParser::parseSbrSinusoidalCoding(std::shared_ptr<AacSbrInfo> &sbr, std::uint8_t channel)
+void AacFrameElementParser::parseSbrSinusoidalCoding(AacSbrInfo *sbr, std::uint8_t channel)
 {
     for (std::uint8_t i = 0; i < sbr->nHigh; ++i) {
         sbr->bsAddHarmonic[channel][i] = m_reader.readBit();
     }
 }
 
-std::uint16_t AacFrameElementParser::parseSbrExtension(std::shared_ptr<AacSbrInfo> &sbr, std::uint8_t extensionId, std::uint8_t)
+std::uint16_t AacFrameElementParser::parseSbrExtension(AacSbrInfo *sbr, std::uint8_t extensionId, std::uint8_t)
 {
     std::uint8_t header;
     std::uint16_t res;
@@ -1147,7 +1159,7 @@ std::uint16_t AacFrameElementParser::parseSbrExtension(std::shared_ptr<AacSbrInf
         using namespace AacSbrExtensionIds;
     case Ps:
         if (sbr->psResetFlag) {
-            sbr->ps->headerRead = 0;
+            sbr->ps.headerRead = 0;
         }
         res = parsePsData(sbr->ps, header);
         if (sbr->psUsed == 0 && header == 1) {
@@ -1166,26 +1178,26 @@ std::uint16_t AacFrameElementParser::parseSbrExtension(std::shared_ptr<AacSbrInf
     }
 }
 
-std::uint16_t AacFrameElementParser::parsePsData(std::shared_ptr<AacPsInfo> &ps, std::uint8_t &header)
+std::uint16_t AacFrameElementParser::parsePsData(AacPsInfo &ps, std::uint8_t &header)
 {
     if (m_reader.readBit()) {
         header = 1;
-        ps->headerRead = 1;
-        ps->use34HybridBands = 0;
-        if ((ps->enableIID = m_reader.readBit())) {
-            ps->iidMode = m_reader.readBits<std::uint8_t>(3);
+        ps.headerRead = 1;
+        ps.use34HybridBands = 0;
+        if ((ps.enableIID = m_reader.readBit())) {
+            ps.iidMode = m_reader.readBits<std::uint8_t>(3);
         }
     }
     throw NotImplementedException(); // TODO
 }
 
-std::uint16_t AacFrameElementParser::parseDrmPsData(std::shared_ptr<AacDrmPsInfo> &drmPs)
+std::uint16_t AacFrameElementParser::parseDrmPsData(AacDrmPsInfo &drmPs)
 {
     CPP_UTILITIES_UNUSED(drmPs)
     throw NotImplementedException(); // TODO
 }
 
-void AacFrameElementParser::parseSbrSingleChannelElement(std::shared_ptr<AacSbrInfo> &sbr)
+void AacFrameElementParser::parseSbrSingleChannelElement(AacSbrInfo *sbr)
 {
     if (m_reader.readBit()) { // bs data extra
         m_reader.skipBits(4); // skip bs reserved
@@ -1223,7 +1235,7 @@ void AacFrameElementParser::parseSbrSingleChannelElement(std::shared_ptr<AacSbrI
     }
 }
 
-void AacFrameElementParser::parseSbrChannelPairElement(std::shared_ptr<AacSbrInfo> &sbr)
+void AacFrameElementParser::parseSbrChannelPairElement(AacSbrInfo *sbr)
 {
     if (m_reader.readBit()) { // bs data extra
         m_reader.skipBits(8); // skip bs reserved
@@ -1295,24 +1307,34 @@ void AacFrameElementParser::parseSbrChannelPairElement(std::shared_ptr<AacSbrInf
     }
 }
 
-shared_ptr<AacSbrInfo> AacFrameElementParser::makeSbrInfo(std::uint8_t sbrElement, bool isDrm)
+/*!
+ * \brief Returns the SBR info for the specified \a sbrElement.
+ * \remarks The SBR info (including the PS info) is owned by the parser and created only once per element, so it
+ *          is reused when parsing further raw data blocks (SBR headers are not repeated in every block anyways).
+ */
+AacSbrInfo &AacFrameElementParser::sbrInfo(std::uint8_t sbrElement, bool isDrm)
 {
+    auto &sbr = m_sbrElements[sbrElement];
+    if (sbr) {
+        return *sbr;
+    }
     if (m_mpeg4ExtensionSamplingFrequencyIndex >= sizeof(mpeg4SamplingFrequencyTable)
         && m_mpeg4SamplingFrequencyIndex >= sizeof(mpeg4SamplingFrequencyTable)) {
         throw InvalidDataException(); // sampling frequency index is invalid
     }
-    return make_shared<AacSbrInfo>(m_elementId[sbrElement],
+    sbr = make_unique<AacSbrInfo>(m_elementId[sbrElement],
         m_mpeg4ExtensionSamplingFrequencyIndex < sizeof(mpeg4SamplingFrequencyTable)
             ? mpeg4SamplingFrequencyTable[m_mpeg4ExtensionSamplingFrequencyIndex]
             : mpeg4SamplingFrequencyTable[m_mpeg4SamplingFrequencyIndex] * 2,
         m_frameLength, isDrm);
+    return *sbr;
 }
 
 void AacFrameElementParser::parseSbrExtensionData(std::uint8_t sbrElement, std::uint16_t count, bool crcFlag)
 {
     CPP_UTILITIES_UNUSED(count);
     //uint16 alignBitCount = 0;
-    std::shared_ptr<AacSbrInfo> &sbr = m_sbrElements[sbrElement];
+    AacSbrInfo *const sbr = m_sbrElements[sbrElement].get();
     if (m_psResetFlag) {
         sbr->psResetFlag = m_psResetFlag;
     }
@@ -1372,16 +1394,156 @@ void AacFrameElementParser::parseSbrExtensionData(std::uint8_t sbrElement, std::
     }
 }
 
-std::uint8_t AacFrameElementParser::parseHuffmanScaleFactor()
+namespace {
+
+/// \brief The number of bits resolved by a single lookup when decoding codewords of binary Huffman trees.
+constexpr std::uint8_t treeLookupBits = 8;
+/// \brief The number of bits denoting an invalid codeword within a TreeLookup.
+constexpr std::uint8_t invalidTreeCode = 0xFF;
+/// \brief The number of nodes of the scale factor Huffman tree.
+constexpr std::size_t scaleFactorTreeSize = 241;
+
+/*!
+ * \brief The TreeLookup struct allows decoding codewords of a binary Huffman tree via a table lookup.
+ *
+ * The entry for the next treeLookupBits bits denotes the node reached when walking the tree with these bits and the
+ * number of bits actually consumed (less than treeLookupBits if a leaf is reached before). Only the rare codewords
+ * which are longer than treeLookupBits need to be walked further bit by bit.
+ */
+struct TreeLookup {
+    std::array<std::uint16_t, 1u << treeLookupBits> nodes;
+    std::array<std::uint8_t, 1u << treeLookupBits> bits;
+};
+
+/*!
+ * \brief Makes a TreeLookup for the tree with the specified number of nodes.
+ * \remarks \a isLeaf returns whether a node is a leaf and \a next returns the node following a node for a bit.
+ */
+template <typename IsLeaf, typename Next> TreeLookup makeTreeLookup(std::size_t nodeCount, IsLeaf isLeaf, Next next)
+{
+    auto lookup = TreeLookup();
+    for (auto code = std::size_t(); code != lookup.nodes.size(); ++code) {
+        auto node = std::size_t();
+        auto bits = std::uint8_t();
+        for (; bits != treeLookupBits && node < nodeCount && !isLeaf(node); ++bits) {
+            node = next(node, (code >> (treeLookupBits - 1 - bits)) & 0x1u);
+        }
+        lookup.nodes[code] = static_cast<std::uint16_t>(node);
+        lookup.bits[code] = node < nodeCount ? bits : invalidTreeCode;
+    }
+    return lookup;
+}
+
+/*!
+ * \brief Decodes a codeword read via \a reader using \a lookup and returns the leaf node.
+ * \remarks The parameters must be the same as used to make \a lookup.
+ * \throws Throws InvalidDataException if the codeword is invalid.
+ */
+template <typename IsLeaf, typename Next>
+std::size_t decodeTree(AacBitReader &reader, const TreeLookup &lookup, std::size_t nodeCount, IsLeaf isLeaf, Next next)
 {
-    std::uint16_t offset = 0;
-    while (aacHcbSf[offset][1]) {
-        offset += aacHcbSf[offset][m_reader.readBit()];
-        if (offset > 240) {
+    const auto code = static_cast<std::size_t>(reader.peekBits(treeLookupBits));
+    const auto bits = lookup.bits[code];
+    if (bits == invalidTreeCode) {
+        throw InvalidDataException();
+    }
+    reader.skipBits(bits);
+    auto node = static_cast<std::size_t>(lookup.nodes[code]);
+    while (!isLeaf(node)) {
+        if ((node = next(node, reader.readBit())) >= nodeCount) {
             throw InvalidDataException();
         }
     }
-    return aacHcbSf[offset][0];
+    return node;
+}
+
+/// \brief Returns whether the specified node of the scale factor tree is a leaf.
+inline bool isScaleFactorLeaf(std::size_t node)
+{
+    return !aacHcbSf[node][1];
+}
+
+/// \brief Returns the node following the specified node of the scale factor tree for the specified bit.
+inline std::size_t nextScaleFactorNode(std::size_t node, std::uint8_t bit)
+{
+    return node + aacHcbSf[node][bit];
+}
+
+/*!
+ * \brief Returns the lookup for the scale factor tree.
+ */
+const TreeLookup &scaleFactorLookup()
+{
+    static const auto lookup = makeTreeLookup(scaleFactorTreeSize, &isScaleFactorLeaf, &nextScaleFactorNode);
+    return lookup;
+}
+
+/*!
+ * \brief The BinaryTree struct provides access to the nodes of the binary search trees for codebooks 3, 5, 7 and 9.
+ */
+template <typename NodeType> struct BinaryTree {
+    bool operator()(std::size_t node) const
+    {
+        return nodes[node].isLeaf;
+    }
+    std::size_t operator()(std::size_t node, std::uint8_t bit) const
+    {
+        return node + static_cast<std::size_t>(nodes[node].data[bit]);
+    }
+
+    const NodeType *nodes;
+    std::size_t size;
+};
+
+/*!
+ * \brief Returns the tree of the specified binary pair codebook (5, 7 or 9).
+ */
+BinaryTree<AacHcbBinPair> binaryPairTree(std::uint8_t cb)
+{
+    return BinaryTree<AacHcbBinPair>{ aacHcbBinTable[cb], static_cast<std::size_t>(aacHcbBinTableSize[cb]) };
+}
+
+/*!
+ * \brief Returns the lookups for the binary pair codebooks by codebook number (only entries 5, 7 and 9 are used).
+ */
+const std::array<TreeLookup, 10> &binaryPairLookups()
+{
+    static const auto lookups = [] {
+        auto res = std::array<TreeLookup, 10>();
+        for (const auto cb : { 5, 7, 9 }) {
+            const auto tree = binaryPairTree(static_cast<std::uint8_t>(cb));
+            res[static_cast<std::size_t>(cb)] = makeTreeLookup(tree.size, tree, tree);
+        }
+        return res;
+    }();
+    return lookups;
+}
+
+/*!
+ * \brief Returns the tree of the binary quad codebook (3).
+ */
+BinaryTree<AacHcbBinQuad> binaryQuadTree()
+{
+    return BinaryTree<AacHcbBinQuad>{ aacHcb3, static_cast<std::size_t>(aacHcbBinTableSize[3]) };
+}
+
+/*!
+ * \brief Returns the lookup for the binary quad codebook (3).
+ */
+const TreeLookup &binaryQuadLookup()
+{
+    static const auto lookup = [] {
+        const auto tree = binaryQuadTree();
+        return makeTreeLookup(tree.size, tree, tree);
+    }();
+    return lookup;
+}
+
+} // namespace
+
+std::uint8_t AacFrameElementParser::parseHuffmanScaleFactor()
+{
+    return aacHcbSf[decodeTree(m_reader, scaleFactorLookup(), scaleFactorTreeSize, &isScaleFactorLeaf, &nextScaleFactorNode)][0];
 }
 
 void AacFrameElementParser::parseHuffmanSpectralData(std::uint8_t cb, std::int16_t *sp)
@@ -1394,11 +1556,11 @@ void AacFrameElementParser::parseHuffmanSpectralData(std::uint8_t cb, std::int16
     case 3: // binary search for data quadruples
         huffmanBinaryQuadSign(cb, sp);
         break;
-    case 4: // binary search for data paris
-        huffmanBinaryPair(cb, sp);
+    case 4: // 2-step method for data quadruples
+        huffman2StepQuadSign(cb, sp);
         break;
-    case 5: // 2-step method for data pairs
-        huffman2StepPair(cb, sp);
+    case 5: // binary search for data pairs
+        huffmanBinaryPair(cb, sp);
         break;
     case 6: // 2-step method for data pairs
         huffman2StepPair(cb, sp);
@@ -1468,11 +1630,19 @@ void AacFrameElementParser::parseHuffmanSpectralData(std::uint8_t cb, std::int16
 
 void AacFrameElementParser::huffmanSignBits(std::int16_t *sp, std::uint8_t len)
 {
-    for (std::int16_t *end = sp + len; sp < end; ++sp) {
+    // read the sign bits of all non-zero values at once
+    auto signBitCount = std::uint8_t();
+    for (const std::int16_t *i = sp, *end = sp + len; i != end; ++i) {
+        signBitCount += *i != 0;
+    }
+    const auto signBits = m_reader.readBits<std::uint8_t>(signBitCount);
+    auto mask = static_cast<std::uint8_t>((1u << signBitCount) >> 1);
+    for (std::int16_t *end = sp + len; sp != end; ++sp) {
         if (*sp) {
-            if (m_reader.readBit()) {
+            if (signBits & mask) {
                 *sp = -(*sp);
             }
+            mask >>= 1;
         }
     }
 }
@@ -1498,7 +1668,7 @@ void AacFrameElementParser::huffman2StepQuad(std::uint8_t cb, std::int16_t *sp)
     sp[3] = aacHcb2QuadTable[cb][offset].w;
 }
 
-void AacFrameElementParser::huffmanBinaryQuadSign(std::uint8_t cb, std::int16_t *sp)
+void AacFrameElementParser::huffman2StepQuadSign(std::uint8_t cb, std::int16_t *sp)
 {
     try {
         huffman2StepQuad(cb, sp);
@@ -1509,17 +1679,29 @@ void AacFrameElementParser::huffmanBinaryQuadSign(std::uint8_t cb, std::int16_t
     huffmanSignBits(sp, 4);
 }
 
-void AacFrameElementParser::huffmanBinaryPair(std::uint8_t cb, std::int16_t *sp)
+void AacFrameElementParser::huffmanBinaryQuadSign(std::uint8_t cb, std::int16_t *sp)
 {
-    std::uint16_t offset = 0;
-    while (!aacHcbBinTable[cb][offset].isLeaf) {
-        offset += aacHcbBinTable[cb][offset].data[m_reader.readBit()];
-    }
-    if (offset > aacHcbBinTableSize[cb]) {
-        throw InvalidDataException();
+    CPP_UTILITIES_UNUSED(cb)
+    try {
+        const auto tree = binaryQuadTree();
+        const auto &leaf = aacHcb3[decodeTree(m_reader, binaryQuadLookup(), tree.size, tree, tree)];
+        sp[0] = leaf.data[0];
+        sp[1] = leaf.data[1];
+        sp[2] = leaf.data[2];
+        sp[3] = leaf.data[3];
+    } catch (const InvalidDataException &) {
+        huffmanSignBits(sp, 4);
+        throw;
     }
-    sp[0] = aacHcbBinTable[cb][offset].data[0];
-    sp[1] = aacHcbBinTable[cb][offset].data[1];
+    huffmanSignBits(sp, 4);
+}
+
+void AacFrameElementParser::huffmanBinaryPair(std::uint8_t cb, std::int16_t *sp)
+{
+    const auto tree = binaryPairTree(cb);
+    const auto &leaf = tree.nodes[decodeTree(m_reader, binaryPairLookups()[cb], tree.size, tree, tree)];
+    sp[0] = leaf.data[0];
+    sp[1] = leaf.data[1];
 }
 
 void AacFrameElementParser::huffman2StepPair(std::uint8_t cb, std::int16_t *sp)
@@ -1723,6 +1905,7 @@ void AacFrameElementParser::parseSingleChannelElement()
     }
     // TODO: check whether limit of channels is exceeded
 
+    ++m_statistics.singleChannelElementCount;
     std::int16_t specData[1024] = { 0 };
     m_elementId[m_elementCount] = AacSyntaxElementTypes::SingleChannelElement;
     m_elementInstanceTag[m_elementCount] = m_reader.readBits<std::uint8_t>(4);
@@ -1734,6 +1917,7 @@ void AacFrameElementParser::parseSingleChannelElement()
     }
     // check wheter next bitstream element is a fill element (for SBR decoding)
     if (m_reader.showBits<std::uint8_t>(3) == AacSyntaxElementTypes::FillElement) {
+        m_reader.skipBits(3);
         parseFillElement(m_elementCount);
     }
     // TODO: reconstruct single channel element
@@ -1751,6 +1935,7 @@ void AacFrameElementParser::parseChannelPairElement()
         throw NotImplementedException(); // can not parse frame with more than aacMaxSyntaxElements syntax elements
     }
     // TODO: check whether limit of channels is exceeded
+    ++m_statistics.channelPairElementCount;
     m_elementId[m_elementCount] = AacSyntaxElementTypes::ChannelPairElement;
     m_elementChannelCount[m_elementCount] = 2; // number of output channels in CPE is always 2
 
@@ -1788,6 +1973,7 @@ void AacFrameElementParser::parseChannelPairElement()
     parseIndividualChannelStream(m_ics2, specData2);
     // check if next bitstream element is a fill element (for SBR decoding)
     if (m_reader.showBits<std::uint8_t>(3) == AacSyntaxElementTypes::FillElement) {
+        m_reader.skipBits(3);
         parseFillElement(m_elementCount);
     }
     // TODO: reconstruct channel pair
@@ -1801,6 +1987,7 @@ void AacFrameElementParser::parseChannelPairElement()
  */
 void AacFrameElementParser::parseCouplingChannelElement()
 {
+    ++m_statistics.couplingChannelElementCount;
     m_reader.skipBits(4); // element instance tag
     std::uint8_t swCceFlag = m_reader.readBit();
     std::uint8_t coupledElementCount = m_reader.readBits<std::uint8_t>(3);
@@ -1841,7 +2028,10 @@ void AacFrameElementParser::parseCouplingChannelElement()
  */
 void AacFrameElementParser::parseLowFrequencyElement()
 {
+    ++m_statistics.lowFrequencyElementCount;
     parseSingleChannelElement();
+    // the element has the same syntax as a single channel element but must not be counted as such
+    --m_statistics.singleChannelElementCount;
 }
 
 /*!
@@ -1849,6 +2039,7 @@ void AacFrameElementParser::parseLowFrequencyElement()
  */
 void AacFrameElementParser::parseDataStreamElement()
 {
+    ++m_statistics.dataStreamElementCount;
     std::uint8_t byteAligned = m_reader.readBit();
     std::uint16_t count = m_reader.readBits<std::uint16_t>(8);
     if (count == 0xFF) {
@@ -1865,6 +2056,7 @@ void AacFrameElementParser::parseDataStreamElement()
  */
 void AacFrameElementParser::parseProgramConfigElement()
 {
+    ++m_statistics.programConfigElementCount;
     m_pce.elementInstanceTag = m_reader.readBits<std::uint8_t>(4);
     m_pce.objectType = m_reader.readBits<std::uint8_t>(2);
     m_pce.samplingFrequencyIndex = m_reader.readBits<std::uint8_t>(4);
@@ -1953,6 +2145,7 @@ void AacFrameElementParser::parseProgramConfigElement()
  */
 void AacFrameElementParser::parseFillElement(std::uint8_t sbrElement)
 {
+    ++m_statistics.fillElementCount;
     std::uint16_t count = m_reader.readBits<std::uint8_t>(4);
     bool crcFlag = 0;
     if (count == 0xF) {
@@ -1971,14 +2164,14 @@ void AacFrameElementParser::parseFillElement(std::uint8_t sbrElement)
             if (sbrElement == aacInvalidSbrElement) {
                 throw InvalidDataException();
             } else {
+                ++m_statistics.sbrElementCount;
                 // ensure SBR element exists
-                if (!m_sbrElements[sbrElement]) {
-                    m_sbrElements[sbrElement] = makeSbrInfo(sbrElement);
-                }
+                auto &sbr = sbrInfo(sbrElement);
                 parseSbrExtensionData(sbrElement, count, crcFlag);
                 // set global flags
                 m_sbrPresentFlag = 1;
-                if (m_sbrElements[sbrElement]->ps) {
+                if (sbr.psUsed) {
+                    ++m_statistics.psElementCount;
                     m_psUsed[sbrElement] = 1;
                     m_psUsedGlobal = 1;
                 }
@@ -2103,20 +2296,50 @@ endOfBlock:;
  */
 void AacFrameElementParser::parse(const AdtsFrame &adtsFrame, std::istream &stream, std::size_t dataSize)
 {
-    auto data = make_unique<char[]>(dataSize);
-    stream.read(data.get(), dataSize);
-    parse(adtsFrame, data, dataSize);
+    // reuse the buffer when parsing further frames
+    if (m_bufferSize < dataSize) {
+        m_buffer = make_unique<char[]>(m_bufferSize = dataSize);
+    }
+    stream.read(m_buffer.get(), static_cast<std::streamsize>(dataSize));
+    parse(adtsFrame, m_buffer, dataSize);
 }
 
 /*!
  * \brief Parses the specified frame \a data.
+ * \remarks The SBR state is kept across frames. Statistics about the parsed elements are accumulated and can be
+ *          obtained via statistics(), also if parsing the frame fails.
  */
-void AacFrameElementParser::parse(const AdtsFrame &adtsFrame, std::unique_ptr<char[]> &data, std::size_t dataSize)
+void AacFrameElementParser::parse(const AdtsFrame &adtsFrame, const char *data, std::size_t dataSize)
 {
-    m_reader.reset(data.get(), dataSize);
+    m_reader.reset(data, dataSize);
     m_mpeg4AudioObjectId = adtsFrame.mpeg4AudioObjectId();
     m_mpeg4SamplingFrequencyIndex = adtsFrame.mpeg4SamplingFrequencyIndex();
-    parseRawDataBlock();
+    // the elements of the previous raw data block are not relevant anymore
+    m_elementCount = 0;
+    m_channelCount = 0;
+
+    const auto sbrElementCount = m_statistics.sbrElementCount, psElementCount = m_statistics.psElementCount;
+    const auto updateFrameStatistics = [&, this] {
+        ++m_statistics.frameCount;
+        m_statistics.sbrFrameCount += m_statistics.sbrElementCount != sbrElementCount;
+        m_statistics.psFrameCount += m_statistics.psElementCount != psElementCount;
+    };
+    try {
+        parseRawDataBlock();
+    } catch (...) {
+        ++m_statistics.incompleteFrameCount;
+        updateFrameStatistics();
+        throw;
+    }
+    updateFrameStatistics();
+}
+
+/*!
+ * \brief Parses the specified frame \a data.
+ */
+void AacFrameElementParser::parse(const AdtsFrame &adtsFrame, std::unique_ptr<char[]> &data, std::size_t dataSize)
+{
+    parse(adtsFrame, data.get(), dataSize);
 }
 
 /// \endcond
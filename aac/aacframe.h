@@ -5,13 +5,92 @@
 
 #include "../global.h"
 
-#include <c++utilities/io/bitreader.h>
+#include "./aacbitreader.h"
 
 #include <cstdint>
 #include <memory>
 
 namespace TagParser {
 
+/*!
+ * \brief The AacFrameStatistics struct holds statistics about the syntax elements of parsed AAC raw data blocks.
+ * \remarks The AAC parser is still WIP. Frames which could not be parsed completely are counted as incomplete frames;
+ *          the elements encountered until the parser gave up are still taken into account.
+ * \sa AacFrameAnalyzer
+ */
+struct TAG_PARSER_EXPORT AacFrameStatistics {
+    constexpr AacFrameStatistics();
+    AacFrameStatistics &operator+=(const AacFrameStatistics &other);
+
+    /// \brief The number of frames passed to the parser.
+    std::uint64_t frameCount;
+    /// \brief The number of frames the parser could not parse completely.
+    std::uint64_t incompleteFrameCount;
+    /// \brief The number of frames containing SBR data.
+    std::uint64_t sbrFrameCount;
+    /// \brief The number of frames containing SBR data using parametric stereo.
+    std::uint64_t psFrameCount;
+    /// \brief The number of "single channel elements".
+    std::uint64_t singleChannelElementCount;
+    /// \brief The number of "channel pair elements".
+    std::uint64_t channelPairElementCount;
+    /// \brief The number of "coupling channel elements".
+    std::uint64_t couplingChannelElementCount;
+    /// \brief The number of "low frequency elements".
+    std::uint64_t lowFrequencyElementCount;
+    /// \brief The number of "data stream elements".
+    std::uint64_t dataStreamElementCount;
+    /// \brief The number of "program config elements".
+    std::uint64_t programConfigElementCount;
+    /// \brief The number of "fill elements" (including the ones following a channel element).
+    std::uint64_t fillElementCount;
+    /// \brief The number of fill elements carrying SBR data.
+    std::uint64_t sbrElementCount;
+    /// \brief The number of fill elements carrying SBR data using parametric stereo.
+    std::uint64_t psElementCount;
+};
+
+/*!
+ * \brief Constructs empty statistics.
+ */
+constexpr AacFrameStatistics::AacFrameStatistics()
+    : frameCount(0)
+    , incompleteFrameCount(0)
+    , sbrFrameCount(0)
+    , psFrameCount(0)
+    , singleChannelElementCount(0)
+    , channelPairElementCount(0)
+    , couplingChannelElementCount(0)
+    , lowFrequencyElementCount(0)
+    , dataStreamElementCount(0)
+    , programConfigElementCount(0)
+    , fillElementCount(0)
+    , sbrElementCount(0)
+    , psElementCount(0)
+{
+}
+
+/*!
+ * \brief Adds the \a other statistics to these statistics.
+ */
+inline AacFrameStatistics &AacFrameStatistics::operator+=(const AacFrameStatistics &other)
+{
+    frameCount += other.frameCount;
+    incompleteFrameCount += other.incompleteFrameCount;
+    sbrFrameCount += other.sbrFrameCount;
+    psFrameCount += other.psFrameCount;
+    singleChannelElementCount += other.singleChannelElementCount;
+    channelPairElementCount += other.channelPairElementCount;
+    couplingChannelElementCount += other.couplingChannelElementCount;
+    lowFrequencyElementCount += other.lowFrequencyElementCount;
+    dataStreamElementCount += other.dataStreamElementCount;
+    programConfigElementCount += other.programConfigElementCount;
+    fillElementCount += other.fillElementCount;
+    sbrElementCount += other.sbrElementCount;
+    psElementCount += other.psElementCount;
+    return *this;
+}
+
 /// \cond
 
 class AdtsFrame;
@@ -262,14 +341,14 @@ struct TAG_PARSER_EXPORT AacSbrInfo {
     //qmf_t Xsbr[2][aacSbrMaxNtsrhfg][64];
 
     std::uint8_t isDrmSbr;
-    std::shared_ptr<AacDrmPsInfo> drmPs;
+    AacDrmPsInfo drmPs;
 
     std::uint8_t timeSlotsRateCount;
     std::uint8_t timeSlotsCount;
     std::uint8_t tHfGen;
     std::uint8_t tHfAdj;
 
-    std::shared_ptr<AacPsInfo> ps;
+    AacPsInfo ps;
     std::uint8_t psUsed;
     std::uint8_t psResetFlag;
 
@@ -389,7 +468,7 @@ struct TAG_PARSER_EXPORT AacIcsInfo {
     AacLtpInfo ltp1;
     AacLtpInfo ltp2;
     AacSsrInfo ssr;
-    std::shared_ptr<AacSbrInfo> sbr;
+    AacSbrInfo *sbr;
 
     // error resilience
     std::uint16_t reorderedSpectralDataLength;
@@ -408,8 +487,10 @@ public:
     AacFrameElementParser(std::uint8_t audioObjectId, std::uint8_t samplingFrequencyIndex, std::uint8_t extensionSamplingFrequencyIndex,
         std::uint8_t channelConfig, std::uint16_t frameLength = 1024);
 
+    void parse(const AdtsFrame &adtsFrame, const char *data, std::size_t dataSize);
     void parse(const AdtsFrame &adtsFrame, std::unique_ptr<char[]> &data, std::size_t dataSize);
     void parse(const AdtsFrame &adtsFrame, std::istream &stream, std::size_t dataSize);
+    const AacFrameStatistics &statistics() const;
 
 private:
     void parseLtpInfo(const AacIcsInfo &ics, AacLtpInfo &ltp);
@@ -427,23 +508,24 @@ private:
     std::uint8_t parseDynamicRange();
     static std::int8_t sbrLog2(const std::int8_t val);
     std::int16_t sbrHuffmanDec(SbrHuffTab table);
-    void parseSbrGrid(std::shared_ptr<AacSbrInfo> &sbr, std::uint8_t channel);
-    void parseSbrDtdf(std::shared_ptr<AacSbrInfo> &sbr, std::uint8_t channel);
-    void parseInvfMode(std::shared_ptr<AacSbrInfo> &sbr, std::uint8_t channel);
-    void parseSbrEnvelope(std::shared_ptr<AacSbrInfo> &sbr, std::uint8_t channel);
-    void parseSbrNoise(std::shared_ptr<AacSbrInfo> &sbr, std::uint8_t channel);
-    void parseSbrSinusoidalCoding(std::shared_ptr<AacSbrInfo> &sbr, std::uint8_t channel);
-    std::uint16_t parseSbrExtension(std::shared_ptr<AacSbrInfo> &sbr, std::uint8_t extensionId, std::uint8_t bitsLeft);
-    std::uint16_t parsePsData(std::shared_ptr<AacPsInfo> &ps, std::uint8_t &header);
-    std::uint16_t parseDrmPsData(std::shared_ptr<AacDrmPsInfo> &drmPs);
-    void parseSbrSingleChannelElement(std::shared_ptr<AacSbrInfo> &sbr);
-    void parseSbrChannelPairElement(std::shared_ptr<AacSbrInfo> &sbr);
-    std::shared_ptr<AacSbrInfo> makeSbrInfo(std::uint8_t sbrElement, bool isDrm = false);
+    void parseSbrGrid(AacSbrInfo *sbr, std::uint8_t channel);
+    void parseSbrDtdf(AacSbrInfo *sbr, std::uint8_t channel);
+    void parseInvfMode(AacSbrInfo *sbr, std::uint8_t channel);
+    void parseSbrEnvelope(AacSbrInfo *sbr, std::uint8_t channel);
+    void parseSbrNoise(AacSbrInfo *sbr, std::uint8_t channel);
+    void parseSbrSinusoidalCoding(AacSbrInfo *sbr, std::uint8_t channel);
+    std::uint16_t parseSbrExtension(AacSbrInfo *sbr, std::uint8_t extensionId, std::uint8_t bitsLeft);
+    std::uint16_t parsePsData(AacPsInfo &ps, std::uint8_t &header);
+    std::uint16_t parseDrmPsData(AacDrmPsInfo &drmPs);
+    void parseSbrSingleChannelElement(AacSbrInfo *sbr);
+    void parseSbrChannelPairElement(AacSbrInfo *sbr);
+    AacSbrInfo &sbrInfo(std::uint8_t sbrElement, bool isDrm = false);
     void parseSbrExtensionData(std::uint8_t sbrElement, std::uint16_t count, bool crcFlag);
     std::uint8_t parseHuffmanScaleFactor();
     void parseHuffmanSpectralData(std::uint8_t cb, std::int16_t *sp);
     void huffmanSignBits(std::int16_t *sp, std::uint8_t len);
     void huffman2StepQuad(std::uint8_t cb, std::int16_t *sp);
+    void huffman2StepQuadSign(std::uint8_t cb, std::int16_t *sp);
     void huffmanBinaryQuadSign(std::uint8_t cb, std::int16_t *sp);
     void huffmanBinaryPair(std::uint8_t cb, std::int16_t *sp);
     void huffman2StepPair(std::uint8_t cb, std::int16_t *sp);
@@ -464,7 +546,7 @@ private:
     void parseRawDataBlock();
 
     // these fields contain setup information
-    CppUtilities::BitReader m_reader;
+    AacBitReader m_reader;
     std::uint8_t m_mpeg4AudioObjectId;
     std::uint8_t m_mpeg4SamplingFrequencyIndex;
     std::uint8_t m_mpeg4ExtensionSamplingFrequencyIndex;
@@ -489,10 +571,13 @@ private:
     std::uint8_t m_sbrPresentFlag;
     //std::uint8_t m_forceUpSampling;
     //std::uint8_t m_downSampledSbr;
-    std::shared_ptr<AacSbrInfo> m_sbrElements[aacMaxSyntaxElements];
+    std::unique_ptr<AacSbrInfo> m_sbrElements[aacMaxSyntaxElements];
+    std::unique_ptr<char[]> m_buffer;
+    std::size_t m_bufferSize;
     std::uint8_t m_psUsed[aacMaxSyntaxElements];
     std::uint8_t m_psUsedGlobal;
     std::uint8_t m_psResetFlag;
+    AacFrameStatistics m_statistics;
 };
 
 /*!
@@ -506,6 +591,8 @@ inline AacFrameElementParser::AacFrameElementParser(std::uint8_t audioObjectId,
     , m_mpeg4ExtensionSamplingFrequencyIndex(extensionSamplingFrequencyIndex)
     , m_mpeg4ChannelConfig(channelConfig)
     , m_frameLength(frameLength)
+    , m_aacSectionDataResilienceFlag(0)
+    , m_aacScalefactorDataResilienceFlag(0)
     , m_aacSpectralDataResilienceFlag(0)
     , m_elementId{ 0 }
     , m_channelCount(0)
@@ -520,13 +607,21 @@ inline AacFrameElementParser::AacFrameElementParser(std::uint8_t audioObjectId,
     ,
     //m_forceUpSampling(0),
     //m_downSampledSbr(0),
-    m_sbrElements{ 0 }
+    m_bufferSize(0)
     , m_psUsed{ 0 }
     , m_psUsedGlobal(0)
     , m_psResetFlag(0)
 {
 }
 
+/*!
+ * \brief Returns statistics about the frames parsed so far.
+ */
+inline const AacFrameStatistics &AacFrameElementParser::statistics() const
+{
+    return m_statistics;
+}
+
 inline std::int8_t AacFrameElementParser::sbrLog2(const std::int8_t val)
 {
     static const int log2tab[] = { 0, 0, 1, 2, 2, 3, 3, 3, 3, 4 };
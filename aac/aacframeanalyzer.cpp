@@ -0,0 +1,229 @@
+#include "./aacframeanalyzer.h"
+
+#include "../adts/adtsframe.h"
+
+#include "../batchparser.h"
+#include "../exceptions.h"
+
+#include <c++utilities/conversion/stringbuilder.h>
+
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <vector>
+
+using namespace std;
+using namespace CppUtilities;
+
+/*!
+ * \file aacframeanalyzer.cpp
+ * \remarks The AAC parser is still WIP. It does not work yet and its API/ABI may change even in patch releases.
+ */
+
+namespace TagParser {
+
+/// \cond
+namespace {
+
+/*!
+ * \brief The FrameInfo struct holds the offset and header of a frame within a buffer.
+ */
+struct FrameInfo {
+    std::size_t offset;
+    AdtsFrame header;
+};
+
+/*!
+ * \brief Parses the header at \a index into \a frame and returns whether it is a complete frame within the buffer.
+ * \remarks If a \a reference is specified, the fixed header fields of \a frame must match the ones of \a reference.
+ */
+bool parseFrame(const AdtsFrame *reference, const char *buffer, std::size_t size, std::size_t index, AdtsFrame &frame)
+{
+    if (index + AdtsFrame::maxHeaderSize > size || static_cast<unsigned char>(buffer[index]) != 0xFFu
+        || (static_cast<unsigned char>(buffer[index + 1]) & 0xF6u) != 0xF0u) {
+        return false;
+    }
+    try {
+        frame.parseHeader(buffer + index);
+    } catch (const InvalidDataException &) {
+        return false;
+    }
+    if (reference
+        && (frame.isMpeg4() != reference->isMpeg4() || frame.mpeg4AudioObjectId() != reference->mpeg4AudioObjectId()
+            || frame.mpeg4SamplingFrequencyIndex() != reference->mpeg4SamplingFrequencyIndex()
+            || frame.mpeg4ChannelConfig() != reference->mpeg4ChannelConfig())) {
+        return false;
+    }
+    return index + frame.totalSize() <= size;
+}
+
+} // namespace
+/// \endcond
+
+/*!
+ * \class TagParser::AacFrameAnalyzer
+ * \brief The AacFrameAnalyzer class gathers AacFrameStatistics about the frames of an ADTS stream using multiple threads.
+ *
+ * The ADTS frames are located within the buffer first. Then successive frames are grouped into tasks of
+ * framesPerTask() frames which are distributed over the worker threads in the same way BatchParser distributes
+ * files. Each task uses its own AacFrameElementParser so no state is shared between the threads. The statistics of
+ * all tasks are summed up in the end.
+ *
+ * This is useful to classify streams (e.g. to tell HE-AACv2 from plain AAC-LC) without walking through hours of
+ * frames on a single thread.
+ *
+ * \remarks The AAC parser is still WIP. Frames it can not parse completely are counted via
+ *          AacFrameStatistics::incompleteFrameCount.
+ */
+
+/*!
+ * \brief Constructs a new analyzer using the specified number of threads.
+ * \remarks If \a parallelism is zero, the number of hardware threads is used.
+ */
+AacFrameAnalyzer::AacFrameAnalyzer(unsigned int parallelism)
+    : m_parallelism(parallelism)
+    , m_framesPerTask(512)
+    , m_aborted(false)
+{
+}
+
+/*!
+ * \brief Analyzes the ADTS frames within the specified \a buffer.
+ *
+ * The function blocks until all frames have been parsed or the analysis has been aborted via abort(). Data which can
+ * not be synchronized to is skipped (and a warning is added to \a diag).
+ */
+AacFrameStatistics AacFrameAnalyzer::analyze(const char *buffer, std::size_t size, Diagnostics &diag)
+{
+    m_aborted.store(false);
+    auto statistics = AacFrameStatistics();
+    auto skippedBytes = std::uint64_t();
+    analyzeBatch(buffer, size, true, statistics, skippedBytes);
+    finish(statistics, skippedBytes, diag);
+    return statistics;
+}
+
+/*!
+ * \brief Analyzes the ADTS frames within the next \a size bytes of the specified \a stream.
+ *
+ * The data is read in batches of batchSize bytes which are analyzed as described in
+ * analyze(const char *, std::size_t, Diagnostics &). So the whole stream does not need to be buffered at once.
+ *
+ * \throws Throws TruncatedDataException if the stream ends before \a size bytes could be read.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+AacFrameStatistics AacFrameAnalyzer::analyze(std::istream &stream, std::uint64_t size, Diagnostics &diag)
+{
+    static const string context("analyzing AAC frames");
+    m_aborted.store(false);
+    auto statistics = AacFrameStatistics();
+    auto skippedBytes = std::uint64_t();
+    auto buffer = make_unique<char[]>(batchSize);
+    auto buffered = std::size_t();
+    for (auto remaining = size; remaining && !isAborted();) {
+        const auto bytesToRead = static_cast<std::size_t>(min<std::uint64_t>(remaining, batchSize - buffered));
+        stream.read(buffer.get() + buffered, static_cast<streamsize>(bytesToRead));
+        if (static_cast<std::size_t>(stream.gcount()) != bytesToRead) {
+            diag.emplace_back(DiagLevel::Critical, "The stream ends before all frames could be read.", context);
+            throw TruncatedDataException();
+        }
+        buffered += bytesToRead;
+        remaining -= bytesToRead;
+
+        // keep the incomplete frame at the end of the batch for the next batch
+        const auto consumed = analyzeBatch(buffer.get(), buffered, !remaining, statistics, skippedBytes);
+        memmove(buffer.get(), buffer.get() + consumed, buffered - consumed);
+        buffered -= consumed;
+    }
+    finish(statistics, skippedBytes, diag);
+    return statistics;
+}
+
+/*!
+ * \brief Analyzes the frames within the specified \a buffer and adds the results to \a statistics.
+ * \returns Returns the number of bytes processed. Unless \a isLast is set, a frame exceeding the buffer is not
+ *          processed so it can be analyzed as part of the next batch.
+ */
+std::size_t AacFrameAnalyzer::analyzeBatch(
+    const char *buffer, std::size_t size, bool isLast, AacFrameStatistics &statistics, std::uint64_t &skippedBytes)
+{
+    // locate frames; the first frame is only taken as reference if the next frame matches it
+    auto frames = vector<FrameInfo>();
+    frames.reserve(size / 256);
+    auto index = std::size_t();
+    for (auto frame = AdtsFrame(), next = AdtsFrame(); index + AdtsFrame::maxHeaderSize <= size;) {
+        const auto *const reference = frames.empty() ? nullptr : &frames.front().header;
+        if (!parseFrame(reference, buffer, size, index, frame)) {
+            if (!isLast && index + 0x2000 > size) {
+                break; // the frame might be continued within the next batch
+            }
+            ++index;
+            ++skippedBytes;
+            continue;
+        }
+        const auto nextIndex = index + frame.totalSize();
+        if (!reference && !parseFrame(&frame, buffer, size, nextIndex, next) && (!isLast || nextIndex != size)) {
+            if (!isLast && index + 0x4000 > size) {
+                break; // the next frame might be continued within the next batch
+            }
+            ++index;
+            ++skippedBytes;
+            continue;
+        }
+        frames.emplace_back(FrameInfo{ index, frame });
+        index = nextIndex;
+    }
+    if (isLast) {
+        skippedBytes += size - index;
+        index = size;
+    }
+    if (frames.empty()) {
+        return index;
+    }
+
+    // parse groups of successive frames concurrently
+    const auto &reference = frames.front().header;
+    const auto taskCount = (frames.size() + m_framesPerTask - 1) / m_framesPerTask;
+    auto results = vector<AacFrameStatistics>(taskCount);
+    BatchParser::runConcurrently(taskCount, m_parallelism, m_aborted, [&, this](size_t task) {
+        auto parser = AacFrameElementParser(
+            reference.mpeg4AudioObjectId(), reference.mpeg4SamplingFrequencyIndex(), 0xFF, reference.mpeg4ChannelConfig());
+        for (auto i = task * m_framesPerTask, end = min(i + m_framesPerTask, frames.size()); i != end; ++i) {
+            const auto &frame = frames[i];
+            try {
+                parser.parse(frame.header, buffer + frame.offset + frame.header.headerSize(), frame.header.dataSize());
+            } catch (const Failure &) {
+                // the frame is counted as incomplete by the parser
+            } catch (const std::ios_base::failure &) {
+                // the frame is counted as incomplete by the parser
+            }
+        }
+        results[task] = parser.statistics();
+    });
+    for (const auto &result : results) {
+        statistics += result;
+    }
+    return index;
+}
+
+/*!
+ * \brief Adds diagnostic messages about the analysis to \a diag.
+ */
+void AacFrameAnalyzer::finish(const AacFrameStatistics &statistics, std::uint64_t skippedBytes, Diagnostics &diag) const
+{
+    static const string context("analyzing AAC frames");
+    if (skippedBytes) {
+        diag.emplace_back(DiagLevel::Warning, argsToString(skippedBytes, " bytes not belonging to any ADTS frame have been skipped."), context);
+    }
+    if (!statistics.frameCount) {
+        diag.emplace_back(DiagLevel::Warning, "No ADTS frames found.", context);
+    } else if (statistics.incompleteFrameCount) {
+        diag.emplace_back(DiagLevel::Information,
+            argsToString(statistics.incompleteFrameCount, " of ", statistics.frameCount, " frames could not be parsed completely."), context);
+    }
+    if (isAborted()) {
+        diag.emplace_back(DiagLevel::Information, "The analysis has been aborted; the statistics only cover some frames.", context);
+    }
+}
+
+} // namespace TagParser
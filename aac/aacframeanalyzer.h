@@ -0,0 +1,97 @@
+#ifndef TAG_PARSER_AACFRAMEANALYZER_H
+#define TAG_PARSER_AACFRAMEANALYZER_H
+
+// NOTE: The AAC parser is still WIP. It does not work yet and its API/ABI may change even in patch releases.
+
+#include "./aacframe.h"
+
+#include "../diagnostics.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+namespace TagParser {
+
+class TAG_PARSER_EXPORT AacFrameAnalyzer {
+public:
+    explicit AacFrameAnalyzer(unsigned int parallelism = 0);
+
+    unsigned int parallelism() const;
+    void setParallelism(unsigned int parallelism);
+    std::size_t framesPerTask() const;
+    void setFramesPerTask(std::size_t framesPerTask);
+
+    AacFrameStatistics analyze(const char *buffer, std::size_t size, Diagnostics &diag);
+    AacFrameStatistics analyze(std::istream &stream, std::uint64_t size, Diagnostics &diag);
+    void abort();
+    bool isAborted() const;
+
+    /// \brief The number of bytes read at once by analyze(std::istream &, std::uint64_t, Diagnostics &).
+    static constexpr std::size_t batchSize = 0x1000000;
+
+private:
+    std::size_t analyzeBatch(const char *buffer, std::size_t size, bool isLast, AacFrameStatistics &statistics, std::uint64_t &skippedBytes);
+    void finish(const AacFrameStatistics &statistics, std::uint64_t skippedBytes, Diagnostics &diag) const;
+
+    unsigned int m_parallelism;
+    std::size_t m_framesPerTask;
+    std::atomic<bool> m_aborted;
+};
+
+/*!
+ * \brief Returns the number of threads used to parse frames.
+ * \remarks A value of zero means the number of hardware threads is used.
+ */
+inline unsigned int AacFrameAnalyzer::parallelism() const
+{
+    return m_parallelism;
+}
+
+/*!
+ * \brief Sets the number of threads used to parse frames.
+ * \sa parallelism()
+ */
+inline void AacFrameAnalyzer::setParallelism(unsigned int parallelism)
+{
+    m_parallelism = parallelism;
+}
+
+/*!
+ * \brief Returns the number of successive frames parsed by the same parser within one task.
+ */
+inline std::size_t AacFrameAnalyzer::framesPerTask() const
+{
+    return m_framesPerTask;
+}
+
+/*!
+ * \brief Sets the number of successive frames parsed by the same parser within one task.
+ * \remarks The SBR state is only kept within a task so tasks should not be too small. A value of zero is treated as one.
+ */
+inline void AacFrameAnalyzer::setFramesPerTask(std::size_t framesPerTask)
+{
+    m_framesPerTask = framesPerTask ? framesPerTask : 1;
+}
+
+/*!
+ * \brief Aborts the analysis. Tasks which are currently running are still finished.
+ * \remarks May be called from any thread.
+ */
+inline void AacFrameAnalyzer::abort()
+{
+    m_aborted.store(true);
+}
+
+/*!
+ * \brief Returns whether the analysis has been aborted.
+ */
+inline bool AacFrameAnalyzer::isAborted() const
+{
+    return m_aborted.load();
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_AACFRAMEANALYZER_H
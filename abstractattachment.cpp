@@ -1,9 +1,18 @@
 #include "./abstractattachment.h"
 
 #include "./exceptions.h"
+#include "./filerangecopier.h"
 #include "./mediafileinfo.h"
+#include "./seeklessoutputstream.h"
 
+#include <c++utilities/conversion/stringbuilder.h>
 #include <c++utilities/io/copy.h>
+#include <c++utilities/io/nativefilestream.h>
+
+#ifdef PLATFORM_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #include <memory>
 #include <sstream>
@@ -65,6 +74,7 @@ StreamDataBlock::~StreamDataBlock()
 
 /*!
  * \brief Buffers the data block. Buffered data can be accessed via buffer().
+ * \remarks Derived classes might obtain the data differently, e.g. by decompressing it.
  */
 void StreamDataBlock::makeBuffer() const
 {
@@ -88,6 +98,74 @@ void StreamDataBlock::copyTo(ostream &stream) const
     }
 }
 
+/*!
+ * \brief Writes the data to the file at the specified \a path; the file is created or truncated.
+ *
+ * This is meant to extract attachments and covers without buffering them (see extractTo(int) for details).
+ *
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+void StreamDataBlock::extractTo(const std::string &path) const
+{
+#ifdef PLATFORM_UNIX
+    const auto fileDescriptor = ::open(BasicFileInfo::pathForOpen(path), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fileDescriptor < 0) {
+        throw std::ios_base::failure("Unable to open \"" % path + "\" for writing.");
+    }
+    try {
+        extractTo(fileDescriptor);
+    } catch (...) {
+        ::close(fileDescriptor);
+        throw;
+    }
+    if (::close(fileDescriptor) != 0) {
+        throw std::ios_base::failure("Unable to close \"" % path + "\" after writing.");
+    }
+#else
+    NativeFileStream file;
+    file.exceptions(ios_base::badbit | ios_base::failbit);
+    file.open(BasicFileInfo::pathForOpen(path), ios_base::out | ios_base::binary | ios_base::trunc);
+    copyTo(file);
+    file.close();
+#endif
+}
+
+#ifdef PLATFORM_UNIX
+/*!
+ * \brief Writes the data to the specified \a fileDescriptor at its current position.
+ *
+ * If the data has not been buffered and the file it refers to is known (see setFilePath()), the data is copied by the
+ * kernel (see FileRangeCopier::copyToFileDescriptor()) so it does not pass through userspace. This works if
+ * \a fileDescriptor refers to a regular file, a pipe or a socket. Otherwise the data is written via copyTo().
+ *
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ * \remarks The \a fileDescriptor is not closed.
+ */
+void StreamDataBlock::extractTo(int fileDescriptor) const
+{
+    const auto count = static_cast<std::uint64_t>(size());
+    auto copied = std::uint64_t();
+    if (!buffer()) {
+        if (const auto path = filePath(); !path.empty()) {
+            copied = FileRangeCopier::copyToFileDescriptor(path, static_cast<std::uint64_t>(startOffset()), fileDescriptor, count);
+        }
+    }
+    if (copied == count) {
+        return;
+    }
+    SeeklessOutputStream output(fileDescriptor);
+    if (!copied) {
+        copyTo(output);
+    } else {
+        // write the rest the kernel could not copy; the data is not decoded in this case (see setFilePath())
+        CopyHelper<0x10000> copyHelper;
+        m_stream().seekg(startOffset() + static_cast<std::istream::off_type>(copied));
+        copyHelper.copy(m_stream(), output, count - copied);
+    }
+    output.flush();
+}
+#endif
+
 /*!
  * \class TagParser::FileDataBlock
  * \brief The FileDataBlock class is a reference to a certain data block of a file stream.
@@ -109,6 +187,7 @@ FileDataBlock::FileDataBlock(const string &path, Diagnostics &diag)
     m_startOffset = 0;
     m_endOffset = m_fileInfo->size();
     m_stream = [this]() -> std::istream & { return this->m_fileInfo->stream(); };
+    m_filePath = [this] { return this->m_fileInfo->path(); };
 }
 
 /*!
@@ -152,6 +231,7 @@ void AbstractAttachment::clear()
     m_mimeType.clear();
     m_id = 0;
     m_data.reset();
+    m_modified = true;
 }
 
 /*!
@@ -181,6 +261,7 @@ void AbstractAttachment::setFile(const std::string &path, Diagnostics &diag)
     }
     m_data = move(file);
     m_isDataFromFile = true;
+    m_modified = true;
 }
 
 } // namespace TagParser
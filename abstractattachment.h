@@ -4,8 +4,9 @@
 #include "./diagnostics.h"
 
 #include <functional>
-#include <iostream>
+#include <istream>
 #include <memory>
+#include <ostream>
 #include <string>
 
 namespace TagParser {
@@ -24,14 +25,21 @@ public:
     std::istream::pos_type endOffset() const;
     std::istream::pos_type size() const;
     const std::unique_ptr<char[]> &buffer() const;
-    void makeBuffer() const;
+    virtual void makeBuffer() const;
     void discardBuffer();
-    void copyTo(std::ostream &stream) const;
+    virtual void copyTo(std::ostream &stream) const;
+    std::string filePath() const;
+    void setFilePath(const std::function<std::string()> &filePath);
+    void extractTo(const std::string &path) const;
+#ifdef PLATFORM_UNIX
+    void extractTo(int fileDescriptor) const;
+#endif
 
 protected:
     StreamDataBlock();
 
     std::function<std::istream &()> m_stream;
+    std::function<std::string()> m_filePath;
     std::istream::pos_type m_startOffset;
     std::istream::pos_type m_endOffset;
     mutable std::unique_ptr<char[]> m_buffer;
@@ -87,6 +95,30 @@ inline void StreamDataBlock::discardBuffer()
     m_buffer.reset();
 }
 
+/*!
+ * \brief Returns the path of the file the offsets of the data block refer to; returns an empty string if not known.
+ * \sa setFilePath()
+ */
+inline std::string StreamDataBlock::filePath() const
+{
+    return m_filePath ? m_filePath() : std::string();
+}
+
+/*!
+ * \brief Sets the path of the file the offsets of the data block refer to.
+ *
+ * The path must be provided as function for the same reason the stream is (see StreamDataBlock()). It allows
+ * extractTo() and FileRangeCopier::copyFromFile() to let the kernel copy the data. The function may return an empty
+ * string if the stream does not refer to a file (anymore).
+ *
+ * \remarks Must not be set by derived classes which decode the data (e.g. decompress it) as the data can not be copied
+ *          as-is then.
+ */
+inline void StreamDataBlock::setFilePath(const std::function<std::string()> &filePath)
+{
+    m_filePath = filePath;
+}
+
 class TAG_PARSER_EXPORT FileDataBlock : public StreamDataBlock {
 public:
     FileDataBlock(const std::string &path, Diagnostics &diag);
@@ -121,6 +153,8 @@ public:
     bool isIgnored() const;
     void setIgnored(bool ignored);
     bool isEmpty() const;
+    bool isModified() const;
+    void setModified(bool modified);
 
 protected:
     AbstractAttachment();
@@ -133,6 +167,7 @@ private:
     std::unique_ptr<StreamDataBlock> m_data;
     bool m_isDataFromFile;
     bool m_ignored;
+    bool m_modified;
 };
 
 /*!
@@ -142,6 +177,7 @@ inline AbstractAttachment::AbstractAttachment()
     : m_id(0)
     , m_isDataFromFile(false)
     , m_ignored(false)
+    , m_modified(true)
 {
 }
 
@@ -158,7 +194,10 @@ inline const std::string &AbstractAttachment::description() const
  */
 inline void AbstractAttachment::setDescription(const std::string &description)
 {
-    m_description = description;
+    if (m_description != description) {
+        m_description = description;
+        m_modified = true;
+    }
 }
 
 /*!
@@ -174,7 +213,10 @@ inline const std::string &AbstractAttachment::name() const
  */
 inline void AbstractAttachment::setName(const std::string &name)
 {
-    m_name = name;
+    if (m_name != name) {
+        m_name = name;
+        m_modified = true;
+    }
 }
 
 /*!
@@ -190,7 +232,10 @@ inline const std::string &AbstractAttachment::mimeType() const
  */
 inline void AbstractAttachment::setMimeType(const std::string &mimeType)
 {
-    m_mimeType = mimeType;
+    if (m_mimeType != mimeType) {
+        m_mimeType = mimeType;
+        m_modified = true;
+    }
 }
 
 /*!
@@ -206,7 +251,10 @@ inline std::uint64_t AbstractAttachment::id() const
  */
 inline void AbstractAttachment::setId(const std::uint64_t &id)
 {
-    m_id = id;
+    if (m_id != id) {
+        m_id = id;
+        m_modified = true;
+    }
 }
 
 /*!
@@ -230,6 +278,7 @@ inline void AbstractAttachment::setData(std::unique_ptr<StreamDataBlock> &&data)
 {
     m_data = std::move(data);
     m_isDataFromFile = false;
+    m_modified = true;
 }
 
 /*!
@@ -258,7 +307,32 @@ inline bool AbstractAttachment::isIgnored() const
  */
 inline void AbstractAttachment::setIgnored(bool ignored)
 {
-    m_ignored = ignored;
+    if (m_ignored != ignored) {
+        m_ignored = ignored;
+        m_modified = true;
+    }
+}
+
+/*!
+ * \brief Returns whether the attachment has been modified since it has been parsed.
+ *
+ * Newly created attachments are considered modified. The setters only mark the attachment as modified if the new
+ * value differs from the present one; assigning data always does.
+ *
+ * \sa MediaFileInfo::changes()
+ */
+inline bool AbstractAttachment::isModified() const
+{
+    return m_modified;
+}
+
+/*!
+ * \brief Sets whether the attachment is considered modified.
+ * \remarks This is done by MediaFileInfo after parsing the attachment.
+ */
+inline void AbstractAttachment::setModified(bool modified)
+{
+    m_modified = modified;
 }
 
 /*!
@@ -1,5 +1,8 @@
 #include "./abstractcontainer.h"
 #include "./diagnostics.h"
+#include "./tracepoints.h"
+
+#include <c++utilities/conversion/stringbuilder.h>
 
 using namespace std;
 using namespace CppUtilities;
@@ -26,10 +29,19 @@ AbstractContainer::AbstractContainer(iostream &stream, std::uint64_t startOffset
     , m_tracksAltered(false)
     , m_chaptersParsed(false)
     , m_attachmentsParsed(false)
+    , m_modified(false)
+    , m_planningFile(false)
+    , m_seeklessOutput(nullptr)
     , m_startOffset(startOffset)
     , m_stream(&stream)
+    , m_mappedData(nullptr)
     , m_reader(BinaryReader(m_stream))
     , m_writer(BinaryWriter(m_stream))
+    , m_parsedElementCount(0)
+    , m_memoryAccount(nullptr)
+    , m_elementCount(0)
+    , m_elementArenaEnabled(false)
+    , m_parseLimitExceeded(false)
 {
 }
 
@@ -57,7 +69,9 @@ void AbstractContainer::parseHeader(Diagnostics &diag)
     if (!isHeaderParsed()) {
         removeAllTags();
         removeAllTracks();
+        TAG_PARSER_TRACEPOINT_SCOPE(container_parse_header, startOffset(), parsedElementCount(), trackCount(), tagCount());
         internalParseHeader(diag);
+        checkParseLimits();
         m_headerParsed = true;
     }
 }
@@ -84,6 +98,7 @@ void AbstractContainer::parseTags(Diagnostics &diag)
     if (!areTagsParsed()) {
         parseHeader(diag);
         internalParseTags(diag);
+        checkParseLimits();
         m_tagsParsed = true;
     }
 }
@@ -108,6 +123,7 @@ void AbstractContainer::parseTracks(Diagnostics &diag)
     if (!areTracksParsed()) {
         parseHeader(diag);
         internalParseTracks(diag);
+        checkParseLimits();
         m_tracksParsed = true;
         m_tracksAltered = false;
     }
@@ -128,6 +144,7 @@ void AbstractContainer::parseChapters(Diagnostics &diag)
     if (!areChaptersParsed()) {
         parseHeader(diag);
         internalParseChapters(diag);
+        checkParseLimits();
         m_chaptersParsed = true;
     }
 }
@@ -147,10 +164,32 @@ void AbstractContainer::parseAttachments(Diagnostics &diag)
     if (!areAttachmentsParsed()) {
         parseHeader(diag);
         internalParseAttachments(diag);
+        checkParseLimits();
         m_attachmentsParsed = true;
     }
 }
 
+/*!
+ * \brief Continues parsing after data has been appended to the file (e.g. by a recording or download still in progress).
+ * \returns Returns whether the container could take the appended data into account. If not, the file needs to be
+ *          parsed from scratch (see MediaFileInfo::resumeParsing()).
+ *
+ * The new size of the file must have been reported via BasicFileInfo::reportSizeChanged() before. The implementations
+ * keep the state of the previous parsing (e.g. the element tree or the page table) and parse only the appended data.
+ *
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ * \throws Throws Failure or a derived class when an parsing error occurs.
+ */
+bool AbstractContainer::resumeParsing(Diagnostics &diag)
+{
+    if (!isHeaderParsed()) {
+        return false;
+    }
+    const auto resumed = internalResumeParsing(diag);
+    checkParseLimits();
+    return resumed;
+}
+
 /*!
  * \brief Rewrites the file to apply changed tag information.
  *
@@ -160,7 +199,108 @@ void AbstractContainer::parseAttachments(Diagnostics &diag)
  */
 void AbstractContainer::makeFile(Diagnostics &diag, AbortableProgressFeedback &progress)
 {
+    TAG_PARSER_TRACEPOINT_SCOPE(container_make_file, startOffset(), parsedElementCount(), trackCount(), tagCount());
+    checkParseLimits();
+    m_applyChangesResult = ApplyChangesResult();
     internalMakeFile(diag, progress);
+    checkParseLimits();
+}
+
+/*!
+ * \brief Calculates the layout of the file makeFile() would make without writing anything.
+ * \returns Returns the predicted strategy, padding, size of the new file and number of bytes to be copied.
+ *
+ * The implementations calculate the layout within internalMakeFile() as usual and return before the file is touched
+ * if m_planningFile is set. The parsing results are kept.
+ *
+ * \throws Throws the same exceptions as makeFile() (except those caused by writing the file).
+ * \sa MediaFileInfo::planChanges()
+ */
+ApplyChangesResult AbstractContainer::planFile(Diagnostics &diag, AbortableProgressFeedback &progress)
+{
+    checkParseLimits();
+    m_applyChangesResult = ApplyChangesResult();
+    m_planningFile = true;
+    try {
+        internalMakeFile(diag, progress);
+    } catch (...) {
+        m_planningFile = false;
+        throw;
+    }
+    m_planningFile = false;
+    return m_applyChangesResult;
+}
+
+/*!
+ * \brief Writes the file with the changes applied strictly forward to the specified \a output.
+ *
+ * The implementations calculate the layout within internalMakeFile() as usual and write the new file to
+ * m_seeklessOutput (instead of modifying the file) if it is set. The original file is left untouched and the parsing
+ * results are kept.
+ *
+ * \throws Throws the same exceptions as makeFile() and TagParser::NotImplementedException if writing to a seekless
+ *         output is not supported for the file (currently only MP4 files which are not fragmented and whose tracks have
+ *         not been altered and Matroska files are supported).
+ * \sa MediaFileInfo::writeChanges()
+ */
+void AbstractContainer::writeFile(SeeklessOutputStream &output, Diagnostics &diag, AbortableProgressFeedback &progress)
+{
+    checkParseLimits();
+    m_applyChangesResult = ApplyChangesResult();
+    m_seeklessOutput = &output;
+    try {
+        internalMakeFile(diag, progress);
+    } catch (...) {
+        m_seeklessOutput = nullptr;
+        throw;
+    }
+    m_seeklessOutput = nullptr;
+}
+
+/*!
+ * \brief Checks whether the specified \a value exceeds the specified \a limit (which is one of the parseLimits()).
+ * \returns Returns whether the limit is exceeded; in this case a critical message describing \a what has been limited
+ *          is added to \a diag and parsing or making the file fails after the current phase.
+ * \remarks This is called by the implementations before building the limited structure. They are supposed to skip
+ *          the structure or to throw a Failure if true is returned.
+ */
+bool AbstractContainer::exceedsParseLimit(
+    std::uint64_t value, std::uint64_t limit, std::string_view what, Diagnostics &diag, const std::string &context)
+{
+    if (!limit || value <= limit) {
+        return false;
+    }
+    diag.emplace_back(DiagLevel::Critical, argsToString("The ", what, " (", value, ") exceeds the configured limit of ", limit, '.'), context);
+    m_parseLimitExceeded = true;
+    return true;
+}
+
+/*!
+ * \brief Reports that ParseLimits::maxElements has been exceeded (only once) and throws InvalidDataException.
+ */
+void AbstractContainer::rejectElement(Diagnostics &diag)
+{
+    m_parseLimitExceeded = true;
+    if (m_elementCount == m_parseLimits.maxElements + 1) {
+        diag.emplace_back(DiagLevel::Critical, argsToString("The number of elements exceeds the configured limit of ", m_parseLimits.maxElements, '.'),
+            "parsing element structure");
+    }
+    throw InvalidDataException();
+}
+
+/*!
+ * \brief Throws a Failure if a limit has been exceeded.
+ * \remarks The implementations might have caught the exception thrown when exceeding a limit to continue after a
+ *          broken element or skipped a structure exceeding a limit. This makes the current phase fail nevertheless.
+ */
+void AbstractContainer::checkParseLimits() const
+{
+    if (m_memoryAccount && m_memoryAccount->isLimitExceeded()) {
+        throw MemoryLimitExceededException();
+    }
+    if (m_parseLimitExceeded) {
+        throw InvalidDataException();
+    }
 }
 
 /*!
@@ -186,6 +326,25 @@ ElementPosition AbstractContainer::determineIndexPosition(Diagnostics &diag) con
     return ElementPosition::Keep;
 }
 
+/*!
+ * \brief Adds the media payload of the file to the specified \a hasher.
+ *
+ * Must be implemented when subclassing to provide this feature. Only the data of the tracks must be added (in the order
+ * it is stored in the file) so the hash does not change when tags or other meta-data are modified.
+ *
+ * \throws Throws TagParser::NotImplementedException if not supported by the container format.
+ * \throws Throws Failure or a derived class when a parsing error occurs.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ * \sa MediaFileInfo::hashMediaPayload()
+ */
+void AbstractContainer::hashMediaPayload(MediaPayloadHasher &hasher, Diagnostics &diag, AbortableProgressFeedback &progress)
+{
+    CPP_UTILITIES_UNUSED(hasher);
+    CPP_UTILITIES_UNUSED(diag);
+    CPP_UTILITIES_UNUSED(progress);
+    throw NotImplementedException();
+}
+
 /*!
  * \brief Internally called to parse the header.
  *
@@ -256,10 +415,27 @@ void AbstractContainer::internalParseAttachments(Diagnostics &diag)
     throw NotImplementedException();
 }
 
+/*!
+ * \brief Internally called to continue parsing after data has been appended to the file (see resumeParsing()).
+ *
+ * Might be implemented when subclassing to provide this feature. The default implementation returns false so the file
+ * is parsed from scratch.
+ *
+ * \throws Throws Failure or a derived class when a parsing error occurs.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+bool AbstractContainer::internalResumeParsing(Diagnostics &diag)
+{
+    CPP_UTILITIES_UNUSED(diag);
+    return false;
+}
+
 /*!
  * \brief Internally called to make the file.
  *
- * Must be implemented when subclassing.
+ * Must be implemented when subclassing. If m_planningFile is set, only the layout must be calculated and reported via
+ * m_applyChangesResult (see planFile()). If m_seeklessOutput is set, the new file must be written strictly forward to
+ * it without modifying the original file (see writeFile()); throw a NotImplementedException if that is not supported.
  *
  * \throws Throws Failure or a derived class when a parsing error occurs.
  * \throws Throws std::ios_base::failure when an IO error occurs.
@@ -486,12 +662,15 @@ void AbstractContainer::reset()
     m_tracksAltered = false;
     m_chaptersParsed = false;
     m_attachmentsParsed = false;
+    m_modified = false;
     m_version = 0;
     m_readVersion = 0;
     m_doctypeVersion = 0;
     m_doctypeReadVersion = 0;
     m_timeScale = 0;
     m_titles.clear();
+    m_elementCount = 0;
+    m_parseLimitExceeded = false;
 }
 
 } // namespace TagParser
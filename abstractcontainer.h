@@ -1,7 +1,11 @@
 #ifndef TAG_PARSER_ABSTRACTCONTAINER_H
 #define TAG_PARSER_ABSTRACTCONTAINER_H
 
+#include "./applychangesresult.h"
+#include "./elementarena.h"
 #include "./exceptions.h"
+#include "./filerangecopier.h"
+#include "./memoryaccount.h"
 #include "./settings.h"
 #include "./tagtarget.h"
 
@@ -10,7 +14,9 @@
 #include <c++utilities/io/binaryreader.h>
 #include <c++utilities/io/binarywriter.h>
 
-#include <iostream>
+#include <istream>
+#include <ostream>
+#include <string_view>
 
 namespace CppUtilities {
 class BinaryReader;
@@ -25,6 +31,8 @@ class AbstractChapter;
 class AbstractAttachment;
 class Diagnostics;
 class AbortableProgressFeedback;
+class MediaPayloadHasher;
+class SeeklessOutputStream;
 
 class TAG_PARSER_EXPORT AbstractContainer {
 public:
@@ -32,6 +40,23 @@ public:
 
     std::iostream &stream();
     void setStream(std::iostream &stream);
+    std::string_view mappedData() const;
+    FileRangeCopier &rangeCopier();
+    bool isElementArenaEnabled() const;
+    void setElementArenaEnabled(bool enabled);
+    ElementArena *elementArena();
+    std::unique_ptr<ElementArena> takeElementArena();
+    void setElementArena(std::unique_ptr<ElementArena> &&arena);
+    std::uint64_t parsedElementCount() const;
+    void countParsedElement();
+    MemoryAccount *memoryAccount();
+    void setMemoryAccount(MemoryAccount *account);
+    void accountMemory(std::uint64_t size);
+    const ParseLimits &parseLimits() const;
+    void setParseLimits(const ParseLimits &limits);
+    bool isParseLimitExceeded() const;
+    bool exceedsParseLimit(std::uint64_t value, std::uint64_t limit, std::string_view what, Diagnostics &diag, const std::string &context);
+    void accountElement(std::size_t size, Diagnostics &diag);
     std::uint64_t startOffset() const;
     CppUtilities::BinaryReader &reader();
     CppUtilities::BinaryWriter &writer();
@@ -41,13 +66,19 @@ public:
     void parseTracks(Diagnostics &diag);
     void parseChapters(Diagnostics &diag);
     void parseAttachments(Diagnostics &diag);
+    bool resumeParsing(Diagnostics &diag);
     void makeFile(Diagnostics &diag, AbortableProgressFeedback &progress);
+    ApplyChangesResult planFile(Diagnostics &diag, AbortableProgressFeedback &progress);
+    void writeFile(SeeklessOutputStream &output, Diagnostics &diag, AbortableProgressFeedback &progress);
+    const ApplyChangesResult &applyChangesResult() const;
 
     bool isHeaderParsed() const;
     bool areTagsParsed() const;
     bool areTracksParsed() const;
     bool areChaptersParsed() const;
     bool areAttachmentsParsed() const;
+    bool isModified() const;
+    void setModified(bool modified);
 
     virtual Tag *createTag(const TagTarget &target = TagTarget());
     virtual Tag *tag(std::size_t index);
@@ -62,6 +93,7 @@ public:
     virtual void removeAllTracks();
     virtual bool supportsTrackModifications() const;
     virtual ElementPosition determineIndexPosition(Diagnostics &diag) const;
+    virtual void hashMediaPayload(MediaPayloadHasher &hasher, Diagnostics &diag, AbortableProgressFeedback &progress);
 
     virtual AbstractChapter *chapter(std::size_t index);
     virtual std::size_t chapterCount() const;
@@ -94,7 +126,10 @@ protected:
     virtual void internalParseTracks(Diagnostics &diag);
     virtual void internalParseChapters(Diagnostics &diag);
     virtual void internalParseAttachments(Diagnostics &diag);
+    virtual bool internalResumeParsing(Diagnostics &diag);
     virtual void internalMakeFile(Diagnostics &diag, AbortableProgressFeedback &progress);
+    void setMappedData(const std::string_view *mappedData);
+    void releaseElementArena();
 
     std::uint64_t m_version;
     std::uint64_t m_readVersion;
@@ -113,12 +148,28 @@ protected:
     bool m_tracksAltered;
     bool m_chaptersParsed;
     bool m_attachmentsParsed;
+    bool m_modified;
+    bool m_planningFile;
+    SeeklessOutputStream *m_seeklessOutput;
+    ApplyChangesResult m_applyChangesResult;
 
 private:
+    void rejectElement(Diagnostics &diag);
+    void checkParseLimits() const;
+
     std::uint64_t m_startOffset;
     std::iostream *m_stream;
+    const std::string_view *m_mappedData;
+    FileRangeCopier m_rangeCopier;
     CppUtilities::BinaryReader m_reader;
     CppUtilities::BinaryWriter m_writer;
+    std::unique_ptr<ElementArena> m_elementArena;
+    std::uint64_t m_parsedElementCount;
+    MemoryAccount *m_memoryAccount;
+    ParseLimits m_parseLimits;
+    std::uint64_t m_elementCount;
+    bool m_elementArenaEnabled;
+    bool m_parseLimitExceeded;
 };
 
 /*!
@@ -139,6 +190,194 @@ inline void AbstractContainer::setStream(std::iostream &stream)
     m_writer.setStream(m_stream);
 }
 
+/*!
+ * \brief Returns the memory-mapped data of the related stream or an empty view if not mapped.
+ * \sa BasicFileInfo::mappedData()
+ */
+inline std::string_view AbstractContainer::mappedData() const
+{
+    return m_mappedData ? *m_mappedData : std::string_view();
+}
+
+/*!
+ * \brief Sets the memory-mapped data of the related stream.
+ * \remarks The specified view is only referenced and supposed to be BasicFileInfo::mappedData() so it is always up-to-date.
+ */
+inline void AbstractContainer::setMappedData(const std::string_view *mappedData)
+{
+    m_mappedData = mappedData;
+}
+
+/*!
+ * \brief Returns the copier used to copy unchanged data from the original file when rewriting the file.
+ * \remarks It is only opened while the file is rewritten; otherwise it just copies in userspace.
+ */
+inline FileRangeCopier &AbstractContainer::rangeCopier()
+{
+    return m_rangeCopier;
+}
+
+/*!
+ * \brief Returns whether the elements of the container are allocated within an arena.
+ * \sa setElementArenaEnabled()
+ */
+inline bool AbstractContainer::isElementArenaEnabled() const
+{
+    return m_elementArenaEnabled;
+}
+
+/*!
+ * \brief Sets whether the elements of the container are allocated within an arena.
+ *
+ * If enabled, elements created when parsing the element tree are allocated within an ElementArena owned by the container.
+ * The memory is released at once when the container is reset or destroyed.
+ *
+ * \remarks
+ * - Only affects elements allocated afterwards. Elements allocated within the arena remain valid when disabling it.
+ * - Only relevant for containers which are based on GenericFileElement (MP4 and Matroska).
+ * \sa elementArena()
+ */
+inline void AbstractContainer::setElementArenaEnabled(bool enabled)
+{
+    m_elementArenaEnabled = enabled;
+}
+
+/*!
+ * \brief Returns the arena to allocate elements in or nullptr if elements are supposed to be allocated individually.
+ * \sa setElementArenaEnabled()
+ */
+inline ElementArena *AbstractContainer::elementArena()
+{
+    if (!m_elementArenaEnabled) {
+        return nullptr;
+    }
+    if (!m_elementArena) {
+        m_elementArena = std::make_unique<ElementArena>();
+    }
+    return m_elementArena.get();
+}
+
+/*!
+ * \brief Transfers the ownership of the arena used to allocate elements to the caller.
+ * \remarks The elements allocated within the arena stay valid as long as the returned arena exists. So the arena can be
+ *          taken before destroying the container and re-used (see ElementArena::rewind()) after the container has been
+ *          destroyed.
+ * \sa setElementArena()
+ */
+inline std::unique_ptr<ElementArena> AbstractContainer::takeElementArena()
+{
+    return std::move(m_elementArena);
+}
+
+/*!
+ * \brief Assigns an existing \a arena to allocate elements in (e.g. one re-used from a previously parsed file).
+ * \remarks Must be called before elements have been allocated. The arena is only used if enabled via setElementArenaEnabled().
+ * \sa takeElementArena()
+ */
+inline void AbstractContainer::setElementArena(std::unique_ptr<ElementArena> &&arena)
+{
+    m_elementArena = std::move(arena);
+}
+
+/*!
+ * \brief Returns the number of elements parsed since the container has been created.
+ * \remarks
+ * - Only elements based on GenericFileElement (MP4 atoms, MPEG-4 descriptors and EBML elements) are counted.
+ * - Always zero if the library has been built without statistics (see MediaFileInfo::setStatisticsEnabled()).
+ */
+inline std::uint64_t AbstractContainer::parsedElementCount() const
+{
+    return m_parsedElementCount;
+}
+
+/*!
+ * \brief Increments the number of parsed elements.
+ * \remarks This is called by the element implementations when parsing the header of an element.
+ */
+inline void AbstractContainer::countParsedElement()
+{
+#ifndef TAG_PARSER_NO_STATISTICS
+    ++m_parsedElementCount;
+#endif
+}
+
+/*!
+ * \brief Returns the account the memory allocated for parsing results is accounted in or nullptr if not accounted.
+ */
+inline MemoryAccount *AbstractContainer::memoryAccount()
+{
+    return m_memoryAccount;
+}
+
+/*!
+ * \brief Sets the account the memory allocated for parsing results is accounted in; nullptr disables accounting.
+ * \remarks The \a account must outlive the container or be unset before it is destroyed.
+ */
+inline void AbstractContainer::setMemoryAccount(MemoryAccount *account)
+{
+    m_memoryAccount = account;
+}
+
+/*!
+ * \brief Accounts \a size bytes which are about to be allocated for parsing results.
+ * \throws Throws MemoryLimitExceededException if the limit of the account would be exceeded.
+ * \remarks This is called by the element and track implementations (see MemoryAccount for details).
+ */
+inline void AbstractContainer::accountMemory(std::uint64_t size)
+{
+    if (m_memoryAccount) {
+        m_memoryAccount->allocate(size);
+    }
+}
+
+/*!
+ * \brief Returns the limits enforced when parsing and making the file.
+ */
+inline const ParseLimits &AbstractContainer::parseLimits() const
+{
+    return m_parseLimits;
+}
+
+/*!
+ * \brief Sets the limits enforced when parsing and making the file.
+ * \sa ParseLimits
+ */
+inline void AbstractContainer::setParseLimits(const ParseLimits &limits)
+{
+    m_parseLimits = limits;
+}
+
+/*!
+ * \brief Returns whether a limit has been exceeded; parsing and making the file fails in this case.
+ */
+inline bool AbstractContainer::isParseLimitExceeded() const
+{
+    return m_parseLimitExceeded;
+}
+
+/*!
+ * \brief Accounts an element of \a size bytes which is about to be parsed.
+ * \throws Throws InvalidDataException if ParseLimits::maxElements is exceeded and MemoryLimitExceededException if
+ *         the limit of the memory account would be exceeded.
+ * \remarks This is called by GenericFileElement::parse().
+ */
+inline void AbstractContainer::accountElement(std::size_t size, Diagnostics &diag)
+{
+    if (m_parseLimits.maxElements && ++m_elementCount > m_parseLimits.maxElements) {
+        rejectElement(diag);
+    }
+    accountMemory(size);
+}
+
+/*!
+ * \brief Releases the memory of the arena used to allocate elements.
+ * \remarks All elements allocated within the arena must have been destroyed before.
+ */
+inline void AbstractContainer::releaseElementArena()
+{
+    m_elementArena.reset();
+}
+
 /*!
  * \brief Returns the start offset in the related stream.
  */
@@ -195,6 +434,37 @@ inline bool AbstractContainer::areAttachmentsParsed() const
     return m_attachmentsParsed;
 }
 
+/*!
+ * \brief Returns whether the structure of the container has been modified since it has been parsed.
+ *
+ * This is the case if tags or tracks have been added or removed or a title has been changed. Modifications of the
+ * tags, tracks and attachments themselves are tracked by these objects (see e.g. Tag::isModified()).
+ */
+inline bool AbstractContainer::isModified() const
+{
+    return m_modified || m_tracksAltered;
+}
+
+/*!
+ * \brief Sets whether the structure of the container is considered modified.
+ * \remarks Tracks which have been added or removed are still considered as modification until the tracks are parsed again.
+ * \sa isModified()
+ */
+inline void AbstractContainer::setModified(bool modified)
+{
+    m_modified = modified;
+}
+
+/*!
+ * \brief Returns how the file has been modified by the last call of makeFile().
+ * \remarks The implementations only set the strategy, the padding and whether the backup has been copied; the other
+ *          fields are determined by MediaFileInfo::applyChanges().
+ */
+inline const ApplyChangesResult &AbstractContainer::applyChangesResult() const
+{
+    return m_applyChangesResult;
+}
+
 /*!
  * \brief Returns an indication whether the tracks have been parsed yet.
  */
@@ -267,7 +537,11 @@ inline const std::vector<std::string> &AbstractContainer::titles() const
  */
 inline void AbstractContainer::setTitle(const std::string &title, std::size_t segmentIndex)
 {
-    m_titles.at(segmentIndex) = title;
+    auto &existingTitle = m_titles.at(segmentIndex);
+    if (existingTitle != title) {
+        existingTitle = title;
+        m_modified = true;
+    }
 }
 
 /*!
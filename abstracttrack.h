@@ -22,6 +22,7 @@ namespace TagParser {
 class MpegAudioFrameStream;
 class WaveAudioStream;
 class Mp4Track;
+struct TrackColumns;
 
 /*!
  * \brief The TrackType enum specifies the underlying file type of a track and the concrete class of the track object.
@@ -52,6 +53,7 @@ enum class TrackFlags : std::uint64_t {
     UsedInPresentation = (1 << 7), /**< The track is supposed to be used in presentation. */
     UsedWhenPreviewing = (1 << 8), /**< The track is supposed to be used when previewing. */
     Interlaced = (1 << 9), /**< The video is interlaced. */
+    Modified = (1 << 10), /**< The track has been modified since it has been parsed (see AbstractTrack::isModified()). */
 };
 
 } // namespace TagParser
@@ -64,6 +66,7 @@ class TAG_PARSER_EXPORT AbstractTrack {
     friend class MpegAudioFrameStream;
     friend class WaveAudioStream;
     friend class Mp4Track;
+    friend struct TrackColumns;
 
 public:
     virtual ~AbstractTrack();
@@ -89,7 +92,7 @@ public:
     void setTrackNumber(std::uint32_t trackNumber);
     std::uint64_t id() const;
     void setId(std::uint64_t id);
-    const std::string name() const;
+    const std::string &name() const;
     void setName(const std::string &name);
     const CppUtilities::TimeSpan &duration() const;
     double bitrate() const;
@@ -135,6 +138,8 @@ public:
 
     void parseHeader(Diagnostics &diag);
     bool isHeaderValid() const;
+    bool isModified() const;
+    void setModified(bool modified);
 
 protected:
     AbstractTrack(std::istream &inputStream, std::ostream &outputStream, std::uint64_t startOffset);
@@ -358,7 +363,10 @@ inline std::uint32_t AbstractTrack::trackNumber() const
  */
 inline void AbstractTrack::setTrackNumber(std::uint32_t trackNumber)
 {
-    m_trackNumber = trackNumber;
+    if (m_trackNumber != trackNumber) {
+        m_trackNumber = trackNumber;
+        m_flags |= TrackFlags::Modified;
+    }
 }
 
 /*!
@@ -375,13 +383,16 @@ inline std::uint64_t AbstractTrack::id() const
  */
 inline void AbstractTrack::setId(std::uint64_t id)
 {
-    m_id = id;
+    if (m_id != id) {
+        m_id = id;
+        m_flags |= TrackFlags::Modified;
+    }
 }
 
 /*!
  * \brief Returns the track name if known; otherwise returns an empty string.
  */
-inline const std::string AbstractTrack::name() const
+inline const std::string &AbstractTrack::name() const
 {
     return m_name;
 }
@@ -392,7 +403,10 @@ inline const std::string AbstractTrack::name() const
  */
 inline void AbstractTrack::setName(const std::string &name)
 {
-    m_name = name;
+    if (m_name != name) {
+        m_name = name;
+        m_flags |= TrackFlags::Modified;
+    }
 }
 
 /*!
@@ -451,7 +465,10 @@ inline const Locale &AbstractTrack::locale() const
  */
 inline void AbstractTrack::setLocale(const Locale &locale)
 {
-    m_locale = locale;
+    if (m_locale != locale) {
+        m_locale = locale;
+        m_flags |= TrackFlags::Modified;
+    }
 }
 
 /*!
@@ -562,7 +579,10 @@ inline const std::string &AbstractTrack::compressorName() const
  */
 inline void AbstractTrack::setCompressorName(const std::string &compressorName)
 {
-    m_compressorName = compressorName;
+    if (m_compressorName != compressorName) {
+        m_compressorName = compressorName;
+        m_flags |= TrackFlags::Modified;
+    }
 }
 
 /*!
@@ -635,7 +655,10 @@ inline bool AbstractTrack::isEnabled() const
  */
 inline void AbstractTrack::setEnabled(bool enabled)
 {
-    CppUtilities::modFlagEnum(m_flags, TrackFlags::Enabled, enabled);
+    if (isEnabled() != enabled) {
+        CppUtilities::modFlagEnum(m_flags, TrackFlags::Enabled, enabled);
+        m_flags |= TrackFlags::Modified;
+    }
 }
 
 /*!
@@ -652,7 +675,10 @@ inline bool AbstractTrack::isDefault() const
  */
 inline void AbstractTrack::setDefault(bool isDefault)
 {
-    CppUtilities::modFlagEnum(m_flags, TrackFlags::Default, isDefault);
+    if (this->isDefault() != isDefault) {
+        CppUtilities::modFlagEnum(m_flags, TrackFlags::Default, isDefault);
+        m_flags |= TrackFlags::Modified;
+    }
 }
 
 /*!
@@ -669,7 +695,10 @@ inline bool AbstractTrack::isForced() const
  */
 inline void AbstractTrack::setForced(bool forced)
 {
-    CppUtilities::modFlagEnum(m_flags, TrackFlags::Forced, forced);
+    if (isForced() != forced) {
+        CppUtilities::modFlagEnum(m_flags, TrackFlags::Forced, forced);
+        m_flags |= TrackFlags::Modified;
+    }
 }
 
 /*!
@@ -712,6 +741,25 @@ inline bool AbstractTrack::isHeaderValid() const
     return m_flags & TrackFlags::HeaderValid;
 }
 
+/*!
+ * \brief Returns whether the track has been modified since it has been parsed.
+ * \remarks The setters only mark the track as modified if the new value differs from the present one.
+ * \sa MediaFileInfo::changes()
+ */
+inline bool AbstractTrack::isModified() const
+{
+    return m_flags & TrackFlags::Modified;
+}
+
+/*!
+ * \brief Sets whether the track is considered modified.
+ * \remarks This is done by MediaFileInfo after parsing the track.
+ */
+inline void AbstractTrack::setModified(bool modified)
+{
+    CppUtilities::modFlagEnum(m_flags, TrackFlags::Modified, modified);
+}
+
 } // namespace TagParser
 
 #endif // TAG_PARSER_ABSTRACTTRACK_H
@@ -2,9 +2,11 @@
 
 #include "../exceptions.h"
 
+#include <c++utilities/conversion/binaryconversion.h>
 #include <c++utilities/io/binaryreader.h>
 
 using namespace std;
+using namespace CppUtilities;
 
 namespace TagParser {
 
@@ -32,4 +34,25 @@ void AdtsFrame::parseHeader(CppUtilities::BinaryReader &reader)
     }
 }
 
+/*!
+ * \brief Parses the header from the specified \a buffer.
+ * \remarks The \a buffer must provide at least maxHeaderSize bytes. This is used to walk through the frames of
+ *          a buffered block without going through a stream.
+ * \throws Throws InvalidDataException if the data is no valid frame header.
+ */
+void AdtsFrame::parseHeader(const char *buffer)
+{
+    m_header1 = BE::toUInt16(buffer);
+    // check whether syncword is present
+    if ((m_header1 & 0xFFF6u) != 0xFFF0u) {
+        throw InvalidDataException();
+    }
+    m_header2 = (static_cast<std::uint64_t>(BE::toUInt32(buffer + 2)) << 24) | (static_cast<std::uint64_t>(static_cast<std::uint8_t>(buffer[6])) << 16)
+        | (hasCrc() ? BE::toUInt16(buffer + 7) : 0u);
+    // check whether frame length is ok
+    if (totalSize() < headerSize()) {
+        throw InvalidDataException();
+    }
+}
+
 } // namespace TagParser
@@ -3,6 +3,7 @@
 
 #include "../global.h"
 
+#include <cstddef>
 #include <cstdint>
 
 namespace CppUtilities {
@@ -16,6 +17,7 @@ public:
     constexpr AdtsFrame();
 
     void parseHeader(CppUtilities::BinaryReader &reader);
+    void parseHeader(const char *buffer);
 
     constexpr bool isValid() const;
     constexpr bool isMpeg4() const;
@@ -30,6 +32,9 @@ public:
     constexpr std::uint8_t frameCount() const;
     constexpr std::uint16_t crc() const;
 
+    /// \brief The maximum size of the header (with CRC).
+    static constexpr std::size_t maxHeaderSize = 9;
+
 private:
     std::uint16_t m_header1;
     std::uint64_t m_header2;
@@ -2,41 +2,242 @@
 
 #include "../mp4/mp4ids.h"
 
+#include "../diagnostics.h"
 #include "../exceptions.h"
+#include "../tailprobe.h"
 
+#include <algorithm>
+#include <cmath>
+#include <memory>
 #include <string>
 
 using namespace std;
+using namespace CppUtilities;
 
 namespace TagParser {
 
+/// \cond
+namespace {
+
+/// \brief The number of samples (per channel) within a "raw data block" of an ADTS frame.
+constexpr std::uint64_t samplesPerRawDataBlock = 1024;
+/// \brief The minimum number of blocks to sample before the estimate is considered.
+constexpr std::size_t minSampledBlocks = 8;
+/// \brief The maximum number of blocks to sample.
+constexpr std::size_t maxSampledBlocks = 256;
+/// \brief The relative change of the estimated bytes per sample below which the estimate is considered converged.
+constexpr double sampleTolerance = 0.002;
+
+/*!
+ * \brief The FrameWalk struct holds the totals of frames walked through within a block.
+ */
+struct FrameWalk {
+    std::uint64_t bytes = 0;
+    std::uint64_t frames = 0;
+    std::uint64_t samples = 0;
+};
+
+/*!
+ * \brief Returns whether \a frame has the same fixed header fields as \a reference.
+ */
+bool isMatching(const AdtsFrame &reference, const AdtsFrame &frame)
+{
+    return frame.isMpeg4() == reference.isMpeg4() && frame.mpeg4AudioObjectId() == reference.mpeg4AudioObjectId()
+        && frame.mpeg4SamplingFrequencyIndex() == reference.mpeg4SamplingFrequencyIndex()
+        && frame.mpeg4ChannelConfig() == reference.mpeg4ChannelConfig();
+}
+
+/*!
+ * \brief Parses the header at \a index into \a frame and returns whether it is a complete frame matching \a reference.
+ */
+bool parseFrame(const AdtsFrame &reference, const char *buffer, std::size_t size, std::size_t index, AdtsFrame &frame)
+{
+    if (index + AdtsFrame::maxHeaderSize > size || static_cast<unsigned char>(buffer[index]) != 0xFFu
+        || (static_cast<unsigned char>(buffer[index + 1]) & 0xF6u) != 0xF0u) {
+        return false;
+    }
+    try {
+        frame.parseHeader(buffer + index);
+    } catch (const InvalidDataException &) {
+        return false;
+    }
+    return isMatching(reference, frame) && index + frame.totalSize() <= size;
+}
+
+/*!
+ * \brief Walks through the frames within \a buffer starting at \a index until a frame is invalid or exceeds the buffer.
+ */
+FrameWalk walk(const AdtsFrame &reference, const char *buffer, std::size_t size, std::size_t index)
+{
+    auto totals = FrameWalk();
+    for (auto frame = AdtsFrame(); parseFrame(reference, buffer, size, index, frame); index += frame.totalSize()) {
+        totals.bytes += frame.totalSize();
+        totals.frames += 1;
+        totals.samples += frame.frameCount() * samplesPerRawDataBlock;
+    }
+    return totals;
+}
+
+/*!
+ * \brief Returns the index of the first frame within \a buffer which is followed by another matching frame or \a size
+ *        if there is none.
+ */
+std::size_t findSyncPoint(const AdtsFrame &reference, const char *buffer, std::size_t size)
+{
+    auto frame = AdtsFrame(), next = AdtsFrame();
+    for (auto index = std::size_t(); index + AdtsFrame::maxHeaderSize <= size; ++index) {
+        if (parseFrame(reference, buffer, size, index, frame) && parseFrame(reference, buffer, size, index + frame.totalSize(), next)) {
+            return index;
+        }
+    }
+    return size;
+}
+
+} // namespace
+/// \endcond
+
 /*!
  * \class TagParser::AdtsStream
  * \brief Implementation of TagParser::AbstractTrack for ADTS streams.
+ *
+ * The duration, bitrate and sample count are determined by walking through the frame headers which are read in
+ * blocks of blockSize bytes. Streams bigger than maxFullWalkSize are not walked through completely; instead blocks
+ * spread over the whole stream are sampled until the estimated number of bytes per sample converges.
  */
 
 void AdtsStream::internalParseHeader(Diagnostics &diag)
 {
-    CPP_UTILITIES_UNUSED(diag)
-
-    //static const string context("parsing ADTS frame header");
+    static const string context("parsing ADTS frame header");
     if (!m_istream) {
         throw NoDataFoundException();
     }
-    // get size
-    m_istream->seekg(-128, ios_base::end);
-    if (m_reader.readUInt24BE() == 0x544147) {
-        m_size = static_cast<std::uint64_t>(m_istream->tellg()) - 3u - m_startOffset;
-    } else {
-        m_size = static_cast<std::uint64_t>(m_istream->tellg()) + 125u - m_startOffset;
+    // parse only the first frame header if the stream is forward-only
+    if (m_forwardOnly) {
+        m_istream->seekg(static_cast<streamoff>(m_startOffset), ios_base::beg);
+        m_firstFrame.parseHeader(m_reader);
+        applyFirstFrame();
+        diag.emplace_back(DiagLevel::Information,
+            "The input is forward-only so the size, duration and bitrate of the ADTS stream can not be determined.", context);
+        return;
     }
+    // get size: the audio data ends in front of the tags at the end of the file
+    auto localTailProbe = TailProbe();
+    const auto *tailProbe = m_tailProbe;
+    if (!tailProbe || !tailProbe->probed) {
+        localTailProbe.probe(*m_istream);
+        tailProbe = &localTailProbe;
+    }
+    m_size = tailProbe->audioEndOffset > m_startOffset ? tailProbe->audioEndOffset - m_startOffset : 0;
     m_istream->seekg(static_cast<streamoff>(m_startOffset), ios_base::beg);
     // parse frame header
     m_firstFrame.parseHeader(m_reader);
+    applyFirstFrame();
+
+    // determine duration and bitrate from the frames
+    if (!m_samplingFrequency) {
+        return;
+    }
+    if (m_size <= maxFullWalkSize) {
+        walkFrames(diag);
+    } else {
+        sampleFrames(diag);
+    }
+}
+
+/*!
+ * \brief Determines the exact duration by walking through all frames.
+ */
+void AdtsStream::walkFrames(Diagnostics &diag)
+{
+    static const string context("parsing ADTS frames");
+    const auto buffer = make_unique<char[]>(blockSize);
+    const auto end = m_startOffset + m_size;
+    auto totals = FrameWalk();
+    for (auto offset = m_startOffset; offset < end;) {
+        const auto size = static_cast<std::size_t>(min<std::uint64_t>(blockSize, end - offset));
+        m_istream->seekg(static_cast<streamoff>(offset));
+        m_istream->read(buffer.get(), static_cast<streamsize>(size));
+        const auto block = walk(m_firstFrame, buffer.get(), size, 0);
+        if (!block.frames) {
+            break;
+        }
+        totals.bytes += block.bytes;
+        totals.frames += block.frames;
+        totals.samples += block.samples;
+        offset += block.bytes;
+    }
+    if (!totals.samples) {
+        diag.emplace_back(DiagLevel::Warning, "No complete frames found; unable to determine the duration.", context);
+        return;
+    }
+    applyFrameStatistics(totals.samples);
+}
+
+/*!
+ * \brief Estimates the duration by sampling blocks spread over the stream.
+ *
+ * The blocks are taken in the order 0, 1/2, 1/4, 3/4, 1/8, … of the stream so the sampled positions are always spread
+ * over the whole stream. Sampling stops once the estimated bytes per sample change less than a tolerance.
+ */
+void AdtsStream::sampleFrames(Diagnostics &diag)
+{
+    static const string context("sampling ADTS frames");
+    const auto buffer = make_unique<char[]>(blockSize);
+    const auto range = m_size - blockSize;
+    auto totals = FrameWalk();
+    auto estimate = 0.0;
+    for (auto block = std::size_t(); block != maxSampledBlocks; ++block) {
+        // determine position via the bit-reversed block number
+        auto fraction = 0.0;
+        for (auto bits = block, weight = std::size_t(2); bits; bits >>= 1, weight <<= 1) {
+            fraction += (bits & 1) ? 1.0 / static_cast<double>(weight) : 0.0;
+        }
+        m_istream->seekg(static_cast<streamoff>(m_startOffset + static_cast<std::uint64_t>(fraction * static_cast<double>(range))));
+        m_istream->read(buffer.get(), static_cast<streamsize>(blockSize));
+
+        // walk through the frames of the block; only the first block is known to start with a frame
+        const auto syncPoint = block ? findSyncPoint(m_firstFrame, buffer.get(), blockSize) : 0;
+        const auto frames = walk(m_firstFrame, buffer.get(), blockSize, syncPoint);
+        totals.bytes += frames.bytes;
+        totals.frames += frames.frames;
+        totals.samples += frames.samples;
+        if (!totals.samples) {
+            continue;
+        }
+
+        // check whether the estimate has converged
+        const auto previousEstimate = estimate;
+        estimate = static_cast<double>(totals.bytes) / static_cast<double>(totals.samples);
+        if (block + 1 >= minSampledBlocks && abs(estimate - previousEstimate) <= estimate * sampleTolerance) {
+            break;
+        }
+    }
+    if (!totals.samples) {
+        diag.emplace_back(DiagLevel::Warning, "No complete frames found; unable to determine the duration.", context);
+        return;
+    }
+    applyFrameStatistics(static_cast<std::uint64_t>(static_cast<double>(m_size) / estimate));
+}
+
+/*!
+ * \brief Sets the format, channel count and sampling frequency from the first frame.
+ */
+void AdtsStream::applyFirstFrame()
+{
     m_format = Mpeg4AudioObjectIds::idToMediaFormat(m_firstFrame.mpeg4AudioObjectId());
     m_channelCount = Mpeg4ChannelConfigs::channelCount(m_channelConfig = m_firstFrame.mpeg4ChannelConfig());
     std::uint8_t sampleRateIndex = m_firstFrame.mpeg4SamplingFrequencyIndex();
     m_samplingFrequency = sampleRateIndex < sizeof(mpeg4SamplingFrequencyTable) ? mpeg4SamplingFrequencyTable[sampleRateIndex] : 0;
 }
 
+/*!
+ * \brief Sets the sample count, duration and bitrate from the specified \a sampleCount.
+ */
+void AdtsStream::applyFrameStatistics(std::uint64_t sampleCount)
+{
+    m_sampleCount = sampleCount;
+    m_duration = TimeSpan::fromSeconds(static_cast<double>(sampleCount) / static_cast<double>(m_samplingFrequency));
+    m_bitrate = static_cast<double>(m_size) * 8.0 / m_duration.totalSeconds() / 1024.0;
+}
+
 } // namespace TagParser
@@ -7,18 +7,36 @@
 
 namespace TagParser {
 
+struct TailProbe;
+
 class TAG_PARSER_EXPORT AdtsStream final : public AbstractTrack {
 public:
     AdtsStream(std::iostream &stream, std::uint64_t startOffset);
     ~AdtsStream() override;
 
     TrackType type() const override;
+    bool isForwardOnly() const;
+    void setForwardOnly(bool forwardOnly);
+    const TailProbe *tailProbe() const;
+    void setTailProbe(const TailProbe *tailProbe);
+
+    /// \brief The size of the blocks read when walking through the frames.
+    static constexpr std::size_t blockSize = 0x10000;
+    /// \brief Streams up to this size are walked through completely; for bigger streams only blocks are sampled.
+    static constexpr std::uint64_t maxFullWalkSize = 0x400000;
 
 protected:
     void internalParseHeader(Diagnostics &diag) override;
 
 private:
+    void applyFirstFrame();
+    void walkFrames(Diagnostics &diag);
+    void sampleFrames(Diagnostics &diag);
+    void applyFrameStatistics(std::uint64_t sampleCount);
+
     AdtsFrame m_firstFrame;
+    const TailProbe *m_tailProbe;
+    bool m_forwardOnly;
 };
 
 /*!
@@ -26,6 +44,8 @@ private:
  */
 inline AdtsStream::AdtsStream(std::iostream &stream, std::uint64_t startOffset)
     : AbstractTrack(stream, startOffset)
+    , m_tailProbe(nullptr)
+    , m_forwardOnly(false)
 {
     m_mediaType = MediaType::Audio;
 }
@@ -39,6 +59,48 @@ inline TrackType AdtsStream::type() const
     return TrackType::AdtsStream;
 }
 
+/*!
+ * \brief Returns whether the stream is only read forward.
+ * \sa setForwardOnly()
+ */
+inline bool AdtsStream::isForwardOnly() const
+{
+    return m_forwardOnly;
+}
+
+/*!
+ * \brief Sets whether the stream is only read forward (see ByteSource::isForwardOnly()).
+ *
+ * In this case only the first frame header is parsed. The size, duration and bitrate are not determined because that
+ * requires reading the end of the stream or walking through all frames.
+ */
+inline void AdtsStream::setForwardOnly(bool forwardOnly)
+{
+    m_forwardOnly = forwardOnly;
+}
+
+/*!
+ * \brief Returns the probe of the end of the stream used to determine where the audio data ends.
+ * \sa setTailProbe()
+ */
+inline const TailProbe *AdtsStream::tailProbe() const
+{
+    return m_tailProbe;
+}
+
+/*!
+ * \brief Sets the probe of the end of the stream used to determine where the audio data ends.
+ *
+ * This allows sharing the probe with other consumers (see MediaFileInfo::tailProbe()). If not set or not yet probed,
+ * the end of the stream is probed when parsing the header.
+ *
+ * \remarks The \a tailProbe must outlive the stream or be unset before.
+ */
+inline void AdtsStream::setTailProbe(const TailProbe *tailProbe)
+{
+    m_tailProbe = tailProbe;
+}
+
 } // namespace TagParser
 
 #endif // TAG_PARSER_ADTSSTREAM_H
@@ -0,0 +1,77 @@
+#ifndef TAG_PARSER_APPLYCHANGESRESULT_H
+#define TAG_PARSER_APPLYCHANGESRESULT_H
+
+#include "./signature.h"
+
+#include <cstdint>
+
+namespace TagParser {
+
+/*!
+ * \brief The ApplyChangesStrategy enum specifies how MediaFileInfo::applyChanges() has modified the file.
+ */
+enum class ApplyChangesStrategy : std::uint8_t {
+    None, /**< the file has not been modified (e.g. nothing has been changed or applying changes failed) */
+    InPlace, /**< the file has been patched in-place and the padding in front of the media data has been kept as it is */
+    PaddingReuse, /**< the file has been patched in-place and the padding has absorbed the size difference of the changed structures */
+    Rewrite, /**< the file has been rewritten so all unchanged data (e.g. the media data) has been copied */
+    BlockShift, /**< the media data has been shifted by whole file system blocks and the padding has absorbed the remaining size difference */
+};
+
+/*!
+ * \brief The ApplyChangesResult struct describes how MediaFileInfo::applyChanges() has modified the file.
+ *
+ * It is also returned by MediaFileInfo::planChanges() to predict how the file would be modified.
+ *
+ * It allows tuning the padding settings (see MediaFileInfo::setMinPadding(), MediaFileInfo::setMaxPadding() and
+ * MediaFileInfo::setPreferredPadding()) based on the write amplification observed for real files: ideally most files
+ * are patched in-place and only the tags are written.
+ *
+ * \remarks
+ * - The padding is the one the makers of the particular format consider: the "Void"-elements in front of the first
+ *   "Cluster"-element of Matroska files, the "free"-/"skip"-atoms in front of the media data (or after the "moov"-atom
+ *   when only the user data is patched) of MP4 files and the padding of the ID3v2 tag or the FLAC metadata of MP3/FLAC
+ *   files. It is not determined for Ogg and RIFF/WAVE files.
+ * - The byte counts are determined by counting the I/O on the stream (see MediaFileStatistics); they are always zero if
+ *   the library has been built without statistics (CMake option ENABLE_STATISTICS).
+ */
+struct TAG_PARSER_EXPORT ApplyChangesResult {
+    void setLayout(bool rewrite, std::uint64_t paddingBefore, std::uint64_t paddingAfter);
+
+    /// \brief The format of the file the changes have been applied to.
+    ContainerFormat containerFormat = ContainerFormat::Unknown;
+    /// \brief How the file has been modified.
+    ApplyChangesStrategy strategy = ApplyChangesStrategy::None;
+    /// \brief The size of the file before applying changes.
+    std::uint64_t fileSizeBefore = 0;
+    /// \brief The size of the file after applying changes.
+    std::uint64_t fileSizeAfter = 0;
+    /// \brief The padding of the original file (see remarks of the struct).
+    std::uint64_t paddingBefore = 0;
+    /// \brief The padding of the new file (see remarks of the struct).
+    std::uint64_t paddingAfter = 0;
+    /// \brief The number of bytes written except for the unchanged data which has been copied (usually tags, index and padding).
+    std::uint64_t bytesPatched = 0;
+    /// \brief The number of bytes of unchanged data which have been copied (via the kernel, by cloning or in userspace).
+    std::uint64_t bytesCopied = 0;
+    /// \brief Whether a backup file has been created (or would be created, see MediaFileInfo::planChanges()).
+    bool backupCreated = false;
+    /// \brief Whether creating the backup file copied the original file because it could neither be renamed nor be cloned.
+    bool backupCopied = false;
+};
+
+/*!
+ * \brief Sets the strategy and the padding according to the layout the maker has chosen.
+ * \remarks Used by the makers which are supposed to call this after the layout of the new file has been determined.
+ */
+inline void ApplyChangesResult::setLayout(bool rewrite, std::uint64_t paddingBefore, std::uint64_t paddingAfter)
+{
+    strategy = rewrite ? ApplyChangesStrategy::Rewrite
+                       : (paddingBefore == paddingAfter ? ApplyChangesStrategy::InPlace : ApplyChangesStrategy::PaddingReuse);
+    this->paddingBefore = paddingBefore;
+    this->paddingAfter = paddingAfter;
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_APPLYCHANGESRESULT_H
@@ -6,8 +6,6 @@
 
 #include <c++utilities/io/binaryreader.h>
 
-#include <limits>
-
 using namespace std;
 using namespace CppUtilities;
 
@@ -20,9 +18,15 @@ namespace TagParser {
 
 /*!
  * \brief Parses the AVC configuration using the specified \a reader.
+ *
+ * The SPS/PPS NAL units are read into spsNalUnits and ppsNalUnits. If \a decodeParameterSets is true (the default)
+ * they are decoded into spsInfos and ppsInfos right away. Otherwise only the raw NAL units are kept and
+ * decodeParameterSets() needs to be called when the SPS/PPS fields are needed. This avoids the exp-Golomb decoding
+ * of the SPS (including the VUI) when only the profile and level denoted in the configuration itself are of interest.
+ *
  * \throws Throws TruncatedDataException() when the config size exceeds the specified \a maxSize.
  */
-void AvcConfiguration::parse(BinaryReader &reader, std::uint64_t maxSize, Diagnostics &diag)
+void AvcConfiguration::parse(BinaryReader &reader, std::uint64_t maxSize, Diagnostics &diag, bool decodeParameterSets)
 {
     if (maxSize < 7) {
         throw TruncatedDataException();
@@ -35,59 +39,80 @@ void AvcConfiguration::parse(BinaryReader &reader, std::uint64_t maxSize, Diagno
     levelIndication = reader.readByte();
     naluSizeLength = (reader.readByte() & 0x03) + 1;
 
-    // read SPS info entries
+    // read SPS NAL units
     std::uint8_t spsEntryCount = reader.readByte() & 0x0f;
-    std::uint8_t ignoredSpsEntries = 0;
-    spsInfos.reserve(spsEntryCount);
+    spsNalUnits.reserve(spsEntryCount);
     for (; spsEntryCount; --spsEntryCount) {
         if (maxSize < SpsInfo::minSize) {
             throw TruncatedDataException();
         }
-        auto error = false;
-        try {
-            spsInfos.emplace_back().parse(
-                reader, maxSize > numeric_limits<std::uint32_t>::max() ? numeric_limits<std::uint32_t>::max() : static_cast<std::uint32_t>(maxSize));
-        } catch (const TruncatedDataException &) {
-            if (spsInfos.back().size > (maxSize - SpsInfo::minSize)) {
-                throw; // sps info looks bigger than bytes to read
-            }
-            error = true; // sps info exceeds denoted size
-        } catch (const Failure &) {
-            error = true;
-        }
-        maxSize -= spsInfos.back().size;
-        if (error) {
-            spsInfos.pop_back();
-            ++ignoredSpsEntries;
+        const auto size = reader.readUInt16BE();
+        if (size > (maxSize - SpsInfo::minSize)) {
+            throw TruncatedDataException(); // sps info looks bigger than bytes to read
         }
+        reader.read(spsNalUnits.emplace_back(size, '\0').data(), size);
+        maxSize -= size;
     }
 
-    // read PPS info entries
+    // read PPS NAL units
     std::uint8_t ppsEntryCount = reader.readByte();
-    std::uint8_t ignoredPpsEntries = 0;
-    ppsInfos.reserve(ppsEntryCount);
+    ppsNalUnits.reserve(ppsEntryCount);
     for (; ppsEntryCount; --ppsEntryCount) {
         if (maxSize < PpsInfo::minSize) {
             throw TruncatedDataException();
         }
-        auto error = false;
+        const auto size = reader.readUInt16BE();
+        if (size > (maxSize - PpsInfo::minSize)) {
+            throw TruncatedDataException(); // pps info looks bigger than bytes to read
+        }
+        reader.read(ppsNalUnits.emplace_back(size, '\0').data(), size);
+        maxSize -= size;
+    }
+
+    // ignore remaining data
+
+    if (decodeParameterSets) {
+        this->decodeParameterSets(diag);
+    }
+}
+
+/*!
+ * \brief Decodes the SPS/PPS NAL units read via parse() into spsInfos and ppsInfos.
+ * \remarks
+ * - The NAL units are released afterwards so calling this function again is cheap.
+ * - NAL units which can not be decoded are ignored (and logged as debug message).
+ */
+void AvcConfiguration::decodeParameterSets(Diagnostics &diag)
+{
+    if (!hasUndecodedParameterSets()) {
+        return;
+    }
+
+    // decode SPS info entries
+    std::size_t ignoredSpsEntries = 0;
+    spsInfos.reserve(spsInfos.size() + spsNalUnits.size());
+    for (const auto &nalUnit : spsNalUnits) {
         try {
-            ppsInfos.emplace_back().parse(
-                reader, maxSize > numeric_limits<std::uint32_t>::max() ? numeric_limits<std::uint32_t>::max() : static_cast<std::uint32_t>(maxSize));
-        } catch (const TruncatedDataException &) {
-            if (ppsInfos.back().size > (maxSize - PpsInfo::minSize)) {
-                throw; // pps info looks bigger than bytes to read
-            }
-            error = true; // pps info exceeds denoted size
+            spsInfos.emplace_back().parse(nalUnit.data(), static_cast<std::uint16_t>(nalUnit.size()));
         } catch (const Failure &) {
-            error = true;
+            spsInfos.pop_back();
+            ++ignoredSpsEntries;
         }
-        maxSize -= ppsInfos.back().size;
-        if (error) {
+    }
+
+    // decode PPS info entries
+    std::size_t ignoredPpsEntries = 0;
+    ppsInfos.reserve(ppsInfos.size() + ppsNalUnits.size());
+    for (const auto &nalUnit : ppsNalUnits) {
+        try {
+            ppsInfos.emplace_back().parse(nalUnit.data(), static_cast<std::uint16_t>(nalUnit.size()));
+        } catch (const Failure &) {
             ppsInfos.pop_back();
             ++ignoredPpsEntries;
         }
     }
+    spsNalUnits.clear();
+    ppsNalUnits.clear();
 
     // log parsing errors
     if (ignoredSpsEntries || ignoredPpsEntries) {
@@ -96,8 +121,6 @@ void AvcConfiguration::parse(BinaryReader &reader, std::uint64_t maxSize, Diagno
                 "Ignored ", ignoredSpsEntries, " SPS entries and ", ignoredPpsEntries, " PPS entries. This AVC config is likely just not supported."),
             "parsing AVC config");
     }
-
-    // ignore remaining data
 }
 
 } // namespace TagParser
@@ -3,6 +3,7 @@
 
 #include "./avcinfo.h"
 
+#include <string>
 #include <vector>
 
 namespace TagParser {
@@ -18,8 +19,12 @@ struct TAG_PARSER_EXPORT AvcConfiguration {
     std::uint8_t naluSizeLength;
     std::vector<SpsInfo> spsInfos;
     std::vector<PpsInfo> ppsInfos;
+    std::vector<std::string> spsNalUnits;
+    std::vector<std::string> ppsNalUnits;
 
-    void parse(CppUtilities::BinaryReader &reader, std::uint64_t maxSize, Diagnostics &diag);
+    void parse(CppUtilities::BinaryReader &reader, std::uint64_t maxSize, Diagnostics &diag, bool decodeParameterSets = true);
+    void decodeParameterSets(Diagnostics &diag);
+    bool hasUndecodedParameterSets() const;
 };
 
 /*!
@@ -33,6 +38,15 @@ inline AvcConfiguration::AvcConfiguration()
 {
 }
 
+/*!
+ * \brief Returns whether there are SPS/PPS NAL units which have not been decoded yet.
+ * \sa decodeParameterSets()
+ */
+inline bool AvcConfiguration::hasUndecodedParameterSets() const
+{
+    return !spsNalUnits.empty() || !ppsNalUnits.empty();
+}
+
 } // namespace TagParser
 
 #endif // TAG_PARSER_AVCCONFIGURATION_H
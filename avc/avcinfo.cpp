@@ -31,7 +31,16 @@ void SpsInfo::parse(BinaryReader &reader, std::uint32_t maxSize)
     // buffer data for reading with BitReader
     auto buffer = make_unique<char[]>(size);
     reader.read(buffer.get(), size);
-    BitReader bitReader(buffer.get(), size);
+    parse(buffer.get(), size);
+}
+
+/*!
+ * \brief Parses the SPS info from the NAL unit with the specified \a dataSize at \a data (not including the size).
+ */
+void SpsInfo::parse(const char *data, std::uint16_t dataSize)
+{
+    size = dataSize;
+    BitReader bitReader(data, size);
 
     try {
         // read general values
@@ -228,7 +237,16 @@ void PpsInfo::parse(BinaryReader &reader, std::uint32_t maxSize)
     // buffer data for reading with BitReader
     auto buffer = make_unique<char[]>(size);
     reader.read(buffer.get(), size);
-    BitReader bitReader(buffer.get(), size);
+    parse(buffer.get(), size);
+}
+
+/*!
+ * \brief Parses the PPS info from the NAL unit with the specified \a dataSize at \a data (not including the size).
+ */
+void PpsInfo::parse(const char *data, std::uint16_t dataSize)
+{
+    size = dataSize;
+    BitReader bitReader(data, size);
 
     try {
         // read general values
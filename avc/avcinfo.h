@@ -96,6 +96,7 @@ struct TAG_PARSER_EXPORT SpsInfo {
     static constexpr std::uint16_t minSize = 2;
 
     void parse(CppUtilities::BinaryReader &reader, std::uint32_t maxSize);
+    void parse(const char *data, std::uint16_t dataSize);
 };
 
 constexpr SpsInfo::SpsInfo()
@@ -128,6 +129,7 @@ struct TAG_PARSER_EXPORT PpsInfo {
     static constexpr std::uint16_t minSize = 2;
 
     void parse(CppUtilities::BinaryReader &reader, std::uint32_t maxSize);
+    void parse(const char *data, std::uint16_t dataSize);
 };
 
 constexpr PpsInfo::PpsInfo()
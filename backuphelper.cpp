@@ -1,16 +1,25 @@
 #include "./backuphelper.h"
 #include "./diagnostics.h"
+#include "./filerangecopier.h"
 #include "./mediafileinfo.h"
+#include "./tracepoints.h"
 
 #include <c++utilities/conversion/stringbuilder.h>
 #include <c++utilities/conversion/stringconversion.h>
+#include <c++utilities/io/binaryreader.h>
+#include <c++utilities/io/binarywriter.h>
+#include <c++utilities/io/copy.h>
 
 #ifdef PLATFORM_WINDOWS
 #include <windows.h>
 #else
+#include <fcntl.h>
 #include <sys/stat.h>
 #endif
+#include <unistd.h>
 
+#include <algorithm>
+#include <cerrno>
 #include <cstdio>
 #include <fstream>
 #include <stdexcept>
@@ -31,6 +40,118 @@ namespace TagParser {
 
 namespace BackupHelper {
 
+/// \brief The magic number of journal files ("TPJR").
+constexpr std::uint32_t journalMagic = 0x54504A52;
+/// \brief The version of the journal file format.
+constexpr std::uint8_t journalVersion = 1;
+
+/*!
+ * \brief Copies the whole file opened via \a source to \a target (preferably within the kernel, see FileRangeCopier).
+ */
+static void copyFileContents(NativeFileStream &source, const std::string &sourcePath, NativeFileStream &target, const std::string &targetPath)
+{
+    source.seekg(0, ios_base::end);
+    const auto size = static_cast<std::uint64_t>(source.tellg());
+    source.seekg(0);
+    FileRangeCopier copier;
+    copier.open(source, sourcePath, target, targetPath);
+    copier.copy(source, target, size);
+    target.flush();
+}
+
+/*!
+ * \brief Syncs the file at \a path to the disk.
+ * \returns Returns whether the file could be synced.
+ */
+static bool syncFile(const std::string &path)
+{
+#ifdef PLATFORM_UNIX
+    const auto fileDescriptor = ::open(BasicFileInfo::pathForOpen(path), O_WRONLY);
+    if (fileDescriptor < 0) {
+        return false;
+    }
+#ifdef PLATFORM_LINUX
+    const auto res = ::fdatasync(fileDescriptor);
+#else
+    const auto res = ::fsync(fileDescriptor);
+#endif
+    ::close(fileDescriptor);
+    return res == 0;
+#else
+    CPP_UTILITIES_UNUSED(path);
+    return true;
+#endif
+}
+
+/*!
+ * \brief Syncs the directory containing the file at \a path to the disk so renaming/creating the file is durable.
+ * \returns Returns whether the directory could be synced. Always returns true on platforms where this is not required.
+ */
+bool syncDirectory(const std::string &path)
+{
+#ifdef PLATFORM_UNIX
+    auto directory = BasicFileInfo::containingDirectory(path);
+    if (directory.empty()) {
+        directory = ".";
+    }
+    const auto fileDescriptor = ::open(BasicFileInfo::pathForOpen(directory), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fileDescriptor < 0) {
+        return false;
+    }
+    const auto res = ::fsync(fileDescriptor);
+    ::close(fileDescriptor);
+    return res == 0;
+#else
+    CPP_UTILITIES_UNUSED(path);
+    return true;
+#endif
+}
+
+/*!
+ * \brief Renames the file at \a sourcePath to \a targetPath replacing the file at \a targetPath atomically if it exists.
+ * \returns Returns whether the file could be renamed.
+ * \remarks Under Windows std::rename() fails if the target exists. So the file is renamed via SetFileInformationByHandle()
+ *          using FileRenameInfoEx with POSIX semantics (which works even if the target is still opened by others) and via
+ *          MoveFileExW() on older versions of Windows.
+ */
+static bool replaceFile(const std::string &sourcePath, const std::string &targetPath)
+{
+#ifdef PLATFORM_WINDOWS
+    auto ec = std::error_code();
+    const auto wideSourcePath = convertMultiByteToWide(ec, BasicFileInfo::pathForOpen(sourcePath));
+    if (ec) {
+        return false;
+    }
+    const auto wideTargetPath = convertMultiByteToWide(ec, BasicFileInfo::pathForOpen(targetPath));
+    if (ec) {
+        return false;
+    }
+#ifdef FILE_RENAME_FLAG_POSIX_SEMANTICS
+    // the target needs to be specified as full path
+    const auto handle = ::CreateFileW(wideSourcePath.get(), DELETE | SYNCHRONIZE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle != INVALID_HANDLE_VALUE) {
+        const auto fullPathSize = ::GetFullPathNameW(wideTargetPath.get(), 0, nullptr, nullptr);
+        auto buffer = vector<char>(sizeof(FILE_RENAME_INFO) + fullPathSize * sizeof(wchar_t));
+        auto *const info = reinterpret_cast<FILE_RENAME_INFO *>(buffer.data());
+        info->Flags = FILE_RENAME_FLAG_REPLACE_IF_EXISTS | FILE_RENAME_FLAG_POSIX_SEMANTICS;
+        info->RootDirectory = nullptr;
+        const auto fullPathLength = fullPathSize ? ::GetFullPathNameW(wideTargetPath.get(), fullPathSize, info->FileName, nullptr) : 0;
+        info->FileNameLength = static_cast<DWORD>(fullPathLength * sizeof(wchar_t));
+        const auto renamed = fullPathLength && fullPathLength < fullPathSize
+            && ::SetFileInformationByHandle(handle, FileRenameInfoEx, info, static_cast<DWORD>(buffer.size()));
+        ::CloseHandle(handle);
+        if (renamed) {
+            return true;
+        }
+    }
+#endif
+    return ::MoveFileExW(wideSourcePath.get(), wideTargetPath.get(), MOVEFILE_REPLACE_EXISTING);
+#else
+    return std::rename(BasicFileInfo::pathForOpen(sourcePath), BasicFileInfo::pathForOpen(targetPath)) == 0;
+#endif
+}
+
 /*!
  * \brief Restores the original file from the specified backup file.
  * \param originalPath Specifies the path to the original file.
@@ -43,8 +164,11 @@ namespace BackupHelper {
  * or an IO error occurs. The specified streams will be closed if
  * currently open.
  *
+ * The backup file replaces the (partially rewritten) original file atomically, so there is no point in time when no
+ * file exists at \a originalPath.
+ *
  * If moving isn't possible (eg. \a originalPath and \a backupPath refer to different partitions) the backup
- * file will be restored by copying.
+ * file will be restored by copying. The data is copied within the kernel if possible (see FileRangeCopier).
  *
  * \throws Throws std::ios_base::failure on failure.
  * \todo Implement callback for progress updates (copy).
@@ -52,6 +176,7 @@ namespace BackupHelper {
 void restoreOriginalFileFromBackupFile(
     const std::string &originalPath, const std::string &backupPath, NativeFileStream &originalStream, NativeFileStream &backupStream)
 {
+    TAG_PARSER_TRACEPOINT_SCOPE(restore_backup_file, originalPath.data(), backupPath.data());
     // ensure the orignal stream is closed
     if (originalStream.is_open()) {
         originalStream.close();
@@ -66,9 +191,8 @@ void restoreOriginalFileFromBackupFile(
     } else {
         throw std::ios_base::failure("Backup/temporary file has not been created.");
     }
-    // remove original file and restore backup
-    std::remove(originalPath.c_str());
-    if (std::rename(BasicFileInfo::pathForOpen(backupPath), BasicFileInfo::pathForOpen(originalPath)) == 0) {
+    // replace the original file with the backup
+    if (replaceFile(backupPath, originalPath)) {
         return;
     }
     // can't rename/move the file (maybe backup dir on another partition) -> make a copy instead
@@ -78,8 +202,7 @@ void restoreOriginalFileFromBackupFile(
         originalStream.exceptions(ios_base::failbit | ios_base::badbit);
         backupStream.open(backupPath, ios_base::in | ios_base::binary);
         originalStream.open(originalPath, ios_base::out | ios_base::binary);
-        originalStream << backupStream.rdbuf();
-        originalStream.flush();
+        copyFileContents(backupStream, backupPath, originalStream, originalPath);
         // TODO: callback for progress updates
     } catch (const std::ios_base::failure &failure) {
         throw std::ios_base::failure("Unable to restore original file from backup file \"" % backupPath % "\" after failure: " + failure.what());
@@ -95,32 +218,9 @@ static bool isRelative(const std::string &path)
 }
 
 /*!
- * \brief Creates a backup file for the specified file.
- * \param backupDir Specifies the directory to store backup files. If empty, the directory of the file
- *                  to be backuped is used.
- * \param originalPath Specifies the path of the file to be backuped.
- * \param backupPath Contains the path of the created backup file when this function returns.
- * \param originalStream Specifies a std::fstream for the original file.
- * \param backupStream Specifies a std::fstream for creating the backup file.
- *
- * This helper function is used by MediaFileInfo and container implementations to create a backup file
- * when applying changes. The specified \a backupPath is set to the path of the created backup file.
- * The specified \a backupStream will be closed if currently open. Then it is
- * used to open the backup file using the flags ios_base::in and ios_base::binary.
- *
- * The specified \a originalStream is closed before performing the move operation.
- *
- * If moving isn't possible (eg. \a originalPath and \a backupPath refer to different partitions) the backup
- * file will be created by copying.
- *
- * The original file can now be rewritten to apply changes. When this operation fails
- * the created backup file can be restored using restoreOriginalFileFromBackupFile().
- *
- * \throws Throws std::ios_base::failure on failure.
- * \todo Implement callback for progress updates (copy).
+ * \brief Determines an unused path for a backup file of \a originalPath within \a backupDir ending with \a suffix.
  */
-void createBackupFile(const std::string &backupDir, const std::string &originalPath, std::string &backupPath, NativeFileStream &originalStream,
-    NativeFileStream &backupStream)
+static void determineBackupPath(const std::string &backupDir, const std::string &originalPath, std::string &backupPath, const char *suffix)
 {
     // determine dirs
     const auto backupDirRelative(isRelative(backupDir));
@@ -151,6 +251,7 @@ void createBackupFile(const std::string &backupDir, const std::string &originalP
                 }
             }
         }
+        backupPath += suffix;
 
         // test whether the backup path is still unused; otherwise continue loop
 #ifdef PLATFORM_WINDOWS
@@ -162,15 +263,60 @@ void createBackupFile(const std::string &backupDir, const std::string &originalP
             break;
         }
     }
+}
+
+/*!
+ * \brief Creates a backup file for the specified file.
+ * \param backupDir Specifies the directory to store backup files. If empty, the directory of the file
+ *                  to be backuped is used.
+ * \param originalPath Specifies the path of the file to be backuped.
+ * \param backupPath Contains the path of the created backup file when this function returns.
+ * \param originalStream Specifies a std::fstream for the original file.
+ * \param backupStream Specifies a std::fstream for creating the backup file.
+ * \param strategy Specifies whether the original file is renamed or cloned (BackupStrategy::Journal and
+ *                 BackupStrategy::TemporaryFile are treated like BackupStrategy::Rename).
+ * \param durabilityPolicy Specifies whether renaming the original file is synced to the disk. This is only the case
+ *                         for DurabilityPolicy::FullSync so the backup file is found after a power loss.
+ *
+ * This helper function is used by MediaFileInfo and container implementations to create a backup file
+ * when applying changes. The specified \a backupPath is set to the path of the created backup file.
+ * The specified \a backupStream will be closed if currently open. Then it is
+ * used to open the backup file using the flags ios_base::in and ios_base::binary.
+ *
+ * The specified \a originalStream is closed before performing the move operation.
+ *
+ * If moving isn't possible (eg. \a originalPath and \a backupPath refer to different partitions) the backup
+ * file will be created by copying. The data is copied within the kernel if possible (see FileRangeCopier).
+ *
+ * If \a strategy is BackupStrategy::Clone, the backup file is created as clone (reflink) of the original file so the
+ * original file (and its inode) is kept without copying any data. This requires a file system supporting reflinks
+ * (e.g. Btrfs, XFS, APFS or ReFS) and that the backup directory is on the same file system. Otherwise the file is renamed.
+ *
+ * The original file can now be rewritten to apply changes. When this operation fails
+ * the created backup file can be restored using restoreOriginalFileFromBackupFile().
+ *
+ * \returns Returns whether the original file has been copied because it could neither be renamed nor be cloned.
+ * \throws Throws std::ios_base::failure on failure.
+ * \todo Implement callback for progress updates (copy).
+ */
+bool createBackupFile(const std::string &backupDir, const std::string &originalPath, std::string &backupPath, NativeFileStream &originalStream,
+    NativeFileStream &backupStream, BackupStrategy strategy, DurabilityPolicy durabilityPolicy)
+{
+    determineBackupPath(backupDir, originalPath, backupPath, "");
+    TAG_PARSER_TRACEPOINT_SCOPE(create_backup_file, originalPath.data(), backupPath.data());
 
     // ensure original file is closed
     if (originalStream.is_open()) {
         originalStream.close();
     }
 
-    // rename original file
-    if (std::rename(BasicFileInfo::pathForOpen(originalPath), BasicFileInfo::pathForOpen(backupPath))) {
+    // clone or rename original file
+    auto renamed = false, copied = false;
+    if (strategy == BackupStrategy::Clone && FileRangeCopier::cloneFile(originalPath, backupPath)) {
+        // keep the original file so it is overwritten in-place when rewriting it
+    } else if (!(renamed = std::rename(BasicFileInfo::pathForOpen(originalPath), BasicFileInfo::pathForOpen(backupPath)) == 0)) {
         // can't rename/move the file (maybe backup dir on another partition) -> make a copy instead
+        copied = true;
         try {
             backupStream.exceptions(ios_base::failbit | ios_base::badbit);
             originalStream.exceptions(ios_base::failbit | ios_base::badbit);
@@ -182,8 +328,7 @@ void createBackupFile(const std::string &backupDir, const std::string &originalP
             // ensure originalStream is opened with read permissions
             originalStream.open(BasicFileInfo::pathForOpen(originalPath), ios_base::in | ios_base::binary);
             // do the actual copying
-            backupStream << originalStream.rdbuf();
-            backupStream.flush();
+            copyFileContents(originalStream, originalPath, backupStream, backupPath);
             // streams are closed in the next try-block
             // TODO: callback for progress updates
         } catch (const std::ios_base::failure &failure) {
@@ -191,6 +336,26 @@ void createBackupFile(const std::string &backupDir, const std::string &originalP
         }
     }
 
+    // ensure the backup file is found when the system crashes while rewriting
+    if (durabilityPolicy == DurabilityPolicy::FullSync) {
+        if (originalStream.is_open()) {
+            originalStream.close();
+        }
+        if (backupStream.is_open()) {
+            backupStream.close();
+        }
+        if ((!renamed && !syncFile(backupPath)) || !syncDirectory(backupPath)
+            || (BasicFileInfo::containingDirectory(backupPath) != BasicFileInfo::containingDirectory(originalPath)
+                && !syncDirectory(originalPath))) {
+            if (renamed) {
+                std::rename(BasicFileInfo::pathForOpen(backupPath), BasicFileInfo::pathForOpen(originalPath));
+            } else {
+                std::remove(BasicFileInfo::pathForOpen(backupPath));
+            }
+            throw std::ios_base::failure("Unable to sync the backup file to the disk.");
+        }
+    }
+
     // manage streams
     try {
         // ensure there is no file associated with the originalStream object
@@ -213,6 +378,319 @@ void createBackupFile(const std::string &backupDir, const std::string &originalP
             throw std::ios_base::failure(argsToString("Unable to open backup file: ", failure.what()));
         }
     }
+    return copied;
+}
+
+/*!
+ * \class TagParser::BackupHelper::TemporaryFile
+ * \brief The TemporaryFile class replaces the original file atomically by an anonymous file written in the same directory.
+ *
+ * This is used when rewriting a file with BackupStrategy::TemporaryFile. Under Linux the new file is created via
+ * O_TMPFILE so it has no name until it replaces the original file. The original file is not touched while the new file
+ * is written, so it can be read directly (and unchanged ranges can be reflinked, see FileRangeCopier). If writing the
+ * new file fails or the process crashes, the anonymous file is just freed by the kernel so no backup file needs to be
+ * restored or cleaned up.
+ *
+ * The new file is linked into the file system via linkat() and renamed over the original file when replaceOriginalFile()
+ * is called. That is only a single rename compared to renaming the original file to a backup file, creating the new file
+ * and removing the backup file afterwards.
+ *
+ * \remarks As with BackupStrategy::Rename, the rewritten file is a new inode (so hard links of the original file are not
+ *          updated) and only the permissions (but not ownership) of the original file are taken over if the process
+ *          lacks the privileges to do so.
+ */
+
+/*!
+ * \brief Constructs a new object; no file is created until create() has been called.
+ */
+TemporaryFile::TemporaryFile()
+    : m_fileDescriptor(-1)
+{
+}
+
+/*!
+ * \brief Destroys the object discarding the temporary file if it has not replaced the original file.
+ */
+TemporaryFile::~TemporaryFile()
+{
+    discard();
+}
+
+/*!
+ * \brief Creates an anonymous temporary file in the directory containing the file at \a originalPath.
+ * \returns Returns whether the file could be created. This is only possible under Linux and on file systems
+ *          supporting O_TMPFILE (e.g. ext4, Btrfs, XFS and tmpfs); callers are supposed to fall back to creating a
+ *          backup file otherwise.
+ * \remarks The file gets the permissions of the original file. It can be opened via path().
+ */
+bool TemporaryFile::create(const std::string &originalPath)
+{
+    discard();
+#if defined(PLATFORM_LINUX) && defined(O_TMPFILE)
+    struct stat originalStat;
+    if (::stat(BasicFileInfo::pathForOpen(originalPath), &originalStat)) {
+        return false;
+    }
+    auto directory = BasicFileInfo::containingDirectory(originalPath);
+    if (directory.empty()) {
+        directory = ".";
+    }
+    const auto permissions = static_cast<mode_t>(originalStat.st_mode & 07777);
+    m_fileDescriptor = ::open(BasicFileInfo::pathForOpen(directory), O_TMPFILE | O_RDWR | O_CLOEXEC, permissions);
+    if (m_fileDescriptor < 0) {
+        return false;
+    }
+    // take over the ownership if possible and apply the permissions regardless of the umask
+    const auto res = ::fchown(m_fileDescriptor, originalStat.st_uid, originalStat.st_gid);
+    CPP_UTILITIES_UNUSED(res)
+    ::fchmod(m_fileDescriptor, permissions);
+    m_path = argsToString("/proc/self/fd/", m_fileDescriptor);
+    return true;
+#else
+    CPP_UTILITIES_UNUSED(originalPath);
+    return false;
+#endif
+}
+
+/*!
+ * \brief Replaces the file at \a originalPath atomically with the temporary file.
+ *
+ * The temporary file is synced to the disk first (unless \a durabilityPolicy is DurabilityPolicy::None) so the
+ * original file is never replaced by a file which has not reached the disk completely. Then the file is linked as
+ * "<originalPath>.tmp" and renamed over the original file. For DurabilityPolicy::FullSync the directory is synced as
+ * well so the replacement itself is durable.
+ *
+ * \returns Returns false if the directory could not be synced; the original file has been replaced anyways.
+ * \remarks Streams opened via path() remain valid and refer to the file at \a originalPath afterwards.
+ * \throws Throws std::ios_base::failure on failure. The original file is kept in this case.
+ */
+bool TemporaryFile::replaceOriginalFile(const std::string &originalPath, DurabilityPolicy durabilityPolicy)
+{
+    if (!isCreated()) {
+        throw std::ios_base::failure("The temporary file has not been created.");
+    }
+#ifdef PLATFORM_LINUX
+    if (durabilityPolicy != DurabilityPolicy::None
+        && (durabilityPolicy == DurabilityPolicy::FullSync ? ::fsync(m_fileDescriptor) : ::fdatasync(m_fileDescriptor))) {
+        throw std::ios_base::failure("Unable to sync the temporary file to the disk.");
+    }
+    // link the file under an unused name next to the original file as linkat() can not replace existing files
+    string linkPath;
+    for (unsigned int i = 0;; ++i) {
+        linkPath = i ? argsToString(originalPath, '.', i, ".tmp") : originalPath + ".tmp";
+        if (!::linkat(AT_FDCWD, m_path.data(), AT_FDCWD, BasicFileInfo::pathForOpen(linkPath), AT_SYMLINK_FOLLOW)) {
+            break;
+        }
+        if (errno != EEXIST) {
+            throw std::ios_base::failure(argsToString("Unable to link the temporary file to \"", linkPath, "\"."));
+        }
+    }
+    if (std::rename(BasicFileInfo::pathForOpen(linkPath), BasicFileInfo::pathForOpen(originalPath))) {
+        std::remove(BasicFileInfo::pathForOpen(linkPath));
+        throw std::ios_base::failure("Unable to replace the original file with the temporary file.");
+    }
+    discard();
+    return durabilityPolicy != DurabilityPolicy::FullSync || syncDirectory(originalPath);
+#else
+    CPP_UTILITIES_UNUSED(originalPath);
+    CPP_UTILITIES_UNUSED(durabilityPolicy);
+    return true;
+#endif
+}
+
+/*!
+ * \brief Closes the temporary file; if it has not replaced the original file yet, it is freed by the kernel.
+ * \remarks Streams opened via path() must be closed as well to free the file.
+ */
+void TemporaryFile::discard()
+{
+#ifdef PLATFORM_UNIX
+    if (m_fileDescriptor >= 0) {
+        ::close(m_fileDescriptor);
+    }
+#endif
+    m_fileDescriptor = -1;
+    m_path.clear();
+}
+
+/*!
+ * \brief Creates a backup file for the specified file as clone before the file is modified in-place.
+ * \param backupDir Specifies the directory to store the backup file (see createBackupFile()).
+ * \param originalPath Specifies the path of the file to be modified in-place.
+ * \param backupPath Contains the path of the created backup file when this function returns; it is cleared if no backup
+ *                   file has been created.
+ * \param durabilityPolicy Specifies whether creating the backup file is synced to the disk. This is only the case for
+ *                         DurabilityPolicy::FullSync so the backup file is found after a power loss.
+ *
+ * This helper function is used by MediaFileInfo and container implementations when changes are applied in-place with
+ * BackupStrategy::Clone ("clone-then-patch"). Cloning takes constant time and no space for the unchanged data, so the
+ * whole file can be protected without copying it. If applying the changes fails, the original file is restored via
+ * restoreOriginalFileFromBackupFile() as after a failed rewrite.
+ *
+ * \returns Returns whether the backup file has been created. That requires a file system supporting clones in the
+ *          first place (see FileRangeCopier::cloneFile()); otherwise the file is modified without backup as usual.
+ */
+bool createCloneBackupFile(const std::string &backupDir, const std::string &originalPath, std::string &backupPath, DurabilityPolicy durabilityPolicy)
+{
+    determineBackupPath(backupDir, originalPath, backupPath, "");
+    TAG_PARSER_TRACEPOINT_SCOPE(create_backup_file, originalPath.data(), backupPath.data());
+    if (!FileRangeCopier::cloneFile(originalPath, backupPath)) {
+        backupPath.clear();
+        return false;
+    }
+    if (durabilityPolicy == DurabilityPolicy::FullSync && !syncDirectory(backupPath)) {
+        std::remove(BasicFileInfo::pathForOpen(backupPath));
+        backupPath.clear();
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief Creates a journal file holding the bytes of the specified file which are about to be overwritten.
+ * \param backupDir Specifies the directory to store the journal file (see createBackupFile()).
+ * \param originalPath Specifies the path of the file to be modified in-place.
+ * \param journalPath Contains the path of the created journal file when this function returns.
+ * \param originalStream Specifies a stream to read the file to be modified.
+ * \param originalSize Specifies the size of the file to be modified.
+ * \param untouchedRanges Specifies the ranges (start and end offset) which are not going to be modified (usually the
+ *                        media data). Everything else is saved to the journal.
+ *
+ * This helper function is used by MediaFileInfo and container implementations to protect changes which are
+ * applied in-place when BackupStrategy::Journal is used. Unlike a backup file, the journal only holds the
+ * parts of the file which are overwritten (usually only the tags and the index). The journal is synced to the
+ * disk before this function returns so the original file can be restored using restoreOriginalFileFromJournal()
+ * even after a crash.
+ *
+ * \throws Throws std::ios_base::failure on failure.
+ */
+void createJournal(const std::string &backupDir, const std::string &originalPath, std::string &journalPath, std::istream &originalStream,
+    std::uint64_t originalSize, const std::vector<std::pair<std::uint64_t, std::uint64_t>> &untouchedRanges)
+{
+    determineBackupPath(backupDir, originalPath, journalPath, ".journal");
+
+    // determine the ranges to be saved
+    auto sortedRanges(untouchedRanges);
+    sort(sortedRanges.begin(), sortedRanges.end());
+    vector<pair<std::uint64_t, std::uint64_t>> savedRanges;
+    std::uint64_t currentOffset = 0;
+    for (const auto &range : sortedRanges) {
+        const auto start = min(range.first, originalSize), end = min(range.second, originalSize);
+        if (start > currentOffset) {
+            savedRanges.emplace_back(currentOffset, start - currentOffset);
+        }
+        currentOffset = max(currentOffset, end);
+    }
+    if (currentOffset < originalSize) {
+        savedRanges.emplace_back(currentOffset, originalSize - currentOffset);
+    }
+
+    // write the journal
+    try {
+        NativeFileStream journalStream;
+        journalStream.exceptions(ios_base::failbit | ios_base::badbit);
+        journalStream.open(BasicFileInfo::pathForOpen(journalPath), ios_base::out | ios_base::binary | ios_base::trunc);
+        BinaryWriter writer(&journalStream);
+        writer.writeUInt32BE(journalMagic);
+        writer.writeByte(journalVersion);
+        writer.writeUInt64BE(originalSize);
+        writer.writeUInt64BE(savedRanges.size());
+        CopyHelper<0x10000> copyHelper;
+        for (const auto &range : savedRanges) {
+            writer.writeUInt64BE(range.first);
+            writer.writeUInt64BE(range.second);
+            originalStream.seekg(static_cast<streamoff>(range.first));
+            copyHelper.copy(originalStream, journalStream, range.second);
+        }
+        journalStream.flush();
+        journalStream.close();
+    } catch (const std::ios_base::failure &failure) {
+        std::remove(BasicFileInfo::pathForOpen(journalPath));
+        throw std::ios_base::failure(argsToString("Unable to create journal file: ", failure.what()));
+    }
+    if (!syncFile(journalPath)) {
+        std::remove(BasicFileInfo::pathForOpen(journalPath));
+        throw std::ios_base::failure("Unable to sync journal file to the disk.");
+    }
+}
+
+/*!
+ * \brief Restores the original file from the specified journal file.
+ * \param originalPath Specifies the path to the original file.
+ * \param journalPath Specifies the path to the journal file created via createJournal().
+ * \param originalStream Specifies a std::fstream instance for the original file. It will be closed if currently open.
+ *
+ * The bytes saved within the journal are written back and the file is truncated to its original size. The journal
+ * file is removed afterwards.
+ *
+ * \throws Throws std::ios_base::failure on failure.
+ */
+void restoreOriginalFileFromJournal(const std::string &originalPath, const std::string &journalPath, NativeFileStream &originalStream)
+{
+    // ensure the orignal stream is closed
+    if (originalStream.is_open()) {
+        originalStream.close();
+    }
+    std::uint64_t originalSize;
+    try {
+        NativeFileStream journalStream;
+        journalStream.exceptions(ios_base::failbit | ios_base::badbit);
+        journalStream.open(BasicFileInfo::pathForOpen(journalPath), ios_base::in | ios_base::binary);
+        BinaryReader reader(&journalStream);
+        if (reader.readUInt32BE() != journalMagic || reader.readByte() != journalVersion) {
+            throw std::ios_base::failure("journal file has an unknown format");
+        }
+        originalSize = reader.readUInt64BE();
+        const auto rangeCount = reader.readUInt64BE();
+        originalStream.exceptions(ios_base::failbit | ios_base::badbit);
+        originalStream.open(BasicFileInfo::pathForOpen(originalPath), ios_base::in | ios_base::out | ios_base::binary);
+        CopyHelper<0x10000> copyHelper;
+        for (std::uint64_t i = 0; i != rangeCount; ++i) {
+            const auto offset = reader.readUInt64BE();
+            const auto size = reader.readUInt64BE();
+            originalStream.seekp(static_cast<streamoff>(offset));
+            copyHelper.copy(journalStream, originalStream, size);
+        }
+        originalStream.flush();
+        originalStream.close();
+    } catch (const std::ios_base::failure &failure) {
+        throw std::ios_base::failure("Unable to restore original file from journal file \"" % journalPath % "\" after failure: " + failure.what());
+    }
+    if (truncate(BasicFileInfo::pathForOpen(originalPath), static_cast<streamoff>(originalSize)) != 0) {
+        throw std::ios_base::failure("Unable to truncate original file to its original size when restoring it from journal file \"" + journalPath
+            + "\".");
+    }
+    std::remove(BasicFileInfo::pathForOpen(journalPath));
+}
+
+/*!
+ * \brief Shifts the data of the file at \a path back after it has been shifted via FileRangeCopier::shiftData().
+ * \param path Specifies the path of the file modified in-place.
+ * \param dataOffset Specifies the offset the data has been shifted to.
+ * \param originalDataOffset Specifies the offset of the data before it has been shifted.
+ * \param outputStream Specifies the stream used to modify the file. It will be closed if currently open.
+ * \param diag Specifies the container to add diagnostic messages to.
+ * \param context Specifies the context used to add notifications.
+ *
+ * The same range of blocks is collapsed or inserted again so the data ends up at \a originalDataOffset. The bytes in
+ * front of the data are not restored; this is supposed to be done via restoreOriginalFileFromJournal() afterwards using
+ * a journal created via createJournal() before shifting.
+ *
+ * \returns Returns whether the data could be shifted back. Restoring the journal must not be attempted otherwise as the
+ *          data is not at its original offset.
+ */
+bool undoDataShift(const std::string &path, std::uint64_t dataOffset, std::uint64_t originalDataOffset, NativeFileStream &outputStream,
+    Diagnostics &diag, const std::string &context)
+{
+    if (outputStream.is_open()) {
+        outputStream.close();
+    }
+    if (FileRangeCopier::shiftData(path, dataOffset, originalDataOffset) != originalDataOffset) {
+        diag.emplace_back(DiagLevel::Critical,
+            argsToString("Unable to shift the data from offset ", dataOffset, " back to its original offset ", originalDataOffset, '.'), context);
+        return false;
+    }
+    return true;
 }
 
 /*!
@@ -236,12 +714,38 @@ void createBackupFile(const std::string &backupDir, const std::string &originalP
  */
 void handleFailureAfterFileModified(MediaFileInfo &fileInfo, const std::string &backupPath, NativeFileStream &outputStream,
     NativeFileStream &backupStream, Diagnostics &diag, const std::string &context)
+{
+    handleFailureAfterFileModified(fileInfo, backupPath, string(), outputStream, backupStream, diag, context);
+}
+
+/*!
+ * \brief Handles a failure/abort which occurred after the file has been modified.
+ *
+ * Same as the overload above but additionally restores the original file using restoreOriginalFileFromJournal()
+ * if \a journalPath is not empty (a journal has been created via createJournal() before modifying the file in-place).
+ */
+void handleFailureAfterFileModified(MediaFileInfo &fileInfo, const std::string &backupPath, const std::string &journalPath,
+    NativeFileStream &outputStream, NativeFileStream &backupStream, Diagnostics &diag, const std::string &context)
 {
     // reset the associated container in any case
     if (fileInfo.container()) {
         fileInfo.container()->reset();
     }
 
+    // restores the original file from the backup or journal file if one has been created
+    const auto restoreOriginalFile = [&] {
+        try {
+            if (!backupPath.empty()) {
+                restoreOriginalFileFromBackupFile(fileInfo.path(), backupPath, outputStream, backupStream);
+            } else {
+                restoreOriginalFileFromJournal(fileInfo.path(), journalPath, outputStream);
+            }
+            diag.emplace_back(DiagLevel::Information, "The original file has been restored.", context);
+        } catch (const std::ios_base::failure &failure) {
+            diag.emplace_back(DiagLevel::Critical, failure.what(), context);
+        }
+    };
+
     // re-throw the current exception
     try {
         throw;
@@ -249,14 +753,12 @@ void handleFailureAfterFileModified(MediaFileInfo &fileInfo, const std::string &
         if (!backupPath.empty()) {
             // a temp/backup file has been created -> restore original file
             diag.emplace_back(DiagLevel::Information, "Rewriting the file to apply changed tag information has been aborted.", context);
-            try {
-                restoreOriginalFileFromBackupFile(fileInfo.path(), backupPath, outputStream, backupStream);
-                diag.emplace_back(DiagLevel::Information, "The original file has been restored.", context);
-            } catch (const std::ios_base::failure &failure) {
-                diag.emplace_back(DiagLevel::Critical, failure.what(), context);
-            }
+            restoreOriginalFile();
         } else {
             diag.emplace_back(DiagLevel::Information, "Applying new tag information has been aborted.", context);
+            if (!journalPath.empty()) {
+                restoreOriginalFile();
+            }
         }
         throw;
 
@@ -264,14 +766,12 @@ void handleFailureAfterFileModified(MediaFileInfo &fileInfo, const std::string &
         if (!backupPath.empty()) {
             // a temp/backup file has been created -> restore original file
             diag.emplace_back(DiagLevel::Critical, "Rewriting the file to apply changed tag information failed.", context);
-            try {
-                restoreOriginalFileFromBackupFile(fileInfo.path(), backupPath, outputStream, backupStream);
-                diag.emplace_back(DiagLevel::Information, "The original file has been restored.", context);
-            } catch (const std::ios_base::failure &failure) {
-                diag.emplace_back(DiagLevel::Critical, failure.what(), context);
-            }
+            restoreOriginalFile();
         } else {
             diag.emplace_back(DiagLevel::Critical, "Applying new tag information failed.", context);
+            if (!journalPath.empty()) {
+                restoreOriginalFile();
+            }
         }
         throw;
 
@@ -279,14 +779,12 @@ void handleFailureAfterFileModified(MediaFileInfo &fileInfo, const std::string &
         if (!backupPath.empty()) {
             // a temp/backup file has been created -> restore original file
             diag.emplace_back(DiagLevel::Critical, "An IO error occurred when rewriting the file to apply changed tag information.", context);
-            try {
-                restoreOriginalFileFromBackupFile(fileInfo.path(), backupPath, outputStream, backupStream);
-                diag.emplace_back(DiagLevel::Information, "The original file has been restored.", context);
-            } catch (const std::ios_base::failure &failure) {
-                diag.emplace_back(DiagLevel::Critical, failure.what(), context);
-            }
+            restoreOriginalFile();
         } else {
             diag.emplace_back(DiagLevel::Critical, "An IO error occurred when applying tag information.", context);
+            if (!journalPath.empty()) {
+                restoreOriginalFile();
+            }
         }
         throw;
     }
@@ -2,9 +2,16 @@
 #define TAG_PARSER_BACKUPHELPER_H
 
 #include "./global.h"
+#include "./settings.h"
 
 #include <c++utilities/io/nativefilestream.h>
 
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace TagParser {
 
 class MediaFileInfo;
@@ -12,13 +19,61 @@ class Diagnostics;
 
 namespace BackupHelper {
 
+class TAG_PARSER_EXPORT TemporaryFile {
+public:
+    TemporaryFile();
+    TemporaryFile(const TemporaryFile &) = delete;
+    TemporaryFile &operator=(const TemporaryFile &) = delete;
+    ~TemporaryFile();
+
+    bool create(const std::string &originalPath);
+    bool isCreated() const;
+    const std::string &path() const;
+    bool replaceOriginalFile(const std::string &originalPath, DurabilityPolicy durabilityPolicy = DurabilityPolicy::Default);
+    void discard();
+
+private:
+    int m_fileDescriptor;
+    std::string m_path;
+};
+
+/*!
+ * \brief Returns whether the temporary file has been created (and has neither replaced the original file nor been discarded yet).
+ */
+inline bool TemporaryFile::isCreated() const
+{
+    return m_fileDescriptor >= 0;
+}
+
+/*!
+ * \brief Returns a path which can be used to open the temporary file (as long as isCreated() returns true).
+ * \remarks The path refers to the file descriptor of the temporary file and not to a directory entry.
+ */
+inline const std::string &TemporaryFile::path() const
+{
+    return m_path;
+}
+
 TAG_PARSER_EXPORT void restoreOriginalFileFromBackupFile(const std::string &originalPath, const std::string &backupPath,
     CppUtilities::NativeFileStream &originalStream, CppUtilities::NativeFileStream &backupStream);
-TAG_PARSER_EXPORT void createBackupFile(const std::string &backupDir, const std::string &originalPath, std::string &backupPath,
-    CppUtilities::NativeFileStream &originalStream, CppUtilities::NativeFileStream &backupStream);
+TAG_PARSER_EXPORT bool createBackupFile(const std::string &backupDir, const std::string &originalPath, std::string &backupPath,
+    CppUtilities::NativeFileStream &originalStream, CppUtilities::NativeFileStream &backupStream,
+    BackupStrategy strategy = BackupStrategy::Rename, DurabilityPolicy durabilityPolicy = DurabilityPolicy::Default);
+TAG_PARSER_EXPORT bool createCloneBackupFile(const std::string &backupDir, const std::string &originalPath, std::string &backupPath,
+    DurabilityPolicy durabilityPolicy = DurabilityPolicy::Default);
+TAG_PARSER_EXPORT void createJournal(const std::string &backupDir, const std::string &originalPath, std::string &journalPath,
+    std::istream &originalStream, std::uint64_t originalSize, const std::vector<std::pair<std::uint64_t, std::uint64_t>> &untouchedRanges);
+TAG_PARSER_EXPORT void restoreOriginalFileFromJournal(
+    const std::string &originalPath, const std::string &journalPath, CppUtilities::NativeFileStream &originalStream);
+TAG_PARSER_EXPORT bool undoDataShift(const std::string &path, std::uint64_t dataOffset, std::uint64_t originalDataOffset,
+    CppUtilities::NativeFileStream &outputStream, Diagnostics &diag, const std::string &context = "making file");
+TAG_PARSER_EXPORT bool syncDirectory(const std::string &path);
 TAG_PARSER_EXPORT void handleFailureAfterFileModified(MediaFileInfo &mediaFileInfo, const std::string &backupPath,
     CppUtilities::NativeFileStream &outputStream, CppUtilities::NativeFileStream &backupStream, Diagnostics &diag,
     const std::string &context = "making file");
+TAG_PARSER_EXPORT void handleFailureAfterFileModified(MediaFileInfo &mediaFileInfo, const std::string &backupPath,
+    const std::string &journalPath, CppUtilities::NativeFileStream &outputStream, CppUtilities::NativeFileStream &backupStream,
+    Diagnostics &diag, const std::string &context = "making file");
 
 } // namespace BackupHelper
 
@@ -0,0 +1,307 @@
+#include "./base64.h"
+
+#include <c++utilities/conversion/conversionexception.h>
+
+#include <limits>
+
+#if defined(__AVX2__)
+#define TAG_PARSER_BASE64_AVX2
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define TAG_PARSER_BASE64_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+/// \cond
+namespace Base64 {
+
+namespace {
+
+/// \brief The alphabet of Base64 (RFC 4648, section 4).
+constexpr char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/// \brief The value denoting characters which are not part of the alphabet within the decoding table.
+constexpr std::uint8_t invalid = 0xFF;
+
+/*!
+ * \brief The DecodingTable struct maps each character to its value or to invalid if it is not part of the alphabet.
+ */
+struct DecodingTable {
+    constexpr DecodingTable()
+        : values()
+    {
+        for (auto &value : values) {
+            value = invalid;
+        }
+        for (std::uint8_t i = 0; i < 64; ++i) {
+            values[static_cast<unsigned char>(alphabet[i])] = i;
+        }
+    }
+    std::uint8_t values[256];
+};
+constexpr auto decodingTable = DecodingTable();
+
+/*!
+ * \brief Encodes the 3 bytes at \a data into 4 characters at \a output.
+ */
+inline void encodeGroup(const std::uint8_t *data, char *output)
+{
+    const auto group = static_cast<std::uint32_t>(data[0]) << 16 | static_cast<std::uint32_t>(data[1]) << 8 | data[2];
+    output[0] = alphabet[(group >> 18) & 0x3F];
+    output[1] = alphabet[(group >> 12) & 0x3F];
+    output[2] = alphabet[(group >> 6) & 0x3F];
+    output[3] = alphabet[group & 0x3F];
+}
+
+/*!
+ * \brief Decodes the 4 characters at \a encoded into 3 bytes at \a output.
+ * \returns Returns whether all characters are part of the alphabet.
+ */
+inline bool decodeGroup(const char *encoded, std::uint8_t *output)
+{
+    const auto *const values = decodingTable.values;
+    const auto a = values[static_cast<unsigned char>(encoded[0])], b = values[static_cast<unsigned char>(encoded[1])],
+               c = values[static_cast<unsigned char>(encoded[2])], d = values[static_cast<unsigned char>(encoded[3])];
+    if ((a | b | c | d) & 0x80) {
+        return false;
+    }
+    const auto group = static_cast<std::uint32_t>(a) << 18 | static_cast<std::uint32_t>(b) << 12 | static_cast<std::uint32_t>(c) << 6 | d;
+    output[0] = static_cast<std::uint8_t>(group >> 16);
+    output[1] = static_cast<std::uint8_t>(group >> 8);
+    output[2] = static_cast<std::uint8_t>(group);
+    return true;
+}
+
+/*!
+ * \brief Encodes as many bytes as possible using SIMD instructions.
+ * \returns Returns the number of bytes which have been encoded (a multiple of 3).
+ */
+std::size_t encodeVectorized(const std::uint8_t *data, std::size_t size, char *output)
+{
+    auto i = std::size_t();
+#if defined(TAG_PARSER_BASE64_AVX2)
+    // encode 24 bytes at a time; each lane is loaded with 16 bytes of which the first 12 are used (so 28 bytes are read)
+    const auto reshuffle = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10, 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const auto offsets = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0, 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    for (; i + 28 <= size; i += 24, output += 32) {
+        const auto low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const auto high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 12));
+        const auto input = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1), reshuffle);
+        // split each group of 3 bytes into 4 indices of 6 bits
+        const auto indicesAC = _mm256_mulhi_epu16(_mm256_and_si256(input, _mm256_set1_epi32(0x0FC0FC00)), _mm256_set1_epi32(0x04000040));
+        const auto indicesBD = _mm256_mullo_epi16(_mm256_and_si256(input, _mm256_set1_epi32(0x003F03F0)), _mm256_set1_epi32(0x01000010));
+        const auto indices = _mm256_or_si256(indicesAC, indicesBD);
+        // translate indices into characters by adding the offset of the range the index is in
+        auto ranges = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        ranges = _mm256_or_si256(ranges, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices), _mm256_set1_epi8(13)));
+        const auto characters = _mm256_add_epi8(_mm256_shuffle_epi8(offsets, ranges), indices);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output), characters);
+    }
+#elif defined(TAG_PARSER_BASE64_NEON)
+    // encode 48 bytes at a time; vld3q_u8() splits the input into the first, second and third bytes of the groups
+    uint8x16x4_t table;
+    for (auto part = 0; part != 4; ++part) {
+        table.val[part] = vld1q_u8(reinterpret_cast<const std::uint8_t *>(alphabet) + part * 16);
+    }
+    const auto mask = vdupq_n_u8(0x3F);
+    for (; i + 48 <= size; i += 48, output += 64) {
+        const auto input = vld3q_u8(data + i);
+        uint8x16x4_t indices;
+        indices.val[0] = vshrq_n_u8(input.val[0], 2);
+        indices.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(input.val[0], 4), vshrq_n_u8(input.val[1], 4)), mask);
+        indices.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(input.val[1], 2), vshrq_n_u8(input.val[2], 6)), mask);
+        indices.val[3] = vandq_u8(input.val[2], mask);
+        for (auto part = 0; part != 4; ++part) {
+            indices.val[part] = vqtbl4q_u8(table, indices.val[part]);
+        }
+        vst4q_u8(reinterpret_cast<std::uint8_t *>(output), indices);
+    }
+#else
+    (void)data;
+    (void)size;
+    (void)output;
+#endif
+    return i;
+}
+
+/*!
+ * \brief Decodes as many characters as possible using SIMD instructions.
+ * \returns Returns the number of characters which have been decoded (a multiple of 4).
+ * \remarks Stops at the first block containing characters which are not part of the alphabet (including padding) so
+ *          the caller can deal with them.
+ */
+std::size_t decodeVectorized(const char *encoded, std::size_t size, std::uint8_t *output)
+{
+    auto i = std::size_t();
+#if defined(TAG_PARSER_BASE64_AVX2)
+    // decode 32 characters at a time; the masks and offsets are looked up via the high and low nibble of each character
+    const auto lowNibbleMasks = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const auto highNibbleMasks = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const auto offsets = _mm256_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0, 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const auto packing = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const auto nibbleMask = _mm256_set1_epi8(0x0F);
+    for (; i + 32 <= size; i += 32, output += 24) {
+        const auto input = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(encoded + i));
+        const auto highNibbles = _mm256_and_si256(_mm256_srli_epi32(input, 4), nibbleMask);
+        const auto lowNibbles = _mm256_and_si256(input, nibbleMask);
+        if (!_mm256_testz_si256(_mm256_shuffle_epi8(lowNibbleMasks, lowNibbles), _mm256_shuffle_epi8(highNibbleMasks, highNibbles))) {
+            break;
+        }
+        // translate characters into values; '/' needs to be distinguished from '+' (which shares its high nibble)
+        const auto isSlash = _mm256_cmpeq_epi8(input, _mm256_set1_epi8('/'));
+        const auto values = _mm256_add_epi8(input, _mm256_shuffle_epi8(offsets, _mm256_add_epi8(isSlash, highNibbles)));
+        // merge 4 values of 6 bits into 3 bytes
+        const auto merged = _mm256_madd_epi16(_mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140)), _mm256_set1_epi32(0x00011000));
+        const auto packed = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(merged, packing), _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output), _mm256_castsi256_si128(packed));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(output + 16), _mm256_extracti128_si256(packed, 1));
+    }
+#elif defined(TAG_PARSER_BASE64_NEON)
+    // decode 64 characters at a time; vld4q_u8() splits the input into the first, second, third and fourth characters
+    // of the groups which are translated via a table covering the first 128 characters
+    uint8x16x4_t lowTable, highTable;
+    for (auto part = 0; part != 4; ++part) {
+        lowTable.val[part] = vld1q_u8(decodingTable.values + part * 16);
+        highTable.val[part] = vld1q_u8(decodingTable.values + 64 + part * 16);
+    }
+    const auto highOffset = vdupq_n_u8(64);
+    for (; i + 64 <= size; i += 64, output += 48) {
+        const auto input = vld4q_u8(reinterpret_cast<const std::uint8_t *>(encoded + i));
+        uint8x16x4_t values;
+        auto errors = vdupq_n_u8(0);
+        for (auto part = 0; part != 4; ++part) {
+            // indices exceeding the table yield zero so characters beyond 127 are checked via their high bit
+            values.val[part] = vorrq_u8(vqtbl4q_u8(lowTable, input.val[part]), vqtbl4q_u8(highTable, vsubq_u8(input.val[part], highOffset)));
+            errors = vorrq_u8(errors, vorrq_u8(values.val[part], input.val[part]));
+        }
+        if (vmaxvq_u8(errors) & 0x80) {
+            break;
+        }
+        uint8x16x3_t bytes;
+        bytes.val[0] = vorrq_u8(vshlq_n_u8(values.val[0], 2), vshrq_n_u8(values.val[1], 4));
+        bytes.val[1] = vorrq_u8(vshlq_n_u8(values.val[1], 4), vshrq_n_u8(values.val[2], 2));
+        bytes.val[2] = vorrq_u8(vshlq_n_u8(values.val[2], 6), values.val[3]);
+        vst3q_u8(output, bytes);
+    }
+#else
+    (void)encoded;
+    (void)size;
+    (void)output;
+#endif
+    return i;
+}
+
+} // namespace
+
+/*!
+ * \brief Encodes the specified \a data of \a size bytes writing encodedSize() characters to \a output.
+ */
+void encode(const std::uint8_t *data, std::size_t size, char *output)
+{
+    auto i = encodeVectorized(data, size, output);
+    output += i / 3 * 4;
+    for (; i + 3 <= size; i += 3, output += 4) {
+        encodeGroup(data + i, output);
+    }
+    // encode remaining bytes with padding
+    if (const auto remaining = size - i) {
+        const std::uint8_t last[3] = { data[i], remaining > 1 ? data[i + 1] : std::uint8_t(), std::uint8_t() };
+        encodeGroup(last, output);
+        output[3] = '=';
+        if (remaining == 1) {
+            output[2] = '=';
+        }
+    }
+}
+
+/*!
+ * \brief Encodes the specified \a data of \a size bytes.
+ */
+std::string encode(const std::uint8_t *data, std::size_t size)
+{
+    auto encoded = std::string(encodedSize(size), '\0');
+    encode(data, size, encoded.data());
+    return encoded;
+}
+
+/*!
+ * \brief Returns the number of bytes decode() produces for the specified \a encoded data of \a size characters.
+ * \throws Throws a ConversionException if \a size is not a multiple of 4.
+ */
+std::size_t decodedSize(const char *encoded, std::size_t size)
+{
+    if (size % 4) {
+        throw ConversionException("Size is not a multiple of 4.");
+    }
+    if (!size) {
+        return 0;
+    }
+    return size / 4 * 3 - (encoded[size - 1] == '=' ? (encoded[size - 2] == '=' ? 2 : 1) : 0);
+}
+
+/*!
+ * \brief Decodes the specified \a encoded data of \a size characters writing decodedSize() bytes to \a output.
+ * \returns Returns the number of bytes written to \a output.
+ * \throws Throws a ConversionException if \a encoded is not valid Base64.
+ */
+std::size_t decode(const char *encoded, std::size_t size, std::uint8_t *output)
+{
+    const auto outputSize = decodedSize(encoded, size);
+    if (!outputSize) {
+        return 0;
+    }
+    // decode all groups except the last one (which might be padded)
+    const auto lastGroup = size - 4;
+    auto i = decodeVectorized(encoded, lastGroup, output);
+    auto *out = output + i / 4 * 3;
+    for (; i != lastGroup; i += 4, out += 3) {
+        if (!decodeGroup(encoded + i, out)) {
+            throw ConversionException("Base64 data contains invalid characters.");
+        }
+    }
+    // decode last group
+    char last[4] = { encoded[i], encoded[i + 1], encoded[i + 2], encoded[i + 3] };
+    const auto padding = static_cast<std::size_t>(size / 4 * 3 - outputSize);
+    for (auto p = std::size_t(); p != padding; ++p) {
+        last[3 - p] = alphabet[0];
+    }
+    std::uint8_t lastBytes[3];
+    if (!decodeGroup(last, lastBytes)) {
+        throw ConversionException("Base64 data contains invalid characters.");
+    }
+    for (auto b = std::size_t(); b != 3 - padding; ++b) {
+        out[b] = lastBytes[b];
+    }
+    return outputSize;
+}
+
+/*!
+ * \brief Decodes the specified \a encoded data of \a size characters.
+ * \returns Returns the buffer and its size.
+ * \throws Throws a ConversionException if \a encoded is not valid Base64 or the decoded data exceeds 4 GiB.
+ */
+std::pair<std::unique_ptr<std::uint8_t[]>, std::uint32_t> decode(const char *encoded, std::size_t size)
+{
+    const auto outputSize = decodedSize(encoded, size);
+    if (outputSize > numeric_limits<std::uint32_t>::max()) {
+        throw ConversionException("Decoded data exceeds the maximum size.");
+    }
+    auto buffer = make_unique<std::uint8_t[]>(outputSize);
+    decode(encoded, size, buffer.get());
+    return make_pair(move(buffer), static_cast<std::uint32_t>(outputSize));
+}
+
+} // namespace Base64
+/// \endcond
+
+} // namespace TagParser
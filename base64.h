@@ -0,0 +1,45 @@
+#ifndef TAG_PARSER_BASE64_H
+#define TAG_PARSER_BASE64_H
+
+#include "./global.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace TagParser {
+
+/// \cond
+
+/*!
+ * \brief The Base64 namespace contains the Base64 codec used for "METADATA_BLOCK_PICTURE"s within Vorbis comments.
+ *
+ * The functions produce the same results as CppUtilities::encodeBase64() and CppUtilities::decodeBase64(). However,
+ * they process 24 bytes (AVX2) or 48 bytes (NEON) at a time if available and are otherwise still table-driven so
+ * an encoded cover of several MiB can be converted without noticeable delay.
+ */
+namespace Base64 {
+
+TAG_PARSER_EXPORT void encode(const std::uint8_t *data, std::size_t size, char *output);
+TAG_PARSER_EXPORT std::string encode(const std::uint8_t *data, std::size_t size);
+TAG_PARSER_EXPORT std::size_t decodedSize(const char *encoded, std::size_t size);
+TAG_PARSER_EXPORT std::size_t decode(const char *encoded, std::size_t size, std::uint8_t *output);
+TAG_PARSER_EXPORT std::pair<std::unique_ptr<std::uint8_t[]>, std::uint32_t> decode(const char *encoded, std::size_t size);
+
+/*!
+ * \brief Returns the number of characters encode() produces for \a size bytes (including padding).
+ */
+inline std::size_t encodedSize(std::size_t size)
+{
+    return (size + 2) / 3 * 4;
+}
+
+} // namespace Base64
+
+/// \endcond
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_BASE64_H
@@ -1,7 +1,16 @@
 #include "./basicfileinfo.h"
+#include "./bytesource.h"
 
 #include <c++utilities/conversion/stringconversion.h>
 
+#ifdef PLATFORM_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <limits>
+
 using namespace std;
 using namespace CppUtilities;
 
@@ -24,6 +33,7 @@ BasicFileInfo::BasicFileInfo(const std::string &path)
     : m_path(path)
     , m_size(0)
     , m_readOnly(false)
+    , m_memoryMappingEnabled(false)
 {
     m_file.exceptions(ios_base::failbit | ios_base::badbit);
 }
@@ -59,10 +69,21 @@ void BasicFileInfo::open(bool readOnly)
 void BasicFileInfo::reopen(bool readOnly)
 {
     invalidated();
+    if (m_byteSource) {
+        m_readOnly = true;
+        m_size = m_byteSource->size();
+        m_mappedData = m_byteSource->contiguousData();
+        m_byteSourceStream->clear();
+        m_byteSourceStream->seekg(0, ios_base::beg);
+        return;
+    }
     m_file.open(pathForOpen(path()), (m_readOnly = readOnly) ? ios_base::in | ios_base::binary : ios_base::in | ios_base::out | ios_base::binary);
     m_file.seekg(0, ios_base::end);
     m_size = static_cast<std::uint64_t>(m_file.tellg());
     m_file.seekg(0, ios_base::beg);
+    if (m_readOnly && m_memoryMappingEnabled) {
+        mapFile();
+    }
 }
 
 /*!
@@ -70,12 +91,149 @@ void BasicFileInfo::reopen(bool readOnly)
  */
 void BasicFileInfo::close()
 {
+    unmapFile();
     if (isOpen()) {
         m_file.close();
     }
     m_file.clear();
 }
 
+/*!
+ * \brief Sets whether the file should be memory-mapped when opened read-only.
+ *
+ * When enabled, parsers read headers and small structures directly from mappedData() instead of
+ * issuing seek and read calls on the stream(). This avoids a lot of syscalls and copying when
+ * parsing large files. The stream() is still opened and can be used as usual.
+ *
+ * \remarks
+ * - Takes effect on the next read-only open()/reopen(). Disabling releases an existing mapping immediately.
+ * - Memory-mapping is currently only supported on UNIX platforms. If mapping the file fails, the
+ *   stream is used as fallback.
+ */
+void BasicFileInfo::setMemoryMappingEnabled(bool enabled)
+{
+    if (!(m_memoryMappingEnabled = enabled)) {
+        unmapFile();
+    }
+}
+
+/*!
+ * \brief Maps the whole file read-only into memory.
+ * \remarks Failures are not considered fatal; mappedData() just stays empty in that case.
+ */
+void BasicFileInfo::mapFile()
+{
+#ifdef PLATFORM_UNIX
+    unmapFile();
+    if (!m_size || m_size > numeric_limits<size_t>::max()) {
+        return;
+    }
+    const auto fd = ::open(pathForOpen(path()), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    const auto mappingSize = static_cast<size_t>(m_size);
+    void *const mapping = ::mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping != MAP_FAILED) {
+        m_mappedData = string_view(static_cast<const char *>(mapping), mappingSize);
+    }
+#endif
+}
+
+/*!
+ * \brief Tells the kernel how the file is going to be read so it can adjust the read-ahead.
+ *
+ * MediaFileInfo::parseContainerFormat() calls this according to the container format, e.g. random access is advised
+ * for MP4 and Matroska files so walking their headers does not read ahead (and cache) the media data in between.
+ *
+ * \remarks
+ * - Currently this only affects the memory-mapping of the file (see setMemoryMappingEnabled()) because the file
+ *   descriptor of the stream() is not accessible. Without mapping this does nothing.
+ * - The advice is reset when the file is mapped again.
+ */
+void BasicFileInfo::adviseAccessPattern(FileAccessPattern pattern)
+{
+#ifdef PLATFORM_UNIX
+    if (m_byteSource || m_mappedData.empty()) {
+        return;
+    }
+    auto advice = MADV_NORMAL;
+    switch (pattern) {
+    case FileAccessPattern::Random:
+        advice = MADV_RANDOM;
+        break;
+    case FileAccessPattern::Sequential:
+        advice = MADV_SEQUENTIAL;
+        break;
+    default:;
+    }
+    ::madvise(const_cast<char *>(m_mappedData.data()), m_mappedData.size(), advice);
+#else
+    CPP_UTILITIES_UNUSED(pattern);
+#endif
+}
+
+/*!
+ * \brief Releases the memory-mapping of the file if present.
+ * \remarks Needs to be called before the file is modified or replaced.
+ */
+void BasicFileInfo::unmapFile()
+{
+    if (m_byteSource) {
+        // contiguous data of the byte source is not a mapping and stays valid as long as the source is set
+        return;
+    }
+#ifdef PLATFORM_UNIX
+    if (!m_mappedData.empty()) {
+        ::munmap(const_cast<char *>(m_mappedData.data()), m_mappedData.size());
+    }
+#endif
+    m_mappedData = string_view();
+}
+
+/*!
+ * \brief Sets a \a byteSource to read from instead of the file.
+ *
+ * When set, all parsing methods read from inputStream() which reads from the specified \a byteSource. If the
+ * source provides ByteSource::contiguousData(), parsers access the data directly without copying (like if the
+ * file was memory-mapped).
+ *
+ * \remarks
+ * - The file info is invalidated and a possibly opened file is closed. Passing nullptr reverts to reading from
+ *   the file again.
+ * - The source is considered read-only, so changes can not be applied as long as a byte source is set.
+ * - If the source is forward-only (e.g. ForwardOnlyByteSource for pipes and sockets), parsers avoid seeking; see
+ *   isForwardOnly().
+ * - The path() is still used to determine e.g. the file name and extension.
+ */
+void BasicFileInfo::setByteSource(const std::shared_ptr<ByteSource> &byteSource)
+{
+    if (m_byteSource) {
+        m_mappedData = string_view();
+        m_byteSource.reset();
+    }
+    invalidated();
+    m_byteSourceStream.reset();
+    m_byteSourceBuffer.reset();
+    if (!(m_byteSource = byteSource)) {
+        return;
+    }
+    m_byteSourceBuffer = make_unique<ByteSourceStreamBuffer>(*m_byteSource);
+    m_byteSourceStream = make_unique<iostream>(m_byteSourceBuffer.get());
+    m_byteSourceStream->exceptions(ios_base::failbit | ios_base::badbit);
+    reopen(true);
+}
+
+/*!
+ * \brief Returns whether a forward-only byte source (e.g. ForwardOnlyByteSource) has been set.
+ * \remarks Parsers avoid seeking in that case; see ByteSource::isForwardOnly().
+ */
+bool BasicFileInfo::isForwardOnly() const
+{
+    return m_byteSource && m_byteSource->isForwardOnly();
+}
+
 /*!
  * \brief Invalidates the file info manually.
  */
@@ -217,7 +375,7 @@ string BasicFileInfo::containingDirectory() const
  */
 void BasicFileInfo::invalidated()
 {
-    m_size = 0;
+    m_size = m_byteSource ? m_byteSource->size() : 0;
     close();
 }
 
@@ -7,10 +7,25 @@
 #include <c++utilities/io/nativefilestream.h>
 
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 
 namespace TagParser {
 
+class ByteSource;
+class ByteSourceStreamBuffer;
+
+/*!
+ * \brief The FileAccessPattern enum specifies how a file is going to be read.
+ * \sa BasicFileInfo::adviseAccessPattern()
+ */
+enum class FileAccessPattern {
+    Normal, /**< no particular pattern, the kernel's default read-ahead is used */
+    Random, /**< the file is read at scattered offsets (e.g. when walking the headers of MP4 and Matroska files) */
+    Sequential, /**< the file is read from the beginning to the end (e.g. Ogg pages) */
+};
+
 class TAG_PARSER_EXPORT BasicFileInfo {
 public:
     // constructor, destructor
@@ -28,6 +43,20 @@ public:
     void invalidate();
     CppUtilities::NativeFileStream &stream();
     const CppUtilities::NativeFileStream &stream() const;
+    std::iostream &inputStream();
+
+    // methods to read from a byte source instead of the file
+    const std::shared_ptr<ByteSource> &byteSource() const;
+    void setByteSource(const std::shared_ptr<ByteSource> &byteSource);
+    bool hasByteSource() const;
+    bool isForwardOnly() const;
+
+    // methods to control memory-mapping of the file
+    bool isMemoryMappingEnabled() const;
+    void setMemoryMappingEnabled(bool enabled);
+    bool isMapped() const;
+    const std::string_view &mappedData() const;
+    void adviseAccessPattern(FileAccessPattern pattern);
 
     // methods to get, set path (components)
     const std::string &path() const;
@@ -49,22 +78,30 @@ public:
 
 protected:
     virtual void invalidated();
+    void unmapFile();
 
 private:
+    void mapFile();
+
     std::string m_path;
     CppUtilities::NativeFileStream m_file;
+    std::shared_ptr<ByteSource> m_byteSource;
+    std::unique_ptr<ByteSourceStreamBuffer> m_byteSourceBuffer;
+    std::unique_ptr<std::iostream> m_byteSourceStream;
+    std::string_view m_mappedData;
     std::uint64_t m_size;
     bool m_readOnly;
+    bool m_memoryMappingEnabled;
 };
 
 /*!
  * \brief Indicates whether a std::fstream is open for the current file.
- *
+ * \remarks Always true if a byte source has been set.
  * \sa stream()
  */
 inline bool BasicFileInfo::isOpen() const
 {
-    return m_file.is_open();
+    return m_byteSource || m_file.is_open();
 }
 
 /*!
@@ -91,6 +128,68 @@ inline const CppUtilities::NativeFileStream &BasicFileInfo::stream() const
     return m_file;
 }
 
+/*!
+ * \brief Returns the stream to read from when parsing.
+ *
+ * This is a stream reading from the byteSource() if one has been set; otherwise it is the stream().
+ */
+inline std::iostream &BasicFileInfo::inputStream()
+{
+    return m_byteSourceStream ? *m_byteSourceStream : static_cast<std::iostream &>(m_file);
+}
+
+/*!
+ * \brief Returns the byte source to read from instead of the file if one has been set; otherwise returns nullptr.
+ * \sa setByteSource()
+ */
+inline const std::shared_ptr<ByteSource> &BasicFileInfo::byteSource() const
+{
+    return m_byteSource;
+}
+
+/*!
+ * \brief Returns whether a byte source has been set.
+ * \sa setByteSource()
+ */
+inline bool BasicFileInfo::hasByteSource() const
+{
+    return m_byteSource != nullptr;
+}
+
+/*!
+ * \brief Returns whether the file is memory-mapped when opened read-only.
+ * \sa setMemoryMappingEnabled()
+ */
+inline bool BasicFileInfo::isMemoryMappingEnabled() const
+{
+    return m_memoryMappingEnabled;
+}
+
+/*!
+ * \brief Returns whether the file is currently memory-mapped.
+ * \remarks Also true if a byte source providing contiguous data has been set.
+ * \sa mappedData()
+ */
+inline bool BasicFileInfo::isMapped() const
+{
+    return !m_mappedData.empty();
+}
+
+/*!
+ * \brief Returns the memory-mapped contents of the file or an empty view if the file is not mapped.
+ * \remarks
+ * - The mapping is only available when memory-mapping has been enabled via setMemoryMappingEnabled()
+ *   and the file has been opened read-only on a platform supporting it. It is also available if a byte source
+ *   providing ByteSource::contiguousData() has been set.
+ * - The mapping covers size() bytes and is released when the file is closed, reopened or modified.
+ *   Hence parsers must not keep pointers into the mapping beyond that. Keeping a reference to the
+ *   returned view is fine because it is always updated.
+ */
+inline const std::string_view &BasicFileInfo::mappedData() const
+{
+    return m_mappedData;
+}
+
 /*!
  * \brief Returns the path of the current file.
  *
@@ -0,0 +1,460 @@
+#include "./batchparser.h"
+#include "./batchwriter.h"
+#include "./bytesource.h"
+#include "./concurrencycontroller.h"
+#include "./mediafileinfo.h"
+#include "./mediafilestatistics.h"
+#include "./trackcolumns.h"
+
+#include <c++utilities/conversion/stringbuilder.h>
+
+#ifdef PLATFORM_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <ios>
+#include <map>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+#ifdef PLATFORM_UNIX
+/// \cond
+namespace {
+
+/*!
+ * \brief The OwnedFileDescriptorByteSource class reads from a file descriptor it owns until close() is called.
+ */
+class OwnedFileDescriptorByteSource : public ByteSource {
+public:
+    explicit OwnedFileDescriptorByteSource(int fileDescriptor);
+    ~OwnedFileDescriptorByteSource() override;
+
+    std::uint64_t size() const override;
+    std::size_t read(std::uint64_t offset, char *buffer, std::size_t count) override;
+    int fileDescriptor() const;
+    void close();
+
+private:
+    int m_fileDescriptor;
+    FileDescriptorByteSource m_source;
+};
+
+OwnedFileDescriptorByteSource::OwnedFileDescriptorByteSource(int fileDescriptor)
+    : m_fileDescriptor(fileDescriptor)
+    , m_source(fileDescriptor)
+{
+}
+
+OwnedFileDescriptorByteSource::~OwnedFileDescriptorByteSource()
+{
+    close();
+}
+
+std::uint64_t OwnedFileDescriptorByteSource::size() const
+{
+    return m_source.size();
+}
+
+std::size_t OwnedFileDescriptorByteSource::read(std::uint64_t offset, char *buffer, std::size_t count)
+{
+    if (m_fileDescriptor < 0) {
+        throw ios_base::failure("The file has already been closed.");
+    }
+    return m_source.read(offset, buffer, count);
+}
+
+int OwnedFileDescriptorByteSource::fileDescriptor() const
+{
+    return m_fileDescriptor;
+}
+
+void OwnedFileDescriptorByteSource::close()
+{
+    if (m_fileDescriptor >= 0) {
+        ::close(m_fileDescriptor);
+        m_fileDescriptor = -1;
+    }
+}
+
+} // namespace
+/// \endcond
+#endif
+
+/*!
+ * \class TagParser::BatchParser
+ * \brief The BatchParser class parses many files concurrently using a work-stealing thread pool.
+ *
+ * Each worker thread owns a queue of files. Once its own queue is exhausted a worker steals files from the
+ * back of the queues of the other workers so the load is balanced even if the files differ greatly in size.
+ *
+ * Each file is parsed via its own MediaFileInfo object and collects diagnostic messages in its own Diagnostics
+ * object. Hence no state is shared between files. Per-file settings (e.g. MediaFileInfo::setMatroskaMaxFullParseSize())
+ * can be applied via the setup callback. The global settings (e.g. MatroskaContainer::maxFullParseSize()
+ * and EbmlElement::bytesToBeSkipped) are atomic and the lookup tables used by the parser are constant or initialized
+ * in a thread-safe manner, so it is safe to parse files concurrently.
+ */
+
+/*!
+ * \brief Constructs an empty result.
+ */
+BatchParserResult::BatchParserResult()
+    : index(0)
+{
+}
+
+/*!
+ * \brief Move-constructs a result.
+ */
+BatchParserResult::BatchParserResult(BatchParserResult &&other) = default;
+
+/*!
+ * \brief Destroys the result.
+ */
+BatchParserResult::~BatchParserResult()
+{
+}
+
+/*!
+ * \brief Move-assigns a result.
+ */
+BatchParserResult &BatchParserResult::operator=(BatchParserResult &&other) = default;
+
+/*!
+ * \brief Constructs a new batch parser using the specified number of threads.
+ * \remarks If \a parallelism is zero, the number of hardware threads is used.
+ */
+BatchParser::BatchParser(unsigned int parallelism)
+    : m_parallelism(parallelism)
+    , m_parsingFlags(ParsingFlags::None)
+    , m_memoryMappingEnabled(false)
+    , m_asyncReadingEnabled(false)
+    , m_adaptiveParallelismEnabled(false)
+    , m_aborted(false)
+{
+}
+
+/*!
+ * \brief Parses the files with the specified \a paths and invokes \a callback for each of them.
+ *
+ * The function blocks until all files have been parsed or parsing has been aborted via abort(). The callback
+ * is invoked from the worker threads as soon as a file has been parsed; so results are not necessarily reported
+ * in the order of \a paths (use BatchParserResult::index to correlate them). Invocations of the callback are
+ * serialized, so the callback does not need to be thread-safe itself. It must not throw.
+ *
+ * Exceptions which abort parsing a file (e.g. IO errors) are caught and stored in BatchParserResult::exception.
+ */
+void BatchParser::parse(const std::vector<std::string> &paths, const ResultCallback &callback)
+{
+    m_aborted.store(false);
+    auto callbackMutex = mutex();
+    runOnFiles(paths, [&, this](size_t index, const shared_ptr<ByteSource> &source, ConcurrencyController *controller) {
+        BatchParserResult result;
+        result.index = index;
+        result.path = paths[index];
+        parseFile(result, false, source, controller);
+        if (callback) {
+            const auto guard = lock_guard<mutex>(callbackMutex);
+            callback(result);
+        }
+    });
+}
+
+/*!
+ * \brief Parses the tracks of the files with the specified \a paths and appends their properties to \a columns.
+ *
+ * Only the container format and the tracks are parsed (tags, chapters and attachments are skipped). The properties of
+ * the tracks are written into columns gathered per file which are appended to \a columns as soon as the file has been
+ * parsed; so the rows of different files are not necessarily in the order of \a paths (use TrackColumns::fileIndex to
+ * correlate them). The MediaFileInfo object of a file is destroyed right after its tracks have been exported unless
+ * \a callback is specified; in this case \a callback is invoked with the result of each file like parse() does.
+ *
+ * \remarks Rows are appended to \a columns; call TrackColumns::clear() before to reuse the buffers for another batch.
+ */
+void BatchParser::scanTrackColumns(const std::vector<std::string> &paths, TrackColumns &columns, const ResultCallback &callback)
+{
+    m_aborted.store(false);
+    auto columnsMutex = mutex();
+    runOnFiles(paths, [&, this](size_t index, const shared_ptr<ByteSource> &source, ConcurrencyController *controller) {
+        BatchParserResult result;
+        result.index = index;
+        result.path = paths[index];
+        parseFile(result, true, source, controller);
+        TrackColumns fileColumns;
+        result.fileInfo->exportTrackColumns(fileColumns, static_cast<std::uint32_t>(index));
+        const auto guard = lock_guard<mutex>(columnsMutex);
+        columns.append(fileColumns);
+        if (callback) {
+            callback(result);
+        }
+    });
+}
+
+/*!
+ * \brief Invokes \a task for each index in [0, \a count) using the work-stealing thread pool described in the class documentation.
+ *
+ * The function blocks until \a task has been invoked for all indices or until \a aborted is set. The current thread
+ * acts as one of the workers. If \a parallelism is zero, the number of hardware threads is used.
+ *
+ * \remarks This is also used by other batch operations, e.g. Id3BatchConverter. The \a task must not throw.
+ */
+void BatchParser::runConcurrently(
+    std::size_t count, unsigned int parallelism, const std::atomic<bool> &aborted, const std::function<void(std::size_t index)> &task)
+{
+    runConcurrently(count, parallelism, nullptr, aborted, task);
+}
+
+/*!
+ * \brief Invokes \a task for each index in [0, \a count) like runConcurrently() but lets \a controller determine the
+ *        number of workers.
+ *
+ * Up to ConcurrencyController::maxParallelism() workers are started but only the first
+ * ConcurrencyController::parallelism() ones take tasks at a time (see ConcurrencyController::waitForTurn()). The
+ * \a task is supposed to report the time it took via ConcurrencyController::addSample().
+ */
+void BatchParser::runConcurrently(
+    std::size_t count, ConcurrencyController &controller, const std::atomic<bool> &aborted, const std::function<void(std::size_t index)> &task)
+{
+    runConcurrently(count, controller.maxParallelism(), &controller, aborted, task);
+}
+
+/*!
+ * \brief Implements both overloads of runConcurrently(); \a controller might be nullptr.
+ */
+void BatchParser::runConcurrently(std::size_t count, unsigned int parallelism, ConcurrencyController *controller, const std::atomic<bool> &aborted,
+    const std::function<void(std::size_t index)> &task)
+{
+    if (!count) {
+        return;
+    }
+
+    // determine number of workers
+    auto workerCount = static_cast<size_t>(parallelism ? parallelism : thread::hardware_concurrency());
+    workerCount = max<size_t>(1, min(workerCount, count));
+
+    // distribute indices evenly over the queues of the workers
+    struct WorkerQueue {
+        mutex lock;
+        deque<size_t> indices;
+    };
+    auto queues = vector<WorkerQueue>(workerCount);
+    for (size_t index = 0; index != count; ++index) {
+        queues[index * workerCount / count].indices.push_back(index);
+    }
+
+    // define routine to take the next file (from the own queue or from another one)
+    const auto takeNext = [&queues, workerCount](size_t worker, size_t &index) {
+        {
+            auto &own = queues[worker];
+            const auto guard = lock_guard<mutex>(own.lock);
+            if (!own.indices.empty()) {
+                index = own.indices.front();
+                own.indices.pop_front();
+                return true;
+            }
+        }
+        for (size_t offset = 1; offset != workerCount; ++offset) {
+            auto &victim = queues[(worker + offset) % workerCount];
+            const auto guard = lock_guard<mutex>(victim.lock);
+            if (!victim.indices.empty()) {
+                index = victim.indices.back();
+                victim.indices.pop_back();
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // define routine executed by workers; workers beyond the number allowed by the controller wait for their turn and
+    // the first worker running out of tasks ends the run so the waiting workers exit as well
+    const auto work = [&](size_t worker) {
+        for (size_t index;;) {
+            if (controller) {
+                controller->waitForTurn(worker);
+            }
+            if (aborted.load() || !takeNext(worker, index)) {
+                break;
+            }
+            task(index);
+        }
+        if (controller) {
+            controller->endRun();
+        }
+    };
+    if (controller) {
+        controller->beginRun();
+    }
+
+    // run workers; the current thread acts as first worker
+    auto threads = vector<thread>();
+    threads.reserve(workerCount - 1);
+    for (size_t worker = 1; worker != workerCount; ++worker) {
+        threads.emplace_back(work, worker);
+    }
+    work(0);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+/*!
+ * \brief Invokes \a task for each of the specified \a paths using runConcurrently().
+ *
+ * If async reading is enabled, the files are opened in batches and the head and the tail of all files of a batch are
+ * read at once via AsyncFileReader before the batch is processed. The \a task is passed a byte source providing the
+ * file's data in this case and nullptr otherwise (e.g. if opening the file failed, so parseFile() reports the error).
+ */
+void BatchParser::runOnFiles(const std::vector<std::string> &paths, const FileTask &task)
+{
+#ifdef PLATFORM_UNIX
+    if (m_asyncReadingEnabled) {
+        auto controller = m_adaptiveParallelismEnabled ? make_unique<ConcurrencyController>(m_parallelism) : nullptr;
+        auto reader = AsyncFileReader(static_cast<unsigned int>(asyncBatchSize));
+        auto files = vector<shared_ptr<OwnedFileDescriptorByteSource>>();
+        auto sources = vector<shared_ptr<CoalescingByteSource>>();
+        auto requests = vector<AsyncReadRequest>();
+        auto buffers = vector<unique_ptr<char[]>>();
+        auto requestedSources = vector<size_t>();
+        for (size_t batchStart = 0; batchStart < paths.size() && !m_aborted.load(); batchStart += asyncBatchSize) {
+            const auto batchSize = min(asyncBatchSize, paths.size() - batchStart);
+
+            // open the files of the batch and determine the ranges to read upfront
+            files.assign(batchSize, nullptr);
+            sources.assign(batchSize, nullptr);
+            requests.clear();
+            buffers.clear();
+            requestedSources.clear();
+            for (size_t index = 0; index != batchSize; ++index) {
+                const auto fileDescriptor = ::open(BasicFileInfo::pathForOpen(paths[batchStart + index]), O_RDONLY | O_CLOEXEC);
+                if (fileDescriptor < 0) {
+                    continue;
+                }
+                try {
+                    files[index] = make_shared<OwnedFileDescriptorByteSource>(fileDescriptor);
+                } catch (const ios_base::failure &) {
+                    ::close(fileDescriptor);
+                    continue;
+                }
+                sources[index] = make_shared<CoalescingByteSource>(files[index]);
+                for (const auto &[offset, length] : sources[index]->prefetchRanges()) {
+                    auto &request = requests.emplace_back();
+                    request.fileDescriptor = fileDescriptor;
+                    request.offset = offset;
+                    request.buffer = buffers.emplace_back(make_unique<char[]>(length)).get();
+                    request.count = length;
+                    requestedSources.emplace_back(index);
+                }
+            }
+
+            // read the ranges of all files at once; the sources read what could not be read upfront themselves
+            reader.read(requests.data(), requests.size());
+            for (size_t index = 0; index != requests.size(); ++index) {
+                const auto &request = requests[index];
+                if (!request.error && request.bytesRead == request.count) {
+                    sources[requestedSources[index]]->insertPrefetchedRange(request.offset, request.buffer, request.count);
+                }
+            }
+            buffers.clear();
+
+            // parse the files of the batch and close them right away
+            runConcurrently(batchSize, m_parallelism, controller.get(), m_aborted, [&](size_t index) {
+                task(batchStart + index, sources[index], controller.get());
+                if (files[index]) {
+                    files[index]->close();
+                }
+            });
+        }
+        return;
+    }
+#endif
+    if (!m_adaptiveParallelismEnabled) {
+        runConcurrently(paths.size(), m_parallelism, m_aborted, [&task](size_t index) { task(index, nullptr, nullptr); });
+        return;
+    }
+
+    // parse the files of each device via its own pool of threads whose size is adjusted by its own controller
+    auto groupsByDevice = map<std::uint64_t, vector<size_t>>();
+    for (size_t index = 0; index != paths.size(); ++index) {
+        groupsByDevice[BatchWriter::deviceId(paths[index])].emplace_back(index);
+    }
+    auto groups = vector<vector<size_t>>();
+    auto controllers = vector<unique_ptr<ConcurrencyController>>();
+    for (auto &[deviceId, indices] : groupsByDevice) {
+        groups.emplace_back(std::move(indices));
+        controllers.emplace_back(make_unique<ConcurrencyController>(m_parallelism));
+    }
+    const auto runGroup = [&](size_t group) {
+        auto &controller = *controllers[group];
+        const auto &indices = groups[group];
+        runConcurrently(indices.size(), controller, m_aborted, [&](size_t index) { task(indices[index], nullptr, &controller); });
+    };
+    auto threads = vector<thread>();
+    for (size_t group = 1; group < groups.size(); ++group) {
+        threads.emplace_back(runGroup, group);
+    }
+    if (!groups.empty()) {
+        runGroup(0);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+/*!
+ * \brief Parses the file specified within \a result and stores the outcome in \a result.
+ * \remarks
+ * - If \a tracksOnly is set, only the container format and the tracks are parsed.
+ * - If \a source is specified, the file is read from it instead of opening the file.
+ * - If \a controller is specified, the time it took to parse the file and the time spent reading are reported to it.
+ */
+void BatchParser::parseFile(
+    BatchParserResult &result, bool tracksOnly, const std::shared_ptr<ByteSource> &source, ConcurrencyController *controller) const
+{
+    static const string context("batch parsing");
+    const auto start = controller ? chrono::steady_clock::now() : chrono::steady_clock::time_point();
+    result.fileInfo = make_unique<MediaFileInfo>(result.path);
+    auto &fileInfo = *result.fileInfo;
+    try {
+        fileInfo.setParsingFlags(m_parsingFlags);
+        fileInfo.setMemoryMappingEnabled(m_memoryMappingEnabled);
+        if (m_setupCallback) {
+            m_setupCallback(fileInfo);
+        }
+        if (controller) {
+            fileInfo.setStatisticsEnabled(true);
+        }
+        if (source) {
+            fileInfo.setByteSource(source);
+        } else {
+            fileInfo.open(true);
+        }
+        if (tracksOnly) {
+            fileInfo.parseContainerFormat(result.diag);
+            fileInfo.parseTracks(result.diag);
+        } else {
+            fileInfo.parseEverything(result.diag);
+        }
+    } catch (const std::ios_base::failure &failure) {
+        result.diag.emplace_back(DiagLevel::Critical, argsToString("An IO error occurred: ", failure.what()), context);
+        result.exception = current_exception();
+    } catch (...) {
+        result.exception = current_exception();
+    }
+    if (controller) {
+        const auto *const statistics = fileInfo.statistics();
+        controller->addSample(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start),
+            statistics ? statistics->readTime : chrono::nanoseconds::zero());
+    }
+    // close the file so the number of open files does not grow with the number of results kept by the caller
+    fileInfo.close();
+}
+
+} // namespace TagParser
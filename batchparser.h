@@ -0,0 +1,239 @@
+#ifndef TAG_PARSER_BATCHPARSER_H
+#define TAG_PARSER_BATCHPARSER_H
+
+#include "./diagnostics.h"
+#include "./settings.h"
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace TagParser {
+
+class ByteSource;
+class ConcurrencyController;
+class MediaFileInfo;
+struct TrackColumns;
+
+/*!
+ * \brief The BatchParserResult struct holds the result of parsing a single file via BatchParser.
+ */
+struct TAG_PARSER_EXPORT BatchParserResult {
+    BatchParserResult();
+    BatchParserResult(BatchParserResult &&other);
+    ~BatchParserResult();
+    BatchParserResult &operator=(BatchParserResult &&other);
+
+    /// \brief The index of the file within the list passed to BatchParser::parse().
+    std::size_t index;
+    /// \brief The path of the file.
+    std::string path;
+    /// \brief The parsed file; it has already been closed.
+    std::unique_ptr<MediaFileInfo> fileInfo;
+    /// \brief The diagnostic messages which occurred when parsing the file.
+    Diagnostics diag;
+    /// \brief The exception which aborted parsing the file (e.g. an IO error) or nullptr if none occurred.
+    std::exception_ptr exception;
+};
+
+class TAG_PARSER_EXPORT BatchParser {
+public:
+    /// \brief The callback invoked with the result of each parsed file.
+    using ResultCallback = std::function<void(BatchParserResult &result)>;
+    /// \brief The callback invoked to configure a MediaFileInfo object before it is parsed.
+    using SetupCallback = std::function<void(MediaFileInfo &fileInfo)>;
+
+    explicit BatchParser(unsigned int parallelism = 0);
+
+    unsigned int parallelism() const;
+    void setParallelism(unsigned int parallelism);
+    ParsingFlags parsingFlags() const;
+    void setParsingFlags(ParsingFlags flags);
+    bool isMemoryMappingEnabled() const;
+    void setMemoryMappingEnabled(bool enabled);
+    bool isAsyncReadingEnabled() const;
+    void setAsyncReadingEnabled(bool enabled);
+    bool isAdaptiveParallelismEnabled() const;
+    void setAdaptiveParallelismEnabled(bool enabled);
+    const SetupCallback &setupCallback() const;
+    void setSetupCallback(const SetupCallback &callback);
+
+    void parse(const std::vector<std::string> &paths, const ResultCallback &callback);
+    void scanTrackColumns(const std::vector<std::string> &paths, TrackColumns &columns, const ResultCallback &callback = ResultCallback());
+    void abort();
+    bool isAborted() const;
+
+    static void runConcurrently(
+        std::size_t count, unsigned int parallelism, const std::atomic<bool> &aborted, const std::function<void(std::size_t index)> &task);
+    static void runConcurrently(
+        std::size_t count, ConcurrencyController &controller, const std::atomic<bool> &aborted, const std::function<void(std::size_t index)> &task);
+
+    /// \brief The number of files which are read at once when async reading is enabled.
+    static constexpr std::size_t asyncBatchSize = 256;
+
+private:
+    using FileTask = std::function<void(std::size_t index, const std::shared_ptr<ByteSource> &source, ConcurrencyController *controller)>;
+
+    static void runConcurrently(std::size_t count, unsigned int parallelism, ConcurrencyController *controller, const std::atomic<bool> &aborted,
+        const std::function<void(std::size_t index)> &task);
+    void runOnFiles(const std::vector<std::string> &paths, const FileTask &task);
+    void parseFile(BatchParserResult &result, bool tracksOnly = false, const std::shared_ptr<ByteSource> &source = nullptr,
+        ConcurrencyController *controller = nullptr) const;
+
+    unsigned int m_parallelism;
+    ParsingFlags m_parsingFlags;
+    bool m_memoryMappingEnabled;
+    bool m_asyncReadingEnabled;
+    bool m_adaptiveParallelismEnabled;
+    SetupCallback m_setupCallback;
+    std::atomic<bool> m_aborted;
+};
+
+/*!
+ * \brief Returns the number of threads used to parse files.
+ * \remarks A value of zero means the number of hardware threads is used.
+ */
+inline unsigned int BatchParser::parallelism() const
+{
+    return m_parallelism;
+}
+
+/*!
+ * \brief Sets the number of threads used to parse files.
+ * \sa parallelism()
+ */
+inline void BatchParser::setParallelism(unsigned int parallelism)
+{
+    m_parallelism = parallelism;
+}
+
+/*!
+ * \brief Returns the flags passed to each MediaFileInfo object via MediaFileInfo::setParsingFlags().
+ */
+inline ParsingFlags BatchParser::parsingFlags() const
+{
+    return m_parsingFlags;
+}
+
+/*!
+ * \brief Sets the flags passed to each MediaFileInfo object via MediaFileInfo::setParsingFlags().
+ */
+inline void BatchParser::setParsingFlags(ParsingFlags flags)
+{
+    m_parsingFlags = flags;
+}
+
+/*!
+ * \brief Returns whether files are memory-mapped for parsing.
+ * \sa BasicFileInfo::setMemoryMappingEnabled()
+ */
+inline bool BatchParser::isMemoryMappingEnabled() const
+{
+    return m_memoryMappingEnabled;
+}
+
+/*!
+ * \brief Sets whether files are memory-mapped for parsing.
+ * \sa BasicFileInfo::setMemoryMappingEnabled()
+ */
+inline void BatchParser::setMemoryMappingEnabled(bool enabled)
+{
+    m_memoryMappingEnabled = enabled;
+}
+
+/*!
+ * \brief Returns whether the data needed to parse the files is read upfront via AsyncFileReader.
+ *
+ * When enabled, the files are processed in batches of asyncBatchSize files. The head and the tail of all files of a
+ * batch are read at once (via io_uring if available) and the files are then parsed from memory by the worker threads
+ * (see CoalescingByteSource). Data beyond the head and the tail is read synchronously when needed. So a few threads can
+ * serve many files without blocking on each read which pays off on network file systems and with many small files.
+ *
+ * This is disabled by default and currently only supported on UNIX platforms. If enabled, memory-mapping is not used and
+ * the MediaFileInfo objects of the results read from a byte source (which has already been closed) instead of the file.
+ *
+ * \sa setAsyncReadingEnabled()
+ */
+inline bool BatchParser::isAsyncReadingEnabled() const
+{
+    return m_asyncReadingEnabled;
+}
+
+/*!
+ * \brief Sets whether the data needed to parse the files is read upfront via AsyncFileReader.
+ * \sa isAsyncReadingEnabled()
+ */
+inline void BatchParser::setAsyncReadingEnabled(bool enabled)
+{
+    m_asyncReadingEnabled = enabled;
+}
+
+/*!
+ * \brief Returns whether the number of threads is adjusted to the observed throughput via ConcurrencyController.
+ *
+ * When enabled, parallelism() denotes the maximum number of threads (zero means four times the number of hardware
+ * threads). The files are grouped by the device they are stored on and each group is parsed by its own pool of threads
+ * whose size is adjusted independently, e.g. files on an SSD and on an NFS share are parsed with a different number of
+ * threads. Statistics are enabled for all MediaFileInfo objects to determine the time spent reading (see
+ * MediaFileStatistics::readTime).
+ *
+ * This is disabled by default. Grouping by device is only supported on UNIX platforms and not done if async reading is
+ * enabled; then a single controller is used for all files.
+ *
+ * \sa setAdaptiveParallelismEnabled()
+ */
+inline bool BatchParser::isAdaptiveParallelismEnabled() const
+{
+    return m_adaptiveParallelismEnabled;
+}
+
+/*!
+ * \brief Sets whether the number of threads is adjusted to the observed throughput via ConcurrencyController.
+ * \sa isAdaptiveParallelismEnabled()
+ */
+inline void BatchParser::setAdaptiveParallelismEnabled(bool enabled)
+{
+    m_adaptiveParallelismEnabled = enabled;
+}
+
+/*!
+ * \brief Returns the callback invoked to configure a MediaFileInfo object before it is parsed.
+ */
+inline const BatchParser::SetupCallback &BatchParser::setupCallback() const
+{
+    return m_setupCallback;
+}
+
+/*!
+ * \brief Sets the callback invoked to configure a MediaFileInfo object before it is parsed.
+ * \remarks The callback is invoked from the worker threads and must therefore be thread-safe.
+ */
+inline void BatchParser::setSetupCallback(const SetupCallback &callback)
+{
+    m_setupCallback = callback;
+}
+
+/*!
+ * \brief Aborts parsing. Files which are currently being parsed are still finished.
+ * \remarks May be called from any thread, e.g. from within the result callback.
+ */
+inline void BatchParser::abort()
+{
+    m_aborted.store(true);
+}
+
+/*!
+ * \brief Returns whether parsing has been aborted.
+ */
+inline bool BatchParser::isAborted() const
+{
+    return m_aborted.load();
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_BATCHPARSER_H
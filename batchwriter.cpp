@@ -0,0 +1,236 @@
+#include "./batchwriter.h"
+#include "./batchparser.h"
+#include "./exceptions.h"
+#include "./mediafileinfo.h"
+#include "./progressfeedback.h"
+
+#include <c++utilities/conversion/stringbuilder.h>
+
+#ifdef PLATFORM_UNIX
+#include <sys/stat.h>
+#endif
+
+#include <algorithm>
+#include <deque>
+#include <ios>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+/// \cond
+namespace {
+
+/*!
+ * \brief The DeviceQueue struct holds the files of a device which are still to be processed.
+ */
+struct DeviceQueue {
+    bool takeNext(std::size_t &index, bool &rewrite);
+
+    std::mutex lock;
+    std::deque<std::size_t> inPlaceJobs;
+    std::deque<std::size_t> rewriteJobs;
+};
+
+/*!
+ * \brief Takes the next file (preferring files which might still be modified in-place).
+ */
+bool DeviceQueue::takeNext(std::size_t &index, bool &rewrite)
+{
+    const auto guard = lock_guard<mutex>(lock);
+    auto &jobs = (rewrite = inPlaceJobs.empty()) ? rewriteJobs : inPlaceJobs;
+    if (jobs.empty()) {
+        return false;
+    }
+    index = jobs.front();
+    jobs.pop_front();
+    return true;
+}
+
+} // namespace
+/// \endcond
+
+/*!
+ * \class TagParser::BatchWriter
+ * \brief The BatchWriter class applies changes to many files concurrently while limiting the number of concurrent
+ *        writes per device.
+ *
+ * The files are grouped by the device they are stored on (see deviceId()). Each device is processed by up to
+ * writersPerDevice() writers; the writers of all devices run on the work-stealing thread pool also used by BatchParser
+ * (see BatchParser::runConcurrently()). So a library spread over a few slow disks and a fast SSD is written with the
+ * appropriate concurrency for each of them.
+ *
+ * Each file is processed as follows:
+ * 1. The file is parsed, the change callback is invoked and the changes are applied with MediaFileInfo::setForceInPlace()
+ *    enabled. This succeeds quickly if the changes fit into the padding of the file.
+ * 2. If the file would need to be rewritten (RewriteRequiredException), it is queued again behind all files of the same
+ *    device which have not been attempted yet. So cheap in-place edits finish first. When it is taken again, it is parsed
+ *    again, the change callback is invoked again and the changes are applied in the regular way.
+ *
+ * Files for which the setup callback enables MediaFileInfo::setForceRewrite() or sets a save file path are queued as
+ * rewrites right away; if it enables MediaFileInfo::setForceInPlace() they are never rewritten. Rewriting is disabled
+ * by default (in contrast to MediaFileInfo) as the purpose of this class is to avoid unnecessary rewrites.
+ *
+ * \remarks
+ * - Forcing the in-place attempt means padding limits (see MediaFileInfo::setMaxPadding()) are not enforced for files
+ *   modified in-place, like with MediaFileInfo::setForceInPlace().
+ * - The change callback might be invoked twice for the same file and must therefore set values rather than e.g.
+ *   appending them. It is invoked from the worker threads and must be thread-safe.
+ */
+
+/*!
+ * \brief Constructs an empty result.
+ */
+BatchWriterResult::BatchWriterResult()
+    : index(0)
+    , deviceId(0)
+    , rewritten(false)
+{
+}
+
+/*!
+ * \brief Constructs a new batch writer using the specified number of writers per device and threads.
+ * \remarks If \a parallelism is zero, one thread per writer is used.
+ */
+BatchWriter::BatchWriter(unsigned int writersPerDevice, unsigned int parallelism)
+    : m_writersPerDevice(writersPerDevice)
+    , m_parallelism(parallelism)
+    , m_aborted(false)
+{
+}
+
+/*!
+ * \brief Returns the ID of the device the file with the specified \a path is stored on.
+ * \remarks Returns zero on platforms where the device can not be determined or if the file can not be accessed (the
+ *          error is reported when the file is processed).
+ */
+std::uint64_t BatchWriter::deviceId(const std::string &path)
+{
+#ifdef PLATFORM_UNIX
+    struct stat status;
+    return ::stat(path.data(), &status) == 0 ? static_cast<std::uint64_t>(status.st_dev) : 0;
+#else
+    CPP_UTILITIES_UNUSED(path)
+    return 0;
+#endif
+}
+
+/*!
+ * \brief Applies the changes made by \a change to the files with the specified \a paths and invokes \a callback for
+ *        each of them.
+ *
+ * The function blocks until all files have been processed or processing has been aborted via abort(). The callback
+ * is invoked from the worker threads as soon as a file has been processed; so results are not necessarily reported
+ * in the order of \a paths (use BatchWriterResult::index to correlate them). Invocations of the callback are
+ * serialized, so the callback does not need to be thread-safe itself. It must not throw.
+ *
+ * Exceptions which abort processing a file (e.g. IO errors or exceptions thrown by \a change) are caught and stored in
+ * BatchWriterResult::exception.
+ */
+void BatchWriter::apply(const std::vector<std::string> &paths, const ChangeCallback &change, const ResultCallback &callback)
+{
+    m_aborted.store(false);
+
+    // group the files by device
+    auto results = vector<BatchWriterResult>(paths.size());
+    auto devices = vector<unique_ptr<DeviceQueue>>();
+    auto deviceIndices = unordered_map<std::uint64_t, std::size_t>();
+    for (size_t index = 0; index != paths.size(); ++index) {
+        auto &result = results[index];
+        result.index = index;
+        result.path = paths[index];
+        result.deviceId = deviceId(result.path);
+        const auto [deviceIndex, isNewDevice] = deviceIndices.emplace(result.deviceId, devices.size());
+        if (isNewDevice) {
+            devices.emplace_back(make_unique<DeviceQueue>());
+        }
+        devices[deviceIndex->second]->inPlaceJobs.emplace_back(index);
+    }
+
+    // create the writers; the first writers of all devices come first so all devices are served if parallelism is limited
+    auto writers = vector<DeviceQueue *>();
+    for (size_t writer = 0, writersPerDevice = max(1u, m_writersPerDevice); writer != writersPerDevice; ++writer) {
+        for (const auto &device : devices) {
+            if (device->inPlaceJobs.size() > writer) {
+                writers.emplace_back(device.get());
+            }
+        }
+    }
+
+    // run the writers; each writer processes files of its device until there are none left
+    auto callbackMutex = mutex();
+    const auto parallelism = m_parallelism ? m_parallelism : static_cast<unsigned int>(writers.size());
+    BatchParser::runConcurrently(writers.size(), parallelism, m_aborted, [&, this](size_t writer) {
+        auto &queue = *writers[writer];
+        auto fileInfo = MediaFileInfo();
+        auto index = size_t();
+        auto rewrite = false;
+        while (!m_aborted.load() && queue.takeNext(index, rewrite)) {
+            auto &result = results[index];
+            if (!writeFile(fileInfo, result, change, rewrite)) {
+                const auto guard = lock_guard<mutex>(queue.lock);
+                queue.rewriteJobs.emplace_back(index);
+                continue;
+            }
+            if (callback) {
+                const auto guard = lock_guard<mutex>(callbackMutex);
+                callback(result);
+            }
+        }
+    });
+}
+
+/*!
+ * \brief Applies the changes to the file specified within \a result using \a fileInfo and stores the outcome in \a result.
+ * \returns Returns false if the file needs to be rewritten but \a rewrite is not set; \a result is left untouched in this
+ *          case so the file can be processed again with \a rewrite set.
+ */
+bool BatchWriter::writeFile(MediaFileInfo &fileInfo, BatchWriterResult &result, const ChangeCallback &change, bool rewrite) const
+{
+    static const string context("batch writing");
+    auto forcingInPlace = false;
+    fileInfo.reset(result.path);
+    try {
+        fileInfo.setForceRewrite(false);
+        fileInfo.setForceInPlace(false);
+        if (m_setupCallback) {
+            m_setupCallback(fileInfo);
+        }
+        if (!rewrite && !(forcingInPlace = fileInfo.isForcingInPlace())) {
+            // don't bother parsing files which are going to be rewritten anyways
+            if (fileInfo.isForcingRewrite() || !fileInfo.saveFilePath().empty()) {
+                return false;
+            }
+            fileInfo.setForceInPlace(true);
+        }
+        fileInfo.open(false);
+        fileInfo.parseEverything(result.diag);
+        if (change) {
+            change(fileInfo, result.diag);
+        }
+        auto progress = AbortableProgressFeedback(AbortableProgressFeedback::Callback{});
+        fileInfo.applyChanges(result.diag, progress);
+        result.rewritten = rewrite;
+    } catch (const RewriteRequiredException &) {
+        if (!rewrite && !forcingInPlace) {
+            // discard the messages of this attempt as they will occur again when rewriting the file
+            result.diag.clear();
+            fileInfo.close();
+            return false;
+        }
+        result.exception = current_exception();
+    } catch (const std::ios_base::failure &failure) {
+        result.diag.emplace_back(DiagLevel::Critical, argsToString("An IO error occurred: ", failure.what()), context);
+        result.exception = current_exception();
+    } catch (...) {
+        result.exception = current_exception();
+    }
+    fileInfo.close();
+    return true;
+}
+
+} // namespace TagParser
@@ -0,0 +1,145 @@
+#ifndef TAG_PARSER_BATCHWRITER_H
+#define TAG_PARSER_BATCHWRITER_H
+
+#include "./diagnostics.h"
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace TagParser {
+
+class MediaFileInfo;
+
+/*!
+ * \brief The BatchWriterResult struct holds the result of applying changes to a single file via BatchWriter.
+ */
+struct TAG_PARSER_EXPORT BatchWriterResult {
+    BatchWriterResult();
+
+    /// \brief The index of the file within the list passed to BatchWriter::apply().
+    std::size_t index;
+    /// \brief The path of the file.
+    std::string path;
+    /// \brief The ID of the device the file is stored on (see BatchWriter::deviceId()).
+    std::uint64_t deviceId;
+    /// \brief Whether the file had to be rewritten (or a save file path has been set) so changes could not be applied in-place.
+    bool rewritten;
+    /// \brief The diagnostic messages which occurred when parsing the file and applying changes.
+    Diagnostics diag;
+    /// \brief The exception which aborted processing the file (e.g. an IO error) or nullptr if none occurred.
+    std::exception_ptr exception;
+};
+
+class TAG_PARSER_EXPORT BatchWriter {
+public:
+    /// \brief The callback invoked with each parsed file to make the changes which are supposed to be applied.
+    using ChangeCallback = std::function<void(MediaFileInfo &fileInfo, Diagnostics &diag)>;
+    /// \brief The callback invoked with the result of each processed file.
+    using ResultCallback = std::function<void(BatchWriterResult &result)>;
+    /// \brief The callback invoked to configure a MediaFileInfo object before it is parsed.
+    using SetupCallback = std::function<void(MediaFileInfo &fileInfo)>;
+
+    explicit BatchWriter(unsigned int writersPerDevice = 1, unsigned int parallelism = 0);
+
+    unsigned int writersPerDevice() const;
+    void setWritersPerDevice(unsigned int writersPerDevice);
+    unsigned int parallelism() const;
+    void setParallelism(unsigned int parallelism);
+    const SetupCallback &setupCallback() const;
+    void setSetupCallback(const SetupCallback &callback);
+
+    void apply(const std::vector<std::string> &paths, const ChangeCallback &change, const ResultCallback &callback);
+    void abort();
+    bool isAborted() const;
+
+    static std::uint64_t deviceId(const std::string &path);
+
+private:
+    bool writeFile(MediaFileInfo &fileInfo, BatchWriterResult &result, const ChangeCallback &change, bool rewrite) const;
+
+    unsigned int m_writersPerDevice;
+    unsigned int m_parallelism;
+    SetupCallback m_setupCallback;
+    std::atomic<bool> m_aborted;
+};
+
+/*!
+ * \brief Returns the number of files which are written concurrently on the same device.
+ */
+inline unsigned int BatchWriter::writersPerDevice() const
+{
+    return m_writersPerDevice;
+}
+
+/*!
+ * \brief Sets the number of files which are written concurrently on the same device.
+ *
+ * One writer per device avoids seek storms on spinning disks which handle concurrent rewrites of big files badly.
+ * SSDs and arrays usually benefit from several writers. A value of zero is treated like one.
+ */
+inline void BatchWriter::setWritersPerDevice(unsigned int writersPerDevice)
+{
+    m_writersPerDevice = writersPerDevice;
+}
+
+/*!
+ * \brief Returns the maximum number of threads used to process files (of all devices).
+ * \remarks A value of zero means one thread per writer is used (the number of devices times writersPerDevice()).
+ */
+inline unsigned int BatchWriter::parallelism() const
+{
+    return m_parallelism;
+}
+
+/*!
+ * \brief Sets the maximum number of threads used to process files (of all devices).
+ * \sa parallelism()
+ */
+inline void BatchWriter::setParallelism(unsigned int parallelism)
+{
+    m_parallelism = parallelism;
+}
+
+/*!
+ * \brief Returns the callback invoked to configure a MediaFileInfo object before it is parsed.
+ */
+inline const BatchWriter::SetupCallback &BatchWriter::setupCallback() const
+{
+    return m_setupCallback;
+}
+
+/*!
+ * \brief Sets the callback invoked to configure a MediaFileInfo object before it is parsed.
+ * \remarks The callback is invoked from the worker threads and must therefore be thread-safe. The MediaFileInfo objects
+ *          are re-used for several files via MediaFileInfo::reset() so the callback should apply every setting it
+ *          changes for each file.
+ */
+inline void BatchWriter::setSetupCallback(const SetupCallback &callback)
+{
+    m_setupCallback = callback;
+}
+
+/*!
+ * \brief Aborts applying changes. Files which are currently being written are still finished.
+ * \remarks May be called from any thread, e.g. from within the result callback.
+ */
+inline void BatchWriter::abort()
+{
+    m_aborted.store(true);
+}
+
+/*!
+ * \brief Returns whether applying changes has been aborted.
+ */
+inline bool BatchWriter::isAborted() const
+{
+    return m_aborted.load();
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_BATCHWRITER_H
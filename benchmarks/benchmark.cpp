@@ -0,0 +1,209 @@
+#include "./generator.h"
+
+#include "../diagnostics.h"
+#include "../mediafileinfo.h"
+#include "../progressfeedback.h"
+#include "../tag.h"
+
+#include <c++utilities/conversion/stringbuilder.h>
+#include <c++utilities/conversion/stringconversion.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace CppUtilities;
+using namespace TagParser;
+
+/*!
+ * \file benchmark.cpp
+ * \brief Times parsing and writing synthetic files of all supported container formats.
+ *
+ * The files are generated on the fly via SyntheticFiles::generate(). Their size is determined by the "scale" which
+ * specifies the number of clusters (Matroska), chunks (MP4), pages (Ogg) or blocks of frames (MP3, FLAC); each unit
+ * contains 64 KiB. The number of tracks, the tag and attachment sizes and the cue interval can be configured as well.
+ * Results are reported in files/s and MB/s, optionally as CSV so the numbers of different releases can be
+ * compared.
+ */
+
+namespace {
+
+constexpr std::size_t paddingSize = 0x1000;
+
+struct Options {
+    vector<std::size_t> scales = { 1, 16, 128 };
+    vector<string> formats;
+    SyntheticFiles::Options file;
+    string directory = ".";
+    double minTime = 0.5;
+    std::size_t minIterations = 3;
+    bool csv = false;
+};
+
+void printResult(const Options &options, const char *format, std::size_t scale, std::uint64_t fileSize, const char *operation,
+    std::size_t iterations, double seconds)
+{
+    const auto filesPerSecond = static_cast<double>(iterations) / seconds;
+    const auto megabytesPerSecond = filesPerSecond * static_cast<double>(fileSize) / 1000000.0;
+    if (options.csv) {
+        cout << format << ',' << scale << ',' << fileSize << ',' << operation << ',' << iterations << ',' << seconds << ',' << filesPerSecond
+             << ',' << megabytesPerSecond << '\n';
+        return;
+    }
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-9s %7zu %12llu  %-22s %8zu %12.1f %10.1f", format, scale, static_cast<unsigned long long>(fileSize),
+        operation, iterations, filesPerSecond, megabytesPerSecond);
+    cout << line << '\n';
+}
+
+void run(const Options &options, SyntheticFiles::Format format, std::size_t scale, std::uint64_t fileSize, const char *operation,
+    const std::function<void()> &routine)
+{
+    using Clock = chrono::steady_clock;
+    auto iterations = std::size_t();
+    const auto start = Clock::now();
+    auto seconds = 0.0;
+    do {
+        routine();
+        ++iterations;
+        seconds = chrono::duration<double>(Clock::now() - start).count();
+    } while (iterations < options.minIterations || seconds < options.minTime);
+    printResult(options, SyntheticFiles::formatName(format), scale, fileSize, operation, iterations, seconds);
+}
+
+void parse(const string &path, void (MediaFileInfo::*method)(Diagnostics &))
+{
+    auto diag = Diagnostics();
+    auto file = MediaFileInfo(path);
+    file.open(true);
+    file.parseContainerFormat(diag);
+    if (method) {
+        (file.*method)(diag);
+    }
+}
+
+void applyChanges(const string &path, bool forceRewrite, std::size_t iteration)
+{
+    auto diag = Diagnostics();
+    auto progress = AbortableProgressFeedback(AbortableProgressFeedback::Callback{});
+    auto file = MediaFileInfo(path);
+    file.open(false);
+    file.parseEverything(diag);
+    file.createAppropriateTags();
+    for (auto *const tag : file.tags()) {
+        tag->setValue(KnownField::Title, TagValue(argsToString("Benchmark ", iteration % 10), TagTextEncoding::Utf8));
+    }
+    file.setForceRewrite(forceRewrite);
+    file.setMinPadding(0);
+    file.setMaxPadding(paddingSize * 4);
+    file.setPreferredPadding(paddingSize);
+    file.applyChanges(diag, progress);
+    file.close();
+    if (forceRewrite) {
+        std::remove((path + ".bak").data());
+    }
+}
+
+void benchmark(const Options &options, SyntheticFiles::Format format, std::size_t scale)
+{
+    const auto path = argsToString(options.directory, "/tagparser_bench_", SyntheticFiles::formatName(format), '_', scale, '.',
+        SyntheticFiles::fileExtension(format));
+    auto fileOptions = options.file;
+    fileOptions.units = scale;
+    fileOptions.paddingSize = paddingSize;
+    const auto fileSize = SyntheticFiles::generate(format, fileOptions, path);
+    run(options, format, scale, fileSize, "parseContainerFormat", [&] { parse(path, nullptr); });
+    run(options, format, scale, fileSize, "parseTags", [&] { parse(path, &MediaFileInfo::parseTags); });
+    run(options, format, scale, fileSize, "parseTracks", [&] { parse(path, &MediaFileInfo::parseTracks); });
+    run(options, format, scale, fileSize, "parseEverything", [&] { parse(path, &MediaFileInfo::parseEverything); });
+    auto iteration = std::size_t();
+    run(options, format, scale, fileSize, "applyChanges (padding)", [&] { applyChanges(path, false, ++iteration); });
+    run(options, format, scale, fileSize, "applyChanges (rewrite)", [&] { applyChanges(path, true, ++iteration); });
+    std::remove(path.data());
+}
+
+void printUsage(const char *executable)
+{
+    cerr << "Usage: " << executable << " [--scales 1,16,128] [--formats mkv,mp4,ogg,mp3,flac] [--dir .] [--min-time 0.5] [--min-iterations 3] [--csv]\n"
+         << "       [--tracks 1] [--tag-size 0] [--attachment-size 0] [--cue-interval 0] [--no-sparse]\n"
+         << "Times parsing and writing synthetic files. The scale specifies the number of 64 KiB clusters/chunks/pages per file.\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    auto options = Options();
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const auto arg = string_view(argv[i]);
+            const auto value = [&] {
+                if (++i >= argc) {
+                    throw runtime_error(argsToString("missing value for ", arg));
+                }
+                return string(argv[i]);
+            };
+            if (arg == "--scales") {
+                options.scales.clear();
+                for (const auto &scale : splitString<vector<string>>(value(), ",", EmptyPartsTreat::Omit)) {
+                    options.scales.emplace_back(stringToNumber<std::size_t>(scale));
+                }
+            } else if (arg == "--formats") {
+                options.formats = splitString<vector<string>>(value(), ",", EmptyPartsTreat::Omit);
+            } else if (arg == "--dir") {
+                options.directory = value();
+            } else if (arg == "--min-time") {
+                options.minTime = stod(value());
+            } else if (arg == "--min-iterations") {
+                options.minIterations = stringToNumber<std::size_t>(value());
+            } else if (arg == "--tracks") {
+                options.file.trackCount = stringToNumber<std::size_t>(value());
+            } else if (arg == "--tag-size") {
+                options.file.tagSize = stringToNumber<std::size_t>(value());
+            } else if (arg == "--attachment-size") {
+                options.file.attachmentSize = stringToNumber<std::uint64_t>(value());
+            } else if (arg == "--cue-interval") {
+                options.file.cueInterval = stringToNumber<std::uint64_t>(value());
+            } else if (arg == "--no-sparse") {
+                options.file.sparse = false;
+            } else if (arg == "--csv") {
+                options.csv = true;
+            } else {
+                printUsage(argv[0]);
+                return arg == "--help" || arg == "-h" ? 0 : 1;
+            }
+        }
+    } catch (const exception &error) {
+        cerr << "Invalid arguments: " << error.what() << '\n';
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (options.csv) {
+        cout << "format,scale,size,operation,iterations,seconds,files_per_second,mb_per_second\n";
+    } else {
+        cout << "format      scale         size  operation              iterations      files/s       MB/s\n";
+    }
+    try {
+        for (const auto format : { SyntheticFiles::Format::Matroska, SyntheticFiles::Format::Mp4, SyntheticFiles::Format::Ogg,
+                 SyntheticFiles::Format::Mp3, SyntheticFiles::Format::Flac }) {
+            if (!options.formats.empty()
+                && find(options.formats.cbegin(), options.formats.cend(), SyntheticFiles::formatName(format)) == options.formats.cend()) {
+                continue;
+            }
+            for (const auto scale : options.scales) {
+                benchmark(options, format, scale);
+            }
+        }
+    } catch (const std::exception &error) {
+        cerr << "Benchmark failed: " << error.what() << '\n';
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include "./generator.h"
+
+#include <c++utilities/conversion/stringbuilder.h>
+#include <c++utilities/conversion/stringconversion.h>
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using namespace CppUtilities;
+using namespace TagParser;
+
+/*!
+ * \file generate.cpp
+ * \brief Generates a synthetic file of one of the container formats used by the benchmark.
+ *
+ * This allows running the benchmark or other tools on big files (e.g. 10 to 100 GB) which are reproducible from the
+ * command-line arguments and therefore don't need to be stored.
+ */
+
+namespace {
+
+/*!
+ * \brief Parses a size with an optional binary suffix (K, M, G or T).
+ */
+std::uint64_t parseSize(const string &size)
+{
+    if (size.empty()) {
+        throw runtime_error("empty size");
+    }
+    auto factor = std::uint64_t(1);
+    switch (size.back()) {
+    case 'T':
+        factor <<= 10;
+        [[fallthrough]];
+    case 'G':
+        factor <<= 10;
+        [[fallthrough]];
+    case 'M':
+        factor <<= 10;
+        [[fallthrough]];
+    case 'K':
+        factor <<= 10;
+        return stringToNumber<std::uint64_t>(size.substr(0, size.size() - 1)) * factor;
+    default:
+        return stringToNumber<std::uint64_t>(size);
+    }
+}
+
+void printUsage(const char *executable)
+{
+    cerr << "Usage: " << executable << " --format mkv|mp4|ogg|mp3|flac --output path [--units 1 | --size 10G] [--unit-size 64K]\n"
+         << "       [--tracks 1] [--tag-size 0] [--attachment-size 0] [--cue-interval 0] [--padding 4K] [--no-sparse]\n"
+         << "Generates a synthetic file consisting of the specified number of clusters/chunks/pages. The media data is\n"
+         << "zero-filled and written as hole unless --no-sparse is specified.\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    auto options = SyntheticFiles::Options();
+    auto format = SyntheticFiles::Format::Matroska;
+    auto hasFormat = false;
+    auto path = string();
+    auto size = std::uint64_t();
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const auto arg = string_view(argv[i]);
+            const auto value = [&] {
+                if (++i >= argc) {
+                    throw runtime_error(argsToString("missing value for ", arg));
+                }
+                return string(argv[i]);
+            };
+            if (arg == "--format") {
+                if (!(hasFormat = SyntheticFiles::formatFromName(value(), format))) {
+                    throw runtime_error(argsToString("unknown format ", argv[i]));
+                }
+            } else if (arg == "--output") {
+                path = value();
+            } else if (arg == "--units") {
+                options.units = stringToNumber<std::uint64_t>(value());
+            } else if (arg == "--size") {
+                size = parseSize(value());
+            } else if (arg == "--unit-size") {
+                options.unitSize = parseSize(value());
+            } else if (arg == "--tracks") {
+                options.trackCount = stringToNumber<std::size_t>(value());
+            } else if (arg == "--tag-size") {
+                options.tagSize = static_cast<std::size_t>(parseSize(value()));
+            } else if (arg == "--attachment-size") {
+                options.attachmentSize = parseSize(value());
+            } else if (arg == "--cue-interval") {
+                options.cueInterval = stringToNumber<std::uint64_t>(value());
+            } else if (arg == "--padding") {
+                options.paddingSize = static_cast<std::size_t>(parseSize(value()));
+            } else if (arg == "--no-sparse") {
+                options.sparse = false;
+            } else {
+                printUsage(argv[0]);
+                return arg == "--help" || arg == "-h" ? 0 : 1;
+            }
+        }
+        if (!hasFormat || path.empty()) {
+            throw runtime_error("format and output path are required");
+        }
+    } catch (const exception &error) {
+        cerr << "Invalid arguments: " << error.what() << '\n';
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (size && options.unitSize) {
+        options.units = max<std::uint64_t>(1, size / options.unitSize);
+    }
+    try {
+        const auto fileSize = SyntheticFiles::generate(format, options, path);
+        cout << "Generated " << path << " (" << SyntheticFiles::formatName(format) << ", " << options.units << " units, " << fileSize
+             << " bytes)\n";
+    } catch (const std::exception &error) {
+        cerr << "Unable to generate file: " << error.what() << '\n';
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,764 @@
+#include "./generator.h"
+
+#include "../base64.h"
+#include "../matroska/ebmlelement.h"
+#include "../matroska/ebmlid.h"
+#include "../matroska/matroskaid.h"
+#include "../ogg/oggpage.h"
+
+#include <c++utilities/conversion/binaryconversion.h>
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+namespace SyntheticFiles {
+
+/// \cond
+namespace {
+
+constexpr auto appName = "tagparser_generator";
+constexpr std::uint64_t sparseThreshold = 0x1000;
+
+/*!
+ * \brief The Output class writes a synthetic file; zero-filled regions are skipped if sparse files are requested.
+ */
+class Output {
+public:
+    explicit Output(const std::string &path, bool sparse);
+    void write(const char *data, std::size_t size);
+    void write(const std::string &data);
+    void skip(std::uint64_t size);
+    std::uint64_t finish();
+
+private:
+    void writeZeros();
+
+    std::ofstream m_stream;
+    std::uint64_t m_size;
+    std::uint64_t m_zeros;
+    bool m_sparse;
+};
+
+Output::Output(const std::string &path, bool sparse)
+    : m_size(0)
+    , m_zeros(0)
+    , m_sparse(sparse)
+{
+    m_stream.exceptions(ios_base::failbit | ios_base::badbit);
+    m_stream.open(path, ios_base::out | ios_base::trunc | ios_base::binary);
+}
+
+void Output::write(const char *data, std::size_t size)
+{
+    writeZeros();
+    m_stream.write(data, static_cast<streamsize>(size));
+    m_size += size;
+}
+
+void Output::write(const std::string &data)
+{
+    write(data.data(), data.size());
+}
+
+/*!
+ * \brief Appends \a size zero bytes (written lazily so consecutive calls are merged into one hole).
+ */
+void Output::skip(std::uint64_t size)
+{
+    m_zeros += size;
+    m_size += size;
+}
+
+void Output::writeZeros()
+{
+    if (!m_zeros) {
+        return;
+    }
+    if (m_sparse && m_zeros >= sparseThreshold) {
+        m_stream.seekp(static_cast<streamoff>(m_zeros), ios_base::cur);
+    } else {
+        static const char zeros[0x1000] = {};
+        for (auto remaining = m_zeros; remaining;) {
+            const auto chunkSize = min<std::uint64_t>(remaining, sizeof(zeros));
+            m_stream.write(zeros, static_cast<streamsize>(chunkSize));
+            remaining -= chunkSize;
+        }
+    }
+    m_zeros = 0;
+}
+
+/*!
+ * \brief Writes pending zeros, closes the file and returns its size.
+ */
+std::uint64_t Output::finish()
+{
+    // seeking alone does not extend the file so the last byte of a trailing hole needs to be written
+    if (m_zeros) {
+        --m_zeros;
+        --m_size;
+        write("\0", 1);
+    }
+    m_stream.close();
+    return m_size;
+}
+
+// helpers for writing big-endian/little-endian integers to a string
+
+void appendBE(string &out, std::uint64_t value, unsigned int bytes)
+{
+    while (bytes--) {
+        out.push_back(static_cast<char>((value >> (bytes * 8)) & 0xFF));
+    }
+}
+
+void appendLE(string &out, std::uint64_t value, unsigned int bytes)
+{
+    for (unsigned int i = 0; i != bytes; ++i) {
+        out.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+    }
+}
+
+void appendSynchsafe(string &out, std::uint64_t value)
+{
+    for (int shift = 21; shift >= 0; shift -= 7) {
+        out.push_back(static_cast<char>((value >> shift) & 0x7F));
+    }
+}
+
+// Matroska
+
+string ebmlHeader(std::uint64_t id, std::uint64_t size)
+{
+    char buffer[16];
+    auto header = string(buffer, EbmlElement::makeId(static_cast<EbmlElement::IdentifierType>(id), buffer));
+    header.append(buffer, EbmlElement::makeSizeDenotation(size, buffer));
+    return header;
+}
+
+/*!
+ * \brief Returns an element with the specified \a content which is followed by \a trailingSize bytes written separately.
+ */
+string ebml(std::uint64_t id, const string &content, std::uint64_t trailingSize = 0)
+{
+    return ebmlHeader(id, content.size() + trailingSize) + content;
+}
+
+string ebmlUInt(std::uint64_t id, std::uint64_t value)
+{
+    char buffer[8];
+    return ebml(id, string(buffer, EbmlElement::makeUInteger(value, buffer)));
+}
+
+string ebmlFloat(std::uint64_t id, double value)
+{
+    char buffer[8];
+    BE::getBytes(value, buffer);
+    return ebml(id, string(buffer, sizeof(buffer)));
+}
+
+string ebmlVoid(std::size_t totalSize)
+{
+    if (totalSize < 9) {
+        return string();
+    }
+    char buffer[16];
+    auto element = string(1, static_cast<char>(EbmlIds::Void));
+    const auto contentSize = totalSize - 1 - 8;
+    element.append(buffer, EbmlElement::makeSizeDenotation(contentSize, buffer, 8));
+    element.append(contentSize, '\0');
+    return element;
+}
+
+void generateMatroska(const Options &options, Output &output)
+{
+    using namespace MatroskaIds;
+    const auto header = ebml(EbmlIds::Header,
+        ebmlUInt(EbmlIds::Version, 1) + ebmlUInt(EbmlIds::ReadVersion, 1) + ebmlUInt(EbmlIds::MaxIdLength, 4)
+            + ebmlUInt(EbmlIds::MaxSizeLength, 8) + ebml(EbmlIds::DocType, "matroska") + ebmlUInt(EbmlIds::DocTypeVersion, 4)
+            + ebmlUInt(EbmlIds::DocTypeReadVersion, 2));
+
+    // make the elements in front of the clusters
+    auto head = ebml(SegmentInfo,
+        ebmlUInt(TimeCodeScale, 1000000) + ebmlFloat(Duration, static_cast<double>(options.units * 1000)) + ebml(MuxingApp, appName)
+            + ebml(WrittingApp, appName));
+    auto trackEntries = string();
+    for (std::size_t track = 1; track <= options.trackCount; ++track) {
+        trackEntries += ebml(TrackEntry,
+            ebmlUInt(TrackNumber, track) + ebmlUInt(TrackUID, track) + ebmlUInt(TrackType, MatroskaTrackType::Audio) + ebml(CodecID, "A_PCM/INT/LIT")
+                + ebml(TrackAudio, ebmlFloat(SamplingFrequency, 48000.0) + ebmlUInt(Channels, 2) + ebmlUInt(BitDepth, 16)));
+    }
+    head += ebml(Tracks, trackEntries);
+    auto simpleTags = ebml(SimpleTag, ebml(TagName, "TITLE") + ebml(TagString, "Synthetic"));
+    if (options.tagSize) {
+        simpleTags += ebml(SimpleTag, ebml(TagName, "COMMENT") + ebml(TagString, string(options.tagSize, 'x')));
+    }
+    head += ebml(MatroskaIds::Tags, ebml(MatroskaIds::Tag, ebml(Targets, ebmlUInt(TargetTypeValue, 50)) + simpleTags));
+    auto attachments = string();
+    if (options.attachmentSize) {
+        const auto attachedFile = ebml(FileName, "cover.jpg") + ebml(FileMimeType, "image/jpeg") + ebmlUInt(FileUID, 1)
+            + ebmlHeader(FileData, options.attachmentSize);
+        attachments = ebml(Attachments, ebml(AttachedFile, attachedFile, options.attachmentSize), options.attachmentSize);
+    }
+    const auto padding = ebmlVoid(options.paddingSize);
+
+    // determine the size of the clusters and the positions of the cue points
+    const auto blocksPerCluster = max<std::uint64_t>(4, options.trackCount);
+    const auto blockSize = options.unitSize / blocksPerCluster;
+    const auto blockHeaderSize = ebmlHeader(SimpleBlock, blockSize).size();
+    const auto clusterContentSize
+        = [&](std::uint64_t cluster) { return ebmlUInt(Timecode, cluster * 1000).size() + blocksPerCluster * (blockHeaderSize + blockSize); };
+    const auto firstClusterPosition = head.size() + attachments.size() + options.attachmentSize + padding.size();
+    auto cuePoints = string();
+    auto clustersSize = std::uint64_t();
+    for (std::uint64_t cluster = 0; cluster != options.units; ++cluster) {
+        if (options.cueInterval && !(cluster % options.cueInterval)) {
+            cuePoints += ebml(CuePoint,
+                ebmlUInt(CueTime, cluster * 1000)
+                    + ebml(CueTrackPositions, ebmlUInt(CueTrack, 1) + ebmlUInt(CueClusterPosition, firstClusterPosition + clustersSize)));
+        }
+        const auto contentSize = clusterContentSize(cluster);
+        clustersSize += ebmlHeader(Cluster, contentSize).size() + contentSize;
+    }
+    const auto cues = cuePoints.empty() ? string() : ebml(Cues, cuePoints);
+
+    // write the file; the blocks are assigned to the tracks in turn
+    auto blockHeaders = vector<string>();
+    for (std::size_t track = 1; track <= options.trackCount; ++track) {
+        auto &blockHeader = blockHeaders.emplace_back(ebmlHeader(SimpleBlock, blockSize));
+        blockHeader.push_back(static_cast<char>(0x80 | track));
+        blockHeader.append("\x00\x00\x80", 3);
+    }
+    output.write(header);
+    output.write(ebmlHeader(Segment, firstClusterPosition + clustersSize + cues.size()));
+    output.write(head);
+    output.write(attachments);
+    output.skip(options.attachmentSize);
+    output.write(padding);
+    for (std::uint64_t cluster = 0; cluster != options.units; ++cluster) {
+        output.write(ebmlHeader(Cluster, clusterContentSize(cluster)) + ebmlUInt(Timecode, cluster * 1000));
+        for (std::uint64_t block = 0; block != blocksPerCluster; ++block) {
+            output.write(blockHeaders[block % blockHeaders.size()]);
+            output.skip(blockSize - 4);
+        }
+    }
+    output.write(cues);
+}
+
+// MP4
+
+string atomHeader(const char *type, std::uint64_t contentSize)
+{
+    auto header = string();
+    if (contentSize + 8 > numeric_limits<std::uint32_t>::max()) {
+        appendBE(header, 1, 4);
+        header.append(type, 4);
+        appendBE(header, contentSize + 16, 8);
+    } else {
+        appendBE(header, contentSize + 8, 4);
+        header.append(type, 4);
+    }
+    return header;
+}
+
+/*!
+ * \brief Returns an atom with the specified \a content which is followed by \a trailingSize bytes written separately.
+ */
+string atom(const char *type, const string &content, std::uint64_t trailingSize = 0)
+{
+    return atomHeader(type, content.size() + trailingSize) + content;
+}
+
+string fullAtom(const char *type, std::uint32_t versionAndFlags, const string &content, std::uint64_t trailingSize = 0)
+{
+    auto prefixed = string();
+    appendBE(prefixed, versionAndFlags, 4);
+    return atom(type, prefixed + content, trailingSize);
+}
+
+string ilstItem(const char *type, std::uint32_t dataType, const string &value, std::uint64_t trailingSize = 0)
+{
+    auto data = string();
+    appendBE(data, dataType, 4);
+    appendBE(data, 0, 4); // locale
+    return atom(type, atom("data", data + value, trailingSize), trailingSize);
+}
+
+/*!
+ * \brief Returns the "moov"-atom; the data of the cover is supposed to be written separately after it.
+ * \remarks The chunks are assigned to the tracks in turn.
+ */
+string makeMp4Moov(const Options &options, std::uint64_t mdatDataOffset, bool co64)
+{
+    constexpr std::uint32_t timeScale = 44100, samplesPerChunk = 16;
+    const auto sampleSize = static_cast<std::uint32_t>(options.unitSize / samplesPerChunk);
+    const auto chunkCount = [&](std::size_t track) { return (options.units + options.trackCount - 1 - track) / options.trackCount; };
+    const auto duration = [&](std::size_t track) { return chunkCount(track) * samplesPerChunk * 1024; };
+    auto matrix = string();
+    for (const auto value : { 0x00010000u, 0u, 0u, 0u, 0x00010000u, 0u, 0u, 0u, 0x40000000u }) {
+        appendBE(matrix, value, 4);
+    }
+
+    auto mvhd = string();
+    appendBE(mvhd, 0, 8); // creation and modification time
+    appendBE(mvhd, timeScale, 4);
+    appendBE(mvhd, duration(0), 4);
+    appendBE(mvhd, 0x00010000, 4); // rate
+    appendBE(mvhd, 0x0100, 2); // volume
+    mvhd.append(10, '\0');
+    mvhd += matrix;
+    mvhd.append(24, '\0');
+    appendBE(mvhd, options.trackCount + 1, 4); // next track ID
+    auto moov = fullAtom("mvhd", 0, mvhd);
+
+    for (std::size_t track = 0; track != options.trackCount; ++track) {
+        auto tkhd = string();
+        appendBE(tkhd, 0, 8); // creation and modification time
+        appendBE(tkhd, track + 1, 4); // track ID
+        appendBE(tkhd, 0, 4);
+        appendBE(tkhd, duration(track), 4);
+        tkhd.append(8, '\0');
+        appendBE(tkhd, 0, 4); // layer and alternate group
+        appendBE(tkhd, 0x0100, 2); // volume
+        appendBE(tkhd, 0, 2);
+        tkhd += matrix;
+        appendBE(tkhd, 0, 8); // width and height
+
+        auto mdhd = string();
+        appendBE(mdhd, 0, 8); // creation and modification time
+        appendBE(mdhd, timeScale, 4);
+        appendBE(mdhd, duration(track), 4);
+        appendBE(mdhd, 0x55C4, 2); // "und"
+        appendBE(mdhd, 0, 2);
+
+        auto hdlr = string();
+        appendBE(hdlr, 0, 4);
+        hdlr.append("soun");
+        hdlr.append(12, '\0');
+        hdlr.append("SoundHandler", 13);
+
+        auto mp4a = string(6, '\0');
+        appendBE(mp4a, 1, 2); // data reference index
+        appendBE(mp4a, 0, 8); // version, revision and vendor
+        appendBE(mp4a, 2, 2); // channels
+        appendBE(mp4a, 16, 2); // sample size
+        appendBE(mp4a, 0, 4); // compression ID and packet size
+        appendBE(mp4a, static_cast<std::uint64_t>(timeScale) << 16, 4);
+        auto stsd = string();
+        appendBE(stsd, 1, 4);
+        stsd += atom("mp4a", mp4a);
+
+        const auto sampleCount = chunkCount(track) * samplesPerChunk;
+        auto stts = string();
+        appendBE(stts, 1, 4);
+        appendBE(stts, sampleCount, 4);
+        appendBE(stts, 1024, 4);
+        auto stsc = string();
+        appendBE(stsc, 1, 4);
+        appendBE(stsc, 1, 4);
+        appendBE(stsc, samplesPerChunk, 4);
+        appendBE(stsc, 1, 4);
+        auto stsz = string();
+        appendBE(stsz, sampleSize, 4);
+        appendBE(stsz, sampleCount, 4);
+        auto stco = string();
+        appendBE(stco, chunkCount(track), 4);
+        for (auto chunk = static_cast<std::uint64_t>(track); chunk < options.units; chunk += options.trackCount) {
+            appendBE(stco, mdatDataOffset + chunk * options.unitSize, co64 ? 8 : 4);
+        }
+
+        auto dref = string();
+        appendBE(dref, 1, 4);
+        dref += fullAtom("url ", 1, string());
+        const auto stbl = atom("stbl",
+            fullAtom("stsd", 0, stsd) + fullAtom("stts", 0, stts) + fullAtom("stsc", 0, stsc) + fullAtom("stsz", 0, stsz)
+                + fullAtom(co64 ? "co64" : "stco", 0, stco));
+        const auto minf = atom("minf", fullAtom("smhd", 0, string(4, '\0')) + atom("dinf", fullAtom("dref", 0, dref)) + stbl);
+        moov += atom("trak", fullAtom("tkhd", 0x000007, tkhd) + atom("mdia", fullAtom("mdhd", 0, mdhd) + fullAtom("hdlr", 0, hdlr) + minf));
+    }
+
+    // add the tag as last atom so the data of the cover can be written separately
+    auto metaHdlr = string();
+    appendBE(metaHdlr, 0, 4);
+    metaHdlr.append("mdirappl");
+    metaHdlr.append(9, '\0');
+    auto items = ilstItem("\xA9nam", 1, "Synthetic");
+    if (options.tagSize) {
+        items += ilstItem("\xA9"
+                          "cmt",
+            1, string(options.tagSize, 'x'));
+    }
+    if (options.attachmentSize) {
+        items += ilstItem("covr", 13, string(), options.attachmentSize);
+    }
+    const auto meta = fullAtom("meta", 0, fullAtom("hdlr", 0, metaHdlr) + atom("ilst", items, options.attachmentSize), options.attachmentSize);
+    moov += atom("udta", meta, options.attachmentSize);
+    return atom("moov", moov, options.attachmentSize);
+}
+
+void generateMp4(const Options &options, Output &output)
+{
+    auto ftypContent = string("M4A ");
+    appendBE(ftypContent, 0, 4);
+    ftypContent.append("M4A mp42isom");
+    const auto ftyp = atom("ftyp", ftypContent);
+    const auto free = options.paddingSize >= 8 ? atom("free", string(options.paddingSize - 8, '\0')) : string();
+    const auto mediaDataSize = options.units * options.unitSize;
+    const auto mdatHeader = atomHeader("mdat", mediaDataSize);
+    const auto moovSize = [&](bool co64) { return makeMp4Moov(options, 0, co64).size() + options.attachmentSize; };
+    const auto co64 = ftyp.size() + moovSize(false) + free.size() + mdatHeader.size() + mediaDataSize > numeric_limits<std::uint32_t>::max();
+    const auto mdatDataOffset = ftyp.size() + moovSize(co64) + free.size() + mdatHeader.size();
+    output.write(ftyp);
+    output.write(makeMp4Moov(options, mdatDataOffset, co64));
+    output.skip(options.attachmentSize);
+    output.write(free);
+    output.write(mdatHeader);
+    output.skip(mediaDataSize);
+}
+
+// Vorbis comments and FLAC pictures (used by Ogg and FLAC)
+
+/*!
+ * \brief Returns the FLAC picture block for a cover of \a dataSize bytes without the data itself.
+ */
+string makeFlacPictureHeader(std::uint64_t dataSize)
+{
+    auto picture = string();
+    appendBE(picture, 3, 4); // front cover
+    appendBE(picture, 10, 4);
+    picture.append("image/jpeg");
+    appendBE(picture, 0, 4); // description
+    picture.append(16, '\0'); // width, height, color depth and number of colors
+    appendBE(picture, dataSize, 4);
+    return picture;
+}
+
+string makeVorbisComment(const Options &options, const string &encodedCover)
+{
+    auto fields = vector<string>{ "TITLE=Synthetic" };
+    if (options.tagSize) {
+        fields.emplace_back("COMMENT=" + string(options.tagSize, 'x'));
+    }
+    if (!encodedCover.empty()) {
+        fields.emplace_back("METADATA_BLOCK_PICTURE=" + encodedCover);
+    }
+    auto comment = string();
+    appendLE(comment, char_traits<char>::length(appName), 4);
+    comment.append(appName);
+    appendLE(comment, fields.size(), 4);
+    for (const auto &field : fields) {
+        appendLE(comment, field.size(), 4);
+        comment += field;
+    }
+    return comment;
+}
+
+// Ogg (Opus)
+
+constexpr std::size_t maxOggPageDataSize = 255 * 255;
+
+string makeOggPageHeader(std::uint8_t flags, std::uint64_t granulePosition, std::uint32_t serialNumber, std::uint32_t sequenceNumber,
+    std::size_t dataSize, bool packetComplete)
+{
+    auto page = string("OggS\0", 5);
+    page.push_back(static_cast<char>(flags));
+    appendLE(page, granulePosition, 8);
+    appendLE(page, serialNumber, 4);
+    appendLE(page, sequenceNumber, 4);
+    appendLE(page, 0, 4); // checksum
+    const auto segmentCount = dataSize / 255 + (packetComplete ? 1 : 0);
+    page.push_back(static_cast<char>(segmentCount));
+    page.append(dataSize / 255, static_cast<char>(255));
+    if (packetComplete) {
+        page.push_back(static_cast<char>(dataSize % 255));
+    }
+    return page;
+}
+
+/*!
+ * \brief Writes \a packet as the only packet of one or more pages (if it does not fit into a single page).
+ */
+void writeOggPacket(Output &output, std::uint32_t serialNumber, std::uint32_t &sequenceNumber, std::uint8_t flags, const string &packet)
+{
+    for (std::size_t offset = 0;;) {
+        const auto remaining = packet.size() - offset;
+        const auto complete = remaining < maxOggPageDataSize;
+        const auto dataSize = complete ? remaining : maxOggPageDataSize;
+        auto page = makeOggPageHeader(flags, complete ? 0 : numeric_limits<std::uint64_t>::max(), serialNumber, sequenceNumber++, dataSize, complete);
+        page.append(packet, offset, dataSize);
+        LE::getBytes(OggPage::computeChecksum(page.data()), page.data() + 22);
+        output.write(page);
+        if (complete) {
+            return;
+        }
+        offset += dataSize;
+        flags = 0x01; // continued packet
+    }
+}
+
+/*!
+ * \brief Returns \a checksum adjusted for XOR-ing \a delta into the 4 bytes at \a offset of a page of \a totalSize bytes.
+ * \remarks OggPage::computeChecksumForSequenceNumber() does this for the sequence number at offset 18; the size is shifted
+ *          accordingly so it can be used for any other field.
+ */
+std::uint32_t adjustOggChecksum(std::uint32_t checksum, std::uint32_t offset, std::uint32_t delta, std::uint32_t totalSize)
+{
+    return delta ? OggPage::computeChecksumForSequenceNumber(checksum, 0, delta, totalSize + 18 - offset) : checksum;
+}
+
+void generateOgg(const Options &options, Output &output)
+{
+    const auto streamCount = static_cast<std::uint32_t>(options.trackCount);
+    auto sequenceNumbers = vector<std::uint32_t>(streamCount);
+    for (std::uint32_t stream = 0; stream != streamCount; ++stream) {
+        auto head = string("OpusHead");
+        head.push_back(1); // version
+        head.push_back(2); // channels
+        appendLE(head, 312, 2); // pre-skip
+        appendLE(head, 48000, 4);
+        appendLE(head, 0, 2); // output gain
+        head.push_back(0); // mapping family
+        writeOggPacket(output, stream + 1, sequenceNumbers[stream], 0x02, head);
+    }
+    auto encodedCover = string();
+    if (options.attachmentSize) {
+        auto picture = makeFlacPictureHeader(options.attachmentSize);
+        picture.append(options.attachmentSize, '\0');
+        encodedCover = Base64::encode(reinterpret_cast<const std::uint8_t *>(picture.data()), picture.size());
+    }
+    for (std::uint32_t stream = 0; stream != streamCount; ++stream) {
+        auto tags = string("OpusTags");
+        tags += stream ? makeVorbisComment(Options(), string()) : makeVorbisComment(options, encodedCover);
+        tags.append(options.paddingSize, '\0');
+        writeOggPacket(output, stream + 1, sequenceNumbers[stream], 0x00, tags);
+    }
+
+    // use packets of less than 255 segments so each one fits into a single page
+    constexpr std::size_t maxPacketSize = maxOggPageDataSize - 1;
+    const auto pagesPerUnit = static_cast<std::size_t>((options.unitSize + maxPacketSize - 1) / maxPacketSize);
+    const auto packetSize = static_cast<std::size_t>(options.unitSize / pagesPerUnit);
+
+    // compute the checksum of a zero-filled template page for each stream; the pages only differ in the flags, granule
+    // position and sequence number so the checksum of each page is derived from it (the CRC used by Ogg is linear)
+    auto templates = vector<pair<string, std::uint32_t>>();
+    for (std::uint32_t stream = 0; stream != streamCount; ++stream) {
+        auto page = makeOggPageHeader(0, 0, stream + 1, 0, packetSize, true);
+        const auto headerSize = page.size();
+        page.append(packetSize, '\0');
+        const auto checksum = OggPage::computeChecksum(page.data());
+        page.resize(headerSize);
+        templates.emplace_back(std::move(page), checksum);
+    }
+    const auto totalPageSize = static_cast<std::uint32_t>(templates.front().first.size() + packetSize);
+
+    auto pageCounts = vector<std::uint64_t>(streamCount);
+    for (std::uint64_t unit = 0; unit != options.units; ++unit) {
+        const auto stream = static_cast<std::uint32_t>(unit % streamCount);
+        auto &[page, templateChecksum] = templates[stream];
+        for (std::size_t i = 0; i != pagesPerUnit; ++i) {
+            const auto flags = static_cast<std::uint8_t>(unit + streamCount >= options.units && i + 1 == pagesPerUnit ? 0x04 : 0x00);
+            const auto granulePosition = ++pageCounts[stream] * 960;
+            const auto sequenceNumber = sequenceNumbers[stream]++;
+            auto checksum = adjustOggChecksum(templateChecksum, 5, flags, totalPageSize);
+            checksum = adjustOggChecksum(checksum, 6, static_cast<std::uint32_t>(granulePosition), totalPageSize);
+            checksum = adjustOggChecksum(checksum, 10, static_cast<std::uint32_t>(granulePosition >> 32), totalPageSize);
+            checksum = adjustOggChecksum(checksum, 18, sequenceNumber, totalPageSize);
+            page[5] = static_cast<char>(flags);
+            LE::getBytes(granulePosition, page.data() + 6);
+            LE::getBytes(sequenceNumber, page.data() + 18);
+            LE::getBytes(checksum, page.data() + 22);
+            output.write(page);
+            output.skip(packetSize);
+        }
+    }
+}
+
+// MP3 with ID3v2 tag
+
+string makeId3v2FrameHeader(const char *id, std::uint64_t size)
+{
+    auto header = string(id, 4);
+    appendSynchsafe(header, size);
+    appendBE(header, 0, 2); // flags
+    return header;
+}
+
+void generateMp3(const Options &options, Output &output)
+{
+    auto frames = string();
+    const auto title = string("\x03"
+                              "Synthetic");
+    frames += makeId3v2FrameHeader("TIT2", title.size()) + title;
+    if (options.tagSize) {
+        const auto comment = string("\x03"
+                                    "eng\0",
+                                 5)
+            + string(options.tagSize, 'x');
+        frames += makeId3v2FrameHeader("COMM", comment.size()) + comment;
+    }
+    if (options.attachmentSize) {
+        const auto picture = string("\x00image/jpeg\x00\x03\x00", 14);
+        frames += makeId3v2FrameHeader("APIC", picture.size() + options.attachmentSize) + picture;
+    }
+    const auto tagSize = frames.size() + options.attachmentSize + options.paddingSize;
+    if (tagSize > 0x0FFFFFFF) {
+        throw invalid_argument("The tag is too big for an ID3v2 tag.");
+    }
+    auto header = string("ID3\x04\x00\x00", 6);
+    appendSynchsafe(header, tagSize);
+    output.write(header);
+    output.write(frames);
+    output.skip(options.attachmentSize + options.paddingSize);
+
+    // MPEG-1 layer 3, 128 kbit/s, 44.1 kHz, no padding; the frames are written block-wise as they are too small to skip
+    constexpr std::size_t frameSize = 417, framesPerBlock = 0x10000 / frameSize;
+    auto frame = string("\xFF\xFB\x90\x64", 4);
+    frame.append(frameSize - 4, '\0');
+    auto block = string();
+    for (std::size_t i = 0; i != framesPerBlock; ++i) {
+        block += frame;
+    }
+    const auto frameCount = options.units * options.unitSize / frameSize;
+    for (auto i = frameCount / framesPerBlock; i; --i) {
+        output.write(block);
+    }
+    output.write(block.data(), frameCount % framesPerBlock * frameSize);
+}
+
+// FLAC
+
+void generateFlac(const Options &options, Output &output)
+{
+    constexpr std::uint64_t samplesPerFrame = 4096;
+    auto streamInfo = string();
+    appendBE(streamInfo, samplesPerFrame, 2); // min block size
+    appendBE(streamInfo, samplesPerFrame, 2); // max block size
+    appendBE(streamInfo, 0, 3); // min frame size
+    appendBE(streamInfo, 0, 3); // max frame size
+    // sample rate (20 bit), channels - 1 (3 bit), bits per sample - 1 (5 bit), total samples (36 bit)
+    const auto totalSamples = (options.units * samplesPerFrame) & 0xFFFFFFFFFull;
+    appendBE(streamInfo, (std::uint64_t(44100) << 44) | (std::uint64_t(1) << 41) | (std::uint64_t(15) << 36) | totalSamples, 8);
+    streamInfo.append(16, '\0'); // MD5
+    const auto comment = makeVorbisComment(options, string());
+    const auto picture = options.attachmentSize ? makeFlacPictureHeader(options.attachmentSize) : string();
+    if (comment.size() > 0xFFFFFF || picture.size() + options.attachmentSize > 0xFFFFFF || options.paddingSize > 0xFFFFFF) {
+        throw invalid_argument("The tag is too big for a FLAC metadata block.");
+    }
+
+    output.write("fLaC", 4);
+    const auto writeBlockHeader = [&output](std::uint8_t type, std::uint64_t size, bool last) {
+        auto header = string(1, static_cast<char>(last ? (0x80 | type) : type));
+        appendBE(header, size, 3);
+        output.write(header);
+    };
+    writeBlockHeader(0, streamInfo.size(), false);
+    output.write(streamInfo);
+    writeBlockHeader(4, comment.size(), !options.attachmentSize && !options.paddingSize);
+    output.write(comment);
+    if (options.attachmentSize) {
+        writeBlockHeader(6, picture.size() + options.attachmentSize, !options.paddingSize);
+        output.write(picture);
+        output.skip(options.attachmentSize);
+    }
+    if (options.paddingSize) {
+        writeBlockHeader(1, options.paddingSize, true);
+        output.skip(options.paddingSize);
+    }
+    for (std::uint64_t i = 0; i != options.units; ++i) {
+        output.write("\xFF\xF8", 2);
+        output.skip(options.unitSize - 2);
+    }
+}
+
+struct FormatInfo {
+    Format format;
+    const char *name;
+    const char *extension;
+};
+
+constexpr FormatInfo formats[] = {
+    { Format::Matroska, "mkv", "mkv" },
+    { Format::Mp4, "mp4", "m4a" },
+    { Format::Ogg, "ogg", "opus" },
+    { Format::Mp3, "mp3", "mp3" },
+    { Format::Flac, "flac", "flac" },
+};
+
+} // namespace
+/// \endcond
+
+/*!
+ * \brief Returns the name of the specified \a format as used by the command-line options of the benchmark and generator.
+ */
+const char *formatName(Format format)
+{
+    return formats[static_cast<std::size_t>(format)].name;
+}
+
+/*!
+ * \brief Returns the file extension for the specified \a format.
+ */
+const char *fileExtension(Format format)
+{
+    return formats[static_cast<std::size_t>(format)].extension;
+}
+
+/*!
+ * \brief Assigns the format with the specified \a name (see formatName()) to \a format.
+ * \returns Returns whether \a name denotes a format.
+ */
+bool formatFromName(std::string_view name, Format &format)
+{
+    for (const auto &info : formats) {
+        if (name == info.name) {
+            format = info.format;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * \brief Generates a synthetic file of the specified \a format with the specified \a options at \a path.
+ * \returns Returns the size of the generated file.
+ * \throws Throws std::invalid_argument if the options can not be represented in the format and std::ios_base::failure
+ *         when an IO error occurs.
+ */
+std::uint64_t generate(Format format, const Options &options, const std::string &path)
+{
+    if (!options.trackCount || options.trackCount > 126) {
+        throw invalid_argument("The number of tracks must be between 1 and 126.");
+    }
+    if (options.unitSize < 0x400) {
+        throw invalid_argument("The unit size must be at least 1 KiB.");
+    }
+    auto output = Output(path, options.sparse);
+    switch (format) {
+    case Format::Matroska:
+        generateMatroska(options, output);
+        break;
+    case Format::Mp4:
+        generateMp4(options, output);
+        break;
+    case Format::Ogg:
+        generateOgg(options, output);
+        break;
+    case Format::Mp3:
+        generateMp3(options, output);
+        break;
+    case Format::Flac:
+        generateFlac(options, output);
+        break;
+    }
+    return output.finish();
+}
+
+} // namespace SyntheticFiles
+
+} // namespace TagParser
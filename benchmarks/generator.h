@@ -0,0 +1,56 @@
+#ifndef TAG_PARSER_BENCHMARKS_GENERATOR_H
+#define TAG_PARSER_BENCHMARKS_GENERATOR_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace TagParser {
+
+/*!
+ * \brief The SyntheticFiles namespace contains the generator for the synthetic files used by the benchmark.
+ *
+ * The generated files are valid Matroska, MP4, Ogg (Opus), MP3 (with ID3v2 tag) and FLAC files as far as the
+ * tagparser library is concerned. The media payload is zero-filled and written as hole if the file system supports
+ * sparse files, so even files of 10 to 100 GB can be generated within seconds and without occupying much disk space.
+ * Since the files are generated deterministically from the options, they don't need to be stored.
+ */
+namespace SyntheticFiles {
+
+/*!
+ * \brief Specifies the container format of a synthetic file.
+ */
+enum class Format { Matroska, Mp4, Ogg, Mp3, Flac };
+
+/*!
+ * \brief The Options struct specifies the structure of a synthetic file.
+ */
+struct Options {
+    /// \brief The number of clusters (Matroska), chunks (MP4), blocks of pages (Ogg) or blocks of frames (MP3, FLAC).
+    std::uint64_t units = 1;
+    /// \brief The size of each unit in bytes.
+    std::uint64_t unitSize = 0x10000;
+    /// \brief The number of tracks (Matroska, MP4) or logical streams (Ogg); MP3 and FLAC files always have one track.
+    std::size_t trackCount = 1;
+    /// \brief The size of the comment field in bytes which is added to the tag in addition to the title.
+    std::size_t tagSize = 0;
+    /// \brief The size of the attachment (Matroska) or the cover (other formats) in bytes; zero means none.
+    std::uint64_t attachmentSize = 0;
+    /// \brief Specifies that a cue point is added for every n-th cluster (Matroska only); zero means no cues.
+    std::uint64_t cueInterval = 0;
+    /// \brief The size of the padding after the tag in bytes.
+    std::size_t paddingSize = 0x1000;
+    /// \brief Specifies whether zero-filled regions are skipped (creating holes) rather than written.
+    bool sparse = true;
+};
+
+const char *formatName(Format format);
+const char *fileExtension(Format format);
+bool formatFromName(std::string_view name, Format &format);
+std::uint64_t generate(Format format, const Options &options, const std::string &path);
+
+} // namespace SyntheticFiles
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_BENCHMARKS_GENERATOR_H
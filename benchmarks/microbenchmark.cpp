@@ -0,0 +1,364 @@
+#include "./generator.h"
+
+#include "../aac/aacframeanalyzer.h"
+#include "../adts/adtsframe.h"
+#include "../diagnostics.h"
+#include "../exceptions.h"
+#include "../id3/id3v2tag.h"
+#include "../matroska/ebmlelement.h"
+#include "../matroska/matroskacontainer.h"
+#include "../mediafileinfo.h"
+#include "../mpegaudio/mpegaudioframe.h"
+#include "../ogg/oggpage.h"
+#include "../tagvalue.h"
+#include "../vorbis/vorbiscomment.h"
+
+#include <c++utilities/conversion/stringbuilder.h>
+#include <c++utilities/io/binaryreader.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace CppUtilities;
+using namespace TagParser;
+
+/*!
+ * \file microbenchmark.cpp
+ * \brief Times the kernels parsing is built upon in isolation.
+ *
+ * In contrast to tagparser_bench which times whole parse phases, each benchmark covers a single function (e.g. the
+ * EBML VINT decoding, the Ogg CRC or lookups within tags) on data held in memory. This way the effect of optimizing
+ * such a kernel (e.g. via lookup tables or SIMD) can be measured without the noise of I/O and of the remaining parser.
+ * Results are reported in ns per operation (and MB/s where an operation covers a buffer).
+ */
+
+namespace {
+
+struct Options {
+    string filter;
+    string directory = ".";
+    string adtsPath;
+    double minTime = 0.2;
+    bool csv = false;
+};
+
+/// \brief Accumulates results of the benchmarked functions so the compiler can not optimize the calls away.
+volatile std::uint64_t sink = 0;
+
+void printResult(const Options &options, const string &name, std::uint64_t operations, double seconds, std::uint64_t bytesPerOperation)
+{
+    const auto nanosecondsPerOperation = seconds * 1e9 / static_cast<double>(operations);
+    const auto megabytesPerSecond = bytesPerOperation ? static_cast<double>(bytesPerOperation) * 1e3 / nanosecondsPerOperation : 0.0;
+    if (options.csv) {
+        cout << name << ',' << operations << ',' << seconds << ',' << nanosecondsPerOperation << ',' << megabytesPerSecond << '\n';
+        return;
+    }
+    char line[160];
+    if (bytesPerOperation) {
+        std::snprintf(line, sizeof(line), "%-56s %12llu %12.2f %10.1f", name.data(), static_cast<unsigned long long>(operations),
+            nanosecondsPerOperation, megabytesPerSecond);
+    } else {
+        std::snprintf(line, sizeof(line), "%-56s %12llu %12.2f %10s", name.data(), static_cast<unsigned long long>(operations),
+            nanosecondsPerOperation, "-");
+    }
+    cout << line << '\n';
+}
+
+bool isSelected(const Options &options, string_view name)
+{
+    return options.filter.empty() || name.find(options.filter) != string_view::npos;
+}
+
+/*!
+ * \brief Invokes \a routine (which does \a operationsPerCall operations) until the min. time has passed.
+ */
+void run(const Options &options, const string &name, std::uint64_t operationsPerCall, std::uint64_t bytesPerOperation,
+    const std::function<void()> &routine)
+{
+    if (!isSelected(options, name)) {
+        return;
+    }
+    using Clock = chrono::steady_clock;
+    routine(); // warm up caches
+    auto operations = std::uint64_t();
+    const auto start = Clock::now();
+    auto seconds = 0.0;
+    do {
+        routine();
+        operations += operationsPerCall;
+        seconds = chrono::duration<double>(Clock::now() - start).count();
+    } while (seconds < options.minTime);
+    printResult(options, name, operations, seconds, bytesPerOperation);
+}
+
+/// \brief Returns sizes covering all lengths of EBML size denotations.
+vector<std::uint64_t> makeEbmlSizes()
+{
+    auto sizes = vector<std::uint64_t>(1024);
+    for (auto i = std::size_t(); i != sizes.size(); ++i) {
+        sizes[i] = (std::uint64_t(1) << (i % 56)) | i;
+    }
+    return sizes;
+}
+
+std::uint64_t countElements(EbmlElement *element)
+{
+    auto count = std::uint64_t();
+    for (; element; element = element->nextSibling()) {
+        count += 1 + countElements(element->firstChild());
+    }
+    return count;
+}
+
+void benchmarkEbml(const Options &options)
+{
+    const auto sizes = makeEbmlSizes();
+    run(options, "EbmlElement::calculateSizeDenotationLength", sizes.size(), 0, [&] {
+        for (const auto size : sizes) {
+            sink = sink + EbmlElement::calculateSizeDenotationLength(size);
+        }
+    });
+    run(options, "EbmlElement::makeSizeDenotation", sizes.size(), 0, [&] {
+        char buffer[8 + EbmlElement::makeBufferSlack];
+        for (const auto size : sizes) {
+            sink = sink + EbmlElement::makeSizeDenotation(size, buffer);
+        }
+    });
+
+    // parse the element structure of a synthetic Matroska file from the memory-mapped file and from the stream
+    if (!isSelected(options, "EbmlElement::internalParse (mapped)") && !isSelected(options, "EbmlElement::internalParse (stream)")) {
+        return;
+    }
+    const auto path = options.directory + "/tagparser_microbench.mkv";
+    auto fileOptions = SyntheticFiles::Options();
+    fileOptions.units = 64;
+    fileOptions.trackCount = 2;
+    fileOptions.cueInterval = 1;
+    SyntheticFiles::generate(SyntheticFiles::Format::Matroska, fileOptions, path);
+    for (const auto mapped : { true, false }) {
+        auto diag = Diagnostics();
+        auto file = MediaFileInfo(path);
+        file.setMemoryMappingEnabled(mapped);
+        file.open(true);
+        file.parseContainerFormat(diag);
+        auto *const container = static_cast<MatroskaContainer *>(file.container());
+        if (!container) {
+            throw runtime_error("unable to parse " + path);
+        }
+        const auto parseElements = [&] {
+            auto root = EbmlElement(*container, 0);
+            root.validateSubsequentElementStructure(diag);
+            return countElements(&root);
+        };
+        run(options, mapped ? "EbmlElement::internalParse (mapped)" : "EbmlElement::internalParse (stream)", parseElements(), 0,
+            [&] { sink = sink + parseElements(); });
+    }
+    std::remove(path.data());
+}
+
+void benchmarkOggChecksum(const Options &options)
+{
+    // make a page with the max. number of segments of the max. size
+    auto page = string(27 + 255 + 255 * 255, '\x5A');
+    page.replace(0, 4, "OggS");
+    page[26] = static_cast<char>(255);
+    for (auto i = std::size_t(27); i != 27 + 255; ++i) {
+        page[i] = static_cast<char>(255);
+    }
+    run(options, "OggPage::computeChecksum (64 KiB page)", 1, page.size(), [&] { sink = sink + OggPage::computeChecksum(page.data()); });
+}
+
+void benchmarkMpegAudio(const Options &options)
+{
+    // make a frame of MPEG-1 layer 3 at 128 kbit/s and 44.1 kHz (without XING header)
+    auto frame = string(417, '\0');
+    frame.replace(0, 4, "\xFF\xFB\x90\x64", 4);
+    auto stream = istringstream(frame);
+    stream.exceptions(ios_base::failbit | ios_base::badbit);
+    auto reader = BinaryReader(&stream);
+    auto diag = Diagnostics();
+    run(options, "MpegAudioFrame::parseHeader", 1, 0, [&] {
+        auto header = MpegAudioFrame();
+        stream.seekg(0);
+        header.parseHeader(reader, diag);
+        sink = sink + header.size();
+    });
+}
+
+void benchmarkAac(const Options &options)
+{
+    // make an ADTS header of a 256 byte frame (MPEG-4, AAC LC, 44.1 kHz, stereo, no CRC)
+    const char header[AdtsFrame::maxHeaderSize] = { '\xFF', '\xF1', '\x50', '\x80', '\x20', '\x1F', '\xFC' };
+    run(options, "AdtsFrame::parseHeader", 1, 0, [&] {
+        auto frame = AdtsFrame();
+        frame.parseHeader(header);
+        sink = sink + frame.totalSize();
+    });
+
+    // parse the raw data blocks of an actual ADTS stream (requires a file because synthetic data would not get far)
+    if (options.adtsPath.empty() || !isSelected(options, "AacFrameElementParser::parse (per frame)")) {
+        if (!options.csv) {
+            cerr << "AAC decoding skipped; specify an ADTS file via --adts to benchmark it\n";
+        }
+        return;
+    }
+    auto input = ifstream(options.adtsPath, ios_base::in | ios_base::binary);
+    if (!input) {
+        throw runtime_error("unable to open " + options.adtsPath);
+    }
+    const auto data = string(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+    auto analyzer = AacFrameAnalyzer(1);
+    auto diag = Diagnostics();
+    const auto frameCount = analyzer.analyze(data.data(), data.size(), diag).frameCount;
+    if (!frameCount) {
+        throw runtime_error(options.adtsPath + " contains no ADTS frames");
+    }
+    run(options, "AacFrameElementParser::parse (per frame)", frameCount, data.size() / frameCount, [&] {
+        auto frameDiag = Diagnostics();
+        sink = sink + analyzer.analyze(data.data(), data.size(), frameDiag).frameCount;
+    });
+}
+
+const char *encodingName(TagTextEncoding encoding)
+{
+    switch (encoding) {
+    case TagTextEncoding::Latin1:
+        return "Latin-1";
+    case TagTextEncoding::Utf8:
+        return "UTF-8";
+    case TagTextEncoding::Utf16LittleEndian:
+        return "UTF-16LE";
+    case TagTextEncoding::Utf16BigEndian:
+        return "UTF-16BE";
+    default:
+        return "unspecified";
+    }
+}
+
+void benchmarkTextEncodings(const Options &options)
+{
+    // use a text of 256 characters containing non-ASCII characters which can be represented in all encodings
+    auto text = string();
+    while (text.size() < 256) {
+        text += "Caf\xE9 cr\xE8me br\xFBl\xE9\x65 ";
+    }
+    text.resize(256);
+    constexpr TagTextEncoding encodings[]
+        = { TagTextEncoding::Latin1, TagTextEncoding::Utf8, TagTextEncoding::Utf16LittleEndian, TagTextEncoding::Utf16BigEndian };
+    const auto baseline = TagValue(text, TagTextEncoding::Latin1);
+    run(options, "TagValue copy (baseline of the conversions)", 1, baseline.dataSize(), [&] {
+        const auto value = baseline;
+        sink = sink + value.dataSize();
+    });
+    for (const auto from : encodings) {
+        const auto source = TagValue(text, TagTextEncoding::Latin1, from);
+        for (const auto to : encodings) {
+            if (from == to) {
+                continue;
+            }
+            run(options, argsToString("TagValue::convertDataEncoding (", encodingName(from), " -> ", encodingName(to), ')'), 1,
+                source.dataSize(), [&] {
+                    auto value = source;
+                    value.convertDataEncoding(to);
+                    sink = sink + value.dataSize();
+                });
+        }
+    }
+}
+
+void benchmarkTagLookups(const Options &options)
+{
+    for (const auto fieldCount : { 4u, 16u, 64u, 256u }) {
+        auto id3v2Tag = Id3v2Tag();
+        auto vorbisComment = VorbisComment();
+        auto id3v2Ids = vector<Id3v2Tag::IdentifierType>();
+        auto vorbisIds = vector<VorbisComment::IdentifierType>();
+        for (auto i = 0u; i != fieldCount; ++i) {
+            // use IDs which are not sorted by insertion order to avoid favoring a particular storage
+            const auto key = (i * 2654435761u) % 0xFFFFu;
+            id3v2Ids.emplace_back(0x54000000u | key);
+            vorbisIds.emplace_back(argsToString("FIELD", key));
+            id3v2Tag.setValue(id3v2Ids.back(), TagValue("value"));
+            vorbisComment.setValue(vorbisIds.back(), TagValue("value"));
+        }
+        run(options, argsToString("Id3v2Tag::value(id) (", fieldCount, " fields)"), fieldCount, 0, [&] {
+            for (const auto &id : id3v2Ids) {
+                sink = sink + id3v2Tag.value(id).dataSize();
+            }
+        });
+        run(options, argsToString("VorbisComment::value(id) (", fieldCount, " fields)"), fieldCount, 0, [&] {
+            for (const auto &id : vorbisIds) {
+                sink = sink + vorbisComment.value(id).dataSize();
+            }
+        });
+    }
+}
+
+void printUsage(const char *executable)
+{
+    cerr << "Usage: " << executable << " [--filter <substring>] [--dir .] [--adts <file>] [--min-time 0.2] [--csv]\n"
+         << "Times the kernels parsing is built upon in isolation (in ns/op). The directory is used for a temporary Matroska file.\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    auto options = Options();
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const auto arg = string_view(argv[i]);
+            const auto value = [&] {
+                if (++i >= argc) {
+                    throw runtime_error(argsToString("missing value for ", arg));
+                }
+                return string(argv[i]);
+            };
+            if (arg == "--filter") {
+                options.filter = value();
+            } else if (arg == "--dir") {
+                options.directory = value();
+            } else if (arg == "--adts") {
+                options.adtsPath = value();
+            } else if (arg == "--min-time") {
+                options.minTime = stod(value());
+            } else if (arg == "--csv") {
+                options.csv = true;
+            } else {
+                printUsage(argv[0]);
+                return arg == "--help" || arg == "-h" ? 0 : 1;
+            }
+        }
+    } catch (const exception &error) {
+        cerr << "Invalid arguments: " << error.what() << '\n';
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (options.csv) {
+        cout << "benchmark,operations,seconds,ns_per_operation,mb_per_second\n";
+    } else {
+        cout << "benchmark                                                  operations        ns/op       MB/s\n";
+    }
+    try {
+        benchmarkEbml(options);
+        benchmarkOggChecksum(options);
+        benchmarkMpegAudio(options);
+        benchmarkAac(options);
+        benchmarkTextEncodings(options);
+        benchmarkTagLookups(options);
+    } catch (const std::exception &error) {
+        cerr << "Benchmark failed: " << error.what() << '\n';
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "../diagnostics.h"
+#include "../iotrace.h"
+#include "../mediafileinfo.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace TagParser;
+
+/*!
+ * \file replay.cpp
+ * \brief Records I/O traces of parsing files and replays them against latency models of different storage devices.
+ *
+ * A trace can be recorded wherever a file is slow to parse (see MediaFileInfo::setIoTracingEnabled() for recording
+ * traces within applications) and replayed later to estimate the time spent on I/O on another device, e.g. to check
+ * whether a change to the access pattern pays off on an HDD or on S3.
+ */
+
+namespace {
+
+void printUsage(const char *executable)
+{
+    cerr << "Usage: " << executable << " record <media file> <trace file>\n"
+         << "       " << executable << " replay <trace file> [ssd] [hdd] [s3]\n"
+         << "Records the I/O of parsing a file or replays a recorded trace against latency models (all by default).\n";
+}
+
+int record(const string &mediaFilePath, const string &tracePath)
+{
+    auto diag = Diagnostics();
+    auto file = MediaFileInfo(mediaFilePath);
+    file.setIoTracingEnabled(true);
+    file.open(true);
+    file.parseEverything(diag);
+    file.close();
+    auto output = ofstream(tracePath, ios_base::out | ios_base::trunc);
+    output.exceptions(ios_base::failbit | ios_base::badbit);
+    file.statistics()->ioTrace.write(output);
+    cout << "Recorded " << file.statistics()->ioTrace.events().size() << " operations\n";
+    return 0;
+}
+
+int replay(const string &tracePath, const vector<string> &modelNames)
+{
+    auto input = ifstream(tracePath);
+    input.exceptions(ios_base::badbit);
+    if (!input) {
+        throw runtime_error("unable to open " + tracePath);
+    }
+    const auto trace = IoTrace::read(input);
+    auto models = vector<IoLatencyModel>();
+    for (const auto &model : { IoLatencyModel::localSsd(), IoLatencyModel::hdd(), IoLatencyModel::s3() }) {
+        if (modelNames.empty() || find(modelNames.cbegin(), modelNames.cend(), model.name) != modelNames.cend()) {
+            models.emplace_back(model);
+        }
+    }
+    cout << "model     requests      seeks       fetched       written      time (ms)\n";
+    for (const auto &model : models) {
+        const auto result = trace.replay(model);
+        char line[160];
+        std::snprintf(line, sizeof(line), "%-6s %11llu %10llu %13llu %13llu %14.3f", model.name, static_cast<unsigned long long>(result.requests),
+            static_cast<unsigned long long>(result.seeks), static_cast<unsigned long long>(result.bytesFetched),
+            static_cast<unsigned long long>(result.bytesWritten), static_cast<double>(result.time.count()) / 1e6);
+        cout << line << '\n';
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const auto command = argc > 1 ? string_view(argv[1]) : string_view();
+    try {
+        if (command == "record" && argc == 4) {
+            return record(argv[2], argv[3]);
+        } else if (command == "replay" && argc >= 3) {
+            return replay(argv[2], vector<string>(argv + 3, argv + argc));
+        }
+    } catch (const std::exception &error) {
+        cerr << "Unable to " << command << " trace: " << error.what() << '\n';
+        return 2;
+    }
+    printUsage(argv[0]);
+    return command == "--help" || command == "-h" ? 0 : 1;
+}
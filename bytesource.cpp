@@ -0,0 +1,808 @@
+#include "./bytesource.h"
+#include "./exceptions.h"
+
+#ifdef PLATFORM_UNIX
+#include <cerrno>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#ifdef TAG_PARSER_USE_IO_URING
+#include <liburing.h>
+#endif
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <ios>
+#include <istream>
+#include <limits>
+
+using namespace std;
+
+namespace TagParser {
+
+/*!
+ * \class TagParser::ByteSource
+ * \brief The ByteSource class is the interface for data sources which can be parsed via MediaFileInfo instead of a file.
+ *
+ * In contrast to std::istream a byte source only needs to support positional reads (like pread()) so it is easy to
+ * implement for in-memory buffers, file descriptors or ranges of remote objects. Use ByteSourceStreamBuffer to access
+ * a byte source like a stream.
+ *
+ * \sa BasicFileInfo::setByteSource()
+ */
+
+/*!
+ * \brief Destroys the source.
+ */
+ByteSource::~ByteSource()
+{
+}
+
+/*!
+ * \fn ByteSource::size()
+ * \brief Returns the total number of bytes provided by the source.
+ */
+
+/*!
+ * \fn ByteSource::read()
+ * \brief Reads up to \a count bytes at the specified \a offset into \a buffer.
+ * \returns Returns the number of bytes read. This is only less than \a count if the end of the source has been reached.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ * \remarks Reads are positional and must not depend on any internal position.
+ */
+
+/*!
+ * \brief Returns all data of the source if it is contiguously available in memory; otherwise an empty view is returned.
+ * \remarks
+ * - This is not the case by default and might be overwritten when subclassing.
+ * - Parsers read directly from the returned view (see BasicFileInfo::mappedData()) so it must stay valid as long as the
+ *   source is used.
+ */
+string_view ByteSource::contiguousData() const
+{
+    return string_view();
+}
+
+/*!
+ * \brief Returns whether only a bounded window of data in front of the most recent read is available.
+ * \remarks
+ * - This is not the case by default. It is the case for ForwardOnlyByteSource.
+ * - Parsers avoid reading at the end of the source (e.g. to check for an ID3v1 tag) or seeking back to the beginning
+ *   (except for data which has just been read) if the source is forward-only. Fields which can not be determined this
+ *   way are reported via the diagnostic messages.
+ */
+bool ByteSource::isForwardOnly() const
+{
+    return false;
+}
+
+/*!
+ * \brief Announces that the specified range is going to be read again later.
+ * \returns Returns whether the range will be available; this is always the case by default.
+ * \remarks
+ * - This is only relevant for forward-only sources which can keep the range available this way even after having
+ *   read far beyond it. Parsers call this for e.g. the "Tracks"- and "Tags"-elements of a Matroska file which are
+ *   only parsed after walking through all elements.
+ * - The range must start within the data which is still available.
+ */
+bool ByteSource::retain(std::uint64_t offset, std::uint64_t size)
+{
+    CPP_UTILITIES_UNUSED(offset);
+    CPP_UTILITIES_UNUSED(size);
+    return true;
+}
+
+/*!
+ * \class TagParser::MemoryByteSource
+ * \brief The MemoryByteSource class provides a ByteSource for data which is already held in memory.
+ *
+ * The data is not copied. Since it is contiguously available, parsers read from it directly without going through
+ * a stream.
+ */
+
+std::uint64_t MemoryByteSource::size() const
+{
+    return m_data.size();
+}
+
+std::size_t MemoryByteSource::read(std::uint64_t offset, char *buffer, std::size_t count)
+{
+    if (offset >= m_data.size()) {
+        return 0;
+    }
+    const auto bytesToRead = min<std::uint64_t>(count, m_data.size() - offset);
+    memcpy(buffer, m_data.data() + offset, static_cast<std::size_t>(bytesToRead));
+    return static_cast<std::size_t>(bytesToRead);
+}
+
+string_view MemoryByteSource::contiguousData() const
+{
+    return m_data;
+}
+
+/*!
+ * \class TagParser::BufferedRangeByteSource
+ * \brief The BufferedRangeByteSource class provides a ByteSource for a stream of which one range is held in memory.
+ *
+ * The range is read at once when constructing the source. Reads within the range are served from memory; everything
+ * else is read from the stream. This allows parsing a structure which is consumed completely anyways (e.g. the
+ * "moov"-atom of an MP4 file) with one read instead of many small ones while the offsets stay the same.
+ */
+
+/*!
+ * \brief Constructs a new source for the specified \a stream reading \a length bytes at the specified \a offset into memory.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ * \remarks The \a stream must outlive the source.
+ */
+BufferedRangeByteSource::BufferedRangeByteSource(std::istream &stream, std::uint64_t offset, std::size_t length)
+    : m_stream(stream)
+    , m_offset(offset)
+    , m_buffer(length, '\0')
+{
+    m_stream.seekg(0, ios_base::end);
+    m_size = static_cast<std::uint64_t>(m_stream.tellg());
+    m_stream.seekg(static_cast<streamoff>(offset), ios_base::beg);
+    m_stream.read(m_buffer.data(), static_cast<streamsize>(length));
+}
+
+std::uint64_t BufferedRangeByteSource::size() const
+{
+    return m_size;
+}
+
+std::size_t BufferedRangeByteSource::read(std::uint64_t offset, char *buffer, std::size_t count)
+{
+    if (offset >= m_size) {
+        return 0;
+    }
+    count = static_cast<std::size_t>(min<std::uint64_t>(count, m_size - offset));
+    // take what is buffered
+    auto bytesCopied = std::size_t();
+    if (const auto bufferEnd = m_offset + m_buffer.size(); offset >= m_offset && offset < bufferEnd) {
+        bytesCopied = static_cast<std::size_t>(min<std::uint64_t>(count, bufferEnd - offset));
+        memcpy(buffer, m_buffer.data() + (offset - m_offset), bytesCopied);
+        if (bytesCopied == count) {
+            return count;
+        }
+    }
+    // read the rest from the stream
+    m_stream.seekg(static_cast<streamoff>(offset + bytesCopied), ios_base::beg);
+    m_stream.read(buffer + bytesCopied, static_cast<streamsize>(count - bytesCopied));
+    return bytesCopied + static_cast<std::size_t>(m_stream.gcount());
+}
+
+#ifdef PLATFORM_UNIX
+/*!
+ * \class TagParser::FileDescriptorByteSource
+ * \brief The FileDescriptorByteSource class provides a ByteSource reading via pread() from a file descriptor.
+ * \remarks The file descriptor is not owned by the source and must stay open as long as the source is used.
+ */
+
+/*!
+ * \brief Constructs a new source for the specified \a fileDescriptor.
+ * \throws Throws std::ios_base::failure when the size of the file can not be determined.
+ */
+FileDescriptorByteSource::FileDescriptorByteSource(int fileDescriptor)
+    : m_fileDescriptor(fileDescriptor)
+    , m_size(0)
+{
+    struct stat fileInfo;
+    if (::fstat(m_fileDescriptor, &fileInfo) != 0) {
+        throw ios_base::failure("Unable to determine file size", error_code(errno, system_category()));
+    }
+    m_size = static_cast<std::uint64_t>(fileInfo.st_size);
+}
+
+std::uint64_t FileDescriptorByteSource::size() const
+{
+    return m_size;
+}
+
+std::size_t FileDescriptorByteSource::read(std::uint64_t offset, char *buffer, std::size_t count)
+{
+    std::size_t totalBytesRead = 0;
+    while (count) {
+        const auto bytesRead = ::pread(m_fileDescriptor, buffer + totalBytesRead, count, static_cast<off_t>(offset + totalBytesRead));
+        if (bytesRead < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw ios_base::failure("Unable to read from file descriptor", error_code(errno, system_category()));
+        }
+        if (!bytesRead) {
+            break;
+        }
+        totalBytesRead += static_cast<std::size_t>(bytesRead);
+        count -= static_cast<std::size_t>(bytesRead);
+    }
+    return totalBytesRead;
+}
+
+/*!
+ * \class TagParser::AsyncFileReader
+ * \brief The AsyncFileReader class reads many ranges from (possibly many different) files at once.
+ *
+ * All reads passed to read() are submitted via io_uring (if the library has been built with ENABLE_IO_URING and the
+ * kernel supports it), so a single thread can keep hundreds of reads in flight instead of blocking on each of them. The
+ * reads are performed one after another via pread() otherwise.
+ *
+ * \remarks The parsers themselves read synchronously. So this class is meant to fetch the data needed for parsing upfront,
+ *          e.g. the head and tail of many files at once (see BatchParser::setAsyncReadingEnabled()).
+ */
+
+/// \cond
+struct AsyncFileReader::Ring {
+#ifdef TAG_PARSER_USE_IO_URING
+    io_uring ring;
+#endif
+};
+/// \endcond
+
+/*!
+ * \brief Constructs a new reader keeping up to \a queueDepth reads in flight.
+ * \remarks Falls back to pread() if setting up io_uring fails.
+ */
+AsyncFileReader::AsyncFileReader(unsigned int queueDepth)
+    : m_queueDepth(queueDepth ? queueDepth : 1)
+{
+#ifdef TAG_PARSER_USE_IO_URING
+    auto ring = make_unique<Ring>();
+    if (!io_uring_queue_init(m_queueDepth, &ring->ring, 0)) {
+        m_ring = move(ring);
+    }
+#endif
+}
+
+/*!
+ * \brief Destroys the reader.
+ */
+AsyncFileReader::~AsyncFileReader()
+{
+#ifdef TAG_PARSER_USE_IO_URING
+    if (m_ring) {
+        io_uring_queue_exit(&m_ring->ring);
+    }
+#endif
+}
+
+/*!
+ * \brief Performs the specified \a requests and returns when all of them have been completed.
+ *
+ * The number of bytes read and the error (if any) are stored in each request. Short reads are continued until the
+ * requested number of bytes has been read or the end of the file has been reached.
+ *
+ * \throws Throws std::ios_base::failure if the reads can not be submitted (errors of individual reads are only stored
+ *         in the corresponding request).
+ */
+void AsyncFileReader::read(AsyncReadRequest *requests, std::size_t count)
+{
+    for (auto *request = requests, *end = requests + count; request != end; ++request) {
+        request->bytesRead = 0;
+        request->error = 0;
+    }
+#ifdef TAG_PARSER_USE_IO_URING
+    if (m_ring) {
+        auto &ring = m_ring->ring;
+        auto pending = vector<AsyncReadRequest *>();
+        pending.reserve(count);
+        for (auto index = count; index; --index) {
+            pending.emplace_back(requests + index - 1);
+        }
+        for (std::size_t inFlight = 0; !pending.empty() || inFlight;) {
+            // submit as many pending reads as the submission queue can take
+            while (!pending.empty()) {
+                auto *const sqe = io_uring_get_sqe(&ring);
+                if (!sqe) {
+                    break;
+                }
+                auto *const request = pending.back();
+                pending.pop_back();
+                io_uring_prep_read(sqe, request->fileDescriptor, request->buffer + request->bytesRead,
+                    static_cast<unsigned int>(min<std::size_t>(request->count - request->bytesRead, numeric_limits<unsigned int>::max())),
+                    request->offset + request->bytesRead);
+                io_uring_sqe_set_data(sqe, request);
+                ++inFlight;
+            }
+            if (const auto res = io_uring_submit_and_wait(&ring, 1); res < 0 && res != -EINTR) {
+                throw ios_base::failure("Unable to submit reads via io_uring", error_code(-res, system_category()));
+            }
+            // process completed reads; continue short reads
+            io_uring_cqe *cqe;
+            unsigned int head, completed = 0;
+            io_uring_for_each_cqe(&ring, head, cqe)
+            {
+                auto *const request = static_cast<AsyncReadRequest *>(io_uring_cqe_get_data(cqe));
+                ++completed;
+                --inFlight;
+                if (cqe->res == -EINTR || cqe->res == -EAGAIN) {
+                    pending.emplace_back(request);
+                } else if (cqe->res < 0) {
+                    request->error = -cqe->res;
+                } else if (cqe->res > 0 && (request->bytesRead += static_cast<std::size_t>(cqe->res)) < request->count) {
+                    pending.emplace_back(request);
+                }
+            }
+            io_uring_cq_advance(&ring, completed);
+        }
+        return;
+    }
+#endif
+    for (auto *request = requests, *end = requests + count; request != end; ++request) {
+        try {
+            request->bytesRead = FileDescriptorByteSource(request->fileDescriptor).read(request->offset, request->buffer, request->count);
+        } catch (const ios_base::failure &failure) {
+            request->error = failure.code().value();
+        }
+    }
+}
+#endif
+
+/*!
+ * \class TagParser::CoalescingByteSource
+ * \brief The CoalescingByteSource class plans reads from another ByteSource to minimize the number of round trips.
+ *
+ * It is meant to be put on top of sources with a high latency per read such as HTTP or object storage range requests.
+ * Parsing a file usually leads to many small scattered reads (e.g. walking the moov atom of an MP4 file, looking up
+ * SeekHead/Cues/Tags elements of a Matroska file or checking for an ID3v1 tag at the end of the file). This class
+ * - reads the underlying source only in blocks of blockSize() bytes and caches all blocks which have been read,
+ * - fetches all missing blocks needed for a read with a single request,
+ * - fetches the head and the tail of the source upfront since all parsers need to read there anyways and
+ * - keeps track of the number of round trips (see statistics()).
+ *
+ * \remarks The cache is not bounded so the class is intended for parsing metadata. Use clearCache() to free memory.
+ */
+
+/*!
+ * \brief Constructs a new source reading from the specified \a source.
+ * \param blockSize Specifies the granularity of reads from \a source. Nearby reads within that distance are coalesced.
+ * \param headSize Specifies the number of bytes to fetch from the beginning of \a source on the first read.
+ * \param tailSize Specifies the number of bytes to fetch from the end of \a source on the first read.
+ */
+CoalescingByteSource::CoalescingByteSource(std::shared_ptr<ByteSource> source, std::size_t blockSize, std::uint64_t headSize, std::uint64_t tailSize)
+    : m_source(move(source))
+    , m_size(m_source->size())
+    , m_blockSize(blockSize ? blockSize : 1)
+    , m_headSize(headSize)
+    , m_tailSize(tailSize)
+    , m_prefetched(false)
+{
+}
+
+std::uint64_t CoalescingByteSource::size() const
+{
+    return m_size;
+}
+
+std::size_t CoalescingByteSource::read(std::uint64_t offset, char *buffer, std::size_t count)
+{
+    if (offset >= m_size || !count) {
+        return 0;
+    }
+    if (!m_prefetched) {
+        prefetchHeadAndTail();
+    }
+    count = static_cast<std::size_t>(min<std::uint64_t>(count, m_size - offset));
+    ++m_statistics.reads;
+    m_statistics.bytesRequested += count;
+
+    // fetch the range from the first to the last missing block with a single request
+    const auto firstBlock = offset / m_blockSize, lastBlock = (offset + count - 1) / m_blockSize;
+    auto firstMissingBlock = firstBlock, lastMissingBlock = lastBlock;
+    while (firstMissingBlock <= lastBlock && m_blocks.count(firstMissingBlock)) {
+        ++firstMissingBlock;
+    }
+    if (firstMissingBlock > lastBlock) {
+        ++m_statistics.cacheHits;
+    } else {
+        while (lastMissingBlock > firstMissingBlock && m_blocks.count(lastMissingBlock)) {
+            --lastMissingBlock;
+        }
+        fetchBlocks(firstMissingBlock, lastMissingBlock);
+    }
+
+    // copy the data from the cached blocks
+    for (std::size_t bytesCopied = 0; bytesCopied < count;) {
+        const auto currentOffset = offset + bytesCopied;
+        const auto block = currentOffset / m_blockSize;
+        const auto offsetInBlock = static_cast<std::size_t>(currentOffset - block * m_blockSize);
+        const auto bytesToCopy = min(count - bytesCopied, blockLength(block) - offsetInBlock);
+        memcpy(buffer + bytesCopied, m_blocks[block].get() + offsetInBlock, bytesToCopy);
+        bytesCopied += bytesToCopy;
+    }
+    return count;
+}
+
+/*!
+ * \brief Returns the ranges (offset and length) of the head and the tail of the source which are fetched on the first read.
+ *
+ * This allows fetching these ranges in a different way, e.g. for many sources at once via AsyncFileReader. The fetched
+ * data is passed back via insertPrefetchedRange().
+ *
+ * \remarks Returns an empty list if the ranges have already been fetched.
+ */
+std::vector<std::pair<std::uint64_t, std::size_t>> CoalescingByteSource::prefetchRanges() const
+{
+    auto ranges = std::vector<std::pair<std::uint64_t, std::size_t>>();
+    if (m_prefetched) {
+        return ranges;
+    }
+    for (const auto &[firstBlock, lastBlock] : prefetchBlockRanges()) {
+        ranges.emplace_back(firstBlock * m_blockSize, static_cast<std::size_t>((lastBlock - firstBlock) * m_blockSize + blockLength(lastBlock)));
+    }
+    return ranges;
+}
+
+/*!
+ * \brief Caches the specified \a data which has been read from the underlying source at \a offset.
+ *
+ * This is meant to be called with the data of all ranges returned by prefetchRanges(). Afterwards the head and the tail
+ * are not fetched anymore on the first read.
+ *
+ * \throws Throws TruncatedDataException if \a offset and \a length do not denote a range of prefetchRanges().
+ */
+void CoalescingByteSource::insertPrefetchedRange(std::uint64_t offset, const char *data, std::size_t length)
+{
+    if (!length || offset % m_blockSize || offset + length > m_size) {
+        throw TruncatedDataException();
+    }
+    const auto firstBlock = offset / m_blockSize, lastBlock = (offset + length - 1) / m_blockSize;
+    if ((lastBlock - firstBlock) * m_blockSize + blockLength(lastBlock) != length) {
+        throw TruncatedDataException();
+    }
+    ++m_statistics.roundTrips;
+    m_statistics.bytesFetched += length;
+    storeBlocks(firstBlock, lastBlock, data);
+    m_prefetched = true;
+}
+
+/*!
+ * \brief Discards all cached blocks.
+ * \remarks The head and tail of the source are fetched again on the next read.
+ */
+void CoalescingByteSource::clearCache()
+{
+    m_blocks.clear();
+    m_prefetched = false;
+}
+
+/*!
+ * \brief Returns the ranges of blocks (first and last block) making up the head and tail of the source; returns only
+ *        one range if they overlap.
+ */
+std::vector<std::pair<std::uint64_t, std::uint64_t>> CoalescingByteSource::prefetchBlockRanges() const
+{
+    auto ranges = std::vector<std::pair<std::uint64_t, std::uint64_t>>();
+    if (!m_size) {
+        return ranges;
+    }
+    const auto lastBlock = (m_size - 1) / m_blockSize;
+    const auto headBlocks = (min(m_headSize, m_size) + m_blockSize - 1) / m_blockSize;
+    const auto tailBlocks = (min(m_tailSize, m_size) + m_blockSize - 1) / m_blockSize;
+    if (headBlocks + tailBlocks > lastBlock) {
+        ranges.emplace_back(0, lastBlock);
+        return ranges;
+    }
+    if (headBlocks) {
+        ranges.emplace_back(0, headBlocks - 1);
+    }
+    if (tailBlocks) {
+        ranges.emplace_back(lastBlock - tailBlocks + 1, lastBlock);
+    }
+    return ranges;
+}
+
+/*!
+ * \brief Fetches the head and tail of the source; uses only one request if they overlap.
+ */
+void CoalescingByteSource::prefetchHeadAndTail()
+{
+    m_prefetched = true;
+    for (const auto &[firstBlock, lastBlock] : prefetchBlockRanges()) {
+        fetchBlocks(firstBlock, lastBlock);
+    }
+}
+
+/*!
+ * \brief Fetches the blocks from \a firstBlock to \a lastBlock (inclusive) with a single read from the underlying source.
+ * \throws Throws TruncatedDataException if the underlying source returns less data than it announced via its size.
+ */
+void CoalescingByteSource::fetchBlocks(std::uint64_t firstBlock, std::uint64_t lastBlock)
+{
+    const auto startOffset = firstBlock * m_blockSize;
+    const auto length = static_cast<std::size_t>((lastBlock - firstBlock) * m_blockSize + blockLength(lastBlock));
+    auto data = make_unique<char[]>(length);
+    const auto bytesRead = m_source->read(startOffset, data.get(), length);
+    ++m_statistics.roundTrips;
+    m_statistics.bytesFetched += bytesRead;
+    if (bytesRead < length) {
+        throw TruncatedDataException();
+    }
+    storeBlocks(firstBlock, lastBlock, data.get());
+}
+
+/*!
+ * \brief Caches the blocks from \a firstBlock to \a lastBlock (inclusive) from the specified contiguous \a data.
+ */
+void CoalescingByteSource::storeBlocks(std::uint64_t firstBlock, std::uint64_t lastBlock, const char *data)
+{
+    for (auto block = firstBlock; block <= lastBlock; ++block) {
+        const auto blockData = data + (block - firstBlock) * m_blockSize;
+        auto &cachedBlock = m_blocks[block];
+        cachedBlock = make_unique<char[]>(blockLength(block));
+        memcpy(cachedBlock.get(), blockData, blockLength(block));
+    }
+}
+
+/*!
+ * \brief Returns the number of bytes of the specified \a block (only the last block might be shorter than blockSize()).
+ */
+std::size_t CoalescingByteSource::blockLength(std::uint64_t block) const
+{
+    return static_cast<std::size_t>(min<std::uint64_t>(m_blockSize, m_size - block * m_blockSize));
+}
+
+/*!
+ * \class TagParser::ForwardOnlyByteSource
+ * \brief The ForwardOnlyByteSource class provides a ByteSource for non-seekable streams such as pipes or sockets.
+ *
+ * Data is taken from the stream only when it is read and the last lookbehindSize() bytes are kept in a buffer so parsers
+ * can go back to data they have just walked through (e.g. to read the "Tags"-element of a Matroska file after parsing
+ * its header). Reads in front of the buffer are not possible; reads far ahead skip the data in between without buffering
+ * it. This allows parsing the tags and tracks of Ogg, FLAC, MP3, ADTS and Matroska files while the data arrives without
+ * spooling it to disk first (see isForwardOnly()).
+ *
+ * Ranges which are needed later can be kept via retain() as long as their total size does not exceed the lookbehind
+ * size.
+ *
+ * \remarks
+ * - The size of the stream should be specified if it is known (e.g. via the "Content-Length" of an upload). Otherwise
+ *   size() returns unknownSize until the end of the stream has been reached. Reading beyond the end raises a
+ *   TruncatedDataException in that case. Parsers which need to walk up to the end of the stream treat that as the end if
+ *   possible (e.g. the walk through the elements of a Matroska file).
+ * - The buffer might grow up to twice the lookbehind size (plus the size of the most recent read) because discarding
+ *   data from its front is only done in bulk.
+ */
+
+/*!
+ * \brief Constructs a new source reading from the specified \a stream.
+ * \param size Specifies the total number of bytes the stream provides or unknownSize if it is not known.
+ * \param lookbehindSize Specifies the number of bytes in front of the most recent read which are kept at least.
+ * \remarks The \a stream is read from its current position which is considered offset zero.
+ */
+ForwardOnlyByteSource::ForwardOnlyByteSource(std::istream &stream, std::uint64_t size, std::size_t lookbehindSize)
+    : m_stream(stream)
+    , m_size(size)
+    , m_lookbehindSize(lookbehindSize)
+    , m_bufferOffset(0)
+    , m_retainedSize(0)
+    , m_endReached(false)
+{
+}
+
+std::uint64_t ForwardOnlyByteSource::size() const
+{
+    return m_size;
+}
+
+/*!
+ * \throws Throws std::ios_base::failure when reading in front of the buffered data which has already been discarded
+ *         (the lookbehind size is insufficient in this case) or when an IO error occurs.
+ * \throws Throws TruncatedDataException when reading beyond the end of a stream whose size was unknown.
+ */
+std::size_t ForwardOnlyByteSource::read(std::uint64_t offset, char *buffer, std::size_t count)
+{
+    if (offset >= m_size || !count) {
+        return 0;
+    }
+    count = static_cast<std::size_t>(min<std::uint64_t>(count, m_size - offset));
+    if (offset < m_bufferOffset) {
+        // serve the read from a retained range; only the retained part is returned if the read exceeds it
+        if (auto range = m_retainedRanges.upper_bound(offset); range != m_retainedRanges.begin()) {
+            if (const auto &[rangeOffset, data] = *--range; offset < rangeOffset + data.size()) {
+                const auto bytesToCopy = static_cast<std::size_t>(min<std::uint64_t>(count, rangeOffset + data.size() - offset));
+                memcpy(buffer, data.data() + (offset - rangeOffset), bytesToCopy);
+                return bytesToCopy;
+            }
+        }
+        throw ios_base::failure("Unable to read in front of the lookbehind buffer of forward-only source");
+    }
+    receive(offset, offset + count);
+    const auto bufferEnd = m_bufferOffset + m_buffer.size();
+    if (offset >= bufferEnd) {
+        // the stream ended before the offset (which is only possible if the size was unknown or wrong)
+        throw TruncatedDataException();
+    }
+    const auto bytesToCopy = static_cast<std::size_t>(min<std::uint64_t>(count, bufferEnd - offset));
+    memcpy(buffer, m_buffer.data() + (offset - m_bufferOffset), bytesToCopy);
+    return bytesToCopy;
+}
+
+bool ForwardOnlyByteSource::isForwardOnly() const
+{
+    return true;
+}
+
+/*!
+ * \brief Keeps a copy of the specified range which is read from the stream if not received yet.
+ * \returns Returns false if the range would exceed the lookbehind size in total; it is not kept in this case.
+ * \throws Throws std::ios_base::failure if the range is not available anymore or an IO error occurs.
+ */
+bool ForwardOnlyByteSource::retain(std::uint64_t offset, std::uint64_t size)
+{
+    if (offset >= m_size || !size) {
+        return true;
+    }
+    size = min(size, m_size - offset);
+    if (m_retainedSize + size > m_lookbehindSize) {
+        return false;
+    }
+    auto data = vector<char>(static_cast<std::size_t>(size));
+    data.resize(read(offset, data.data(), data.size()));
+    auto &retainedData = m_retainedRanges[offset];
+    m_retainedSize += data.size() - retainedData.size();
+    retainedData = move(data);
+    return true;
+}
+
+/*!
+ * \brief Takes the data up to \a endOffset from the stream; keeps everything from \a offset on in the buffer.
+ */
+void ForwardOnlyByteSource::receive(std::uint64_t offset, std::uint64_t endOffset)
+{
+    const auto received = bytesReceived();
+    if (m_endReached || endOffset <= received) {
+        return;
+    }
+    const auto handleEnd = [this](std::uint64_t totalSize) {
+        if (m_stream.bad()) {
+            throw ios_base::failure("Unable to read from stream of forward-only source");
+        }
+        m_endReached = true;
+        if (m_size == unknownSize) {
+            m_size = totalSize;
+        }
+    };
+
+    // skip data which would be discarded anyways without buffering it
+    const auto keepFrom = min(offset, endOffset > m_lookbehindSize ? endOffset - m_lookbehindSize : std::uint64_t());
+    if (keepFrom > received) {
+        const auto bytesToSkip = keepFrom - received;
+        for (auto bytesSkipped = std::uint64_t(); bytesSkipped < bytesToSkip;) {
+            const auto chunkSize = static_cast<streamsize>(min<std::uint64_t>(bytesToSkip - bytesSkipped, numeric_limits<streamsize>::max()));
+            m_stream.ignore(chunkSize);
+            const auto bytesIgnored = static_cast<std::uint64_t>(m_stream.gcount());
+            bytesSkipped += bytesIgnored;
+            if (bytesIgnored < static_cast<std::uint64_t>(chunkSize)) {
+                m_buffer.clear();
+                m_bufferOffset = received + bytesSkipped;
+                handleEnd(m_bufferOffset);
+                return;
+            }
+        }
+        m_buffer.clear();
+        m_bufferOffset = keepFrom;
+    } else if (keepFrom > m_bufferOffset && keepFrom - m_bufferOffset > m_lookbehindSize) {
+        // discard data from the front of the buffer in bulk
+        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + static_cast<vector<char>::difference_type>(keepFrom - m_bufferOffset));
+        m_bufferOffset = keepFrom;
+    }
+
+    // append the requested data to the buffer
+    const auto bufferedSize = m_buffer.size();
+    const auto bytesToRead = static_cast<std::size_t>(endOffset - bytesReceived());
+    m_buffer.resize(bufferedSize + bytesToRead);
+    m_stream.read(m_buffer.data() + bufferedSize, static_cast<streamsize>(bytesToRead));
+    const auto bytesRead = static_cast<std::size_t>(m_stream.gcount());
+    if (bytesRead < bytesToRead) {
+        m_buffer.resize(bufferedSize + bytesRead);
+        handleEnd(bytesReceived());
+    }
+}
+
+/*!
+ * \class TagParser::ByteSourceStreamBuffer
+ * \brief The ByteSourceStreamBuffer class allows reading a ByteSource via std::istream.
+ *
+ * If the source provides contiguousData() the data is exposed directly as get area without any copying. Otherwise
+ * reads are buffered and large reads bypass the buffer. The buffer is read-only; writing is not supported.
+ */
+
+/*!
+ * \brief Constructs a new stream buffer for the specified \a source.
+ * \remarks The \a bufferSize is only relevant if the source does not provide contiguous data.
+ */
+ByteSourceStreamBuffer::ByteSourceStreamBuffer(ByteSource &source, std::size_t bufferSize)
+    : m_source(source)
+    , m_bufferSize(bufferSize ? bufferSize : 1)
+    , m_bufferOffset(0)
+{
+    if (const auto data = m_source.contiguousData(); !data.empty()) {
+        auto *const begin = const_cast<char *>(data.data());
+        setg(begin, begin, begin + data.size());
+    } else {
+        m_buffer = make_unique<char[]>(m_bufferSize);
+        setg(m_buffer.get(), m_buffer.get(), m_buffer.get());
+    }
+}
+
+ByteSourceStreamBuffer::int_type ByteSourceStreamBuffer::underflow()
+{
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+    if (!m_buffer) {
+        return traits_type::eof();
+    }
+    m_bufferOffset = currentOffset();
+    const auto bytesRead = m_source.read(m_bufferOffset, m_buffer.get(), m_bufferSize);
+    setg(m_buffer.get(), m_buffer.get(), m_buffer.get() + bytesRead);
+    return bytesRead ? traits_type::to_int_type(*gptr()) : traits_type::eof();
+}
+
+streamsize ByteSourceStreamBuffer::xsgetn(char_type *buffer, streamsize count)
+{
+    streamsize totalBytesRead = 0;
+    while (count > 0) {
+        // take what is available in the get area
+        if (const auto available = egptr() - gptr(); available > 0) {
+            const auto bytesToCopy = min<streamsize>(available, count);
+            memcpy(buffer + totalBytesRead, gptr(), static_cast<std::size_t>(bytesToCopy));
+            setg(eback(), gptr() + bytesToCopy, egptr());
+            totalBytesRead += bytesToCopy;
+            count -= bytesToCopy;
+            continue;
+        }
+        if (!m_buffer) {
+            break;
+        }
+        // read large chunks directly into the target buffer
+        if (static_cast<std::size_t>(count) >= m_bufferSize) {
+            const auto offset = currentOffset();
+            const auto bytesRead = m_source.read(offset, buffer + totalBytesRead, static_cast<std::size_t>(count));
+            m_bufferOffset = offset + bytesRead;
+            setg(m_buffer.get(), m_buffer.get(), m_buffer.get());
+            totalBytesRead += static_cast<streamsize>(bytesRead);
+            break;
+        }
+        // refill the buffer otherwise
+        if (traits_type::eq_int_type(underflow(), traits_type::eof())) {
+            break;
+        }
+    }
+    return totalBytesRead;
+}
+
+streamsize ByteSourceStreamBuffer::showmanyc()
+{
+    const auto size = m_source.size(), offset = currentOffset();
+    return offset < size ? static_cast<streamsize>(min<std::uint64_t>(size - offset, numeric_limits<streamsize>::max())) : -1;
+}
+
+ByteSourceStreamBuffer::pos_type ByteSourceStreamBuffer::seekoff(off_type off, ios_base::seekdir dir, ios_base::openmode which)
+{
+    if (!(which & ios_base::in)) {
+        return pos_type(off_type(-1));
+    }
+    const auto size = static_cast<off_type>(m_source.size());
+    const auto newOffset = off + (dir == ios_base::beg ? 0 : (dir == ios_base::cur ? static_cast<off_type>(currentOffset()) : size));
+    if (newOffset < 0 || newOffset > size) {
+        return pos_type(off_type(-1));
+    }
+    const auto bufferBegin = static_cast<off_type>(m_bufferOffset);
+    if (newOffset >= bufferBegin && newOffset <= bufferBegin + (egptr() - eback())) {
+        // keep buffered data if the new position is within the get area
+        setg(eback(), eback() + (newOffset - bufferBegin), egptr());
+    } else {
+        m_bufferOffset = static_cast<std::uint64_t>(newOffset);
+        setg(m_buffer.get(), m_buffer.get(), m_buffer.get());
+    }
+    return pos_type(newOffset);
+}
+
+ByteSourceStreamBuffer::pos_type ByteSourceStreamBuffer::seekpos(pos_type pos, ios_base::openmode which)
+{
+    return seekoff(off_type(pos), ios_base::beg, which);
+}
+
+} // namespace TagParser
@@ -0,0 +1,340 @@
+#ifndef TAG_PARSER_BYTESOURCE_H
+#define TAG_PARSER_BYTESOURCE_H
+
+#include "./global.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <limits>
+#include <map>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace TagParser {
+
+class TAG_PARSER_EXPORT ByteSource {
+public:
+    ByteSource() = default;
+    ByteSource(const ByteSource &) = delete;
+    ByteSource &operator=(const ByteSource &) = delete;
+    virtual ~ByteSource();
+
+    virtual std::uint64_t size() const = 0;
+    virtual std::size_t read(std::uint64_t offset, char *buffer, std::size_t count) = 0;
+    virtual std::string_view contiguousData() const;
+    virtual bool isForwardOnly() const;
+    virtual bool retain(std::uint64_t offset, std::uint64_t size);
+};
+
+class TAG_PARSER_EXPORT MemoryByteSource : public ByteSource {
+public:
+    explicit MemoryByteSource(std::string_view data);
+
+    std::uint64_t size() const override;
+    std::size_t read(std::uint64_t offset, char *buffer, std::size_t count) override;
+    std::string_view contiguousData() const override;
+
+private:
+    std::string_view m_data;
+};
+
+/*!
+ * \brief Constructs a new source for the specified \a data.
+ * \remarks The \a data is not copied and must outlive the source.
+ */
+inline MemoryByteSource::MemoryByteSource(std::string_view data)
+    : m_data(data)
+{
+}
+
+class TAG_PARSER_EXPORT BufferedRangeByteSource : public ByteSource {
+public:
+    explicit BufferedRangeByteSource(std::istream &stream, std::uint64_t offset, std::size_t length);
+
+    std::uint64_t size() const override;
+    std::size_t read(std::uint64_t offset, char *buffer, std::size_t count) override;
+
+    std::uint64_t offset() const;
+    std::size_t length() const;
+
+private:
+    std::istream &m_stream;
+    std::uint64_t m_size;
+    std::uint64_t m_offset;
+    std::string m_buffer;
+};
+
+/*!
+ * \brief Returns the offset of the range which is held in memory.
+ */
+inline std::uint64_t BufferedRangeByteSource::offset() const
+{
+    return m_offset;
+}
+
+/*!
+ * \brief Returns the length of the range which is held in memory.
+ */
+inline std::size_t BufferedRangeByteSource::length() const
+{
+    return m_buffer.size();
+}
+
+#ifdef PLATFORM_UNIX
+class TAG_PARSER_EXPORT FileDescriptorByteSource : public ByteSource {
+public:
+    explicit FileDescriptorByteSource(int fileDescriptor);
+
+    std::uint64_t size() const override;
+    std::size_t read(std::uint64_t offset, char *buffer, std::size_t count) override;
+
+private:
+    int m_fileDescriptor;
+    std::uint64_t m_size;
+};
+
+/*!
+ * \brief The AsyncReadRequest struct describes a read from a file descriptor submitted via AsyncFileReader::read().
+ */
+struct TAG_PARSER_EXPORT AsyncReadRequest {
+    /// \brief The file descriptor to read from.
+    int fileDescriptor = -1;
+    /// \brief The offset to start reading at.
+    std::uint64_t offset = 0;
+    /// \brief The buffer to read into; it must be able to hold \a count bytes.
+    char *buffer = nullptr;
+    /// \brief The number of bytes to read.
+    std::size_t count = 0;
+    /// \brief The number of bytes which have been read; only less than \a count if the end of the file has been reached or an error occurred.
+    std::size_t bytesRead = 0;
+    /// \brief The errno value of the error which occurred or zero if the read succeeded.
+    int error = 0;
+};
+
+class TAG_PARSER_EXPORT AsyncFileReader {
+public:
+    explicit AsyncFileReader(unsigned int queueDepth = 256);
+    AsyncFileReader(const AsyncFileReader &) = delete;
+    AsyncFileReader &operator=(const AsyncFileReader &) = delete;
+    ~AsyncFileReader();
+
+    bool isIoUringUsed() const;
+    unsigned int queueDepth() const;
+    void read(AsyncReadRequest *requests, std::size_t count);
+
+private:
+    struct Ring;
+
+    std::unique_ptr<Ring> m_ring;
+    unsigned int m_queueDepth;
+};
+
+/*!
+ * \brief Returns whether reads are submitted via io_uring.
+ * \remarks This is only the case if the library has been built with io_uring support and the kernel supports it; otherwise
+ *          the requests are read one after another via pread().
+ */
+inline bool AsyncFileReader::isIoUringUsed() const
+{
+    return m_ring != nullptr;
+}
+
+/*!
+ * \brief Returns the max. number of reads in flight.
+ */
+inline unsigned int AsyncFileReader::queueDepth() const
+{
+    return m_queueDepth;
+}
+#endif
+
+/*!
+ * \brief The ByteSourceStatistics struct holds statistics about reads from a byte source.
+ * \sa CoalescingByteSource::statistics()
+ */
+struct TAG_PARSER_EXPORT ByteSourceStatistics {
+    /// \brief The number of reads issued to the underlying source (e.g. range requests).
+    std::uint64_t roundTrips = 0;
+    /// \brief The number of bytes read from the underlying source.
+    std::uint64_t bytesFetched = 0;
+    /// \brief The number of reads which have been requested.
+    std::uint64_t reads = 0;
+    /// \brief The number of bytes which have been requested.
+    std::uint64_t bytesRequested = 0;
+    /// \brief The number of requested reads which could be served from the cache entirely.
+    std::uint64_t cacheHits = 0;
+};
+
+class TAG_PARSER_EXPORT CoalescingByteSource : public ByteSource {
+public:
+    explicit CoalescingByteSource(std::shared_ptr<ByteSource> source, std::size_t blockSize = 0x10000, std::uint64_t headSize = 0x40000,
+        std::uint64_t tailSize = 0x10000);
+
+    std::uint64_t size() const override;
+    std::size_t read(std::uint64_t offset, char *buffer, std::size_t count) override;
+
+    const std::shared_ptr<ByteSource> &source() const;
+    std::vector<std::pair<std::uint64_t, std::size_t>> prefetchRanges() const;
+    void insertPrefetchedRange(std::uint64_t offset, const char *data, std::size_t length);
+    std::size_t blockSize() const;
+    const ByteSourceStatistics &statistics() const;
+    void resetStatistics();
+    void clearCache();
+
+private:
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> prefetchBlockRanges() const;
+    void prefetchHeadAndTail();
+    void fetchBlocks(std::uint64_t firstBlock, std::uint64_t lastBlock);
+    void storeBlocks(std::uint64_t firstBlock, std::uint64_t lastBlock, const char *data);
+    std::size_t blockLength(std::uint64_t block) const;
+
+    std::shared_ptr<ByteSource> m_source;
+    std::uint64_t m_size;
+    std::size_t m_blockSize;
+    std::uint64_t m_headSize;
+    std::uint64_t m_tailSize;
+    std::unordered_map<std::uint64_t, std::unique_ptr<char[]>> m_blocks;
+    ByteSourceStatistics m_statistics;
+    bool m_prefetched;
+};
+
+/*!
+ * \brief Returns the underlying source.
+ */
+inline const std::shared_ptr<ByteSource> &CoalescingByteSource::source() const
+{
+    return m_source;
+}
+
+/*!
+ * \brief Returns the granularity of reads from the underlying source.
+ */
+inline std::size_t CoalescingByteSource::blockSize() const
+{
+    return m_blockSize;
+}
+
+/*!
+ * \brief Returns statistics about the reads so far, e.g. the number of round trips to the underlying source.
+ */
+inline const ByteSourceStatistics &CoalescingByteSource::statistics() const
+{
+    return m_statistics;
+}
+
+/*!
+ * \brief Resets the statistics.
+ */
+inline void CoalescingByteSource::resetStatistics()
+{
+    m_statistics = ByteSourceStatistics();
+}
+
+class TAG_PARSER_EXPORT ForwardOnlyByteSource : public ByteSource {
+public:
+    /// \brief The size to pass to the constructor if the size of the stream is not known upfront.
+    static constexpr std::uint64_t unknownSize = std::numeric_limits<std::uint64_t>::max();
+
+    explicit ForwardOnlyByteSource(std::istream &stream, std::uint64_t size = unknownSize, std::size_t lookbehindSize = 0x1000000);
+
+    std::uint64_t size() const override;
+    std::size_t read(std::uint64_t offset, char *buffer, std::size_t count) override;
+    bool isForwardOnly() const override;
+    bool retain(std::uint64_t offset, std::uint64_t size) override;
+
+    std::size_t lookbehindSize() const;
+    std::uint64_t bytesReceived() const;
+    std::uint64_t retainedSize() const;
+    bool isEndReached() const;
+
+private:
+    void receive(std::uint64_t offset, std::uint64_t endOffset);
+
+    std::istream &m_stream;
+    std::uint64_t m_size;
+    std::size_t m_lookbehindSize;
+    std::vector<char> m_buffer;
+    std::uint64_t m_bufferOffset;
+    std::map<std::uint64_t, std::vector<char>> m_retainedRanges;
+    std::uint64_t m_retainedSize;
+    bool m_endReached;
+};
+
+/*!
+ * \brief Returns the number of bytes in front of the most recent read which are kept at least.
+ */
+inline std::size_t ForwardOnlyByteSource::lookbehindSize() const
+{
+    return m_lookbehindSize;
+}
+
+/*!
+ * \brief Returns the number of bytes which have been taken from the stream so far (including skipped bytes).
+ */
+inline std::uint64_t ForwardOnlyByteSource::bytesReceived() const
+{
+    return m_bufferOffset + m_buffer.size();
+}
+
+/*!
+ * \brief Returns the number of bytes kept via retain().
+ */
+inline std::uint64_t ForwardOnlyByteSource::retainedSize() const
+{
+    return m_retainedSize;
+}
+
+/*!
+ * \brief Returns whether the end of the stream has been reached.
+ */
+inline bool ForwardOnlyByteSource::isEndReached() const
+{
+    return m_endReached;
+}
+
+class TAG_PARSER_EXPORT ByteSourceStreamBuffer : public std::streambuf {
+public:
+    explicit ByteSourceStreamBuffer(ByteSource &source, std::size_t bufferSize = 0x4000);
+
+    ByteSource &source();
+
+protected:
+    int_type underflow() override;
+    std::streamsize xsgetn(char_type *buffer, std::streamsize count) override;
+    std::streamsize showmanyc() override;
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+private:
+    std::uint64_t currentOffset() const;
+
+    ByteSource &m_source;
+    std::unique_ptr<char[]> m_buffer;
+    std::size_t m_bufferSize;
+    std::uint64_t m_bufferOffset;
+};
+
+/*!
+ * \brief Returns the source data is read from.
+ */
+inline ByteSource &ByteSourceStreamBuffer::source()
+{
+    return m_source;
+}
+
+/*!
+ * \brief Returns the offset of the next character within the source.
+ */
+inline std::uint64_t ByteSourceStreamBuffer::currentOffset() const
+{
+    return m_bufferOffset + static_cast<std::uint64_t>(gptr() - eback());
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_BYTESOURCE_H
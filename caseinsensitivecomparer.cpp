@@ -0,0 +1,95 @@
+#include "./caseinsensitivecomparer.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#define TAG_PARSER_CASEFOLD_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define TAG_PARSER_CASEFOLD_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace std;
+
+namespace TagParser {
+
+/// \cond
+namespace {
+
+/*!
+ * \brief Returns the number of leading bytes of \a lhs and \a rhs which are equal when ignoring the case.
+ * \remarks Compares 16 bytes at a time and stops at the first block containing a difference, so the returned number is
+ *          a multiple of 16 and the remaining bytes need to be compared individually. Only ASCII letters are folded
+ *          (like CaseInsensitiveCharComparer::toLower()); other bytes, including all non-ASCII ones, are compared as-is.
+ */
+std::size_t equalBlocks(const char *lhs, const char *rhs, std::size_t size)
+{
+    auto offset = std::size_t();
+#if defined(TAG_PARSER_CASEFOLD_SSE2)
+    const auto beforeA = _mm_set1_epi8('A' - 1), afterZ = _mm_set1_epi8('Z' + 1), caseBit = _mm_set1_epi8('a' - 'A');
+    const auto toLower = [&](__m128i chars) {
+        // bytes >= 0x80 are negative when compared as signed bytes so they are never considered upper case
+        const auto isUpper = _mm_and_si128(_mm_cmpgt_epi8(chars, beforeA), _mm_cmplt_epi8(chars, afterZ));
+        return _mm_or_si128(chars, _mm_and_si128(isUpper, caseBit));
+    };
+    for (; size - offset >= 16; offset += 16) {
+        const auto lhsChars = toLower(_mm_loadu_si128(reinterpret_cast<const __m128i *>(lhs + offset)));
+        const auto rhsChars = toLower(_mm_loadu_si128(reinterpret_cast<const __m128i *>(rhs + offset)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(lhsChars, rhsChars)) != 0xFFFF) {
+            break;
+        }
+    }
+#elif defined(TAG_PARSER_CASEFOLD_NEON)
+    const auto a = vdupq_n_u8('A'), range = vdupq_n_u8('Z' - 'A'), caseBit = vdupq_n_u8('a' - 'A');
+    const auto toLower = [&](uint8x16_t chars) { return vorrq_u8(chars, vandq_u8(vcleq_u8(vsubq_u8(chars, a), range), caseBit)); };
+    for (; size - offset >= 16; offset += 16) {
+        const auto lhsChars = toLower(vld1q_u8(reinterpret_cast<const std::uint8_t *>(lhs + offset)));
+        const auto rhsChars = toLower(vld1q_u8(reinterpret_cast<const std::uint8_t *>(rhs + offset)));
+        if (vminvq_u8(vceqq_u8(lhsChars, rhsChars)) != 0xFF) {
+            break;
+        }
+    }
+#else
+    CPP_UTILITIES_UNUSED(lhs)
+    CPP_UTILITIES_UNUSED(rhs)
+    CPP_UTILITIES_UNUSED(size)
+#endif
+    return offset;
+}
+
+} // namespace
+/// \endcond
+
+/*!
+ * \brief Returns whether the \a size bytes at \a lhs and \a rhs are equal when ignoring the case of ASCII letters.
+ */
+bool CaseInsensitiveCharComparer::equals(const char *lhs, const char *rhs, std::size_t size)
+{
+    for (auto i = equalBlocks(lhs, rhs, size); i != size; ++i) {
+        if (toLower(static_cast<unsigned char>(lhs[i])) != toLower(static_cast<unsigned char>(rhs[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief Compares the strings \a lhs and \a rhs lexicographically ignoring the case of ASCII letters.
+ * \returns Returns a negative value if \a lhs is less than \a rhs, a positive value if \a lhs is greater than \a rhs
+ *          and zero if both are equal.
+ */
+int CaseInsensitiveCharComparer::compare(const char *lhs, std::size_t lhsSize, const char *rhs, std::size_t rhsSize)
+{
+    const auto size = min(lhsSize, rhsSize);
+    for (auto i = equalBlocks(lhs, rhs, size); i != size; ++i) {
+        const auto lhsChar = toLower(static_cast<unsigned char>(lhs[i])), rhsChar = toLower(static_cast<unsigned char>(rhs[i]));
+        if (lhsChar != rhsChar) {
+            return lhsChar < rhsChar ? -1 : 1;
+        }
+    }
+    return lhsSize < rhsSize ? -1 : (lhsSize > rhsSize ? 1 : 0);
+}
+
+} // namespace TagParser
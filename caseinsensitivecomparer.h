@@ -3,10 +3,9 @@
 
 #include "./global.h"
 
+#include <cstddef>
 #include <string>
 
-#include <iostream>
-
 namespace TagParser {
 
 /*!
@@ -22,6 +21,9 @@ struct TAG_PARSER_EXPORT CaseInsensitiveCharComparer {
     {
         return toLower(lhs) < toLower(rhs);
     }
+
+    static bool equals(const char *lhs, const char *rhs, std::size_t size);
+    static int compare(const char *lhs, std::size_t lhsSize, const char *rhs, std::size_t rhsSize);
 };
 
 /*!
@@ -30,7 +32,7 @@ struct TAG_PARSER_EXPORT CaseInsensitiveCharComparer {
 struct TAG_PARSER_EXPORT CaseInsensitiveStringComparer {
     bool operator()(const std::string &lhs, const std::string &rhs) const
     {
-        return std::lexicographical_compare(lhs.cbegin(), lhs.cend(), rhs.cbegin(), rhs.cend(), CaseInsensitiveCharComparer());
+        return CaseInsensitiveCharComparer::compare(lhs.data(), lhs.size(), rhs.data(), rhs.size()) < 0;
     }
 };
 
@@ -0,0 +1,202 @@
+#include "./concurrencycontroller.h"
+
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+namespace TagParser {
+
+/*!
+ * \class TagParser::ConcurrencyController
+ * \brief The ConcurrencyController class adjusts the number of workers parsing files based on the observed throughput.
+ *
+ * A fixed number of workers is either too low for storage with a high latency (e.g. NFS, where many requests need to
+ * be in flight) or too high for local storage (where additional workers only compete for the CPU and the disk). The
+ * controller adjusts the number of workers similar to TCP congestion control adjusting its window:
+ *
+ * - The samples reported via addSample() are gathered in windows of at least one sample per allowed worker. At the end
+ *   of each window the throughput (files per second), the mean latency and the share of the latency spent reading
+ *   (the I/O ratio) are computed.
+ * - Like TCP Vegas, the number of files which are just queued (within the storage or waiting for the CPU) is estimated
+ *   from the lowest mean latency seen so far: by Little's law the number of files in progress which would be needed to
+ *   achieve the throughput without queueing is the throughput multiplied by that latency; the remaining workers are
+ *   considered queued.
+ * - Starting with initialParallelism workers, the number of workers is doubled as long as the throughput increases
+ *   ("slow start"). Afterwards it is increased by one per window while hardly any files are queued ("additive
+ *   increase") and decreased by one if many files are queued.
+ * - If the throughput decreases by more than 10 %, the number of workers is reduced to three quarters ("multiplicative
+ *   decrease") and slow start ends at half the previous number.
+ * - If the I/O ratio is below cpuBoundIoRatio, the files are CPU-bound and the number of workers is capped at
+ *   cpuParallelism().
+ *
+ * The workers call waitForTurn() before taking the next task; workers whose index is not less than parallelism() block
+ * until the number of workers is raised again or the run ends. BatchParser::runConcurrently() does this when a
+ * controller is passed.
+ *
+ * \remarks
+ * - All functions are thread-safe. A controller must not be used by multiple runs at the same time but it can be
+ *   reused for subsequent runs, e.g. for the batches of files read via AsyncFileReader.
+ * - The estimation assumes that the files processed within a run are of a similar kind. The lowest latency is
+ *   therefore only kept within a run.
+ */
+
+/*!
+ * \brief Constructs a new controller.
+ * \param maxParallelism Specifies the maximum number of workers; zero means four times the number of hardware threads.
+ * \param cpuParallelism Specifies the maximum number of workers for CPU-bound files; zero means the number of hardware
+ *                       threads.
+ */
+ConcurrencyController::ConcurrencyController(unsigned int maxParallelism, unsigned int cpuParallelism)
+    : m_cpuParallelism(cpuParallelism ? cpuParallelism : max(thread::hardware_concurrency(), 1u))
+    , m_slowStartThreshold(0)
+    , m_running(false)
+    , m_windowStart(chrono::steady_clock::now())
+    , m_windowSamples(0)
+    , m_windowLatency(chrono::nanoseconds::zero())
+    , m_windowIoTime(chrono::nanoseconds::zero())
+    , m_throughput(0.0)
+    , m_ioRatio(0.0)
+    , m_meanLatency(chrono::nanoseconds::zero())
+    , m_minLatency(chrono::nanoseconds::max())
+{
+    m_maxParallelism = maxParallelism ? maxParallelism : max(thread::hardware_concurrency(), 1u) * 4;
+    m_parallelism = min(initialParallelism, m_maxParallelism);
+    m_slowStartThreshold = m_maxParallelism;
+}
+
+/*!
+ * \brief Returns the number of workers which are currently allowed to run.
+ */
+unsigned int ConcurrencyController::parallelism() const
+{
+    const auto lock = lock_guard<mutex>(m_mutex);
+    return m_parallelism;
+}
+
+/*!
+ * \brief Returns the throughput (in files per second) of the last complete window or zero if there is none yet.
+ */
+double ConcurrencyController::throughput() const
+{
+    const auto lock = lock_guard<mutex>(m_mutex);
+    return m_throughput;
+}
+
+/*!
+ * \brief Returns the share of the latency spent reading within the last complete window.
+ */
+double ConcurrencyController::ioRatio() const
+{
+    const auto lock = lock_guard<mutex>(m_mutex);
+    return m_ioRatio;
+}
+
+/*!
+ * \brief Returns the mean latency of the files within the last complete window.
+ */
+std::chrono::nanoseconds ConcurrencyController::meanLatency() const
+{
+    const auto lock = lock_guard<mutex>(m_mutex);
+    return m_meanLatency;
+}
+
+/*!
+ * \brief Records that a file has been processed.
+ * \param latency Specifies the time it took to process the file.
+ * \param ioTime Specifies the part of \a latency spent reading (see MediaFileStatistics::readTime); might be zero if
+ *               unknown in which case the files are considered CPU-bound.
+ * \param now Specifies the time the file has been processed.
+ */
+void ConcurrencyController::addSample(std::chrono::nanoseconds latency, std::chrono::nanoseconds ioTime, std::chrono::steady_clock::time_point now)
+{
+    const auto lock = lock_guard<mutex>(m_mutex);
+    ++m_windowSamples;
+    m_windowLatency += latency;
+    m_windowIoTime += min(ioTime, latency);
+    if (m_windowSamples >= max<std::size_t>(m_parallelism, minWindowSize) && now > m_windowStart) {
+        adjust(now);
+    }
+}
+
+/*!
+ * \brief Adjusts the number of workers at the end of a window.
+ */
+void ConcurrencyController::adjust(std::chrono::steady_clock::time_point now)
+{
+    const auto elapsed = chrono::duration<double>(now - m_windowStart).count();
+    const auto throughput = static_cast<double>(m_windowSamples) / elapsed;
+    const auto meanLatency = m_windowLatency / static_cast<chrono::nanoseconds::rep>(m_windowSamples);
+    const auto ioRatio = m_windowLatency.count() ? static_cast<double>(m_windowIoTime.count()) / static_cast<double>(m_windowLatency.count()) : 0.0;
+    const auto previousParallelism = m_parallelism;
+    auto parallelism = m_parallelism;
+    m_minLatency = min(m_minLatency, meanLatency);
+    const auto queued = static_cast<double>(parallelism) - throughput * chrono::duration<double>(m_minLatency).count();
+    const auto fewQueued = max(1.0, parallelism / 8.0), manyQueued = max(2.0, parallelism / 4.0);
+
+    if (m_throughput > 0.0 && throughput < m_throughput * 0.9) {
+        // the throughput decreased (congestion): decrease multiplicatively
+        m_slowStartThreshold = max(parallelism / 2, 1u);
+        parallelism = max(min(parallelism - 1, parallelism * 3 / 4), 1u);
+    } else if (queued > manyQueued) {
+        // the files are just queued: step back and leave slow start
+        m_slowStartThreshold = min(m_slowStartThreshold, parallelism - 1);
+        parallelism = max(parallelism - 1, 1u);
+    } else if (parallelism < m_slowStartThreshold && (m_throughput <= 0.0 || throughput >= m_throughput * 1.05)) {
+        // the throughput still increases during slow start: grow exponentially
+        parallelism *= 2;
+    } else if (queued < fewQueued) {
+        // hardly any files are queued: grow linearly
+        m_slowStartThreshold = min(m_slowStartThreshold, parallelism);
+        parallelism += 1;
+    }
+    const auto cap = ioRatio < cpuBoundIoRatio ? min(m_cpuParallelism, m_maxParallelism) : m_maxParallelism;
+    m_parallelism = max(min(parallelism, cap), 1u);
+
+    m_throughput = throughput;
+    m_ioRatio = ioRatio;
+    m_meanLatency = meanLatency;
+    m_windowStart = now;
+    m_windowSamples = 0;
+    m_windowLatency = m_windowIoTime = chrono::nanoseconds::zero();
+    if (m_parallelism > previousParallelism) {
+        m_condition.notify_all();
+    }
+}
+
+/*!
+ * \brief Starts a run; waitForTurn() blocks workers beyond parallelism() until endRun() is called.
+ * \remarks The current window is restarted so the time between runs is not accounted and the lowest latency is
+ *          forgotten.
+ */
+void ConcurrencyController::beginRun()
+{
+    const auto lock = lock_guard<mutex>(m_mutex);
+    m_running = true;
+    m_minLatency = chrono::nanoseconds::max();
+    m_windowStart = chrono::steady_clock::now();
+    m_windowSamples = 0;
+    m_windowLatency = m_windowIoTime = chrono::nanoseconds::zero();
+}
+
+/*!
+ * \brief Blocks while the specified \a worker (starting at 0) is not allowed to run.
+ */
+void ConcurrencyController::waitForTurn(std::size_t worker)
+{
+    auto lock = unique_lock<mutex>(m_mutex);
+    m_condition.wait(lock, [this, worker] { return !m_running || worker < m_parallelism; });
+}
+
+/*!
+ * \brief Ends the run; all workers blocked within waitForTurn() resume.
+ * \remarks This is supposed to be called as soon as there are no further tasks.
+ */
+void ConcurrencyController::endRun()
+{
+    const auto lock = lock_guard<mutex>(m_mutex);
+    m_running = false;
+    m_condition.notify_all();
+}
+
+} // namespace TagParser
@@ -0,0 +1,75 @@
+#ifndef TAG_PARSER_CONCURRENCYCONTROLLER_H
+#define TAG_PARSER_CONCURRENCYCONTROLLER_H
+
+#include "./global.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace TagParser {
+
+class TAG_PARSER_EXPORT ConcurrencyController {
+public:
+    explicit ConcurrencyController(unsigned int maxParallelism = 0, unsigned int cpuParallelism = 0);
+
+    unsigned int maxParallelism() const;
+    unsigned int cpuParallelism() const;
+    unsigned int parallelism() const;
+    double throughput() const;
+    double ioRatio() const;
+    std::chrono::nanoseconds meanLatency() const;
+    void addSample(std::chrono::nanoseconds latency, std::chrono::nanoseconds ioTime,
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    void beginRun();
+    void waitForTurn(std::size_t worker);
+    void endRun();
+
+    /// \brief The initial number of workers which is doubled while the throughput increases ("slow start").
+    static constexpr unsigned int initialParallelism = 2;
+    /// \brief The minimum number of samples a window consists of (besides one sample per allowed worker).
+    static constexpr std::size_t minWindowSize = 4;
+    /// \brief The share of the latency spent reading below which files are considered CPU-bound.
+    static constexpr double cpuBoundIoRatio = 0.25;
+
+private:
+    void adjust(std::chrono::steady_clock::time_point now);
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    unsigned int m_maxParallelism;
+    unsigned int m_cpuParallelism;
+    unsigned int m_parallelism;
+    unsigned int m_slowStartThreshold;
+    bool m_running;
+    std::chrono::steady_clock::time_point m_windowStart;
+    std::size_t m_windowSamples;
+    std::chrono::nanoseconds m_windowLatency;
+    std::chrono::nanoseconds m_windowIoTime;
+    double m_throughput;
+    double m_ioRatio;
+    std::chrono::nanoseconds m_meanLatency;
+    std::chrono::nanoseconds m_minLatency;
+};
+
+/*!
+ * \brief Returns the maximum number of workers.
+ */
+inline unsigned int ConcurrencyController::maxParallelism() const
+{
+    return m_maxParallelism;
+}
+
+/*!
+ * \brief Returns the number of workers beyond which CPU-bound files are not parsed concurrently.
+ */
+inline unsigned int ConcurrencyController::cpuParallelism() const
+{
+    return m_cpuParallelism;
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_CONCURRENCYCONTROLLER_H
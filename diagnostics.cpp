@@ -1,5 +1,8 @@
 #include "./diagnostics.h"
 
+#include <mutex>
+#include <set>
+
 using namespace std;
 
 namespace TagParser {
@@ -14,6 +17,10 @@ namespace TagParser {
  * \brief The Diagnostics class is a container for DiagMessage.
  * \remarks A lot of methods in this library take such a container as argument. The method will add additional
  *          information, warnings or errors to it.
+ *
+ * When dealing with many (possibly malformed) files, creating messages can become noticeable. The cost can be reduced by
+ * setting a levelThreshold() to skip irrelevant messages and by setting DiagnosticsFlags::InternContexts and
+ * DiagnosticsFlags::NoTimestamps (see setFlags()).
  */
 
 /*!
@@ -38,9 +45,13 @@ const char *diagLevelName(DiagLevel diagLevel)
 
 /*!
  * \brief Returns whether there's at least one DiagMessage which is at least as worse as \a level.
+ * \remarks Messages passed to the sink() are considered as well.
  */
 bool Diagnostics::has(DiagLevel level) const
 {
+    if (m_sinkLevel >= level && m_sinkLevel != DiagLevel::None) {
+        return true;
+    }
     for (const auto &msg : *this) {
         if (msg.level() >= level) {
             return true;
@@ -50,11 +61,11 @@ bool Diagnostics::has(DiagLevel level) const
 }
 
 /*!
- * \brief Returns the worst diag level present in the container.
+ * \brief Returns the worst diag level present in the container (including messages passed to the sink()).
  */
 DiagLevel Diagnostics::level() const
 {
-    auto level = DiagLevel::None;
+    auto level = m_sinkLevel;
     for (const auto &msg : *this) {
         if ((level |= msg.level()) >= worstDiagLevel) {
             return level;
@@ -63,6 +74,139 @@ DiagLevel Diagnostics::level() const
     return level;
 }
 
+/*!
+ * \class DiagSink
+ * \brief The DiagSink class is the interface for processing messages as they are added to Diagnostics.
+ * \sa Diagnostics::setSink()
+ */
+
+/*!
+ * \brief Destroys the sink.
+ */
+DiagSink::~DiagSink()
+{
+}
+
+/*!
+ * \class CountingDiagSink
+ * \brief The CountingDiagSink class counts messages per level and keeps only the first few relevant messages.
+ */
+
+/*!
+ * \brief Constructs a new sink keeping the first \a maxKeptMessages messages of at least \a minKeptLevel.
+ */
+CountingDiagSink::CountingDiagSink(std::size_t maxKeptMessages, DiagLevel minKeptLevel)
+    : m_counts{}
+    , m_maxKeptMessages(maxKeptMessages)
+    , m_minKeptLevel(minKeptLevel)
+{
+}
+
+/*!
+ * \brief Counts the specified \a message and keeps it if it is relevant and the limit has not been reached yet.
+ */
+void CountingDiagSink::handle(DiagMessage &&message)
+{
+    ++m_counts[static_cast<std::size_t>(message.level())];
+    if (message.level() >= m_minKeptLevel && m_keptMessages.size() < m_maxKeptMessages) {
+        m_keptMessages.emplace_back(std::move(message));
+    }
+}
+
+/*!
+ * \brief Returns the number of messages handled so far.
+ */
+std::size_t CountingDiagSink::totalCount() const
+{
+    auto count = std::size_t();
+    for (const auto levelCount : m_counts) {
+        count += levelCount;
+    }
+    return count;
+}
+
+/*!
+ * \brief Resets the counts and discards the kept messages.
+ */
+void CountingDiagSink::clear()
+{
+    m_counts.fill(0);
+    m_keptMessages.clear();
+}
+
+/*!
+ * \class RingBufferDiagSink
+ * \brief The RingBufferDiagSink class keeps only the most recent messages.
+ */
+
+/*!
+ * \brief Constructs a new sink keeping the last \a capacity messages.
+ */
+RingBufferDiagSink::RingBufferDiagSink(std::size_t capacity)
+    : m_capacity(capacity)
+    , m_next(0)
+{
+    m_messages.reserve(capacity);
+}
+
+/*!
+ * \brief Keeps the specified \a message replacing the oldest message if the capacity has been reached.
+ */
+void RingBufferDiagSink::handle(DiagMessage &&message)
+{
+    if (!m_capacity) {
+        return;
+    }
+    if (m_messages.size() < m_capacity) {
+        m_messages.emplace_back(std::move(message));
+    } else {
+        m_messages[m_next] = std::move(message);
+    }
+    m_next = (m_next + 1) % m_capacity;
+}
+
+/*!
+ * \brief Returns the kept messages from the oldest to the most recent one.
+ */
+std::vector<DiagMessage> RingBufferDiagSink::messages() const
+{
+    auto messages = std::vector<DiagMessage>();
+    messages.reserve(m_messages.size());
+    const auto oldest = m_messages.size() < m_capacity ? m_messages.cbegin() : m_messages.cbegin() + static_cast<std::ptrdiff_t>(m_next);
+    messages.insert(messages.end(), oldest, m_messages.cend());
+    messages.insert(messages.end(), m_messages.cbegin(), oldest);
+    return messages;
+}
+
+/*!
+ * \brief Discards all kept messages.
+ */
+void RingBufferDiagSink::clear()
+{
+    m_messages.clear();
+    m_next = 0;
+}
+
+/*!
+ * \brief Returns a reference to an interned copy of the specified \a context.
+ *
+ * Equal contexts are only stored once for the lifetime of the program so messages can refer to them instead of storing a copy.
+ * This is used by Diagnostics if DiagnosticsFlags::InternContexts is set.
+ *
+ * \remarks This function is thread-safe. It is meant for contexts of which only a limited number of distinct values exist.
+ */
+const std::string &DiagMessage::internContext(std::string_view context)
+{
+    static auto mutex = std::mutex();
+    static auto contexts = std::set<std::string, std::less<>>();
+    const auto lock = std::lock_guard<std::mutex>(mutex);
+    auto i = contexts.find(context);
+    if (i == contexts.end()) {
+        i = contexts.emplace(context).first;
+    }
+    return *i;
+}
+
 /*!
  * \brief Concatenates the specified string \a values to a list.
  */
@@ -4,8 +4,14 @@
 #include "./global.h"
 
 #include <c++utilities/chrono/datetime.h>
+#include <c++utilities/misc/flagenumclass.h>
 
+#include <array>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace TagParser {
@@ -38,12 +44,14 @@ constexpr DiagLevel &operator|=(DiagLevel &lhs, const DiagLevel &rhs)
     return lhs;
 }
 
-class DiagMessage {
+class TAG_PARSER_EXPORT DiagMessage {
 public:
     DiagMessage(DiagLevel level, const std::string &message, const std::string &context);
     DiagMessage(DiagLevel level, std::string &&message, const std::string &context);
     DiagMessage(DiagLevel level, const std::string &message, std::string &&context);
     DiagMessage(DiagLevel level, std::string &&message, std::string &&context);
+    DiagMessage(DiagLevel level, std::string &&message, std::string &&context, CppUtilities::DateTime creationTime);
+    DiagMessage(DiagLevel level, std::string &&message, const std::string *internedContext, CppUtilities::DateTime creationTime);
 
     DiagLevel level() const;
     const char *levelName() const;
@@ -53,11 +61,13 @@ public:
     bool operator==(const DiagMessage &other) const;
 
     static std::string formatList(const std::vector<std::string> &values);
+    static const std::string &internContext(std::string_view context);
 
 private:
     DiagLevel m_level;
     std::string m_message;
     std::string m_context;
+    const std::string *m_internedContext;
     CppUtilities::DateTime m_creationTime;
 };
 
@@ -68,6 +78,7 @@ inline DiagMessage::DiagMessage(DiagLevel level, const std::string &message, con
     : m_level(level)
     , m_message(message)
     , m_context(context)
+    , m_internedContext(nullptr)
     , m_creationTime(CppUtilities::DateTime::gmtNow())
 {
 }
@@ -77,8 +88,9 @@ inline DiagMessage::DiagMessage(DiagLevel level, const std::string &message, con
  */
 inline DiagMessage::DiagMessage(DiagLevel level, std::string &&message, const std::string &context)
     : m_level(level)
-    , m_message(message)
+    , m_message(std::move(message))
     , m_context(context)
+    , m_internedContext(nullptr)
     , m_creationTime(CppUtilities::DateTime::gmtNow())
 {
 }
@@ -89,7 +101,8 @@ inline DiagMessage::DiagMessage(DiagLevel level, std::string &&message, const st
 inline DiagMessage::DiagMessage(DiagLevel level, const std::string &message, std::string &&context)
     : m_level(level)
     , m_message(message)
-    , m_context(context)
+    , m_context(std::move(context))
+    , m_internedContext(nullptr)
     , m_creationTime(CppUtilities::DateTime::gmtNow())
 {
 }
@@ -99,12 +112,38 @@ inline DiagMessage::DiagMessage(DiagLevel level, const std::string &message, std
  */
 inline DiagMessage::DiagMessage(DiagLevel level, std::string &&message, std::string &&context)
     : m_level(level)
-    , m_message(message)
-    , m_context(context)
+    , m_message(std::move(message))
+    , m_context(std::move(context))
+    , m_internedContext(nullptr)
     , m_creationTime(CppUtilities::DateTime::gmtNow())
 {
 }
 
+/*!
+ * \brief Constructs a new DiagMessage with the specified \a creationTime.
+ * \remarks A null DateTime can be specified to avoid querying the current time (see DiagnosticsFlags::NoTimestamps).
+ */
+inline DiagMessage::DiagMessage(DiagLevel level, std::string &&message, std::string &&context, CppUtilities::DateTime creationTime)
+    : m_level(level)
+    , m_message(std::move(message))
+    , m_context(std::move(context))
+    , m_internedContext(nullptr)
+    , m_creationTime(creationTime)
+{
+}
+
+/*!
+ * \brief Constructs a new DiagMessage referring to the specified \a internedContext instead of storing a copy of it.
+ * \remarks The \a internedContext must have been obtained via internContext().
+ */
+inline DiagMessage::DiagMessage(DiagLevel level, std::string &&message, const std::string *internedContext, CppUtilities::DateTime creationTime)
+    : m_level(level)
+    , m_message(std::move(message))
+    , m_internedContext(internedContext)
+    , m_creationTime(creationTime)
+{
+}
+
 /*!
  * \brief Returns the level.
  */
@@ -134,11 +173,12 @@ inline const std::string &DiagMessage::message() const
  */
 inline const std::string &DiagMessage::context() const
 {
-    return m_context;
+    return m_internedContext ? *m_internedContext : m_context;
 }
 
 /*!
  * \brief Returns the creation time (using GMT timezone).
+ * \remarks Returns a null DateTime if the message has been created by Diagnostics with DiagnosticsFlags::NoTimestamps.
  */
 inline const CppUtilities::DateTime &DiagMessage::creationTime() const
 {
@@ -150,7 +190,88 @@ inline const CppUtilities::DateTime &DiagMessage::creationTime() const
  */
 inline bool DiagMessage::operator==(const DiagMessage &other) const
 {
-    return m_level == other.m_level && m_message == other.m_message && m_context == other.m_context;
+    return m_level == other.m_level && m_message == other.m_message && context() == other.context();
+}
+
+/*!
+ * \brief The DiagnosticsFlags enum specifies how Diagnostics creates messages.
+ * \sa Diagnostics::setFlags()
+ */
+enum class DiagnosticsFlags : std::uint64_t {
+    None = 0, /**< messages store copies of their context and the time they have been created */
+    InternContexts = 1 << 0, /**< messages refer to an interned copy of their context (see DiagMessage::internContext()) */
+    NoTimestamps = 1 << 1, /**< the creation time of messages is not determined (DiagMessage::creationTime() returns a null DateTime) */
+    Cheap = InternContexts | NoTimestamps, /**< messages are created as cheap as possible */
+};
+
+} // namespace TagParser
+
+CPP_UTILITIES_MARK_FLAG_ENUM_CLASS(TagParser, TagParser::DiagnosticsFlags);
+
+namespace TagParser {
+
+class TAG_PARSER_EXPORT DiagSink {
+public:
+    virtual ~DiagSink();
+
+    /// \brief Handles the specified \a message which has been added to a Diagnostics object using the sink.
+    virtual void handle(DiagMessage &&message) = 0;
+};
+
+class TAG_PARSER_EXPORT CountingDiagSink : public DiagSink {
+public:
+    explicit CountingDiagSink(std::size_t maxKeptMessages = 0, DiagLevel minKeptLevel = DiagLevel::Critical);
+
+    void handle(DiagMessage &&message) override;
+    std::size_t count(DiagLevel level) const;
+    std::size_t totalCount() const;
+    const std::vector<DiagMessage> &keptMessages() const;
+    void clear();
+
+private:
+    std::array<std::size_t, static_cast<std::size_t>(worstDiagLevel) + 1> m_counts;
+    std::vector<DiagMessage> m_keptMessages;
+    std::size_t m_maxKeptMessages;
+    DiagLevel m_minKeptLevel;
+};
+
+/*!
+ * \brief Returns the number of messages of the specified \a level handled so far.
+ */
+inline std::size_t CountingDiagSink::count(DiagLevel level) const
+{
+    return m_counts[static_cast<std::size_t>(level)];
+}
+
+/*!
+ * \brief Returns the messages which have been kept (the first messages of at least the level specified when constructing the sink).
+ */
+inline const std::vector<DiagMessage> &CountingDiagSink::keptMessages() const
+{
+    return m_keptMessages;
+}
+
+class TAG_PARSER_EXPORT RingBufferDiagSink : public DiagSink {
+public:
+    explicit RingBufferDiagSink(std::size_t capacity);
+
+    void handle(DiagMessage &&message) override;
+    std::size_t capacity() const;
+    std::vector<DiagMessage> messages() const;
+    void clear();
+
+private:
+    std::vector<DiagMessage> m_messages;
+    std::size_t m_capacity;
+    std::size_t m_next;
+};
+
+/*!
+ * \brief Returns the maximum number of messages the sink keeps.
+ */
+inline std::size_t RingBufferDiagSink::capacity() const
+{
+    return m_capacity;
 }
 
 class TAG_PARSER_EXPORT Diagnostics : public std::vector<DiagMessage> {
@@ -160,6 +281,24 @@ public:
 
     bool has(DiagLevel level) const;
     DiagLevel level() const;
+    DiagnosticsFlags flags() const;
+    void setFlags(DiagnosticsFlags flags);
+    DiagLevel levelThreshold() const;
+    void setLevelThreshold(DiagLevel levelThreshold);
+    bool accepts(DiagLevel level) const;
+    DiagSink *sink() const;
+    void setSink(DiagSink *sink);
+    template <typename MessageType, typename ContextType> void emplace_back(DiagLevel level, MessageType &&message, ContextType &&context);
+    void push_back(const DiagMessage &message);
+    void push_back(DiagMessage &&message);
+
+private:
+    void add(DiagMessage &&message);
+
+    DiagSink *m_sink = nullptr;
+    DiagnosticsFlags m_flags = DiagnosticsFlags::None;
+    DiagLevel m_levelThreshold = DiagLevel::None;
+    DiagLevel m_sinkLevel = DiagLevel::None;
 };
 
 /*!
@@ -170,6 +309,149 @@ inline Diagnostics::Diagnostics(std::initializer_list<DiagMessage> list)
 {
 }
 
+/*!
+ * \brief Returns the flags controlling how messages are created.
+ */
+inline DiagnosticsFlags Diagnostics::flags() const
+{
+    return m_flags;
+}
+
+/*!
+ * \brief Sets the flags controlling how messages are created.
+ * \remarks Messages which have already been added are not affected.
+ */
+inline void Diagnostics::setFlags(DiagnosticsFlags flags)
+{
+    m_flags = flags;
+}
+
+/*!
+ * \brief Returns the level messages need to have at least to be added.
+ */
+inline DiagLevel Diagnostics::levelThreshold() const
+{
+    return m_levelThreshold;
+}
+
+/*!
+ * \brief Sets the level messages need to have at least to be added.
+ *
+ * Messages of a lower level are discarded by emplace_back() without even constructing them. By default, all messages are added.
+ *
+ * \remarks The library relies on critical messages to detect malformed files in some places (e.g. when applying changes) so it is
+ *          not recommended to set a threshold higher than DiagLevel::Critical.
+ */
+inline void Diagnostics::setLevelThreshold(DiagLevel levelThreshold)
+{
+    m_levelThreshold = levelThreshold;
+}
+
+/*!
+ * \brief Returns whether messages of the specified \a level are added (and not discarded due to the levelThreshold()).
+ */
+inline bool Diagnostics::accepts(DiagLevel level) const
+{
+    return level >= m_levelThreshold;
+}
+
+/*!
+ * \brief Returns the sink messages are passed to instead of storing them; nullptr if messages are stored (the default).
+ */
+inline DiagSink *Diagnostics::sink() const
+{
+    return m_sink;
+}
+
+/*!
+ * \brief Sets the \a sink messages are passed to instead of storing them.
+ *
+ * This allows processing messages as they are emitted (e.g. counting them) while memory usage stays flat regardless of how many
+ * messages are emitted. Specify nullptr to store messages again.
+ *
+ * \remarks
+ * - The sink is not owned by the Diagnostics object. It must stay alive as long as it is assigned.
+ * - The level() and has() functions still consider messages passed to the sink.
+ */
+inline void Diagnostics::setSink(DiagSink *sink)
+{
+    m_sink = sink;
+}
+
+/*!
+ * \brief Adds the specified \a message (or passes it to the sink()) unless it is below the levelThreshold().
+ * \remarks Hides std::vector::push_back() to consider the sink() and levelThreshold().
+ */
+inline void Diagnostics::push_back(const DiagMessage &message)
+{
+    if (accepts(message.level())) {
+        add(DiagMessage(message));
+    }
+}
+
+/*!
+ * \brief Adds the specified \a message (or passes it to the sink()) unless it is below the levelThreshold().
+ * \remarks Hides std::vector::push_back() to consider the sink() and levelThreshold().
+ */
+inline void Diagnostics::push_back(DiagMessage &&message)
+{
+    if (accepts(message.level())) {
+        add(std::move(message));
+    }
+}
+
+/*!
+ * \brief Adds a new DiagMessage with the specified \a level, \a message and \a context.
+ *
+ * The \a message might be specified as function returning the message. The function is only invoked if the message is actually
+ * added. This allows to defer expensive formatting, e.g.:
+ * ```
+ * diag.emplace_back(DiagLevel::Debug, [&] { return argsToString("Skipping ", size, " bytes at ", offset, '.'); }, context);
+ * ```
+ *
+ * \remarks
+ * - Hides std::vector::emplace_back() to apply the levelThreshold(), flags() and sink(). Use push_back() to add an existing
+ *   DiagMessage as-is.
+ * - Does nothing if \a level is below the levelThreshold().
+ */
+template <typename MessageType, typename ContextType>
+inline void Diagnostics::emplace_back(DiagLevel level, MessageType &&message, ContextType &&context)
+{
+    if (!accepts(level)) {
+        return;
+    }
+    auto messageString = [&]() -> std::string {
+        if constexpr (std::is_invocable_v<MessageType &>) {
+            return std::string(message());
+        } else {
+            return std::string(std::forward<MessageType>(message));
+        }
+    }();
+    const auto creationTime = m_flags & DiagnosticsFlags::NoTimestamps ? CppUtilities::DateTime() : CppUtilities::DateTime::gmtNow();
+    if (m_sink) {
+        add(m_flags & DiagnosticsFlags::InternContexts
+                ? DiagMessage(level, std::move(messageString), &DiagMessage::internContext(context), creationTime)
+                : DiagMessage(level, std::move(messageString), std::string(std::forward<ContextType>(context)), creationTime));
+    } else if (m_flags & DiagnosticsFlags::InternContexts) {
+        std::vector<DiagMessage>::emplace_back(level, std::move(messageString), &DiagMessage::internContext(context), creationTime);
+    } else {
+        std::vector<DiagMessage>::emplace_back(level, std::move(messageString), std::string(std::forward<ContextType>(context)), creationTime);
+    }
+}
+
+/*!
+ * \brief Stores the specified \a message or passes it to the sink().
+ */
+inline void Diagnostics::add(DiagMessage &&message)
+{
+    if (m_sink) {
+        m_sinkLevel |= message.level();
+        m_sink->handle(std::move(message));
+    } else {
+        std::vector<DiagMessage>::push_back(std::move(message));
+    }
+}
+
 } // namespace TagParser
 
 #endif // TAGPARSER_DIAGNOSTICS_H
@@ -0,0 +1,104 @@
+#include "./elementarena.h"
+
+using namespace std;
+
+namespace TagParser {
+
+/*!
+ * \class TagParser::ElementArena
+ * \brief The ElementArena class allocates the elements of a tree built by GenericFileElement.
+ *
+ * Parsing big files creates a huge number of small element objects. When an arena is used, these objects are placed
+ * one after another into big blocks instead of being allocated individually. Elements which are parsed after each other
+ * (e.g. the children of an element) are therefore laid out contiguously in memory. The destructors of the elements are
+ * still invoked as usual but their memory is only released at once when the arena is cleared or destroyed.
+ *
+ * The arena is owned by the container (see AbstractContainer::setElementArenaEnabled()). It must outlive all elements
+ * allocated by it.
+ */
+
+/*!
+ * \brief Returns \a size bytes of memory which stay valid until the arena is cleared or destroyed.
+ * \remarks The returned memory is aligned according to ElementArena::alignment.
+ */
+void *ElementArena::allocate(std::size_t size)
+{
+    size = (size + alignment - 1) & ~(alignment - 1);
+    if (size > m_remainingSize) {
+        // use a dedicated block for oversized allocations so the current block can still be used
+        if (size > blockSize / 4) {
+            m_oversizedBlocks.emplace_back(new char[size]);
+            m_allocatedBytes += size;
+            return m_oversizedBlocks.back().get();
+        }
+        // continue with the next block retained by rewind() or allocate a new one
+        if (m_nextBlockIndex == m_blocks.size()) {
+            m_blocks.emplace_back(new char[blockSize]);
+        }
+        m_current = m_blocks[m_nextBlockIndex++].get();
+        m_remainingSize = blockSize;
+    }
+    auto *const memory = m_current;
+    m_current += size;
+    m_remainingSize -= size;
+    m_allocatedBytes += size;
+    return memory;
+}
+
+/*!
+ * \brief Releases all memory allocated by the arena.
+ * \remarks All elements allocated by the arena must have been destroyed before.
+ */
+void ElementArena::clear()
+{
+    m_blocks.clear();
+    rewind();
+}
+
+/*!
+ * \brief Makes all memory allocated by the arena available again but keeps the blocks allocated.
+ *
+ * Subsequent calls of allocate() re-use the blocks so parsing many files of similar structure one after another
+ * reaches a steady state without allocating new blocks. Only blocks of oversized allocations are released.
+ *
+ * \remarks All elements allocated by the arena must have been destroyed before.
+ */
+void ElementArena::rewind()
+{
+    m_oversizedBlocks.clear();
+    m_nextBlockIndex = 0;
+    m_current = nullptr;
+    m_remainingSize = m_allocatedBytes = 0;
+}
+
+/*!
+ * \brief Allocates memory for an element of \a size bytes using the specified \a arena or the heap if \a arena is nullptr.
+ *
+ * The arena used for the allocation is stored in front of the element so deallocateElement() knows whether the memory
+ * needs to be released individually.
+ *
+ * \remarks This is used by the allocation functions of GenericFileElement.
+ */
+void *ElementArena::allocateElement(std::size_t size, ElementArena *arena)
+{
+    auto *const memory = static_cast<char *>(arena ? arena->allocate(alignment + size) : ::operator new(alignment + size));
+    *reinterpret_cast<ElementArena **>(memory) = arena;
+    return memory + alignment;
+}
+
+/*!
+ * \brief Deallocates memory allocated via allocateElement().
+ * \remarks Memory allocated by an arena is not released before the arena is cleared or destroyed.
+ */
+void ElementArena::deallocateElement(void *element)
+{
+    if (!element) {
+        return;
+    }
+    auto *const memory = static_cast<char *>(element) - alignment;
+    if (!*reinterpret_cast<ElementArena **>(memory)) {
+        ::operator delete(memory);
+    }
+}
+
+} // namespace TagParser
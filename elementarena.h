@@ -0,0 +1,72 @@
+#ifndef TAG_PARSER_ELEMENTARENA_H
+#define TAG_PARSER_ELEMENTARENA_H
+
+#include "./global.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace TagParser {
+
+class TAG_PARSER_EXPORT ElementArena {
+public:
+    ElementArena();
+    ElementArena(const ElementArena &) = delete;
+    ElementArena &operator=(const ElementArena &) = delete;
+
+    void *allocate(std::size_t size);
+    void clear();
+    void rewind();
+    std::size_t allocatedBytes() const;
+    std::size_t blockCount() const;
+
+    static void *allocateElement(std::size_t size, ElementArena *arena);
+    static void deallocateElement(void *element);
+
+    /// \brief The size of the blocks the arena allocates its memory in.
+    static constexpr std::size_t blockSize = 0x10000;
+    /// \brief The alignment of the memory returned by allocate().
+    static constexpr std::size_t alignment = alignof(std::max_align_t);
+
+private:
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    std::vector<std::unique_ptr<char[]>> m_oversizedBlocks;
+    std::size_t m_nextBlockIndex;
+    char *m_current;
+    std::size_t m_remainingSize;
+    std::size_t m_allocatedBytes;
+};
+
+/*!
+ * \brief Constructs a new, empty arena.
+ */
+inline ElementArena::ElementArena()
+    : m_nextBlockIndex(0)
+    , m_current(nullptr)
+    , m_remainingSize(0)
+    , m_allocatedBytes(0)
+{
+}
+
+/*!
+ * \brief Returns the number of bytes handed out by allocate() since the arena has been constructed or cleared.
+ */
+inline std::size_t ElementArena::allocatedBytes() const
+{
+    return m_allocatedBytes;
+}
+
+/*!
+ * \brief Returns the number of blocks allocated by the arena (including blocks retained by rewind()).
+ */
+inline std::size_t ElementArena::blockCount() const
+{
+    return m_blocks.size() + m_oversizedBlocks.size();
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_ELEMENTARENA_H
@@ -229,4 +229,75 @@ const char *NotImplementedException::what() const noexcept
     return "the operation has not been implemented yet";
 }
 
+/*!
+ * \class TagParser::RewriteRequiredException
+ * \brief This exception is thrown when changes can not be applied in-place although
+ *        this has been enforced via MediaFileInfo::setForceInPlace().
+ */
+
+/*!
+ * \brief Constructs a new exception.
+ */
+RewriteRequiredException::RewriteRequiredException() noexcept
+{
+}
+
+/*!
+ * \brief Destroys the exception.
+ */
+RewriteRequiredException::~RewriteRequiredException() noexcept
+{
+}
+
+/*!
+ * \brief Returns a C-style character string describing the cause of the exception.
+ */
+const char *RewriteRequiredException::what() const noexcept
+{
+    return "the file would need to be rewritten to apply the changes";
+}
+
+/*!
+ * \class TagParser::MemoryLimitExceededException
+ * \brief This exception is thrown when parsing would exceed the limit set via MediaFileInfo::setMemoryLimit().
+ */
+
+/*!
+ * \brief Constructs a new exception.
+ */
+MemoryLimitExceededException::MemoryLimitExceededException() noexcept
+{
+}
+
+/*!
+ * \brief Destroys the exception.
+ */
+MemoryLimitExceededException::~MemoryLimitExceededException() noexcept
+{
+}
+
+/*!
+ * \brief Returns a C-style character string describing the cause of the exception.
+ */
+const char *MemoryLimitExceededException::what() const noexcept
+{
+    return "the memory limit for parsing the file has been exceeded";
+}
+
+/*!
+ * \brief Throws the exception corresponding to the specified \a error; does nothing if \a error is ParsingError::None.
+ * \throws Throws InvalidDataException or TruncatedDataException according to \a error.
+ */
+void throwOnParsingError(ParsingError error)
+{
+    switch (error) {
+    case ParsingError::None:
+        break;
+    case ParsingError::InvalidData:
+        throw InvalidDataException();
+    case ParsingError::TruncatedData:
+        throw TruncatedDataException();
+    }
+}
+
 } // namespace TagParser
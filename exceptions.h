@@ -3,6 +3,7 @@
 
 #include "./global.h"
 
+#include <cstdint>
 #include <stdexcept>
 #include <string>
 
@@ -64,6 +65,36 @@ public:
     virtual const char *what() const noexcept;
 };
 
+class TAG_PARSER_EXPORT RewriteRequiredException : public Failure {
+public:
+    RewriteRequiredException() noexcept;
+    virtual ~RewriteRequiredException() noexcept;
+    virtual const char *what() const noexcept;
+};
+
+class TAG_PARSER_EXPORT MemoryLimitExceededException : public Failure {
+public:
+    MemoryLimitExceededException() noexcept;
+    virtual ~MemoryLimitExceededException() noexcept;
+    virtual const char *what() const noexcept;
+};
+
+/*!
+ * \brief The ParsingError enum specifies the error returned by non-throwing parsing functions.
+ *
+ * Functions like GenericFileElement::tryParse(), OggPage::tryParseHeader() and MpegAudioFrame::tryParseHeader() are used
+ * within loops which check many positions (e.g. when skipping junk or re-syncing) where throwing an exception for each
+ * position would be costly. Each value corresponds to the exception thrown by the throwing counterpart.
+ * \sa throwOnParsingError()
+ */
+enum class ParsingError : std::uint8_t {
+    None, /**< no error occurred */
+    InvalidData, /**< corresponds to InvalidDataException */
+    TruncatedData, /**< corresponds to TruncatedDataException */
+};
+
+TAG_PARSER_EXPORT void throwOnParsingError(ParsingError error);
+
 /*!
  * \brief Throws TruncatedDataException() if the specified \a sizeDenotation exceeds maxSize; otherwise maxSize is reduced by \a sizeDenotation.
  */
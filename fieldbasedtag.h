@@ -1,10 +1,12 @@
 #ifndef TAG_PARSER_FIELDBASEDTAG_H
 #define TAG_PARSER_FIELDBASEDTAG_H
 
+#include "./flatmultimap.h"
 #include "./tag.h"
 
 #include <functional>
 #include <map>
+#include <type_traits>
 
 namespace TagParser {
 
@@ -17,10 +19,34 @@ namespace TagParser {
 template <typename ImplementationType> class FieldMapBasedTagTraits {
 };
 
+/*!
+ * \brief Determines the type used by FieldMapBasedTag to store the fields of a tag with the specified \a TraitsType.
+ *
+ * The storage can be selected by defining `Storage` within the FieldMapBasedTagTraits specialization, e.g.
+ * `using Storage = FlatMultiMap<typename FieldType::IdentifierType, FieldType, Compare>`. If not defined,
+ * std::multimap is used.
+ */
+template <typename TraitsType, typename = void> struct FieldMapBasedTagStorage {
+    using type = std::multimap<typename TraitsType::FieldType::IdentifierType, typename TraitsType::FieldType, typename TraitsType::Compare>;
+};
+
+/// \cond
+template <typename TraitsType> struct FieldMapBasedTagStorage<TraitsType, std::void_t<typename TraitsType::Storage>> {
+    using type = typename TraitsType::Storage;
+};
+
+template <typename StorageType, typename = void> struct IsFieldMapBasedTagStorageReservable : std::false_type {
+};
+template <typename StorageType>
+struct IsFieldMapBasedTagStorageReservable<StorageType, std::void_t<decltype(std::declval<StorageType &>().reserve(std::size_t()))>>
+    : std::true_type {
+};
+/// \endcond
+
 /*!
  * \class TagParser::FieldMapBasedTag
  * \brief The FieldMapBasedTag provides a generic implementation of Tag which stores
- *        the tag fields using std::multimap.
+ *        the tag fields using std::multimap or a compatible container (see FieldMapBasedTagStorage).
  *
  * The FieldMapBasedTag class only provides the interface and common functionality.
  * It is meant to be subclassed using CRTP pattern.
@@ -35,6 +61,7 @@ public:
     using FieldType = typename FieldMapBasedTagTraits<ImplementationType>::FieldType;
     using IdentifierType = typename FieldMapBasedTagTraits<ImplementationType>::FieldType::IdentifierType;
     using Compare = typename FieldMapBasedTagTraits<ImplementationType>::Compare;
+    using StorageType = typename FieldMapBasedTagStorage<FieldMapBasedTagTraits<ImplementationType>>::type;
 
     FieldMapBasedTag();
 
@@ -52,8 +79,8 @@ public:
     bool hasField(KnownField field) const;
     bool hasField(const IdentifierType &id) const;
     void removeAllFields();
-    const std::multimap<IdentifierType, FieldType, Compare> &fields() const;
-    std::multimap<IdentifierType, FieldType, Compare> &fields();
+    const StorageType &fields() const;
+    StorageType &fields();
     unsigned int fieldCount() const;
     IdentifierType fieldId(KnownField value) const;
     KnownField knownField(const IdentifierType &id) const;
@@ -61,7 +88,11 @@ public:
     using Tag::proposedDataType;
     TagDataType proposedDataType(const IdentifierType &id) const;
     int insertFields(const FieldMapBasedTag<ImplementationType> &from, bool overwrite);
+    int insertFields(FieldMapBasedTag<ImplementationType> &&from, bool overwrite);
     unsigned int insertValues(const Tag &from, bool overwrite);
+    unsigned int insertValues(Tag &&from, bool overwrite);
+    unsigned int assignValues(std::vector<std::pair<KnownField, TagValue>> &&values);
+    unsigned int assignValues(std::vector<std::pair<IdentifierType, TagValue>> &&values);
     void ensureTextValuesAreProperlyEncoded();
 
 protected:
@@ -71,13 +102,17 @@ protected:
     std::vector<const TagValue *> internallyGetValues(const IdentifierType &id) const;
     bool internallySetValue(const IdentifierType &id, const TagValue &value);
     bool internallySetValues(const IdentifierType &id, const std::vector<TagValue> &values);
+    bool internallyAssignValue(KnownField field, TagValue &&value);
     bool internallyHasField(const IdentifierType &id) const;
     // no default implementation: IdentifierType internallyGetFieldId(KnownField field) const;
     // no default implementation: KnownField internallyGetKnownField(const IdentifierType &id) const;
     TagDataType internallyGetProposedDataType(const IdentifierType &id) const;
 
 private:
-    std::multimap<IdentifierType, FieldType, Compare> m_fields;
+    bool assignValue(const IdentifierType &id, TagValue &&value);
+    void reserveFields(std::size_t additionalFields);
+
+    StorageType m_fields;
 };
 
 /*!
@@ -210,23 +245,29 @@ bool FieldMapBasedTag<ImplementationType>::internallySetValues(const FieldMapBas
             ++range.first;
         }
     }
-    // add remaining specified values (there are more specified values than existing ones)
-    for (; valuesIterator != values.cend(); ++valuesIterator) {
-        m_fields.insert(std::make_pair(id, FieldType(id, *valuesIterator)));
-    }
     // remove remaining existing values (there are more existing values than specified ones)
     for (; range.first != range.second; ++range.first) {
         range.first->second.setValue(TagValue());
     }
+    // add remaining specified values (there are more specified values than existing ones)
+    // note: Inserting is done last as it might invalidate the iterators of range.
+    for (; valuesIterator != values.cend(); ++valuesIterator) {
+        m_fields.insert(std::make_pair(id, FieldType(id, *valuesIterator)));
+    }
     return true;
 }
 
 /*!
  * \brief Assigns the given \a value to the field with the specified \a id.
+ * \remarks The tag is only marked as modified if \a value is not identical to the present value (see TagValue::isIdentical()).
  * \sa Tag::setValue()
  */
 template <class ImplementationType> bool FieldMapBasedTag<ImplementationType>::setValue(const IdentifierType &id, const TagParser::TagValue &value)
 {
+    if (value.isEmpty() ? !hasField(id) : this->value(id).isIdentical(value)) {
+        return value.isEmpty() ? m_fields.find(id) != m_fields.end() : true;
+    }
+    m_modified = true;
     return static_cast<ImplementationType *>(this)->internallySetValue(id, value);
 }
 
@@ -239,6 +280,24 @@ template <class ImplementationType> bool FieldMapBasedTag<ImplementationType>::s
 template <class ImplementationType>
 bool FieldMapBasedTag<ImplementationType>::setValues(const IdentifierType &id, const std::vector<TagValue> &values)
 {
+    // don't mark the tag as modified if the non-empty values are identical to the present ones
+    const auto presentValues = this->values(id);
+    auto presentValue = presentValues.cbegin();
+    auto identical = true;
+    for (const auto &value : values) {
+        if (value.isEmpty()) {
+            continue;
+        }
+        if (presentValue == presentValues.cend() || !(*presentValue)->isIdentical(value)) {
+            identical = false;
+            break;
+        }
+        ++presentValue;
+    }
+    if (identical && presentValue == presentValues.cend()) {
+        return true;
+    }
+    m_modified = true;
     return static_cast<ImplementationType *>(this)->internallySetValues(id, values);
 }
 
@@ -282,23 +341,30 @@ template <class ImplementationType> inline bool FieldMapBasedTag<ImplementationT
 
 template <class ImplementationType> inline void FieldMapBasedTag<ImplementationType>::removeAllFields()
 {
-    m_fields.clear();
+    if (!m_fields.empty()) {
+        m_fields.clear();
+        m_modified = true;
+    }
 }
 
 /*!
  * \brief Returns the fields of the tag by providing direct access to the field map of the tag.
+ * \remarks Depending on the StorageType, inserting and removing fields might invalidate iterators and references to other fields.
  */
 template <class ImplementationType>
-inline auto FieldMapBasedTag<ImplementationType>::fields() const -> const std::multimap<IdentifierType, FieldType, Compare> &
+inline auto FieldMapBasedTag<ImplementationType>::fields() const -> const StorageType &
 {
     return m_fields;
 }
 
 /*!
  * \brief Returns the fields of the tag by providing direct access to the field map of the tag.
+ * \remarks Marks the tag as modified (see Tag::isModified()) as changes made via the returned map can not be tracked. Use
+ *          the const overload to only read the fields.
  */
-template <class ImplementationType> inline auto FieldMapBasedTag<ImplementationType>::fields() -> std::multimap<IdentifierType, FieldType, Compare> &
+template <class ImplementationType> inline auto FieldMapBasedTag<ImplementationType>::fields() -> StorageType &
 {
+    m_modified = true;
     return m_fields;
 }
 
@@ -372,7 +438,7 @@ int FieldMapBasedTag<ImplementationType>::insertFields(const FieldMapBasedTag<Im
             continue;
         }
         bool fieldInserted = false;
-        auto range = fields().equal_range(fromField.id());
+        auto range = m_fields.equal_range(fromField.id());
         for (auto i = range.first; i != range.second; ++i) {
             FieldType &ownField = i->second;
             if ((fromField.isTypeInfoAssigned() && ownField.isTypeInfoAssigned() && fromField.typeInfo() == ownField.typeInfo())
@@ -386,10 +452,68 @@ int FieldMapBasedTag<ImplementationType>::insertFields(const FieldMapBasedTag<Im
             }
         }
         if (!fieldInserted) {
-            fields().insert(std::make_pair(fromField.id(), fromField));
+            m_fields.insert(std::make_pair(fromField.id(), fromField));
             ++fieldsInserted;
         }
     }
+    if (fieldsInserted) {
+        m_modified = true;
+    }
+    return fieldsInserted;
+}
+
+/*!
+ * \brief Inserts all fields \a from another tag of the same field type and compare function.
+ *
+ * Works like the overload taking a const reference but the fields are moved instead of copied. So big values
+ * (e.g. cover art) are not copied. If several fields of this tag are overwritten by the same field, only the
+ * first of them takes over its value; the others get a copy.
+ *
+ * \param from Specifies the tag the fields should be inserted from. It is left without any fields.
+ * \param overwrite Indicates whether existing fields should be overwritten.
+ * \return Returns the number of fields that have been inserted.
+ */
+template <class ImplementationType>
+int FieldMapBasedTag<ImplementationType>::insertFields(FieldMapBasedTag<ImplementationType> &&from, bool overwrite)
+{
+    if (&from == this) {
+        return 0;
+    }
+    int fieldsInserted = 0;
+    for (auto &pair : from.m_fields) {
+        FieldType &fromField = pair.second;
+        if (fromField.value().isEmpty()) {
+            continue;
+        }
+        FieldType *takenOver = nullptr;
+        bool fieldInserted = false;
+        auto range = m_fields.equal_range(fromField.id());
+        for (auto i = range.first; i != range.second; ++i) {
+            FieldType &ownField = i->second;
+            if ((fromField.isTypeInfoAssigned() && ownField.isTypeInfoAssigned() && fromField.typeInfo() == ownField.typeInfo())
+                || (!fromField.isTypeInfoAssigned() && !ownField.isTypeInfoAssigned())) {
+                if (overwrite || ownField.value().isEmpty()) {
+                    if (takenOver) {
+                        ownField = *takenOver;
+                    } else {
+                        ownField = std::move(fromField);
+                        takenOver = &ownField;
+                    }
+                    ++fieldsInserted;
+                }
+                fieldInserted = true;
+            }
+        }
+        if (!fieldInserted) {
+            const auto id = fromField.id();
+            m_fields.insert(std::make_pair(id, std::move(fromField)));
+            ++fieldsInserted;
+        }
+    }
+    from.removeAllFields();
+    if (fieldsInserted) {
+        m_modified = true;
+    }
     return fieldsInserted;
 }
 
@@ -403,6 +527,107 @@ template <class ImplementationType> unsigned int FieldMapBasedTag<Implementation
     }
 }
 
+/*!
+ * \brief Moves all compatible values \a from another Tag into this tag.
+ *
+ * If \a from is of the same type, the fields are moved directly (see insertFields()). Otherwise the values are
+ * moved like Tag::insertValues() does.
+ *
+ * \sa Tag::insertValues()
+ */
+template <class ImplementationType> unsigned int FieldMapBasedTag<ImplementationType>::insertValues(Tag &&from, bool overwrite)
+{
+    if (type() == from.type()) {
+        // the tags are of the same type, we can move the fields directly
+        return static_cast<unsigned int>(insertFields(static_cast<FieldMapBasedTag<ImplementationType> &&>(from), overwrite));
+    }
+    return Tag::insertValues(std::move(from), overwrite);
+}
+
+/*!
+ * \brief Assigns the specified \a values to the corresponding fields at once.
+ *
+ * Works like Tag::assignValues() but the values are moved into the fields and storage for new fields is reserved
+ * only once (if supported by the StorageType).
+ *
+ * \sa Tag::assignValues()
+ */
+template <class ImplementationType>
+unsigned int FieldMapBasedTag<ImplementationType>::assignValues(std::vector<std::pair<KnownField, TagValue>> &&values)
+{
+    convertValuesForTag(values);
+    reserveFields(values.size());
+    unsigned int count = 0;
+    for (auto &[field, value] : values) {
+        if (static_cast<ImplementationType *>(this)->internallyAssignValue(field, std::move(value))) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+/*!
+ * \brief Assigns the specified \a values to the fields with the corresponding IDs at once.
+ *
+ * Works like the overload taking KnownField values but like setValue(const IdentifierType &, const TagValue &)
+ * no special handling for particular fields is applied.
+ *
+ * \sa Tag::assignValues()
+ */
+template <class ImplementationType>
+unsigned int FieldMapBasedTag<ImplementationType>::assignValues(std::vector<std::pair<IdentifierType, TagValue>> &&values)
+{
+    convertValuesForTag(values);
+    reserveFields(values.size());
+    unsigned int count = 0;
+    for (auto &[id, value] : values) {
+        if (assignValue(id, std::move(value))) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+/*!
+ * \brief Default implementation for assigning a single value via assignValues().
+ * \remarks Shadow in subclass to provide custom implementation (e.g. if setValue() applies special handling to the
+ *          specified \a field).
+ */
+template <class ImplementationType> bool FieldMapBasedTag<ImplementationType>::internallyAssignValue(KnownField field, TagValue &&value)
+{
+    return assignValue(fieldId(field), std::move(value));
+}
+
+/*!
+ * \brief Assigns the specified \a value like setValue() but moves it into the field.
+ */
+template <class ImplementationType> bool FieldMapBasedTag<ImplementationType>::assignValue(const IdentifierType &id, TagValue &&value)
+{
+    const auto i = m_fields.find(id);
+    if (value.isEmpty() ? !hasField(id) : (i != m_fields.end() && i->second.value().isIdentical(value))) {
+        return i != m_fields.end();
+    }
+    m_modified = true;
+    if (i != m_fields.end()) {
+        i->second.setValue(std::move(value));
+    } else {
+        auto field = FieldType(id, TagValue());
+        field.setValue(std::move(value));
+        m_fields.insert(std::make_pair(id, std::move(field)));
+    }
+    return true;
+}
+
+/*!
+ * \brief Reserves storage for the specified number of \a additionalFields if supported by the StorageType.
+ */
+template <class ImplementationType> inline void FieldMapBasedTag<ImplementationType>::reserveFields(std::size_t additionalFields)
+{
+    if constexpr (IsFieldMapBasedTagStorageReservable<StorageType>::value) {
+        m_fields.reserve(m_fields.size() + additionalFields);
+    }
+}
+
 template <class ImplementationType> void FieldMapBasedTag<ImplementationType>::ensureTextValuesAreProperlyEncoded()
 {
     for (auto &field : fields()) {
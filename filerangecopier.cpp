@@ -0,0 +1,1259 @@
+#include "./filerangecopier.h"
+#include "./basicfileinfo.h"
+#include "./progressfeedback.h"
+
+#include <c++utilities/conversion/stringconversion.h>
+#include <c++utilities/io/copy.h>
+
+#ifdef PLATFORM_LINUX
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+#elif defined(PLATFORM_MAC)
+#include <fcntl.h>
+#include <sys/clonefile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(PLATFORM_WINDOWS)
+#include <fcntl.h>
+#include <io.h>
+#include <windows.h>
+#include <winioctl.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+/*!
+ * \class TagParser::FileRangeCopier
+ * \brief The FileRangeCopier class copies ranges between two files without passing the data through userspace if possible.
+ *
+ * When rewriting a file, the media data of the original file is copied unchanged into the new file. Under Linux this
+ * class uses FICLONERANGE to share the extents of both files (on file systems supporting reflinks such as Btrfs and XFS)
+ * and copy_file_range() otherwise. On other platforms and if the kernel or file system supports none of these, the
+ * data is copied through a buffer as usual.
+ *
+ * The copier is associated with a source and a target stream. Copies between other streams (e.g. buffers) are
+ * always done in userspace.
+ *
+ * If the kernel can not copy the data (e.g. across file systems on older kernels), big ranges are copied via direct I/O
+ * instead: A reader thread fills big aligned buffers while the calling thread writes the previously filled one. This
+ * gives a steady throughput and bypasses the page cache.
+ *
+ * Under Linux the copier also tells the kernel how the files are accessed: The source is read sequentially and the next
+ * range is read ahead while the current one is copied. Copied ranges are dropped from the page cache because they are
+ * not going to be read again, so rewriting big files does not evict the data cached for other processes.
+ *
+ * Under Windows the copier uses block cloning (FSCTL_DUPLICATE_EXTENTS_TO_FILE) on file systems supporting it (ReFS)
+ * instead of FICLONERANGE. There is no counterpart of copy_file_range() for ranges, so big ranges which can not be
+ * cloned are copied via unbuffered, overlapped I/O (the counterpart of direct I/O): the next block is read while the
+ * previous one is written. The file descriptors are CRT file descriptors wrapping the handles in this case.
+ *
+ * Under macOS whole files are cloned via clonefile() on APFS (see cloneFile()). Ranges can not be cloned, so big ranges
+ * are copied like under Linux but via file descriptors for which the page cache has been turned off (F_NOCACHE).
+ */
+
+#ifdef PLATFORM_WINDOWS
+/// \cond
+namespace {
+
+/// \brief The max. number of bytes cloned via FSCTL_DUPLICATE_EXTENTS_TO_FILE at once (it must be less than 4 GiB).
+constexpr std::uint64_t maxDuplicateExtentsSize = 0x40000000;
+
+/*!
+ * \brief Converts the specified UTF-8 encoded \a path to UTF-16 as required by the wide Windows API.
+ */
+std::unique_ptr<wchar_t[]> widePath(const std::string &path)
+{
+    auto ec = std::error_code();
+    auto res = convertMultiByteToWide(ec, BasicFileInfo::pathForOpen(path));
+    return ec ? nullptr : std::move(res);
+}
+
+/*!
+ * \brief Opens the file at \a path via CreateFileW() and wraps the handle in a CRT file descriptor.
+ * \returns Returns the file descriptor (which is closed via ::_close()) or -1 if the file could not be opened.
+ */
+int openFileDescriptor(const std::string &path, DWORD access, DWORD flags, DWORD disposition = OPEN_EXISTING)
+{
+    const auto nativePath = widePath(path);
+    if (!nativePath) {
+        return -1;
+    }
+    const auto handle = ::CreateFileW(
+        nativePath.get(), access, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, disposition, flags, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return -1;
+    }
+    const auto fileDescriptor = ::_open_osfhandle(reinterpret_cast<intptr_t>(handle), access & GENERIC_WRITE ? 0 : _O_RDONLY);
+    if (fileDescriptor < 0) {
+        ::CloseHandle(handle);
+    }
+    return fileDescriptor;
+}
+
+/*!
+ * \brief Returns the handle wrapped by the specified CRT file descriptor.
+ */
+HANDLE handleOf(int fileDescriptor)
+{
+    return reinterpret_cast<HANDLE>(::_get_osfhandle(fileDescriptor));
+}
+
+/*!
+ * \brief Sets the file offset of the specified \a overlapped structure.
+ */
+void setOffset(OVERLAPPED &overlapped, std::uint64_t offset)
+{
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+}
+
+/*!
+ * \brief Determines the size of the file opened via \a handle.
+ */
+bool fileSize(HANDLE handle, std::uint64_t &size)
+{
+    auto res = LARGE_INTEGER();
+    if (!::GetFileSizeEx(handle, &res)) {
+        return false;
+    }
+    size = static_cast<std::uint64_t>(res.QuadPart);
+    return true;
+}
+
+/*!
+ * \brief Sets the size of the file opened via \a handle (which must have been opened for writing).
+ */
+bool setFileSize(HANDLE handle, std::uint64_t size)
+{
+    auto info = FILE_END_OF_FILE_INFO();
+    info.EndOfFile.QuadPart = static_cast<LONGLONG>(size);
+    return ::SetFileInformationByHandle(handle, FileEndOfFileInfo, &info, sizeof(info));
+}
+
+/*!
+ * \brief Returns the cluster size block cloning works with for the file opened via \a handle.
+ * \returns Returns zero if the file system does not support block cloning. Otherwise \a integrity is set to the integrity
+ *          information of the file (if specified).
+ */
+std::uint64_t cloneClusterSize(HANDLE handle, FSCTL_GET_INTEGRITY_INFORMATION_BUFFER *integrity = nullptr)
+{
+#if defined(FSCTL_DUPLICATE_EXTENTS_TO_FILE) && defined(FILE_SUPPORTS_BLOCK_REFCOUNTING)
+    auto fileSystemFlags = DWORD();
+    if (!::GetVolumeInformationByHandleW(handle, nullptr, 0, nullptr, nullptr, &fileSystemFlags, nullptr, 0)
+        || !(fileSystemFlags & FILE_SUPPORTS_BLOCK_REFCOUNTING)) {
+        return 0;
+    }
+    auto info = FSCTL_GET_INTEGRITY_INFORMATION_BUFFER();
+    auto bytesReturned = DWORD();
+    if (!::DeviceIoControl(handle, FSCTL_GET_INTEGRITY_INFORMATION, nullptr, 0, &info, sizeof(info), &bytesReturned, nullptr)) {
+        return 0;
+    }
+    if (integrity) {
+        *integrity = info;
+    }
+    return info.ClusterSizeInBytes;
+#else
+    CPP_UTILITIES_UNUSED(handle);
+    CPP_UTILITIES_UNUSED(integrity);
+    return 0;
+#endif
+}
+
+/*!
+ * \brief Clones the specified range via FSCTL_DUPLICATE_EXTENTS_TO_FILE.
+ * \remarks The offsets and \a count must be aligned to the cluster size and the target file must already extend over
+ *          the target range.
+ */
+bool duplicateExtents(HANDLE sourceHandle, std::uint64_t sourceOffset, HANDLE targetHandle, std::uint64_t targetOffset, std::uint64_t count)
+{
+#ifdef FSCTL_DUPLICATE_EXTENTS_TO_FILE
+    for (std::uint64_t cloned = 0; cloned < count;) {
+        const auto size = min(count - cloned, maxDuplicateExtentsSize);
+        auto data = DUPLICATE_EXTENTS_DATA();
+        data.FileHandle = sourceHandle;
+        data.SourceFileOffset.QuadPart = static_cast<LONGLONG>(sourceOffset + cloned);
+        data.TargetFileOffset.QuadPart = static_cast<LONGLONG>(targetOffset + cloned);
+        data.ByteCount.QuadPart = static_cast<LONGLONG>(size);
+        auto bytesReturned = DWORD();
+        if (!::DeviceIoControl(targetHandle, FSCTL_DUPLICATE_EXTENTS_TO_FILE, &data, sizeof(data), nullptr, 0, &bytesReturned, nullptr)) {
+            return false;
+        }
+        cloned += size;
+    }
+    return true;
+#else
+    CPP_UTILITIES_UNUSED(sourceHandle);
+    CPP_UTILITIES_UNUSED(sourceOffset);
+    CPP_UTILITIES_UNUSED(targetHandle);
+    CPP_UTILITIES_UNUSED(targetOffset);
+    CPP_UTILITIES_UNUSED(count);
+    return false;
+#endif
+}
+
+/*!
+ * \brief Copies the specified (small) range between the specified synchronous handles via ReadFile() and WriteFile().
+ * \returns Returns whether the whole range could be copied.
+ */
+bool copyBetweenHandles(HANDLE sourceHandle, std::uint64_t sourceOffset, HANDLE targetHandle, std::uint64_t targetOffset, std::uint64_t count)
+{
+    char buffer[FileRangeCopier::directIoAlignment];
+    for (std::uint64_t copied = 0; copied < count;) {
+        auto overlapped = OVERLAPPED();
+        auto bytesRead = DWORD(), bytesWritten = DWORD();
+        setOffset(overlapped, sourceOffset + copied);
+        if (!::ReadFile(sourceHandle, buffer, static_cast<DWORD>(min<std::uint64_t>(count - copied, sizeof(buffer))), &bytesRead, &overlapped)
+            || !bytesRead) {
+            return false;
+        }
+        overlapped = OVERLAPPED();
+        setOffset(overlapped, targetOffset + copied);
+        if (!::WriteFile(targetHandle, buffer, bytesRead, &bytesWritten, &overlapped) || bytesWritten != bytesRead) {
+            return false;
+        }
+        copied += bytesRead;
+    }
+    return true;
+}
+
+/*!
+ * \brief The OverlappedTransfer struct holds an asynchronous read or write on a handle opened via FILE_FLAG_OVERLAPPED.
+ * \remarks A pending transfer is cancelled when the object is destroyed. So it must be destroyed before its buffer.
+ */
+struct OverlappedTransfer {
+    OverlappedTransfer();
+    OverlappedTransfer(const OverlappedTransfer &) = delete;
+    ~OverlappedTransfer();
+    bool start(HANDLE handle, char *buffer, std::uint64_t size, std::uint64_t offset, bool write);
+    std::uint64_t finish();
+
+    OVERLAPPED overlapped;
+    HANDLE handle = nullptr;
+    bool pending = false;
+};
+
+OverlappedTransfer::OverlappedTransfer()
+    : overlapped()
+{
+    overlapped.hEvent = ::CreateEventW(nullptr, TRUE, FALSE, nullptr);
+}
+
+OverlappedTransfer::~OverlappedTransfer()
+{
+    if (pending) {
+        ::CancelIoEx(handle, &overlapped);
+        finish();
+    }
+    if (overlapped.hEvent) {
+        ::CloseHandle(overlapped.hEvent);
+    }
+}
+
+/*!
+ * \brief Starts reading/writing \a size bytes at \a offset.
+ * \returns Returns whether the transfer could be started; finish() returns zero if not.
+ */
+bool OverlappedTransfer::start(HANDLE handle, char *buffer, std::uint64_t size, std::uint64_t offset, bool write)
+{
+    const auto event = overlapped.hEvent;
+    overlapped = OVERLAPPED();
+    overlapped.hEvent = event;
+    setOffset(overlapped, offset);
+    this->handle = handle;
+    const auto res = write ? ::WriteFile(handle, buffer, static_cast<DWORD>(size), nullptr, &overlapped)
+                           : ::ReadFile(handle, buffer, static_cast<DWORD>(size), nullptr, &overlapped);
+    return pending = event && (res || ::GetLastError() == ERROR_IO_PENDING);
+}
+
+/*!
+ * \brief Waits until the transfer has been completed.
+ * \returns Returns the number of bytes transferred.
+ */
+std::uint64_t OverlappedTransfer::finish()
+{
+    if (!pending) {
+        return 0;
+    }
+    pending = false;
+    auto bytesTransferred = DWORD();
+    return ::GetOverlappedResult(handle, &overlapped, &bytesTransferred, TRUE) ? bytesTransferred : 0;
+}
+
+} // namespace
+/// \endcond
+#endif
+
+/*!
+ * \brief Constructs a copier which is not opened yet; all copies are done in userspace until open() has been called.
+ */
+FileRangeCopier::FileRangeCopier()
+    : m_source(nullptr)
+    , m_target(nullptr)
+    , m_sourceFileDescriptor(-1)
+    , m_targetFileDescriptor(-1)
+    , m_sourceDirectFileDescriptor(-1)
+    , m_targetDirectFileDescriptor(-1)
+    , m_blockSize(0)
+    , m_pendingTargetOffset(0)
+    , m_pendingTargetSize(0)
+    , m_preallocatedSize(0)
+    , m_cloneSupported(true)
+    , m_kernelCopySupported(true)
+    , m_directIoSupported(true)
+    , m_kernelCopyEnabled(true)
+{
+}
+
+/*!
+ * \brief Destroys the copier closing the file descriptors.
+ */
+FileRangeCopier::~FileRangeCopier()
+{
+    close();
+}
+
+/*!
+ * \brief Associates \a source and \a target with the files at \a sourcePath and \a targetPath.
+ * \returns Returns whether ranges can be copied by the kernel. If not, copy() falls back to copying in userspace.
+ * \remarks The streams must refer to the specified files and must stay valid until close() has been called.
+ */
+bool FileRangeCopier::open(std::istream &source, const std::string &sourcePath, std::ostream &target, const std::string &targetPath)
+{
+    close();
+#ifdef PLATFORM_LINUX
+    m_sourceFileDescriptor = ::open(BasicFileInfo::pathForOpen(sourcePath), O_RDONLY | O_CLOEXEC);
+    m_targetFileDescriptor = ::open(BasicFileInfo::pathForOpen(targetPath), O_WRONLY | O_CLOEXEC);
+    if (!isOpen()) {
+        close();
+        return false;
+    }
+    struct stat status;
+    m_blockSize = ::fstat(m_targetFileDescriptor, &status) == 0 && status.st_blksize > 0 ? static_cast<std::uint64_t>(status.st_blksize) : 0;
+    // open the files for direct I/O as well; not all file systems support it (e.g. tmpfs)
+    m_sourceDirectFileDescriptor = ::open(BasicFileInfo::pathForOpen(sourcePath), O_RDONLY | O_DIRECT | O_CLOEXEC);
+    m_targetDirectFileDescriptor = ::open(BasicFileInfo::pathForOpen(targetPath), O_WRONLY | O_DIRECT | O_CLOEXEC);
+    m_source = &source;
+    m_target = &target;
+    return true;
+#elif defined(PLATFORM_MAC)
+    m_sourceFileDescriptor = ::open(BasicFileInfo::pathForOpen(sourcePath), O_RDONLY | O_CLOEXEC);
+    m_targetFileDescriptor = ::open(BasicFileInfo::pathForOpen(targetPath), O_WRONLY | O_CLOEXEC);
+    if (!isOpen()) {
+        close();
+        return false;
+    }
+    // there is neither a way to clone nor to copy ranges by the kernel
+    m_cloneSupported = m_kernelCopySupported = false;
+    // open the files bypassing the page cache as well (the counterpart of O_DIRECT)
+    m_sourceDirectFileDescriptor = ::open(BasicFileInfo::pathForOpen(sourcePath), O_RDONLY | O_CLOEXEC);
+    m_targetDirectFileDescriptor = ::open(BasicFileInfo::pathForOpen(targetPath), O_WRONLY | O_CLOEXEC);
+    for (auto *const fileDescriptor : { &m_sourceDirectFileDescriptor, &m_targetDirectFileDescriptor }) {
+        if (*fileDescriptor >= 0 && ::fcntl(*fileDescriptor, F_NOCACHE, 1) < 0) {
+            ::close(*fileDescriptor);
+            *fileDescriptor = -1;
+        }
+    }
+    m_source = &source;
+    m_target = &target;
+    return true;
+#elif defined(PLATFORM_WINDOWS)
+    m_sourceFileDescriptor = openFileDescriptor(sourcePath, GENERIC_READ, FILE_FLAG_SEQUENTIAL_SCAN);
+    m_targetFileDescriptor = openFileDescriptor(targetPath, GENERIC_READ | GENERIC_WRITE, FILE_ATTRIBUTE_NORMAL);
+    if (!isOpen()) {
+        close();
+        return false;
+    }
+    // block cloning is only possible if the file system supports it; whether both files are on the same volume is just seen when cloning
+    m_blockSize = cloneClusterSize(handleOf(m_targetFileDescriptor));
+    m_cloneSupported = m_kernelCopySupported = m_blockSize != 0;
+    // open the files for unbuffered, overlapped I/O as well
+    m_sourceDirectFileDescriptor = openFileDescriptor(sourcePath, GENERIC_READ, FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED);
+    m_targetDirectFileDescriptor = openFileDescriptor(targetPath, GENERIC_WRITE, FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED);
+    m_source = &source;
+    m_target = &target;
+    return true;
+#else
+    CPP_UTILITIES_UNUSED(source);
+    CPP_UTILITIES_UNUSED(sourcePath);
+    CPP_UTILITIES_UNUSED(target);
+    CPP_UTILITIES_UNUSED(targetPath);
+    return false;
+#endif
+}
+
+/*!
+ * \brief Closes the file descriptors; subsequent copies are done in userspace.
+ */
+void FileRangeCopier::close()
+{
+#ifdef PLATFORM_LINUX
+    if (m_preallocatedSize && m_targetFileDescriptor >= 0) {
+        // release the space which has been preallocated but not used (truncating to the current size frees blocks behind the end)
+        struct stat status;
+        if (::fstat(m_targetFileDescriptor, &status) == 0 && static_cast<std::uint64_t>(status.st_size) < m_preallocatedSize) {
+            const auto res = ::ftruncate(m_targetFileDescriptor, status.st_size);
+            CPP_UTILITIES_UNUSED(res)
+        }
+    }
+    if (m_pendingTargetSize && m_targetFileDescriptor >= 0) {
+        ::posix_fadvise(m_targetFileDescriptor, static_cast<off_t>(m_pendingTargetOffset), static_cast<off_t>(m_pendingTargetSize),
+            POSIX_FADV_DONTNEED);
+    }
+    for (const auto fileDescriptor :
+        { m_sourceFileDescriptor, m_targetFileDescriptor, m_sourceDirectFileDescriptor, m_targetDirectFileDescriptor }) {
+        if (fileDescriptor >= 0) {
+            ::close(fileDescriptor);
+        }
+    }
+#elif defined(PLATFORM_MAC)
+    if (m_preallocatedSize && m_targetFileDescriptor >= 0) {
+        // release the space which has been preallocated but not used
+        struct stat status;
+        if (::fstat(m_targetFileDescriptor, &status) == 0 && static_cast<std::uint64_t>(status.st_size) < m_preallocatedSize) {
+            const auto res = ::ftruncate(m_targetFileDescriptor, status.st_size);
+            CPP_UTILITIES_UNUSED(res)
+        }
+    }
+    for (const auto fileDescriptor :
+        { m_sourceFileDescriptor, m_targetFileDescriptor, m_sourceDirectFileDescriptor, m_targetDirectFileDescriptor }) {
+        if (fileDescriptor >= 0) {
+            ::close(fileDescriptor);
+        }
+    }
+#elif defined(PLATFORM_WINDOWS)
+    if (m_preallocatedSize && m_targetFileDescriptor >= 0) {
+        // release the space which has been preallocated but not used
+        const auto handle = handleOf(m_targetFileDescriptor);
+        auto size = std::uint64_t();
+        if (fileSize(handle, size) && size < m_preallocatedSize) {
+            auto info = FILE_ALLOCATION_INFO();
+            info.AllocationSize.QuadPart = static_cast<LONGLONG>(size);
+            ::SetFileInformationByHandle(handle, FileAllocationInfo, &info, sizeof(info));
+        }
+    }
+    for (const auto fileDescriptor :
+        { m_sourceFileDescriptor, m_targetFileDescriptor, m_sourceDirectFileDescriptor, m_targetDirectFileDescriptor }) {
+        if (fileDescriptor >= 0) {
+            ::_close(fileDescriptor);
+        }
+    }
+#endif
+    m_sourceFileDescriptor = m_targetFileDescriptor = m_sourceDirectFileDescriptor = m_targetDirectFileDescriptor = -1;
+    m_pendingTargetOffset = m_pendingTargetSize = m_preallocatedSize = 0;
+    m_source = nullptr;
+    m_target = nullptr;
+}
+
+/*!
+ * \brief Reserves the space for a target file of the specified \a size before writing it.
+ *
+ * This lets the file system allocate contiguous extents for the whole file instead of growing it piece by piece which
+ * fragments big files badly, and it lets a rewrite fail before writing anything when there is not enough space.
+ *
+ * The size of the target file is not changed, so \a size may be an estimation. Space which has been reserved but not
+ * used is released again when the copier is closed. Under Linux fallocate() is used, under macOS F_PREALLOCATE (trying
+ * to allocate contiguous space first) and under Windows the allocation size of the file is set (FileAllocationInfo).
+ *
+ * \returns Returns false if there is not enough space; otherwise returns true (also if preallocating is not supported
+ *          by the platform or file system).
+ * \remarks The copier must have been opened; otherwise this does nothing.
+ */
+bool FileRangeCopier::preallocate(std::uint64_t size)
+{
+#ifdef PLATFORM_LINUX
+    if (m_targetFileDescriptor < 0 || !size) {
+        return true;
+    }
+    if (::fallocate(m_targetFileDescriptor, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size)) == 0) {
+        m_preallocatedSize = max(m_preallocatedSize, size);
+        return true;
+    }
+    return errno != ENOSPC;
+#elif defined(PLATFORM_MAC)
+    struct stat status;
+    if (m_targetFileDescriptor < 0 || !size || ::fstat(m_targetFileDescriptor, &status) != 0
+        || size <= static_cast<std::uint64_t>(status.st_size)) {
+        return true;
+    }
+    // allocate the space behind the physical end of the file
+    fstore_t store = { F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0, static_cast<off_t>(size - static_cast<std::uint64_t>(status.st_size)), 0 };
+    if (::fcntl(m_targetFileDescriptor, F_PREALLOCATE, &store) < 0) {
+        store.fst_flags = F_ALLOCATEALL;
+        if (::fcntl(m_targetFileDescriptor, F_PREALLOCATE, &store) < 0) {
+            return errno != ENOSPC;
+        }
+    }
+    m_preallocatedSize = max(m_preallocatedSize, size);
+    return true;
+#elif defined(PLATFORM_WINDOWS)
+    const auto handle = m_targetFileDescriptor >= 0 ? handleOf(m_targetFileDescriptor) : INVALID_HANDLE_VALUE;
+    auto currentSize = std::uint64_t();
+    // setting an allocation size less than the file size would truncate the file
+    if (handle == INVALID_HANDLE_VALUE || !size || !fileSize(handle, currentSize) || size <= currentSize) {
+        return true;
+    }
+    auto info = FILE_ALLOCATION_INFO();
+    info.AllocationSize.QuadPart = static_cast<LONGLONG>(size);
+    if (::SetFileInformationByHandle(handle, FileAllocationInfo, &info, sizeof(info))) {
+        m_preallocatedSize = max(m_preallocatedSize, size);
+        return true;
+    }
+    return ::GetLastError() != ERROR_DISK_FULL;
+#else
+    CPP_UTILITIES_UNUSED(size);
+    return true;
+#endif
+}
+
+/*!
+ * \brief Copies \a count bytes from the current read position of \a source to the current write position of \a target.
+ *
+ * Both positions are advanced by \a count as if the data had been copied via the streams. If the copier has been
+ * opened for the specified streams and the range is big enough, the data is copied by the kernel. Ranges of at least
+ * minDirectCopySize bytes the kernel can not copy are copied via direct I/O if supported.
+ *
+ * If \a progress is specified, the percentage of the current step is updated and whether the operation has been aborted
+ * is checked at least every abortCheckInterval bytes.
+ *
+ * \throws Throws OperationAbortedException when the operation has been aborted before all data could be copied so the
+ *         caller does not go on with an incomplete file but restores the original file.
+ * \remarks The time spent is added to FileRangeCopierStatistics::copyTime unless the operation is aborted.
+ */
+void FileRangeCopier::copy(std::istream &source, std::ostream &target, std::uint64_t count, AbortableProgressFeedback *progress)
+{
+    const auto start = chrono::steady_clock::now();
+    copyRange(source, target, count, progress);
+    m_statistics.copyTime += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start);
+}
+
+#ifdef PLATFORM_LINUX
+/// \cond
+namespace {
+
+/*!
+ * \brief Copies as much as possible of the specified range between the specified file descriptors by the kernel.
+ *
+ * Uses copy_file_range() and falls back to sendfile() if that is not possible for the file descriptors. If
+ * \a targetOffset is nullptr, the data is written at the current position of \a targetFileDescriptor (advancing it).
+ *
+ * \returns Returns the number of bytes copied; the rest needs to be copied in userspace.
+ */
+std::uint64_t copyBetweenFileDescriptors(int sourceFileDescriptor, std::uint64_t sourceOffset, int targetFileDescriptor,
+    loff_t *targetOffset, std::uint64_t count, AbortableProgressFeedback *progress)
+{
+    auto copied = std::uint64_t();
+    auto copyFileRangeSupported = true;
+    while (copied < count) {
+        if (progress) {
+            if (progress->isAborted()) {
+                return copied;
+            }
+            progress->updateStepPercentageFromFraction(static_cast<double>(copied) / static_cast<double>(count));
+        }
+        const auto stepSize = static_cast<std::size_t>(min(count - copied, FileRangeCopier::abortCheckInterval));
+        auto in = static_cast<loff_t>(sourceOffset + copied);
+        auto res = ssize_t();
+        if (copyFileRangeSupported) {
+            res = ::copy_file_range(sourceFileDescriptor, &in, targetFileDescriptor, targetOffset, stepSize, 0);
+            if (res < 0 && (errno == ENOSYS || errno == EXDEV || errno == EOPNOTSUPP || errno == EINVAL || errno == EBADF)) {
+                copyFileRangeSupported = false;
+                continue;
+            }
+        } else {
+            // sendfile() writes at the current position so position the target explicitly if an offset is given
+            if (targetOffset && ::lseek(targetFileDescriptor, static_cast<off_t>(*targetOffset), SEEK_SET) < 0) {
+                break;
+            }
+            auto offset = static_cast<off_t>(in);
+            res = ::sendfile(targetFileDescriptor, sourceFileDescriptor, &offset, stepSize);
+            if (res > 0 && targetOffset) {
+                *targetOffset += res;
+            }
+        }
+        if (res < 0 && errno == EINTR) {
+            continue;
+        }
+        if (res <= 0) {
+            break;
+        }
+        copied += static_cast<std::uint64_t>(res);
+    }
+    return copied;
+}
+
+} // namespace
+/// \endcond
+#endif
+
+/*!
+ * \brief Copies \a count bytes from the current read position of \a source to the current write position of \a target.
+ *
+ * Works like copy() but \a source is a stream of the file at \a sourcePath which is not the source the copier has been
+ * opened for (e.g. a file which is added as attachment). If the copier has been opened for \a target and the range is
+ * big enough, the data is copied by the kernel from the file at \a sourcePath. Otherwise (also if \a sourcePath is
+ * empty) the data is copied in userspace.
+ *
+ * \throws Throws OperationAbortedException when the operation has been aborted before all data could be copied.
+ */
+void FileRangeCopier::copyFromFile(
+    std::istream &source, const std::string &sourcePath, std::ostream &target, std::uint64_t count, AbortableProgressFeedback *progress)
+{
+    const auto start = chrono::steady_clock::now();
+    auto copied = std::uint64_t();
+#ifdef PLATFORM_LINUX
+    if (isOpen() && m_kernelCopyEnabled && &target == m_target && count >= minKernelCopySize && !sourcePath.empty()) {
+        target.flush();
+        const auto sourceOffset = static_cast<std::streamoff>(source.tellg());
+        const auto targetOffset = static_cast<std::streamoff>(target.tellp());
+        const auto sourceFileDescriptor
+            = sourceOffset >= 0 && targetOffset >= 0 ? ::open(BasicFileInfo::pathForOpen(sourcePath), O_RDONLY | O_CLOEXEC) : -1;
+        if (sourceFileDescriptor >= 0) {
+            auto out = static_cast<loff_t>(targetOffset);
+            copied = copyBetweenFileDescriptors(sourceFileDescriptor, static_cast<std::uint64_t>(sourceOffset), m_targetFileDescriptor, &out, count,
+                progress);
+            ::close(sourceFileDescriptor);
+            m_statistics.bytesCopiedByKernel += copied;
+            source.seekg(sourceOffset + static_cast<std::streamoff>(copied));
+            target.seekp(targetOffset + static_cast<std::streamoff>(copied));
+        }
+    }
+#else
+    CPP_UTILITIES_UNUSED(sourcePath);
+#endif
+    if (progress) {
+        progress->stopIfAborted();
+    }
+    if (copied < count) {
+        copyInUserspace(source, target, count - copied, progress);
+    }
+    m_statistics.copyTime += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start);
+}
+
+/*!
+ * \brief Implements copy() without timing.
+ */
+void FileRangeCopier::copyRange(std::istream &source, std::ostream &target, std::uint64_t count, AbortableProgressFeedback *progress)
+{
+    if (!isOpen() || &source != m_source || &target != m_target || count < minKernelCopySize) {
+        copyInUserspace(source, target, count, progress);
+        return;
+    }
+
+    // ensure buffered data has been written before the kernel writes behind it
+    target.flush();
+    const auto sourceOffset = static_cast<std::streamoff>(source.tellg());
+    const auto targetOffset = static_cast<std::streamoff>(target.tellp());
+    if (sourceOffset < 0 || targetOffset < 0) {
+        copyInUserspace(source, target, count, progress);
+        return;
+    }
+#ifdef PLATFORM_LINUX
+    ::posix_fadvise(m_sourceFileDescriptor, sourceOffset, static_cast<off_t>(count), POSIX_FADV_SEQUENTIAL);
+#endif
+    auto copied = m_kernelCopySupported && m_kernelCopyEnabled
+        ? copyInKernel(static_cast<std::uint64_t>(sourceOffset), static_cast<std::uint64_t>(targetOffset), count, progress)
+        : std::uint64_t();
+    if (copied < count && count - copied >= minDirectCopySize && !(progress && progress->isAborted())) {
+        copied += copyDirectly(
+            static_cast<std::uint64_t>(sourceOffset) + copied, static_cast<std::uint64_t>(targetOffset) + copied, count - copied, progress);
+    }
+    source.seekg(sourceOffset + static_cast<std::streamoff>(copied));
+    target.seekp(targetOffset + static_cast<std::streamoff>(copied));
+    if (progress) {
+        progress->stopIfAborted();
+    }
+    if (copied < count) {
+        copyInUserspace(source, target, count - copied, progress);
+        releaseCopiedRange(static_cast<std::uint64_t>(sourceOffset) + copied, static_cast<std::uint64_t>(targetOffset) + copied, count - copied);
+    }
+}
+
+/*!
+ * \brief Creates the file at \a targetPath as clone (reflink) of the file at \a sourcePath.
+ * \returns Returns whether the clone could be created. Nothing is copied if the file system does not support reflinks
+ *          and no file is left at \a targetPath in this case.
+ * \remarks
+ * - The file at \a targetPath must not exist yet.
+ * - Under macOS the file is cloned via clonefile() which requires APFS and takes over the permissions of the file.
+ * - Under Windows the file is cloned via block cloning (ReFS) taking over whether the file is sparse and its integrity
+ *   settings as required by FSCTL_DUPLICATE_EXTENTS_TO_FILE. The tail behind the last whole cluster is copied.
+ */
+bool FileRangeCopier::cloneFile(const std::string &sourcePath, const std::string &targetPath)
+{
+#ifdef PLATFORM_LINUX
+    const auto sourceFileDescriptor = ::open(BasicFileInfo::pathForOpen(sourcePath), O_RDONLY | O_CLOEXEC);
+    if (sourceFileDescriptor < 0) {
+        return false;
+    }
+    struct stat status;
+    const auto mode = ::fstat(sourceFileDescriptor, &status) == 0 ? (status.st_mode & 07777) : 0644;
+    const auto targetFileDescriptor = ::open(BasicFileInfo::pathForOpen(targetPath), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, mode);
+    if (targetFileDescriptor < 0) {
+        ::close(sourceFileDescriptor);
+        return false;
+    }
+    const auto cloned = ::ioctl(targetFileDescriptor, FICLONE, sourceFileDescriptor) == 0;
+    ::close(sourceFileDescriptor);
+    if (::close(targetFileDescriptor) != 0 || !cloned) {
+        ::unlink(BasicFileInfo::pathForOpen(targetPath));
+        return false;
+    }
+    return true;
+#elif defined(PLATFORM_MAC)
+    return ::clonefile(BasicFileInfo::pathForOpen(sourcePath), BasicFileInfo::pathForOpen(targetPath), 0) == 0;
+#elif defined(PLATFORM_WINDOWS)
+    const auto sourceFileDescriptor = openFileDescriptor(sourcePath, GENERIC_READ, FILE_ATTRIBUTE_NORMAL);
+    if (sourceFileDescriptor < 0) {
+        return false;
+    }
+    const auto sourceHandle = handleOf(sourceFileDescriptor);
+    auto integrity = FSCTL_GET_INTEGRITY_INFORMATION_BUFFER();
+    auto sourceInfo = BY_HANDLE_FILE_INFORMATION();
+    auto size = std::uint64_t();
+    const auto clusterSize = cloneClusterSize(sourceHandle, &integrity);
+    const auto targetFileDescriptor = clusterSize && fileSize(sourceHandle, size) && ::GetFileInformationByHandle(sourceHandle, &sourceInfo)
+        ? openFileDescriptor(targetPath, GENERIC_READ | GENERIC_WRITE, FILE_ATTRIBUTE_NORMAL, CREATE_NEW)
+        : -1;
+    if (targetFileDescriptor < 0) {
+        ::_close(sourceFileDescriptor);
+        return false;
+    }
+    const auto targetHandle = handleOf(targetFileDescriptor);
+    auto bytesReturned = DWORD();
+    auto cloned = true;
+    if (sourceInfo.dwFileAttributes & FILE_ATTRIBUTE_SPARSE_FILE) {
+        cloned = ::DeviceIoControl(targetHandle, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &bytesReturned, nullptr);
+    }
+    auto targetIntegrity = FSCTL_SET_INTEGRITY_INFORMATION_BUFFER();
+    targetIntegrity.ChecksumAlgorithm = integrity.ChecksumAlgorithm;
+    targetIntegrity.Flags = integrity.Flags;
+    const auto cloneSize = size - size % clusterSize;
+    cloned = cloned
+        && ::DeviceIoControl(
+            targetHandle, FSCTL_SET_INTEGRITY_INFORMATION, &targetIntegrity, sizeof(targetIntegrity), nullptr, 0, &bytesReturned, nullptr)
+        && setFileSize(targetHandle, size) && duplicateExtents(sourceHandle, 0, targetHandle, 0, cloneSize)
+        && copyBetweenHandles(sourceHandle, cloneSize, targetHandle, cloneSize, size - cloneSize);
+    ::_close(sourceFileDescriptor);
+    if (::_close(targetFileDescriptor) != 0 || !cloned) {
+        if (const auto nativeTargetPath = widePath(targetPath)) {
+            ::DeleteFileW(nativeTargetPath.get());
+        }
+        return false;
+    }
+    return true;
+#else
+    CPP_UTILITIES_UNUSED(sourcePath);
+    CPP_UTILITIES_UNUSED(targetPath);
+    return false;
+#endif
+}
+
+/*!
+ * \brief Shifts the data at \a dataOffset of the file at \a path so it starts at \a minDataOffset or slightly behind it.
+ *
+ * Under Linux the data is shifted by inserting (FALLOC_FL_INSERT_RANGE) or collapsing (FALLOC_FL_COLLAPSE_RANGE)
+ * whole file system blocks in front of it (supported by ext4 and XFS). This only changes the extent tree so no data
+ * is copied. As the range needs to be aligned to the block size, the data is shifted by up to one block further than
+ * required and the bytes in front of \a dataOffset are shifted along within the block containing \a dataOffset.
+ *
+ * \returns Returns the new offset of the data which is at least \a minDataOffset and less than \a minDataOffset plus
+ *          the block size (or as close as possible when collapsing). Returns \a dataOffset if the data could not be
+ *          shifted; the file has not been modified in this case.
+ * \remarks
+ * - The caller is supposed to overwrite everything in front of the returned offset afterwards (the inserted blocks
+ *   are zero-filled), so this is only useful when the structures in front of the data are made anew anyways and
+ *   the size difference is absorbed by padding.
+ * - The shift can be undone by shifting the data from the returned offset back to \a dataOffset (see
+ *   BackupHelper::undoDataShift()). The bytes in front of the data need to be saved beforehand (e.g. via
+ *   BackupHelper::createJournal()) as collapsed blocks are lost and inserted blocks are zero-filled.
+ * - File systems with a block size greater than maxShiftBlockSize are not considered.
+ * - The file must not be modified via buffered streams at the same time; streams reading from the file need to
+ *   discard their buffers afterwards.
+ */
+std::uint64_t FileRangeCopier::shiftData(const std::string &path, std::uint64_t dataOffset, std::uint64_t minDataOffset)
+{
+#ifdef PLATFORM_LINUX
+    const auto fileDescriptor = ::open(BasicFileInfo::pathForOpen(path), O_RDWR | O_CLOEXEC);
+    if (fileDescriptor < 0) {
+        return dataOffset;
+    }
+    auto newDataOffset = dataOffset;
+    struct statfs fileSystemStatus;
+    if (::fstatfs(fileDescriptor, &fileSystemStatus) == 0 && fileSystemStatus.f_bsize > 0
+        && static_cast<std::uint64_t>(fileSystemStatus.f_bsize) <= maxShiftBlockSize) {
+        const auto blockSize = static_cast<std::uint64_t>(fileSystemStatus.f_bsize);
+        // the range starts at the block boundary in front of the data
+        const auto rangeOffset = dataOffset / blockSize * blockSize;
+        if (minDataOffset > dataOffset) {
+            const auto size = (minDataOffset - dataOffset + blockSize - 1) / blockSize * blockSize;
+            if (::fallocate(fileDescriptor, FALLOC_FL_INSERT_RANGE, static_cast<off_t>(rangeOffset), static_cast<off_t>(size)) == 0) {
+                newDataOffset = dataOffset + size;
+            }
+        } else {
+            // collapse only blocks in front of the data
+            const auto size = min((dataOffset - minDataOffset) / blockSize * blockSize, rangeOffset);
+            if (size
+                && ::fallocate(fileDescriptor, FALLOC_FL_COLLAPSE_RANGE, static_cast<off_t>(rangeOffset - size), static_cast<off_t>(size))
+                    == 0) {
+                newDataOffset = dataOffset - size;
+            }
+        }
+    }
+    ::close(fileDescriptor);
+    return newDataOffset;
+#else
+    CPP_UTILITIES_UNUSED(path);
+    CPP_UTILITIES_UNUSED(minDataOffset);
+    return dataOffset;
+#endif
+}
+
+/*!
+ * \brief Copies \a count bytes at \a sourceOffset of the file at \a sourcePath to the current position of
+ *        \a targetFileDescriptor by the kernel.
+ *
+ * Under Linux the data is copied via copy_file_range() (which may share the extents on file systems supporting
+ * reflinks) and via sendfile() if \a targetFileDescriptor does not refer to a regular file on a suitable file system
+ * (e.g. a pipe or a socket). So the data never passes through userspace.
+ *
+ * \returns Returns the number of bytes copied (which is always zero on other platforms); the caller is supposed to
+ *          write the rest itself. The position of \a targetFileDescriptor is advanced by the number of bytes copied.
+ */
+std::uint64_t FileRangeCopier::copyToFileDescriptor(
+    const std::string &sourcePath, std::uint64_t sourceOffset, int targetFileDescriptor, std::uint64_t count)
+{
+#ifdef PLATFORM_LINUX
+    const auto sourceFileDescriptor = ::open(BasicFileInfo::pathForOpen(sourcePath), O_RDONLY | O_CLOEXEC);
+    if (sourceFileDescriptor < 0) {
+        return 0;
+    }
+    ::posix_fadvise(sourceFileDescriptor, static_cast<off_t>(sourceOffset), static_cast<off_t>(count), POSIX_FADV_SEQUENTIAL);
+    const auto copied = copyBetweenFileDescriptors(sourceFileDescriptor, sourceOffset, targetFileDescriptor, nullptr, count, nullptr);
+    ::close(sourceFileDescriptor);
+    return copied;
+#else
+    CPP_UTILITIES_UNUSED(sourcePath);
+    CPP_UTILITIES_UNUSED(sourceOffset);
+    CPP_UTILITIES_UNUSED(targetFileDescriptor);
+    CPP_UTILITIES_UNUSED(count);
+    return 0;
+#endif
+}
+
+/*!
+ * \brief Copies as much as possible of the specified range by the kernel.
+ * \returns Returns the number of bytes copied; the rest needs to be copied in userspace.
+ */
+std::uint64_t FileRangeCopier::copyInKernel(
+    std::uint64_t sourceOffset, std::uint64_t targetOffset, std::uint64_t count, AbortableProgressFeedback *progress)
+{
+#ifdef PLATFORM_LINUX
+    auto copied = std::uint64_t();
+
+    // clone the block-aligned part of the range if source and target offsets are aligned
+    if (m_cloneSupported && m_blockSize && !(sourceOffset % m_blockSize) && !(targetOffset % m_blockSize)) {
+        if (const auto cloneSize = count - count % m_blockSize) {
+            struct file_clone_range range;
+            range.src_fd = m_sourceFileDescriptor;
+            range.src_offset = sourceOffset;
+            range.src_length = cloneSize;
+            range.dest_offset = targetOffset;
+            if (::ioctl(m_targetFileDescriptor, FICLONERANGE, &range) == 0) {
+                m_statistics.bytesCloned += cloneSize;
+                copied = cloneSize;
+            } else if (errno != EINVAL) {
+                // the file system does not support reflinks or the files are on different file systems
+                m_cloneSupported = false;
+            }
+        }
+    }
+
+    // copy the remaining range via copy_file_range() in steps to allow updating the progress and aborting
+    while (copied < count) {
+        if (progress) {
+            if (progress->isAborted()) {
+                return copied;
+            }
+            progress->updateStepPercentageFromFraction(static_cast<double>(copied) / static_cast<double>(count));
+        }
+        // read the next step ahead while copying this one
+        const auto stepSize = min(count - copied, abortCheckInterval);
+        if (const auto remaining = count - copied - stepSize) {
+            ::posix_fadvise(m_sourceFileDescriptor, static_cast<off_t>(sourceOffset + copied + stepSize),
+                static_cast<off_t>(min(remaining, abortCheckInterval)), POSIX_FADV_WILLNEED);
+        }
+        auto in = static_cast<loff_t>(sourceOffset + copied), out = static_cast<loff_t>(targetOffset + copied);
+        const auto res = ::copy_file_range(m_sourceFileDescriptor, &in, m_targetFileDescriptor, &out, static_cast<std::size_t>(stepSize), 0);
+        if (res <= 0) {
+            if (res < 0 && (errno == ENOSYS || errno == EXDEV || errno == EOPNOTSUPP || errno == EINVAL)) {
+                m_kernelCopySupported = false;
+            }
+            break;
+        }
+        releaseCopiedRange(sourceOffset + copied, targetOffset + copied, static_cast<std::uint64_t>(res));
+        m_statistics.bytesCopiedByKernel += static_cast<std::uint64_t>(res);
+        copied += static_cast<std::uint64_t>(res);
+    }
+    return copied;
+#elif defined(PLATFORM_WINDOWS)
+    // clone the cluster-aligned part of the range; there is no way to let the kernel copy the rest so everything else
+    // is copied directly or in userspace
+    CPP_UTILITIES_UNUSED(progress);
+    if (!m_cloneSupported || !m_blockSize || sourceOffset % m_blockSize || targetOffset % m_blockSize) {
+        return 0;
+    }
+    const auto cloneSize = count - count % m_blockSize;
+    const auto targetHandle = handleOf(m_targetFileDescriptor);
+    auto targetSize = std::uint64_t();
+    // the cloned range must not extend behind the end of the target file
+    if (!cloneSize || !fileSize(targetHandle, targetSize)
+        || (targetSize < targetOffset + cloneSize && !setFileSize(targetHandle, targetOffset + cloneSize))) {
+        return 0;
+    }
+    if (!duplicateExtents(handleOf(m_sourceFileDescriptor), sourceOffset, targetHandle, targetOffset, cloneSize)) {
+        if (::GetLastError() != ERROR_INVALID_PARAMETER) {
+            // the files are on different volumes or the file system does not support block cloning after all
+            m_cloneSupported = m_kernelCopySupported = false;
+        }
+        if (targetSize < targetOffset + cloneSize) {
+            setFileSize(targetHandle, targetSize);
+        }
+        return 0;
+    }
+    m_statistics.bytesCloned += cloneSize;
+    return cloneSize;
+#else
+    CPP_UTILITIES_UNUSED(sourceOffset);
+    CPP_UTILITIES_UNUSED(targetOffset);
+    CPP_UTILITIES_UNUSED(count);
+    CPP_UTILITIES_UNUSED(progress);
+    return 0;
+#endif
+}
+
+/*!
+ * \brief Copies as much as possible of the specified range via direct I/O.
+ *
+ * The unaligned head and tail of the range are copied via the regular file descriptors. The aligned part in between is
+ * read in blocks of directCopyBlockSize bytes by a reader thread into one of two buffers while the calling thread writes
+ * the other one. Source and target offsets do not need to be aligned to each other: the source is read from the aligned
+ * offset in front of the data which is moved to the start of the buffer before writing.
+ *
+ * Under macOS the page cache is turned off via F_NOCACHE for the file descriptors used here; the alignment is kept as it
+ * is still faster.
+ *
+ * Under Windows the files are opened via FILE_FLAG_NO_BUFFERING and FILE_FLAG_OVERLAPPED instead of O_DIRECT. No reader
+ * thread is needed in this case: the next block is read asynchronously while the current one is written.
+ *
+ * \returns Returns the number of bytes copied; the rest needs to be copied in userspace.
+ */
+std::uint64_t FileRangeCopier::copyDirectly(
+    std::uint64_t sourceOffset, std::uint64_t targetOffset, std::uint64_t count, AbortableProgressFeedback *progress)
+{
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_MAC)
+    if (!m_directIoSupported || m_sourceDirectFileDescriptor < 0 || m_targetDirectFileDescriptor < 0) {
+        return 0;
+    }
+
+    // copy the head so writes start at an aligned target offset
+    const auto headSize = min(count, (directIoAlignment - targetOffset % directIoAlignment) % directIoAlignment);
+    if (headSize && !copyViaFileDescriptors(sourceOffset, targetOffset, headSize)) {
+        return 0;
+    }
+    auto copied = headSize;
+
+    // copy the aligned part using two buffers
+    struct Block {
+        std::unique_ptr<char, decltype(&std::free)> data{ nullptr, &std::free };
+        std::uint64_t size = 0;
+        bool filled = false;
+    } blocks[2];
+    for (auto &block : blocks) {
+        void *data = nullptr;
+        if (::posix_memalign(&data, directIoAlignment, directCopyBlockSize + directIoAlignment)) {
+            return copied;
+        }
+        block.data.reset(static_cast<char *>(data));
+    }
+    const auto alignedSize = (count - copied) - (count - copied) % directIoAlignment;
+    const auto alignedSourceOffset = sourceOffset + copied, alignedTargetOffset = targetOffset + copied;
+    auto mutex = std::mutex();
+    auto blockChanged = std::condition_variable();
+    auto stopped = false, readFailed = false;
+    auto reader = std::thread([&] {
+        for (std::uint64_t offset = 0, index = 0; offset < alignedSize; ++index) {
+            auto &block = blocks[index % 2];
+            {
+                auto lock = std::unique_lock<std::mutex>(mutex);
+                blockChanged.wait(lock, [&] { return stopped || !block.filled; });
+                if (stopped) {
+                    return;
+                }
+            }
+            const auto size = min(alignedSize - offset, directCopyBlockSize);
+            const auto delta = (alignedSourceOffset + offset) % directIoAlignment;
+            const auto readSize = (delta + size + directIoAlignment - 1) / directIoAlignment * directIoAlignment;
+            auto bytesRead = std::uint64_t();
+            while (bytesRead < delta + size) {
+                const auto res = ::pread(m_sourceDirectFileDescriptor, block.data.get() + bytesRead, static_cast<std::size_t>(readSize - bytesRead),
+                    static_cast<off_t>(alignedSourceOffset + offset - delta + bytesRead));
+                if (res <= 0) {
+                    break;
+                }
+                bytesRead += static_cast<std::uint64_t>(res);
+            }
+            if (bytesRead >= delta + size && delta) {
+                std::memmove(block.data.get(), block.data.get() + delta, static_cast<std::size_t>(size));
+            }
+            const auto lock = std::lock_guard<std::mutex>(mutex);
+            if (bytesRead < delta + size) {
+                readFailed = true;
+                blockChanged.notify_all();
+                return;
+            }
+            block.size = size;
+            block.filled = true;
+            blockChanged.notify_all();
+            offset += size;
+        }
+    });
+    auto offset = std::uint64_t();
+    for (std::uint64_t index = 0; offset < alignedSize; ++index) {
+        if (progress) {
+            if (progress->isAborted()) {
+                break;
+            }
+            progress->updateStepPercentageFromFraction(static_cast<double>(copied) / static_cast<double>(count));
+        }
+        auto &block = blocks[index % 2];
+        {
+            auto lock = std::unique_lock<std::mutex>(mutex);
+            blockChanged.wait(lock, [&] { return readFailed || block.filled; });
+            if (!block.filled) {
+                break;
+            }
+        }
+        auto bytesWritten = std::uint64_t();
+        while (bytesWritten < block.size) {
+            const auto res = ::pwrite(m_targetDirectFileDescriptor, block.data.get() + bytesWritten,
+                static_cast<std::size_t>(block.size - bytesWritten), static_cast<off_t>(alignedTargetOffset + offset + bytesWritten));
+            if (res <= 0) {
+                break;
+            }
+            bytesWritten += static_cast<std::uint64_t>(res);
+        }
+        if (bytesWritten < block.size) {
+            // only whole blocks count as copied; the resulting gap is filled when copying the rest in userspace
+            if (errno == EINVAL) {
+                m_directIoSupported = false;
+            }
+            break;
+        }
+        m_statistics.bytesCopiedDirectly += block.size;
+        copied += block.size;
+        offset += block.size;
+        const auto lock = std::lock_guard<std::mutex>(mutex);
+        block.filled = false;
+        blockChanged.notify_all();
+    }
+    {
+        const auto lock = std::lock_guard<std::mutex>(mutex);
+        stopped = true;
+        blockChanged.notify_all();
+    }
+    reader.join();
+    if (readFailed && !offset) {
+        // reading the first block failed so direct I/O is likely not supported for the source
+        m_directIoSupported = false;
+    }
+
+    // copy the tail
+    if (offset == alignedSize && copied < count && copyViaFileDescriptors(sourceOffset + copied, targetOffset + copied, count - copied)) {
+        copied = count;
+    }
+    return copied;
+#elif defined(PLATFORM_WINDOWS)
+    if (!m_directIoSupported || m_sourceDirectFileDescriptor < 0 || m_targetDirectFileDescriptor < 0) {
+        return 0;
+    }
+
+    // copy the head so writes start at an aligned target offset
+    const auto headSize = min(count, (directIoAlignment - targetOffset % directIoAlignment) % directIoAlignment);
+    if (headSize && !copyViaFileDescriptors(sourceOffset, targetOffset, headSize)) {
+        return 0;
+    }
+    auto copied = headSize;
+
+    // copy the aligned part using two buffers; VirtualAlloc() returns page-aligned memory as required for unbuffered I/O
+    struct Block {
+        std::unique_ptr<char, void (*)(char *)> data{ nullptr, [](char *data) { ::VirtualFree(data, 0, MEM_RELEASE); } };
+        std::uint64_t size = 0;
+        std::uint64_t delta = 0;
+    } blocks[2];
+    for (auto &block : blocks) {
+        block.data.reset(
+            static_cast<char *>(::VirtualAlloc(nullptr, directCopyBlockSize + directIoAlignment, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE)));
+        if (!block.data) {
+            return copied;
+        }
+    }
+    const auto alignedSize = (count - copied) - (count - copied) % directIoAlignment;
+    const auto alignedSourceOffset = sourceOffset + copied, alignedTargetOffset = targetOffset + copied;
+    const auto sourceHandle = handleOf(m_sourceDirectFileDescriptor), targetHandle = handleOf(m_targetDirectFileDescriptor);
+    // declared after the blocks so pending transfers are cancelled before the buffers are freed
+    auto readTransfer = OverlappedTransfer(), writeTransfer = OverlappedTransfer();
+    const auto startReading = [&](Block &block, std::uint64_t offset) {
+        block.size = min(alignedSize - offset, directCopyBlockSize);
+        block.delta = (alignedSourceOffset + offset) % directIoAlignment;
+        const auto readSize = (block.delta + block.size + directIoAlignment - 1) / directIoAlignment * directIoAlignment;
+        readTransfer.start(sourceHandle, block.data.get(), readSize, alignedSourceOffset + offset - block.delta, false);
+    };
+    auto offset = std::uint64_t();
+    auto readFailed = false;
+    if (alignedSize) {
+        startReading(blocks[0], 0);
+    }
+    for (std::uint64_t index = 0; offset < alignedSize; ++index) {
+        if (progress) {
+            if (progress->isAborted()) {
+                break;
+            }
+            progress->updateStepPercentageFromFraction(static_cast<double>(copied) / static_cast<double>(count));
+        }
+        auto &block = blocks[index % 2];
+        if (readTransfer.finish() < block.delta + block.size) {
+            readFailed = true;
+            break;
+        }
+        if (block.delta) {
+            std::memmove(block.data.get(), block.data.get() + block.delta, static_cast<std::size_t>(block.size));
+        }
+        // read the next block while writing this one
+        if (offset + block.size < alignedSize) {
+            startReading(blocks[(index + 1) % 2], offset + block.size);
+        }
+        writeTransfer.start(targetHandle, block.data.get(), block.size, alignedTargetOffset + offset, true);
+        if (writeTransfer.finish() < block.size) {
+            // only whole blocks count as copied; the resulting gap is filled when copying the rest in userspace
+            if (::GetLastError() == ERROR_INVALID_PARAMETER) {
+                m_directIoSupported = false;
+            }
+            break;
+        }
+        m_statistics.bytesCopiedDirectly += block.size;
+        copied += block.size;
+        offset += block.size;
+    }
+    if (readFailed && !offset) {
+        // reading the first block failed so unbuffered I/O is likely not supported for the source
+        m_directIoSupported = false;
+    }
+
+    // copy the tail
+    if (offset == alignedSize && copied < count && copyViaFileDescriptors(sourceOffset + copied, targetOffset + copied, count - copied)) {
+        copied = count;
+    }
+    return copied;
+#else
+    CPP_UTILITIES_UNUSED(sourceOffset);
+    CPP_UTILITIES_UNUSED(targetOffset);
+    CPP_UTILITIES_UNUSED(count);
+    CPP_UTILITIES_UNUSED(progress);
+    return 0;
+#endif
+}
+
+/*!
+ * \brief Copies the specified (small) range via pread() and pwrite() (or ReadFile() and WriteFile()) on the regular file descriptors.
+ * \returns Returns whether the whole range could be copied.
+ */
+bool FileRangeCopier::copyViaFileDescriptors(std::uint64_t sourceOffset, std::uint64_t targetOffset, std::uint64_t count)
+{
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_MAC)
+    char buffer[directIoAlignment];
+    for (std::uint64_t copied = 0; copied < count;) {
+        const auto res = ::pread(m_sourceFileDescriptor, buffer, static_cast<std::size_t>(min<std::uint64_t>(count - copied, sizeof(buffer))),
+            static_cast<off_t>(sourceOffset + copied));
+        if (res <= 0 || ::pwrite(m_targetFileDescriptor, buffer, static_cast<std::size_t>(res), static_cast<off_t>(targetOffset + copied)) != res) {
+            return false;
+        }
+        copied += static_cast<std::uint64_t>(res);
+        m_statistics.bytesCopiedDirectly += static_cast<std::uint64_t>(res);
+    }
+    return true;
+#elif defined(PLATFORM_WINDOWS)
+    if (!copyBetweenHandles(handleOf(m_sourceFileDescriptor), sourceOffset, handleOf(m_targetFileDescriptor), targetOffset, count)) {
+        return false;
+    }
+    m_statistics.bytesCopiedDirectly += count;
+    return true;
+#else
+    CPP_UTILITIES_UNUSED(sourceOffset);
+    CPP_UTILITIES_UNUSED(targetOffset);
+    CPP_UTILITIES_UNUSED(count);
+    return false;
+#endif
+}
+
+/*!
+ * \brief Copies the specified range through a userspace buffer.
+ */
+void FileRangeCopier::copyInUserspace(std::istream &source, std::ostream &target, std::uint64_t count, AbortableProgressFeedback *progress)
+{
+    CopyHelper<0x10000> copyHelper;
+    if (progress) {
+        copyHelper.callbackCopy(source, target, count, std::bind(&AbortableProgressFeedback::isAborted, std::ref(*progress)),
+            std::bind(&AbortableProgressFeedback::updateStepPercentageFromFraction, std::ref(*progress), std::placeholders::_1));
+        progress->stopIfAborted();
+    } else {
+        copyHelper.copy(source, target, count);
+    }
+    m_statistics.bytesCopiedByUserspace += count;
+}
+
+/*!
+ * \brief Drops the specified range which has just been copied from the page cache.
+ *
+ * The source pages are dropped right away. The target pages are dirty at this point so only their write-back is started;
+ * they are dropped when the next range has been copied (or the copier is closed) because by then they have been written
+ * back usually. Pages still being written back are just kept by the kernel.
+ */
+void FileRangeCopier::releaseCopiedRange(std::uint64_t sourceOffset, std::uint64_t targetOffset, std::uint64_t count)
+{
+#ifdef PLATFORM_LINUX
+    ::posix_fadvise(m_sourceFileDescriptor, static_cast<off_t>(sourceOffset), static_cast<off_t>(count), POSIX_FADV_DONTNEED);
+    if (m_pendingTargetSize) {
+        ::posix_fadvise(m_targetFileDescriptor, static_cast<off_t>(m_pendingTargetOffset), static_cast<off_t>(m_pendingTargetSize),
+            POSIX_FADV_DONTNEED);
+    }
+    ::sync_file_range(m_targetFileDescriptor, static_cast<off64_t>(targetOffset), static_cast<off64_t>(count), SYNC_FILE_RANGE_WRITE);
+    m_pendingTargetOffset = targetOffset;
+    m_pendingTargetSize = count;
+#else
+    CPP_UTILITIES_UNUSED(sourceOffset);
+    CPP_UTILITIES_UNUSED(targetOffset);
+    CPP_UTILITIES_UNUSED(count);
+#endif
+}
+
+} // namespace TagParser
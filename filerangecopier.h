@@ -0,0 +1,131 @@
+#ifndef TAG_PARSER_FILERANGECOPIER_H
+#define TAG_PARSER_FILERANGECOPIER_H
+
+#include "./global.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+namespace TagParser {
+
+class AbortableProgressFeedback;
+
+/*!
+ * \brief The FileRangeCopierStatistics struct holds statistics about the copies done via a FileRangeCopier.
+ */
+struct TAG_PARSER_EXPORT FileRangeCopierStatistics {
+    /// \brief The number of bytes which have been cloned (reflinked) without copying any data.
+    std::uint64_t bytesCloned = 0;
+    /// \brief The number of bytes which have been copied by the kernel.
+    std::uint64_t bytesCopiedByKernel = 0;
+    /// \brief The number of bytes which have been copied via direct I/O bypassing the page cache.
+    std::uint64_t bytesCopiedDirectly = 0;
+    /// \brief The number of bytes which have been copied through userspace buffers.
+    std::uint64_t bytesCopiedByUserspace = 0;
+    /// \brief The time spent in FileRangeCopier::copy().
+    std::chrono::nanoseconds copyTime = std::chrono::nanoseconds::zero();
+};
+
+class TAG_PARSER_EXPORT FileRangeCopier {
+public:
+    FileRangeCopier();
+    FileRangeCopier(const FileRangeCopier &) = delete;
+    FileRangeCopier &operator=(const FileRangeCopier &) = delete;
+    ~FileRangeCopier();
+
+    bool open(std::istream &source, const std::string &sourcePath, std::ostream &target, const std::string &targetPath);
+    void close();
+    bool isOpen() const;
+    bool preallocate(std::uint64_t size);
+    bool isKernelCopyEnabled() const;
+    void setKernelCopyEnabled(bool enabled);
+    void copy(std::istream &source, std::ostream &target, std::uint64_t count, AbortableProgressFeedback *progress = nullptr);
+    void copyFromFile(std::istream &source, const std::string &sourcePath, std::ostream &target, std::uint64_t count,
+        AbortableProgressFeedback *progress = nullptr);
+    const FileRangeCopierStatistics &statistics() const;
+    static bool cloneFile(const std::string &sourcePath, const std::string &targetPath);
+    static std::uint64_t shiftData(const std::string &path, std::uint64_t dataOffset, std::uint64_t minDataOffset);
+    static std::uint64_t copyToFileDescriptor(
+        const std::string &sourcePath, std::uint64_t sourceOffset, int targetFileDescriptor, std::uint64_t count);
+
+    /// \brief Ranges smaller than this are always copied through userspace because the syscall overhead would dominate.
+    static constexpr std::uint64_t minKernelCopySize = 0x10000;
+    /// \brief The max. number of bytes copied by the kernel before checking whether the operation has been aborted.
+    static constexpr std::uint64_t abortCheckInterval = 0x800000;
+    /// \brief Ranges at least this big are copied via direct I/O if the kernel can not copy them.
+    static constexpr std::uint64_t minDirectCopySize = 0x4000000;
+    /// \brief The size of the buffers used when copying via direct I/O.
+    static constexpr std::uint64_t directCopyBlockSize = 0x800000;
+    /// \brief The alignment of offsets, sizes and buffers required for direct I/O.
+    static constexpr std::uint64_t directIoAlignment = 0x1000;
+    /// \brief The max. file system block size shiftData() works with (so data is never shifted by more than one block too much).
+    static constexpr std::uint64_t maxShiftBlockSize = 0x10000;
+
+private:
+    void copyRange(std::istream &source, std::ostream &target, std::uint64_t count, AbortableProgressFeedback *progress);
+    std::uint64_t copyInKernel(std::uint64_t sourceOffset, std::uint64_t targetOffset, std::uint64_t count, AbortableProgressFeedback *progress);
+    std::uint64_t copyDirectly(std::uint64_t sourceOffset, std::uint64_t targetOffset, std::uint64_t count, AbortableProgressFeedback *progress);
+    bool copyViaFileDescriptors(std::uint64_t sourceOffset, std::uint64_t targetOffset, std::uint64_t count);
+    void copyInUserspace(std::istream &source, std::ostream &target, std::uint64_t count, AbortableProgressFeedback *progress);
+    void releaseCopiedRange(std::uint64_t sourceOffset, std::uint64_t targetOffset, std::uint64_t count);
+
+    std::istream *m_source;
+    std::ostream *m_target;
+    int m_sourceFileDescriptor;
+    int m_targetFileDescriptor;
+    int m_sourceDirectFileDescriptor;
+    int m_targetDirectFileDescriptor;
+    std::uint64_t m_blockSize;
+    std::uint64_t m_pendingTargetOffset;
+    std::uint64_t m_pendingTargetSize;
+    std::uint64_t m_preallocatedSize;
+    bool m_cloneSupported;
+    bool m_kernelCopySupported;
+    bool m_directIoSupported;
+    bool m_kernelCopyEnabled;
+    FileRangeCopierStatistics m_statistics;
+};
+
+/*!
+ * \brief Returns whether the copier has been opened so ranges between the associated streams can be copied by the kernel.
+ */
+inline bool FileRangeCopier::isOpen() const
+{
+    return m_sourceFileDescriptor >= 0 && m_targetFileDescriptor >= 0;
+}
+
+/*!
+ * \brief Returns whether ranges may be cloned or copied by the kernel.
+ *
+ * This is enabled by default. If disabled, big ranges are copied via direct I/O as if the kernel could not copy them
+ * (see copy()); smaller ranges are copied in userspace.
+ *
+ * \sa setKernelCopyEnabled()
+ */
+inline bool FileRangeCopier::isKernelCopyEnabled() const
+{
+    return m_kernelCopyEnabled;
+}
+
+/*!
+ * \brief Sets whether ranges may be cloned or copied by the kernel.
+ * \sa isKernelCopyEnabled()
+ */
+inline void FileRangeCopier::setKernelCopyEnabled(bool enabled)
+{
+    m_kernelCopyEnabled = enabled;
+}
+
+/*!
+ * \brief Returns statistics about the copies done so far.
+ */
+inline const FileRangeCopierStatistics &FileRangeCopier::statistics() const
+{
+    return m_statistics;
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_FILERANGECOPIER_H
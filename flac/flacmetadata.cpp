@@ -1,5 +1,6 @@
 #include "./flacmetadata.h"
 
+#include "../abstractattachment.h"
 #include "../exceptions.h"
 #include "../tagvalue.h"
 
@@ -39,10 +40,19 @@ void FlacMetaDataBlockHeader::parseHeader(const char *buffer)
  */
 void FlacMetaDataBlockHeader::makeHeader(std::ostream &outputStream)
 {
-    std::uint8_t buff[4];
-    *buff = (m_last ? (0x80 | m_type) : m_type);
-    BE::getBytes24(m_dataSize, reinterpret_cast<char *>(buff) + 1);
-    outputStream.write(reinterpret_cast<char *>(buff), sizeof(buff));
+    char buff[4];
+    makeHeader(buff);
+    outputStream.write(buff, sizeof(buff));
+}
+
+/*!
+ * \brief Writes the header to the specified \a buffer.
+ * \remarks Writes always 4 bytes.
+ */
+void FlacMetaDataBlockHeader::makeHeader(char *buffer)
+{
+    *buffer = static_cast<char>(m_last ? (0x80 | m_type) : m_type);
+    BE::getBytes24(m_dataSize, buffer + 1);
 }
 
 /*!
@@ -79,8 +89,12 @@ void FlacMetaDataBlockStreamInfo::parse(const char *buffer)
  * \brief Parses the FLAC "METADATA_BLOCK_PICTURE".
  *
  * \a maxSize specifies the maximum size of the structure.
+ *
+ * If \a lazyDataStream is specified, the picture data is not read but assigned to be read from the stream returned by
+ * \a lazyDataStream when accessed (see TagValue::assignLazyData()). That stream must contain the same data as \a inputStream
+ * at the same offsets.
  */
-void FlacMetaDataBlockPicture::parse(istream &inputStream, std::uint32_t maxSize)
+void FlacMetaDataBlockPicture::parse(istream &inputStream, std::uint32_t maxSize, const std::function<std::istream &()> &lazyDataStream)
 {
     CHECK_MAX_SIZE(32);
     BinaryReader reader(&inputStream);
@@ -95,7 +109,11 @@ void FlacMetaDataBlockPicture::parse(istream &inputStream, std::uint32_t maxSize
     inputStream.seekg(4 * 4, ios_base::cur);
     size = reader.readUInt32BE();
     CHECK_MAX_SIZE(size);
-    if (size) {
+    if (size && lazyDataStream) {
+        const auto dataOffset = static_cast<istream::off_type>(inputStream.tellg());
+        m_value.assignLazyData(
+            make_shared<StreamDataBlock>(lazyDataStream, dataOffset, ios_base::beg, dataOffset + size, ios_base::beg), TagDataType::Picture);
+    } else if (size) {
         auto data = make_unique<char[]>(size);
         inputStream.read(data.get(), size);
         m_value.assignData(move(data), size, TagDataType::Picture);
@@ -104,6 +122,38 @@ void FlacMetaDataBlockPicture::parse(istream &inputStream, std::uint32_t maxSize
     }
 }
 
+/*!
+ * \brief Parses the FLAC "METADATA_BLOCK_PICTURE" from the specified \a buffer.
+ *
+ * \a maxSize specifies the maximum size of the structure.
+ *
+ * If \a sharedBuffer is specified, the picture data is not copied but refers to \a sharedBuffer which \a buffer must be
+ * part of (see TagValue::assignSharedData()).
+ */
+void FlacMetaDataBlockPicture::parse(const char *buffer, std::uint32_t maxSize, const std::shared_ptr<const void> &sharedBuffer)
+{
+    CHECK_MAX_SIZE(32);
+    m_pictureType = BE::toUInt32(buffer);
+    std::uint32_t size = BE::toUInt32(buffer + 4);
+    CHECK_MAX_SIZE(size);
+    m_value.setMimeType(string(buffer + 8, size));
+    buffer += 8 + size;
+    size = BE::toUInt32(buffer);
+    CHECK_MAX_SIZE(size);
+    m_value.setDescription(string(buffer + 4, size));
+    // skip width, height, color depth, number of colors used
+    buffer += 4 + size + 4 * 4;
+    size = BE::toUInt32(buffer);
+    CHECK_MAX_SIZE(size);
+    if (size && sharedBuffer) {
+        m_value.assignSharedData(sharedBuffer, buffer + 4, size, TagDataType::Picture);
+    } else if (size) {
+        m_value.assignData(buffer + 4, size, TagDataType::Picture);
+    } else {
+        m_value.clearData();
+    }
+}
+
 /*!
  * \brief Returns the number of bytes make() will write.
  * \remarks Any changes to the object will invalidate this value.
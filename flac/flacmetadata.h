@@ -4,7 +4,10 @@
 #include "../global.h"
 
 #include <cstdint>
-#include <iostream>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <ostream>
 
 namespace TagParser {
 
@@ -31,6 +34,7 @@ public:
 
     void parseHeader(const char *buffer);
     void makeHeader(std::ostream &outputStream);
+    void makeHeader(char *buffer);
 
     constexpr std::uint8_t isLast() const;
     void setLast(std::uint8_t last);
@@ -249,7 +253,8 @@ class TAG_PARSER_EXPORT FlacMetaDataBlockPicture {
 public:
     FlacMetaDataBlockPicture(TagValue &tagValue);
 
-    void parse(std::istream &inputStream, std::uint32_t maxSize);
+    void parse(std::istream &inputStream, std::uint32_t maxSize, const std::function<std::istream &()> &lazyDataStream = nullptr);
+    void parse(const char *buffer, std::uint32_t maxSize, const std::shared_ptr<const void> &sharedBuffer = nullptr);
     std::uint32_t requiredSize() const;
     void make(std::ostream &outputStream);
 
@@ -2,22 +2,134 @@
 #include "./flacmetadata.h"
 
 #include "../vorbis/vorbiscomment.h"
+#include "../vorbis/vorbiscommentids.h"
 
 #include "../exceptions.h"
 #include "../mediafileinfo.h"
 #include "../mediaformat.h"
+#include "../tagtemplate.h"
 
 #include "resources/config.h"
 
+#include <c++utilities/conversion/stringbuilder.h>
 #include <c++utilities/io/copy.h>
 
+#include <algorithm>
+#include <cstring>
 #include <sstream>
+#include <utility>
+#include <vector>
 
 using namespace std;
 using namespace CppUtilities;
 
 namespace TagParser {
 
+/// \cond
+namespace {
+
+/// \brief The number of bytes read at once when reading the metadata blocks.
+constexpr std::size_t metaDataPrefetchSize = 0x10000;
+/// \brief The number of bytes read at once when scanning the FLAC frames.
+constexpr std::size_t frameScanBufferSize = 0x100000;
+/// \brief The max. size of a FLAC frame header (including the CRC-8).
+constexpr std::size_t maxFrameHeaderSize = 16;
+/// \brief The size of a seek point within "METADATA_BLOCK_SEEKTABLE".
+constexpr std::size_t seekPointSize = 18;
+
+/*!
+ * \brief The FrameHeader struct holds the fields of a FLAC frame header relevant for building a seek table.
+ */
+struct FrameHeader {
+    std::uint64_t number = 0; // frame number (fixed block size) or sample number (variable block size)
+    std::uint32_t blockSize = 0;
+    bool variableBlockSize = false;
+};
+
+/*!
+ * \brief Computes the CRC-8 (polynomial 0x07) used to protect FLAC frame headers.
+ */
+std::uint8_t computeCrc8(const unsigned char *data, std::size_t size)
+{
+    auto crc = std::uint8_t();
+    for (const auto *const end = data + size; data != end; ++data) {
+        crc ^= *data;
+        for (auto bit = 0; bit != 8; ++bit) {
+            crc = static_cast<std::uint8_t>(crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1);
+        }
+    }
+    return crc;
+}
+
+/*!
+ * \brief Parses the FLAC frame header at the beginning of \a data and returns whether it is valid.
+ * \remarks Reserved values are rejected and the CRC-8 is checked so a false sync within frame data is unlikely.
+ */
+bool parseFrameHeader(const unsigned char *data, std::size_t size, FrameHeader &header)
+{
+    if (size < 5 || data[0] != 0xFF || (data[1] & 0xFE) != 0xF8) {
+        return false;
+    }
+    const auto blockSizeBits = data[2] >> 4, sampleRateBits = data[2] & 0xF;
+    if (!blockSizeBits || sampleRateBits == 0xF || (data[3] >> 4) >= 11 || ((data[3] >> 1) & 0x7) == 3 || (data[3] & 0x1)) {
+        return false;
+    }
+
+    // decode the frame/sample number (coded like UTF-8)
+    auto index = std::size_t(4);
+    const auto first = data[index++];
+    auto leadingOnes = 0;
+    for (; leadingOnes != 8 && (first & (0x80 >> leadingOnes)); ++leadingOnes)
+        ;
+    if (leadingOnes == 1 || leadingOnes == 8) {
+        return false;
+    }
+    auto number = static_cast<std::uint64_t>(first & (0x7F >> leadingOnes));
+    auto extraBytes = static_cast<std::size_t>(leadingOnes ? leadingOnes - 1 : 0);
+    if (index + extraBytes > size) {
+        return false;
+    }
+    for (; extraBytes; --extraBytes) {
+        const auto byte = data[index++];
+        if ((byte & 0xC0) != 0x80) {
+            return false;
+        }
+        number = (number << 6) | (byte & 0x3F);
+    }
+
+    // determine block size and skip the sample rate
+    if (blockSizeBits == 1) {
+        header.blockSize = 192;
+    } else if (blockSizeBits <= 5) {
+        header.blockSize = 576u << (blockSizeBits - 2);
+    } else if (blockSizeBits == 6) {
+        if (index + 1 > size) {
+            return false;
+        }
+        header.blockSize = data[index++] + 1u;
+    } else if (blockSizeBits == 7) {
+        if (index + 2 > size) {
+            return false;
+        }
+        header.blockSize = ((static_cast<std::uint32_t>(data[index]) << 8) | data[index + 1]) + 1u;
+        index += 2;
+    } else {
+        header.blockSize = 256u << (blockSizeBits - 8);
+    }
+    index += sampleRateBits == 12 ? 1 : (sampleRateBits == 13 || sampleRateBits == 14 ? 2 : 0);
+
+    // check CRC-8
+    if (index >= size || computeCrc8(data, index) != data[index]) {
+        return false;
+    }
+    header.number = number;
+    header.variableBlockSize = data[1] & 0x1;
+    return true;
+}
+
+} // namespace
+/// \endcond
+
 /*!
  * \class TagParser::FlacStream
  * \brief Implementation of TagParser::AbstractTrack for raw FLAC streams.
@@ -29,10 +141,11 @@ namespace TagParser {
  * The stream of the \a mediaFileInfo instance is used as input stream.
  */
 FlacStream::FlacStream(MediaFileInfo &mediaFileInfo, std::uint64_t startOffset)
-    : AbstractTrack(mediaFileInfo.stream(), startOffset)
+    : AbstractTrack(mediaFileInfo.inputStream(), startOffset)
     , m_mediaFileInfo(mediaFileInfo)
     , m_paddingSize(0)
     , m_streamOffset(0)
+    , m_seekTablePresent(false)
 {
     m_mediaType = MediaType::Audio;
 }
@@ -59,6 +172,7 @@ bool FlacStream::removeVorbisComment()
         return false;
     }
     m_vorbisComment.reset();
+    m_flags |= TrackFlags::Modified;
     return true;
 }
 
@@ -70,7 +184,6 @@ void FlacStream::internalParseHeader(Diagnostics &diag)
     }
 
     m_istream->seekg(static_cast<streamoff>(m_startOffset), ios_base::beg);
-    char buffer[0x22];
 
     // check signature
     if (m_reader.readUInt32BE() != 0x664C6143) {
@@ -79,22 +192,51 @@ void FlacStream::internalParseHeader(Diagnostics &diag)
     }
     m_format = GeneralMediaFormat::Flac;
 
-    // parse meta data blocks
+    // read meta data blocks into one buffer
+    // note: The total size is only known after walking through all block headers. So a bigger chunk is read at first and
+    //       only the remaining bytes are read if a block exceeds it. Usually all blocks are read via one I/O operation.
+    const auto metaDataOffset = m_startOffset + 4;
+    const auto fileSize = m_mediaFileInfo.size();
+    const auto availableSize = fileSize > metaDataOffset ? fileSize - metaDataOffset : std::uint64_t();
+    auto buffer = vector<char>();
+    const auto ensureBuffered = [&](std::uint64_t requiredSize) {
+        if (requiredSize <= buffer.size()) {
+            return true;
+        }
+        if (requiredSize > availableSize) {
+            return false;
+        }
+        const auto bufferedSize = buffer.size();
+        buffer.resize(static_cast<std::size_t>(min<std::uint64_t>(max<std::uint64_t>(requiredSize, bufferedSize + metaDataPrefetchSize), availableSize)));
+        m_istream->read(buffer.data() + bufferedSize, static_cast<streamsize>(buffer.size() - bufferedSize));
+        return true;
+    };
+    auto blocks = vector<pair<FlacMetaDataBlockHeader, std::size_t>>();
+    auto metaDataSize = std::size_t();
     for (FlacMetaDataBlockHeader header; !header.isLast();) {
-        // parse block header
-        m_istream->read(buffer, 4);
-        header.parseHeader(buffer);
-
-        // remember start offset
-        const auto startOffset = m_istream->tellg();
+        if (!ensureBuffered(metaDataSize + 4)) {
+            diag.emplace_back(DiagLevel::Critical, "The metadata blocks are truncated.", context);
+            throw TruncatedDataException();
+        }
+        header.parseHeader(buffer.data() + metaDataSize);
+        const auto dataOffset = metaDataSize + 4;
+        if (!ensureBuffered(dataOffset + header.dataSize())) {
+            diag.emplace_back(DiagLevel::Critical, "The metadata blocks are truncated.", context);
+            throw TruncatedDataException();
+        }
+        blocks.emplace_back(header, dataOffset);
+        metaDataSize = dataOffset + header.dataSize();
+    }
+    const auto sharedBuffer = make_shared<vector<char>>(move(buffer));
+    const auto *const data = sharedBuffer->data();
 
-        // parse relevant meta data
+    // parse relevant meta data from the buffer
+    for (const auto &[header, dataOffset] : blocks) {
         switch (static_cast<FlacMetaDataBlockType>(header.type())) {
         case FlacMetaDataBlockType::StreamInfo:
             if (header.dataSize() >= 0x22) {
-                m_istream->read(buffer, 0x22);
                 FlacMetaDataBlockStreamInfo streamInfo;
-                streamInfo.parse(buffer);
+                streamInfo.parse(data + dataOffset);
                 m_channelCount = streamInfo.channelCount();
                 m_samplingFrequency = streamInfo.samplingFrequency();
                 m_sampleCount = streamInfo.totalSampleCount();
@@ -112,19 +254,32 @@ void FlacStream::internalParseHeader(Diagnostics &diag)
                 m_vorbisComment = make_unique<VorbisComment>();
             }
             try {
-                m_vorbisComment->parse(*m_istream, header.dataSize(), VorbisCommentFlags::NoSignature | VorbisCommentFlags::NoFramingByte, diag);
+                stringstream blockStream(ios_base::in | ios_base::out | ios_base::binary);
+                blockStream.exceptions(ios_base::failbit | ios_base::badbit);
+                blockStream.rdbuf()->pubsetbuf(const_cast<char *>(data + dataOffset), static_cast<streamsize>(header.dataSize()));
+                const auto sharingFlags = m_mediaFileInfo.parsingFlags() & ParsingFlags::ShareTagValueData ? VorbisCommentFlags::ShareValueData
+                                                                                                           : VorbisCommentFlags::None;
+                m_vorbisComment->parse(blockStream, header.dataSize(), VorbisCommentFlags::NoSignature | VorbisCommentFlags::NoFramingByte | sharingFlags,
+                    diag, &m_mediaFileInfo.tagFieldFilter());
             } catch (const Failure &) {
                 // error is logged via notifications, just continue with the next metadata block
+            } catch (const std::ios_base::failure &) {
+                diag.emplace_back(DiagLevel::Critical, "\"VORBIS_COMMENT\" is truncated.", context);
             }
             break;
 
         case FlacMetaDataBlockType::Picture:
+            // skip the cover if not included by the tag field filter
+            if (!m_mediaFileInfo.tagFieldFilter().includes(KnownField::Cover, VorbisCommentIds::cover())) {
+                break;
+            }
             try {
-                // parse the cover
+                // parse the cover; let it refer to the buffer instead of copying it if lazy-loading/sharing is wanted
                 VorbisCommentField coverField;
                 coverField.setId(m_vorbisComment->fieldId(KnownField::Cover));
                 FlacMetaDataBlockPicture picture(coverField.value());
-                picture.parse(*m_istream, header.dataSize());
+                const auto refersToBuffer = m_mediaFileInfo.parsingFlags() & (ParsingFlags::LazyLoadPictures | ParsingFlags::ShareTagValueData);
+                picture.parse(data + dataOffset, header.dataSize(), refersToBuffer ? sharedBuffer : nullptr);
                 coverField.setTypeInfo(picture.pictureType());
 
                 if (coverField.value().isEmpty()) {
@@ -148,16 +303,111 @@ void FlacStream::internalParseHeader(Diagnostics &diag)
             m_paddingSize += 4 + header.dataSize();
             break;
 
+        case FlacMetaDataBlockType::SeekTable:
+            m_seekTablePresent = true;
+            break;
+
         default:;
         }
 
-        // seek to next block
-        m_istream->seekg(startOffset + static_cast<decltype(startOffset)>(header.dataSize()));
-
         // TODO: check first FLAC frame
     }
 
-    m_streamOffset = static_cast<std::uint32_t>(m_istream->tellg());
+    m_streamOffset = static_cast<std::uint32_t>(metaDataOffset + metaDataSize);
+    m_istream->seekg(static_cast<streamoff>(m_streamOffset));
+}
+
+/*!
+ * \brief Makes the seek points of a "METADATA_BLOCK_SEEKTABLE" by walking through the FLAC frames.
+ *
+ * The FLAC frame headers are located via a buffered sync search from streamOffset() to the end of the file. Frame
+ * headers are only accepted if their CRC-8 is valid and if they continue the sample numbers of the previous frame. A
+ * seek point is added for each frame containing a multiple of \a interval (like metaflac's "--add-seekpoint=#s" does).
+ *
+ * \returns Returns the data of the block (without "METADATA_BLOCK_HEADER") to be passed to makeHeader() or an empty
+ *          string if the stream already contains a seek table.
+ * \throws Throws InvalidDataException if the STREAMINFO is missing/invalid or no FLAC frames could be found.
+ * \remarks The header must have been parsed before.
+ */
+std::string FlacStream::makeSeekTable(TimeSpan interval, Diagnostics &diag)
+{
+    static const string context("making FLAC seek table");
+    if (m_seekTablePresent) {
+        return std::string();
+    }
+    if (!m_samplingFrequency || interval.isNull() || interval.isNegative()) {
+        diag.emplace_back(DiagLevel::Critical, "The sampling frequency or the interval for seek points is invalid.", context);
+        throw InvalidDataException();
+    }
+    auto intervalInSamples = max<std::uint64_t>(1, static_cast<std::uint64_t>(interval.totalSeconds() * m_samplingFrequency + 0.5));
+    if (m_sampleCount) {
+        // ensure the block does not exceed its max. size
+        intervalInSamples = max<std::uint64_t>(intervalInSamples, m_sampleCount / (0xFFFFFF / seekPointSize) + 1);
+    }
+
+    // walk through the frames
+    auto &stream = m_mediaFileInfo.stream();
+    const auto endOffset = m_mediaFileInfo.size();
+    auto buffer = make_unique<unsigned char[]>(frameScanBufferSize);
+    auto seekTable = std::string();
+    auto previous = FrameHeader(), frame = FrameHeader();
+    auto previousSample = std::uint64_t(), previousOffset = std::uint64_t(), nextSample = std::uint64_t(), nextTarget = std::uint64_t();
+    auto fixedBlockSize = std::uint32_t();
+    auto frameCount = std::uint64_t();
+    const auto addSeekPoint = [&] {
+        auto point = std::string(seekPointSize, '\0');
+        BE::getBytes(previousSample, point.data());
+        BE::getBytes(previousOffset - m_streamOffset, point.data() + 8);
+        BE::getBytes(static_cast<std::uint16_t>(min<std::uint32_t>(previous.blockSize, 0xFFFF)), point.data() + 16);
+        seekTable.append(point);
+    };
+    for (auto bufferOffset = static_cast<std::uint64_t>(m_streamOffset); bufferOffset < endOffset;) {
+        const auto bufferSize = static_cast<std::size_t>(min<std::uint64_t>(frameScanBufferSize, endOffset - bufferOffset));
+        stream.seekg(static_cast<streamoff>(bufferOffset));
+        stream.read(reinterpret_cast<char *>(buffer.get()), static_cast<streamsize>(bufferSize));
+        const auto isLastBuffer = bufferOffset + bufferSize >= endOffset;
+        // leave headers which might be continued within the next buffer for the next buffer
+        const auto scanSize = isLastBuffer ? bufferSize : bufferSize - maxFrameHeaderSize + 1;
+        for (auto index = std::size_t(); index < scanSize; ++index) {
+            const auto *const candidate = static_cast<const unsigned char *>(memchr(buffer.get() + index, 0xFF, scanSize - index));
+            if (!candidate) {
+                break;
+            }
+            index = static_cast<std::size_t>(candidate - buffer.get());
+            if (!parseFrameHeader(candidate, bufferSize - index, frame)) {
+                continue;
+            }
+            if (!frameCount && !frame.variableBlockSize) {
+                fixedBlockSize = frame.blockSize;
+            }
+            const auto sample = frame.variableBlockSize ? frame.number : frame.number * fixedBlockSize;
+            if (sample != nextSample || (frameCount && frame.variableBlockSize != previous.variableBlockSize)) {
+                continue; // false sync within frame data
+            }
+
+            // assign pending targets before this frame to the previous frame
+            if (frameCount && nextTarget < sample) {
+                addSeekPoint();
+                nextTarget = (sample + intervalInSamples - 1) / intervalInSamples * intervalInSamples;
+            }
+            previous = frame;
+            previousSample = sample;
+            previousOffset = bufferOffset + index;
+            nextSample = sample + frame.blockSize;
+            ++frameCount;
+        }
+        bufferOffset += scanSize;
+    }
+    if (!frameCount) {
+        diag.emplace_back(DiagLevel::Critical, "No FLAC frames have been found.", context);
+        throw InvalidDataException();
+    }
+    if (nextTarget < nextSample) {
+        addSeekPoint();
+    }
+    diag.emplace_back(DiagLevel::Information,
+        argsToString("Made seek table with ", seekTable.size() / seekPointSize, " seek points from ", frameCount, " frames."), context);
+    return seekTable;
 }
 
 /*!
@@ -168,10 +418,11 @@ void FlacStream::internalParseHeader(Diagnostics &diag)
  *  - Vorbis comment is updated.
  *  - "METADATA_BLOCK_PICTURE" are updated.
  *  - Padding is skipped
+ *  - If \a seekTable is not empty, it is written as additional "METADATA_BLOCK_SEEKTABLE" (see makeSeekTable()).
  *
  * \returns Returns the start offset of the last "METADATA_BLOCK_HEADER" within \a outputStream.
  */
-std::streamoff FlacStream::makeHeader(ostream &outputStream, Diagnostics &diag)
+std::streamoff FlacStream::makeHeader(ostream &outputStream, Diagnostics &diag, std::string_view seekTable)
 {
     istream &originalStream = m_mediaFileInfo.stream();
     originalStream.seekg(static_cast<streamoff>(m_startOffset + 4));
@@ -208,13 +459,24 @@ std::streamoff FlacStream::makeHeader(ostream &outputStream, Diagnostics &diag)
         }
     } while (!header.isLast());
 
+    // write new seek table
+    if (!seekTable.empty()) {
+        lastStartOffset = outputStream.tellp();
+        header.setType(FlacMetaDataBlockType::SeekTable);
+        header.setDataSize(static_cast<std::uint32_t>(seekTable.size()));
+        header.setLast(!m_vorbisComment);
+        header.makeHeader(outputStream);
+        outputStream.write(seekTable.data(), static_cast<streamsize>(seekTable.size()));
+        lastActuallyWrittenHeader = header;
+    }
+
     // adjust "isLast" flag if neccassary
     if (lastStartOffset >= 4
         && ((!m_vorbisComment && !lastActuallyWrittenHeader.isLast()) || (m_vorbisComment && lastActuallyWrittenHeader.isLast()))) {
         outputStream.seekp(lastStartOffset);
         lastActuallyWrittenHeader.setLast(!m_vorbisComment);
         lastActuallyWrittenHeader.makeHeader(outputStream);
-        originalStream.seekg(lastActuallyWrittenHeader.dataSize(), ios_base::cur);
+        outputStream.seekp(lastActuallyWrittenHeader.dataSize(), ios_base::cur);
     }
 
     // write Vorbis comment
@@ -225,8 +487,19 @@ std::streamoff FlacStream::makeHeader(ostream &outputStream, Diagnostics &diag)
     lastStartOffset = outputStream.tellp();
     outputStream.write(copy.buffer(), 4);
 
-    // determine cover ID since covers must be written separately
-    const auto coverId = m_vorbisComment->fieldId(KnownField::Cover);
+    // determine covers since they must be written separately (the covers of the template take precedence)
+    auto covers = vector<pair<TagValue *, std::uint32_t>>();
+    if (const auto &tagTemplate = m_vorbisComment->tagTemplate(); tagTemplate && tagTemplate->hasField(KnownField::Cover)) {
+        // note: The value is only read when making the "METADATA_BLOCK_PICTURE".
+        for (const auto *const cover : tagTemplate->values(KnownField::Cover)) {
+            covers.emplace_back(const_cast<TagValue *>(cover), VorbisCommentField::TypeInfoType());
+        }
+    } else {
+        const auto coverFields = m_vorbisComment->fields().equal_range(m_vorbisComment->fieldId(KnownField::Cover));
+        for (auto i = coverFields.first; i != coverFields.second; ++i) {
+            covers.emplace_back(&i->second.value(), i->second.typeInfo());
+        }
+    }
 
     // write Vorbis comment
     m_vorbisComment->make(outputStream, VorbisCommentFlags::NoSignature | VorbisCommentFlags::NoFramingByte | VorbisCommentFlags::NoCovers, diag);
@@ -240,7 +513,7 @@ std::streamoff FlacStream::makeHeader(ostream &outputStream, Diagnostics &diag)
         diag.emplace_back(DiagLevel::Critical, "Vorbis Comment is too big and will be truncated.", "write Vorbis Comment to FLAC stream");
     }
     header.setDataSize(static_cast<std::uint32_t>(dataSize));
-    header.setLast(!m_vorbisComment->hasField(coverId));
+    header.setLast(covers.empty());
     outputStream.seekp(lastStartOffset);
     header.makeHeader(outputStream);
     outputStream.seekp(static_cast<streamoff>(dataSize), ios_base::cur);
@@ -251,16 +524,15 @@ std::streamoff FlacStream::makeHeader(ostream &outputStream, Diagnostics &diag)
         return lastStartOffset;
     }
     header.setType(FlacMetaDataBlockType::Picture);
-    const auto coverFields = m_vorbisComment->fields().equal_range(coverId);
-    for (auto i = coverFields.first; i != coverFields.second;) {
+    for (auto i = covers.cbegin(); i != covers.cend();) {
         const auto lastCoverStartOffset = outputStream.tellp();
 
         try {
             // write the structure
-            FlacMetaDataBlockPicture pictureBlock(i->second.value());
-            pictureBlock.setPictureType(i->second.typeInfo());
+            FlacMetaDataBlockPicture pictureBlock(*i->first);
+            pictureBlock.setPictureType(i->second);
             header.setDataSize(pictureBlock.requiredSize());
-            header.setLast(++i == coverFields.second);
+            header.setLast(++i == covers.cend());
             header.makeHeader(outputStream);
             pictureBlock.make(outputStream);
 
@@ -283,7 +555,7 @@ std::streamoff FlacStream::makeHeader(ostream &outputStream, Diagnostics &diag)
         outputStream.seekp(lastStartOffset);
         lastActuallyWrittenHeader.setLast(true);
         lastActuallyWrittenHeader.makeHeader(outputStream);
-        outputStream.seekp(lastActuallyWrittenHeader.dataSize());
+        outputStream.seekp(lastActuallyWrittenHeader.dataSize(), ios_base::cur);
     }
 
     return lastStartOffset;
@@ -291,22 +563,37 @@ std::streamoff FlacStream::makeHeader(ostream &outputStream, Diagnostics &diag)
 
 /*!
  * \brief Writes padding of the specified \a size to the specified \a stream.
- * \remarks Size must be at least 4 bytes.
+ * \remarks
+ * - Size must be at least 4 bytes. It includes the "METADATA_BLOCK_HEADER".
+ * - Padding exceeding the maximum size of a block is split into multiple "PADDING" blocks. Only the last one is
+ *   flagged as last block if \a isLast is set.
  */
 void FlacStream::makePadding(ostream &stream, std::uint32_t size, bool isLast, Diagnostics &diag)
 {
     CPP_UTILITIES_UNUSED(diag)
 
-    // make header
+    static constexpr std::uint32_t maxBlockSize = 4 + 0xFFFFFF;
+    static constexpr char zeroes[0x1000] = { 0 };
     FlacMetaDataBlockHeader header;
     header.setType(FlacMetaDataBlockType::Padding);
-    header.setLast(isLast);
-    header.setDataSize(size -= 4);
-    header.makeHeader(stream);
+    while (size) {
+        // leave at least 4 bytes for the header of the next block if the padding needs to be split
+        auto blockSize = min(size, maxBlockSize);
+        if (size - blockSize && size - blockSize < 4) {
+            blockSize -= 4;
+        }
+        size -= blockSize;
 
-    // write zeroes
-    for (; size; --size) {
-        stream.put(0);
+        // make header
+        header.setLast(isLast && !size);
+        header.setDataSize(blockSize -= 4);
+        header.makeHeader(stream);
+
+        // write zeroes
+        for (std::uint32_t chunkSize; blockSize; blockSize -= chunkSize) {
+            chunkSize = min<std::uint32_t>(blockSize, sizeof(zeroes));
+            stream.write(zeroes, chunkSize);
+        }
     }
 }
 
@@ -5,6 +5,8 @@
 
 #include <iosfwd>
 #include <memory>
+#include <string>
+#include <string_view>
 
 namespace TagParser {
 
@@ -22,8 +24,10 @@ public:
     bool removeVorbisComment();
     std::uint32_t paddingSize() const;
     std::uint32_t streamOffset() const;
+    bool hasSeekTable() const;
 
-    std::streamoff makeHeader(std::ostream &stream, Diagnostics &diag);
+    std::string makeSeekTable(CppUtilities::TimeSpan interval, Diagnostics &diag);
+    std::streamoff makeHeader(std::ostream &stream, Diagnostics &diag, std::string_view seekTable = std::string_view());
     static void makePadding(std::ostream &stream, std::uint32_t size, bool isLast, Diagnostics &diag);
 
 protected:
@@ -34,6 +38,7 @@ private:
     std::unique_ptr<VorbisComment> m_vorbisComment;
     std::uint32_t m_paddingSize;
     std::uint32_t m_streamOffset;
+    bool m_seekTablePresent;
 };
 
 inline FlacStream::~FlacStream()
@@ -70,6 +75,14 @@ inline std::uint32_t FlacStream::streamOffset() const
     return m_streamOffset;
 }
 
+/*!
+ * \brief Returns whether the stream contains a "METADATA_BLOCK_SEEKTABLE".
+ */
+inline bool FlacStream::hasSeekTable() const
+{
+    return m_seekTablePresent;
+}
+
 } // namespace TagParser
 
 #endif // TAG_PARSER_FLACSTREAM_H
@@ -0,0 +1,345 @@
+#ifndef TAG_PARSER_FLATMULTIMAP_H
+#define TAG_PARSER_FLATMULTIMAP_H
+
+#include "./global.h"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace TagParser {
+
+/*!
+ * \class TagParser::FlatMultiMap
+ * \brief The FlatMultiMap class is an associative container storing its elements in a sorted std::vector.
+ *
+ * It provides the subset of the std::multimap interface used by FieldMapBasedTag and its subclasses. Elements
+ * with equivalent keys keep their insertion order (like with std::multimap). In contrast to std::multimap all
+ * elements are stored within one contiguous allocation which makes lookups and iterations cache-friendly and
+ * avoids one allocation per element.
+ *
+ * \remarks
+ * - Inserting and erasing invalidates all iterators and references to elements.
+ * - The key of an element must not be modified via an iterator because this would break the ordering.
+ */
+template <typename KeyType, typename MappedType, typename CompareType = std::less<KeyType>> class FlatMultiMap {
+public:
+    using key_type = KeyType;
+    using mapped_type = MappedType;
+    using value_type = std::pair<KeyType, MappedType>;
+    using key_compare = CompareType;
+    using container_type = std::vector<value_type>;
+    using size_type = typename container_type::size_type;
+    using reference = value_type &;
+    using const_reference = const value_type &;
+    using iterator = typename container_type::iterator;
+    using const_iterator = typename container_type::const_iterator;
+
+    FlatMultiMap() = default;
+    explicit FlatMultiMap(const CompareType &compare);
+
+    iterator begin();
+    const_iterator begin() const;
+    const_iterator cbegin() const;
+    iterator end();
+    const_iterator end() const;
+    const_iterator cend() const;
+
+    bool empty() const;
+    size_type size() const;
+    size_type capacity() const;
+    void reserve(size_type size);
+    void clear();
+    key_compare key_comp() const;
+
+    iterator find(const KeyType &key);
+    const_iterator find(const KeyType &key) const;
+    size_type count(const KeyType &key) const;
+    iterator lower_bound(const KeyType &key);
+    const_iterator lower_bound(const KeyType &key) const;
+    iterator upper_bound(const KeyType &key);
+    const_iterator upper_bound(const KeyType &key) const;
+    std::pair<iterator, iterator> equal_range(const KeyType &key);
+    std::pair<const_iterator, const_iterator> equal_range(const KeyType &key) const;
+
+    iterator insert(const value_type &value);
+    iterator insert(value_type &&value);
+    template <typename... Args> iterator emplace(Args &&...args);
+    iterator erase(const_iterator position);
+    iterator erase(const_iterator first, const_iterator last);
+    size_type erase(const KeyType &key);
+
+private:
+    struct ValueCompare {
+        bool operator()(const value_type &lhs, const KeyType &rhs) const;
+        bool operator()(const KeyType &lhs, const value_type &rhs) const;
+        CompareType compare;
+    };
+
+    container_type m_values;
+    ValueCompare m_compare;
+};
+
+/*!
+ * \brief Constructs a new, empty map using the specified \a compare function.
+ */
+template <typename KeyType, typename MappedType, typename CompareType>
+inline FlatMultiMap<KeyType, MappedType, CompareType>::FlatMultiMap(const CompareType &compare)
+    : m_compare{ compare }
+{
+}
+
+template <typename KeyType, typename MappedType, typename CompareType>
+inline bool FlatMultiMap<KeyType, MappedType, CompareType>::ValueCompare::operator()(const value_type &lhs, const KeyType &rhs) const
+{
+    return compare(lhs.first, rhs);
+}
+
+template <typename KeyType, typename MappedType, typename CompareType>
+inline bool FlatMultiMap<KeyType, MappedType, CompareType>::ValueCompare::operator()(const KeyType &lhs, const value_type &rhs) const
+{
+    return compare(lhs, rhs.first);
+}
+
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::begin() -> iterator
+{
+    return m_values.begin();
+}
+
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::begin() const -> const_iterator
+{
+    return m_values.begin();
+}
+
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::cbegin() const -> const_iterator
+{
+    return m_values.cbegin();
+}
+
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::end() -> iterator
+{
+    return m_values.end();
+}
+
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::end() const -> const_iterator
+{
+    return m_values.end();
+}
+
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::cend() const -> const_iterator
+{
+    return m_values.cend();
+}
+
+/*!
+ * \brief Returns whether the map is empty.
+ */
+template <typename KeyType, typename MappedType, typename CompareType> inline bool FlatMultiMap<KeyType, MappedType, CompareType>::empty() const
+{
+    return m_values.empty();
+}
+
+/*!
+ * \brief Returns the number of elements.
+ */
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::size() const -> size_type
+{
+    return m_values.size();
+}
+
+/*!
+ * \brief Returns the number of elements which can be stored without reallocation.
+ */
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::capacity() const -> size_type
+{
+    return m_values.capacity();
+}
+
+/*!
+ * \brief Reserves space for the specified number of elements.
+ */
+template <typename KeyType, typename MappedType, typename CompareType>
+inline void FlatMultiMap<KeyType, MappedType, CompareType>::reserve(size_type size)
+{
+    m_values.reserve(size);
+}
+
+/*!
+ * \brief Removes all elements.
+ */
+template <typename KeyType, typename MappedType, typename CompareType> inline void FlatMultiMap<KeyType, MappedType, CompareType>::clear()
+{
+    m_values.clear();
+}
+
+/*!
+ * \brief Returns the function used to compare keys.
+ */
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::key_comp() const -> key_compare
+{
+    return m_compare.compare;
+}
+
+/*!
+ * \brief Returns the first element with the specified \a key or end() if there is no such element.
+ */
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::find(const KeyType &key) -> iterator
+{
+    const auto i = lower_bound(key);
+    return i != m_values.end() && !m_compare(key, *i) ? i : m_values.end();
+}
+
+/*!
+ * \brief Returns the first element with the specified \a key or end() if there is no such element.
+ */
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::find(const KeyType &key) const -> const_iterator
+{
+    const auto i = lower_bound(key);
+    return i != m_values.end() && !m_compare(key, *i) ? i : m_values.end();
+}
+
+/*!
+ * \brief Returns the number of elements with the specified \a key.
+ */
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::count(const KeyType &key) const -> size_type
+{
+    const auto range = equal_range(key);
+    return static_cast<size_type>(range.second - range.first);
+}
+
+/*!
+ * \brief Returns the first element whose key is not less than the specified \a key.
+ */
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::lower_bound(const KeyType &key) -> iterator
+{
+    return std::lower_bound(m_values.begin(), m_values.end(), key, m_compare);
+}
+
+/*!
+ * \brief Returns the first element whose key is not less than the specified \a key.
+ */
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::lower_bound(const KeyType &key) const -> const_iterator
+{
+    return std::lower_bound(m_values.begin(), m_values.end(), key, m_compare);
+}
+
+/*!
+ * \brief Returns the first element whose key is greater than the specified \a key.
+ */
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::upper_bound(const KeyType &key) -> iterator
+{
+    return std::upper_bound(m_values.begin(), m_values.end(), key, m_compare);
+}
+
+/*!
+ * \brief Returns the first element whose key is greater than the specified \a key.
+ */
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::upper_bound(const KeyType &key) const -> const_iterator
+{
+    return std::upper_bound(m_values.begin(), m_values.end(), key, m_compare);
+}
+
+/*!
+ * \brief Returns the range of elements with the specified \a key.
+ */
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::equal_range(const KeyType &key) -> std::pair<iterator, iterator>
+{
+    return std::equal_range(m_values.begin(), m_values.end(), key, m_compare);
+}
+
+/*!
+ * \brief Returns the range of elements with the specified \a key.
+ */
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::equal_range(const KeyType &key) const -> std::pair<const_iterator, const_iterator>
+{
+    return std::equal_range(m_values.begin(), m_values.end(), key, m_compare);
+}
+
+/*!
+ * \brief Inserts the specified \a value behind all elements with an equivalent key.
+ * \returns Returns an iterator to the inserted element.
+ */
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::insert(const value_type &value) -> iterator
+{
+    return m_values.insert(upper_bound(value.first), value);
+}
+
+/*!
+ * \brief Inserts the specified \a value behind all elements with an equivalent key.
+ * \returns Returns an iterator to the inserted element.
+ * \remarks Inserting elements in order is cheap as they are appended in this case.
+ */
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::insert(value_type &&value) -> iterator
+{
+    const auto position = upper_bound(value.first);
+    return m_values.insert(position, std::move(value));
+}
+
+/*!
+ * \brief Constructs an element from the specified \a args and inserts it behind all elements with an equivalent key.
+ * \returns Returns an iterator to the inserted element.
+ */
+template <typename KeyType, typename MappedType, typename CompareType>
+template <typename... Args>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::emplace(Args &&...args) -> iterator
+{
+    return insert(value_type(std::forward<Args>(args)...));
+}
+
+/*!
+ * \brief Removes the element at the specified \a position.
+ * \returns Returns an iterator to the element following the removed element.
+ */
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::erase(const_iterator position) -> iterator
+{
+    return m_values.erase(position);
+}
+
+/*!
+ * \brief Removes the elements within the specified range.
+ * \returns Returns an iterator to the element following the removed elements.
+ */
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::erase(const_iterator first, const_iterator last) -> iterator
+{
+    return m_values.erase(first, last);
+}
+
+/*!
+ * \brief Removes all elements with the specified \a key.
+ * \returns Returns the number of removed elements.
+ */
+template <typename KeyType, typename MappedType, typename CompareType>
+inline auto FlatMultiMap<KeyType, MappedType, CompareType>::erase(const KeyType &key) -> size_type
+{
+    const auto range = equal_range(key);
+    const auto count = static_cast<size_type>(range.second - range.first);
+    m_values.erase(range.first, range.second);
+    return count;
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_FLATMULTIMAP_H
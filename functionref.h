@@ -0,0 +1,63 @@
+#ifndef TAG_PARSER_FUNCTIONREF_H
+#define TAG_PARSER_FUNCTIONREF_H
+
+#include "./global.h"
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace TagParser {
+
+template <typename Signature> class FunctionRef;
+
+/*!
+ * \class TagParser::FunctionRef
+ * \brief The FunctionRef class references a callable without owning it.
+ *
+ * In contrast to std::function it never allocates and is only two pointers big. It is used for callbacks which are
+ * only invoked while the function taking them runs, e.g. the visitor functions of MediaFileInfo. Lambdas can be passed
+ * directly.
+ *
+ * \remarks The referenced callable must outlive the FunctionRef. So a FunctionRef must not be stored and must not be
+ *          constructed from a temporary which is destroyed before the FunctionRef is invoked.
+ */
+template <typename ResultType, typename... ArgumentTypes> class FunctionRef<ResultType(ArgumentTypes...)> {
+public:
+    template <typename Callable,
+        typename = std::enable_if_t<!std::is_same_v<std::remove_cv_t<std::remove_reference_t<Callable>>, FunctionRef>
+            && std::is_invocable_r_v<ResultType, Callable &, ArgumentTypes...>>>
+    FunctionRef(Callable &&callable) noexcept;
+
+    ResultType operator()(ArgumentTypes... arguments) const;
+
+private:
+    void *m_callable;
+    ResultType (*m_invoke)(void *callable, ArgumentTypes... arguments);
+};
+
+/*!
+ * \brief Constructs a new reference to the specified \a callable.
+ */
+template <typename ResultType, typename... ArgumentTypes>
+template <typename Callable, typename>
+inline FunctionRef<ResultType(ArgumentTypes...)>::FunctionRef(Callable &&callable) noexcept
+    : m_callable(const_cast<void *>(static_cast<const void *>(std::addressof(callable))))
+    , m_invoke([](void *callable, ArgumentTypes... arguments) -> ResultType {
+        return (*static_cast<std::remove_reference_t<Callable> *>(callable))(std::forward<ArgumentTypes>(arguments)...);
+    })
+{
+}
+
+/*!
+ * \brief Invokes the referenced callable with the specified \a arguments.
+ */
+template <typename ResultType, typename... ArgumentTypes>
+inline ResultType FunctionRef<ResultType(ArgumentTypes...)>::operator()(ArgumentTypes... arguments) const
+{
+    return m_invoke(m_callable, std::forward<ArgumentTypes>(arguments)...);
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_FUNCTIONREF_H
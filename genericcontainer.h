@@ -69,9 +69,10 @@ private:
  */
 template <class FileInfoType, class TagType, class TrackType, class ElementType>
 GenericContainer<FileInfoType, TagType, TrackType, ElementType>::GenericContainer(FileInfoType &fileInfo, std::uint64_t startOffset)
-    : AbstractContainer(fileInfo.stream(), startOffset)
+    : AbstractContainer(fileInfo.inputStream(), startOffset)
     , m_fileInfo(&fileInfo)
 {
+    setMappedData(&fileInfo.mappedData());
 }
 
 /*!
@@ -284,7 +285,10 @@ bool GenericContainer<FileInfoType, TagType, TrackType, ElementType>::removeTag(
         m_tags.erase(std::remove_if(m_tags.begin(), m_tags.end(),
                          [tag](const std::unique_ptr<TagType> &existingTag) -> bool { return static_cast<Tag *>(existingTag.get()) == tag; }),
             m_tags.end());
-        return size != m_tags.size();
+        if (size == m_tags.size()) {
+            return false;
+        }
+        return m_modified = true;
     }
     return false;
 }
@@ -292,6 +296,7 @@ bool GenericContainer<FileInfoType, TagType, TrackType, ElementType>::removeTag(
 template <class FileInfoType, class TagType, class TrackType, class ElementType>
 inline void GenericContainer<FileInfoType, TagType, TrackType, ElementType>::removeAllTags()
 {
+    m_modified = m_modified || !m_tags.empty();
     m_tags.clear();
 }
 
@@ -371,6 +376,7 @@ void GenericContainer<FileInfoType, TagType, TrackType, ElementType>::reset()
     m_additionalElements.clear();
     m_tracks.clear();
     m_tags.clear();
+    releaseElementArena();
 }
 
 } // namespace TagParser
@@ -1,17 +1,21 @@
 #ifndef TAG_PARSER_GENERICFILEELEMENT_H
 #define TAG_PARSER_GENERICFILEELEMENT_H
 
+#include "./elementarena.h"
 #include "./exceptions.h"
 #include "./progressfeedback.h"
 
 #include <c++utilities/io/copy.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <initializer_list>
-#include <iostream>
+#include <istream>
 #include <list>
 #include <memory>
+#include <ostream>
 #include <string>
+#include <vector>
 
 namespace CppUtilities {
 class BinaryReader;
@@ -34,6 +38,15 @@ class Diagnostics;
 template <typename ImplementationType> class FileElementTraits {
 };
 
+/*!
+ * \brief The ElementTraversal enum specifies how GenericFileElement::traverseSubsequentElements() proceeds after visiting an element.
+ */
+enum class ElementTraversal {
+    Continue, /**< continue with the children of the element and then with its subsequent siblings */
+    SkipChildren, /**< skip the children of the element and continue with its subsequent siblings */
+    Stop, /**< stop the traversal */
+};
+
 /*!
  * \class TagParser::GenericFileElement
  * \brief The GenericFileElement class helps to parse binary files which consist
@@ -67,6 +80,12 @@ public:
     GenericFileElement(const GenericFileElement &other) = delete;
     GenericFileElement(GenericFileElement &other) = delete;
     GenericFileElement &operator=(const GenericFileElement &other) = delete;
+    ~GenericFileElement();
+
+    static void *operator new(std::size_t size);
+    static void *operator new(std::size_t size, ElementArena *arena);
+    static void operator delete(void *element);
+    static void operator delete(void *element, ElementArena *arena);
 
     ContainerType &container();
     const ContainerType &container() const;
@@ -112,8 +131,11 @@ public:
     bool isParsed() const;
     void clear();
     void parse(Diagnostics &diag);
+    ParsingError tryParse(Diagnostics &diag);
     void reparse(Diagnostics &diag);
+    void resumeSiblings(Diagnostics &diag, std::vector<ImplementationType *> *createdElements = nullptr);
     void validateSubsequentElementStructure(Diagnostics &diag, std::uint64_t *paddingSize = nullptr);
+    template <typename VisitorType> bool traverseSubsequentElements(Diagnostics &diag, VisitorType &&visitor);
     static constexpr std::uint32_t maximumIdLengthSupported();
     static constexpr std::uint32_t maximumSizeLengthSupported();
     static constexpr std::uint8_t minimumElementSize();
@@ -125,9 +147,12 @@ public:
     void copyBuffer(std::ostream &targetStream);
     void copyPreferablyFromBuffer(std::ostream &targetStream, Diagnostics &diag, AbortableProgressFeedback *progress);
     const std::unique_ptr<char[]> &buffer();
+    const char *mappedData(std::uint64_t offset, std::uint64_t size) const;
     ImplementationType *denoteFirstChild(std::uint32_t offset);
 
 protected:
+    ParsingError internalTryParse(Diagnostics &diag);
+
     IdentifierType m_id;
     std::uint64_t m_startOffset;
     std::uint64_t m_maxSize;
@@ -140,10 +165,19 @@ protected:
     std::unique_ptr<char[]> m_buffer;
 
 private:
+    /// \brief The ChildIndex struct maps IDs to the first child with the ID (see childById()).
+    struct ChildIndex {
+        /// \brief The IDs of the children indexed so far and the first child with the ID sorted by the ID.
+        std::vector<std::pair<IdentifierType, ImplementationType *>> entries;
+        /// \brief The last child which has been indexed; the index is extended starting from its next sibling.
+        ImplementationType *lastIndexedChild = nullptr;
+    };
+
     void copyInternal(
         std::ostream &targetStream, std::uint64_t startOffset, std::uint64_t bytesToCopy, Diagnostics &diag, AbortableProgressFeedback *progress);
 
     ContainerType *m_container;
+    std::unique_ptr<ChildIndex> m_childIndex;
     bool m_parsed;
 
 protected:
@@ -213,6 +247,71 @@ GenericFileElement<ImplementationType>::GenericFileElement(
 {
 }
 
+/*!
+ * \brief Destroys the element, its children and its subsequent siblings.
+ * \remarks The tree is torn down using an explicit stack (and not recursively) so long sibling chains and deeply
+ *          nested elements can not exhaust the call stack.
+ */
+template <class ImplementationType> GenericFileElement<ImplementationType>::~GenericFileElement()
+{
+    if (!m_firstChild && !m_nextSibling) {
+        return;
+    }
+    auto pending = std::vector<std::unique_ptr<ImplementationType>>();
+    if (m_firstChild) {
+        pending.emplace_back(std::move(m_firstChild));
+    }
+    if (m_nextSibling) {
+        pending.emplace_back(std::move(m_nextSibling));
+    }
+    while (!pending.empty()) {
+        auto element = std::move(pending.back());
+        pending.pop_back();
+        if (element->m_firstChild) {
+            pending.emplace_back(std::move(element->m_firstChild));
+        }
+        if (element->m_nextSibling) {
+            pending.emplace_back(std::move(element->m_nextSibling));
+        }
+        // element is destroyed here without recursing as its children and siblings have been detached
+    }
+}
+
+/*!
+ * \brief Allocates memory for an element on the heap.
+ */
+template <class ImplementationType> inline void *GenericFileElement<ImplementationType>::operator new(std::size_t size)
+{
+    return ElementArena::allocateElement(size, nullptr);
+}
+
+/*!
+ * \brief Allocates memory for an element within the specified \a arena (or on the heap if \a arena is nullptr).
+ * \remarks This is used to create children and siblings with the arena of the container, eg.
+ *          `new (container().elementArena()) ImplementationType(...)`.
+ */
+template <class ImplementationType> inline void *GenericFileElement<ImplementationType>::operator new(std::size_t size, ElementArena *arena)
+{
+    return ElementArena::allocateElement(size, arena);
+}
+
+/*!
+ * \brief Deallocates the memory of an element.
+ * \remarks Memory allocated within an arena is only released when the arena is released.
+ */
+template <class ImplementationType> inline void GenericFileElement<ImplementationType>::operator delete(void *element)
+{
+    ElementArena::deallocateElement(element);
+}
+
+/*!
+ * \brief Deallocates the memory of an element which could not be constructed.
+ */
+template <class ImplementationType> inline void GenericFileElement<ImplementationType>::operator delete(void *element, ElementArena *)
+{
+    ElementArena::deallocateElement(element);
+}
+
 /*!
  * \brief Returns the related container.
  */
@@ -518,17 +617,8 @@ template <class ImplementationType> inline const ImplementationType *GenericFile
 template <class ImplementationType>
 ImplementationType *GenericFileElement<ImplementationType>::subelementByPath(Diagnostics &diag, IdentifierType item)
 {
-    // ensure element is parsed
-    parse(diag);
-    // return the element if it matches the current and last item in the path
-    if (item == id()) {
-        return static_cast<ImplementationType *>(this);
-    }
-    // check whether a sibling matches the item
-    if (nextSibling()) {
-        return nextSibling()->subelementByPath(diag, item);
-    }
-    return nullptr;
+    // return the element or the first sibling matching the current and last item in the path
+    return siblingByIdIncludingThis(item, diag);
 }
 
 /*!
@@ -543,20 +633,13 @@ ImplementationType *GenericFileElement<ImplementationType>::subelementByPath(Dia
 template <class ImplementationType>
 ImplementationType *GenericFileElement<ImplementationType>::subelementByPath(Diagnostics &diag, IdentifierType item, IdentifierType remainingPath...)
 {
-    // ensure element is parsed
-    parse(diag);
-    // continue with next item in path if the element matches the current item
-    if (item == id()) {
-        if (!firstChild()) {
-            return nullptr;
-        }
-        return firstChild()->subelementByPath(diag, remainingPath);
-    }
-    // check whether a sibling matches the current item
-    if (nextSibling()) {
-        return nextSibling()->subelementByPath(diag, item, remainingPath);
+    // find the element or the first sibling matching the current item
+    auto *const element = siblingByIdIncludingThis(item, diag);
+    if (!element) {
+        return nullptr;
     }
-    return nullptr;
+    // continue with next item in path within the children of the matching element
+    return element->childById(remainingPath, diag);
 }
 
 /*!
@@ -596,14 +679,36 @@ const ImplementationType *GenericFileElement<ImplementationType>::subelementByPa
  * The current element keeps ownership over the returned element.
  * If no element could be found nullptr is returned.
  *
+ * \remarks The children visited when looking up an ID are stored in a small table sorted by ID which is allocated on
+ *          the first lookup. So subsequent lookups only need to visit the children which have not been visited yet.
+ *          The table is discarded when the element or one of its children is cleared/reparsed.
  * \throws Throws a parsing exception when a parsing error occurs.
  * \throws Throws std::ios_base::failure when an IO error occurs.
  */
 template <class ImplementationType> ImplementationType *GenericFileElement<ImplementationType>::childById(const IdentifierType &id, Diagnostics &diag)
 {
     parse(diag); // ensure element is parsed
-    for (ImplementationType *child = firstChild(); child; child = child->nextSibling()) {
+    if (!m_childIndex) {
+        m_childIndex = std::make_unique<ChildIndex>();
+    }
+    auto &entries = m_childIndex->entries;
+    const auto entryLessThanId = [](const auto &entry, const IdentifierType &entryId) { return entry.first < entryId; };
+    auto entry = std::lower_bound(entries.begin(), entries.end(), id, entryLessThanId);
+    if (entry != entries.end() && entry->first == id) {
+        return entry->second;
+    }
+    // extend the index by the children which have not been visited yet
+    auto *&lastIndexedChild = m_childIndex->lastIndexedChild;
+    for (ImplementationType *child = lastIndexedChild ? lastIndexedChild->nextSibling() : firstChild(); child; child = child->nextSibling()) {
         child->parse(diag);
+        if (child->parent() != static_cast<ImplementationType *>(this)) {
+            break; // the child has been moved higher up in the hierarchy when parsing it and hence the end is reached
+        }
+        lastIndexedChild = child;
+        entry = std::lower_bound(entries.begin(), entries.end(), child->id(), entryLessThanId);
+        if (entry == entries.end() || entry->first != child->id()) {
+            entries.emplace(entry, child->id(), child);
+        }
         if (child->id() == id) {
             return child;
         }
@@ -679,6 +784,9 @@ template <class ImplementationType>
 ImplementationType *GenericFileElement<ImplementationType>::siblingByIdIncludingThis(const IdentifierType &id, Diagnostics &diag)
 {
     parse(diag); // ensure element is parsed
+    if (m_parent && m_parent->firstChild() == this) {
+        return m_parent->childById(id, diag); // use the index of the parent when starting from its first child
+    }
     for (ImplementationType *sibling = static_cast<ImplementationType *>(this); sibling; sibling = sibling->nextSibling()) {
         sibling->parse(diag);
         if (sibling->id() == id) {
@@ -751,6 +859,10 @@ template <class ImplementationType> void GenericFileElement<ImplementationType>:
     m_sizeLength = 0;
     m_nextSibling = nullptr;
     m_firstChild = nullptr;
+    m_childIndex.reset();
+    if (m_parent) {
+        m_parent->m_childIndex.reset(); // subsequent siblings might have been indexed
+    }
     m_parsed = false;
 }
 
@@ -771,11 +883,38 @@ template <class ImplementationType> void GenericFileElement<ImplementationType>:
 template <class ImplementationType> void GenericFileElement<ImplementationType>::parse(Diagnostics &diag)
 {
     if (!m_parsed) {
+        container().accountElement(sizeof(ImplementationType), diag);
         static_cast<ImplementationType *>(this)->internalParse(diag);
         m_parsed = true;
     }
 }
 
+/*!
+ * \brief Parses the header information of the element like parse() but returns parsing errors instead of throwing.
+ *
+ * This is meant for loops which check many positions for an element, e.g. when re-syncing after invalid data, where
+ * throwing an exception for each position would be costly. The public API still throws via parse().
+ *
+ * \returns Returns ParsingError::None if the element has been parsed (or has already been parsed before); otherwise
+ *          the error corresponding to the exception parse() would throw. The element is not considered parsed then.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ * \throws Throws TagParser::Failure or a derived exception for errors other than InvalidDataException and
+ *         TruncatedDataException, e.g. MemoryLimitExceededException.
+ * \remarks Implementations which can detect errors without throwing hide internalTryParse(). Otherwise the exceptions
+ *          thrown by internalParse() are converted.
+ */
+template <class ImplementationType> ParsingError GenericFileElement<ImplementationType>::tryParse(Diagnostics &diag)
+{
+    if (!m_parsed) {
+        container().accountElement(sizeof(ImplementationType), diag);
+        if (const auto error = static_cast<ImplementationType *>(this)->internalTryParse(diag); error != ParsingError::None) {
+            return error;
+        }
+        m_parsed = true;
+    }
+    return ParsingError::None;
+}
+
 /*!
  * \brief Parses the header information of the element which is read from the related
  *        stream at the start offset.
@@ -799,6 +938,79 @@ template <class ImplementationType> void GenericFileElement<ImplementationType>:
     m_parsed = true;
 }
 
+/*!
+ * \brief Takes data into account which has been appended to the file after this element and its siblings have been parsed.
+ *
+ * The maximum size of this element and its subsequent siblings is updated to the current size of the file (or to the end
+ * of the parent). If the last sibling has been cut off by the previous end or its size is unknown, its header is read
+ * again and its children are extended in the same way; the existing children are kept so pointers to them stay valid.
+ * If there is space after the last sibling, a new sibling is denoted. Denoted elements are not parsed but added to
+ * \a createdElements if not nullptr.
+ *
+ * Siblings which have not been parsed yet are only updated because the elements after them are found by parsing them
+ * as usual.
+ *
+ * \remarks Only appended data is taken into account; parsed elements are assumed to be unchanged.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+template <class ImplementationType>
+void GenericFileElement<ImplementationType>::resumeSiblings(Diagnostics &diag, std::vector<ImplementationType *> *createdElements)
+{
+    const auto endOffset = m_parent ? m_parent->endOffset() : container().fileInfo().size();
+    auto *element = static_cast<ImplementationType *>(this);
+    auto previousEndOffset = std::uint64_t();
+    for (;; element = element->nextSibling()) {
+        previousEndOffset = element->m_startOffset + element->m_maxSize;
+        element->m_maxSize = endOffset > element->m_startOffset ? endOffset - element->m_startOffset : 0;
+        if (!element->m_parsed) {
+            return;
+        }
+        if (!element->m_nextSibling) {
+            break;
+        }
+    }
+
+    // read the header of the last sibling again if it reached the previous end, using a probe to keep its children
+    if (element->endOffset() >= previousEndOffset) {
+        auto probe = m_parent ? ImplementationType(*m_parent, element->m_startOffset)
+                              : ImplementationType(container(), element->m_startOffset, element->m_maxSize);
+        try {
+            probe.parse(diag);
+        } catch (const Failure &) {
+            return;
+        }
+        if (probe.m_id != element->m_id || probe.headerSize() != element->headerSize()) {
+            return;
+        }
+        element->m_dataSize = probe.m_dataSize;
+        element->m_sizeUnknown = probe.m_sizeUnknown;
+        element->m_childIndex.reset();
+        if (element->m_firstChild) {
+            element->m_firstChild->resumeSiblings(diag, createdElements);
+        } else if (const auto firstChildOffset = element->firstChildOffset(); firstChildOffset && firstChildOffset < element->totalSize()) {
+            element->m_firstChild.reset(new (container().elementArena()) ImplementationType(*element, element->m_startOffset + firstChildOffset));
+            if (createdElements) {
+                createdElements->emplace_back(element->m_firstChild.get());
+            }
+        }
+    }
+
+    // denote the element following the last sibling
+    if (element->endOffset() >= endOffset) {
+        return;
+    }
+    if (m_parent) {
+        element->m_nextSibling.reset(new (container().elementArena()) ImplementationType(*m_parent, element->endOffset()));
+        m_parent->m_childIndex.reset();
+    } else {
+        element->m_nextSibling.reset(
+            new (container().elementArena()) ImplementationType(container(), element->endOffset(), endOffset - element->endOffset()));
+    }
+    if (createdElements) {
+        createdElements->emplace_back(element->m_nextSibling.get());
+    }
+}
+
 /*!
  * \brief Parses (see parse()) this and all subsequent elements.
  *
@@ -814,23 +1026,77 @@ template <class ImplementationType> void GenericFileElement<ImplementationType>:
 template <class ImplementationType>
 void GenericFileElement<ImplementationType>::validateSubsequentElementStructure(Diagnostics &diag, std::uint64_t *paddingSize)
 {
-    // validate element itself by just parsing it
-    parse(diag);
-    // validate children
-    if (firstChild()) {
+    // keep track of the next element to validate on each level (using an explicit stack instead of recursion)
+    auto levels = std::vector<ImplementationType *>{ static_cast<ImplementationType *>(this) };
+    while (!levels.empty()) {
+        auto *const element = levels.back();
+        if (!element) {
+            levels.pop_back();
+            continue;
+        }
+        // validate element itself by just parsing it
         try {
-            firstChild()->validateSubsequentElementStructure(diag, paddingSize);
+            element->parse(diag);
         } catch (const Failure &) {
-            // ignore critical errors in child structure to continue validating siblings
+            if (levels.size() == 1) {
+                throw;
+            }
+            // ignore critical errors in child structure to continue validating siblings of the parent
             // (critical notifications about the errors should have already been added to diag, so nothing to do)
+            levels.pop_back();
+            continue;
+        }
+        // validate siblings after children
+        levels.back() = element->nextSibling();
+        // validate children
+        if (auto *const child = element->firstChild()) {
+            levels.emplace_back(child);
+        } else if (paddingSize && element->isPadding()) { // element is padding
+            *paddingSize += element->totalSize();
         }
-    } else if (paddingSize && isPadding()) { // element is padding
-        *paddingSize += totalSize();
     }
-    // validate siblings
-    if (nextSibling()) {
-        nextSibling()->validateSubsequentElementStructure(diag, paddingSize);
+}
+
+/*!
+ * \brief Visits this element, its subsequent siblings and all of their children in document order.
+ *
+ * Each element is parsed before being passed to \a visitor. The \a visitor is invoked with a reference to the element
+ * and must return an ElementTraversal value to specify how to proceed.
+ *
+ * The traversal uses an explicit stack so neither long sibling chains nor deeply nested elements can exhaust the call stack.
+ *
+ * \returns Returns whether all elements have been visited (false if \a visitor returned ElementTraversal::Stop).
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ * \throws Throws TagParser::Failure or a derived exception when a parsing
+ *         error occurs.
+ */
+template <class ImplementationType>
+template <typename VisitorType>
+bool GenericFileElement<ImplementationType>::traverseSubsequentElements(Diagnostics &diag, VisitorType &&visitor)
+{
+    auto levels = std::vector<ImplementationType *>{ static_cast<ImplementationType *>(this) };
+    while (!levels.empty()) {
+        auto *const element = levels.back();
+        if (!element) {
+            levels.pop_back();
+            continue;
+        }
+        element->parse(diag);
+        const auto traversal = visitor(*element);
+        levels.back() = element->nextSibling();
+        switch (traversal) {
+        case ElementTraversal::Continue:
+            if (auto *const child = element->firstChild()) {
+                levels.emplace_back(child);
+            }
+            break;
+        case ElementTraversal::SkipChildren:
+            break;
+        case ElementTraversal::Stop:
+            return false;
+        }
     }
+    return true;
 }
 
 /*!
@@ -871,6 +1137,10 @@ void GenericFileElement<ImplementationType>::copyEntirely(std::ostream &targetSt
 template <class ImplementationType> void GenericFileElement<ImplementationType>::makeBuffer()
 {
     m_buffer = std::make_unique<char[]>(totalSize());
+    if (const char *const data = mappedData(startOffset(), totalSize())) {
+        std::copy(data, data + totalSize(), m_buffer.get());
+        return;
+    }
     container().stream().seekg(startOffset());
     container().stream().read(m_buffer.get(), totalSize());
 }
@@ -912,6 +1182,19 @@ template <class ImplementationType> inline const std::unique_ptr<char[]> &Generi
     return m_buffer;
 }
 
+/*!
+ * \brief Returns a pointer to \a size bytes at the specified absolute \a offset within the memory-mapped file.
+ * \returns Returns nullptr if the file is not memory-mapped or the requested range exceeds the mapping. Callers
+ *          need to fall back to reading from the stream() in that case.
+ * \sa BasicFileInfo::mappedData()
+ */
+template <class ImplementationType>
+inline const char *GenericFileElement<ImplementationType>::mappedData(std::uint64_t offset, std::uint64_t size) const
+{
+    const auto mapping = m_container->mappedData();
+    return !mapping.empty() && offset <= mapping.size() && size <= mapping.size() - offset ? mapping.data() + offset : nullptr;
+}
+
 /*!
  * \brief Internally used to perform copies of the atom.
  *
@@ -930,14 +1213,9 @@ void GenericFileElement<ImplementationType>::copyInternal(
         throw InvalidDataException();
     }
     auto &stream = container().stream();
-    stream.seekg(startOffset);
-    CppUtilities::CopyHelper<0x10000> copyHelper;
-    if (progress) {
-        copyHelper.callbackCopy(stream, targetStream, bytesToCopy, std::bind(&AbortableProgressFeedback::isAborted, std::ref(progress)),
-            std::bind(&AbortableProgressFeedback::updateStepPercentageFromFraction, std::ref(progress), std::placeholders::_1));
-    } else {
-        copyHelper.copy(stream, targetStream, bytesToCopy);
-    }
+    stream.seekg(static_cast<std::streamoff>(startOffset));
+    // use the range copier so the kernel copies the data when rewriting the file
+    container().rangeCopier().copy(stream, targetStream, bytesToCopy, progress);
 }
 
 /*!
@@ -947,8 +1225,10 @@ void GenericFileElement<ImplementationType>::copyInternal(
 template <class ImplementationType>
 ImplementationType *GenericFileElement<ImplementationType>::denoteFirstChild(std::uint32_t relativeFirstChildOffset)
 {
+    m_childIndex.reset();
     if (relativeFirstChildOffset + minimumElementSize() <= totalSize()) {
-        m_firstChild.reset(new ImplementationType(static_cast<ImplementationType &>(*this), startOffset() + relativeFirstChildOffset));
+        m_firstChild.reset(new (container().elementArena())
+                ImplementationType(static_cast<ImplementationType &>(*this), startOffset() + relativeFirstChildOffset));
     } else {
         m_firstChild.reset();
     }
@@ -979,6 +1259,22 @@ template <class ImplementationType> constexpr std::uint8_t GenericFileElement<Im
     return FileElementTraits<ImplementationType>::minimumElementSize();
 }
 
+/*!
+ * \brief Performs parsing for tryParse() by converting the parsing exceptions thrown by internalParse().
+ * \remarks Implementations can hide this method to avoid throwing in the first place.
+ */
+template <class ImplementationType> ParsingError GenericFileElement<ImplementationType>::internalTryParse(Diagnostics &diag)
+{
+    try {
+        static_cast<ImplementationType *>(this)->internalParse(diag);
+    } catch (const TruncatedDataException &) {
+        return ParsingError::TruncatedData;
+    } catch (const InvalidDataException &) {
+        return ParsingError::InvalidData;
+    }
+    return ParsingError::None;
+}
+
 /*!
  * \fn GenericFileElement<ImplementationType>::internalParse()
  * \brief This method is called to perform parsing.
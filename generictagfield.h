@@ -36,7 +36,11 @@ public:
 
     TagField();
     TagField(const IdentifierType &id, const TagValue &value);
+    TagField(const TagField &other) = default;
+    TagField(TagField &&other) = default;
     ~TagField();
+    TagField &operator=(const TagField &other) = default;
+    TagField &operator=(TagField &&other) = default;
 
     const IdentifierType &id() const;
     std::string idToString() const;
@@ -46,6 +50,7 @@ public:
     TagValue &value();
     const TagValue &value() const;
     void setValue(const TagValue &value);
+    void setValue(TagValue &&value);
     void clearValue();
 
     const TypeInfoType &typeInfo() const;
@@ -162,6 +167,14 @@ template <class ImplementationType> inline void TagField<ImplementationType>::se
     m_value = value;
 }
 
+/*!
+ * \brief Sets the value of the current TagField by moving the specified \a value in.
+ */
+template <class ImplementationType> inline void TagField<ImplementationType>::setValue(TagValue &&value)
+{
+    m_value = std::move(value);
+}
+
 /*!
  * \brief Clears the value of the current TagField.
  */
@@ -0,0 +1,478 @@
+#include "./hevcconfiguration.h"
+
+#include "../diagnostics.h"
+#include "../exceptions.h"
+
+#include <c++utilities/conversion/stringbuilder.h>
+#include <c++utilities/io/binaryreader.h>
+#include <c++utilities/io/bitreader.h>
+
+#include <algorithm>
+#include <string>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+/// \cond
+namespace {
+
+/*!
+ * \brief Returns the RBSP of the specified NAL unit, so the NAL unit with emulation prevention bytes removed.
+ * \remarks Unlike AVC parameter sets, HEVC parameter sets usually contain emulation prevention bytes because
+ *          the constraint flags within the profile/tier/level structure are mostly zero.
+ */
+std::string extractRbsp(const char *data, std::uint16_t size)
+{
+    auto rbsp = std::string();
+    rbsp.reserve(size);
+    auto zeroCount = 0;
+    for (const auto *const end = data + size; data != end; ++data) {
+        if (zeroCount >= 2 && *data == 0x03) {
+            zeroCount = 0;
+            continue;
+        }
+        zeroCount = *data ? 0 : zeroCount + 1;
+        rbsp.push_back(*data);
+    }
+    return rbsp;
+}
+
+/*!
+ * \brief Skips the "scaling_list_data()" structure of an SPS.
+ */
+void skipScalingListData(BitReader &reader)
+{
+    for (std::uint8_t sizeId = 0; sizeId < 4; ++sizeId) {
+        for (std::uint8_t matrixId = 0; matrixId < 6; matrixId += (sizeId == 3) ? 3 : 1) {
+            if (!reader.readBit()) { // scaling list pred mode flag
+                reader.readUnsignedExpGolombCodedBits<ugolomb>(); // scaling list pred matrix id delta
+                continue;
+            }
+            const auto coefficientCount = std::min(64, 1 << (4 + (sizeId << 1)));
+            if (sizeId > 1) {
+                reader.readSignedExpGolombCodedBits<sgolomb>(); // scaling list dc coef minus8
+            }
+            for (auto i = 0; i < coefficientCount; ++i) {
+                reader.readSignedExpGolombCodedBits<sgolomb>(); // scaling list delta coef
+            }
+        }
+    }
+}
+
+/*!
+ * \brief Skips the short-term reference picture sets of an SPS.
+ * \remarks The number of delta POCs of each set needs to be tracked because it determines the size of the next set
+ *          if that one is predicted from it.
+ */
+void skipShortTermRefPicSets(BitReader &reader, ugolomb setCount)
+{
+    if (setCount > 64) {
+        throw InvalidDataException();
+    }
+    ugolomb deltaPocCounts[64] = { 0 };
+    for (ugolomb setIndex = 0; setIndex < setCount; ++setIndex) {
+        if (setIndex && reader.readBit()) { // inter ref pic set prediction flag
+            reader.skipBits(1); // delta rps sign
+            reader.readUnsignedExpGolombCodedBits<ugolomb>(); // abs delta rps minus1
+            auto &deltaPocCount = deltaPocCounts[setIndex];
+            for (ugolomb j = 0; j <= deltaPocCounts[setIndex - 1]; ++j) {
+                // use delta flag is inferred to be 1 if used by curr pic flag is set
+                if (reader.readBit() || reader.readBit()) { // used by curr pic flag, use delta flag
+                    ++deltaPocCount;
+                }
+            }
+        } else {
+            const auto negativePics = reader.readUnsignedExpGolombCodedBits<ugolomb>();
+            const auto positivePics = reader.readUnsignedExpGolombCodedBits<ugolomb>();
+            if (negativePics > 16 || positivePics > 16) {
+                throw InvalidDataException();
+            }
+            for (auto i = negativePics + positivePics; i; --i) {
+                reader.readUnsignedExpGolombCodedBits<ugolomb>(); // delta poc minus1
+                reader.skipBits(1); // used by curr pic flag
+            }
+            deltaPocCounts[setIndex] = negativePics + positivePics;
+        }
+    }
+}
+
+/*!
+ * \brief Skips the "hrd_parameters()" structure of a VPS or SPS.
+ */
+void skipHrdParameters(BitReader &reader, bool commonInfPresent, std::uint8_t maxSubLayersMinus1)
+{
+    auto nalHrdParametersPresent = false, vclHrdParametersPresent = false, subPicHrdParamsPresent = false;
+    if (commonInfPresent) {
+        nalHrdParametersPresent = reader.readBit();
+        vclHrdParametersPresent = reader.readBit();
+        if (nalHrdParametersPresent || vclHrdParametersPresent) {
+            if ((subPicHrdParamsPresent = reader.readBit())) {
+                reader.skipBits(8 + 5 + 1 + 5); // tick divisor, du cpb removal delay increment length, ...
+            }
+            reader.skipBits(4 + 4); // bit rate scale, cpb size scale
+            if (subPicHrdParamsPresent) {
+                reader.skipBits(4); // cpb size du scale
+            }
+            reader.skipBits(5 + 5 + 5); // initial cpb removal delay length, au cpb removal delay length, dpb output delay length
+        }
+    }
+    for (std::uint8_t i = 0; i <= maxSubLayersMinus1; ++i) {
+        auto lowDelayHrd = false;
+        auto fixedPicRateWithinCvs = reader.readBit() != 0; // fixed pic rate general flag
+        if (!fixedPicRateWithinCvs) {
+            fixedPicRateWithinCvs = reader.readBit();
+        }
+        if (fixedPicRateWithinCvs) {
+            reader.readUnsignedExpGolombCodedBits<ugolomb>(); // elemental duration in tc minus1
+        } else {
+            lowDelayHrd = reader.readBit();
+        }
+        auto cpbCount = ugolomb(1);
+        if (!lowDelayHrd) {
+            cpbCount = reader.readUnsignedExpGolombCodedBits<ugolomb>() + 1;
+        }
+        if (cpbCount > 32) {
+            throw InvalidDataException();
+        }
+        for (auto hrdParameterSets = nalHrdParametersPresent + vclHrdParametersPresent; hrdParameterSets; --hrdParameterSets) {
+            for (ugolomb j = 0; j < cpbCount; ++j) {
+                reader.readUnsignedExpGolombCodedBits<ugolomb>(); // bit rate value minus1
+                reader.readUnsignedExpGolombCodedBits<ugolomb>(); // cpb size value minus1
+                if (subPicHrdParamsPresent) {
+                    reader.readUnsignedExpGolombCodedBits<ugolomb>(); // cpb size du value minus1
+                    reader.readUnsignedExpGolombCodedBits<ugolomb>(); // bit rate du value minus1
+                }
+                reader.skipBits(1); // cbr flag
+            }
+        }
+    }
+}
+
+} // namespace
+/// \endcond
+
+/*!
+ * \struct TagParser::HevcProfileTierLevel
+ * \brief The HevcProfileTierLevel struct holds the general profile, tier and level of a VPS or SPS.
+ */
+
+/*!
+ * \brief Parses the "profile_tier_level()" structure skipping the sub-layer specific values.
+ */
+void HevcProfileTierLevel::parse(BitReader &reader, std::uint8_t maxSubLayersMinus1)
+{
+    profileSpace = reader.readBits<std::uint8_t>(2);
+    tierFlag = reader.readBit();
+    profileIndication = reader.readBits<std::uint8_t>(5);
+    profileCompatibilityFlags = reader.readBits<std::uint32_t>(32);
+    reader.skipBits(48); // progressive/interlaced/non-packed/frame-only source flags and constraint flags
+    levelIndication = reader.readBits<std::uint8_t>(8);
+
+    bool subLayerProfilePresent[8], subLayerLevelPresent[8];
+    for (std::uint8_t i = 0; i < maxSubLayersMinus1; ++i) {
+        subLayerProfilePresent[i] = reader.readBit();
+        subLayerLevelPresent[i] = reader.readBit();
+    }
+    if (maxSubLayersMinus1) {
+        reader.skipBits(2 * (8 - maxSubLayersMinus1)); // reserved zero 2 bits
+    }
+    for (std::uint8_t i = 0; i < maxSubLayersMinus1; ++i) {
+        if (subLayerProfilePresent[i]) {
+            reader.skipBits(88);
+        }
+        if (subLayerLevelPresent[i]) {
+            reader.skipBits(8);
+        }
+    }
+}
+
+/*!
+ * \struct TagParser::HevcVpsInfo
+ * \brief The HevcVpsInfo struct holds the video parameter set.
+ */
+
+/*!
+ * \brief Parses the VPS info from the NAL unit with the specified \a dataSize at \a data (not including the size).
+ */
+void HevcVpsInfo::parse(const char *data, std::uint16_t dataSize)
+{
+    size = dataSize;
+    const auto rbsp = extractRbsp(data, size);
+    BitReader bitReader(rbsp.data(), rbsp.size());
+
+    try {
+        // read NAL unit header
+        bitReader.skipBits(1); // forbidden zero bit
+        if (bitReader.readBits<std::uint8_t>(6) != 32) { // nal unit type
+            throw InvalidDataException();
+        }
+        bitReader.skipBits(6 + 3); // nuh layer id, nuh temporal id plus1
+
+        // read general values
+        id = bitReader.readBits<std::uint8_t>(4);
+        bitReader.skipBits(1 + 1 + 6); // base layer internal flag, base layer available flag, max layers minus1
+        if ((maxSubLayersMinus1 = bitReader.readBits<std::uint8_t>(3)) > 6) {
+            throw InvalidDataException();
+        }
+        bitReader.skipBits(1 + 16); // temporal id nesting flag, reserved 0xffff 16 bits
+        profileTierLevel.parse(bitReader, maxSubLayersMinus1);
+
+        // skip sub layer ordering info
+        const auto subLayerOrderingInfoPresent = bitReader.readBit();
+        for (auto i = subLayerOrderingInfoPresent ? 0 : maxSubLayersMinus1; i <= maxSubLayersMinus1; ++i) {
+            bitReader.readUnsignedExpGolombCodedBits<ugolomb>(); // max dec pic buffering minus1
+            bitReader.readUnsignedExpGolombCodedBits<ugolomb>(); // max num reorder pics
+            bitReader.readUnsignedExpGolombCodedBits<ugolomb>(); // max latency increase plus1
+        }
+
+        // skip layer sets
+        const auto maxLayerId = bitReader.readBits<std::uint8_t>(6);
+        const auto layerSetCount = bitReader.readUnsignedExpGolombCodedBits<ugolomb>() + 1;
+        if (layerSetCount > 1024) {
+            throw InvalidDataException();
+        }
+        bitReader.skipBits(static_cast<std::size_t>(layerSetCount - 1) * (maxLayerId + 1u)); // layer id included flags
+
+        // read timing info
+        if ((timingInfo.isPresent = bitReader.readBit())) {
+            timingInfo.unitsInTick = bitReader.readBits<std::uint32_t>(32);
+            timingInfo.timeScale = bitReader.readBits<std::uint32_t>(32);
+        }
+    } catch (const std::ios_base::failure &) {
+        throw TruncatedDataException();
+    }
+}
+
+/*!
+ * \struct TagParser::HevcSpsInfo
+ * \brief The HevcSpsInfo struct holds the sequence parameter set.
+ */
+
+/*!
+ * \brief Parses the SPS info from the NAL unit with the specified \a dataSize at \a data (not including the size).
+ */
+void HevcSpsInfo::parse(const char *data, std::uint16_t dataSize)
+{
+    size = dataSize;
+    const auto rbsp = extractRbsp(data, size);
+    BitReader bitReader(rbsp.data(), rbsp.size());
+
+    try {
+        // read NAL unit header
+        bitReader.skipBits(1); // forbidden zero bit
+        if (bitReader.readBits<std::uint8_t>(6) != 33) { // nal unit type
+            throw InvalidDataException();
+        }
+        bitReader.skipBits(6 + 3); // nuh layer id, nuh temporal id plus1
+
+        // read general values
+        vpsId = bitReader.readBits<std::uint8_t>(4);
+        if ((maxSubLayersMinus1 = bitReader.readBits<std::uint8_t>(3)) > 6) {
+            throw InvalidDataException();
+        }
+        bitReader.skipBits(1); // temporal id nesting flag
+        profileTierLevel.parse(bitReader, maxSubLayersMinus1);
+        id = bitReader.readUnsignedExpGolombCodedBits<ugolomb>();
+        if ((chromaFormatIndication = bitReader.readUnsignedExpGolombCodedBits<ugolomb>()) == 3) {
+            bitReader.skipBits(1); // separate colour plane flag
+        }
+
+        // read picture size related values
+        const auto width = bitReader.readUnsignedExpGolombCodedBits<std::uint32_t>();
+        const auto height = bitReader.readUnsignedExpGolombCodedBits<std::uint32_t>();
+        if (bitReader.readBit()) { // conformance window flag
+            cropping.setLeft(bitReader.readUnsignedExpGolombCodedBits<std::uint32_t>());
+            cropping.setRight(bitReader.readUnsignedExpGolombCodedBits<std::uint32_t>());
+            cropping.setTop(bitReader.readUnsignedExpGolombCodedBits<std::uint32_t>());
+            cropping.setBottom(bitReader.readUnsignedExpGolombCodedBits<std::uint32_t>());
+        }
+
+        // calculate actual picture size (the conformance window is specified in units of chroma samples)
+        const auto croppingScaleX = (chromaFormatIndication == 1 || chromaFormatIndication == 2) ? 2u : 1u;
+        const auto croppingScaleY = chromaFormatIndication == 1 ? 2u : 1u;
+        pictureSize = Size(width - croppingScaleX * (cropping.left() + cropping.right()),
+            height - croppingScaleY * (cropping.top() + cropping.bottom()));
+
+        // read bit depths
+        bitDepthLumaMinus8 = bitReader.readUnsignedExpGolombCodedBits<ugolomb>();
+        bitDepthChromaMinus8 = bitReader.readUnsignedExpGolombCodedBits<ugolomb>();
+
+        // skip values required to get to the VUI
+        const auto log2MaxPicOrderCntLsb = bitReader.readUnsignedExpGolombCodedBits<ugolomb>() + 4;
+        const auto subLayerOrderingInfoPresent = bitReader.readBit();
+        for (auto i = subLayerOrderingInfoPresent ? 0 : maxSubLayersMinus1; i <= maxSubLayersMinus1; ++i) {
+            bitReader.readUnsignedExpGolombCodedBits<ugolomb>(); // max dec pic buffering minus1
+            bitReader.readUnsignedExpGolombCodedBits<ugolomb>(); // max num reorder pics
+            bitReader.readUnsignedExpGolombCodedBits<ugolomb>(); // max latency increase plus1
+        }
+        for (auto i = 0; i < 6; ++i) {
+            bitReader.readUnsignedExpGolombCodedBits<ugolomb>(); // coding/transform block sizes and hierarchy depths
+        }
+        if (bitReader.readBit() && bitReader.readBit()) { // scaling list enabled flag, sps scaling list data present flag
+            skipScalingListData(bitReader);
+        }
+        bitReader.skipBits(1 + 1); // amp enabled flag, sample adaptive offset enabled flag
+        if (bitReader.readBit()) { // pcm enabled flag
+            bitReader.skipBits(4 + 4); // pcm sample bit depth luma/chroma minus1
+            bitReader.readUnsignedExpGolombCodedBits<ugolomb>(); // log2 min pcm luma coding block size minus3
+            bitReader.readUnsignedExpGolombCodedBits<ugolomb>(); // log2 diff max min pcm luma coding block size
+            bitReader.skipBits(1); // pcm loop filter disabled flag
+        }
+        skipShortTermRefPicSets(bitReader, bitReader.readUnsignedExpGolombCodedBits<ugolomb>());
+        if (bitReader.readBit()) { // long term ref pics present flag
+            const auto longTermRefPicCount = bitReader.readUnsignedExpGolombCodedBits<ugolomb>();
+            if (longTermRefPicCount > 32 || log2MaxPicOrderCntLsb > 16) {
+                throw InvalidDataException();
+            }
+            bitReader.skipBits(longTermRefPicCount * (log2MaxPicOrderCntLsb + 1)); // lt ref pic poc lsb sps, used by curr pic lt sps flag
+        }
+        bitReader.skipBits(1 + 1); // sps temporal mvp enabled flag, strong intra smoothing enabled flag
+
+        // read VUI (video usability information)
+        if ((vuiPresent = bitReader.readBit())) {
+            if (bitReader.readBit()) { // aspect ratio info present flag
+                pixelAspectRatio = AspectRatio(bitReader.readBits<std::uint8_t>(8));
+                if (pixelAspectRatio.isExtended()) {
+                    // read extended SAR
+                    pixelAspectRatio.numerator = bitReader.readBits<std::uint16_t>(16);
+                    pixelAspectRatio.denominator = bitReader.readBits<std::uint16_t>(16);
+                }
+            }
+
+            // read/skip misc values
+            if (bitReader.readBit()) { // overscan info present
+                bitReader.skipBits(1); // overscan appropriate
+            }
+            if (bitReader.readBit()) { // video signal type present
+                bitReader.skipBits(4); // video format and video full range
+                if (bitReader.readBit()) { // color description present
+                    bitReader.skipBits(24); // color primaries, transfer characteristics, matrix coefficients
+                }
+            }
+            if (bitReader.readBit()) { // chroma loc info present
+                bitReader.readUnsignedExpGolombCodedBits<ugolomb>(); // chroma sample loc type top field
+                bitReader.readUnsignedExpGolombCodedBits<ugolomb>(); // chroma sample loc type bottom field
+            }
+            bitReader.skipBits(1 + 1 + 1); // neutral chroma indication flag, field seq flag, frame field info present flag
+            if (bitReader.readBit()) { // default display window flag
+                for (auto i = 0; i < 4; ++i) {
+                    bitReader.readUnsignedExpGolombCodedBits<ugolomb>(); // def disp win offsets
+                }
+            }
+
+            // read timing info
+            if ((timingInfo.isPresent = bitReader.readBit())) {
+                timingInfo.unitsInTick = bitReader.readBits<std::uint32_t>(32);
+                timingInfo.timeScale = bitReader.readBits<std::uint32_t>(32);
+                if (bitReader.readBit()) { // poc proportional to timing flag
+                    bitReader.readUnsignedExpGolombCodedBits<ugolomb>(); // num ticks poc diff one minus1
+                }
+                if (bitReader.readBit()) { // hrd parameters present flag
+                    skipHrdParameters(bitReader, true, maxSubLayersMinus1);
+                }
+            }
+        }
+    } catch (const std::ios_base::failure &) {
+        throw TruncatedDataException();
+    }
+}
+
+/*!
+ * \class HevcConfiguration
+ * \brief The HevcConfiguration struct provides a parser for the HEVC decoder configuration ("hvcC").
+ *
+ * The configuration is found in the "hvcC" atom of MP4 files and in the "CodecPrivate" element of Matroska tracks.
+ * Its VPS and SPS NAL units are decoded; other NAL units (e.g. PPS and SEI) are skipped.
+ */
+
+/*!
+ * \brief Parses the HEVC configuration using the specified \a reader.
+ * \throws Throws TruncatedDataException() when the config size exceeds the specified \a maxSize.
+ */
+void HevcConfiguration::parse(BinaryReader &reader, std::uint64_t maxSize, Diagnostics &diag)
+{
+    if (maxSize < 23) {
+        throw TruncatedDataException();
+    }
+    maxSize -= 23;
+
+    configurationVersion = reader.readByte();
+    auto byte = reader.readByte();
+    profileSpace = byte >> 6;
+    tierFlag = (byte >> 5) & 0x01;
+    profileIndication = byte & 0x1F;
+    profileCompatibilityFlags = reader.readUInt32BE();
+    constraintIndicatorFlags = static_cast<std::uint64_t>(reader.readUInt16BE()) << 32;
+    constraintIndicatorFlags |= reader.readUInt32BE();
+    levelIndication = reader.readByte();
+    minSpatialSegmentation = reader.readUInt16BE() & 0x0FFF;
+    parallelismType = reader.readByte() & 0x03;
+    chromaFormatIndication = reader.readByte() & 0x03;
+    bitDepthLumaMinus8 = reader.readByte() & 0x07;
+    bitDepthChromaMinus8 = reader.readByte() & 0x07;
+    averageFrameRate = reader.readUInt16BE();
+    byte = reader.readByte();
+    constantFrameRate = byte >> 6;
+    temporalLayerCount = (byte >> 3) & 0x07;
+    temporalIdNested = (byte >> 2) & 0x01;
+    naluSizeLength = (byte & 0x03) + 1;
+
+    // read NAL unit arrays
+    std::size_t ignoredVpsEntries = 0, ignoredSpsEntries = 0;
+    auto nalUnit = std::string();
+    for (auto arrayCount = reader.readByte(); arrayCount; --arrayCount) {
+        if (maxSize < 3) {
+            throw TruncatedDataException();
+        }
+        maxSize -= 3;
+        const auto nalUnitType = reader.readByte() & 0x3F;
+        for (auto nalUnitCount = reader.readUInt16BE(); nalUnitCount; --nalUnitCount) {
+            if (maxSize < 2) {
+                throw TruncatedDataException();
+            }
+            const auto size = reader.readUInt16BE();
+            if (size > (maxSize -= 2)) {
+                throw TruncatedDataException();
+            }
+            maxSize -= size;
+            switch (nalUnitType) {
+            case 32:
+                nalUnit.resize(size);
+                reader.read(nalUnit.data(), size);
+                try {
+                    vpsInfos.emplace_back().parse(nalUnit.data(), size);
+                } catch (const Failure &) {
+                    vpsInfos.pop_back();
+                    ++ignoredVpsEntries;
+                }
+                break;
+            case 33:
+                nalUnit.resize(size);
+                reader.read(nalUnit.data(), size);
+                try {
+                    spsInfos.emplace_back().parse(nalUnit.data(), size);
+                } catch (const Failure &) {
+                    spsInfos.pop_back();
+                    ++ignoredSpsEntries;
+                }
+                break;
+            default:
+                reader.stream()->seekg(size, ios_base::cur);
+            }
+        }
+    }
+
+    // log parsing errors
+    if (ignoredVpsEntries || ignoredSpsEntries) {
+        diag.emplace_back(DiagLevel::Debug,
+            argsToString("Ignored ", ignoredVpsEntries, " VPS entries and ", ignoredSpsEntries,
+                " SPS entries. This HEVC config is likely just not supported."),
+            "parsing HEVC config");
+    }
+
+    // ignore remaining data
+}
+
+} // namespace TagParser
@@ -0,0 +1,132 @@
+#ifndef TAG_PARSER_HEVCCONFIGURATION_H
+#define TAG_PARSER_HEVCCONFIGURATION_H
+
+#include "../avc/avcinfo.h"
+
+#include <vector>
+
+namespace TagParser {
+
+class Diagnostics;
+
+struct TAG_PARSER_EXPORT HevcProfileTierLevel {
+    constexpr HevcProfileTierLevel();
+    std::uint8_t profileSpace;
+    std::uint8_t tierFlag;
+    std::uint8_t profileIndication;
+    std::uint32_t profileCompatibilityFlags;
+    std::uint8_t levelIndication;
+
+    void parse(CppUtilities::BitReader &reader, std::uint8_t maxSubLayersMinus1);
+};
+
+constexpr HevcProfileTierLevel::HevcProfileTierLevel()
+    : profileSpace(0)
+    , tierFlag(0)
+    , profileIndication(0)
+    , profileCompatibilityFlags(0)
+    , levelIndication(0)
+{
+}
+
+struct TAG_PARSER_EXPORT HevcVpsInfo {
+    constexpr HevcVpsInfo();
+    std::uint8_t id;
+    std::uint8_t maxSubLayersMinus1;
+    HevcProfileTierLevel profileTierLevel;
+    TimingInfo timingInfo;
+    std::uint16_t size;
+
+    void parse(const char *data, std::uint16_t dataSize);
+};
+
+constexpr HevcVpsInfo::HevcVpsInfo()
+    : id(0)
+    , maxSubLayersMinus1(0)
+    , size(0)
+{
+}
+
+struct TAG_PARSER_EXPORT HevcSpsInfo {
+    constexpr HevcSpsInfo();
+    ugolomb id;
+    std::uint8_t vpsId;
+    std::uint8_t maxSubLayersMinus1;
+    HevcProfileTierLevel profileTierLevel;
+    ugolomb chromaFormatIndication;
+    ugolomb bitDepthLumaMinus8;
+    ugolomb bitDepthChromaMinus8;
+    std::uint8_t vuiPresent;
+    AspectRatio pixelAspectRatio;
+    TimingInfo timingInfo;
+    Margin cropping;
+    Size pictureSize;
+    std::uint16_t size;
+
+    void parse(const char *data, std::uint16_t dataSize);
+};
+
+constexpr HevcSpsInfo::HevcSpsInfo()
+    : id(0)
+    , vpsId(0)
+    , maxSubLayersMinus1(0)
+    , chromaFormatIndication(0)
+    , bitDepthLumaMinus8(0)
+    , bitDepthChromaMinus8(0)
+    , vuiPresent(0)
+    , size(0)
+{
+}
+
+struct TAG_PARSER_EXPORT HevcConfiguration {
+    HevcConfiguration();
+    std::uint8_t configurationVersion;
+    std::uint8_t profileSpace;
+    std::uint8_t tierFlag;
+    std::uint8_t profileIndication;
+    std::uint32_t profileCompatibilityFlags;
+    std::uint64_t constraintIndicatorFlags;
+    std::uint8_t levelIndication;
+    std::uint16_t minSpatialSegmentation;
+    std::uint8_t parallelismType;
+    std::uint8_t chromaFormatIndication;
+    std::uint8_t bitDepthLumaMinus8;
+    std::uint8_t bitDepthChromaMinus8;
+    std::uint16_t averageFrameRate;
+    std::uint8_t constantFrameRate;
+    std::uint8_t temporalLayerCount;
+    std::uint8_t temporalIdNested;
+    std::uint8_t naluSizeLength;
+    std::vector<HevcVpsInfo> vpsInfos;
+    std::vector<HevcSpsInfo> spsInfos;
+
+    void parse(CppUtilities::BinaryReader &reader, std::uint64_t maxSize, Diagnostics &diag);
+};
+
+/*!
+ * \brief Constructs an empty HEVC configuration.
+ */
+inline HevcConfiguration::HevcConfiguration()
+    : configurationVersion(0)
+    , profileSpace(0)
+    , tierFlag(0)
+    , profileIndication(0)
+    , profileCompatibilityFlags(0)
+    , constraintIndicatorFlags(0)
+    , levelIndication(0)
+    , minSpatialSegmentation(0)
+    , parallelismType(0)
+    , chromaFormatIndication(0)
+    , bitDepthLumaMinus8(0)
+    , bitDepthChromaMinus8(0)
+    , averageFrameRate(0)
+    , constantFrameRate(0)
+    , temporalLayerCount(0)
+    , temporalIdNested(0)
+    , naluSizeLength(0)
+{
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_HEVCCONFIGURATION_H
@@ -0,0 +1,288 @@
+#include "./id3batchconverter.h"
+
+#include "../basicfileinfo.h"
+#include "../batchparser.h"
+#include "../bytesource.h"
+#include "../exceptions.h"
+#include "../tailprobe.h"
+
+#include <c++utilities/conversion/binaryconversion.h>
+#include <c++utilities/conversion/stringbuilder.h>
+#include <c++utilities/io/nativefilestream.h>
+
+#include <unistd.h>
+
+#include <cstring>
+#include <mutex>
+#include <sstream>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+/*!
+ * \class TagParser::Id3BatchConverter
+ * \brief The Id3BatchConverter class converts the ID3 tags of many MP3 files without going through MediaFileInfo.
+ *
+ * Only the ID3v2 tags at the beginning of a file and the ID3v1 tag within the last 128 bytes are read. The container
+ * format is not determined and the MPEG audio frames are not parsed at all. The tags are converted according to the
+ * specified TagCreationSettings (the same way MediaFileInfo::createAppropriateTags() does for MP3 files), optionally
+ * altered further via the transform callback and written back in-place.
+ *
+ * A file is only modified if the new ID3v2 tags fit into the space occupied by the present ID3v2 tags (including their
+ * padding). Otherwise it is left untouched and Id3BatchConverterResult::rewriteRequired is set so the caller can fall
+ * back to MediaFileInfo::applyChanges() for those files. Regions which are not changed by the conversion are not
+ * written at all.
+ *
+ * \remarks
+ * - All files are treated as MP3 files. Don't pass files of other formats.
+ * - The files are modified directly; no backup or journal is created. Removing all ID3v2 tags replaces them with an
+ *   ID3v2 tag only consisting of padding to avoid moving the audio data.
+ * - Files are processed concurrently in the same way as BatchParser parses files.
+ */
+
+/*!
+ * \brief Constructs an empty result.
+ */
+Id3BatchConverterResult::Id3BatchConverterResult()
+    : index(0)
+    , id3v2RegionSize(0)
+    , hadId3v1Tag(false)
+    , modified(false)
+    , rewriteRequired(false)
+{
+}
+
+/*!
+ * \brief Constructs a new converter using the specified \a settings and number of threads.
+ * \remarks If \a parallelism is zero, the number of hardware threads is used.
+ */
+Id3BatchConverter::Id3BatchConverter(const TagCreationSettings &settings, unsigned int parallelism)
+    : m_settings(settings)
+    , m_parallelism(parallelism)
+    , m_aborted(false)
+{
+}
+
+/*!
+ * \brief Converts the ID3 tags of the files with the specified \a paths and invokes \a callback for each of them.
+ *
+ * The function blocks until all files have been processed or the conversion has been aborted via abort(). The
+ * callback is invoked from the worker threads as soon as a file has been processed; so results are not necessarily
+ * reported in the order of \a paths (use Id3BatchConverterResult::index to correlate them). Invocations of the callback
+ * are serialized, so the callback does not need to be thread-safe itself. It must not throw.
+ *
+ * Exceptions which abort processing a file (e.g. IO errors or tags which can not be parsed) are caught and stored in
+ * Id3BatchConverterResult::exception.
+ */
+void Id3BatchConverter::convert(const std::vector<std::string> &paths, const ResultCallback &callback)
+{
+    m_aborted.store(false);
+    auto callbackMutex = mutex();
+    BatchParser::runConcurrently(paths.size(), m_parallelism, m_aborted, [&, this](size_t index) {
+        Id3BatchConverterResult result;
+        result.index = index;
+        result.path = paths[index];
+        convertFile(result);
+        if (callback) {
+            const auto guard = lock_guard<mutex>(callbackMutex);
+            callback(result);
+        }
+    });
+}
+
+/*!
+ * \brief Converts the tags within \a result according to the specified \a settings.
+ * \remarks This follows the rules MediaFileInfo::createAppropriateTags() applies to MP3 files.
+ */
+void Id3BatchConverter::applySettings(Id3BatchConverterResult &result, const TagCreationSettings &settings)
+{
+    const auto flags = settings.flags;
+    auto &id3v1Tag = result.id3v1Tag;
+    auto &id3v2Tags = result.id3v2Tags;
+
+    // create ID3 tags according to settings
+    if (settings.id3v1usage == TagUsage::Always && !id3v1Tag) {
+        id3v1Tag = make_unique<Id3v1Tag>();
+        if (flags & TagCreationFlags::Id3InitOnCreate) {
+            for (const auto &id3v2Tag : id3v2Tags) {
+                // overwrite existing values to ensure default ID3v1 genre "Blues" is updated as well
+                id3v1Tag->insertValues(*id3v2Tag, true);
+                // ID3v1 does not support all text encodings which might be used in ID3v2
+                id3v1Tag->ensureTextValuesAreProperlyEncoded();
+            }
+        }
+    }
+    if (settings.id3v2usage == TagUsage::Always && id3v2Tags.empty()) {
+        auto &id3v2Tag = id3v2Tags.emplace_back(make_unique<Id3v2Tag>());
+        id3v2Tag->setVersion(settings.id3v2MajorVersion, 0);
+        if ((flags & TagCreationFlags::Id3InitOnCreate) && id3v1Tag) {
+            id3v2Tag->insertValues(*id3v1Tag, true);
+        }
+    }
+
+    // merge ID3v2 tags into the first one
+    if ((flags & TagCreationFlags::MergeMultipleSuccessiveId3v2Tags) && id3v2Tags.size() > 1) {
+        for (auto i = id3v2Tags.begin() + 1, end = id3v2Tags.end(); i != end; ++i) {
+            id3v2Tags.front()->insertFields(std::move(**i), false);
+        }
+        id3v2Tags.erase(id3v2Tags.begin() + 1, id3v2Tags.end());
+    }
+
+    // remove ID3 tags according to settings
+    if (settings.id3v1usage == TagUsage::Never && id3v1Tag) {
+        if ((flags & TagCreationFlags::Id3TransferValuesOnRemoval) && !id3v2Tags.empty()) {
+            id3v2Tags.front()->insertValues(std::move(*id3v1Tag), false);
+        }
+        id3v1Tag.reset();
+    }
+    if (settings.id3v2usage == TagUsage::Never) {
+        if ((flags & TagCreationFlags::Id3TransferValuesOnRemoval) && id3v1Tag) {
+            for (const auto &id3v2Tag : id3v2Tags) {
+                id3v1Tag->insertValues(std::move(*id3v2Tag), false);
+            }
+        }
+        id3v2Tags.clear();
+    } else if (!(flags & TagCreationFlags::KeepExistingId3v2Version)) {
+        for (const auto &id3v2Tag : id3v2Tags) {
+            id3v2Tag->setVersion(settings.id3v2MajorVersion, 0);
+        }
+    }
+}
+
+/*!
+ * \brief Converts the tags of the file specified within \a result and stores the outcome in \a result.
+ */
+void Id3BatchConverter::convertFile(Id3BatchConverterResult &result) const
+{
+    static const string context("converting ID3 tags");
+    auto &diag = result.diag;
+    try {
+        NativeFileStream stream;
+        stream.exceptions(ios_base::failbit | ios_base::badbit);
+        stream.open(BasicFileInfo::pathForOpen(result.path), ios_base::in | ios_base::out | ios_base::binary);
+        auto tailProbe = TailProbe();
+        tailProbe.probe(stream);
+        const auto fileSize = tailProbe.fileSize;
+
+        // parse ID3v1 tag within the last 128 bytes (already read when probing the end of the file)
+        if (tailProbe.hasId3v1Tag()) {
+            MemoryByteSource id3v1Source(tailProbe.id3v1TagData);
+            ByteSourceStreamBuffer id3v1Buffer(id3v1Source);
+            istream id3v1Stream(&id3v1Buffer);
+            id3v1Stream.exceptions(ios_base::failbit | ios_base::badbit);
+            auto id3v1Tag = make_unique<Id3v1Tag>();
+            try {
+                id3v1Tag->parse(id3v1Stream, diag);
+                result.id3v1Tag = move(id3v1Tag);
+                result.hadId3v1Tag = true;
+            } catch (const NoDataFoundException &) {
+            }
+        }
+        const auto mediaEnd = fileSize - (result.hadId3v1Tag ? 128 : 0);
+
+        // parse ID3v2 tags at the beginning
+        char header[10];
+        for (auto &offset = result.id3v2RegionSize; offset + sizeof(header) <= mediaEnd;) {
+            stream.seekg(static_cast<streamoff>(offset));
+            stream.read(header, sizeof(header));
+            if (memcmp(header, "ID3", 3)) {
+                break;
+            }
+            auto &id3v2Tag = result.id3v2Tags.emplace_back(make_unique<Id3v2Tag>());
+            stream.seekg(static_cast<streamoff>(offset));
+            try {
+                id3v2Tag->parse(stream, mediaEnd - offset, diag);
+            } catch (const Failure &) {
+                diag.emplace_back(DiagLevel::Critical, "Unable to parse ID3v2 tag; the file is left untouched.", context);
+                throw;
+            }
+            offset += sizeof(header) + toNormalInt(BE::toUInt32(header + 6)) + (header[5] & 0x10 ? 10 : 0);
+        }
+        if (result.id3v2RegionSize > mediaEnd) {
+            diag.emplace_back(DiagLevel::Critical, "ID3v2 tags exceed the file; the file is left untouched.", context);
+            throw TruncatedDataException();
+        }
+
+        // convert tags
+        applySettings(result, m_settings);
+        if (m_transformCallback) {
+            m_transformCallback(result);
+        }
+
+        // make ID3v2 tags filling exactly the space of the present ID3v2 tags
+        auto makers = vector<Id3v2TagMaker>();
+        makers.reserve(result.id3v2Tags.size());
+        auto tagsSize = std::uint64_t();
+        for (auto &id3v2Tag : result.id3v2Tags) {
+            tagsSize += makers.emplace_back(id3v2Tag->prepareMaking(diag)).requiredSize();
+        }
+        const auto regionSize = result.id3v2RegionSize;
+        if (tagsSize > regionSize || (makers.empty() && regionSize && regionSize < 10)) {
+            result.rewriteRequired = true;
+            diag.emplace_back(DiagLevel::Information,
+                argsToString("The ID3v2 tags need ", tagsSize, " bytes but only ", regionSize,
+                    " bytes are available; the file needs to be rewritten and is left untouched."),
+                context);
+            return;
+        }
+        // note: The tags are made into a buffer of the final size at once (instead of writing them via a stream) to compare them
+        //       with the present tags.
+        auto newData = string(static_cast<std::size_t>(regionSize), '\0');
+        if (!makers.empty()) {
+            auto *tagData = newData.data();
+            for (auto i = makers.begin(), end = makers.end() - 1; i != end; tagData += (i++)->requiredSize()) {
+                i->make(tagData, 0, diag);
+            }
+            makers.back().make(tagData, static_cast<std::uint32_t>(regionSize - tagsSize), diag);
+        } else if (regionSize) {
+            Id3v2Tag().prepareMaking(diag).make(newData.data(), static_cast<std::uint32_t>(regionSize - 10), diag);
+        }
+
+        // write ID3v2 tags if they have changed
+        auto oldData = string(newData.size(), '\0');
+        stream.seekg(0);
+        stream.read(oldData.data(), static_cast<streamsize>(oldData.size()));
+        if (newData != oldData) {
+            stream.seekp(0);
+            stream.write(newData.data(), static_cast<streamsize>(newData.size()));
+            result.modified = true;
+        }
+
+        // write ID3v1 tag if it has changed or remove it
+        if (result.id3v1Tag) {
+            stringstream buffer(ios_base::in | ios_base::out | ios_base::binary);
+            buffer.exceptions(ios_base::failbit | ios_base::badbit);
+            result.id3v1Tag->make(buffer, diag);
+            newData = buffer.str();
+            if (result.hadId3v1Tag) {
+                oldData.resize(newData.size());
+                stream.seekg(static_cast<streamoff>(mediaEnd));
+                stream.read(oldData.data(), static_cast<streamsize>(oldData.size()));
+            }
+            if (!result.hadId3v1Tag || newData != oldData) {
+                stream.seekp(static_cast<streamoff>(mediaEnd));
+                stream.write(newData.data(), static_cast<streamsize>(newData.size()));
+                result.modified = true;
+            }
+            stream.close();
+        } else if (result.hadId3v1Tag) {
+            stream.close();
+            if (truncate(BasicFileInfo::pathForOpen(result.path), static_cast<streamoff>(mediaEnd)) != 0) {
+                diag.emplace_back(DiagLevel::Critical, "Unable to truncate file to remove ID3v1 tag.", context);
+                throw std::ios_base::failure("Unable to truncate file to remove ID3v1 tag.");
+            }
+            result.modified = true;
+        } else {
+            stream.close();
+        }
+    } catch (const std::ios_base::failure &failure) {
+        diag.emplace_back(DiagLevel::Critical, argsToString("An IO error occurred: ", failure.what()), context);
+        result.exception = current_exception();
+    } catch (...) {
+        result.exception = current_exception();
+    }
+}
+
+} // namespace TagParser
@@ -0,0 +1,153 @@
+#ifndef TAG_PARSER_ID3BATCHCONVERTER_H
+#define TAG_PARSER_ID3BATCHCONVERTER_H
+
+#include "./id3v1tag.h"
+#include "./id3v2tag.h"
+
+#include "../diagnostics.h"
+#include "../settings.h"
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace TagParser {
+
+/*!
+ * \brief The Id3BatchConverterResult struct holds the ID3 tags of a single file processed via Id3BatchConverter.
+ */
+struct TAG_PARSER_EXPORT Id3BatchConverterResult {
+    Id3BatchConverterResult();
+
+    /// \brief The index of the file within the list passed to Id3BatchConverter::convert().
+    std::size_t index;
+    /// \brief The path of the file.
+    std::string path;
+    /// \brief The ID3v1 tag of the file or nullptr if the file has none (after the conversion).
+    std::unique_ptr<Id3v1Tag> id3v1Tag;
+    /// \brief The ID3v2 tags at the beginning of the file (after the conversion).
+    std::vector<std::unique_ptr<Id3v2Tag>> id3v2Tags;
+    /// \brief The number of bytes at the beginning of the file occupied by ID3v2 tags (including their padding).
+    std::uint64_t id3v2RegionSize;
+    /// \brief Whether the file has an ID3v1 tag at its end (before the conversion).
+    bool hadId3v1Tag;
+    /// \brief Whether the file has been modified.
+    bool modified;
+    /// \brief Whether the file has been left untouched because the new ID3v2 tags don't fit into id3v2RegionSize.
+    bool rewriteRequired;
+    /// \brief The diagnostic messages which occurred when processing the file.
+    Diagnostics diag;
+    /// \brief The exception which aborted processing the file (e.g. an IO error) or nullptr if none occurred.
+    std::exception_ptr exception;
+};
+
+class TAG_PARSER_EXPORT Id3BatchConverter {
+public:
+    /// \brief The callback invoked with the parsed tags of each file to apply further changes before they are written.
+    using TransformCallback = std::function<void(Id3BatchConverterResult &result)>;
+    /// \brief The callback invoked with the result of each processed file.
+    using ResultCallback = std::function<void(Id3BatchConverterResult &result)>;
+
+    explicit Id3BatchConverter(const TagCreationSettings &settings = TagCreationSettings(), unsigned int parallelism = 0);
+
+    const TagCreationSettings &settings() const;
+    void setSettings(const TagCreationSettings &settings);
+    unsigned int parallelism() const;
+    void setParallelism(unsigned int parallelism);
+    const TransformCallback &transformCallback() const;
+    void setTransformCallback(const TransformCallback &callback);
+
+    void convert(const std::vector<std::string> &paths, const ResultCallback &callback);
+    void abort();
+    bool isAborted() const;
+
+    static void applySettings(Id3BatchConverterResult &result, const TagCreationSettings &settings);
+
+private:
+    void convertFile(Id3BatchConverterResult &result) const;
+
+    TagCreationSettings m_settings;
+    unsigned int m_parallelism;
+    TransformCallback m_transformCallback;
+    std::atomic<bool> m_aborted;
+};
+
+/*!
+ * \brief Returns the settings used to convert the ID3 tags of each file.
+ * \remarks Only the ID3 related settings are taken into account (targets are ignored).
+ */
+inline const TagCreationSettings &Id3BatchConverter::settings() const
+{
+    return m_settings;
+}
+
+/*!
+ * \brief Sets the settings used to convert the ID3 tags of each file.
+ * \sa settings()
+ */
+inline void Id3BatchConverter::setSettings(const TagCreationSettings &settings)
+{
+    m_settings = settings;
+}
+
+/*!
+ * \brief Returns the number of threads used to process files.
+ * \remarks A value of zero means the number of hardware threads is used.
+ */
+inline unsigned int Id3BatchConverter::parallelism() const
+{
+    return m_parallelism;
+}
+
+/*!
+ * \brief Sets the number of threads used to process files.
+ * \sa parallelism()
+ */
+inline void Id3BatchConverter::setParallelism(unsigned int parallelism)
+{
+    m_parallelism = parallelism;
+}
+
+/*!
+ * \brief Returns the callback invoked to apply further changes to the tags of each file.
+ */
+inline const Id3BatchConverter::TransformCallback &Id3BatchConverter::transformCallback() const
+{
+    return m_transformCallback;
+}
+
+/*!
+ * \brief Sets the callback invoked to apply further changes to the tags of each file.
+ * \remarks The callback is invoked from the worker threads after the settings have been applied and must therefore
+ *          be thread-safe. It may throw; the exception is stored in Id3BatchConverterResult::exception and the file
+ *          is left untouched.
+ */
+inline void Id3BatchConverter::setTransformCallback(const TransformCallback &callback)
+{
+    m_transformCallback = callback;
+}
+
+/*!
+ * \brief Aborts the conversion. Files which are currently being processed are still finished.
+ * \remarks May be called from any thread, e.g. from within the result callback.
+ */
+inline void Id3BatchConverter::abort()
+{
+    m_aborted.store(true);
+}
+
+/*!
+ * \brief Returns whether the conversion has been aborted.
+ */
+inline bool Id3BatchConverter::isAborted() const
+{
+    return m_aborted.load();
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_ID3BATCHCONVERTER_H
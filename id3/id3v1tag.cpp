@@ -167,32 +167,37 @@ const TagValue &Id3v1Tag::value(KnownField field) const
 
 bool Id3v1Tag::setValue(KnownField field, const TagValue &value)
 {
+    TagValue *fieldValue;
     switch (field) {
     case KnownField::Title:
-        m_title = value;
+        fieldValue = &m_title;
         break;
     case KnownField::Artist:
-        m_artist = value;
+        fieldValue = &m_artist;
         break;
     case KnownField::Album:
-        m_album = value;
+        fieldValue = &m_album;
         break;
     case KnownField::RecordDate:
     case KnownField::Year:
-        m_year = value;
+        fieldValue = &m_year;
         break;
     case KnownField::Comment:
-        m_comment = value;
+        fieldValue = &m_comment;
         break;
     case KnownField::TrackPosition:
-        m_trackPos = value;
+        fieldValue = &m_trackPos;
         break;
     case KnownField::Genre:
-        m_genre = value;
+        fieldValue = &m_genre;
         break;
     default:
         return false;
     }
+    if (!fieldValue->isIdentical(value)) {
+        *fieldValue = value;
+        m_modified = true;
+    }
     return true;
 }
 
@@ -225,6 +230,7 @@ bool Id3v1Tag::hasField(KnownField field) const
 
 void Id3v1Tag::removeAllFields()
 {
+    m_modified = m_modified || fieldCount();
     m_title.clearDataAndMetadata();
     m_artist.clearDataAndMetadata();
     m_album.clearDataAndMetadata();
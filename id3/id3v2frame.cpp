@@ -2,6 +2,7 @@
 #include "./id3genres.h"
 #include "./id3v2frameids.h"
 
+#include "../abstractattachment.h"
 #include "../diagnostics.h"
 #include "../exceptions.h"
 
@@ -29,6 +30,212 @@ enum Id3v2TextEncodingByte : std::uint8_t { Ascii, Utf16WithBom, Utf16BigEndianW
 /// \brief The maximum (supported) size of an ID3v2Frame.
 constexpr auto maxId3v2FrameDataSize(numeric_limits<std::uint32_t>::max() - 15);
 
+/// \brief The number of bytes read from picture frames when ParsingFlags::LazyLoadPictures is present.
+/// \remarks This is supposed to cover the MIME-type, picture type and description of any reasonable picture frame.
+constexpr std::uint32_t lazyPictureFrameHeadSize = 0x400;
+
+namespace {
+
+/*!
+ * \brief The ZlibStreams class provides the z_stream instances used to inflate and deflate frame data.
+ * \remarks There is one instance per thread (see forCurrentThread()) so the streams and the state zlib allocates for
+ *          them are reused for all frames instead of being allocated for each frame (as uncompress() and compress() do).
+ */
+class ZlibStreams {
+public:
+    ZlibStreams() = default;
+    ZlibStreams(const ZlibStreams &) = delete;
+    ZlibStreams &operator=(const ZlibStreams &) = delete;
+    ~ZlibStreams();
+
+    z_stream *inflater();
+    z_stream *deflater();
+    static ZlibStreams &forCurrentThread();
+
+private:
+    z_stream m_inflater = {};
+    z_stream m_deflater = {};
+    bool m_inflaterInitialized = false;
+    bool m_deflaterInitialized = false;
+};
+
+ZlibStreams::~ZlibStreams()
+{
+    if (m_inflaterInitialized) {
+        inflateEnd(&m_inflater);
+    }
+    if (m_deflaterInitialized) {
+        deflateEnd(&m_deflater);
+    }
+}
+
+/*!
+ * \brief Returns the stream for inflating in its initial state or nullptr if it can not be initialized.
+ */
+z_stream *ZlibStreams::inflater()
+{
+    if (m_inflaterInitialized) {
+        return inflateReset(&m_inflater) == Z_OK ? &m_inflater : nullptr;
+    }
+    return (m_inflaterInitialized = inflateInit(&m_inflater) == Z_OK) ? &m_inflater : nullptr;
+}
+
+/*!
+ * \brief Returns the stream for deflating in its initial state or nullptr if it can not be initialized.
+ */
+z_stream *ZlibStreams::deflater()
+{
+    if (m_deflaterInitialized) {
+        return deflateReset(&m_deflater) == Z_OK ? &m_deflater : nullptr;
+    }
+    return (m_deflaterInitialized = deflateInit(&m_deflater, Z_DEFAULT_COMPRESSION) == Z_OK) ? &m_deflater : nullptr;
+}
+
+/*!
+ * \brief Returns the instance for the current thread.
+ */
+ZlibStreams &ZlibStreams::forCurrentThread()
+{
+    static thread_local ZlibStreams streams;
+    return streams;
+}
+
+/*!
+ * \brief Inflates the specified \a input skipping the first \a skip bytes of the inflated data.
+ * \returns Returns a zlib status code like uncompress(): Z_OK on success, Z_BUF_ERROR if the inflated data exceeds
+ *          \a outputSize and Z_DATA_ERROR if the input is corrupted or incomplete.
+ * \remarks
+ * - Writes up to \a outputSize bytes to \a output and sets \a outputSize to the number of bytes actually written.
+ * - If \a partial is set inflating stops without error when \a output is full. This allows inflating only the head of
+ *   a frame.
+ */
+int inflateData(const char *input, std::size_t inputSize, std::size_t skip, char *output, std::size_t &outputSize, bool partial)
+{
+    auto *const stream = ZlibStreams::forCurrentThread().inflater();
+    if (!stream) {
+        return Z_MEM_ERROR;
+    }
+    stream->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input));
+    stream->avail_in = static_cast<uInt>(inputSize);
+
+    // inflate the data to be skipped into a scratch buffer
+    Bytef scratch[0x1000];
+    auto status = Z_OK;
+    while (skip && status == Z_OK) {
+        const auto chunkSize = static_cast<uInt>(min<std::size_t>(skip, sizeof(scratch)));
+        stream->next_out = scratch;
+        stream->avail_out = chunkSize;
+        status = inflate(stream, Z_NO_FLUSH);
+        skip -= chunkSize - stream->avail_out;
+    }
+
+    // inflate the requested data into the output buffer
+    stream->next_out = reinterpret_cast<Bytef *>(output);
+    stream->avail_out = static_cast<uInt>(outputSize);
+    while (status == Z_OK && stream->avail_out) {
+        status = inflate(stream, Z_NO_FLUSH);
+    }
+    outputSize -= stream->avail_out;
+
+    switch (status) {
+    case Z_STREAM_END:
+        return skip ? Z_DATA_ERROR : Z_OK;
+    case Z_OK:
+        if (partial) {
+            return Z_OK;
+        }
+        // the output buffer is full; check whether the end of the data has been reached as well
+        stream->next_out = scratch;
+        stream->avail_out = 1;
+        status = inflate(stream, Z_NO_FLUSH);
+        return status == Z_STREAM_END && stream->avail_out ? Z_OK : (status == Z_OK ? Z_BUF_ERROR : Z_DATA_ERROR);
+    case Z_BUF_ERROR:
+    case Z_NEED_DICT:
+        // no progress possible because the input is incomplete or a dictionary would be required
+        return Z_DATA_ERROR;
+    default:
+        return status;
+    }
+}
+
+/*!
+ * \brief Deflates the specified \a input into \a output which is allocated to fit the deflated data.
+ * \returns Returns a zlib status code like compress().
+ * \remarks Sets \a outputSize to the size of the deflated data.
+ */
+int deflateData(const char *input, std::size_t inputSize, std::unique_ptr<char[]> &output, std::size_t &outputSize)
+{
+    auto *const stream = ZlibStreams::forCurrentThread().deflater();
+    if (!stream) {
+        return Z_MEM_ERROR;
+    }
+    outputSize = deflateBound(stream, static_cast<uLong>(inputSize));
+    output = make_unique<char[]>(outputSize);
+    stream->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input));
+    stream->avail_in = static_cast<uInt>(inputSize);
+    stream->next_out = reinterpret_cast<Bytef *>(output.get());
+    stream->avail_out = static_cast<uInt>(outputSize);
+    const auto status = deflate(stream, Z_FINISH);
+    outputSize -= stream->avail_out;
+    return status == Z_STREAM_END ? Z_OK : (status == Z_OK ? Z_BUF_ERROR : status);
+}
+
+/*!
+ * \brief The DeflatedDataBlock class provides the picture data of a compressed frame which is inflated when accessed.
+ * \remarks The compressed data is kept in memory so the stream the frame has been parsed from is not required.
+ */
+class DeflatedDataBlock : public StreamDataBlock {
+public:
+    explicit DeflatedDataBlock(std::shared_ptr<const char> deflatedData, std::uint32_t deflatedSize, std::size_t skip, std::size_t size);
+
+    void makeBuffer() const override;
+    void copyTo(std::ostream &stream) const override;
+
+private:
+    std::shared_ptr<const char> m_deflatedData;
+    std::uint32_t m_deflatedSize;
+    std::size_t m_skip;
+};
+
+/*!
+ * \brief Constructs a block for \a size bytes of the inflated data after skipping the first \a skip bytes.
+ */
+DeflatedDataBlock::DeflatedDataBlock(std::shared_ptr<const char> deflatedData, std::uint32_t deflatedSize, std::size_t skip, std::size_t size)
+    : m_deflatedData(std::move(deflatedData))
+    , m_deflatedSize(deflatedSize)
+    , m_skip(skip)
+{
+    m_endOffset = static_cast<std::streamoff>(size);
+}
+
+/*!
+ * \brief Inflates the data.
+ * \throws Throws std::ios_base::failure if the data can not be inflated (like any failure to read lazy-loaded data).
+ */
+void DeflatedDataBlock::makeBuffer() const
+{
+    auto bufferSize = static_cast<std::size_t>(size());
+    auto buffer = make_unique<char[]>(bufferSize);
+    if (inflateData(m_deflatedData.get(), m_deflatedSize, m_skip, buffer.get(), bufferSize, false) != Z_OK
+        || bufferSize != static_cast<std::size_t>(size())) {
+        throw std::ios_base::failure("Unable to inflate the data of the compressed ID3v2 frame.");
+    }
+    m_buffer = std::move(buffer);
+}
+
+/*!
+ * \brief Inflates the data (if not done yet) and writes it to the specified \a stream.
+ */
+void DeflatedDataBlock::copyTo(std::ostream &stream) const
+{
+    if (!buffer()) {
+        makeBuffer();
+    }
+    stream.write(buffer().get(), size());
+}
+
+} // namespace
+
 /*!
  * \class TagParser::Id3v2Frame
  * \brief The Id3v2Frame class is used by Id3v2Tag to store the fields.
@@ -38,7 +245,11 @@ constexpr auto maxId3v2FrameDataSize(numeric_limits<std::uint32_t>::max() - 15);
  * \brief Constructs a new Id3v2Frame.
  */
 Id3v2Frame::Id3v2Frame()
-    : m_parsedVersion(0)
+    : m_lazyDataStream(nullptr)
+    , m_lazyDataHead(nullptr)
+    , m_lazyDataOffset(0)
+    , m_deflatedDataSize(0)
+    , m_parsedVersion(0)
     , m_dataSize(0)
     , m_totalSize(0)
     , m_flag(0)
@@ -52,6 +263,10 @@ Id3v2Frame::Id3v2Frame()
  */
 Id3v2Frame::Id3v2Frame(const IdentifierType &id, const TagValue &value, std::uint8_t group, std::uint16_t flag)
     : TagField<Id3v2Frame>(id, value)
+    , m_lazyDataStream(nullptr)
+    , m_lazyDataHead(nullptr)
+    , m_lazyDataOffset(0)
+    , m_deflatedDataSize(0)
     , m_parsedVersion(0)
     , m_dataSize(0)
     , m_totalSize(0)
@@ -127,14 +342,25 @@ u16string wideStringFromSubstring(tuple<const char *, size_t, const char *> subs
  * The position of the current character in the input stream is expected to be
  * at the beginning of the frame to be parsed.
  *
+ * If \a flags contains ParsingFlags::ShareTagValueData the values refer to the buffer the data has been read into
+ * instead of copying it. If \a flags contains ParsingFlags::LazyLoadPictures only the head of picture frames is read;
+ * the picture data is read from the stream of \a reader when accessed. If the stream of \a reader only exists while
+ * parsing (e.g. because it reads from a buffer), another stream denoting the same offsets can be specified as
+ * \a lazyDataStream to read the picture data from instead.
+ *
+ * Unsynchronisation of ID3v2.4 frames is removed while the data is read (see removeUnsynchronisation()).
+ *
  * \throws Throws std::ios_base::failure when an IO error occurs.
  * \throws Throws TagParser::Failure or a derived exception when a parsing
  *         error occurs.
  */
-void Id3v2Frame::parse(BinaryReader &reader, std::uint32_t version, std::uint32_t maximalSize, Diagnostics &diag)
+void Id3v2Frame::parse(
+    BinaryReader &reader, std::uint32_t version, std::uint32_t maximalSize, Diagnostics &diag, ParsingFlags flags, std::istream *lazyDataStream)
 {
     static const string defaultContext("parsing ID3v2 frame");
     string context;
+    std::uint32_t dataLength = 0;
+    m_parsedVersion = version;
 
     // parse header
     if (version < 3) {
@@ -187,14 +413,41 @@ void Id3v2Frame::parse(BinaryReader &reader, std::uint32_t version, std::uint32_
             throw TruncatedDataException();
         }
 
-        // -> read flags and group
+        // -> read flags
         m_flag = reader.readUInt16BE();
-        m_group = hasGroupInformation() ? reader.readByte() : 0;
         if (isEncrypted()) {
             // encryption is not implemented
             diag.emplace_back(DiagLevel::Critical, "Encrypted frames aren't supported.", context);
             throw VersionNotSupportedException();
         }
+
+        // -> read group and data length indicator (in the order of the flags) which are counted by the frame size as well
+        const auto readDataLength = [&] {
+            if (!hasDataLengthIndicator()) {
+                return;
+            }
+            if (m_dataSize < 4) {
+                diag.emplace_back(DiagLevel::Critical, "The data length indicator is truncated.", context);
+                throw TruncatedDataException();
+            }
+            dataLength = version >= 4 ? reader.readSynchsafeUInt32BE() : reader.readUInt32BE();
+            m_dataSize -= 4;
+        };
+        if (version < 4) {
+            readDataLength();
+        }
+        m_group = 0;
+        if (hasGroupInformation()) {
+            if (!m_dataSize) {
+                diag.emplace_back(DiagLevel::Critical, "The group information is truncated.", context);
+                throw TruncatedDataException();
+            }
+            m_group = reader.readByte();
+            m_dataSize -= 1;
+        }
+        if (version >= 4) {
+            readDataLength();
+        }
     }
 
     // add a warning if a frame appears in an ID3v2 tag known not to support it
@@ -214,51 +467,88 @@ void Id3v2Frame::parse(BinaryReader &reader, std::uint32_t version, std::uint32_
 
     // parse the data
     unique_ptr<char[]> buffer;
-
-    // -> decompress data if compressed; otherwise just read it
-    if (isCompressed()) {
-        uLongf decompressedSize = version >= 4 ? reader.readSynchsafeUInt32BE() : reader.readUInt32BE();
-        if (decompressedSize < m_dataSize) {
-            diag.emplace_back(DiagLevel::Critical, "The decompressed size is smaller than the compressed size.", context);
-            throw InvalidDataException();
+    const auto isPictureFrame = (version >= 3 && id() == Id3v2FrameIds::lCover) || (version < 3 && id() == Id3v2FrameIds::sCover);
+    // note: Compressed pictures are inflated when accessed (see assignParsedData()) so they can be lazy-loaded even if unsynchronized.
+    auto lazyPicture = (flags & ParsingFlags::LazyLoadPictures) && isPictureFrame
+        && (isCompressed() ? dataLength > lazyPictureFrameHeadSize : !isUnsynchronized() && m_dataSize > lazyPictureFrameHeadSize);
+    const auto readData = [&, unsynchronized = isUnsynchronized()](std::uint32_t &size) {
+        auto data = make_unique<char[]>(size);
+        reader.read(data.get(), size);
+        if (unsynchronized) {
+            size = static_cast<std::uint32_t>(removeUnsynchronisation(data.get(), size));
         }
-        const auto bufferCompressed = make_unique<char[]>(m_dataSize);
-        reader.read(bufferCompressed.get(), m_dataSize);
-        buffer = make_unique<char[]>(decompressedSize);
-        switch (
-            uncompress(reinterpret_cast<Bytef *>(buffer.get()), &decompressedSize, reinterpret_cast<Bytef *>(bufferCompressed.get()), m_dataSize)) {
+        return data;
+    };
+
+    const auto checkInflateStatus = [&](int status) {
+        switch (status) {
+        case Z_OK:
+            return;
         case Z_MEM_ERROR:
-            diag.emplace_back(DiagLevel::Critical, "Decompressing failed. The source buffer was too small.", context);
-            throw InvalidDataException();
+            diag.emplace_back(DiagLevel::Critical, "Decompressing failed. Not enough memory available.", context);
+            break;
         case Z_BUF_ERROR:
             diag.emplace_back(DiagLevel::Critical, "Decompressing failed. The destination buffer was too small.", context);
-            throw InvalidDataException();
+            break;
         case Z_DATA_ERROR:
             diag.emplace_back(DiagLevel::Critical, "Decompressing failed. The input data was corrupted or incomplete.", context);
-            throw InvalidDataException();
-        case Z_OK:
             break;
         default:
             diag.emplace_back(DiagLevel::Critical, "Decompressing failed (unknown reason).", context);
+        }
+        throw InvalidDataException();
+    };
+
+    // -> decompress data if compressed; otherwise just read it
+    if (isCompressed()) {
+        auto compressedSize = m_dataSize;
+        auto bufferCompressed = readData(compressedSize);
+        if (dataLength < compressedSize) {
+            diag.emplace_back(DiagLevel::Critical, "The decompressed size is smaller than the compressed size.", context);
             throw InvalidDataException();
         }
-        if (decompressedSize > maxId3v2FrameDataSize) {
+        if (dataLength > maxId3v2FrameDataSize) {
             diag.emplace_back(DiagLevel::Critical, "The decompressed data exceeds the maximum supported frame size.", context);
             throw InvalidDataException();
         }
-        m_dataSize = static_cast<std::uint32_t>(decompressedSize);
+        // inflate only the head of lazy-loaded pictures
+        auto decompressedSize = static_cast<std::size_t>(lazyPicture ? lazyPictureFrameHeadSize : dataLength);
+        buffer = make_unique<char[]>(decompressedSize);
+        checkInflateStatus(inflateData(bufferCompressed.get(), compressedSize, 0, buffer.get(), decompressedSize, lazyPicture));
+        if (lazyPicture && decompressedSize == lazyPictureFrameHeadSize) {
+            // keep the compressed data to inflate the picture data when accessed (see assignParsedData())
+            m_deflatedData = std::shared_ptr<const char>(bufferCompressed.release(), std::default_delete<char[]>());
+            m_deflatedDataSize = compressedSize;
+            m_lazyDataHead = buffer.get();
+            m_dataSize = dataLength;
+        } else {
+            lazyPicture = false;
+            m_dataSize = static_cast<std::uint32_t>(decompressedSize);
+        }
+    } else if (lazyPicture) {
+        // read only the head of the picture frame; the picture data is read when accessed (see assignParsedData())
+        m_lazyDataStream = lazyDataStream ? lazyDataStream : reader.stream();
+        m_lazyDataOffset = static_cast<std::uint64_t>(reader.stream()->tellg());
+        buffer = make_unique<char[]>(lazyPictureFrameHeadSize);
+        reader.read(buffer.get(), lazyPictureFrameHeadSize);
+        m_lazyDataHead = buffer.get();
     } else {
-        buffer = make_unique<char[]>(m_dataSize);
-        reader.read(buffer.get(), m_dataSize);
+        buffer = readData(m_dataSize);
+    }
+
+    // -> share the buffer with the parsed values instead of copying data out of it if enabled
+    const char *const bufferData = buffer.get();
+    if (flags & ParsingFlags::ShareTagValueData) {
+        m_parseBuffer = std::shared_ptr<const void>(buffer.release(), std::default_delete<char[]>());
     }
 
     // read tag value depending on frame ID/type
     if (Id3v2FrameIds::isTextFrame(id())) {
         // parse text encoding byte
-        TagTextEncoding dataEncoding = parseTextEncodingByte(static_cast<std::uint8_t>(*buffer.get()), diag);
+        TagTextEncoding dataEncoding = parseTextEncodingByte(static_cast<std::uint8_t>(*bufferData), diag);
 
         // parse string values (since ID3v2.4 a text frame may contain multiple strings)
-        const char *currentOffset = buffer.get() + 1;
+        const char *currentOffset = bufferData + 1;
         for (size_t currentIndex = 1; currentIndex < m_dataSize;) {
             // determine the next substring
             const auto substr(parseSubstring(currentOffset, m_dataSize - currentIndex, dataEncoding, false, diag));
@@ -268,7 +558,7 @@ void Id3v2Frame::parse(BinaryReader &reader, std::uint32_t version, std::uint32_
                 if (currentIndex == 1) {
                     value().clearDataAndMetadata();
                 }
-                currentIndex = static_cast<size_t>(get<2>(substr) - buffer.get());
+                currentIndex = static_cast<size_t>(get<2>(substr) - bufferData);
                 currentOffset = get<2>(substr);
                 continue;
             }
@@ -301,7 +591,7 @@ void Id3v2Frame::parse(BinaryReader &reader, std::uint32_t version, std::uint32_
                 try {
                     const auto milliseconds = [&] {
                         if (dataEncoding == TagTextEncoding::Utf16BigEndian || dataEncoding == TagTextEncoding::Utf16LittleEndian) {
-                            const auto parsedStringRef = parseSubstring(buffer.get() + 1, m_dataSize - 1, dataEncoding, false, diag);
+                            const auto parsedStringRef = parseSubstring(bufferData + 1, m_dataSize - 1, dataEncoding, false, diag);
                             const auto convertedStringData = dataEncoding == TagTextEncoding::Utf16BigEndian
                                 ? convertUtf16BEToUtf8(get<0>(parsedStringRef), get<1>(parsedStringRef))
                                 : convertUtf16LEToUtf8(get<0>(parsedStringRef), get<1>(parsedStringRef));
@@ -329,14 +619,14 @@ void Id3v2Frame::parse(BinaryReader &reader, std::uint32_t version, std::uint32_
                     value->assignStandardGenreIndex(genreIndex);
                 } else {
                     // genre is specified as string
-                    value->assignData(get<0>(substr), get<1>(substr), TagDataType::Text, dataEncoding);
+                    assignParsedData(*value, get<0>(substr), get<1>(substr), TagDataType::Text, dataEncoding);
                 }
             } else {
                 // store any other text frames as-is
-                value->assignData(get<0>(substr), get<1>(substr), TagDataType::Text, dataEncoding);
+                assignParsedData(*value, get<0>(substr), get<1>(substr), TagDataType::Text, dataEncoding);
             }
 
-            currentIndex = static_cast<size_t>(get<2>(substr) - buffer.get());
+            currentIndex = static_cast<size_t>(get<2>(substr) - bufferData);
             currentOffset = get<2>(substr);
         }
 
@@ -346,27 +636,58 @@ void Id3v2Frame::parse(BinaryReader &reader, std::uint32_t version, std::uint32_
                 DiagLevel::Warning, "Multiple strings found though the tag is pre-ID3v2.4. " + ignoreAdditionalValuesDiagMsg(), context);
         }
 
-    } else if (version >= 3 && id() == Id3v2FrameIds::lCover) {
-        // parse picture frame
+    } else if (isPictureFrame) {
+        // parse picture frame (or legacy picture frame in ID3v2.2)
+        const auto parseFunction = version >= 3 ? &Id3v2Frame::parsePicture : &Id3v2Frame::parseLegacyPicture;
         std::uint8_t type;
-        parsePicture(buffer.get(), m_dataSize, value(), type, diag);
-        setTypeInfo(type);
-
-    } else if (version < 3 && id() == Id3v2FrameIds::sCover) {
-        // parse legacy picutre
-        std::uint8_t type;
-        parseLegacyPicture(buffer.get(), m_dataSize, value(), type, diag);
+        if (lazyPicture) {
+            // parse only the head; read the entire frame if the meta-data is not contained by the head
+            Diagnostics headDiag;
+            headDiag.setFlags(diag.flags());
+            headDiag.setLevelThreshold(diag.levelThreshold());
+            try {
+                (this->*parseFunction)(bufferData, lazyPictureFrameHeadSize, value(), type, headDiag);
+            } catch (const TruncatedDataException &) {
+                headDiag.clear();
+                auto entireBuffer = make_unique<char[]>(m_dataSize);
+                if (m_deflatedData) {
+                    auto decompressedSize = static_cast<std::size_t>(m_dataSize);
+                    checkInflateStatus(inflateData(m_deflatedData.get(), m_deflatedDataSize, 0, entireBuffer.get(), decompressedSize, false));
+                    m_dataSize = static_cast<std::uint32_t>(decompressedSize);
+                } else {
+                    copy(bufferData, bufferData + lazyPictureFrameHeadSize, entireBuffer.get());
+                    reader.read(entireBuffer.get() + lazyPictureFrameHeadSize, m_dataSize - lazyPictureFrameHeadSize);
+                }
+                buffer = move(entireBuffer);
+                m_parseBuffer.reset();
+                m_deflatedData.reset();
+                m_lazyDataStream = nullptr;
+                (this->*parseFunction)(buffer.get(), m_dataSize, value(), type, headDiag);
+            }
+            for (auto &message : headDiag) {
+                diag.push_back(std::move(message));
+            }
+        } else {
+            (this->*parseFunction)(bufferData, m_dataSize, value(), type, diag);
+        }
         setTypeInfo(type);
 
     } else if (((version >= 3 && id() == Id3v2FrameIds::lComment) || (version < 3 && id() == Id3v2FrameIds::sComment))
         || ((version >= 3 && id() == Id3v2FrameIds::lUnsynchronizedLyrics) || (version < 3 && id() == Id3v2FrameIds::sUnsynchronizedLyrics))) {
         // parse comment frame or unsynchronized lyrics frame (these two frame types have the same structure)
-        parseComment(buffer.get(), m_dataSize, value(), diag);
+        parseComment(bufferData, m_dataSize, value(), diag);
 
     } else {
-        // parse unknown/unsupported frame
-        value().assignData(buffer.get(), m_dataSize, TagDataType::Undefined);
+        // parse unknown/unsupported frame (taking over the buffer instead of copying it)
+        if (m_parseBuffer) {
+            value().assignSharedData(m_parseBuffer, bufferData, m_dataSize, TagDataType::Undefined);
+        } else {
+            value().assignData(std::move(buffer), m_dataSize, TagDataType::Undefined);
+        }
     }
+    m_parseBuffer.reset();
+    m_deflatedData.reset();
+    m_lazyDataStream = nullptr;
 }
 
 /*!
@@ -409,6 +730,34 @@ void Id3v2Frame::reset()
     m_totalSize = 0;
     m_padding = false;
     m_additionalValues.clear();
+    m_parseBuffer.reset();
+    m_deflatedData.reset();
+    m_lazyDataStream = nullptr;
+}
+
+/*!
+ * \brief Assigns the specified \a data of the frame being parsed to the specified \a tagValue.
+ * \remarks The data is not copied but shared if ParsingFlags::ShareTagValueData has been specified when parsing.
+ * \remarks The data is assigned to be read when accessed if only the head of a picture frame has been read when
+ *          parsing (ParsingFlags::LazyLoadPictures). The picture data is then assumed to range until the end of the frame.
+ *          If the frame is compressed the picture data is inflated when accessed.
+ */
+void Id3v2Frame::assignParsedData(TagValue &tagValue, const char *data, std::size_t length, TagDataType type, TagTextEncoding encoding)
+{
+    if (m_deflatedData && type == TagDataType::Picture) {
+        const auto skip = static_cast<std::size_t>(data - m_lazyDataHead);
+        tagValue.assignLazyData(make_shared<DeflatedDataBlock>(m_deflatedData, m_deflatedDataSize, skip, m_dataSize - skip), type, encoding);
+        return;
+    }
+    if (m_lazyDataStream && type == TagDataType::Picture) {
+        const auto startOffset = m_lazyDataOffset + static_cast<std::uint64_t>(data - m_lazyDataHead);
+        tagValue.assignLazyData(make_shared<StreamDataBlock>([stream = m_lazyDataStream]() -> istream & { return *stream; },
+                                    static_cast<istream::off_type>(startOffset), ios_base::beg,
+                                    static_cast<istream::off_type>(m_lazyDataOffset + m_dataSize), ios_base::beg),
+            type, encoding);
+        return;
+    }
+    tagValue.assignSharedData(m_parseBuffer, data, length, type, encoding);
 }
 
 /*!
@@ -655,17 +1004,20 @@ Id3v2FrameMaker::Id3v2FrameMaker(Id3v2Frame &frame, std::uint8_t version, Diagno
 
     // apply compression if frame should be compressed
     if (version >= 3 && m_frame.isCompressed()) {
-        auto compressedSize = compressBound(m_decompressedSize);
-        auto compressedData = make_unique<char[]>(compressedSize);
-        switch (compress(reinterpret_cast<Bytef *>(compressedData.get()), reinterpret_cast<uLongf *>(&compressedSize),
-            reinterpret_cast<Bytef *>(m_data.get()), m_decompressedSize)) {
+        auto compressedSize = std::size_t();
+        auto compressedData = unique_ptr<char[]>();
+        switch (deflateData(m_data.get(), m_decompressedSize, compressedData, compressedSize)) {
+        case Z_OK:
+            break;
         case Z_MEM_ERROR:
-            diag.emplace_back(DiagLevel::Critical, "Decompressing failed. The source buffer was too small.", context);
+            diag.emplace_back(DiagLevel::Critical, "Compressing failed. Not enough memory available.", context);
             throw InvalidDataException();
         case Z_BUF_ERROR:
-            diag.emplace_back(DiagLevel::Critical, "Decompressing failed. The destination buffer was too small.", context);
+            diag.emplace_back(DiagLevel::Critical, "Compressing failed. The destination buffer was too small.", context);
+            throw InvalidDataException();
+        default:
+            diag.emplace_back(DiagLevel::Critical, "Compressing failed (unknown reason).", context);
             throw InvalidDataException();
-        case Z_OK:;
         }
         if (compressedSize > maxId3v2FrameDataSize) {
             diag.emplace_back(DiagLevel::Critical, "Compressed size exceeds maximum data size.", context);
@@ -678,23 +1030,43 @@ Id3v2FrameMaker::Id3v2FrameMaker(Id3v2Frame &frame, std::uint8_t version, Diagno
     }
 
     // calculate required size
-    // -> data size
-    m_requiredSize = m_dataSize;
-    if (version < 3) {
-        // -> header size
-        m_requiredSize += 6;
-    } else {
-        // -> header size
-        m_requiredSize += 10;
+    // -> data size (the data is only scanned here and unsynchronised when actually making the frame)
+    m_unsynchronised = version >= 4 && m_frame.isUnsynchronized();
+    m_frameSize = m_unsynchronised ? static_cast<std::uint32_t>(Id3v2Frame::unsynchronisedSize(m_data.get(), m_dataSize)) : m_dataSize;
+    m_dataLengthIndicator = version >= 4 ? m_frame.hasDataLengthIndicator() || m_frame.isCompressed() : version >= 3 && m_frame.isCompressed();
+    m_flag = version >= 3 ? makeFlag() : 0;
+    if (version >= 3) {
         // -> group byte
         if (m_frame.hasGroupInformation()) {
-            m_requiredSize += 1;
+            m_frameSize += 1;
         }
-        // -> decompressed size
-        if (version >= 3 && m_frame.isCompressed()) {
-            m_requiredSize += 4;
+        // -> data length indicator/decompressed size
+        if (m_dataLengthIndicator) {
+            m_frameSize += 4;
         }
     }
+    // -> header size
+    m_requiredSize = m_frameSize + (version < 3 ? 6 : 10);
+}
+
+/*!
+ * \brief Returns the flags of the frame in the layout of the version the frame is made for.
+ *
+ * The flags of the frame are in the layout of the version the frame has been parsed from (see
+ * Id3v2Frame::parsedVersion()) which differs between ID3v2.3 and ID3v2.4. The format flags are set according to what is
+ * actually written; in particular the flag for the data length indicator is set whenever one is written.
+ */
+std::uint16_t Id3v2FrameMaker::makeFlag() const
+{
+    // -> status flags (tag alter preservation, file alter preservation, read-only) in the layout of ID3v2.3
+    const auto flag = m_frame.flag();
+    const auto statusFlag = static_cast<std::uint16_t>(m_frame.parsedVersion() >= 4 ? (flag & 0x7000) << 1 : flag & 0xE000);
+    if (m_version < 4) {
+        return static_cast<std::uint16_t>(
+            statusFlag | (m_frame.isCompressed() ? 0x80 : 0x00) | (m_frame.hasGroupInformation() ? 0x20 : 0x00));
+    }
+    return static_cast<std::uint16_t>((statusFlag >> 1) | (m_frame.hasGroupInformation() ? 0x40 : 0x00) | (m_frame.isCompressed() ? 0x08 : 0x00)
+        | (m_unsynchronised ? 0x02 : 0x00) | (m_dataLengthIndicator ? 0x01 : 0x00));
 }
 
 /*!
@@ -708,27 +1080,64 @@ void Id3v2FrameMaker::make(BinaryWriter &writer)
 {
     if (m_version < 3) {
         writer.writeUInt24BE(m_frameId);
-        writer.writeUInt24BE(m_dataSize);
+        writer.writeUInt24BE(m_frameSize);
     } else {
         writer.writeUInt32BE(m_frameId);
         if (m_version >= 4) {
-            writer.writeSynchsafeUInt32BE(m_dataSize);
+            writer.writeSynchsafeUInt32BE(m_frameSize);
         } else {
-            writer.writeUInt32BE(m_dataSize);
+            writer.writeUInt32BE(m_frameSize);
+        }
+        writer.writeUInt16BE(m_flag);
+        if (m_version < 4 && m_dataLengthIndicator) {
+            writer.writeUInt32BE(m_decompressedSize);
         }
-        writer.writeUInt16BE(m_frame.flag());
         if (m_frame.hasGroupInformation()) {
             writer.writeByte(m_frame.group());
         }
-        if (m_version >= 3 && m_frame.isCompressed()) {
-            if (m_version >= 4) {
-                writer.writeSynchsafeUInt32BE(m_decompressedSize);
-            } else {
-                writer.writeUInt32BE(m_decompressedSize);
-            }
+        if (m_version >= 4 && m_dataLengthIndicator) {
+            writer.writeSynchsafeUInt32BE(m_decompressedSize);
+        }
+    }
+    if (m_unsynchronised) {
+        Id3v2Frame::writeUnsynchronised(writer, m_data.get(), m_dataSize);
+    } else {
+        writer.write(m_data.get(), m_dataSize);
+    }
+}
+
+/*!
+ * \brief Saves the frame (specified when constructing the object) to the specified \a buffer.
+ * \returns Returns a pointer to the end of the written frame.
+ * \remarks The \a buffer must hold at least requiredSize() bytes.
+ */
+char *Id3v2FrameMaker::make(char *buffer)
+{
+    if (m_version < 3) {
+        BE::getBytes24(m_frameId, buffer);
+        BE::getBytes24(m_frameSize, buffer + 3);
+        buffer += 6;
+    } else {
+        BE::getBytes(m_frameId, buffer);
+        BE::getBytes(m_version >= 4 ? toSynchsafeInt(m_frameSize) : m_frameSize, buffer + 4);
+        BE::getBytes(m_flag, buffer + 8);
+        buffer += 10;
+        if (m_version < 4 && m_dataLengthIndicator) {
+            BE::getBytes(m_decompressedSize, buffer);
+            buffer += 4;
+        }
+        if (m_frame.hasGroupInformation()) {
+            *buffer++ = static_cast<char>(m_frame.group());
         }
+        if (m_version >= 4 && m_dataLengthIndicator) {
+            BE::getBytes(toSynchsafeInt(m_decompressedSize), buffer);
+            buffer += 4;
+        }
+    }
+    if (m_unsynchronised) {
+        return Id3v2Frame::writeUnsynchronised(buffer, m_data.get(), m_dataSize);
     }
-    writer.write(m_data.get(), m_dataSize);
+    return copy(m_data.get(), m_data.get() + m_dataSize, buffer);
 }
 
 /*!
@@ -927,7 +1336,7 @@ void Id3v2Frame::parseLegacyPicture(const char *buffer, std::size_t maxSize, Tag
         diag.emplace_back(DiagLevel::Critical, "Picture frame is incomplete (actual data is missing).", context);
         throw TruncatedDataException();
     }
-    tagValue.assignData(get<2>(substr), static_cast<size_t>(end - get<2>(substr)), TagDataType::Picture, dataEncoding);
+    assignParsedData(tagValue, get<2>(substr), static_cast<size_t>(end - get<2>(substr)), TagDataType::Picture, dataEncoding);
 }
 
 /*!
@@ -962,7 +1371,7 @@ void Id3v2Frame::parsePicture(const char *buffer, std::size_t maxSize, TagValue
         diag.emplace_back(DiagLevel::Critical, "Picture frame is incomplete (actual data is missing).", context);
         throw TruncatedDataException();
     }
-    tagValue.assignData(get<2>(substr), static_cast<size_t>(end - get<2>(substr)), TagDataType::Picture, dataEncoding);
+    assignParsedData(tagValue, get<2>(substr), static_cast<size_t>(end - get<2>(substr)), TagDataType::Picture, dataEncoding);
 }
 
 /*!
@@ -990,7 +1399,7 @@ void Id3v2Frame::parseComment(const char *buffer, std::size_t dataSize, TagValue
         throw TruncatedDataException();
     }
     substr = parseSubstring(get<2>(substr), static_cast<size_t>(end - get<2>(substr)), dataEncoding, false, diag);
-    tagValue.assignData(get<0>(substr), get<1>(substr), TagDataType::Text, dataEncoding);
+    assignParsedData(tagValue, get<0>(substr), get<1>(substr), TagDataType::Text, dataEncoding);
 }
 
 /*!
@@ -1219,4 +1628,107 @@ void Id3v2Frame::makeComment(unique_ptr<char[]> &buffer, std::uint32_t &bufferSi
     data.copy(++offset, data.size());
 }
 
+namespace {
+
+/*!
+ * \brief Returns whether a 0x00 byte needs to be inserted after a 0xFF byte followed by \a next to unsynchronise data.
+ * \remarks The byte is inserted before a byte which would form a false sync word (0xFF 0xE0 or higher) and before a
+ *          0x00 byte (so the inserted bytes can be told apart when removing unsynchronisation). Pass nullptr if the
+ *          0xFF byte is the last byte.
+ */
+bool isUnsynchronisationRequired(const char *next)
+{
+    return !next || !*next || static_cast<unsigned char>(*next) >= 0xE0;
+}
+
+} // namespace
+
+/*!
+ * \brief Removes the unsynchronisation from the specified \a buffer in-place.
+ * \returns Returns the size of the data after removing the unsynchronisation.
+ * \remarks
+ * - The 0x00 byte following each 0xFF byte is removed. Regions without 0xFF bytes are found via std::memchr() (which
+ *   is vectorized by common C libraries) and only moved once, so this is a single pass over the data.
+ * - This is used when parsing frames so the data does not need to be copied to another buffer.
+ */
+std::size_t Id3v2Frame::removeUnsynchronisation(char *buffer, std::size_t size)
+{
+    const auto *const end = buffer + size;
+    auto *input = buffer, *output = buffer;
+    for (;;) {
+        auto *const syncByte = static_cast<char *>(memchr(input, 0xFF, static_cast<std::size_t>(end - input)));
+        auto *const regionEnd = syncByte ? syncByte + 1 : buffer + size;
+        const auto regionSize = static_cast<std::size_t>(regionEnd - input);
+        if (output != input) {
+            memmove(output, input, regionSize);
+        }
+        output += regionSize;
+        input = regionEnd;
+        if (!syncByte) {
+            return static_cast<std::size_t>(output - buffer);
+        }
+        if (input != end && !*input) {
+            ++input;
+        }
+    }
+}
+
+/*!
+ * \brief Returns the size of the specified data when unsynchronised.
+ * \sa writeUnsynchronised()
+ */
+std::size_t Id3v2Frame::unsynchronisedSize(const char *buffer, std::size_t size)
+{
+    const auto *const end = buffer + size;
+    auto unsynchronisedSize = size;
+    for (auto *i = buffer; (i = static_cast<const char *>(memchr(i, 0xFF, static_cast<std::size_t>(end - i))));) {
+        if (isUnsynchronisationRequired(++i != end ? i : nullptr)) {
+            ++unsynchronisedSize;
+        }
+    }
+    return unsynchronisedSize;
+}
+
+/*!
+ * \brief Writes the specified data unsynchronised using the specified \a writer.
+ * \remarks
+ * - A 0x00 byte is inserted after each 0xFF byte which is followed by a byte of 0xE0 or higher, a 0x00 byte or the
+ *   end of the data. The regions in-between are written directly from \a buffer so no copy of the data is made.
+ * - This is used when making frames the Id3v2FrameMaker has determined the size of via unsynchronisedSize().
+ */
+void Id3v2Frame::writeUnsynchronised(BinaryWriter &writer, const char *buffer, std::size_t size)
+{
+    const auto *const end = buffer + size;
+    auto *regionStart = buffer;
+    for (auto *i = buffer; (i = static_cast<const char *>(memchr(i, 0xFF, static_cast<std::size_t>(end - i))));) {
+        if (!isUnsynchronisationRequired(++i != end ? i : nullptr)) {
+            continue;
+        }
+        writer.write(regionStart, static_cast<std::streamsize>(i - regionStart));
+        writer.writeByte(0x00);
+        regionStart = i;
+    }
+    writer.write(regionStart, static_cast<std::streamsize>(end - regionStart));
+}
+
+/*!
+ * \brief Writes the specified data unsynchronised to the specified \a target buffer.
+ * \returns Returns a pointer to the end of the written data.
+ * \remarks The \a target buffer must hold at least unsynchronisedSize() bytes.
+ */
+char *Id3v2Frame::writeUnsynchronised(char *target, const char *buffer, std::size_t size)
+{
+    const auto *const end = buffer + size;
+    auto *regionStart = buffer;
+    for (auto *i = buffer; (i = static_cast<const char *>(memchr(i, 0xFF, static_cast<std::size_t>(end - i))));) {
+        if (!isUnsynchronisationRequired(++i != end ? i : nullptr)) {
+            continue;
+        }
+        target = copy(regionStart, i, target);
+        *target++ = 0x00;
+        regionStart = i;
+    }
+    return copy(regionStart, end, target);
+}
+
 } // namespace TagParser
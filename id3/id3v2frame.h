@@ -4,6 +4,7 @@
 #include "./id3v2frameids.h"
 
 #include "../generictagfield.h"
+#include "../settings.h"
 #include "../tagvalue.h"
 
 #include <c++utilities/conversion/stringconversion.h>
@@ -11,6 +12,7 @@
 #include <c++utilities/io/binarywriter.h>
 
 #include <iosfwd>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -24,6 +26,7 @@ class TAG_PARSER_EXPORT Id3v2FrameMaker {
 
 public:
     void make(CppUtilities::BinaryWriter &writer);
+    char *make(char *buffer);
     const Id3v2Frame &field() const;
     const std::unique_ptr<char[]> &data() const;
     std::uint32_t dataSize() const;
@@ -32,6 +35,7 @@ public:
 private:
     Id3v2FrameMaker(Id3v2Frame &frame, std::uint8_t version, Diagnostics &diag);
     void makeSubstring(const TagValue &value, Diagnostics &diag, const std::string &context);
+    std::uint16_t makeFlag() const;
 
     Id3v2Frame &m_frame;
     std::uint32_t m_frameId;
@@ -39,7 +43,11 @@ private:
     std::unique_ptr<char[]> m_data;
     std::uint32_t m_dataSize;
     std::uint32_t m_decompressedSize;
+    std::uint32_t m_frameSize;
     std::uint32_t m_requiredSize;
+    std::uint16_t m_flag;
+    bool m_dataLengthIndicator;
+    bool m_unsynchronised;
 };
 
 /*!
@@ -92,7 +100,8 @@ public:
     Id3v2Frame(const IdentifierType &id, const TagValue &value, std::uint8_t group = 0, std::uint16_t flag = 0);
 
     // parsing/making
-    void parse(CppUtilities::BinaryReader &reader, std::uint32_t version, std::uint32_t maximalSize, Diagnostics &diag);
+    void parse(CppUtilities::BinaryReader &reader, std::uint32_t version, std::uint32_t maximalSize, Diagnostics &diag,
+        ParsingFlags flags = ParsingFlags::None, std::istream *lazyDataStream = nullptr);
     Id3v2FrameMaker prepareMaking(std::uint8_t version, Diagnostics &diag);
     void make(CppUtilities::BinaryWriter &writer, std::uint8_t version, Diagnostics &diag);
 
@@ -140,14 +149,27 @@ public:
     static void makeComment(
         std::unique_ptr<char[]> &buffer, std::uint32_t &bufferSize, const TagValue &comment, std::uint8_t version, Diagnostics &diag);
 
+    // unsynchronisation
+    static std::size_t removeUnsynchronisation(char *buffer, std::size_t size);
+    static std::size_t unsynchronisedSize(const char *buffer, std::size_t size);
+    static void writeUnsynchronised(CppUtilities::BinaryWriter &writer, const char *buffer, std::size_t size);
+    static char *writeUnsynchronised(char *target, const char *buffer, std::size_t size);
+
     static IdentifierType fieldIdFromString(const char *idString, std::size_t idStringSize = std::string::npos);
     static std::string fieldIdToString(IdentifierType id);
 
 private:
     void reset();
     std::string ignoreAdditionalValuesDiagMsg() const;
+    void assignParsedData(TagValue &tagValue, const char *data, std::size_t length, TagDataType type, TagTextEncoding encoding);
 
     std::vector<TagValue> m_additionalValues;
+    std::shared_ptr<const void> m_parseBuffer;
+    std::shared_ptr<const char> m_deflatedData;
+    std::istream *m_lazyDataStream;
+    const char *m_lazyDataHead;
+    std::uint64_t m_lazyDataOffset;
+    std::uint32_t m_deflatedDataSize;
     std::uint32_t m_parsedVersion;
     std::uint32_t m_dataSize;
     std::uint32_t m_totalSize;
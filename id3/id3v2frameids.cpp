@@ -1,6 +1,7 @@
 #include "./id3v2frameids.h"
 
 #include "../exceptions.h"
+#include "../perfecthashmap.h"
 
 namespace TagParser {
 
@@ -20,64 +21,48 @@ namespace TagParser {
  */
 namespace Id3v2FrameIds {
 
+namespace {
+
+/// \brief The long frame IDs and their equivalent short frame IDs.
+constexpr std::pair<std::uint32_t, std::uint32_t> longAndShortIds[] = {
+    { lAlbum, sAlbum },
+    { lArtist, sArtist },
+    { lComment, sComment },
+    { lYear, sYear },
+    { lOriginalYear, sOriginalYear },
+    { lRecordingDates, sRecordingDates },
+    { lDate, sDate },
+    { lTime, sTime },
+    { lTitle, sTitle },
+    { lGenre, sGenre },
+    { lTrackPosition, sTrackPosition },
+    { lDiskPosition, sDiskPosition },
+    { lEncoder, sEncoder },
+    { lBpm, sBpm },
+    { lCover, sCover },
+    { lWriter, sWriter },
+    { lLength, sLength },
+    { lLanguage, sLanguage },
+    { lEncoderSettings, sEncoderSettings },
+    { lUnsynchronizedLyrics, sUnsynchronizedLyrics },
+    { lAlbumArtist, sAlbumArtist },
+    { lContentGroupDescription, sContentGroupDescription },
+    { lRecordLabel, sRecordLabel },
+    { lUserDefinedText, sUserDefinedText },
+};
+constexpr auto longToShortIds = makePerfectHashMap(longAndShortIds, std::uint32_t());
+constexpr auto shortToLongIds = makeReversedPerfectHashMap(longAndShortIds, std::uint32_t());
+static_assert(longToShortIds.isPerfect() && shortToLongIds.isPerfect(), "frame IDs must be unique");
+
+} // namespace
+
 /*!
  * \brief Converts the specified long frame ID to the equivalent short frame ID.
  * \returns Returns the short ID if available; otherwise returns 0.
  */
 std::uint32_t convertToShortId(std::uint32_t id)
 {
-    switch (id) {
-    case lAlbum:
-        return sAlbum;
-    case lArtist:
-        return sArtist;
-    case lComment:
-        return sComment;
-    case lYear:
-        return sYear;
-    case lOriginalYear:
-        return sOriginalYear;
-    case lRecordingDates:
-        return sRecordingDates;
-    case lDate:
-        return sDate;
-    case lTime:
-        return sTime;
-    case lTitle:
-        return sTitle;
-    case lGenre:
-        return sGenre;
-    case lTrackPosition:
-        return sTrackPosition;
-    case lDiskPosition:
-        return sDiskPosition;
-    case lEncoder:
-        return sEncoder;
-    case lBpm:
-        return sBpm;
-    case lCover:
-        return sCover;
-    case lWriter:
-        return sWriter;
-    case lLength:
-        return sLength;
-    case lLanguage:
-        return sLanguage;
-    case lEncoderSettings:
-        return sEncoderSettings;
-    case lUnsynchronizedLyrics:
-        return sUnsynchronizedLyrics;
-    case lAlbumArtist:
-        return sAlbumArtist;
-    case lContentGroupDescription:
-        return sContentGroupDescription;
-    case lRecordLabel:
-        return sRecordLabel;
-    case lUserDefinedText:
-        return sUserDefinedText;
-    default:
-        return 0;
-    }
+    return longToShortIds.find(id);
 }
 
 /*!
@@ -86,58 +71,7 @@ std::uint32_t convertToShortId(std::uint32_t id)
  */
 std::uint32_t convertToLongId(std::uint32_t id)
 {
-    switch (id) {
-    case sAlbum:
-        return lAlbum;
-    case sArtist:
-        return lArtist;
-    case sComment:
-        return lComment;
-    case sYear:
-        return lYear;
-    case sOriginalYear:
-        return lOriginalYear;
-    case sRecordingDates:
-        return lRecordingDates;
-    case sDate:
-        return lDate;
-    case sTime:
-        return lTime;
-    case sTitle:
-        return lTitle;
-    case sGenre:
-        return lGenre;
-    case sTrackPosition:
-        return lTrackPosition;
-    case sDiskPosition:
-        return lDiskPosition;
-    case sEncoder:
-        return lEncoder;
-    case sBpm:
-        return lBpm;
-    case sCover:
-        return lCover;
-    case sWriter:
-        return lWriter;
-    case sLength:
-        return lLength;
-    case sLanguage:
-        return lLanguage;
-    case sEncoderSettings:
-        return lEncoderSettings;
-    case sUnsynchronizedLyrics:
-        return lUnsynchronizedLyrics;
-    case sAlbumArtist:
-        return lAlbumArtist;
-    case sContentGroupDescription:
-        return lContentGroupDescription;
-    case sRecordLabel:
-        return lRecordLabel;
-    case sUserDefinedText:
-        return lUserDefinedText;
-    default:
-        return 0;
-    }
+    return shortToLongIds.find(id);
 }
 
 /*!
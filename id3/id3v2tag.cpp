@@ -1,19 +1,191 @@
 #include "./id3v2tag.h"
 #include "./id3v2frameids.h"
 
+#include "../bytesource.h"
 #include "../diagnostics.h"
 #include "../exceptions.h"
+#include "../perfecthashmap.h"
+#include "../tagfieldfilter.h"
+#include "../tagtemplate.h"
 
 #include <c++utilities/conversion/stringbuilder.h>
 #include <c++utilities/conversion/stringconversion.h>
 
-#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <thread>
 
 using namespace std;
 using namespace CppUtilities;
 
 namespace TagParser {
 
+namespace {
+
+/// \brief The frame IDs (short and long) and the known fields they are mapped to.
+constexpr std::pair<std::uint32_t, KnownField> frameIdsAndKnownFields[] = {
+    { Id3v2FrameIds::lAlbum, KnownField::Album },
+    { Id3v2FrameIds::lArtist, KnownField::Artist },
+    { Id3v2FrameIds::lComment, KnownField::Comment },
+    { Id3v2FrameIds::lRecordingTime, KnownField::RecordDate },
+    { Id3v2FrameIds::lYear, KnownField::RecordDate },
+    { Id3v2FrameIds::lTitle, KnownField::Title },
+    { Id3v2FrameIds::lGenre, KnownField::Genre },
+    { Id3v2FrameIds::lTrackPosition, KnownField::TrackPosition },
+    { Id3v2FrameIds::lDiskPosition, KnownField::DiskPosition },
+    { Id3v2FrameIds::lEncoder, KnownField::Encoder },
+    { Id3v2FrameIds::lBpm, KnownField::Bpm },
+    { Id3v2FrameIds::lCover, KnownField::Cover },
+    { Id3v2FrameIds::lWriter, KnownField::Lyricist },
+    { Id3v2FrameIds::lLanguage, KnownField::Language },
+    { Id3v2FrameIds::lLength, KnownField::Length },
+    { Id3v2FrameIds::lEncoderSettings, KnownField::EncoderSettings },
+    { Id3v2FrameIds::lUnsynchronizedLyrics, KnownField::Lyrics },
+    { Id3v2FrameIds::lSynchronizedLyrics, KnownField::SynchronizedLyrics },
+    { Id3v2FrameIds::lAlbumArtist, KnownField::AlbumArtist },
+    { Id3v2FrameIds::lContentGroupDescription, KnownField::Grouping },
+    { Id3v2FrameIds::lRecordLabel, KnownField::RecordLabel },
+    { Id3v2FrameIds::sAlbum, KnownField::Album },
+    { Id3v2FrameIds::sArtist, KnownField::Artist },
+    { Id3v2FrameIds::sComment, KnownField::Comment },
+    { Id3v2FrameIds::sYear, KnownField::RecordDate },
+    { Id3v2FrameIds::sTitle, KnownField::Title },
+    { Id3v2FrameIds::sGenre, KnownField::Genre },
+    { Id3v2FrameIds::sTrackPosition, KnownField::TrackPosition },
+    { Id3v2FrameIds::sEncoder, KnownField::Encoder },
+    { Id3v2FrameIds::sBpm, KnownField::Bpm },
+    { Id3v2FrameIds::sCover, KnownField::Cover },
+    { Id3v2FrameIds::sWriter, KnownField::Lyricist },
+    { Id3v2FrameIds::sLanguage, KnownField::Language },
+    { Id3v2FrameIds::sLength, KnownField::Length },
+    { Id3v2FrameIds::sEncoderSettings, KnownField::EncoderSettings },
+    { Id3v2FrameIds::sUnsynchronizedLyrics, KnownField::Lyrics },
+    { Id3v2FrameIds::sSynchronizedLyrics, KnownField::SynchronizedLyrics },
+    { Id3v2FrameIds::sAlbumArtist, KnownField::Grouping },
+    { Id3v2FrameIds::sRecordLabel, KnownField::RecordLabel },
+};
+constexpr auto knownFieldsByFrameId = makePerfectHashMap(frameIdsAndKnownFields, KnownField::Invalid);
+static_assert(knownFieldsByFrameId.isPerfect(), "frame IDs must be unique");
+
+/*!
+ * \brief The ResynchronisedFrames struct holds the frames of a pre-ID3v2.4 tag after removing the unsynchronisation.
+ * \remarks The frames are read at once and the unsynchronisation is removed in-place. The stream exposes the buffer
+ *          without further copying.
+ */
+struct ResynchronisedFrames {
+    explicit ResynchronisedFrames(std::istream &input, std::uint32_t inputSize);
+
+    std::unique_ptr<char[]> data;
+    std::size_t size;
+    MemoryByteSource source;
+    ByteSourceStreamBuffer buffer;
+    std::istream stream;
+};
+
+ResynchronisedFrames::ResynchronisedFrames(std::istream &input, std::uint32_t inputSize)
+    : data(std::make_unique<char[]>(inputSize))
+    , size(Id3v2Frame::removeUnsynchronisation(data.get(), static_cast<std::size_t>(input.read(data.get(), inputSize).gcount())))
+    , source(std::string_view(data.get(), size))
+    , buffer(source)
+    , stream(&buffer)
+{
+}
+
+/*!
+ * \brief The BufferedFrames struct reads the frames of a tag at once and provides a stream for parsing them from memory.
+ * \remarks Unlike ResynchronisedFrames the offsets of the stream are the ones of the \a input stream. Frames exceeding
+ *          the buffered bytes are read from the \a input stream.
+ */
+struct BufferedFrames {
+    explicit BufferedFrames(std::istream &input, std::uint64_t offset, std::uint32_t size);
+
+    BufferedRangeByteSource source;
+    ByteSourceStreamBuffer buffer;
+    std::istream stream;
+};
+
+BufferedFrames::BufferedFrames(std::istream &input, std::uint64_t offset, std::uint32_t size)
+    : source(input, offset, size)
+    , buffer(source)
+    , stream(&buffer)
+{
+    stream.exceptions(input.exceptions());
+    stream.seekg(static_cast<std::streamoff>(offset));
+}
+
+/*!
+ * \brief Returns whether the data of the specified \a stream is held in memory anyways (e.g. the file is memory-mapped).
+ */
+bool isHeldInMemory(std::istream &stream)
+{
+    const auto *const buffer = dynamic_cast<ByteSourceStreamBuffer *>(stream.rdbuf());
+    return buffer && !const_cast<ByteSourceStreamBuffer *>(buffer)->source().contiguousData().empty();
+}
+
+/*!
+ * \brief Prepares making the specified \a frames using \a threadCount threads.
+ * \returns Returns the makers in the order of \a frames. Frames which can not be made are represented by std::nullopt.
+ * \remarks
+ * - Each frame gets its own Diagnostics which are added to \a diag in the order of \a frames afterwards so the result
+ *   is the same as when preparing the frames sequentially.
+ * - Lazy-loaded data (see TagValue::assignLazyData()) is loaded sequentially beforehand because it is read from the
+ *   stream of the file.
+ */
+std::vector<std::optional<Id3v2FrameMaker>> prepareFramesInParallel(
+    const std::vector<Id3v2Frame *> &frames, std::uint8_t version, std::size_t threadCount, Diagnostics &diag)
+{
+    for (const auto *const frame : frames) {
+        frame->value().loadData();
+        for (const auto &value : frame->additionalValues()) {
+            value.loadData();
+        }
+    }
+
+    auto makers = std::vector<std::optional<Id3v2FrameMaker>>(frames.size());
+    auto frameDiags = std::vector<Diagnostics>(frames.size());
+    auto exceptions = std::vector<std::exception_ptr>(frames.size());
+    auto nextFrame = std::atomic<std::size_t>(0);
+    const auto work = [&] {
+        for (auto i = nextFrame++; i < frames.size(); i = nextFrame++) {
+            auto &frameDiag = frameDiags[i];
+            frameDiag.setFlags(diag.flags());
+            frameDiag.setLevelThreshold(diag.levelThreshold());
+            try {
+                makers[i].emplace(frames[i]->prepareMaking(version, frameDiag));
+            } catch (const Failure &) {
+            } catch (...) {
+                exceptions[i] = std::current_exception();
+            }
+        }
+    };
+    auto workers = std::vector<std::thread>();
+    workers.reserve(threadCount - 1);
+    for (auto i = std::size_t(1); i < threadCount; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    for (auto i = std::size_t(); i != frames.size(); ++i) {
+        for (auto &message : frameDiags[i]) {
+            diag.push_back(std::move(message));
+        }
+        if (exceptions[i]) {
+            std::rethrow_exception(exceptions[i]);
+        }
+    }
+    return makers;
+}
+
+} // namespace
+
 /*!
  * \class TagParser::Id3v2Tag
  * \brief Implementation of TagParser::Tag for ID3v2 tags.
@@ -122,6 +294,8 @@ bool Id3v2Tag::internallySetValues(const IdentifierType &id, const std::vector<T
         // add primary value to new frame
         frameIterator = fields().insert(make_pair(id, Id3v2Frame(id, *valuesIterator)));
         ++valuesIterator;
+        // reset range as inserting might have invalidated its iterators (it is empty anyway)
+        range.first = range.second = fields().end();
     }
 
     // add additional values to frame
@@ -243,88 +417,7 @@ Id3v2Tag::IdentifierType Id3v2Tag::internallyGetFieldId(KnownField field) const
 
 KnownField Id3v2Tag::internallyGetKnownField(const IdentifierType &id) const
 {
-    using namespace Id3v2FrameIds;
-    switch (id) {
-    case lAlbum:
-        return KnownField::Album;
-    case lArtist:
-        return KnownField::Artist;
-    case lComment:
-        return KnownField::Comment;
-    case lRecordingTime:
-    case lYear:
-        return KnownField::RecordDate;
-    case lTitle:
-        return KnownField::Title;
-    case lGenre:
-        return KnownField::Genre;
-    case lTrackPosition:
-        return KnownField::TrackPosition;
-    case lDiskPosition:
-        return KnownField::DiskPosition;
-    case lEncoder:
-        return KnownField::Encoder;
-    case lBpm:
-        return KnownField::Bpm;
-    case lCover:
-        return KnownField::Cover;
-    case lWriter:
-        return KnownField::Lyricist;
-    case lLanguage:
-        return KnownField::Language;
-    case lLength:
-        return KnownField::Length;
-    case lEncoderSettings:
-        return KnownField::EncoderSettings;
-    case lUnsynchronizedLyrics:
-        return KnownField::Lyrics;
-    case lSynchronizedLyrics:
-        return KnownField::SynchronizedLyrics;
-    case lAlbumArtist:
-        return KnownField::AlbumArtist;
-    case lContentGroupDescription:
-        return KnownField::Grouping;
-    case lRecordLabel:
-        return KnownField::RecordLabel;
-    case sAlbum:
-        return KnownField::Album;
-    case sArtist:
-        return KnownField::Artist;
-    case sComment:
-        return KnownField::Comment;
-    case sYear:
-        return KnownField::RecordDate;
-    case sTitle:
-        return KnownField::Title;
-    case sGenre:
-        return KnownField::Genre;
-    case sTrackPosition:
-        return KnownField::TrackPosition;
-    case sEncoder:
-        return KnownField::Encoder;
-    case sBpm:
-        return KnownField::Bpm;
-    case sCover:
-        return KnownField::Cover;
-    case sWriter:
-        return KnownField::Lyricist;
-    case sLanguage:
-        return KnownField::Language;
-    case sLength:
-        return KnownField::Length;
-    case sEncoderSettings:
-        return KnownField::EncoderSettings;
-    case sUnsynchronizedLyrics:
-        return KnownField::Lyrics;
-    case sSynchronizedLyrics:
-        return KnownField::SynchronizedLyrics;
-    case sAlbumArtist:
-        return KnownField::Grouping;
-    case sRecordLabel:
-        return KnownField::RecordLabel;
-    default:
-        return KnownField::Invalid;
-    }
+    return knownFieldsByFrameId.find(id);
 }
 
 TagDataType Id3v2Tag::internallyGetProposedDataType(const std::uint32_t &id) const
@@ -420,14 +513,44 @@ void Id3v2Tag::convertOldRecordDateFields(const std::string &diagContext, Diagno
     }
 }
 
+/*!
+ * \brief Returns whether the frame with the specified \a id is included by the specified \a filter.
+ * \remarks The frames converted to KnownField::RecordDate by convertOldRecordDateFields() are included along with it.
+ */
+bool Id3v2Tag::isFrameIncluded(const TagFieldFilter &filter, std::uint32_t id) const
+{
+    using namespace Id3v2FrameIds;
+    switch (id) {
+    case lRecordingDates:
+    case lDate:
+    case lTime:
+    case sYear:
+    case sRecordingDates:
+    case sDate:
+    case sTime:
+        if (filter.includes(KnownField::RecordDate)) {
+            return true;
+        }
+        break;
+    default:;
+    }
+    return filter.includes(knownField(id), id);
+}
+
 /*!
  * \brief Parses tag information from the specified \a stream.
  *
+ * If \a flags contains ParsingFlags::ShareTagValueData the values refer to the buffer the data has been read into
+ * instead of copying it. If \a filter is specified frames it does not include are skipped without reading their data.
+ *
+ * If the unsynchronisation flag is set for a pre-ID3v2.4 tag the frames are read into a buffer at once and parsed from
+ * there after removing the unsynchronisation. ParsingFlags::LazyLoadPictures has no effect in this case.
+ *
  * \throws Throws std::ios_base::failure when an IO error occurs.
  * \throws Throws TagParser::Failure or a derived exception when a parsing
  *         error occurs.
  */
-void Id3v2Tag::parse(istream &stream, const std::uint64_t maximalSize, Diagnostics &diag)
+void Id3v2Tag::parse(istream &stream, const std::uint64_t maximalSize, Diagnostics &diag, ParsingFlags flags, const TagFieldFilter *filter)
 {
     // prepare parsing
     static const string context("parsing ID3v2 tag");
@@ -484,22 +607,61 @@ void Id3v2Tag::parse(istream &stream, const std::uint64_t maximalSize, Diagnosti
         diag.emplace_back(DiagLevel::Critical, "Frames are truncated.", context);
     }
 
+    // remove unsynchronisation of pre-ID3v2.4 tags (it applies to the whole tag, so frame sizes refer to the data without it)
+    // note: Since ID3v2.4 unsynchronisation is denoted and removed per frame (see Id3v2Frame::parse()).
+    auto framesEnd = startOffset + m_size;
+    auto resynchronisedFrames = std::unique_ptr<ResynchronisedFrames>();
+    if (majorVersion < 4 && isUnsynchronisationUsed()) {
+        resynchronisedFrames = std::make_unique<ResynchronisedFrames>(stream, bytesRemaining);
+        reader.setStream(&resynchronisedFrames->stream);
+        bytesRemaining = static_cast<std::uint32_t>(resynchronisedFrames->size);
+        framesEnd = resynchronisedFrames->size;
+        flags -= ParsingFlags::LazyLoadPictures;
+    }
+
+    // read the frames at once to parse them from memory (see maxBufferedSize)
+    // note: When loading pictures lazily, only the beginning of the tag is read at once because pictures (which are usually
+    //       located after the text frames) are not supposed to be read.
+    auto bufferedFrames = std::unique_ptr<BufferedFrames>();
+    if (!resynchronisedFrames && !isHeldInMemory(stream)) {
+        const auto maxSize = (flags & ParsingFlags::LazyLoadPictures) ? maxBufferedSizeWhenLoadingPicturesLazily : maxBufferedSize;
+        bufferedFrames = std::make_unique<BufferedFrames>(stream, static_cast<std::uint64_t>(stream.tellg()), min(bytesRemaining, maxSize));
+        reader.setStream(&bufferedFrames->stream);
+    }
+    auto &framesStream = *reader.stream();
+
     // read frames
-    auto pos = static_cast<std::uint64_t>(stream.tellg());
+    auto pos = static_cast<std::uint64_t>(framesStream.tellg());
     while (bytesRemaining) {
         // seek to next frame
-        stream.seekg(static_cast<streamoff>(pos));
+        framesStream.seekg(static_cast<streamoff>(pos));
+        // skip frame if not included by the filter (only the header is read)
+        if (filter && !filter->isEmpty()) {
+            const auto headerSize = majorVersion < 3 ? 6u : 10u;
+            if (bytesRemaining >= headerSize) {
+                const auto id = majorVersion < 3 ? reader.readUInt24BE() : reader.readUInt32BE();
+                const auto dataSize = majorVersion < 3 ? reader.readUInt24BE()
+                                                       : (majorVersion >= 4 ? reader.readSynchsafeUInt32BE() : reader.readUInt32BE());
+                const auto isPadding = !(id & (majorVersion < 3 ? 0xFFFF0000u : 0xFF000000u));
+                if (!isPadding && dataSize <= bytesRemaining - headerSize && !isFrameIncluded(*filter, id)) {
+                    pos += headerSize + dataSize;
+                    bytesRemaining -= headerSize + dataSize;
+                    continue;
+                }
+                framesStream.seekg(static_cast<streamoff>(pos));
+            }
+        }
         // parse frame
         Id3v2Frame frame;
         try {
-            frame.parse(reader, majorVersion, bytesRemaining, diag);
+            frame.parse(reader, majorVersion, bytesRemaining, diag, flags, bufferedFrames ? &stream : nullptr);
             if (Id3v2FrameIds::isTextFrame(frame.id()) && fields().count(frame.id()) == 1) {
                 diag.emplace_back(DiagLevel::Warning, "The text frame " % frame.idToString() + " exists more than once.", context);
             }
             fields().emplace(frame.id(), move(frame));
         } catch (const NoDataFoundException &) {
             if (frame.hasPaddingReached()) {
-                m_paddingSize = startOffset + m_size - pos;
+                m_paddingSize = framesEnd - pos;
                 break;
             }
         } catch (const Failure &) {
@@ -516,6 +678,7 @@ void Id3v2Tag::parse(istream &stream, const std::uint64_t maximalSize, Diagnosti
     }
 
     convertOldRecordDateFields(context, diag);
+    reader.setStream(&stream);
 
     // check for extended header
     if (!hasFooter()) {
@@ -543,6 +706,9 @@ void Id3v2Tag::parse(istream &stream, const std::uint64_t maximalSize, Diagnosti
  * \throws Throws TagParser::Failure or a derived exception when a making error occurs.
  *
  * This method might be useful when it is necessary to know the size of the tag before making it.
+ *
+ * The frames are prepared using multiple threads if configured via setMakingThreadCount(). The frames and diagnostic
+ * messages are in the same order as when preparing them sequentially.
  * \sa make()
  */
 Id3v2TagMaker Id3v2Tag::prepareMaking(Diagnostics &diag)
@@ -568,6 +734,9 @@ void Id3v2Tag::make(ostream &stream, std::uint32_t padding, Diagnostics &diag)
  */
 void Id3v2Tag::setVersion(std::uint8_t majorVersion, std::uint8_t revisionVersion)
 {
+    if (m_majorVersion != majorVersion || m_revisionVersion != revisionVersion) {
+        m_modified = true;
+    }
     m_majorVersion = majorVersion;
     m_revisionVersion = revisionVersion;
     m_version = argsToString('2', '.', majorVersion, '.', revisionVersion);
@@ -723,6 +892,7 @@ void Id3v2Tag::prepareRecordDataForMaking(const std::string &diagContext, Diagno
 Id3v2TagMaker::Id3v2TagMaker(Id3v2Tag &tag, Diagnostics &diag)
     : m_tag(tag)
     , m_framesSize(0)
+    , m_templateFields(nullptr)
 {
     static const string context("making ID3v2 tag");
 
@@ -735,13 +905,51 @@ Id3v2TagMaker::Id3v2TagMaker(Id3v2Tag &tag, Diagnostics &diag)
 
     tag.prepareRecordDataForMaking(context, diag);
 
+    // take the pre-made frames of the template; frames of the tag which are also present in the template are skipped
+    if (tag.tagTemplate()) {
+        m_templateFields = &tag.tagTemplate()->serializedFields(TagType::Id3v2Tag, tag.majorVersion(), diag);
+        for (const auto &field : *m_templateFields) {
+            m_framesSize += static_cast<std::uint32_t>(field.data.size());
+        }
+    }
+    const auto isOverriddenByTemplate = [this](std::uint32_t id) {
+        if (!m_templateFields) {
+            return false;
+        }
+        const auto comparer = FrameComparer();
+        const auto field = lower_bound(m_templateFields->cbegin(), m_templateFields->cend(), id,
+            [&comparer](const TagTemplateField &field, std::uint32_t id) { return comparer(field.id, id); });
+        return field != m_templateFields->cend() && !comparer(id, field->id);
+    };
+
     // prepare frames
     m_maker.reserve(tag.fields().size());
-    for (auto &pair : tag.fields()) {
-        try {
-            m_maker.emplace_back(pair.second.prepareMaking(tag.majorVersion(), diag));
-            m_framesSize += m_maker.back().requiredSize();
-        } catch (const Failure &) {
+    const auto threadCount = min<std::size_t>(
+        tag.makingThreadCount() ? tag.makingThreadCount() : max<std::size_t>(thread::hardware_concurrency(), 1), tag.fields().size());
+    if (threadCount > 1) {
+        auto frames = vector<Id3v2Frame *>();
+        frames.reserve(tag.fields().size());
+        for (auto &pair : tag.fields()) {
+            if (!isOverriddenByTemplate(pair.first)) {
+                frames.emplace_back(&pair.second);
+            }
+        }
+        for (auto &maker : prepareFramesInParallel(frames, tag.majorVersion(), threadCount, diag)) {
+            if (maker.has_value()) {
+                m_maker.emplace_back(std::move(*maker));
+                m_framesSize += m_maker.back().requiredSize();
+            }
+        }
+    } else {
+        for (auto &pair : tag.fields()) {
+            if (isOverriddenByTemplate(pair.first)) {
+                continue;
+            }
+            try {
+                m_maker.emplace_back(pair.second.prepareMaking(tag.majorVersion(), diag));
+                m_framesSize += m_maker.back().requiredSize();
+            } catch (const Failure &) {
+            }
         }
     }
 
@@ -761,28 +969,103 @@ void Id3v2TagMaker::make(std::ostream &stream, std::uint32_t padding, Diagnostic
 {
     CPP_UTILITIES_UNUSED(diag)
 
-    BinaryWriter writer(&stream);
+    // make the header and the frames in memory to write them at once
+    const auto buffer = make_unique<char[]>(m_requiredSize);
+    makeHeaderAndFrames(buffer.get(), m_tag.flags() & 0x2F, padding);
+    stream.write(buffer.get(), static_cast<streamsize>(m_requiredSize));
+
+    // write padding
+    static constexpr char zeroes[0x1000] = {};
+    for (; padding; padding -= min<std::uint32_t>(padding, sizeof(zeroes))) {
+        stream.write(zeroes, static_cast<streamsize>(min<std::uint32_t>(padding, sizeof(zeroes))));
+    }
+}
+
+/*!
+ * \brief Saves the tag (specified when constructing the object) to the specified \a buffer.
+ *
+ * This avoids the overhead of writing the many small parts of the tag to a stream. The caller can write the
+ * \a buffer at once afterwards.
+ *
+ * \remarks The \a buffer must hold at least requiredSize() plus \a padding bytes.
+ * \throws Throws Assumes the data is already validated and thus does NOT
+ *                throw TagParser::Failure or a derived exception.
+ */
+void Id3v2TagMaker::make(char *buffer, std::uint32_t padding, Diagnostics &diag)
+{
+    CPP_UTILITIES_UNUSED(diag)
+
+    fill_n(makeHeaderAndFrames(buffer, m_tag.flags() & 0x2F, padding), padding, '\0');
+}
 
+/*!
+ * \brief Saves the tag (specified when constructing the object) followed by a footer to the specified \a stream.
+ *
+ * The footer allows locating the tag from the end, so this is used to append the tag to a file. It is only supported
+ * by ID3v2.4 and writes 10 bytes more than requiredSize(). A tag with a footer must not contain padding.
+ *
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ * \throws Throws Assumes the data is already validated and thus does NOT
+ *                throw TagParser::Failure or a derived exception.
+ */
+void Id3v2TagMaker::makeWithFooter(std::ostream &stream, Diagnostics &diag)
+{
+    CPP_UTILITIES_UNUSED(diag)
+
+    const auto size = static_cast<std::size_t>(m_requiredSize) + 10;
+    const auto buffer = make_unique<char[]>(size);
+    const auto flags = static_cast<std::uint8_t>((m_tag.flags() & 0x2F) | 0x10);
+    auto *const footer = makeHeaderAndFrames(buffer.get(), flags, 0);
+
+    // write footer (same as the header but with reversed signature)
+    BE::getBytes24(0x334449u, footer);
+    footer[3] = static_cast<char>(m_tag.majorVersion());
+    footer[4] = static_cast<char>(m_tag.revisionVersion());
+    footer[5] = static_cast<char>(flags);
+    BE::getBytes(toSynchsafeInt(m_framesSize), footer + 6);
+    stream.write(buffer.get(), static_cast<streamsize>(size));
+}
+
+/*!
+ * \brief Writes the header with the specified \a flags and the frames to the specified \a buffer; the header denotes
+ *        the specified number of \a padding bytes but the padding itself is not written.
+ * \returns Returns a pointer to the end of the last frame.
+ */
+char *Id3v2TagMaker::makeHeaderAndFrames(char *buffer, std::uint8_t flags, std::uint32_t padding)
+{
     // write header
     // -> signature
-    writer.writeUInt24BE(0x494433u);
+    BE::getBytes24(0x494433u, buffer);
     // -> version
-    writer.writeByte(m_tag.majorVersion());
-    writer.writeByte(m_tag.revisionVersion());
+    buffer[3] = static_cast<char>(m_tag.majorVersion());
+    buffer[4] = static_cast<char>(m_tag.revisionVersion());
     // -> flags, but without extended header or compression bit set
-    writer.writeByte(m_tag.flags() & 0xBF);
+    // note: Unsynchronisation is only applied to ID3v2.4 frames having the corresponding flag (see Id3v2FrameMaker) so
+    //       the flag for the whole tag must not be set. The footer flag is only set by makeWithFooter().
+    buffer[5] = static_cast<char>(flags);
     // -> size (excluding header)
-    writer.writeSynchsafeUInt32BE(m_framesSize + padding);
+    BE::getBytes(toSynchsafeInt(m_framesSize + padding), buffer + 6);
+    buffer += 10;
 
-    // write frames
+    // write frames merging in the frames of the template (which are ordered in the same way)
+    if (!m_templateFields) {
+        for (auto &maker : m_maker) {
+            buffer = maker.make(buffer);
+        }
+        return buffer;
+    }
+    const auto comparer = FrameComparer();
+    auto templateField = m_templateFields->cbegin();
     for (auto &maker : m_maker) {
-        maker.make(writer);
+        for (; templateField != m_templateFields->cend() && comparer(templateField->id, maker.field().id()); ++templateField) {
+            buffer = copy(templateField->data.cbegin(), templateField->data.cend(), buffer);
+        }
+        buffer = maker.make(buffer);
     }
-
-    // write padding
-    for (; padding; --padding) {
-        stream.put(0);
+    for (; templateField != m_templateFields->cend(); ++templateField) {
+        buffer = copy(templateField->data.cbegin(), templateField->data.cend(), buffer);
     }
+    return buffer;
 }
 
 } // namespace TagParser
@@ -10,6 +10,8 @@
 namespace TagParser {
 
 class Id3v2Tag;
+class TagFieldFilter;
+struct TagTemplateField;
 
 struct TAG_PARSER_EXPORT FrameComparer {
     bool operator()(std::uint32_t lhs, std::uint32_t rhs) const;
@@ -20,16 +22,21 @@ class TAG_PARSER_EXPORT Id3v2TagMaker {
 
 public:
     void make(std::ostream &stream, std::uint32_t padding, Diagnostics &diag);
+    void make(char *buffer, std::uint32_t padding, Diagnostics &diag);
+    void makeWithFooter(std::ostream &stream, Diagnostics &diag);
     const Id3v2Tag &tag() const;
+    std::vector<Id3v2FrameMaker> &frameMakers();
     std::uint64_t requiredSize() const;
 
 private:
     Id3v2TagMaker(Id3v2Tag &tag, Diagnostics &diag);
+    char *makeHeaderAndFrames(char *buffer, std::uint8_t flags, std::uint32_t padding);
 
     Id3v2Tag &m_tag;
     std::uint32_t m_framesSize;
     std::uint32_t m_requiredSize;
     std::vector<Id3v2FrameMaker> m_maker;
+    const std::vector<TagTemplateField> *m_templateFields;
 };
 
 /*!
@@ -40,9 +47,17 @@ inline const Id3v2Tag &Id3v2TagMaker::tag() const
     return m_tag;
 }
 
+/*!
+ * \brief Returns the makers of the frames of the tag (excluding the frames of the tag's template).
+ */
+inline std::vector<Id3v2FrameMaker> &Id3v2TagMaker::frameMakers()
+{
+    return m_maker;
+}
+
 /*!
  * \brief Returns the number of bytes which will be written when making the tag.
- * \remarks Excludes padding!
+ * \remarks Excludes padding and the footer (see makeWithFooter())!
  */
 inline std::uint64_t Id3v2TagMaker::requiredSize() const
 {
@@ -56,6 +71,7 @@ template <> class TAG_PARSER_EXPORT FieldMapBasedTagTraits<Id3v2Tag> {
 public:
     using FieldType = Id3v2Frame;
     using Compare = FrameComparer;
+    using Storage = FlatMultiMap<typename FieldType::IdentifierType, FieldType, Compare>;
 };
 
 class TAG_PARSER_EXPORT Id3v2Tag final : public FieldMapBasedTag<Id3v2Tag> {
@@ -68,6 +84,10 @@ public:
     static constexpr TagType tagType = TagType::Id3v2Tag;
     static constexpr const char *tagName = "ID3v2 tag";
     static constexpr TagTextEncoding defaultTextEncoding = TagTextEncoding::Utf16LittleEndian;
+    /// \brief The number of bytes parse() reads at once to parse the frames from memory at most.
+    static constexpr std::uint32_t maxBufferedSize = 0x1000000;
+    /// \brief The number of bytes parse() reads at once at most if ParsingFlags::LazyLoadPictures is present.
+    static constexpr std::uint32_t maxBufferedSizeWhenLoadingPicturesLazily = 0x40000;
     TagTextEncoding proposedTextEncoding() const override;
     bool canEncodingBeUsed(TagTextEncoding encoding) const override;
     bool supportsDescription(KnownField field) const override;
@@ -75,7 +95,8 @@ public:
     bool supportsMultipleValues(KnownField field) const override;
     void ensureTextValuesAreProperlyEncoded() override;
 
-    void parse(std::istream &sourceStream, const std::uint64_t maximalSize, Diagnostics &diag);
+    void parse(std::istream &sourceStream, const std::uint64_t maximalSize, Diagnostics &diag, ParsingFlags flags = ParsingFlags::None,
+        const TagFieldFilter *filter = nullptr);
     Id3v2TagMaker prepareMaking(Diagnostics &diag);
     void make(std::ostream &targetStream, std::uint32_t padding, Diagnostics &diag);
 
@@ -90,6 +111,8 @@ public:
     bool hasFooter() const;
     std::uint32_t extendedHeaderSize() const;
     std::uint32_t paddingSize() const;
+    std::size_t makingThreadCount() const;
+    void setMakingThreadCount(std::size_t threadCount);
 
 protected:
     IdentifierType internallyGetFieldId(KnownField field) const;
@@ -99,6 +122,7 @@ protected:
     bool internallySetValues(const IdentifierType &id, const std::vector<TagValue> &values);
 
 private:
+    bool isFrameIncluded(const TagFieldFilter &filter, std::uint32_t id) const;
     void convertOldRecordDateFields(const std::string &diagContext, Diagnostics &diag);
     void removeOldRecordDateRelatedFields();
     void prepareRecordDataForMaking(const std::string &diagContext, Diagnostics &diag);
@@ -110,6 +134,7 @@ private:
     std::uint32_t m_sizeExcludingHeader;
     std::uint32_t m_extendedHeaderSize;
     std::uint32_t m_paddingSize;
+    std::size_t m_makingThreadCount;
 };
 
 /*!
@@ -122,6 +147,7 @@ inline Id3v2Tag::Id3v2Tag()
     , m_sizeExcludingHeader(0)
     , m_extendedHeaderSize(0)
     , m_paddingSize(0)
+    , m_makingThreadCount(1)
 {
 }
 
@@ -237,6 +263,25 @@ inline std::uint32_t Id3v2Tag::paddingSize() const
     return m_paddingSize;
 }
 
+/*!
+ * \brief Returns the number of threads used to prepare making the frames (see prepareMaking()).
+ *
+ * A value of zero means the number of hardware threads is used. The default is one, so frames are prepared sequentially.
+ */
+inline std::size_t Id3v2Tag::makingThreadCount() const
+{
+    return m_makingThreadCount;
+}
+
+/*!
+ * \brief Sets the number of threads used to prepare making the frames (see prepareMaking()).
+ * \sa makingThreadCount()
+ */
+inline void Id3v2Tag::setMakingThreadCount(std::size_t threadCount)
+{
+    m_makingThreadCount = threadCount;
+}
+
 } // namespace TagParser
 
 #endif // TAG_PARSER_ID3V2TAG_H
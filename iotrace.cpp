@@ -0,0 +1,215 @@
+#include "./iotrace.h"
+#include "./exceptions.h"
+
+#include <algorithm>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+namespace TagParser {
+
+/// \cond
+namespace {
+
+constexpr std::string_view operationNames[] = { "seek", "read", "write", "flush" };
+
+std::chrono::nanoseconds transferTime(const IoLatencyModel &model, std::uint64_t size)
+{
+    const auto bytesPerSecond = static_cast<double>(max<std::uint64_t>(model.bytesPerSecond, 1));
+    return std::chrono::nanoseconds(static_cast<std::int64_t>(static_cast<double>(size) * 1e9 / bytesPerSecond));
+}
+
+} // namespace
+/// \endcond
+
+/*!
+ * \brief Returns a model of a local SSD (NVMe or SATA).
+ */
+IoLatencyModel IoLatencyModel::localSsd()
+{
+    auto model = IoLatencyModel();
+    model.name = "ssd";
+    model.requestLatency = std::chrono::microseconds(10);
+    model.seekLatency = std::chrono::microseconds(80);
+    model.flushLatency = std::chrono::milliseconds(1);
+    model.bytesPerSecond = 2000000000;
+    model.blockSize = 0x20000;
+    return model;
+}
+
+/*!
+ * \brief Returns a model of a spinning hard disk.
+ */
+IoLatencyModel IoLatencyModel::hdd()
+{
+    auto model = IoLatencyModel();
+    model.name = "hdd";
+    model.requestLatency = std::chrono::microseconds(50);
+    model.seekLatency = std::chrono::milliseconds(8);
+    model.flushLatency = std::chrono::milliseconds(20);
+    model.bytesPerSecond = 150000000;
+    model.blockSize = 0x20000;
+    return model;
+}
+
+/*!
+ * \brief Returns a model of an object storage like S3 accessed via ranged GET requests.
+ * \remarks There is no such thing as a sequential request so the latency is entirely attributed to the request.
+ */
+IoLatencyModel IoLatencyModel::s3()
+{
+    auto model = IoLatencyModel();
+    model.name = "s3";
+    model.requestLatency = std::chrono::milliseconds(30);
+    model.flushLatency = std::chrono::milliseconds(50);
+    model.bytesPerSecond = 90000000;
+    model.blockSize = 0x100000;
+    return model;
+}
+
+/*!
+ * \class TagParser::IoTrace
+ * \brief The IoTrace class records the I/O operations done on a stream with timestamps.
+ *
+ * A trace is recorded by MediaFileInfo if I/O tracing is enabled (see MediaFileInfo::setIoTracingEnabled()) and stored
+ * within MediaFileStatistics::ioTrace. It can be saved via write() and loaded again via read(), e.g. to reproduce a slow
+ * parse which happened elsewhere. Replaying it against an IoLatencyModel via replay() gives an estimate of the time
+ * spent on I/O on different storage devices; this allows checking whether changes to the access pattern (e.g.
+ * coalescing reads) actually pay off.
+ *
+ * \remarks The operations are recorded at the stream layer, so small reads which std::filebuf serves from its buffer
+ *          show up as well. The latency model accounts for that via IoLatencyModel::blockSize.
+ */
+
+/*!
+ * \brief Constructs an empty trace.
+ */
+IoTrace::IoTrace()
+    : m_start(std::chrono::steady_clock::now())
+{
+}
+
+/*!
+ * \brief Records the specified \a operation at the specified \a offset; the time is set to now.
+ */
+void IoTrace::record(IoOperation operation, std::uint64_t offset, std::uint64_t size)
+{
+    const auto now = std::chrono::steady_clock::now();
+    if (m_events.empty()) {
+        m_start = now;
+    }
+    auto &event = m_events.emplace_back();
+    event.time = std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_start);
+    event.offset = offset;
+    event.size = size;
+    event.operation = operation;
+}
+
+/*!
+ * \brief Writes the trace to the specified \a stream.
+ *
+ * The trace is written as text with one event per line consisting of the time in nanoseconds, the operation, the
+ * offset and the size separated by spaces (e.g. "1234 read 4096 16"). Lines starting with "#" are comments.
+ */
+void IoTrace::write(std::ostream &stream) const
+{
+    stream << "# tagparser I/O trace: time (ns), operation, offset, size\n";
+    for (const auto &event : m_events) {
+        stream << event.time.count() << ' ' << operationNames[static_cast<std::size_t>(event.operation)] << ' ' << event.offset << ' '
+               << event.size << '\n';
+    }
+}
+
+/*!
+ * \brief Reads a trace written via write() from the specified \a stream.
+ * \throws Throws InvalidDataException if the stream contains a line which is not a valid event.
+ */
+IoTrace IoTrace::read(std::istream &stream)
+{
+    auto trace = IoTrace();
+    for (auto line = std::string(); getline(stream, line);) {
+        if (line.empty() || line.front() == '#') {
+            continue;
+        }
+        auto lineStream = istringstream(line);
+        auto time = std::int64_t();
+        auto operation = std::string();
+        auto &event = trace.m_events.emplace_back();
+        if (!(lineStream >> time >> operation >> event.offset >> event.size)) {
+            throw InvalidDataException();
+        }
+        const auto name = find(begin(operationNames), end(operationNames), operation);
+        if (name == end(operationNames)) {
+            throw InvalidDataException();
+        }
+        event.time = std::chrono::nanoseconds(time);
+        event.operation = static_cast<IoOperation>(name - begin(operationNames));
+    }
+    return trace;
+}
+
+/*!
+ * \brief Replays the trace against the specified \a model.
+ *
+ * Reads are rounded to blocks of IoLatencyModel::blockSize bytes. Reading from the blocks fetched last (e.g. multiple
+ * small reads of the same header) is free; otherwise the missing blocks are fetched with one request. Each request
+ * takes IoLatencyModel::requestLatency plus the transfer time; requests which do not continue the previous request
+ * take IoLatencyModel::seekLatency in addition. Seeking the stream alone costs nothing. The timestamps of the events
+ * are not taken into account (so time spent on computation is not part of the result).
+ */
+IoReplayResult IoTrace::replay(const IoLatencyModel &model) const
+{
+    auto result = IoReplayResult();
+    const auto blockSize = max<std::uint64_t>(model.blockSize, 1);
+    auto cacheBegin = std::uint64_t(), cacheEnd = std::uint64_t();
+    auto deviceOffset = numeric_limits<std::uint64_t>::max();
+    const auto request = [&](std::uint64_t offset, std::uint64_t size) {
+        ++result.requests;
+        result.time += model.requestLatency + transferTime(model, size);
+        if (offset != deviceOffset) {
+            ++result.seeks;
+            result.time += model.seekLatency;
+        }
+        deviceOffset = offset + size;
+    };
+    for (const auto &event : m_events) {
+        const auto eventEnd = event.offset + event.size;
+        switch (event.operation) {
+        case IoOperation::Seek:
+            break;
+        case IoOperation::Read: {
+            if (!event.size || (event.offset >= cacheBegin && eventEnd <= cacheEnd)) {
+                break;
+            }
+            const auto begin = event.offset / blockSize * blockSize;
+            const auto end = (eventEnd + blockSize - 1) / blockSize * blockSize;
+            // don't fetch the cached blocks again if the read only extends beyond them
+            const auto fetchBegin = begin >= cacheBegin && begin < cacheEnd ? cacheEnd : begin;
+            request(fetchBegin, end - fetchBegin);
+            result.bytesFetched += end - fetchBegin;
+            cacheBegin = begin;
+            cacheEnd = end;
+            break;
+        }
+        case IoOperation::Write:
+            request(event.offset, event.size);
+            result.bytesWritten += event.size;
+            if (event.offset < cacheEnd && eventEnd > cacheBegin) {
+                cacheBegin = cacheEnd = 0;
+            }
+            break;
+        case IoOperation::Flush:
+            ++result.requests;
+            result.time += model.flushLatency;
+            break;
+        }
+    }
+    return result;
+}
+
+} // namespace TagParser
@@ -0,0 +1,118 @@
+#ifndef TAG_PARSER_IOTRACE_H
+#define TAG_PARSER_IOTRACE_H
+
+#include "./global.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace TagParser {
+
+/*!
+ * \brief The IoOperation enum specifies the type of an IoTraceEvent.
+ */
+enum class IoOperation : std::uint8_t {
+    Seek, /**< the position of the stream has been changed (the offset is the new position) */
+    Read, /**< data has been read */
+    Write, /**< data has been written */
+    Flush, /**< the stream has been flushed */
+};
+
+/*!
+ * \brief The IoTraceEvent struct holds a single operation recorded within an IoTrace.
+ */
+struct TAG_PARSER_EXPORT IoTraceEvent {
+    /// \brief The time of the operation relative to the first operation of the trace.
+    std::chrono::nanoseconds time = std::chrono::nanoseconds::zero();
+    /// \brief The offset the operation starts at (or the new position for IoOperation::Seek).
+    std::uint64_t offset = 0;
+    /// \brief The number of bytes read or written; zero for IoOperation::Seek and IoOperation::Flush.
+    std::uint64_t size = 0;
+    /// \brief The type of the operation.
+    IoOperation operation = IoOperation::Seek;
+};
+
+/*!
+ * \brief The IoLatencyModel struct describes a storage device for replaying an IoTrace.
+ */
+struct TAG_PARSER_EXPORT IoLatencyModel {
+    static IoLatencyModel localSsd();
+    static IoLatencyModel hdd();
+    static IoLatencyModel s3();
+
+    /// \brief The name of the model.
+    const char *name = "custom";
+    /// \brief The latency of each request sent to the device.
+    std::chrono::nanoseconds requestLatency = std::chrono::nanoseconds::zero();
+    /// \brief The additional latency of a request which does not continue the previous one.
+    std::chrono::nanoseconds seekLatency = std::chrono::nanoseconds::zero();
+    /// \brief The latency of flushing.
+    std::chrono::nanoseconds flushLatency = std::chrono::nanoseconds::zero();
+    /// \brief The throughput of the device in bytes per second.
+    std::uint64_t bytesPerSecond = 100000000;
+    /// \brief The granularity of reads; reading from the block fetched last is free (like reading from a cache).
+    std::uint64_t blockSize = 0x1000;
+};
+
+/*!
+ * \brief The IoReplayResult struct holds the outcome of replaying an IoTrace via IoTrace::replay().
+ */
+struct TAG_PARSER_EXPORT IoReplayResult {
+    /// \brief The simulated time spent on I/O.
+    std::chrono::nanoseconds time = std::chrono::nanoseconds::zero();
+    /// \brief The number of requests sent to the device (reads not served from the last block, writes and flushes).
+    std::uint64_t requests = 0;
+    /// \brief The number of requests which did not continue the previous one.
+    std::uint64_t seeks = 0;
+    /// \brief The number of bytes read from the device (which is a multiple of the block size).
+    std::uint64_t bytesFetched = 0;
+    /// \brief The number of bytes written to the device.
+    std::uint64_t bytesWritten = 0;
+};
+
+class TAG_PARSER_EXPORT IoTrace {
+public:
+    IoTrace();
+
+    void record(IoOperation operation, std::uint64_t offset, std::uint64_t size = 0);
+    const std::vector<IoTraceEvent> &events() const;
+    bool isEmpty() const;
+    void clear();
+    void write(std::ostream &stream) const;
+    static IoTrace read(std::istream &stream);
+    IoReplayResult replay(const IoLatencyModel &model) const;
+
+private:
+    std::vector<IoTraceEvent> m_events;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+/*!
+ * \brief Returns the events in the order they have been recorded.
+ */
+inline const std::vector<IoTraceEvent> &IoTrace::events() const
+{
+    return m_events;
+}
+
+/*!
+ * \brief Returns whether no events have been recorded.
+ */
+inline bool IoTrace::isEmpty() const
+{
+    return m_events.empty();
+}
+
+/*!
+ * \brief Discards all events recorded so far.
+ */
+inline void IoTrace::clear()
+{
+    m_events.clear();
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_IOTRACE_H
@@ -2,13 +2,55 @@
 
 #include "../exceptions.h"
 
+#include <c++utilities/conversion/binaryconversion.h>
 #include <c++utilities/io/binaryreader.h>
 
+#include <algorithm>
+
 using namespace std;
 using namespace CppUtilities;
 
 namespace TagParser {
 
+/// \cond
+namespace {
+
+/*!
+ * \brief Returns whether the specified AV1 temporal unit contains a sequence header OBU.
+ * \remarks Encoders repeat the sequence header at each random access point so this is used to detect keyframes
+ *          without decoding the frame header (which would require the sequence header's values).
+ */
+bool containsAv1SequenceHeader(const char *data, std::size_t size)
+{
+    for (std::size_t i = 0; i < size;) {
+        const auto obuHeader = static_cast<std::uint8_t>(data[i]);
+        const auto obuType = (obuHeader >> 3) & 0x0F;
+        if (obuType == 1) {
+            return true;
+        }
+        if (!(obuHeader & 0x02)) {
+            return false; // OBU size not present so the next OBU can not be located
+        }
+        i += (obuHeader & 0x04) ? 2 : 1; // skip header and extension header
+        std::uint64_t obuSize = 0;
+        for (auto shift = 0u; i < size && shift < 56; shift += 7) {
+            const auto byte = static_cast<std::uint8_t>(data[i++]);
+            obuSize |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                break;
+            }
+        }
+        if (obuSize > size - i) {
+            return false;
+        }
+        i += static_cast<std::size_t>(obuSize);
+    }
+    return false;
+}
+
+} // namespace
+/// \endcond
+
 /*!
  * \class TagParser::IvfFrame
  * \brief The IvfFrame class is used to parse IVF frames.
@@ -21,9 +63,51 @@ namespace TagParser {
 void IvfFrame::parseHeader(CppUtilities::BinaryReader &reader, Diagnostics &diag)
 {
     CPP_UTILITIES_UNUSED(diag)
-    startOffset = static_cast<std::uint64_t>(reader.stream()->tellg());
-    size = reader.readUInt32BE();
-    timestamp = reader.readUInt64BE();
+    m_startOffset = static_cast<std::uint64_t>(reader.stream()->tellg());
+    m_size = reader.readUInt32LE();
+    m_timestamp = reader.readUInt64LE();
+}
+
+/*!
+ * \brief Parses the frame at the specified \a startOffset from the specified \a buffer.
+ *
+ * The \a buffer must contain at least the frame header. Whether the frame is a keyframe is determined from the
+ * start of the frame data if it is contained by the \a buffer as well:
+ * - VP8: The "key frame" bit of the frame tag is checked.
+ * - VP9: The "frame type" bit of the uncompressed header is checked.
+ * - AV1: The frame is considered a keyframe if the temporal unit contains a sequence header.
+ * For other formats frames are never considered keyframes.
+ */
+void IvfFrame::parse(const char *buffer, std::size_t bufferSize, std::uint64_t startOffset, GeneralMediaFormat format)
+{
+    m_startOffset = startOffset;
+    m_size = LE::toUInt32(buffer);
+    m_timestamp = LE::toUInt64(buffer + 4);
+    m_keyframe = false;
+
+    const auto *const data = buffer + headerSize;
+    const auto dataSize = std::min<std::size_t>(m_size, bufferSize - headerSize);
+    if (!dataSize) {
+        return;
+    }
+    const auto firstByte = static_cast<std::uint8_t>(*data);
+    switch (format) {
+    case GeneralMediaFormat::Vp8:
+        m_keyframe = !(firstByte & 0x01);
+        break;
+    case GeneralMediaFormat::Vp9:
+        if ((firstByte >> 6) == 0x02) { // frame marker
+            // skip profile bits (and reserved zero bit for profile 3), check show existing frame and frame type
+            const auto profile = ((firstByte >> 5) & 0x01) | ((firstByte >> 3) & 0x02);
+            const auto bits = profile == 3 ? (firstByte << 1) : firstByte;
+            m_keyframe = !(bits & 0x08) && !(bits & 0x04);
+        }
+        break;
+    case GeneralMediaFormat::Av1:
+        m_keyframe = containsAv1SequenceHeader(data, dataSize);
+        break;
+    default:;
+    }
 }
 
 } // namespace TagParser
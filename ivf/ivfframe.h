@@ -2,6 +2,7 @@
 #define TAG_PARSER_IVFRAME_H
 
 #include "../diagnostics.h"
+#include "../mediaformat.h"
 
 namespace CppUtilities {
 class BinaryReader;
@@ -13,21 +14,65 @@ class TAG_PARSER_EXPORT IvfFrame {
 public:
     constexpr IvfFrame();
     void parseHeader(CppUtilities::BinaryReader &reader, Diagnostics &diag);
+    void parse(const char *buffer, std::size_t bufferSize, std::uint64_t startOffset, GeneralMediaFormat format);
+
+    constexpr std::uint64_t startOffset() const;
+    constexpr std::uint64_t timestamp() const;
+    constexpr std::uint32_t size() const;
+    constexpr bool isKeyframe() const;
+
+    /// \brief The size of the frame header.
+    static constexpr std::size_t headerSize = 12;
 
 private:
-    std::uint64_t startOffset;
-    std::uint64_t timestamp;
-    std::uint32_t size;
+    std::uint64_t m_startOffset;
+    std::uint64_t m_timestamp;
+    std::uint32_t m_size;
+    bool m_keyframe;
 };
 
 /*!
  * \brief Constructs a new frame.
  */
 constexpr IvfFrame::IvfFrame()
-    : startOffset(0)
-    , timestamp(0)
-    , size(0)
+    : m_startOffset(0)
+    , m_timestamp(0)
+    , m_size(0)
+    , m_keyframe(false)
+{
+}
+
+/*!
+ * \brief Returns the offset of the frame header within the file.
+ */
+constexpr std::uint64_t IvfFrame::startOffset() const
+{
+    return m_startOffset;
+}
+
+/*!
+ * \brief Returns the presentation timestamp of the frame (in the time base of the stream).
+ */
+constexpr std::uint64_t IvfFrame::timestamp() const
+{
+    return m_timestamp;
+}
+
+/*!
+ * \brief Returns the size of the frame data (not including the frame header).
+ */
+constexpr std::uint32_t IvfFrame::size() const
+{
+    return m_size;
+}
+
+/*!
+ * \brief Returns whether the frame is a keyframe.
+ * \remarks Only determined by parse(); see there for details.
+ */
+constexpr bool IvfFrame::isKeyframe() const
 {
+    return m_keyframe;
 }
 
 } // namespace TagParser
@@ -7,6 +7,8 @@
 #include <c++utilities/conversion/stringbuilder.h>
 #include <c++utilities/conversion/stringconversion.h>
 
+#include <algorithm>
+#include <memory>
 #include <string>
 
 using namespace std;
@@ -16,7 +18,7 @@ namespace TagParser {
 
 /*!
  * \class TagParser::IvfStream
- * \brief Implementation of TagParser::AbstractTrack for ADTS streams.
+ * \brief Implementation of TagParser::AbstractTrack for IVF streams.
  * \sa https://wiki.multimedia.cx/index.php/IVF
  */
 
@@ -50,10 +52,104 @@ void IvfStream::internalParseHeader(Diagnostics &diag)
 
     // compute further values
     m_format = FourccIds::fourccToMediaFormat(formatId);
-    m_duration = TimeSpan::fromSeconds(static_cast<double>(m_sampleCount) / m_fps);
+    m_duration = TimeSpan::fromSeconds(framesToSeconds(m_sampleCount));
 
     // skip unused bytes
     m_istream->seekg(4, ios_base::cur);
+
+    // determine the actual frames if enabled
+    m_frames.clear();
+    m_frameIndexComplete = false;
+    if (m_frameIndexBudget) {
+        buildFrameIndex(diag);
+    }
+}
+
+/*!
+ * \brief Returns the duration of the specified \a frameCount in seconds.
+ * \remarks The header denotes the time base as rate (stored as fps) and scale (stored as time scale).
+ */
+double IvfStream::framesToSeconds(std::uint64_t frameCount) const
+{
+    return m_fps ? static_cast<double>(frameCount) * (m_timeScale ? m_timeScale : 1) / m_fps : 0.0;
+}
+
+/*!
+ * \brief Walks through the frame headers to determine the frames, the sample count, the duration and the bitrate.
+ *
+ * The stream is read in big chunks so usually many frame headers are read at once. It is only read again at the
+ * next frame header when frames exceed the buffer. The walk stops when frameIndexBudget() bytes have been
+ * read. Then the sample count is estimated from the average size of the frames seen so far unless the header
+ * denotes a higher frame count.
+ */
+void IvfStream::buildFrameIndex(Diagnostics &diag)
+{
+    static const string context("indexing IVF frames");
+    constexpr std::size_t bufferSize = 0x10000;
+    // the start of the frame data is buffered as well to determine keyframes
+    constexpr std::size_t requiredFrameDataSize = 64;
+
+    m_istream->seekg(0, ios_base::end);
+    const auto streamEnd = static_cast<std::uint64_t>(m_istream->tellg());
+    const auto firstFrameOffset = m_startOffset + std::max<std::uint16_t>(m_headerLength, 32);
+    auto buffer = make_unique<char[]>(bufferSize);
+    auto bufferOffset = std::uint64_t(), bufferFill = std::uint64_t(), bytesRead = std::uint64_t();
+    auto offset = firstFrameOffset, dataSize = std::uint64_t();
+    auto budgetExhausted = false;
+    while (offset + IvfFrame::headerSize <= streamEnd) {
+        // (re)fill buffer if the frame header (and the start of the frame data) is not buffered
+        const auto requiredSize = std::min<std::uint64_t>(IvfFrame::headerSize + requiredFrameDataSize, streamEnd - offset);
+        if (offset < bufferOffset || offset + requiredSize > bufferOffset + bufferFill) {
+            if (bytesRead >= m_frameIndexBudget) {
+                budgetExhausted = true;
+                break;
+            }
+            bufferOffset = offset;
+            bufferFill = std::min<std::uint64_t>(bufferSize, streamEnd - offset);
+            m_istream->seekg(static_cast<streamoff>(bufferOffset));
+            m_istream->read(buffer.get(), static_cast<streamsize>(bufferFill));
+            bytesRead += bufferFill;
+        }
+
+        // parse frame
+        const auto bufferIndex = static_cast<std::size_t>(offset - bufferOffset);
+        auto &frame = m_frames.emplace_back();
+        frame.parse(buffer.get() + bufferIndex, static_cast<std::size_t>(bufferFill) - bufferIndex, offset, m_format.general);
+        if (frame.size() > streamEnd - offset - IvfFrame::headerSize) {
+            diag.emplace_back(DiagLevel::Warning, argsToString("Frame at offset ", offset, " is truncated; it is ignored."), context);
+            m_frames.pop_back();
+            offset = streamEnd;
+            break;
+        }
+        dataSize += frame.size();
+        offset += IvfFrame::headerSize + frame.size();
+    }
+
+    // determine the sample count, estimate it if the end has not been reached
+    const auto frameCount = static_cast<std::uint64_t>(m_frames.size());
+    if (!(m_frameIndexComplete = !budgetExhausted)) {
+        const auto indexedSize = offset - firstFrameOffset;
+        const auto estimatedFrameCount = indexedSize
+            ? static_cast<std::uint64_t>(static_cast<double>(frameCount) * static_cast<double>(streamEnd - firstFrameOffset) / indexedSize)
+            : frameCount;
+        m_sampleCount = std::max(m_sampleCount, estimatedFrameCount);
+        diag.emplace_back(DiagLevel::Information,
+            argsToString("The frame index has been built for the first ", frameCount, " frames only because the read budget of ",
+                m_frameIndexBudget, " bytes is exhausted; the frame count is estimated."),
+            context);
+    } else {
+        if (m_sampleCount != frameCount) {
+            diag.emplace_back(DiagLevel::Warning,
+                argsToString("The header denotes ", m_sampleCount, " frames but the stream contains ", frameCount, " frames."), context);
+        }
+        m_sampleCount = frameCount;
+    }
+    m_duration = TimeSpan::fromSeconds(framesToSeconds(m_sampleCount));
+
+    // compute the average bitrate from the frames seen
+    if (const auto indexedDuration = framesToSeconds(frameCount); indexedDuration > 0.0) {
+        m_bitrate = static_cast<double>(dataSize) * 0.008 / indexedDuration;
+    }
 }
 
 void IvfStream::readFrame(Diagnostics &diag)
@@ -15,13 +15,22 @@ public:
     TrackType type() const override;
 
     void readFrame(Diagnostics &diag);
+    const std::vector<IvfFrame> &frames() const;
+    std::uint64_t frameIndexBudget() const;
+    void setFrameIndexBudget(std::uint64_t budget);
+    bool isFrameIndexComplete() const;
 
 protected:
     void internalParseHeader(Diagnostics &diag) override;
 
 private:
+    void buildFrameIndex(Diagnostics &diag);
+    double framesToSeconds(std::uint64_t frameCount) const;
+
     std::vector<IvfFrame> m_frames;
+    std::uint64_t m_frameIndexBudget;
     std::uint16_t m_headerLength;
+    bool m_frameIndexComplete;
 };
 
 /*!
@@ -29,6 +38,9 @@ private:
  */
 inline IvfStream::IvfStream(std::iostream &stream, std::uint64_t startOffset)
     : AbstractTrack(stream, startOffset)
+    , m_frameIndexBudget(0)
+    , m_headerLength(0)
+    , m_frameIndexComplete(false)
 {
     m_mediaType = MediaType::Video;
 }
@@ -42,6 +54,49 @@ inline TrackType IvfStream::type() const
     return TrackType::IvfStream;
 }
 
+/*!
+ * \brief Returns the frames read via readFrame() or indexed when parsing the header.
+ * \sa setFrameIndexBudget()
+ */
+inline const std::vector<IvfFrame> &IvfStream::frames() const
+{
+    return m_frames;
+}
+
+/*!
+ * \brief Returns the maximum number of bytes read to build the frame index when parsing the header.
+ * \sa setFrameIndexBudget()
+ */
+inline std::uint64_t IvfStream::frameIndexBudget() const
+{
+    return m_frameIndexBudget;
+}
+
+/*!
+ * \brief Sets the maximum number of bytes read to build the frame index when parsing the header.
+ *
+ * If non-zero, the frame headers are walked through when parsing the header so frames() returns all frames and the
+ * sample count, the duration and the average bitrate are determined from the actual frames instead of the frame
+ * count denoted in the header. If the budget is exhausted before reaching the end of the stream, the values are
+ * estimated (see isFrameIndexComplete()). Zero disables building the frame index which is the default.
+ *
+ * \remarks The setting is applied next time parsing. The current parsing results are not mutated.
+ */
+inline void IvfStream::setFrameIndexBudget(std::uint64_t budget)
+{
+    m_frameIndexBudget = budget;
+}
+
+/*!
+ * \brief Returns whether the frame index contains all frames of the stream.
+ * \remarks Returns false if no frame index has been built or the budget has been exhausted before reaching the
+ *          end of the stream. In the latter case the sample count, the duration and the bitrate are estimations.
+ */
+inline bool IvfStream::isFrameIndexComplete() const
+{
+    return m_frameIndexComplete;
+}
+
 } // namespace TagParser
 
 #endif // TAG_PARSER_IVFSTREAM_H
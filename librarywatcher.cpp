@@ -0,0 +1,319 @@
+#include "./librarywatcher.h"
+#include "./diagnostics.h"
+#include "./mediafileinfo.h"
+#include "./parseresultcache.h"
+
+#include <c++utilities/conversion/stringbuilder.h>
+
+#ifdef PLATFORM_LINUX
+#include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <ios>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+/*!
+ * \class TagParser::LibraryWatcher
+ * \brief The LibraryWatcher class keeps a ParseResultCache up to date by watching directories for changes.
+ *
+ * Instead of re-scanning a whole library periodically, the directories of the library are watched (recursively) and
+ * only the files which have actually been changed are parsed again:
+ * 1. Add the directories via watch() after the initial scan.
+ * 2. Call readChanges() when fileDescriptor() becomes readable (or periodically with a timeout).
+ * 3. Pass the changes to refresh() which removes the entries of removed files from the cache and parses the changed
+ *    files via the specified BatchParser storing the results in the cache.
+ *
+ * Files written by MediaFileInfo::applyChanges() within the same process are usually not parsed again: If the cache has
+ * been assigned via MediaFileInfo::setParseResultCache(), its entry is updated directly when applying changes and
+ * refresh() skips files whose entry is up to date.
+ *
+ * Currently only Linux is supported (via inotify); on other platforms isSupported() returns false and no changes are
+ * reported so the library needs to be re-scanned as before.
+ *
+ * \remarks
+ * - Directories created within a watched directory are watched automatically and the files already contained are
+ *   reported as changed.
+ * - Changes of files which are only modified without being closed (e.g. via memory-mapping) are not reported. Neither are
+ *   changes on network file systems made by other hosts.
+ * - The number of watches is limited by the kernel (see /proc/sys/fs/inotify/max_user_watches).
+ * - The class is not thread-safe. refresh() can be called while another thread reads changes though.
+ */
+
+/*!
+ * \brief Constructs a new watcher for updating the specified \a cache.
+ */
+LibraryWatcher::LibraryWatcher(ParseResultCache &cache)
+    : m_cache(cache)
+    , m_fileDescriptor(-1)
+{
+#ifdef PLATFORM_LINUX
+    m_fileDescriptor = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+/*!
+ * \brief Destroys the watcher removing all watches.
+ */
+LibraryWatcher::~LibraryWatcher()
+{
+#ifdef PLATFORM_LINUX
+    if (m_fileDescriptor >= 0) {
+        ::close(m_fileDescriptor);
+    }
+#endif
+}
+
+/*!
+ * \brief Returns whether watching directories is supported by the platform.
+ */
+bool LibraryWatcher::isSupported()
+{
+#ifdef PLATFORM_LINUX
+    return true;
+#else
+    return false;
+#endif
+}
+
+/*!
+ * \brief Watches the specified \a directory and its sub directories for changes.
+ * \returns Returns whether all directories could be watched. Problems are added to \a diag.
+ */
+bool LibraryWatcher::watch(const std::string &directory, Diagnostics &diag)
+{
+    static const string context("watching directories");
+    if (m_fileDescriptor < 0) {
+        diag.emplace_back(DiagLevel::Warning, "Watching directories for changes is not supported.", context);
+        return false;
+    }
+    return addWatches(directory, nullptr, &diag);
+}
+
+/*!
+ * \brief Removes all watches; changes which have not been read yet are discarded.
+ */
+void LibraryWatcher::unwatchAll()
+{
+#ifdef PLATFORM_LINUX
+    for (const auto &[watchDescriptor, directory] : m_directories) {
+        ::inotify_rm_watch(m_fileDescriptor, watchDescriptor);
+    }
+    m_directories.clear();
+    // discard remaining events
+    readChanges();
+#endif
+}
+
+/*!
+ * \brief Returns the changes which occurred since the last call.
+ * \param timeout Specifies the number of milliseconds to wait for changes; -1 means waiting until changes occur.
+ * \remarks
+ * - Paths are reported at most once (as changed or removed according to the last event concerning the path).
+ * - Sub directories created meanwhile are watched from now on.
+ * \throws Throws std::ios_base::failure when reading the events fails.
+ */
+LibraryChanges LibraryWatcher::readChanges(int timeout)
+{
+    auto changes = LibraryChanges();
+#ifdef PLATFORM_LINUX
+    if (m_fileDescriptor < 0) {
+        return changes;
+    }
+    auto pollInfo = pollfd{ m_fileDescriptor, POLLIN, 0 };
+    if (timeout && ::poll(&pollInfo, 1, timeout) <= 0) {
+        return changes;
+    }
+
+    // read all pending events, keep only the last state of each path
+    auto latestChange = unordered_map<string, bool>();
+    auto order = vector<string>();
+    const auto record = [&](std::string &&path, bool changed) {
+        if (auto [i, inserted] = latestChange.emplace(path, changed); !inserted) {
+            i->second = changed;
+        } else {
+            order.emplace_back(std::move(path));
+        }
+    };
+    alignas(inotify_event) char buffer[eventBufferSize];
+    for (;;) {
+        const auto bytesRead = ::read(m_fileDescriptor, buffer, sizeof(buffer));
+        if (bytesRead < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                break;
+            }
+            throw ios_base::failure(argsToString("Unable to read file system events: ", std::strerror(errno)));
+        }
+        for (auto *i = buffer, *end = buffer + bytesRead; i < end;) {
+            const auto &event = *reinterpret_cast<const inotify_event *>(i);
+            i += sizeof(inotify_event) + event.len;
+            if (event.mask & IN_Q_OVERFLOW) {
+                changes.overflowed = true;
+                continue;
+            }
+            const auto directory = m_directories.find(event.wd);
+            if (directory == m_directories.end()) {
+                continue;
+            }
+            if (event.mask & IN_IGNORED) {
+                // the directory has been removed (reported via the event of its parent)
+                m_directories.erase(directory);
+                continue;
+            }
+            if (!event.len) {
+                continue;
+            }
+            auto path = directory->second % '/' + event.name;
+            if (event.mask & (IN_DELETE | IN_MOVED_FROM)) {
+                if ((event.mask & IN_ISDIR) && (event.mask & IN_MOVED_FROM)) {
+                    // stop watching directories moved away (the watches would follow them)
+                    const auto prefix = path + "/";
+                    for (auto watched = m_directories.begin(); watched != m_directories.end();) {
+                        if (watched->second == path || watched->second.compare(0, prefix.size(), prefix) == 0) {
+                            ::inotify_rm_watch(m_fileDescriptor, watched->first);
+                            watched = m_directories.erase(watched);
+                        } else {
+                            ++watched;
+                        }
+                    }
+                }
+                record(std::move(path), false);
+            } else if (event.mask & IN_ISDIR) {
+                // watch new directories and report the files they already contain
+                auto files = vector<string>();
+                addWatches(path, &files, nullptr);
+                for (auto &file : files) {
+                    record(std::move(file), true);
+                }
+            } else if (event.mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                record(std::move(path), true);
+            }
+        }
+    }
+    for (auto &path : order) {
+        (latestChange[path] ? changes.changedPaths : changes.removedPaths).emplace_back(std::move(path));
+    }
+#else
+    CPP_UTILITIES_UNUSED(timeout);
+#endif
+    return changes;
+}
+
+/*!
+ * \brief Updates the cache according to the specified \a changes.
+ *
+ * The entries of removed files and of files within removed directories are removed. The changed files are parsed via
+ * the specified \a parser (using BatchParser::parse()) and the results are stored in the cache. Files whose entry is
+ * still up to date are skipped. The specified \a callback is invoked with the result of each parsed file.
+ *
+ * \returns Returns the number of files which have been parsed.
+ * \remarks LibraryChanges::overflowed is not considered; the caller is supposed to re-scan the library in this case.
+ */
+std::size_t LibraryWatcher::refresh(const LibraryChanges &changes, BatchParser &parser, const BatchParser::ResultCallback &callback)
+{
+    for (const auto &path : changes.removedPaths) {
+        if (!m_cache.remove(path)) {
+            m_cache.removeDirectory(path);
+        }
+    }
+
+    // skip files whose entry is up to date (e.g. written via MediaFileInfo::applyChanges())
+    auto paths = vector<string>();
+    auto identities = vector<FileIdentity>();
+    for (const auto &path : changes.changedPaths) {
+        try {
+            auto identity = m_cache.identify(path);
+            if (!m_cache.find(path, identity)) {
+                paths.emplace_back(path);
+                identities.emplace_back(identity);
+            }
+        } catch (const std::ios_base::failure &) {
+            // the file has been removed meanwhile
+            m_cache.remove(path);
+        }
+    }
+    if (paths.empty()) {
+        return 0;
+    }
+
+    // parse the files; the identity is determined upfront so a file modified while being parsed is parsed again next time
+    parser.parse(paths, [&](BatchParserResult &result) {
+        if (result.exception) {
+            m_cache.remove(result.path);
+        } else {
+            m_cache.store(result.path, identities[result.index], CachedParseResult::fromFileInfo(*result.fileInfo));
+        }
+        if (callback) {
+            callback(result);
+        }
+    });
+    return paths.size();
+}
+
+/*!
+ * \brief Watches the specified \a directory and its sub directories.
+ * \remarks The paths of the regular files found are appended to \a files if not nullptr. Problems are added to \a diag if
+ *          not nullptr.
+ */
+bool LibraryWatcher::addWatches(const std::string &directory, std::vector<std::string> *files, Diagnostics *diag)
+{
+#ifdef PLATFORM_LINUX
+    static const string context("watching directories");
+    constexpr auto mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_ONLYDIR | IN_EXCL_UNLINK;
+    const auto watchDescriptor = ::inotify_add_watch(m_fileDescriptor, directory.data(), mask);
+    if (watchDescriptor < 0) {
+        if (diag) {
+            diag->emplace_back(DiagLevel::Warning,
+                argsToString("Unable to watch \"", directory, "\": ", std::strerror(errno),
+                    errno == ENOSPC ? " (consider increasing /proc/sys/fs/inotify/max_user_watches)" : ""),
+                context);
+        }
+        return false;
+    }
+    m_directories[watchDescriptor] = directory;
+
+    // add the sub directories (after adding the watch so directories created meanwhile are not missed)
+    auto *const dir = ::opendir(directory.data());
+    if (!dir) {
+        return false;
+    }
+    auto success = true;
+    while (const auto *const entry = ::readdir(dir)) {
+        if (!std::strcmp(entry->d_name, ".") || !std::strcmp(entry->d_name, "..")) {
+            continue;
+        }
+        auto path = directory % '/' + entry->d_name;
+        auto type = entry->d_type;
+        if (type == DT_UNKNOWN) {
+            struct stat status;
+            type = ::lstat(path.data(), &status) ? DT_UNKNOWN : (S_ISDIR(status.st_mode) ? DT_DIR : (S_ISREG(status.st_mode) ? DT_REG : DT_UNKNOWN));
+        }
+        if (type == DT_DIR) {
+            success = addWatches(path, files, diag) && success;
+        } else if (type == DT_REG && files) {
+            files->emplace_back(std::move(path));
+        }
+    }
+    ::closedir(dir);
+    return success;
+#else
+    CPP_UTILITIES_UNUSED(directory);
+    CPP_UTILITIES_UNUSED(files);
+    CPP_UTILITIES_UNUSED(diag);
+    return false;
+#endif
+}
+
+} // namespace TagParser
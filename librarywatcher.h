@@ -0,0 +1,94 @@
+#ifndef TAG_PARSER_LIBRARYWATCHER_H
+#define TAG_PARSER_LIBRARYWATCHER_H
+
+#include "./batchparser.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace TagParser {
+
+class Diagnostics;
+class ParseResultCache;
+
+/*!
+ * \brief The LibraryChanges struct holds the changes within the directories watched via LibraryWatcher.
+ */
+struct TAG_PARSER_EXPORT LibraryChanges {
+    bool isEmpty() const;
+
+    /// \brief The paths of files which have been written, created or moved into a watched directory.
+    std::vector<std::string> changedPaths;
+    /// \brief The paths of files and directories which have been removed or moved out of a watched directory.
+    std::vector<std::string> removedPaths;
+    /// \brief Whether events have been lost because the kernel's event queue overflowed; a full re-scan is required then.
+    bool overflowed = false;
+};
+
+/*!
+ * \brief Returns whether there are no changes.
+ */
+inline bool LibraryChanges::isEmpty() const
+{
+    return changedPaths.empty() && removedPaths.empty() && !overflowed;
+}
+
+class TAG_PARSER_EXPORT LibraryWatcher {
+public:
+    explicit LibraryWatcher(ParseResultCache &cache);
+    LibraryWatcher(const LibraryWatcher &) = delete;
+    LibraryWatcher &operator=(const LibraryWatcher &) = delete;
+    ~LibraryWatcher();
+
+    static bool isSupported();
+    ParseResultCache &cache();
+    bool watch(const std::string &directory, Diagnostics &diag);
+    void unwatchAll();
+    std::size_t watchCount() const;
+    int fileDescriptor() const;
+    LibraryChanges readChanges(int timeout = 0);
+    std::size_t refresh(
+        const LibraryChanges &changes, BatchParser &parser, const BatchParser::ResultCallback &callback = BatchParser::ResultCallback());
+
+    /// \brief The size of the buffer the events are read into at once.
+    static constexpr std::size_t eventBufferSize = 0x10000;
+
+private:
+    bool addWatches(const std::string &directory, std::vector<std::string> *files, Diagnostics *diag);
+
+    ParseResultCache &m_cache;
+    int m_fileDescriptor;
+    std::unordered_map<int, std::string> m_directories;
+};
+
+/*!
+ * \brief Returns the cache which is kept up to date.
+ */
+inline ParseResultCache &LibraryWatcher::cache()
+{
+    return m_cache;
+}
+
+/*!
+ * \brief Returns the number of directories which are currently watched.
+ */
+inline std::size_t LibraryWatcher::watchCount() const
+{
+    return m_directories.size();
+}
+
+/*!
+ * \brief Returns the file descriptor events are read from; -1 if not supported.
+ * \remarks The file descriptor becomes readable when there are changes so it can be integrated into the event loop of
+ *          the application (e.g. via poll() or QSocketNotifier). Call readChanges() when it becomes readable.
+ */
+inline int LibraryWatcher::fileDescriptor() const
+{
+    return m_fileDescriptor;
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_LIBRARYWATCHER_H
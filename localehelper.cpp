@@ -1,48 +1,150 @@
 #include "./localehelper.h"
+#include "./perfecthashmap.h"
 
 #include <c++utilities/conversion/stringconversion.h>
 
-#include <unordered_map>
+#include <array>
+#include <limits>
+#include <string_view>
 
 using namespace std::literals;
 
 namespace TagParser {
 
 /// \cond
-static const auto &languageMapping()
-{
+namespace {
+
 #include "resources/languages.h"
-    return languages;
+
+constexpr auto languageCount = sizeof(languages) / sizeof(*languages);
+
+constexpr auto makeLanguageCodesAndIndices()
+{
+    auto entries = std::array<std::pair<std::string_view, std::size_t>, languageCount>();
+    for (auto index = std::size_t(); index != languageCount; ++index) {
+        entries[index].first = languages[index].first;
+        entries[index].second = index;
+    }
+    return entries;
+}
+
+constexpr auto languageIndicesByCode = makeDisplacedPerfectHashMap(makeLanguageCodesAndIndices(), std::numeric_limits<std::size_t>::max());
+static_assert(languageIndicesByCode.isPerfect(), "language codes must be unique");
+static_assert(languageCount < LocaleId::invalidIndex, "language indices must fit into LocaleId");
+
+/*!
+ * \brief Maps each index of the language table to the index of the canonical entry of the language.
+ * \remarks The ISO-639-2/T code directly follows the ISO-639-2/B code of the same language (see CMakeLists.txt) so both
+ *          codes are mapped to the ID of the ISO-639-2/B entry.
+ */
+constexpr auto makeCanonicalLanguageIndices()
+{
+    auto indices = std::array<std::uint16_t, languageCount>();
+    for (auto index = std::size_t(); index != languageCount; ++index) {
+        const auto isTerminologicalCode = index && languages[index].second == languages[index - 1].second;
+        indices[index] = static_cast<std::uint16_t>(isTerminologicalCode ? indices[index - 1] : index);
+    }
+    return indices;
+}
+
+constexpr auto canonicalLanguageIndices = makeCanonicalLanguageIndices();
+
+/*!
+ * \brief Returns the language names as std::string objects (created once on first use).
+ */
+const std::array<std::string, languageCount> &languageNames()
+{
+    static const auto names = [] {
+        auto names = std::array<std::string, languageCount>();
+        for (auto index = std::size_t(); index != languageCount; ++index) {
+            names[index] = languages[index].second;
+        }
+        return names;
+    }();
+    return names;
 }
+
+/*!
+ * \brief Returns the language name for the specified \a isoCode or nullptr if \a isoCode is unknown.
+ * \remarks The lookup itself is done via the table built at compile-time. The names are only turned into std::string
+ *          objects (once, on first use) because references to them are returned by the public functions.
+ */
+const std::string *languageName(std::string_view isoCode)
+{
+    const auto index = languageIndicesByCode.find(isoCode);
+    return index < languageCount ? &languageNames()[index] : nullptr;
+}
+
+} // namespace
 /// \endcond
 
 /*!
- * \brief Returns the language name for the specified ISO-639-2 code (bibliographic, 639-2/B).
+ * \brief Returns the language name for the specified ISO-639-2 code (bibliographic, 639-2/B, or terminologic, 639-2/T).
  * \remarks If \a isoCode is unknown an empty string is returned.
  */
 const std::string &languageNameFromIso(const std::string &isoCode)
 {
-    const auto &mapping = languageMapping();
-    const auto i = mapping.find(isoCode);
-    if (i == mapping.cend()) {
-        static const std::string empty;
-        return empty;
+    if (const auto *const name = languageName(isoCode)) {
+        return *name;
     }
-    return i->second;
+    static const std::string empty;
+    return empty;
 }
 
 /*!
- * \brief Returns the language name for the specified ISO-639-2 code (bibliographic, 639-2/B).
+ * \brief Returns the language name for the specified ISO-639-2 code (bibliographic, 639-2/B, or terminologic, 639-2/T).
  * \remarks If \a isoCode is unknown the \a isoCode itself is returned.
  */
 const std::string &languageNameFromIsoWithFallback(const std::string &isoCode)
 {
-    const auto &mapping = languageMapping();
-    const auto i = mapping.find(isoCode);
-    if (i == mapping.cend()) {
-        return isoCode;
-    }
-    return i->second;
+    const auto *const name = languageName(isoCode);
+    return name ? *name : isoCode;
+}
+
+/*!
+ * \class TagParser::LocaleId
+ *
+ * Locales are stored as strings in the various formats used by the tag and container formats. To compare languages
+ * across many files (e.g. to compute the available languages of a whole library), the LocaleId of a Locale can be
+ * determined via Locale::id() instead. It is just the 16-bit index into the language table which is built at
+ * compile-time so it can be put into sets and used as array index without any allocations. The ISO-639-2/B and
+ * ISO-639-2/T codes of a language are mapped to the same ID. Convert it back into a string via isoCode() and name()
+ * only when needed for display.
+ */
+
+/*!
+ * \brief Returns the ID for the specified ISO-639-2 code (bibliographic, 639-2/B, or terminologic, 639-2/T).
+ * \remarks Returns an invalid ID if \a isoCode is unknown.
+ */
+LocaleId LocaleId::fromIsoCode(std::string_view isoCode)
+{
+    const auto index = languageIndicesByCode.find(isoCode);
+    return index < languageCount ? LocaleId(canonicalLanguageIndices[index]) : LocaleId();
+}
+
+/*!
+ * \brief Returns the number of entries within the language table; valid IDs are less than this number.
+ * \remarks Useful to allocate an array with an element for each language, e.g. to count the files per language.
+ */
+std::size_t LocaleId::count()
+{
+    return languageCount;
+}
+
+/*!
+ * \brief Returns the ISO-639-2/B code of the language or an empty string if the ID is not valid.
+ */
+std::string_view LocaleId::isoCode() const
+{
+    return index < languageCount ? languages[index].first : std::string_view();
+}
+
+/*!
+ * \brief Returns the name of the language or an empty string if the ID is not valid.
+ */
+const std::string &LocaleId::name() const
+{
+    return index < languageCount ? languageNames()[index] : LocaleDetail::getEmpty();
 }
 
 /*!
@@ -108,7 +210,7 @@ const LocaleDetail &Locale::someAbbreviatedName(LocaleFormat preferredFormat) co
 /*!
  * \brief Returns the full name of the locale, e.g. Germany for the ISO code "ger" or an empty string if the
  *        full name is not known.
- * \remarks So far the full name is only known for ISO-639-2/B codes.
+ * \remarks So far the full name is only known for ISO-639-2 codes (639-2/B and 639-2/T).
  */
 const std::string &TagParser::Locale::fullName() const
 {
@@ -132,6 +234,22 @@ const std::string &Locale::fullOrSomeAbbreviatedName() const
     return someAbbreviatedName();
 }
 
+/*!
+ * \brief Returns the ID of the language specified via ISO-639-2 code or an invalid ID if there is no known ISO-639-2 code.
+ * \remarks The lookup is done via the table built at compile-time and does not allocate.
+ */
+LocaleId Locale::id() const
+{
+    for (const auto &detail : *this) {
+        if (detail.format == LocaleFormat::ISO_639_2_B || detail.format == LocaleFormat::ISO_639_2_T) {
+            if (const auto id = LocaleId::fromIsoCode(detail); id.isValid()) {
+                return id;
+            }
+        }
+    }
+    return LocaleId();
+}
+
 /*!
  * \brief Returns all details as comma-separated string.
  */
@@ -140,4 +258,25 @@ std::string Locale::toString() const
     return CppUtilities::joinStrings<std::vector<LocaleDetail>, std::string>(*this, LocaleDetail(", "sv, LocaleFormat::Unknown), true);
 }
 
+/*!
+ * \brief Returns all details as comma-separated string like toString().
+ * \remarks If there is not more than one non-empty detail (the usual case) the returned view refers to that detail
+ *          and \a buffer is not touched. Otherwise the details are joined into \a buffer and the view refers to it.
+ */
+std::string_view Locale::toStringView(std::string &buffer) const
+{
+    const LocaleDetail *nonEmptyDetail = nullptr;
+    for (const auto &detail : *this) {
+        if (detail.empty()) {
+            continue;
+        }
+        if (nonEmptyDetail) {
+            buffer = toString();
+            return buffer;
+        }
+        nonEmptyDetail = &detail;
+    }
+    return nonEmptyDetail ? std::string_view(*nonEmptyDetail) : std::string_view();
+}
+
 } // namespace TagParser
@@ -4,8 +4,10 @@
 #include "./global.h"
 
 #include <cstdint>
+#include <limits>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -69,10 +71,72 @@ inline LocaleDetail::LocaleDetail(std::string &&value, LocaleFormat format)
 {
 }
 
+/// \brief The LocaleId struct identifies a language compactly via its index within the table of ISO-639-2 languages.
+struct TAG_PARSER_EXPORT LocaleId {
+    /// \brief The index used if the language is not known.
+    static constexpr std::uint16_t invalidIndex = std::numeric_limits<std::uint16_t>::max();
+
+    constexpr explicit LocaleId() = default;
+    constexpr explicit LocaleId(std::uint16_t index);
+    static LocaleId fromIsoCode(std::string_view isoCode);
+    static std::size_t count();
+    constexpr bool isValid() const;
+    std::string_view isoCode() const;
+    const std::string &name() const;
+    constexpr bool operator==(LocaleId other) const;
+    constexpr bool operator!=(LocaleId other) const;
+    constexpr bool operator<(LocaleId other) const;
+
+    /// \brief The index within the language table (less than count()) or invalidIndex.
+    std::uint16_t index = invalidIndex;
+};
+
+/*!
+ * \brief Constructs a new LocaleId for the specified \a index.
+ * \remarks Use fromIsoCode() to obtain the ID of a language.
+ */
+constexpr LocaleId::LocaleId(std::uint16_t index)
+    : index(index)
+{
+}
+
+/*!
+ * \brief Returns whether the ID refers to a known language.
+ */
+constexpr bool LocaleId::isValid() const
+{
+    return index != invalidIndex;
+}
+
+/*!
+ * \brief Returns whether the ID refers to the same language as \a other.
+ */
+constexpr bool LocaleId::operator==(LocaleId other) const
+{
+    return index == other.index;
+}
+
+/*!
+ * \brief Returns whether the ID refers to another language than \a other.
+ */
+constexpr bool LocaleId::operator!=(LocaleId other) const
+{
+    return index != other.index;
+}
+
+/*!
+ * \brief Orders IDs by their index so they can be kept in sorted vectors.
+ */
+constexpr bool LocaleId::operator<(LocaleId other) const
+{
+    return index < other.index;
+}
+
 /// \brief The Locale struct specifies a language and/or a country using one or more LocaleDetail objects.
 struct TAG_PARSER_EXPORT Locale : public std::vector<LocaleDetail> {
     explicit Locale() = default;
     explicit Locale(std::initializer_list<LocaleDetail> details);
+    explicit Locale(LocaleId id);
     explicit Locale(std::string &&value, LocaleFormat format);
     explicit Locale(std::string_view value, LocaleFormat format);
     const LocaleDetail &abbreviatedName(LocaleFormat format) const;
@@ -81,7 +145,9 @@ struct TAG_PARSER_EXPORT Locale : public std::vector<LocaleDetail> {
     const LocaleDetail &someAbbreviatedName(LocaleFormat preferredFormat = LocaleFormat::BCP_47) const;
     const std::string &fullName() const;
     const std::string &fullOrSomeAbbreviatedName() const;
+    LocaleId id() const;
     std::string toString() const;
+    std::string_view toStringView(std::string &buffer) const;
 };
 
 /*!
@@ -105,6 +171,18 @@ inline Locale::Locale(std::initializer_list<LocaleDetail> details)
 {
 }
 
+/*!
+ * \brief Constructs a new locale for the language with the specified \a id using its ISO-639-2/B code.
+ * \remarks The locale is empty if \a id is not valid.
+ */
+inline Locale::Locale(LocaleId id)
+    : std::vector<LocaleDetail>()
+{
+    if (id.isValid()) {
+        emplace_back(id.isoCode(), LocaleFormat::ISO_639_2_B);
+    }
+}
+
 /*!
  * \brief Constructs a new locale with the specified \a value and \a format.
  */
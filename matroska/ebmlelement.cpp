@@ -10,8 +10,11 @@
 #include <c++utilities/io/binaryreader.h>
 #include <c++utilities/io/binarywriter.h>
 
+#include <zlib.h>
+
+#include <algorithm>
 #include <cstdint>
-#include <cstring>
+#include <limits>
 #include <memory>
 #include <sstream>
 #include <string>
@@ -21,6 +24,70 @@ using namespace CppUtilities;
 
 namespace TagParser {
 
+/// \cond
+namespace {
+
+/*!
+ * \brief Returns the length of the EBML variable-size integer starting with \a firstByte.
+ * \remarks Returns 9 if \a firstByte is zero (which no supported length denotes).
+ */
+inline std::uint8_t vintLength(std::uint8_t firstByte)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return firstByte ? static_cast<std::uint8_t>(__builtin_clz(firstByte) - (sizeof(unsigned int) * 8 - 9)) : 9;
+#else
+    std::uint8_t length = 1;
+    for (std::uint8_t mask = 0x80; length <= 8 && !(firstByte & mask); ++length, mask >>= 1)
+        ;
+    return length;
+#endif
+}
+
+/*!
+ * \brief Returns the big-endian number composed of the first \a length bytes of \a data.
+ */
+inline std::uint64_t readVintBytes(const char *data, std::uint8_t length)
+{
+    std::uint64_t value = 0;
+    for (const auto *const end = data + length; data != end; ++data) {
+        value = (value << 8) | static_cast<std::uint8_t>(*data);
+    }
+    return value;
+}
+
+/*!
+ * \brief Returns the offset of the first position within [0, \a searchEnd) of \a data where the ID of a top-level or
+ *        level 1 Matroska element starts or \a searchEnd if there is none.
+ * \remarks All those IDs are 4 bytes long and start with 0x1?; so only positions with such a byte are compared. The
+ *          \a data must provide 3 bytes beyond \a searchEnd.
+ */
+std::size_t findLevel1Id(const char *data, std::size_t searchEnd)
+{
+    for (std::size_t i = 0; i != searchEnd; ++i) {
+        if ((static_cast<std::uint8_t>(data[i]) & 0xF0) != 0x10) {
+            continue;
+        }
+        switch (BE::toUInt32(data + i)) {
+        case EbmlIds::Header:
+        case MatroskaIds::Segment:
+        case MatroskaIds::SegmentInfo:
+        case MatroskaIds::Tracks:
+        case MatroskaIds::Cues:
+        case MatroskaIds::Tags:
+        case MatroskaIds::SeekHead:
+        case MatroskaIds::Cluster:
+        case MatroskaIds::Attachments:
+        case MatroskaIds::Chapters:
+            return i;
+        default:;
+        }
+    }
+    return searchEnd;
+}
+
+} // namespace
+/// \endcond
+
 /*!
  * \class TagParser::EbmlElement
  * \brief The EbmlElement class helps to parse EBML files such as Matroska files.
@@ -28,8 +95,9 @@ namespace TagParser {
 
 /*!
  * \brief Specifies the number of bytes to be skipped till a valid EBML element is found in the stream.
+ * \remarks This is a global setting. It is atomic so it might be changed while other threads are parsing.
  */
-std::uint64_t EbmlElement::bytesToBeSkipped = 0x4000;
+std::atomic<std::uint64_t> EbmlElement::bytesToBeSkipped(0x4000);
 
 /*!
  * \brief Constructs a new top level element with the specified \a container at the specified \a startOffset.
@@ -68,24 +136,69 @@ string EbmlElement::parsingContext() const
  */
 void EbmlElement::internalParse(Diagnostics &diag)
 {
-    static const string context("parsing EBML element header");
+    throwOnParsingError(internalTryParse(diag));
+}
 
-    for (std::uint64_t skipped = 0; skipped < bytesToBeSkipped; ++m_startOffset, --m_maxSize, ++skipped) {
+/*!
+ * \brief Parses the EBML element returning parsing errors instead of throwing (see GenericFileElement::tryParse()).
+ */
+ParsingError EbmlElement::internalTryParse(Diagnostics &diag)
+{
+    static const string context("parsing EBML element header");
+    container().countParsedElement();
+
+    const auto maxBytesToBeSkipped = bytesToBeSkipped.load(std::memory_order_relaxed);
+    for (std::uint64_t skipped = 0; skipped < maxBytesToBeSkipped; ++m_startOffset, --m_maxSize, ++skipped) {
+        // jump to the next plausible level 1 element after a failed attempt to parse a top-level or level 1 element
+        // instead of trying every single byte (which would take a seek per byte when the file is not memory-mapped)
+        if (skipped && (!m_parent || m_parent->id() == MatroskaIds::Segment)) {
+            const auto distance = resyncDistance(min(maxBytesToBeSkipped - skipped, maxTotalSize()));
+            m_startOffset += distance;
+            m_maxSize -= distance;
+            if ((skipped += distance) >= maxBytesToBeSkipped) {
+                break;
+            }
+        }
         // check whether max size is valid
         if (maxTotalSize() < 2) {
             diag.emplace_back(DiagLevel::Critical, argsToString("The EBML element at ", startOffset(), " is truncated or does not exist."), context);
-            throw TruncatedDataException();
+            return ParsingError::TruncatedData;
+        }
+        // read the header directly from the memory-mapped file if possible; prefetch a window big enough for the longest
+        // supported header otherwise so ID and size are decoded from memory without further stream operations
+        // note: The mapping covers the whole file so the stream is not used at all when the file is mapped. This allows parsing
+        //       independent element trees concurrently (see MediaFileInfo::matroskaSegmentParsingThreadCount()).
+        char window[maximumIdLengthSupported() + maximumSizeLengthSupported()] = { 0 };
+        const auto mapping = container().mappedData();
+        const char *header = nullptr;
+        auto availableBytes = static_cast<std::uint64_t>(sizeof(window));
+        if (!mapping.empty()) {
+            availableBytes = startOffset() < mapping.size() ? min<std::uint64_t>(availableBytes, mapping.size() - startOffset()) : 0;
+            header = mapping.data() + min<std::uint64_t>(startOffset(), mapping.size());
+            if (availableBytes < 2) {
+                diag.emplace_back(
+                    DiagLevel::Critical, argsToString("The EBML element at ", startOffset(), " is truncated or does not exist."), context);
+                return ParsingError::TruncatedData;
+            }
+        } else if (const auto bytesNeeded = min<std::uint64_t>(sizeof(window), maxTotalSize());
+                   const char *const bufferedHeader = dataInMemory(startOffset(), bytesNeeded)) {
+            // read the header from the buffered master element (see EbmlMasterBuffer)
+            availableBytes = bytesNeeded;
+            header = bufferedHeader;
+        } else {
+            stream().seekg(static_cast<streamoff>(startOffset()));
+            availableBytes = static_cast<std::uint64_t>(
+                max<streamsize>(stream().rdbuf()->sgetn(window, static_cast<streamsize>(min<std::uint64_t>(sizeof(window), maxTotalSize()))), 0));
+            header = window;
+            if (availableBytes < 2) {
+                diag.emplace_back(
+                    DiagLevel::Critical, argsToString("The EBML element at ", startOffset(), " is truncated or does not exist."), context);
+                return ParsingError::TruncatedData;
+            }
         }
-        stream().seekg(static_cast<streamoff>(startOffset()));
 
         // read ID
-        char buf[maximumIdLengthSupported() > maximumSizeLengthSupported() ? maximumIdLengthSupported() : maximumSizeLengthSupported()] = { 0 };
-        std::uint8_t beg = static_cast<std::uint8_t>(stream().peek()), mask = 0x80;
-        m_idLength = 1;
-        while (m_idLength <= maximumIdLengthSupported() && (beg & mask) == 0) {
-            ++m_idLength;
-            mask >>= 1;
-        }
+        m_idLength = vintLength(static_cast<std::uint8_t>(header[0]));
         if (m_idLength > maximumIdLengthSupported()) {
             if (!skipped) {
                 diag.emplace_back(
@@ -99,8 +212,7 @@ void EbmlElement::internalParse(Diagnostics &diag)
             }
             continue; // try again
         }
-        reader().read(buf + (maximumIdLengthSupported() - m_idLength), m_idLength);
-        m_id = BE::toUInt32(buf);
+        m_id = static_cast<IdentifierType>(readVintBytes(header, m_idLength));
 
         // check whether this element is actually a sibling of one of its parents rather then a child
         // (might be the case if the parent's size is unknown and hence assumed to be the max file size)
@@ -143,18 +255,14 @@ void EbmlElement::internalParse(Diagnostics &diag)
         }
 
         // read size
-        beg = static_cast<std::uint8_t>(stream().peek());
-        mask = 0x80;
+        const auto sizeBegin = static_cast<std::uint8_t>(header[m_idLength]);
         m_sizeLength = 1;
-        if ((m_sizeUnknown = (beg == 0xFF))) {
+        if ((m_sizeUnknown = (sizeBegin == 0xFF))) {
             // this indicates that the element size is unknown
             // -> just assume the element takes the maximum available size
             m_dataSize = maxTotalSize() - headerSize();
         } else {
-            while (m_sizeLength <= maximumSizeLengthSupported() && (beg & mask) == 0) {
-                ++m_sizeLength;
-                mask >>= 1;
-            }
+            m_sizeLength = vintLength(sizeBegin);
             if (m_sizeLength > maximumSizeLengthSupported()) {
                 if (!skipped) {
                     diag.emplace_back(DiagLevel::Critical, "EBML size length is not supported.", parsingContext());
@@ -167,12 +275,12 @@ void EbmlElement::internalParse(Diagnostics &diag)
                 }
                 continue; // try again
             }
-            // read size into buffer
-            memset(buf, 0, sizeof(DataSizeType)); // reset buffer
-            reader().read(buf + (maximumSizeLengthSupported() - m_sizeLength), m_sizeLength);
-            // xor the first byte in buffer which has been read from the file with mask
-            *(buf + (maximumSizeLengthSupported() - m_sizeLength)) ^= mask;
-            m_dataSize = BE::toUInt64(buf);
+            if (m_idLength + m_sizeLength > availableBytes) {
+                diag.emplace_back(DiagLevel::Critical, "EBML header seems to be truncated.", parsingContext());
+                return ParsingError::TruncatedData;
+            }
+            // decode size, clearing the bit which denotes the length
+            m_dataSize = readVintBytes(header + m_idLength, m_sizeLength) & ((static_cast<std::uint64_t>(1) << (7 * m_sizeLength)) - 1);
             // check if element is truncated
             if (totalSize() > maxTotalSize()) {
                 if (m_idLength + m_sizeLength > maxTotalSize()) { // header truncated
@@ -188,10 +296,17 @@ void EbmlElement::internalParse(Diagnostics &diag)
             }
         }
 
+        // determine the end of a cluster of unknown size by scanning for the next level 1 element so the blocks don't
+        // need to be parsed one by one to find the siblings of the cluster (all clusters of live-recorded files lack a size)
+        // note: The elements checked by isPlausibleLevel1ElementAt() have no parent so the scan isn't done recursively.
+        if (m_sizeUnknown && m_id == MatroskaIds::Cluster && m_parent && m_parent->id() == MatroskaIds::Segment) {
+            determineUnknownClusterSize();
+        }
+
         // check if there's a first child
         const std::uint64_t firstChildOffset = this->firstChildOffset();
         if (firstChildOffset && firstChildOffset < totalSize()) {
-            m_firstChild.reset(new EbmlElement(static_cast<EbmlElement &>(*this), startOffset() + firstChildOffset));
+            m_firstChild.reset(new (container().elementArena()) EbmlElement(static_cast<EbmlElement &>(*this), startOffset() + firstChildOffset));
         } else {
             m_firstChild.reset();
         }
@@ -199,9 +314,10 @@ void EbmlElement::internalParse(Diagnostics &diag)
         // check if there's a sibling
         if (totalSize() < maxTotalSize()) {
             if (parent()) {
-                m_nextSibling.reset(new EbmlElement(*(parent()), startOffset() + totalSize()));
+                m_nextSibling.reset(new (container().elementArena()) EbmlElement(*(parent()), startOffset() + totalSize()));
             } else {
-                m_nextSibling.reset(new EbmlElement(container(), startOffset() + totalSize(), maxTotalSize() - totalSize()));
+                m_nextSibling.reset(
+                    new (container().elementArena()) EbmlElement(container(), startOffset() + totalSize(), maxTotalSize() - totalSize()));
             }
         } else {
             m_nextSibling.reset();
@@ -213,11 +329,127 @@ void EbmlElement::internalParse(Diagnostics &diag)
             diag.emplace_back(DiagLevel::Warning, argsToString(skipped, " bytes have been skipped"), parsingContext());
         }
         // -> don't need another try, return here
-        return;
+        return ParsingError::None;
     }
 
     // critical errors occurred and skipping some bytes wasn't successful
-    throw InvalidDataException();
+    return ParsingError::InvalidData;
+}
+
+/*!
+ * \brief Returns the distance from startOffset() to the next position where the ID of a top-level or level 1 element
+ *        starts, starting at the distance \a from and not looking further than \a limit bytes.
+ * \returns Returns \a limit if there is no such position.
+ * \remarks The data is scanned from the memory-mapped file if possible; otherwise it is read in blocks of 64 KiB.
+ */
+std::uint64_t EbmlElement::resyncDistance(std::uint64_t limit, std::uint64_t from)
+{
+    constexpr std::size_t idLength = 4, blockSize = 0x10000;
+    if (maxTotalSize() < idLength) {
+        return limit;
+    }
+    const auto searchLimit = min(limit, maxTotalSize() - idLength + 1);
+    if (const auto mapping = container().mappedData(); !mapping.empty()) {
+        // the mapping covers the whole file so there's nothing to be found beyond it
+        if (startOffset() + from + idLength > mapping.size()) {
+            return limit;
+        }
+        const auto mappedSearchLimit = min<std::uint64_t>(searchLimit, mapping.size() - startOffset() - idLength + 1);
+        if (from >= mappedSearchLimit) {
+            return limit;
+        }
+        const auto distance
+            = from + findLevel1Id(mapping.data() + startOffset() + from, static_cast<std::size_t>(mappedSearchLimit - from));
+        return distance < mappedSearchLimit ? distance : limit;
+    }
+    auto block = make_unique<char[]>(blockSize + idLength - 1);
+    for (std::uint64_t distance = from; distance < searchLimit;) {
+        stream().seekg(static_cast<streamoff>(startOffset() + distance));
+        const auto searchEnd = static_cast<std::size_t>(min<std::uint64_t>(blockSize, searchLimit - distance));
+        const auto bytesRead = stream().rdbuf()->sgetn(block.get(), static_cast<streamsize>(searchEnd + idLength - 1));
+        if (bytesRead < static_cast<streamsize>(idLength)) {
+            break;
+        }
+        const auto available = min(searchEnd, static_cast<std::size_t>(bytesRead) - idLength + 1);
+        if (const auto index = findLevel1Id(block.get(), available); index < available) {
+            return distance + index;
+        }
+        if (available < searchEnd) {
+            break;
+        }
+        distance += searchEnd;
+    }
+    return limit;
+}
+
+/*!
+ * \brief Determines the size of a "Cluster"-element of unknown size.
+ *
+ * The data of the cluster is scanned for the IDs of top-level and level 1 elements (see resyncDistance()). The first
+ * position where a plausible element starts (see isPlausibleLevel1ElementAt()) is considered the end of the cluster.
+ *
+ * \returns Returns whether the size could be determined. If not, the cluster is still assumed to take the maximum
+ *          available size and its end is only found when parsing its children.
+ */
+bool EbmlElement::determineUnknownClusterSize()
+{
+    const auto end = startOffset() + maxTotalSize();
+    for (std::uint64_t distance = headerSize(); distance < maxTotalSize(); ++distance) {
+        if ((distance = resyncDistance(maxTotalSize(), distance)) >= maxTotalSize()) {
+            break;
+        }
+        if (isPlausibleLevel1ElementAt(startOffset() + distance, end)) {
+            m_dataSize = distance - headerSize();
+            m_sizeUnknown = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * \brief Returns whether a top-level or level 1 element plausibly starts at the specified \a offset.
+ *
+ * The header of the element must be valid and the element must not exceed \a end. Unless the element is of unknown size
+ * or reaches \a end, the element following it must have a valid header as well and must be a top-level, level 1 or global
+ * element. This rules out the IDs which just happen to occur within the data of a block.
+ */
+bool EbmlElement::isPlausibleLevel1ElementAt(std::uint64_t offset, std::uint64_t end)
+{
+    Diagnostics diag;
+    for (auto checkSibling = false; offset < end; checkSibling = true) {
+        EbmlElement element(container(), offset, end - offset);
+        if (element.tryParse(diag) != ParsingError::None) {
+            return false;
+        }
+        if (diag.has(DiagLevel::Warning)) {
+            return false;
+        }
+        if (checkSibling) {
+            const auto level = matroskaIdLevel(element.id());
+            return level == MatroskaElementLevel::TopLevel || level == MatroskaElementLevel::Level1 || level == MatroskaElementLevel::Global;
+        }
+        if (element.m_sizeUnknown) {
+            return true;
+        }
+        offset = element.endOffset();
+    }
+    return true;
+}
+
+/*!
+ * \brief Returns a pointer to \a size bytes at the specified absolute \a offset if they are held in memory.
+ *
+ * This is the case if the file is memory-mapped or if the bytes are within the master element currently buffered
+ * via EbmlMasterBuffer. Returns nullptr otherwise so callers need to fall back to reading from the stream().
+ */
+const char *EbmlElement::dataInMemory(std::uint64_t offset, std::uint64_t size) const
+{
+    if (const char *const data = mappedData(offset, size)) {
+        return data;
+    }
+    const auto buffered = container().bufferedData(offset);
+    return !buffered.empty() && size <= buffered.size() ? buffered.data() : nullptr;
 }
 
 /*!
@@ -225,10 +457,60 @@ void EbmlElement::internalParse(Diagnostics &diag)
  */
 std::string EbmlElement::readString()
 {
+    if (const char *const data = dataInMemory(dataOffset(), dataSize())) {
+        return std::string(data, static_cast<std::size_t>(dataSize()));
+    }
     stream().seekg(static_cast<streamoff>(dataOffset()));
     return reader().readString(dataSize());
 }
 
+/*!
+ * \brief Verifies the checksum stored in the "CRC-32"-element of the element (if present).
+ *
+ * The "CRC-32"-element must be the first child and covers the data of all subsequent children.
+ *
+ * \returns Returns false if the checksum does not match (a warning is added to \a diag then); otherwise (also if
+ *          the element has no "CRC-32"-element) true is returned.
+ * \remarks The element must have been parsed. The data of the element is read completely (unless it is mapped or
+ *          buffered) so this should not be used on "Cluster"-elements unless really required.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ * \throws Throws Failure or a derived exception when the first child can not be parsed.
+ */
+bool EbmlElement::verifyCrc32(Diagnostics &diag)
+{
+    auto *const crc32Element = firstChild();
+    if (!crc32Element) {
+        return true;
+    }
+    crc32Element->parse(diag);
+    if (crc32Element->id() != EbmlIds::Crc32) {
+        return true;
+    }
+    if (crc32Element->dataSize() != 4) {
+        diag.emplace_back(DiagLevel::Warning, "The \"CRC-32\"-element does not contain a 4 byte checksum.", parsingContext());
+        return false;
+    }
+    char checksum[4];
+    if (const char *const data = dataInMemory(crc32Element->dataOffset(), 4)) {
+        copy(data, data + 4, checksum);
+    } else {
+        stream().seekg(static_cast<streamoff>(crc32Element->dataOffset()));
+        stream().read(checksum, 4);
+    }
+    const auto begin = crc32Element->endOffset(), size = endOffset() > begin ? endOffset() - begin : 0;
+    const char *const data = dataInMemory(begin, size);
+    const auto actualChecksum
+        = data ? updateCrc32(0, data, static_cast<std::size_t>(size)) : computeCrc32(stream(), begin, static_cast<std::uint64_t>(size));
+    if (actualChecksum != LE::toUInt32(checksum)) {
+        diag.emplace_back(DiagLevel::Warning,
+            argsToString("The CRC-32 checksum of the element does not match (stored: 0x", numberToString(LE::toUInt32(checksum), 16),
+                ", actual: 0x", numberToString(actualChecksum, 16), ")."),
+            parsingContext());
+        return false;
+    }
+    return true;
+}
+
 /*!
  * \brief Reads the content of the element as unsigned integer.
  *
@@ -240,6 +522,10 @@ std::uint64_t EbmlElement::readUInteger()
     constexpr DataSizeType maxBytesToRead = 8;
     char buff[maxBytesToRead] = { 0 };
     const auto bytesToSkip = maxBytesToRead - min(dataSize(), maxBytesToRead);
+    if (const char *const data = dataInMemory(dataOffset(), sizeof(buff) - bytesToSkip)) {
+        copy(data, data + sizeof(buff) - bytesToSkip, buff + bytesToSkip);
+        return BE::toUInt64(buff);
+    }
     stream().seekg(static_cast<streamoff>(dataOffset()), ios_base::beg);
     stream().read(buff + bytesToSkip, static_cast<streamoff>(sizeof(buff) - bytesToSkip));
     return BE::toUInt64(buff);
@@ -251,6 +537,16 @@ std::uint64_t EbmlElement::readUInteger()
  */
 double EbmlElement::readFloat()
 {
+    if (const char *const data = dataInMemory(dataOffset(), dataSize())) {
+        switch (dataSize()) {
+        case sizeof(float):
+            return static_cast<double>(BE::toFloat32(data));
+        case sizeof(double):
+            return BE::toFloat64(data);
+        default:
+            return 0.0;
+        }
+    }
     stream().seekg(static_cast<streamoff>(dataOffset()));
     switch (dataSize()) {
     case sizeof(float):
@@ -555,4 +851,149 @@ void EbmlElement::makeSimpleElement(ostream &stream, GenericFileElement::Identif
     stream.write(data, dataSize);
 }
 
+/*!
+ * \brief Updates the specified \a crc with \a size bytes from \a data.
+ *
+ * EBML uses the CRC-32 of ISO 3309 (the one used by zlib) so the computation is delegated to zlib's optimized
+ * implementation (which uses CPU instructions like PCLMULQDQ or the ARMv8 CRC extension when built accordingly, e.g.
+ * zlib-ng). Pass zero as \a crc to start a new computation; pass the returned value to continue it.
+ */
+std::uint32_t EbmlElement::updateCrc32(std::uint32_t crc, const char *data, std::size_t size)
+{
+    // process the data in chunks as zlib's crc32() takes the size as uInt
+    constexpr auto maxChunkSize = static_cast<std::size_t>(numeric_limits<uInt>::max());
+    auto value = static_cast<uLong>(crc);
+    while (size) {
+        const auto chunkSize = min(size, maxChunkSize);
+        value = crc32(value, reinterpret_cast<const Bytef *>(data), static_cast<uInt>(chunkSize));
+        data += chunkSize;
+        size -= chunkSize;
+    }
+    return static_cast<std::uint32_t>(value);
+}
+
+/*!
+ * \brief Computes the CRC-32 of \a size bytes read from the specified \a stream at the specified \a offset.
+ * \sa updateCrc32()
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+std::uint32_t EbmlElement::computeCrc32(std::istream &stream, std::uint64_t offset, std::uint64_t size)
+{
+    auto buffer = make_unique<char[]>(0x10000);
+    auto crc = std::uint32_t();
+    stream.seekg(static_cast<streamoff>(offset));
+    while (size) {
+        const auto blockSize = static_cast<std::size_t>(min<std::uint64_t>(size, 0x10000));
+        stream.read(buffer.get(), static_cast<streamsize>(blockSize));
+        crc = updateCrc32(crc, buffer.get(), blockSize);
+        size -= blockSize;
+    }
+    return crc;
+}
+
+/*!
+ * \brief Makes a "CRC-32"-element with the specified \a crc in \a buff (which must provide crc32ElementSize bytes).
+ */
+void EbmlElement::makeCrc32Element(char *buff, std::uint32_t crc)
+{
+    buff[0] = static_cast<char>(EbmlIds::Crc32);
+    buff[1] = static_cast<char>(0x84); // length denotation: 4 byte
+    LE::getBytes(crc, buff + 2);
+}
+
+/*!
+ * \brief Makes the header (ID and size denotation) of an EBML element with \a dataSize bytes of data in \a buff.
+ * \returns Returns the number of bytes made.
+ * \remarks The buffer must provide makeBufferSlack bytes beyond the made bytes because IDs and sizes are stored
+ *          as whole words.
+ * \throws Throws InvalidDataException() if \a id or \a dataSize can not be represented.
+ */
+std::size_t EbmlElement::makeElementHeader(char *buff, IdentifierType id, std::uint64_t dataSize)
+{
+    const auto idLength = EbmlElement::makeId(id, buff);
+    return idLength + EbmlElement::makeSizeDenotation(dataSize, buff + idLength);
+}
+
+/*!
+ * \brief Makes a simple EBML element in \a buff.
+ * \param buff Specifies the buffer to make the element in; see makeElementHeader() for its required size.
+ * \param id Specifies the element ID.
+ * \param content Specifies the value of the element as unsigned integer.
+ * \returns Returns the number of bytes made.
+ */
+std::size_t EbmlElement::makeSimpleElement(char *buff, IdentifierType id, std::uint64_t content)
+{
+    char value[8];
+    const auto valueLength = EbmlElement::makeUInteger(content, value);
+    const auto headerLength = makeElementHeader(buff, id, valueLength);
+    std::copy(value, value + valueLength, buff + headerLength);
+    return headerLength + valueLength;
+}
+
+/*!
+ * \brief Makes a simple EBML element in \a buff.
+ * \param buff Specifies the buffer to make the element in; see makeElementHeader() for its required size.
+ * \param id Specifies the element ID.
+ * \param data Specifies the data of the element.
+ * \param dataSize Specifies the size of \a data.
+ * \returns Returns the number of bytes made.
+ */
+std::size_t EbmlElement::makeSimpleElement(char *buff, IdentifierType id, const char *data, std::size_t dataSize)
+{
+    const auto headerLength = makeElementHeader(buff, id, dataSize);
+    std::copy(data, data + dataSize, buff + headerLength);
+    return headerLength + dataSize;
+}
+
+/*!
+ * \class TagParser::EbmlMasterBuffer
+ * \brief The EbmlMasterBuffer class reads a master element at once so its children are parsed and read from memory.
+ *
+ * While the object exists, EbmlElement::parse(), EbmlElement::readString(), EbmlElement::readUInteger() and
+ * EbmlElement::readFloat() take the data of the children (and grandchildren) of the element from the buffer instead of
+ * seeking to each of them and reading a few bytes. This is meant for master elements consisting of many small children
+ * like "TrackEntry", "Tag", "SimpleTag", "ChapterAtom" and "Info".
+ *
+ * Only one master element is buffered per container at a time; buffering a nested element which is not covered by the
+ * buffer of its parent replaces that buffer until the object is destroyed. Nothing is buffered if the file is
+ * memory-mapped anyways.
+ */
+
+/*!
+ * \brief Buffers the specified \a element which must have been parsed.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+EbmlMasterBuffer::EbmlMasterBuffer(EbmlElement &element)
+    : m_container(element.container())
+    , m_previousOffset(0)
+    , m_active(false)
+{
+    const auto size = element.totalSize();
+    if (!m_container.mappedData().empty() || size > maxSize || m_container.bufferedData(element.startOffset()).size() >= size) {
+        return;
+    }
+    m_previousBuffer = move(m_container.m_masterBuffer);
+    m_previousOffset = m_container.m_masterBufferOffset;
+    m_active = true;
+    auto &buffer = m_container.m_masterBuffer;
+    buffer.resize(static_cast<std::size_t>(size));
+    // read only what is available if the element is truncated; the children are read from the stream then
+    auto &stream = m_container.stream();
+    stream.seekg(static_cast<streamoff>(element.startOffset()));
+    buffer.resize(static_cast<std::size_t>(max<streamsize>(stream.rdbuf()->sgetn(buffer.data(), static_cast<streamsize>(size)), 0)));
+    m_container.m_masterBufferOffset = element.startOffset();
+}
+
+/*!
+ * \brief Discards the buffer and restores the previously buffered master element (if any).
+ */
+EbmlMasterBuffer::~EbmlMasterBuffer()
+{
+    if (!m_active) {
+        return;
+    }
+    m_container.m_masterBuffer = move(m_previousBuffer);
+    m_container.m_masterBufferOffset = m_previousOffset;
+}
+
 } // namespace TagParser
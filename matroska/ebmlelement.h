@@ -9,9 +9,12 @@
 #include <c++utilities/conversion/stringbuilder.h>
 #include <c++utilities/conversion/stringconversion.h>
 
+#include <atomic>
 #include <cstdint>
-#include <iostream>
+#include <istream>
 #include <memory>
+#include <ostream>
+#include <string>
 
 namespace TagParser {
 
@@ -30,6 +33,7 @@ public:
 
 class TAG_PARSER_EXPORT EbmlElement : public GenericFileElement<EbmlElement> {
     friend class GenericFileElement<EbmlElement>;
+    friend class MatroskaChapterCursor;
 
 public:
     EbmlElement(MatroskaContainer &container, std::uint64_t startOffset);
@@ -41,6 +45,7 @@ public:
     std::string readString();
     std::uint64_t readUInteger();
     double readFloat();
+    bool verifyCrc32(Diagnostics &diag);
 
     static std::uint8_t calculateIdLength(IdentifierType id);
     static std::uint8_t calculateSizeDenotationLength(std::uint64_t size);
@@ -53,16 +58,31 @@ public:
     static void makeSimpleElement(std::ostream &stream, IdentifierType id, std::uint64_t content);
     static void makeSimpleElement(std::ostream &stream, IdentifierType id, const std::string &content);
     static void makeSimpleElement(std::ostream &stream, IdentifierType id, const char *data, std::size_t dataSize);
-    static std::uint64_t bytesToBeSkipped;
+    static std::size_t makeElementHeader(char *buff, IdentifierType id, std::uint64_t dataSize);
+    static std::size_t makeSimpleElement(char *buff, IdentifierType id, std::uint64_t content);
+    static std::size_t makeSimpleElement(char *buff, IdentifierType id, const char *data, std::size_t dataSize);
+    static std::uint32_t updateCrc32(std::uint32_t crc, const char *data, std::size_t size);
+    static std::uint32_t computeCrc32(std::istream &stream, std::uint64_t offset, std::uint64_t size);
+    static void makeCrc32Element(char *buff, std::uint32_t crc);
+    /// \brief The size of a "CRC-32"-element (ID, size denotation and the 4 byte checksum).
+    static constexpr std::size_t crc32ElementSize = 6;
+    /// \brief The number of bytes a buffer passed to the functions making elements into a buffer must provide beyond the made bytes.
+    static constexpr std::size_t makeBufferSlack = 8;
+    static std::atomic<std::uint64_t> bytesToBeSkipped;
 
 protected:
     EbmlElement(EbmlElement &parent, std::uint64_t startOffset);
     EbmlElement(MatroskaContainer &container, std::uint64_t startOffset, std::uint64_t maxSize);
 
     void internalParse(Diagnostics &diag);
+    ParsingError internalTryParse(Diagnostics &diag);
 
 private:
     std::string parsingContext() const;
+    const char *dataInMemory(std::uint64_t offset, std::uint64_t size) const;
+    std::uint64_t resyncDistance(std::uint64_t limit, std::uint64_t from = 0);
+    bool determineUnknownClusterSize();
+    bool isPlausibleLevel1ElementAt(std::uint64_t offset, std::uint64_t end);
 };
 
 /*!
@@ -160,6 +180,35 @@ inline std::uint64_t EbmlElement::firstChildOffset() const
     return isParent() ? (idLength() + sizeLength()) : 0;
 }
 
+class TAG_PARSER_EXPORT EbmlMasterBuffer {
+public:
+    explicit EbmlMasterBuffer(EbmlElement &element);
+    EbmlMasterBuffer(const EbmlMasterBuffer &) = delete;
+    EbmlMasterBuffer &operator=(const EbmlMasterBuffer &) = delete;
+    ~EbmlMasterBuffer();
+
+    bool isActive() const;
+
+    /// \brief The max. total size of elements which are buffered.
+    static constexpr std::uint64_t maxSize = 0x100000;
+
+private:
+    MatroskaContainer &m_container;
+    std::string m_previousBuffer;
+    std::uint64_t m_previousOffset;
+    bool m_active;
+};
+
+/*!
+ * \brief Returns whether the element has been buffered by this object.
+ * \remarks This is not the case if the file is memory-mapped, if the element exceeds EbmlMasterBuffer::maxSize or if
+ *          the element is already covered by another EbmlMasterBuffer (e.g. one for a parent element).
+ */
+inline bool EbmlMasterBuffer::isActive() const
+{
+    return m_active;
+}
+
 } // namespace TagParser
 
 #endif // TAG_PARSER_EBMLELEMENT_H
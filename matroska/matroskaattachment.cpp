@@ -3,6 +3,9 @@
 #include "./matroskacontainer.h"
 #include "./matroskaid.h"
 
+#include "../filerangecopier.h"
+#include "../mediafileinfo.h"
+
 #include <c++utilities/conversion/binaryconversion.h>
 #include <c++utilities/conversion/stringbuilder.h>
 
@@ -59,8 +62,13 @@ void MatroskaAttachment::parse(EbmlElement *attachedFileElement, Diagnostics &di
             if (data()) {
                 diag.emplace_back(DiagLevel::Warning, "Multiple \"FileData\"-elements found. Surplus elements will be ignored.", context);
             } else {
-                setData(make_unique<StreamDataBlock>(std::bind(&EbmlElement::stream, subElement), subElement->dataOffset(), ios_base::beg,
-                    subElement->startOffset() + subElement->totalSize(), ios_base::beg));
+                auto dataBlock = make_unique<StreamDataBlock>(std::bind(&EbmlElement::stream, subElement), subElement->dataOffset(),
+                    ios_base::beg, subElement->startOffset() + subElement->totalSize(), ios_base::beg);
+                // allow extracting the data by the kernel (not possible if the file is read from a byte source)
+                dataBlock->setFilePath([&fileInfo = subElement->container().fileInfo()] {
+                    return fileInfo.hasByteSource() ? string() : fileInfo.path();
+                });
+                setData(move(dataBlock));
             }
             break;
         case MatroskaIds::FileUID:
@@ -138,24 +146,32 @@ MatroskaAttachmentMaker::MatroskaAttachmentMaker(MatroskaAttachment &attachment,
 /*!
  * \brief Saves the attachment (specified when constructing the object) to the
  *        specified \a stream (makes an "AttachedFile"-element).
+ *
+ * The header and the small child elements are composed within one buffer and written at once. The attached data is
+ * not buffered but copied from its source; if \a copier is specified and opened for the stream of the data and
+ * \a stream the data is copied by the kernel (see FileRangeCopier::copy()). Data from another file (see
+ * AbstractAttachment::setFile()) is copied by the kernel as well if \a copier is opened for \a stream (see
+ * FileRangeCopier::copyFromFile()).
+ *
  * \throws Throws std::ios_base::failure when an IO error occurs.
  * \throws Throws Assumes the data is already validated and thus does NOT
  *                throw TagParser::Failure or a derived exception.
  */
-void MatroskaAttachmentMaker::make(ostream &stream, Diagnostics &diag) const
+void MatroskaAttachmentMaker::make(ostream &stream, Diagnostics &diag, FileRangeCopier *copier) const
 {
-    char buff[8];
-    BE::getBytes(static_cast<std::uint16_t>(MatroskaIds::AttachedFile), buff);
-    stream.write(buff, 2);
-    std::uint8_t len = EbmlElement::makeSizeDenotation(m_attachedFileElementSize, buff);
-    stream.write(buff, len);
+    const auto &name = attachment().name(), &description = attachment().description(), &mimeType = attachment().mimeType();
+    const auto bufferSize = 5 * (2 + 8) + name.size() + description.size() + mimeType.size() + EbmlElement::makeBufferSlack;
+    auto buffer = make_unique<char[]>(bufferSize);
+    auto *out = buffer.get();
+    out += EbmlElement::makeElementHeader(out, MatroskaIds::AttachedFile, m_attachedFileElementSize);
     // make elements
-    EbmlElement::makeSimpleElement(stream, MatroskaIds::FileName, attachment().name());
-    if (!attachment().description().empty()) {
-        EbmlElement::makeSimpleElement(stream, MatroskaIds::FileDescription, attachment().description());
+    out += EbmlElement::makeSimpleElement(out, MatroskaIds::FileName, name.data(), name.size());
+    if (!description.empty()) {
+        out += EbmlElement::makeSimpleElement(out, MatroskaIds::FileDescription, description.data(), description.size());
     }
-    EbmlElement::makeSimpleElement(stream, MatroskaIds::FileMimeType, attachment().mimeType());
-    EbmlElement::makeSimpleElement(stream, MatroskaIds::FileUID, attachment().id());
+    out += EbmlElement::makeSimpleElement(out, MatroskaIds::FileMimeType, mimeType.data(), mimeType.size());
+    out += EbmlElement::makeSimpleElement(out, MatroskaIds::FileUID, attachment().id());
+    stream.write(buffer.get(), out - buffer.get());
     if (attachment().attachedFileElement()) {
         EbmlElement *child;
         for (auto id : initializer_list<EbmlElement::IdentifierType>{
@@ -169,12 +185,20 @@ void MatroskaAttachmentMaker::make(ostream &stream, Diagnostics &diag) const
             }
         }
     }
-    if (attachment().data() && attachment().data()->size()) {
-        BE::getBytes(static_cast<std::uint16_t>(MatroskaIds::FileData), buff);
-        stream.write(buff, 2);
-        len = EbmlElement::makeSizeDenotation(static_cast<std::uint64_t>(attachment().data()->size()), buff);
-        stream.write(buff, len);
-        attachment().data()->copyTo(stream);
+    if (const auto *const data = attachment().data(); data && data->size()) {
+        char header[2 + 8 + EbmlElement::makeBufferSlack];
+        const auto dataSize = static_cast<std::uint64_t>(data->size());
+        stream.write(header, static_cast<streamsize>(EbmlElement::makeElementHeader(header, MatroskaIds::FileData, dataSize)));
+        if (copier && !data->buffer()) {
+            data->stream().seekg(data->startOffset());
+            if (attachment().isDataFromFile()) {
+                copier->copyFromFile(data->stream(), data->filePath(), stream, dataSize);
+            } else {
+                copier->copy(data->stream(), stream, dataSize);
+            }
+        } else {
+            data->copyTo(stream);
+        }
     }
 }
 
@@ -6,13 +6,14 @@
 namespace TagParser {
 
 class EbmlElement;
+class FileRangeCopier;
 class MatroskaAttachment;
 
 class TAG_PARSER_EXPORT MatroskaAttachmentMaker {
     friend class MatroskaAttachment;
 
 public:
-    void make(std::ostream &stream, Diagnostics &diag) const;
+    void make(std::ostream &stream, Diagnostics &diag, FileRangeCopier *copier = nullptr) const;
     const MatroskaAttachment &attachment() const;
     std::uint64_t requiredSize() const;
     void bufferCurrentAttachments(Diagnostics &diag);
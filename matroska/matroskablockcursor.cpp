@@ -0,0 +1,599 @@
+#include "./matroskablockcursor.h"
+#include "./ebmlelement.h"
+#include "./matroskacontainer.h"
+#include "./matroskaid.h"
+#include "./matroskaseekinfo.h"
+
+#include "../diagnostics.h"
+#include "../exceptions.h"
+#include "../mediafileinfo.h"
+
+#include <c++utilities/conversion/binaryconversion.h>
+#include <c++utilities/conversion/stringbuilder.h>
+
+#include <algorithm>
+#include <istream>
+#include <memory>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+/// \cond
+namespace {
+
+/*!
+ * \brief The RawElementHeader struct holds the ID and the size of an EBML element decoded via decodeElementHeader().
+ */
+struct RawElementHeader {
+    /// \brief the ID of the element
+    EbmlElement::IdentifierType id = 0;
+    /// \brief the data size of the element
+    std::uint64_t dataSize = 0;
+    /// \brief the length of the ID and the size denotation
+    std::uint8_t headerSize = 0;
+    /// \brief whether the size is denoted as unknown
+    bool sizeUnknown = false;
+};
+
+/*!
+ * \brief Returns the length of the EBML variable size integer starting with the specified \a firstByte (9 if invalid).
+ */
+std::uint8_t vintLength(std::uint8_t firstByte)
+{
+    std::uint8_t length = 1;
+    for (std::uint8_t mask = 0x80; length <= 8 && !(firstByte & mask); mask >>= 1, ++length)
+        ;
+    return length;
+}
+
+/*!
+ * \brief Returns the big-endian unsigned integer stored in the specified \a size bytes of \a data (at most 8 are taken into account).
+ */
+std::uint64_t decodeUInteger(const char *data, std::uint64_t size)
+{
+    std::uint64_t value = 0;
+    for (const auto *const end = data + min<std::uint64_t>(size, 8); data != end; ++data) {
+        value = (value << 8) | static_cast<std::uint8_t>(*data);
+    }
+    return value;
+}
+
+/*!
+ * \brief Decodes the EBML variable size integer at \a pos within the specified \a size bytes of \a data and advances \a pos.
+ * \returns Returns whether the integer is valid and fits into \a data.
+ */
+bool decodeVint(const char *data, std::uint64_t size, std::uint64_t &pos, std::uint64_t &value, std::uint8_t &length)
+{
+    if (pos >= size || (length = vintLength(static_cast<std::uint8_t>(data[pos]))) > 8 || length > size - pos) {
+        return false;
+    }
+    value = decodeUInteger(data + pos, length) & ((static_cast<std::uint64_t>(1) << (7 * length)) - 1);
+    pos += length;
+    return true;
+}
+
+/*!
+ * \brief Decodes the header of the EBML element at the beginning of the specified \a size bytes of \a data.
+ * \returns Returns whether the header is valid and fits into \a data.
+ */
+bool decodeElementHeader(const char *data, std::uint64_t size, RawElementHeader &header)
+{
+    const auto idLength = size ? vintLength(static_cast<std::uint8_t>(*data)) : std::uint8_t(0);
+    if (!idLength || idLength > 4 || idLength >= size) {
+        return false;
+    }
+    auto pos = static_cast<std::uint64_t>(idLength);
+    std::uint8_t sizeLength;
+    if (!decodeVint(data, size, pos, header.dataSize, sizeLength)) {
+        return false;
+    }
+    header.id = static_cast<EbmlElement::IdentifierType>(decodeUInteger(data, idLength));
+    header.headerSize = static_cast<std::uint8_t>(pos);
+    header.sizeUnknown = header.dataSize == (static_cast<std::uint64_t>(1) << (7 * sizeLength)) - 1;
+    return true;
+}
+
+} // namespace
+/// \endcond
+
+/*!
+ * \brief Decodes the header and the lacing of the "Block"- or "SimpleBlock"-element with the specified \a size bytes of \a data.
+ *
+ * The frames are assigned as views into \a data; nothing is copied.
+ *
+ * \returns Returns nullptr if the block is valid; otherwise a description of the problem (e.g. "has truncated lace sizes").
+ * \remarks The decoded header is only complete if the block is valid. The timestamp, offset and the keyframe flag of
+ *          "Block"-elements are only determined by MatroskaBlockCursor.
+ */
+const char *MatroskaBlock::decode(const char *data, std::uint64_t size)
+{
+    // decode the header (track number, relative timestamp and flags)
+    frames.clear();
+    std::uint64_t pos = 0;
+    std::uint8_t length;
+    if (!decodeVint(data, size, pos, trackNumber, length)) {
+        return "has an invalid track number";
+    }
+    if (size - pos < 3) {
+        return "is too small to hold the block header";
+    }
+    relativeTimestamp = static_cast<std::int16_t>(BE::toUInt16(data + pos));
+    flags = static_cast<std::uint8_t>(data[pos + 2]);
+    isKeyframe = flags & 0x80;
+    const auto lacing = (flags >> 1) & 0x3;
+    if (!lacing) {
+        frames.emplace_back(data + pos + 3, static_cast<std::size_t>(size - pos - 3));
+        return nullptr;
+    }
+
+    // decode the lacing
+    if ((pos += 3) >= size) {
+        return "is too small to hold the number of laced frames";
+    }
+    const auto frameCount = static_cast<std::uint64_t>(static_cast<std::uint8_t>(data[pos++])) + 1;
+    // -> decodes the sizes of all frames except the last one invoking the specified callback for each size
+    const auto decodeLaceSizes = [data, size, lacing, frameCount](std::uint64_t &pos, const auto &callback) -> const char * {
+        switch (lacing) {
+        case 0x1:
+            // Xiph lacing: the sizes are denoted as sums of bytes
+            for (std::uint64_t frame = 1; frame < frameCount; ++frame) {
+                auto frameSize = std::uint64_t();
+                for (auto byte = std::uint8_t(0xFF); byte == 0xFF; frameSize += byte) {
+                    if (pos >= size) {
+                        return "has truncated lace sizes";
+                    }
+                    byte = static_cast<std::uint8_t>(data[pos++]);
+                }
+                callback(frameSize);
+            }
+            break;
+        case 0x3: {
+            // EBML lacing: the size of the first frame is followed by the differences to the previous size as signed integers
+            if (frameCount < 2) {
+                break;
+            }
+            std::uint64_t frameSize, value;
+            std::uint8_t length;
+            if (!decodeVint(data, size, pos, frameSize, length)) {
+                return "has truncated lace sizes";
+            }
+            callback(frameSize);
+            for (std::uint64_t frame = 2; frame < frameCount; ++frame) {
+                if (!decodeVint(data, size, pos, value, length)) {
+                    return "has truncated lace sizes";
+                }
+                const auto difference = static_cast<std::int64_t>(value) - ((static_cast<std::int64_t>(1) << (7 * length - 1)) - 1);
+                if (difference < 0 && static_cast<std::uint64_t>(-difference) > frameSize) {
+                    return "has a negative lace size";
+                }
+                callback(frameSize = static_cast<std::uint64_t>(static_cast<std::int64_t>(frameSize) + difference));
+            }
+            break;
+        }
+        default:;
+        }
+        return nullptr;
+    };
+    // -> validate the lace sizes first so the frames can be assigned without further checks
+    auto framesPos = pos;
+    auto lacedSize = std::uint64_t();
+    if (const auto *const problem = decodeLaceSizes(framesPos, [&lacedSize](std::uint64_t frameSize) { lacedSize += frameSize; })) {
+        return problem;
+    }
+    if (framesPos > size || lacedSize > size - framesPos) {
+        return "has lace sizes exceeding the block";
+    }
+    if (lacing == 0x2 && (size - framesPos) % frameCount) {
+        // fixed-size lacing: the frames share the remaining data evenly
+        return "has a size which can not be split evenly into the number of laced frames";
+    }
+
+    // assign the frames
+    const auto *frameData = data + framesPos;
+    frames.reserve(static_cast<std::size_t>(frameCount));
+    if (lacing == 0x2) {
+        const auto frameSize = static_cast<std::size_t>((size - framesPos) / frameCount);
+        for (std::uint64_t frame = 0; frame != frameCount; ++frame, frameData += frameSize) {
+            frames.emplace_back(frameData, frameSize);
+        }
+        return nullptr;
+    }
+    decodeLaceSizes(pos, [this, &frameData](std::uint64_t frameSize) {
+        frames.emplace_back(frameData, static_cast<std::size_t>(frameSize));
+        frameData += frameSize;
+    });
+    frames.emplace_back(frameData, static_cast<std::size_t>(data + size - frameData));
+    return nullptr;
+}
+
+/*!
+ * \brief The MatroskaBlockCursor::CuePoint struct holds a cluster position denoted by the "Cues"-element.
+ */
+struct MatroskaBlockCursor::CuePoint {
+    /// \brief the time of the cue point in the timestamp scale of the segment
+    std::uint64_t time = 0;
+    /// \brief the number of the track the position is denoted for
+    std::uint64_t trackNumber = 0;
+    /// \brief the offset of the "Cluster"-element within the file
+    std::uint64_t clusterOffset = 0;
+};
+
+/*!
+ * \class TagParser::MatroskaBlockCursor
+ * \brief The MatroskaBlockCursor class iterates the "SimpleBlock"- and "Block"-elements of a Matroska file.
+ *
+ * Each time next() is called the cursor is positioned at the next block of the first segment in file order. The block
+ * provides the track number, the timestamp, whether it is a keyframe and the (lacing-decoded) frames. The
+ * "Cluster"-elements are decoded via the raw element headers without building an element tree. If the file is
+ * memory-mapped (or read from a byte source providing ByteSource::contiguousData()) the frames point directly into the
+ * mapped data; otherwise each "Cluster"-element is read into a buffer at once.
+ *
+ * Use seek() to position the cursor at the cluster denoted by the "Cues"-element for a particular time, e.g. to extract
+ * a keyframe for a thumbnail:
+ * ```
+ * auto cursor = MatroskaBlockCursor(container);
+ * cursor.seek(timestamp, diag, videoTrackNumber);
+ * while (cursor.next(diag)) {
+ *     if (const auto &block = cursor.block(); block.trackNumber == videoTrackNumber && block.isKeyframe) {
+ *         // decode block.frames
+ *         break;
+ *     }
+ * }
+ * ```
+ *
+ * \remarks
+ * - The header of the container must have been parsed. The timestamps are in the timestamp scale of the segment
+ *   (milliseconds by default).
+ * - Only the first segment is taken into account. Iterating stops at the first "Cluster"-element which can not be
+ *   decoded or whose size is unknown (the problem is reported via the diagnostics).
+ * - The cursor does not take ownership over the container; it must not be used after the container has been
+ *   destroyed or its header has been parsed again. It uses the stream of the container if the file is not mapped.
+ */
+
+/*!
+ * \brief Constructs a new cursor for the specified \a container which is positioned before the first block.
+ */
+MatroskaBlockCursor::MatroskaBlockCursor(MatroskaContainer &container)
+    : m_container(container)
+{
+    reset();
+}
+
+/*!
+ * \brief Destroys the cursor.
+ */
+MatroskaBlockCursor::~MatroskaBlockCursor()
+{
+}
+
+/*!
+ * \brief Positions the cursor before the first block again.
+ */
+void MatroskaBlockCursor::reset()
+{
+    m_initialized = false;
+    m_cuesParsed = false;
+    m_segmentElement = nullptr;
+    m_segmentDataOffset = m_segmentEnd = m_firstClusterOffset = m_nextOffset = 0;
+    m_clusterOffset = m_clusterDataOffset = m_clusterSize = m_pos = 0;
+    m_clusterData = nullptr;
+    m_clusterTimestamp = 0;
+    m_cuePoints.clear();
+    m_block = MatroskaBlock();
+}
+
+/*!
+ * \brief Advances the cursor to the next block.
+ * \returns Returns whether the cursor is positioned at a block; false is returned when all blocks have been visited.
+ * \remarks Blocks which can not be decoded are reported via \a diag and skipped.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+bool MatroskaBlockCursor::next(Diagnostics &diag)
+{
+    static const string context("iterating blocks of Matroska container");
+    if (!m_initialized && !init(diag)) {
+        return false;
+    }
+    // decodes the specified block and returns whether it is valid; reports it otherwise
+    const auto decodeBlock = [this, &diag](const char *data, std::uint64_t size, std::uint64_t offset, const char *blockName) {
+        if (const auto *const problem = m_block.decode(data, size)) {
+            diag.emplace_back(DiagLevel::Critical, argsToString("The \"", blockName, "\"-element at ", offset, ' ', problem, '.'), context);
+            return false;
+        }
+        m_block.timestamp = m_clusterTimestamp + m_block.relativeTimestamp;
+        m_block.offset = offset;
+        return true;
+    };
+
+    RawElementHeader child, blockGroupChild;
+    for (;;) {
+        // read the next "Cluster"-element if all children of the current one have been visited
+        if (m_pos >= m_clusterSize) {
+            if (!nextCluster(diag)) {
+                return false;
+            }
+            continue;
+        }
+
+        // decode the next child of the "Cluster"-element
+        const auto childOffset = m_clusterDataOffset + m_pos;
+        if (!decodeElementHeader(m_clusterData + m_pos, m_clusterSize - m_pos, child) || child.sizeUnknown
+            || child.dataSize > m_clusterSize - m_pos - child.headerSize) {
+            diag.emplace_back(DiagLevel::Critical,
+                argsToString("The child of the \"Cluster\"-element at ", m_clusterOffset,
+                    " is invalid or exceeds the \"Cluster\"-element. The remaining children will be ignored."),
+                context);
+            m_pos = m_clusterSize;
+            continue;
+        }
+        const auto *const childData = m_clusterData + m_pos + child.headerSize;
+        m_pos += child.headerSize + child.dataSize;
+        switch (child.id) {
+        case MatroskaIds::Timecode:
+            m_clusterTimestamp = static_cast<std::int64_t>(decodeUInteger(childData, child.dataSize));
+            break;
+        case MatroskaIds::SimpleBlock:
+            if (decodeBlock(childData, child.dataSize, childOffset, "SimpleBlock")) {
+                return true;
+            }
+            break;
+        case MatroskaIds::BlockGroup: {
+            // a "Block"-element is a keyframe if it does not reference other blocks
+            const char *blockData = nullptr;
+            auto blockSize = std::uint64_t(), blockOffset = std::uint64_t();
+            auto referencesOtherBlocks = false;
+            for (std::uint64_t pos = 0; pos < child.dataSize; pos += blockGroupChild.headerSize + blockGroupChild.dataSize) {
+                if (!decodeElementHeader(childData + pos, child.dataSize - pos, blockGroupChild) || blockGroupChild.sizeUnknown
+                    || blockGroupChild.dataSize > child.dataSize - pos - blockGroupChild.headerSize) {
+                    diag.emplace_back(DiagLevel::Critical,
+                        argsToString(
+                            "The child of the \"BlockGroup\"-element at ", childOffset, " is invalid or exceeds the \"BlockGroup\"-element."),
+                        context);
+                    break;
+                }
+                switch (blockGroupChild.id) {
+                case MatroskaIds::Block:
+                    blockData = childData + pos + blockGroupChild.headerSize;
+                    blockSize = blockGroupChild.dataSize;
+                    blockOffset = childOffset + child.headerSize + pos;
+                    break;
+                case MatroskaIds::ReferenceBlock:
+                    referencesOtherBlocks = true;
+                    break;
+                default:;
+                }
+            }
+            if (!blockData) {
+                diag.emplace_back(DiagLevel::Critical,
+                    argsToString("The \"BlockGroup\"-element at ", childOffset, " does not contain a \"Block\"-element."), context);
+            } else if (decodeBlock(blockData, blockSize, blockOffset, "Block")) {
+                m_block.isKeyframe = !referencesOtherBlocks;
+                return true;
+            }
+            break;
+        }
+        default:;
+        }
+    }
+}
+
+/*!
+ * \brief Positions the cursor before the "Cluster"-element denoted by the "Cues"-element for the specified \a timestamp.
+ *
+ * The cursor is positioned at the cluster of the last cue point whose time is not after \a timestamp. If \a trackNumber
+ * is not zero, only cue points for that track are taken into account. So subsequent calls of next() yield the blocks
+ * starting from the cluster which contains the keyframe preceding \a timestamp (which might be preceded by other blocks
+ * within the cluster).
+ *
+ * \returns Returns whether the "Cues"-element could be used. If there are no cue points the cursor is positioned before
+ *          the first block; then blocks have to be skipped via next() until the timestamp is reached.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+bool MatroskaBlockCursor::seek(std::uint64_t timestamp, Diagnostics &diag, std::uint64_t trackNumber)
+{
+    if (!m_initialized && !init(diag)) {
+        return false;
+    }
+    if (!m_cuesParsed) {
+        parseCues(diag);
+    }
+    m_nextOffset = m_firstClusterOffset;
+    m_clusterData = nullptr;
+    m_clusterSize = m_pos = 0;
+    for (const auto &cuePoint : m_cuePoints) {
+        if (cuePoint.time > timestamp) {
+            break;
+        }
+        if (!trackNumber || cuePoint.trackNumber == trackNumber) {
+            m_nextOffset = cuePoint.clusterOffset;
+        }
+    }
+    return !m_cuePoints.empty();
+}
+
+/*!
+ * \brief Locates the first "Cluster"-element of the first segment.
+ * \returns Returns whether there is a "Cluster"-element.
+ */
+bool MatroskaBlockCursor::init(Diagnostics &diag)
+{
+    static const string context("iterating blocks of Matroska container");
+    m_initialized = true;
+    auto *const firstElement = m_container.firstElement();
+    if (!firstElement) {
+        return false;
+    }
+    try {
+        if (!(m_segmentElement = firstElement->siblingById(MatroskaIds::Segment, diag))) {
+            return false;
+        }
+        m_segmentElement->parse(diag);
+        const auto *const firstClusterElement = m_segmentElement->childById(MatroskaIds::Cluster, diag);
+        if (!firstClusterElement) {
+            return false;
+        }
+        m_segmentDataOffset = m_segmentElement->dataOffset();
+        m_segmentEnd = min(m_segmentElement->endOffset(), m_container.fileInfo().size());
+        m_nextOffset = m_firstClusterOffset = firstClusterElement->startOffset();
+    } catch (const Failure &) {
+        diag.emplace_back(DiagLevel::Critical, "Unable to locate the first \"Cluster\"-element.", context);
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief Returns the specified \a size bytes at the specified \a offset of the file or nullptr if they can not be read.
+ * \remarks The data is only valid until the next call if the file is not mapped.
+ */
+const char *MatroskaBlockCursor::read(std::uint64_t offset, std::uint64_t size)
+{
+    if (const auto mapping = m_container.mappedData(); !mapping.empty()) {
+        return offset <= mapping.size() && size <= mapping.size() - offset ? mapping.data() + offset : nullptr;
+    }
+    auto &stream = m_container.stream();
+    m_buffer.resize(static_cast<std::size_t>(size));
+    stream.seekg(static_cast<streamoff>(offset));
+    stream.read(m_buffer.data(), static_cast<streamsize>(size));
+    return static_cast<std::uint64_t>(stream.gcount()) == size ? m_buffer.data() : nullptr;
+}
+
+/*!
+ * \brief Reads the next "Cluster"-element of the segment.
+ * \returns Returns whether there is a next "Cluster"-element.
+ */
+bool MatroskaBlockCursor::nextCluster(Diagnostics &diag)
+{
+    static const string context("iterating blocks of Matroska container");
+    RawElementHeader header;
+    for (; m_nextOffset < m_segmentEnd;) {
+        // decode the header of the level 1 element
+        const auto offset = m_nextOffset;
+        const auto headerBytes = min<std::uint64_t>(12, m_segmentEnd - offset);
+        const auto *const headerData = read(offset, headerBytes);
+        if (!headerData || !decodeElementHeader(headerData, headerBytes, header) || header.sizeUnknown
+            || header.dataSize > m_segmentEnd - offset - header.headerSize) {
+            diag.emplace_back(DiagLevel::Critical,
+                argsToString("Unable to determine the size of the EBML element at ", offset, ". The subsequent blocks will be ignored."), context);
+            m_nextOffset = m_segmentEnd;
+            return false;
+        }
+        m_nextOffset += header.headerSize + header.dataSize;
+        if (header.id != MatroskaIds::Cluster) {
+            continue;
+        }
+
+        // read the "Cluster"-element at once
+        m_clusterOffset = offset;
+        m_clusterDataOffset = offset + header.headerSize;
+        if (!(m_clusterData = read(m_clusterDataOffset, header.dataSize))) {
+            diag.emplace_back(DiagLevel::Critical, argsToString("Unable to read the \"Cluster\"-element at ", offset, '.'), context);
+            m_nextOffset = m_segmentEnd;
+            return false;
+        }
+        m_clusterSize = header.dataSize;
+        m_clusterTimestamp = 0;
+        m_pos = 0;
+        return true;
+    }
+    return false;
+}
+
+/*!
+ * \brief Reads the cue points of the "Cues"-elements of the segment.
+ * \remarks The "Cues"-elements in front of the first "Cluster"-element and those denoted by the "SeekHead"-element are
+ *          taken into account.
+ */
+void MatroskaBlockCursor::parseCues(Diagnostics &diag)
+{
+    static const string context("reading cue points for iterating blocks of Matroska container");
+    m_cuesParsed = true;
+    if (!m_segmentElement) {
+        return;
+    }
+
+    // locate the "Cues"-elements
+    auto cuesElements = vector<EbmlElement *>();
+    auto additionalElements = vector<unique_ptr<EbmlElement>>();
+    try {
+        for (EbmlElement *child = m_segmentElement->firstChild(); child; child = child->nextSibling()) {
+            child->parse(diag);
+            if (child->id() == MatroskaIds::Cluster) {
+                break;
+            }
+            if (child->id() == MatroskaIds::Cues) {
+                cuesElements.emplace_back(child);
+            }
+        }
+    } catch (const Failure &) {
+        diag.emplace_back(DiagLevel::Critical, "Unable to locate the \"Cues\"-elements in front of the first \"Cluster\"-element.", context);
+    }
+    for (const auto &seekInfo : m_container.seekInfos()) {
+        if (seekInfo->seekHeadElements().empty() || seekInfo->seekHeadElements().front()->parent() != m_segmentElement) {
+            continue;
+        }
+        for (const auto &[id, position] : seekInfo->info()) {
+            const auto offset = m_segmentDataOffset + position;
+            if (id == MatroskaIds::Cues && offset > m_firstClusterOffset && offset < m_segmentEnd) {
+                cuesElements.emplace_back(additionalElements.emplace_back(make_unique<EbmlElement>(m_container, offset)).get());
+            }
+        }
+    }
+
+    // read the cluster positions of the cue points
+    for (auto *const cuesElement : cuesElements) {
+        try {
+            cuesElement->parse(diag);
+            if (cuesElement->id() != MatroskaIds::Cues) {
+                continue;
+            }
+            for (EbmlElement *cuePointElement = cuesElement->firstChild(); cuePointElement; cuePointElement = cuePointElement->nextSibling()) {
+                cuePointElement->parse(diag);
+                if (cuePointElement->id() != MatroskaIds::CuePoint) {
+                    continue;
+                }
+                const auto firstPosition = m_cuePoints.size();
+                auto time = std::uint64_t();
+                for (EbmlElement *cuePointChild = cuePointElement->firstChild(); cuePointChild; cuePointChild = cuePointChild->nextSibling()) {
+                    cuePointChild->parse(diag);
+                    if (cuePointChild->id() == MatroskaIds::CueTime) {
+                        time = cuePointChild->readUInteger();
+                        continue;
+                    }
+                    if (cuePointChild->id() != MatroskaIds::CueTrackPositions) {
+                        continue;
+                    }
+                    auto cuePoint = CuePoint();
+                    for (EbmlElement *positionElement = cuePointChild->firstChild(); positionElement;
+                         positionElement = positionElement->nextSibling()) {
+                        positionElement->parse(diag);
+                        switch (positionElement->id()) {
+                        case MatroskaIds::CueTrack:
+                            cuePoint.trackNumber = positionElement->readUInteger();
+                            break;
+                        case MatroskaIds::CueClusterPosition:
+                            cuePoint.clusterOffset = m_segmentDataOffset + positionElement->readUInteger();
+                            break;
+                        default:;
+                        }
+                    }
+                    if (cuePoint.clusterOffset >= m_firstClusterOffset && cuePoint.clusterOffset < m_segmentEnd) {
+                        m_cuePoints.emplace_back(cuePoint);
+                    }
+                }
+                // note: The "CueTime"-element is supposed to precede the "CueTrackPositions"-elements but might not.
+                for (auto i = firstPosition; i != m_cuePoints.size(); ++i) {
+                    m_cuePoints[i].time = time;
+                }
+            }
+        } catch (const Failure &) {
+            diag.emplace_back(
+                DiagLevel::Critical, argsToString("Unable to parse the \"Cues\"-element at ", cuesElement->startOffset(), '.'), context);
+        }
+    }
+    stable_sort(m_cuePoints.begin(), m_cuePoints.end(), [](const CuePoint &lhs, const CuePoint &rhs) { return lhs.time < rhs.time; });
+}
+
+} // namespace TagParser
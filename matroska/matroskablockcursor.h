@@ -0,0 +1,112 @@
+#ifndef TAG_PARSER_MATROSKABLOCKCURSOR_H
+#define TAG_PARSER_MATROSKABLOCKCURSOR_H
+
+#include "../global.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace TagParser {
+
+class Diagnostics;
+class EbmlElement;
+class MatroskaContainer;
+
+/*!
+ * \brief The MatroskaBlock struct holds a "SimpleBlock"- or "Block"-element decoded via decode() or MatroskaBlockCursor.
+ */
+struct TAG_PARSER_EXPORT MatroskaBlock {
+    const char *decode(const char *data, std::uint64_t size);
+    std::uint64_t frameDataSize() const;
+
+    /// \brief The number of the track the block belongs to.
+    std::uint64_t trackNumber = 0;
+    /// \brief The timestamp relative to the timestamp of the "Cluster"-element.
+    std::int16_t relativeTimestamp = 0;
+    /// \brief The timestamp in the timestamp scale of the segment (only set by MatroskaBlockCursor).
+    std::int64_t timestamp = 0;
+    /// \brief The flags of the block header.
+    std::uint8_t flags = 0;
+    /// \brief Whether the block is a keyframe (only set by MatroskaBlockCursor for "Block"-elements).
+    bool isKeyframe = false;
+    /// \brief The offset of the "SimpleBlock"- or "Block"-element within the file (only set by MatroskaBlockCursor).
+    std::uint64_t offset = 0;
+    /// \brief The data of the frames (more than one if laced); the views point into the data passed to decode().
+    std::vector<std::string_view> frames;
+};
+
+/*!
+ * \brief Returns the size of all frames (without the header and the lacing).
+ */
+inline std::uint64_t MatroskaBlock::frameDataSize() const
+{
+    auto size = std::uint64_t();
+    for (const auto &frame : frames) {
+        size += frame.size();
+    }
+    return size;
+}
+
+class TAG_PARSER_EXPORT MatroskaBlockCursor {
+public:
+    explicit MatroskaBlockCursor(MatroskaContainer &container);
+    ~MatroskaBlockCursor();
+
+    bool next(Diagnostics &diag);
+    bool seek(std::uint64_t timestamp, Diagnostics &diag, std::uint64_t trackNumber = 0);
+    void reset();
+    const MatroskaBlock &block() const;
+    std::uint64_t clusterOffset() const;
+
+private:
+    struct CuePoint;
+
+    bool init(Diagnostics &diag);
+    const char *read(std::uint64_t offset, std::uint64_t size);
+    bool nextCluster(Diagnostics &diag);
+    void parseCues(Diagnostics &diag);
+
+    MatroskaContainer &m_container;
+    bool m_initialized;
+    bool m_cuesParsed;
+    EbmlElement *m_segmentElement;
+    std::uint64_t m_segmentDataOffset;
+    std::uint64_t m_segmentEnd;
+    std::uint64_t m_firstClusterOffset;
+    std::uint64_t m_nextOffset;
+    std::uint64_t m_clusterOffset;
+    std::uint64_t m_clusterDataOffset;
+    const char *m_clusterData;
+    std::uint64_t m_clusterSize;
+    std::uint64_t m_pos;
+    std::int64_t m_clusterTimestamp;
+    std::string m_buffer;
+    std::vector<CuePoint> m_cuePoints;
+    MatroskaBlock m_block;
+};
+
+/*!
+ * \brief Returns the current block.
+ * \remarks
+ * - Only valid after next() returned true.
+ * - The frames point into the memory-mapped file or into a buffer of the cursor which holds the current "Cluster"-element.
+ *   So they are only valid as long as the file is mapped or until the next "Cluster"-element is read (whatever applies).
+ */
+inline const MatroskaBlock &MatroskaBlockCursor::block() const
+{
+    return m_block;
+}
+
+/*!
+ * \brief Returns the offset of the "Cluster"-element containing the current block.
+ */
+inline std::uint64_t MatroskaBlockCursor::clusterOffset() const
+{
+    return m_clusterOffset;
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_MATROSKABLOCKCURSOR_H
@@ -1,5 +1,6 @@
 #include "./matroskachapter.h"
 #include "./ebmlelement.h"
+#include "./matroskacontainer.h"
 #include "./matroskaid.h"
 
 #include "../diagnostics.h"
@@ -45,6 +46,7 @@ void MatroskaChapter::internalParse(Diagnostics &diag)
     static const string context("parsing \"ChapterAtom\"-element");
     clear();
     // iterate through children of "ChapterAtom"-element
+    const auto buffer = EbmlMasterBuffer(*m_chapterAtomElement);
     for (EbmlElement *chapterAtomChild = m_chapterAtomElement->firstChild(); chapterAtomChild; chapterAtomChild = chapterAtomChild->nextSibling()) {
         chapterAtomChild->parse(diag);
         switch (chapterAtomChild->id()) {
@@ -0,0 +1,189 @@
+#include "./matroskachaptercursor.h"
+#include "./ebmlelement.h"
+#include "./ebmlid.h"
+#include "./matroskacontainer.h"
+#include "./matroskaid.h"
+
+#include "../diagnostics.h"
+#include "../exceptions.h"
+
+#include <c++utilities/conversion/stringbuilder.h>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+/*!
+ * \class TagParser::MatroskaChapterCursor
+ * \brief The MatroskaChapterCursor class iterates the edition entries and chapters of a Matroska file on demand.
+ *
+ * Unlike MatroskaContainer::parseChapters() which builds the whole tree of edition entries and chapters, the cursor
+ * only parses one edition entry or chapter each time next() is called. The items are visited in the order they are
+ * stored within the file: Each edition entry is followed by its chapters and each chapter by its nested chapters.
+ *
+ * Only the elements on the path to the current item are kept in memory. So files with a huge number of chapters (e.g.
+ * automatically generated markers every few seconds) can be processed with bounded memory.
+ *
+ * Example:
+ * ```
+ * auto cursor = MatroskaChapterCursor(container);
+ * while (cursor.next(diag)) {
+ *     if (const auto *const chapter = cursor.chapter()) {
+ *         // process chapter at nesting level cursor.depth()
+ *     } else {
+ *         // process cursor.editionEntry()
+ *     }
+ * }
+ * ```
+ *
+ * \remarks
+ * - The header of the container must have been parsed. MatroskaContainer::parseChapters() does not need to be called;
+ *   use ParsingFlags::SkipChapters to skip it when parsing the file via MediaFileInfo::parseEverything().
+ * - The cursor does not take ownership over the container; it must not be used after the container has been
+ *   destroyed or its header has been parsed again.
+ */
+
+/*!
+ * \brief Constructs a new cursor for the specified \a container which is positioned before the first edition entry.
+ */
+MatroskaChapterCursor::MatroskaChapterCursor(MatroskaContainer &container)
+    : m_container(container)
+    , m_chaptersElementIndex(0)
+    , m_chaptersElement(nullptr)
+    , m_depth(0)
+{
+}
+
+/*!
+ * \brief Destroys the cursor.
+ */
+MatroskaChapterCursor::~MatroskaChapterCursor()
+{
+}
+
+/*!
+ * \brief Positions the cursor before the first edition entry again.
+ */
+void MatroskaChapterCursor::reset()
+{
+    m_chaptersElementIndex = 0;
+    m_chaptersElement = nullptr;
+    m_chapter.reset();
+    m_editionEntry.reset();
+    m_elements.clear();
+    m_nextOffsets.clear();
+    m_depth = 0;
+}
+
+/*!
+ * \brief Advances the cursor to the next edition entry or chapter.
+ * \returns Returns whether the cursor is positioned at an edition entry or chapter; false is returned when all
+ *          edition entries and chapters have been visited.
+ * \remarks Elements which can not be parsed are reported via \a diag and skipped (along with their subsequent siblings).
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+bool MatroskaChapterCursor::next(Diagnostics &diag)
+{
+    static const string context("iterating editions/chapters of Matroska container");
+    constexpr std::uint64_t minimumElementSize = 2; // ID and size denotation take at least one byte each
+    m_chapter.reset();
+    for (;;) {
+        // continue with the next "Chapters"-element if all children of the current one have been visited
+        if (m_nextOffsets.empty()) {
+            if (m_chaptersElementIndex >= m_container.m_chaptersElements.size()) {
+                m_chaptersElement = nullptr;
+                return false;
+            }
+            m_chaptersElement = m_container.m_chaptersElements[m_chaptersElementIndex++];
+            try {
+                m_chaptersElement->parse(diag);
+            } catch (const Failure &) {
+                diag.emplace_back(DiagLevel::Critical, "Unable to parse \"Chapters\"-element.", context);
+                continue;
+            }
+            m_nextOffsets.emplace_back(m_chaptersElement->dataOffset());
+            continue;
+        }
+
+        // ascend if all children of the current parent have been visited
+        auto &parent = m_elements.empty() ? *m_chaptersElement : *m_elements.back();
+        auto &nextOffset = m_nextOffsets.back();
+        if (nextOffset + minimumElementSize > parent.endOffset()) {
+            m_nextOffsets.pop_back();
+            if (!m_elements.empty()) {
+                m_elements.pop_back();
+            }
+            if (m_elements.empty()) {
+                m_editionEntry.reset();
+            }
+            continue;
+        }
+
+        // parse the next child without keeping its predecessors in memory
+        auto element = unique_ptr<EbmlElement>(new EbmlElement(parent, nextOffset));
+        try {
+            element->parse(diag);
+        } catch (const Failure &) {
+            diag.emplace_back(DiagLevel::Critical,
+                argsToString("Unable to parse element at ", nextOffset, ". Remaining children of \"", parent.idToString(),
+                    "\"-element will be ignored."),
+                context);
+            nextOffset = parent.endOffset();
+            continue;
+        }
+        nextOffset = element->endOffset();
+
+        if (m_elements.empty()) {
+            // handle children of "Chapters"-element
+            switch (element->id()) {
+            case MatroskaIds::EditionEntry:
+                m_editionEntry = make_unique<MatroskaEditionEntry>(element.get());
+                // -> read only the properties of the edition itself; its chapters are visited subsequently
+                for (auto childOffset = element->dataOffset(); childOffset + minimumElementSize <= element->endOffset();) {
+                    auto child = EbmlElement(*element, childOffset);
+                    try {
+                        child.parse(diag);
+                        m_editionEntry->parseChild(child, diag);
+                    } catch (const Failure &) {
+                        diag.emplace_back(DiagLevel::Critical,
+                            argsToString("Unable to parse all children of \"EditionEntry\"-element at ", element->startOffset(), '.'), context);
+                        break;
+                    }
+                    childOffset = child.endOffset();
+                }
+                m_depth = 0;
+                m_nextOffsets.emplace_back(element->dataOffset());
+                m_elements.emplace_back(move(element));
+                return true;
+            case EbmlIds::Crc32:
+            case EbmlIds::Void:
+                break;
+            default:
+                diag.emplace_back(DiagLevel::Warning,
+                    "\"Chapters\"-element contains unknown child element \"" % element->idToString() + "\". It will be ignored.", context);
+            }
+            continue;
+        }
+
+        // handle "ChapterAtom"-elements within "EditionEntry"- and "ChapterAtom"-elements
+        // note: Other children have already been taken into account when parsing the edition entry or chapter.
+        if (element->id() != MatroskaIds::ChapterAtom) {
+            continue;
+        }
+        m_chapter = make_unique<MatroskaChapter>(element.get());
+        try {
+            m_chapter->parse(diag);
+        } catch (const Failure &) {
+            diag.emplace_back(DiagLevel::Critical, argsToString("Unable to parse chapter at ", element->startOffset(), '.'), context);
+            m_chapter.reset();
+            continue;
+        }
+        m_depth = m_elements.size() - 1;
+        m_nextOffsets.emplace_back(element->dataOffset());
+        m_elements.emplace_back(move(element));
+        return true;
+    }
+}
+
+} // namespace TagParser
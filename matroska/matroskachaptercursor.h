@@ -0,0 +1,68 @@
+#ifndef TAG_PARSER_MATROSKACHAPTERCURSOR_H
+#define TAG_PARSER_MATROSKACHAPTERCURSOR_H
+
+#include "./matroskachapter.h"
+#include "./matroskaeditionentry.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace TagParser {
+
+class EbmlElement;
+class MatroskaContainer;
+
+class TAG_PARSER_EXPORT MatroskaChapterCursor {
+public:
+    explicit MatroskaChapterCursor(MatroskaContainer &container);
+    ~MatroskaChapterCursor();
+
+    bool next(Diagnostics &diag);
+    void reset();
+    const MatroskaEditionEntry *editionEntry() const;
+    const MatroskaChapter *chapter() const;
+    std::size_t depth() const;
+
+private:
+    MatroskaContainer &m_container;
+    std::size_t m_chaptersElementIndex;
+    EbmlElement *m_chaptersElement;
+    std::vector<std::unique_ptr<EbmlElement>> m_elements;
+    std::vector<std::uint64_t> m_nextOffsets;
+    std::unique_ptr<MatroskaEditionEntry> m_editionEntry;
+    std::unique_ptr<MatroskaChapter> m_chapter;
+    std::size_t m_depth;
+};
+
+/*!
+ * \brief Returns the current edition entry or nullptr if the cursor is not positioned within an edition entry.
+ * \remarks The chapters() of the returned edition entry are not fetched; they are iterated by the cursor instead.
+ */
+inline const MatroskaEditionEntry *MatroskaChapterCursor::editionEntry() const
+{
+    return m_editionEntry.get();
+}
+
+/*!
+ * \brief Returns the current chapter or nullptr if the cursor is positioned at an edition entry.
+ * \remarks The nested chapters of the returned chapter are fetched but not parsed; they are iterated by the cursor instead.
+ */
+inline const MatroskaChapter *MatroskaChapterCursor::chapter() const
+{
+    return m_chapter.get();
+}
+
+/*!
+ * \brief Returns the nesting depth of the current chapter.
+ *
+ * Chapters directly within an edition entry have a depth of zero, their nested chapters a depth of one and so on.
+ */
+inline std::size_t MatroskaChapterCursor::depth() const
+{
+    return m_depth;
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_MATROSKACHAPTERCURSOR_H
@@ -1,27 +1,42 @@
 #include "./matroskacontainer.h"
 #include "./ebmlid.h"
+#include "./matroskablockcursor.h"
 #include "./matroskacues.h"
 #include "./matroskaeditionentry.h"
 #include "./matroskaid.h"
 #include "./matroskaseekinfo.h"
+#include "./matroskatagid.h"
 
 #include "../backuphelper.h"
+#include "../bytesource.h"
 #include "../exceptions.h"
 #include "../mediafileinfo.h"
+#include "../mediapayloadhash.h"
+#include "../seeklessoutputstream.h"
 
 #include "resources/config.h"
 
+#include <c++utilities/chrono/datetime.h>
+#include <c++utilities/conversion/binaryconversion.h>
 #include <c++utilities/conversion/stringbuilder.h>
 #include <c++utilities/conversion/stringconversion.h>
 
+#ifdef PLATFORM_UNIX
+#include <fcntl.h>
+#endif
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <functional>
 #include <initializer_list>
+#include <iterator>
 #include <limits>
 #include <memory>
 #include <random>
+#include <thread>
+#include <unordered_map>
 #include <unordered_set>
 
 using namespace std;
@@ -35,7 +50,7 @@ namespace TagParser {
  * \brief Implementation of GenericContainer<MediaFileInfo, MatroskaTag, MatroskaTrack, EbmlElement>.
  */
 
-std::uint64_t MatroskaContainer::m_maxFullParseSize = 0x3200000;
+std::atomic<std::uint64_t> MatroskaContainer::m_maxFullParseSize(0x3200000);
 
 /*!
  * \brief Constructs a new container for the specified \a fileInfo at the specified \a startOffset.
@@ -44,7 +59,16 @@ MatroskaContainer::MatroskaContainer(MediaFileInfo &fileInfo, std::uint64_t star
     : GenericContainer<MediaFileInfo, MatroskaTag, MatroskaTrack, EbmlElement>(fileInfo, startOffset)
     , m_maxIdLength(4)
     , m_maxSizeLength(8)
+    , m_masterBufferOffset(0)
     , m_segmentCount(0)
+    , m_indexedTagCount(0)
+    , m_tagIndexRevision(0)
+    , m_streamingIndexValidation(false)
+    , m_indexGeneration(false)
+    , m_finalizing(false)
+    , m_seekHeadReservation(false)
+    , m_tagPatching(false)
+    , m_tagIndexValid(false)
 {
     m_version = 1;
     m_readVersion = 1;
@@ -75,21 +99,910 @@ void MatroskaContainer::reset()
     m_seekInfos.clear();
     m_editionEntries.clear();
     m_attachments.clear();
+    m_tagsByTarget.clear();
+    m_tagIndexValid = false;
     m_segmentCount = 0;
 }
 
+namespace {
+
+/*!
+ * \brief The CuePosition struct holds a position denoted by a "CueTrackPositions"-element.
+ */
+struct CuePosition {
+    /// \brief The start offset of the "CueClusterPosition"-element.
+    std::uint64_t elementOffset = 0;
+    /// \brief The absolute offset of the "Cluster"-element denoted by the "CueClusterPosition"-element.
+    std::uint64_t clusterOffset = 0;
+    /// \brief The position of the "Block"-element relative to the data of the "Cluster"-element.
+    std::uint64_t relativePosition = 0;
+    /// \brief Whether a "CueRelativePosition"-element is present.
+    bool hasRelativePosition = false;
+};
+
+/*!
+ * \brief Validates whether the specified \a cuePosition points to a "Cluster"-element (and to a "Block"-element within it).
+ */
+void validateCuePosition(MatroskaContainer &container, const CuePosition &cuePosition, const string &context, Diagnostics &diag)
+{
+    // validate "Cluster" position denoted by "CueClusterPosition"-element
+    EbmlElement clusterElement(container, cuePosition.clusterOffset);
+    try {
+        clusterElement.parse(diag);
+    } catch (const Failure &) {
+        return;
+    }
+    if (clusterElement.id() != MatroskaIds::Cluster) {
+        diag.emplace_back(DiagLevel::Critical,
+            "\"CueClusterPosition\" element at " % numberToString(cuePosition.elementOffset) + " does not point to \"Cluster\"-element (points to "
+                + numberToString(clusterElement.startOffset()) + ").",
+            context);
+    }
+    if (!cuePosition.hasRelativePosition) {
+        return;
+    }
+    // validate "Block" position denoted by "CueRelativePosition"-element
+    EbmlElement referenceElement(container, clusterElement.dataOffset() + cuePosition.relativePosition);
+    try {
+        referenceElement.parse(diag);
+        switch (referenceElement.id()) {
+        case MatroskaIds::SimpleBlock:
+        case MatroskaIds::Block:
+        case MatroskaIds::BlockGroup:
+            break;
+        default:
+            diag.emplace_back(DiagLevel::Critical,
+                "\"CueRelativePosition\" element does not point to \"Block\"-, \"BlockGroup\", or \"SimpleBlock\"-element (points to "
+                    % numberToString(referenceElement.startOffset())
+                    + ").",
+                context);
+        }
+    } catch (const Failure &) {
+    }
+}
+
+/*!
+ * \brief Reads the track number, the relative timestamp and the flags from the header of the specified \a block.
+ * \remarks The \a block must be a "Block"- or a "SimpleBlock"-element.
+ * \returns Returns whether the header could be read.
+ */
+bool readBlockHeader(EbmlElement &block, std::uint64_t &trackNumber, std::int16_t &relativeTime, std::uint8_t &flags)
+{
+    char buffer[11];
+    const auto size = static_cast<std::size_t>(min<std::uint64_t>(block.dataSize(), sizeof(buffer)));
+    if (size < 4) {
+        return false;
+    }
+    auto &stream = block.stream();
+    stream.seekg(static_cast<std::streamoff>(block.dataOffset()));
+    stream.read(buffer, static_cast<std::streamsize>(size));
+    // read track number which is denoted like an EBML size
+    const auto firstByte = static_cast<std::uint8_t>(buffer[0]);
+    std::uint8_t length = 1;
+    for (std::uint8_t mask = 0x80; length <= 8 && !(firstByte & mask); mask >>= 1, ++length)
+        ;
+    if (size < length + 3u) {
+        return false;
+    }
+    trackNumber = firstByte & (0xFF >> length);
+    for (std::uint8_t i = 1; i < length; ++i) {
+        trackNumber = (trackNumber << 8) | static_cast<std::uint8_t>(buffer[i]);
+    }
+    relativeTime = BE::toInt16(buffer + length);
+    flags = static_cast<std::uint8_t>(buffer[length + 2]);
+    return true;
+}
+
+/*!
+ * \brief Returns whether the specified "SimpleBlock"- or "BlockGroup"-element contains a keyframe.
+ * \remarks The track number and the relative timestamp of the block are stored in \a trackNumber and \a relativeTime.
+ */
+bool isKeyframe(EbmlElement &element, std::uint64_t &trackNumber, std::int16_t &relativeTime, Diagnostics &diag)
+{
+    std::uint8_t flags;
+    switch (element.id()) {
+    case MatroskaIds::SimpleBlock:
+        return readBlockHeader(element, trackNumber, relativeTime, flags) && (flags & 0x80);
+    case MatroskaIds::BlockGroup: {
+        // a "Block"-element is a keyframe if it does not reference any other block
+        bool blockFound = false;
+        for (EbmlElement *child = element.firstChild(); child; child = child->nextSibling()) {
+            child->parse(diag);
+            switch (child->id()) {
+            case MatroskaIds::Block:
+                blockFound = readBlockHeader(*child, trackNumber, relativeTime, flags);
+                break;
+            case MatroskaIds::ReferenceBlock:
+                return false;
+            default:;
+            }
+        }
+        return blockFound;
+    }
+    default:
+        return false;
+    }
+}
+
+/*!
+ * \brief Adds a cue point for the first keyframe of each track within each "Cluster"-element starting from \a cluster
+ *        to \a cuesUpdater.
+ * \remarks Only tracks contained by \a cueTrackNumbers are indexed unless it is empty. The cluster positions are offsets
+ *          within the original file as passed to MatroskaCuePositionUpdater::updateOffsets() by the caller.
+ */
+void collectCuePoints(const EbmlElement &segmentElement, EbmlElement *cluster, std::uint64_t readOffset, const vector<std::uint64_t> &cueTrackNumbers,
+    MatroskaCuePositionUpdater &cuesUpdater, Diagnostics &diag, AbortableProgressFeedback &progress)
+{
+    vector<std::uint64_t> indexedTrackNumbers;
+    std::uint64_t cueTrackNumber, clusterTime, clusterReadSize;
+    std::int16_t relativeTime;
+    for (; cluster; cluster = cluster->siblingById(MatroskaIds::Cluster, diag)) {
+        const auto clusterReadOffset = cluster->startOffset() - segmentElement.dataOffset() + readOffset;
+        clusterTime = clusterReadSize = 0;
+        indexedTrackNumbers.clear();
+        for (EbmlElement *child = cluster->firstChild(); child; clusterReadSize += child->totalSize(), child = child->nextSibling()) {
+            child->parse(diag);
+            if (child->id() == MatroskaIds::Timecode) {
+                clusterTime = child->readUInteger();
+            } else if (isKeyframe(*child, cueTrackNumber, relativeTime, diag)
+                && (cueTrackNumbers.empty() || find(cueTrackNumbers.cbegin(), cueTrackNumbers.cend(), cueTrackNumber) != cueTrackNumbers.cend())
+                && find(indexedTrackNumbers.cbegin(), indexedTrackNumbers.cend(), cueTrackNumber) == indexedTrackNumbers.cend()) {
+                indexedTrackNumbers.emplace_back(cueTrackNumber);
+                cuesUpdater.addCuePoint(relativeTime < 0 && clusterTime < static_cast<std::uint64_t>(-relativeTime)
+                        ? 0
+                        : static_cast<std::uint64_t>(static_cast<std::int64_t>(clusterTime) + relativeTime),
+                    cueTrackNumber, clusterReadOffset, clusterReadSize);
+            }
+        }
+        progress.stopIfAborted();
+    }
+}
+
+/*!
+ * \brief Returns whether the size of the specified \a element is denoted as unknown using 8 bytes within \a stream.
+ * \remarks These are the only unknown sizes which can be replaced with the actual size without moving the data.
+ */
+bool hasUnknownSizeDenotation(istream &stream, const EbmlElement &element)
+{
+    char sizeDenotation[8];
+    if (element.sizeLength() != sizeof(sizeDenotation)) {
+        return false;
+    }
+    stream.seekg(static_cast<streamoff>(element.startOffset() + element.idLength()));
+    stream.read(sizeDenotation, sizeof(sizeDenotation));
+    return BE::toUInt64(sizeDenotation) == 0x01FFFFFFFFFFFFFFu;
+}
+
+/*!
+ * \brief The RawElementHeader struct holds the ID and the size of an EBML element decoded via decodeElementHeader().
+ */
+struct RawElementHeader {
+    /// \brief the ID of the element
+    EbmlElement::IdentifierType id = 0;
+    /// \brief the data size of the element
+    std::uint64_t dataSize = 0;
+    /// \brief the length of the ID and the size denotation
+    std::uint8_t headerSize = 0;
+    /// \brief whether the size is denoted as unknown
+    bool sizeUnknown = false;
+};
+
+/*!
+ * \brief Returns the length of the EBML variable size integer starting with the specified \a firstByte (9 if invalid).
+ */
+std::uint8_t vintLength(std::uint8_t firstByte)
+{
+    std::uint8_t length = 1;
+    for (std::uint8_t mask = 0x80; length <= 8 && !(firstByte & mask); mask >>= 1, ++length)
+        ;
+    return length;
+}
+
+/*!
+ * \brief Returns the big-endian unsigned integer stored in the specified \a size bytes of \a data (at most 8 are taken into account).
+ */
+std::uint64_t decodeUInteger(const char *data, std::uint64_t size)
+{
+    std::uint64_t value = 0;
+    for (const auto *const end = data + min<std::uint64_t>(size, 8); data != end; ++data) {
+        value = (value << 8) | static_cast<std::uint8_t>(*data);
+    }
+    return value;
+}
+
+/*!
+ * \brief Decodes the EBML variable size integer at \a pos within the specified \a size bytes of \a data and advances \a pos.
+ * \returns Returns whether the integer is valid and fits into \a data.
+ */
+bool decodeVint(const char *data, std::uint64_t size, std::uint64_t &pos, std::uint64_t &value, std::uint8_t &length)
+{
+    if (pos >= size || (length = vintLength(static_cast<std::uint8_t>(data[pos]))) > 8 || length > size - pos) {
+        return false;
+    }
+    value = decodeUInteger(data + pos, length) & ((static_cast<std::uint64_t>(1) << (7 * length)) - 1);
+    pos += length;
+    return true;
+}
+
+/*!
+ * \brief Decodes the header of the EBML element at the beginning of the specified \a size bytes of \a data.
+ * \returns Returns whether the header is valid and fits into \a data.
+ * \remarks Unlike EbmlElement::parse() this works without an element tree and is therefore used when validating clusters
+ *          concurrently.
+ */
+bool decodeElementHeader(const char *data, std::uint64_t size, RawElementHeader &header)
+{
+    const auto idLength = size ? vintLength(static_cast<std::uint8_t>(*data)) : std::uint8_t(0);
+    if (!idLength || idLength > 4 || idLength >= size) {
+        return false;
+    }
+    auto pos = static_cast<std::uint64_t>(idLength);
+    std::uint8_t sizeLength;
+    if (!decodeVint(data, size, pos, header.dataSize, sizeLength)) {
+        return false;
+    }
+    header.id = static_cast<EbmlElement::IdentifierType>(decodeUInteger(data, idLength));
+    header.headerSize = static_cast<std::uint8_t>(pos);
+    header.sizeUnknown = header.dataSize == (static_cast<std::uint64_t>(1) << (7 * sizeLength)) - 1;
+    return true;
+}
+
+/*!
+ * \brief The ClusterRange struct holds a range of "Cluster"-elements validated via validateClusterRange() and the results.
+ */
+struct ClusterRange {
+    /// \brief offset of the first "Cluster"-element of the range
+    std::uint64_t begin = 0;
+    /// \brief end offset of the range (the offset of the first "Cluster"-element of the next range or the end of the segment)
+    std::uint64_t end = 0;
+    /// \brief data offset of the segment the range belongs to
+    std::uint64_t segmentDataOffset = 0;
+    /// \brief end offset of the last element which has been validated
+    std::uint64_t validatedEnd = 0;
+    /// \brief total size of the last "Cluster"-element of the range
+    std::uint64_t lastClusterSize = 0;
+    /// \brief offset of the "PrevSize"-element of the first "Cluster"-element of the range (zero if not present)
+    std::uint64_t firstPrevSizeOffset = 0;
+    /// \brief value of the "PrevSize"-element of the first "Cluster"-element of the range
+    std::uint64_t firstPrevSize = 0;
+    /// \brief number of "Cluster"-elements validated
+    std::uint64_t clusterCount = 0;
+    /// \brief default durations of the frames by track number (in the timestamp scale); nullptr if no statistics are computed
+    const std::unordered_map<std::uint64_t, std::uint64_t> *defaultDurations = nullptr;
+    /// \brief statistics of the tracks by track number
+    std::unordered_map<std::uint64_t, MatroskaTrackStatistics> statistics;
+    /// \brief diagnostic messages for the range
+    Diagnostics diag;
+    /// \brief unexpected exception which occurred when validating the range
+    exception_ptr exception;
+};
+
+/*!
+ * \brief Validates the elements within the specified \a range reading from the specified \a source.
+ *
+ * The structure of the "Cluster"-elements and their children, the "Position"- and "PrevSize"-elements and the bounds of
+ * the blocks are validated. The "PrevSize"-element of the first "Cluster"-element is only stored in \a range to be
+ * validated by the caller (as the previous "Cluster"-element belongs to the previous range). If the default durations
+ * are assigned, the statistics of the tracks are accumulated from the headers of the valid blocks.
+ *
+ * \remarks This function only uses positional reads on \a source (and no element tree) so it is called for multiple ranges
+ *          at the same time by MatroskaContainer::validateClusters().
+ */
+void validateClusterRange(ByteSource &source, ClusterRange &range)
+{
+    static const string context("validating Matroska clusters");
+    auto &diag = range.diag;
+    const auto contiguousData = source.contiguousData();
+    auto buffer = string();
+    // returns the specified bytes from the source; they are only valid until the next call
+    const auto bytesAt = [&](std::uint64_t offset, std::uint64_t count) -> const char * {
+        if (!contiguousData.empty()) {
+            return offset <= contiguousData.size() && count <= contiguousData.size() - offset ? contiguousData.data() + offset : nullptr;
+        }
+        buffer.resize(static_cast<std::size_t>(count));
+        return source.read(offset, buffer.data(), buffer.size()) == buffer.size() ? buffer.data() : nullptr;
+    };
+    // returns whether the child of the parent with the specified data is valid; reports it otherwise
+    const auto decodeChild = [&diag](const char *parentData, std::uint64_t parentSize, std::uint64_t pos, std::uint64_t offset,
+                                 RawElementHeader &child, const char *parentName) {
+        if (decodeElementHeader(parentData + pos, parentSize - pos, child) && !child.sizeUnknown
+            && child.dataSize <= parentSize - pos - child.headerSize) {
+            return true;
+        }
+        diag.emplace_back(DiagLevel::Critical,
+            argsToString("The child of the \"", parentName, "\"-element at ", offset, " is invalid or exceeds the \"", parentName, "\"-element."),
+            context);
+        return false;
+    };
+    const auto validateBlockAt = [&diag](const char *data, std::uint64_t size, std::uint64_t offset, const char *blockName, MatroskaBlock &block) {
+        if (const auto *const problem = block.decode(data, size)) {
+            diag.emplace_back(DiagLevel::Critical, argsToString("The \"", blockName, "\"-element at ", offset, ' ', problem, '.'), context);
+            return false;
+        }
+        return true;
+    };
+    // adds the specified block to the statistics of its track; the default duration is used if the block has no duration
+    const auto addBlock = [&range](const MatroskaBlock &block, std::int64_t clusterTimestamp, const std::uint64_t *blockDuration) {
+        if (!range.defaultDurations) {
+            return;
+        }
+        auto duration = std::uint64_t();
+        if (blockDuration) {
+            duration = *blockDuration;
+        } else if (const auto defaultDuration = range.defaultDurations->find(block.trackNumber); defaultDuration != range.defaultDurations->end()) {
+            duration = defaultDuration->second * block.frames.size();
+        }
+        auto &statistics = range.statistics[block.trackNumber];
+        const auto timestamp = clusterTimestamp + block.relativeTimestamp;
+        statistics.frameCount += block.frames.size();
+        statistics.byteCount += block.frameDataSize();
+        statistics.firstTimestamp = min(statistics.firstTimestamp, timestamp);
+        statistics.endTimestamp = max(statistics.endTimestamp, timestamp + static_cast<std::int64_t>(duration));
+    };
+
+    std::uint64_t prevClusterSize = 0;
+    RawElementHeader header, child, blockGroupChild;
+    MatroskaBlock block;
+    for (auto offset = range.validatedEnd = range.begin; offset < range.end; range.validatedEnd = offset) {
+        // decode the header of the level 1 element
+        const auto headerBytes = min<std::uint64_t>(12, range.end - offset);
+        const auto *const headerData = bytesAt(offset, headerBytes);
+        if (!headerData || !decodeElementHeader(headerData, headerBytes, header)) {
+            diag.emplace_back(DiagLevel::Critical, argsToString("Unable to decode the header of the EBML element at ", offset, '.'), context);
+            return;
+        }
+        if (header.sizeUnknown) {
+            diag.emplace_back(DiagLevel::Warning,
+                argsToString("The size of the EBML element at ", offset, " is unknown; the subsequent elements are not validated."), context);
+            return;
+        }
+        if (header.dataSize > range.end - offset - header.headerSize) {
+            diag.emplace_back(DiagLevel::Critical,
+                argsToString("The EBML element at ", offset, " exceeds the end of the segment or the next \"Cluster\"-element denoted by the index."),
+                context);
+            return;
+        }
+        const auto totalSize = header.headerSize + header.dataSize;
+        if (header.id != MatroskaIds::Cluster) {
+            offset += totalSize;
+            continue;
+        }
+
+        // validate the children of the "Cluster"-element
+        // note: The "Timestamp"-element is supposed to be the first child so it precedes the blocks.
+        const auto clusterDataOffset = offset + header.headerSize;
+        auto clusterTimestamp = std::int64_t();
+        const auto *const data = bytesAt(clusterDataOffset, header.dataSize);
+        if (!data) {
+            diag.emplace_back(DiagLevel::Critical, argsToString("Unable to read the \"Cluster\"-element at ", offset, '.'), context);
+            return;
+        }
+        for (std::uint64_t pos = 0; pos < header.dataSize; pos += child.headerSize + child.dataSize) {
+            const auto childOffset = clusterDataOffset + pos;
+            if (!decodeChild(data, header.dataSize, pos, childOffset, child, "Cluster")) {
+                break;
+            }
+            const auto *const childData = data + pos + child.headerSize;
+            switch (child.id) {
+            case MatroskaIds::Timecode:
+                clusterTimestamp = static_cast<std::int64_t>(decodeUInteger(childData, child.dataSize));
+                break;
+            case MatroskaIds::Position:
+                if (const auto position = decodeUInteger(childData, child.dataSize); position && position != offset - range.segmentDataOffset) {
+                    diag.emplace_back(DiagLevel::Critical,
+                        argsToString("\"Position\"-element at ", childOffset, " points to ", position,
+                            " which is not the offset of the containing \"Cluster\"-element."),
+                        context);
+                }
+                break;
+            case MatroskaIds::PrevSize:
+                if (const auto prevSize = decodeUInteger(childData, child.dataSize); !range.clusterCount) {
+                    range.firstPrevSizeOffset = childOffset;
+                    range.firstPrevSize = prevSize;
+                } else if (prevSize != prevClusterSize) {
+                    diag.emplace_back(DiagLevel::Critical,
+                        argsToString("\"PrevSize\"-element at ", childOffset, " should be ", prevClusterSize, " but is ", prevSize, "."), context);
+                }
+                break;
+            case MatroskaIds::SimpleBlock:
+                if (validateBlockAt(childData, child.dataSize, childOffset, "SimpleBlock", block)) {
+                    addBlock(block, clusterTimestamp, nullptr);
+                }
+                break;
+            case MatroskaIds::BlockGroup: {
+                auto blockValid = false, hasBlockDuration = false;
+                auto blockDuration = std::uint64_t();
+                for (std::uint64_t blockGroupPos = 0; blockGroupPos < child.dataSize;
+                     blockGroupPos += blockGroupChild.headerSize + blockGroupChild.dataSize) {
+                    const auto blockGroupChildOffset = childOffset + child.headerSize + blockGroupPos;
+                    if (!decodeChild(childData, child.dataSize, blockGroupPos, blockGroupChildOffset, blockGroupChild, "BlockGroup")) {
+                        break;
+                    }
+                    const auto *const blockGroupChildData = childData + blockGroupPos + blockGroupChild.headerSize;
+                    switch (blockGroupChild.id) {
+                    case MatroskaIds::Block:
+                        blockValid = validateBlockAt(blockGroupChildData, blockGroupChild.dataSize, blockGroupChildOffset, "Block", block);
+                        break;
+                    case MatroskaIds::BlockDuration:
+                        blockDuration = decodeUInteger(blockGroupChildData, blockGroupChild.dataSize);
+                        hasBlockDuration = true;
+                        break;
+                    default:;
+                    }
+                }
+                if (blockValid) {
+                    addBlock(block, clusterTimestamp, hasBlockDuration ? &blockDuration : nullptr);
+                }
+                break;
+            }
+            default:;
+            }
+        }
+        prevClusterSize = range.lastClusterSize = totalSize;
+        ++range.clusterCount;
+        offset += totalSize;
+    }
+}
+
+/*!
+ * \brief Returns the specified \a nanoseconds formatted like mkvmerge formats the "DURATION"-field ("HH:MM:SS.nnnnnnnnn").
+ */
+std::string formatStatisticsDuration(std::uint64_t nanoseconds)
+{
+    const auto pad = [](std::uint64_t value, std::size_t width) {
+        auto digits = numberToString(value);
+        digits.insert(0, digits.size() < width ? width - digits.size() : 0, '0');
+        return digits;
+    };
+    return argsToString(pad(nanoseconds / 3600000000000u, 2), ':', pad(nanoseconds / 60000000000u % 60, 2), ':',
+        pad(nanoseconds / 1000000000u % 60, 2), '.', pad(nanoseconds % 1000000000u, 9));
+}
+
+#ifdef PLATFORM_UNIX
+/*!
+ * \brief The FileDescriptorGuard struct closes the file descriptor it holds when being destroyed.
+ */
+struct FileDescriptorGuard {
+    ~FileDescriptorGuard()
+    {
+        if (fileDescriptor >= 0) {
+            ::close(fileDescriptor);
+        }
+    }
+    int fileDescriptor = -1;
+};
+#endif
+
+} // namespace
+
 /*!
  * \brief Validates the file index (cue entries).
  * \remarks Checks only for cluster positions and missing, unknown or surplus elements.
+ * \remarks Resolves the position of every cue point and walks through all "Cluster"-elements to validate their "Position"-
+ *          and "PrevSize"-elements. This requires a seek per cluster. Use validateIndexSample() to check big files quickly.
  */
 void MatroskaContainer::validateIndex(Diagnostics &diag)
+{
+    internalValidateIndex(diag, numeric_limits<std::size_t>::max());
+}
+
+/*!
+ * \brief Validates the file index (cue entries) by resolving only a random sample of the cue points.
+ *
+ * The structure of all cue points is still validated. However, only a random sample of the cluster and block positions
+ * denoted by the cue points are resolved. The sample size is chosen so that an index of which at least the specified
+ * \a defectRatio of the positions are invalid is detected with the specified \a confidence. For the defaults (95 %
+ * confidence to detect 1 % of invalid positions) only 299 cue points are resolved, regardless of the file size.
+ *
+ * In contrast to validateIndex() the "Position"- and "PrevSize"-elements of the clusters are not validated.
+ *
+ * \remarks A \a confidence of 1 or a \a defectRatio of 0 causes all cue points to be resolved.
+ */
+void MatroskaContainer::validateIndexSample(Diagnostics &diag, double confidence, double defectRatio)
+{
+    std::size_t sampleSize = numeric_limits<std::size_t>::max();
+    if (confidence < 1.0 && defectRatio > 0.0) {
+        // the propability to miss all of the defects when picking n cue points is (1 - defectRatio)^n
+        sampleSize = defectRatio >= 1.0 || confidence <= 0.0
+            ? 1
+            : static_cast<std::size_t>(ceil(log(1.0 - confidence) / log(1.0 - defectRatio)));
+    }
+    internalValidateIndex(diag, sampleSize, false);
+}
+
+/*!
+ * \brief Validates the structure of all "Cluster"-elements concurrently.
+ *
+ * Each segment is split into ranges of clusters at the cluster positions denoted by the "Cues"- and "SeekHead"-elements.
+ * The ranges are validated on \a threadCount threads (or as many as there are hardware threads if zero) using positional
+ * reads from the memory-mapped file or from a file descriptor opened for this purpose. No element tree is built for the
+ * clusters. The following is validated:
+ * - the structure of the level 1 elements and of the children of "Cluster"- and "BlockGroup"-elements (the elements
+ *   must be decodable and must not exceed their parent)
+ * - the "Position"- and "PrevSize"-elements of the clusters
+ * - the bounds of the "SimpleBlock"- and "Block"-elements (header and lacing)
+ *
+ * The results of the ranges are merged into \a diag in file order.
+ *
+ * \remarks
+ * - The header must have been parsed. Only the elements after the first "Cluster"-element of each segment are validated.
+ * - If the file is neither memory-mapped nor can be opened again (e.g. when reading from a byte source), the clusters are
+ *   validated on the calling thread only.
+ * - Cluster positions denoted by the index which do not point to a "Cluster"-element are not used as split points. Use
+ *   validateIndex() to validate the index itself.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+void MatroskaContainer::validateClusters(Diagnostics &diag, std::size_t threadCount)
+{
+    sweepClusters(diag, threadCount, nullptr, nullptr);
+}
+
+/*!
+ * \brief Adds the data of the "SimpleBlock"- and "BlockGroup"-elements within the "Cluster"-elements of all segments to
+ *        the specified \a hasher.
+ *
+ * The other children of the "Cluster"-elements are not included because the "Position"- and "PrevSize"-elements change
+ * when the clusters are moved. The "Cluster"-elements are read once in file order; their children are decoded via the
+ * raw element headers (without an element tree).
+ *
+ * \throws Throws InvalidDataException if the structure of the clusters is invalid or a "Cluster"-element has an
+ *         unknown size (the hash would not cover the whole payload).
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+void MatroskaContainer::hashMediaPayload(MediaPayloadHasher &hasher, Diagnostics &diag, AbortableProgressFeedback &progress)
+{
+    static const string context("hashing media payload of Matroska container");
+    if (!m_firstElement) {
+        return;
+    }
+    auto &stream = this->stream();
+    auto buffer = string();
+    RawElementHeader header, child;
+    for (EbmlElement *segmentElement = m_firstElement->siblingById(MatroskaIds::Segment, diag); segmentElement;
+         segmentElement = segmentElement->siblingById(MatroskaIds::Segment, diag)) {
+        segmentElement->parse(diag);
+        const auto segmentEnd = min(segmentElement->endOffset(), fileInfo().size());
+        const auto *const firstClusterElement = segmentElement->childById(MatroskaIds::Cluster, diag);
+        if (!firstClusterElement) {
+            continue;
+        }
+        for (auto offset = firstClusterElement->startOffset(); offset < segmentEnd; offset += header.headerSize + header.dataSize) {
+            progress.stopIfAborted();
+            // decode the header of the level 1 element
+            buffer.resize(static_cast<std::size_t>(min<std::uint64_t>(12, segmentEnd - offset)));
+            stream.seekg(static_cast<streamoff>(offset));
+            stream.read(buffer.data(), static_cast<streamsize>(buffer.size()));
+            if (!decodeElementHeader(buffer.data(), buffer.size(), header) || header.sizeUnknown
+                || header.dataSize > segmentEnd - offset - header.headerSize) {
+                diag.emplace_back(DiagLevel::Critical,
+                    argsToString("Unable to determine the size of the EBML element at ", offset, "; the subsequent media payload can not be hashed."),
+                    context);
+                throw InvalidDataException();
+            }
+            if (header.id != MatroskaIds::Cluster) {
+                continue;
+            }
+
+            // read the "Cluster"-element at once and add the blocks
+            buffer.resize(static_cast<std::size_t>(header.dataSize));
+            stream.seekg(static_cast<streamoff>(offset + header.headerSize));
+            stream.read(buffer.data(), static_cast<streamsize>(buffer.size()));
+            for (std::uint64_t pos = 0; pos < header.dataSize; pos += child.headerSize + child.dataSize) {
+                if (!decodeElementHeader(buffer.data() + pos, header.dataSize - pos, child) || child.sizeUnknown
+                    || child.dataSize > header.dataSize - pos - child.headerSize) {
+                    diag.emplace_back(DiagLevel::Critical,
+                        argsToString("The child of the \"Cluster\"-element at ", offset, " is invalid or exceeds the \"Cluster\"-element."), context);
+                    throw InvalidDataException();
+                }
+                if (child.id == MatroskaIds::SimpleBlock || child.id == MatroskaIds::BlockGroup) {
+                    hasher.add(buffer.data() + pos + child.headerSize, static_cast<std::size_t>(child.dataSize));
+                }
+            }
+            progress.updateStepPercentage(static_cast<std::uint8_t>(offset * 100 / fileInfo().size()));
+        }
+    }
+}
+
+/*!
+ * \brief Validates the "Cluster"-elements as described for validateClusters().
+ *
+ * If \a defaultDurations is not nullptr, the statistics of the tracks of the first segment are accumulated into
+ * \a statistics by track number as well.
+ */
+void MatroskaContainer::sweepClusters(Diagnostics &diag, std::size_t threadCount,
+    const std::unordered_map<std::uint64_t, std::uint64_t> *defaultDurations, std::unordered_map<std::uint64_t, MatroskaTrackStatistics> *statistics)
+{
+    static const string context("validating Matroska clusters");
+    if (!m_firstElement) {
+        return;
+    }
+
+    // determine how to read the clusters
+    // -> use positional reads on the memory-mapped file or on a file descriptor of its own so the ranges can be validated
+    //    concurrently
+    auto source = unique_ptr<ByteSource>();
+    auto concurrent = true;
+#ifdef PLATFORM_UNIX
+    auto fileDescriptor = FileDescriptorGuard();
+#endif
+    if (const auto mapping = mappedData(); !mapping.empty()) {
+        source = make_unique<MemoryByteSource>(mapping);
+#ifdef PLATFORM_UNIX
+    } else if (!fileInfo().hasByteSource() && !fileInfo().path().empty()
+        && (fileDescriptor.fileDescriptor = ::open(BasicFileInfo::pathForOpen(fileInfo().path()), O_RDONLY | O_CLOEXEC)) >= 0) {
+        source = make_unique<FileDescriptorByteSource>(fileDescriptor.fileDescriptor);
+#endif
+    } else {
+        source = make_unique<BufferedRangeByteSource>(stream(), 0, 0);
+        concurrent = false;
+    }
+    threadCount = concurrent ? (threadCount ? threadCount : max<std::size_t>(thread::hardware_concurrency(), 1)) : 1;
+
+    // split the segments into ranges at the cluster positions denoted by the "Cues"- and "SeekHead"-elements
+    auto ranges = vector<ClusterRange>();
+    auto clusterOffsets = vector<std::uint64_t>();
+    auto cuesElements = vector<EbmlElement *>();
+    auto additionalElements = vector<unique_ptr<EbmlElement>>();
+    for (EbmlElement *segmentElement = m_firstElement->siblingById(MatroskaIds::Segment, diag); segmentElement;
+         segmentElement = segmentElement->siblingById(MatroskaIds::Segment, diag)) {
+        segmentElement->parse(diag);
+        const auto segmentDataOffset = segmentElement->dataOffset();
+        const auto segmentEnd = min(segmentElement->endOffset(), fileInfo().size());
+        // locate the first "Cluster"-element and the "Cues"-elements in front of it
+        EbmlElement *firstClusterElement = nullptr;
+        cuesElements.clear();
+        clusterOffsets.clear();
+        try {
+            for (EbmlElement *child = segmentElement->firstChild(); child && !firstClusterElement; child = child->nextSibling()) {
+                child->parse(diag);
+                switch (child->id()) {
+                case MatroskaIds::Cues:
+                    cuesElements.emplace_back(child);
+                    break;
+                case MatroskaIds::Cluster:
+                    firstClusterElement = child;
+                    break;
+                default:;
+                }
+            }
+        } catch (const Failure &) {
+            diag.emplace_back(DiagLevel::Critical, "Unable to locate the first \"Cluster\"-element.", context);
+        }
+        if (!firstClusterElement) {
+            continue;
+        }
+        // take the "Cues"- and "Cluster"-elements denoted by the seek information of the segment into account
+        const auto firstClusterOffset = firstClusterElement->startOffset();
+        for (const auto &seekInfo : m_seekInfos) {
+            if (seekInfo->seekHeadElements().empty() || seekInfo->seekHeadElements().front()->parent() != segmentElement) {
+                continue;
+            }
+            for (const auto &[id, position] : seekInfo->info()) {
+                const auto offset = segmentDataOffset + position;
+                if (offset <= firstClusterOffset || offset >= segmentEnd) {
+                    continue;
+                }
+                if (id == MatroskaIds::Cluster) {
+                    clusterOffsets.emplace_back(offset);
+                } else if (id == MatroskaIds::Cues) {
+                    cuesElements.emplace_back(additionalElements.emplace_back(make_unique<EbmlElement>(*this, offset)).get());
+                }
+            }
+        }
+        for (auto *const cuesElement : cuesElements) {
+            try {
+                cuesElement->parse(diag);
+                if (cuesElement->id() != MatroskaIds::Cues) {
+                    continue;
+                }
+                for (EbmlElement *cuePoint = cuesElement->firstChild(); cuePoint; cuePoint = cuePoint->nextSibling()) {
+                    cuePoint->parse(diag);
+                    for (EbmlElement *cuePointChild = cuePoint->id() == MatroskaIds::CuePoint ? cuePoint->firstChild() : nullptr; cuePointChild;
+                         cuePointChild = cuePointChild->nextSibling()) {
+                        cuePointChild->parse(diag);
+                        for (EbmlElement *positionElement
+                             = cuePointChild->id() == MatroskaIds::CueTrackPositions ? cuePointChild->firstChild() : nullptr;
+                             positionElement; positionElement = positionElement->nextSibling()) {
+                            positionElement->parse(diag);
+                            if (positionElement->id() == MatroskaIds::CueClusterPosition) {
+                                clusterOffsets.emplace_back(segmentDataOffset + positionElement->readUInteger());
+                            }
+                        }
+                    }
+                }
+            } catch (const Failure &) {
+                diag.emplace_back(DiagLevel::Warning,
+                    argsToString("Unable to parse the \"Cues\"-element at ", cuesElement->startOffset(), "; not using it to split the clusters."),
+                    context);
+            }
+        }
+        // pick split points evenly so each thread gets multiple ranges (to balance ranges of different sizes)
+        sort(clusterOffsets.begin(), clusterOffsets.end());
+        clusterOffsets.erase(unique(clusterOffsets.begin(), clusterOffsets.end()), clusterOffsets.end());
+        clusterOffsets.erase(remove_if(clusterOffsets.begin(), clusterOffsets.end(),
+                                 [&](std::uint64_t offset) { return offset <= firstClusterOffset || offset >= segmentEnd; }),
+            clusterOffsets.end());
+        const auto step = threadCount > 1 ? max<std::size_t>(clusterOffsets.size() / (threadCount * 4), 1) : clusterOffsets.size() + 1;
+        auto rangeBegin = firstClusterOffset;
+        for (auto i = step - 1; i < clusterOffsets.size(); i += step) {
+            const auto offset = clusterOffsets[i];
+            char id[4];
+            if (source->read(offset, id, sizeof(id)) != sizeof(id) || BE::toUInt32(id) != MatroskaIds::Cluster) {
+                diag.emplace_back(DiagLevel::Warning,
+                    argsToString("The cluster position ", offset, " denoted by the index does not point to a \"Cluster\"-element."), context);
+                continue;
+            }
+            auto &range = ranges.emplace_back();
+            range.begin = rangeBegin;
+            range.end = rangeBegin = offset;
+            range.segmentDataOffset = segmentDataOffset;
+        }
+        auto &range = ranges.emplace_back();
+        range.begin = rangeBegin;
+        range.end = segmentEnd;
+        range.segmentDataOffset = segmentDataOffset;
+    }
+    if (defaultDurations && statistics) {
+        for (auto &range : ranges) {
+            if (range.segmentDataOffset == ranges.front().segmentDataOffset) {
+                range.defaultDurations = defaultDurations;
+            }
+        }
+    }
+
+    // validate the ranges concurrently
+    threadCount = min(threadCount, ranges.size());
+    auto nextRange = atomic<std::size_t>(0);
+    const auto work = [&] {
+        for (auto i = nextRange++; i < ranges.size(); i = nextRange++) {
+            auto &range = ranges[i];
+            range.diag.setFlags(diag.flags());
+            range.diag.setLevelThreshold(diag.levelThreshold());
+            try {
+                validateClusterRange(*source, range);
+            } catch (...) {
+                range.exception = current_exception();
+            }
+        }
+    };
+    auto workers = vector<thread>();
+    workers.reserve(threadCount > 1 ? threadCount - 1 : 0);
+    for (auto i = std::size_t(1); i < threadCount; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    // merge the results in file order
+    // -> validate the "PrevSize"-element of the first cluster of each range against the last cluster of the previous range
+    std::uint64_t clusterCount = 0;
+    for (auto i = ranges.begin(), end = ranges.end(); i != end; ++i) {
+        for (auto &message : i->diag) {
+            diag.push_back(std::move(message));
+        }
+        if (i->exception) {
+            rethrow_exception(i->exception);
+        }
+        clusterCount += i->clusterCount;
+        for (const auto &[trackNumber, rangeStatistics] : i->statistics) {
+            auto &trackStatistics = (*statistics)[trackNumber];
+            trackStatistics.frameCount += rangeStatistics.frameCount;
+            trackStatistics.byteCount += rangeStatistics.byteCount;
+            trackStatistics.firstTimestamp = min(trackStatistics.firstTimestamp, rangeStatistics.firstTimestamp);
+            trackStatistics.endTimestamp = max(trackStatistics.endTimestamp, rangeStatistics.endTimestamp);
+        }
+        if (i == ranges.begin() || !i->firstPrevSizeOffset) {
+            continue;
+        }
+        const auto &previous = *(i - 1);
+        if (previous.segmentDataOffset == i->segmentDataOffset && previous.validatedEnd == i->begin && previous.clusterCount
+            && previous.lastClusterSize != i->firstPrevSize) {
+            diag.emplace_back(DiagLevel::Critical,
+                argsToString("\"PrevSize\"-element at ", i->firstPrevSizeOffset, " should be ", previous.lastClusterSize, " but is ",
+                    i->firstPrevSize, "."),
+                context);
+        }
+    }
+    diag.emplace_back(DiagLevel::Information,
+        argsToString(
+            "Validated ", clusterCount, " clusters split into ", ranges.size(), " ranges on ", max<std::size_t>(threadCount, 1), " threads."),
+        context);
+}
+
+/*!
+ * \brief Computes the statistics of the tracks from the headers of their blocks and stores them in the tags targeting the tracks.
+ *
+ * The "Cluster"-elements are swept concurrently like validateClusters() does (so defects are reported as well). Only the
+ * headers of the blocks (track number, timestamp, lacing and size) are decoded; the frames are not read. The fields
+ * "BPS", "DURATION", "NUMBER_OF_FRAMES" and "NUMBER_OF_BYTES" (and the fields describing the statistics) are set like
+ * mkvmerge sets them within the tag with the target type value 50 targeting only the track. The tag is created if it does not
+ * exist yet. So the statistics are written when applying changes as usual. The track information (e.g. AbstractTrack::size())
+ * is updated from the new statistics.
+ *
+ * \remarks
+ * - Tags and tracks must have been parsed before calling this method.
+ * - Only blocks of the first segment are taken into account.
+ * - The duration of a block is denoted by its "BlockDuration"-element or by the "DefaultDuration"-element of its track.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+void MatroskaContainer::generateTrackStatistics(Diagnostics &diag, std::size_t threadCount)
+{
+    static const string context("generating track statistics of Matroska container");
+    if (!m_firstElement) {
+        return;
+    }
+
+    // determine the timestamp scale of the segment and the default durations of the tracks in that scale
+    std::uint64_t timestampScale = 1000000;
+    try {
+        if (!m_segmentInfoElements.empty()) {
+            if (auto *const timestampScaleElement = m_segmentInfoElements.front()->childById(MatroskaIds::TimeCodeScale, diag)) {
+                timestampScale = max<std::uint64_t>(timestampScaleElement->readUInteger(), 1);
+            }
+        }
+    } catch (const Failure &) {
+        diag.emplace_back(DiagLevel::Warning, "Unable to read the timestamp scale; assuming the default.", context);
+    }
+    auto defaultDurations = unordered_map<std::uint64_t, std::uint64_t>();
+    for (const auto &track : tracks()) {
+        try {
+            if (auto *const defaultDurationElement = track->m_trackElement->childById(MatroskaIds::DefaultDuration, diag)) {
+                defaultDurations[track->trackNumber()] = (defaultDurationElement->readUInteger() + timestampScale / 2) / timestampScale;
+            }
+        } catch (const Failure &) {
+            diag.emplace_back(DiagLevel::Warning, argsToString("Unable to read the default duration of track ", track->trackNumber(), '.'), context);
+        }
+    }
+
+    // sweep the clusters
+    auto statistics = unordered_map<std::uint64_t, MatroskaTrackStatistics>();
+    sweepClusters(diag, threadCount, &defaultDurations, &statistics);
+
+    // set the fields within the tags targeting the tracks
+    using namespace MatroskaTagIds::TrackSpecific;
+    const auto writingApp = fileInfo().writingApplication().empty() ? string(APP_NAME " v" APP_VERSION) : string(fileInfo().writingApplication());
+    const auto writingDateUtc = DateTime::gmtNow().toString(DateTimeOutputFormat::DateAndTime, true);
+    std::size_t trackCount = 0;
+    for (const auto &track : tracks()) {
+        const auto trackStatistics = statistics.find(track->trackNumber());
+        if (trackStatistics == statistics.end() || !trackStatistics->second.frameCount) {
+            continue;
+        }
+        const auto &[frameCount, byteCount, firstTimestamp, endTimestamp] = trackStatistics->second;
+        const auto duration = endTimestamp > firstTimestamp ? static_cast<std::uint64_t>(endTimestamp - firstTimestamp) * timestampScale : 0u;
+        const auto bitrate
+            = duration ? static_cast<std::uint64_t>(static_cast<double>(byteCount) * 8.0 * 1e9 / static_cast<double>(duration) + 0.5) : 0u;
+        auto target = TagTarget(50, { track->id() });
+        target.setLevelName("MOVIE");
+        auto *const tag = createTag(target);
+        tag->setValue(MatroskaTagIds::TrackSpecific::bitrate(), TagValue(numberToString(bitrate)));
+        tag->setValue(MatroskaTagIds::TrackSpecific::duration(), TagValue(formatStatisticsDuration(duration)));
+        tag->setValue(numberOfFrames(), TagValue(numberToString(frameCount)));
+        tag->setValue(numberOfBytes(), TagValue(numberToString(byteCount)));
+        tag->setValue(MatroskaTagIds::TrackSpecific::writingApp(), TagValue(writingApp));
+        tag->setValue(writingDate(), TagValue(writingDateUtc));
+        tag->setValue(statisticsTags(), TagValue("BPS DURATION NUMBER_OF_FRAMES NUMBER_OF_BYTES"s));
+        track->readStatisticsFromTag(*tag, diag);
+        ++trackCount;
+    }
+    diag.emplace_back(DiagLevel::Information, argsToString("Generated the statistics of ", trackCount, " tracks."), context);
+}
+
+/*!
+ * \brief Validates the file index (cue entries) resolving at most the specified number of cue points.
+ * \remarks If not all cue points are resolved, a random sample is picked.
+ */
+void MatroskaContainer::internalValidateIndex(Diagnostics &diag, std::size_t sampleSize, bool validateClusters)
 {
     static const string context("validating Matroska file index (cues)");
     bool cuesElementsFound = false;
     if (m_firstElement) {
         unordered_set<EbmlElement::IdentifierType> ids;
         bool cueTimeFound = false, cueTrackPositionsFound = false;
-        unique_ptr<EbmlElement> clusterElement;
+        vector<CuePosition> cuePositions;
+        CuePosition cuePosition;
         std::uint64_t pos, prevClusterSize = 0, currentOffset = 0;
         // iterate throught all segments
         for (EbmlElement *segmentElement = m_firstElement->siblingById(MatroskaIds::Segment, diag); segmentElement;
@@ -132,7 +1045,7 @@ void MatroskaContainer::validateIndex(Diagnostics &diag)
                                 case MatroskaIds::CueTrackPositions:
                                     cueTrackPositionsFound = true;
                                     ids.clear();
-                                    clusterElement.reset();
+                                    cuePosition = CuePosition();
                                     for (EbmlElement *subElement = cuePointChildElement->firstChild(); subElement;
                                          subElement = subElement->nextSibling()) {
                                         subElement->parse(diag);
@@ -167,24 +1080,13 @@ void MatroskaContainer::validateIndex(Diagnostics &diag)
                                         case MatroskaIds::CueTrack:
                                             break;
                                         case MatroskaIds::CueClusterPosition:
-                                            // validate "Cluster" position denoted by "CueClusterPosition"-element
-                                            clusterElement = make_unique<EbmlElement>(
-                                                *this, segmentElement->dataOffset() + subElement->readUInteger() - currentOffset);
-                                            try {
-                                                clusterElement->parse(diag);
-                                                if (clusterElement->id() != MatroskaIds::Cluster) {
-                                                    diag.emplace_back(DiagLevel::Critical,
-                                                        "\"CueClusterPosition\" element at " % numberToString(subElement->startOffset())
-                                                            + " does not point to \"Cluster\"-element (points to "
-                                                            + numberToString(clusterElement->startOffset()) + ").",
-                                                        context);
-                                                }
-                                            } catch (const Failure &) {
-                                            }
+                                            // read "Cluster" position denoted by "CueClusterPosition"-element (resolved later)
+                                            cuePosition.elementOffset = subElement->startOffset();
+                                            cuePosition.clusterOffset = segmentElement->dataOffset() + subElement->readUInteger() - currentOffset;
                                             break;
                                         case MatroskaIds::CueRelativePosition:
-                                            // read "Block" position denoted by "CueRelativePosition"-element (validate later since the "Cluster"-element is needed to validate)
-                                            pos = subElement->readUInteger();
+                                            // read "Block" position denoted by "CueRelativePosition"-element (resolved later)
+                                            cuePosition.relativePosition = subElement->readUInteger();
                                             break;
                                         case MatroskaIds::CueDuration:
                                             break;
@@ -202,29 +1104,12 @@ void MatroskaContainer::validateIndex(Diagnostics &diag)
                                         diag.emplace_back(DiagLevel::Warning,
                                             "\"CueTrackPositions\"-element does not contain mandatory element \"CueTrack\".", context);
                                     }
-                                    if (!clusterElement) {
+                                    if (!ids.count(MatroskaIds::CueClusterPosition)) {
                                         diag.emplace_back(DiagLevel::Warning,
                                             "\"CueTrackPositions\"-element does not contain mandatory element \"CueClusterPosition\".", context);
-                                    } else if (ids.count(MatroskaIds::CueRelativePosition)) {
-                                        // validate "Block" position denoted by "CueRelativePosition"-element
-                                        EbmlElement referenceElement(*this, clusterElement->dataOffset() + pos);
-                                        try {
-                                            referenceElement.parse(diag);
-                                            switch (referenceElement.id()) {
-                                            case MatroskaIds::SimpleBlock:
-                                            case MatroskaIds::Block:
-                                            case MatroskaIds::BlockGroup:
-                                                break;
-                                            default:
-                                                diag.emplace_back(DiagLevel::Critical,
-                                                    "\"CueRelativePosition\" element does not point to \"Block\"-, \"BlockGroup\", or "
-                                                    "\"SimpleBlock\"-element (points to "
-                                                            % numberToString(referenceElement.startOffset())
-                                                        + ").",
-                                                    context);
-                                            }
-                                        } catch (const Failure &) {
-                                        }
+                                    } else {
+                                        cuePosition.hasRelativePosition = ids.count(MatroskaIds::CueRelativePosition);
+                                        cuePositions.emplace_back(cuePosition);
                                     }
                                     break;
                                 case EbmlIds::Crc32:
@@ -250,6 +1135,9 @@ void MatroskaContainer::validateIndex(Diagnostics &diag)
                     }
                     break;
                 case MatroskaIds::Cluster:
+                    if (!validateClusters) {
+                        break;
+                    }
                     // parse children of "Cluster"-element
                     for (EbmlElement *clusterElementChild = segmentChildElement->firstChild(); clusterElementChild;
                          clusterElementChild = clusterElementChild->nextSibling()) {
@@ -287,6 +1175,18 @@ void MatroskaContainer::validateIndex(Diagnostics &diag)
             }
             currentOffset += segmentElement->totalSize();
         }
+        // resolve the positions denoted by the cue points (or a random sample of them)
+        if (cuePositions.size() > sampleSize) {
+            vector<CuePosition> sample;
+            sample.reserve(sampleSize);
+            std::sample(cuePositions.cbegin(), cuePositions.cend(), back_inserter(sample), sampleSize, mt19937(random_device()()));
+            cuePositions.swap(sample);
+            diag.emplace_back(DiagLevel::Information,
+                argsToString("Resolving only a random sample of ", cuePositions.size(), " cue points."), context);
+        }
+        for (const auto &position : cuePositions) {
+            validateCuePosition(*this, position, context, diag);
+        }
     }
     // add a warning when no index could be found
     if (!cuesElementsFound) {
@@ -311,6 +1211,189 @@ inline bool excludesOffset(const vector<EbmlElement *> &elements, std::uint64_t
     return find_if(elements.cbegin(), elements.cend(), std::bind(sameOffset, offset, _1)) == elements.cend();
 }
 
+/*!
+ * \brief Returns a hash of the specified \a target which is consistent with TagTarget::operator==().
+ */
+std::size_t hashTagTarget(const TagTarget &target)
+{
+    auto hash = std::hash<std::uint64_t>()(target.level());
+    const auto combine = [&hash](std::uint64_t value) {
+        hash ^= std::hash<std::uint64_t>()(value) + 0x9E3779B97F4A7C15u + (hash << 6) + (hash >> 2);
+    };
+    for (const auto *const ids : { &target.tracks(), &target.chapters(), &target.editions(), &target.attachments() }) {
+        combine(ids->size());
+        for (const auto id : *ids) {
+            combine(id);
+        }
+    }
+    return hash;
+}
+
+/*!
+ * \brief The TopLevelElements struct references the lists the top-level elements of segments are gathered in.
+ * \remarks This struct is used when parsing the header to gather the elements either directly within the container or
+ *          within a MatroskaContainer::SegmentHeader when parsing segments concurrently.
+ */
+struct TopLevelElements {
+    vector<EbmlElement *> &tracksElements;
+    vector<EbmlElement *> &segmentInfoElements;
+    vector<EbmlElement *> &tagsElements;
+    vector<EbmlElement *> &chaptersElements;
+    vector<EbmlElement *> &attachmentsElements;
+    vector<unique_ptr<EbmlElement>> &additionalElements;
+};
+
+/*!
+ * \brief Parses the elements denoted by the specified \a seekInfo and adds them to the corresponding lists of \a elements.
+ * \remarks The positions of \a seekInfo are relative to \a segmentOffset. Elements which have already been gathered are
+ *          not added again.
+ */
+void parseElementsDenotedBySeekInfo(
+    MatroskaContainer &container, const MatroskaSeekInfo &seekInfo, std::uint64_t segmentOffset, TopLevelElements &elements, Diagnostics &diag)
+{
+    static const string context("parsing header of Matroska container");
+    for (const auto &infoPair : seekInfo.info()) {
+        std::uint64_t offset = segmentOffset + infoPair.second;
+        if (offset >= container.fileInfo().size()) {
+            diag.emplace_back(DiagLevel::Critical, argsToString("Offset (", offset, ") denoted by \"SeekHead\" element is invalid."), context);
+            continue;
+        }
+        auto element = make_unique<EbmlElement>(container, offset);
+        try {
+            element->parse(diag);
+            if (element->id() != infoPair.first) {
+                diag.emplace_back(DiagLevel::Critical,
+                    argsToString("ID of element ", element->idToString(), " at ", offset,
+                        " does not match the ID denoted in the \"SeekHead\" element (0x", numberToString(infoPair.first, 16), ")."),
+                    context);
+            }
+            vector<EbmlElement *> *list = nullptr;
+            switch (element->id()) {
+            case MatroskaIds::SegmentInfo:
+                list = &elements.segmentInfoElements;
+                break;
+            case MatroskaIds::Tracks:
+                list = &elements.tracksElements;
+                break;
+            case MatroskaIds::Tags:
+                list = &elements.tagsElements;
+                break;
+            case MatroskaIds::Chapters:
+                list = &elements.chaptersElements;
+                break;
+            case MatroskaIds::Attachments:
+                list = &elements.attachmentsElements;
+                break;
+            default:;
+            }
+            if (list && excludesOffset(*list, offset)) {
+                if (container.fileInfo().parsingFlags() & ParsingFlags::VerifyCrc32Checksums) {
+                    element->verifyCrc32(diag);
+                }
+                elements.additionalElements.emplace_back(move(element));
+                list->emplace_back(elements.additionalElements.back().get());
+            }
+        } catch (const Failure &) {
+            diag.emplace_back(
+                DiagLevel::Critical, argsToString("Can not parse element at ", offset, " (denoted using \"SeekHead\" element)."), context);
+        }
+    }
+}
+
+/*!
+ * \brief Returns the tag with the specified \a target or creates a new one if there is no such tag.
+ *
+ * Unlike GenericContainer::createTag() the existing tag is looked up via tagByTarget() so creating tags for many
+ * targets (e.g. for each track) does not need to compare the targets of all present tags each time.
+ */
+MatroskaTag *MatroskaContainer::createTag(const TagTarget &target)
+{
+    // check whether a tag matching the specified target is already assigned
+    if (!m_tags.empty()) {
+        if (target.isEmpty()) {
+            return m_tags.front().get();
+        }
+        if (auto *const tag = tagByTarget(target)) {
+            return tag;
+        }
+    }
+
+    // create a new tag and add it to the index if the index is up-to-date
+    const auto revision = Tag::targetRevision();
+    const auto indexUpToDate = m_tagIndexValid && m_tagIndexRevision == revision && m_indexedTagCount == m_tags.size();
+    auto *const tag = m_tags.emplace_back(make_unique<MatroskaTag>()).get();
+    tag->setTarget(target);
+    if (indexUpToDate) {
+        m_tagsByTarget.emplace(hashTagTarget(target), tag);
+        m_tagIndexRevision = Tag::targetRevision();
+        ++m_indexedTagCount;
+    }
+    return tag;
+}
+
+bool MatroskaContainer::removeTag(Tag *tag)
+{
+    // invalidate the index because another tag with the same target might be present
+    m_tagIndexValid = false;
+    return GenericContainer<MediaFileInfo, MatroskaTag, MatroskaTrack, EbmlElement>::removeTag(tag);
+}
+
+void MatroskaContainer::removeAllTags()
+{
+    GenericContainer<MediaFileInfo, MatroskaTag, MatroskaTrack, EbmlElement>::removeAllTags();
+    m_tagsByTarget.clear();
+    m_indexedTagCount = 0;
+    m_tagIndexRevision = Tag::targetRevision();
+    m_tagIndexValid = true;
+}
+
+/*!
+ * \brief Returns the first tag with the specified \a target or nullptr if there is no such tag.
+ *
+ * The tags are looked up via an index by target which is built on the first call and maintained when creating and
+ * removing tags. So looking up e.g. the tags for particular tracks of multi-track files takes constant time.
+ *
+ * \remarks The index is rebuilt automatically when the target of any tag has been changed via Tag::setTarget() or
+ *          tags have been added to or removed from tags() directly.
+ */
+MatroskaTag *MatroskaContainer::tagByTarget(const TagTarget &target)
+{
+    updateTagIndex();
+    for (auto [i, end] = m_tagsByTarget.equal_range(hashTagTarget(target)); i != end; ++i) {
+        if (i->second->target() == target) {
+            return i->second;
+        }
+    }
+    return nullptr;
+}
+
+/*!
+ * \brief Builds the index used by tagByTarget() if it is not up-to-date.
+ * \remarks Only the first tag of each target is indexed so tagByTarget() behaves like comparing the targets in order.
+ */
+void MatroskaContainer::updateTagIndex()
+{
+    const auto revision = Tag::targetRevision();
+    if (m_tagIndexValid && m_tagIndexRevision == revision && m_indexedTagCount == m_tags.size()) {
+        return;
+    }
+    m_tagsByTarget.clear();
+    m_tagsByTarget.reserve(m_tags.size());
+    for (const auto &tag : m_tags) {
+        const auto hash = hashTagTarget(tag->target());
+        auto indexed = false;
+        for (auto [i, end] = m_tagsByTarget.equal_range(hash); i != end && !indexed; ++i) {
+            indexed = i->second->target() == tag->target();
+        }
+        if (!indexed) {
+            m_tagsByTarget.emplace(hash, tag.get());
+        }
+    }
+    m_indexedTagCount = m_tags.size();
+    m_tagIndexRevision = revision;
+    m_tagIndexValid = true;
+}
+
 MatroskaChapter *MatroskaContainer::chapter(std::size_t index)
 {
     for (const auto &entry : m_editionEntries) {
@@ -411,64 +1494,63 @@ void MatroskaContainer::internalParseHeader(Diagnostics &diag)
     m_segmentCount = 0;
     std::uint64_t currentOffset = 0;
     vector<MatroskaSeekInfo>::difference_type seekInfosIndex = 0;
+    std::uint64_t firstClusterOffset = 0, clusterCount = 0;
+    auto elements = TopLevelElements{ m_tracksElements, m_segmentInfoElements, m_tagsElements, m_chaptersElements, m_attachmentsElements,
+        m_additionalElements };
+
+    // measure the time elements take to be parsed to decide adaptively whether walking through all clusters is worthwhile
+    const auto parsingStart = chrono::steady_clock::now();
+    std::uint64_t elementsParsed = 0;
+
+    // walk through the elements in order without following "SeekHead"-elements if the input is forward-only
+    // note: The size of the stream might only be known when its end has been reached (running into it is not an error).
+    const auto forwardOnly = fileInfo().isForwardOnly();
+    const auto isEndOfStream = [&, this](const EbmlElement &element) {
+        return forwardOnly && element.startOffset() >= fileInfo().byteSource()->size();
+    };
+    // -> keep the elements which are parsed later available after walking beyond them
+    const auto retain = [&, this](const EbmlElement &element) {
+        if (forwardOnly && !fileInfo().byteSource()->retain(element.startOffset(), element.totalSize())) {
+            diag.emplace_back(DiagLevel::Warning,
+                argsToString("Unable to keep element at ", element.startOffset(), " as the lookbehind size of the input is exceeded."), context);
+        }
+    };
+
+    // verify the checksums of level 1 elements if enabled (not possible if the input is forward-only)
+    const auto verifyChecksums = !forwardOnly && (fileInfo().parsingFlags() & ParsingFlags::VerifyCrc32Checksums);
+
+    // parse the segments concurrently if enabled and possible
+    const auto maxParsingOffset = fileInfo().maxParsingOffset();
+    const auto seekHeadFirst = fileInfo().matroskaParseStrategy() == MatroskaParseStrategy::SeekHeadFirst;
+    if (parseSegmentsConcurrently(diag)) {
+        goto finish;
+    }
 
     // loop through all top level elements
     for (EbmlElement *topLevelElement = m_firstElement.get(); topLevelElement; topLevelElement = topLevelElement->nextSibling()) {
+        if (maxParsingOffset && topLevelElement->startOffset() >= maxParsingOffset) {
+            goto maxParsingOffsetReached;
+        }
         try {
             topLevelElement->parse(diag);
+            ++elementsParsed;
             switch (topLevelElement->id()) {
             case EbmlIds::Header:
-                for (EbmlElement *subElement = topLevelElement->firstChild(); subElement; subElement = subElement->nextSibling()) {
-                    try {
-                        subElement->parse(diag);
-                        switch (subElement->id()) {
-                        case EbmlIds::Version:
-                            m_version = subElement->readUInteger();
-                            break;
-                        case EbmlIds::ReadVersion:
-                            m_readVersion = subElement->readUInteger();
-                            break;
-                        case EbmlIds::DocType:
-                            m_doctype = subElement->readString();
-                            break;
-                        case EbmlIds::DocTypeVersion:
-                            m_doctypeVersion = subElement->readUInteger();
-                            break;
-                        case EbmlIds::DocTypeReadVersion:
-                            m_doctypeReadVersion = subElement->readUInteger();
-                            break;
-                        case EbmlIds::MaxIdLength:
-                            m_maxIdLength = subElement->readUInteger();
-                            if (m_maxIdLength > EbmlElement::maximumIdLengthSupported()) {
-                                diag.emplace_back(DiagLevel::Critical,
-                                    argsToString("Maximum EBML element ID length greather than ", EbmlElement::maximumIdLengthSupported(),
-                                        " bytes is not supported."),
-                                    context);
-                                throw InvalidDataException();
-                            }
-                            break;
-                        case EbmlIds::MaxSizeLength:
-                            m_maxSizeLength = subElement->readUInteger();
-                            if (m_maxSizeLength > EbmlElement::maximumSizeLengthSupported()) {
-                                diag.emplace_back(DiagLevel::Critical,
-                                    argsToString("Maximum EBML element size length greather than ", EbmlElement::maximumSizeLengthSupported(),
-                                        " bytes is not supported."),
-                                    context);
-                                throw InvalidDataException();
-                            }
-                            break;
-                        }
-                    } catch (const Failure &) {
-                        diag.emplace_back(DiagLevel::Critical, "Unable to parse all children of EBML header.", context);
-                        break;
-                    }
-                }
+                parseEbmlHeader(*topLevelElement, diag);
                 break;
             case MatroskaIds::Segment:
                 ++m_segmentCount;
+                firstClusterOffset = clusterCount = 0;
                 for (EbmlElement *subElement = topLevelElement->firstChild(); subElement; subElement = subElement->nextSibling()) {
+                    if (maxParsingOffset && subElement->startOffset() >= maxParsingOffset) {
+                        goto maxParsingOffsetReached;
+                    }
                     try {
                         subElement->parse(diag);
+                        ++elementsParsed;
+                        if (verifyChecksums && subElement->id() != MatroskaIds::Cluster) {
+                            subElement->verifyCrc32(diag);
+                        }
                         switch (subElement->id()) {
                         case MatroskaIds::SeekHead:
                             m_seekInfos.emplace_back(make_unique<MatroskaSeekInfo>());
@@ -477,117 +1559,465 @@ void MatroskaContainer::internalParseHeader(Diagnostics &diag)
                         case MatroskaIds::Tracks:
                             if (excludesOffset(m_tracksElements, subElement->startOffset())) {
                                 m_tracksElements.push_back(subElement);
+                                retain(*subElement);
                             }
                             break;
                         case MatroskaIds::SegmentInfo:
                             if (excludesOffset(m_segmentInfoElements, subElement->startOffset())) {
                                 m_segmentInfoElements.push_back(subElement);
+                                retain(*subElement);
                             }
                             break;
                         case MatroskaIds::Tags:
                             if (excludesOffset(m_tagsElements, subElement->startOffset())) {
                                 m_tagsElements.push_back(subElement);
+                                retain(*subElement);
                             }
                             break;
                         case MatroskaIds::Chapters:
                             if (excludesOffset(m_chaptersElements, subElement->startOffset())) {
                                 m_chaptersElements.push_back(subElement);
+                                retain(*subElement);
                             }
                             break;
                         case MatroskaIds::Attachments:
                             if (excludesOffset(m_attachmentsElements, subElement->startOffset())) {
                                 m_attachmentsElements.push_back(subElement);
+                                retain(*subElement);
                             }
                             break;
                         case MatroskaIds::Cluster:
+                            if (!clusterCount++) {
+                                firstClusterOffset = subElement->startOffset();
+                            }
+                            if (forwardOnly) {
+                                break;
+                            }
                             // stop as soon as the first cluster has been reached if all relevant information has been gathered
                             // -> take elements from seek tables within this segment into account
                             for (auto i = m_seekInfos.cbegin() + seekInfosIndex, end = m_seekInfos.cend(); i != end; ++i, ++seekInfosIndex) {
-                                for (const auto &infoPair : (*i)->info()) {
-                                    std::uint64_t offset = currentOffset + topLevelElement->dataOffset() + infoPair.second;
-                                    if (offset >= fileInfo().size()) {
-                                        diag.emplace_back(DiagLevel::Critical,
-                                            argsToString("Offset (", offset, ") denoted by \"SeekHead\" element is invalid."), context);
-                                    } else {
-                                        auto element = make_unique<EbmlElement>(*this, offset);
-                                        try {
-                                            element->parse(diag);
-                                            if (element->id() != infoPair.first) {
-                                                diag.emplace_back(DiagLevel::Critical,
-                                                    argsToString("ID of element ", element->idToString(), " at ", offset,
-                                                        " does not match the ID denoted in the \"SeekHead\" element (0x",
-                                                        numberToString(infoPair.first, 16), ")."),
-                                                    context);
-                                            }
-                                            switch (element->id()) {
-                                            case MatroskaIds::SegmentInfo:
-                                                if (excludesOffset(m_segmentInfoElements, offset)) {
-                                                    m_additionalElements.emplace_back(move(element));
-                                                    m_segmentInfoElements.emplace_back(m_additionalElements.back().get());
-                                                }
-                                                break;
-                                            case MatroskaIds::Tracks:
-                                                if (excludesOffset(m_tracksElements, offset)) {
-                                                    m_additionalElements.emplace_back(move(element));
-                                                    m_tracksElements.emplace_back(m_additionalElements.back().get());
-                                                }
-                                                break;
-                                            case MatroskaIds::Tags:
-                                                if (excludesOffset(m_tagsElements, offset)) {
-                                                    m_additionalElements.emplace_back(move(element));
-                                                    m_tagsElements.emplace_back(m_additionalElements.back().get());
-                                                }
-                                                break;
-                                            case MatroskaIds::Chapters:
-                                                if (excludesOffset(m_chaptersElements, offset)) {
-                                                    m_additionalElements.emplace_back(move(element));
-                                                    m_chaptersElements.emplace_back(m_additionalElements.back().get());
-                                                }
-                                                break;
-                                            case MatroskaIds::Attachments:
-                                                if (excludesOffset(m_attachmentsElements, offset)) {
-                                                    m_additionalElements.emplace_back(move(element));
-                                                    m_attachmentsElements.emplace_back(m_additionalElements.back().get());
-                                                }
-                                                break;
-                                            default:;
-                                            }
-                                        } catch (const Failure &) {
-                                            diag.emplace_back(DiagLevel::Critical,
-                                                argsToString("Can not parse element at ", offset, " (denoted using \"SeekHead\" element)."), context);
-                                        }
-                                    }
+                                parseElementsDenotedBySeekInfo(*this, **i, currentOffset + topLevelElement->dataOffset(), elements, diag);
+                            }
+                            // -> probe the end of the segment for tags if not denoted by a "SeekHead" element and scan clusters only
+                            //    as last resort within the budget when using the "SeekHead first" strategy
+                            if (seekHeadFirst) {
+                                if (clusterCount == 1 && m_tagsElements.empty()) {
+                                    probeTagsAtSegmentEnd(*topLevelElement, firstClusterOffset, diag);
                                 }
+                                if (!m_tracksElements.empty() && !m_tagsElements.empty() && !m_segmentInfoElements.empty()) {
+                                    goto finish;
+                                }
+                                if (subElement->startOffset() - firstClusterOffset >= fileInfo().matroskaClusterScanBudget()) {
+                                    diag.emplace_back(DiagLevel::Information,
+                                        argsToString("Clusters beyond the cluster scan budget (", dataSizeToString(fileInfo().matroskaClusterScanBudget()),
+                                            ") have been skipped. Maybe not all tracks and tags could be found."),
+                                        context);
+                                    goto finish;
+                                }
+                                break;
                             }
-                            // -> stop if tracks and tags have been found or the file exceeds the max. size to fully process
-                            if (((!m_tracksElements.empty() && !m_tagsElements.empty()) || fileInfo().size() > m_maxFullParseSize)
+                            // -> stop if tracks and tags have been found or walking through all clusters is not worthwhile
+                            if (((!m_tracksElements.empty() && !m_tagsElements.empty())
+                                    || !isFullParseWorthwhile(*topLevelElement, *subElement, firstClusterOffset, clusterCount,
+                                        chrono::steady_clock::now() - parsingStart, elementsParsed))
                                 && !m_segmentInfoElements.empty()) {
                                 goto finish;
                             }
                             break;
                         }
+                        // -> stop if tracks and tags have been found and the first cluster (or the elements following the clusters)
+                        //    reached if the input is forward-only
+                        if (forwardOnly && clusterCount && !m_tracksElements.empty() && !m_tagsElements.empty()
+                            && !m_segmentInfoElements.empty()) {
+                            goto finish;
+                        }
                     } catch (const Failure &) {
-                        diag.emplace_back(DiagLevel::Critical, "Unable to parse all children of \"Segment\"-element.", context);
+                        if (!isEndOfStream(*subElement)) {
+                            diag.emplace_back(DiagLevel::Critical, "Unable to parse all children of \"Segment\"-element.", context);
+                        }
                         break;
                     }
                 }
-                currentOffset += topLevelElement->totalSize();
+                currentOffset += topLevelElement->totalSize();
+                break;
+            default:;
+            }
+        } catch (const Failure &) {
+            if (!isEndOfStream(*topLevelElement)) {
+                diag.emplace_back(
+                    DiagLevel::Critical, argsToString("Unable to parse top-level element at ", topLevelElement->startOffset(), '.'), context);
+            }
+            break;
+        }
+    }
+
+    goto finish;
+
+maxParsingOffsetReached:
+    diag.emplace_back(DiagLevel::Information,
+        argsToString("Elements beyond the max. parsing offset (", maxParsingOffset, ") have been skipped. Maybe not all tracks and tags could be found."),
+        context);
+    if (m_segmentInfoElements.empty()) {
+        return;
+    }
+
+    // finally parse the "Info"-element and fetch "EditionEntry"-elements
+finish:
+    try {
+        parseSegmentInfo(diag);
+    } catch (const Failure &) {
+        diag.emplace_back(DiagLevel::Critical, "Unable to parse EBML (segment) \"Info\"-element.", context);
+    }
+}
+
+/*!
+ * \brief Parses the specified EBML \a header.
+ *
+ * This private method is called when parsing the header.
+ */
+void MatroskaContainer::parseEbmlHeader(EbmlElement &header, Diagnostics &diag)
+{
+    static const string context("parsing header of Matroska container");
+    for (EbmlElement *subElement = header.firstChild(); subElement; subElement = subElement->nextSibling()) {
+        try {
+            subElement->parse(diag);
+            switch (subElement->id()) {
+            case EbmlIds::Version:
+                m_version = subElement->readUInteger();
+                break;
+            case EbmlIds::ReadVersion:
+                m_readVersion = subElement->readUInteger();
+                break;
+            case EbmlIds::DocType:
+                m_doctype = subElement->readString();
+                break;
+            case EbmlIds::DocTypeVersion:
+                m_doctypeVersion = subElement->readUInteger();
+                break;
+            case EbmlIds::DocTypeReadVersion:
+                m_doctypeReadVersion = subElement->readUInteger();
+                break;
+            case EbmlIds::MaxIdLength:
+                m_maxIdLength = subElement->readUInteger();
+                if (m_maxIdLength > EbmlElement::maximumIdLengthSupported()) {
+                    diag.emplace_back(DiagLevel::Critical,
+                        argsToString("Maximum EBML element ID length greather than ", EbmlElement::maximumIdLengthSupported(),
+                            " bytes is not supported."),
+                        context);
+                    throw InvalidDataException();
+                }
+                break;
+            case EbmlIds::MaxSizeLength:
+                m_maxSizeLength = subElement->readUInteger();
+                if (m_maxSizeLength > EbmlElement::maximumSizeLengthSupported()) {
+                    diag.emplace_back(DiagLevel::Critical,
+                        argsToString("Maximum EBML element size length greather than ", EbmlElement::maximumSizeLengthSupported(),
+                            " bytes is not supported."),
+                        context);
+                    throw InvalidDataException();
+                }
+                break;
+            }
+        } catch (const Failure &) {
+            diag.emplace_back(DiagLevel::Critical, "Unable to parse all children of EBML header.", context);
+            break;
+        }
+    }
+}
+
+/// \brief The private SegmentHeader struct is used by MatroskaContainer::parseSegmentsConcurrently() to store the elements found within a segment.
+struct MatroskaContainer::SegmentHeader {
+    /// \brief "Segment"-element
+    EbmlElement *segmentElement = nullptr;
+    /// \brief offset the positions denoted by "SeekHead"-elements are relative to
+    std::uint64_t segmentOffset = 0;
+    /// \brief "Tracks"-elements found within the segment
+    vector<EbmlElement *> tracksElements;
+    /// \brief "SegmentInfo"-elements found within the segment
+    vector<EbmlElement *> segmentInfoElements;
+    /// \brief "Tags"-elements found within the segment
+    vector<EbmlElement *> tagsElements;
+    /// \brief "Chapters"-elements found within the segment
+    vector<EbmlElement *> chaptersElements;
+    /// \brief "Attachments"-elements found within the segment
+    vector<EbmlElement *> attachmentsElements;
+    /// \brief elements which have been constructed for positions denoted by "SeekHead"-elements
+    vector<unique_ptr<EbmlElement>> additionalElements;
+    /// \brief seek information read from the "SeekHead"-elements of the segment
+    vector<unique_ptr<MatroskaSeekInfo>> seekInfos;
+    /// \brief diagnostic messages which occurred when parsing the segment
+    Diagnostics diag;
+    /// \brief unexpected exception which occurred when parsing the segment
+    exception_ptr exception;
+};
+
+/*!
+ * \brief Parses the segments concurrently if enabled via MediaFileInfo::setMatroskaSegmentParsingThreadCount() and possible.
+ *
+ * This private method is called when parsing the header. The top-level elements are located sequentially and the EBML
+ * header is parsed. Then the children of the "Segment"-elements are parsed concurrently via parseSegmentHeader(), each
+ * segment using its own element tree and reading only from the memory-mapped file. The gathered elements and diagnostic
+ * messages are merged in segment order afterwards.
+ *
+ * \returns Returns whether the segments have been parsed. If false is returned, nothing has been parsed and the header
+ *          needs to be parsed sequentially.
+ */
+bool MatroskaContainer::parseSegmentsConcurrently(Diagnostics &diag)
+{
+    static const string context("parsing header of Matroska container");
+    auto threadCount = fileInfo().matroskaSegmentParsingThreadCount();
+    if (threadCount == 1 || fileInfo().maxParsingOffset() || fileInfo().matroskaParseStrategy() != MatroskaParseStrategy::Sequential
+        || mappedData().empty()) {
+        return false;
+    }
+
+    // locate the "Segment"-elements
+    auto locatingDiag = Diagnostics();
+    locatingDiag.setFlags(diag.flags());
+    locatingDiag.setLevelThreshold(diag.levelThreshold());
+    auto headerElements = vector<EbmlElement *>();
+    auto segments = vector<SegmentHeader>();
+    std::uint64_t currentOffset = 0;
+    for (EbmlElement *topLevelElement = m_firstElement.get(); topLevelElement; topLevelElement = topLevelElement->nextSibling()) {
+        try {
+            topLevelElement->parse(locatingDiag);
+        } catch (const Failure &) {
+            locatingDiag.emplace_back(
+                DiagLevel::Critical, argsToString("Unable to parse top-level element at ", topLevelElement->startOffset(), '.'), context);
+            break;
+        }
+        switch (topLevelElement->id()) {
+        case EbmlIds::Header:
+            headerElements.emplace_back(topLevelElement);
+            break;
+        case MatroskaIds::Segment:
+            segments.emplace_back();
+            segments.back().segmentElement = topLevelElement;
+            segments.back().segmentOffset = currentOffset + topLevelElement->dataOffset();
+            currentOffset += topLevelElement->totalSize();
+            break;
+        default:;
+        }
+    }
+    if (segments.size() < 2) {
+        // start over to parse the header sequentially
+        m_firstElement = make_unique<EbmlElement>(*this, startOffset());
+        return false;
+    }
+    for (auto &message : locatingDiag) {
+        diag.push_back(std::move(message));
+    }
+    for (auto *const headerElement : headerElements) {
+        parseEbmlHeader(*headerElement, diag);
+    }
+
+    // parse the children of the "Segment"-elements concurrently
+    // note: The element arena is disabled meanwhile because it is not thread-safe.
+    const auto elementArenaEnabled = isElementArenaEnabled();
+    setElementArenaEnabled(false);
+    threadCount = min<std::size_t>(threadCount ? threadCount : max<std::size_t>(thread::hardware_concurrency(), 1), segments.size());
+    auto nextSegment = atomic<std::size_t>(0);
+    const auto work = [&] {
+        for (auto i = nextSegment++; i < segments.size(); i = nextSegment++) {
+            auto &segment = segments[i];
+            segment.diag.setFlags(diag.flags());
+            segment.diag.setLevelThreshold(diag.levelThreshold());
+            try {
+                parseSegmentHeader(segment);
+            } catch (...) {
+                segment.exception = current_exception();
+            }
+        }
+    };
+    auto workers = vector<thread>();
+    workers.reserve(threadCount - 1);
+    for (auto i = std::size_t(1); i < threadCount; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    setElementArenaEnabled(elementArenaEnabled);
+
+    // merge the results in segment order
+    auto elements = TopLevelElements{ m_tracksElements, m_segmentInfoElements, m_tagsElements, m_chaptersElements, m_attachmentsElements,
+        m_additionalElements };
+    const auto merge = [](vector<EbmlElement *> &source, vector<EbmlElement *> &target) {
+        for (auto *const element : source) {
+            if (excludesOffset(target, element->startOffset())) {
+                target.emplace_back(element);
+            }
+        }
+    };
+    for (auto &segment : segments) {
+        for (auto &message : segment.diag) {
+            diag.push_back(std::move(message));
+        }
+        if (segment.exception) {
+            rethrow_exception(segment.exception);
+        }
+        ++m_segmentCount;
+        merge(segment.tracksElements, elements.tracksElements);
+        merge(segment.segmentInfoElements, elements.segmentInfoElements);
+        merge(segment.tagsElements, elements.tagsElements);
+        merge(segment.chaptersElements, elements.chaptersElements);
+        merge(segment.attachmentsElements, elements.attachmentsElements);
+        move(segment.additionalElements.begin(), segment.additionalElements.end(), back_inserter(elements.additionalElements));
+        move(segment.seekInfos.begin(), segment.seekInfos.end(), back_inserter(m_seekInfos));
+    }
+    return true;
+}
+
+/*!
+ * \brief Parses the children of the "Segment"-element of the specified \a segment.
+ *
+ * This private method is called by parseSegmentsConcurrently() for each segment (possibly from multiple threads at the
+ * same time). The found elements are only added to \a segment so the container is not mutated. Like when parsing the
+ * header sequentially, the clusters are only walked through as long as not all relevant elements have been found and
+ * walking through them is considered worthwhile.
+ */
+void MatroskaContainer::parseSegmentHeader(SegmentHeader &segment)
+{
+    static const string context("parsing header of Matroska container");
+    auto &diag = segment.diag;
+    auto elements = TopLevelElements{ segment.tracksElements, segment.segmentInfoElements, segment.tagsElements, segment.chaptersElements,
+        segment.attachmentsElements, segment.additionalElements };
+    const auto parsingStart = chrono::steady_clock::now();
+    std::uint64_t elementsParsed = 0, firstClusterOffset = 0, clusterCount = 0;
+    std::size_t seekInfosIndex = 0;
+    for (EbmlElement *subElement = segment.segmentElement->firstChild(); subElement; subElement = subElement->nextSibling()) {
+        try {
+            subElement->parse(diag);
+            ++elementsParsed;
+            vector<EbmlElement *> *list = nullptr;
+            switch (subElement->id()) {
+            case MatroskaIds::SeekHead:
+                segment.seekInfos.emplace_back(make_unique<MatroskaSeekInfo>());
+                segment.seekInfos.back()->parse(subElement, diag);
+                break;
+            case MatroskaIds::Tracks:
+                list = &segment.tracksElements;
+                break;
+            case MatroskaIds::SegmentInfo:
+                list = &segment.segmentInfoElements;
+                break;
+            case MatroskaIds::Tags:
+                list = &segment.tagsElements;
+                break;
+            case MatroskaIds::Chapters:
+                list = &segment.chaptersElements;
+                break;
+            case MatroskaIds::Attachments:
+                list = &segment.attachmentsElements;
+                break;
+            case MatroskaIds::Cluster:
+                if (!clusterCount++) {
+                    firstClusterOffset = subElement->startOffset();
+                }
+                // take elements from seek tables within this segment into account
+                for (; seekInfosIndex < segment.seekInfos.size(); ++seekInfosIndex) {
+                    parseElementsDenotedBySeekInfo(*this, *segment.seekInfos[seekInfosIndex], segment.segmentOffset, elements, diag);
+                }
+                // stop if tracks and tags have been found or walking through all clusters is not worthwhile
+                if (((!segment.tracksElements.empty() && !segment.tagsElements.empty())
+                        || !isFullParseWorthwhile(*segment.segmentElement, *subElement, firstClusterOffset, clusterCount,
+                            chrono::steady_clock::now() - parsingStart, elementsParsed))
+                    && !segment.segmentInfoElements.empty()) {
+                    return;
+                }
                 break;
             default:;
             }
+            if (list && excludesOffset(*list, subElement->startOffset())) {
+                list->emplace_back(subElement);
+            }
         } catch (const Failure &) {
-            diag.emplace_back(
-                DiagLevel::Critical, argsToString("Unable to parse top-level element at ", topLevelElement->startOffset(), '.'), context);
+            diag.emplace_back(DiagLevel::Critical, "Unable to parse all children of \"Segment\"-element.", context);
             break;
         }
     }
+}
 
-    // finally parse the "Info"-element and fetch "EditionEntry"-elements
-finish:
-    try {
-        parseSegmentInfo(diag);
-    } catch (const Failure &) {
-        diag.emplace_back(DiagLevel::Critical, "Unable to parse EBML (segment) \"Info\"-element.", context);
+/*!
+ * \brief Returns whether walking through the remaining clusters of the specified \a segment is worthwhile.
+ *
+ * This private method is called when parsing the header for each cluster as long as not all relevant elements have
+ * been found. If MediaFileInfo::matroskaFullParseTimeBudget() is set, the time walking through the remaining clusters
+ * takes is estimated from the time the \a elementsParsed took so far (\a elapsed) and from the average size of the
+ * \a clusterCount clusters walked through so far. Hence the decision adapts to the storage latency and the cluster
+ * size. Otherwise the file size is compared against MediaFileInfo::matroskaMaxFullParseSize().
+ */
+bool MatroskaContainer::isFullParseWorthwhile(const EbmlElement &segment, const EbmlElement &cluster, std::uint64_t firstClusterOffset,
+    std::uint64_t clusterCount, std::chrono::steady_clock::duration elapsed, std::uint64_t elementsParsed) const
+{
+    const auto timeBudget = fileInfo().matroskaFullParseTimeBudget();
+    if (timeBudget.isNull()) {
+        return fileInfo().size() <= fileInfo().matroskaMaxFullParseSize();
+    }
+    const auto latency = chrono::duration_cast<chrono::nanoseconds>(elapsed).count() / static_cast<double>(max<std::uint64_t>(elementsParsed, 1));
+    const auto averageClusterSize = static_cast<double>(cluster.endOffset() - firstClusterOffset) / static_cast<double>(max<std::uint64_t>(clusterCount, 1));
+    const auto segmentEnd = min(segment.endOffset(), fileInfo().size());
+    const auto remainingClusters = segmentEnd > cluster.endOffset() ? static_cast<double>(segmentEnd - cluster.endOffset()) / averageClusterSize : 0.0;
+    return remainingClusters * latency / 100.0 <= static_cast<double>(timeBudget.totalTicks());
+}
+
+/*!
+ * \brief Probes the end of the specified \a segment for a "Tags"-element.
+ *
+ * This private method is called when parsing the header using MatroskaParseStrategy::SeekHeadFirst if no "Tags"-element
+ * is denoted by a "SeekHead"-element. Only the last MiB of the segment (but nothing before \a firstClusterOffset) is
+ * searched for the ID of the "Tags"-element. A candidate is only taken if it can be parsed, ends within the segment and
+ * its first child is a "Tag"-element.
+ */
+void MatroskaContainer::probeTagsAtSegmentEnd(EbmlElement &segment, std::uint64_t firstClusterOffset, Diagnostics &diag)
+{
+    static const string context("probing end of Matroska segment for tags");
+    constexpr std::uint64_t maxProbeSize = 0x100000;
+    const auto segmentEnd = min(segment.endOffset(), fileInfo().size());
+    const auto probeStart = max(firstClusterOffset, segmentEnd > maxProbeSize ? segmentEnd - maxProbeSize : 0);
+    if (probeStart + 4 >= segmentEnd) {
+        return;
+    }
+
+    // read the end of the segment
+    const auto probeSize = static_cast<std::size_t>(segmentEnd - probeStart);
+    auto buffer = make_unique<char[]>(probeSize);
+    stream().seekg(static_cast<streamoff>(probeStart));
+    stream().read(buffer.get(), static_cast<streamsize>(probeSize));
+
+    // search for the ID of the "Tags"-element
+    static constexpr char tagsId[] = { 0x12, 0x54, static_cast<char>(0xC3), 0x67 };
+    for (auto *candidate = buffer.get(), *const end = buffer.get() + probeSize;
+         (candidate = search(candidate, end, tagsId, tagsId + sizeof(tagsId))) != end; ++candidate) {
+        const auto offset = probeStart + static_cast<std::uint64_t>(candidate - buffer.get());
+        auto element = make_unique<EbmlElement>(*this, offset);
+        // -> validate the candidate without polluting the diagnostic messages
+        auto candidateDiag = Diagnostics();
+        try {
+            element->parse(candidateDiag);
+            if (element->id() != MatroskaIds::Tags || element->endOffset() > segmentEnd) {
+                continue;
+            }
+            auto *const firstChild = element->firstChild();
+            if (!firstChild) {
+                continue;
+            }
+            firstChild->parse(candidateDiag);
+            if (firstChild->id() != MatroskaIds::Tag) {
+                continue;
+            }
+        } catch (const Failure &) {
+            continue;
+        }
+        diag.emplace_back(DiagLevel::Information,
+            argsToString("Found \"Tags\"-element at ", offset, " by probing the end of the segment (it is not denoted by a \"SeekHead\"-element)."),
+            context);
+        if (excludesOffset(m_tagsElements, offset)) {
+            m_additionalElements.emplace_back(move(element));
+            m_tagsElements.emplace_back(m_additionalElements.back().get());
+        }
+        return;
     }
 }
 
@@ -608,6 +2038,7 @@ void MatroskaContainer::parseSegmentInfo(Diagnostics &diag)
     m_duration = TimeSpan();
     for (EbmlElement *element : m_segmentInfoElements) {
         element->parse(diag);
+        const auto buffer = EbmlMasterBuffer(*element);
         EbmlElement *subElement = element->firstChild();
         double rawDuration = 0.0;
         std::uint64_t timeScale = 1000000;
@@ -642,15 +2073,28 @@ void MatroskaContainer::parseSegmentInfo(Diagnostics &diag)
 /*!
  * \brief Reads track-specific statistics from tags.
  * \remarks Tags and tracks must have been parsed before calling this method.
+ *
+ * The tracks are indexed by their UID so the tags only need to be iterated once and each tag is only applied to the
+ * tracks it targets.
+ *
  * \sa MatroskaTrack::readStatisticsFromTags()
  */
 void MatroskaContainer::readTrackStatisticsFromTags(Diagnostics &diag)
 {
-    if (tracks().empty() || tags().empty()) {
+    if (tracks().empty() || tags().empty() || fileInfo().parsingFlags() & ParsingFlags::SkipTrackStatistics) {
         return;
     }
+    unordered_multimap<std::uint64_t, MatroskaTrack *> tracksById;
+    tracksById.reserve(tracks().size());
     for (const auto &track : tracks()) {
-        track->readStatisticsFromTags(tags(), diag);
+        tracksById.emplace(track->id(), track.get());
+    }
+    for (const auto &tag : tags()) {
+        for (const auto trackId : tag->target().tracks()) {
+            for (auto [i, end] = tracksById.equal_range(trackId); i != end; ++i) {
+                i->second->readStatisticsFromTag(*tag, diag);
+            }
+        }
     }
 }
 
@@ -664,9 +2108,12 @@ void MatroskaContainer::internalParseTags(Diagnostics &diag)
                 subElement->parse(diag);
                 switch (subElement->id()) {
                 case MatroskaIds::Tag:
+                    if (exceedsParseLimit(subElement->totalSize(), parseLimits().maxTagSize, "size of the tag", diag, context)) {
+                        break;
+                    }
                     m_tags.emplace_back(make_unique<MatroskaTag>());
                     try {
-                        m_tags.back()->parse(*subElement, diag);
+                        m_tags.back()->parse(*subElement, diag, &fileInfo().tagFieldFilter());
                     } catch (const NoDataFoundException &) {
                         m_tags.pop_back();
                     } catch (const Failure &) {
@@ -682,10 +2129,12 @@ void MatroskaContainer::internalParseTags(Diagnostics &diag)
             }
         } catch (const Failure &) {
             diag.emplace_back(DiagLevel::Critical, "Element structure seems to be invalid.", context);
+            m_tagIndexValid = false;
             readTrackStatisticsFromTags(diag);
             throw;
         }
     }
+    m_tagIndexValid = false;
     readTrackStatisticsFromTags(diag);
 }
 
@@ -769,6 +2218,9 @@ void MatroskaContainer::internalParseAttachments(Diagnostics &diag)
                 subElement->parse(diag);
                 switch (subElement->id()) {
                 case MatroskaIds::AttachedFile:
+                    if (exceedsParseLimit(subElement->totalSize(), parseLimits().maxAttachmentSize, "size of the attached file", diag, context)) {
+                        break;
+                    }
                     m_attachments.emplace_back(make_unique<MatroskaAttachment>());
                     try {
                         m_attachments.back()->parse(subElement, diag);
@@ -793,13 +2245,81 @@ void MatroskaContainer::internalParseAttachments(Diagnostics &diag)
     }
 }
 
+/*!
+ * \brief Takes the elements into account which have been appended to the file (e.g. clusters of a live recording).
+ *
+ * The element tree is extended (see EbmlElement::resumeSiblings()) so the segment and the last cluster cover the
+ * appended data; the appended level 1 elements are parsed.
+ *
+ * \returns Returns false if elements other than clusters and cues have been appended (e.g. the "Tags"-element written at
+ *          the end of a recording, another segment or the rest of a partially downloaded "Tracks"-element); the file
+ *          needs to be parsed from scratch then.
+ */
+bool MatroskaContainer::internalResumeParsing(Diagnostics &diag)
+{
+    static const string context("resuming parsing of Matroska container");
+    if (!m_firstElement) {
+        return false;
+    }
+    auto createdElements = vector<EbmlElement *>();
+    m_firstElement->resumeSiblings(diag, &createdElements);
+    for (auto *element : createdElements) {
+        // new top-level elements (e.g. another segment) require parsing from scratch
+        if (!element->parent()) {
+            return false;
+        }
+        // ignore appended children of clusters but not of other level 1 elements
+        if (element->parent()->parent()) {
+            auto *level1Element = element->parent();
+            while (level1Element->parent()->parent()) {
+                level1Element = level1Element->parent();
+            }
+            if (level1Element->id() != MatroskaIds::Cluster) {
+                return false;
+            }
+            continue;
+        }
+        // parse appended level 1 elements
+        try {
+            for (; element; element = element->nextSibling()) {
+                element->parse(diag);
+                switch (element->id()) {
+                case MatroskaIds::Cluster:
+                case MatroskaIds::Cues:
+                case EbmlIds::Crc32:
+                case EbmlIds::Void:
+                    break;
+                default:
+                    return false;
+                }
+            }
+        } catch (const Failure &) {
+            diag.emplace_back(DiagLevel::Critical, "Unable to parse appended \"Segment\"-element children.", context);
+        }
+    }
+    return true;
+}
+
 /// \brief The private SegmentData struct is used in MatroskaContainer::internalMakeFile() to store segment specific data.
 struct SegmentData {
+    /// \brief The ClusterLayout struct holds the size of a "Cluster"-element determined when pretending to write it.
+    struct ClusterLayout {
+        /// \brief position of the cluster (in the new file) the size has been determined for
+        std::uint64_t position;
+        /// \brief data size of the cluster (in the new file)
+        std::uint64_t size;
+        /// \brief whether the cluster contains a "Position"-element (whose size depends on the position of the cluster)
+        bool hasPosition;
+    };
+
     /// \brief Constructs a new segment data object.
     SegmentData()
         : hasCrc32(false)
         , cuesElement(nullptr)
+        , generateCues(false)
+        , cuePointsCollected(false)
         , infoDataSize(0)
+        , clusterLayoutsComplete(false)
         , firstClusterElement(nullptr)
         , clusterEndOffset(0)
         , startOffset(0)
@@ -819,10 +2339,18 @@ struct SegmentData {
     EbmlElement *cuesElement;
     /// \brief used to make "Cues"-element
     MatroskaCuePositionUpdater cuesUpdater;
+    /// \brief whether a "Cues"-element is generated (because the original file has none)
+    bool generateCues;
+    /// \brief whether the cue points to generate "Cues"-element have been collected yet
+    bool cuePointsCollected;
     /// \brief size of the "SegmentInfo"-element
     std::uint64_t infoDataSize;
     /// \brief cluster sizes
     vector<std::uint64_t> clusterSizes;
+    /// \brief cluster layouts determined when pretending to write the clusters (re-used by subsequent passes)
+    vector<ClusterLayout> clusterLayouts;
+    /// \brief whether clusterLayouts contains the layouts of all clusters
+    bool clusterLayoutsComplete;
     /// \brief first "Cluster"-element (original file)
     EbmlElement *firstClusterElement;
     /// \brief end offset of last "Cluster"-element (original file)
@@ -845,6 +2373,7 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
 {
     static const string context("making Matroska container");
     progress.updateStep("Calculating element sizes ...");
+    auto layoutTimer = ApplyPhaseTimer(fileInfo().statistics(), ApplyPhase::Layout);
 
     // basic validation of original file
     if (!isHeaderParsed()) {
@@ -869,11 +2398,32 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
     attachmentMaker.reserve(m_attachments.size());
     std::uint64_t attachedFileElementsSize = 0;
     std::uint64_t attachmentsSize;
+    // whether "CRC-32"-elements are kept (they are omitted when writing to a seekless output as the checksums are computed
+    // after writing the file)
+    const auto hasCrc32 = [seekless = m_seeklessOutput != nullptr](const vector<EbmlElement *> &elements) {
+        return !seekless && any_of(elements.cbegin(), elements.cend(), [](EbmlElement *element) {
+            return element->firstChild() && element->firstChild()->id() == EbmlIds::Crc32;
+        });
+    };
+    bool tagsHaveCrc32 = false, attachmentsHaveCrc32 = false;
     vector<MatroskaTrackHeaderMaker> trackHeaderMaker;
     trackHeaderMaker.reserve(tracks().size());
     std::uint64_t trackHeaderElementsSize = 0;
     std::uint64_t trackHeaderSize;
 
+    // define variables needed to generate "Cues"-elements
+    // -> only keyframes of video tracks are indexed (or keyframes of all tracks if there are no video tracks)
+    vector<std::uint64_t> cueTrackNumbers, indexedTrackNumbers;
+    if (m_indexGeneration || m_finalizing) {
+        for (const auto &track : tracks()) {
+            if (track->mediaType() == MediaType::Video) {
+                cueTrackNumbers.emplace_back(track->trackNumber());
+            }
+        }
+    }
+    std::uint64_t cueTrackNumber, clusterTime;
+    std::int16_t relativeTime;
+
     // define variables to store sizes, offsets and other information required to make a header and "Segment"-elements
     // current segment index
     unsigned int segmentIndex = 0;
@@ -905,8 +2455,11 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
     unsigned int lastSegmentIndex = numeric_limits<unsigned int>::max();
     // -> holds new padding
     std::uint64_t newPadding;
+    // -> holds the size of the new file (as calculated when pretending writing it)
+    std::uint64_t newFileSize = 0;
     // -> whether rewrite is required (always required when forced to rewrite)
-    bool rewriteRequired = fileInfo().isForcingRewrite() || !fileInfo().saveFilePath().empty();
+    bool rewriteRequired
+        = (fileInfo().isForcingRewrite() && !fileInfo().isForcingInPlace()) || !fileInfo().saveFilePath().empty() || m_seeklessOutput;
 
     // calculate EBML header size
     // -> sub element ID sizes
@@ -944,8 +2497,18 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
             } catch (const Failure &) {
             }
         }
+        if (tagElementsSize && (tagsHaveCrc32 = hasCrc32(m_tagsElements))) {
+            tagElementsSize += EbmlElement::crc32ElementSize;
+        }
         tagsSize = tagElementsSize ? 4 + EbmlElement::calculateSizeDenotationLength(tagElementsSize) + tagElementsSize : 0;
 
+        // patch only the changed "Tag"-elements if enabled, nothing but tags has been changed and they still fit
+        // note: Otherwise changes to the tracks, attachments or the segment information would be dropped.
+        if (const auto changes = fileInfo().changes(); m_tagPatching && !rewriteRequired && !m_indexGeneration && !m_finalizing
+            && (changes == MediaFileChanges::None || changes == MediaFileChanges::Tags) && patchTags(tagMaker, diag, progress)) {
+            return;
+        }
+
         // calculate size of "Attachments"-element
         for (auto &attachment : m_attachments) {
             if (!attachment->isIgnored()) {
@@ -959,6 +2522,9 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                 }
             }
         }
+        if (attachedFileElementsSize && (attachmentsHaveCrc32 = hasCrc32(m_attachmentsElements))) {
+            attachedFileElementsSize += EbmlElement::crc32ElementSize;
+        }
         attachmentsSize
             = attachedFileElementsSize ? 4 + EbmlElement::calculateSizeDenotationLength(attachedFileElementsSize) + attachedFileElementsSize : 0;
 
@@ -1069,6 +2635,35 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                     segment.firstClusterElement = level0Element->childById(MatroskaIds::Cluster, diag);
                 }
 
+                // collect cue points to generate "Cues"-element if none present when finalizing (the blocks are only read so the
+                // "Cues"-element can still be written in-place; the positions are updated like the ones of a parsed "Cues"-element)
+                if (m_finalizing && !segment.cuesElement && segment.firstClusterElement && !segment.generateCues) {
+                    progress.updateStep("Collecting cue points ...");
+                    collectCuePoints(*level0Element, segment.firstClusterElement, readOffset, cueTrackNumbers, segment.cuesUpdater, diag, progress);
+                    segment.generateCues = segment.cuePointsCollected = true;
+                    if (segment.cuesUpdater.hasCues()) {
+                        diag.emplace_back(DiagLevel::Information,
+                            argsToString("Generated index with ", segment.cuesUpdater.generatedCuePointCount(), " cue points for segment ",
+                                segmentIndex, '.'),
+                            context);
+                    }
+                }
+
+                // generate "Cues"-element if none present (requires rewriting since all blocks need to be visited)
+                if (m_indexGeneration && !segment.cuesElement && segment.firstClusterElement && !segment.generateCues) {
+                    if (fileInfo().isForcingInPlace()) {
+                        diag.emplace_back(DiagLevel::Information,
+                            argsToString("No index is generated for segment ", segmentIndex, " because applying changes in-place is enforced."),
+                            context);
+                    } else {
+                        segment.generateCues = true;
+                        if (!rewriteRequired) {
+                            rewriteRequired = true;
+                            goto calculateSegmentData;
+                        }
+                    }
+                }
+
                 // determine current/new cue position
                 if (segment.cuesElement && segment.firstClusterElement) {
                     currentCuesPos = segment.cuesElement->startOffset() < segment.firstClusterElement->startOffset() ? ElementPosition::BeforeData
@@ -1083,8 +2678,13 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                 // set start offset of the segment in the new file
                 segment.startOffset = currentOffset;
 
-                // check whether the segment has a CRC-32 element
-                segment.hasCrc32 = level0Element->firstChild() && level0Element->firstChild()->id() == EbmlIds::Crc32;
+                // check whether the segment has a CRC-32 element (which is omitted when writing to a seekless output as it is
+                // computed after writing the segment)
+                segment.hasCrc32 = !m_seeklessOutput && level0Element->firstChild() && level0Element->firstChild()->id() == EbmlIds::Crc32;
+                // keep the "CRC-32"-element of the "SeekHead"-element (which is computed when making it so this works on seekless outputs as well)
+                if (const auto *const seekHeadElement = level0Element->childById(MatroskaIds::SeekHead, diag)) {
+                    segment.seekInfo.setHasCrc32(seekHeadElement->firstChild() && seekHeadElement->firstChild()->id() == EbmlIds::Crc32);
+                }
 
                 // precalculate the size of the segment
             calculateSegmentSize:
@@ -1092,8 +2692,8 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                 // pretent writing "CRC-32"-element (which either present and 6 byte long or omitted)
                 segment.totalDataSize = segment.hasCrc32 ? 6 : 0;
 
-                // pretend writing "SeekHead"-element
-                segment.totalDataSize += segment.seekInfo.actualSize();
+                // pretend writing "SeekHead"-element (and the reserve following it)
+                segment.totalDataSize += m_seekHeadReservation ? segment.seekInfo.reservedSize() : segment.seekInfo.actualSize();
 
                 // pretend writing "SegmentInfo"-element
                 for (level1Element = level0Element->childById(MatroskaIds::SegmentInfo, diag), index = 0; level1Element;
@@ -1123,7 +2723,9 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                             case MatroskaIds::WrittingApp: // calculated separately
                                 break;
                             default:
-                                level2Element->makeBuffer();
+                                if (!level2Element->buffer()) {
+                                    level2Element->makeBuffer();
+                                }
                                 segment.infoDataSize += level2Element->totalSize();
                             }
                         }
@@ -1151,7 +2753,9 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                         goto calculateSegmentSize;
                     } else {
                         // add size of element
-                        level1Element->makeBuffer();
+                        if (!level1Element->buffer()) {
+                            level1Element->makeBuffer();
+                        }
                         segment.totalDataSize += level1Element->totalSize();
                     }
                 }
@@ -1185,7 +2789,7 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                 offset = segment.totalDataSize; // save current offset (offset before "Cues"-element)
 
                 // pretend writing "Cues"-element
-                if (newCuesPos == ElementPosition::BeforeData && segment.cuesElement) {
+                if (newCuesPos == ElementPosition::BeforeData && segment.cuesUpdater.hasCues()) {
                     // update offset of "Cues"-element in "SeekHead"-element
                     if (segment.seekInfo.push(0, MatroskaIds::Cues, currentPosition + segment.totalDataSize)) {
                         goto calculateSegmentSize;
@@ -1233,7 +2837,7 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                             for (index = 0; level1Element; level1Element = level1Element->siblingById(MatroskaIds::Cluster, diag), ++index) {
                                 clusterReadOffset = level1Element->startOffset() - level0Element->dataOffset() + readOffset;
                                 segment.clusterEndOffset = level1Element->endOffset();
-                                if (segment.cuesElement
+                                if (segment.cuesUpdater.hasCues()
                                     && segment.cuesUpdater.updateOffsets(
                                         clusterReadOffset, level1Element->startOffset() - 4 - segment.sizeDenotationLength - ebmlHeaderSize)
                                     && newCuesPos == ElementPosition::BeforeData) {
@@ -1254,7 +2858,7 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
 
                             // pretend writing "Cues"-element
                             progress.updateStep("Calculating offsets of elements after cluster ...");
-                            if (newCuesPos == ElementPosition::AfterData && segment.cuesElement) {
+                            if (newCuesPos == ElementPosition::AfterData && segment.cuesUpdater.hasCues()) {
                                 // update offset of "Cues"-element in "SeekHead"-element
                                 if (segment.seekInfo.push(0, MatroskaIds::Cues, currentPosition + segment.totalDataSize)) {
                                     goto calculateSegmentSize;
@@ -1348,41 +2952,82 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                     // pretend writing "Cluster"-element
                     segment.clusterSizes.clear();
                     bool cuesInvalidated = false;
+                    // -> collect keyframes when generating the "Cues"-element (positions are updated in the next run)
+                    const bool collectCuePoints = segment.generateCues && !segment.cuePointsCollected;
+                    const bool hasCues = segment.cuesUpdater.hasCues();
+                    // -> re-use the layouts of the previous pass; only clusters whose "Position"-element changes its size need
+                    //    to be visited again (the sizes and relative offsets of all other clusters are independent of their position)
+                    const bool useClusterLayouts = segment.clusterLayoutsComplete && !collectCuePoints;
+                    if (!useClusterLayouts) {
+                        segment.clusterLayouts.clear();
+                    }
                     for (index = 0; level1Element; level1Element = level1Element->siblingById(MatroskaIds::Cluster, diag), ++index) {
                         // update offset of "Cluster"-element in "Cues"-element
                         clusterReadOffset = level1Element->startOffset() - level0Element->dataOffset() + readOffset;
-                        if (segment.cuesElement && segment.cuesUpdater.updateOffsets(clusterReadOffset, currentPosition + segment.totalDataSize)
+                        const auto clusterPosition = currentPosition + segment.totalDataSize;
+                        if (hasCues && segment.cuesUpdater.updateOffsets(clusterReadOffset, clusterPosition)
                             && newCuesPos == ElementPosition::BeforeData) {
                             cuesInvalidated = true;
+                        }
+                        if (index == 0 && segment.seekInfo.push(index, MatroskaIds::Cluster, clusterPosition)) {
+                            goto calculateSegmentSize;
+                        }
+                        auto *const layout = useClusterLayouts && index < segment.clusterLayouts.size() ? &segment.clusterLayouts[index] : nullptr;
+                        if (layout
+                            && (!layout->hasPosition
+                                || EbmlElement::calculateUIntegerLength(layout->position)
+                                    == EbmlElement::calculateUIntegerLength(clusterPosition))) {
+                            // add size of "Cluster"-element determined in the previous pass
+                            clusterSize = layout->size;
                         } else {
-                            if (index == 0 && segment.seekInfo.push(index, MatroskaIds::Cluster, currentPosition + segment.totalDataSize)) {
-                                goto calculateSegmentSize;
-                            } else {
-                                // add size of "Cluster"-element
-                                clusterSize = clusterReadSize = 0;
-                                for (level2Element = level1Element->firstChild(); level2Element; level2Element = level2Element->nextSibling()) {
-                                    level2Element->parse(diag);
-                                    if (segment.cuesElement
-                                        && segment.cuesUpdater.updateRelativeOffsets(clusterReadOffset, clusterReadSize, clusterSize)
-                                        && newCuesPos == ElementPosition::BeforeData) {
-                                        cuesInvalidated = true;
-                                    }
-                                    switch (level2Element->id()) {
-                                    case EbmlIds::Void:
-                                    case EbmlIds::Crc32:
-                                        break;
-                                    case MatroskaIds::Position:
-                                        clusterSize += 1 + 1 + EbmlElement::calculateUIntegerLength(currentPosition + segment.totalDataSize);
-                                        break;
-                                    default:
-                                        clusterSize += level2Element->totalSize();
+                            // add size of "Cluster"-element
+                            bool hasPosition = false;
+                            clusterSize = clusterReadSize = clusterTime = 0;
+                            indexedTrackNumbers.clear();
+                            for (level2Element = level1Element->firstChild(); level2Element; level2Element = level2Element->nextSibling()) {
+                                level2Element->parse(diag);
+                                if (hasCues && segment.cuesUpdater.updateRelativeOffsets(clusterReadOffset, clusterReadSize, clusterSize)
+                                    && newCuesPos == ElementPosition::BeforeData) {
+                                    cuesInvalidated = true;
+                                }
+                                if (collectCuePoints) {
+                                    // add a cue point for the first keyframe of each track within the cluster
+                                    if (level2Element->id() == MatroskaIds::Timecode) {
+                                        clusterTime = level2Element->readUInteger();
+                                    } else if (isKeyframe(*level2Element, cueTrackNumber, relativeTime, diag)
+                                        && (cueTrackNumbers.empty()
+                                            || find(cueTrackNumbers.cbegin(), cueTrackNumbers.cend(), cueTrackNumber) != cueTrackNumbers.cend())
+                                        && find(indexedTrackNumbers.cbegin(), indexedTrackNumbers.cend(), cueTrackNumber)
+                                            == indexedTrackNumbers.cend()) {
+                                        indexedTrackNumbers.emplace_back(cueTrackNumber);
+                                        segment.cuesUpdater.addCuePoint(
+                                            relativeTime < 0 && clusterTime < static_cast<std::uint64_t>(-relativeTime)
+                                                ? 0
+                                                : static_cast<std::uint64_t>(static_cast<std::int64_t>(clusterTime) + relativeTime),
+                                            cueTrackNumber, clusterReadOffset, clusterReadSize);
                                     }
-                                    clusterReadSize += level2Element->totalSize();
                                 }
-                                segment.clusterSizes.push_back(clusterSize);
-                                segment.totalDataSize += 4 + EbmlElement::calculateSizeDenotationLength(clusterSize) + clusterSize;
+                                switch (level2Element->id()) {
+                                case EbmlIds::Void:
+                                case EbmlIds::Crc32:
+                                    break;
+                                case MatroskaIds::Position:
+                                    clusterSize += 1 + 1 + EbmlElement::calculateUIntegerLength(clusterPosition);
+                                    hasPosition = true;
+                                    break;
+                                default:
+                                    clusterSize += level2Element->totalSize();
+                                }
+                                clusterReadSize += level2Element->totalSize();
+                            }
+                            if (layout) {
+                                *layout = SegmentData::ClusterLayout{ clusterPosition, clusterSize, hasPosition };
+                            } else {
+                                segment.clusterLayouts.emplace_back(SegmentData::ClusterLayout{ clusterPosition, clusterSize, hasPosition });
                             }
                         }
+                        segment.clusterSizes.push_back(clusterSize);
+                        segment.totalDataSize += 4 + EbmlElement::calculateSizeDenotationLength(clusterSize) + clusterSize;
                         // check whether aborted (because this loop might take some seconds to process)
                         progress.stopIfAborted();
                         // update the progress percentage (using offset / file size should be accurate enough)
@@ -1391,6 +3036,18 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                         }
                         // TODO: reduce code duplication for aborting and progress updates
                     }
+                    segment.clusterLayoutsComplete = true;
+                    // compute cluster positions and size of the generated "Cues"-element now that all cue points are known
+                    if (collectCuePoints) {
+                        segment.cuePointsCollected = true;
+                        if (segment.cuesUpdater.hasCues()) {
+                            diag.emplace_back(DiagLevel::Information,
+                                argsToString("Generated index with ", segment.cuesUpdater.generatedCuePointCount(), " cue points for segment ",
+                                    segmentIndex, '.'),
+                                context);
+                            goto calculateSegmentSize;
+                        }
+                    }
                     // check whether the total size of the "Cues"-element has been invalidated and recompute cluster if required
                     if (cuesInvalidated) {
                         // reset element size to previously saved offset of "Cues"-element
@@ -1400,7 +3057,7 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
 
                     // pretend writing "Cues"-element
                     progress.updateStep("Calculating offsets of elements after cluster ...");
-                    if (newCuesPos == ElementPosition::AfterData && segment.cuesElement) {
+                    if (newCuesPos == ElementPosition::AfterData && segment.cuesUpdater.hasCues()) {
                         // update offset of "Cues"-element in "SeekHead"-element
                         if (segment.seekInfo.push(0, MatroskaIds::Cues, currentPosition + segment.totalDataSize)) {
                             goto calculateSegmentSize;
@@ -1459,8 +3116,9 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                 readOffset += level0Element->totalSize();
             }
         }
+        newFileSize = currentOffset;
 
-        if (!rewriteRequired) {
+        if (!rewriteRequired && !fileInfo().isForcingInPlace()) {
             // check whether the new padding is ok according to specifications
             if ((rewriteRequired = (newPadding > fileInfo().maxPadding() || newPadding < fileInfo().minPadding()))) {
                 // need to recalculate segment data for rewrite
@@ -1479,22 +3137,88 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
         throw;
     }
 
+    // fail before modifying the file if it would need to be rewritten but applying changes in-place is enforced
+    if (rewriteRequired && fileInfo().isForcingInPlace()) {
+        diag.emplace_back(DiagLevel::Critical, "The file would need to be rewritten but applying changes in-place is enforced.", context);
+        throw RewriteRequiredException();
+    }
+
+    // report cue points which could not be resolved when pretending writing the clusters
+    if (rewriteRequired && m_streamingIndexValidation) {
+        for (const auto &segment : segmentData) {
+            if (segment.cuesElement) {
+                segment.cuesUpdater.reportUnresolvedOffsets(diag);
+            }
+        }
+    }
+
+    // report the layout; the original padding is the "Void"-elements in front of the first "Cluster"-element of each segment
+    auto originalPadding = std::uint64_t();
+    for (level0Element = firstElement(); level0Element; level0Element = level0Element->nextSibling()) {
+        if (level0Element->id() != MatroskaIds::Segment) {
+            continue;
+        }
+        for (level1Element = level0Element->firstChild(); level1Element && level1Element->id() != MatroskaIds::Cluster;
+             level1Element = level1Element->nextSibling()) {
+            if (level1Element->id() == EbmlIds::Void) {
+                originalPadding += level1Element->totalSize();
+            }
+        }
+    }
+    m_applyChangesResult.setLayout(rewriteRequired, originalPadding, newPadding);
+    m_applyChangesResult.fileSizeAfter = newFileSize;
+
+    // return the layout if only planning the changes; when rewriting, the clusters are copied
+    if (m_planningFile) {
+        if (rewriteRequired) {
+            for (const auto &segment : segmentData) {
+                for (const auto clusterSize : segment.clusterSizes) {
+                    m_applyChangesResult.bytesCopied += clusterSize;
+                }
+            }
+        }
+        return;
+    }
+
     // setup stream(s) for writing
     // -> update status
+    layoutTimer.stop();
     progress.nextStepOrStop("Preparing streams ...");
 
     // -> define variables needed to handle output stream and backup stream (required when rewriting the file)
-    string backupPath;
+    string backupPath, journalPath;
     NativeFileStream &outputStream = fileInfo().stream();
     NativeFileStream backupStream; // create a stream to open the backup/original file for the case rewriting the file is required
-    BinaryWriter outputWriter(&outputStream);
+    BackupHelper::TemporaryFile temporaryFile; // the new file replacing the original file when using BackupStrategy::TemporaryFile
+    // -> write to the seekless output instead and read from the untouched original file if set
+    std::ostream &targetStream = m_seeklessOutput ? static_cast<std::ostream &>(*m_seeklessOutput) : outputStream;
+    std::istream &originalStream = m_seeklessOutput ? static_cast<std::istream &>(outputStream) : backupStream;
+    BinaryWriter outputWriter(&targetStream);
     char buff[8]; // buffer used to make size denotations
 
-    if (rewriteRequired) {
-        if (fileInfo().saveFilePath().empty()) {
+    if (m_seeklessOutput) {
+        // the range copier is not opened as the kernel can only copy between regular files
+        diag.emplace_back(DiagLevel::Information, "Writing the file to a seekless output.", context);
+    } else if (rewriteRequired) {
+        if (fileInfo().saveFilePath().empty() && fileInfo().backupStrategy() == BackupStrategy::TemporaryFile
+            && temporaryFile.create(fileInfo().path())) {
+            // keep the original file untouched as backupStream and write the new file into the temporary file replacing it when done
+            try {
+                backupStream.exceptions(ios_base::badbit | ios_base::failbit);
+                backupStream.open(BasicFileInfo::pathForOpen(fileInfo().path()), ios_base::in | ios_base::binary);
+                fileInfo().close();
+                outputStream.open(BasicFileInfo::pathForOpen(temporaryFile.path()), ios_base::out | ios_base::binary | ios_base::trunc);
+            } catch (const std::ios_base::failure &failure) {
+                diag.emplace_back(DiagLevel::Critical, argsToString("Opening streams to write output file failed: ", failure.what()), context);
+                throw;
+            }
+        } else if (fileInfo().saveFilePath().empty()) {
             // move current file to temp dir and reopen it as backupStream, recreate original file
             try {
-                BackupHelper::createBackupFile(fileInfo().backupDirectory(), fileInfo().path(), backupPath, outputStream, backupStream);
+                auto backupTimer = ApplyPhaseTimer(fileInfo().statistics(), ApplyPhase::Backup);
+                m_applyChangesResult.backupCopied = BackupHelper::createBackupFile(fileInfo().backupDirectory(), fileInfo().path(), backupPath,
+                    outputStream, backupStream, fileInfo().backupStrategy(), fileInfo().durabilityPolicy());
+                backupTimer.stop();
                 // recreate original file, define buffer variables
                 outputStream.open(BasicFileInfo::pathForOpen(fileInfo().path()), ios_base::out | ios_base::binary | ios_base::trunc);
             } catch (const std::ios_base::failure &failure) {
@@ -1518,6 +3242,17 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
         // set backup stream as associated input stream since we need the original elements to write the new file
         setStream(backupStream);
 
+        // allow copying unchanged elements by the kernel
+        rangeCopier().open(backupStream, backupPath.empty() ? fileInfo().path() : backupPath, outputStream,
+            temporaryFile.isCreated() ? temporaryFile.path() : (fileInfo().saveFilePath().empty() ? fileInfo().path() : fileInfo().saveFilePath()));
+
+        // reserve the space for the new file (its size is known from the calculation above)
+        if (!rangeCopier().preallocate(newFileSize)) {
+            diag.emplace_back(
+                DiagLevel::Critical, argsToString("There is not enough space to write the new file of ", newFileSize, " bytes."), context);
+            throw std::ios_base::failure("not enough space");
+        }
+
         // TODO: reduce code duplication
 
     } else { // !rewriteRequired
@@ -1534,6 +3269,33 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
             diag.emplace_back(DiagLevel::Critical, argsToString("Opening the file with write permissions failed: ", failure.what()), context);
             throw;
         }
+
+        // save everything but the clusters to the journal ("Position"-elements within clusters are updated as well)
+        if (fileInfo().backupStrategy() == BackupStrategy::Journal) {
+            vector<pair<std::uint64_t, std::uint64_t>> clusterRanges;
+            for (const auto &segment : segmentData) {
+                for (auto *cluster = segment.firstClusterElement; cluster; cluster = cluster->siblingById(MatroskaIds::Cluster, diag)) {
+                    // -> keep the header when finalizing as unknown sizes are replaced
+                    auto rangeStart = m_finalizing ? cluster->dataOffset() : cluster->startOffset();
+                    for (auto *child = cluster->firstChild(); child; child = child->nextSibling()) {
+                        if (child->id() == MatroskaIds::Position) {
+                            clusterRanges.emplace_back(rangeStart, child->startOffset());
+                            rangeStart = child->endOffset();
+                        }
+                    }
+                    clusterRanges.emplace_back(rangeStart, cluster->endOffset());
+                }
+            }
+            try {
+                BackupHelper::createJournal(fileInfo().backupDirectory(), fileInfo().path(), journalPath, outputStream, fileInfo().size(), clusterRanges);
+            } catch (const std::ios_base::failure &failure) {
+                diag.emplace_back(DiagLevel::Critical, failure.what(), context);
+                throw;
+            }
+        } else if (fileInfo().backupStrategy() == BackupStrategy::Clone) {
+            // clone the file so it can be restored if patching it fails (if supported by the file system)
+            BackupHelper::createCloneBackupFile(fileInfo().backupDirectory(), fileInfo().path(), backupPath, fileInfo().durabilityPolicy());
+        }
     }
 
     // start actual writing
@@ -1542,14 +3304,14 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
         progress.nextStepOrStop("Writing EBML header ...");
         outputWriter.writeUInt32BE(EbmlIds::Header);
         sizeLength = EbmlElement::makeSizeDenotation(ebmlHeaderDataSize, buff);
-        outputStream.write(buff, sizeLength);
-        EbmlElement::makeSimpleElement(outputStream, EbmlIds::Version, m_version);
-        EbmlElement::makeSimpleElement(outputStream, EbmlIds::ReadVersion, m_readVersion);
-        EbmlElement::makeSimpleElement(outputStream, EbmlIds::MaxIdLength, m_maxIdLength);
-        EbmlElement::makeSimpleElement(outputStream, EbmlIds::MaxSizeLength, m_maxSizeLength);
-        EbmlElement::makeSimpleElement(outputStream, EbmlIds::DocType, m_doctype);
-        EbmlElement::makeSimpleElement(outputStream, EbmlIds::DocTypeVersion, m_doctypeVersion);
-        EbmlElement::makeSimpleElement(outputStream, EbmlIds::DocTypeReadVersion, m_doctypeReadVersion);
+        targetStream.write(buff, sizeLength);
+        EbmlElement::makeSimpleElement(targetStream, EbmlIds::Version, m_version);
+        EbmlElement::makeSimpleElement(targetStream, EbmlIds::ReadVersion, m_readVersion);
+        EbmlElement::makeSimpleElement(targetStream, EbmlIds::MaxIdLength, m_maxIdLength);
+        EbmlElement::makeSimpleElement(targetStream, EbmlIds::MaxSizeLength, m_maxSizeLength);
+        EbmlElement::makeSimpleElement(targetStream, EbmlIds::DocType, m_doctype);
+        EbmlElement::makeSimpleElement(targetStream, EbmlIds::DocTypeVersion, m_doctypeVersion);
+        EbmlElement::makeSimpleElement(targetStream, EbmlIds::DocTypeReadVersion, m_doctypeReadVersion);
 
         // iterates through all level 0 elements of the original file
         for (level0Element = firstElement(), segmentIndex = 0, currentPosition = 0; level0Element; level0Element = level0Element->nextSibling()) {
@@ -1573,8 +3335,8 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                 progress.updateStep("Writing segment header ...");
                 outputWriter.writeUInt32BE(MatroskaIds::Segment);
                 sizeLength = EbmlElement::makeSizeDenotation(segment.totalDataSize, buff);
-                outputStream.write(buff, sizeLength);
-                segment.newDataOffset = offset = static_cast<std::uint64_t>(outputStream.tellp()); // store segment data offset here
+                targetStream.write(buff, sizeLength);
+                segment.newDataOffset = offset = static_cast<std::uint64_t>(targetStream.tellp()); // store segment data offset here
 
                 // write CRC-32 element ...
                 if (segment.hasCrc32) {
@@ -1582,12 +3344,19 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                     *buff = static_cast<char>(EbmlIds::Crc32);
                     *(buff + 1) = static_cast<char>(0x84); // length denotation: 4 byte
                     // set the value after writing the element
-                    crc32Offsets.emplace_back(outputStream.tellp(), segment.totalDataSize);
-                    outputStream.write(buff, 6);
+                    crc32Offsets.emplace_back(targetStream.tellp(), segment.totalDataSize);
+                    targetStream.write(buff, 6);
+                } else if (m_seeklessOutput && level0Element->firstChild() && level0Element->firstChild()->id() == EbmlIds::Crc32) {
+                    diag.emplace_back(DiagLevel::Warning,
+                        argsToString("The CRC-32 checksum of segment ", segmentIndex, " is omitted as it can not be written to a seekless output."),
+                        context);
                 }
 
                 // write "SeekHead"-element (except there is no seek information for the current segment)
-                segment.seekInfo.make(outputStream, diag);
+                segment.seekInfo.make(targetStream, diag);
+                if (m_seekHeadReservation) {
+                    segment.seekInfo.makeReserve(targetStream);
+                }
 
                 // write "SegmentInfo"-element
                 for (level1Element = level0Element->childById(MatroskaIds::SegmentInfo, diag); level1Element;
@@ -1595,7 +3364,7 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                     // -> write ID and size
                     outputWriter.writeUInt32BE(MatroskaIds::SegmentInfo);
                     sizeLength = EbmlElement::makeSizeDenotation(segment.infoDataSize, buff);
-                    outputStream.write(buff, sizeLength);
+                    targetStream.write(buff, sizeLength);
                     // -> write children
                     for (level2Element = level1Element->firstChild(); level2Element; level2Element = level2Element->nextSibling()) {
                         switch (level2Element->id()) {
@@ -1606,7 +3375,7 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                         case MatroskaIds::WrittingApp: // written separately
                             break;
                         default:
-                            level2Element->copyBuffer(outputStream);
+                            level2Element->copyBuffer(targetStream);
                             level2Element->discardBuffer();
                         }
                     }
@@ -1614,12 +3383,12 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                     if (segmentIndex < m_titles.size()) {
                         const auto &title = m_titles[segmentIndex];
                         if (!title.empty()) {
-                            EbmlElement::makeSimpleElement(outputStream, MatroskaIds::Title, title);
+                            EbmlElement::makeSimpleElement(targetStream, MatroskaIds::Title, title);
                         }
                     }
                     // -> write "MuxingApp"- and "WritingApp"-element
-                    EbmlElement::makeSimpleElement(outputStream, MatroskaIds::MuxingApp, muxingAppName, muxingAppElementDataSize);
-                    EbmlElement::makeSimpleElement(outputStream, MatroskaIds::WrittingApp,
+                    EbmlElement::makeSimpleElement(targetStream, MatroskaIds::MuxingApp, muxingAppName, muxingAppElementDataSize);
+                    EbmlElement::makeSimpleElement(targetStream, MatroskaIds::WrittingApp,
                         fileInfo().writingApplication().empty() ? muxingAppName : fileInfo().writingApplication().data(), writingAppElementDataSize);
                 }
 
@@ -1627,16 +3396,16 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                 if (trackHeaderElementsSize) {
                     outputWriter.writeUInt32BE(MatroskaIds::Tracks);
                     sizeLength = EbmlElement::makeSizeDenotation(trackHeaderElementsSize, buff);
-                    outputStream.write(buff, sizeLength);
+                    targetStream.write(buff, sizeLength);
                     for (auto &maker : trackHeaderMaker) {
-                        maker.make(outputStream);
+                        maker.make(targetStream);
                     }
                 }
 
                 // write "Chapters"-element
                 for (level1Element = level0Element->childById(MatroskaIds::Chapters, diag); level1Element;
                      level1Element = level1Element->siblingById(MatroskaIds::Chapters, diag)) {
-                    level1Element->copyBuffer(outputStream);
+                    level1Element->copyBuffer(targetStream);
                     level1Element->discardBuffer();
                 }
 
@@ -1645,25 +3414,35 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                     if (tagsSize) {
                         outputWriter.writeUInt32BE(MatroskaIds::Tags);
                         sizeLength = EbmlElement::makeSizeDenotation(tagElementsSize, buff);
-                        outputStream.write(buff, sizeLength);
+                        targetStream.write(buff, sizeLength);
+                        if (tagsHaveCrc32) {
+                            EbmlElement::makeCrc32Element(buff, 0);
+                            crc32Offsets.emplace_back(targetStream.tellp(), tagElementsSize);
+                            targetStream.write(buff, EbmlElement::crc32ElementSize);
+                        }
                         for (auto &maker : tagMaker) {
-                            maker.make(outputStream);
+                            maker.make(targetStream);
                         }
                     }
                     // write "Attachments"-element
                     if (attachmentsSize) {
                         outputWriter.writeUInt32BE(MatroskaIds::Attachments);
                         sizeLength = EbmlElement::makeSizeDenotation(attachedFileElementsSize, buff);
-                        outputStream.write(buff, sizeLength);
+                        targetStream.write(buff, sizeLength);
+                        if (attachmentsHaveCrc32) {
+                            EbmlElement::makeCrc32Element(buff, 0);
+                            crc32Offsets.emplace_back(targetStream.tellp(), attachedFileElementsSize);
+                            targetStream.write(buff, EbmlElement::crc32ElementSize);
+                        }
                         for (auto &maker : attachmentMaker) {
-                            maker.make(outputStream, diag);
+                            maker.make(targetStream, diag, &rangeCopier());
                         }
                     }
                 }
 
                 // write "Cues"-element
-                if (newCuesPos == ElementPosition::BeforeData && segment.cuesElement) {
-                    segment.cuesUpdater.make(outputStream, diag);
+                if (newCuesPos == ElementPosition::BeforeData && segment.cuesUpdater.hasCues()) {
+                    segment.cuesUpdater.make(targetStream, diag);
                 }
 
                 // write padding / "Void"-element
@@ -1679,10 +3458,10 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                     }
                     // write header
                     outputWriter.writeByte(EbmlIds::Void);
-                    outputStream.write(buff, sizeLength);
+                    targetStream.write(buff, sizeLength);
                     // write zeroes
                     for (; voidLength; --voidLength) {
-                        outputStream.put(0);
+                        targetStream.put(0);
                     }
                 }
 
@@ -1691,42 +3470,66 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                 if (rewriteRequired) {
                     // update status, check whether the operation has been aborted
                     progress.nextStepOrStop("Writing cluster ...",
-                        static_cast<std::uint8_t>((static_cast<std::uint64_t>(outputStream.tellp()) - offset) * 100 / segment.totalDataSize));
+                        static_cast<std::uint8_t>((static_cast<std::uint64_t>(targetStream.tellp()) - offset) * 100 / segment.totalDataSize));
                     // write "Cluster"-element
                     auto clusterSizesIterator = segment.clusterSizes.cbegin();
                     unsigned int index = 0;
                     for (; level1Element; level1Element = level1Element->siblingById(MatroskaIds::Cluster, diag), ++clusterSizesIterator, ++index) {
                         // calculate position of cluster in segment
-                        clusterSize = currentPosition + (static_cast<std::uint64_t>(outputStream.tellp()) - offset);
+                        clusterSize = currentPosition + (static_cast<std::uint64_t>(targetStream.tellp()) - offset);
                         // write header; checking whether clusterSizesIterator is valid shouldn't be necessary
                         outputWriter.writeUInt32BE(MatroskaIds::Cluster);
                         sizeLength = EbmlElement::makeSizeDenotation(*clusterSizesIterator, buff);
-                        outputStream.write(buff, sizeLength);
+                        targetStream.write(buff, sizeLength);
                         // write children
+                        // -> copy adjacent children as one range so the data can be copied by the kernel in one go
+                        std::uint64_t pendingStart = 0, pendingEnd = 0;
+                        const auto flushPendingChildren = [&] {
+                            if (pendingEnd > pendingStart) {
+                                originalStream.seekg(static_cast<streamoff>(pendingStart));
+                                rangeCopier().copy(originalStream, targetStream, pendingEnd - pendingStart);
+                            }
+                            pendingStart = pendingEnd = 0;
+                        };
                         for (level2Element = level1Element->firstChild(); level2Element; level2Element = level2Element->nextSibling()) {
                             switch (level2Element->id()) {
                             case EbmlIds::Void:
                             case EbmlIds::Crc32:
+                                flushPendingChildren();
                                 break;
                             case MatroskaIds::Position:
-                                EbmlElement::makeSimpleElement(outputStream, MatroskaIds::Position, clusterSize);
+                                flushPendingChildren();
+                                EbmlElement::makeSimpleElement(targetStream, MatroskaIds::Position, clusterSize);
                                 break;
                             default:
-                                level2Element->copyEntirely(outputStream, diag, nullptr);
+                                if (pendingEnd != level2Element->startOffset()) {
+                                    flushPendingChildren();
+                                    pendingStart = level2Element->startOffset();
+                                }
+                                pendingEnd = level2Element->endOffset();
                             }
                         }
+                        flushPendingChildren();
                         // update percentage, check whether the operation has been aborted
                         progress.stopIfAborted();
                         if (index % 50 == 0) {
                             progress.updateStepPercentage(
-                                static_cast<std::uint8_t>((static_cast<std::uint64_t>(outputStream.tellp()) - offset) * 100 / segment.totalDataSize));
+                                static_cast<std::uint8_t>((static_cast<std::uint64_t>(targetStream.tellp()) - offset) * 100 / segment.totalDataSize));
                         }
                     }
                 } else {
                     // can't just skip existing "Cluster"-elements: "Position"-elements must be updated
                     progress.nextStepOrStop("Updateing cluster ...",
-                        static_cast<std::uint8_t>((static_cast<std::uint64_t>(outputStream.tellp()) - offset) * 100 / segment.totalDataSize));
+                        static_cast<std::uint8_t>((static_cast<std::uint64_t>(targetStream.tellp()) - offset) * 100 / segment.totalDataSize));
                     for (; level1Element; level1Element = level1Element->nextSibling()) {
+                        // replace unknown size with the actual size when finalizing (possible if the size denotation keeps its length)
+                        if (m_finalizing && level1Element->id() == MatroskaIds::Cluster && hasUnknownSizeDenotation(outputStream, *level1Element)) {
+                            sizeLength = EbmlElement::makeSizeDenotation(level1Element->dataSize(), buff, 8);
+                            if (sizeLength == level1Element->sizeLength()) {
+                                targetStream.seekp(static_cast<streamoff>(level1Element->startOffset() + level1Element->idLength()));
+                                targetStream.write(buff, sizeLength);
+                            }
+                        }
                         for (level2Element = level1Element->firstChild(); level2Element; level2Element = level2Element->nextSibling()) {
                             switch (level2Element->id()) {
                             case MatroskaIds::Position:
@@ -1736,12 +3539,12 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                                 // new position can only applied if it doesn't need more bytes than the previous position
                                 if (level2Element->dataSize() < sizeLength) {
                                     // can't update position -> void position elements ("Position"-elements seem a bit useless anyways)
-                                    outputStream.seekp(static_cast<streamoff>(level2Element->startOffset()));
-                                    outputStream.put(static_cast<char>(EbmlIds::Void));
+                                    targetStream.seekp(static_cast<streamoff>(level2Element->startOffset()));
+                                    targetStream.put(static_cast<char>(EbmlIds::Void));
                                 } else {
                                     // update position
-                                    outputStream.seekp(static_cast<streamoff>(level2Element->dataOffset()));
-                                    outputStream.write(buff, sizeLength);
+                                    targetStream.seekp(static_cast<streamoff>(level2Element->dataOffset()));
+                                    targetStream.write(buff, sizeLength);
                                 }
                                 break;
                             default:;
@@ -1749,14 +3552,14 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                         }
                     }
                     // skip existing "Cluster"-elements
-                    outputStream.seekp(static_cast<streamoff>(segment.clusterEndOffset));
+                    targetStream.seekp(static_cast<streamoff>(segment.clusterEndOffset));
                 }
 
                 progress.updateStep("Writing segment tail ...");
 
                 // write "Cues"-element
-                if (newCuesPos == ElementPosition::AfterData && segment.cuesElement) {
-                    segment.cuesUpdater.make(outputStream, diag);
+                if (newCuesPos == ElementPosition::AfterData && segment.cuesUpdater.hasCues()) {
+                    segment.cuesUpdater.make(targetStream, diag);
                 }
 
                 if (newTagPos == ElementPosition::AfterData && segmentIndex == lastSegmentIndex) {
@@ -1764,18 +3567,28 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
                     if (tagsSize) {
                         outputWriter.writeUInt32BE(MatroskaIds::Tags);
                         sizeLength = EbmlElement::makeSizeDenotation(tagElementsSize, buff);
-                        outputStream.write(buff, sizeLength);
+                        targetStream.write(buff, sizeLength);
+                        if (tagsHaveCrc32) {
+                            EbmlElement::makeCrc32Element(buff, 0);
+                            crc32Offsets.emplace_back(targetStream.tellp(), tagElementsSize);
+                            targetStream.write(buff, EbmlElement::crc32ElementSize);
+                        }
                         for (auto &maker : tagMaker) {
-                            maker.make(outputStream);
+                            maker.make(targetStream);
                         }
                     }
                     // write "Attachments"-element
                     if (attachmentsSize) {
                         outputWriter.writeUInt32BE(MatroskaIds::Attachments);
                         sizeLength = EbmlElement::makeSizeDenotation(attachedFileElementsSize, buff);
-                        outputStream.write(buff, sizeLength);
+                        targetStream.write(buff, sizeLength);
+                        if (attachmentsHaveCrc32) {
+                            EbmlElement::makeCrc32Element(buff, 0);
+                            crc32Offsets.emplace_back(targetStream.tellp(), attachedFileElementsSize);
+                            targetStream.write(buff, EbmlElement::crc32ElementSize);
+                        }
                         for (auto &maker : attachmentMaker) {
-                            maker.make(outputStream, diag);
+                            maker.make(targetStream, diag, &rangeCopier());
                         }
                     }
                 }
@@ -1790,11 +3603,17 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
             }
             default:
                 // just copy any unknown top-level elements
-                level0Element->copyEntirely(outputStream, diag, nullptr);
+                level0Element->copyEntirely(targetStream, diag, nullptr);
                 currentPosition += level0Element->totalSize();
             }
         }
 
+        // keep the parsing results when writing to a seekless output as the original file has not been modified
+        if (m_seeklessOutput) {
+            targetStream.flush();
+            return;
+        }
+
         // reparse what is written so far
         progress.updateStep("Reparsing output file ...");
         if (rewriteRequired) {
@@ -1808,8 +3627,9 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
             }
 
             // the outputStream needs to be reopened to be able to read again
+            rangeCopier().close();
             outputStream.close();
-            outputStream.open(fileInfo().path(), ios_base::in | ios_base::out | ios_base::binary);
+            outputStream.open(temporaryFile.isCreated() ? temporaryFile.path() : fileInfo().path(), ios_base::in | ios_base::out | ios_base::binary);
             setStream(outputStream);
         } else {
             const auto newSize = static_cast<std::uint64_t>(outputStream.tellp());
@@ -1839,22 +3659,263 @@ void MatroskaContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFee
         }
 
         // update CRC-32 checksums
+        // -> the checksums of inner elements must be updated first as they are covered by the checksum of the enclosing segment
         if (!crc32Offsets.empty()) {
             progress.updateStep("Updating CRC-32 checksums ...");
-            for (const auto &crc32Offset : crc32Offsets) {
-                outputStream.seekg(static_cast<streamoff>(get<0>(crc32Offset) + 6));
-                outputStream.seekp(static_cast<streamoff>(get<0>(crc32Offset) + 2));
-                writer().writeUInt32LE(reader().readCrc32(get<1>(crc32Offset) - 6));
+            for (auto i = crc32Offsets.crbegin(), end = crc32Offsets.crend(); i != end; ++i) {
+                const auto [crc32Offset, blockSize] = *i;
+                const auto crc32 = EbmlElement::computeCrc32(
+                    outputStream, crc32Offset + EbmlElement::crc32ElementSize, blockSize - EbmlElement::crc32ElementSize);
+                outputStream.seekp(static_cast<streamoff>(crc32Offset + 2));
+                writer().writeUInt32LE(crc32);
             }
         }
 
         // prevent deferring final write operations (to catch and handle possible errors here)
         outputStream.flush();
 
+        // replace the original file with the new file now that it has been written completely
+        if (temporaryFile.isCreated() && !temporaryFile.replaceOriginalFile(fileInfo().path(), fileInfo().durabilityPolicy())) {
+            diag.emplace_back(DiagLevel::Warning, "Unable to sync the directory containing the file to the disk.", context);
+        }
+
         // handle errors (which might have been occurred after renaming/creating backup file)
     } catch (...) {
-        BackupHelper::handleFailureAfterFileModified(fileInfo(), backupPath, outputStream, backupStream, diag, context);
+        rangeCopier().close();
+        if (m_seeklessOutput) {
+            diag.emplace_back(DiagLevel::Critical, "Writing the file to the seekless output failed.", context);
+            throw;
+        }
+        if (temporaryFile.isCreated()) {
+            // the original file has not been touched -> just free the temporary file
+            outputStream.close();
+            temporaryFile.discard();
+        }
+        BackupHelper::handleFailureAfterFileModified(fileInfo(), backupPath, journalPath, outputStream, backupStream, diag, context);
+    }
+}
+
+/*!
+ * \brief Overwrites only the changed "Tag"-elements if possible.
+ * \returns Returns whether the tags could be patched. If not, nothing has been written and the file needs to be made as
+ *          usual.
+ *
+ * The tags made by the specified \a tagMaker are compared with the "Tag"-elements of the only "Tags"-element by their
+ * position so the resulting "Tags"-element contains the same tags as the one which would be made otherwise. Tags which
+ * differ are overwritten at their offset if they fit into the space of the original element and the "Void"-elements
+ * directly following it. The remaining space is turned into a "Void"-element (if only one byte remains, the size of the
+ * "Tag"-element is denoted using one more byte instead). The last tag might also use a "Void"-element directly following
+ * the "Tags"-element; the size of the "Tags"-element is patched accordingly then. A "CRC-32"-element of the "Tags"-element
+ * is updated.
+ *
+ * \remarks The content of "Void"-elements is not overwritten.
+ * \sa setTagPatchingEnabled()
+ */
+bool MatroskaContainer::patchTags(std::vector<MatroskaTagMaker> &tagMaker, Diagnostics &diag, AbortableProgressFeedback &progress)
+{
+    static const string context("patching Matroska tags");
+
+    // find the "Tag"-elements of the only "Tags"-element and the space they might use
+    if (m_segmentCount != 1 || m_tagsElements.size() != 1) {
+        return false;
+    }
+    EbmlElement *const tagsElement = m_tagsElements.front();
+    EbmlElement *crc32Element = nullptr, *paddingElement = nullptr;
+    auto oldTags = vector<pair<EbmlElement *, std::uint64_t>>(); // the "Tag"-elements and the end of the space they might use
+    try {
+        if (tagsElement->parent()->firstChild() && tagsElement->parent()->firstChild()->id() == EbmlIds::Crc32) {
+            // the checksum of the whole segment would need to be updated
+            return false;
+        }
+        for (EbmlElement *child = tagsElement->firstChild(); child; child = child->nextSibling()) {
+            child->parse(diag);
+            switch (child->id()) {
+            case MatroskaIds::Tag:
+                oldTags.emplace_back(child, child->endOffset());
+                break;
+            case EbmlIds::Void:
+                if (oldTags.empty()) {
+                    return false;
+                }
+                oldTags.back().second = child->endOffset();
+                break;
+            case EbmlIds::Crc32:
+                if (child != tagsElement->firstChild() || child->headerSize() != 2 || child->dataSize() != 4) {
+                    return false;
+                }
+                crc32Element = child;
+                break;
+            default:
+                return false;
+            }
+        }
+        if (oldTags.empty() || oldTags.back().second != tagsElement->endOffset()) {
+            return false;
+        }
+        if ((paddingElement = tagsElement->nextSibling())) {
+            paddingElement->parse(diag);
+            if (paddingElement->id() != EbmlIds::Void) {
+                paddingElement = nullptr;
+            }
+        }
+    } catch (const Failure &) {
+        return false;
+    }
+
+    // make the tags in memory (empty tags are skipped as usual)
+    auto newTags = vector<string>();
+    newTags.reserve(tagMaker.size());
+    for (const auto &maker : tagMaker) {
+        if (maker.requiredSize() > 3) {
+            auto buffer = stringstream(ios_base::in | ios_base::out | ios_base::binary);
+            buffer.exceptions(ios_base::badbit | ios_base::failbit);
+            maker.make(buffer);
+            newTags.emplace_back(buffer.str());
+        }
+    }
+    if (newTags.size() != oldTags.size()) {
+        return false;
+    }
+
+    // compare the tags with the original "Tag"-elements to determine what needs to be written
+    auto patches = vector<pair<std::uint64_t, string>>();
+    auto oldPadding = std::uint64_t(), newPadding = std::uint64_t();
+    auto newTagsEnd = tagsElement->endOffset();
+    auto oldData = string(static_cast<std::size_t>(tagsElement->dataSize()), '\0');
+    auto &inputStream = stream();
+    inputStream.seekg(static_cast<streamoff>(tagsElement->dataOffset()));
+    inputStream.read(oldData.data(), static_cast<streamsize>(oldData.size()));
+    char buff[9];
+    for (std::size_t index = 0, count = newTags.size(); index != count; ++index) {
+        const auto [oldTag, oldSpaceEnd] = oldTags[index];
+        auto &newTag = newTags[index];
+        if (newTag.size() == oldTag->totalSize()) {
+            if (oldData.compare(oldTag->startOffset() - tagsElement->dataOffset(), newTag.size(), newTag)) {
+                patches.emplace_back(oldTag->startOffset(), move(newTag));
+            }
+            continue;
+        }
+        // -> use the "Void"-elements following the tag; the last tag might also use the "Void"-element following the "Tags"-element
+        const auto usesPadding = newTag.size() > oldSpaceEnd - oldTag->startOffset() && index + 1 == count && paddingElement;
+        const auto spaceEnd = usesPadding ? paddingElement->endOffset() : oldSpaceEnd;
+        if (newTag.size() > spaceEnd - oldTag->startOffset()) {
+            return false;
+        }
+        auto remainingSpace = spaceEnd - oldTag->startOffset() - newTag.size();
+        if (remainingSpace == 1) {
+            // -> denote the size using one more byte as a "Void"-element takes at least two bytes
+            const auto idLength = EbmlElement::calculateIdLength(MatroskaIds::Tag);
+            auto sizeLength = std::uint8_t(1);
+            for (auto mask = 0x80u; sizeLength < 8 && !(static_cast<unsigned char>(newTag[idLength]) & mask); mask >>= 1) {
+                ++sizeLength;
+            }
+            if (sizeLength >= 8) {
+                return false;
+            }
+            const auto dataSize = newTag.size() - idLength - sizeLength;
+            newTag.replace(idLength, sizeLength, buff, EbmlElement::makeSizeDenotation(dataSize, buff, static_cast<std::uint8_t>(sizeLength + 1)));
+            remainingSpace = 0;
+        }
+        const auto paddingOffset = oldTag->startOffset() + newTag.size();
+        patches.emplace_back(oldTag->startOffset(), move(newTag));
+        if (remainingSpace) {
+            // -> write only the header of the "Void"-element
+            const auto sizeLength = static_cast<std::uint8_t>(remainingSpace < 64 ? 1 : 8);
+            auto &voidHeader = patches.emplace_back(paddingOffset, string(1, static_cast<char>(EbmlIds::Void))).second;
+            voidHeader.append(buff, EbmlElement::makeSizeDenotation(remainingSpace - 1 - sizeLength, buff, sizeLength));
+        }
+        if (usesPadding) {
+            oldPadding = paddingElement->totalSize();
+            newPadding = remainingSpace;
+            newTagsEnd = paddingOffset;
+        }
+    }
+
+    // patch the size of the "Tags"-element if the last tag has used the "Void"-element following it
+    if (newTagsEnd != tagsElement->endOffset()) {
+        const auto newDataSize = newTagsEnd - tagsElement->dataOffset();
+        if (EbmlElement::calculateSizeDenotationLength(newDataSize) > tagsElement->sizeLength()) {
+            return false;
+        }
+        patches.emplace_back(tagsElement->startOffset() + tagsElement->idLength(),
+            string(buff, EbmlElement::makeSizeDenotation(newDataSize, buff, static_cast<std::uint8_t>(tagsElement->sizeLength()))));
+    }
+    sort(patches.begin(), patches.end(), [](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+    m_applyChangesResult.setLayout(false, oldPadding, newPadding);
+    m_applyChangesResult.fileSizeAfter = fileInfo().size();
+    if (m_planningFile || patches.empty()) {
+        return true;
+    }
+
+    // reopen original file to ensure it is opened for writing
+    progress.nextStepOrStop("Patching tags ...");
+    string backupPath, journalPath;
+    NativeFileStream &outputStream = fileInfo().stream();
+    NativeFileStream backupStream;
+    try {
+        fileInfo().close();
+        outputStream.open(fileInfo().path(), ios_base::in | ios_base::out | ios_base::binary);
+    } catch (const std::ios_base::failure &failure) {
+        diag.emplace_back(DiagLevel::Critical, argsToString("Opening the file with write permissions failed: ", failure.what()), context);
+        throw;
+    }
+
+    // save the bytes to be overwritten to the journal or clone the file if supported by the file system
+    const auto crc32Offset = crc32Element ? crc32Element->startOffset() : std::uint64_t();
+    if (fileInfo().backupStrategy() == BackupStrategy::Journal) {
+        auto unchangedRanges = vector<pair<std::uint64_t, std::uint64_t>>();
+        auto unchangedStart = std::uint64_t();
+        for (const auto &[offset, data] : patches) {
+            if (crc32Element && unchangedStart <= crc32Offset && crc32Offset < offset) {
+                unchangedRanges.emplace_back(unchangedStart, crc32Offset);
+                unchangedStart = crc32Offset + EbmlElement::crc32ElementSize;
+            }
+            unchangedRanges.emplace_back(unchangedStart, offset);
+            unchangedStart = offset + data.size();
+        }
+        unchangedRanges.emplace_back(unchangedStart, fileInfo().size());
+        try {
+            BackupHelper::createJournal(fileInfo().backupDirectory(), fileInfo().path(), journalPath, outputStream, fileInfo().size(), unchangedRanges);
+        } catch (const std::ios_base::failure &failure) {
+            diag.emplace_back(DiagLevel::Critical, failure.what(), context);
+            throw;
+        }
+    } else if (fileInfo().backupStrategy() == BackupStrategy::Clone) {
+        BackupHelper::createCloneBackupFile(fileInfo().backupDirectory(), fileInfo().path(), backupPath, fileInfo().durabilityPolicy());
+    }
+
+    try {
+        // write the changed tags, the headers of the "Void"-elements and the adjusted size
+        for (const auto &[offset, data] : patches) {
+            outputStream.seekp(static_cast<streamoff>(offset));
+            outputStream.write(data.data(), static_cast<streamsize>(data.size()));
+        }
+
+        // update the CRC-32 checksum
+        if (crc32Element) {
+            const auto crc32 = EbmlElement::computeCrc32(
+                outputStream, crc32Offset + EbmlElement::crc32ElementSize, newTagsEnd - crc32Offset - EbmlElement::crc32ElementSize);
+            outputStream.seekp(static_cast<streamoff>(crc32Offset + 2));
+            writer().writeUInt32LE(crc32);
+        }
+
+        // reparse what is written so far
+        progress.updateStep("Reparsing output file ...");
+        reset();
+        try {
+            parseHeader(diag);
+        } catch (const Failure &) {
+            diag.emplace_back(DiagLevel::Critical, "Unable to reparse the header of the new file.", context);
+            throw;
+        }
+
+        // prevent deferring final write operations (to catch and handle possible errors here)
+        outputStream.flush();
+
+    } catch (...) {
+        BackupHelper::handleFailureAfterFileModified(fileInfo(), backupPath, journalPath, outputStream, backupStream, diag, context);
     }
+    return true;
 }
 
 } // namespace TagParser
@@ -9,9 +9,14 @@
 
 #include "../genericcontainer.h"
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <limits>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 namespace TagParser {
@@ -21,14 +26,46 @@ class MatroskaEditionEntry;
 
 class MediaFileInfo;
 
+/*!
+ * \brief The MatroskaTrackStatistics struct holds the statistics of a track determined from the headers of its blocks.
+ * \sa MatroskaContainer::generateTrackStatistics()
+ */
+struct TAG_PARSER_EXPORT MatroskaTrackStatistics {
+    /// \brief The number of frames (laced frames are counted individually).
+    std::uint64_t frameCount = 0;
+    /// \brief The number of bytes of the frames (without the block headers and the lacing).
+    std::uint64_t byteCount = 0;
+    /// \brief The timestamp of the first frame in the timestamp scale of the segment.
+    std::int64_t firstTimestamp = std::numeric_limits<std::int64_t>::max();
+    /// \brief The timestamp the last frame ends at in the timestamp scale of the segment.
+    std::int64_t endTimestamp = std::numeric_limits<std::int64_t>::min();
+};
+
 class TAG_PARSER_EXPORT MatroskaContainer final : public GenericContainer<MediaFileInfo, MatroskaTag, MatroskaTrack, EbmlElement> {
+    friend class MatroskaChapterCursor;
+    friend class EbmlMasterBuffer;
+
 public:
     MatroskaContainer(MediaFileInfo &stream, std::uint64_t startOffset);
     ~MatroskaContainer() override;
 
     void validateIndex(Diagnostics &diag);
+    void validateIndexSample(Diagnostics &diag, double confidence = 0.95, double defectRatio = 0.01);
+    void validateClusters(Diagnostics &diag, std::size_t threadCount = 0);
+    void generateTrackStatistics(Diagnostics &diag, std::size_t threadCount = 0);
+    bool isStreamingIndexValidationEnabled() const;
+    void setStreamingIndexValidationEnabled(bool enabled);
+    bool isIndexGenerationEnabled() const;
+    void setIndexGenerationEnabled(bool enabled);
+    bool isFinalizingEnabled() const;
+    void setFinalizingEnabled(bool enabled);
+    bool isSeekHeadReservationEnabled() const;
+    void setSeekHeadReservationEnabled(bool enabled);
+    bool isTagPatchingEnabled() const;
+    void setTagPatchingEnabled(bool enabled);
     std::uint64_t maxIdLength() const;
     std::uint64_t maxSizeLength() const;
+    std::string_view bufferedData(std::uint64_t offset) const;
     const std::vector<std::unique_ptr<MatroskaSeekInfo>> &seekInfos() const;
 
     static std::uint64_t maxFullParseSize();
@@ -36,12 +73,17 @@ public:
     const std::vector<std::unique_ptr<MatroskaEditionEntry>> &editionEntires() const;
     MatroskaChapter *chapter(std::size_t index) override;
     std::size_t chapterCount() const override;
+    MatroskaTag *createTag(const TagTarget &target = TagTarget()) override;
+    bool removeTag(Tag *tag) override;
+    void removeAllTags() override;
+    MatroskaTag *tagByTarget(const TagTarget &target);
     MatroskaAttachment *createAttachment() override;
     MatroskaAttachment *attachment(std::size_t index) override;
     std::size_t attachmentCount() const override;
     ElementPosition determineElementPosition(std::uint64_t elementId, Diagnostics &diag) const;
     ElementPosition determineTagPosition(Diagnostics &diag) const override;
     ElementPosition determineIndexPosition(Diagnostics &diag) const override;
+    void hashMediaPayload(MediaPayloadHasher &hasher, Diagnostics &diag, AbortableProgressFeedback &progress) override;
 
     virtual bool supportsTitle() const override;
     virtual std::size_t segmentCount() const override;
@@ -54,14 +96,29 @@ protected:
     void internalParseTracks(Diagnostics &diag) override;
     void internalParseChapters(Diagnostics &diag) override;
     void internalParseAttachments(Diagnostics &diag) override;
+    bool internalResumeParsing(Diagnostics &diag) override;
     void internalMakeFile(Diagnostics &diag, AbortableProgressFeedback &progress) override;
 
 private:
+    void internalValidateIndex(Diagnostics &diag, std::size_t sampleSize, bool validateClusters = true);
+    void sweepClusters(Diagnostics &diag, std::size_t threadCount, const std::unordered_map<std::uint64_t, std::uint64_t> *defaultDurations,
+        std::unordered_map<std::uint64_t, MatroskaTrackStatistics> *statistics);
+    struct SegmentHeader;
+    void parseEbmlHeader(EbmlElement &header, Diagnostics &diag);
+    bool parseSegmentsConcurrently(Diagnostics &diag);
+    void parseSegmentHeader(SegmentHeader &segment);
     void parseSegmentInfo(Diagnostics &diag);
+    bool isFullParseWorthwhile(const EbmlElement &segment, const EbmlElement &cluster, std::uint64_t firstClusterOffset, std::uint64_t clusterCount,
+        std::chrono::steady_clock::duration elapsed, std::uint64_t elementsParsed) const;
+    void probeTagsAtSegmentEnd(EbmlElement &segment, std::uint64_t firstClusterOffset, Diagnostics &diag);
     void readTrackStatisticsFromTags(Diagnostics &diag);
+    void updateTagIndex();
+    bool patchTags(std::vector<MatroskaTagMaker> &tagMaker, Diagnostics &diag, AbortableProgressFeedback &progress);
 
     std::uint64_t m_maxIdLength;
     std::uint64_t m_maxSizeLength;
+    std::string m_masterBuffer;
+    std::uint64_t m_masterBufferOffset;
 
     std::vector<EbmlElement *> m_tracksElements;
     std::vector<EbmlElement *> m_segmentInfoElements;
@@ -71,8 +128,17 @@ private:
     std::vector<std::unique_ptr<MatroskaSeekInfo>> m_seekInfos;
     std::vector<std::unique_ptr<MatroskaEditionEntry>> m_editionEntries;
     std::vector<std::unique_ptr<MatroskaAttachment>> m_attachments;
+    std::unordered_multimap<std::size_t, MatroskaTag *> m_tagsByTarget;
     std::size_t m_segmentCount;
-    static std::uint64_t m_maxFullParseSize;
+    std::size_t m_indexedTagCount;
+    std::uint64_t m_tagIndexRevision;
+    bool m_streamingIndexValidation;
+    bool m_indexGeneration;
+    bool m_finalizing;
+    bool m_seekHeadReservation;
+    bool m_tagPatching;
+    bool m_tagIndexValid;
+    static std::atomic<std::uint64_t> m_maxFullParseSize;
 };
 
 /*!
@@ -91,6 +157,167 @@ inline std::uint64_t MatroskaContainer::maxSizeLength() const
     return m_maxSizeLength;
 }
 
+/*!
+ * \brief Returns the data of the currently buffered master element from the specified absolute \a offset on.
+ * \returns Returns an empty view if no master element is buffered or the \a offset is not within it.
+ * \sa EbmlMasterBuffer
+ */
+inline std::string_view MatroskaContainer::bufferedData(std::uint64_t offset) const
+{
+    if (offset < m_masterBufferOffset || offset - m_masterBufferOffset >= m_masterBuffer.size()) {
+        return std::string_view();
+    }
+    const auto index = static_cast<std::size_t>(offset - m_masterBufferOffset);
+    return std::string_view(m_masterBuffer.data() + index, m_masterBuffer.size() - index);
+}
+
+/*!
+ * \brief Returns whether the index (cue entries) is validated when rewriting the file.
+ *
+ * When the file is rewritten, all "Cluster"-elements and their children are walked through anyways to compute the
+ * shifted positions of the cue points. If enabled, the cue points which do not denote the offset of a "Cluster"-element
+ * or of one of its children are reported as warnings. So the index is validated without any additional seeks.
+ *
+ * This is disabled by default.
+ *
+ * \remarks Unlike validateIndex() only the positions denoted by the cue points are validated (and not the IDs of the
+ *          elements they point to). Nothing is validated when the file is not rewritten.
+ * \sa setStreamingIndexValidationEnabled()
+ */
+inline bool MatroskaContainer::isStreamingIndexValidationEnabled() const
+{
+    return m_streamingIndexValidation;
+}
+
+/*!
+ * \brief Sets whether the index (cue entries) is validated when rewriting the file.
+ * \sa isStreamingIndexValidationEnabled()
+ */
+inline void MatroskaContainer::setStreamingIndexValidationEnabled(bool enabled)
+{
+    m_streamingIndexValidation = enabled;
+}
+
+/*!
+ * \brief Returns whether a "Cues"-element (index) is generated for segments which have none when applying changes.
+ *
+ * The cue points are generated from the keyframes of the video tracks (or of all tracks if there are no video tracks).
+ * For each track only the first keyframe within a cluster is indexed. The "Cues"-element is placed according to
+ * MediaFileInfo::indexPosition().
+ *
+ * This is disabled by default.
+ *
+ * \remarks Since all blocks need to be visited, the file is always rewritten if a "Cues"-element is generated. No index
+ *          is generated when applying changes in-place is enforced.
+ * \sa setIndexGenerationEnabled()
+ */
+inline bool MatroskaContainer::isIndexGenerationEnabled() const
+{
+    return m_indexGeneration;
+}
+
+/*!
+ * \brief Sets whether a "Cues"-element (index) is generated for segments which have none when applying changes.
+ * \sa isIndexGenerationEnabled()
+ */
+inline void MatroskaContainer::setIndexGenerationEnabled(bool enabled)
+{
+    m_indexGeneration = enabled;
+}
+
+/*!
+ * \brief Returns whether files are "finalized" when applying changes.
+ *
+ * Recordings which were not finished properly (e.g. live recordings) commonly lack the "SeekHead"- and "Cues"-element and
+ * use unknown sizes for the "Segment"- and "Cluster"-elements. Hence the whole file needs to be scanned whenever it is
+ * parsed. When finalizing, the unknown sizes of "Cluster"-elements are replaced with the actual sizes and a "Cues"-element
+ * is generated for segments which have none. The "Segment"-element and the "SeekHead"-element are written anyways when
+ * applying changes.
+ *
+ * This is disabled by default.
+ *
+ * \remarks In contrast to setIndexGenerationEnabled() the file does not need to be rewritten for this: The blocks are only
+ *          read to collect the cue points and the "Cues"-element is written in the padding or after the last cluster.
+ *          Unknown sizes can only be replaced in-place if they are denoted using 8 bytes (0x01FFFFFFFFFFFFFF) which is
+ *          the case for e.g. files recorded by OBS; when rewriting the file all sizes are written anyways.
+ * \sa setFinalizingEnabled()
+ */
+inline bool MatroskaContainer::isFinalizingEnabled() const
+{
+    return m_finalizing;
+}
+
+/*!
+ * \brief Sets whether files are "finalized" when applying changes.
+ * \sa isFinalizingEnabled()
+ */
+inline void MatroskaContainer::setFinalizingEnabled(bool enabled)
+{
+    m_finalizing = enabled;
+}
+
+/*!
+ * \brief Returns whether space for referencing all top-level elements is reserved after the "SeekHead"-element when
+ *        applying changes.
+ *
+ * When a "Tags"- or "Attachments"-element is added to a file, the "SeekHead"-element needs to reference it and grows.
+ * This shifts all subsequent elements so the file needs to be rewritten unless there is enough padding, even if the new
+ * element itself is written after the last cluster. If enabled, the "SeekHead"-element is followed by a "Void"-element
+ * providing the space for the entries of all top-level element types which are not referenced yet (see
+ * MatroskaSeekInfo::reservedSize()). Subsequent edits then keep the offsets of all other elements and can be applied
+ * in-place, provided the reservation is still enabled.
+ *
+ * This is disabled by default.
+ *
+ * \remarks The reservation takes up to 150 bytes per segment. Without the reservation the "Void"-element is treated as
+ *          padding by subsequent edits.
+ * \sa setSeekHeadReservationEnabled()
+ */
+inline bool MatroskaContainer::isSeekHeadReservationEnabled() const
+{
+    return m_seekHeadReservation;
+}
+
+/*!
+ * \brief Sets whether space for referencing all top-level elements is reserved after the "SeekHead"-element when
+ *        applying changes.
+ * \sa isSeekHeadReservationEnabled()
+ */
+inline void MatroskaContainer::setSeekHeadReservationEnabled(bool enabled)
+{
+    m_seekHeadReservation = enabled;
+}
+
+/*!
+ * \brief Returns whether only the changed "Tag"-elements are written when applying changes in-place if possible.
+ *
+ * If enabled, the "Tag"-elements of the "Tags"-element are compared with the tags which would be written and only the
+ * tags which differ are overwritten at their offset. So changing a single field like the rating writes only the affected
+ * "Tag"-element. This requires the changed tags to fit into the space of the original element including "Void"-elements
+ * directly following it; the last tag might also use a "Void"-element directly following the "Tags"-element. The other
+ * top-level elements are not written again in this case so it is only done if MediaFileInfo::changes() contains
+ * nothing but MediaFileChanges::Tags. The "WritingApp"-element is not updated either.
+ *
+ * If not possible, changes are applied as usual. This is disabled by default.
+ *
+ * \remarks This is only possible for files with only one segment and only one "Tags"-element. It is not done when
+ *          generating an index or finalizing (see setIndexGenerationEnabled() and setFinalizingEnabled()).
+ * \sa setTagPatchingEnabled()
+ */
+inline bool MatroskaContainer::isTagPatchingEnabled() const
+{
+    return m_tagPatching;
+}
+
+/*!
+ * \brief Sets whether only the changed "Tag"-elements are written when applying changes in-place if possible.
+ * \sa isTagPatchingEnabled()
+ */
+inline void MatroskaContainer::setTagPatchingEnabled(bool enabled)
+{
+    m_tagPatching = enabled;
+}
+
 /*!
  * \brief Returns seek information read from "SeekHead"-elements when parsing segment info.
  */
@@ -110,20 +337,25 @@ inline const std::vector<std::unique_ptr<MatroskaSeekInfo>> &MatroskaContainer::
  *
  * The default value is 50 MiB.
  *
+ * \remarks This is the global default for MediaFileInfo::matroskaMaxFullParseSize() which is used when parsing
+ *          (and can be set for each file individually).
  * \sa setMaxFullParseSize()
  */
 inline std::uint64_t MatroskaContainer::maxFullParseSize()
 {
-    return m_maxFullParseSize;
+    return m_maxFullParseSize.load(std::memory_order_relaxed);
 }
 
 /*!
  * \brief Sets the maximal file size for a "full parse" in byte.
+ * \remarks This is a global setting. It is atomic so it might be changed while other threads are parsing. It only
+ *          affects MediaFileInfo objects constructed afterwards; use MediaFileInfo::setMatroskaMaxFullParseSize() to
+ *          change the value for a particular file.
  * \sa maxFullParseSize()
  */
 inline void MatroskaContainer::setMaxFullParseSize(std::uint64_t maxFullParseSize)
 {
-    m_maxFullParseSize = maxFullParseSize;
+    m_maxFullParseSize.store(maxFullParseSize, std::memory_order_relaxed);
 }
 
 /*!
@@ -2,6 +2,10 @@
 #include "./matroskacontainer.h"
 
 #include <c++utilities/conversion/binaryconversion.h>
+#include <c++utilities/conversion/stringbuilder.h>
+
+#include <algorithm>
+#include <sstream>
 
 using namespace std;
 using namespace CppUtilities;
@@ -29,6 +33,15 @@ namespace TagParser {
  * \brief The MatroskaCuePositionUpdater class helps to rewrite the "Cues"-element with shifted positions.
  *
  * This class is used when rewriting a Matroska file to save changed tag information.
+ *
+ * The offsets are stored in flat arrays which are sorted by their initial value once after parsing. So updateOffsets()
+ * and updateRelativeOffsets() (which are called for every cluster and every child of a cluster) only need a binary
+ * search to find the affected entries. Further arrays sorted by the element address are used to look up the offsets
+ * via their element when making the new "Cues"-element.
+ *
+ * If the original file has no "Cues"-element, this class can also be used to generate a new one. In this case cue points
+ * are added via addCuePoint() instead of calling parse(). The positions of the generated cue points are updated in the
+ * same way as the positions of parsed cue points.
  */
 
 /*!
@@ -40,11 +53,59 @@ std::uint64_t MatroskaCuePositionUpdater::totalSize() const
     if (m_cuesElement) {
         std::uint64_t size = m_sizes.at(m_cuesElement);
         return 4 + EbmlElement::calculateSizeDenotationLength(size) + size;
+    } else if (!m_generatedCuePoints.empty()) {
+        return 4 + EbmlElement::calculateSizeDenotationLength(m_generatedCuesSize) + m_generatedCuesSize;
     } else {
         return 0;
     }
 }
 
+/*!
+ * \brief Returns the data size of the "CueTrackPositions"-element for the specified generated \a cuePoint.
+ */
+std::uint64_t MatroskaCuePositionUpdater::generatedTrackPositionsSize(const GeneratedCuePoint &cuePoint)
+{
+    // "CueTrack"-, "CueClusterPosition"- and "CueRelativePosition"-element
+    return 2 + EbmlElement::calculateUIntegerLength(cuePoint.track) + 2 + EbmlElement::calculateUIntegerLength(cuePoint.clusterPosition.currentValue())
+        + 2 + EbmlElement::calculateUIntegerLength(cuePoint.relativePosition.currentValue());
+}
+
+/*!
+ * \brief Returns the data size of the "CuePoint"-element for the specified generated \a cuePoint.
+ */
+std::uint64_t MatroskaCuePositionUpdater::generatedCuePointDataSize(const GeneratedCuePoint &cuePoint)
+{
+    // "CueTime"- and "CueTrackPositions"-element
+    const auto trackPositionsSize = generatedTrackPositionsSize(cuePoint);
+    return 2 + EbmlElement::calculateUIntegerLength(cuePoint.time) + 1 + EbmlElement::calculateSizeDenotationLength(trackPositionsSize)
+        + trackPositionsSize;
+}
+
+/*!
+ * \brief Returns the total size of the "CuePoint"-element for the specified generated \a cuePoint.
+ */
+std::uint64_t MatroskaCuePositionUpdater::generatedCuePointSize(const GeneratedCuePoint &cuePoint)
+{
+    const auto cuePointSize = generatedCuePointDataSize(cuePoint);
+    return 1 + EbmlElement::calculateSizeDenotationLength(cuePointSize) + cuePointSize;
+}
+
+/*!
+ * \brief Adds a cue point for the block at \a relativePosition within the cluster at \a clusterPosition.
+ *
+ * The \a time is specified in the timestamp scale of the segment. The \a clusterPosition is relative to the data of the
+ * segment and the \a relativePosition relative to the data of the cluster (both within the original file). The positions
+ * are updated when calling updateOffsets() and updateRelativeOffsets() like the positions of parsed cue points.
+ *
+ * \remarks Must not be mixed with parse(). Cue points must be added ordered by their positions (which is the order they
+ *          are written in).
+ */
+void MatroskaCuePositionUpdater::addCuePoint(std::uint64_t time, std::uint64_t track, std::uint64_t clusterPosition, std::uint64_t relativePosition)
+{
+    m_generatedCuePoints.emplace_back(GeneratedCuePoint{ time, track, clusterPosition, relativePosition });
+    m_generatedCuesSize += generatedCuePointSize(m_generatedCuePoints.back());
+}
+
 /*!
  * \brief Parses the specified \a cuesElement.
  * \remarks Previous parsing results and updates will be cleared.
@@ -55,14 +116,25 @@ void MatroskaCuePositionUpdater::parse(EbmlElement *cuesElement, Diagnostics &di
     clear();
     std::uint64_t cuesElementSize = 0, cuePointElementSize, cueTrackPositionsElementSize, cueReferenceElementSize, pos, relPos, statePos;
     EbmlElement *cueRelativePositionElement, *cueClusterPositionElement;
+    auto &container = cuesElement->container();
+    std::uint64_t cuePointCount = 0;
     for (EbmlElement *cuePointElement = cuesElement->firstChild(); cuePointElement; cuePointElement = cuePointElement->nextSibling()) {
         // parse children of "Cues"-element which must be "CuePoint"-elements
         cuePointElement->parse(diag);
         switch (cuePointElement->id()) {
-        case EbmlIds::Void:
         case EbmlIds::Crc32:
+            // keep the "CRC-32"-element when making the "Cues"-element (only valid as first child)
+            if (cuePointElement == cuesElement->firstChild()) {
+                m_hasCrc32 = true;
+                cuesElementSize += EbmlElement::crc32ElementSize;
+            }
+            break;
+        case EbmlIds::Void:
             break;
         case MatroskaIds::CuePoint:
+            if (container.exceedsParseLimit(++cuePointCount, container.parseLimits().maxTableEntries, "number of cue points", diag, context)) {
+                throw InvalidDataException();
+            }
             cuePointElementSize = 0;
             for (EbmlElement *cuePointChild = cuePointElement->firstChild(); cuePointChild; cuePointChild = cuePointChild->nextSibling()) {
                 // parse children of "CuePoint"-element
@@ -95,12 +167,12 @@ void MatroskaCuePositionUpdater::parse(EbmlElement *cuesElement, Diagnostics &di
                         case MatroskaIds::CueClusterPosition:
                             pos = (cueClusterPositionElement = cueTrackPositionsChild)->readUInteger();
                             cueTrackPositionsElementSize += 2 + EbmlElement::calculateUIntegerLength(pos);
-                            m_offsets.emplace(cueTrackPositionsChild, pos);
+                            m_offsets.emplace_back(OffsetEntry<MatroskaOffsetStates>{ cueTrackPositionsChild, pos, false });
                             break;
                         case MatroskaIds::CueCodecState:
                             statePos = cueTrackPositionsChild->readUInteger();
                             cueTrackPositionsElementSize += 2 + EbmlElement::calculateUIntegerLength(statePos);
-                            m_offsets.emplace(cueTrackPositionsChild, statePos);
+                            m_offsets.emplace_back(OffsetEntry<MatroskaOffsetStates>{ cueTrackPositionsChild, statePos, false });
                             break;
                         case MatroskaIds::CueReference:
                             cueReferenceElementSize = 0;
@@ -121,7 +193,7 @@ void MatroskaCuePositionUpdater::parse(EbmlElement *cuesElement, Diagnostics &di
                                 case MatroskaIds::CueRefCodecState:
                                     statePos = cueReferenceChild->readUInteger();
                                     cueReferenceElementSize += 2 + EbmlElement::calculateUIntegerLength(statePos);
-                                    m_offsets.emplace(cueReferenceChild, statePos);
+                                    m_offsets.emplace_back(OffsetEntry<MatroskaOffsetStates>{ cueReferenceChild, statePos, false });
                                     break;
                                 default:
                                     diag.emplace_back(DiagLevel::Warning,
@@ -142,7 +214,8 @@ void MatroskaCuePositionUpdater::parse(EbmlElement *cuesElement, Diagnostics &di
                             DiagLevel::Critical, "\"CueTrackPositions\"-element does not contain mandatory \"CueClusterPosition\"-element.", context);
                     } else if (cueRelativePositionElement) {
                         cueTrackPositionsElementSize += 2 + EbmlElement::calculateUIntegerLength(relPos);
-                        m_relativeOffsets.emplace(piecewise_construct, forward_as_tuple(cueRelativePositionElement), forward_as_tuple(pos, relPos));
+                        m_relativeOffsets.emplace_back(
+                            OffsetEntry<MatroskaReferenceOffsetPair>{ cueRelativePositionElement, MatroskaReferenceOffsetPair(pos, relPos), false });
                     }
                     cuePointElementSize
                         += 1 + EbmlElement::calculateSizeDenotationLength(cueTrackPositionsElementSize) + cueTrackPositionsElementSize;
@@ -163,22 +236,89 @@ void MatroskaCuePositionUpdater::parse(EbmlElement *cuesElement, Diagnostics &di
         }
     }
     m_sizes.emplace(m_cuesElement = cuesElement, cuesElementSize);
+    sortOffsets();
+}
+
+/*!
+ * \brief Sorts the offsets parsed via parse() by their initial value and builds the element indices.
+ */
+void MatroskaCuePositionUpdater::sortOffsets()
+{
+    stable_sort(m_offsets.begin(), m_offsets.end(),
+        [](const auto &lhs, const auto &rhs) { return lhs.states.initialValue() < rhs.states.initialValue(); });
+    stable_sort(m_relativeOffsets.begin(), m_relativeOffsets.end(), [](const auto &lhs, const auto &rhs) {
+        return make_pair(lhs.states.referenceOffset(), lhs.states.initialValue()) < make_pair(rhs.states.referenceOffset(), rhs.states.initialValue());
+    });
+    const auto makeIndex = [](const auto &entries, ElementIndex &index) {
+        index.clear();
+        index.reserve(entries.size());
+        for (std::size_t i = 0, count = entries.size(); i != count; ++i) {
+            index.emplace_back(entries[i].element, i);
+        }
+        sort(index.begin(), index.end());
+    };
+    makeIndex(m_offsets, m_offsetIndex);
+    makeIndex(m_relativeOffsets, m_relativeOffsetIndex);
+}
+
+/*!
+ * \brief Returns the current value of the offset denoted by the specified \a element.
+ * \throws Throws std::out_of_range if \a element does not denote an offset.
+ */
+std::uint64_t MatroskaCuePositionUpdater::currentOffset(const EbmlElement *element) const
+{
+    const auto i = lower_bound(m_offsetIndex.cbegin(), m_offsetIndex.cend(), make_pair(element, std::size_t()));
+    if (i == m_offsetIndex.cend() || i->first != element) {
+        throw out_of_range("element does not denote an offset");
+    }
+    return m_offsets[i->second].states.currentValue();
+}
+
+/*!
+ * \brief Returns the current value of the relative offset denoted by the specified \a element.
+ * \throws Throws std::out_of_range if \a element does not denote a relative offset.
+ */
+std::uint64_t MatroskaCuePositionUpdater::currentRelativeOffset(const EbmlElement *element) const
+{
+    const auto i = lower_bound(m_relativeOffsetIndex.cbegin(), m_relativeOffsetIndex.cend(), make_pair(element, std::size_t()));
+    if (i == m_relativeOffsetIndex.cend() || i->first != element) {
+        throw out_of_range("element does not denote a relative offset");
+    }
+    return m_relativeOffsets[i->second].states.currentValue();
 }
 
 /*!
  * \brief Sets the offset of the entries with the specified \a originalOffset to \a newOffset.
  * \returns Returns whether the size of the "Cues"-element has been altered.
+ * \remarks The entries are considered resolved (see reportUnresolvedOffsets()).
  */
 bool MatroskaCuePositionUpdater::updateOffsets(std::uint64_t originalOffset, std::uint64_t newOffset)
 {
     bool updated = false;
-    for (auto &offset : m_offsets) {
-        if (offset.second.initialValue() == originalOffset && offset.second.currentValue() != newOffset) {
-            updated = updateSize(offset.first->parent(),
+    for (auto offset = lower_bound(m_offsets.begin(), m_offsets.end(), originalOffset,
+             [](const auto &entry, std::uint64_t value) { return entry.states.initialValue() < value; });
+         offset != m_offsets.end() && offset->states.initialValue() == originalOffset; ++offset) {
+        offset->resolved = true;
+        if (offset->states.currentValue() != newOffset) {
+            updated = updateSize(offset->element->parent(),
                           static_cast<int>(EbmlElement::calculateUIntegerLength(newOffset))
-                              - static_cast<int>(EbmlElement::calculateUIntegerLength(offset.second.currentValue())))
+                              - static_cast<int>(EbmlElement::calculateUIntegerLength(offset->states.currentValue())))
                 || updated;
-            offset.second.update(newOffset);
+            offset->states.update(newOffset);
+        }
+    }
+    for (auto cuePoint = lower_bound(m_generatedCuePoints.begin(), m_generatedCuePoints.end(), originalOffset,
+             [](const auto &entry, std::uint64_t value) { return entry.clusterPosition.initialValue() < value; });
+         cuePoint != m_generatedCuePoints.end() && cuePoint->clusterPosition.initialValue() == originalOffset; ++cuePoint) {
+        if (cuePoint->clusterPosition.currentValue() == newOffset) {
+            continue;
+        }
+        const auto previousSize = generatedCuePointSize(*cuePoint);
+        cuePoint->clusterPosition.update(newOffset);
+        const auto newSize = generatedCuePointSize(*cuePoint);
+        if (newSize != previousSize) {
+            m_generatedCuesSize = m_generatedCuesSize + newSize - previousSize;
+            updated = true;
         }
     }
     return updated;
@@ -187,19 +327,41 @@ bool MatroskaCuePositionUpdater::updateOffsets(std::uint64_t originalOffset, std
 /*!
  * \brief Sets the relative offset of the entries with the specified \a originalRelativeOffset and the specified \a referenceOffset to \a newRelativeOffset.
  * \returns Returns whether the size of the "Cues"-element has been altered.
+ * \remarks The entries are considered resolved (see reportUnresolvedOffsets()).
  */
 bool MatroskaCuePositionUpdater::updateRelativeOffsets(
     std::uint64_t referenceOffset, std::uint64_t originalRelativeOffset, std::uint64_t newRelativeOffset)
 {
     bool updated = false;
-    for (auto &offset : m_relativeOffsets) {
-        if (offset.second.referenceOffset() == referenceOffset && offset.second.initialValue() == originalRelativeOffset
-            && offset.second.currentValue() != newRelativeOffset) {
-            updated = updateSize(offset.first->parent(),
+    const auto key = make_pair(referenceOffset, originalRelativeOffset);
+    for (auto offset = lower_bound(m_relativeOffsets.begin(), m_relativeOffsets.end(), key,
+             [](const auto &entry, const auto &value) { return make_pair(entry.states.referenceOffset(), entry.states.initialValue()) < value; });
+         offset != m_relativeOffsets.end() && make_pair(offset->states.referenceOffset(), offset->states.initialValue()) == key; ++offset) {
+        offset->resolved = true;
+        if (offset->states.currentValue() != newRelativeOffset) {
+            updated = updateSize(offset->element->parent(),
                           static_cast<int>(EbmlElement::calculateUIntegerLength(newRelativeOffset))
-                              - static_cast<int>(EbmlElement::calculateUIntegerLength(offset.second.currentValue())))
+                              - static_cast<int>(EbmlElement::calculateUIntegerLength(offset->states.currentValue())))
                 || updated;
-            offset.second.update(newRelativeOffset);
+            offset->states.update(newRelativeOffset);
+        }
+    }
+    for (auto cuePoint = lower_bound(m_generatedCuePoints.begin(), m_generatedCuePoints.end(), key,
+             [](const auto &entry, const auto &value) {
+                 return make_pair(entry.clusterPosition.initialValue(), entry.relativePosition.initialValue()) < value;
+             });
+         cuePoint != m_generatedCuePoints.end()
+         && make_pair(cuePoint->clusterPosition.initialValue(), cuePoint->relativePosition.initialValue()) == key;
+         ++cuePoint) {
+        if (cuePoint->relativePosition.currentValue() == newRelativeOffset) {
+            continue;
+        }
+        const auto previousSize = generatedCuePointSize(*cuePoint);
+        cuePoint->relativePosition.update(newRelativeOffset);
+        const auto newSize = generatedCuePointSize(*cuePoint);
+        if (newSize != previousSize) {
+            m_generatedCuesSize = m_generatedCuesSize + newSize - previousSize;
+            updated = true;
         }
     }
     return updated;
@@ -239,11 +401,80 @@ bool MatroskaCuePositionUpdater::updateSize(EbmlElement *element, int shift)
 }
 
 /*!
- * \brief Writes the previously parsed "Cues"-element with updates positions to the specified \a stream.
+ * \brief Adds a warning to \a diag for each cluster position and relative position which has not been resolved yet.
+ *
+ * When rewriting a file, updateOffsets() is called for each "Cluster"-element and updateRelativeOffsets() for each child of
+ * a "Cluster"-element. Positions which have not been passed to these functions don't point to such an element and are
+ * therefore invalid. This allows validating the index while pretending writing the clusters (without further seeking).
+ *
+ * \remarks Positions denoted by "CueCodecState"- and "CueRefCodecState"-elements are not taken into account.
+ */
+void MatroskaCuePositionUpdater::reportUnresolvedOffsets(Diagnostics &diag) const
+{
+    static const string context("validating \"Cues\"-element");
+    for (const auto &offset : m_offsets) {
+        switch (offset.element->id()) {
+        case MatroskaIds::CueClusterPosition:
+        case MatroskaIds::CueRefCluster:
+            if (!offset.resolved) {
+                diag.emplace_back(DiagLevel::Warning,
+                    argsToString("\"", offset.element->idToString(), "\"-element at ", offset.element->startOffset(), " points to ",
+                        offset.states.initialValue(), " which is not the offset of a \"Cluster\"-element. It will be kept as-is."),
+                    context);
+            }
+            break;
+        default:;
+        }
+    }
+    for (const auto &offset : m_relativeOffsets) {
+        if (!offset.resolved) {
+            diag.emplace_back(DiagLevel::Warning,
+                argsToString("\"CueRelativePosition\"-element at ", offset.element->startOffset(), " points to ", offset.states.initialValue(),
+                    " which is not the offset of a child of the \"Cluster\"-element at ", offset.states.referenceOffset(), ". It will be kept as-is."),
+                context);
+        }
+    }
+}
+
+/*!
+ * \brief Writes a "Cues"-element containing the cue points added via addCuePoint().
+ */
+void MatroskaCuePositionUpdater::makeGenerated(ostream &stream)
+{
+    char buff[8];
+    std::uint8_t len;
+    BE::getBytes(static_cast<std::uint32_t>(MatroskaIds::Cues), buff);
+    stream.write(buff, 4);
+    len = EbmlElement::makeSizeDenotation(m_generatedCuesSize, buff);
+    stream.write(buff, len);
+    for (const auto &cuePoint : m_generatedCuePoints) {
+        // write "CuePoint"-element
+        stream.put(static_cast<char>(MatroskaIds::CuePoint));
+        len = EbmlElement::makeSizeDenotation(generatedCuePointDataSize(cuePoint), buff);
+        stream.write(buff, len);
+        EbmlElement::makeSimpleElement(stream, MatroskaIds::CueTime, cuePoint.time);
+        // write "CueTrackPositions"-element
+        stream.put(static_cast<char>(MatroskaIds::CueTrackPositions));
+        len = EbmlElement::makeSizeDenotation(generatedTrackPositionsSize(cuePoint), buff);
+        stream.write(buff, len);
+        EbmlElement::makeSimpleElement(stream, MatroskaIds::CueTrack, cuePoint.track);
+        EbmlElement::makeSimpleElement(stream, MatroskaIds::CueClusterPosition, cuePoint.clusterPosition.currentValue());
+        EbmlElement::makeSimpleElement(stream, MatroskaIds::CueRelativePosition, cuePoint.relativePosition.currentValue());
+    }
+}
+
+/*!
+ * \brief Writes the previously parsed "Cues"-element with updates positions to the specified \a outputStream.
+ * \remarks If the parsed "Cues"-element has a "CRC-32"-element, the element is made in memory to compute the checksum
+ *          before writing it.
  */
-void MatroskaCuePositionUpdater::make(ostream &stream, Diagnostics &diag)
+void MatroskaCuePositionUpdater::make(ostream &outputStream, Diagnostics &diag)
 {
     static const string context("making \"Cues\"-element");
+    if (!m_cuesElement && !m_generatedCuePoints.empty()) {
+        makeGenerated(outputStream);
+        return;
+    }
     if (!m_cuesElement) {
         diag.emplace_back(DiagLevel::Warning, "No cues written; the cues of the source file could not be parsed correctly.", context);
         return;
@@ -251,12 +482,21 @@ void MatroskaCuePositionUpdater::make(ostream &stream, Diagnostics &diag)
     // temporary variables
     char buff[8];
     std::uint8_t len;
+    std::size_t crc32ElementOffset = 0;
+    ostringstream buffer(ios_base::out | ios_base::binary);
+    ostream &stream = m_hasCrc32 ? static_cast<ostream &>(buffer) : outputStream;
     // write "Cues"-element
     try {
         BE::getBytes(static_cast<std::uint32_t>(MatroskaIds::Cues), buff);
         stream.write(buff, 4);
         len = EbmlElement::makeSizeDenotation(m_sizes[m_cuesElement], buff);
         stream.write(buff, len);
+        // write "CRC-32"-element (the checksum is computed after making the whole element)
+        if (m_hasCrc32) {
+            crc32ElementOffset = 4u + len;
+            EbmlElement::makeCrc32Element(buff, 0);
+            stream.write(buff, EbmlElement::crc32ElementSize);
+        }
         // loop through original elements and write (a updated version) of them
         for (EbmlElement *cuePointElement = m_cuesElement->firstChild(); cuePointElement; cuePointElement = cuePointElement->nextSibling()) {
             cuePointElement->parse(diag);
@@ -301,7 +541,7 @@ void MatroskaCuePositionUpdater::make(ostream &stream, Diagnostics &diag)
                             case MatroskaIds::CueRelativePosition:
                                 try {
                                     EbmlElement::makeSimpleElement(
-                                        stream, cueTrackPositionsChild->id(), m_relativeOffsets.at(cueTrackPositionsChild).currentValue());
+                                        stream, cueTrackPositionsChild->id(), currentRelativeOffset(cueTrackPositionsChild));
                                 } catch (const out_of_range &) {
                                     // we were not able parse the relative offset because the absolute offset is missing
                                     // continue anyways
@@ -311,7 +551,7 @@ void MatroskaCuePositionUpdater::make(ostream &stream, Diagnostics &diag)
                             case MatroskaIds::CueCodecState:
                                 // write "CueClusterPosition"/"CueCodecState"-element
                                 EbmlElement::makeSimpleElement(
-                                    stream, cueTrackPositionsChild->id(), m_offsets.at(cueTrackPositionsChild).currentValue());
+                                    stream, cueTrackPositionsChild->id(), currentOffset(cueTrackPositionsChild));
                                 break;
                             case MatroskaIds::CueReference:
                                 // write "CueReference"-element
@@ -336,7 +576,7 @@ void MatroskaCuePositionUpdater::make(ostream &stream, Diagnostics &diag)
                                     case MatroskaIds::CueRefCodecState:
                                         // write "CueRefCluster"/"CueRefCodecState"-element
                                         EbmlElement::makeSimpleElement(
-                                            stream, cueReferenceChild->id(), m_offsets.at(cueReferenceChild).currentValue());
+                                            stream, cueReferenceChild->id(), currentOffset(cueReferenceChild));
                                         break;
                                     default:
                                         diag.emplace_back(DiagLevel::Warning,
@@ -370,6 +610,13 @@ void MatroskaCuePositionUpdater::make(ostream &stream, Diagnostics &diag)
             DiagLevel::Critical, "Unable to write the file index because the index of the original file could not be parsed correctly.", context);
         throw InvalidDataException();
     }
+    if (m_hasCrc32) {
+        auto data = buffer.str();
+        const auto dataOffset = crc32ElementOffset + EbmlElement::crc32ElementSize;
+        EbmlElement::makeCrc32Element(
+            data.data() + crc32ElementOffset, EbmlElement::updateCrc32(0, data.data() + dataOffset, data.size() - dataOffset));
+        outputStream.write(data.data(), static_cast<streamsize>(data.size()));
+    }
 }
 
 } // namespace TagParser
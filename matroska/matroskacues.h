@@ -5,6 +5,8 @@
 
 #include <ostream>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace TagParser {
 
@@ -66,21 +68,54 @@ public:
     MatroskaCuePositionUpdater();
 
     EbmlElement *cuesElement() const;
+    bool hasCues() const;
     std::uint64_t totalSize() const;
 
     void parse(EbmlElement *cuesElement, Diagnostics &diag);
+    void addCuePoint(std::uint64_t time, std::uint64_t track, std::uint64_t clusterPosition, std::uint64_t relativePosition);
+    std::size_t generatedCuePointCount() const;
     bool updateOffsets(std::uint64_t originalOffset, std::uint64_t newOffset);
     bool updateRelativeOffsets(std::uint64_t referenceOffset, std::uint64_t originalRelativeOffset, std::uint64_t newRelativeOffset);
     void make(std::ostream &stream, Diagnostics &diag);
+    void reportUnresolvedOffsets(Diagnostics &diag) const;
     void clear();
 
 private:
+    /// \brief The GeneratedCuePoint struct holds a cue point added via addCuePoint().
+    struct GeneratedCuePoint {
+        std::uint64_t time;
+        std::uint64_t track;
+        MatroskaOffsetStates clusterPosition;
+        MatroskaOffsetStates relativePosition;
+    };
+
+    /// \brief The OffsetEntry struct holds an offset denoted by a child of the parsed "Cues"-element.
+    template <typename StatesType> struct OffsetEntry {
+        EbmlElement *element;
+        StatesType states;
+        bool resolved;
+    };
+    /// \brief The ElementIndex type maps elements to the index of their OffsetEntry (sorted by the element address).
+    using ElementIndex = std::vector<std::pair<const EbmlElement *, std::size_t>>;
+
+    void sortOffsets();
+    std::uint64_t currentOffset(const EbmlElement *element) const;
+    std::uint64_t currentRelativeOffset(const EbmlElement *element) const;
     bool updateSize(EbmlElement *element, int shift);
+    static std::uint64_t generatedTrackPositionsSize(const GeneratedCuePoint &cuePoint);
+    static std::uint64_t generatedCuePointDataSize(const GeneratedCuePoint &cuePoint);
+    static std::uint64_t generatedCuePointSize(const GeneratedCuePoint &cuePoint);
+    void makeGenerated(std::ostream &stream);
 
     EbmlElement *m_cuesElement;
-    std::unordered_map<EbmlElement *, MatroskaOffsetStates> m_offsets;
-    std::unordered_map<EbmlElement *, MatroskaReferenceOffsetPair> m_relativeOffsets;
+    std::vector<OffsetEntry<MatroskaOffsetStates>> m_offsets;
+    std::vector<OffsetEntry<MatroskaReferenceOffsetPair>> m_relativeOffsets;
+    ElementIndex m_offsetIndex;
+    ElementIndex m_relativeOffsetIndex;
     std::unordered_map<EbmlElement *, std::uint64_t> m_sizes;
+    std::vector<GeneratedCuePoint> m_generatedCuePoints;
+    std::uint64_t m_generatedCuesSize;
+    bool m_hasCrc32;
 };
 
 /*!
@@ -90,6 +125,8 @@ private:
  */
 inline MatroskaCuePositionUpdater::MatroskaCuePositionUpdater()
     : m_cuesElement(nullptr)
+    , m_generatedCuesSize(0)
+    , m_hasCrc32(false)
 {
 }
 
@@ -103,6 +140,24 @@ inline EbmlElement *MatroskaCuePositionUpdater::cuesElement() const
     return m_cuesElement;
 }
 
+/*!
+ * \brief Returns whether a "Cues"-element will be written when calling the make() method.
+ *
+ * This is the case if a "Cues"-element has been parsed or cue points have been added via addCuePoint().
+ */
+inline bool MatroskaCuePositionUpdater::hasCues() const
+{
+    return m_cuesElement || !m_generatedCuePoints.empty();
+}
+
+/*!
+ * \brief Returns the number of cue points added via addCuePoint().
+ */
+inline std::size_t MatroskaCuePositionUpdater::generatedCuePointCount() const
+{
+    return m_generatedCuePoints.size();
+}
+
 /*!
  * \brief Resets the object to its initial state. Parsing results and updates are cleared.
  */
@@ -110,7 +165,13 @@ inline void MatroskaCuePositionUpdater::clear()
 {
     m_cuesElement = nullptr;
     m_offsets.clear();
+    m_relativeOffsets.clear();
+    m_offsetIndex.clear();
+    m_relativeOffsetIndex.clear();
     m_sizes.clear();
+    m_generatedCuePoints.clear();
+    m_generatedCuesSize = 0;
+    m_hasCrc32 = false;
 }
 
 } // namespace TagParser
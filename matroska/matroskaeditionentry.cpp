@@ -1,5 +1,6 @@
 #include "./matroskaeditionentry.h"
 #include "./ebmlelement.h"
+#include "./matroskacontainer.h"
 #include "./matroskaid.h"
 
 #include "../diagnostics.h"
@@ -63,30 +64,43 @@ void MatroskaEditionEntry::parse(Diagnostics &diag)
     EbmlElement *entryChild = m_editionEntryElement->firstChild();
     while (entryChild) {
         entryChild->parse(diag);
-        switch (entryChild->id()) {
-        case MatroskaIds::EditionUID:
-            m_id = entryChild->readUInteger();
-            break;
-        case MatroskaIds::EditionFlagHidden:
-            m_hidden = entryChild->readUInteger() == 1;
-            break;
-        case MatroskaIds::EditionFlagDefault:
-            m_default = entryChild->readUInteger() == 1;
-            break;
-        case MatroskaIds::EditionFlagOrdered:
-            m_ordered = entryChild->readUInteger() == 1;
-            break;
-        case MatroskaIds::ChapterAtom:
+        if (parseChild(*entryChild, diag)) {
             m_chapters.emplace_back(make_unique<MatroskaChapter>(entryChild));
-            break;
-        default:
-            diag.emplace_back(DiagLevel::Warning,
-                "\"EditionEntry\"-element contains unknown child element \"" % entryChild->idToString() + "\" which will be ingored.", context);
         }
         entryChild = entryChild->nextSibling();
     }
 }
 
+/*!
+ * \brief Reads the property denoted by the specified (already parsed) \a entryChild.
+ * \returns Returns whether \a entryChild is a "ChapterAtom"-element (which is not handled by this method).
+ * \remarks This private method is used by parse() and MatroskaChapterCursor.
+ */
+bool MatroskaEditionEntry::parseChild(EbmlElement &entryChild, Diagnostics &diag)
+{
+    static const string context("parsing \"EditionEntry\"-element");
+    switch (entryChild.id()) {
+    case MatroskaIds::EditionUID:
+        m_id = entryChild.readUInteger();
+        break;
+    case MatroskaIds::EditionFlagHidden:
+        m_hidden = entryChild.readUInteger() == 1;
+        break;
+    case MatroskaIds::EditionFlagDefault:
+        m_default = entryChild.readUInteger() == 1;
+        break;
+    case MatroskaIds::EditionFlagOrdered:
+        m_ordered = entryChild.readUInteger() == 1;
+        break;
+    case MatroskaIds::ChapterAtom:
+        return true;
+    default:
+        diag.emplace_back(DiagLevel::Warning,
+            "\"EditionEntry\"-element contains unknown child element \"" % entryChild.idToString() + "\" which will be ingored.", context);
+    }
+    return false;
+}
+
 /*!
  * \brief Parses the "EditionEntry"-element specified when constructing the object.
  * \remarks
@@ -8,6 +8,8 @@ namespace TagParser {
 class EbmlElement;
 
 class TAG_PARSER_EXPORT MatroskaEditionEntry {
+    friend class MatroskaChapterCursor;
+
 public:
     MatroskaEditionEntry(EbmlElement *editionEntryElement);
     ~MatroskaEditionEntry();
@@ -25,6 +27,8 @@ public:
     void clear();
 
 private:
+    bool parseChild(EbmlElement &entryChild, Diagnostics &diag);
+
     EbmlElement *m_editionEntryElement;
     std::uint64_t m_id;
     bool m_hidden;
@@ -1,4 +1,5 @@
 #include "./matroskaseekinfo.h"
+#include "./matroskacontainer.h"
 #include "./matroskaid.h"
 
 #include "../diagnostics.h"
@@ -7,6 +8,7 @@
 #include <c++utilities/conversion/binaryconversion.h>
 #include <c++utilities/conversion/stringbuilder.h>
 
+#include <algorithm>
 #include <string>
 
 using namespace std;
@@ -126,6 +128,9 @@ void MatroskaSeekInfo::parse(EbmlElement *seekHeadElement, Diagnostics &diag, si
 
             break;
         case EbmlIds::Crc32:
+            // keep the "CRC-32"-element of the first "SeekHead"-element when making a new one
+            m_hasCrc32 = m_hasCrc32 || (m_seekHeadElements.size() == 1 && seekElement == seekHeadElement->firstChild());
+            break;
         case EbmlIds::Void:
             break;
         default:
@@ -143,12 +148,13 @@ void MatroskaSeekInfo::parse(EbmlElement *seekHeadElement, Diagnostics &diag, si
  * \param stream Specifies the stream to write the "SeekHead" element to.
  * \throws Throws ios_base::failure when an IO error occurs.
  * \throws Throws Failure or a derived exception when a making error occurs.
+ * \remarks The element is made in memory and written at once; it starts with a "CRC-32"-element if hasCrc32() returns true.
  */
 void MatroskaSeekInfo::make(ostream &stream, Diagnostics &diag)
 {
     CPP_UTILITIES_UNUSED(diag)
 
-    std::uint64_t totalSize = 0;
+    std::uint64_t totalSize = m_hasCrc32 ? EbmlElement::crc32ElementSize : 0;
     char buff0[8];
     char buff1[8];
     char buff2[2];
@@ -158,31 +164,44 @@ void MatroskaSeekInfo::make(ostream &stream, Diagnostics &diag)
         // "Seek" element + "SeekID" element + "SeekPosition" element
         totalSize += 2 + 1 + (2 + 1 + EbmlElement::calculateIdLength(get<0>(info))) + (2 + 1 + EbmlElement::calculateUIntegerLength(get<1>(info)));
     }
-    // write ID and size
+    auto buffer = string();
+    buffer.reserve(static_cast<std::size_t>(4 + EbmlElement::calculateSizeDenotationLength(totalSize) + totalSize));
+    // make ID and size
     BE::getBytes(static_cast<std::uint32_t>(MatroskaIds::SeekHead), buff0);
-    stream.write(buff0, 4);
+    buffer.append(buff0, 4);
     sizeLength0 = EbmlElement::makeSizeDenotation(totalSize, buff0);
-    stream.write(buff0, sizeLength0);
-    // write entries
+    buffer.append(buff0, sizeLength0);
+    // reserve space for the "CRC-32"-element (the checksum is computed after making the entries)
+    const auto crc32ElementOffset = buffer.size();
+    if (m_hasCrc32) {
+        buffer.append(EbmlElement::crc32ElementSize, '\0');
+    }
+    // make entries
     for (const auto &info : m_info) {
         // make values
         sizeLength0 = EbmlElement::makeId(get<0>(info), buff0);
         sizeLength1 = EbmlElement::makeUInteger(get<1>(info), buff1);
         // "Seek" header
         BE::getBytes(static_cast<std::uint16_t>(MatroskaIds::Seek), buff2);
-        stream.write(buff2, 2);
-        stream.put(static_cast<char>(0x80 | (2 + 1 + sizeLength0 + 2 + 1 + sizeLength1)));
+        buffer.append(buff2, 2);
+        buffer.push_back(static_cast<char>(0x80 | (2 + 1 + sizeLength0 + 2 + 1 + sizeLength1)));
         // "SeekID" element
         BE::getBytes(static_cast<std::uint16_t>(MatroskaIds::SeekID), buff2);
-        stream.write(buff2, 2);
-        stream.put(static_cast<char>(0x80 | sizeLength0));
-        stream.write(buff0, sizeLength0);
+        buffer.append(buff2, 2);
+        buffer.push_back(static_cast<char>(0x80 | sizeLength0));
+        buffer.append(buff0, sizeLength0);
         // "SeekPosition" element
         BE::getBytes(static_cast<std::uint16_t>(MatroskaIds::SeekPosition), buff2);
-        stream.write(buff2, 2);
-        stream.put(static_cast<char>(0x80 | sizeLength1));
-        stream.write(buff1, sizeLength1);
+        buffer.append(buff2, 2);
+        buffer.push_back(static_cast<char>(0x80 | sizeLength1));
+        buffer.append(buff1, sizeLength1);
+    }
+    if (m_hasCrc32) {
+        const auto dataOffset = crc32ElementOffset + EbmlElement::crc32ElementSize;
+        EbmlElement::makeCrc32Element(
+            buffer.data() + crc32ElementOffset, EbmlElement::updateCrc32(0, buffer.data() + dataOffset, buffer.size() - dataOffset));
     }
+    stream.write(buffer.data(), static_cast<streamsize>(buffer.size()));
 }
 
 /*!
@@ -191,7 +210,7 @@ void MatroskaSeekInfo::make(ostream &stream, Diagnostics &diag)
  */
 std::uint64_t MatroskaSeekInfo::minSize() const
 {
-    std::uint64_t maxTotalSize = m_info.size() * (2 + 1 + 2 + 1 + 1 + 2 + 1 + 1);
+    std::uint64_t maxTotalSize = m_info.size() * (2 + 1 + 2 + 1 + 1 + 2 + 1 + 1) + (m_hasCrc32 ? EbmlElement::crc32ElementSize : 0);
     return 4 + EbmlElement::calculateSizeDenotationLength(maxTotalSize) + maxTotalSize;
 }
 
@@ -201,7 +220,7 @@ std::uint64_t MatroskaSeekInfo::minSize() const
  */
 std::uint64_t MatroskaSeekInfo::maxSize() const
 {
-    std::uint64_t maxTotalSize = m_info.size() * (2 + 1 + 2 + 1 + 4 + 2 + 1 + 8);
+    std::uint64_t maxTotalSize = m_info.size() * (2 + 1 + 2 + 1 + 4 + 2 + 1 + 8) + (m_hasCrc32 ? EbmlElement::crc32ElementSize : 0);
     return 4 + EbmlElement::calculateSizeDenotationLength(maxTotalSize) + maxTotalSize;
 }
 
@@ -211,7 +230,7 @@ std::uint64_t MatroskaSeekInfo::maxSize() const
  */
 std::uint64_t MatroskaSeekInfo::actualSize() const
 {
-    std::uint64_t totalSize = 0;
+    std::uint64_t totalSize = m_hasCrc32 ? EbmlElement::crc32ElementSize : 0;
     for (const auto &info : m_info) {
         // "Seek" element + "SeekID" element + "SeekPosition" element
         totalSize += 2 + 1 + (2 + 1 + EbmlElement::calculateIdLength(get<0>(info))) + (2 + 1 + EbmlElement::calculateUIntegerLength(get<1>(info)));
@@ -219,6 +238,54 @@ std::uint64_t MatroskaSeekInfo::actualSize() const
     return totalSize += 4 + EbmlElement::calculateSizeDenotationLength(totalSize);
 }
 
+/*!
+ * \brief Returns the number of bytes occupied by the "SeekHead"-element and the "Void"-element written by makeReserve().
+ *
+ * The reservation covers an entry of maximal size for each present entry and for each top-level element type which is
+ * not referenced yet ("SegmentInfo", "Tracks", "Chapters", "Tags", "Attachments", "Cues" and "Cluster") plus a
+ * "Void"-element of at least 2 bytes. So pushing the first offset of such an element type does not alter the
+ * reservation and the elements following it keep their offsets.
+ * \remarks The returned value gets invalidated when the object is mutated.
+ */
+std::uint64_t MatroskaSeekInfo::reservedSize() const
+{
+    static constexpr EbmlElement::IdentifierType reservedIds[] = { MatroskaIds::SegmentInfo, MatroskaIds::Tracks, MatroskaIds::Chapters,
+        MatroskaIds::Tags, MatroskaIds::Attachments, MatroskaIds::Cues, MatroskaIds::Cluster };
+    auto entryCount = static_cast<std::uint64_t>(m_info.size());
+    for (const auto id : reservedIds) {
+        if (find_if(m_info.cbegin(), m_info.cend(), [id](const auto &info) { return get<0>(info) == id; }) == m_info.cend()) {
+            ++entryCount;
+        }
+    }
+    std::uint64_t maxTotalSize = entryCount * (2 + 1 + 2 + 1 + 4 + 2 + 1 + 8) + (m_hasCrc32 ? EbmlElement::crc32ElementSize : 0);
+    return 4 + EbmlElement::calculateSizeDenotationLength(maxTotalSize) + maxTotalSize + 2;
+}
+
+/*!
+ * \brief Writes a "Void"-element filling the space between actualSize() and reservedSize() to the specified \a stream.
+ * \throws Throws ios_base::failure when an IO error occurs.
+ * \remarks This is supposed to be called right after make().
+ */
+void MatroskaSeekInfo::makeReserve(std::ostream &stream) const
+{
+    const auto reserve = reservedSize() - actualSize();
+    char buff[9];
+    std::uint64_t voidLength;
+    std::uint8_t sizeLength;
+    buff[0] = static_cast<char>(EbmlIds::Void);
+    if (reserve < 64) {
+        sizeLength = 1;
+        buff[1] = static_cast<char>((voidLength = reserve - 2) | 0x80);
+    } else {
+        sizeLength = 8;
+        BE::getBytes(static_cast<std::uint64_t>((voidLength = reserve - 9) | 0x100000000000000), buff + 1);
+    }
+    stream.write(buff, 1 + sizeLength);
+    for (; voidLength; --voidLength) {
+        stream.put(0);
+    }
+}
+
 /*!
  * \brief Pushes the specified \a offset of an element with the specified \a id to the info.
  *
@@ -252,6 +319,7 @@ void MatroskaSeekInfo::clear()
     m_seekHeadElements.clear();
     m_additionalSeekHeadElements.clear();
     m_info.clear();
+    m_hasCrc32 = false;
 }
 
 } // namespace TagParser
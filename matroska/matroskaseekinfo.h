@@ -20,19 +20,25 @@ public:
     std::uint64_t minSize() const;
     std::uint64_t maxSize() const;
     std::uint64_t actualSize() const;
+    std::uint64_t reservedSize() const;
+    void makeReserve(std::ostream &stream) const;
     bool push(unsigned int index, EbmlElement::IdentifierType id, std::uint64_t offset);
+    bool hasCrc32() const;
+    void setHasCrc32(bool hasCrc32);
     void clear();
 
 private:
     std::vector<EbmlElement *> m_seekHeadElements;
     std::vector<std::unique_ptr<EbmlElement>> m_additionalSeekHeadElements;
     std::vector<std::pair<EbmlElement::IdentifierType, std::uint64_t>> m_info;
+    bool m_hasCrc32;
 };
 
 /*!
  * \brief Constructs a new MatroskaSeekInfo.
  */
 inline MatroskaSeekInfo::MatroskaSeekInfo()
+    : m_hasCrc32(false)
 {
 }
 
@@ -64,6 +70,24 @@ inline std::vector<std::pair<EbmlElement::IdentifierType, std::uint64_t>> &Matro
     return m_info;
 }
 
+/*!
+ * \brief Returns whether a "CRC-32"-element is made as first child of the "SeekHead"-element.
+ * \remarks This is the case if parse() encountered a "CRC-32"-element in the first "SeekHead"-element or
+ *          if enabled via setHasCrc32().
+ */
+inline bool MatroskaSeekInfo::hasCrc32() const
+{
+    return m_hasCrc32;
+}
+
+/*!
+ * \brief Sets whether a "CRC-32"-element is made as first child of the "SeekHead"-element.
+ */
+inline void MatroskaSeekInfo::setHasCrc32(bool hasCrc32)
+{
+    m_hasCrc32 = hasCrc32;
+}
+
 } // namespace TagParser
 
 #endif // TAG_PARSER_MATROSKASEEKINFO_H
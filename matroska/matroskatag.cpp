@@ -1,17 +1,53 @@
 #include "./matroskatag.h"
 #include "./ebmlelement.h"
+#include "./matroskacontainer.h"
 
 #include "../diagnostics.h"
+#include "../perfecthashmap.h"
+#include "../tagfieldfilter.h"
 
 #include <initializer_list>
-#include <map>
+#include <memory>
 #include <stdexcept>
+#include <string_view>
+#include <utility>
 
 using namespace std;
 using namespace CppUtilities;
 
 namespace TagParser {
 
+namespace {
+
+/// \brief The field IDs ("TagName"-elements) and the known fields they are mapped to.
+constexpr std::pair<std::string_view, KnownField> fieldIdsAndKnownFields[] = {
+    { MatroskaTagIds::artist(), KnownField::Artist },
+    { MatroskaTagIds::album(), KnownField::Album },
+    { MatroskaTagIds::comment(), KnownField::Comment },
+    { MatroskaTagIds::dateRecorded(), KnownField::RecordDate },
+    { MatroskaTagIds::dateRelease(), KnownField::ReleaseDate },
+    { MatroskaTagIds::title(), KnownField::Title },
+    { MatroskaTagIds::partNumber(), KnownField::PartNumber },
+    { MatroskaTagIds::totalParts(), KnownField::TotalParts },
+    { MatroskaTagIds::encoder(), KnownField::Encoder },
+    { MatroskaTagIds::encoderSettings(), KnownField::EncoderSettings },
+    { MatroskaTagIds::bpm(), KnownField::Bpm },
+    { MatroskaTagIds::bps(), KnownField::Bps },
+    { MatroskaTagIds::rating(), KnownField::Rating },
+    { MatroskaTagIds::description(), KnownField::Description },
+    { MatroskaTagIds::lyrics(), KnownField::Lyrics },
+    { MatroskaTagIds::label(), KnownField::RecordLabel },
+    { MatroskaTagIds::actor(), KnownField::Performers },
+    { MatroskaTagIds::lyricist(), KnownField::Lyricist },
+    { MatroskaTagIds::composer(), KnownField::Composer },
+    { MatroskaTagIds::duration(), KnownField::Length },
+    { MatroskaTagIds::language(), KnownField::Language },
+};
+constexpr auto knownFieldsByFieldId = makePerfectHashMap(fieldIdsAndKnownFields, KnownField::Invalid);
+static_assert(knownFieldsByFieldId.isPerfect(), "field IDs must be unique");
+
+} // namespace
+
 /*!
  * \class TagParser::MatroskaTag
  * \brief Implementation of TagParser::Tag for the Matroska container.
@@ -73,42 +109,20 @@ MatroskaTag::IdentifierType MatroskaTag::internallyGetFieldId(KnownField field)
 
 KnownField MatroskaTag::internallyGetKnownField(const IdentifierType &id) const
 {
-    using namespace MatroskaTagIds;
-    static const map<string, KnownField> fieldMap({
-        { artist(), KnownField::Artist },
-        { album(), KnownField::Album },
-        { comment(), KnownField::Comment },
-        { dateRecorded(), KnownField::RecordDate },
-        { dateRelease(), KnownField::ReleaseDate },
-        { title(), KnownField::Title },
-        { partNumber(), KnownField::PartNumber },
-        { totalParts(), KnownField::TotalParts },
-        { encoder(), KnownField::Encoder },
-        { encoderSettings(), KnownField::EncoderSettings },
-        { bpm(), KnownField::Bpm },
-        { bps(), KnownField::Bps },
-        { rating(), KnownField::Rating },
-        { description(), KnownField::Description },
-        { lyrics(), KnownField::Lyrics },
-        { label(), KnownField::RecordLabel },
-        { actor(), KnownField::Performers },
-        { lyricist(), KnownField::Lyricist },
-        { composer(), KnownField::Composer },
-        { duration(), KnownField::Length },
-        { language(), KnownField::Language },
-    });
-    const auto knownField(fieldMap.find(id));
-    return knownField != fieldMap.cend() ? knownField->second : KnownField::Invalid;
+    return knownFieldsByFieldId.find(id);
 }
 
 /*!
  * \brief Parses tag information from the specified \a tagElement.
  *
+ * If \a filter is specified "SimpleTag"-elements whose name it does not include are skipped; only their "TagName"-element
+ * is read. Nested fields are read along with the field they are nested in.
+ *
  * \throws Throws std::ios_base::failure when an IO error occurs.
  * \throws Throws TagParser::Failure or a derived exception when a parsing
  *         error occurs.
  */
-void MatroskaTag::parse(EbmlElement &tagElement, Diagnostics &diag)
+void MatroskaTag::parse(EbmlElement &tagElement, Diagnostics &diag, const TagFieldFilter *filter)
 {
     static const string context("parsing Matroska tag");
     tagElement.parse(diag);
@@ -118,11 +132,20 @@ void MatroskaTag::parse(EbmlElement &tagElement, Diagnostics &diag)
         throw NotImplementedException();
     }
     m_size = static_cast<std::uint32_t>(tagElement.totalSize());
+    const auto buffer = EbmlMasterBuffer(tagElement);
     for (EbmlElement *child = tagElement.firstChild(); child; child = child->nextSibling()) {
         child->parse(diag);
         switch (child->id()) {
         case MatroskaIds::SimpleTag:
             try {
+                if (filter && !filter->isEmpty()) {
+                    if (auto *const nameElement = child->childById(MatroskaIds::TagName, diag)) {
+                        const auto name = nameElement->readString();
+                        if (!filter->includes(knownField(name), name)) {
+                            break;
+                        }
+                    }
+                }
                 MatroskaTagField field;
                 field.reparse(*child, diag, true);
                 fields().emplace(field.id(), move(field));
@@ -252,47 +275,31 @@ MatroskaTagMaker::MatroskaTagMaker(MatroskaTag &tag, Diagnostics &diag)
  */
 void MatroskaTagMaker::make(ostream &stream) const
 {
-    // write header
-    char buff[11];
-    BE::getBytes(static_cast<std::uint16_t>(MatroskaIds::Tag), buff);
-    stream.write(buff, 2); // ID
-    std::uint8_t len = EbmlElement::makeSizeDenotation(m_tagSize, buff);
-    stream.write(buff, len); // size
-    // write "Targets" element
-    BE::getBytes(static_cast<std::uint16_t>(MatroskaIds::Targets), buff);
-    stream.write(buff, 2);
-    len = EbmlElement::makeSizeDenotation(m_targetsSize, buff);
-    stream.write(buff, len);
+    // compose the header and the "Targets"-element within one buffer so they are written at once; the size of the
+    // "Targets"-element has been computed when preparing and the header takes at most 2 * (2 + 8) bytes
+    const auto bufferSize = static_cast<std::size_t>(2 * (2 + 8) + m_targetsSize + EbmlElement::makeBufferSlack);
+    auto buffer = make_unique<char[]>(bufferSize);
+    auto *out = buffer.get();
+    out += EbmlElement::makeElementHeader(out, MatroskaIds::Tag, m_tagSize);
+    out += EbmlElement::makeElementHeader(out, MatroskaIds::Targets, m_targetsSize);
     const TagTarget &t = m_tag.target();
     if (t.level() != 50) {
-        // write "TargetTypeValue"
-        BE::getBytes(static_cast<std::uint16_t>(MatroskaIds::TargetTypeValue), buff);
-        stream.write(buff, 2);
-        len = EbmlElement::makeUInteger(t.level(), buff);
-        stream.put(static_cast<char>(0x80 | len));
-        stream.write(buff, len);
+        // make "TargetTypeValue"
+        out += EbmlElement::makeSimpleElement(out, MatroskaIds::TargetTypeValue, t.level());
     }
     if (!t.levelName().empty()) {
-        // write "TargetType"
-        BE::getBytes(static_cast<std::uint16_t>(MatroskaIds::TargetType), buff);
-        stream.write(buff, 2);
-        len = EbmlElement::makeSizeDenotation(t.levelName().size(), buff);
-        stream.write(buff, len);
-        stream.write(t.levelName().c_str(), t.levelName().size());
+        // make "TargetType"
+        out += EbmlElement::makeSimpleElement(out, MatroskaIds::TargetType, t.levelName().data(), t.levelName().size());
     }
-    // write UIDs
-    using p = pair<std::uint16_t, vector<std::uint64_t>>;
+    // make UIDs
+    using p = pair<std::uint16_t, const vector<std::uint64_t> &>;
     for (const auto &pair : initializer_list<p>{ p(MatroskaIds::TagTrackUID, t.tracks()), p(MatroskaIds::TagEditionUID, t.editions()),
              p(MatroskaIds::TagChapterUID, t.chapters()), p(MatroskaIds::TagAttachmentUID, t.attachments()) }) {
-        if (!pair.second.empty()) {
-            BE::getBytes(pair.first, buff);
-            for (auto uid : pair.second) {
-                len = EbmlElement::makeUInteger(uid, buff + 3);
-                *(buff + 2) = static_cast<char>(0x80 | len);
-                stream.write(buff, 3 + len);
-            }
+        for (auto uid : pair.second) {
+            out += EbmlElement::makeSimpleElement(out, pair.first, uid);
         }
     }
+    stream.write(buffer.get(), out - buffer.get());
     // write "SimpleTag" elements using maker objects prepared previously
     for (const auto &maker : m_maker) {
         maker.make(stream);
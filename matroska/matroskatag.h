@@ -10,6 +10,7 @@ namespace TagParser {
 
 class EbmlElement;
 class MatroskaTag;
+class TagFieldFilter;
 
 class TAG_PARSER_EXPORT MatroskaTagMaker {
     friend class MatroskaTag;
@@ -53,6 +54,7 @@ template <> class TAG_PARSER_EXPORT FieldMapBasedTagTraits<MatroskaTag> {
 public:
     using FieldType = MatroskaTagField;
     using Compare = std::less<typename FieldType::IdentifierType>;
+    using Storage = FlatMultiMap<typename FieldType::IdentifierType, FieldType, Compare>;
 };
 
 class TAG_PARSER_EXPORT MatroskaTag final : public FieldMapBasedTag<MatroskaTag> {
@@ -69,7 +71,7 @@ public:
     bool supportsMultipleValues(KnownField field) const override;
     TagTargetLevel targetLevel() const override;
 
-    void parse(EbmlElement &tagElement, Diagnostics &diag);
+    void parse(EbmlElement &tagElement, Diagnostics &diag, const TagFieldFilter *filter = nullptr);
     MatroskaTagMaker prepareMaking(Diagnostics &diag);
     void make(std::ostream &stream, Diagnostics &diag);
 
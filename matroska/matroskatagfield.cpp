@@ -4,15 +4,24 @@
 
 #include "../exceptions.h"
 
-#include <c++utilities/io/binarywriter.h>
 
 #include <memory>
+#include <string_view>
 
 using namespace std;
 using namespace CppUtilities;
 
 namespace TagParser {
 
+/// \cond
+namespace {
+
+/// \brief The value of the mandatory "TagLanguage"-element used if no language is set.
+constexpr std::string_view undefinedLanguage("und");
+
+} // namespace
+/// \endcond
+
 /*!
  * \class TagParser::MatroskaTagField
  * \brief The MatroskaTagField class is used by MatroskaTag to store the fields.
@@ -47,6 +56,7 @@ void MatroskaTagField::reparse(EbmlElement &simpleTagElement, Diagnostics &diag,
 {
     string context("parsing Matroska tag field");
     simpleTagElement.parse(diag);
+    const auto buffer = EbmlMasterBuffer(simpleTagElement);
     bool tagDefaultFound = false, tagLanguageFound = false, tagLanguageIETFFound = false;
     for (EbmlElement *child = simpleTagElement.firstChild(); child; child = child->nextSibling()) {
         try {
@@ -241,49 +251,35 @@ MatroskaTagFieldMaker::MatroskaTagFieldMaker(MatroskaTagField &field, Diagnostic
  */
 void MatroskaTagFieldMaker::make(ostream &stream) const
 {
-    BinaryWriter writer(&stream);
-    char buff[8];
-    // write "SimpleTag" element
-    writer.writeUInt16BE(MatroskaIds::SimpleTag);
-    std::uint8_t sizeDenotationLen = EbmlElement::makeSizeDenotation(m_simpleTagSize, buff);
-    stream.write(buff, sizeDenotationLen);
-    // write "TagName" element
-    writer.writeUInt16BE(MatroskaIds::TagName);
-    sizeDenotationLen = EbmlElement::makeSizeDenotation(m_field.id().size(), buff);
-    stream.write(buff, sizeDenotationLen);
-    stream.write(m_field.id().c_str(), m_field.id().size());
-    // write "TagLanguage" element
-    writer.writeUInt16BE(MatroskaIds::TagLanguage);
-    if (m_language.empty()) {
-        stream.put(static_cast<ostream::char_type>(0x80 | 3));
-        stream.write("und", 3);
-    } else {
-        sizeDenotationLen = EbmlElement::makeSizeDenotation(m_language.size(), buff);
-        stream.write(buff, sizeDenotationLen);
-        stream.write(m_language.data(), m_language.size());
-    }
-    // write "TagLanguageIETF" element
+    // compose the elements preceding the value within one buffer so they are written at once; the value itself is
+    // written directly from where it is stored
+    const auto language = m_language.empty() ? undefinedLanguage : std::string_view(m_language);
+    char stackBuffer[256];
+    const auto bufferSize = 5 * (2 + 8) + 4 + m_field.id().size() + language.size() + m_languageIETF.size() + EbmlElement::makeBufferSlack;
+    auto heapBuffer = unique_ptr<char[]>(bufferSize > sizeof(stackBuffer) ? new char[bufferSize] : nullptr);
+    char *const buffer = heapBuffer ? heapBuffer.get() : stackBuffer;
+    auto *out = buffer;
+    // make "SimpleTag" element header
+    out += EbmlElement::makeElementHeader(out, MatroskaIds::SimpleTag, m_simpleTagSize);
+    // make "TagName" element
+    out += EbmlElement::makeSimpleElement(out, MatroskaIds::TagName, m_field.id().data(), m_field.id().size());
+    // make "TagLanguage" element
+    out += EbmlElement::makeSimpleElement(out, MatroskaIds::TagLanguage, language.data(), language.size());
+    // make "TagLanguageIETF" element
     if (!m_languageIETF.empty()) {
-        writer.writeUInt16BE(MatroskaIds::TagLanguageIETF);
-        sizeDenotationLen = EbmlElement::makeSizeDenotation(m_languageIETF.size(), buff);
-        stream.write(buff, sizeDenotationLen);
-        stream.write(m_languageIETF.data(), m_languageIETF.size());
+        out += EbmlElement::makeSimpleElement(out, MatroskaIds::TagLanguageIETF, m_languageIETF.data(), m_languageIETF.size());
     }
-    // write "TagDefault" element
-    writer.writeUInt16BE(MatroskaIds::TagDefault);
-    stream.put(static_cast<ostream::char_type>(0x80 | 1));
-    stream.put(m_field.isDefault() ? 1 : 0);
-    // write "TagString"/"TagBinary" element
+    // make "TagDefault" element
+    out += EbmlElement::makeSimpleElement(out, MatroskaIds::TagDefault, m_field.isDefault() ? 1u : 0u);
+    // make header of "TagString"/"TagBinary" element and write everything followed by the value
     if (m_isBinary) {
-        writer.writeUInt16BE(MatroskaIds::TagBinary);
-        sizeDenotationLen = EbmlElement::makeSizeDenotation(m_field.value().dataSize(), buff);
-        stream.write(buff, sizeDenotationLen);
-        stream.write(m_field.value().dataPointer(), m_field.value().dataSize());
+        out += EbmlElement::makeElementHeader(out, MatroskaIds::TagBinary, m_field.value().dataSize());
+        stream.write(buffer, out - buffer);
+        stream.write(m_field.value().dataPointer(), static_cast<streamsize>(m_field.value().dataSize()));
     } else {
-        writer.writeUInt16BE(MatroskaIds::TagString);
-        sizeDenotationLen = EbmlElement::makeSizeDenotation(m_stringValue.size(), buff);
-        stream.write(buff, sizeDenotationLen);
-        stream.write(m_stringValue.data(), m_stringValue.size());
+        out += EbmlElement::makeElementHeader(out, MatroskaIds::TagString, m_stringValue.size());
+        stream.write(buffer, out - buffer);
+        stream.write(m_stringValue.data(), static_cast<streamsize>(m_stringValue.size()));
     }
     // make nested tags
     for (const auto &maker : m_nestedMaker) {
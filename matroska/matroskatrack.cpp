@@ -10,14 +10,20 @@
 
 #include "../avc/avcconfiguration.h"
 
+#include "../hevc/hevcconfiguration.h"
+
 #include "../mp4/mp4ids.h"
 #include "../mp4/mp4track.h"
 
 #include "../exceptions.h"
+#include "../mediafileinfo.h"
 #include "../mediaformat.h"
+#include "../perfecthashmap.h"
 
 #include <c++utilities/conversion/stringconversion.h>
 
+#include <string_view>
+
 using namespace std;
 using namespace CppUtilities;
 
@@ -52,170 +58,132 @@ TrackType MatroskaTrack::type() const
     return TrackType::MatroskaTrack;
 }
 
+/*!
+ * \brief Decodes the SPS/PPS of the AVC configuration if not done yet and adds the information to the track.
+ *
+ * This is only required when the track has been parsed using ParsingFlags::LazyDecodeParameterSets. Then the pixel
+ * size, cropping, chroma format and pixel aspect ratio are only determined when calling this function.
+ */
+void MatroskaTrack::decodeParameterSets(Diagnostics &diag)
+{
+    if (m_avcConfig) {
+        m_avcConfig->decodeParameterSets(diag);
+        Mp4Track::addInfo(*m_avcConfig, *this);
+        m_avcConfig.reset();
+    }
+}
+
+/// \cond
+namespace {
+
+/*!
+ * \brief The Matroska codec IDs and the corresponding media formats.
+ * \remarks IDs with less parts match any ID starting with them (see MatroskaTrack::codecIdToMediaFormat()).
+ */
+constexpr std::pair<std::string_view, MediaFormat> codecIdsAndFormats[] = {
+    { "V_MS/VFW/FOURCC", GeneralMediaFormat::MicrosoftVideoCodecManager },
+    { "V_UNCOMPRESSED", GeneralMediaFormat::UncompressedVideoFrames },
+    { "V_MPEG4", GeneralMediaFormat::Mpeg4Video },
+    { "V_MPEG4/ISO/SP", MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4SimpleProfile1) },
+    { "V_MPEG4/ISO/ASP", MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4AdvancedSimpleProfile1) },
+    { "V_MPEG4/ISO/AVC", GeneralMediaFormat::Avc },
+    { "V_MPEG4/MS/V3", MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4SimpleProfile1) },
+    { "V_MPEG1", GeneralMediaFormat::Mpeg1Video },
+    { "V_MPEG2", GeneralMediaFormat::Mpeg2Video },
+    { "V_REAL", GeneralMediaFormat::RealVideo },
+    { "V_QUICKTIME", GeneralMediaFormat::QuicktimeVideo },
+    { "V_THEORA", GeneralMediaFormat::Theora },
+    { "V_PRORES", GeneralMediaFormat::ProRes },
+    { "V_VP8", GeneralMediaFormat::Vp8 },
+    { "V_VP9", GeneralMediaFormat::Vp9 },
+    { "V_AV1", GeneralMediaFormat::Av1 },
+    { "V_MPEGH/ISO/HEVC", GeneralMediaFormat::Hevc },
+    { "V_MSWMV", GeneralMediaFormat::Vc1 },
+    { "A_MPEG", GeneralMediaFormat::Mpeg1Audio },
+    { "A_MPEG/L1", MediaFormat(GeneralMediaFormat::Mpeg1Audio, SubFormats::Mpeg1Layer1) },
+    { "A_MPEG/L2", MediaFormat(GeneralMediaFormat::Mpeg1Audio, SubFormats::Mpeg1Layer2) },
+    { "A_MPEG/L3", MediaFormat(GeneralMediaFormat::Mpeg1Audio, SubFormats::Mpeg1Layer3) },
+    { "A_PCM", GeneralMediaFormat::Pcm },
+    { "A_PCM/INT/BIG", MediaFormat(GeneralMediaFormat::Pcm, SubFormats::PcmIntBe) },
+    { "A_PCM/INT/LIT", MediaFormat(GeneralMediaFormat::Pcm, SubFormats::PcmIntLe) },
+    { "A_PCM/FLOAT/IEEE", MediaFormat(GeneralMediaFormat::Pcm, SubFormats::PcmFloatIeee) },
+    { "A_MPC", GeneralMediaFormat::Mpc },
+    { "A_AC3", GeneralMediaFormat::Ac3 },
+    { "A_EAC3", GeneralMediaFormat::EAc3 },
+    { "A_ALAC", GeneralMediaFormat::Alac },
+    { "A_DTS", GeneralMediaFormat::Dts },
+    { "A_DTS/EXPRESS", MediaFormat(GeneralMediaFormat::Dts, SubFormats::DtsExpress) },
+    { "A_DTS/LOSSLESS", MediaFormat(GeneralMediaFormat::Dts, SubFormats::DtsLossless) },
+    { "A_VORBIS", GeneralMediaFormat::Vorbis },
+    { "A_FLAC", GeneralMediaFormat::Flac },
+    { "A_OPUS", GeneralMediaFormat::Opus },
+    { "A_REAL", GeneralMediaFormat::RealAudio },
+    { "A_MS/ACM", GeneralMediaFormat::MicrosoftAudioCodecManager },
+    { "A_AAC", GeneralMediaFormat::Aac },
+    { "A_AAC/MPEG2/MAIN", MediaFormat(GeneralMediaFormat::Aac, SubFormats::AacMpeg2MainProfile) },
+    { "A_AAC/MPEG2/LC", MediaFormat(GeneralMediaFormat::Aac, SubFormats::AacMpeg2LowComplexityProfile) },
+    { "A_AAC/MPEG2/SBR",
+        MediaFormat(GeneralMediaFormat::Aac, SubFormats::AacMpeg2LowComplexityProfile, ExtensionFormats::SpectralBandReplication) },
+    { "A_AAC/MPEG2/SSR", MediaFormat(GeneralMediaFormat::Aac, SubFormats::AacMpeg2ScalableSamplingRateProfile) },
+    { "A_AAC/MPEG4/MAIN", MediaFormat(GeneralMediaFormat::Aac, SubFormats::AacMpeg4MainProfile) },
+    { "A_AAC/MPEG4/LC", MediaFormat(GeneralMediaFormat::Aac, SubFormats::AacMpeg4LowComplexityProfile) },
+    { "A_AAC/MPEG4/SBR",
+        MediaFormat(GeneralMediaFormat::Aac, SubFormats::AacMpeg4LowComplexityProfile, ExtensionFormats::SpectralBandReplication) },
+    { "A_AAC/MPEG4/SSR", MediaFormat(GeneralMediaFormat::Aac, SubFormats::AacMpeg4ScalableSamplingRateProfile) },
+    { "A_AAC/MPEG4/LTP", MediaFormat(GeneralMediaFormat::Aac, SubFormats::AacMpeg4LongTermPrediction) },
+    { "A_QUICKTIME", GeneralMediaFormat::QuicktimeAudio },
+    { "A_TTA1", GeneralMediaFormat::Tta },
+    { "A_WAVPACK4", GeneralMediaFormat::WavPack },
+    { "S_TEXT", GeneralMediaFormat::TextSubtitle },
+    { "S_TEXT/UTF8", MediaFormat(GeneralMediaFormat::TextSubtitle, SubFormats::PlainUtf8Subtitle) },
+    { "S_TEXT/SSA", MediaFormat(GeneralMediaFormat::TextSubtitle, SubFormats::SubStationAlpha) },
+    { "S_TEXT/ASS", MediaFormat(GeneralMediaFormat::TextSubtitle, SubFormats::AdvancedSubStationAlpha) },
+    { "S_TEXT/USF", MediaFormat(GeneralMediaFormat::TextSubtitle, SubFormats::UniversalSubtitleFormat) },
+    { "S_TEXT/WEBVTT", MediaFormat(GeneralMediaFormat::TextSubtitle, SubFormats::WebVideoTextTracksFormat) },
+    { "S_IMAGE", GeneralMediaFormat::ImageSubtitle },
+    { "S_IMAGE/BMP", MediaFormat(GeneralMediaFormat::ImageSubtitle, SubFormats::ImgSubBmp) },
+    { "S_VOBSUB", GeneralMediaFormat::VobSub },
+    { "S_KATE", GeneralMediaFormat::OggKate },
+    { "S_DVBSUB", GeneralMediaFormat::DvbSub },
+    { "B_VOBBTN", GeneralMediaFormat::VobBtn },
+};
+constexpr auto formatsByCodecId = makePerfectHashMap(codecIdsAndFormats, MediaFormat());
+static_assert(formatsByCodecId.isPerfect(), "codec IDs must be unique");
+
+} // namespace
+/// \endcond
+
 /*!
  * \brief Returns the MediaFormat for the specified Matroska codec ID.
- * \todo Use an std::unordered_map here.
+ *
+ * The whole ID is looked up first, then its first two parts and then its first part. So sub formats are only
+ * determined if known while the general format is determined from the first part. Only the first three parts are
+ * distinguished (further parts count as part of the third one). The lookup does not allocate.
  */
-MediaFormat MatroskaTrack::codecIdToMediaFormat(const string &codecId)
+MediaFormat MatroskaTrack::codecIdToMediaFormat(std::string_view codecId)
 {
-    auto parts = splitString<vector<string>>(codecId, "/", EmptyPartsTreat::Keep, 3);
-    parts.resize(3);
-    const auto &part1 = parts[0], &part2 = parts[1], &part3 = parts[2];
-    MediaFormat fmt;
-    if (part1 == "V_MS" && part2 == "VFW" && part3 == "FOURCC") {
-        fmt.general = GeneralMediaFormat::MicrosoftVideoCodecManager;
-    } else if (part1 == "V_UNCOMPRESSED") {
-        fmt.general = GeneralMediaFormat::UncompressedVideoFrames;
-    } else if (part1 == "V_MPEG4") {
-        fmt.general = GeneralMediaFormat::Mpeg4Video;
-        if (part2 == "ISO") {
-            if (part3 == "SP") {
-                fmt.sub = SubFormats::Mpeg4SimpleProfile1;
-            } else if (part3 == "ASP") {
-                fmt.sub = SubFormats::Mpeg4AdvancedSimpleProfile1;
-            } else if (part3 == "AVC") {
-                fmt.general = GeneralMediaFormat::Avc;
-            }
-        } else if (part2 == "MS" && part3 == "V3") {
-            fmt.sub = SubFormats::Mpeg4SimpleProfile1;
-        }
-    } else if (part1 == "V_MPEG1") {
-        fmt.general = GeneralMediaFormat::Mpeg1Video;
-    } else if (part1 == "V_MPEG2") {
-        fmt.general = GeneralMediaFormat::Mpeg2Video;
-    } else if (part1 == "V_REAL") {
-        fmt.general = GeneralMediaFormat::RealVideo;
-    } else if (part1 == "V_QUICKTIME") {
-        fmt.general = GeneralMediaFormat::QuicktimeVideo;
-    } else if (part1 == "V_THEORA") {
-        fmt.general = GeneralMediaFormat::Theora;
-    } else if (part1 == "V_PRORES") {
-        fmt.general = GeneralMediaFormat::ProRes;
-    } else if (part1 == "V_VP8") {
-        fmt.general = GeneralMediaFormat::Vp8;
-    } else if (part1 == "V_VP9") {
-        fmt.general = GeneralMediaFormat::Vp9;
-    } else if (part1 == "V_AV1") {
-        fmt.general = GeneralMediaFormat::Av1;
-    } else if (part1 == "A_MPEG") {
-        fmt.general = GeneralMediaFormat::Mpeg1Audio;
-        if (part2 == "L1") {
-            fmt.sub = SubFormats::Mpeg1Layer1;
-        } else if (part2 == "L2") {
-            fmt.sub = SubFormats::Mpeg1Layer2;
-        } else if (part2 == "L3") {
-            fmt.sub = SubFormats::Mpeg1Layer3;
-        }
-    } else if (part1 == "V_MPEGH" && part2 == "ISO" && part3 == "HEVC") {
-        fmt.general = GeneralMediaFormat::Hevc;
-    } else if (part1 == "A_PCM") {
-        fmt.general = GeneralMediaFormat::Pcm;
-        if (part2 == "INT") {
-            if (part3 == "BIG") {
-                fmt.sub = SubFormats::PcmIntBe;
-            } else if (part3 == "LIT") {
-                fmt.sub = SubFormats::PcmIntLe;
-            }
-        } else if (part2 == "FLOAT" && part3 == "IEEE") {
-            fmt.sub = SubFormats::PcmFloatIeee;
-        }
-    } else if (part1 == "A_MPC") {
-        fmt.general = GeneralMediaFormat::Mpc;
-    } else if (part1 == "A_AC3") {
-        fmt.general = GeneralMediaFormat::Ac3;
-    } else if (part1 == "A_EAC3") {
-        fmt.general = GeneralMediaFormat::EAc3;
-    } else if (part1 == "A_ALAC") {
-        fmt.general = GeneralMediaFormat::Alac;
-    } else if (part1 == "A_DTS") {
-        fmt.general = GeneralMediaFormat::Dts;
-        if (part2 == "EXPRESS") {
-            fmt.sub = SubFormats::DtsExpress;
-        } else if (part2 == "LOSSLESS") {
-            fmt.sub = SubFormats::DtsLossless;
-        }
-    } else if (part1 == "A_VORBIS") {
-        fmt.general = GeneralMediaFormat::Vorbis;
-    } else if (part1 == "A_FLAC") {
-        fmt.general = GeneralMediaFormat::Flac;
-    } else if (part1 == "A_OPUS") {
-        fmt.general = GeneralMediaFormat::Opus;
-    } else if (part1 == "A_REAL") {
-        fmt.general = GeneralMediaFormat::RealAudio;
-    } else if (part1 == "A_MS" && part2 == "ACM") {
-        fmt.general = GeneralMediaFormat::MicrosoftAudioCodecManager;
-    } else if (part1 == "A_AAC") {
-        fmt.general = GeneralMediaFormat::Aac;
-        if (part2 == "MPEG2") {
-            if (part3 == "MAIN") {
-                fmt.sub = SubFormats::AacMpeg2MainProfile;
-            } else if (part3 == "LC") {
-                fmt.sub = SubFormats::AacMpeg2LowComplexityProfile;
-            } else if (part3 == "SBR") {
-                fmt.sub = SubFormats::AacMpeg2LowComplexityProfile;
-                fmt.extension = ExtensionFormats::SpectralBandReplication;
-            } else if (part3 == "SSR") {
-                fmt.sub = SubFormats::AacMpeg2ScalableSamplingRateProfile;
-            }
-        } else if (part2 == "MPEG4") {
-            if (part3 == "MAIN") {
-                fmt.sub = SubFormats::AacMpeg4MainProfile;
-            } else if (part3 == "LC") {
-                fmt.sub = SubFormats::AacMpeg4LowComplexityProfile;
-            } else if (part3 == "SBR") {
-                fmt.sub = SubFormats::AacMpeg4LowComplexityProfile;
-                fmt.extension = ExtensionFormats::SpectralBandReplication;
-            } else if (part3 == "SSR") {
-                fmt.sub = SubFormats::AacMpeg4ScalableSamplingRateProfile;
-            } else if (part3 == "LTP") {
-                fmt.sub = SubFormats::AacMpeg4LongTermPrediction;
-            }
-        }
-    } else if (part1 == "A_QUICKTIME") {
-        fmt.general = GeneralMediaFormat::QuicktimeAudio;
-    } else if (part1 == "A_TTA1") {
-        fmt.general = GeneralMediaFormat::Tta;
-    } else if (part1 == "A_WAVPACK4") {
-        fmt.general = GeneralMediaFormat::WavPack;
-    } else if (part1 == "S_TEXT") {
-        fmt.general = GeneralMediaFormat::TextSubtitle;
-        if (part2 == "UTF8") {
-            fmt.sub = SubFormats::PlainUtf8Subtitle;
-        } else if (part2 == "SSA") {
-            fmt.sub = SubFormats::SubStationAlpha;
-        } else if (part2 == "ASS") {
-            fmt.sub = SubFormats::AdvancedSubStationAlpha;
-        } else if (part2 == "USF") {
-            fmt.sub = SubFormats::UniversalSubtitleFormat;
-        } else if (part2 == "WEBVTT") {
-            fmt.sub = SubFormats::WebVideoTextTracksFormat;
-        }
-    } else if (part1 == "S_IMAGE") {
-        fmt.general = GeneralMediaFormat::ImageSubtitle;
-        if (part2 == "BMP") {
-            fmt.sub = SubFormats::ImgSubBmp;
+    if (const auto fmt = formatsByCodecId.find(codecId)) {
+        return fmt;
+    }
+    const auto firstSeparator = codecId.find('/');
+    if (firstSeparator == std::string_view::npos) {
+        return MediaFormat();
+    }
+    if (const auto secondSeparator = codecId.find('/', firstSeparator + 1); secondSeparator != std::string_view::npos) {
+        if (const auto fmt = formatsByCodecId.find(codecId.substr(0, secondSeparator))) {
+            return fmt;
         }
-    } else if (part1 == "S_VOBSUB") {
-        fmt.general = GeneralMediaFormat::VobSub;
-    } else if (part1 == "S_KATE") {
-        fmt.general = GeneralMediaFormat::OggKate;
-    } else if (part1 == "B_VOBBTN") {
-        fmt.general = GeneralMediaFormat::VobBtn;
-    } else if (part1 == "S_DVBSUB") {
-        fmt.general = GeneralMediaFormat::DvbSub;
-    } else if (part1 == "V_MSWMV") {
-        fmt.general = GeneralMediaFormat::Vc1;
     }
-    return fmt;
+    return formatsByCodecId.find(codecId.substr(0, firstSeparator));
 }
 
 /// \cond
 
 template <typename PropertyType, typename ConversionFunction>
-void MatroskaTrack::assignPropertyFromTagValue(const std::unique_ptr<MatroskaTag> &tag, const char *fieldId, PropertyType &property,
-    const ConversionFunction &conversionFunction, Diagnostics &diag)
+void MatroskaTrack::assignPropertyFromTagValue(
+    const MatroskaTag &tag, const char *fieldId, PropertyType &property, const ConversionFunction &conversionFunction, Diagnostics &diag)
 {
-    const TagValue &value = tag->value(fieldId);
+    const TagValue &value = tag.value(fieldId);
     if (!value.isEmpty()) {
         try {
             property = conversionFunction(value);
@@ -226,7 +194,7 @@ void MatroskaTrack::assignPropertyFromTagValue(const std::unique_ptr<MatroskaTag
             } catch (const ConversionException &) {
                 message = argsToString("Ignoring invalid value of \"", fieldId, '\"', '.');
             }
-            diag.emplace_back(DiagLevel::Warning, message, argsToString("reading track statatistic from \"", tag->toString(), '\"'));
+            diag.emplace_back(DiagLevel::Warning, message, argsToString("reading track statatistic from \"", tag.toString(), '\"'));
         }
     }
 }
@@ -262,27 +230,39 @@ NumberType tagValueToBitrate(const TagValue &tagValue)
  *   before (either by calling parseHeader() or setId()).
  * \sa https://github.com/mbunkus/mkvtoolnix/wiki/Automatic-tag-generation for list of track-specific
  *     tag fields written by mkvmerge
+ * - To read the statistics of many tracks it is more efficient to iterate over the tags only once and pass each tag to
+ *   readStatisticsFromTag() for the tracks it targets (see MatroskaContainer::readTrackStatisticsFromTags()).
  */
 void MatroskaTrack::readStatisticsFromTags(const std::vector<std::unique_ptr<MatroskaTag>> &tags, Diagnostics &diag)
 {
-    using namespace std::placeholders;
-    using namespace MatroskaTagIds::TrackSpecific;
     for (const auto &tag : tags) {
         const TagTarget &target = tag->target();
-        if (find(target.tracks().cbegin(), target.tracks().cend(), id()) == target.tracks().cend()) {
-            continue;
-        }
-        assignPropertyFromTagValue(tag, numberOfBytes(), m_size, &tagValueToNumber<std::uint64_t>, diag);
-        assignPropertyFromTagValue(tag, numberOfFrames(), m_sampleCount, &tagValueToNumber<std::uint64_t>, diag);
-        assignPropertyFromTagValue(tag, MatroskaTagIds::TrackSpecific::duration(), m_duration, bind(&TagValue::toTimeSpan, _1), diag);
-        assignPropertyFromTagValue(tag, MatroskaTagIds::TrackSpecific::bitrate(), m_bitrate, &tagValueToBitrate<double>, diag);
-        assignPropertyFromTagValue(tag, writingDate(), m_modificationTime, bind(&TagValue::toDateTime, _1), diag);
-        if (m_creationTime.isNull()) {
-            m_creationTime = m_modificationTime;
+        if (find(target.tracks().cbegin(), target.tracks().cend(), id()) != target.tracks().cend()) {
+            readStatisticsFromTag(*tag, diag);
         }
     }
 }
 
+/*!
+ * \brief Reads track-specific statistics from the specified \a tag.
+ * \remarks Unlike readStatisticsFromTags() this does not check whether the \a tag targets the track. The fields are
+ *          looked up by their ID within the field map of the tag so the number of fields the tag contains does not
+ *          matter much.
+ */
+void MatroskaTrack::readStatisticsFromTag(const MatroskaTag &tag, Diagnostics &diag)
+{
+    using namespace std::placeholders;
+    using namespace MatroskaTagIds::TrackSpecific;
+    assignPropertyFromTagValue(tag, numberOfBytes(), m_size, &tagValueToNumber<std::uint64_t>, diag);
+    assignPropertyFromTagValue(tag, numberOfFrames(), m_sampleCount, &tagValueToNumber<std::uint64_t>, diag);
+    assignPropertyFromTagValue(tag, MatroskaTagIds::TrackSpecific::duration(), m_duration, bind(&TagValue::toTimeSpan, _1), diag);
+    assignPropertyFromTagValue(tag, MatroskaTagIds::TrackSpecific::bitrate(), m_bitrate, &tagValueToBitrate<double>, diag);
+    assignPropertyFromTagValue(tag, writingDate(), m_modificationTime, bind(&TagValue::toDateTime, _1), diag);
+    if (m_creationTime.isNull()) {
+        m_creationTime = m_modificationTime;
+    }
+}
+
 void MatroskaTrack::internalParseHeader(Diagnostics &diag)
 {
     static const string context("parsing header of Matroska track");
@@ -293,6 +273,8 @@ void MatroskaTrack::internalParseHeader(Diagnostics &diag)
         throw;
     }
     // read information about the track from the children of the track entry element
+    // note: The track entry is buffered so the many small children are not read one after another from the stream.
+    const auto buffer = EbmlMasterBuffer(*m_trackElement);
     for (EbmlElement *trackInfoElement = m_trackElement->firstChild(), *subElement = nullptr; trackInfoElement;
          trackInfoElement = trackInfoElement->nextSibling()) {
         try {
@@ -503,12 +485,18 @@ void MatroskaTrack::internalParseHeader(Diagnostics &diag)
         }
         break;
     case GeneralMediaFormat::Avc:
+        m_avcConfig.reset();
         if ((codecPrivateElement = m_trackElement->childById(MatroskaIds::CodecPrivate, diag))) {
             auto avcConfig = make_unique<TagParser::AvcConfiguration>();
             try {
                 m_istream->seekg(static_cast<streamoff>(codecPrivateElement->dataOffset()));
-                avcConfig->parse(m_reader, codecPrivateElement->dataSize(), diag);
+                avcConfig->parse(m_reader, codecPrivateElement->dataSize(), diag,
+                    !(m_trackElement->container().fileInfo().parsingFlags() & ParsingFlags::LazyDecodeParameterSets));
                 Mp4Track::addInfo(*avcConfig, *this);
+                if (avcConfig->hasUndecodedParameterSets()) {
+                    // keep the configuration to be able to decode the SPS/PPS when needed
+                    m_avcConfig = move(avcConfig);
+                }
             } catch (const TruncatedDataException &) {
                 diag.emplace_back(DiagLevel::Critical, "AVC configuration is truncated.", context);
             } catch (const Failure &) {
@@ -516,6 +504,20 @@ void MatroskaTrack::internalParseHeader(Diagnostics &diag)
             }
         }
         break;
+    case GeneralMediaFormat::Hevc:
+        if ((codecPrivateElement = m_trackElement->childById(MatroskaIds::CodecPrivate, diag))) {
+            auto hevcConfig = HevcConfiguration();
+            try {
+                m_istream->seekg(static_cast<streamoff>(codecPrivateElement->dataOffset()));
+                hevcConfig.parse(m_reader, codecPrivateElement->dataSize(), diag);
+                Mp4Track::addInfo(hevcConfig, *this);
+            } catch (const TruncatedDataException &) {
+                diag.emplace_back(DiagLevel::Critical, "HEVC configuration is truncated.", context);
+            } catch (const Failure &) {
+                diag.emplace_back(DiagLevel::Critical, "HEVC configuration is invalid.", context);
+            }
+        }
+        break;
     default:;
     }
 
@@ -3,6 +3,9 @@
 
 #include "../abstracttrack.h"
 
+#include <memory>
+#include <string_view>
+
 namespace TagParser {
 
 class EbmlElement;
@@ -45,6 +48,8 @@ inline std::uint64_t MatroskaTrackHeaderMaker::requiredSize() const
     return m_requiredSize;
 }
 
+struct AvcConfiguration;
+
 class TAG_PARSER_EXPORT MatroskaTrack : public AbstractTrack {
     friend class MatroskaContainer;
     friend class MatroskaTrackHeaderMaker;
@@ -55,20 +60,23 @@ public:
 
     TrackType type() const override;
 
-    static MediaFormat codecIdToMediaFormat(const std::string &codecId);
+    static MediaFormat codecIdToMediaFormat(std::string_view codecId);
     void readStatisticsFromTags(const std::vector<std::unique_ptr<MatroskaTag>> &tags, Diagnostics &diag);
+    void readStatisticsFromTag(const MatroskaTag &tag, Diagnostics &diag);
     MatroskaTrackHeaderMaker prepareMakingHeader(Diagnostics &diag) const;
     void makeHeader(std::ostream &stream, Diagnostics &diag) const;
+    void decodeParameterSets(Diagnostics &diag);
 
 protected:
     void internalParseHeader(Diagnostics &diag) override;
 
 private:
     template <typename PropertyType, typename ConversionFunction>
-    void assignPropertyFromTagValue(const std::unique_ptr<MatroskaTag> &tag, const char *fieldId, PropertyType &integer,
+    void assignPropertyFromTagValue(const MatroskaTag &tag, const char *fieldId, PropertyType &integer,
         const ConversionFunction &conversionFunction, Diagnostics &diag);
 
     EbmlElement *m_trackElement;
+    std::unique_ptr<AvcConfiguration> m_avcConfig;
 };
 
 /*!
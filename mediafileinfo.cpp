@@ -1,12 +1,18 @@
 #include "./mediafileinfo.h"
 #include "./abstracttrack.h"
 #include "./backuphelper.h"
+#include "./bytesource.h"
 #include "./diagnostics.h"
 #include "./exceptions.h"
+#include "./filerangecopier.h"
 #include "./locale.h"
+#include "./parseresultcache.h"
 #include "./progressfeedback.h"
+#include "./seeklessoutputstream.h"
 #include "./signature.h"
 #include "./tag.h"
+#include "./tracepoints.h"
+#include "./trackcolumns.h"
 
 #include "./id3/id3v1tag.h"
 #include "./id3/id3v2tag.h"
@@ -39,13 +45,19 @@
 #include <c++utilities/conversion/stringconversion.h>
 
 #include <unistd.h>
+#ifdef PLATFORM_UNIX
+#include <fcntl.h>
+#endif
 
 #include <algorithm>
+#include <chrono>
 #include <cstdio>
+#include <cstring>
 #include <functional>
 #include <iomanip>
 #include <ios>
 #include <memory>
+#include <optional>
 #include <system_error>
 
 using namespace std;
@@ -65,6 +77,52 @@ namespace TagParser {
 #define MEDIAINFO_CPP_FORCE_FULL_PARSE false
 #endif
 
+/// \cond
+#define MEDIAINFO_CPP_TRACEPOINT_SCOPE(name)                                                                                                         \
+    TAG_PARSER_TRACEPOINT_SCOPE(name, path().data(), size(), static_cast<int>(m_containerFormat),                                                    \
+        m_container ? m_container->parsedElementCount() : std::uint64_t(), trackCount())
+
+namespace {
+
+/*!
+ * \brief Adds a critical message about exceeding the limit of the specified \a account to \a diag.
+ */
+void addMemoryLimitMessage(Diagnostics &diag, const MemoryAccount &account, const std::string &context)
+{
+    diag.emplace_back(DiagLevel::Critical,
+        argsToString("Parsing has been aborted because the memory limit of ", account.limit(), " bytes has been exceeded."), context);
+}
+
+/*!
+ * \brief Restores the padding settings of MediaFileInfo which are altered while applying a PaddingPolicy.
+ */
+class PaddingSettingsRestorer {
+public:
+    explicit PaddingSettingsRestorer(std::size_t &minPadding, std::size_t &maxPadding, std::size_t &preferredPadding)
+        : m_minPadding(minPadding)
+        , m_maxPadding(maxPadding)
+        , m_preferredPadding(preferredPadding)
+        , m_settings{ minPadding, maxPadding, preferredPadding }
+    {
+    }
+    PaddingSettingsRestorer(const PaddingSettingsRestorer &) = delete;
+    ~PaddingSettingsRestorer()
+    {
+        m_minPadding = m_settings.minPadding;
+        m_maxPadding = m_settings.maxPadding;
+        m_preferredPadding = m_settings.preferredPadding;
+    }
+
+private:
+    std::size_t &m_minPadding;
+    std::size_t &m_maxPadding;
+    std::size_t &m_preferredPadding;
+    const PaddingSettings m_settings;
+};
+
+} // namespace
+/// \endcond
+
 /*!
  * \class TagParser::MediaFileInfo
  * \brief The MediaFileInfo class allows to read and write tag information providing
@@ -83,19 +141,42 @@ MediaFileInfo::MediaFileInfo()
     , m_containerFormat(ContainerFormat::Unknown)
     , m_containerOffset(0)
     , m_actualExistingId3v1Tag(false)
+    , m_actualAppendedId3v2TagSize(0)
     , m_tracksParsingStatus(ParsingStatus::NotParsedYet)
     , m_tagsParsingStatus(ParsingStatus::NotParsedYet)
     , m_chaptersParsingStatus(ParsingStatus::NotParsedYet)
     , m_attachmentsParsingStatus(ParsingStatus::NotParsedYet)
+    , m_backupStrategy(BackupStrategy::Rename)
+    , m_durabilityPolicy(DurabilityPolicy::Default)
+    , m_parseResultCache(nullptr)
     , m_minPadding(0)
     , m_maxPadding(0)
     , m_preferredPadding(0)
     , m_tagPosition(ElementPosition::BeforeData)
     , m_indexPosition(ElementPosition::BeforeData)
+    , m_parsingFlags(ParsingFlags::None)
+    , m_maxParsingOffset(0)
+    , m_mpegAudioMaxJunkSize(MpegAudioFrameStream::defaultMaxJunkSize)
+    , m_ivfFrameIndexBudget(0)
+    , m_matroskaClusterScanBudget(0x1000000)
+    , m_matroskaMaxFullParseSize(MatroskaContainer::maxFullParseSize())
+    , m_matroskaSegmentParsingThreadCount(1)
+    , m_matroskaParseStrategy(MatroskaParseStrategy::Sequential)
     , m_forceFullParse(MEDIAINFO_CPP_FORCE_FULL_PARSE)
     , m_forceRewrite(true)
+    , m_forceInPlace(false)
     , m_forceTagPosition(true)
     , m_forceIndexPosition(true)
+    , m_elementArenaEnabled(false)
+    , m_tagsFiltered(false)
+    , m_mpegAudioExactDurationEnabled(false)
+    , m_mpegAudioSeekTableWritingEnabled(false)
+    , m_blockShiftingEnabled(false)
+    , m_skipUnmodified(false)
+    , m_ioTracingEnabled(false)
+    , m_structureModified(false)
+    , m_headOffset(0)
+    , m_forcedContainerFormat(ContainerFormat::Unknown)
 {
 }
 
@@ -110,19 +191,42 @@ MediaFileInfo::MediaFileInfo(const string &path)
     , m_containerFormat(ContainerFormat::Unknown)
     , m_containerOffset(0)
     , m_actualExistingId3v1Tag(false)
+    , m_actualAppendedId3v2TagSize(0)
     , m_tracksParsingStatus(ParsingStatus::NotParsedYet)
     , m_tagsParsingStatus(ParsingStatus::NotParsedYet)
     , m_chaptersParsingStatus(ParsingStatus::NotParsedYet)
     , m_attachmentsParsingStatus(ParsingStatus::NotParsedYet)
+    , m_backupStrategy(BackupStrategy::Rename)
+    , m_durabilityPolicy(DurabilityPolicy::Default)
+    , m_parseResultCache(nullptr)
     , m_minPadding(0)
     , m_maxPadding(0)
     , m_preferredPadding(0)
     , m_tagPosition(ElementPosition::BeforeData)
     , m_indexPosition(ElementPosition::BeforeData)
+    , m_parsingFlags(ParsingFlags::None)
+    , m_maxParsingOffset(0)
+    , m_mpegAudioMaxJunkSize(MpegAudioFrameStream::defaultMaxJunkSize)
+    , m_ivfFrameIndexBudget(0)
+    , m_matroskaClusterScanBudget(0x1000000)
+    , m_matroskaMaxFullParseSize(MatroskaContainer::maxFullParseSize())
+    , m_matroskaSegmentParsingThreadCount(1)
+    , m_matroskaParseStrategy(MatroskaParseStrategy::Sequential)
     , m_forceFullParse(MEDIAINFO_CPP_FORCE_FULL_PARSE)
     , m_forceRewrite(true)
+    , m_forceInPlace(false)
     , m_forceTagPosition(true)
     , m_forceIndexPosition(true)
+    , m_elementArenaEnabled(false)
+    , m_tagsFiltered(false)
+    , m_mpegAudioExactDurationEnabled(false)
+    , m_mpegAudioSeekTableWritingEnabled(false)
+    , m_blockShiftingEnabled(false)
+    , m_skipUnmodified(false)
+    , m_ioTracingEnabled(false)
+    , m_structureModified(false)
+    , m_headOffset(0)
+    , m_forcedContainerFormat(ContainerFormat::Unknown)
 {
 }
 
@@ -133,6 +237,253 @@ MediaFileInfo::~MediaFileInfo()
 {
 }
 
+/*!
+ * \class TagParser::MediaFileInfo::StatisticsScope
+ * \brief The StatisticsScope class records the statistics of a parse phase or of applying changes while it is alive.
+ *
+ * It installs a CountingStreamBuffer on the specified stream and times the phase. Nested scopes (e.g. parseTracks()
+ * being called by parseTags()) only time their phase so I/O is not counted twice.
+ *
+ * \remarks Does nothing if the library has been built without statistics. If statistics are disabled, only the I/O
+ *          of applying changes is counted (into statistics local to the scope) for MediaFileInfo::applyChangesResult().
+ */
+class MediaFileInfo::StatisticsScope {
+public:
+    explicit StatisticsScope(MediaFileInfo &fileInfo, std::ios &stream, std::optional<ParsePhase> phase = std::nullopt);
+    ~StatisticsScope();
+
+    void addParsedElements(ContainerFormat format, std::uint64_t count);
+    void addCopiedBytes(const FileRangeCopierStatistics &before, const FileRangeCopierStatistics &after);
+    std::uint64_t bytesPatched() const;
+    std::uint64_t bytesCopied() const;
+
+private:
+#ifndef TAG_PARSER_NO_STATISTICS
+    static void replaceBuffer(std::ios &stream, std::streambuf *buffer);
+
+    MediaFileInfo &m_fileInfo;
+    std::optional<MediaFileStatistics> m_localStatistics;
+    MediaFileStatistics *const m_statistics;
+    std::ios &m_stream;
+    std::optional<ParsePhase> m_phase;
+    std::optional<CountingStreamBuffer> m_buffer;
+    std::chrono::steady_clock::time_point m_start;
+    std::uint64_t m_initialElementCount;
+    std::uint64_t m_initialBytesWritten;
+    std::uint64_t m_bytesCopiedByUserspace;
+    std::uint64_t m_bytesCopied;
+#endif
+};
+
+/*!
+ * \brief Starts recording the statistics of the specified \a phase (or of applying changes) done via the specified \a stream.
+ */
+MediaFileInfo::StatisticsScope::StatisticsScope(MediaFileInfo &fileInfo, std::ios &stream, std::optional<ParsePhase> phase)
+#ifndef TAG_PARSER_NO_STATISTICS
+    : m_fileInfo(fileInfo)
+    , m_statistics(fileInfo.m_statistics ? fileInfo.m_statistics.get() : (phase.has_value() ? nullptr : &m_localStatistics.emplace()))
+    , m_stream(stream)
+    , m_phase(phase)
+    , m_initialElementCount(0)
+    , m_initialBytesWritten(0)
+    , m_bytesCopiedByUserspace(0)
+    , m_bytesCopied(0)
+{
+    if (!m_statistics) {
+        return;
+    }
+    if (fileInfo.m_container) {
+        m_initialElementCount = fileInfo.m_container->parsedElementCount();
+    }
+    m_initialBytesWritten = m_statistics->bytesWritten;
+    if (auto *const buffer = stream.rdbuf(); buffer && !dynamic_cast<CountingStreamBuffer *>(buffer)) {
+        replaceBuffer(stream, &m_buffer.emplace(*buffer, *m_statistics, fileInfo.m_ioTracingEnabled && !m_localStatistics.has_value()));
+    }
+    m_start = std::chrono::steady_clock::now();
+}
+#else
+{
+    CPP_UTILITIES_UNUSED(fileInfo);
+    CPP_UTILITIES_UNUSED(stream);
+    CPP_UTILITIES_UNUSED(phase);
+}
+#endif
+
+/*!
+ * \brief Stops recording, restoring the original buffer of the stream.
+ */
+MediaFileInfo::StatisticsScope::~StatisticsScope()
+{
+#ifndef TAG_PARSER_NO_STATISTICS
+    if (!m_statistics) {
+        return;
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start);
+    if (m_phase.has_value()) {
+        m_statistics->parseTimes[static_cast<std::size_t>(m_phase.value())] += elapsed;
+    } else {
+        m_statistics->applyChangesTime += elapsed;
+        // copies done in userspace went through the stream as well
+        m_statistics->bytesPatched += bytesPatched();
+    }
+    if (!m_buffer.has_value()) {
+        return; // the outermost scope takes care of the rest
+    }
+    if (m_fileInfo.m_container) {
+        addParsedElements(m_fileInfo.m_containerFormat, m_fileInfo.m_container->parsedElementCount() - m_initialElementCount);
+    }
+    // restore the original buffer unless it has been replaced in the meantime
+    if (m_stream.rdbuf() == &m_buffer.value()) {
+        replaceBuffer(m_stream, &m_buffer->target());
+    }
+#endif
+}
+
+/*!
+ * \brief Records \a count elements of the specified \a format which have been parsed in addition to the container's elements.
+ */
+void MediaFileInfo::StatisticsScope::addParsedElements(ContainerFormat format, std::uint64_t count)
+{
+#ifndef TAG_PARSER_NO_STATISTICS
+    if (m_statistics && count) {
+        m_statistics->parsedElements[format] += count;
+    }
+#else
+    CPP_UTILITIES_UNUSED(format);
+    CPP_UTILITIES_UNUSED(count);
+#endif
+}
+
+/*!
+ * \brief Records the bytes copied by a FileRangeCopier between taking the \a before and \a after snapshots of its statistics.
+ */
+void MediaFileInfo::StatisticsScope::addCopiedBytes(const FileRangeCopierStatistics &before, const FileRangeCopierStatistics &after)
+{
+#ifndef TAG_PARSER_NO_STATISTICS
+    if (!m_statistics) {
+        return;
+    }
+    const auto bytesCopiedByUserspace = after.bytesCopiedByUserspace - before.bytesCopiedByUserspace;
+    const auto bytesCopied = (after.bytesCloned - before.bytesCloned) + (after.bytesCopiedByKernel - before.bytesCopiedByKernel)
+        + (after.bytesCopiedDirectly - before.bytesCopiedDirectly) + bytesCopiedByUserspace;
+    m_bytesCopiedByUserspace += bytesCopiedByUserspace;
+    m_bytesCopied += bytesCopied;
+    m_statistics->bytesCopied += bytesCopied;
+    m_statistics->applyTimes[static_cast<std::size_t>(ApplyPhase::Copy)] += after.copyTime - before.copyTime;
+#else
+    CPP_UTILITIES_UNUSED(before);
+    CPP_UTILITIES_UNUSED(after);
+#endif
+}
+
+/*!
+ * \brief Returns the number of bytes written so far within the scope except for the ones copied in userspace.
+ * \remarks Only counted by the outermost scope; always zero if the library has been built without statistics.
+ */
+std::uint64_t MediaFileInfo::StatisticsScope::bytesPatched() const
+{
+#ifndef TAG_PARSER_NO_STATISTICS
+    if (!m_statistics) {
+        return 0;
+    }
+    const auto bytesWritten = m_statistics->bytesWritten - m_initialBytesWritten;
+    return bytesWritten > m_bytesCopiedByUserspace ? bytesWritten - m_bytesCopiedByUserspace : 0;
+#else
+    return 0;
+#endif
+}
+
+/*!
+ * \brief Returns the number of bytes copied so far within the scope as recorded via addCopiedBytes().
+ * \remarks Always zero if the library has been built without statistics.
+ */
+std::uint64_t MediaFileInfo::StatisticsScope::bytesCopied() const
+{
+#ifndef TAG_PARSER_NO_STATISTICS
+    return m_bytesCopied;
+#else
+    return 0;
+#endif
+}
+
+#ifndef TAG_PARSER_NO_STATISTICS
+/*!
+ * \brief Sets the buffer of the specified \a stream preserving its state.
+ * \remarks std::ios::rdbuf() clears the state which would throw if exceptions are enabled and the state was not good.
+ */
+void MediaFileInfo::StatisticsScope::replaceBuffer(std::ios &stream, std::streambuf *buffer)
+{
+    const auto state = stream.rdstate();
+    const auto exceptions = stream.exceptions();
+    stream.exceptions(ios_base::goodbit);
+    stream.rdbuf(buffer);
+    stream.clear(state);
+    try {
+        stream.exceptions(exceptions);
+    } catch (const std::ios_base::failure &) {
+        // the state was already bad before replacing the buffer; the exception has been thrown at this point
+    }
+}
+#endif
+
+/*!
+ * \brief Sets whether statistics are collected.
+ *
+ * If enabled, parsing the file and applying changes records the amount of I/O, the number of parsed elements and the
+ * time spent in each phase. The statistics can be retrieved via statistics(). See MediaFileStatistics for details.
+ *
+ * This is disabled by default because additional virtual calls are necessary for every I/O operation.
+ *
+ * \remarks
+ * - Statistics are accumulated until resetStatistics() is called or they are disabled.
+ * - If the library has been built without statistics (CMake option ENABLE_STATISTICS), this function does nothing
+ *   and statistics() always returns nullptr.
+ * - Must not be called while parsing or applying changes (e.g. from a progress callback).
+ */
+void MediaFileInfo::setStatisticsEnabled(bool enabled)
+{
+#ifndef TAG_PARSER_NO_STATISTICS
+    if (!enabled) {
+        m_statistics.reset();
+    } else if (!m_statistics) {
+        m_statistics = make_unique<MediaFileStatistics>();
+    }
+#else
+    CPP_UTILITIES_UNUSED(enabled);
+#endif
+}
+
+/*!
+ * \brief Resets the statistics collected so far (if statistics are enabled).
+ */
+void MediaFileInfo::resetStatistics()
+{
+    if (m_statistics) {
+        *m_statistics = MediaFileStatistics();
+    }
+}
+
+/*!
+ * \brief Sets whether every I/O operation done via the stream of the file is recorded in MediaFileStatistics::ioTrace.
+ *
+ * The trace contains every seek, read, write and flush with its offset, size and time. It can be saved via
+ * IoTrace::write() to replay it later against different latency models (see IoTrace::replay()), e.g. to find out why
+ * parsing a particular file is slow on a certain device.
+ *
+ * \remarks
+ * - Enabling tracing enables statistics as well (see setStatisticsEnabled()); disabling it leaves them enabled. The
+ *   trace is discarded along with the statistics (e.g. via resetStatistics()).
+ * - The trace grows with every operation, so it should only be enabled for looking into particular files.
+ * - Only the stream of the file is traced; when rewriting a file the writes to the new file are not recorded.
+ * - Must not be called while parsing or applying changes (e.g. from a progress callback).
+ */
+void MediaFileInfo::setIoTracingEnabled(bool enabled)
+{
+    if ((m_ioTracingEnabled = enabled)) {
+        setStatisticsEnabled(true);
+    }
+}
+
 /*!
  * \brief Parses the container format of the current file.
  *
@@ -143,6 +494,12 @@ MediaFileInfo::~MediaFileInfo()
  * containerFormatAbbreviation(), containerFormatSubversion(), containerMimeType(),
  * container(), mp4Container() and matroskaContainer() will return the parsed
  * information.
+ *
+ * The head of the file and the result of skipping ID3v2 tags and junk in front of the container are kept when
+ * calling clearParsingResults(). So parsing the container format again (e.g. with a different
+ * forcedContainerFormat()) does not need to read and examine the head of the file again. Both are discarded when
+ * the file info is invalidated or changes are applied.
+ *
  * \throws Throws std::ios_base::failure when an IO error occurs.
  * \throws Throws TagParser::Failure or a derived exception when a parsing
  *         error occurs.
@@ -157,20 +514,163 @@ void MediaFileInfo::parseContainerFormat(Diagnostics &diag)
 
     static const string context("parsing file header");
     open(); // ensure the file is open
+    StatisticsScope statisticsScope(*this, inputStream(), ParsePhase::ContainerFormat);
+    MEDIAINFO_CPP_TRACEPOINT_SCOPE(parse_container_format);
     m_containerFormat = ContainerFormat::Unknown;
 
     // file size
     m_paddingSize = 0;
     m_containerOffset = 0;
-    size_t bytesSkippedBeforeContainer = 0;
+
+    // determine the signature and the offset of the container skipping ID3v2 tags and junk
+    // note: The walk is only done once per file; parsing the container format again replays its result.
+    if (!m_detectionTrace.valid) {
+        detectContainerFormat();
+    }
+    m_containerFormat = m_detectionTrace.format;
+    m_containerOffset = m_detectionTrace.containerOffset;
+    m_paddingSize = m_detectionTrace.bytesSkipped;
+    m_actualId3v2TagOffsets = m_detectionTrace.id3v2TagOffsets;
+    if (m_actualId3v2TagOffsets.size() >= 2) {
+        diag.emplace_back(DiagLevel::Warning, "There is more than just one ID3v2 header at the beginning of the file.", context);
+    }
+    if (m_detectionTrace.gaveUp) {
+        m_containerParsingStatus = ParsingStatus::NotSupported;
+        return;
+    }
+    if (m_forcedContainerFormat != ContainerFormat::Unknown) {
+        m_containerFormat = m_forcedContainerFormat;
+    }
+
+    // create the container object
+    switch (m_containerFormat) {
+    case ContainerFormat::Mp4:
+    case ContainerFormat::QuickTime: {
+        // MP4/QuickTime is handled using Mp4Container instance
+        m_container = make_unique<Mp4Container>(*this, m_containerOffset);
+        m_container->setElementArenaEnabled(m_elementArenaEnabled);
+        m_container->setElementArena(std::move(m_spareElementArena));
+        m_container->setMemoryAccount(&m_memoryAccount);
+        m_container->setParseLimits(m_parseLimits);
+        adviseAccessPattern(FileAccessPattern::Random);
+        try {
+            static_cast<Mp4Container *>(m_container.get())->validateElementStructure(diag, &m_paddingSize);
+        } catch (const MemoryLimitExceededException &) {
+            addMemoryLimitMessage(diag, m_memoryAccount, context);
+            m_containerParsingStatus = ParsingStatus::CriticalFailure;
+        } catch (const Failure &) {
+            m_containerParsingStatus = ParsingStatus::CriticalFailure;
+        }
+        break;
+    }
+    case ContainerFormat::Ebml:
+    case ContainerFormat::Matroska:
+    case ContainerFormat::Webm: {
+        // EBML/Matroska is handled using MatroskaContainer instance
+        auto container = make_unique<MatroskaContainer>(*this, m_containerOffset);
+        container->setElementArenaEnabled(m_elementArenaEnabled);
+        container->setElementArena(std::move(m_spareElementArena));
+        container->setMemoryAccount(&m_memoryAccount);
+        container->setParseLimits(m_parseLimits);
+        adviseAccessPattern(FileAccessPattern::Random);
+        try {
+            container->parseHeader(diag);
+            if (container->documentType() == "matroska") {
+                m_containerFormat = ContainerFormat::Matroska;
+            } else if (container->documentType() == "webm") {
+                m_containerFormat = ContainerFormat::Webm;
+            }
+            if (m_forceFullParse) {
+                // validating the element structure of Matroska files takes too long when
+                // parsing big files so do this only when explicitely desired
+                container->validateElementStructure(diag, &m_paddingSize);
+                container->validateIndex(diag);
+            }
+        } catch (const MemoryLimitExceededException &) {
+            addMemoryLimitMessage(diag, m_memoryAccount, context);
+            m_containerParsingStatus = ParsingStatus::CriticalFailure;
+        } catch (const Failure &) {
+            m_containerParsingStatus = ParsingStatus::CriticalFailure;
+        }
+        m_container = move(container);
+        break;
+    }
+    case ContainerFormat::Ogg:
+        // Ogg is handled by OggContainer instance
+        m_container = make_unique<OggContainer>(*this, m_containerOffset);
+        m_container->setMemoryAccount(&m_memoryAccount);
+        m_container->setParseLimits(m_parseLimits);
+        static_cast<OggContainer *>(m_container.get())->setChecksumValidationEnabled(m_forceFullParse);
+        adviseAccessPattern(FileAccessPattern::Sequential);
+        break;
+    default:;
+    }
+
+    if (m_detectionTrace.bytesSkipped) {
+        diag.emplace_back(DiagLevel::Warning, argsToString(m_detectionTrace.bytesSkipped, " bytes of junk skipped"), context);
+    }
+
+    // set parsing status
+    if (m_containerParsingStatus == ParsingStatus::NotParsedYet) {
+        if (m_containerFormat == ContainerFormat::Unknown) {
+            m_containerParsingStatus = ParsingStatus::NotSupported;
+        } else {
+            m_containerParsingStatus = ParsingStatus::Ok;
+        }
+    }
+}
+
+/*!
+ * \brief Returns a pointer to \a requiredSize bytes of the file at \a offset.
+ *
+ * The bytes are read from the memory-mapped file if possible. Otherwise the head of the file (4 KiB starting at
+ * \a offset) is read into a buffer which is kept for subsequent calls (also across clearParsingResults()). So the
+ * signature, ID3v2 headers and junk are examined without a read for every step.
+ *
+ * \remarks The caller needs to ensure that the requested range is within the file.
+ */
+const char *MediaFileInfo::readHead(std::uint64_t offset, std::size_t requiredSize)
+{
+    if (isMapped()) {
+        return mappedData().data() + offset;
+    }
+    if (offset < m_headOffset || offset + requiredSize > m_headOffset + m_head.size()) {
+        m_headOffset = offset;
+        m_head.resize(static_cast<std::size_t>(min<std::uint64_t>(0x1000, size() - offset)));
+        inputStream().seekg(static_cast<streamoff>(offset), ios_base::beg);
+        inputStream().read(m_head.data(), static_cast<streamsize>(m_head.size()));
+    }
+    return m_head.data() + (offset - m_headOffset);
+}
+
+/*!
+ * \brief Discards the buffered head of the file and the result of detectContainerFormat().
+ * \remarks Called when the file info is invalidated or the file has been modified.
+ */
+void MediaFileInfo::clearHead()
+{
+    m_head.clear();
+    m_headOffset = 0;
+    m_detectionTrace.valid = false;
+}
+
+/*!
+ * \brief Determines the signature and the offset of the container skipping ID3v2 tags and junk in front of it.
+ * \remarks The result is stored as m_detectionTrace to be used by parseContainerFormat().
+ */
+void MediaFileInfo::detectContainerFormat()
+{
+    auto &trace = m_detectionTrace;
+    trace = DetectionTrace();
+    trace.valid = true;
+    auto &containerOffset = trace.containerOffset;
 
     // read signatrue
     char buff[16];
     const char *const buffEnd = buff + sizeof(buff), *buffOffset;
 startParsingSignature:
-    if (size() - containerOffset() >= 16) {
-        stream().seekg(m_containerOffset, ios_base::beg);
-        stream().read(buff, sizeof(buff));
+    if (size() - static_cast<std::uint64_t>(containerOffset) >= 16) {
+        std::memcpy(buff, readHead(static_cast<std::uint64_t>(containerOffset), sizeof(buff)), sizeof(buff));
 
         // skip zero/junk bytes
         // notes:
@@ -182,13 +682,12 @@ startParsingSignature:
             ;
         if (bytesSkipped >= 4) {
         skipJunkBytes:
-            m_containerOffset += bytesSkipped;
-            m_paddingSize += bytesSkipped;
+            containerOffset += static_cast<std::streamoff>(bytesSkipped);
 
             // give up after 0x800 bytes
-            if ((bytesSkippedBeforeContainer += bytesSkipped) >= 0x800u) {
-                m_containerParsingStatus = ParsingStatus::NotSupported;
-                m_containerFormat = ContainerFormat::Unknown;
+            if ((trace.bytesSkipped += bytesSkipped) >= 0x800u) {
+                trace.format = ContainerFormat::Unknown;
+                trace.gaveUp = true;
                 return;
             }
 
@@ -197,74 +696,31 @@ startParsingSignature:
         }
 
         // parse signature
-        switch ((m_containerFormat = parseSignature(buff, sizeof(buff)))) {
+        switch ((trace.format = parseSignature(buff, sizeof(buff)))) {
         case ContainerFormat::Id2v2Tag:
             // save position of ID3v2 tag
-            m_actualId3v2TagOffsets.push_back(m_containerOffset);
-            if (m_actualId3v2TagOffsets.size() == 2) {
-                diag.emplace_back(DiagLevel::Warning, "There is more than just one ID3v2 header at the beginning of the file.", context);
-            }
+            trace.id3v2TagOffsets.push_back(containerOffset);
 
             // read ID3v2 header
-            stream().seekg(m_containerOffset + 5, ios_base::beg);
-            stream().read(buff, 5);
+            std::memcpy(buff, readHead(static_cast<std::uint64_t>(containerOffset) + 5, 5), 5);
 
             // set the container offset to skip ID3v2 header
-            m_containerOffset += toNormalInt(BE::toUInt32(buff + 1)) + 10;
+            containerOffset += toNormalInt(BE::toUInt32(buff + 1)) + 10;
             if ((*buff) & 0x10) {
                 // footer present
-                m_containerOffset += 10;
+                containerOffset += 10;
             }
 
             // continue reading signature
             goto startParsingSignature;
 
-        case ContainerFormat::Mp4:
-        case ContainerFormat::QuickTime: {
-            // MP4/QuickTime is handled using Mp4Container instance
-            m_container = make_unique<Mp4Container>(*this, m_containerOffset);
-            try {
-                static_cast<Mp4Container *>(m_container.get())->validateElementStructure(diag, &m_paddingSize);
-            } catch (const Failure &) {
-                m_containerParsingStatus = ParsingStatus::CriticalFailure;
-            }
-            break;
-        }
-        case ContainerFormat::Ebml: {
-            // EBML/Matroska is handled using MatroskaContainer instance
-            auto container = make_unique<MatroskaContainer>(*this, m_containerOffset);
-            try {
-                container->parseHeader(diag);
-                if (container->documentType() == "matroska") {
-                    m_containerFormat = ContainerFormat::Matroska;
-                } else if (container->documentType() == "webm") {
-                    m_containerFormat = ContainerFormat::Webm;
-                }
-                if (m_forceFullParse) {
-                    // validating the element structure of Matroska files takes too long when
-                    // parsing big files so do this only when explicitely desired
-                    container->validateElementStructure(diag, &m_paddingSize);
-                    container->validateIndex(diag);
-                }
-            } catch (const Failure &) {
-                m_containerParsingStatus = ParsingStatus::CriticalFailure;
-            }
-            m_container = move(container);
-            break;
-        }
-        case ContainerFormat::Ogg:
-            // Ogg is handled by OggContainer instance
-            m_container = make_unique<OggContainer>(*this, m_containerOffset);
-            static_cast<OggContainer *>(m_container.get())->setChecksumValidationEnabled(m_forceFullParse);
-            break;
         case ContainerFormat::Unknown:
             // check for magic numbers at odd offsets
             // -> check for tar (magic number at offset 0x101)
             if (size() > 0x107) {
-                stream().seekg(0x101);
-                stream().read(buff, 6);
+                std::memcpy(buff, readHead(0x101, 6), 6);
                 if (buff[0] == 0x75 && buff[1] == 0x73 && buff[2] == 0x74 && buff[3] == 0x61 && buff[4] == 0x72 && buff[5] == 0x00) {
-                    m_containerFormat = ContainerFormat::Tar;
+                    trace.format = ContainerFormat::Tar;
                     break;
                 }
             }
@@ -276,19 +732,6 @@ startParsingSignature:
         default:;
         }
     }
-
-    if (bytesSkippedBeforeContainer) {
-        diag.emplace_back(DiagLevel::Warning, argsToString(bytesSkippedBeforeContainer, " bytes of junk skipped"), context);
-    }
-
-    // set parsing status
-    if (m_containerParsingStatus == ParsingStatus::NotParsedYet) {
-        if (m_containerFormat == ContainerFormat::Unknown) {
-            m_containerParsingStatus = ParsingStatus::NotSupported;
-        } else {
-            m_containerParsingStatus = ParsingStatus::Ok;
-        }
-    }
 }
 
 /*!
@@ -306,36 +749,54 @@ startParsingSignature:
  */
 void MediaFileInfo::parseTracks(Diagnostics &diag)
 {
-    // skip if tracks already parsed
-    if (tracksParsingStatus() != ParsingStatus::NotParsedYet) {
+    // skip if tracks already parsed or shall not be parsed at all
+    if (tracksParsingStatus() != ParsingStatus::NotParsedYet
+        || (m_parsingFlags & ParsingFlags::SkipTracks && m_containerFormat != ContainerFormat::Flac
+            && m_containerFormat != ContainerFormat::RiffWave)) {
         return;
     }
     static const string context("parsing tracks");
+    StatisticsScope statisticsScope(*this, inputStream(), ParsePhase::Tracks);
+    MEDIAINFO_CPP_TRACEPOINT_SCOPE(parse_tracks);
 
     try {
         // parse tracks via container object
         if (m_container) {
             m_container->parseTracks(diag);
             m_tracksParsingStatus = ParsingStatus::Ok;
+            markAsUnmodified(MediaFileChanges::Tracks);
             return;
         }
 
         // parse tracks via track object for "single-track"-formats
         switch (m_containerFormat) {
-        case ContainerFormat::Adts:
-            m_singleTrack = make_unique<AdtsStream>(stream(), m_containerOffset);
+        case ContainerFormat::Adts: {
+            auto track = make_unique<AdtsStream>(inputStream(), m_containerOffset);
+            track->setForwardOnly(isForwardOnly());
+            track->setTailProbe(isForwardOnly() ? nullptr : &tailProbe());
+            m_singleTrack = move(track);
             break;
+        }
         case ContainerFormat::Flac:
             m_singleTrack = make_unique<FlacStream>(*this, m_containerOffset);
             break;
-        case ContainerFormat::Ivf:
-            m_singleTrack = make_unique<IvfStream>(stream(), m_containerOffset);
+        case ContainerFormat::Ivf: {
+            auto track = make_unique<IvfStream>(inputStream(), m_containerOffset);
+            track->setFrameIndexBudget(m_ivfFrameIndexBudget);
+            m_singleTrack = move(track);
             break;
-        case ContainerFormat::MpegAudioFrames:
-            m_singleTrack = make_unique<MpegAudioFrameStream>(stream(), m_containerOffset);
+        }
+        case ContainerFormat::MpegAudioFrames: {
+            auto track = make_unique<MpegAudioFrameStream>(inputStream(), m_containerOffset);
+            track->setMaxJunkSize(m_mpegAudioMaxJunkSize);
+            track->setExactDurationEnabled(m_mpegAudioExactDurationEnabled);
+            track->setForwardOnly(isForwardOnly());
+            track->setTailProbe(isForwardOnly() ? nullptr : &tailProbe());
+            m_singleTrack = move(track);
             break;
+        }
         case ContainerFormat::RiffWave:
-            m_singleTrack = make_unique<WaveAudioStream>(stream(), m_containerOffset);
+            m_singleTrack = make_unique<WaveAudioStream>(inputStream(), m_containerOffset);
             break;
         default:
             throw NotImplementedException();
@@ -351,10 +812,14 @@ void MediaFileInfo::parseTracks(Diagnostics &diag)
         }
 
         m_tracksParsingStatus = ParsingStatus::Ok;
+        markAsUnmodified(MediaFileChanges::Tracks);
 
     } catch (const NotImplementedException &) {
         diag.emplace_back(DiagLevel::Information, "Parsing tracks is not implemented for the container format of the file.", context);
         m_tracksParsingStatus = ParsingStatus::NotSupported;
+    } catch (const MemoryLimitExceededException &) {
+        addMemoryLimitMessage(diag, m_memoryAccount, context);
+        m_tracksParsingStatus = ParsingStatus::CriticalFailure;
     } catch (const Failure &) {
         diag.emplace_back(DiagLevel::Critical, "Unable to parse tracks.", context);
         m_tracksParsingStatus = ParsingStatus::CriticalFailure;
@@ -377,18 +842,40 @@ void MediaFileInfo::parseTracks(Diagnostics &diag)
  */
 void MediaFileInfo::parseTags(Diagnostics &diag)
 {
-    // skip if tags already parsed
-    if (tagsParsingStatus() != ParsingStatus::NotParsedYet) {
+    // skip if tags already parsed or shall not be parsed at all
+    if (tagsParsingStatus() != ParsingStatus::NotParsedYet || m_parsingFlags & ParsingFlags::SkipTags) {
         return;
     }
     static const string context("parsing tag");
-
-    // check for ID3v1 tag
-    if (size() >= 128) {
+    StatisticsScope statisticsScope(*this, inputStream(), ParsePhase::Tags);
+    MEDIAINFO_CPP_TRACEPOINT_SCOPE(parse_tags);
+    m_tagsFiltered = !m_tagFieldFilter.isEmpty();
+
+    // read ID3 tags from the memory-mapped file if possible
+    // note: Not possible when loading pictures lazily because the stream is used to read pictures after returning.
+    MemoryByteSource mappedSource(mappedData());
+    ByteSourceStreamBuffer mappedBuffer(mappedSource);
+    istream mappedStream(&mappedBuffer);
+    mappedStream.exceptions(ios_base::failbit | ios_base::badbit);
+    istream &id3Stream
+        = isMapped() && !(m_parsingFlags & ParsingFlags::LazyLoadPictures) ? mappedStream : static_cast<istream &>(inputStream());
+
+    // check for ID3v1 tag (not possible without seeking to the end if the input is forward-only)
+    const auto forwardOnly = isForwardOnly();
+    if (forwardOnly) {
+        if (!m_container && m_containerFormat != ContainerFormat::RiffWave) {
+            diag.emplace_back(DiagLevel::Information,
+                "The input is forward-only so an ID3v1 tag or appended ID3v2 tag at the end of the file can not be detected.", context);
+        }
+    } else if (const auto &id3v1TagData = tailProbe().id3v1TagData; !id3v1TagData.empty()) {
+        // parse the ID3v1 tag from the bytes read when probing the end of the file
+        MemoryByteSource id3v1Source(id3v1TagData);
+        ByteSourceStreamBuffer id3v1Buffer(id3v1Source);
+        istream id3v1Stream(&id3v1Buffer);
+        id3v1Stream.exceptions(ios_base::failbit | ios_base::badbit);
         m_id3v1Tag = make_unique<Id3v1Tag>();
         try {
-            stream().seekg(-128, ios_base::end);
-            m_id3v1Tag->parse(stream(), diag);
+            m_id3v1Tag->parse(id3v1Stream, diag);
             m_actualExistingId3v1Tag = true;
         } catch (const NoDataFoundException &) {
             m_id3v1Tag.reset();
@@ -398,14 +885,35 @@ void MediaFileInfo::parseTags(Diagnostics &diag)
         }
     }
 
+    // check the size of ID3v2 tags before parsing them (see ParseLimits::maxTagSize)
+    const auto exceedsTagSizeLimit = [&, this](std::uint64_t tagSize) {
+        if (!m_parseLimits.maxTagSize || tagSize <= m_parseLimits.maxTagSize) {
+            return false;
+        }
+        m_tagsParsingStatus = ParsingStatus::CriticalFailure;
+        diag.emplace_back(DiagLevel::Critical,
+            argsToString("The size of the tag (", tagSize, ") exceeds the configured limit of ", m_parseLimits.maxTagSize, '.'), context);
+        return true;
+    };
+
     // check for ID3v2 tags: the offsets of the ID3v2 tags have already been parsed when parsing the container format
     m_id3v2Tags.clear();
     for (const auto offset : m_actualId3v2TagOffsets) {
         auto id3v2Tag = make_unique<Id3v2Tag>();
-        stream().seekg(offset, ios_base::beg);
+        if (m_parseLimits.maxTagSize && size() - static_cast<std::uint64_t>(offset) >= 10) {
+            char header[10];
+            id3Stream.seekg(offset, ios_base::beg);
+            id3Stream.read(header, 10);
+            if (BE::toUInt24(header) == 0x494433u
+                && exceedsTagSizeLimit(static_cast<std::uint64_t>(toNormalInt(BE::toUInt32(header + 6))) + ((header[5] & 0x10) ? 20 : 10))) {
+                continue;
+            }
+        }
+        id3Stream.seekg(offset, ios_base::beg);
         try {
-            id3v2Tag->parse(stream(), size() - static_cast<std::uint64_t>(offset), diag);
+            id3v2Tag->parse(id3Stream, size() - static_cast<std::uint64_t>(offset), diag, m_parsingFlags, &m_tagFieldFilter);
             m_paddingSize += id3v2Tag->paddingSize();
+            statisticsScope.addParsedElements(ContainerFormat::Id2v2Tag, id3v2Tag->fieldCount());
         } catch (const NoDataFoundException &) {
             continue;
         } catch (const Failure &) {
@@ -415,13 +923,72 @@ void MediaFileInfo::parseTags(Diagnostics &diag)
         m_id3v2Tags.emplace_back(id3v2Tag.release());
     }
 
-    // check for tags in tracks (FLAC only) or via container object
+    // check for an appended ID3v2 tag: it is located via its footer in front of the ID3v1 tag (or at the end of the file)
+    // note: The appended tag is put first because it is supposed to take precedence and to be edited. Appended tags are only
+    //       considered if there is no container object because otherwise ID3 tags are not written anyways. RIFF/WAVE files
+    //       store the ID3v2 tag within the "id3 " chunk instead.
+    m_actualAppendedId3v2TagSize = 0;
+    if (const auto tagsEnd = size() - (m_actualExistingId3v1Tag ? 128 : 0); !forwardOnly && !m_container
+        && m_containerFormat != ContainerFormat::RiffWave && tagsEnd >= static_cast<std::uint64_t>(m_containerOffset) + 20) {
+        char footer[10];
+        id3Stream.seekg(static_cast<streamoff>(tagsEnd - 10), ios_base::beg);
+        id3Stream.read(footer, 10);
+        const auto tagSize = static_cast<std::uint64_t>(toNormalInt(BE::toUInt32(footer + 6))) + 20;
+        if (BE::toUInt24(footer) == 0x334449u && footer[3] == 4 && (footer[5] & 0x10)
+            && tagSize <= tagsEnd - static_cast<std::uint64_t>(m_containerOffset) && !exceedsTagSizeLimit(tagSize)) {
+            auto id3v2Tag = make_unique<Id3v2Tag>();
+            id3Stream.seekg(static_cast<streamoff>(tagsEnd - tagSize), ios_base::beg);
+            try {
+                id3v2Tag->parse(id3Stream, tagSize, diag, m_parsingFlags, &m_tagFieldFilter);
+                statisticsScope.addParsedElements(ContainerFormat::Id2v2Tag, id3v2Tag->fieldCount());
+                m_id3v2Tags.insert(m_id3v2Tags.begin(), move(id3v2Tag));
+                m_actualAppendedId3v2TagSize = tagSize;
+            } catch (const NoDataFoundException &) {
+                m_actualAppendedId3v2TagSize = tagSize;
+            } catch (const Failure &) {
+                m_tagsParsingStatus = ParsingStatus::CriticalFailure;
+                diag.emplace_back(DiagLevel::Critical, "Unable to parse appended ID3v2 tag.", context);
+            }
+        }
+    }
+
+    // check for tags in tracks (FLAC and RIFF/WAVE only) or via container object
     try {
         if (m_containerFormat == ContainerFormat::Flac) {
             parseTracks(diag);
             if (m_tagsParsingStatus == ParsingStatus::NotParsedYet) {
                 m_tagsParsingStatus = m_tracksParsingStatus;
             }
+            markAsUnmodified(MediaFileChanges::Tags);
+            return;
+        } else if (m_containerFormat == ContainerFormat::RiffWave) {
+            // the "INFO" list is parsed along with the track; the ID3v2 tag is read from the "id3 " chunk located via the chunk index
+            // note: The tag of the "id3 " chunk is put first because it is the one to be edited (see makeWaveFile()).
+            parseTracks(diag);
+            if (const auto *const waveStream = static_cast<const WaveAudioStream *>(m_singleTrack.get())) {
+                const auto *id3Chunk = waveStream->chunk(0x69643320u); // "id3 "
+                if (!id3Chunk) {
+                    id3Chunk = waveStream->chunk(0x49443320u); // "ID3 "
+                }
+                if (id3Chunk) {
+                    auto id3v2Tag = make_unique<Id3v2Tag>();
+                    id3Stream.seekg(static_cast<streamoff>(id3Chunk->offset + 8), ios_base::beg);
+                    try {
+                        id3v2Tag->parse(id3Stream, id3Chunk->dataSize, diag, m_parsingFlags, &m_tagFieldFilter);
+                        statisticsScope.addParsedElements(ContainerFormat::Id2v2Tag, id3v2Tag->fieldCount());
+                        m_id3v2Tags.insert(m_id3v2Tags.begin(), move(id3v2Tag));
+                    } catch (const NoDataFoundException &) {
+                        diag.emplace_back(DiagLevel::Warning, "The \"id3 \" chunk does not contain an ID3v2 tag.", context);
+                    } catch (const Failure &) {
+                        m_tagsParsingStatus = ParsingStatus::CriticalFailure;
+                        diag.emplace_back(DiagLevel::Critical, "Unable to parse ID3v2 tag of \"id3 \" chunk.", context);
+                    }
+                }
+            }
+            if (m_tagsParsingStatus == ParsingStatus::NotParsedYet) {
+                m_tagsParsingStatus = m_tracksParsingStatus;
+            }
+            markAsUnmodified(MediaFileChanges::Tags);
             return;
         } else if (m_container) {
             m_container->parseTags(diag);
@@ -440,10 +1007,14 @@ void MediaFileInfo::parseTags(Diagnostics &diag)
             m_tagsParsingStatus = ParsingStatus::NotSupported;
         }
         diag.emplace_back(DiagLevel::Information, "Parsing tags is not implemented for the container format of the file.", context);
+    } catch (const MemoryLimitExceededException &) {
+        m_tagsParsingStatus = ParsingStatus::CriticalFailure;
+        addMemoryLimitMessage(diag, m_memoryAccount, context);
     } catch (const Failure &) {
         m_tagsParsingStatus = ParsingStatus::CriticalFailure;
         diag.emplace_back(DiagLevel::Critical, "Unable to parse tag.", context);
     }
+    markAsUnmodified(MediaFileChanges::Tags);
 }
 
 /*!
@@ -459,11 +1030,13 @@ void MediaFileInfo::parseTags(Diagnostics &diag)
  */
 void MediaFileInfo::parseChapters(Diagnostics &diag)
 {
-    // skip if chapters already parsed
-    if (chaptersParsingStatus() != ParsingStatus::NotParsedYet) {
+    // skip if chapters already parsed or shall not be parsed at all
+    if (chaptersParsingStatus() != ParsingStatus::NotParsedYet || m_parsingFlags & ParsingFlags::SkipChapters) {
         return;
     }
     static const string context("parsing chapters");
+    StatisticsScope statisticsScope(*this, inputStream(), ParsePhase::Chapters);
+    MEDIAINFO_CPP_TRACEPOINT_SCOPE(parse_chapters);
 
     try {
         // parse chapters via container object
@@ -475,6 +1048,9 @@ void MediaFileInfo::parseChapters(Diagnostics &diag)
     } catch (const NotImplementedException &) {
         m_chaptersParsingStatus = ParsingStatus::NotSupported;
         diag.emplace_back(DiagLevel::Information, "Parsing chapters is not implemented for the container format of the file.", context);
+    } catch (const MemoryLimitExceededException &) {
+        m_chaptersParsingStatus = ParsingStatus::CriticalFailure;
+        addMemoryLimitMessage(diag, m_memoryAccount, context);
     } catch (const Failure &) {
         m_chaptersParsingStatus = ParsingStatus::CriticalFailure;
         diag.emplace_back(DiagLevel::Critical, "Unable to parse chapters.", context);
@@ -494,11 +1070,13 @@ void MediaFileInfo::parseChapters(Diagnostics &diag)
  */
 void MediaFileInfo::parseAttachments(Diagnostics &diag)
 {
-    // skip if attachments already parsed
-    if (attachmentsParsingStatus() != ParsingStatus::NotParsedYet) {
+    // skip if attachments already parsed or shall not be parsed at all
+    if (attachmentsParsingStatus() != ParsingStatus::NotParsedYet || m_parsingFlags & ParsingFlags::SkipAttachments) {
         return;
     }
     static const string context("parsing attachments");
+    StatisticsScope statisticsScope(*this, inputStream(), ParsePhase::Attachments);
+    MEDIAINFO_CPP_TRACEPOINT_SCOPE(parse_attachments);
 
     try {
         // parse attachments via container object
@@ -507,9 +1085,13 @@ void MediaFileInfo::parseAttachments(Diagnostics &diag)
         }
         m_container->parseAttachments(diag);
         m_attachmentsParsingStatus = ParsingStatus::Ok;
+        markAsUnmodified(MediaFileChanges::Attachments);
     } catch (const NotImplementedException &) {
         m_attachmentsParsingStatus = ParsingStatus::NotSupported;
         diag.emplace_back(DiagLevel::Information, "Parsing attachments is not implemented for the container format of the file.", context);
+    } catch (const MemoryLimitExceededException &) {
+        m_attachmentsParsingStatus = ParsingStatus::CriticalFailure;
+        addMemoryLimitMessage(diag, m_memoryAccount, context);
     } catch (const Failure &) {
         m_attachmentsParsingStatus = ParsingStatus::CriticalFailure;
         diag.emplace_back(DiagLevel::Critical, "Unable to parse attachments.", context);
@@ -531,6 +1113,151 @@ void MediaFileInfo::parseEverything(Diagnostics &diag)
     parseAttachments(diag);
 }
 
+/*!
+ * \brief Continues parsing after data has been appended to the file, e.g. by a recording or a download still in progress.
+ * \returns Returns whether the file has grown (or shrunk) since it has been parsed.
+ *
+ * The size of the file is determined again and reported via reportSizeChanged(). For Ogg, MP4 and Matroska files the
+ * parsing results are kept and only the appended data is parsed (see AbstractContainer::resumeParsing()): the page
+ * table and the element tree are extended so the appended pages, movie fragments or clusters are covered and the
+ * durations of Ogg streams are updated. Otherwise (and if the appended data changes the structure, e.g. the "moov"-atom
+ * or the "Tags"-element written at the end of a recording) the file is parsed from scratch: the parsing results are
+ * cleared and everything which had been parsed before is parsed again.
+ *
+ * \remarks
+ * - Only appended data is taken into account when resuming. If the file has been modified in-place (e.g. the duration
+ *   is written into the header when a recording is finished), call clearParsingResults() and parse the file again.
+ * - A memory-mapping of the file is kept and only covers the previous size; the appended data is read via the stream.
+ * - Pointers to tags and tracks stay valid unless the file is parsed from scratch.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ * \throws Throws Failure or a derived exception when a parsing error occurs.
+ */
+bool MediaFileInfo::resumeParsing(Diagnostics &diag)
+{
+    static const string context("resuming parsing");
+    const auto previousSize = size();
+    auto newSize = previousSize;
+    if (hasByteSource()) {
+        newSize = byteSource()->size();
+    } else {
+        stream().clear();
+        stream().seekg(0, ios_base::end);
+        newSize = static_cast<std::uint64_t>(stream().tellg());
+    }
+    if (newSize == previousSize) {
+        return false;
+    }
+    reportSizeChanged(newSize);
+    if (m_containerParsingStatus == ParsingStatus::NotParsedYet) {
+        return true;
+    }
+    if (newSize > previousSize && m_containerParsingStatus == ParsingStatus::Ok && m_container && m_container->resumeParsing(diag)) {
+        diag.emplace_back(DiagLevel::Information,
+            argsToString("Parsing has been resumed at ", previousSize, " to take ", newSize - previousSize, " appended bytes into account."), context);
+        return true;
+    }
+
+    // parse from scratch what has been parsed before
+    diag.emplace_back(DiagLevel::Information, "The file has changed in a way parsing can not be resumed; parsing it from scratch.", context);
+    const auto tracksParsed = m_tracksParsingStatus != ParsingStatus::NotParsedYet;
+    const auto tagsParsed = m_tagsParsingStatus != ParsingStatus::NotParsedYet;
+    const auto chaptersParsed = m_chaptersParsingStatus != ParsingStatus::NotParsedYet;
+    const auto attachmentsParsed = m_attachmentsParsingStatus != ParsingStatus::NotParsedYet;
+    clearHead();
+    clearParsingResults();
+    parseContainerFormat(diag);
+    if (tracksParsed) {
+        parseTracks(diag);
+    }
+    if (tagsParsed) {
+        parseTags(diag);
+    }
+    if (chaptersParsed) {
+        parseChapters(diag);
+    }
+    if (attachmentsParsed) {
+        parseAttachments(diag);
+    }
+    return true;
+}
+
+/*!
+ * \brief Parses the container format and the tags and returns the values of the tags as flat, immutable list.
+ * \param maxDataSize Specifies the maximum size of values which data is copied into the list (see TagFieldList::fromTags()).
+ * \param namePool Specifies the pool to intern the textual IDs of the fields in (see TagFieldList::fromTags()).
+ *
+ * This is meant for consumers which only read tags, e.g. to index a library. Tracks, chapters and attachments are not
+ * parsed by this function. The returned list does not refer to the tag objects, the file or the parse buffer. So
+ * the file can be closed (or the object be reset to parse the next file) right away.
+ *
+ * \remarks
+ * - Specify ParsingFlags::ReadTagsOnly via setParsingFlags() to avoid copying values and loading cover art while
+ *   parsing the tags.
+ * - The tags are parsed via parseTags() so they are still available via tags() afterwards.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ * \throws Throws TagParser::Failure or a derived exception when a parsing error occurs.
+ */
+std::shared_ptr<const TagFieldList> MediaFileInfo::parseTagFields(Diagnostics &diag, std::size_t maxDataSize, StringPool *namePool)
+{
+    parseContainerFormat(diag);
+    parseTags(diag);
+    return TagFieldList::fromTags(tags(), maxDataSize, namePool);
+}
+
+/*!
+ * \brief Parses the container format and computes the hash of the media payload of the file.
+ * \param parallelism Specifies the number of threads used to hash large files (see MediaPayloadHasher); zero means the
+ *                    number of hardware threads is used.
+ *
+ * Only the data of the tracks is hashed but not the tags and other meta-data. So files which only differ in their tags
+ * get the same hash which is useful to find duplicates within a library. The file is read only once:
+ * - MP4: the "mdat"-atoms
+ * - Matroska/WebM: the "SimpleBlock"- and "BlockGroup"-elements within the "Cluster"-elements
+ * - Ogg: the pages following the header packets of each stream (see OggContainer::hashMediaPayload())
+ * - FLAC: the frames following the metadata blocks
+ * - RIFF/WAVE: the "data"-chunk
+ * - MPEG-1 audio, ADTS and IVF: the data between the tags at the beginning and at the end of the file (ID3v2, ID3v1,
+ *   APEv2 and Lyrics3 tags)
+ *
+ * \remarks The hash is only comparable with hashes of files of the same container format (e.g. a FLAC file within an Ogg
+ *          container does not have the same hash as the raw FLAC file).
+ * \throws Throws TagParser::NotImplementedException if the container format is not supported.
+ * \throws Throws TagParser::Failure or a derived exception when a parsing error occurs.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+MediaPayloadHash MediaFileInfo::hashMediaPayload(Diagnostics &diag, AbortableProgressFeedback &progress, unsigned int parallelism)
+{
+    parseContainerFormat(diag);
+    progress.nextStepOrStop("Hashing media payload ...");
+    auto hasher = MediaPayloadHasher(parallelism);
+    if (m_container) {
+        m_container->hashMediaPayload(hasher, diag, progress);
+        return hasher.finish();
+    }
+    switch (m_containerFormat) {
+    case ContainerFormat::Flac:
+    case ContainerFormat::RiffWave:
+        parseTracks(diag);
+        if (!m_singleTrack) {
+            throw InvalidDataException();
+        }
+        if (m_containerFormat == ContainerFormat::Flac) {
+            hasher.addRange(inputStream(), static_cast<FlacStream *>(m_singleTrack.get())->streamOffset(), tailProbe().audioEndOffset);
+        } else if (const auto *const dataChunk = static_cast<WaveAudioStream *>(m_singleTrack.get())->chunk(0x64617461)) {
+            hasher.addRange(inputStream(), dataChunk->offset + 8, min(dataChunk->offset + 8 + dataChunk->dataSize, size()));
+        }
+        break;
+    case ContainerFormat::Adts:
+    case ContainerFormat::Ivf:
+    case ContainerFormat::MpegAudioFrames:
+        hasher.addRange(inputStream(), m_containerOffset, tailProbe().audioEndOffset);
+        break;
+    default:
+        throw NotImplementedException();
+    }
+    return hasher.finish();
+}
+
 /*!
  * \brief Ensures appropriate tags are created according the given \a settings.
  * \return Returns whether appropriate tags could be created for the file.
@@ -591,6 +1318,7 @@ bool MediaFileInfo::createAppropriateTags(const TagCreationSettings &settings)
             switch (containerFormat()) {
             case ContainerFormat::Adts:
             case ContainerFormat::MpegAudioFrames:
+            case ContainerFormat::RiffWave:
             case ContainerFormat::WavPack:
                 break;
             default:
@@ -627,15 +1355,15 @@ bool MediaFileInfo::createAppropriateTags(const TagCreationSettings &settings)
     if (settings.id3v1usage == TagUsage::Never && hasId3v1Tag()) {
         // transfer tags to ID3v2 tag before removing
         if ((flags & TagCreationFlags::Id3TransferValuesOnRemoval) && hasId3v2Tag()) {
-            id3v2Tags().front()->insertValues(*id3v1Tag(), false);
+            id3v2Tags().front()->insertValues(std::move(*id3v1Tag()), false);
         }
         removeId3v1Tag();
     }
     if (settings.id3v2usage == TagUsage::Never) {
         if ((flags & TagCreationFlags::Id3TransferValuesOnRemoval) && hasId3v1Tag()) {
-            // transfer tags to ID3v1 tag before removing
+            // transfer tags to ID3v1 tag before removing (moving the values as the ID3v2 tags are discarded anyways)
             for (const auto &tag : id3v2Tags()) {
-                id3v1Tag()->insertValues(*tag, false);
+                id3v1Tag()->insertValues(std::move(*tag), false);
             }
         }
         removeAllId3v2Tags();
@@ -672,26 +1400,29 @@ void MediaFileInfo::applyChanges(Diagnostics &diag, AbortableProgressFeedback &p
 {
     static const string context("making file");
     diag.emplace_back(DiagLevel::Information, "Changes are about to be applied.", context);
-    bool previousParsingSuccessful = true;
-    switch (tagsParsingStatus()) {
-    case ParsingStatus::Ok:
-    case ParsingStatus::NotSupported:
-        break;
-    default:
-        previousParsingSuccessful = false;
-        diag.emplace_back(DiagLevel::Critical, "Tags have to be parsed without critical errors before changes can be applied.", context);
-    }
-    switch (tracksParsingStatus()) {
-    case ParsingStatus::Ok:
-    case ParsingStatus::NotSupported:
-        break;
-    default:
-        previousParsingSuccessful = false;
-        diag.emplace_back(DiagLevel::Critical, "Tracks have to be parsed without critical errors before changes can be applied.", context);
+    m_applyChangesResult = ApplyChangesResult();
+    m_applyChangesResult.containerFormat = m_containerFormat;
+    m_applyChangesResult.fileSizeBefore = m_applyChangesResult.fileSizeAfter = size();
+    validateChanges(diag, context);
+    if (m_skipUnmodified && !m_forceRewrite && m_saveFilePath.empty() && !isModified()) {
+        diag.emplace_back(DiagLevel::Information, "Nothing has been modified; the file is left untouched.", context);
+        return;
     }
-    if (!previousParsingSuccessful) {
-        throw InvalidDataException();
+    m_applyChangesResult.backupCreated = m_saveFilePath.empty();
+    // determine the cache entry as long as the parsing results are available (they are cleared when applying changes)
+    auto cachedResult = m_parseResultCache ? std::make_optional(CachedParseResult::fromFileInfo(*this)) : std::nullopt;
+    // read cover art which has been skipped when parsing (see ParsingFlags::LazyLoadPictures) as long as the original file is available
+    for (const auto *const tag : tags()) {
+        for (const auto *const value : tag->values(KnownField::Cover)) {
+            value->loadData();
+        }
     }
+    const auto paddingSettingsRestorer = PaddingSettingsRestorer(m_minPadding, m_maxPadding, m_preferredPadding);
+    applyPaddingPolicy(diag, progress, true);
+    // the file is going to be modified/replaced so the memory-mapping must not be used anymore
+    unmapFile();
+    StatisticsScope statisticsScope(*this, stream());
+    MEDIAINFO_CPP_TRACEPOINT_SCOPE(apply_changes);
     if (m_container) { // container object takes care
         // ID3 tags can not be applied in this case -> add warnings if ID3 tags have been assigned
         if (hasId3v1Tag()) {
@@ -702,24 +1433,509 @@ void MediaFileInfo::applyChanges(Diagnostics &diag, AbortableProgressFeedback &p
         }
         m_tracksParsingStatus = ParsingStatus::NotParsedYet;
         m_tagsParsingStatus = ParsingStatus::NotParsedYet;
+        // the memory limit only applies to parsing; the parsing results are discarded afterwards anyway
+        m_container->setMemoryAccount(nullptr);
         try {
+            const auto copierStatistics = m_container->rangeCopier().statistics();
             m_container->makeFile(diag, progress);
+            statisticsScope.addCopiedBytes(copierStatistics, m_container->rangeCopier().statistics());
+            // take over the layout chosen by the container; the remaining fields are determined here
+            const auto &containerResult = m_container->applyChangesResult();
+            m_applyChangesResult.strategy = containerResult.strategy;
+            m_applyChangesResult.paddingBefore = containerResult.paddingBefore;
+            m_applyChangesResult.paddingAfter = containerResult.paddingAfter;
+            m_applyChangesResult.backupCopied = containerResult.backupCopied;
         } catch (...) {
             // since the file might be messed up, invalidate the parsing results
+            clearHead();
             clearParsingResults();
             throw;
         }
     } else { // implementation if no container object is present
-        // assume the file is a MP3 file
+        // assume the file is a MP3 file unless it is a RIFF/WAVE file
         try {
-            makeMp3File(diag, progress);
+            if (m_containerFormat == ContainerFormat::RiffWave && m_singleTrack) {
+                makeWaveFile(diag, progress, &statisticsScope);
+            } else {
+                makeMp3File(diag, progress, &statisticsScope);
+            }
         } catch (...) {
             // since the file might be messed up, invalidate the parsing results
+            clearHead();
             clearParsingResults();
             throw;
         }
     }
-    clearParsingResults();
+    clearHead();
+    clearParsingResults();
+    syncToDisk(diag);
+    m_applyChangesResult.fileSizeAfter = size();
+    m_applyChangesResult.bytesPatched = statisticsScope.bytesPatched();
+    m_applyChangesResult.bytesCopied = statisticsScope.bytesCopied();
+    m_applyChangesResult.backupCreated = m_applyChangesResult.backupCreated && m_applyChangesResult.strategy == ApplyChangesStrategy::Rewrite;
+    // update the cache without parsing the file again
+    if (cachedResult) {
+        try {
+            m_parseResultCache->store(path(), m_parseResultCache->identify(path()), *cachedResult);
+        } catch (const std::ios_base::failure &failure) {
+            m_parseResultCache->remove(path());
+            diag.emplace_back(DiagLevel::Warning, argsToString("Unable to update the parse result cache: ", failure.what()), context);
+        }
+    }
+}
+
+/*!
+ * \brief Predicts how applyChanges() would modify the file without writing anything.
+ *
+ * The layout of the new file is calculated like applyChanges() does it so the returned result tells the strategy which
+ * would be chosen, the size of the new file, the padding, the number of bytes which would be copied and whether a backup
+ * file would be created. This allows deferring expensive rewrites (e.g. to off-peak hours) while applying cheap in-place
+ * changes right away.
+ *
+ * 
+emarks
+ * - The same preconditions as for applyChanges() apply and the same exceptions are thrown. In particular a
+ *   RewriteRequiredException is thrown if rewriting would be necessary but applying changes in-place is enforced.
+ * - The parsing results are kept (so applyChanges() can be called afterwards) and applyChangesResult() is not altered.
+ * - The number of bytes which would be patched is not predicted. The size of Ogg files is assumed unchanged.
+ */
+ApplyChangesResult MediaFileInfo::planChanges(Diagnostics &diag, AbortableProgressFeedback &progress)
+{
+    static const string context("planning changes");
+    // use the member as scratch space so the makers don't need to distinguish; keep the result of the last applyChanges()
+    auto plan = ApplyChangesResult();
+    std::swap(plan, m_applyChangesResult);
+    try {
+        m_applyChangesResult.containerFormat = m_containerFormat;
+        m_applyChangesResult.fileSizeBefore = m_applyChangesResult.fileSizeAfter = size();
+        validateChanges(diag, context);
+        if (!m_skipUnmodified || m_forceRewrite || !m_saveFilePath.empty() || isModified()) {
+            // read cover art which has been skipped when parsing as its size is required to compute the layout
+            for (const auto *const tag : tags()) {
+                for (const auto *const value : tag->values(KnownField::Cover)) {
+                    value->loadData();
+                }
+            }
+            const auto paddingSettingsRestorer = PaddingSettingsRestorer(m_minPadding, m_maxPadding, m_preferredPadding);
+            applyPaddingPolicy(diag, progress, false);
+            if (m_container) {
+                const auto containerPlan = m_container->planFile(diag, progress);
+                m_applyChangesResult.strategy = containerPlan.strategy;
+                m_applyChangesResult.fileSizeAfter = containerPlan.fileSizeAfter;
+                m_applyChangesResult.paddingBefore = containerPlan.paddingBefore;
+                m_applyChangesResult.paddingAfter = containerPlan.paddingAfter;
+                m_applyChangesResult.bytesCopied = containerPlan.bytesCopied;
+            } else if (m_containerFormat == ContainerFormat::RiffWave && m_singleTrack) {
+                makeWaveFile(diag, progress, nullptr);
+            } else {
+                makeMp3File(diag, progress, nullptr);
+            }
+            m_applyChangesResult.backupCreated = m_saveFilePath.empty() && m_applyChangesResult.strategy == ApplyChangesStrategy::Rewrite;
+        }
+    } catch (...) {
+        std::swap(plan, m_applyChangesResult);
+        throw;
+    }
+    std::swap(plan, m_applyChangesResult);
+    return plan;
+}
+
+/*!
+ * \brief Returns a view of the file as applyChanges() would write it without writing anything.
+ *
+ * The returned VirtualFile consists of the new header (the ID3v2 tags, the FLAC metadata and a Xing frame if
+ * enabled), the range of the original file containing the media data and the new ID3v1 tag. The ranges of the
+ * original file can be sent as-is (e.g. via sendfile() or splice()) so tags can be injected when serving files
+ * without copying the media data or modifying the file on disk.
+ *
+ * \remarks
+ * - The same preconditions regarding parsing as for applyChanges() apply. In contrast to applyChanges(), the file might
+ *   have been opened via a byte source as only the parsing results are used. The ranges refer to that source then.
+ * - No padding is included and the settings regarding the tag position, rewriting and the save file path are ignored.
+ * - Only MP3, FLAC, ADTS and other files which might have ID3 tags are supported. No offsets need to be patched for
+ *   these formats because the Xing frame and the FLAC seek table are relative to the first frame.
+ * \throws Throws InvalidDataException if the tags or tracks have not been parsed successfully and NotImplementedException
+ *         if the format is not supported or the tags have been parsed with a field filter.
+ */
+VirtualFile MediaFileInfo::makeVirtualFile(Diagnostics &diag)
+{
+    static const string context("making virtual file");
+    auto previousParsingSuccessful = true;
+    for (const auto status : { tagsParsingStatus(), tracksParsingStatus() }) {
+        if (status != ParsingStatus::Ok && status != ParsingStatus::NotSupported) {
+            previousParsingSuccessful = false;
+        }
+    }
+    if (!previousParsingSuccessful) {
+        diag.emplace_back(DiagLevel::Critical, "Tags and tracks have to be parsed without critical errors before making a virtual file.", context);
+        throw InvalidDataException();
+    }
+    if (m_tagsFiltered) {
+        diag.emplace_back(DiagLevel::Critical, "A virtual file can not be made because tags have been parsed with a field filter.", context);
+        throw NotImplementedException();
+    }
+    if (m_container || m_containerFormat == ContainerFormat::RiffWave) {
+        diag.emplace_back(DiagLevel::Critical,
+            argsToString("Making a virtual file is not supported for the format ", containerFormatName(), " as it would require patching offsets."),
+            context);
+        throw NotImplementedException();
+    }
+
+    // make the ID3v2 tags, the FLAC metadata and the Xing frame like makeMp3File() does (just without padding)
+    auto header = stringstream(ios_base::in | ios_base::out | ios_base::binary);
+    header.exceptions(ios_base::badbit | ios_base::failbit);
+    for (auto &tag : m_id3v2Tags) {
+        try {
+            tag->prepareMaking(diag).make(header, 0, diag);
+        } catch (const Failure &) {
+        }
+    }
+    auto *const flacStream = m_containerFormat == ContainerFormat::Flac ? static_cast<FlacStream *>(m_singleTrack.get()) : nullptr;
+    auto streamOffset = m_containerOffset;
+    if (flacStream) {
+        auto flacSeekTable = std::string();
+        if (!m_flacSeekPointInterval.isNull() && !flacStream->hasSeekTable()) {
+            try {
+                flacSeekTable = flacStream->makeSeekTable(m_flacSeekPointInterval, diag);
+            } catch (const Failure &) {
+                diag.emplace_back(DiagLevel::Warning, "Unable to make FLAC seek table; no seek table will be added.", context);
+            }
+        }
+        flacStream->makeHeader(header, diag, flacSeekTable);
+        streamOffset = flacStream->streamOffset();
+    }
+    if (m_mpegAudioSeekTableWritingEnabled && m_containerFormat == ContainerFormat::MpegAudioFrames && m_singleTrack) {
+        try {
+            const auto xingFrame = static_cast<MpegAudioFrameStream *>(m_singleTrack.get())->makeXingFrame(diag);
+            header.write(xingFrame.data(), static_cast<streamsize>(xingFrame.size()));
+        } catch (const Failure &) {
+            diag.emplace_back(DiagLevel::Warning, "Unable to make Xing frame; no seek table will be added.", context);
+        }
+    }
+
+    // determine media data (excluding an appended ID3v2 tag and the ID3v1 tag)
+    auto mediaDataSize = size() - streamOffset - m_actualAppendedId3v2TagSize;
+    if (m_actualExistingId3v1Tag) {
+        mediaDataSize -= 128;
+    }
+
+    auto file = VirtualFile();
+    file.appendData(header.str());
+    file.appendFileRange(streamOffset, mediaDataSize);
+    if (m_id3v1Tag) {
+        auto id3v1Tag = stringstream(ios_base::in | ios_base::out | ios_base::binary);
+        id3v1Tag.exceptions(ios_base::badbit | ios_base::failbit);
+        try {
+            m_id3v1Tag->make(id3v1Tag, diag);
+            file.appendData(id3v1Tag.str());
+        } catch (const Failure &) {
+            diag.emplace_back(DiagLevel::Warning, "Unable to make ID3v1 tag.", context);
+        }
+    }
+    return file;
+}
+
+/*!
+ * \brief Writes the file with the changes applied strictly forward to the specified \a output.
+ *
+ * In contrast to applyChanges() with a save file path (see setSaveFilePath()), every size and offset is computed before
+ * it is written so nothing needs to be patched afterwards and the \a output does not need to be seekable. This allows
+ * writing re-tagged files straight into pipes, sockets or uploads to object stores. The file itself is not modified.
+ *
+ * \remarks
+ * - The same preconditions as for applyChanges() apply. The new file is always written as if rewriting is forced.
+ * - The sizes and offsets within the "SeekHead"- and "Cues"-elements of Matroska files and the chunk offsets of MP4
+ *   files are computed upfront. The "moov"-atom of MP4 files is held back in memory until its size is known. CRC-32
+ *   checksums of Matroska segments are omitted as they could only be computed after writing the segment.
+ * - MP3, FLAC and ADTS files are written as described by makeVirtualFile() (so no padding is added).
+ * - Ogg and RIFF/WAVE files as well as fragmented MP4 files and MP4 files whose tracks have been altered are not
+ *   supported.
+ * - The parsing results are kept and applyChangesResult() is not altered.
+ * - A new SeeklessOutputStream must be used for each file as the offsets are determined via its position.
+ * \throws Throws the same exceptions as applyChanges() and TagParser::NotImplementedException if writing the file to
+ *         a seekless output is not supported.
+ */
+void MediaFileInfo::writeChanges(SeeklessOutputStream &output, Diagnostics &diag, AbortableProgressFeedback &progress)
+{
+    static const string context("writing changes to seekless output");
+    validateChanges(diag, context);
+    if (m_forceInPlace) {
+        diag.emplace_back(
+            DiagLevel::Critical, "Changes can not be written to a seekless output when applying changes in-place is enforced.", context);
+        throw RewriteRequiredException();
+    }
+    // read cover art which has been skipped when parsing (see ParsingFlags::LazyLoadPictures)
+    for (const auto *const tag : tags()) {
+        for (const auto *const value : tag->values(KnownField::Cover)) {
+            value->loadData();
+        }
+    }
+    // ensure the original file can be read without invalidating the parsing results (as open() would do)
+    if (!isOpen()) {
+        stream().open(BasicFileInfo::pathForOpen(path()), ios_base::in | ios_base::binary);
+    }
+    const auto paddingSettingsRestorer = PaddingSettingsRestorer(m_minPadding, m_maxPadding, m_preferredPadding);
+    applyPaddingPolicy(diag, progress, false);
+    if (m_container) {
+        m_container->writeFile(output, diag, progress);
+    } else {
+        progress.updateStep("Writing file ...");
+        makeVirtualFile(diag).write(stream(), output);
+    }
+    output.flush();
+}
+
+/*!
+ * \brief Replaces the padding settings with the ones determined by the padding policy (if one has been set).
+ *
+ * If \a updateHint is set and the policy stores a hint, the hint is incremented in case the file is going to be
+ * rewritten; then the padding is determined again for the incremented number of rewrites. The hint is not stored
+ * within Ogg files as these are always rewritten.
+ *
+ * \remarks The caller is responsible for restoring the padding settings afterwards (see PaddingSettingsRestorer).
+ */
+void MediaFileInfo::applyPaddingPolicy(Diagnostics &diag, AbortableProgressFeedback &progress, bool updateHint)
+{
+    if (!m_paddingPolicy) {
+        return;
+    }
+    const auto settings = PaddingSettings{ m_minPadding, m_maxPadding, m_preferredPadding };
+    auto input = PaddingPolicyInput();
+    auto *hintTag = static_cast<Tag *>(nullptr);
+    input.containerFormat = m_containerFormat;
+    input.fileSize = size();
+    for (auto *const tag : tags()) {
+        input.oldTagSize += tag->size();
+        input.newTagSize += PaddingPolicy::requiredSize(*tag);
+        if (!PaddingPolicy::supportsHint(*tag)) {
+            continue;
+        }
+        input.rewriteCount = max(input.rewriteCount, PaddingPolicy::readHint(*tag));
+        if (!hintTag) {
+            hintTag = tag;
+        }
+    }
+    const auto applySettings = [this](const PaddingSettings &padding) {
+        m_minPadding = padding.minPadding;
+        m_maxPadding = padding.maxPadding;
+        m_preferredPadding = padding.preferredPadding;
+    };
+    applySettings(m_paddingPolicy->determinePadding(input, settings));
+    if (!updateHint || !hintTag || !m_paddingPolicy->storesHint() || m_containerFormat == ContainerFormat::Ogg) {
+        return;
+    }
+    if (planChanges(diag, progress).strategy != ApplyChangesStrategy::Rewrite) {
+        return;
+    }
+    PaddingPolicy::writeHint(*hintTag, ++input.rewriteCount);
+    applySettings(m_paddingPolicy->determinePadding(input, settings));
+}
+
+/*!
+ * \brief Checks whether changes can be applied; used by applyChanges() and planChanges().
+ * \throws Throws a Failure (see applyChanges()) if changes can not be applied.
+ */
+void MediaFileInfo::validateChanges(Diagnostics &diag, const std::string &context) const
+{
+    bool previousParsingSuccessful = true;
+    switch (tagsParsingStatus()) {
+    case ParsingStatus::Ok:
+    case ParsingStatus::NotSupported:
+        break;
+    default:
+        previousParsingSuccessful = false;
+        diag.emplace_back(DiagLevel::Critical, "Tags have to be parsed without critical errors before changes can be applied.", context);
+    }
+    switch (tracksParsingStatus()) {
+    case ParsingStatus::Ok:
+    case ParsingStatus::NotSupported:
+        break;
+    default:
+        previousParsingSuccessful = false;
+        diag.emplace_back(DiagLevel::Critical, "Tracks have to be parsed without critical errors before changes can be applied.", context);
+    }
+    if (!previousParsingSuccessful) {
+        throw InvalidDataException();
+    }
+    if (m_tagsFiltered) {
+        diag.emplace_back(DiagLevel::Critical, "Changes can not be applied because tags have been parsed with a field filter.", context);
+        throw NotImplementedException();
+    }
+    if (hasByteSource()) {
+        diag.emplace_back(DiagLevel::Critical, "Changes can not be applied when reading from a byte source.", context);
+        throw NotImplementedException();
+    }
+    if (m_forceInPlace && !m_saveFilePath.empty()) {
+        diag.emplace_back(DiagLevel::Critical, "Changes can not be applied in-place when a save file path has been set.", context);
+        throw RewriteRequiredException();
+    }
+}
+
+/*!
+ * \brief Moves the "moov"-atom of an MP4 file in front of the media data so the file can be played while being downloaded.
+ *
+ * This is equivalent to calling applyChanges() with the tag position set to ElementPosition::BeforeData and
+ * forceTagPosition() enabled. The previous settings are restored afterwards. If there is enough padding in front of the
+ * media data the atom is moved in-place; otherwise the file is rewritten. The chunk offset tables are computed for the
+ * new layout while writing the "moov"-atom so it is written only once.
+ *
+ * \throws Throws the same exceptions as applyChanges() and TagParser::NotImplementedException if the file is not an
+ *         MP4 file.
+ * \remarks Tags and tracks need to be parsed without errors before this method can be called (see applyChanges()).
+ */
+void MediaFileInfo::makeFaststart(Diagnostics &diag, AbortableProgressFeedback &progress)
+{
+    if (m_containerFormat != ContainerFormat::Mp4 && m_containerFormat != ContainerFormat::QuickTime) {
+        diag.emplace_back(DiagLevel::Critical, "Relocating the index in front of the media data is only supported for MP4 files.", "making file");
+        throw NotImplementedException();
+    }
+    const auto tagPosition = m_tagPosition;
+    const auto forceTagPosition = m_forceTagPosition;
+    const auto skipUnmodified = m_skipUnmodified;
+    m_tagPosition = ElementPosition::BeforeData;
+    m_forceTagPosition = true;
+    m_skipUnmodified = false;
+    try {
+        applyChanges(diag, progress);
+    } catch (...) {
+        m_tagPosition = tagPosition;
+        m_forceTagPosition = forceTagPosition;
+        m_skipUnmodified = skipUnmodified;
+        throw;
+    }
+    m_tagPosition = tagPosition;
+    m_forceTagPosition = forceTagPosition;
+    m_skipUnmodified = skipUnmodified;
+}
+
+/*!
+ * \brief Returns which parts of the file have been modified since they have been parsed.
+ *
+ * The tags, tracks and attachments track modifications made via their setters themselves (see e.g. Tag::isModified()).
+ * Additionally, adding or removing tags, tracks or attachments and changing the title of the container is considered.
+ *
+ * \remarks
+ * - Setting a value which is identical to the present value is not considered a modification.
+ * - The chapters can not be modified via the API so they are not considered.
+ * \sa isModified(), markAsUnmodified(), setSkipUnmodified()
+ */
+MediaFileChanges MediaFileInfo::changes() const
+{
+    auto changes = MediaFileChanges::None;
+    if (m_structureModified || (m_container && m_container->isModified())) {
+        changes |= MediaFileChanges::Structure;
+    }
+    for (const auto *const tag : tags()) {
+        if (tag->isModified()) {
+            changes |= MediaFileChanges::Tags;
+            break;
+        }
+    }
+    for (const auto *const track : tracks()) {
+        if (track->isModified()) {
+            changes |= MediaFileChanges::Tracks;
+            break;
+        }
+    }
+    for (const auto *const attachment : attachments()) {
+        if (attachment->isModified()) {
+            changes |= MediaFileChanges::Attachments;
+            break;
+        }
+    }
+    return changes;
+}
+
+/*!
+ * \brief Marks the specified parts of the file as unmodified.
+ *
+ * This is done automatically when the parts are parsed. It might be useful to call this function after making changes
+ * which are not supposed to be applied (unless further changes are made) when applying changes with
+ * setSkipUnmodified() enabled.
+ *
+ * \sa changes()
+ */
+void MediaFileInfo::markAsUnmodified(MediaFileChanges changes)
+{
+    if (changes & MediaFileChanges::Structure) {
+        m_structureModified = false;
+        if (m_container) {
+            m_container->setModified(false);
+        }
+    }
+    if (changes & MediaFileChanges::Tags) {
+        for (auto *const tag : tags()) {
+            tag->setModified(false);
+        }
+    }
+    if (changes & MediaFileChanges::Tracks) {
+        for (auto *const track : tracks()) {
+            track->setModified(false);
+        }
+    }
+    if (changes & MediaFileChanges::Attachments) {
+        for (auto *const attachment : attachments()) {
+            attachment->setModified(false);
+        }
+    }
+}
+
+/*!
+ * \brief Ensures data written to the file has reached the disk according to the durabilityPolicy().
+ * \remarks Only dirty pages are written so when changes have been applied in-place only the overwritten range is
+ *          affected.
+ */
+void MediaFileInfo::syncToDisk(Diagnostics &diag)
+{
+#ifdef PLATFORM_UNIX
+    static const string context("syncing file");
+    auto policy = m_durabilityPolicy;
+    if (policy == DurabilityPolicy::Default) {
+        policy = m_forceInPlace ? DurabilityPolicy::DataSync : DurabilityPolicy::None;
+    }
+    if (policy == DurabilityPolicy::None) {
+        return;
+    }
+    const auto syncTimer = ApplyPhaseTimer(m_statistics.get(), ApplyPhase::Sync);
+    if (isOpen()) {
+        stream().flush();
+    }
+    const auto fileDescriptor = ::open(BasicFileInfo::pathForOpen(path()), O_WRONLY);
+    if (fileDescriptor < 0) {
+        diag.emplace_back(DiagLevel::Warning, "Unable to open the file for syncing it to the disk.", context);
+        return;
+    }
+    auto res = 0;
+    switch (policy) {
+#ifdef PLATFORM_LINUX
+    case DurabilityPolicy::WrittenRanges:
+        // a size of zero means up to the end of the file; only dirty pages are written anyway
+        res = ::sync_file_range(fileDescriptor, 0, 0, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+        break;
+    case DurabilityPolicy::DataSync:
+        res = ::fdatasync(fileDescriptor);
+        break;
+#endif
+    case DurabilityPolicy::FullSync:
+        res = ::fsync(fileDescriptor);
+        break;
+    default:
+#ifdef PLATFORM_LINUX
+        res = ::fdatasync(fileDescriptor);
+#else
+        res = ::fsync(fileDescriptor);
+#endif
+    }
+    if (res != 0) {
+        diag.emplace_back(DiagLevel::Warning, "Unable to sync the file to the disk.", context);
+    }
+    ::close(fileDescriptor);
+    if (policy == DurabilityPolicy::FullSync && !BackupHelper::syncDirectory(path())) {
+        diag.emplace_back(DiagLevel::Warning, "Unable to sync the directory containing the file to the disk.", context);
+    }
+#else
+    CPP_UTILITIES_UNUSED(diag);
+#endif
 }
 
 /*!
@@ -837,6 +2053,50 @@ vector<AbstractTrack *> MediaFileInfo::tracks() const
     return res;
 }
 
+/*!
+ * \brief Invokes the specified \a callback for all tracks of the current file in the order tracks() returns them.
+ * \remarks In contrast to tracks() no list is allocated.
+ */
+void MediaFileInfo::forEachTrack(FunctionRef<void(AbstractTrack &track)> callback) const
+{
+    if (m_singleTrack) {
+        callback(*m_singleTrack);
+    }
+    if (m_container) {
+        for (size_t i = 0, count = m_container->trackCount(); i != count; ++i) {
+            callback(*m_container->track(i));
+        }
+    }
+}
+
+/*!
+ * \brief Appends the properties of all tracks to the specified \a columns.
+ * \param fileIndex Specifies the value for the TrackColumns::fileIndex column, e.g. the index of the file within a batch.
+ * \returns Returns the number of appended rows.
+ *
+ * This is the columnar counterpart of tracks(): the properties are written directly into the buffers of \a columns,
+ * without building a list of tracks or copying strings into temporary objects. parseTracks() needs to be called
+ * before. Otherwise nothing is appended.
+ *
+ * \sa BatchParser::scanTrackColumns()
+ */
+std::size_t MediaFileInfo::exportTrackColumns(TrackColumns &columns, std::uint32_t fileIndex) const
+{
+    auto rowCount = std::size_t();
+    if (m_singleTrack) {
+        columns.append(*m_singleTrack, fileIndex);
+        ++rowCount;
+    }
+    if (m_container) {
+        const auto containerTrackCount = m_container->trackCount();
+        for (size_t i = 0; i != containerTrackCount; ++i) {
+            columns.append(*m_container->track(i), fileIndex);
+        }
+        rowCount += containerTrackCount;
+    }
+    return rowCount;
+}
+
 /*!
  * \brief Returns an indication whether the current file has tracks of the specified \a type.
  *
@@ -930,6 +2190,39 @@ unordered_set<string> MediaFileInfo::availableLanguages(MediaType type) const
     return res;
 }
 
+/*!
+ * \brief Determines the IDs of the available languages for specified media type (by default MediaType::Audio).
+ *
+ * This is like availableLanguages() but returns the IDs of the languages specified via ISO-639-2 code as sorted vector
+ * without duplicates. Languages which are not known (or not specified via ISO-639-2 code) are not considered. No strings
+ * are copied so this is preferable when computing the languages of many files, e.g. via an array indexed by
+ * LocaleId::index. Use LocaleId::isoCode() or LocaleId::name() to display the languages.
+ *
+ * \sa parseTracks()
+ */
+std::vector<LocaleId> MediaFileInfo::availableLanguageIds(MediaType type) const
+{
+    auto ids = std::vector<LocaleId>();
+    const auto addTrack = [&ids, type](const AbstractTrack &track) {
+        if (type != MediaType::Unknown && track.mediaType() != type) {
+            return;
+        }
+        if (const auto id = track.locale().id(); id.isValid()) {
+            if (const auto i = lower_bound(ids.begin(), ids.end(), id); i == ids.end() || *i != id) {
+                ids.insert(i, id);
+            }
+        }
+    };
+    if (m_container) {
+        for (size_t i = 0, count = m_container->trackCount(); i != count; ++i) {
+            addTrack(*m_container->track(i));
+        }
+    } else if (m_singleTrack) {
+        addTrack(*m_singleTrack);
+    }
+    return ids;
+}
+
 /*!
  * \brief Generates a short technical summary about the file's tracks.
  *
@@ -939,10 +2232,15 @@ unordered_set<string> MediaFileInfo::availableLanguages(MediaType type) const
  * Example (exact format might change in the future!):
  * "H.264-720p / HE-AAC-6ch-eng / HE-AAC-2ch-ger / SRT-eng / SRT-ger"
  *
+ * If statistics are enabled (see setStatisticsEnabled()), the times spent in the phases of parsing and applying changes
+ * as well as the amount of I/O are appended for debugging (see MediaFileStatistics::summary()), separated by " | ".
+ * This is also the case when the tracks are not available (anymore), e.g. after applying changes.
+ *
  * \sa parseTracks()
  */
 string MediaFileInfo::technicalSummary() const
 {
+    auto summary = string();
     if (m_container) {
         const size_t trackCount = m_container->trackCount();
         vector<string> parts;
@@ -953,11 +2251,14 @@ string MediaFileInfo::technicalSummary() const
                 parts.emplace_back(move(description));
             }
         }
-        return joinStrings(parts, " / ");
+        summary = joinStrings(parts, " / ");
     } else if (m_singleTrack) {
-        return m_singleTrack->description();
+        summary = m_singleTrack->description();
+    }
+    if (m_statistics) {
+        summary += argsToString(summary.empty() ? "" : " | ", m_statistics->summary());
     }
-    return string();
+    return summary;
 }
 
 /*!
@@ -976,7 +2277,7 @@ bool MediaFileInfo::removeId3v1Tag()
     }
     if (m_id3v1Tag) {
         m_id3v1Tag.reset();
-        return true;
+        return m_structureModified = true;
     }
     return false;
 }
@@ -1025,7 +2326,7 @@ bool MediaFileInfo::removeId3v2Tag(Id3v2Tag *tag)
     for (auto i = m_id3v2Tags.begin(), end = m_id3v2Tags.end(); i != end; ++i) {
         if (i->get() == tag) {
             m_id3v2Tags.erase(i);
-            return true;
+            return m_structureModified = true;
         }
     }
     return false;
@@ -1045,7 +2346,7 @@ bool MediaFileInfo::removeAllId3v2Tags()
         return false;
     }
     m_id3v2Tags.clear();
-    return true;
+    return m_structureModified = true;
 }
 
 /*!
@@ -1098,20 +2399,26 @@ bool MediaFileInfo::removeTag(Tag *tag)
     // remove tag via track for "single-track" formats
     if (m_singleTrack && m_containerFormat == ContainerFormat::Flac) {
         auto *const flacStream(static_cast<FlacStream *>(m_singleTrack.get()));
-        if (flacStream->vorbisComment() == tag) {
-            return flacStream->removeVorbisComment();
+        if (flacStream->vorbisComment() == tag && flacStream->removeVorbisComment()) {
+            return m_structureModified = true;
+        }
+    }
+    if (m_singleTrack && m_containerFormat == ContainerFormat::RiffWave) {
+        auto *const waveStream(static_cast<WaveAudioStream *>(m_singleTrack.get()));
+        if (waveStream->infoTag() == tag && waveStream->removeInfoTag()) {
+            return m_structureModified = true;
         }
     }
 
     // remove ID3 tags
     if (m_id3v1Tag.get() == tag) {
         m_id3v1Tag.reset();
-        return true;
+        return m_structureModified = true;
     }
     for (auto i = m_id3v2Tags.begin(), end = m_id3v2Tags.end(); i != end; ++i) {
         if (i->get() == tag) {
             m_id3v2Tags.erase(i);
-            return true;
+            return m_structureModified = true;
         }
     }
     return false;
@@ -1129,8 +2436,12 @@ void MediaFileInfo::removeAllTags()
         m_container->removeAllTags();
     }
     if (m_singleTrack && m_containerFormat == ContainerFormat::Flac) {
-        static_cast<FlacStream *>(m_singleTrack.get())->removeVorbisComment();
+        m_structureModified = static_cast<FlacStream *>(m_singleTrack.get())->removeVorbisComment() || m_structureModified;
+    }
+    if (m_singleTrack && m_containerFormat == ContainerFormat::RiffWave) {
+        m_structureModified = static_cast<WaveAudioStream *>(m_singleTrack.get())->removeInfoTag() || m_structureModified;
     }
+    m_structureModified = m_structureModified || m_id3v1Tag || !m_id3v2Tags.empty();
     m_id3v1Tag.reset();
     m_id3v2Tags.clear();
 }
@@ -1146,6 +2457,8 @@ bool MediaFileInfo::areChaptersSupported() const
     switch (m_containerFormat) {
     case ContainerFormat::Matroska:
     case ContainerFormat::Webm:
+    case ContainerFormat::Mp4:
+    case ContainerFormat::QuickTime:
         return true;
     default:
         return false;
@@ -1202,6 +2515,7 @@ bool MediaFileInfo::areTagsSupported() const
     case ContainerFormat::MpegAudioFrames:
     case ContainerFormat::Mp4:
     case ContainerFormat::Ogg:
+    case ContainerFormat::RiffWave:
     case ContainerFormat::WavPack:
     case ContainerFormat::Webm:
         // these container formats are supported
@@ -1274,6 +2588,19 @@ vector<AbstractChapter *> MediaFileInfo::chapters() const
     return res;
 }
 
+/*!
+ * \brief Invokes the specified \a callback for all chapters assigned to the current file.
+ * \remarks In contrast to chapters() no list is allocated.
+ */
+void MediaFileInfo::forEachChapter(FunctionRef<void(AbstractChapter &chapter)> callback) const
+{
+    if (m_container) {
+        for (size_t i = 0, count = m_container->chapterCount(); i != count; ++i) {
+            callback(*m_container->chapter(i));
+        }
+    }
+}
+
 /*!
  * \brief Returns all attachments assigned to the current file.
  * \remarks The MediaFileInfo keeps the ownership over the object which will be destroyed when the
@@ -1292,6 +2619,19 @@ vector<AbstractAttachment *> MediaFileInfo::attachments() const
     return res;
 }
 
+/*!
+ * \brief Invokes the specified \a callback for all attachments assigned to the current file.
+ * \remarks In contrast to attachments() no list is allocated.
+ */
+void MediaFileInfo::forEachAttachment(FunctionRef<void(AbstractAttachment &attachment)> callback) const
+{
+    if (m_container) {
+        for (size_t i = 0, count = m_container->attachmentCount(); i != count; ++i) {
+            callback(*m_container->attachment(i));
+        }
+    }
+}
+
 /*!
  * \brief Clears all parsing results and assigned/created/changed information such as
  *        detected container format, tracks, tags, ...
@@ -1316,11 +2656,50 @@ void MediaFileInfo::clearParsingResults()
     m_id3v1Tag.reset();
     m_id3v2Tags.clear();
     m_actualId3v2TagOffsets.clear();
+    m_actualAppendedId3v2TagSize = 0;
     m_actualExistingId3v1Tag = false;
-    m_container.reset();
+    m_tailProbe = TailProbe();
+    m_structureModified = false;
+    m_memoryAccount.reset();
+    if (m_container) {
+        // keep the arena (which must outlive the elements) to re-use its blocks next time a container is created
+        auto arena = m_container->takeElementArena();
+        m_container.reset();
+        if (arena) {
+            arena->rewind();
+            m_spareElementArena = std::move(arena);
+        }
+    }
     m_singleTrack.reset();
 }
 
+/*!
+ * \brief Resets the object to parse the file with the specified \a path from scratch.
+ *
+ * In contrast to constructing a new MediaFileInfo this keeps the settings (e.g. the parsing flags, the padding
+ * settings and whether the element arena is enabled) as well as allocated memory which can be re-used for the next
+ * file. So a worker parsing many files one after another can use the same object for all of them:
+ * - The blocks of the element arena are retained (if enabled via setElementArenaEnabled()) so the element trees of
+ *   subsequent MP4 and Matroska files are allocated without growing the heap.
+ * - The buffers for the head of the file and the ID3v2 tags keep their capacity.
+ * - A Diagnostics object used by the worker can be re-used in the same way by calling clear() on it.
+ *
+ * Per-file state is discarded: the file is closed, a byte source is unset, the parsing results and statistics are
+ * cleared and the save file path is unset.
+ */
+void MediaFileInfo::reset(const std::string &path)
+{
+    if (hasByteSource()) {
+        setByteSource(nullptr);
+    }
+    close();
+    invalidated();
+    reportPathChanged(path);
+    m_saveFilePath.clear();
+    m_tagsFiltered = false;
+    resetStatistics();
+}
+
 /*!
  * \brief Merges the assigned ID3v2 tags into a single ID3v2 tag.
  *
@@ -1349,9 +2728,10 @@ void MediaFileInfo::mergeId3v2Tags()
         return;
     }
     for (auto i = isecond; i != end; ++i) {
-        first.insertFields(**i, false);
+        first.insertFields(std::move(**i), false);
     }
-    m_id3v2Tags.erase(isecond, end - 1);
+    m_id3v2Tags.erase(isecond, end);
+    m_structureModified = true;
 }
 
 /*!
@@ -1444,8 +2824,8 @@ bool MediaFileInfo::removeVorbisComment()
         }
         break;
     case ContainerFormat::Flac:
-        if (m_singleTrack) {
-            return static_cast<FlacStream *>(m_singleTrack.get())->removeVorbisComment();
+        if (m_singleTrack && static_cast<FlacStream *>(m_singleTrack.get())->removeVorbisComment()) {
+            return m_structureModified = true;
         }
         break;
     default:;
@@ -1462,32 +2842,94 @@ bool MediaFileInfo::removeVorbisComment()
  *          destroyed when the MediaFileInfo is invalidated.
  */
 void MediaFileInfo::tags(vector<Tag *> &tags) const
+{
+    forEachTag([&tags](Tag &tag) { tags.push_back(&tag); });
+}
+
+/*!
+ * \brief Invokes the specified \a callback for all tags assigned to the current file in the order tags() returns them.
+ * \remarks In contrast to tags() no list is allocated.
+ */
+void MediaFileInfo::forEachTag(FunctionRef<void(Tag &tag)> callback) const
 {
     if (hasId3v1Tag()) {
-        tags.push_back(m_id3v1Tag.get());
+        callback(*m_id3v1Tag);
     }
     for (const unique_ptr<Id3v2Tag> &tag : m_id3v2Tags) {
-        tags.push_back(tag.get());
+        callback(*tag);
     }
     if (m_containerFormat == ContainerFormat::Flac && m_singleTrack) {
         if (auto *const vorbisComment = static_cast<const FlacStream *>(m_singleTrack.get())->vorbisComment()) {
-            tags.push_back(vorbisComment);
+            callback(*vorbisComment);
+        }
+    }
+    if (m_containerFormat == ContainerFormat::RiffWave && m_singleTrack) {
+        if (auto *const infoTag = static_cast<const WaveAudioStream *>(m_singleTrack.get())->infoTag()) {
+            callback(*infoTag);
         }
     }
     if (m_container) {
         for (size_t i = 0, count = m_container->tagCount(); i < count; ++i) {
-            tags.push_back(m_container->tag(i));
+            callback(*m_container->tag(i));
         }
     }
 }
 
+/*!
+ * \brief Invokes the specified \a callback for each value of all fields of all tags assigned to the current file.
+ * \param maxDataSize Specifies the maximum size of values which data is assigned to the records.
+ *
+ * The records are the same as in the TagFieldList created by TagFieldList::fromTags() for the tags returned by
+ * tags() (TagFieldRecord::tagIndex refers to these tags). However, no list is created and the names and values of the
+ * records point into the tags so nothing is copied or allocated.
+ *
+ * \remarks Values which have been assigned lazily are loaded unless they exceed \a maxDataSize.
+ * \throws Throws std::ios_base::failure when an IO error occurs when loading data.
+ */
+void MediaFileInfo::forEachField(FunctionRef<void(Tag &tag, const TagFieldRecord &record)> callback, std::size_t maxDataSize) const
+{
+    auto tagIndex = std::uint32_t();
+    forEachTag([&](Tag &tag) {
+        TagFieldList::forEachRecord(
+            tag, [&](const TagFieldRecord &record) { callback(tag, record); }, maxDataSize, tagIndex++);
+    });
+}
+
 /*!
  * \brief Returns an indication whether a tag of any format is assigned.
  */
 bool MediaFileInfo::hasAnyTag() const
 {
     return hasId3v1Tag() || hasId3v2Tag() || (m_container && m_container->tagCount())
-        || (m_containerFormat == ContainerFormat::Flac && static_cast<FlacStream *>(m_singleTrack.get())->vorbisComment());
+        || (m_containerFormat == ContainerFormat::Flac && static_cast<FlacStream *>(m_singleTrack.get())->vorbisComment())
+        || (m_containerFormat == ContainerFormat::RiffWave && m_singleTrack && static_cast<WaveAudioStream *>(m_singleTrack.get())->infoTag());
+}
+
+/*!
+ * \brief Returns the tags located at the end of the file (ID3v1, APEv2 and Lyrics3) and where the audio data ends.
+ *
+ * The end of the file is probed only once (reading at most TailProbe::maxSize bytes) and the result is shared by parseTags()
+ * and the tracks of "single-track"-formats which need to know where the audio data ends. The probe is redone after the
+ * size of the file has changed and when the parsing results are cleared.
+ *
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ * \remarks Returns a not probed TailProbe if the input is forward-only because the end of the file can not be read then.
+ */
+const TailProbe &MediaFileInfo::tailProbe()
+{
+    if (isForwardOnly() || (m_tailProbe.probed && m_tailProbe.fileSize == size())) {
+        return m_tailProbe;
+    }
+    if (isMapped()) {
+        MemoryByteSource mappedSource(mappedData());
+        ByteSourceStreamBuffer mappedBuffer(mappedSource);
+        istream mappedStream(&mappedBuffer);
+        mappedStream.exceptions(ios_base::failbit | ios_base::badbit);
+        m_tailProbe.probe(mappedStream);
+    } else {
+        m_tailProbe.probe(inputStream());
+    }
+    return m_tailProbe;
 }
 
 /*!
@@ -1509,19 +2951,34 @@ vector<Tag *> MediaFileInfo::tags() const
 void MediaFileInfo::invalidated()
 {
     BasicFileInfo::invalidated();
+    clearHead();
     clearParsingResults();
 }
 
 /*!
  * \brief Internally used to save chanings of MP3/FLAC files and any other files which might have ID3 tags.
+ * \remarks Only the layout is calculated (see planChanges()) if \a statisticsScope is nullptr.
  */
-void MediaFileInfo::makeMp3File(Diagnostics &diag, AbortableProgressFeedback &progress)
+void MediaFileInfo::makeMp3File(Diagnostics &diag, AbortableProgressFeedback &progress, StatisticsScope *statisticsScope)
 {
     static const string context("making MP3/FLAC file");
+    auto layoutTimer = ApplyPhaseTimer(statistics(), ApplyPhase::Layout);
+
+    // make a Xing frame if a seek table shall be added to MPEG audio files lacking one
+    auto xingFrame = std::string();
+    if (m_mpegAudioSeekTableWritingEnabled && m_containerFormat == ContainerFormat::MpegAudioFrames && m_singleTrack) {
+        progress.updateStep("Making Xing frame ...");
+        try {
+            xingFrame = static_cast<MpegAudioFrameStream *>(m_singleTrack.get())->makeXingFrame(diag);
+        } catch (const Failure &) {
+            diag.emplace_back(DiagLevel::Warning, "Unable to make Xing frame; no seek table will be added.", context);
+        }
+    }
 
     // don't rewrite the complete file if there are no ID3v2/FLAC tags present or to be written
-    if (!isForcingRewrite() && m_id3v2Tags.empty() && m_actualId3v2TagOffsets.empty() && m_saveFilePath.empty()
-        && m_containerFormat != ContainerFormat::Flac) {
+    const auto forceRewrite = isForcingRewrite() && !isForcingInPlace();
+    if (!forceRewrite && m_id3v2Tags.empty() && m_actualId3v2TagOffsets.empty() && !m_actualAppendedId3v2TagSize && m_saveFilePath.empty()
+        && m_containerFormat != ContainerFormat::Flac && xingFrame.empty()) {
         // alter ID3v1 tag
         if (!m_id3v1Tag) {
             // remove ID3v1 tag
@@ -1529,6 +2986,11 @@ void MediaFileInfo::makeMp3File(Diagnostics &diag, AbortableProgressFeedback &pr
                 diag.emplace_back(DiagLevel::Information, "Nothing to be changed.", context);
                 return;
             }
+            m_applyChangesResult.setLayout(false, m_paddingSize, m_paddingSize);
+            if (!statisticsScope) {
+                m_applyChangesResult.fileSizeAfter = size() - 128;
+                return;
+            }
             progress.updateStep("Removing ID3v1 tag ...");
             stream().close();
             if (truncate(BasicFileInfo::pathForOpen(path()), static_cast<std::streamoff>(size() - 128)) == 0) {
@@ -1540,6 +3002,11 @@ void MediaFileInfo::makeMp3File(Diagnostics &diag, AbortableProgressFeedback &pr
             return;
         } else {
             // add or update ID3v1 tag
+            m_applyChangesResult.setLayout(false, m_paddingSize, m_paddingSize);
+            if (!statisticsScope) {
+                m_applyChangesResult.fileSizeAfter = size() + (m_actualExistingId3v1Tag ? 0 : 128);
+                return;
+            }
             if (m_actualExistingId3v1Tag) {
                 progress.updateStep("Updating existing ID3v1 tag ...");
                 // ensure the file is still open / not readonly
@@ -1583,6 +3050,18 @@ void MediaFileInfo::makeMp3File(Diagnostics &diag, AbortableProgressFeedback &pr
         }
     }
 
+    // make a seek table if one shall be added to FLAC files lacking one
+    auto flacSeekTable = std::string();
+    if (flacStream && !m_flacSeekPointInterval.isNull() && !flacStream->hasSeekTable()) {
+        progress.updateStep("Making FLAC seek table ...");
+        try {
+            flacSeekTable = flacStream->makeSeekTable(m_flacSeekPointInterval, diag);
+        } catch (const Failure &) {
+            diag.emplace_back(DiagLevel::Warning, "Unable to make FLAC seek table; no seek table will be added.", context);
+        }
+        progress.updateStep("Updating FLAC tags ...");
+    }
+
     // determine stream offset and make track/format specific metadata
     std::uint32_t streamOffset; // where the actual stream starts
     stringstream flacMetaData(ios_base::in | ios_base::out | ios_base::binary);
@@ -1590,7 +3069,7 @@ void MediaFileInfo::makeMp3File(Diagnostics &diag, AbortableProgressFeedback &pr
     std::streamoff startOfLastMetaDataBlock;
     if (flacStream) {
         // if it is a raw FLAC stream, make FLAC metadata
-        startOfLastMetaDataBlock = flacStream->makeHeader(flacMetaData, diag);
+        startOfLastMetaDataBlock = flacStream->makeHeader(flacMetaData, diag, flacSeekTable);
         tagsSize += flacMetaData.tellp();
         streamOffset = flacStream->streamOffset();
     } else {
@@ -1598,15 +3077,21 @@ void MediaFileInfo::makeMp3File(Diagnostics &diag, AbortableProgressFeedback &pr
         streamOffset = static_cast<std::uint32_t>(m_containerOffset);
     }
 
+    // determine media data size (excluding an appended ID3v2 tag and the ID3v1 tag)
+    std::uint64_t mediaDataSize = size() - streamOffset - m_actualAppendedId3v2TagSize;
+    if (m_actualExistingId3v1Tag) {
+        mediaDataSize -= 128;
+    }
+
     // check whether rewrite is required
-    bool rewriteRequired = isForcingRewrite() || !m_saveFilePath.empty() || (tagsSize > streamOffset);
+    bool rewriteRequired = forceRewrite || !m_saveFilePath.empty() || (tagsSize > streamOffset) || !xingFrame.empty();
     size_t padding = 0;
     if (!rewriteRequired) {
         // rewriting is not forced and new tag is not too big for available space
         // -> calculate new padding
         padding = streamOffset - tagsSize;
-        // -> check whether the new padding matches specifications
-        if (padding < minPadding() || padding > maxPadding()) {
+        // -> check whether the new padding matches specifications (not relevant when in-place update is enforced)
+        if (!isForcingInPlace() && (padding < minPadding() || padding > maxPadding())) {
             rewriteRequired = true;
         }
     }
@@ -1628,24 +3113,128 @@ void MediaFileInfo::makeMp3File(Diagnostics &diag, AbortableProgressFeedback &pr
         padding = preferredPadding();
         rewriteRequired = true;
     }
+
+    // check whether the ID3v2 tag can be appended to the file so the MPEG audio frames don't need to be moved
+    // note: This is only possible for a single ID3v2.4 tag (the footer is only supported by that version) and when
+    //       modifying the file in-place. Makers of further tags without fields are dropped when appending.
+    Id3v2TagMaker *appendedMaker = nullptr;
+    if (!flacStream && m_containerFormat == ContainerFormat::MpegAudioFrames && !forceRewrite && m_saveFilePath.empty() && xingFrame.empty()) {
+        for (auto &maker : makers) {
+            if (!maker.tag().fieldCount()) {
+                continue;
+            }
+            if (appendedMaker) {
+                appendedMaker = nullptr;
+                break;
+            }
+            appendedMaker = &maker;
+        }
+        if (appendedMaker && appendedMaker->tag().majorVersion() != 4) {
+            appendedMaker = nullptr;
+        }
+    }
+    const auto appendTag = appendedMaker
+        && (m_tagPosition == ElementPosition::AfterData || (m_tagPosition == ElementPosition::Keep && m_actualAppendedId3v2TagSize)
+            || (rewriteRequired && !m_forceTagPosition));
+    if (appendTag) {
+        // the space in front of the MPEG audio frames is just filled with a padding-only tag (see below)
+        rewriteRequired = false;
+        padding = 0;
+    }
     if (rewriteRequired && flacStream && makers.empty() && padding) {
         // the first 4 byte of FLAC padding actually don't count because these
         // can not be used for additional meta data
         padding += 4;
     }
+    if (rewriteRequired && isForcingInPlace()) {
+        diag.emplace_back(DiagLevel::Critical, "The file would need to be rewritten but applying changes in-place is enforced.", context);
+        throw RewriteRequiredException();
+    }
+    // shift the frames by whole file system blocks instead of rewriting the file if enabled (not when only planning)
+    // note: The tags are made anew in front of the shifted frames so the inserted blocks are overwritten with padding. The
+    //       bytes in front of the frames are saved to a journal beforehand so the original file can be restored on failure.
+    auto blocksShifted = false;
+    auto originalStreamOffset = streamOffset;
+    string backupPath, journalPath;
+    if (rewriteRequired && statisticsScope && m_blockShiftingEnabled && !forceRewrite && m_saveFilePath.empty() && xingFrame.empty()
+        && m_backupStrategy != BackupStrategy::Journal && (!makers.empty() || flacStream)) {
+        // -> padding of 1, 2 and 3 byte isn't possible when it needs to go into the FLAC "PADDING" block
+        const auto minPadding = makers.empty() ? max<size_t>(preferredPadding(), 4) : preferredPadding();
+        auto journalCreated = false;
+        if (static_cast<std::uint64_t>(tagsSize) + minPadding <= numeric_limits<std::int32_t>::max()) {
+            try {
+                BackupHelper::createJournal(
+                    backupDirectory(), path(), journalPath, stream(), size(), { { streamOffset, streamOffset + mediaDataSize } });
+                journalCreated = true;
+            } catch (const std::ios_base::failure &failure) {
+                diag.emplace_back(DiagLevel::Warning, argsToString("Not shifting the frames: ", failure.what()), context);
+            }
+        }
+        if (journalCreated) {
+            const auto newStreamOffset = FileRangeCopier::shiftData(path(), streamOffset, tagsSize + minPadding);
+            if (newStreamOffset == streamOffset) {
+                std::remove(BasicFileInfo::pathForOpen(journalPath));
+                journalPath.clear();
+            } else {
+                diag.emplace_back(DiagLevel::Information,
+                    argsToString("Shifted the frames from offset ", streamOffset, " to ", newStreamOffset, " instead of rewriting the file."),
+                    context);
+                reportSizeChanged(size() + newStreamOffset - streamOffset);
+                streamOffset = static_cast<std::uint32_t>(newStreamOffset);
+                padding = streamOffset - tagsSize;
+                rewriteRequired = false;
+                blocksShifted = true;
+            }
+        }
+    }
+    // determine where the padding goes within a FLAC file
+    // note: Padding is written as "PADDING" block which absorbs the size difference so the FLAC frames don't need to be
+    //       moved. Only padding of 1 to 3 bytes (which can not be expressed as "PADDING" block) goes into the ID3v2 tag.
+    const auto flacPadding = flacStream && (makers.empty() || padding >= 4) ? padding : size_t();
+    if (flacStream && !rewriteRequired) {
+        diag.emplace_back(DiagLevel::Information,
+            argsToString("Updating FLAC metadata in-place; the padding changes from ", flacStream->paddingSize(), " to ", padding, " bytes."), context);
+    }
+    m_applyChangesResult.setLayout(rewriteRequired, m_paddingSize, appendTag ? streamOffset : padding);
+    if (blocksShifted) {
+        m_applyChangesResult.strategy = ApplyChangesStrategy::BlockShift;
+    }
+    if (!statisticsScope) {
+        // only planning the changes: the new file consists of the tags and padding (or the space in front of the frames if
+        // kept), the Xing frame, the frames, the appended ID3v2 tag and the ID3v1 tag
+        m_applyChangesResult.fileSizeAfter = (rewriteRequired ? tagsSize + padding + xingFrame.size() : streamOffset) + mediaDataSize
+            + (appendTag ? appendedMaker->requiredSize() : 0) + (m_id3v1Tag ? 128 : 0);
+        m_applyChangesResult.bytesCopied = rewriteRequired ? mediaDataSize : 0;
+        return;
+    }
+    layoutTimer.stop();
     progress.updateStep(rewriteRequired ? "Preparing streams for rewriting ..." : "Preparing streams for updating ...");
 
     // setup stream(s) for writing
     // -> define variables needed to handle output stream and backup stream (required when rewriting the file)
-    string backupPath;
     NativeFileStream &outputStream = stream();
     NativeFileStream backupStream; // create a stream to open the backup/original file for the case rewriting the file is required
+    BackupHelper::TemporaryFile temporaryFile; // the new file replacing the original file when using BackupStrategy::TemporaryFile
 
     if (rewriteRequired) {
-        if (m_saveFilePath.empty()) {
+        if (m_saveFilePath.empty() && m_backupStrategy == BackupStrategy::TemporaryFile && temporaryFile.create(path())) {
+            // keep the original file untouched as backupStream and write the new file into the temporary file replacing it when done
+            try {
+                close();
+                backupStream.exceptions(ios_base::badbit | ios_base::failbit);
+                backupStream.open(BasicFileInfo::pathForOpen(path()), ios_base::in | ios_base::binary);
+                outputStream.open(BasicFileInfo::pathForOpen(temporaryFile.path()), ios_base::out | ios_base::binary | ios_base::trunc);
+            } catch (const std::ios_base::failure &failure) {
+                diag.emplace_back(DiagLevel::Critical, argsToString("Opening streams to write output file failed: ", failure.what()), context);
+                throw;
+            }
+        } else if (m_saveFilePath.empty()) {
             // move current file to temp dir and reopen it as backupStream, recreate original file
             try {
-                BackupHelper::createBackupFile(backupDirectory(), path(), backupPath, outputStream, backupStream);
+                auto backupTimer = ApplyPhaseTimer(statistics(), ApplyPhase::Backup);
+                m_applyChangesResult.backupCopied = BackupHelper::createBackupFile(
+                    backupDirectory(), path(), backupPath, outputStream, backupStream, m_backupStrategy, m_durabilityPolicy);
+                backupTimer.stop();
                 // recreate original file, define buffer variables
                 outputStream.open(BasicFileInfo::pathForOpen(path()), ios_base::out | ios_base::binary | ios_base::trunc);
             } catch (const std::ios_base::failure &failure) {
@@ -1673,8 +3262,29 @@ void MediaFileInfo::makeMp3File(Diagnostics &diag, AbortableProgressFeedback &pr
             outputStream.open(BasicFileInfo::pathForOpen(path()), ios_base::in | ios_base::out | ios_base::binary);
         } catch (const std::ios_base::failure &failure) {
             diag.emplace_back(DiagLevel::Critical, argsToString("Opening the file with write permissions failed: ", failure.what()), context);
+            if (blocksShifted && BackupHelper::undoDataShift(path(), streamOffset, originalStreamOffset, outputStream, diag, context)) {
+                reportSizeChanged(size() + originalStreamOffset - streamOffset);
+                try {
+                    BackupHelper::restoreOriginalFileFromJournal(path(), journalPath, outputStream);
+                } catch (const std::ios_base::failure &restoreFailure) {
+                    diag.emplace_back(DiagLevel::Critical, restoreFailure.what(), context);
+                }
+            }
             throw;
         }
+        // save everything but the media data (and the ID3v1 tag) to the journal
+        if (m_backupStrategy == BackupStrategy::Journal) {
+            try {
+                BackupHelper::createJournal(
+                    backupDirectory(), path(), journalPath, outputStream, size(), { { streamOffset, streamOffset + mediaDataSize } });
+            } catch (const std::ios_base::failure &failure) {
+                diag.emplace_back(DiagLevel::Critical, failure.what(), context);
+                throw;
+            }
+        } else if (m_backupStrategy == BackupStrategy::Clone && !blocksShifted) {
+            // clone the file so it can be restored if patching it fails (if supported by the file system)
+            BackupHelper::createCloneBackupFile(backupDirectory(), path(), backupPath, m_durabilityPolicy);
+        }
     }
     // TODO: fix code duplication
 
@@ -1687,18 +3297,26 @@ void MediaFileInfo::makeMp3File(Diagnostics &diag, AbortableProgressFeedback &pr
                 DiagLevel::Critical, argsToString("Preferred padding is not supported. Setting preferred padding to ", padding, '.'), context);
         }
 
-        if (!makers.empty()) {
+        if (appendTag) {
+            // fill the space in front of the MPEG audio frames with a padding-only tag (or keep it empty)
+            if (streamOffset >= 10) {
+                progress.updateStep("Writing padding ...");
+                Id3v2Tag().make(outputStream, streamOffset - 10, diag);
+            } else {
+                outputStream.seekp(static_cast<std::streamoff>(streamOffset));
+            }
+        } else if (!makers.empty()) {
             // write ID3v2 tags
             progress.updateStep("Writing ID3v2 tag ...");
             for (auto i = makers.begin(), end = makers.end() - 1; i != end; ++i) {
                 i->make(outputStream, 0, diag);
             }
-            // include padding into the last ID3v2 tag
-            makers.back().make(outputStream, (flacStream && padding && padding < 4) ? 0 : static_cast<std::uint32_t>(padding), diag);
+            // include padding into the last ID3v2 tag (unless it goes into the FLAC "PADDING" block)
+            makers.back().make(outputStream, static_cast<std::uint32_t>(padding - flacPadding), diag);
         }
 
         if (flacStream) {
-            if (padding && startOfLastMetaDataBlock) {
+            if (flacPadding && startOfLastMetaDataBlock) {
                 // if appending padding, ensure the last flag of the last "METADATA_BLOCK_HEADER" is not set
                 flacMetaData.seekg(startOfLastMetaDataBlock);
                 flacMetaData.seekp(startOfLastMetaDataBlock);
@@ -1710,8 +3328,8 @@ void MediaFileInfo::makeMp3File(Diagnostics &diag, AbortableProgressFeedback &pr
             outputStream << flacMetaData.rdbuf();
 
             // write padding
-            if (padding) {
-                flacStream->makePadding(outputStream, static_cast<std::uint32_t>(padding), true, diag);
+            if (flacPadding) {
+                flacStream->makePadding(outputStream, static_cast<std::uint32_t>(flacPadding), true, diag);
             }
         }
 
@@ -1723,13 +3341,13 @@ void MediaFileInfo::makeMp3File(Diagnostics &diag, AbortableProgressFeedback &pr
         }
 
         // copy / skip actual stream data
-        // -> determine media data size
-        std::uint64_t mediaDataSize = size() - streamOffset;
-        if (m_actualExistingId3v1Tag) {
-            mediaDataSize -= 128;
-        }
-
         if (rewriteRequired) {
+            // write Xing frame in front of the frames
+            if (!xingFrame.empty()) {
+                progress.updateStep("Writing Xing frame ...");
+                outputStream.write(xingFrame.data(), static_cast<streamsize>(xingFrame.size()));
+            }
+
             // copy data from original file
             switch (m_containerFormat) {
             case ContainerFormat::MpegAudioFrames:
@@ -1739,14 +3357,29 @@ void MediaFileInfo::makeMp3File(Diagnostics &diag, AbortableProgressFeedback &pr
                 progress.updateStep("Writing frames ...");
             }
             backupStream.seekg(static_cast<streamoff>(streamOffset));
-            CopyHelper<0x4000> copyHelper;
-            copyHelper.callbackCopy(backupStream, stream(), mediaDataSize, bind(&AbortableProgressFeedback::isAborted, ref(progress)),
-                bind(&AbortableProgressFeedback::updateStepPercentage, ref(progress), _1));
+            FileRangeCopier copier;
+            copier.open(backupStream, backupPath.empty() ? path() : backupPath, outputStream,
+                temporaryFile.isCreated() ? temporaryFile.path() : (m_saveFilePath.empty() ? path() : m_saveFilePath));
+            const auto expectedSize = static_cast<std::uint64_t>(outputStream.tellp()) + mediaDataSize;
+            if (!copier.preallocate(expectedSize)) {
+                diag.emplace_back(
+                    DiagLevel::Critical, argsToString("There is not enough space to write the new file of ", expectedSize, " bytes."), context);
+                throw std::ios_base::failure("not enough space");
+            }
+            copier.copy(backupStream, outputStream, mediaDataSize, &progress);
+            statisticsScope->addCopiedBytes(FileRangeCopierStatistics(), copier.statistics());
         } else {
             // just skip actual stream data
+            progress.stopIfAborted();
             outputStream.seekp(static_cast<std::streamoff>(mediaDataSize), ios_base::cur);
         }
 
+        // write appended ID3v2 tag
+        if (appendTag) {
+            progress.updateStep("Writing ID3v2 tag ...");
+            appendedMaker->makeWithFooter(outputStream, diag);
+        }
+
         // write ID3v1 tag
         if (m_id3v1Tag) {
             progress.updateStep("Writing ID3v1 tag ...");
@@ -1769,6 +3402,10 @@ void MediaFileInfo::makeMp3File(Diagnostics &diag, AbortableProgressFeedback &pr
             // prevent deferring final write operations (to catch and handle possible errors here); stream is useless for further
             // usage anyways because it is write-only
             outputStream.close();
+            // replace the original file with the new file now that it has been written completely
+            if (temporaryFile.isCreated() && !temporaryFile.replaceOriginalFile(path(), m_durabilityPolicy)) {
+                diag.emplace_back(DiagLevel::Warning, "Unable to sync the directory containing the file to the disk.", context);
+            }
         } else {
             const auto newSize = static_cast<std::uint64_t>(outputStream.tellp());
             if (newSize < size()) {
@@ -1791,7 +3428,223 @@ void MediaFileInfo::makeMp3File(Diagnostics &diag, AbortableProgressFeedback &pr
         }
 
     } catch (...) {
-        BackupHelper::handleFailureAfterFileModified(*this, backupPath, outputStream, backupStream, diag, context);
+        if (temporaryFile.isCreated()) {
+            // the original file has not been touched -> just free the temporary file
+            outputStream.close();
+            temporaryFile.discard();
+        }
+        if (blocksShifted) {
+            if (BackupHelper::undoDataShift(path(), streamOffset, originalStreamOffset, outputStream, diag, context)) {
+                reportSizeChanged(size() + originalStreamOffset - streamOffset);
+            } else {
+                // keep the journal as restoring it would destroy the frames not being at their original offset
+                journalPath.clear();
+            }
+        }
+        BackupHelper::handleFailureAfterFileModified(*this, backupPath, journalPath, outputStream, backupStream, diag, context);
+    }
+
+    // the journal is only needed to undo the shifting
+    if (blocksShifted) {
+        std::remove(BasicFileInfo::pathForOpen(journalPath));
+    }
+}
+
+/*!
+ * \brief Internally used to save changes of RIFF/WAVE files.
+ *
+ * The "INFO" list and the "id3 " chunk are written as last chunks of the RIFF chunk so the "data" chunk never needs to
+ * be moved. Tag chunks following the "data" chunk are overwritten; tag chunks in front of it are turned into "JUNK"
+ * chunks. Hence the file is never rewritten (when a save file path is set, the chunks in front of the tags are copied).
+ *
+ * \remarks Only the layout is calculated (see planChanges()) if \a statisticsScope is nullptr.
+ */
+void MediaFileInfo::makeWaveFile(Diagnostics &diag, AbortableProgressFeedback &progress, StatisticsScope *statisticsScope)
+{
+    static const string context("making RIFF/WAVE file");
+    const auto *const waveStream = static_cast<const WaveAudioStream *>(m_singleTrack.get());
+    const auto &chunks = waveStream->chunks();
+    const auto *const dataChunk = waveStream->chunk(0x64617461u); // "data"
+    if (!dataChunk || waveStream->isTruncated()) {
+        diag.emplace_back(DiagLevel::Critical, "The file is truncated or lacks the \"data\" chunk; tags can not be written.", context);
+        throw InvalidDataException();
+    }
+    progress.updateStep("Updating RIFF/WAVE tags ...");
+    const auto isTagChunk = [](const WaveChunk &chunk) {
+        return (chunk.id == 0x4C495354u && chunk.listType == 0x494E464Fu) // "LIST" with form type "INFO"
+            || chunk.id == 0x69643320u || chunk.id == 0x49443320u; // "id3 " or "ID3 "
+    };
+
+    // determine where the new tag chunks go: tag chunks and padding ("JUNK"/"PAD ") after the "data" chunk are overwritten
+    auto tagsOffset = waveStream->riffEndOffset();
+    for (auto i = chunks.crbegin(), end = chunks.crend(); i != end && i->offset > dataChunk->offset; ++i) {
+        if (!isTagChunk(*i) && i->id != 0x4A554E4Bu && i->id != 0x50414420u) {
+            break;
+        }
+        tagsOffset = i->offset;
+    }
+
+    // make new tag chunks
+    stringstream tagChunks(ios_base::in | ios_base::out | ios_base::binary);
+    tagChunks.exceptions(ios_base::badbit | ios_base::failbit);
+    if (auto *const infoTag = waveStream->infoTag(); infoTag && infoTag->fieldCount()) {
+        infoTag->make(tagChunks, diag);
+    }
+    if (m_id3v2Tags.size() > 1 || !m_actualId3v2TagOffsets.empty()) {
+        diag.emplace_back(DiagLevel::Warning,
+            "Only the first ID3v2 tag is written to the \"id3 \" chunk; ID3v2 tags in front of the RIFF chunk are left untouched.", context);
+    }
+    if (!m_id3v2Tags.empty() && m_id3v2Tags.front()->fieldCount()) {
+        auto maker = m_id3v2Tags.front()->prepareMaking(diag);
+        char header[8];
+        BE::getBytes(static_cast<std::uint32_t>(0x69643320u), header);
+        LE::getBytes(maker.requiredSize(), header + 4);
+        tagChunks.write(header, 8);
+        maker.make(tagChunks, 0, diag);
+        if (maker.requiredSize() & 1) {
+            tagChunks.put(0);
+        }
+    }
+    const auto tagChunksData = tagChunks.str();
+
+    // check whether the RIFF chunk still fits
+    const auto riffStart = static_cast<std::uint64_t>(m_containerOffset);
+    const auto newRiffSize = tagsOffset + tagChunksData.size() - riffStart - 8;
+    if (newRiffSize > numeric_limits<std::uint32_t>::max()) {
+        diag.emplace_back(DiagLevel::Critical, "The RIFF chunk would exceed 4 GiB which requires RF64; RF64 is not supported.", context);
+        throw NotImplementedException();
+    }
+
+    // keep data following the RIFF chunk (except the ID3v1 tag which is written separately)
+    const auto riffEnd = waveStream->riffEndOffset();
+    const auto trailingEnd = size() - (m_actualExistingId3v1Tag ? 128 : 0);
+    auto trailingData = string(trailingEnd > riffEnd ? trailingEnd - riffEnd : 0, '\0');
+    if (!trailingData.empty()) {
+        stream().seekg(static_cast<streamoff>(riffEnd));
+        stream().read(trailingData.data(), static_cast<streamsize>(trailingData.size()));
+    }
+
+    // determine the tag chunks in front of the new ones which are turned into "JUNK" chunks
+    vector<std::uint64_t> obsoleteChunkOffsets;
+    for (const auto &chunk : chunks) {
+        if (chunk.offset < tagsOffset && isTagChunk(chunk)) {
+            obsoleteChunkOffsets.emplace_back(chunk.offset);
+        }
+    }
+    if (isForcingRewrite()) {
+        diag.emplace_back(DiagLevel::Information, "Rewriting RIFF/WAVE files is not necessary; the tags are updated in-place.", context);
+    }
+    m_applyChangesResult.setLayout(!m_saveFilePath.empty(), 0, 0);
+    if (!statisticsScope) {
+        m_applyChangesResult.fileSizeAfter = tagsOffset + tagChunksData.size() + trailingData.size() + (m_id3v1Tag ? 128 : 0);
+        m_applyChangesResult.bytesCopied = m_saveFilePath.empty() ? 0 : tagsOffset;
+        return;
+    }
+
+    // setup stream(s) for writing
+    string backupPath, journalPath;
+    NativeFileStream &outputStream = stream();
+    NativeFileStream backupStream;
+    if (!m_saveFilePath.empty()) {
+        // open the current file as backupStream and create a new outputStream at the specified "save file path"
+        try {
+            close();
+            backupStream.exceptions(ios_base::badbit | ios_base::failbit);
+            backupStream.open(BasicFileInfo::pathForOpen(path()), ios_base::in | ios_base::binary);
+            outputStream.open(BasicFileInfo::pathForOpen(m_saveFilePath), ios_base::out | ios_base::binary | ios_base::trunc);
+        } catch (const std::ios_base::failure &failure) {
+            diag.emplace_back(DiagLevel::Critical, argsToString("Opening streams to write output file failed: ", failure.what()), context);
+            throw;
+        }
+    } else {
+        // reopen original file to ensure it is opened for writing
+        try {
+            close();
+            outputStream.open(BasicFileInfo::pathForOpen(path()), ios_base::in | ios_base::out | ios_base::binary);
+        } catch (const std::ios_base::failure &failure) {
+            diag.emplace_back(DiagLevel::Critical, argsToString("Opening the file with write permissions failed: ", failure.what()), context);
+            throw;
+        }
+        // save everything but the chunks in front of the new tag chunks to the journal (except the IDs to be changed)
+        if (m_backupStrategy == BackupStrategy::Journal) {
+            auto untouchedRanges = vector<pair<std::uint64_t, std::uint64_t>>();
+            auto untouchedStart = riffStart + 8;
+            for (const auto offset : obsoleteChunkOffsets) {
+                untouchedRanges.emplace_back(untouchedStart, offset);
+                untouchedStart = offset + 4;
+            }
+            untouchedRanges.emplace_back(untouchedStart, tagsOffset);
+            try {
+                BackupHelper::createJournal(backupDirectory(), path(), journalPath, outputStream, size(), untouchedRanges);
+            } catch (const std::ios_base::failure &failure) {
+                diag.emplace_back(DiagLevel::Critical, failure.what(), context);
+                throw;
+            }
+        } else if (m_backupStrategy == BackupStrategy::Clone) {
+            // clone the file so it can be restored if patching it fails (if supported by the file system)
+            BackupHelper::createCloneBackupFile(backupDirectory(), path(), backupPath, m_durabilityPolicy);
+        }
+    }
+
+    // start actual writing
+    try {
+        if (!m_saveFilePath.empty()) {
+            progress.updateStep("Writing chunks ...");
+            backupStream.seekg(0);
+            FileRangeCopier copier;
+            copier.open(backupStream, path(), outputStream, m_saveFilePath);
+            copier.copy(backupStream, outputStream, tagsOffset, &progress);
+            statisticsScope->addCopiedBytes(FileRangeCopierStatistics(), copier.statistics());
+        }
+
+        // update the size of the RIFF chunk and the IDs of obsolete tag chunks
+        progress.updateStep("Writing tags ...");
+        char buffer[4];
+        LE::getBytes(static_cast<std::uint32_t>(newRiffSize), buffer);
+        outputStream.seekp(static_cast<streamoff>(riffStart + 4));
+        outputStream.write(buffer, 4);
+        BE::getBytes(static_cast<std::uint32_t>(0x4A554E4Bu), buffer); // "JUNK"
+        for (const auto offset : obsoleteChunkOffsets) {
+            outputStream.seekp(static_cast<streamoff>(offset));
+            outputStream.write(buffer, 4);
+        }
+
+        // write new tag chunks, trailing data and ID3v1 tag
+        outputStream.seekp(static_cast<streamoff>(tagsOffset));
+        outputStream.write(tagChunksData.data(), static_cast<streamsize>(tagChunksData.size()));
+        outputStream.write(trailingData.data(), static_cast<streamsize>(trailingData.size()));
+        if (m_id3v1Tag) {
+            progress.updateStep("Writing ID3v1 tag ...");
+            try {
+                m_id3v1Tag->make(outputStream, diag);
+            } catch (const Failure &) {
+                diag.emplace_back(DiagLevel::Warning, "Unable to write ID3v1 tag.", context);
+            }
+        }
+
+        // handle streams
+        const auto newSize = static_cast<std::uint64_t>(outputStream.tellp());
+        if (!m_saveFilePath.empty()) {
+            reportSizeChanged(newSize);
+            reportPathChanged(m_saveFilePath);
+            m_saveFilePath.clear();
+            outputStream.close();
+        } else if (newSize < size()) {
+            // file is smaller after the modification -> truncate
+            outputStream.close();
+            if (truncate(BasicFileInfo::pathForOpen(path()), static_cast<streamoff>(newSize)) == 0) {
+                reportSizeChanged(newSize);
+            } else {
+                diag.emplace_back(DiagLevel::Critical, "Unable to truncate the file.", context);
+            }
+        } else {
+            // prevent deferring final write operations (to catch and handle possible errors here)
+            outputStream.flush();
+            reportSizeChanged(newSize);
+        }
+
+    } catch (...) {
+        BackupHelper::handleFailureAfterFileModified(*this, backupPath, journalPath, outputStream, backupStream, diag, context);
     }
 }
 
@@ -2,9 +2,19 @@
 #define TAG_PARSER_MEDIAINFO_H
 
 #include "./abstractcontainer.h"
+#include "./applychangesresult.h"
 #include "./basicfileinfo.h"
+#include "./functionref.h"
+#include "./localehelper.h"
+#include "./mediafilestatistics.h"
+#include "./mediapayloadhash.h"
+#include "./paddingpolicy.h"
 #include "./settings.h"
 #include "./signature.h"
+#include "./tailprobe.h"
+#include "./tagfieldfilter.h"
+#include "./tagfieldlist.h"
+#include "./virtualfile.h"
 
 #include <cstdint>
 #include <memory>
@@ -24,9 +34,12 @@ class OggContainer;
 class EbmlElement;
 class MatroskaTag;
 class AbstractTrack;
+struct TrackColumns;
 class VorbisComment;
 class Diagnostics;
 class AbortableProgressFeedback;
+class SeeklessOutputStream;
+class ParseResultCache;
 
 enum class MediaType : unsigned int;
 enum class TagType : unsigned int;
@@ -42,6 +55,24 @@ enum class ParsingStatus : std::uint8_t {
     CriticalFailure /**< tried to parse the part, but critical errors occurred */
 };
 
+/*!
+ * \brief The MediaFileChanges enum specifies which parts of the file have been modified since they have been parsed.
+ * \sa MediaFileInfo::changes()
+ */
+enum class MediaFileChanges : std::uint8_t {
+    None = 0, /**< nothing has been modified */
+    Tags = (1 << 0), /**< the fields or targets of at least one tag have been modified */
+    Tracks = (1 << 1), /**< the meta-data of at least one track has been modified */
+    Attachments = (1 << 2), /**< at least one attachment has been modified */
+    Structure = (1 << 3), /**< tags, tracks or attachments have been added or removed or the title has been changed */
+};
+
+} // namespace TagParser
+
+CPP_UTILITIES_MARK_FLAG_ENUM_CLASS(TagParser, TagParser::MediaFileChanges);
+
+namespace TagParser {
+
 class TAG_PARSER_EXPORT MediaFileInfo : public BasicFileInfo {
 public:
     // constructor, destructor
@@ -58,9 +89,22 @@ public:
     void parseChapters(Diagnostics &diag);
     void parseAttachments(Diagnostics &diag);
     void parseEverything(Diagnostics &diag);
+    bool resumeParsing(Diagnostics &diag);
+    std::shared_ptr<const TagFieldList> parseTagFields(
+        Diagnostics &diag, std::size_t maxDataSize = TagFieldList::defaultMaxDataSize, StringPool *namePool = nullptr);
+    MediaPayloadHash hashMediaPayload(Diagnostics &diag, AbortableProgressFeedback &progress, unsigned int parallelism = 0);
 
     // methods to apply changes
     void applyChanges(Diagnostics &diag, AbortableProgressFeedback &progress);
+    ApplyChangesResult planChanges(Diagnostics &diag, AbortableProgressFeedback &progress);
+    VirtualFile makeVirtualFile(Diagnostics &diag);
+    void writeChanges(SeeklessOutputStream &output, Diagnostics &diag, AbortableProgressFeedback &progress);
+    void makeFaststart(Diagnostics &diag, AbortableProgressFeedback &progress);
+    MediaFileChanges changes() const;
+    bool isModified() const;
+    void markAsUnmodified(
+        MediaFileChanges changes = MediaFileChanges::Tags | MediaFileChanges::Tracks | MediaFileChanges::Attachments | MediaFileChanges::Structure);
+    const ApplyChangesResult &applyChangesResult() const;
 
     // methods to get parsed information regarding ...
     // ... the container
@@ -76,19 +120,24 @@ public:
     // ... the capters
     ParsingStatus chaptersParsingStatus() const;
     std::vector<AbstractChapter *> chapters() const;
+    void forEachChapter(FunctionRef<void(AbstractChapter &chapter)> callback) const;
     bool areChaptersSupported() const;
     // ... the attachments
     ParsingStatus attachmentsParsingStatus() const;
     std::vector<AbstractAttachment *> attachments() const;
+    void forEachAttachment(FunctionRef<void(AbstractAttachment &attachment)> callback) const;
     bool areAttachmentsSupported() const;
     // ... the tracks
     ParsingStatus tracksParsingStatus() const;
     std::size_t trackCount() const;
     std::vector<AbstractTrack *> tracks() const;
+    void forEachTrack(FunctionRef<void(AbstractTrack &track)> callback) const;
+    std::size_t exportTrackColumns(TrackColumns &columns, std::uint32_t fileIndex = 0) const;
     bool hasTracksOfType(TagParser::MediaType type) const;
     CppUtilities::TimeSpan duration() const;
     double overallAverageBitrate() const;
     std::unordered_set<std::string> availableLanguages(TagParser::MediaType type = TagParser::MediaType::Audio) const;
+    std::vector<LocaleId> availableLanguageIds(TagParser::MediaType type = TagParser::MediaType::Audio) const;
     std::string technicalSummary() const;
     bool areTracksSupported() const;
     // ... the tags
@@ -96,10 +145,14 @@ public:
     bool hasId3v1Tag() const;
     bool hasId3v2Tag() const;
     bool hasAnyTag() const;
+    const TailProbe &tailProbe();
     Id3v1Tag *id3v1Tag() const;
     const std::vector<std::unique_ptr<Id3v2Tag>> &id3v2Tags() const;
     void tags(std::vector<Tag *> &tags) const;
     std::vector<Tag *> tags() const;
+    void forEachTag(FunctionRef<void(Tag &tag)> callback) const;
+    void forEachField(
+        FunctionRef<void(Tag &tag, const TagFieldRecord &record)> callback, std::size_t maxDataSize = TagFieldList::defaultMaxDataSize) const;
     Mp4Tag *mp4Tag() const;
     const std::vector<std::unique_ptr<MatroskaTag>> &matroskaTags() const;
     VorbisComment *vorbisComment() const;
@@ -120,25 +173,82 @@ public:
     VorbisComment *createVorbisComment();
     bool removeVorbisComment();
     void clearParsingResults();
+    void reset(const std::string &path);
 
     // methods to get, set object behaviour
     const std::string &backupDirectory() const;
     void setBackupDirectory(const std::string &backupDirectory);
+    BackupStrategy backupStrategy() const;
+    void setBackupStrategy(BackupStrategy backupStrategy);
+    DurabilityPolicy durabilityPolicy() const;
+    void setDurabilityPolicy(DurabilityPolicy durabilityPolicy);
+    ParseResultCache *parseResultCache() const;
+    void setParseResultCache(ParseResultCache *cache);
     const std::string &saveFilePath() const;
     void setSaveFilePath(const std::string &saveFilePath);
-    const std::string writingApplication() const;
+    const std::string &writingApplication() const;
     void setWritingApplication(const std::string &writingApplication);
     void setWritingApplication(const char *writingApplication);
     bool isForcingFullParse() const;
     void setForceFullParse(bool forceFullParse);
+    ContainerFormat forcedContainerFormat() const;
+    void setForcedContainerFormat(ContainerFormat format);
+    ParsingFlags parsingFlags() const;
+    void setParsingFlags(ParsingFlags flags);
+    const TagFieldFilter &tagFieldFilter() const;
+    void setTagFieldFilter(const TagFieldFilter &filter);
+    std::uint64_t maxParsingOffset() const;
+    void setMaxParsingOffset(std::uint64_t maxParsingOffset);
+    std::size_t mpegAudioMaxJunkSize() const;
+    void setMpegAudioMaxJunkSize(std::size_t maxJunkSize);
+    bool isMpegAudioExactDurationEnabled() const;
+    void setMpegAudioExactDurationEnabled(bool enabled);
+    bool isMpegAudioSeekTableWritingEnabled() const;
+    void setMpegAudioSeekTableWritingEnabled(bool enabled);
+    bool isBlockShiftingEnabled() const;
+    void setBlockShiftingEnabled(bool enabled);
+    std::uint64_t ivfFrameIndexBudget() const;
+    void setIvfFrameIndexBudget(std::uint64_t budget);
+    CppUtilities::TimeSpan flacSeekPointInterval() const;
+    void setFlacSeekPointInterval(CppUtilities::TimeSpan interval);
+    MatroskaParseStrategy matroskaParseStrategy() const;
+    void setMatroskaParseStrategy(MatroskaParseStrategy strategy);
+    std::uint64_t matroskaClusterScanBudget() const;
+    void setMatroskaClusterScanBudget(std::uint64_t budget);
+    std::uint64_t matroskaMaxFullParseSize() const;
+    void setMatroskaMaxFullParseSize(std::uint64_t maxFullParseSize);
+    CppUtilities::TimeSpan matroskaFullParseTimeBudget() const;
+    void setMatroskaFullParseTimeBudget(CppUtilities::TimeSpan timeBudget);
+    std::size_t matroskaSegmentParsingThreadCount() const;
+    void setMatroskaSegmentParsingThreadCount(std::size_t threadCount);
+    bool isElementArenaEnabled() const;
+    void setElementArenaEnabled(bool enabled);
+    bool isStatisticsEnabled() const;
+    void setStatisticsEnabled(bool enabled);
+    const MediaFileStatistics *statistics() const;
+    MediaFileStatistics *statistics();
+    void resetStatistics();
+    bool isIoTracingEnabled() const;
+    void setIoTracingEnabled(bool enabled);
+    const MemoryAccount &memoryAccount() const;
+    std::uint64_t memoryLimit() const;
+    void setMemoryLimit(std::uint64_t limit);
+    const ParseLimits &parseLimits() const;
+    void setParseLimits(const ParseLimits &limits);
     bool isForcingRewrite() const;
     void setForceRewrite(bool forceRewrite);
+    bool isForcingInPlace() const;
+    void setForceInPlace(bool forceInPlace);
+    bool isSkippingUnmodified() const;
+    void setSkipUnmodified(bool skipUnmodified);
     std::size_t minPadding() const;
     void setMinPadding(std::size_t minPadding);
     std::size_t maxPadding() const;
     void setMaxPadding(std::size_t maxPadding);
     std::size_t preferredPadding() const;
     void setPreferredPadding(std::size_t preferredPadding);
+    const std::shared_ptr<PaddingPolicy> &paddingPolicy() const;
+    void setPaddingPolicy(const std::shared_ptr<PaddingPolicy> &paddingPolicy);
     ElementPosition tagPosition() const;
     void setTagPosition(ElementPosition tagPosition);
     bool forceTagPosition() const;
@@ -152,10 +262,19 @@ protected:
     void invalidated() override;
 
 private:
+    class StatisticsScope;
+
+    void validateChanges(Diagnostics &diag, const std::string &context) const;
+    void applyPaddingPolicy(Diagnostics &diag, AbortableProgressFeedback &progress, bool updateHint);
+    void syncToDisk(Diagnostics &diag);
+    const char *readHead(std::uint64_t offset, std::size_t requiredSize);
+    void detectContainerFormat();
+    void clearHead();
     // private methods internally used when rewriting the file to apply new tag information
-    // currently only the makeMp3File() methods is present; corresponding methods for
+    // currently only the makeMp3File() and makeWaveFile() methods are present; corresponding methods for
     // other formats are outsourced to container classes
-    void makeMp3File(Diagnostics &diag, AbortableProgressFeedback &progress);
+    void makeMp3File(Diagnostics &diag, AbortableProgressFeedback &progress, StatisticsScope *statisticsScope);
+    void makeWaveFile(Diagnostics &diag, AbortableProgressFeedback &progress, StatisticsScope *statisticsScope);
 
     // fields related to the container
     ParsingStatus m_containerParsingStatus;
@@ -163,8 +282,11 @@ private:
     std::streamoff m_containerOffset;
     std::uint64_t m_paddingSize;
     bool m_actualExistingId3v1Tag;
+    TailProbe m_tailProbe;
     std::vector<std::streamoff> m_actualId3v2TagOffsets;
+    std::uint64_t m_actualAppendedId3v2TagSize;
     std::unique_ptr<AbstractContainer> m_container;
+    std::unique_ptr<ElementArena> m_spareElementArena;
 
     // fields related to the tracks
     ParsingStatus m_tracksParsingStatus;
@@ -179,19 +301,65 @@ private:
     ParsingStatus m_chaptersParsingStatus;
     ParsingStatus m_attachmentsParsingStatus;
 
+    // statistics (only present if enabled)
+    std::unique_ptr<MediaFileStatistics> m_statistics;
+    ApplyChangesResult m_applyChangesResult;
+
+    // memory accounting of the parsing results
+    MemoryAccount m_memoryAccount;
+    ParseLimits m_parseLimits;
+
     // fields specifying object behaviour
     std::string m_backupDirectory;
+    BackupStrategy m_backupStrategy;
+    DurabilityPolicy m_durabilityPolicy;
+    ParseResultCache *m_parseResultCache;
     std::string m_saveFilePath;
     std::string m_writingApplication;
     std::size_t m_minPadding;
     std::size_t m_maxPadding;
     std::size_t m_preferredPadding;
+    std::shared_ptr<PaddingPolicy> m_paddingPolicy;
     ElementPosition m_tagPosition;
     ElementPosition m_indexPosition;
+    ParsingFlags m_parsingFlags;
+    TagFieldFilter m_tagFieldFilter;
+    std::uint64_t m_maxParsingOffset;
+    std::size_t m_mpegAudioMaxJunkSize;
+    std::uint64_t m_ivfFrameIndexBudget;
+    std::uint64_t m_matroskaClusterScanBudget;
+    std::uint64_t m_matroskaMaxFullParseSize;
+    std::size_t m_matroskaSegmentParsingThreadCount;
+    CppUtilities::TimeSpan m_matroskaFullParseTimeBudget;
+    CppUtilities::TimeSpan m_flacSeekPointInterval;
+    MatroskaParseStrategy m_matroskaParseStrategy;
     bool m_forceFullParse;
     bool m_forceRewrite;
+    bool m_forceInPlace;
     bool m_forceTagPosition;
     bool m_forceIndexPosition;
+    bool m_elementArenaEnabled;
+    bool m_tagsFiltered;
+    bool m_mpegAudioExactDurationEnabled;
+    bool m_mpegAudioSeekTableWritingEnabled;
+    bool m_blockShiftingEnabled;
+    bool m_skipUnmodified;
+    bool m_ioTracingEnabled;
+    bool m_structureModified;
+
+    // fields caching the head of the file and the result of skipping ID3v2 tags and junk in front of the container
+    struct DetectionTrace {
+        std::vector<std::streamoff> id3v2TagOffsets;
+        std::streamoff containerOffset = 0;
+        std::uint64_t bytesSkipped = 0;
+        ContainerFormat format = ContainerFormat::Unknown;
+        bool gaveUp = false;
+        bool valid = false;
+    };
+    std::string m_head;
+    std::uint64_t m_headOffset;
+    DetectionTrace m_detectionTrace;
+    ContainerFormat m_forcedContainerFormat;
 };
 
 /*!
@@ -363,6 +531,79 @@ inline void MediaFileInfo::setBackupDirectory(const std::string &backupDirectory
     m_backupDirectory = backupDirectory;
 }
 
+/*!
+ * \brief Returns how the original file is preserved while applying changes.
+ * \sa setBackupStrategy()
+ */
+inline BackupStrategy MediaFileInfo::backupStrategy() const
+{
+    return m_backupStrategy;
+}
+
+/*!
+ * \brief Sets how the original file is preserved while applying changes.
+ *
+ * By default, the original file is renamed to the backup file when the file needs to be rewritten and nothing is backed up
+ * when changes are applied in-place. Use BackupStrategy::Clone to keep the inode of the original file (without copying
+ * its data on file systems supporting reflinks such as Btrfs, XFS, APFS and ReFS) which also protects changes applied
+ * in-place on these file systems by cloning the file first. Use BackupStrategy::Journal to protect changes applied
+ * in-place on any file system.
+ * Use BackupStrategy::TemporaryFile to write the new file into an anonymous file which replaces the original file
+ * atomically without creating a backup file at all (supported when rewriting MP4, Matroska and files with ID3 tags or
+ * FLAC metadata; BackupStrategy::Rename is used otherwise).
+ *
+ * \remarks Backup files and journal files are not removed after changes have been applied successfully.
+ */
+inline void MediaFileInfo::setBackupStrategy(BackupStrategy backupStrategy)
+{
+    m_backupStrategy = backupStrategy;
+}
+
+/*!
+ * \brief Returns how the written data is synced to the disk after applying changes.
+ * \sa setDurabilityPolicy()
+ */
+inline DurabilityPolicy MediaFileInfo::durabilityPolicy() const
+{
+    return m_durabilityPolicy;
+}
+
+/*!
+ * \brief Sets how the written data is synced to the disk after applying changes.
+ *
+ * By default, the file is only synced when applying changes in-place is enforced (see setForceInPlace()). Use
+ * DurabilityPolicy::WrittenRanges to only write back the ranges which have been modified (useful for in-place edits),
+ * DurabilityPolicy::DataSync to sync the file via fdatasync() and DurabilityPolicy::FullSync to also sync renaming the
+ * original file to the backup file and creating the new file. Failing to sync is reported as warning.
+ */
+inline void MediaFileInfo::setDurabilityPolicy(DurabilityPolicy durabilityPolicy)
+{
+    m_durabilityPolicy = durabilityPolicy;
+}
+
+/*!
+ * \brief Returns the cache updated when applying changes; nullptr if none has been assigned.
+ * \sa setParseResultCache()
+ */
+inline ParseResultCache *MediaFileInfo::parseResultCache() const
+{
+    return m_parseResultCache;
+}
+
+/*!
+ * \brief Sets the cache updated when applying changes.
+ *
+ * When changes have been applied successfully, the entry for the file is replaced with the new tags and the new identity
+ * of the file so the file does not need to be parsed again (e.g. by LibraryWatcher::refresh()). The entry is determined
+ * from the parsing results before applying the changes, so the tracks and the duration are assumed to be unchanged.
+ *
+ * \remarks The cache must outlive the object or be unassigned before it is destroyed.
+ */
+inline void MediaFileInfo::setParseResultCache(ParseResultCache *cache)
+{
+    m_parseResultCache = cache;
+}
+
 /*!
  * \brief Returns the "save file path" which has been set using setSaveFilePath().
  * \sa setSaveFilePath()
@@ -396,7 +637,7 @@ inline void MediaFileInfo::setSaveFilePath(const std::string &saveFilePath)
  * \remarks This is not read from the file when parsing and only used when saving changes.
  * \sa setWritingApplication() for more details
  */
-inline const std::string MediaFileInfo::writingApplication() const
+inline const std::string &MediaFileInfo::writingApplication() const
 {
     return m_writingApplication;
 }
@@ -457,6 +698,528 @@ inline void MediaFileInfo::setForceFullParse(bool forceFullParse)
     m_forceFullParse = forceFullParse;
 }
 
+/*!
+ * \brief Returns the container format which is used instead of the detected one.
+ * \remarks Returns ContainerFormat::Unknown if the detected container format is used (the default).
+ * \sa setForcedContainerFormat()
+ */
+inline ContainerFormat MediaFileInfo::forcedContainerFormat() const
+{
+    return m_forcedContainerFormat;
+}
+
+/*!
+ * \brief Sets the container format which is used instead of the detected one.
+ *
+ * ID3v2 tags and junk in front of the container are still skipped. Then the container is parsed as the specified
+ * \a format regardless of its signature. Specify ContainerFormat::Unknown to use the detected container format again.
+ *
+ * \remarks The setting is applied next time parsing. To re-parse the file as a different format, call
+ *          clearParsingResults() first. This does not read the head of the file again.
+ * \sa forcedContainerFormat()
+ */
+inline void MediaFileInfo::setForcedContainerFormat(ContainerFormat format)
+{
+    m_forcedContainerFormat = format;
+}
+
+/*!
+ * \brief Returns the flags controlling which parts of the file are parsed.
+ * \sa setParsingFlags()
+ */
+inline ParsingFlags MediaFileInfo::parsingFlags() const
+{
+    return m_parsingFlags;
+}
+
+/*!
+ * \brief Sets the flags controlling which parts of the file are parsed.
+ * \remarks
+ * - The setting is applied next time parsing. The current parsing results are not mutated.
+ * - Skipped parts remain ParsingStatus::NotParsedYet so they can still be parsed later after altering the flags.
+ * - Tracks and tags must be parsed to apply changes so ParsingFlags::SkipTracks and ParsingFlags::SkipTags are
+ *   only useful when read-only access is sufficient.
+ * \sa parsingFlags()
+ */
+inline void MediaFileInfo::setParsingFlags(ParsingFlags flags)
+{
+    m_parsingFlags = flags;
+}
+
+/*!
+ * \brief Returns the filter specifying which fields are read when parsing tags.
+ * \sa setTagFieldFilter()
+ */
+inline const TagFieldFilter &MediaFileInfo::tagFieldFilter() const
+{
+    return m_tagFieldFilter;
+}
+
+/*!
+ * \brief Sets the filter specifying which fields are read when parsing tags.
+ *
+ * Fields not included are skipped without reading their data when parsing MP4, ID3v2, Vorbis comment and Matroska
+ * tags. By default, the filter is empty which means all fields are read.
+ *
+ * \remarks
+ * - The setting is applied next time parsing. The current parsing results are not mutated.
+ * - Tags parsed with a non-empty filter lack the other fields so changes can not be applied (applyChanges() throws).
+ * \sa tagFieldFilter()
+ */
+inline void MediaFileInfo::setTagFieldFilter(const TagFieldFilter &filter)
+{
+    m_tagFieldFilter = filter;
+}
+
+/*!
+ * \brief Returns the offset up to which the file is parsed. Zero means the whole file is parsed.
+ * \sa setMaxParsingOffset()
+ */
+inline std::uint64_t MediaFileInfo::maxParsingOffset() const
+{
+    return m_maxParsingOffset;
+}
+
+/*!
+ * \brief Sets the offset up to which the file is parsed.
+ *
+ * This allows to put an upper bound on the amount of data walked through when parsing big files. Elements which
+ * start beyond that offset are not considered. Zero means the whole file is parsed (the default).
+ *
+ * \remarks
+ * - The setting is applied next time parsing. The current parsing results are not mutated.
+ * - Currently only walking through the Matroska segment and OGG pages is limited. The tail of the file is still
+ *   read to find an ID3v1 tag. The last OGG pages are still probed (see OggPageIndex) to determine the duration.
+ * - Parsing results might be incomplete. An information is added to the diagnostic messages if data beyond the
+ *   offset has been omitted.
+ */
+inline void MediaFileInfo::setMaxParsingOffset(std::uint64_t maxParsingOffset)
+{
+    m_maxParsingOffset = maxParsingOffset;
+}
+
+/*!
+ * \brief Returns the number of junk bytes which are skipped at most before the first frame of MPEG audio files.
+ * \sa setMpegAudioMaxJunkSize()
+ */
+inline std::size_t MediaFileInfo::mpegAudioMaxJunkSize() const
+{
+    return m_mpegAudioMaxJunkSize;
+}
+
+/*!
+ * \brief Sets the number of junk bytes which are skipped at most before the first frame of MPEG audio files.
+ *
+ * The default is MpegAudioFrameStream::defaultMaxJunkSize (see MpegAudioFrameStream::setMaxJunkSize() for details).
+ *
+ * \remarks The setting is applied next time parsing. The current parsing results are not mutated.
+ */
+inline void MediaFileInfo::setMpegAudioMaxJunkSize(std::size_t maxJunkSize)
+{
+    m_mpegAudioMaxJunkSize = maxJunkSize;
+}
+
+/*!
+ * \brief Returns whether the duration of MPEG audio files is determined by walking through all frames.
+ * \sa setMpegAudioExactDurationEnabled()
+ */
+inline bool MediaFileInfo::isMpegAudioExactDurationEnabled() const
+{
+    return m_mpegAudioExactDurationEnabled;
+}
+
+/*!
+ * \brief Sets whether the duration of MPEG audio files is determined by walking through all frames.
+ *
+ * This is disabled by default (see MpegAudioFrameStream::setExactDurationEnabled() for details).
+ *
+ * \remarks The setting is applied next time parsing. The current parsing results are not mutated.
+ */
+inline void MediaFileInfo::setMpegAudioExactDurationEnabled(bool enabled)
+{
+    m_mpegAudioExactDurationEnabled = enabled;
+}
+
+/*!
+ * \brief Returns whether applyChanges() adds a Xing frame with a seek table to MPEG audio files lacking one.
+ * \sa setMpegAudioSeekTableWritingEnabled()
+ */
+inline bool MediaFileInfo::isMpegAudioSeekTableWritingEnabled() const
+{
+    return m_mpegAudioSeekTableWritingEnabled;
+}
+
+/*!
+ * \brief Sets whether applyChanges() adds a Xing frame with a seek table to MPEG audio files lacking one.
+ *
+ * If enabled and the first frame contains neither a Xing nor a VBRI header, a Xing frame denoting the number of
+ * frames, the size and a TOC is inserted in front of the first frame (see MpegAudioFrameStream::makeXingFrame()).
+ * This requires the file to be rewritten. This is disabled by default.
+ *
+ * \remarks The tracks must have been parsed before applying changes; otherwise the setting has no effect.
+ */
+inline void MediaFileInfo::setMpegAudioSeekTableWritingEnabled(bool enabled)
+{
+    m_mpegAudioSeekTableWritingEnabled = enabled;
+}
+
+/*!
+ * \brief Returns whether applyChanges() shifts the media data by whole file system blocks instead of rewriting the file.
+ * \sa setBlockShiftingEnabled()
+ */
+inline bool MediaFileInfo::isBlockShiftingEnabled() const
+{
+    return m_blockShiftingEnabled;
+}
+
+/*!
+ * \brief Sets whether applyChanges() shifts the media data by whole file system blocks instead of rewriting the file.
+ *
+ * If enabled and the tags in front of the media data of an MP3/FLAC file or the "moov"-atom in front of the media
+ * data of an MP4 file do not fit into the available space (or the padding would exceed the max. padding), blocks are
+ * inserted or collapsed in front of the media data (see FileRangeCopier::shiftData()) and the preferred padding plus
+ * the remainder of the last block is written. So the media data is neither copied nor moved on disk. The strategy is
+ * reported as ApplyChangesStrategy::BlockShift. If the platform or the file system does not support it (it is supported
+ * by ext4 and XFS under Linux), the file is rewritten as usual.
+ *
+ * Everything but the media data is saved to a journal in the backup directory before shifting (see
+ * BackupHelper::createJournal()). If applying changes fails afterwards, the blocks are shifted back and the original
+ * file is restored from the journal; otherwise the journal is removed. The media data is not shifted if the journal
+ * can not be created. This is disabled by default. It is never done when a save file path has been set, when rewriting
+ * is forced, when the backup strategy is BackupStrategy::Journal, when applying changes in-place is enforced and for
+ * fragmented MP4 files.
+ *
+ * \remarks
+ * - The padding may exceed the max. padding by up to one file system block.
+ * - planChanges() can not predict whether the file system supports it, so it reports ApplyChangesStrategy::Rewrite.
+ */
+inline void MediaFileInfo::setBlockShiftingEnabled(bool enabled)
+{
+    m_blockShiftingEnabled = enabled;
+}
+
+/*!
+ * \brief Returns the maximum number of bytes read to index the frames of IVF files.
+ * \sa setIvfFrameIndexBudget()
+ */
+inline std::uint64_t MediaFileInfo::ivfFrameIndexBudget() const
+{
+    return m_ivfFrameIndexBudget;
+}
+
+/*!
+ * \brief Sets the maximum number of bytes read to index the frames of IVF files.
+ *
+ * If non-zero, the frame count, duration and average bitrate of IVF files are determined from the actual frames
+ * instead of the frame count denoted in the header (see IvfStream::setFrameIndexBudget()). Zero disables indexing
+ * the frames which is the default.
+ *
+ * \remarks The setting is applied next time parsing. The current parsing results are not mutated.
+ */
+inline void MediaFileInfo::setIvfFrameIndexBudget(std::uint64_t budget)
+{
+    m_ivfFrameIndexBudget = budget;
+}
+
+/*!
+ * \brief Returns the interval of the seek points applyChanges() adds to FLAC files lacking a seek table.
+ * \sa setFlacSeekPointInterval()
+ */
+inline CppUtilities::TimeSpan MediaFileInfo::flacSeekPointInterval() const
+{
+    return m_flacSeekPointInterval;
+}
+
+/*!
+ * \brief Sets the interval of the seek points applyChanges() adds to FLAC files lacking a seek table.
+ *
+ * If set and the FLAC file contains no "METADATA_BLOCK_SEEKTABLE", the FLAC frames are walked through to make one with
+ * a seek point every \a interval (see FlacStream::makeSeekTable()). The seek table is written along with the other
+ * metadata blocks so the FLAC frames don't need to be moved as long as the padding is big enough.
+ *
+ * A null time span disables adding a seek table (the default).
+ *
+ * \remarks The tracks must have been parsed before applying changes; otherwise the setting has no effect.
+ */
+inline void MediaFileInfo::setFlacSeekPointInterval(CppUtilities::TimeSpan interval)
+{
+    m_flacSeekPointInterval = interval;
+}
+
+/*!
+ * \brief Returns the strategy used to locate the top-level elements of Matroska segments.
+ * \sa setMatroskaParseStrategy()
+ */
+inline MatroskaParseStrategy MediaFileInfo::matroskaParseStrategy() const
+{
+    return m_matroskaParseStrategy;
+}
+
+/*!
+ * \brief Sets the strategy used to locate the top-level elements of Matroska segments.
+ *
+ * The default is MatroskaParseStrategy::Sequential. With MatroskaParseStrategy::SeekHeadFirst big files with an
+ * incomplete or missing "SeekHead" element can be parsed without walking through all clusters.
+ *
+ * \remarks The setting is applied next time parsing. The current parsing results are not mutated.
+ * \sa matroskaParseStrategy()
+ */
+inline void MediaFileInfo::setMatroskaParseStrategy(MatroskaParseStrategy strategy)
+{
+    m_matroskaParseStrategy = strategy;
+}
+
+/*!
+ * \brief Returns the number of bytes of clusters which are walked through at most to find further top-level elements
+ *        when using MatroskaParseStrategy::SeekHeadFirst.
+ * \sa setMatroskaClusterScanBudget()
+ */
+inline std::uint64_t MediaFileInfo::matroskaClusterScanBudget() const
+{
+    return m_matroskaClusterScanBudget;
+}
+
+/*!
+ * \brief Sets the number of bytes of clusters which are walked through at most to find further top-level elements
+ *        when using MatroskaParseStrategy::SeekHeadFirst.
+ *
+ * The clusters are only walked through if not all relevant elements have been found via "SeekHead" elements and by
+ * probing the end of the segment. Zero means clusters are never walked through. The default is 16 MiB.
+ *
+ * \remarks The setting is applied next time parsing. The current parsing results are not mutated.
+ * \sa matroskaClusterScanBudget()
+ */
+inline void MediaFileInfo::setMatroskaClusterScanBudget(std::uint64_t budget)
+{
+    m_matroskaClusterScanBudget = budget;
+}
+
+/*!
+ * \brief Returns the maximal file size for walking through all clusters of a Matroska file in byte.
+ * \sa setMatroskaMaxFullParseSize()
+ */
+inline std::uint64_t MediaFileInfo::matroskaMaxFullParseSize() const
+{
+    return m_matroskaMaxFullParseSize;
+}
+
+/*!
+ * \brief Sets the maximal file size for walking through all clusters of a Matroska file in byte.
+ *
+ * If not all relevant elements have been found when the first cluster is reached, clusters are only walked through
+ * if the file is not bigger than the specified value (see MatroskaContainer::maxFullParseSize() for details). The
+ * default is the value of MatroskaContainer::maxFullParseSize() at the time the object has been constructed.
+ *
+ * \remarks
+ * - The setting is applied next time parsing. The current parsing results are not mutated.
+ * - The setting is not used if matroskaFullParseTimeBudget() is set.
+ * \sa matroskaMaxFullParseSize()
+ */
+inline void MediaFileInfo::setMatroskaMaxFullParseSize(std::uint64_t maxFullParseSize)
+{
+    m_matroskaMaxFullParseSize = maxFullParseSize;
+}
+
+/*!
+ * \brief Returns the time walking through the clusters of a Matroska file may take at most.
+ * \sa setMatroskaFullParseTimeBudget()
+ */
+inline CppUtilities::TimeSpan MediaFileInfo::matroskaFullParseTimeBudget() const
+{
+    return m_matroskaFullParseTimeBudget;
+}
+
+/*!
+ * \brief Sets the time walking through the clusters of a Matroska file may take at most.
+ *
+ * If set, whether clusters are walked through is decided adaptively instead of comparing the file size against
+ * matroskaMaxFullParseSize(): The time walking through the remaining clusters takes is estimated from the time it
+ * took to read the elements so far (reflecting the latency of the storage) and from the average cluster size. The
+ * clusters are only walked through as long as the estimation does not exceed the specified time. So scanning a file
+ * on a fast local disk is likely done while scanning the same file on a slow network share is not.
+ *
+ * A null time span disables the adaptive decision (the default).
+ *
+ * \remarks The setting is applied next time parsing. The current parsing results are not mutated.
+ * \sa matroskaFullParseTimeBudget()
+ */
+inline void MediaFileInfo::setMatroskaFullParseTimeBudget(CppUtilities::TimeSpan timeBudget)
+{
+    m_matroskaFullParseTimeBudget = timeBudget;
+}
+
+/*!
+ * \brief Returns the number of threads used to parse the headers of the segments of a Matroska file.
+ * \sa setMatroskaSegmentParsingThreadCount()
+ */
+inline std::size_t MediaFileInfo::matroskaSegmentParsingThreadCount() const
+{
+    return m_matroskaSegmentParsingThreadCount;
+}
+
+/*!
+ * \brief Sets the number of threads used to parse the headers of the segments of a Matroska file.
+ *
+ * Linked or concatenated Matroska files might consist of many "Segment"-elements. If the file is memory-mapped (see
+ * BasicFileInfo::setMemoryMappingEnabled()) and uses more than one segment, the top-level elements within the segments
+ * are located concurrently using the specified number of threads. Each segment is parsed into its own element tree
+ * reading only from the mapping. The tracks, tags, chapters and attachments are merged in segment order afterwards
+ * so the results do not depend on the number of threads.
+ *
+ * A value of zero means the number of hardware threads is used. The default is one, so segments are parsed sequentially.
+ *
+ * \remarks
+ * - Segments are only parsed concurrently when using MatroskaParseStrategy::Sequential and no maxParsingOffset().
+ * - Unlike when parsing sequentially, each segment is searched for all relevant elements on its own (instead of
+ *   stopping as soon as all relevant elements have been found within a previous segment).
+ * - The setting is applied next time parsing. The current parsing results are not mutated.
+ * \sa matroskaSegmentParsingThreadCount()
+ */
+inline void MediaFileInfo::setMatroskaSegmentParsingThreadCount(std::size_t threadCount)
+{
+    m_matroskaSegmentParsingThreadCount = threadCount;
+}
+
+/*!
+ * \brief Returns whether the elements of MP4 and Matroska files are allocated within an arena owned by the container.
+ * \sa setElementArenaEnabled()
+ */
+inline bool MediaFileInfo::isElementArenaEnabled() const
+{
+    return m_elementArenaEnabled;
+}
+
+/*!
+ * \brief Sets whether the elements of MP4 and Matroska files are allocated within an arena owned by the container.
+ *
+ * Parsing big files creates a huge number of elements. If enabled, they are not allocated individually but within
+ * big blocks which are released at once when the parsing results are cleared. See ElementArena for details. The
+ * blocks are kept for parsing the next time (see reset()); they are only freed when the MediaFileInfo is destroyed.
+ *
+ * This is disabled by default.
+ *
+ * \remarks The setting is applied next time parsing. The current parsing results are not mutated.
+ * \sa isElementArenaEnabled()
+ */
+inline void MediaFileInfo::setElementArenaEnabled(bool enabled)
+{
+    m_elementArenaEnabled = enabled;
+}
+
+/*!
+ * \brief Returns whether statistics are collected.
+ * \sa setStatisticsEnabled()
+ */
+inline bool MediaFileInfo::isStatisticsEnabled() const
+{
+    return m_statistics != nullptr;
+}
+
+/*!
+ * \brief Returns the statistics collected so far or nullptr if statistics are not enabled.
+ * \sa setStatisticsEnabled()
+ */
+inline const MediaFileStatistics *MediaFileInfo::statistics() const
+{
+    return m_statistics.get();
+}
+
+/*!
+ * \brief Returns the statistics collected so far or nullptr if statistics are not enabled.
+ * \remarks The containers record the phases of applying changes via this function (see ApplyPhaseTimer).
+ * \sa setStatisticsEnabled()
+ */
+inline MediaFileStatistics *MediaFileInfo::statistics()
+{
+    return m_statistics.get();
+}
+
+/*!
+ * \brief Returns whether I/O operations are recorded in MediaFileStatistics::ioTrace.
+ * \sa setIoTracingEnabled()
+ */
+inline bool MediaFileInfo::isIoTracingEnabled() const
+{
+    return m_ioTracingEnabled;
+}
+
+/*!
+ * \brief Returns how the last call of applyChanges() has modified the file.
+ *
+ * The result tells the strategy the maker has chosen (in-place, in-place absorbing the size difference by the padding
+ * or rewriting the file), the padding before and after, the number of bytes written and copied and whether creating
+ * the backup file had to copy the original file. See ApplyChangesResult for details. This is useful to tune the
+ * padding settings (see setMinPadding(), setMaxPadding() and setPreferredPadding()).
+ *
+ * 
+emarks
+ * - The I/O is counted even if statistics are disabled (see setStatisticsEnabled()).
+ * - If applyChanges() fails, the result is only partially populated.
+ */
+inline const ApplyChangesResult &MediaFileInfo::applyChangesResult() const
+{
+    return m_applyChangesResult;
+}
+
+/*!
+ * \brief Returns the account of the memory allocated for the parsing results.
+ *
+ * The account tracks the current, peak and total number of bytes of the structures which grow with the file (see
+ * MemoryAccount for details). It is reset when the parsing results are cleared so the numbers refer to the current
+ * parse.
+ *
+ * \sa setMemoryLimit()
+ */
+inline const MemoryAccount &MediaFileInfo::memoryAccount() const
+{
+    return m_memoryAccount;
+}
+
+/*!
+ * \brief Returns the limit of the memory allocated for the parsing results in bytes; zero means unlimited.
+ * \sa setMemoryLimit()
+ */
+inline std::uint64_t MediaFileInfo::memoryLimit() const
+{
+    return m_memoryAccount.limit();
+}
+
+/*!
+ * \brief Sets the limit of the memory allocated for the parsing results in bytes; zero means unlimited (the default).
+ *
+ * When parsing would exceed the limit, the current parse phase is aborted: its parsing status is set to
+ * ParsingStatus::CriticalFailure and a critical message is added to the diagnostics. Subsequent phases fail the same
+ * way until the parsing results are cleared. This allows rejecting pathological files (e.g. Ogg files with millions
+ * of pages) before they exhaust the memory.
+ *
+ * \remarks
+ * - The limit does not apply to applying changes.
+ * - The limit applies to the structures accounted by MemoryAccount only, so the actual memory usage is higher. The
+ *   peak of previously parsed files (see memoryAccount()) is a good hint for choosing a limit.
+ */
+inline void MediaFileInfo::setMemoryLimit(std::uint64_t limit)
+{
+    m_memoryAccount.setLimit(limit);
+}
+
+/*!
+ * \brief Returns the limits for rejecting files which are excessively slow or expensive to parse.
+ * \sa setParseLimits()
+ */
+inline const ParseLimits &MediaFileInfo::parseLimits() const
+{
+    return m_parseLimits;
+}
+
+/*!
+ * \brief Sets the limits for rejecting files which are excessively slow or expensive to parse (see ParseLimits).
+ * \remarks The limits are passed to the container when parsing the container format, so they need to be set before.
+ */
+inline void MediaFileInfo::setParseLimits(const ParseLimits &limits)
+{
+    m_parseLimits = limits;
+}
+
 /*!
  * \brief Returns whether forcing rewriting (when applying changes) is enabled.
  */
@@ -473,6 +1236,74 @@ inline void MediaFileInfo::setForceRewrite(bool forceRewrite)
     m_forceRewrite = forceRewrite;
 }
 
+/*!
+ * \brief Returns whether applying changes in-place is enforced.
+ * \sa setForceInPlace()
+ */
+inline bool MediaFileInfo::isForcingInPlace() const
+{
+    return m_forceInPlace;
+}
+
+/*!
+ * \brief Sets whether applying changes in-place is enforced.
+ *
+ * When enabled, applyChanges() only overwrites the region holding the tags and the padding. No backup file is created
+ * and media data is never copied. If that is not possible (e.g. the new tags do not fit into the existing padding, the
+ * container format does not support it or a save file path has been set), applyChanges() fails with a
+ * RewriteRequiredException before the file is modified. The modified range is synced to the disk before applyChanges()
+ * returns unless a different durabilityPolicy() has been set.
+ *
+ * \remarks
+ * - isForcingRewrite() is ignored when enabled.
+ * - The min. and max. padding are not enforced as long as the existing padding can be used.
+ * - Currently only supported for Matroska, MP4, MP3 and FLAC files.
+ */
+inline void MediaFileInfo::setForceInPlace(bool forceInPlace)
+{
+    m_forceInPlace = forceInPlace;
+}
+
+/*!
+ * \brief Returns whether applyChanges() leaves the file untouched if nothing has been modified.
+ * \sa setSkipUnmodified()
+ */
+inline bool MediaFileInfo::isSkippingUnmodified() const
+{
+    return m_skipUnmodified;
+}
+
+/*!
+ * \brief Sets whether applyChanges() leaves the file untouched if nothing has been modified.
+ *
+ * When enabled, applyChanges() returns right away (keeping the parsing results) if changes() returns
+ * MediaFileChanges::None. This saves re-serializing the tags and writing the file when e.g. a tagging tool applies the
+ * same values to a whole library of which only a few files actually differ.
+ *
+ * \remarks
+ * - Disabled by default as applyChanges() might otherwise also be used to normalize a file (e.g. to update the padding
+ *   or to write tags in a different format).
+ * - The file is written nevertheless if isForcingRewrite() is enabled or a saveFilePath() has been set. makeFaststart()
+ *   is not affected either.
+ * - The tag and index positions are not enforced in case the file is left untouched even if forceTagPosition() or
+ *   forceIndexPosition() is enabled.
+ * - The modifications are tracked conservatively; e.g. obtaining non-const access to the fields of a tag via
+ *   FieldMapBasedTag::fields() marks the tag as modified.
+ */
+inline void MediaFileInfo::setSkipUnmodified(bool skipUnmodified)
+{
+    m_skipUnmodified = skipUnmodified;
+}
+
+/*!
+ * \brief Returns whether any part of the file has been modified since it has been parsed.
+ * \sa changes()
+ */
+inline bool MediaFileInfo::isModified() const
+{
+    return changes() != MediaFileChanges::None;
+}
+
 /*!
  * \brief Returns the minimum padding to be written before the data blocks when applying changes.
  *
@@ -549,6 +1380,29 @@ inline void MediaFileInfo::setPreferredPadding(std::size_t preferredPadding)
     m_preferredPadding = preferredPadding;
 }
 
+/*!
+ * \brief Returns the policy determining the padding when applying changes.
+ * \sa setPaddingPolicy()
+ */
+inline const std::shared_ptr<PaddingPolicy> &MediaFileInfo::paddingPolicy() const
+{
+    return m_paddingPolicy;
+}
+
+/*!
+ * \brief Sets the policy determining the padding when applying changes.
+ *
+ * If a policy is set, applyChanges() asks it for the padding settings instead of using minPadding(), maxPadding()
+ * and preferredPadding() directly; these are passed to the policy and are not altered. Set nullptr (the default)
+ * to use the static settings.
+ *
+ * \sa PaddingPolicy and AdaptivePaddingPolicy
+ */
+inline void MediaFileInfo::setPaddingPolicy(const std::shared_ptr<PaddingPolicy> &paddingPolicy)
+{
+    m_paddingPolicy = paddingPolicy;
+}
+
 /*!
  * \brief Returns the position (in the output file) where the tag information is written when applying changes.
  * \sa setTagPosition()
@@ -567,6 +1421,9 @@ inline ElementPosition MediaFileInfo::tagPosition() const
  *    might not be used if forceTagPosition() is false.
  *  - However if the specified position is not supported by the container/tag format or by the implementation
  *    for the format it is ignored (even if forceTagPosition() is true).
+ *  - For MP3 files ElementPosition::AfterData means the ID3v2 tag is appended as ID3v2.4 tag with footer (in front of
+ *    the ID3v1 tag) so the MPEG audio frames never need to be moved. This is only supported if there is a single ID3v2
+ *    tag with fields and its version is 2.4.
  *  - Default value is ElementPosition::BeforeData
  */
 inline void MediaFileInfo::setTagPosition(ElementPosition tagPosition)
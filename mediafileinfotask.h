@@ -0,0 +1,268 @@
+#ifndef TAG_PARSER_MEDIAFILEINFOTASK_H
+#define TAG_PARSER_MEDIAFILEINFOTASK_H
+
+#include "./mediafileinfo.h"
+#include "./progressfeedback.h"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+/// \brief Defined if MediaFileInfoTask is available (requires compiling with C++20 coroutine support).
+#define TAG_PARSER_HAS_COROUTINES
+
+namespace TagParser {
+
+/*!
+ * \brief The MediaFileInfoTask class is a coroutine which performs an operation on a MediaFileInfo object step by step.
+ *
+ * The task is a cooperative stepping wrapper around the blocking functions of MediaFileInfo: Each step calls e.g.
+ * MediaFileInfo::parseTracks() on the thread resuming the task and returns once that call has returned. No I/O is performed
+ * asynchronously; the task only allows splitting an operation into steps which can be interleaved with other work.
+ *
+ * A task is created by parseEverythingStepwise() or applyChangesStepwise() and does nothing until it is resumed or awaited:
+ * - Calling resume() performs the next step (e.g. parsing the tracks) and returns whether further steps are pending. So
+ *   an event loop can interleave the steps of many files on a few threads, e.g. by posting a handler which resumes the task
+ *   again until it is done.
+ * - Awaiting the task from another coroutine performs all remaining steps and resumes the awaiting coroutine afterwards.
+ *
+ * Before each step AbortableProgressFeedback::isAborted() is checked; if the operation has been aborted, the task
+ * finishes with OperationAbortedException. The exception of a failed step is rethrown by resume() or when awaiting.
+ *
+ * \remarks
+ * - The library is built as C++17 so the task is header-only and only available when the including code is compiled
+ *   with coroutine support (see TAG_PARSER_HAS_COROUTINES).
+ * - A step blocks for as long as the underlying MediaFileInfo function does. For parsing many files, reading their head and
+ *   tail upfront via AsyncFileReader (see BatchParser::setAsyncReadingEnabled()) keeps the steps short.
+ */
+class MediaFileInfoTask {
+public:
+    struct promise_type;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    /// \cond
+    struct FinalAwaiter {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+        std::coroutine_handle<> await_suspend(Handle handle) noexcept
+        {
+            const auto continuation = handle.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+    struct StepAwaiter {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+        bool await_suspend(Handle handle) const noexcept
+        {
+            // suspend only if steps are performed via resume(); continue right away when awaited
+            return !handle.promise().continuation;
+        }
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+    struct promise_type {
+        MediaFileInfoTask get_return_object()
+        {
+            return MediaFileInfoTask(Handle::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() const noexcept
+        {
+            return {};
+        }
+        FinalAwaiter final_suspend() const noexcept
+        {
+            return {};
+        }
+        void return_void() const noexcept
+        {
+        }
+        void unhandled_exception() noexcept
+        {
+            exception = std::current_exception();
+        }
+
+        std::coroutine_handle<> continuation;
+        std::exception_ptr exception;
+    };
+    /// \endcond
+
+    MediaFileInfoTask(MediaFileInfoTask &&other) noexcept;
+    MediaFileInfoTask(const MediaFileInfoTask &) = delete;
+    MediaFileInfoTask &operator=(MediaFileInfoTask &&other) noexcept;
+    MediaFileInfoTask &operator=(const MediaFileInfoTask &) = delete;
+    ~MediaFileInfoTask();
+
+    bool isDone() const;
+    bool resume();
+    static StepAwaiter nextStep();
+
+    bool await_ready() const noexcept;
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept;
+    void await_resume() const;
+
+private:
+    explicit MediaFileInfoTask(Handle handle);
+
+    Handle m_handle;
+};
+
+/*!
+ * \brief Constructs a task for the specified coroutine \a handle.
+ */
+inline MediaFileInfoTask::MediaFileInfoTask(Handle handle)
+    : m_handle(handle)
+{
+}
+
+/*!
+ * \brief Moves the coroutine of \a other into a new task.
+ */
+inline MediaFileInfoTask::MediaFileInfoTask(MediaFileInfoTask &&other) noexcept
+    : m_handle(std::exchange(other.m_handle, nullptr))
+{
+}
+
+/*!
+ * \brief Destroys the coroutine of the task replacing it with the one of \a other.
+ */
+inline MediaFileInfoTask &MediaFileInfoTask::operator=(MediaFileInfoTask &&other) noexcept
+{
+    if (this != &other) {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+        m_handle = std::exchange(other.m_handle, nullptr);
+    }
+    return *this;
+}
+
+/*!
+ * \brief Destroys the task and its coroutine; pending steps are not performed anymore.
+ */
+inline MediaFileInfoTask::~MediaFileInfoTask()
+{
+    if (m_handle) {
+        m_handle.destroy();
+    }
+}
+
+/*!
+ * \brief Returns whether all steps have been performed (or the task failed).
+ */
+inline bool MediaFileInfoTask::isDone() const
+{
+    return !m_handle || m_handle.done();
+}
+
+/*!
+ * \brief Performs the next step of the task.
+ * \returns Returns whether further steps are pending.
+ * \throws Throws the exception the task failed with once it is done, e.g. OperationAbortedException or a parsing exception.
+ */
+inline bool MediaFileInfoTask::resume()
+{
+    if (isDone()) {
+        return false;
+    }
+    m_handle.resume();
+    if (!m_handle.done()) {
+        return true;
+    }
+    if (auto &exception = m_handle.promise().exception) {
+        std::rethrow_exception(std::exchange(exception, nullptr));
+    }
+    return false;
+}
+
+/*!
+ * \brief Returns an awaitable which suspends the task until the next call of resume(); used between the steps of a task.
+ */
+inline MediaFileInfoTask::StepAwaiter MediaFileInfoTask::nextStep()
+{
+    return StepAwaiter();
+}
+
+/*!
+ * \brief Returns whether the task is done so awaiting it does not need to suspend.
+ */
+inline bool MediaFileInfoTask::await_ready() const noexcept
+{
+    return isDone();
+}
+
+/*!
+ * \brief Performs the remaining steps of the task and resumes the \a awaiting coroutine afterwards.
+ */
+inline std::coroutine_handle<> MediaFileInfoTask::await_suspend(std::coroutine_handle<> awaiting) noexcept
+{
+    m_handle.promise().continuation = awaiting;
+    return m_handle;
+}
+
+/*!
+ * \brief Rethrows the exception the task failed with (if any).
+ */
+inline void MediaFileInfoTask::await_resume() const
+{
+    if (m_handle && m_handle.promise().exception) {
+        std::rethrow_exception(m_handle.promise().exception);
+    }
+}
+
+/*!
+ * \brief Returns a task which parses everything like MediaFileInfo::parseEverything() does.
+ *
+ * The steps are parsing the container format, the tracks, the tags, the chapters and the attachments.
+ */
+inline MediaFileInfoTask parseEverythingStepwise(MediaFileInfo &fileInfo, Diagnostics &diag, AbortableProgressFeedback &progress)
+{
+    progress.stopIfAborted();
+    fileInfo.parseContainerFormat(diag);
+    co_await MediaFileInfoTask::nextStep();
+    progress.stopIfAborted();
+    fileInfo.parseTracks(diag);
+    co_await MediaFileInfoTask::nextStep();
+    progress.stopIfAborted();
+    fileInfo.parseTags(diag);
+    co_await MediaFileInfoTask::nextStep();
+    progress.stopIfAborted();
+    fileInfo.parseChapters(diag);
+    co_await MediaFileInfoTask::nextStep();
+    progress.stopIfAborted();
+    fileInfo.parseAttachments(diag);
+}
+
+/*!
+ * \brief Returns a task which applies changes like MediaFileInfo::applyChanges() does.
+ *
+ * Everything which has not been parsed yet is parsed in steps like parseEverythingStepwise() does before changes are
+ * applied in the last step. Applying the changes checks \a progress for being aborted as usual.
+ */
+inline MediaFileInfoTask applyChangesStepwise(MediaFileInfo &fileInfo, Diagnostics &diag, AbortableProgressFeedback &progress)
+{
+    for (auto parsing = parseEverythingStepwise(fileInfo, diag, progress); parsing.resume();) {
+        co_await MediaFileInfoTask::nextStep();
+    }
+    co_await MediaFileInfoTask::nextStep();
+    progress.stopIfAborted();
+    fileInfo.applyChanges(diag, progress);
+}
+
+} // namespace TagParser
+
+#endif // defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#endif // TAG_PARSER_MEDIAFILEINFOTASK_H
@@ -0,0 +1,143 @@
+#include "./mediafilesnapshot.h"
+#include "./abstractattachment.h"
+#include "./abstractchapter.h"
+#include "./mediafileinfo.h"
+#include "./tag.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+/*!
+ * \brief Returns the first value of the specified \a field or an empty value if the tag has no such field.
+ */
+const TagValue &SnapshotTag::value(KnownField field) const
+{
+    const auto &fieldValues = values(field);
+    return fieldValues.empty() ? TagValue::empty() : fieldValues.front();
+}
+
+/*!
+ * \brief Returns the values of the specified \a field (empty if the tag has no such field).
+ */
+const std::vector<TagValue> &SnapshotTag::values(KnownField field) const
+{
+    static const auto noValues = std::vector<TagValue>();
+    const auto i = lower_bound(
+        fields.cbegin(), fields.cend(), field, [](const SnapshotTagField &snapshotField, KnownField value) { return snapshotField.field < value; });
+    return i != fields.cend() && i->field == field ? i->values : noValues;
+}
+
+/*!
+ * \class TagParser::MediaFileSnapshot
+ * \brief The MediaFileSnapshot class holds the parsing results of a MediaFileInfo object as immutable copy.
+ *
+ * A MediaFileInfo object is not suitable to be queried from many threads at the same time: its getters and the
+ * getters of the tags and elements might load data lazily (e.g. cover art assigned via TagValue::assignLazyData() or
+ * buffers of the element tree) and they read from the file stream. A snapshot is detached from the MediaFileInfo
+ * object and its stream instead:
+ * - The tracks, chapters and attachments are stored as plain values (like in a CachedParseResult).
+ * - The tags are stored as copies of their values. In contrast to CachedParseResult values are kept as TagValue
+ *   (so e.g. pictures, descriptions and locales are preserved) and lazily loaded data is loaded when taking the
+ *   snapshot. Values referring to a shared parse buffer keep referring to it; that buffer is never modified.
+ *
+ * Hence a snapshot is never modified after fromFileInfo() returned. It can be shared via the returned pointer between
+ * any number of threads and all const functions may be called concurrently without locking. The MediaFileInfo object
+ * can be closed or destroyed afterwards.
+ *
+ * \remarks The data of attachments is only copied up to the size passed to fromFileInfo() as attachments might be huge.
+ */
+
+/*!
+ * \brief Takes a snapshot of the specified \a fileInfo which has already been parsed.
+ * \param maxAttachmentDataSize Specifies the maximum size of attachments which data is copied into the snapshot.
+ * \remarks The stream of \a fileInfo must still be open as lazily loaded data is read from it.
+ * \throws Throws std::ios_base::failure when an IO error occurs when loading data.
+ */
+std::shared_ptr<const MediaFileSnapshot> MediaFileSnapshot::fromFileInfo(const MediaFileInfo &fileInfo, std::uint64_t maxAttachmentDataSize)
+{
+    auto snapshot = std::shared_ptr<MediaFileSnapshot>(new MediaFileSnapshot());
+    snapshot->m_path = fileInfo.path();
+    snapshot->m_size = fileInfo.size();
+    snapshot->m_containerFormat = fileInfo.containerFormat();
+    snapshot->m_parsingFlags = fileInfo.parsingFlags();
+    snapshot->m_mimeType = fileInfo.mimeType();
+    snapshot->m_duration = fileInfo.duration();
+
+    const auto tracks = fileInfo.tracks();
+    snapshot->m_tracks.reserve(tracks.size());
+    for (const auto *const track : tracks) {
+        snapshot->m_tracks.emplace_back(CachedTrack::fromTrack(*track));
+    }
+
+    const auto tags = fileInfo.tags();
+    snapshot->m_tags.reserve(tags.size());
+    for (const auto *const tag : tags) {
+        auto &snapshotTag = snapshot->m_tags.emplace_back();
+        snapshotTag.type = tag->type();
+        snapshotTag.typeName = tag->typeName();
+        snapshotTag.target = tag->target();
+        for (auto field = firstKnownField; field != KnownField::Invalid; field = nextKnownField(field)) {
+            auto values = std::vector<TagValue>();
+            for (const auto *const value : tag->values(field)) {
+                if (value->isEmpty()) {
+                    continue;
+                }
+                // load lazily assigned data now to prevent modifying the value when it is accessed concurrently
+                values.emplace_back(*value).loadData();
+            }
+            if (!values.empty()) {
+                snapshotTag.fields.emplace_back(SnapshotTagField{ field, std::move(values) });
+            }
+        }
+    }
+
+    for (const auto *const chapter : fileInfo.chapters()) {
+        CachedChapter::appendChapter(snapshot->m_chapters, *chapter);
+    }
+
+    const auto attachments = fileInfo.attachments();
+    snapshot->m_attachments.reserve(attachments.size());
+    for (const auto *const attachment : attachments) {
+        auto &snapshotAttachment = snapshot->m_attachments.emplace_back();
+        snapshotAttachment.id = attachment->id();
+        snapshotAttachment.name = attachment->name();
+        snapshotAttachment.mimeType = attachment->mimeType();
+        snapshotAttachment.description = attachment->description();
+        const auto *const data = attachment->data();
+        if (!data) {
+            continue;
+        }
+        snapshotAttachment.dataSize = static_cast<std::uint64_t>(data->size());
+        if (snapshotAttachment.dataSize > maxAttachmentDataSize) {
+            continue;
+        }
+        snapshotAttachment.data.resize(static_cast<std::size_t>(snapshotAttachment.dataSize));
+        if (data->buffer()) {
+            copy(data->buffer().get(), data->buffer().get() + snapshotAttachment.dataSize, snapshotAttachment.data.begin());
+        } else {
+            data->stream().seekg(data->startOffset());
+            data->stream().read(snapshotAttachment.data.data(), static_cast<streamsize>(snapshotAttachment.dataSize));
+        }
+    }
+    return snapshot;
+}
+
+/*!
+ * \brief Returns the first value of the specified \a field found within the tags or an empty value if none of the tags
+ *        has such a field.
+ */
+const TagValue &MediaFileSnapshot::tagValue(KnownField field) const
+{
+    for (const auto &tag : m_tags) {
+        if (const auto &value = tag.value(field); !value.isEmpty()) {
+            return value;
+        }
+    }
+    return TagValue::empty();
+}
+
+} // namespace TagParser
@@ -0,0 +1,167 @@
+#ifndef TAG_PARSER_MEDIAFILESNAPSHOT_H
+#define TAG_PARSER_MEDIAFILESNAPSHOT_H
+
+#include "./parseresultcache.h"
+#include "./tagtarget.h"
+#include "./tagvalue.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace TagParser {
+
+class MediaFileInfo;
+
+/*!
+ * \brief The SnapshotTagField struct holds the values of a field of a tag stored within a MediaFileSnapshot.
+ */
+struct TAG_PARSER_EXPORT SnapshotTagField {
+    KnownField field = KnownField::Invalid;
+    /// \brief The non-empty values of the field (with all data loaded).
+    std::vector<TagValue> values;
+};
+
+/*!
+ * \brief The SnapshotTag struct holds a tag stored within a MediaFileSnapshot.
+ */
+struct TAG_PARSER_EXPORT SnapshotTag {
+    const TagValue &value(KnownField field) const;
+    const std::vector<TagValue> &values(KnownField field) const;
+
+    TagType type = TagType::Unspecified;
+    /// \brief The name of the tag type (see Tag::typeName()); points to a string literal.
+    const char *typeName = "unspecified";
+    TagTarget target;
+    /// \brief The fields of the tag ordered by KnownField (fields without values are omitted).
+    std::vector<SnapshotTagField> fields;
+};
+
+/*!
+ * \brief The SnapshotAttachment struct holds an attachment stored within a MediaFileSnapshot.
+ */
+struct TAG_PARSER_EXPORT SnapshotAttachment {
+    std::uint64_t id = 0;
+    std::string name;
+    std::string mimeType;
+    std::string description;
+    std::uint64_t dataSize = 0;
+    /// \brief The data of the attachment; empty if it has not been copied (see MediaFileSnapshot::fromFileInfo()).
+    std::string data;
+};
+
+class TAG_PARSER_EXPORT MediaFileSnapshot {
+public:
+    static std::shared_ptr<const MediaFileSnapshot> fromFileInfo(const MediaFileInfo &fileInfo, std::uint64_t maxAttachmentDataSize = 0);
+
+    const std::string &path() const;
+    std::uint64_t size() const;
+    ContainerFormat containerFormat() const;
+    ParsingFlags parsingFlags() const;
+    const std::string &mimeType() const;
+    CppUtilities::TimeSpan duration() const;
+    const std::vector<CachedTrack> &tracks() const;
+    const std::vector<SnapshotTag> &tags() const;
+    const TagValue &tagValue(KnownField field) const;
+    const std::vector<CachedChapter> &chapters() const;
+    const std::vector<SnapshotAttachment> &attachments() const;
+
+private:
+    MediaFileSnapshot() = default;
+
+    std::string m_path;
+    std::uint64_t m_size = 0;
+    ContainerFormat m_containerFormat = ContainerFormat::Unknown;
+    ParsingFlags m_parsingFlags = ParsingFlags::None;
+    std::string m_mimeType;
+    CppUtilities::TimeSpan m_duration;
+    std::vector<CachedTrack> m_tracks;
+    std::vector<SnapshotTag> m_tags;
+    std::vector<CachedChapter> m_chapters;
+    std::vector<SnapshotAttachment> m_attachments;
+};
+
+/*!
+ * \brief Returns the path of the file the snapshot has been taken from.
+ */
+inline const std::string &MediaFileSnapshot::path() const
+{
+    return m_path;
+}
+
+/*!
+ * \brief Returns the size of the file in byte at the time the snapshot has been taken.
+ */
+inline std::uint64_t MediaFileSnapshot::size() const
+{
+    return m_size;
+}
+
+/*!
+ * \brief Returns the container format of the file.
+ */
+inline ContainerFormat MediaFileSnapshot::containerFormat() const
+{
+    return m_containerFormat;
+}
+
+/*!
+ * \brief Returns the flags the file has been parsed with (so it is known which parts are missing).
+ */
+inline ParsingFlags MediaFileSnapshot::parsingFlags() const
+{
+    return m_parsingFlags;
+}
+
+/*!
+ * \brief Returns the MIME type of the file.
+ */
+inline const std::string &MediaFileSnapshot::mimeType() const
+{
+    return m_mimeType;
+}
+
+/*!
+ * \brief Returns the overall duration of the file.
+ */
+inline CppUtilities::TimeSpan MediaFileSnapshot::duration() const
+{
+    return m_duration;
+}
+
+/*!
+ * \brief Returns the tracks of the file.
+ */
+inline const std::vector<CachedTrack> &MediaFileSnapshot::tracks() const
+{
+    return m_tracks;
+}
+
+/*!
+ * \brief Returns the tags of the file in the order MediaFileInfo::tags() returns them.
+ */
+inline const std::vector<SnapshotTag> &MediaFileSnapshot::tags() const
+{
+    return m_tags;
+}
+
+/*!
+ * \brief Returns the chapters of the file; nested chapters follow their parent and have a greater depth.
+ */
+inline const std::vector<CachedChapter> &MediaFileSnapshot::chapters() const
+{
+    return m_chapters;
+}
+
+/*!
+ * \brief Returns the attachments of the file.
+ */
+inline const std::vector<SnapshotAttachment> &MediaFileSnapshot::attachments() const
+{
+    return m_attachments;
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_MEDIAFILESNAPSHOT_H
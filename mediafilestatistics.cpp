@@ -0,0 +1,276 @@
+#include "./mediafilestatistics.h"
+
+#include <c++utilities/conversion/stringbuilder.h>
+#include <c++utilities/conversion/stringconversion.h>
+
+#include <cstdio>
+#include <numeric>
+#include <vector>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+/// \cond
+namespace {
+
+constexpr const char *parsePhaseNames[] = { "container format", "tracks", "tags", "chapters", "attachments" };
+constexpr const char *applyPhaseNames[] = { "layout", "backup", "copy", "sync" };
+
+std::string durationToString(std::chrono::nanoseconds duration)
+{
+    char buffer[32];
+    const auto milliseconds = static_cast<double>(duration.count()) / 1e6;
+    if (milliseconds >= 1000.0) {
+        std::snprintf(buffer, sizeof(buffer), "%.2f s", milliseconds / 1000.0);
+    } else {
+        std::snprintf(buffer, sizeof(buffer), "%.2f ms", milliseconds);
+    }
+    return buffer;
+}
+
+/*!
+ * \brief The ReadTimer class adds the time it is alive to MediaFileStatistics::readTime.
+ */
+class ReadTimer {
+public:
+    explicit ReadTimer(MediaFileStatistics &statistics)
+        : m_statistics(statistics)
+        , m_start(chrono::steady_clock::now())
+    {
+    }
+    ~ReadTimer()
+    {
+        m_statistics.readTime += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - m_start);
+    }
+
+private:
+    MediaFileStatistics &m_statistics;
+    chrono::steady_clock::time_point m_start;
+};
+
+} // namespace
+/// \endcond
+
+/*!
+ * \struct TagParser::MediaFileStatistics
+ *
+ * The statistics are meant to find out why a particular file is slow to parse or to apply changes to, e.g. because
+ * many small reads or seeks are done or a big part of the file needs to be copied.
+ *
+ * \remarks
+ * - Only I/O done via the stream of the file is taken into account. Reads served from the memory-mapping (see
+ *   BasicFileInfo::setMemoryMappingEnabled()) do not show up. Copies done by the kernel (see FileRangeCopier) only
+ *   show up in bytesCopied.
+ * - Phases might be nested (e.g. tracks of FLAC files are parsed when parsing tags) so the times might overlap.
+ */
+
+/*!
+ * \brief Returns the time spent in all phases.
+ * \remarks Nested phases (see remarks of the struct) are counted twice.
+ */
+std::chrono::nanoseconds MediaFileStatistics::totalParseTime() const
+{
+    return accumulate(parseTimes.cbegin(), parseTimes.cend(), chrono::nanoseconds::zero());
+}
+
+/*!
+ * \brief Returns a human-readable summary of the times and the I/O for debugging.
+ *
+ * Example (exact format might change in the future!):
+ * "parsing: container format 1.20 ms, tracks 3.51 ms, tags 0.42 ms; applying changes: 40.12 s (layout 0.80 ms,
+ * backup 1.02 ms, copy 38.72 s, sync 1.31 s); read 1.2 MiB in 210 calls (2.13 ms) with 35 seeks; written 5 KiB, copied 3.4 GiB"
+ *
+ * Phases which have not been run are omitted. The time spent applying changes which is not covered by the phases is
+ * spent writing the new structures (e.g. tags and indexes).
+ *
+ * \sa MediaFileInfo::technicalSummary()
+ */
+std::string MediaFileStatistics::summary() const
+{
+    auto parts = vector<string>();
+    for (auto i = std::size_t(); i != parsePhaseCount; ++i) {
+        if (parseTimes[i] != chrono::nanoseconds::zero()) {
+            parts.emplace_back(argsToString(parsePhaseNames[i], ' ', durationToString(parseTimes[i])));
+        }
+    }
+    auto res = parts.empty() ? string() : "parsing: " + joinStrings(parts, ", ");
+    if (applyChangesTime != chrono::nanoseconds::zero()) {
+        parts.clear();
+        for (auto i = std::size_t(); i != applyPhaseCount; ++i) {
+            if (applyTimes[i] != chrono::nanoseconds::zero()) {
+                parts.emplace_back(argsToString(applyPhaseNames[i], ' ', durationToString(applyTimes[i])));
+            }
+        }
+        res += argsToString(res.empty() ? "" : "; ", "applying changes: ", durationToString(applyChangesTime));
+        if (!parts.empty()) {
+            res += argsToString(" (", joinStrings(parts, ", "), ')');
+        }
+    }
+    res += argsToString(res.empty() ? "" : "; ", "read ", dataSizeToString(bytesRead), " in ", readCalls, " calls");
+    if (readTime != chrono::nanoseconds::zero()) {
+        res += argsToString(" (", durationToString(readTime), ')');
+    }
+    res += argsToString(" with ", seeks, " seeks");
+    if (bytesWritten || bytesCopied) {
+        res += argsToString("; written ", dataSizeToString(bytesWritten), ", copied ", dataSizeToString(bytesCopied));
+    }
+    return res;
+}
+
+/*!
+ * \class TagParser::CountingStreamBuffer
+ * \brief The CountingStreamBuffer class forwards all operations to another buffer and records them in MediaFileStatistics.
+ *
+ * The buffer does not buffer anything on its own so it can be installed on a stream (via std::ios::rdbuf()) and removed
+ * again at any time. Every operation results in a virtual call though so it is only installed when statistics are
+ * enabled.
+ *
+ * If tracing is enabled, the buffer keeps track of the position of the stream so the offset of each operation can be
+ * recorded without querying the target each time.
+ */
+
+/*!
+ * \brief Returns the current position of the target, querying it only if it is not known.
+ */
+std::uint64_t CountingStreamBuffer::position()
+{
+    if (!m_positionKnown) {
+        const auto position = m_target.pubseekoff(0, ios_base::cur, ios_base::in);
+        m_position = position == pos_type(off_type(-1)) ? 0 : static_cast<std::uint64_t>(static_cast<off_type>(position));
+        m_positionKnown = true;
+    }
+    return m_position;
+}
+
+/*!
+ * \brief Records the specified \a operation and advances the position by \a size.
+ */
+void CountingStreamBuffer::trace(IoOperation operation, std::uint64_t offset, std::uint64_t size)
+{
+    m_statistics.ioTrace.record(operation, offset, size);
+    m_position = offset + size;
+}
+
+/*!
+ * \brief Updates the position after seeking to the specified \a position.
+ */
+void CountingStreamBuffer::tracePosition(pos_type position)
+{
+    if ((m_positionKnown = position != pos_type(off_type(-1)))) {
+        m_position = static_cast<std::uint64_t>(static_cast<off_type>(position));
+    }
+}
+
+CountingStreamBuffer::int_type CountingStreamBuffer::underflow()
+{
+    const auto timer = ReadTimer(m_statistics);
+    return m_target.sgetc();
+}
+
+CountingStreamBuffer::int_type CountingStreamBuffer::uflow()
+{
+    const auto offset = m_tracing ? position() : 0;
+    const auto timer = ReadTimer(m_statistics);
+    const auto c = m_target.sbumpc();
+    ++m_statistics.readCalls;
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        ++m_statistics.bytesRead;
+        if (m_tracing) {
+            trace(IoOperation::Read, offset, 1);
+        }
+    }
+    return c;
+}
+
+std::streamsize CountingStreamBuffer::xsgetn(char_type *buffer, std::streamsize count)
+{
+    const auto offset = m_tracing ? position() : 0;
+    const auto timer = ReadTimer(m_statistics);
+    const auto bytesRead = m_target.sgetn(buffer, count);
+    ++m_statistics.readCalls;
+    m_statistics.bytesRead += static_cast<std::uint64_t>(bytesRead);
+    if (m_tracing) {
+        trace(IoOperation::Read, offset, static_cast<std::uint64_t>(bytesRead));
+    }
+    return bytesRead;
+}
+
+std::streamsize CountingStreamBuffer::showmanyc()
+{
+    return m_target.in_avail();
+}
+
+CountingStreamBuffer::int_type CountingStreamBuffer::pbackfail(int_type c)
+{
+    m_positionKnown = false;
+    return traits_type::eq_int_type(c, traits_type::eof()) ? m_target.sungetc() : m_target.sputbackc(traits_type::to_char_type(c));
+}
+
+CountingStreamBuffer::int_type CountingStreamBuffer::overflow(int_type c)
+{
+    if (traits_type::eq_int_type(c, traits_type::eof())) {
+        return traits_type::not_eof(c);
+    }
+    const auto offset = m_tracing ? position() : 0;
+    const auto res = m_target.sputc(traits_type::to_char_type(c));
+    if (!traits_type::eq_int_type(res, traits_type::eof())) {
+        ++m_statistics.bytesWritten;
+        if (m_tracing) {
+            trace(IoOperation::Write, offset, 1);
+        }
+    }
+    return res;
+}
+
+std::streamsize CountingStreamBuffer::xsputn(const char_type *buffer, std::streamsize count)
+{
+    const auto offset = m_tracing ? position() : 0;
+    const auto bytesWritten = m_target.sputn(buffer, count);
+    m_statistics.bytesWritten += static_cast<std::uint64_t>(bytesWritten);
+    if (m_tracing) {
+        trace(IoOperation::Write, offset, static_cast<std::uint64_t>(bytesWritten));
+    }
+    return bytesWritten;
+}
+
+CountingStreamBuffer::pos_type CountingStreamBuffer::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+    // don't count tellg()/tellp() which are implemented via seeking by 0 relative to the current position
+    const auto isSeek = off || dir != ios_base::cur;
+    if (isSeek) {
+        ++m_statistics.seeks;
+    }
+    const auto res = m_target.pubseekoff(off, dir, which);
+    if (m_tracing) {
+        tracePosition(res);
+        if (isSeek && m_positionKnown) {
+            m_statistics.ioTrace.record(IoOperation::Seek, m_position);
+        }
+    }
+    return res;
+}
+
+CountingStreamBuffer::pos_type CountingStreamBuffer::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+    ++m_statistics.seeks;
+    const auto res = m_target.pubseekpos(pos, which);
+    if (m_tracing) {
+        tracePosition(res);
+        if (m_positionKnown) {
+            m_statistics.ioTrace.record(IoOperation::Seek, m_position);
+        }
+    }
+    return res;
+}
+
+int CountingStreamBuffer::sync()
+{
+    if (m_tracing) {
+        m_statistics.ioTrace.record(IoOperation::Flush, position());
+    }
+    return m_target.pubsync();
+}
+
+} // namespace TagParser
@@ -0,0 +1,195 @@
+#ifndef TAG_PARSER_MEDIAFILESTATISTICS_H
+#define TAG_PARSER_MEDIAFILESTATISTICS_H
+
+#include "./iotrace.h"
+#include "./signature.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <streambuf>
+#include <string>
+
+namespace TagParser {
+
+/*!
+ * \brief The ParsePhase enum specifies the phases of parsing a file which are timed by MediaFileStatistics.
+ */
+enum class ParsePhase : std::uint8_t {
+    ContainerFormat, /**< MediaFileInfo::parseContainerFormat() */
+    Tracks, /**< MediaFileInfo::parseTracks() */
+    Tags, /**< MediaFileInfo::parseTags() */
+    Chapters, /**< MediaFileInfo::parseChapters() */
+    Attachments, /**< MediaFileInfo::parseAttachments() */
+};
+
+/// \brief The number of values of ParsePhase.
+constexpr std::size_t parsePhaseCount = 5;
+
+/*!
+ * \brief The ApplyPhase enum specifies the parts of applying changes which are timed by MediaFileStatistics.
+ */
+enum class ApplyPhase : std::uint8_t {
+    Layout, /**< calculating the layout of the new file (sizes, padding and whether the file needs to be rewritten) */
+    Backup, /**< creating the backup file when rewriting the file (see BackupHelper::createBackupFile()) */
+    Copy, /**< copying unchanged data (e.g. the media data) via FileRangeCopier */
+    Sync, /**< syncing the file to the disk according to MediaFileInfo::durabilityPolicy() */
+};
+
+/// \brief The number of values of ApplyPhase.
+constexpr std::size_t applyPhaseCount = 4;
+
+/*!
+ * \brief The MediaFileStatistics struct holds counters about parsing a file and applying changes to it.
+ * \sa MediaFileInfo::setStatisticsEnabled()
+ */
+struct TAG_PARSER_EXPORT MediaFileStatistics {
+    std::chrono::nanoseconds parseTime(ParsePhase phase) const;
+    std::chrono::nanoseconds totalParseTime() const;
+    std::chrono::nanoseconds applyTime(ApplyPhase phase) const;
+    std::string summary() const;
+
+    /// \brief The number of bytes read via the stream of the file.
+    std::uint64_t bytesRead = 0;
+    /// \brief The number of calls to read data from the stream of the file.
+    std::uint64_t readCalls = 0;
+    /// \brief The number of seeks on the stream of the file (determining the current position is not counted).
+    std::uint64_t seeks = 0;
+    /// \brief The time spent reading via the stream of the file (which includes waiting for the storage).
+    std::chrono::nanoseconds readTime = std::chrono::nanoseconds::zero();
+    /// \brief The number of bytes written via the stream of the file when applying changes.
+    std::uint64_t bytesWritten = 0;
+    /// \brief The number of bytes copied unchanged from the original file when applying changes (see FileRangeCopier).
+    std::uint64_t bytesCopied = 0;
+    /// \brief The number of bytes which have been written when applying changes, excluding copied bytes.
+    std::uint64_t bytesPatched = 0;
+    /// \brief The number of parsed elements by the format they belong to (e.g. MP4 atoms, EBML elements and ID3v2 frames).
+    std::map<ContainerFormat, std::uint64_t> parsedElements;
+    /// \brief The time spent in each ParsePhase (use parseTime() for a convenient access).
+    std::array<std::chrono::nanoseconds, parsePhaseCount> parseTimes = {};
+    /// \brief The time spent applying changes.
+    std::chrono::nanoseconds applyChangesTime = std::chrono::nanoseconds::zero();
+    /// \brief The time spent in each ApplyPhase (use applyTime() for a convenient access); part of applyChangesTime.
+    std::array<std::chrono::nanoseconds, applyPhaseCount> applyTimes = {};
+    /// \brief The I/O operations done via the stream of the file; only recorded if enabled (see MediaFileInfo::setIoTracingEnabled()).
+    IoTrace ioTrace;
+};
+
+/*!
+ * \brief Returns the time spent in the specified \a phase.
+ */
+inline std::chrono::nanoseconds MediaFileStatistics::parseTime(ParsePhase phase) const
+{
+    return parseTimes[static_cast<std::size_t>(phase)];
+}
+
+/*!
+ * \brief Returns the time spent in the specified \a phase of applying changes.
+ */
+inline std::chrono::nanoseconds MediaFileStatistics::applyTime(ApplyPhase phase) const
+{
+    return applyTimes[static_cast<std::size_t>(phase)];
+}
+
+/*!
+ * \brief The ApplyPhaseTimer class adds the time it is alive to the specified ApplyPhase of MediaFileStatistics.
+ * \remarks Does nothing if no statistics are specified so it can be used unconditionally.
+ */
+class TAG_PARSER_EXPORT ApplyPhaseTimer {
+public:
+    explicit ApplyPhaseTimer(MediaFileStatistics *statistics, ApplyPhase phase);
+    ApplyPhaseTimer(const ApplyPhaseTimer &) = delete;
+    ~ApplyPhaseTimer();
+
+    void stop();
+
+private:
+    MediaFileStatistics *m_statistics;
+    std::chrono::steady_clock::time_point m_start;
+    ApplyPhase m_phase;
+};
+
+/*!
+ * \brief Starts timing the specified \a phase.
+ */
+inline ApplyPhaseTimer::ApplyPhaseTimer(MediaFileStatistics *statistics, ApplyPhase phase)
+    : m_statistics(statistics)
+    , m_start(statistics ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point())
+    , m_phase(phase)
+{
+}
+
+/*!
+ * \brief Stops timing unless stop() has been called before.
+ */
+inline ApplyPhaseTimer::~ApplyPhaseTimer()
+{
+    stop();
+}
+
+/*!
+ * \brief Adds the time elapsed since the construction to the statistics; subsequent calls do nothing.
+ */
+inline void ApplyPhaseTimer::stop()
+{
+    if (m_statistics) {
+        m_statistics->applyTimes[static_cast<std::size_t>(m_phase)] += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start);
+        m_statistics = nullptr;
+    }
+}
+
+class TAG_PARSER_EXPORT CountingStreamBuffer : public std::streambuf {
+public:
+    explicit CountingStreamBuffer(std::streambuf &target, MediaFileStatistics &statistics, bool tracing = false);
+
+    std::streambuf &target();
+
+protected:
+    int_type underflow() override;
+    int_type uflow() override;
+    std::streamsize xsgetn(char_type *buffer, std::streamsize count) override;
+    std::streamsize showmanyc() override;
+    int_type pbackfail(int_type c) override;
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char_type *buffer, std::streamsize count) override;
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+    int sync() override;
+
+private:
+    std::uint64_t position();
+    void trace(IoOperation operation, std::uint64_t offset, std::uint64_t size = 0);
+    void tracePosition(pos_type position);
+
+    std::streambuf &m_target;
+    MediaFileStatistics &m_statistics;
+    std::uint64_t m_position;
+    bool m_positionKnown;
+    bool m_tracing;
+};
+
+/*!
+ * \brief Constructs a buffer forwarding to the specified \a target and recording I/O into the specified \a statistics.
+ * \remarks If \a tracing is enabled, the operations are recorded in MediaFileStatistics::ioTrace as well.
+ */
+inline CountingStreamBuffer::CountingStreamBuffer(std::streambuf &target, MediaFileStatistics &statistics, bool tracing)
+    : m_target(target)
+    , m_statistics(statistics)
+    , m_position(0)
+    , m_positionKnown(false)
+    , m_tracing(tracing)
+{
+}
+
+/*!
+ * \brief Returns the buffer all operations are forwarded to.
+ */
+inline std::streambuf &CountingStreamBuffer::target()
+{
+    return m_target;
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_MEDIAFILESTATISTICS_H
@@ -0,0 +1,228 @@
+#include "./mediapayloadhash.h"
+#include "./batchparser.h"
+
+#include <c++utilities/conversion/binaryconversion.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <istream>
+#include <thread>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+/// \cond
+namespace {
+
+constexpr std::uint64_t prime1 = 0x9E3779B185EBCA87ull;
+constexpr std::uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+constexpr std::uint64_t prime3 = 0x165667B19E3779F9ull;
+constexpr std::uint64_t prime4 = 0x85EBCA77C2B2AE63ull;
+constexpr std::uint64_t prime5 = 0x27D4EB2F165667C5ull;
+
+constexpr std::uint64_t rotateLeft(std::uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+constexpr std::uint64_t round(std::uint64_t accumulator, std::uint64_t input)
+{
+    return rotateLeft(accumulator + input * prime2, 31) * prime1;
+}
+
+constexpr std::uint64_t mergeRound(std::uint64_t accumulator, std::uint64_t value)
+{
+    return (accumulator ^ round(0, value)) * prime1 + prime4;
+}
+
+} // namespace
+/// \endcond
+
+/*!
+ * \class TagParser::MediaPayloadHasher
+ * \brief The MediaPayloadHasher class computes the hash of the media payload of a file.
+ *
+ * The containers add the ranges of the file which contain the actual media data (and no meta-data) via add() and
+ * addRange() when MediaFileInfo::hashMediaPayload() is called. So files which only differ in their tags (or in the
+ * layout of their meta-data) get the same hash.
+ *
+ * The payload is split into blocks of blockSize which are hashed via xxHash64(). The hash is the xxHash64() of the
+ * block hashes seeded with the size of the payload. Hence the blocks of large files can be hashed concurrently and the
+ * hash does not depend on parallelism() or on how the payload is split into ranges by the containers. The hash is not
+ * the same as the XXH64 of the payload itself, though.
+ *
+ * \remarks The data passed to add() and addRange() is copied into the blocks which are hashed when
+ *          2 * parallelism() blocks have been filled.
+ */
+
+/*!
+ * \brief Constructs a new hasher using the specified number of threads.
+ * \remarks A value of zero means the number of hardware threads is used.
+ */
+MediaPayloadHasher::MediaPayloadHasher(unsigned int parallelism)
+    : m_parallelism(parallelism ? parallelism : max(thread::hardware_concurrency(), 1u))
+    , m_blockCount(0)
+    , m_lastBlockSize(0)
+    , m_size(0)
+{
+    m_blocks.resize(m_parallelism > 1 ? m_parallelism * 2 : 1);
+}
+
+/*!
+ * \brief Adds the specified \a data to the payload.
+ */
+void MediaPayloadHasher::add(const char *data, std::size_t size)
+{
+    while (size) {
+        auto available = std::size_t();
+        auto *const buffer = reserveBlockSpace(available);
+        const auto count = min(available, size);
+        std::memcpy(buffer, data, count);
+        m_lastBlockSize += count;
+        m_size += count;
+        data += count;
+        size -= count;
+    }
+}
+
+/*!
+ * \brief Adds the data within [\a begin, \a end) of the specified \a stream to the payload.
+ * \remarks The data is read directly into the blocks.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+void MediaPayloadHasher::addRange(std::istream &stream, std::uint64_t begin, std::uint64_t end)
+{
+    if (end <= begin) {
+        return;
+    }
+    stream.seekg(static_cast<streamoff>(begin));
+    for (auto remaining = end - begin; remaining;) {
+        auto available = std::size_t();
+        auto *const buffer = reserveBlockSpace(available);
+        const auto count = static_cast<std::size_t>(min<std::uint64_t>(available, remaining));
+        stream.read(buffer, static_cast<streamsize>(count));
+        m_lastBlockSize += count;
+        m_size += count;
+        remaining -= count;
+    }
+}
+
+/*!
+ * \brief Returns the hash of the payload added so far and resets the hasher so it can be used for the next file.
+ */
+MediaPayloadHash MediaPayloadHasher::finish()
+{
+    if (m_blockCount) {
+        hashBlocks();
+    }
+    auto blockHashes = string(m_blockHashes.size() * sizeof(std::uint64_t), '\0');
+    for (auto i = std::size_t(); i != m_blockHashes.size(); ++i) {
+        for (auto byte = std::size_t(); byte != sizeof(std::uint64_t); ++byte) {
+            blockHashes[i * sizeof(std::uint64_t) + byte] = static_cast<char>(m_blockHashes[i] >> (byte * 8));
+        }
+    }
+    auto hash = MediaPayloadHash();
+    hash.value = xxHash64(blockHashes.data(), blockHashes.size(), m_size);
+    hash.size = m_size;
+    m_blockHashes.clear();
+    m_lastBlockSize = 0;
+    m_size = 0;
+    return hash;
+}
+
+/*!
+ * \brief Returns the XXH64 hash of the specified \a data.
+ * \remarks This is a portable implementation of the algorithm specified at https://github.com/Cyan4973/xxHash.
+ */
+std::uint64_t MediaPayloadHasher::xxHash64(const char *data, std::size_t size, std::uint64_t seed)
+{
+    const auto *const end = data + size;
+    auto hash = std::uint64_t();
+    if (size >= 32) {
+        std::uint64_t accumulators[4] = { seed + prime1 + prime2, seed + prime2, seed, seed - prime1 };
+        for (const auto *const limit = end - 32; data <= limit; data += 32) {
+            for (auto i = 0; i != 4; ++i) {
+                accumulators[i] = round(accumulators[i], LE::toUInt64(data + i * 8));
+            }
+        }
+        hash = rotateLeft(accumulators[0], 1) + rotateLeft(accumulators[1], 7) + rotateLeft(accumulators[2], 12)
+            + rotateLeft(accumulators[3], 18);
+        for (const auto accumulator : accumulators) {
+            hash = mergeRound(hash, accumulator);
+        }
+    } else {
+        hash = seed + prime5;
+    }
+    hash += size;
+    for (; end - data >= 8; data += 8) {
+        hash = rotateLeft(hash ^ round(0, LE::toUInt64(data)), 27) * prime1 + prime4;
+    }
+    if (end - data >= 4) {
+        hash = rotateLeft(hash ^ (static_cast<std::uint64_t>(LE::toUInt32(data)) * prime1), 23) * prime2 + prime3;
+        data += 4;
+    }
+    for (; data != end; ++data) {
+        hash = rotateLeft(hash ^ (static_cast<std::uint64_t>(static_cast<unsigned char>(*data)) * prime5), 11) * prime1;
+    }
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+/*!
+ * \brief Returns the space left within the current block (hashing the filled blocks first if necessary).
+ */
+char *MediaPayloadHasher::reserveBlockSpace(std::size_t &available)
+{
+    if (!m_blockCount || m_lastBlockSize == blockSize) {
+        if (m_blockCount == m_blocks.size()) {
+            hashBlocks();
+        }
+        // note: The blocks are only allocated once.
+        m_blocks[m_blockCount++].resize(blockSize);
+        m_lastBlockSize = 0;
+    }
+    available = blockSize - m_lastBlockSize;
+    return m_blocks[m_blockCount - 1].data() + m_lastBlockSize;
+}
+
+/*!
+ * \brief Hashes the filled blocks concurrently; only the last block might not be full.
+ */
+void MediaPayloadHasher::hashBlocks()
+{
+    const auto offset = m_blockHashes.size();
+    m_blockHashes.resize(offset + m_blockCount);
+    const auto hashBlock = [this, offset](std::size_t index) {
+        m_blockHashes[offset + index] = xxHash64(m_blocks[index].data(), index + 1 == m_blockCount ? m_lastBlockSize : blockSize);
+    };
+    if (m_blockCount > 1 && m_parallelism > 1) {
+        static const auto notAborted = atomic<bool>(false);
+        BatchParser::runConcurrently(m_blockCount, m_parallelism, notAborted, hashBlock);
+    } else {
+        for (auto index = std::size_t(); index != m_blockCount; ++index) {
+            hashBlock(index);
+        }
+    }
+    m_blockCount = 0;
+}
+
+/*!
+ * \brief Returns the hash as hexadecimal string of 16 digits.
+ */
+std::string MediaPayloadHash::toString() const
+{
+    auto string = std::string(16, '0');
+    for (auto i = std::size_t(); i != 16; ++i) {
+        string[15 - i] = "0123456789abcdef"[(value >> (i * 4)) & 0xF];
+    }
+    return string;
+}
+
+} // namespace TagParser
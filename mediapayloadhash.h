@@ -0,0 +1,88 @@
+#ifndef TAG_PARSER_MEDIAPAYLOADHASH_H
+#define TAG_PARSER_MEDIAPAYLOADHASH_H
+
+#include "./global.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace TagParser {
+
+/*!
+ * \brief The MediaPayloadHash struct holds the hash of the media payload of a file computed via MediaFileInfo::hashMediaPayload().
+ */
+struct TAG_PARSER_EXPORT MediaPayloadHash {
+    bool operator==(const MediaPayloadHash &other) const;
+    bool operator!=(const MediaPayloadHash &other) const;
+    std::string toString() const;
+
+    /// \brief The hash value.
+    std::uint64_t value = 0;
+    /// \brief The number of bytes which have been hashed.
+    std::uint64_t size = 0;
+};
+
+/*!
+ * \brief Returns whether the hash equals \a other (considering the hashed size as well).
+ */
+inline bool MediaPayloadHash::operator==(const MediaPayloadHash &other) const
+{
+    return value == other.value && size == other.size;
+}
+
+/*!
+ * \brief Returns whether the hash differs from \a other.
+ */
+inline bool MediaPayloadHash::operator!=(const MediaPayloadHash &other) const
+{
+    return !(*this == other);
+}
+
+class TAG_PARSER_EXPORT MediaPayloadHasher {
+public:
+    explicit MediaPayloadHasher(unsigned int parallelism = 1);
+
+    unsigned int parallelism() const;
+    void add(const char *data, std::size_t size);
+    void addRange(std::istream &stream, std::uint64_t begin, std::uint64_t end);
+    std::uint64_t size() const;
+    MediaPayloadHash finish();
+
+    static std::uint64_t xxHash64(const char *data, std::size_t size, std::uint64_t seed = 0);
+
+    /// \brief The size of the blocks the payload is split into (so they can be hashed concurrently).
+    static constexpr std::size_t blockSize = 0x100000;
+
+private:
+    char *reserveBlockSpace(std::size_t &available);
+    void hashBlocks();
+
+    unsigned int m_parallelism;
+    std::vector<std::string> m_blocks;
+    std::size_t m_blockCount;
+    std::size_t m_lastBlockSize;
+    std::vector<std::uint64_t> m_blockHashes;
+    std::uint64_t m_size;
+};
+
+/*!
+ * \brief Returns the number of threads used to hash the blocks.
+ */
+inline unsigned int MediaPayloadHasher::parallelism() const
+{
+    return m_parallelism;
+}
+
+/*!
+ * \brief Returns the number of bytes added so far.
+ */
+inline std::uint64_t MediaPayloadHasher::size() const
+{
+    return m_size;
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_MEDIAPAYLOADHASH_H
@@ -0,0 +1,141 @@
+#ifndef TAG_PARSER_MEMORYACCOUNT_H
+#define TAG_PARSER_MEMORYACCOUNT_H
+
+#include "./exceptions.h"
+
+#include <cstdint>
+
+namespace TagParser {
+
+/*!
+ * \brief The MemoryAccount class accounts the memory allocated for the parsing results of a file.
+ *
+ * Only the structures whose size depends on the file (rather than on the format) are accounted: the element trees of
+ * MP4 and Matroska files (including their tags), the page tables of Ogg files and the sample size tables of MP4
+ * tracks. These are the structures which grow huge for pathological files (e.g. millions of Ogg pages or MP4 sample
+ * tables covering days of audio) so it is possible to enforce a limit to abort parsing such files cleanly instead of
+ * running out of memory.
+ *
+ * The account is owned by MediaFileInfo (see MediaFileInfo::memoryAccount() and MediaFileInfo::setMemoryLimit()) and
+ * passed to the container (see AbstractContainer::setMemoryAccount()). The numbers are estimates based on the sizes
+ * of the objects; the overhead of the heap is not taken into account.
+ */
+class TAG_PARSER_EXPORT MemoryAccount {
+public:
+    explicit MemoryAccount(std::uint64_t limit = 0);
+
+    void allocate(std::uint64_t size);
+    void deallocate(std::uint64_t size);
+    void reset();
+    std::uint64_t currentBytes() const;
+    std::uint64_t peakBytes() const;
+    std::uint64_t totalBytes() const;
+    std::uint64_t limit() const;
+    void setLimit(std::uint64_t limit);
+    bool isLimitExceeded() const;
+
+private:
+    std::uint64_t m_current;
+    std::uint64_t m_peak;
+    std::uint64_t m_total;
+    std::uint64_t m_limit;
+    bool m_limitExceeded;
+};
+
+/*!
+ * \brief Constructs a new account with the specified \a limit in bytes (zero means unlimited).
+ */
+inline MemoryAccount::MemoryAccount(std::uint64_t limit)
+    : m_current(0)
+    , m_peak(0)
+    , m_total(0)
+    , m_limit(limit)
+    , m_limitExceeded(false)
+{
+}
+
+/*!
+ * \brief Accounts \a size bytes which are about to be allocated.
+ * \throws Throws MemoryLimitExceededException if the limit would be exceeded. Once that happened, all further
+ *         allocations fail as well until reset() is called so parsing does not continue after skipping the element.
+ */
+inline void MemoryAccount::allocate(std::uint64_t size)
+{
+    if (m_limit && (m_limitExceeded || m_current + size > m_limit)) {
+        m_limitExceeded = true;
+        throw MemoryLimitExceededException();
+    }
+    m_total += size;
+    if ((m_current += size) > m_peak) {
+        m_peak = m_current;
+    }
+}
+
+/*!
+ * \brief Accounts \a size bytes which have been released.
+ */
+inline void MemoryAccount::deallocate(std::uint64_t size)
+{
+    m_current -= size < m_current ? size : m_current;
+}
+
+/*!
+ * \brief Resets all counters (but not the limit).
+ */
+inline void MemoryAccount::reset()
+{
+    m_current = m_peak = m_total = 0;
+    m_limitExceeded = false;
+}
+
+/*!
+ * \brief Returns the number of bytes which are currently allocated.
+ */
+inline std::uint64_t MemoryAccount::currentBytes() const
+{
+    return m_current;
+}
+
+/*!
+ * \brief Returns the maximum of currentBytes() since the account has been constructed or reset.
+ */
+inline std::uint64_t MemoryAccount::peakBytes() const
+{
+    return m_peak;
+}
+
+/*!
+ * \brief Returns the number of bytes allocated in total since the account has been constructed or reset.
+ */
+inline std::uint64_t MemoryAccount::totalBytes() const
+{
+    return m_total;
+}
+
+/*!
+ * \brief Returns the limit in bytes; zero means unlimited.
+ */
+inline std::uint64_t MemoryAccount::limit() const
+{
+    return m_limit;
+}
+
+/*!
+ * \brief Sets the limit in bytes; zero means unlimited.
+ */
+inline void MemoryAccount::setLimit(std::uint64_t limit)
+{
+    m_limit = limit;
+}
+
+/*!
+ * \brief Returns whether an allocation has failed because the limit would have been exceeded.
+ */
+inline bool MemoryAccount::isLimitExceeded() const
+{
+    return m_limitExceeded;
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_MEMORYACCOUNT_H
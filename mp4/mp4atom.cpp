@@ -7,6 +7,7 @@
 #include "../exceptions.h"
 #include "../mediafileinfo.h"
 
+#include <c++utilities/conversion/binaryconversion.h>
 #include <c++utilities/conversion/stringbuilder.h>
 #include <c++utilities/io/binaryreader.h>
 #include <c++utilities/io/binarywriter.h>
@@ -61,14 +62,21 @@ string Mp4Atom::parsingContext() const
 void Mp4Atom::internalParse(Diagnostics &diag)
 {
     static const string context("parsing MP4 atom");
+    container().countParsedElement();
     if (maxTotalSize() < minimumElementSize()) {
         diag.emplace_back(DiagLevel::Critical,
             argsToString("Atom is smaller than 8 byte and hence invalid. The remaining size within the parent atom is ", maxTotalSize(), '.'),
             context);
         throw TruncatedDataException();
     }
-    stream().seekg(static_cast<streamoff>(startOffset()));
-    m_dataSize = reader().readUInt32BE();
+    // read the header directly from the memory-mapped file if possible; use the stream otherwise
+    const char *const header = mappedData(startOffset(), minimumElementSize());
+    if (header) {
+        m_dataSize = BE::toUInt32(header);
+    } else {
+        stream().seekg(static_cast<streamoff>(startOffset()));
+        m_dataSize = reader().readUInt32BE();
+    }
     if (m_dataSize == 0) {
         // atom size extends to rest of the file/enclosing container
         m_dataSize = maxTotalSize();
@@ -81,10 +89,18 @@ void Mp4Atom::internalParse(Diagnostics &diag)
         diag.emplace_back(DiagLevel::Critical, "Atom is smaller than 8 byte and hence invalid.", context);
         throw TruncatedDataException();
     }
-    m_id = reader().readUInt32BE();
+    m_id = header ? BE::toUInt32(header + 4) : reader().readUInt32BE();
     m_idLength = 4;
     if (m_dataSize == 1) { // atom denotes 64-bit size
-        m_dataSize = reader().readUInt64BE();
+        const char *const longSize = header ? mappedData(startOffset() + 8, 8) : nullptr;
+        if (longSize) {
+            m_dataSize = BE::toUInt64(longSize);
+        } else {
+            if (header) {
+                stream().seekg(static_cast<streamoff>(startOffset() + 8));
+            }
+            m_dataSize = reader().readUInt64BE();
+        }
         m_sizeLength = 12; // 4 bytes indicate long size denotation + 8 bytes for actual size denotation
         if (dataSize() < 16 && m_dataSize != 1) {
             diag.emplace_back(DiagLevel::Critical, "Atom denoting 64-bit size is smaller than 16 byte and hence invalid.", parsingContext());
@@ -102,16 +118,16 @@ void Mp4Atom::internalParse(Diagnostics &diag)
     Mp4Atom *child = nullptr;
     if (std::uint64_t firstChildOffset = this->firstChildOffset()) {
         if (firstChildOffset + minimumElementSize() <= totalSize()) {
-            child = new Mp4Atom(static_cast<Mp4Atom &>(*this), startOffset() + firstChildOffset);
+            child = new (container().elementArena()) Mp4Atom(static_cast<Mp4Atom &>(*this), startOffset() + firstChildOffset);
         }
     }
     m_firstChild.reset(child);
     Mp4Atom *sibling = nullptr;
     if (totalSize() < maxTotalSize()) {
         if (parent()) {
-            sibling = new Mp4Atom(*(parent()), startOffset() + totalSize());
+            sibling = new (container().elementArena()) Mp4Atom(*(parent()), startOffset() + totalSize());
         } else {
-            sibling = new Mp4Atom(container(), startOffset() + totalSize(), maxTotalSize() - totalSize());
+            sibling = new (container().elementArena()) Mp4Atom(container(), startOffset() + totalSize(), maxTotalSize() - totalSize());
         }
     }
     m_nextSibling.reset(sibling);
@@ -204,6 +220,7 @@ bool Mp4Atom::isParent() const
     case Meta:
     case ItunesList:
     case MovieFragment:
+    case MovieFragmentRandomAccess:
     case TrackFragment:
     case TrackReference:
     case MovieExtends:
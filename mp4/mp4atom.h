@@ -8,9 +8,10 @@
 #include <c++utilities/conversion/stringconversion.h>
 
 #include <cstdint>
-#include <iostream>
+#include <istream>
 #include <list>
 #include <memory>
+#include <ostream>
 
 namespace TagParser {
 
@@ -0,0 +1,102 @@
+#include "./mp4chapter.h"
+
+#include "../diagnostics.h"
+#include "../tagvalue.h"
+#include "../textcodec.h"
+
+#include <c++utilities/conversion/binaryconversion.h>
+#include <c++utilities/conversion/conversionexception.h>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+/*!
+ * \class TagParser::Mp4Chapter
+ * \brief The Mp4Chapter class provides an implementation of AbstractChapter for MP4 files.
+ *
+ * MP4 files store chapters either within a text track referenced by the "chap"-atom of a track reference ("QuickTime
+ * chapters") or within the "chpl"-atom of the movie's user data ("Nero chapters"). In both cases the chapters are
+ * flat and each chapter has only a single name. The data is read by Mp4Container::parseChapters(); parsing the
+ * chapter only decodes the name so it does not read from the file.
+ */
+
+/*!
+ * \brief Constructs a new Mp4Chapter.
+ * \param id Specifies the ID (the index of the chapter starting at 1).
+ * \param startTime Specifies the start time.
+ * \param endTime Specifies the end time or a negative time span if unknown.
+ * \param data Specifies the raw data of the text sample or the UTF-8 encoded title from the "chpl"-atom.
+ * \param isTextSample Specifies whether \a data is a text sample (prefixed with its size and possibly UTF-16 encoded).
+ * \param locale Specifies the locale of the name (the language of the chapter track).
+ */
+Mp4Chapter::Mp4Chapter(std::uint64_t id, CppUtilities::TimeSpan startTime, CppUtilities::TimeSpan endTime, std::string &&data,
+    bool isTextSample, const Locale &locale)
+    : m_parsedId(id)
+    , m_parsedStartTime(startTime)
+    , m_parsedEndTime(endTime)
+    , m_data(std::move(data))
+    , m_locale(locale)
+    , m_isTextSample(isTextSample)
+{
+}
+
+/*!
+ * \brief Destroys the chapter.
+ */
+Mp4Chapter::~Mp4Chapter()
+{
+}
+
+/*!
+ * \brief Decodes the name of the chapter from the data which has been specified when constructing the object.
+ */
+void Mp4Chapter::internalParse(Diagnostics &diag)
+{
+    static const string context("parsing MP4 chapter");
+    m_id = m_parsedId;
+    m_startTime = m_parsedStartTime;
+    m_endTime = m_parsedEndTime;
+
+    auto name = string_view(m_data);
+    if (m_isTextSample) {
+        // text samples are prefixed with the size of the text
+        if (name.size() < 2) {
+            diag.emplace_back(DiagLevel::Critical, "Text sample is truncated.", context);
+            return;
+        }
+        const auto textSize = BE::toUInt16(name.data());
+        name = name.substr(2);
+        if (textSize > name.size()) {
+            diag.emplace_back(DiagLevel::Warning, "Text sample is truncated.", context);
+        } else {
+            name = name.substr(0, textSize);
+        }
+    }
+
+    // the text is UTF-8 encoded unless there is a UTF-16 BOM
+    auto encoding = TagTextEncoding::Utf8;
+    if (name.size() >= 2 && static_cast<unsigned char>(name[0]) == 0xFE && static_cast<unsigned char>(name[1]) == 0xFF) {
+        encoding = TagTextEncoding::Utf16BigEndian;
+    } else if (name.size() >= 2 && static_cast<unsigned char>(name[0]) == 0xFF && static_cast<unsigned char>(name[1]) == 0xFE) {
+        encoding = TagTextEncoding::Utf16LittleEndian;
+    }
+    if (encoding == TagTextEncoding::Utf8) {
+        if (name.size() >= 3 && name.substr(0, 3) == "\xEF\xBB\xBF"sv) {
+            name = name.substr(3);
+        }
+        m_names.emplace_back(string(name));
+    } else {
+        try {
+            const auto utf8 = TextCodec::transcode(encoding, TagTextEncoding::Utf8, name.data() + 2, name.size() - 2);
+            m_names.emplace_back(string(utf8.first.get(), utf8.second));
+        } catch (const ConversionException &) {
+            diag.emplace_back(DiagLevel::Critical, "The UTF-16 encoded chapter name is invalid.", context);
+            return;
+        }
+    }
+    m_names.back().locale() = m_locale;
+}
+
+} // namespace TagParser
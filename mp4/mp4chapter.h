@@ -0,0 +1,40 @@
+#ifndef TAG_PARSER_MP4CHAPTER_H
+#define TAG_PARSER_MP4CHAPTER_H
+
+#include "../abstractchapter.h"
+
+#include <string>
+
+namespace TagParser {
+
+class TAG_PARSER_EXPORT Mp4Chapter : public AbstractChapter {
+public:
+    Mp4Chapter(std::uint64_t id, CppUtilities::TimeSpan startTime, CppUtilities::TimeSpan endTime, std::string &&data, bool isTextSample,
+        const Locale &locale = Locale());
+    ~Mp4Chapter() override;
+
+    bool isTextSample() const;
+
+protected:
+    void internalParse(Diagnostics &diag) override;
+
+private:
+    std::uint64_t m_parsedId;
+    CppUtilities::TimeSpan m_parsedStartTime;
+    CppUtilities::TimeSpan m_parsedEndTime;
+    std::string m_data;
+    Locale m_locale;
+    bool m_isTextSample;
+};
+
+/*!
+ * \brief Returns whether the chapter has been read from a sample of a chapter text track (and not from a "chpl"-atom).
+ */
+inline bool Mp4Chapter::isTextSample() const
+{
+    return m_isTextSample;
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_MP4CHAPTER_H
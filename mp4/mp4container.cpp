@@ -1,9 +1,13 @@
 #include "./mp4container.h"
 #include "./mp4ids.h"
+#include "./mp4samplecursor.h"
 
 #include "../backuphelper.h"
+#include "../bytesource.h"
 #include "../exceptions.h"
 #include "../mediafileinfo.h"
+#include "../mediapayloadhash.h"
+#include "../seeklessoutputstream.h"
 
 #include <c++utilities/conversion/stringbuilder.h>
 #include <c++utilities/io/binaryreader.h>
@@ -11,9 +15,19 @@
 #include <c++utilities/io/copy.h>
 
 #include <unistd.h>
-
+#ifdef PLATFORM_UNIX
+#include <fcntl.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <exception>
 #include <memory>
+#include <mutex>
 #include <numeric>
+#include <thread>
 #include <tuple>
 
 using namespace std;
@@ -21,6 +35,309 @@ using namespace CppUtilities;
 
 namespace TagParser {
 
+namespace {
+
+/*!
+ * \brief The BufferedMovieAtom struct makes a container and its tracks read the "moov"-atom from memory while it exists.
+ * \remarks The original stream is assigned again on destruction (also to the tracks created in the meantime).
+ */
+struct BufferedMovieAtom {
+    explicit BufferedMovieAtom(AbstractContainer &container, std::uint64_t offset, std::size_t size);
+    ~BufferedMovieAtom();
+
+    AbstractContainer &container;
+    std::iostream &originalStream;
+    BufferedRangeByteSource source;
+    ByteSourceStreamBuffer streamBuffer;
+    std::iostream stream;
+};
+
+BufferedMovieAtom::BufferedMovieAtom(AbstractContainer &container, std::uint64_t offset, std::size_t size)
+    : container(container)
+    , originalStream(container.stream())
+    , source(originalStream, offset, size)
+    , streamBuffer(source)
+    , stream(&streamBuffer)
+{
+    stream.exceptions(originalStream.exceptions());
+    container.setStream(stream);
+}
+
+BufferedMovieAtom::~BufferedMovieAtom()
+{
+    container.setStream(originalStream);
+    for (std::size_t i = 0, count = container.trackCount(); i != count; ++i) {
+        container.track(i)->setInputStream(originalStream);
+    }
+}
+
+/// \brief Flags of the "tfhd"-atom.
+namespace TrackFragmentHeaderFlags {
+enum : std::uint32_t {
+    BaseDataOffsetPresent = 0x000001,
+    SampleDescriptionIndexPresent = 0x000002,
+    DefaultSampleDurationPresent = 0x000008,
+    DefaultSampleSizePresent = 0x000010,
+    DefaultSampleFlagsPresent = 0x000020,
+    DefaultBaseIsMoof = 0x020000,
+};
+}
+
+/// \brief Flags of the "trun"-atom.
+namespace TrackFragmentRunFlags {
+enum : std::uint32_t {
+    DataOffsetPresent = 0x000001,
+    FirstSampleFlagsPresent = 0x000004,
+    SampleDurationPresent = 0x000100,
+    SampleSizePresent = 0x000200,
+    SampleFlagsPresent = 0x000400,
+    SampleCompositionTimeOffsetPresent = 0x000800,
+};
+}
+
+/*!
+ * \brief The TrackFragmentRun struct holds a "trun"-atom and the location of the samples it refers to.
+ * \remarks The struct is only used internally by Mp4Container::makeMovieFragment().
+ */
+struct TrackFragmentRun {
+    std::unique_ptr<char[]> buffer;
+    std::uint64_t bufferSize;
+    std::uint64_t dataOffset;
+    std::uint64_t dataSize;
+};
+
+/*!
+ * \brief The TrackFragment struct holds a "traf"-atom which is kept when rewriting a movie fragment.
+ * \remarks The struct is only used internally by Mp4Container::makeMovieFragment().
+ */
+struct TrackFragment {
+    Mp4Atom *atom;
+    Mp4Atom *headerAtom;
+    std::unique_ptr<char[]> headerBuffer;
+    std::uint64_t headerBufferSize;
+    std::vector<TrackFragmentRun> runs;
+    std::uint64_t newSize;
+};
+
+/*!
+ * \brief Reads the data of the specified \a atom (without its header) from the specified \a stream.
+ */
+std::unique_ptr<char[]> readAtomData(Mp4Atom &atom, std::istream &stream)
+{
+    auto buffer = make_unique<char[]>(atom.dataSize());
+    stream.seekg(static_cast<std::streamoff>(atom.dataOffset()));
+    stream.read(buffer.get(), static_cast<std::streamsize>(atom.dataSize()));
+    return buffer;
+}
+
+/*!
+ * \brief The ChunkCopy struct describes a chunk which is copied when writing chunk-by-chunk.
+ * \remarks The struct is only used internally by Mp4Container::internalMakeFile().
+ */
+struct ChunkCopy {
+    std::uint64_t sourceOffset;
+    std::uint64_t size;
+    std::uint64_t *newOffset;
+    std::size_t trackIndex;
+    std::uint64_t interleavePeriod;
+};
+
+#ifdef PLATFORM_UNIX
+/*!
+ * \brief The ChunkPrefetcher class reads chunks ahead using multiple threads so they can be written in order.
+ *
+ * The worker threads read the chunks via positional reads into a ring of buffers. The thread writing the new file
+ * takes the buffers in order via wait() and hands them back via release(). Chunks bigger than maxChunkSize are not
+ * read; wait() returns nullptr for them so they can be copied via the FileRangeCopier instead.
+ *
+ * \remarks The class is only used internally by Mp4Container::internalMakeFile().
+ */
+class ChunkPrefetcher {
+public:
+    explicit ChunkPrefetcher(const std::string &path, const std::vector<ChunkCopy> &chunks, std::size_t threadCount);
+    ~ChunkPrefetcher();
+
+    bool isOpen() const;
+    const std::vector<char> *wait(std::size_t chunkIndex);
+    void release(std::size_t chunkIndex);
+
+    /// \brief The number of buffers per thread.
+    static constexpr std::size_t buffersPerThread = 4;
+    /// \brief Chunks bigger than this are not prefetched.
+    static constexpr std::uint64_t maxChunkSize = 0x1000000;
+
+private:
+    struct Buffer {
+        std::vector<char> data;
+        std::size_t chunkIndex = numeric_limits<std::size_t>::max();
+        bool failed = false;
+    };
+
+    void work();
+
+    int m_fileDescriptor;
+    const std::vector<ChunkCopy> &m_chunks;
+    std::vector<Buffer> m_buffers;
+    std::atomic<std::size_t> m_nextChunk;
+    std::size_t m_releasedChunks;
+    bool m_stopped;
+    std::mutex m_mutex;
+    std::condition_variable m_bufferFilled;
+    std::condition_variable m_bufferReleased;
+    std::vector<std::thread> m_threads;
+};
+
+/*!
+ * \brief Opens the file at \a path and starts \a threadCount threads reading the specified \a chunks.
+ * \remarks No threads are started if the file can not be opened (see isOpen()).
+ */
+ChunkPrefetcher::ChunkPrefetcher(const std::string &path, const std::vector<ChunkCopy> &chunks, std::size_t threadCount)
+    : m_fileDescriptor(::open(BasicFileInfo::pathForOpen(path), O_RDONLY | O_CLOEXEC))
+    , m_chunks(chunks)
+    , m_buffers(threadCount * buffersPerThread)
+    , m_nextChunk(0)
+    , m_releasedChunks(0)
+    , m_stopped(false)
+{
+    if (m_fileDescriptor < 0) {
+        return;
+    }
+    m_threads.reserve(threadCount);
+    for (std::size_t i = 0; i != threadCount; ++i) {
+        m_threads.emplace_back(&ChunkPrefetcher::work, this);
+    }
+}
+
+/*!
+ * \brief Stops the threads and closes the file.
+ */
+ChunkPrefetcher::~ChunkPrefetcher()
+{
+    {
+        const auto lock = lock_guard<mutex>(m_mutex);
+        m_stopped = true;
+    }
+    m_bufferReleased.notify_all();
+    for (auto &thread : m_threads) {
+        thread.join();
+    }
+    if (m_fileDescriptor >= 0) {
+        ::close(m_fileDescriptor);
+    }
+}
+
+/*!
+ * \brief Returns whether the file could be opened.
+ */
+inline bool ChunkPrefetcher::isOpen() const
+{
+    return m_fileDescriptor >= 0;
+}
+
+/*!
+ * \brief Waits until the chunk with the specified \a chunkIndex has been read.
+ * \returns Returns the buffer holding the data of the chunk or nullptr if the chunk is too big to be prefetched.
+ * \throws Throws std::ios_base::failure if the chunk could not be read.
+ * \remarks Chunks must be waited for in order and each chunk must be released before waiting for the next one.
+ */
+const std::vector<char> *ChunkPrefetcher::wait(std::size_t chunkIndex)
+{
+    auto &buffer = m_buffers[chunkIndex % m_buffers.size()];
+    auto lock = unique_lock<mutex>(m_mutex);
+    m_bufferFilled.wait(lock, [&] { return buffer.chunkIndex == chunkIndex; });
+    if (buffer.failed) {
+        throw std::ios_base::failure("Unable to read chunk from the original file.");
+    }
+    return m_chunks[chunkIndex].size <= maxChunkSize ? &buffer.data : nullptr;
+}
+
+/*!
+ * \brief Hands the buffer of the chunk with the specified \a chunkIndex back so it can be used for upcoming chunks.
+ */
+void ChunkPrefetcher::release(std::size_t chunkIndex)
+{
+    {
+        const auto lock = lock_guard<mutex>(m_mutex);
+        m_releasedChunks = chunkIndex + 1;
+    }
+    m_bufferReleased.notify_all();
+}
+
+/*!
+ * \brief Reads chunks until all chunks have been read or the prefetcher is stopped.
+ * \remarks This is the function run by the threads.
+ */
+void ChunkPrefetcher::work()
+{
+    for (;;) {
+        const auto chunkIndex = m_nextChunk++;
+        if (chunkIndex >= m_chunks.size()) {
+            return;
+        }
+
+        // wait until the buffer has been released by the chunk which used it before
+        auto &buffer = m_buffers[chunkIndex % m_buffers.size()];
+        {
+            auto lock = unique_lock<mutex>(m_mutex);
+            m_bufferReleased.wait(lock, [&] { return m_stopped || chunkIndex < m_releasedChunks + m_buffers.size(); });
+            if (m_stopped) {
+                return;
+            }
+        }
+
+        // read the chunk
+        const auto &chunk = m_chunks[chunkIndex];
+        auto failed = false;
+        if (chunk.size <= maxChunkSize) {
+            buffer.data.resize(static_cast<std::size_t>(chunk.size));
+            for (std::size_t bytesRead = 0; bytesRead < buffer.data.size();) {
+                const auto res = ::pread(m_fileDescriptor, buffer.data.data() + bytesRead, buffer.data.size() - bytesRead,
+                    static_cast<off_t>(chunk.sourceOffset + bytesRead));
+                if (res > 0) {
+                    bytesRead += static_cast<std::size_t>(res);
+                } else if (res == 0 || errno != EINTR) {
+                    failed = true;
+                    break;
+                }
+            }
+        }
+        {
+            const auto lock = lock_guard<mutex>(m_mutex);
+            buffer.chunkIndex = chunkIndex;
+            buffer.failed = failed;
+        }
+        m_bufferFilled.notify_all();
+    }
+}
+
+/*!
+ * \brief The FileDescriptorGuard struct closes the file descriptor it holds when being destroyed.
+ */
+struct FileDescriptorGuard {
+    ~FileDescriptorGuard()
+    {
+        if (fileDescriptor >= 0) {
+            ::close(fileDescriptor);
+        }
+    }
+    int fileDescriptor = -1;
+};
+#endif
+
+/*!
+ * \brief The TrackParsing struct holds the state of parsing a track concurrently.
+ * \remarks The struct is only used internally by Mp4Container::parseTracksConcurrently().
+ */
+struct TrackParsing {
+    Mp4Track *track = nullptr;
+    Diagnostics diag;
+    std::exception_ptr exception;
+    bool descriptionParsed = false;
+    bool sampleInformationParsed = false;
+};
+
+} // namespace
+
 /*!
  * \class TagParser::Mp4Container
  * \brief Implementation of GenericContainer<MediaFileInfo, Mp4Tag, Mp4Track, Mp4Atom>.
@@ -32,6 +349,14 @@ namespace TagParser {
 Mp4Container::Mp4Container(MediaFileInfo &fileInfo, std::uint64_t startOffset)
     : GenericContainer<MediaFileInfo, Mp4Tag, Mp4Track, Mp4Atom>(fileInfo, startOffset)
     , m_fragmented(false)
+    , m_chunkCopyThreadCount(1)
+    , m_interleaveDuration()
+    , m_userDataPatchingEnabled(false)
+    , m_tagFieldPatchingEnabled(false)
+    , m_movieAtomCompactionEnabled(false)
+    , m_strippedAtomIds({ Mp4AtomIds::Free, Mp4AtomIds::Skip })
+    , m_segmentIndexGenerationEnabled(false)
+    , m_fragmentIndexParsed(false)
 {
 }
 
@@ -43,6 +368,9 @@ void Mp4Container::reset()
 {
     GenericContainer<MediaFileInfo, Mp4Tag, Mp4Track, Mp4Atom>::reset();
     m_fragmented = false;
+    m_fragmentIndex.clear();
+    m_fragmentIndexParsed = false;
+    m_chapters.clear();
 }
 
 ElementPosition Mp4Container::determineTagPosition(Diagnostics &diag) const
@@ -69,6 +397,178 @@ ElementPosition Mp4Container::determineIndexPosition(Diagnostics &diag) const
     return ElementPosition::Keep;
 }
 
+/*!
+ * \brief Adds the data of the "mdat"-atoms to the specified \a hasher.
+ * \remarks The "mdat"-atoms of fragmented files are included. The end of the "mdat"-atoms is limited to the file size.
+ */
+void Mp4Container::hashMediaPayload(MediaPayloadHasher &hasher, Diagnostics &diag, AbortableProgressFeedback &progress)
+{
+    static const string context("hashing media payload of MP4 container");
+    if (!m_firstElement) {
+        return;
+    }
+    auto mediaDataRanges = vector<pair<std::uint64_t, std::uint64_t>>();
+    auto totalSize = std::uint64_t();
+    for (Mp4Atom *level0Atom = m_firstElement.get(); level0Atom; level0Atom = level0Atom->nextSibling()) {
+        level0Atom->parse(diag);
+        if (level0Atom->id() == Mp4AtomIds::MediaData) {
+            const auto &range = mediaDataRanges.emplace_back(level0Atom->dataOffset(), min(level0Atom->endOffset(), fileInfo().size()));
+            totalSize += range.second - range.first;
+        }
+    }
+    if (mediaDataRanges.empty()) {
+        diag.emplace_back(DiagLevel::Warning, "There is no mdat atom; the hash only covers an empty payload.", context);
+    }
+    auto hashedSize = std::uint64_t();
+    for (const auto &[begin, end] : mediaDataRanges) {
+        // hash large atoms in pieces so the progress is updated and aborting is possible
+        for (auto offset = begin; offset < end; offset += MediaPayloadHasher::blockSize * 16) {
+            progress.stopIfAborted();
+            const auto pieceEnd = min<std::uint64_t>(end, offset + MediaPayloadHasher::blockSize * 16);
+            hasher.addRange(stream(), offset, pieceEnd);
+            hashedSize += pieceEnd - offset;
+            progress.updateStepPercentage(static_cast<std::uint8_t>(hashedSize * 100 / totalSize));
+        }
+    }
+}
+
+/*!
+ * \brief Validates the sample tables of all tracks against the "mdat"-atoms without reading the media data.
+ *
+ * Only the top-level atoms and the sample tables of the tracks are read. This allows detecting truncated files (e.g.
+ * from cameras which have stopped recording unexpectedly) in a fraction of the time it takes to read the media data.
+ * See Mp4Track::validateSampleTable() for what is validated. The end of the "mdat"-atoms is limited to the file size.
+ *
+ * If \a spotCheckCount is not zero, the last byte of that many randomly picked chunks of each track is read additionally.
+ *
+ * \remarks The tracks must have been parsed. Fragments are not validated.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+void Mp4Container::validateSampleTables(Diagnostics &diag, std::size_t spotCheckCount)
+{
+    static const string context("validating sample tables of MP4 container");
+    if (!m_firstElement) {
+        return;
+    }
+    auto mediaDataRanges = vector<pair<std::uint64_t, std::uint64_t>>();
+    for (Mp4Atom *level0Atom = m_firstElement.get(); level0Atom; level0Atom = level0Atom->nextSibling()) {
+        level0Atom->parse(diag);
+        if (level0Atom->id() == Mp4AtomIds::MediaData) {
+            mediaDataRanges.emplace_back(level0Atom->dataOffset(), min(level0Atom->endOffset(), fileInfo().size()));
+        }
+    }
+    if (mediaDataRanges.empty()) {
+        diag.emplace_back(DiagLevel::Critical, "There is no mdat atom.", context);
+    }
+    std::uint64_t chunkCount = 0;
+    for (auto &track : m_tracks) {
+        track->validateSampleTable(mediaDataRanges, spotCheckCount, diag);
+        chunkCount += track->chunkCount();
+    }
+    if (m_fragmented) {
+        diag.emplace_back(DiagLevel::Information, "The file is fragmented; the chunks of the fragments have not been validated.", context);
+    }
+    diag.emplace_back(DiagLevel::Information,
+        argsToString("Validated ", chunkCount, " chunks of ", m_tracks.size(), " tracks within ", mediaDataRanges.size(), " mdat atoms."),
+        context);
+}
+
+/*!
+ * \struct TagParser::Mp4FragmentIndexEntry
+ * \brief The Mp4FragmentIndexEntry struct describes a random access point within a movie fragment denoted by a "tfra"-atom.
+ * \sa Mp4Container::fragmentIndex()
+ */
+
+/*!
+ * \brief Parses the "tfra"-atoms of the "mfra"-atom located at the end of the file.
+ *
+ * The "mfra"-atom is located via the "mfro"-atom which makes up the last 16 bytes of the file. So the movie fragments
+ * containing the random access points of the tracks can be located without walking through the top-level atoms which
+ * takes long for long fragmented recordings. The entries are accessible via fragmentIndex().
+ *
+ * \returns Returns whether an index has been found.
+ * \remarks The index is only parsed once; subsequent calls return immediately. It is parsed automatically when parsing
+ *          the tracks if ParsingFlags::LazyMp4Fragments is set.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+bool Mp4Container::parseFragmentIndex(Diagnostics &diag)
+{
+    static const string context("parsing movie fragment random access atom");
+    if (m_fragmentIndexParsed) {
+        return !m_fragmentIndex.empty();
+    }
+    m_fragmentIndexParsed = true;
+
+    // read the "mfro"-atom denoting the size of the "mfra"-atom
+    const auto fileSize = fileInfo().size();
+    if (fileSize < startOffset() + 16) {
+        return false;
+    }
+    stream().seekg(static_cast<streamoff>(fileSize - 16));
+    if (reader().readUInt32BE() != 16 || reader().readUInt32BE() != Mp4AtomIds::MovieFragmentRandomAccessOffset) {
+        return false;
+    }
+    stream().seekg(4, ios_base::cur); // skip version and flags
+    const auto mfraSize = static_cast<std::uint64_t>(reader().readUInt32BE());
+    if (mfraSize < 8 + 16 || mfraSize > fileSize - startOffset()) {
+        diag.emplace_back(DiagLevel::Warning, "The mfro atom denotes an invalid size. The mfra atom will be ignored.", context);
+        return false;
+    }
+
+    // parse the "tfra"-atoms of the "mfra"-atom
+    try {
+        auto mfraAtom = make_unique<Mp4Atom>(*this, fileSize - mfraSize);
+        mfraAtom->parse(diag);
+        if (mfraAtom->id() != Mp4AtomIds::MovieFragmentRandomAccess || mfraAtom->totalSize() != mfraSize) {
+            diag.emplace_back(DiagLevel::Warning, "The mfro atom does not point to a mfra atom. The mfra atom will be ignored.", context);
+            return false;
+        }
+        for (Mp4Atom *tfraAtom = mfraAtom->childById(Mp4AtomIds::TrackFragmentRandomAccess, diag); tfraAtom;
+             tfraAtom = tfraAtom->siblingById(Mp4AtomIds::TrackFragmentRandomAccess, diag)) {
+            if (tfraAtom->dataSize() < 16) {
+                diag.emplace_back(DiagLevel::Warning, "tfra atom is truncated.", context);
+                continue;
+            }
+            const auto data = readAtomData(*tfraAtom, stream());
+            const auto version = static_cast<std::uint8_t>(data[0]);
+            const auto trackId = BE::toUInt32(data.get() + 4);
+            const auto lengthSizes = BE::toUInt32(data.get() + 8);
+            const auto entryCount = BE::toUInt32(data.get() + 12);
+            const std::uint64_t numberSizes[] = { ((lengthSizes >> 4) & 0x3) + 1, ((lengthSizes >> 2) & 0x3) + 1, (lengthSizes & 0x3) + 1 };
+            const auto timeAndOffsetSize = version == 1 ? std::uint64_t(16) : std::uint64_t(8);
+            const auto entrySize = timeAndOffsetSize + numberSizes[0] + numberSizes[1] + numberSizes[2];
+            if (tfraAtom->dataSize() < 16 + entrySize * entryCount) {
+                diag.emplace_back(DiagLevel::Warning, argsToString("tfra atom of track ", trackId, " is truncated."), context);
+                continue;
+            }
+            accountMemory(static_cast<std::uint64_t>(entryCount) * sizeof(Mp4FragmentIndexEntry));
+            auto &entries = m_fragmentIndex[trackId];
+            entries.reserve(entries.size() + entryCount);
+            for (const char *entryData = data.get() + 16, *const end = entryData + entrySize * entryCount; entryData != end;) {
+                auto &entry = entries.emplace_back();
+                if (version == 1) {
+                    entry.time = BE::toUInt64(entryData);
+                    entry.movieFragmentOffset = BE::toUInt64(entryData + 8);
+                } else {
+                    entry.time = BE::toUInt32(entryData);
+                    entry.movieFragmentOffset = BE::toUInt32(entryData + 4);
+                }
+                entryData += timeAndOffsetSize;
+                std::uint32_t *const numbers[] = { &entry.trackFragmentNumber, &entry.trackRunNumber, &entry.sampleNumber };
+                for (std::size_t i = 0; i != 3; ++i) {
+                    for (const auto *const numberEnd = entryData + numberSizes[i]; entryData != numberEnd; ++entryData) {
+                        *numbers[i] = (*numbers[i] << 8) | static_cast<std::uint8_t>(*entryData);
+                    }
+                }
+            }
+        }
+    } catch (const Failure &) {
+        diag.emplace_back(DiagLevel::Warning, "Unable to parse mfra atom. It will be ignored.", context);
+        m_fragmentIndex.clear();
+    }
+    return !m_fragmentIndex.empty();
+}
+
 void Mp4Container::internalParseHeader(Diagnostics &diag)
 {
     //const string context("parsing header of MP4 container"); will be used when generating notifications
@@ -96,9 +596,12 @@ void Mp4Container::internalParseTags(Diagnostics &diag)
     bool surplusMetaAtoms = false;
     while (metaAtom) {
         metaAtom->parse(diag);
+        if (exceedsParseLimit(metaAtom->totalSize(), parseLimits().maxTagSize, "size of the tag", diag, context)) {
+            break;
+        }
         m_tags.emplace_back(make_unique<Mp4Tag>());
         try {
-            m_tags.back()->parse(*metaAtom, diag);
+            m_tags.back()->parse(*metaAtom, diag, &fileInfo().tagFieldFilter());
         } catch (const NoDataFoundException &) {
             m_tags.pop_back();
         }
@@ -120,6 +623,13 @@ void Mp4Container::internalParseTracks(Diagnostics &diag)
     try {
         // get moov atom which holds track information
         if (Mp4Atom *moovAtom = firstElement()->siblingByIdIncludingThis(Mp4AtomIds::Movie, diag)) {
+            // read the "moov"-atom at once to parse the track information from memory if enabled
+            // note: Not useful if the file is memory-mapped anyways.
+            auto bufferedMovieAtom = unique_ptr<BufferedMovieAtom>();
+            if ((fileInfo().parsingFlags() & ParsingFlags::BufferMp4MovieAtom) && mappedData().empty()
+                && moovAtom->totalSize() <= maxBufferedMovieAtomSize) {
+                bufferedMovieAtom = make_unique<BufferedMovieAtom>(*this, moovAtom->startOffset(), static_cast<std::size_t>(moovAtom->totalSize()));
+            }
             // get mvhd atom which holds overall track information
             if (Mp4Atom *mvhdAtom = moovAtom->childById(Mp4AtomIds::MovieHeader, diag)) {
                 if (mvhdAtom->dataSize() > 0) {
@@ -173,8 +683,14 @@ void Mp4Container::internalParseTracks(Diagnostics &diag)
                     }
                 }
             }
+            // locate the movie fragments via the "mfra"-atom so the tracks do not need to read them (see Mp4Track::readFragment())
+            if (fileInfo().parsingFlags() & ParsingFlags::LazyMp4Fragments) {
+                parseFragmentIndex(diag);
+            }
             // get first trak atoms which hold information for each track
-            Mp4Atom *trakAtom = moovAtom->childById(Mp4AtomIds::Track, diag);
+            Mp4Atom *trakAtom = (fileInfo().parsingFlags() & ParsingFlags::ParallelMp4TrackParsing) && parseTracksConcurrently(*moovAtom, diag)
+                ? nullptr
+                : moovAtom->childById(Mp4AtomIds::Track, diag);
             int trackNum = 1;
             while (trakAtom) {
                 try {
@@ -212,10 +728,299 @@ void Mp4Container::internalParseTracks(Diagnostics &diag)
     }
 }
 
+/*!
+ * \brief Parses the tracks of the specified \a movieAtom determining the sample information of the tracks concurrently.
+ *
+ * The atoms and the descriptions of the tracks (e.g. the "stsd"-atom and the codec configuration) are parsed one after
+ * another because parsing atoms modifies the element tree. The sample information (e.g. the accumulated sample sizes and the
+ * peak bitrate) which makes up most of the work for long tracks is determined concurrently reading via a stream per thread.
+ * The diagnostic messages are collected per track and merged in the order of the tracks so they are the same as when parsing
+ * the tracks one after another.
+ *
+ * \returns Returns false without parsing anything if the tracks can not be parsed concurrently because the file is fragmented
+ *          or it is neither memory-mapped nor a regular file on a UNIX-like platform.
+ * \remarks Called by internalParseTracks() if ParsingFlags::ParallelMp4TrackParsing is set.
+ */
+bool Mp4Container::parseTracksConcurrently(Mp4Atom &movieAtom, Diagnostics &diag)
+{
+    static const string context("parsing tracks of MP4 container");
+
+    // ensure the top-level atoms are parsed so the tracks do not need to parse them when looking for track fragments
+    try {
+        if (m_fragmented || firstElement()->siblingByIdIncludingThis(Mp4AtomIds::MovieFragment, diag)) {
+            return false;
+        }
+    } catch (const Failure &) {
+        return false;
+    }
+
+    // determine how to read the sample information concurrently (see MatroskaContainer::validateClusters())
+    auto source = unique_ptr<ByteSource>();
+#ifdef PLATFORM_UNIX
+    auto fileDescriptor = FileDescriptorGuard();
+#endif
+    if (const auto mapping = mappedData(); !mapping.empty()) {
+        source = make_unique<MemoryByteSource>(mapping);
+#ifdef PLATFORM_UNIX
+    } else if (!fileInfo().hasByteSource() && !fileInfo().path().empty()
+        && (fileDescriptor.fileDescriptor = ::open(BasicFileInfo::pathForOpen(fileInfo().path()), O_RDONLY | O_CLOEXEC)) >= 0) {
+        source = make_unique<FileDescriptorByteSource>(fileDescriptor.fileDescriptor);
+#endif
+    } else {
+        return false;
+    }
+
+    // parse the atoms and the descriptions of the tracks one after another
+    auto parsings = vector<TrackParsing>();
+    for (auto *trakAtom = movieAtom.childById(Mp4AtomIds::Track, diag); trakAtom; trakAtom = trakAtom->siblingById(Mp4AtomIds::Track, diag)) {
+        auto &parsing = parsings.emplace_back();
+        parsing.diag.setFlags(diag.flags());
+        parsing.diag.setLevelThreshold(diag.levelThreshold());
+        try {
+            try {
+                trakAtom->parse(parsing.diag);
+            } catch (const Failure &) {
+                parsing.diag.emplace_back(DiagLevel::Warning, "Unable to parse child atom of moov.", context);
+            }
+            parsing.track = m_tracks.emplace_back(make_unique<Mp4Track>(*trakAtom)).get();
+            parsing.track->m_flags -= TrackFlags::HeaderValid;
+            parsing.track->parseDescription(parsing.diag);
+            parsing.descriptionParsed = true;
+        } catch (const Failure &) {
+            parsing.diag.emplace_back(DiagLevel::Critical, argsToString("Unable to parse track ", parsings.size(), '.'), context);
+        } catch (...) {
+            parsing.exception = current_exception();
+            break;
+        }
+    }
+
+    // determine the sample information of the tracks concurrently
+    const auto streamExceptions = stream().exceptions();
+    const auto threadCount = min<std::size_t>(max<std::size_t>(thread::hardware_concurrency(), 1), parsings.size());
+    auto nextTrack = atomic<std::size_t>(0);
+    const auto work = [&] {
+        ByteSourceStreamBuffer streamBuffer(*source);
+        istream trackStream(&streamBuffer);
+        trackStream.exceptions(streamExceptions);
+        for (auto i = nextTrack++; i < parsings.size(); i = nextTrack++) {
+            auto &parsing = parsings[i];
+            if (!parsing.descriptionParsed) {
+                continue;
+            }
+            parsing.track->setInputStream(trackStream);
+            try {
+                parsing.track->parseSampleInformation(parsing.diag);
+                parsing.sampleInformationParsed = true;
+            } catch (const Failure &) {
+                parsing.diag.emplace_back(DiagLevel::Critical, argsToString("Unable to parse track ", i + 1, '.'), context);
+            } catch (...) {
+                parsing.exception = current_exception();
+            }
+        }
+    };
+    auto workers = vector<thread>();
+    workers.reserve(threadCount > 1 ? threadCount - 1 : 0);
+    for (auto i = std::size_t(1); i < threadCount; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    // merge the results in the order of the tracks
+    // -> assign the stream of the container again before rethrowing because the streams of the threads are gone
+    for (auto &parsing : parsings) {
+        if (!parsing.track) {
+            continue;
+        }
+        parsing.track->setInputStream(stream());
+        if (parsing.sampleInformationParsed) {
+            parsing.track->m_flags += TrackFlags::HeaderValid;
+        }
+    }
+    for (auto &parsing : parsings) {
+        for (auto &message : parsing.diag) {
+            diag.push_back(std::move(message));
+        }
+        if (parsing.exception) {
+            rethrow_exception(parsing.exception);
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief Reads the chapters of the file.
+ *
+ * The chapters are read from the text track referenced by the "chap"-atom within the "tref"-atom of another track
+ * ("QuickTime chapters"). If there is no such track the "chpl"-atom within the "udta"-atom is read ("Nero chapters").
+ * The tracks are parsed if not done yet.
+ *
+ * \remarks Like for Matroska files this is not done when parsing the header, tracks or tags but only when parseChapters()
+ *          is called (which MediaFileInfo skips when ParsingFlags::SkipChapters is set).
+ */
+void Mp4Container::internalParseChapters(Diagnostics &diag)
+{
+    static const string context("parsing chapters of MP4 container");
+    m_chapters.clear();
+    parseTracks(diag);
+
+    // read the chapter track referenced by the first track having a chapter reference
+    for (const auto &track : m_tracks) {
+        auto *const trackReferenceAtom = track->trakAtom().childById(Mp4AtomIds::TrackReference, diag);
+        auto *const chapterReferenceAtom = trackReferenceAtom ? trackReferenceAtom->childById(Mp4AtomIds::ChapterReference, diag) : nullptr;
+        if (!chapterReferenceAtom) {
+            continue;
+        }
+        if (chapterReferenceAtom->dataSize() < 4) {
+            diag.emplace_back(DiagLevel::Warning, "\"chap\"-atom is truncated.", context);
+            continue;
+        }
+        stream().seekg(static_cast<iostream::off_type>(chapterReferenceAtom->dataOffset()));
+        const auto chapterTrackId = reader().readUInt32BE();
+        const auto chapterTrack
+            = find_if(m_tracks.cbegin(), m_tracks.cend(), [chapterTrackId](const auto &candidate) { return candidate->id() == chapterTrackId; });
+        if (chapterTrack == m_tracks.cend()) {
+            diag.emplace_back(DiagLevel::Warning, argsToString("The referenced chapter track ", chapterTrackId, " does not exist."), context);
+            continue;
+        }
+        parseChapterTrack(**chapterTrack, diag);
+        break;
+    }
+    if (!m_chapters.empty()) {
+        return;
+    }
+
+    // read the "chpl"-atom otherwise
+    if (auto *const userDataAtom = firstElement()->subelementByPath(diag, Mp4AtomIds::Movie, Mp4AtomIds::UserData)) {
+        if (auto *const chapterListAtom = userDataAtom->childById(Mp4AtomIds::ChapterList, diag)) {
+            parseChapterList(*chapterListAtom, diag);
+        }
+    }
+}
+
+/*!
+ * \brief Reads the chapters from the samples of the specified \a chapterTrack.
+ *
+ * Each sample is a chapter starting at the decoding time of the sample. The samples are tiny and usually interleaved
+ * with the media data so they are read via Mp4SampleCursor::gather() which plans the reads first and reads samples
+ * close to each other at once instead of seeking to each sample.
+ */
+void Mp4Container::parseChapterTrack(Mp4Track &chapterTrack, Diagnostics &diag)
+{
+    static const string context("parsing chapter track of MP4 container");
+    if (!chapterTrack.timeScale()) {
+        diag.emplace_back(DiagLevel::Critical, "The time scale of the chapter track is zero.", context);
+        return;
+    }
+    auto samples = vector<pair<TimeSpan, string>>();
+    auto cursor = Mp4SampleCursor(chapterTrack);
+    cursor.gather(
+        [&samples, &chapterTrack](const Mp4Sample &sample, std::string_view data) {
+            // note: Only the text is used which can not exceed its 16-bit size denotation (so modifiers are skipped).
+            samples.emplace_back(TimeSpan::fromSeconds(static_cast<double>(sample.decodingTime) / chapterTrack.timeScale()),
+                string(data.substr(0, 2 + 0xFFFF)));
+        },
+        diag);
+    for (auto i = samples.begin(), end = samples.end(); i != end; ++i) {
+        const auto next = i + 1;
+        const auto endTime = next != end ? next->first : (chapterTrack.duration().isNull() ? TimeSpan(-1) : chapterTrack.duration());
+        m_chapters.emplace_back(make_unique<Mp4Chapter>(m_chapters.size() + 1, i->first, endTime, std::move(i->second), true, chapterTrack.locale()));
+        m_chapters.back()->parse(diag);
+    }
+}
+
+/*!
+ * \brief Reads the chapters from the specified "chpl"-atom.
+ *
+ * The atom contains a version byte, 24-bit flags, 32 reserved bits (only if the version is 1) and the 8-bit number of
+ * chapters. Each chapter consists of its 64-bit start time in 100 ns units followed by its UTF-8 encoded title prefixed
+ * with its 8-bit size.
+ */
+void Mp4Container::parseChapterList(Mp4Atom &chapterListAtom, Diagnostics &diag)
+{
+    static const string context("parsing \"chpl\"-atom");
+    // note: The number of chapters and the title sizes are 8-bit so a valid atom can not be bigger.
+    constexpr auto maxChapterListSize = std::uint64_t(4 + 4 + 1 + 0xFF * (8 + 1 + 0xFF));
+    if (chapterListAtom.dataSize() < 5 || chapterListAtom.dataSize() > maxChapterListSize) {
+        diag.emplace_back(DiagLevel::Critical, "The size of the \"chpl\"-atom is invalid.", context);
+        return;
+    }
+    auto data = string(static_cast<std::size_t>(chapterListAtom.dataSize()), '\0');
+    stream().seekg(static_cast<iostream::off_type>(chapterListAtom.dataOffset()));
+    stream().read(data.data(), static_cast<streamsize>(data.size()));
+
+    auto pos = std::size_t(data[0] == 1 ? 8 : 4);
+    const auto chapterCount = pos < data.size() ? static_cast<unsigned char>(data[pos++]) : 0u;
+    auto entries = vector<pair<TimeSpan, string>>();
+    entries.reserve(chapterCount);
+    for (auto i = 0u; i < chapterCount; ++i) {
+        if (data.size() - pos < 9 || data.size() - pos - 9 < static_cast<unsigned char>(data[pos + 8])) {
+            diag.emplace_back(DiagLevel::Critical, argsToString("\"chpl\"-atom is truncated after ", i, " of ", chapterCount, " chapters."), context);
+            break;
+        }
+        const auto startTime = TimeSpan(static_cast<std::int64_t>(BE::toUInt64(data.data() + pos)));
+        const auto titleSize = static_cast<unsigned char>(data[pos + 8]);
+        entries.emplace_back(startTime, data.substr(pos + 9, titleSize));
+        pos += 9 + titleSize;
+    }
+    for (auto i = entries.begin(), end = entries.end(); i != end; ++i) {
+        const auto next = i + 1;
+        const auto endTime = next != end ? next->first : (m_duration.isNull() ? TimeSpan(-1) : m_duration);
+        m_chapters.emplace_back(make_unique<Mp4Chapter>(m_chapters.size() + 1, i->first, endTime, std::move(i->second), false));
+        m_chapters.back()->parse(diag);
+    }
+}
+
+/*!
+ * \brief Takes the atoms into account which have been appended to the file (e.g. movie fragments of a live recording).
+ *
+ * The atom tree is extended (see Mp4Atom::resumeSiblings()) and the appended top-level atoms are parsed.
+ *
+ * \returns Returns false if a "moov"-atom has been appended or extended (e.g. the "moov"-atom written at the end of a
+ *          recording or the rest of a partially downloaded "moov"-atom); the file needs to be parsed from scratch then.
+ */
+bool Mp4Container::internalResumeParsing(Diagnostics &diag)
+{
+    static const string context("resuming parsing of MP4 container");
+    if (!m_firstElement) {
+        return false;
+    }
+    auto createdAtoms = vector<Mp4Atom *>();
+    m_firstElement->resumeSiblings(diag, &createdAtoms);
+    for (auto *atom : createdAtoms) {
+        // check children of appended data of existing atoms only for being part of the "moov"-atom
+        if (atom->parent()) {
+            auto *topLevelAtom = atom->parent();
+            while (topLevelAtom->parent()) {
+                topLevelAtom = topLevelAtom->parent();
+            }
+            if (topLevelAtom->id() == Mp4AtomIds::Movie) {
+                return false;
+            }
+            continue;
+        }
+        // parse appended top-level atoms
+        try {
+            for (; atom; atom = atom->nextSibling()) {
+                atom->parse(diag);
+                if (atom->id() == Mp4AtomIds::Movie) {
+                    return false;
+                }
+            }
+        } catch (const Failure &) {
+            diag.emplace_back(DiagLevel::Critical, "Unable to parse appended top-level atom.", context);
+        }
+    }
+    return true;
+}
+
 void Mp4Container::internalMakeFile(Diagnostics &diag, AbortableProgressFeedback &progress)
 {
     static const string context("making MP4 container");
     progress.updateStep("Calculating atom sizes and padding ...");
+    auto layoutTimer = ApplyPhaseTimer(fileInfo().statistics(), ApplyPhase::Layout);
 
     // basic validation of original file
     if (!isHeaderParsed()) {
@@ -233,7 +1038,7 @@ void Mp4Container::internalMakeFile(Diagnostics &diag, AbortableProgressFeedback
     // -> whether media data is written chunk by chunk (need to write chunk by chunk if tracks have been altered)
     const bool writeChunkByChunk = m_tracksAltered;
     // -> whether rewrite is required (always required when forced to rewrite or when tracks have been altered)
-    bool rewriteRequired = fileInfo().isForcingRewrite() || writeChunkByChunk;
+    bool rewriteRequired = (fileInfo().isForcingRewrite() && !fileInfo().isForcingInPlace()) || writeChunkByChunk || m_seeklessOutput;
     // -> use the preferred tag position/index position (force one wins, if both are force tag pos wins; might be changed later if none is forced)
     ElementPosition initialNewTagPos
         = fileInfo().forceTagPosition() || !fileInfo().forceIndexPosition() ? fileInfo().tagPosition() : fileInfo().indexPosition();
@@ -244,6 +1049,8 @@ void Mp4Container::internalMakeFile(Diagnostics &diag, AbortableProgressFeedback
     std::uint64_t newPadding;
     // -> holds new padding (after actual data)
     std::uint64_t newPaddingEnd;
+    // -> holds padding of the original file (before actual data)
+    std::uint64_t originalPadding = 0;
     // -> holds current offset
     std::uint64_t currentOffset;
     // -> holds track information, used when writing chunk-by-chunk
@@ -254,6 +1061,13 @@ void Mp4Container::internalMakeFile(Diagnostics &diag, AbortableProgressFeedback
     vector<std::int64_t> newMediaDataOffsets;
     // -> new size of movie atom and user data atom
     std::uint64_t movieAtomSize, userDataAtomSize;
+    // -> whether a segment index is made for the movie fragments (see isSegmentIndexGenerationEnabled()) and its size
+    bool segmentIndexRequired = false;
+    std::uint64_t segmentIndexSize = 0;
+    // -> returns the ID of the specified top-level atom considering segment indexes which are made anew as padding
+    const auto madeAnewAsPadding = [&segmentIndexRequired](const Mp4Atom *atom) -> std::uint32_t {
+        return segmentIndexRequired && atom->id() == Mp4AtomIds::SegmentIndex ? Mp4AtomIds::Free : atom->id();
+    };
     // -> track count of original file
     const auto trackCount = this->trackCount();
 
@@ -287,27 +1101,36 @@ void Mp4Container::internalMakeFile(Diagnostics &diag, AbortableProgressFeedback
         // movie fragment atom (indicates dash file)
         if ((firstMovieFragmentAtom = firstElement()->siblingById(Mp4AtomIds::MovieFragment, diag))) {
             // there is at least one movie fragment atom -> consider file being dash
-            // -> can not write chunk-by-chunk (currently)
-            if (writeChunkByChunk) {
-                diag.emplace_back(DiagLevel::Critical, "Writing chunk-by-chunk is not implemented for DASH files.", context);
-                throw NotImplementedException();
-            }
+            // -> movie fragments are rewritten along with their media data when writing chunk-by-chunk (see makeMovieFragment())
             // -> tags must be placed at the beginning
             newTagPos = ElementPosition::BeforeData;
+            // -> existing segment indexes are omitted and a new one is made in front of the media data if enabled
+            if (m_segmentIndexGenerationEnabled && writeChunkByChunk) {
+                diag.emplace_back(DiagLevel::Warning, "Unable to make a sidx atom because the tracks are written chunk-by-chunk.", context);
+            }
+            segmentIndexRequired = m_segmentIndexGenerationEnabled && !writeChunkByChunk;
         }
 
         // media data atom (mandatory?)
         // -> consider not only mdat as media data atom; consider everything not handled otherwise as media data
+        // -> count the padding in front of it (reported via applyChangesResult())
         for (firstMediaDataAtom = nullptr, level0Atom = firstElement(); level0Atom; level0Atom = level0Atom->nextSibling()) {
             level0Atom->parse(diag);
             switch (level0Atom->id()) {
-            case Mp4AtomIds::FileType:
-            case Mp4AtomIds::ProgressiveDownloadInformation:
-            case Mp4AtomIds::Movie:
             case Mp4AtomIds::Free:
             case Mp4AtomIds::Skip:
+                originalPadding += level0Atom->totalSize();
                 continue;
-            default:
+            case Mp4AtomIds::FileType:
+            case Mp4AtomIds::ProgressiveDownloadInformation:
+            case Mp4AtomIds::Movie:
+                continue;
+            case Mp4AtomIds::SegmentIndex:
+                if (segmentIndexRequired) {
+                    continue;
+                }
+                [[fallthrough]];
+            default:
                 firstMediaDataAtom = level0Atom;
             }
             break;
@@ -360,6 +1183,16 @@ void Mp4Container::internalMakeFile(Diagnostics &diag, AbortableProgressFeedback
         }
     }
 
+    // -> compact the track atoms if enabled (see isMovieAtomCompactionEnabled())
+    // note: The sample groups of the movie atom might be referenced by the track fragments of DASH files.
+    for (auto &track : tracks()) {
+        if (m_movieAtomCompactionEnabled) {
+            track->compactAtoms(m_strippedAtomIds, !firstMovieFragmentAtom, diag);
+        } else {
+            track->discardCompactedAtoms();
+        }
+    }
+
     // -> size of movie atom (contains track and tag information)
     movieAtomSize = userDataAtomSize = 0;
     try {
@@ -378,6 +1211,9 @@ void Mp4Container::internalMakeFile(Diagnostics &diag, AbortableProgressFeedback
                                 break;
                             default:
                                 // add size of unknown children of the user data atom
+                                if (isStripped(level2Atom)) {
+                                    break;
+                                }
                                 userDataAtomSize += level2Atom->totalSize();
                                 level2Atom->makeBuffer();
                             }
@@ -393,6 +1229,9 @@ void Mp4Container::internalMakeFile(Diagnostics &diag, AbortableProgressFeedback
                     break;
                 default:
                     // add size of unknown children of the movie atom
+                    if (isStripped(level1Atom)) {
+                        break;
+                    }
                     movieAtomSize += level1Atom->totalSize();
                     level1Atom->makeBuffer();
                 }
@@ -418,15 +1257,70 @@ void Mp4Container::internalMakeFile(Diagnostics &diag, AbortableProgressFeedback
         throw InvalidDataException();
     }
 
+    // -> size of the segment index (in version 1) and durations of the movie fragments it refers to
+    // note: The durations are taken from the first video track or the first track if there is no video track.
+    Mp4Track *segmentIndexTrack = nullptr;
+    auto segmentDurations = vector<std::uint32_t>();
+    auto earliestPresentationTime = std::uint64_t();
+    if (segmentIndexRequired) {
+        for (auto &track : tracks()) {
+            if (!segmentIndexTrack || (track->mediaType() == MediaType::Video && segmentIndexTrack->mediaType() != MediaType::Video)) {
+                segmentIndexTrack = track.get();
+            }
+        }
+        if (!segmentIndexTrack) {
+            diag.emplace_back(DiagLevel::Critical, "Unable to make a sidx atom because there are no tracks.", context);
+            throw InvalidDataException();
+        }
+        auto segmentDuration = std::uint64_t();
+        try {
+            for (level0Atom = firstMovieFragmentAtom; level0Atom; level0Atom = level0Atom->siblingById(Mp4AtomIds::MovieFragment, diag)) {
+                const auto fragment = segmentIndexTrack->readFragment(level0Atom->startOffset(), diag);
+                if (segmentDurations.empty()) {
+                    earliestPresentationTime = fragment.baseMediaDecodeTime;
+                }
+                segmentDuration = max(segmentDuration, fragment.duration);
+                segmentDurations.emplace_back(static_cast<std::uint32_t>(fragment.duration));
+            }
+        } catch (const Failure &) {
+            diag.emplace_back(DiagLevel::Critical, "Unable to read the movie fragments of the source file to make a sidx atom.", context);
+            throw InvalidDataException();
+        }
+        if (segmentDurations.size() > numeric_limits<std::uint16_t>::max() || segmentDuration > numeric_limits<std::uint32_t>::max()) {
+            diag.emplace_back(
+                DiagLevel::Critical, "Unable to make a sidx atom because there are too many or too long movie fragments.", context);
+            throw InvalidDataException();
+        }
+        segmentIndexSize = 8 + 4 + 4 + 4 + 8 + 8 + 2 + 2 + 12 * segmentDurations.size();
+    }
+
     progress.stopIfAborted();
 
+    // patch only the changed tag fields if enabled, nothing but tags has been changed and they still fit
+    // note: Otherwise changes to the tracks would be dropped.
+    if (const auto changes = fileInfo().changes(); m_tagFieldPatchingEnabled && !m_movieAtomCompactionEnabled && !segmentIndexRequired
+        && !rewriteRequired && (changes == MediaFileChanges::None || changes == MediaFileChanges::Tags)
+        && (!fileInfo().forceTagPosition() || initialNewTagPos == ElementPosition::Keep || initialNewTagPos == currentTagPos)
+        && patchTagFields(movieAtom, tagMaker, diag, progress)) {
+        return;
+    }
+
+    // patch only the user data atom if enabled, nothing but tags has been changed and the space after the movie atom suffices
+    // note: Otherwise changes to the tracks would be dropped.
+    if (const auto changes = fileInfo().changes(); m_userDataPatchingEnabled && !m_movieAtomCompactionEnabled && !segmentIndexRequired
+        && !rewriteRequired && (changes == MediaFileChanges::None || changes == MediaFileChanges::Tags)
+        && (!fileInfo().forceTagPosition() || initialNewTagPos == ElementPosition::Keep || initialNewTagPos == currentTagPos)
+        && patchUserData(movieAtom, tagMaker, userDataAtomSize, diag, progress)) {
+        return;
+    }
+
     // check whether there are atoms to be voided after movie next sibling (only relevant when not rewriting)
     if (!rewriteRequired) {
         newPaddingEnd = 0;
         std::uint64_t currentSum = 0;
         for (Mp4Atom *level0Atom = firstMediaDataAtom; level0Atom; level0Atom = level0Atom->nextSibling()) {
             level0Atom->parse(diag);
-            switch (level0Atom->id()) {
+            switch (madeAnewAsPadding(level0Atom)) {
             case Mp4AtomIds::FileType:
             case Mp4AtomIds::ProgressiveDownloadInformation:
             case Mp4AtomIds::Movie:
@@ -465,6 +1359,9 @@ calculatePadding:
         default:;
         }
 
+        // segment index (always in front of the media data)
+        currentOffset += segmentIndexSize;
+
         // check whether there is sufficiant space before the next atom
         if (!(rewriteRequired = firstMediaDataAtom && currentOffset > firstMediaDataAtom->startOffset())) {
             // there is sufficiant space
@@ -473,8 +1370,10 @@ calculatePadding:
             //                 shouldn't be tanken into account (it can't be used to prepend further tag info)
             //    max padding: says "do not waste more than ... byte", so here all padding should be taken into account
             newPadding = firstMediaDataAtom->startOffset() - currentOffset;
-            rewriteRequired = (newPadding > 0 && newPadding < 8) || newPadding < fileInfo().minPadding()
-                || (newPadding + newPaddingEnd) > fileInfo().maxPadding();
+            //    (both are not relevant when in-place update is enforced)
+            rewriteRequired = (newPadding > 0 && newPadding < 8)
+                || (!fileInfo().isForcingInPlace()
+                    && (newPadding < fileInfo().minPadding() || (newPadding + newPaddingEnd) > fileInfo().maxPadding()));
         }
         if (rewriteRequired) {
             // can't put the tags before media data
@@ -500,21 +1399,263 @@ calculatePadding:
         }
     }
 
+    // fail before modifying the file if it would need to be rewritten but applying changes in-place is enforced
+    if (rewriteRequired && fileInfo().isForcingInPlace()) {
+        diag.emplace_back(DiagLevel::Critical, "The file would need to be rewritten but applying changes in-place is enforced.", context);
+        throw RewriteRequiredException();
+    }
+
+    // promote stco atoms to co64 atoms if 32-bit chunk offsets would overflow in the new file
+    const auto headerSize = fileTypeAtom->totalSize() + (progressiveDownloadInfoAtom ? progressiveDownloadInfoAtom->totalSize() : 0);
+    if (rewriteRequired && firstMediaDataAtom) {
+        try {
+            promoteChunkOffsetTables(headerSize, firstMediaDataAtom, newTagPos, newPadding, writeChunkByChunk, movieAtomSize, diag);
+        } catch (const Failure &) {
+            diag.emplace_back(DiagLevel::Critical, "Unable to determine whether chunk offsets need to be stored as 64-bit values.", context);
+            throw InvalidDataException();
+        }
+    }
+
+    // determine the size of the media data which is kept (everything but the atoms which are made anew)
+    auto mediaDataSize = std::uint64_t();
+    for (level0Atom = firstMediaDataAtom; level0Atom; level0Atom = level0Atom->nextSibling()) {
+        switch (madeAnewAsPadding(level0Atom)) {
+        case Mp4AtomIds::FileType:
+        case Mp4AtomIds::ProgressiveDownloadInformation:
+        case Mp4AtomIds::Movie:
+        case Mp4AtomIds::Free:
+        case Mp4AtomIds::Skip:
+            break;
+        default:
+            mediaDataSize += level0Atom->totalSize();
+        }
+    }
+    m_applyChangesResult.setLayout(rewriteRequired, originalPadding, newPadding);
+    m_applyChangesResult.fileSizeAfter
+        = headerSize + movieAtomSize + newPadding + segmentIndexSize + mediaDataSize + (rewriteRequired ? 0 : newPaddingEnd);
+
+    // return the layout if only planning the changes (before the tracks are altered); when rewriting, the media data is copied
+    if (m_planningFile) {
+        m_applyChangesResult.bytesCopied = rewriteRequired ? mediaDataSize : 0;
+        return;
+    }
+
+    // fail before writing anything if the chunk offsets can only be determined after writing the media data
+    if (m_seeklessOutput && (writeChunkByChunk || firstMovieFragmentAtom)) {
+        diag.emplace_back(DiagLevel::Critical,
+            "Writing fragmented MP4 files or MP4 files with altered tracks to a seekless output is not supported as the offsets are only known "
+            "after writing the media data.",
+            context);
+        throw NotImplementedException();
+    }
+
+    // determine the ranges of the atoms which are not made anew (and therefore not altered when applying changes in-place)
+    // -> consider the same atoms as media data as when writing the file
+    const auto determineMediaDataRanges = [&] {
+        vector<pair<std::uint64_t, std::uint64_t>> mediaDataRanges;
+        for (auto *atom = firstMediaDataAtom; atom; atom = atom->nextSibling()) {
+            atom->parse(diag);
+            switch (madeAnewAsPadding(atom)) {
+            case Mp4AtomIds::FileType:
+            case Mp4AtomIds::ProgressiveDownloadInformation:
+            case Mp4AtomIds::Movie:
+            case Mp4AtomIds::Free:
+            case Mp4AtomIds::Skip:
+                break;
+            default:
+                mediaDataRanges.emplace_back(atom->startOffset(), atom->endOffset());
+            }
+        }
+        return mediaDataRanges;
+    };
+
+    // shift the media data by whole file system blocks instead of rewriting the file if enabled
+    // note: Not done for DASH files because the offsets within the fragments would need to be updated as well. The movie
+    //       atom is made anew in front of the shifted media data so the inserted blocks are overwritten with padding. Everything
+    //       but the media data is saved to a journal beforehand so the original file can be restored on failure.
+    auto blocksShifted = false;
+    auto originalMediaDataOffset = std::uint64_t(), shiftedMediaDataOffset = std::uint64_t();
+    string backupPath, journalPath;
+    if (rewriteRequired && fileInfo().isBlockShiftingEnabled() && !fileInfo().isForcingRewrite() && fileInfo().saveFilePath().empty()
+        && fileInfo().backupStrategy() != BackupStrategy::Journal && !writeChunkByChunk && !firstMovieFragmentAtom && firstMediaDataAtom
+        && newTagPos != ElementPosition::AfterData && !m_seeklessOutput) {
+        const auto mediaDataOffset = firstMediaDataAtom->startOffset();
+        const auto minMediaDataOffset = headerSize + movieAtomSize + max<std::uint64_t>(fileInfo().preferredPadding(), 8);
+        // -> chunk offsets must not exceed 32-bit (tables have only been promoted for the layout of the rewritten file)
+        //    so the shift is only done if the new file can not exceed 4 GiB or all tracks store 64-bit offsets anyways
+        const auto chunkOffsetsMayOverflow = fileInfo().size() + minMediaDataOffset + FileRangeCopier::maxShiftBlockSize
+                > numeric_limits<std::uint32_t>::max() + mediaDataOffset
+            && any_of(tracks().cbegin(), tracks().cend(),
+                [](const auto &track) { return track->chunkOffsetSize() == 4 && !track->isChunkOffsetTablePromoted(); });
+        auto journalCreated = false;
+        if (!chunkOffsetsMayOverflow) {
+            try {
+                BackupHelper::createJournal(fileInfo().backupDirectory(), fileInfo().path(), journalPath, fileInfo().stream(), fileInfo().size(),
+                    determineMediaDataRanges());
+                journalCreated = true;
+            } catch (const std::ios_base::failure &failure) {
+                diag.emplace_back(DiagLevel::Warning, argsToString("Not shifting the media data: ", failure.what()), context);
+            }
+        }
+        if (journalCreated) {
+            // -> buffer everything to make the track atoms as their offsets within the file are going to change
+            for (auto &track : tracks()) {
+                track->bufferTrackAtoms(diag, true);
+            }
+            const auto newMediaDataOffset = FileRangeCopier::shiftData(fileInfo().path(), mediaDataOffset, minMediaDataOffset);
+            if (newMediaDataOffset == mediaDataOffset) {
+                std::remove(BasicFileInfo::pathForOpen(journalPath));
+                journalPath.clear();
+            } else {
+                diag.emplace_back(DiagLevel::Information,
+                    argsToString(
+                        "Shifted the media data from offset ", mediaDataOffset, " to ", newMediaDataOffset, " instead of rewriting the file."),
+                    context);
+                vector<std::int64_t> origOffsets, newOffsets;
+                for (level0Atom = firstMediaDataAtom; level0Atom; level0Atom = level0Atom->nextSibling()) {
+                    if (level0Atom->id() == Mp4AtomIds::MediaData) {
+                        origOffsets.push_back(static_cast<std::int64_t>(level0Atom->startOffset()));
+                        newOffsets.push_back(static_cast<std::int64_t>(level0Atom->startOffset() + newMediaDataOffset - mediaDataOffset));
+                    }
+                }
+                for (auto &track : tracks()) {
+                    track->setChunkOffsetShift(origOffsets, newOffsets);
+                }
+                fileInfo().reportSizeChanged(fileInfo().size() + newMediaDataOffset - mediaDataOffset);
+                newPadding = newMediaDataOffset - headerSize - movieAtomSize;
+                rewriteRequired = false;
+                blocksShifted = true;
+                originalMediaDataOffset = mediaDataOffset;
+                shiftedMediaDataOffset = newMediaDataOffset;
+                m_applyChangesResult.setLayout(false, originalPadding, newPadding);
+                m_applyChangesResult.strategy = ApplyChangesStrategy::BlockShift;
+                m_applyChangesResult.fileSizeAfter = headerSize + movieAtomSize + newPadding + mediaDataSize + newPaddingEnd;
+            }
+        }
+    }
+
+    // compute the sizes of the segments the segment index refers to for the new layout
+    // note: The segment index is located directly in front of the media data (after the movie atom and the padding). Each
+    //       segment consists of a movie fragment and the atoms up to the next one (ending with the last "mdat"-atom).
+    auto segmentReferences = vector<pair<std::uint32_t, std::uint32_t>>();
+    auto segmentIndexFirstOffset = std::uint64_t();
+    if (segmentIndexSize) {
+        const auto segmentIndexEnd = headerSize + movieAtomSize + newPadding + segmentIndexSize;
+        auto movieFragmentOffsets = vector<std::uint64_t>();
+        auto segmentsEnd = std::uint64_t(), newOffset = segmentIndexEnd;
+        movieFragmentOffsets.reserve(segmentDurations.size());
+        for (level0Atom = firstMediaDataAtom; level0Atom; level0Atom = level0Atom->nextSibling()) {
+            switch (madeAnewAsPadding(level0Atom)) {
+            case Mp4AtomIds::FileType:
+            case Mp4AtomIds::ProgressiveDownloadInformation:
+            case Mp4AtomIds::Movie:
+            case Mp4AtomIds::Free:
+            case Mp4AtomIds::Skip:
+                if (rewriteRequired) {
+                    continue;
+                }
+                break;
+            default:;
+            }
+            const auto offset = rewriteRequired ? newOffset : level0Atom->startOffset();
+            newOffset = offset + level0Atom->totalSize();
+            if (level0Atom->id() == Mp4AtomIds::MovieFragment) {
+                movieFragmentOffsets.emplace_back(offset);
+                segmentsEnd = newOffset;
+            } else if (level0Atom->id() == Mp4AtomIds::MediaData && !movieFragmentOffsets.empty()) {
+                segmentsEnd = newOffset;
+            }
+        }
+        if (movieFragmentOffsets.size() != segmentDurations.size()) {
+            diag.emplace_back(DiagLevel::Critical, "Unable to make a sidx atom because the movie fragments could not be located.", context);
+            throw InvalidDataException();
+        }
+        segmentIndexFirstOffset = movieFragmentOffsets.front() - segmentIndexEnd;
+        segmentReferences.reserve(movieFragmentOffsets.size());
+        for (std::size_t i = 0; i != movieFragmentOffsets.size(); ++i) {
+            const auto segmentSize = (i + 1 != movieFragmentOffsets.size() ? movieFragmentOffsets[i + 1] : segmentsEnd) - movieFragmentOffsets[i];
+            if (segmentSize > 0x7FFFFFFF) {
+                diag.emplace_back(DiagLevel::Critical, "Unable to make a sidx atom because a movie fragment exceeds 2 GiB.", context);
+                throw InvalidDataException();
+            }
+            segmentReferences.emplace_back(static_cast<std::uint32_t>(segmentSize), segmentDurations[i]);
+        }
+    }
+
+    // compute the new offsets of the media data atoms so the tracks are made with already updated chunk offsets
+    // note: Not done for DASH files because the offsets within the fragments need to be updated afterwards anyways.
+    vector<std::int64_t> expectedOrigMediaDataOffsets, expectedNewMediaDataOffsets;
+    if (rewriteRequired && !writeChunkByChunk && !firstMovieFragmentAtom && firstMediaDataAtom) {
+        auto newOffset = headerSize + (newTagPos == ElementPosition::AfterData ? 0 : movieAtomSize) + newPadding;
+        for (level0Atom = firstMediaDataAtom; level0Atom; level0Atom = level0Atom->nextSibling()) {
+            switch (level0Atom->id()) {
+            case Mp4AtomIds::FileType:
+            case Mp4AtomIds::ProgressiveDownloadInformation:
+            case Mp4AtomIds::Movie:
+            case Mp4AtomIds::Free:
+            case Mp4AtomIds::Skip:
+                continue;
+            case Mp4AtomIds::MediaData:
+                expectedOrigMediaDataOffsets.push_back(static_cast<std::int64_t>(level0Atom->startOffset()));
+                expectedNewMediaDataOffsets.push_back(static_cast<std::int64_t>(newOffset));
+                break;
+            default:;
+            }
+            newOffset += level0Atom->totalSize();
+        }
+        for (auto &track : tracks()) {
+            track->setChunkOffsetShift(expectedOrigMediaDataOffsets, expectedNewMediaDataOffsets);
+        }
+    }
+
     // setup stream(s) for writing
-    // -> update status
-    progress.nextStepOrStop("Preparing streams ...");
+    // -> update status (an abort after shifting the media data is handled when starting to write so it is shifted back)
+    layoutTimer.stop();
+    if (blocksShifted) {
+        progress.updateStep("Preparing streams ...");
+    } else {
+        progress.nextStepOrStop("Preparing streams ...");
+    }
 
     // -> define variables needed to handle output stream and backup stream (required when rewriting the file)
-    string backupPath;
     NativeFileStream &outputStream = fileInfo().stream();
     NativeFileStream backupStream; // create a stream to open the backup/original file for the case rewriting the file is required
-    BinaryWriter outputWriter(&outputStream);
-
-    if (rewriteRequired) {
-        if (fileInfo().saveFilePath().empty()) {
+    BackupHelper::TemporaryFile temporaryFile; // the new file replacing the original file when using BackupStrategy::TemporaryFile
+    // -> write to the seekless output instead and read from the untouched original file if set
+    std::ostream &targetStream = m_seeklessOutput ? static_cast<std::ostream &>(*m_seeklessOutput) : outputStream;
+    std::istream &originalStream = m_seeklessOutput ? static_cast<std::istream &>(outputStream) : backupStream;
+    BinaryWriter outputWriter(&targetStream);
+    // -> restores the state of the tracks after writing to a seekless output (they are not reparsed in this case)
+    const auto restoreTracks = [this, &outputStream] {
+        for (auto &track : tracks()) {
+            track->setChunkOffsetShift({}, {});
+            track->setOutputStream(outputStream);
+        }
+    };
+
+    if (m_seeklessOutput) {
+        // the range copier is not opened as the kernel can only copy between regular files
+        diag.emplace_back(DiagLevel::Information, "Writing the file to a seekless output.", context);
+    } else if (rewriteRequired) {
+        if (fileInfo().saveFilePath().empty() && fileInfo().backupStrategy() == BackupStrategy::TemporaryFile
+            && temporaryFile.create(fileInfo().path())) {
+            // keep the original file untouched as backupStream and write the new file into the temporary file replacing it when done
+            try {
+                backupStream.exceptions(ios_base::badbit | ios_base::failbit);
+                backupStream.open(BasicFileInfo::pathForOpen(fileInfo().path()), ios_base::in | ios_base::binary);
+                fileInfo().close();
+                outputStream.open(BasicFileInfo::pathForOpen(temporaryFile.path()), ios_base::out | ios_base::binary | ios_base::trunc);
+            } catch (const std::ios_base::failure &failure) {
+                diag.emplace_back(DiagLevel::Critical, argsToString("Opening streams to write output file failed: ", failure.what()), context);
+                throw;
+            }
+        } else if (fileInfo().saveFilePath().empty()) {
             // move current file to temp dir and reopen it as backupStream, recreate original file
             try {
-                BackupHelper::createBackupFile(fileInfo().backupDirectory(), fileInfo().path(), backupPath, outputStream, backupStream);
+                auto backupTimer = ApplyPhaseTimer(fileInfo().statistics(), ApplyPhase::Backup);
+                m_applyChangesResult.backupCopied = BackupHelper::createBackupFile(fileInfo().backupDirectory(), fileInfo().path(), backupPath,
+                    outputStream, backupStream, fileInfo().backupStrategy(), fileInfo().durabilityPolicy());
+                backupTimer.stop();
                 // recreate original file, define buffer variables
                 outputStream.open(BasicFileInfo::pathForOpen(fileInfo().path()), ios_base::out | ios_base::binary | ios_base::trunc);
             } catch (const std::ios_base::failure &failure) {
@@ -538,12 +1679,26 @@ calculatePadding:
         // set backup stream as associated input stream since we need the original elements to write the new file
         setStream(backupStream);
 
+        // allow copying unchanged atoms and chunks by the kernel
+        rangeCopier().open(backupStream, backupPath.empty() ? fileInfo().path() : backupPath, outputStream,
+            temporaryFile.isCreated() ? temporaryFile.path() : (fileInfo().saveFilePath().empty() ? fileInfo().path() : fileInfo().saveFilePath()));
+
+        // reserve the space for the new file (assuming all media data is copied)
+        const auto expectedSize = headerSize + movieAtomSize + newPadding + mediaDataSize;
+        if (!rangeCopier().preallocate(expectedSize)) {
+            diag.emplace_back(
+                DiagLevel::Critical, argsToString("There is not enough space to write the new file of ", expectedSize, " bytes."), context);
+            throw std::ios_base::failure("not enough space");
+        }
+
         // TODO: reduce code duplication
 
     } else { // !rewriteRequired
-        // ensure everything to make track atoms is buffered before altering the source file
-        for (const auto &track : tracks()) {
-            track->bufferTrackAtoms(diag);
+        // ensure everything to make track atoms is buffered before altering the source file (already done when shifting)
+        if (!blocksShifted) {
+            for (const auto &track : tracks()) {
+                track->bufferTrackAtoms(diag);
+            }
         }
 
         // reopen original file to ensure it is opened for writing
@@ -552,8 +1707,31 @@ calculatePadding:
             outputStream.open(fileInfo().path(), ios_base::in | ios_base::out | ios_base::binary);
         } catch (const std::ios_base::failure &failure) {
             diag.emplace_back(DiagLevel::Critical, argsToString("Opening the file with write permissions failed: ", failure.what()), context);
+            if (blocksShifted
+                && BackupHelper::undoDataShift(fileInfo().path(), shiftedMediaDataOffset, originalMediaDataOffset, outputStream, diag, context)) {
+                fileInfo().reportSizeChanged(fileInfo().size() + originalMediaDataOffset - shiftedMediaDataOffset);
+                try {
+                    BackupHelper::restoreOriginalFileFromJournal(fileInfo().path(), journalPath, outputStream);
+                } catch (const std::ios_base::failure &restoreFailure) {
+                    diag.emplace_back(DiagLevel::Critical, restoreFailure.what(), context);
+                }
+            }
             throw;
         }
+
+        // save everything but the media data to the journal
+        if (fileInfo().backupStrategy() == BackupStrategy::Journal) {
+            try {
+                BackupHelper::createJournal(
+                    fileInfo().backupDirectory(), fileInfo().path(), journalPath, outputStream, fileInfo().size(), determineMediaDataRanges());
+            } catch (const std::ios_base::failure &failure) {
+                diag.emplace_back(DiagLevel::Critical, failure.what(), context);
+                throw;
+            }
+        } else if (fileInfo().backupStrategy() == BackupStrategy::Clone && !blocksShifted) {
+            // clone the file so it can be restored if patching it fails (if supported by the file system)
+            BackupHelper::createCloneBackupFile(fileInfo().backupDirectory(), fileInfo().path(), backupPath, fileInfo().durabilityPolicy());
+        }
     }
 
     // start actual writing
@@ -561,11 +1739,11 @@ calculatePadding:
         // write header
         progress.nextStepOrStop("Writing header and tags ...");
         // -> make file type atom
-        fileTypeAtom->copyBuffer(outputStream);
+        fileTypeAtom->copyBuffer(targetStream);
         fileTypeAtom->discardBuffer();
         // -> make progressive download info atom
         if (progressiveDownloadInfoAtom) {
-            progressiveDownloadInfoAtom->copyBuffer(outputStream);
+            progressiveDownloadInfoAtom->copyBuffer(targetStream);
             progressiveDownloadInfoAtom->discardBuffer();
         }
 
@@ -573,10 +1751,10 @@ calculatePadding:
         for (auto &track : tracks()) {
             // ensure the track reads from the original file
             if (&track->inputStream() == &outputStream) {
-                track->setInputStream(backupStream);
+                track->setInputStream(originalStream);
             }
             // ensure the track writes to the output file
-            track->setOutputStream(outputStream);
+            track->setOutputStream(targetStream);
         }
 
         // write movie atom / padding and media data
@@ -602,43 +1780,15 @@ calculatePadding:
                         return;
                     }
 
-                    // writer user data atom header
-                    Mp4Atom::makeHeader(userDataAtomSize, Mp4AtomIds::UserData, outputWriter);
-
-                    // write children of user data atom
-                    bool metaAtomWritten = false;
-                    for (Mp4Atom *level0Atom = movieAtom; level0Atom; level0Atom = level0Atom->siblingById(Mp4AtomIds::Movie, diag)) {
-                        for (Mp4Atom *level1Atom = level0Atom->childById(Mp4AtomIds::UserData, diag); level1Atom;
-                             level1Atom = level1Atom->siblingById(Mp4AtomIds::UserData, diag)) {
-                            for (Mp4Atom *level2Atom = level1Atom->firstChild(); level2Atom; level2Atom = level2Atom->nextSibling()) {
-                                switch (level2Atom->id()) {
-                                case Mp4AtomIds::Meta:
-                                    // write meta atom
-                                    for (auto &maker : tagMaker) {
-                                        maker.make(outputStream, diag);
-                                    }
-                                    metaAtomWritten = true;
-                                    break;
-                                default:
-                                    // write buffered data
-                                    level2Atom->copyBuffer(outputStream);
-                                    level2Atom->discardBuffer();
-                                }
-                            }
-                        }
-                    }
-
-                    // write meta atom if not already written
-                    if (!metaAtomWritten) {
-                        for (auto &maker : tagMaker) {
-                            maker.make(outputStream, diag);
-                        }
-                    }
-
+                    makeUserData(movieAtom, userDataAtomSize, tagMaker, outputWriter, diag);
                     userDataWritten = true;
                 };
 
                 // write movie atom
+                // -> hold it back when writing to a seekless output as the sizes of the track atoms are written afterwards
+                if (m_seeklessOutput) {
+                    m_seeklessOutput->hold();
+                }
                 // -> write movie atom header
                 Mp4Atom::makeHeader(movieAtomSize, Mp4AtomIds::Movie, outputWriter);
 
@@ -654,7 +1804,10 @@ calculatePadding:
                             break;
                         default:
                             // write buffered data
-                            level1Atom->copyBuffer(outputStream);
+                            if (isStripped(level1Atom)) {
+                                break;
+                            }
+                            level1Atom->copyBuffer(targetStream);
                             level1Atom->discardBuffer();
                         }
                     }
@@ -663,6 +1816,9 @@ calculatePadding:
                 // -> write tracks and user data atoms if not already happened within the loop
                 writeTracks();
                 writeUserData();
+                if (m_seeklessOutput) {
+                    m_seeklessOutput->release();
+                }
 
             } else {
                 // write padding
@@ -681,15 +1837,42 @@ calculatePadding:
 
                     // write zeroes
                     for (; newPadding; --newPadding) {
-                        outputStream.put(0);
+                        targetStream.put(0);
                     }
                 }
 
+                // write segment index
+                if (segmentIndexSize) {
+                    makeSegmentIndex(*segmentIndexTrack, earliestPresentationTime, segmentIndexFirstOffset, segmentReferences, outputWriter);
+                }
+
                 // write media data
                 if (rewriteRequired) {
+                    // read the default sample sizes of the tracks which are required to locate the samples of movie fragments
+                    const auto defaultSampleSizes = writeChunkByChunk && firstMovieFragmentAtom ? readDefaultSampleSizes(movieAtom, diag)
+                                                                                                : unordered_map<std::uint32_t, std::uint32_t>();
                     for (level0Atom = firstMediaDataAtom; level0Atom; level0Atom = level0Atom->nextSibling()) {
                         level0Atom->parse(diag);
-                        switch (level0Atom->id()) {
+                        // rewrite movie fragments along with their media data when writing chunk-by-chunk
+                        // -> their original "mdat"-atoms are skipped as all other "mdat"-atoms
+                        // -> index atoms referring to the original layout can not be updated and are omitted
+                        if (writeChunkByChunk && firstMovieFragmentAtom) {
+                            switch (level0Atom->id()) {
+                            case Mp4AtomIds::MovieFragment:
+                                progress.updateStep("Writing movie fragment ...");
+                                makeMovieFragment(level0Atom, defaultSampleSizes, outputWriter, diag);
+                                continue;
+                            case Mp4AtomIds::SegmentIndex:
+                            case Mp4AtomIds::MovieFragmentRandomAccess:
+                                diag.emplace_back(DiagLevel::Warning,
+                                    argsToString("Omitting \"", level0Atom->idToString(),
+                                        "\"-atom because it can not be updated when writing chunk-by-chunk."),
+                                    context);
+                                continue;
+                            default:;
+                            }
+                        }
+                        switch (madeAnewAsPadding(level0Atom)) {
                         case Mp4AtomIds::FileType:
                         case Mp4AtomIds::ProgressiveDownloadInformation:
                         case Mp4AtomIds::Movie:
@@ -703,14 +1886,14 @@ calculatePadding:
                             } else {
                                 // store media data offsets when not writing chunk-by-chunk to be able to update chunk offset table
                                 origMediaDataOffsets.push_back(static_cast<std::int64_t>(level0Atom->startOffset()));
-                                newMediaDataOffsets.push_back(outputStream.tellp());
+                                newMediaDataOffsets.push_back(targetStream.tellp());
                             }
                             [[fallthrough]];
                         default:
                             // update status
                             progress.updateStep("Writing atom: " + level0Atom->idToString());
                             // copy atom entirely and forward status update calls
-                            level0Atom->copyEntirely(outputStream, diag, &progress);
+                            level0Atom->copyEntirely(targetStream, diag, &progress);
                         }
                     }
 
@@ -747,41 +1930,114 @@ calculatePadding:
                         Mp4Atom::addHeaderSize(totalMediaDataSize);
                         Mp4Atom::makeHeader(totalMediaDataSize, Mp4AtomIds::MediaData, outputWriter);
 
-                        // -> copy chunks
-                        CopyHelper<0x2000> copyHelper;
-                        std::uint64_t chunkIndexWithinTrack = 0, totalChunksCopied = 0;
-                        bool anyChunksCopied;
-                        do {
-                            progress.stopIfAborted();
-
-                            // copy a chunk from each track
-                            anyChunksCopied = false;
-                            for (size_t trackIndex = 0; trackIndex < trackCount; ++trackIndex) {
-                                // get source stream and tables for current track
-                                auto &trackInfo = trackInfos[trackIndex];
-                                istream &sourceStream = *get<0>(trackInfo);
-                                vector<std::uint64_t> &chunkOffsetTable = get<1>(trackInfo);
-                                const vector<std::uint64_t> &chunkSizesTable = get<2>(trackInfo);
-
-                                // still chunks to be copied (of this track)?
-                                if (chunkIndexWithinTrack < chunkOffsetTable.size() && chunkIndexWithinTrack < chunkSizesTable.size()) {
-                                    // copy chunk, update entry in chunk offset table
-                                    sourceStream.seekg(static_cast<streamoff>(chunkOffsetTable[chunkIndexWithinTrack]));
-                                    chunkOffsetTable[chunkIndexWithinTrack] = static_cast<std::uint64_t>(outputStream.tellp());
-                                    copyHelper.copy(sourceStream, outputStream, chunkSizesTable[chunkIndexWithinTrack]);
-
-                                    // update counter / status
-                                    anyChunksCopied = true;
-                                    ++totalChunksCopied;
+                        // -> determine the order of the chunks
+                        auto chunks = vector<ChunkCopy>();
+                        chunks.reserve(totalChunkCount);
+                        if (m_interleaveDuration.totalTicks() > 0) {
+                            // group chunks by interleave periods via the decoding time of their first sample
+                            try {
+                                const auto interleaveDuration = m_interleaveDuration.totalSeconds();
+                                for (size_t trackIndex = 0; trackIndex < trackCount; ++trackIndex) {
+                                    auto &track = tracks()[trackIndex];
+                                    if (!track->timeScale()) {
+                                        throw InvalidDataException();
+                                    }
+                                    const auto decodingTimes = track->readChunkDecodingTimes(diag);
+                                    auto &trackInfo = trackInfos[trackIndex];
+                                    vector<std::uint64_t> &chunkOffsetTable = get<1>(trackInfo);
+                                    const vector<std::uint64_t> &chunkSizesTable = get<2>(trackInfo);
+                                    const auto chunkCount = min({ chunkOffsetTable.size(), chunkSizesTable.size(), decodingTimes.size() });
+                                    for (size_t chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex) {
+                                        const auto decodingTime = static_cast<double>(decodingTimes[chunkIndex]) / track->timeScale();
+                                        chunks.emplace_back(ChunkCopy{ chunkOffsetTable[chunkIndex], chunkSizesTable[chunkIndex],
+                                            &chunkOffsetTable[chunkIndex], trackIndex, static_cast<std::uint64_t>(decodingTime / interleaveDuration) });
+                                    }
                                 }
+                                // -> the sort is stable so chunks of the same track within a period keep their order
+                                stable_sort(chunks.begin(), chunks.end(), [](const ChunkCopy &lhs, const ChunkCopy &rhs) {
+                                    return lhs.interleavePeriod < rhs.interleavePeriod
+                                        || (lhs.interleavePeriod == rhs.interleavePeriod && lhs.trackIndex < rhs.trackIndex);
+                                });
+                            } catch (const Failure &) {
+                                diag.emplace_back(DiagLevel::Warning,
+                                    "Unable to determine decoding times of chunks. Chunks will be interleaved by their index instead.",
+                                    context);
+                                chunks.clear();
                             }
+                        }
+                        if (chunks.empty()) {
+                            // take a chunk from each track in turn
+                            bool anyChunksAdded;
+                            size_t chunkIndexWithinTrack = 0;
+                            do {
+                                anyChunksAdded = false;
+                                for (size_t trackIndex = 0; trackIndex < trackCount; ++trackIndex) {
+                                    auto &trackInfo = trackInfos[trackIndex];
+                                    vector<std::uint64_t> &chunkOffsetTable = get<1>(trackInfo);
+                                    const vector<std::uint64_t> &chunkSizesTable = get<2>(trackInfo);
+                                    if (chunkIndexWithinTrack < chunkOffsetTable.size() && chunkIndexWithinTrack < chunkSizesTable.size()) {
+                                        chunks.emplace_back(ChunkCopy{ chunkOffsetTable[chunkIndexWithinTrack],
+                                            chunkSizesTable[chunkIndexWithinTrack], &chunkOffsetTable[chunkIndexWithinTrack], trackIndex, 0 });
+                                        anyChunksAdded = true;
+                                    }
+                                }
+                                ++chunkIndexWithinTrack;
+                            } while (anyChunksAdded);
+                        }
 
-                            // incrase chunk index within track, update progress percentage
-                            if (!(++chunkIndexWithinTrack % 10)) {
-                                progress.updateStepPercentage(static_cast<std::uint8_t>(totalChunksCopied * 100 / totalChunkCount));
+                        // -> copy chunks using multiple threads to read ahead if enabled and all chunks are from the original file
+                        auto chunksCopied = false;
+#ifdef PLATFORM_UNIX
+                        const auto threadCount
+                            = m_chunkCopyThreadCount ? m_chunkCopyThreadCount : max<std::size_t>(thread::hardware_concurrency(), 1);
+                        if (threadCount > 1 && !chunks.empty()
+                            && all_of(trackInfos.cbegin(), trackInfos.cend(),
+                                [&backupStream](const auto &trackInfo) { return get<0>(trackInfo) == &backupStream; })) {
+                            // write the chunks in order as they become available
+                            auto prefetcher = ChunkPrefetcher(
+                                backupPath.empty() ? fileInfo().path() : backupPath, chunks, min<std::size_t>(threadCount, chunks.size()));
+                            if (prefetcher.isOpen()) {
+                                auto bytesSinceAbortCheck = std::uint64_t();
+                                for (std::size_t chunkIndex = 0; chunkIndex != chunks.size(); ++chunkIndex) {
+                                    const auto &chunk = chunks[chunkIndex];
+                                    if (!(chunkIndex % 10) || bytesSinceAbortCheck >= FileRangeCopier::abortCheckInterval) {
+                                        progress.stopIfAborted();
+                                        progress.updateStepPercentage(static_cast<std::uint8_t>(chunkIndex * 100 / chunks.size()));
+                                        bytesSinceAbortCheck = 0;
+                                    }
+                                    bytesSinceAbortCheck += chunk.size;
+                                    const auto *const buffer = prefetcher.wait(chunkIndex);
+                                    *chunk.newOffset = static_cast<std::uint64_t>(targetStream.tellp());
+                                    if (buffer) {
+                                        targetStream.write(buffer->data(), static_cast<streamsize>(buffer->size()));
+                                    } else {
+                                        backupStream.seekg(static_cast<streamoff>(chunk.sourceOffset));
+                                        rangeCopier().copy(backupStream, targetStream, chunk.size);
+                                    }
+                                    prefetcher.release(chunkIndex);
+                                }
+                                chunksCopied = true;
+                            } else {
+                                diag.emplace_back(DiagLevel::Debug,
+                                    "Unable to open the original file for reading chunks ahead; copying chunks sequentially instead.", context);
                             }
-
-                        } while (anyChunksCopied);
+                        }
+#endif
+                        // -> copy chunks sequentially otherwise
+                        auto bytesSinceAbortCheck = std::uint64_t();
+                        for (std::size_t chunkIndex = 0; !chunksCopied && chunkIndex != chunks.size(); ++chunkIndex) {
+                            const auto &chunk = chunks[chunkIndex];
+                            if (!(chunkIndex % 10) || bytesSinceAbortCheck >= FileRangeCopier::abortCheckInterval) {
+                                progress.stopIfAborted();
+                                progress.updateStepPercentage(static_cast<std::uint8_t>(chunkIndex * 100 / chunks.size()));
+                                bytesSinceAbortCheck = 0;
+                            }
+                            bytesSinceAbortCheck += chunk.size;
+                            istream &sourceStream = *get<0>(trackInfos[chunk.trackIndex]);
+                            sourceStream.seekg(static_cast<streamoff>(chunk.sourceOffset));
+                            *chunk.newOffset = static_cast<std::uint64_t>(targetStream.tellp());
+                            rangeCopier().copy(sourceStream, targetStream, chunk.size);
+                        }
                     }
 
                 } else {
@@ -793,11 +2049,20 @@ calculatePadding:
                         case Mp4AtomIds::ProgressiveDownloadInformation:
                         case Mp4AtomIds::Movie:
                             // must void these if they occur "between" the media data
-                            outputStream.seekp(4, ios_base::cur);
+                            targetStream.seekp(4, ios_base::cur);
                             outputWriter.writeUInt32BE(Mp4AtomIds::Free);
                             break;
+                        case Mp4AtomIds::SegmentIndex:
+                            if (segmentIndexRequired) {
+                                // void the original segment index as it has been made anew in front of the media data
+                                targetStream.seekp(4, ios_base::cur);
+                                outputWriter.writeUInt32BE(Mp4AtomIds::Free);
+                                targetStream.seekp(static_cast<iostream::off_type>(level0Atom->totalSize() - 8), ios_base::cur);
+                                break;
+                            }
+                            [[fallthrough]];
                         default:
-                            outputStream.seekp(static_cast<iostream::off_type>(level0Atom->totalSize()), ios_base::cur);
+                            targetStream.seekp(static_cast<iostream::off_type>(level0Atom->totalSize()), ios_base::cur);
                         }
                         if (level0Atom == lastAtomToBeWritten) {
                             break;
@@ -807,6 +2072,18 @@ calculatePadding:
             }
         }
 
+        // keep the parsing results when writing to a seekless output as the original file has not been modified
+        // note: The chunk offsets have been written for the expected layout and can not be corrected afterwards.
+        if (m_seeklessOutput) {
+            if (expectedNewMediaDataOffsets != newMediaDataOffsets) {
+                diag.emplace_back(DiagLevel::Critical, "The media data has not been written at the expected offsets.", context);
+                throw Failure();
+            }
+            targetStream.flush();
+            restoreTracks();
+            return;
+        }
+
         // reparse what is written so far
         progress.updateStep("Reparsing output file ...");
         if (rewriteRequired) {
@@ -818,8 +2095,10 @@ calculatePadding:
                 fileInfo().setSaveFilePath(string());
             }
             // the outputStream needs to be reopened to be able to read again
+            rangeCopier().close();
             outputStream.close();
-            outputStream.open(BasicFileInfo::pathForOpen(fileInfo().path()), ios_base::in | ios_base::out | ios_base::binary);
+            outputStream.open(BasicFileInfo::pathForOpen(temporaryFile.isCreated() ? temporaryFile.path() : fileInfo().path()),
+                ios_base::in | ios_base::out | ios_base::binary);
             setStream(outputStream);
         } else {
             const auto newSize = static_cast<std::uint64_t>(outputStream.tellp());
@@ -875,18 +2154,541 @@ calculatePadding:
                         throw Failure();
                     }
                 }
-            } else {
+            } else if (expectedNewMediaDataOffsets.empty()) {
                 progress.updateStep("Updating chunk offset table for each track ...");
                 updateOffsets(origMediaDataOffsets, newMediaDataOffsets, diag);
+            } else if (expectedNewMediaDataOffsets != newMediaDataOffsets) {
+                // the chunk offsets have been written for the expected layout; correct them if the actual layout differs
+                diag.emplace_back(DiagLevel::Debug, "The media data has not been written at the expected offsets.", context);
+                progress.updateStep("Updating chunk offset table for each track ...");
+                updateOffsets(expectedNewMediaDataOffsets, newMediaDataOffsets, diag);
             }
         }
 
         // prevent deferring final write operations (to catch and handle possible errors here)
         outputStream.flush();
 
+        // replace the original file with the new file now that it has been written completely
+        if (temporaryFile.isCreated() && !temporaryFile.replaceOriginalFile(fileInfo().path(), fileInfo().durabilityPolicy())) {
+            diag.emplace_back(DiagLevel::Warning, "Unable to sync the directory containing the file to the disk.", context);
+        }
+
         // handle errors (which might have been occurred after renaming/creating backup file)
     } catch (...) {
-        BackupHelper::handleFailureAfterFileModified(fileInfo(), backupPath, outputStream, backupStream, diag, context);
+        rangeCopier().close();
+        if (m_seeklessOutput) {
+            restoreTracks();
+            diag.emplace_back(DiagLevel::Critical, "Writing the file to the seekless output failed.", context);
+            throw;
+        }
+        if (temporaryFile.isCreated()) {
+            // the original file has not been touched -> just free the temporary file
+            outputStream.close();
+            temporaryFile.discard();
+        }
+        if (blocksShifted) {
+            if (BackupHelper::undoDataShift(fileInfo().path(), shiftedMediaDataOffset, originalMediaDataOffset, outputStream, diag, context)) {
+                fileInfo().reportSizeChanged(fileInfo().size() + originalMediaDataOffset - shiftedMediaDataOffset);
+            } else {
+                // keep the journal as restoring it would destroy the media data not being at its original offset
+                journalPath.clear();
+            }
+        }
+        BackupHelper::handleFailureAfterFileModified(fileInfo(), backupPath, journalPath, outputStream, backupStream, diag, context);
+    }
+
+    // the journal is only needed to undo the shifting
+    if (blocksShifted) {
+        std::remove(BasicFileInfo::pathForOpen(journalPath));
+    }
+}
+
+/*!
+ * \brief Writes the user data atom of the specified \a movieAtom containing the tags made by the specified \a tagMaker.
+ * \param userDataAtomSize Specifies the size of the new user data atom. Nothing is written if it is zero.
+ * \remarks Children of the original user data atom besides the meta atom must have been buffered.
+ */
+void Mp4Container::makeUserData(
+    Mp4Atom *movieAtom, std::uint64_t userDataAtomSize, std::vector<Mp4TagMaker> &tagMaker, BinaryWriter &writer, Diagnostics &diag)
+{
+    if (!userDataAtomSize) {
+        return;
+    }
+
+    // writer user data atom header
+    auto &outputStream = *writer.stream();
+    Mp4Atom::makeHeader(userDataAtomSize, Mp4AtomIds::UserData, writer);
+
+    // write children of user data atom
+    bool metaAtomWritten = false;
+    for (Mp4Atom *level0Atom = movieAtom; level0Atom; level0Atom = level0Atom->siblingById(Mp4AtomIds::Movie, diag)) {
+        for (Mp4Atom *level1Atom = level0Atom->childById(Mp4AtomIds::UserData, diag); level1Atom;
+             level1Atom = level1Atom->siblingById(Mp4AtomIds::UserData, diag)) {
+            for (Mp4Atom *level2Atom = level1Atom->firstChild(); level2Atom; level2Atom = level2Atom->nextSibling()) {
+                switch (level2Atom->id()) {
+                case Mp4AtomIds::Meta:
+                    // write meta atom
+                    for (auto &maker : tagMaker) {
+                        maker.make(outputStream, diag);
+                    }
+                    metaAtomWritten = true;
+                    break;
+                default:
+                    // write buffered data
+                    if (isStripped(level2Atom)) {
+                        break;
+                    }
+                    level2Atom->copyBuffer(outputStream);
+                    level2Atom->discardBuffer();
+                }
+            }
+        }
+    }
+
+    // write meta atom if not already written
+    if (!metaAtomWritten) {
+        for (auto &maker : tagMaker) {
+            maker.make(outputStream, diag);
+        }
+    }
+}
+
+/*!
+ * \brief Returns whether the specified \a atom is omitted when making the movie atom.
+ * \sa strippedAtomIds()
+ */
+bool Mp4Container::isStripped(const Mp4Atom *atom) const
+{
+    return m_movieAtomCompactionEnabled && find(m_strippedAtomIds.cbegin(), m_strippedAtomIds.cend(), atom->id()) != m_strippedAtomIds.cend();
+}
+
+/*!
+ * \brief Writes only the user data atom and patches the size of the movie atom if possible.
+ * \param userDataAtomSize Specifies the size of the new user data atom (zero if it is omitted).
+ * \returns Returns whether the user data atom could be patched. If not, nothing has been written and the file needs
+ *          to be made as usual.
+ *
+ * This is possible if the user data atom is the last child of the only movie atom and there is enough space until the
+ * next atom which is not a "free"/"skip"-atom (or the end of the file). The remaining space is turned into a single
+ * "free"-atom. This way the track atoms are not made again and there are no chunk offsets to be updated.
+ *
+ * \remarks The remaining space must match the padding settings unless applying changes in-place is enforced. The
+ *          padding can be adjusted freely if the movie atom is at the end of the file.
+ * \sa setUserDataPatchingEnabled()
+ */
+bool Mp4Container::patchUserData(
+    Mp4Atom *movieAtom, std::vector<Mp4TagMaker> &tagMaker, std::uint64_t userDataAtomSize, Diagnostics &diag, AbortableProgressFeedback &progress)
+{
+    static const string context("patching MP4 user data");
+
+    // ensure the user data atom is the last child of the only movie atom so no other atoms need to be moved
+    if (movieAtom->siblingById(Mp4AtomIds::Movie, diag)) {
+        return false;
+    }
+    Mp4Atom *userDataAtom = nullptr;
+    for (Mp4Atom *level1Atom = movieAtom->firstChild(); level1Atom; level1Atom = level1Atom->nextSibling()) {
+        if (userDataAtom) {
+            return false;
+        }
+        if (level1Atom->id() == Mp4AtomIds::UserData) {
+            userDataAtom = level1Atom;
+        }
+    }
+
+    // determine the space available after the movie atom
+    const auto userDataOffset = userDataAtom ? userDataAtom->startOffset() : movieAtom->endOffset();
+    const auto newMovieAtomSize = userDataOffset + userDataAtomSize - movieAtom->startOffset();
+    if (movieAtom->headerSize() < 16 && newMovieAtomSize >= numeric_limits<std::uint32_t>::max()) {
+        return false;
+    }
+    auto availableEnd = movieAtom->endOffset();
+    auto atEnd = true;
+    try {
+        for (Mp4Atom *level0Atom = movieAtom->nextSibling(); level0Atom; level0Atom = level0Atom->nextSibling()) {
+            level0Atom->parse(diag);
+            if (level0Atom->id() != Mp4AtomIds::Free && level0Atom->id() != Mp4AtomIds::Skip) {
+                atEnd = false;
+                break;
+            }
+            availableEnd = level0Atom->endOffset();
+        }
+    } catch (const Failure &) {
+        return false;
+    }
+    atEnd = atEnd && availableEnd == fileInfo().size();
+
+    // check whether the remaining space can be used as padding
+    const auto newMovieAtomEnd = movieAtom->startOffset() + newMovieAtomSize;
+    if (!atEnd && newMovieAtomEnd > availableEnd) {
+        return false;
+    }
+    auto newPadding = availableEnd > newMovieAtomEnd ? availableEnd - newMovieAtomEnd : 0;
+    if ((newPadding && newPadding < 8)
+        || (!fileInfo().isForcingInPlace() && (newPadding < fileInfo().minPadding() || newPadding > fileInfo().maxPadding()))) {
+        if (!atEnd) {
+            return false;
+        }
+        newPadding = (fileInfo().preferredPadding() && fileInfo().preferredPadding() < 8 ? 8 : fileInfo().preferredPadding());
+    }
+    const auto newSize = atEnd ? newMovieAtomEnd + newPadding : fileInfo().size();
+    m_applyChangesResult.setLayout(false, availableEnd - movieAtom->endOffset(), newPadding);
+    m_applyChangesResult.fileSizeAfter = newSize;
+    if (m_planningFile) {
+        return true;
+    }
+
+    // reopen original file to ensure it is opened for writing
+    progress.nextStepOrStop("Patching user data ...");
+    string journalPath;
+    NativeFileStream &outputStream = fileInfo().stream();
+    NativeFileStream backupStream;
+    BinaryWriter outputWriter(&outputStream);
+    try {
+        fileInfo().close();
+        outputStream.open(BasicFileInfo::pathForOpen(fileInfo().path()), ios_base::in | ios_base::out | ios_base::binary);
+    } catch (const std::ios_base::failure &failure) {
+        diag.emplace_back(DiagLevel::Critical, argsToString("Opening the file with write permissions failed: ", failure.what()), context);
+        throw;
+    }
+
+    // save the bytes to be overwritten to the journal
+    if (fileInfo().backupStrategy() == BackupStrategy::Journal) {
+        auto unchangedRanges = vector<pair<std::uint64_t, std::uint64_t>>();
+        unchangedRanges.emplace_back(0, movieAtom->startOffset());
+        unchangedRanges.emplace_back(movieAtom->startOffset() + movieAtom->headerSize(), userDataOffset);
+        if (!atEnd) {
+            unchangedRanges.emplace_back(availableEnd, fileInfo().size());
+        }
+        try {
+            BackupHelper::createJournal(fileInfo().backupDirectory(), fileInfo().path(), journalPath, outputStream, fileInfo().size(), unchangedRanges);
+        } catch (const std::ios_base::failure &failure) {
+            diag.emplace_back(DiagLevel::Critical, failure.what(), context);
+            throw;
+        }
+    }
+
+    try {
+        // write the user data atom and the padding
+        outputStream.seekp(static_cast<streamoff>(userDataOffset));
+        makeUserData(movieAtom, userDataAtomSize, tagMaker, outputWriter, diag);
+        if (newPadding) {
+            Mp4Atom::makeHeader(newPadding, Mp4AtomIds::Free, outputWriter);
+        }
+
+        // patch the size of the movie atom
+        if (movieAtom->headerSize() < 16) {
+            outputStream.seekp(static_cast<streamoff>(movieAtom->startOffset()));
+            outputWriter.writeUInt32BE(static_cast<std::uint32_t>(newMovieAtomSize));
+        } else {
+            outputStream.seekp(static_cast<streamoff>(movieAtom->startOffset() + 8));
+            outputWriter.writeUInt64BE(newMovieAtomSize);
+        }
+
+        // adjust the size of the file if the movie atom is at the end (which also fills the padding with zeroes)
+        if (newSize != fileInfo().size()) {
+            outputStream.close();
+            if (truncate(BasicFileInfo::pathForOpen(fileInfo().path()), static_cast<iostream::off_type>(newSize)) == 0) {
+                fileInfo().reportSizeChanged(newSize);
+            } else {
+                diag.emplace_back(DiagLevel::Critical, "Unable to adjust the size of the file.", context);
+                throw Failure();
+            }
+            outputStream.open(BasicFileInfo::pathForOpen(fileInfo().path()), ios_base::in | ios_base::out | ios_base::binary);
+        }
+
+        // reparse what is written so far
+        progress.updateStep("Reparsing output file ...");
+        reset();
+        try {
+            parseTracks(diag);
+        } catch (const Failure &) {
+            diag.emplace_back(DiagLevel::Critical, "Unable to reparse the new file.", context);
+            throw;
+        }
+
+        // prevent deferring final write operations (to catch and handle possible errors here)
+        outputStream.flush();
+
+    } catch (...) {
+        BackupHelper::handleFailureAfterFileModified(fileInfo(), string(), journalPath, outputStream, backupStream, diag, context);
+    }
+    return true;
+}
+
+/*!
+ * \brief Overwrites only the changed children of the "ilst"-atom if possible.
+ * \returns Returns whether the tag could be patched. If not, nothing has been written and the file needs to be made as
+ *          usual.
+ *
+ * The fields made by the only tag maker are compared with the children of the "ilst"-atom of the only "meta"-atom. Both
+ * are compared by their position so the resulting "ilst"-atom equals the one which would be made otherwise. Fields which
+ * differ are overwritten at their offset if they keep their size. The last field might also grow or shrink if the atom
+ * following the "ilst"-atom (or an enclosing atom the "ilst"-atom ends with) is a "free"/"skip"-atom which absorbs the
+ * size difference; the sizes of the enclosing atoms are patched accordingly then.
+ *
+ * \sa setTagFieldPatchingEnabled()
+ */
+bool Mp4Container::patchTagFields(Mp4Atom *movieAtom, std::vector<Mp4TagMaker> &tagMaker, Diagnostics &diag, AbortableProgressFeedback &progress)
+{
+    static const string context("patching MP4 tag fields");
+
+    // find the "ilst"-atom of the only tag and its children
+    if (tagMaker.size() != 1 || m_tags.size() != 1) {
+        return false;
+    }
+    Mp4Atom *userDataAtom, *metaAtom, *listAtom, *paddingAtom = nullptr;
+    auto oldFields = vector<Mp4Atom *>();
+    auto resizableAtoms = vector<Mp4Atom *>();
+    try {
+        if (movieAtom->siblingById(Mp4AtomIds::Movie, diag) || !(userDataAtom = movieAtom->childById(Mp4AtomIds::UserData, diag))
+            || !(metaAtom = userDataAtom->childById(Mp4AtomIds::Meta, diag)) || metaAtom->siblingById(Mp4AtomIds::Meta, diag)
+            || !(listAtom = metaAtom->childById(Mp4AtomIds::ItunesList, diag))) {
+            return false;
+        }
+        for (Mp4Atom *child = listAtom->firstChild(); child; child = child->nextSibling()) {
+            child->parse(diag);
+            oldFields.emplace_back(child);
+        }
+        if (oldFields.empty() || oldFields.back()->endOffset() != listAtom->endOffset()) {
+            return false;
+        }
+        // -> determine the padding which might absorb a size change of the last field and the atoms to be resized then
+        for (Mp4Atom *atom = listAtom; atom != movieAtom; atom = atom->parent()) {
+            resizableAtoms.emplace_back(atom);
+            if (Mp4Atom *const nextAtom = atom->nextSibling()) {
+                nextAtom->parse(diag);
+                if (nextAtom->id() == Mp4AtomIds::Free || nextAtom->id() == Mp4AtomIds::Skip) {
+                    paddingAtom = nextAtom;
+                }
+                break;
+            }
+            if (atom->endOffset() != atom->parent()->endOffset()) {
+                break;
+            }
+        }
+    } catch (const Failure &) {
+        return false;
+    }
+
+    // make the tag in memory and split the "ilst"-atom into its children
+    auto &maker = tagMaker.front();
+    const auto newMetaSize = static_cast<std::size_t>(maker.requiredSize());
+    // -> the maker writes the "meta"-head and the "hdlr"-atom in front of the "ilst"-atom
+    constexpr auto listOffset = std::size_t(8 + 37);
+    if (newMetaSize <= listOffset + 8) {
+        return false;
+    }
+    const auto newMeta = make_unique<char[]>(newMetaSize);
+    maker.make(newMeta.get(), diag);
+    if (BE::toUInt32(newMeta.get() + listOffset + 4) != Mp4AtomIds::ItunesList) {
+        return false;
+    }
+    auto newFields = vector<pair<const char *, std::size_t>>();
+    for (const char *field = newMeta.get() + listOffset + 8, *const end = newMeta.get() + newMetaSize; field < end;) {
+        const auto fieldSize = static_cast<std::size_t>(BE::toUInt32(field));
+        if (fieldSize < 8 || fieldSize > static_cast<std::size_t>(end - field)) {
+            return false;
+        }
+        newFields.emplace_back(field, fieldSize);
+        field += fieldSize;
+    }
+    if (newFields.size() != oldFields.size()) {
+        return false;
+    }
+
+    // compare the fields with the children of the original "ilst"-atom to determine what needs to be written
+    auto patches = vector<pair<std::uint64_t, string>>();
+    auto oldPadding = std::uint64_t(), newPadding = std::uint64_t();
+    auto oldData = string(static_cast<std::size_t>(listAtom->dataSize()), '\0');
+    auto &inputStream = stream();
+    inputStream.seekg(static_cast<streamoff>(listAtom->dataOffset()));
+    inputStream.read(oldData.data(), static_cast<streamsize>(oldData.size()));
+    for (std::size_t index = 0, count = newFields.size(); index != count; ++index) {
+        const auto *const oldField = oldFields[index];
+        const auto [newField, newSize] = newFields[index];
+        const auto *const oldFieldData = oldData.data() + (oldField->startOffset() - listAtom->dataOffset());
+        if (newSize == oldField->totalSize()) {
+            if (!equal(newField, newField + newSize, oldFieldData)) {
+                patches.emplace_back(oldField->startOffset(), string(newField, newSize));
+            }
+            continue;
+        }
+        // -> only the last field might change its size if the padding absorbs the difference
+        if (index + 1 != count || !paddingAtom) {
+            return false;
+        }
+        const auto sizeDifference = static_cast<std::int64_t>(newSize) - static_cast<std::int64_t>(oldField->totalSize());
+        oldPadding = paddingAtom->totalSize();
+        if (sizeDifference > static_cast<std::int64_t>(oldPadding)) {
+            return false;
+        }
+        newPadding = static_cast<std::uint64_t>(static_cast<std::int64_t>(oldPadding) - sizeDifference);
+        if (newPadding && (newPadding < 8 || newPadding > numeric_limits<std::uint32_t>::max())) {
+            return false;
+        }
+        patches.emplace_back(oldField->startOffset(), string(newField, newSize));
+        if (newPadding) {
+            auto paddingHeader = string(8, '\0');
+            BE::getBytes(static_cast<std::uint32_t>(newPadding), paddingHeader.data());
+            BE::getBytes(static_cast<std::uint32_t>(Mp4AtomIds::Free), paddingHeader.data() + 4);
+            patches.emplace_back(oldField->startOffset() + newSize, move(paddingHeader));
+        }
+        for (const auto *const atom : resizableAtoms) {
+            const auto newAtomSize = static_cast<std::uint64_t>(static_cast<std::int64_t>(atom->totalSize()) + sizeDifference);
+            auto sizeField = string(atom->headerSize() < 16 ? 4 : 8, '\0');
+            if (atom->headerSize() < 16) {
+                if (newAtomSize > numeric_limits<std::uint32_t>::max()) {
+                    return false;
+                }
+                BE::getBytes(static_cast<std::uint32_t>(newAtomSize), sizeField.data());
+                patches.emplace_back(atom->startOffset(), move(sizeField));
+            } else {
+                BE::getBytes(newAtomSize, sizeField.data());
+                patches.emplace_back(atom->startOffset() + 8, move(sizeField));
+            }
+        }
+    }
+    sort(patches.begin(), patches.end(), [](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+    m_applyChangesResult.setLayout(false, oldPadding, newPadding);
+    m_applyChangesResult.fileSizeAfter = fileInfo().size();
+    if (m_planningFile || patches.empty()) {
+        return true;
+    }
+
+    // reopen original file to ensure it is opened for writing
+    progress.nextStepOrStop("Patching tag fields ...");
+    string backupPath, journalPath;
+    NativeFileStream &outputStream = fileInfo().stream();
+    NativeFileStream backupStream;
+    try {
+        fileInfo().close();
+        outputStream.open(BasicFileInfo::pathForOpen(fileInfo().path()), ios_base::in | ios_base::out | ios_base::binary);
+    } catch (const std::ios_base::failure &failure) {
+        diag.emplace_back(DiagLevel::Critical, argsToString("Opening the file with write permissions failed: ", failure.what()), context);
+        throw;
+    }
+
+    // save the bytes to be overwritten to the journal or clone the file if supported by the file system
+    if (fileInfo().backupStrategy() == BackupStrategy::Journal) {
+        auto unchangedRanges = vector<pair<std::uint64_t, std::uint64_t>>();
+        auto unchangedStart = std::uint64_t();
+        for (const auto &[offset, data] : patches) {
+            unchangedRanges.emplace_back(unchangedStart, offset);
+            unchangedStart = offset + data.size();
+        }
+        unchangedRanges.emplace_back(unchangedStart, fileInfo().size());
+        try {
+            BackupHelper::createJournal(fileInfo().backupDirectory(), fileInfo().path(), journalPath, outputStream, fileInfo().size(), unchangedRanges);
+        } catch (const std::ios_base::failure &failure) {
+            diag.emplace_back(DiagLevel::Critical, failure.what(), context);
+            throw;
+        }
+    } else if (fileInfo().backupStrategy() == BackupStrategy::Clone) {
+        BackupHelper::createCloneBackupFile(fileInfo().backupDirectory(), fileInfo().path(), backupPath, fileInfo().durabilityPolicy());
+    }
+
+    try {
+        // write the changed fields and the adjusted sizes
+        for (const auto &[offset, data] : patches) {
+            outputStream.seekp(static_cast<streamoff>(offset));
+            outputStream.write(data.data(), static_cast<streamsize>(data.size()));
+        }
+
+        // reparse what is written so far
+        progress.updateStep("Reparsing output file ...");
+        reset();
+        try {
+            parseTracks(diag);
+        } catch (const Failure &) {
+            diag.emplace_back(DiagLevel::Critical, "Unable to reparse the new file.", context);
+            throw;
+        }
+
+        // prevent deferring final write operations (to catch and handle possible errors here)
+        outputStream.flush();
+
+    } catch (...) {
+        BackupHelper::handleFailureAfterFileModified(fileInfo(), backupPath, journalPath, outputStream, backupStream, diag, context);
+    }
+    return true;
+}
+
+/*!
+ * \brief Promotes the "stco"-atoms of tracks whose 32-bit chunk offsets would overflow in the new file to "co64"-atoms.
+ * \param headerSize Specifies the size of the atoms written before the movie atom or the padding.
+ * \param firstMediaDataAtom Specifies the first media data atom of the original file.
+ * \param newTagPos Specifies whether the movie atom is written before or after the media data.
+ * \param newPadding Specifies the size of the padding written before the media data.
+ * \param writeChunkByChunk Specifies whether chunk offsets are recomputed because the media data is written chunk-by-chunk.
+ * \param movieAtomSize Specifies the size of the new movie atom. It is increased by the size the promoted tables require.
+ *
+ * The new location of the media data depends on the size of the movie atom (if written before the media data) which
+ * grows by promoting tables. Hence tracks are checked again until no further track needs to be promoted.
+ *
+ * \remarks
+ * - When copying the media data, each media data atom is moved by at most the distance the first one is moved by. So a
+ *   track is promoted if its greatest chunk offset would overflow when being moved by that distance.
+ * - When writing chunk-by-chunk, all tracks are promoted if the new media data might end beyond 4 GiB.
+ */
+void Mp4Container::promoteChunkOffsetTables(std::uint64_t headerSize, Mp4Atom *firstMediaDataAtom, ElementPosition newTagPos,
+    std::uint64_t newPadding, bool writeChunkByChunk, std::uint64_t &movieAtomSize, Diagnostics &diag)
+{
+    static const string context("making MP4 container");
+    constexpr auto maxChunkOffset = static_cast<std::uint64_t>(numeric_limits<std::uint32_t>::max());
+
+    // determine the size of the media data which is copied
+    std::uint64_t mediaDataSize = 0;
+    for (Mp4Atom *level0Atom = firstMediaDataAtom; level0Atom; level0Atom = level0Atom->nextSibling()) {
+        level0Atom->parse(diag);
+        switch (level0Atom->id()) {
+        case Mp4AtomIds::FileType:
+        case Mp4AtomIds::ProgressiveDownloadInformation:
+        case Mp4AtomIds::Movie:
+        case Mp4AtomIds::Free:
+        case Mp4AtomIds::Skip:
+            break;
+        default:
+            mediaDataSize += level0Atom->totalSize();
+        }
+    }
+
+    // promote tracks until the chunk offsets of all tracks fit
+    vector<std::uint64_t> greatestChunkOffsets(tracks().size(), 0);
+    bool chunkOffsetsRead = false;
+    for (bool anyTrackPromoted = true; anyTrackPromoted;) {
+        anyTrackPromoted = false;
+        const auto newMediaDataOffset = headerSize + (newTagPos == ElementPosition::AfterData ? 0 : movieAtomSize) + newPadding;
+        // -> add the max. header size of the media data atom made when writing chunk-by-chunk
+        if (newMediaDataOffset + mediaDataSize + (writeChunkByChunk ? 16 : 0) <= maxChunkOffset) {
+            return; // no offset of the new file can overflow
+        }
+        if (!writeChunkByChunk && !chunkOffsetsRead) {
+            for (size_t trackIndex = 0; trackIndex != tracks().size(); ++trackIndex) {
+                const auto &track = tracks()[trackIndex];
+                if (track->chunkOffsetSize() == 4) {
+                    const auto chunkOffsets = track->readChunkOffsets(false, diag);
+                    if (!chunkOffsets.empty()) {
+                        greatestChunkOffsets[trackIndex] = *max_element(chunkOffsets.cbegin(), chunkOffsets.cend());
+                    }
+                }
+            }
+            chunkOffsetsRead = true;
+        }
+        const auto shift = newMediaDataOffset > firstMediaDataAtom->startOffset() ? newMediaDataOffset - firstMediaDataAtom->startOffset() : 0;
+        for (size_t trackIndex = 0; trackIndex != tracks().size(); ++trackIndex) {
+            const auto &track = tracks()[trackIndex];
+            if (track->chunkOffsetSize() != 4 || track->isChunkOffsetTablePromoted()
+                || (!writeChunkByChunk && greatestChunkOffsets[trackIndex] + shift <= maxChunkOffset)) {
+                continue;
+            }
+            const auto requiredSize = track->requiredSize(diag);
+            track->setChunkOffsetTablePromoted(true);
+            movieAtomSize += track->requiredSize(diag) - requiredSize;
+            anyTrackPromoted = true;
+            diag.emplace_back(DiagLevel::Information,
+                argsToString("The chunk offsets of track ", track->id(), " are stored as 64-bit values (\"co64\"-atom) because they exceed 4 GiB."),
+                context);
+        }
     }
 }
 
@@ -990,4 +2792,280 @@ void Mp4Container::updateOffsets(const std::vector<std::int64_t> &oldMdatOffsets
     }
 }
 
+/*!
+ * \brief Reads the default sample sizes of the tracks from the "trex"-atoms within the specified \a movieAtom.
+ * \returns Returns the default sample sizes by track ID.
+ */
+std::unordered_map<std::uint32_t, std::uint32_t> Mp4Container::readDefaultSampleSizes(Mp4Atom *movieAtom, Diagnostics &diag)
+{
+    static const string context("reading MP4 track extends atoms");
+    unordered_map<std::uint32_t, std::uint32_t> defaultSampleSizes;
+    for (; movieAtom; movieAtom = movieAtom->siblingById(Mp4AtomIds::Movie, diag)) {
+        for (Mp4Atom *mvexAtom = movieAtom->childById(Mp4AtomIds::MovieExtends, diag); mvexAtom;
+             mvexAtom = mvexAtom->siblingById(Mp4AtomIds::MovieExtends, diag)) {
+            for (Mp4Atom *trexAtom = mvexAtom->childById(Mp4AtomIds::TrackExtends, diag); trexAtom;
+                 trexAtom = trexAtom->siblingById(Mp4AtomIds::TrackExtends, diag)) {
+                if (trexAtom->dataSize() < 24) {
+                    diag.emplace_back(DiagLevel::Warning, "trex atom is truncated.", context);
+                    continue;
+                }
+                stream().seekg(static_cast<iostream::off_type>(trexAtom->dataOffset()) + 4);
+                const auto trackId = reader().readUInt32BE();
+                stream().seekg(8, ios_base::cur); // skip default sample description index and duration
+                defaultSampleSizes[trackId] = reader().readUInt32BE();
+            }
+        }
+    }
+    return defaultSampleSizes;
+}
+
+/*!
+ * \brief Writes a "sidx"-atom (in version 1) referring to the specified segments.
+ * \param referenceTrack Specifies the track the durations have been taken from.
+ * \param earliestPresentationTime Specifies the time of the first segment in the time scale of the \a referenceTrack.
+ * \param firstOffset Specifies the distance from the end of the "sidx"-atom to the first segment.
+ * \param references Specifies the size and the duration of each segment.
+ * \param writer Specifies the writer for the output stream.
+ * \remarks This is used by internalMakeFile() if isSegmentIndexGenerationEnabled() returns true. Whether the segments
+ *          start with a stream access point is not denoted.
+ */
+void Mp4Container::makeSegmentIndex(const Mp4Track &referenceTrack, std::uint64_t earliestPresentationTime, std::uint64_t firstOffset,
+    const std::vector<std::pair<std::uint32_t, std::uint32_t>> &references, CppUtilities::BinaryWriter &writer)
+{
+    Mp4Atom::makeHeader(8 + 4 + 4 + 4 + 8 + 8 + 2 + 2 + 12 * references.size(), Mp4AtomIds::SegmentIndex, writer);
+    writer.writeUInt32BE(0x01000000); // version 1 and flags
+    writer.writeUInt32BE(static_cast<std::uint32_t>(referenceTrack.id()));
+    writer.writeUInt32BE(referenceTrack.timeScale());
+    writer.writeUInt64BE(earliestPresentationTime);
+    writer.writeUInt64BE(firstOffset);
+    writer.writeUInt16BE(0); // reserved
+    writer.writeUInt16BE(static_cast<std::uint16_t>(references.size()));
+    for (const auto &[size, duration] : references) {
+        writer.writeUInt32BE(size); // reference type 0 (media) and referenced size
+        writer.writeUInt32BE(duration);
+        writer.writeUInt32BE(0); // stream access point not denoted
+    }
+}
+
+/*!
+ * \brief Writes the specified \a movieFragmentAtom followed by a new "mdat"-atom containing the samples it refers to.
+ * \param movieFragmentAtom Specifies the "moof"-atom of the original file.
+ * \param defaultSampleSizes Specifies the default sample sizes of the tracks (see readDefaultSampleSizes()).
+ * \param writer Specifies the writer for the output stream.
+ *
+ * Track fragments of tracks which are not present anymore are omitted and so are their samples. The remaining
+ * "tfhd"-atoms are changed to use the start of the movie fragment as base data offset and each "trun"-atom is given
+ * an explicit data offset. Hence the new fragment does not depend on the layout of the original file and no offsets
+ * need to be updated afterwards. Samples are copied run by run so the effort depends on the number of runs and not
+ * on the number of samples.
+ *
+ * \remarks
+ * - This is used by internalMakeFile() when writing chunk-by-chunk. The original "mdat"-atoms are not copied in this case.
+ * - Offsets of sample auxiliary information ("saio"-atom) are not updated.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ * \throws Throws TagParser::Failure or a derived exception when a making error occurs.
+ */
+void Mp4Container::makeMovieFragment(Mp4Atom *movieFragmentAtom, const std::unordered_map<std::uint32_t, std::uint32_t> &defaultSampleSizes,
+    CppUtilities::BinaryWriter &writer, Diagnostics &diag)
+{
+    static const string context("making MP4 movie fragment");
+    auto &inputStream = stream();
+    auto &outputStream = *writer.stream();
+
+    // determine the track fragments to keep and the samples they refer to
+    vector<TrackFragment> trackFragments;
+    std::uint64_t newMovieFragmentSize = 0, mediaDataSize = 0;
+    // -> the implicit base data offset of the first track fragment is the start of the movie fragment and the end of the
+    //    data of the previous track fragment for subsequent ones
+    std::uint64_t previousTrackFragmentDataEnd = movieFragmentAtom->startOffset();
+    bool auxiliaryInformationOffsetsPresent = false;
+    movieFragmentAtom->parse(diag);
+    for (Mp4Atom *level1Atom = movieFragmentAtom->firstChild(); level1Atom; level1Atom = level1Atom->nextSibling()) {
+        level1Atom->parse(diag);
+        if (level1Atom->id() != Mp4AtomIds::TrackFragment) {
+            newMovieFragmentSize += level1Atom->totalSize();
+            continue;
+        }
+
+        // read "tfhd"-atom
+        auto *const tfhdAtom = level1Atom->childById(Mp4AtomIds::TrackFragmentHeader, diag);
+        if (!tfhdAtom || tfhdAtom->dataSize() < 8) {
+            diag.emplace_back(DiagLevel::Critical, "traf atom doesn't contain a valid tfhd atom.", context);
+            throw InvalidDataException();
+        }
+        TrackFragment trackFragment{ level1Atom, tfhdAtom, readAtomData(*tfhdAtom, inputStream), tfhdAtom->dataSize(), {}, 0 };
+        const char *const tfhd = trackFragment.headerBuffer.get();
+        const auto tfhdFlags = BE::toUInt24(tfhd + 1);
+        const auto trackId = BE::toUInt32(tfhd + 4);
+        const auto requiredHeaderSize = 8u + (tfhdFlags & TrackFragmentHeaderFlags::BaseDataOffsetPresent ? 8u : 0u)
+            + (tfhdFlags & TrackFragmentHeaderFlags::SampleDescriptionIndexPresent ? 4u : 0u)
+            + (tfhdFlags & TrackFragmentHeaderFlags::DefaultSampleDurationPresent ? 4u : 0u)
+            + (tfhdFlags & TrackFragmentHeaderFlags::DefaultSampleSizePresent ? 4u : 0u)
+            + (tfhdFlags & TrackFragmentHeaderFlags::DefaultSampleFlagsPresent ? 4u : 0u);
+        if (trackFragment.headerBufferSize < requiredHeaderSize) {
+            diag.emplace_back(DiagLevel::Critical, argsToString("tfhd atom of track ", trackId, " is truncated."), context);
+            throw InvalidDataException();
+        }
+        const char *optionalField = tfhd + 8;
+        auto baseDataOffset = previousTrackFragmentDataEnd;
+        if (tfhdFlags & TrackFragmentHeaderFlags::BaseDataOffsetPresent) {
+            baseDataOffset = BE::toUInt64(optionalField);
+            optionalField += 8;
+        } else if (tfhdFlags & TrackFragmentHeaderFlags::DefaultBaseIsMoof) {
+            baseDataOffset = movieFragmentAtom->startOffset();
+        }
+        optionalField += (tfhdFlags & TrackFragmentHeaderFlags::SampleDescriptionIndexPresent ? 4 : 0)
+            + (tfhdFlags & TrackFragmentHeaderFlags::DefaultSampleDurationPresent ? 4 : 0);
+        const auto defaultSampleSize = defaultSampleSizes.find(trackId);
+        const auto hasDefaultSampleSize
+            = (tfhdFlags & TrackFragmentHeaderFlags::DefaultSampleSizePresent) || defaultSampleSize != defaultSampleSizes.cend();
+        const auto sampleSize = tfhdFlags & TrackFragmentHeaderFlags::DefaultSampleSizePresent ? BE::toUInt32(optionalField)
+            : defaultSampleSize != defaultSampleSizes.cend()                                  ? defaultSampleSize->second
+                                                                                              : 0u;
+
+        // read "trun"-atoms to locate the samples
+        auto dataEnd = baseDataOffset;
+        for (Mp4Atom *level2Atom = level1Atom->firstChild(); level2Atom; level2Atom = level2Atom->nextSibling()) {
+            level2Atom->parse(diag);
+            if (level2Atom == tfhdAtom) {
+                auto newHeaderSize = trackFragment.headerBufferSize - (tfhdFlags & TrackFragmentHeaderFlags::BaseDataOffsetPresent ? 8 : 0);
+                Mp4Atom::addHeaderSize(newHeaderSize);
+                trackFragment.newSize += newHeaderSize;
+                continue;
+            }
+            switch (level2Atom->id()) {
+            case Mp4AtomIds::TrackFragmentRun: {
+                TrackFragmentRun run{ readAtomData(*level2Atom, inputStream), level2Atom->dataSize(), dataEnd, 0 };
+                if (run.bufferSize < 8) {
+                    diag.emplace_back(DiagLevel::Critical, argsToString("trun atom of track ", trackId, " is truncated."), context);
+                    throw InvalidDataException();
+                }
+                const char *const trun = run.buffer.get();
+                const auto trunFlags = BE::toUInt24(trun + 1);
+                const auto sampleCount = BE::toUInt32(trun + 4);
+                const char *entry = trun + 8;
+                if (trunFlags & TrackFragmentRunFlags::DataOffsetPresent) {
+                    run.dataOffset = static_cast<std::uint64_t>(static_cast<std::int64_t>(baseDataOffset) + BE::toInt32(entry));
+                    entry += 4;
+                }
+                if (trunFlags & TrackFragmentRunFlags::FirstSampleFlagsPresent) {
+                    entry += 4;
+                }
+                const auto entrySize = (trunFlags & TrackFragmentRunFlags::SampleDurationPresent ? 4u : 0u)
+                    + (trunFlags & TrackFragmentRunFlags::SampleSizePresent ? 4u : 0u)
+                    + (trunFlags & TrackFragmentRunFlags::SampleFlagsPresent ? 4u : 0u)
+                    + (trunFlags & TrackFragmentRunFlags::SampleCompositionTimeOffsetPresent ? 4u : 0u);
+                if (static_cast<std::uint64_t>(entry - trun) + static_cast<std::uint64_t>(sampleCount) * entrySize > run.bufferSize) {
+                    diag.emplace_back(DiagLevel::Critical, argsToString("trun atom of track ", trackId, " is truncated."), context);
+                    throw InvalidDataException();
+                }
+                if (trunFlags & TrackFragmentRunFlags::SampleSizePresent) {
+                    entry += trunFlags & TrackFragmentRunFlags::SampleDurationPresent ? 4 : 0;
+                    for (std::uint32_t sampleIndex = 0; sampleIndex != sampleCount; ++sampleIndex, entry += entrySize) {
+                        run.dataSize += BE::toUInt32(entry);
+                    }
+                } else if (hasDefaultSampleSize) {
+                    run.dataSize = static_cast<std::uint64_t>(sampleCount) * sampleSize;
+                } else {
+                    diag.emplace_back(DiagLevel::Critical, argsToString("The sample sizes of a track run of track ", trackId, " are unknown."), context);
+                    throw InvalidDataException();
+                }
+                dataEnd = run.dataOffset + run.dataSize;
+                auto newRunSize = run.bufferSize + (trunFlags & TrackFragmentRunFlags::DataOffsetPresent ? 0 : 4);
+                Mp4Atom::addHeaderSize(newRunSize);
+                trackFragment.newSize += newRunSize;
+                trackFragment.runs.emplace_back(move(run));
+                break;
+            }
+            case Mp4AtomIds::SampleAuxiliaryInformationOffsets:
+                auxiliaryInformationOffsetsPresent = true;
+                [[fallthrough]];
+            default:
+                trackFragment.newSize += level2Atom->totalSize();
+            }
+        }
+        previousTrackFragmentDataEnd = dataEnd;
+
+        // omit track fragments of tracks which are not present anymore
+        if (none_of(tracks().cbegin(), tracks().cend(), [trackId](const auto &track) { return track->id() == trackId; })) {
+            continue;
+        }
+        Mp4Atom::addHeaderSize(trackFragment.newSize);
+        newMovieFragmentSize += trackFragment.newSize;
+        for (const auto &run : trackFragment.runs) {
+            mediaDataSize += run.dataSize;
+        }
+        trackFragments.emplace_back(move(trackFragment));
+    }
+    Mp4Atom::addHeaderSize(newMovieFragmentSize);
+    if (auxiliaryInformationOffsetsPresent) {
+        diag.emplace_back(DiagLevel::Warning, "The offsets of sample auxiliary information (\"saio\"-atom) are not updated and might be invalid.", context);
+    }
+
+    // write movie fragment atom
+    // -> the samples are placed in the media data atom directly following the movie fragment atom
+    auto mediaDataAtomSize = mediaDataSize;
+    Mp4Atom::addHeaderSize(mediaDataAtomSize);
+    auto dataOffset = newMovieFragmentSize + (mediaDataAtomSize - mediaDataSize);
+    if (newMovieFragmentSize + mediaDataAtomSize > static_cast<std::uint64_t>(numeric_limits<std::int32_t>::max())) {
+        diag.emplace_back(DiagLevel::Critical, "The data of the movie fragment can not be addressed relative to the movie fragment.", context);
+        throw InvalidDataException();
+    }
+    Mp4Atom::makeHeader(newMovieFragmentSize, Mp4AtomIds::MovieFragment, writer);
+    auto trackFragment = trackFragments.begin();
+    for (Mp4Atom *level1Atom = movieFragmentAtom->firstChild(); level1Atom; level1Atom = level1Atom->nextSibling()) {
+        if (level1Atom->id() != Mp4AtomIds::TrackFragment) {
+            level1Atom->copyEntirely(outputStream, diag, nullptr);
+            continue;
+        }
+        if (trackFragment == trackFragments.end() || trackFragment->atom != level1Atom) {
+            continue; // track fragment has been omitted
+        }
+        Mp4Atom::makeHeader(trackFragment->newSize, Mp4AtomIds::TrackFragment, writer);
+        auto run = trackFragment->runs.begin();
+        for (Mp4Atom *level2Atom = level1Atom->firstChild(); level2Atom; level2Atom = level2Atom->nextSibling()) {
+            if (level2Atom == trackFragment->headerAtom) {
+                // -> write "tfhd"-atom using the start of the movie fragment as base data offset
+                const char *const tfhd = trackFragment->headerBuffer.get();
+                const auto tfhdFlags = BE::toUInt24(tfhd + 1);
+                const auto optionalFieldsOffset = tfhdFlags & TrackFragmentHeaderFlags::BaseDataOffsetPresent ? 16u : 8u;
+                auto newHeaderSize = trackFragment->headerBufferSize - optionalFieldsOffset + 8;
+                Mp4Atom::addHeaderSize(newHeaderSize);
+                Mp4Atom::makeHeader(newHeaderSize, Mp4AtomIds::TrackFragmentHeader, writer);
+                writer.writeByte(static_cast<std::uint8_t>(tfhd[0]));
+                writer.writeUInt24BE((tfhdFlags & ~TrackFragmentHeaderFlags::BaseDataOffsetPresent) | TrackFragmentHeaderFlags::DefaultBaseIsMoof);
+                writer.write(tfhd + 4, 4);
+                writer.write(tfhd + optionalFieldsOffset, static_cast<std::streamsize>(trackFragment->headerBufferSize - optionalFieldsOffset));
+            } else if (level2Atom->id() == Mp4AtomIds::TrackFragmentRun && run != trackFragment->runs.end()) {
+                // -> write "trun"-atom with an explicit data offset
+                const char *const trun = run->buffer.get();
+                const auto trunFlags = BE::toUInt24(trun + 1);
+                const auto entriesOffset = trunFlags & TrackFragmentRunFlags::DataOffsetPresent ? 12u : 8u;
+                auto newRunSize = run->bufferSize - entriesOffset + 12;
+                Mp4Atom::addHeaderSize(newRunSize);
+                Mp4Atom::makeHeader(newRunSize, Mp4AtomIds::TrackFragmentRun, writer);
+                writer.writeByte(static_cast<std::uint8_t>(trun[0]));
+                writer.writeUInt24BE(trunFlags | TrackFragmentRunFlags::DataOffsetPresent);
+                writer.write(trun + 4, 4);
+                writer.writeInt32BE(static_cast<std::int32_t>(dataOffset));
+                writer.write(trun + entriesOffset, static_cast<std::streamsize>(run->bufferSize - entriesOffset));
+                dataOffset += run->dataSize;
+                ++run;
+            } else {
+                level2Atom->copyEntirely(outputStream, diag, nullptr);
+            }
+        }
+        ++trackFragment;
+    }
+
+    // write media data atom
+    Mp4Atom::makeHeader(mediaDataAtomSize, Mp4AtomIds::MediaData, writer);
+    for (const auto &keptTrackFragment : trackFragments) {
+        for (const auto &run : keptTrackFragment.runs) {
+            inputStream.seekg(static_cast<std::streamoff>(run.dataOffset));
+            rangeCopier().copy(inputStream, outputStream, run.dataSize);
+        }
+    }
+}
+
 } // namespace TagParser
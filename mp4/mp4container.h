@@ -2,6 +2,7 @@
 #define TAG_PARSER_MP4CONTAINER_H
 
 #include "./mp4atom.h"
+#include "./mp4chapter.h"
 #include "./mp4tag.h"
 #include "./mp4track.h"
 
@@ -9,6 +10,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace TagParser {
@@ -22,20 +24,71 @@ public:
 
     bool supportsTrackModifications() const override;
     bool isFragmented() const;
+    std::size_t chunkCopyThreadCount() const;
+    void setChunkCopyThreadCount(std::size_t threadCount);
+    CppUtilities::TimeSpan interleaveDuration() const;
+    void setInterleaveDuration(CppUtilities::TimeSpan interleaveDuration);
+    bool isUserDataPatchingEnabled() const;
+    void setUserDataPatchingEnabled(bool enabled);
+    bool isTagFieldPatchingEnabled() const;
+    void setTagFieldPatchingEnabled(bool enabled);
+    bool isMovieAtomCompactionEnabled() const;
+    void setMovieAtomCompactionEnabled(bool enabled);
+    const std::vector<std::uint32_t> &strippedAtomIds() const;
+    void setStrippedAtomIds(const std::vector<std::uint32_t> &atomIds);
+    bool isSegmentIndexGenerationEnabled() const;
+    void setSegmentIndexGenerationEnabled(bool enabled);
     void reset() override;
     ElementPosition determineTagPosition(Diagnostics &diag) const override;
     ElementPosition determineIndexPosition(Diagnostics &diag) const override;
+    void hashMediaPayload(MediaPayloadHasher &hasher, Diagnostics &diag, AbortableProgressFeedback &progress) override;
+    void validateSampleTables(Diagnostics &diag, std::size_t spotCheckCount = 0);
+    bool parseFragmentIndex(Diagnostics &diag);
+    const std::vector<Mp4FragmentIndexEntry> *fragmentIndex(std::uint32_t trackId) const;
+    Mp4Chapter *chapter(std::size_t index) override;
+    std::size_t chapterCount() const override;
+
+    /// \brief The max. size of the "moov"-atom to read it at once when ParsingFlags::BufferMp4MovieAtom is set.
+    static constexpr std::uint64_t maxBufferedMovieAtomSize = 0x4000000;
 
 protected:
     void internalParseHeader(Diagnostics &diag) override;
     void internalParseTags(Diagnostics &diag) override;
     void internalParseTracks(Diagnostics &diag) override;
+    void internalParseChapters(Diagnostics &diag) override;
+    bool internalResumeParsing(Diagnostics &diag) override;
     void internalMakeFile(Diagnostics &diag, AbortableProgressFeedback &progress) override;
 
 private:
+    bool parseTracksConcurrently(Mp4Atom &movieAtom, Diagnostics &diag);
+    void parseChapterTrack(Mp4Track &chapterTrack, Diagnostics &diag);
+    void parseChapterList(Mp4Atom &chapterListAtom, Diagnostics &diag);
+    void promoteChunkOffsetTables(std::uint64_t headerSize, Mp4Atom *firstMediaDataAtom, ElementPosition newTagPos, std::uint64_t newPadding,
+        bool writeChunkByChunk, std::uint64_t &movieAtomSize, Diagnostics &diag);
     void updateOffsets(const std::vector<std::int64_t> &oldMdatOffsets, const std::vector<std::int64_t> &newMdatOffsets, Diagnostics &diag);
+    std::unordered_map<std::uint32_t, std::uint32_t> readDefaultSampleSizes(Mp4Atom *movieAtom, Diagnostics &diag);
+    bool isStripped(const Mp4Atom *atom) const;
+    void makeUserData(
+        Mp4Atom *movieAtom, std::uint64_t userDataAtomSize, std::vector<Mp4TagMaker> &tagMaker, CppUtilities::BinaryWriter &writer, Diagnostics &diag);
+    bool patchUserData(Mp4Atom *movieAtom, std::vector<Mp4TagMaker> &tagMaker, std::uint64_t userDataAtomSize, Diagnostics &diag,
+        AbortableProgressFeedback &progress);
+    bool patchTagFields(Mp4Atom *movieAtom, std::vector<Mp4TagMaker> &tagMaker, Diagnostics &diag, AbortableProgressFeedback &progress);
+    void makeSegmentIndex(const Mp4Track &referenceTrack, std::uint64_t earliestPresentationTime, std::uint64_t firstOffset,
+        const std::vector<std::pair<std::uint32_t, std::uint32_t>> &references, CppUtilities::BinaryWriter &writer);
+    void makeMovieFragment(Mp4Atom *movieFragmentAtom, const std::unordered_map<std::uint32_t, std::uint32_t> &defaultSampleSizes,
+        CppUtilities::BinaryWriter &writer, Diagnostics &diag);
 
     bool m_fragmented;
+    std::size_t m_chunkCopyThreadCount;
+    CppUtilities::TimeSpan m_interleaveDuration;
+    bool m_userDataPatchingEnabled;
+    bool m_tagFieldPatchingEnabled;
+    bool m_movieAtomCompactionEnabled;
+    std::vector<std::uint32_t> m_strippedAtomIds;
+    bool m_segmentIndexGenerationEnabled;
+    std::unordered_map<std::uint32_t, std::vector<Mp4FragmentIndexEntry>> m_fragmentIndex;
+    bool m_fragmentIndexParsed;
+    std::vector<std::unique_ptr<Mp4Chapter>> m_chapters;
 };
 
 inline bool Mp4Container::supportsTrackModifications() const
@@ -52,6 +105,216 @@ inline bool Mp4Container::isFragmented() const
     return m_fragmented;
 }
 
+/*!
+ * \brief Returns the entries of the "tfra"-atom for the track with the specified \a trackId.
+ * \returns Returns nullptr if there are no entries for the track or parseFragmentIndex() has not been called yet.
+ */
+inline const std::vector<Mp4FragmentIndexEntry> *Mp4Container::fragmentIndex(std::uint32_t trackId) const
+{
+    const auto entries = m_fragmentIndex.find(trackId);
+    return entries != m_fragmentIndex.cend() ? &entries->second : nullptr;
+}
+
+/*!
+ * \brief Returns the chapter with the specified \a index.
+ * \remarks The chapters must have been parsed via parseChapters() and \a index must be less than chapterCount().
+ */
+inline Mp4Chapter *Mp4Container::chapter(std::size_t index)
+{
+    return m_chapters[index].get();
+}
+
+/*!
+ * \brief Returns the number of chapters.
+ */
+inline std::size_t Mp4Container::chapterCount() const
+{
+    return m_chapters.size();
+}
+
+/*!
+ * \brief Returns the number of threads used to read chunks when writing chunk-by-chunk (when tracks have been altered).
+ *
+ * If greater than one, chunks are read ahead by that number of threads using positional reads while the chunks are
+ * written in order by the current thread. This speeds up copying the many small chunks of huge files which are
+ * scattered over the original file.
+ *
+ * A value of zero means the number of hardware threads is used. The default is one (no additional threads).
+ *
+ * \remarks Threads are only used under UNIX-like platforms and if all tracks are read from the file being modified.
+ * \sa setChunkCopyThreadCount()
+ */
+inline std::size_t Mp4Container::chunkCopyThreadCount() const
+{
+    return m_chunkCopyThreadCount;
+}
+
+/*!
+ * \brief Sets the number of threads used to read chunks when writing chunk-by-chunk.
+ * \sa chunkCopyThreadCount()
+ */
+inline void Mp4Container::setChunkCopyThreadCount(std::size_t threadCount)
+{
+    m_chunkCopyThreadCount = threadCount;
+}
+
+/*!
+ * \brief Returns the duration chunks are interleaved by when writing chunk-by-chunk (when tracks have been altered).
+ *
+ * If positive, the chunks of all tracks are grouped into periods of that duration via the decoding time of their
+ * first sample (determined from the "stts"-atom). Within each period the chunks of each track are written
+ * consecutively and the tracks are written in their order. So a player only needs to buffer about one period to play
+ * all tracks from a file which is read sequentially, e.g. when streaming it.
+ *
+ * By default, the duration is null which means one chunk of each track after another is written (like chunks are
+ * usually stored). This is also done if the chunk decoding times can not be determined.
+ *
+ * \sa setInterleaveDuration()
+ */
+inline CppUtilities::TimeSpan Mp4Container::interleaveDuration() const
+{
+    return m_interleaveDuration;
+}
+
+/*!
+ * \brief Sets the duration chunks are interleaved by when writing chunk-by-chunk, e.g. 500 milliseconds.
+ * \sa interleaveDuration()
+ */
+inline void Mp4Container::setInterleaveDuration(CppUtilities::TimeSpan interleaveDuration)
+{
+    m_interleaveDuration = interleaveDuration;
+}
+
+/*!
+ * \brief Returns whether only the user data atom is written when applying changes in-place if possible.
+ *
+ * If enabled, changed tags are written by overwriting only the user data atom (which contains the tags) and patching
+ * the size of the movie atom. This requires the user data atom to be the last child of the movie atom and the space
+ * up to the next atom which is not padding to be sufficient. So growing tags are absorbed by the "free"-atom usually
+ * following the movie atom. The track atoms are not written again in this case so it is only done if nothing but the
+ * tags has been changed (see MediaFileInfo::changes()).
+ *
+ * If not possible, changes are applied as usual. This is disabled by default.
+ *
+ * \sa setUserDataPatchingEnabled()
+ */
+inline bool Mp4Container::isUserDataPatchingEnabled() const
+{
+    return m_userDataPatchingEnabled;
+}
+
+/*!
+ * \brief Sets whether only the user data atom is written when applying changes in-place if possible.
+ * \sa isUserDataPatchingEnabled()
+ */
+inline void Mp4Container::setUserDataPatchingEnabled(bool enabled)
+{
+    m_userDataPatchingEnabled = enabled;
+}
+
+/*!
+ * \brief Returns whether only the changed fields of the tag are written when applying changes in-place if possible.
+ *
+ * If enabled, the children of the "ilst"-atom are compared with the fields which would be written and only the fields
+ * which differ are overwritten at their offset. So changing a single field like the rating or the play count writes
+ * only a few bytes. This requires the changed fields to keep their size. Only the last field may grow or shrink by
+ * resizing the "free"-atom following the "ilst"-atom (or following an enclosing atom the "ilst"-atom is the last child
+ * of). Like user data patching (see isUserDataPatchingEnabled()) the track atoms are not written again in this case so
+ * it is only done if MediaFileInfo::changes() contains nothing but MediaFileChanges::Tags.
+ *
+ * If not possible, changes are applied as usual (considering user data patching). This is disabled by default.
+ *
+ * \sa setTagFieldPatchingEnabled()
+ */
+inline bool Mp4Container::isTagFieldPatchingEnabled() const
+{
+    return m_tagFieldPatchingEnabled;
+}
+
+/*!
+ * \brief Sets whether only the changed fields of the tag are written when applying changes in-place if possible.
+ * \sa isTagFieldPatchingEnabled()
+ */
+inline void Mp4Container::setTagFieldPatchingEnabled(bool enabled)
+{
+    m_tagFieldPatchingEnabled = enabled;
+}
+
+/*!
+ * \brief Returns whether the movie atom is compacted when applying changes.
+ *
+ * If enabled, the sample tables are normalized when making the track atoms: consecutive runs of the "stts"-atom with the
+ * same duration and consecutive entries of the "stsc"-atom with the same number of samples per chunk are merged and the
+ * "stsz"-atom denotes a constant sample size if all samples have the same size. The atoms denoted by strippedAtomIds() are
+ * omitted within the movie atom (except for mandatory ones) as well as "sgpd"- and "sbgp"-atoms which are not referenced
+ * by each other. So the movie atom a player needs to read before playback is as small as possible.
+ *
+ * The media data is not altered. User data patching (see isUserDataPatchingEnabled()) is not used if compaction is
+ * enabled. This is disabled by default.
+ *
+ * \sa setMovieAtomCompactionEnabled()
+ */
+inline bool Mp4Container::isMovieAtomCompactionEnabled() const
+{
+    return m_movieAtomCompactionEnabled;
+}
+
+/*!
+ * \brief Sets whether the movie atom is compacted when applying changes.
+ * \sa isMovieAtomCompactionEnabled()
+ */
+inline void Mp4Container::setMovieAtomCompactionEnabled(bool enabled)
+{
+    m_movieAtomCompactionEnabled = enabled;
+}
+
+/*!
+ * \brief Returns the IDs of the atoms which are omitted within the movie atom when compacting it.
+ *
+ * The default are "free"- and "skip"-atoms. Atoms which are mandatory or made by the library (e.g. "trak", "tkhd", "mdia",
+ * "stbl" and the sample tables) are never omitted.
+ *
+ * \sa isMovieAtomCompactionEnabled()
+ */
+inline const std::vector<std::uint32_t> &Mp4Container::strippedAtomIds() const
+{
+    return m_strippedAtomIds;
+}
+
+/*!
+ * \brief Sets the IDs of the atoms which are omitted within the movie atom when compacting it.
+ * \sa strippedAtomIds()
+ */
+inline void Mp4Container::setStrippedAtomIds(const std::vector<std::uint32_t> &atomIds)
+{
+    m_strippedAtomIds = atomIds;
+}
+
+/*!
+ * \brief Returns whether a "sidx"-atom is made for the movie fragments of fragmented files when applying changes.
+ *
+ * If enabled, a "sidx"-atom referring to each movie fragment (along with its media data) is placed in front of the first
+ * "moof"-atom. The durations are taken from the first video track (or the first track if there is no video track). So
+ * byte ranges of segments can be served without reading the movie fragments. Existing "sidx"-atoms are omitted as they
+ * can not be updated. This is disabled by default.
+ *
+ * \remarks The "sidx"-atom can not be made when writing chunk-by-chunk (when tracks have been altered).
+ * \sa setSegmentIndexGenerationEnabled()
+ */
+inline bool Mp4Container::isSegmentIndexGenerationEnabled() const
+{
+    return m_segmentIndexGenerationEnabled;
+}
+
+/*!
+ * \brief Sets whether a "sidx"-atom is made for the movie fragments of fragmented files when applying changes.
+ * \sa isSegmentIndexGenerationEnabled()
+ */
+inline void Mp4Container::setSegmentIndexGenerationEnabled(bool enabled)
+{
+    m_segmentIndexGenerationEnabled = enabled;
+}
+
 } // namespace TagParser
 
 #endif // TAG_PARSER_MP4CONTAINER_H
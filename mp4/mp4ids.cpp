@@ -1,6 +1,7 @@
 #include "./mp4ids.h"
 
 #include "../mediaformat.h"
+#include "../perfecthashmap.h"
 
 namespace TagParser {
 
@@ -44,155 +45,126 @@ namespace Mp4MediaTypeIds {
  */
 namespace FourccIds {
 
+/// \cond
+namespace {
+
+/// \brief The FOURCCs and the corresponding media formats.
+constexpr std::pair<std::uint32_t, MediaFormat> fourccsAndFormats[] = {
+    { Mpeg, GeneralMediaFormat::Mpeg1Video },
+    { Mpeg2Imx30, GeneralMediaFormat::Mpeg2Video },
+    { Mpeg2Imx50, GeneralMediaFormat::Mpeg2Video },
+    { Mpeg4Video, GeneralMediaFormat::Mpeg4Video },
+    { Mpeg4TimedText, GeneralMediaFormat::Mpeg4TimedText },
+    { Hevc1, GeneralMediaFormat::Hevc },
+    { Hevc2, GeneralMediaFormat::Hevc },
+    { Avc1, GeneralMediaFormat::Avc },
+    { Avc2, GeneralMediaFormat::Avc },
+    { Avc3, GeneralMediaFormat::Avc },
+    { Avc4, GeneralMediaFormat::Avc },
+    { H264Decoder1, GeneralMediaFormat::Avc },
+    { H264Decoder2, GeneralMediaFormat::Avc },
+    { H264Decoder3, GeneralMediaFormat::Avc },
+    { H264Decoder4, GeneralMediaFormat::Avc },
+    { H264Decoder5, GeneralMediaFormat::Avc },
+    { H264Decoder6, GeneralMediaFormat::Avc },
+    { Av1_IVF, GeneralMediaFormat::Av1 },
+    { Av1_ISOBMFF, GeneralMediaFormat::Av1 },
+    { Divx4Decoder1, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4AdvancedSimpleProfile0) },
+    { Divx4Decoder2, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4AdvancedSimpleProfile0) },
+    { H263Quicktime, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4AdvancedSimpleProfile0) },
+    { H2633GPP, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4AdvancedSimpleProfile0) },
+    { XvidDecoder1, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4AdvancedSimpleProfile0) },
+    { XvidDecoder2, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4AdvancedSimpleProfile0) },
+    { XvidDecoder3, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4AdvancedSimpleProfile0) },
+    { XvidDecoder4, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4AdvancedSimpleProfile0) },
+    { XvidDecoder5, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4AdvancedSimpleProfile0) },
+    { Divx5Decoder, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4AdvancedSimpleProfile0) },
+    { Divx3Decoder1, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4SimpleProfile0) },
+    { Divx3Decoder2, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4SimpleProfile0) },
+    { Divx3Decoder3, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4SimpleProfile0) },
+    { Divx3Decoder4, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4SimpleProfile0) },
+    { Divx3Decoder5, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4SimpleProfile0) },
+    { Divx3Decoder6, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4SimpleProfile0) },
+    { Divx3Decoder7, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4SimpleProfile0) },
+    { Divx3Decoder8, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4SimpleProfile0) },
+    { Divx3Decoder9, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4SimpleProfile0) },
+    { Divx3Decoder10, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4SimpleProfile0) },
+    { Divx3Decoder11, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4SimpleProfile0) },
+    { Divx3Decoder12, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4SimpleProfile0) },
+    { Divx3Decoder13, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4SimpleProfile0) },
+    { Divx3Decoder14, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4SimpleProfile0) },
+    { Divx3Decoder15, MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4SimpleProfile0) },
+    { Tiff, GeneralMediaFormat::Tiff },
+    { AppleTextAtsuiCodec, GeneralMediaFormat::TimedText },
+    { Raw, GeneralMediaFormat::UncompressedVideoFrames },
+    { Jpeg, GeneralMediaFormat::Jpeg },
+    { Gif, GeneralMediaFormat::Gif },
+    { Png, GeneralMediaFormat::Png },
+    { AdpcmAcm, GeneralMediaFormat::AdpcmAcm },
+    { ImaadpcmAcm, GeneralMediaFormat::ImaadpcmAcm },
+    { Mp3CbrOnly, MediaFormat(GeneralMediaFormat::Mpeg1Audio, SubFormats::Mpeg1Layer3) },
+    { Mp3, MediaFormat(GeneralMediaFormat::Mpeg1Audio, SubFormats::Mpeg1Layer3) },
+    { Mpeg4Audio, GeneralMediaFormat::Aac },
+    { Alac, GeneralMediaFormat::Alac },
+    { Ac3, GeneralMediaFormat::Ac3 },
+    { EAc3, GeneralMediaFormat::EAc3 },
+    { DolbyMpl, GeneralMediaFormat::DolbyMlp },
+    { Ac4, GeneralMediaFormat::Ac4 },
+    { Rv20, GeneralMediaFormat::RealVideo },
+    { Rv30, GeneralMediaFormat::RealVideo },
+    { Rv40, GeneralMediaFormat::RealVideo },
+    { Int24, MediaFormat(GeneralMediaFormat::Pcm) },
+    { Int32, MediaFormat(GeneralMediaFormat::Pcm) },
+    { Int16Be, MediaFormat(GeneralMediaFormat::Pcm, SubFormats::PcmIntBe) },
+    { Int16Le, MediaFormat(GeneralMediaFormat::Pcm, SubFormats::PcmIntLe) },
+    { FloatingPoint32Bit, MediaFormat(GeneralMediaFormat::Pcm, SubFormats::PcmFloatIeee) },
+    { FloatingPoint64Bit, MediaFormat(GeneralMediaFormat::Pcm, SubFormats::PcmFloatIeee) },
+    { Amr, MediaFormat(GeneralMediaFormat::Amr) },
+    { AmrNarrowband, MediaFormat(GeneralMediaFormat::Amr) },
+    { Dts, MediaFormat(GeneralMediaFormat::Dts) },
+    { DtsH, MediaFormat(GeneralMediaFormat::Dts) },
+    { DtsE, MediaFormat(GeneralMediaFormat::Dts, SubFormats::DtsExpress) },
+    { WindowsMediaAudio, MediaFormat(GeneralMediaFormat::WindowsMediaAudio) },
+    { WindowsMediaAudio7, MediaFormat(GeneralMediaFormat::WindowsMediaAudio) },
+    { WindowsMediaAudio9Professional, MediaFormat(GeneralMediaFormat::WindowsMediaAudio) },
+    { WindowsMediaAudio9Standard, MediaFormat(GeneralMediaFormat::WindowsMediaAudio) },
+    { MsMpeg4V1Decoder1, MediaFormat(GeneralMediaFormat::MicrosoftMpeg4, 1) },
+    { MsMpeg4V1Decoder2, MediaFormat(GeneralMediaFormat::MicrosoftMpeg4, 1) },
+    { MsMpeg4V1Decoder3, MediaFormat(GeneralMediaFormat::MicrosoftMpeg4, 1) },
+    { MsMpeg4V1Decoder4, MediaFormat(GeneralMediaFormat::MicrosoftMpeg4, 1) },
+    { MsMpeg4V1Decoder5, MediaFormat(GeneralMediaFormat::MicrosoftMpeg4, 1) },
+    { MsMpeg4V1Decoder6, MediaFormat(GeneralMediaFormat::MicrosoftMpeg4, 1) },
+    { MsMpeg4V2Decoder1, MediaFormat(GeneralMediaFormat::MicrosoftMpeg4, 2) },
+    { MsMpeg4V2Decoder2, MediaFormat(GeneralMediaFormat::MicrosoftMpeg4, 2) },
+    { MsMpeg4V2Decoder3, MediaFormat(GeneralMediaFormat::MicrosoftMpeg4, 2) },
+    { MsMpeg4V2Decoder4, MediaFormat(GeneralMediaFormat::MicrosoftMpeg4, 2) },
+    { MsMpeg4V3Decoder1, MediaFormat(GeneralMediaFormat::MicrosoftMpeg4, 3) },
+    { MsMpeg4V3Decoder2, MediaFormat(GeneralMediaFormat::MicrosoftMpeg4, 3) },
+    { Vp8, GeneralMediaFormat::Vp8 },
+    { Vp9, GeneralMediaFormat::Vp9 },
+    { Vp9_2, GeneralMediaFormat::Vp9 },
+    { WavPack, MediaFormat(GeneralMediaFormat::WavPack) },
+    { WindowsMediaVideoV17, MediaFormat(GeneralMediaFormat::WindowsMediaVideo, 1) },
+    { WindowsMediaVideoV2, MediaFormat(GeneralMediaFormat::WindowsMediaVideo, 2) },
+    { WindowsMediaVideoV8, MediaFormat(GeneralMediaFormat::WindowsMediaVideo, 2) },
+    { Flac, GeneralMediaFormat::Flac },
+    { Opus, GeneralMediaFormat::Opus },
+    // TODO: map more FOURCCs
+};
+constexpr auto formatsByFourcc = makeDisplacedPerfectHashMap(fourccsAndFormats, MediaFormat());
+static_assert(formatsByFourcc.isPerfect(), "FOURCCs must be unique");
+
+} // namespace
+/// \endcond
+
+/*!
+ * \brief Returns the media format for the specified \a fourccId.
+ * \remarks This is used by the MP4, IVF and Matroska (BITMAPINFOHEADER) parsers and resolves the ID with a single
+ *          lookup in a table built at compile-time.
+ */
 MediaFormat fourccToMediaFormat(std::uint32_t fourccId)
 {
-    switch (fourccId) {
-    case Mpeg:
-        return GeneralMediaFormat::Mpeg1Video;
-    case Mpeg2Imx30:
-    case Mpeg2Imx50:
-        return GeneralMediaFormat::Mpeg2Video;
-    case Mpeg4Video:
-        return GeneralMediaFormat::Mpeg4Video;
-    case Mpeg4TimedText:
-        return GeneralMediaFormat::Mpeg4TimedText;
-    case Hevc1:
-    case Hevc2:
-        return GeneralMediaFormat::Hevc;
-    case Avc1:
-    case Avc2:
-    case Avc3:
-    case Avc4:
-    case H264Decoder1:
-    case H264Decoder2:
-    case H264Decoder3:
-    case H264Decoder4:
-    case H264Decoder5:
-    case H264Decoder6:
-        return GeneralMediaFormat::Avc;
-    case Av1_IVF:
-    case Av1_ISOBMFF:
-        return GeneralMediaFormat::Av1;
-    case Divx4Decoder1:
-    case Divx4Decoder2:
-    case H263Quicktime:
-    case H2633GPP:
-    case XvidDecoder1:
-    case XvidDecoder2:
-    case XvidDecoder3:
-    case XvidDecoder4:
-    case XvidDecoder5:
-    case Divx5Decoder:
-        return MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4AdvancedSimpleProfile0);
-    case Divx3Decoder1:
-    case Divx3Decoder2:
-    case Divx3Decoder3:
-    case Divx3Decoder4:
-    case Divx3Decoder5:
-    case Divx3Decoder6:
-    case Divx3Decoder7:
-    case Divx3Decoder8:
-    case Divx3Decoder9:
-    case Divx3Decoder10:
-    case Divx3Decoder11:
-    case Divx3Decoder12:
-    case Divx3Decoder13:
-    case Divx3Decoder14:
-    case Divx3Decoder15:
-        return MediaFormat(GeneralMediaFormat::Mpeg4Video, SubFormats::Mpeg4SimpleProfile0);
-    case Tiff:
-        return GeneralMediaFormat::Tiff;
-    case AppleTextAtsuiCodec:
-        return GeneralMediaFormat::TimedText;
-    case Raw:
-        return GeneralMediaFormat::UncompressedVideoFrames;
-    case Jpeg:
-        return GeneralMediaFormat::Jpeg;
-    case Gif:
-        return GeneralMediaFormat::Gif;
-    case Png:
-        return GeneralMediaFormat::Png;
-    case AdpcmAcm:
-        return GeneralMediaFormat::AdpcmAcm;
-    case ImaadpcmAcm:
-        return GeneralMediaFormat::ImaadpcmAcm;
-    case Mp3CbrOnly:
-    case Mp3:
-        return MediaFormat(GeneralMediaFormat::Mpeg1Audio, SubFormats::Mpeg1Layer3);
-    case Mpeg4Audio:
-        return GeneralMediaFormat::Aac;
-    case Alac:
-        return GeneralMediaFormat::Alac;
-    case Ac3:
-        return GeneralMediaFormat::Ac3;
-    case EAc3:
-        return GeneralMediaFormat::EAc3;
-    case DolbyMpl:
-        return GeneralMediaFormat::DolbyMlp;
-    case Ac4:
-        return GeneralMediaFormat::Ac4;
-    case Rv20:
-    case Rv30:
-    case Rv40:
-        return GeneralMediaFormat::RealVideo;
-    case Int24:
-    case Int32:
-        return MediaFormat(GeneralMediaFormat::Pcm);
-    case Int16Be:
-        return MediaFormat(GeneralMediaFormat::Pcm, SubFormats::PcmIntBe);
-    case Int16Le:
-        return MediaFormat(GeneralMediaFormat::Pcm, SubFormats::PcmIntLe);
-    case FloatingPoint32Bit:
-    case FloatingPoint64Bit:
-        return MediaFormat(GeneralMediaFormat::Pcm, SubFormats::PcmFloatIeee);
-    case Amr:
-    case AmrNarrowband:
-        return MediaFormat(GeneralMediaFormat::Amr);
-    case Dts:
-    case DtsH:
-        return MediaFormat(GeneralMediaFormat::Dts);
-    case DtsE:
-        return MediaFormat(GeneralMediaFormat::Dts, SubFormats::DtsExpress);
-    case WindowsMediaAudio:
-    case WindowsMediaAudio7:
-    case WindowsMediaAudio9Professional:
-    case WindowsMediaAudio9Standard:
-        return MediaFormat(GeneralMediaFormat::WindowsMediaAudio);
-    case MsMpeg4V1Decoder1:
-    case MsMpeg4V1Decoder2:
-    case MsMpeg4V1Decoder3:
-    case MsMpeg4V1Decoder4:
-    case MsMpeg4V1Decoder5:
-    case MsMpeg4V1Decoder6:
-        return MediaFormat(GeneralMediaFormat::MicrosoftMpeg4, 1);
-    case MsMpeg4V2Decoder1:
-    case MsMpeg4V2Decoder2:
-    case MsMpeg4V2Decoder3:
-    case MsMpeg4V2Decoder4:
-        return MediaFormat(GeneralMediaFormat::MicrosoftMpeg4, 2);
-    case MsMpeg4V3Decoder1:
-    case MsMpeg4V3Decoder2:
-        return MediaFormat(GeneralMediaFormat::MicrosoftMpeg4, 3);
-    case Vp8:
-        return GeneralMediaFormat::Vp8;
-    case Vp9:
-    case Vp9_2:
-        return GeneralMediaFormat::Vp9;
-    case WavPack:
-        return MediaFormat(GeneralMediaFormat::WavPack);
-    case WindowsMediaVideoV17:
-        return MediaFormat(GeneralMediaFormat::WindowsMediaVideo, 1);
-    case WindowsMediaVideoV2:
-    case WindowsMediaVideoV8:
-        return MediaFormat(GeneralMediaFormat::WindowsMediaVideo, 2);
-    case Flac:
-        return GeneralMediaFormat::Flac;
-    case Opus:
-        return GeneralMediaFormat::Opus;
-    // TODO: map more FOURCCs
-    default:
-        return GeneralMediaFormat::Unknown;
-    }
+    return formatsByFourcc.find(fourccId);
 }
 
 } // namespace FourccIds
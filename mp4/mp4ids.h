@@ -14,6 +14,8 @@ enum KnownValue : std::uint32_t {
     Av1Configuration = 0x61763143, /**< av1C */
     AvcConfiguration = 0x61766343, /**< avcC */
     BitrateBox = 0x62747274, /**< btrt */
+    ChapterReference = 0x63686170, /**< chap */
+    ChapterList = 0x6368706c, /**< chpl */
     CleanAperature = 0x636c6170, /**< clap */
     ChunkOffset64 = 0x636f3634, /**< co64 */
     CompositionTimeToSample = 0x63747473, /**< ctts */
@@ -27,6 +29,7 @@ enum KnownValue : std::uint32_t {
     Free = 0x66726565, /**< free */
     FileType = 0x66747970, /**< ftyp */
     HandlerReference = 0x68646c72, /**< hdlr */
+    HevcConfiguration = 0x68766343, /**< hvcC */
     HintMediaHeader = 0x686D6864, /**< hmhd */
     ItunesList = 0x696c7374, /**< ilst */
     MediaData = 0x6d646174, /**< mdat */
@@ -37,6 +40,7 @@ enum KnownValue : std::uint32_t {
     Meta = 0x6d657461, /**< meta */
     MovieFragmentHeader = 0x6D666864, /**< mfhd */
     MovieFragmentRandomAccess = 0x6d667261, /**< mfra */
+    MovieFragmentRandomAccessOffset = 0x6d66726f, /**< mfro */
     MediaInformation = 0x6d696e66, /**< minf */
     MediaInformationHeader = 0x676D6864, /**< gmhd */
     MediaInformationBase = 0x676D696E, /**< gmin */
@@ -50,9 +54,11 @@ enum KnownValue : std::uint32_t {
     PaddingBits = 0x70616462, /**< padb */
     PixalAspectRatio = 0x70617370, /**< pasp */
     ProgressiveDownloadInformation = 0x7064696e, /**< pdin */
+    SampleAuxiliaryInformationOffsets = 0x7361696F, /**< saio */
     SampleToGroup = 0x73626770, /**< sbgp */
     IndependentAndDisposableSamples = 0x73647470, /**< sdtp */
     SampleGroupDescription = 0x73677064, /**< sgpd */
+    SegmentIndex = 0x73696478, /**< sidx */
     Skip = 0x736b6970, /**< skip */
     SoundMediaHeader = 0x736D6864, /**< smhd */
     SampleTable = 0x7374626c, /**< stbl */
@@ -66,7 +72,9 @@ enum KnownValue : std::uint32_t {
     DecodingTimeToSample = 0x73747473, /**< stts */
     CompactSampleSize = 0x73747a32, /**< stz2 */
     SubSampleInformation = 0x73756273, /**< subs */
+    TrackFragmentBaseMediaDecodeTime = 0x74666474, /**< tfdt */
     TrackFragmentHeader = 0x74666864, /**< tfhd */
+    TrackFragmentRandomAccess = 0x74667261, /**< tfra */
     TrackHeader = 0x746b6864, /**< tkhd */
     TrackFragment = 0x74726166, /**< traf */
     Track = 0x7472616b, /**< trak */
@@ -432,6 +440,8 @@ enum KnownValue : std::uint32_t {
     Mpeg4ElementaryStreamDescriptor2 = 0x6D346473, /**< m4ds: Alternative if encoded to AVC stanard. */
     AvcConfiguration
     = 0x61766343, /**< avcC: An H.264 AVCConfigurationBox. This extension is required for H.264 video as defined in ISO/IEC 14496-15. */
+    HevcConfiguration
+    = 0x68766343, /**< hvcC: An H.265 HEVCConfigurationBox. This extension is required for H.265 video as defined in ISO/IEC 14496-15. */
     PixelAspectRatio = 0x70617370, /**< pasp: Pixel aspect ratio. This extension is mandatory for video formats that use non-square pixels. */
     ColorParameters = 0x636F6C72, /**< colr: An image description extension required for all uncompressed Y´CbCr video types. */
     CleanAperature = 0x636C6170, /**< clap: Spatial relationship of Y´CbCr components relative to a canonical image center. */
@@ -0,0 +1,435 @@
+#include "./mp4samplecursor.h"
+#include "./mp4atom.h"
+#include "./mp4container.h"
+#include "./mp4ids.h"
+#include "./mp4track.h"
+
+#include "../diagnostics.h"
+#include "../exceptions.h"
+
+#include <c++utilities/conversion/binaryconversion.h>
+#include <c++utilities/conversion/stringbuilder.h>
+#include <c++utilities/conversion/stringconversion.h>
+
+#include <algorithm>
+#include <istream>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+/*!
+ * \class TagParser::Mp4SampleCursor
+ * \brief The Mp4SampleCursor class iterates over the samples of an MP4 track in decoding order.
+ *
+ * The offset, size, decoding time and sync flag of each sample are determined from the "stco"/"co64"-, "stsc"-,
+ * "stsz"/"stz2"-, "stts"- and "stss"-atoms. The media data is only read when calling data(). This allows extracting
+ * thumbnails and keyframes without a full demuxer:
+ * ```
+ * auto cursor = Mp4SampleCursor(track);
+ * cursor.seek(decodingTime, diag);
+ * if (cursor.next(diag)) {
+ *     const auto keyframe = cursor.data(diag);
+ *     // decode keyframe
+ * }
+ * ```
+ *
+ * \remarks
+ * - The track must have been parsed. The cursor does not take ownership over the track; it must not be used after
+ *   the track has been destroyed or parsed again.
+ * - The chunk offsets as well as the "stsc"-, "stts"- and "stss"-tables are loaded when the cursor is used the first
+ *   time. The sample sizes are read block by block via Mp4Track::sampleTable().
+ * - Samples within movie fragments are not covered; use Mp4Track::readFragment() for fragmented files.
+ * - The composition offsets of the "ctts"-atom are not taken into account.
+ */
+
+/*!
+ * \brief Constructs a new cursor for the specified \a track which is positioned before the first sample.
+ */
+Mp4SampleCursor::Mp4SampleCursor(Mp4Track &track)
+    : m_track(track)
+    , m_initialized(false)
+    , m_hasSyncSampleTable(false)
+    , m_sampleCount(0)
+    , m_nextSample(0)
+    , m_sampleToChunkEntry(0)
+    , m_chunkIndex(0)
+    , m_samplesPerChunk(0)
+    , m_sampleInChunk(0)
+    , m_nextOffset(0)
+    , m_timeToSampleEntry(0)
+    , m_sampleInTimeToSampleEntry(0)
+    , m_nextDecodingTime(0)
+    , m_syncSampleEntry(0)
+    , m_readAhead(0x100000)
+    , m_bufferOffset(0)
+{
+}
+
+/*!
+ * \brief Advances to the next sample.
+ * \returns Returns whether there is a next sample; problems are reported via \a diag.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+bool Mp4SampleCursor::next(Diagnostics &diag)
+{
+    static const string context("iterating samples of MP4 track");
+    if (!m_initialized && !init(diag)) {
+        return false;
+    }
+    if (m_nextSample >= m_sampleCount) {
+        return false;
+    }
+
+    // enter the chunk containing the sample
+    while (m_sampleInChunk >= m_samplesPerChunk) {
+        if (!enterChunk(m_chunkIndex + 1)) {
+            diag.emplace_back(DiagLevel::Critical,
+                argsToString("The chunk of sample ", m_nextSample, " can not be determined. The subsequent samples will be ignored."), context);
+            m_nextSample = m_sampleCount;
+            return false;
+        }
+    }
+
+    // determine size, decoding time and sync flag
+    auto &stream = m_track.inputStream();
+    m_sample.index = m_nextSample;
+    m_sample.offset = m_nextOffset;
+    try {
+        m_sample.size = m_track.sampleTable().sampleSize(stream, m_nextSample);
+    } catch (const Failure &) {
+        diag.emplace_back(DiagLevel::Critical,
+            argsToString("The size of sample ", m_nextSample, " can not be determined. The subsequent samples will be ignored."), context);
+        m_nextSample = m_sampleCount;
+        return false;
+    }
+    for (; m_timeToSampleEntry < m_timeToSampleTable.size() && m_sampleInTimeToSampleEntry >= m_timeToSampleTable[m_timeToSampleEntry].first;
+         ++m_timeToSampleEntry) {
+        m_sampleInTimeToSampleEntry = 0;
+    }
+    m_sample.decodingTime = m_nextDecodingTime;
+    if (m_timeToSampleEntry < m_timeToSampleTable.size()) {
+        m_nextDecodingTime += m_timeToSampleTable[m_timeToSampleEntry].second;
+        ++m_sampleInTimeToSampleEntry;
+    }
+    if (m_hasSyncSampleTable) {
+        // sync samples are denoted by their number (starting at 1)
+        for (; m_syncSampleEntry < m_syncSamples.size() && m_syncSamples[m_syncSampleEntry] <= m_nextSample; ++m_syncSampleEntry)
+            ;
+        m_sample.isSync = m_syncSampleEntry < m_syncSamples.size() && m_syncSamples[m_syncSampleEntry] == m_nextSample + 1;
+    } else {
+        m_sample.isSync = true;
+    }
+
+    m_nextOffset += m_sample.size;
+    ++m_sampleInChunk;
+    ++m_nextSample;
+    return true;
+}
+
+/*!
+ * \brief Positions the cursor before the last sync sample whose decoding time is not greater than \a decodingTime.
+ * \param decodingTime Specifies the decoding time in the time scale of the track (see Mp4Track::timeScale()).
+ * \returns Returns whether the track contains samples; if there is no sync sample before the specified time, the cursor
+ *          is positioned before the first sample.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+bool Mp4SampleCursor::seek(std::uint64_t decodingTime, Diagnostics &diag)
+{
+    if (!m_initialized && !init(diag)) {
+        return false;
+    }
+    if (!m_sampleCount) {
+        return false;
+    }
+
+    // find the sample decoded at the specified time
+    auto sampleIndex = std::uint64_t(m_sampleCount - 1);
+    auto time = std::uint64_t(), firstSample = std::uint64_t();
+    for (const auto &[sampleCount, sampleDelta] : m_timeToSampleTable) {
+        const auto duration = static_cast<std::uint64_t>(sampleCount) * sampleDelta;
+        if (sampleDelta && decodingTime < time + duration) {
+            sampleIndex = min(sampleIndex, firstSample + (decodingTime - time) / sampleDelta);
+            break;
+        }
+        time += duration;
+        firstSample += sampleCount;
+    }
+
+    // go back to the previous sync sample
+    if (m_hasSyncSampleTable) {
+        const auto syncSample = upper_bound(m_syncSamples.cbegin(), m_syncSamples.cend(), sampleIndex + 1);
+        sampleIndex = syncSample != m_syncSamples.cbegin() && *(syncSample - 1) ? *(syncSample - 1) - 1 : 0;
+    }
+    position(static_cast<std::uint32_t>(sampleIndex));
+    return true;
+}
+
+/*!
+ * \brief Positions the cursor before the first sample.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+void Mp4SampleCursor::reset()
+{
+    if (m_initialized) {
+        position(0);
+    }
+}
+
+/*!
+ * \brief Returns the data of the current sample.
+ * \returns Returns the data or an empty view if it can not be read (which is reported via \a diag).
+ * \remarks
+ * - The returned view points into the memory-mapped file if the file is mapped (see BasicFileInfo::mappedData()).
+ * - Otherwise it points into a buffer of the cursor which is only valid until the next call. The buffer holds the
+ *   data of the subsequent samples as well (see setReadAhead()).
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+std::string_view Mp4SampleCursor::data(Diagnostics &diag)
+{
+    static const string context("reading sample of MP4 track");
+    if (const auto mapping = m_track.trakAtom().container().mappedData(); !mapping.empty()) {
+        if (m_sample.offset <= mapping.size() && m_sample.size <= mapping.size() - m_sample.offset) {
+            return mapping.substr(static_cast<std::size_t>(m_sample.offset), m_sample.size);
+        }
+    } else {
+        if (m_sample.offset >= m_bufferOffset && m_sample.offset + m_sample.size <= m_bufferOffset + m_buffer.size()) {
+            return std::string_view(m_buffer.data() + (m_sample.offset - m_bufferOffset), m_sample.size);
+        }
+        auto &stream = m_track.inputStream();
+        m_buffer.resize(static_cast<std::size_t>(max<std::uint64_t>(m_sample.size, m_readAhead)));
+        m_bufferOffset = m_sample.offset;
+        stream.seekg(static_cast<streamoff>(m_sample.offset));
+        stream.read(m_buffer.data(), static_cast<streamsize>(m_buffer.size()));
+        // a short read is fine as long as the sample is covered (read-ahead might exceed the end of the file)
+        m_buffer.resize(static_cast<std::size_t>(max<streamsize>(stream.gcount(), 0)));
+        stream.clear();
+        if (m_sample.size <= m_buffer.size()) {
+            return std::string_view(m_buffer.data(), m_sample.size);
+        }
+    }
+    diag.emplace_back(DiagLevel::Critical, argsToString("The data of sample ", m_sample.index, " exceeds the file."), context);
+    return std::string_view();
+}
+
+/*!
+ * \brief Reads the data of all remaining samples with as few reads as possible.
+ * \param callback Specifies the function invoked for each sample (in decoding order) with its data.
+ * \param maxGap Specifies the max. number of bytes between two samples which are still read at once.
+ * \returns Returns the number of samples \a callback has been invoked for; problems are reported via \a diag.
+ *
+ * The locations of the remaining samples are determined first (which only reads the tables). Then samples which are
+ * stored close to each other (not more than \a maxGap bytes apart) are read at once, up to maxGatherSize bytes. So
+ * small samples which are scattered across the media data, e.g. the samples of a chapter or subtitle track interleaved
+ * with the audio, do not need one read per sample.
+ *
+ * \remarks
+ * - The data passed to \a callback is only valid while \a callback runs.
+ * - The cursor is positioned after the last sample afterwards.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+std::size_t Mp4SampleCursor::gather(FunctionRef<void(const Mp4Sample &, std::string_view)> callback, Diagnostics &diag, std::uint64_t maxGap)
+{
+    static const string context("reading samples of MP4 track");
+
+    // plan the reads by determining the locations of the samples first
+    auto samples = vector<Mp4Sample>();
+    while (next(diag)) {
+        samples.emplace_back(m_sample);
+    }
+
+    // serve the samples from the memory-mapped file if possible
+    auto sampleCount = std::size_t();
+    if (const auto mapping = m_track.trakAtom().container().mappedData(); !mapping.empty()) {
+        for (const auto &sample : samples) {
+            if (sample.offset <= mapping.size() && sample.size <= mapping.size() - sample.offset) {
+                callback(sample, mapping.substr(static_cast<std::size_t>(sample.offset), sample.size));
+                ++sampleCount;
+            } else {
+                diag.emplace_back(DiagLevel::Critical, argsToString("The data of sample ", sample.index, " exceeds the file."), context);
+            }
+        }
+        return sampleCount;
+    }
+
+    // read subsequent samples which are close to each other at once
+    auto &stream = m_track.inputStream();
+    for (auto begin = samples.cbegin(), end = samples.cend(); begin != end;) {
+        const auto readOffset = begin->offset;
+        auto readEnd = readOffset + begin->size;
+        auto last = begin + 1;
+        for (; last != end && last->offset >= readOffset && last->offset <= readEnd + maxGap
+             && last->offset + last->size - readOffset <= maxGatherSize;
+             ++last) {
+            readEnd = max<std::uint64_t>(readEnd, last->offset + last->size);
+        }
+        m_buffer.resize(static_cast<std::size_t>(readEnd - readOffset));
+        m_bufferOffset = readOffset;
+        stream.seekg(static_cast<streamoff>(readOffset));
+        stream.read(m_buffer.data(), static_cast<streamsize>(m_buffer.size()));
+        m_buffer.resize(static_cast<std::size_t>(max<streamsize>(stream.gcount(), 0)));
+        stream.clear();
+        for (; begin != last; ++begin) {
+            if (begin->offset + begin->size <= readOffset + m_buffer.size()) {
+                callback(*begin, std::string_view(m_buffer.data() + (begin->offset - readOffset), begin->size));
+                ++sampleCount;
+            } else {
+                diag.emplace_back(DiagLevel::Critical, argsToString("The data of sample ", begin->index, " exceeds the file."), context);
+            }
+        }
+    }
+    return sampleCount;
+}
+
+/*!
+ * \brief Loads the tables and positions the cursor before the first sample.
+ * \returns Returns whether the required tables could be loaded.
+ */
+bool Mp4SampleCursor::init(Diagnostics &diag)
+{
+    static const string context("iterating samples of MP4 track");
+    m_initialized = true;
+    m_sampleCount = m_track.sampleTable().sampleCount();
+    if (!m_sampleCount) {
+        return true;
+    }
+    try {
+        m_chunkOffsets = m_track.readChunkOffsets(false, diag);
+        m_sampleToChunkTable = m_track.readSampleToChunkTable(diag);
+    } catch (const Failure &) {
+        diag.emplace_back(DiagLevel::Critical, "Unable to read the chunk offsets and the \"sample to chunk\" table.", context);
+        m_sampleCount = 0;
+        return false;
+    }
+
+    auto table = std::string();
+    if (readTable(Mp4AtomIds::DecodingTimeToSample, 8, table, diag)) {
+        m_timeToSampleTable.reserve(table.size() / 8);
+        for (std::size_t i = 0; i + 8 <= table.size(); i += 8) {
+            m_timeToSampleTable.emplace_back(BE::toUInt32(table.data() + i), BE::toUInt32(table.data() + i + 4));
+        }
+    }
+    if ((m_hasSyncSampleTable = readTable(Mp4AtomIds::SyncSample, 4, table, diag))) {
+        m_syncSamples.reserve(table.size() / 4);
+        for (std::size_t i = 0; i + 4 <= table.size(); i += 4) {
+            m_syncSamples.emplace_back(BE::toUInt32(table.data() + i));
+        }
+        if (!is_sorted(m_syncSamples.cbegin(), m_syncSamples.cend())) {
+            diag.emplace_back(DiagLevel::Warning, "The sync sample table is not sorted.", context);
+            sort(m_syncSamples.begin(), m_syncSamples.end());
+        }
+    }
+    position(0);
+    return true;
+}
+
+/*!
+ * \brief Reads the entries of the table with the specified \a atomId within the "stbl"-atom into \a table.
+ * \returns Returns whether the atom is present; truncated tables are reported via \a diag and read partially.
+ */
+bool Mp4SampleCursor::readTable(std::uint32_t atomId, std::size_t entrySize, std::string &table, Diagnostics &diag)
+{
+    static const string context("iterating samples of MP4 track");
+    using namespace Mp4AtomIds;
+    table.clear();
+    auto *const atom = m_track.trakAtom().subelementByPath(diag, Media, MediaInformation, SampleTable, atomId);
+    if (!atom || atom->dataSize() < 8) {
+        return false;
+    }
+    auto &stream = m_track.inputStream();
+    char header[8];
+    stream.seekg(static_cast<streamoff>(atom->dataOffset()));
+    stream.read(header, 8);
+    auto entryCount = static_cast<std::uint64_t>(BE::toUInt32(header + 4));
+    if (entryCount > (atom->dataSize() - 8) / entrySize) {
+        diag.emplace_back(DiagLevel::Critical,
+            argsToString("The \"", interpretIntegerAsString<std::uint32_t>(atomId), "\"-atom is truncated. It stores less entries as denoted."),
+            context);
+        entryCount = (atom->dataSize() - 8) / entrySize;
+    }
+    table.resize(static_cast<std::size_t>(entryCount * entrySize));
+    stream.read(table.data(), static_cast<streamsize>(table.size()));
+    return true;
+}
+
+/*!
+ * \brief Makes the chunk with the specified \a chunkIndex (starting at 0) the current chunk.
+ * \returns Returns whether the chunk exists.
+ * \remarks The entry of the "sample to chunk" table is only looked up forwards.
+ */
+bool Mp4SampleCursor::enterChunk(std::uint32_t chunkIndex)
+{
+    if (chunkIndex >= m_chunkOffsets.size() || m_sampleToChunkTable.empty()) {
+        return false;
+    }
+    for (; m_sampleToChunkEntry + 1 < m_sampleToChunkTable.size() && get<0>(m_sampleToChunkTable[m_sampleToChunkEntry + 1]) <= chunkIndex + 1;
+         ++m_sampleToChunkEntry)
+        ;
+    m_chunkIndex = chunkIndex;
+    m_samplesPerChunk = get<1>(m_sampleToChunkTable[m_sampleToChunkEntry]);
+    m_sampleInChunk = 0;
+    m_nextOffset = m_chunkOffsets[chunkIndex];
+    return true;
+}
+
+/*!
+ * \brief Positions the cursor before the sample with the specified \a sampleIndex.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+void Mp4SampleCursor::position(std::uint32_t sampleIndex)
+{
+    m_nextSample = m_sampleCount;
+    m_sampleToChunkEntry = 0;
+    m_chunkIndex = m_samplesPerChunk = m_sampleInChunk = 0;
+    m_nextOffset = 0;
+
+    // locate the chunk via the "sample to chunk" table
+    auto firstSample = std::uint64_t();
+    for (auto entry = m_sampleToChunkTable.cbegin(), end = m_sampleToChunkTable.cend(); entry != end; ++entry) {
+        const auto firstChunk = get<0>(*entry);
+        const auto nextFirstChunk = entry + 1 != end ? get<0>(*(entry + 1)) : static_cast<std::uint32_t>(m_chunkOffsets.size() + 1);
+        const auto samplesPerChunk = get<1>(*entry);
+        if (!firstChunk || nextFirstChunk <= firstChunk || !samplesPerChunk) {
+            continue;
+        }
+        const auto entrySampleCount = static_cast<std::uint64_t>(nextFirstChunk - firstChunk) * samplesPerChunk;
+        if (sampleIndex >= firstSample + entrySampleCount) {
+            firstSample += entrySampleCount;
+            continue;
+        }
+        const auto sampleInChunk = static_cast<std::uint32_t>((sampleIndex - firstSample) % samplesPerChunk);
+        if (!enterChunk(firstChunk - 1 + static_cast<std::uint32_t>((sampleIndex - firstSample) / samplesPerChunk))) {
+            return;
+        }
+        if (sampleInChunk) {
+            if (!m_track.sampleTable().hasSampleSizes(sampleIndex - sampleInChunk, sampleInChunk)) {
+                return;
+            }
+            m_nextOffset += m_track.sampleTable().accumulateSampleSizes(m_track.inputStream(), sampleIndex - sampleInChunk, sampleInChunk);
+            m_sampleInChunk = sampleInChunk;
+        }
+        m_nextSample = sampleIndex;
+        break;
+    }
+
+    // locate the entry of the "time to sample" table
+    m_timeToSampleEntry = 0;
+    m_sampleInTimeToSampleEntry = 0;
+    m_nextDecodingTime = 0;
+    for (auto remainingSamples = sampleIndex; m_timeToSampleEntry < m_timeToSampleTable.size(); ++m_timeToSampleEntry) {
+        const auto &[sampleCount, sampleDelta] = m_timeToSampleTable[m_timeToSampleEntry];
+        if (remainingSamples < sampleCount) {
+            m_sampleInTimeToSampleEntry = remainingSamples;
+            m_nextDecodingTime += static_cast<std::uint64_t>(remainingSamples) * sampleDelta;
+            break;
+        }
+        m_nextDecodingTime += static_cast<std::uint64_t>(sampleCount) * sampleDelta;
+        remainingSamples -= sampleCount;
+    }
+
+    // locate the entry of the sync sample table
+    m_syncSampleEntry = static_cast<std::size_t>(lower_bound(m_syncSamples.cbegin(), m_syncSamples.cend(), sampleIndex + 1) - m_syncSamples.cbegin());
+}
+
+} // namespace TagParser
@@ -0,0 +1,113 @@
+#ifndef TAG_PARSER_MP4SAMPLECURSOR_H
+#define TAG_PARSER_MP4SAMPLECURSOR_H
+
+#include "../functionref.h"
+#include "../global.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace TagParser {
+
+class Diagnostics;
+class Mp4Track;
+
+/*!
+ * \brief The Mp4Sample struct holds the location and timing of a sample as determined by Mp4SampleCursor.
+ */
+struct TAG_PARSER_EXPORT Mp4Sample {
+    /// \brief The index of the sample within the track (starting at 0).
+    std::uint32_t index = 0;
+    /// \brief The offset of the sample data within the file.
+    std::uint64_t offset = 0;
+    /// \brief The size of the sample data.
+    std::uint32_t size = 0;
+    /// \brief The decoding time in the time scale of the track.
+    std::uint64_t decodingTime = 0;
+    /// \brief Whether the sample is a sync sample (keyframe); all samples are sync samples if there is no "stss"-atom.
+    bool isSync = false;
+};
+
+class TAG_PARSER_EXPORT Mp4SampleCursor {
+public:
+    explicit Mp4SampleCursor(Mp4Track &track);
+
+    bool next(Diagnostics &diag);
+    bool seek(std::uint64_t decodingTime, Diagnostics &diag);
+    void reset();
+    const Mp4Sample &sample() const;
+    std::string_view data(Diagnostics &diag);
+    std::size_t gather(FunctionRef<void(const Mp4Sample &, std::string_view)> callback, Diagnostics &diag, std::uint64_t maxGap = 0x10000);
+    std::uint64_t readAhead() const;
+    void setReadAhead(std::uint64_t readAhead);
+
+    /// \brief The max. number of bytes gather() reads at once (unless a single sample is bigger).
+    static constexpr std::uint64_t maxGatherSize = 0x4000000;
+
+private:
+    bool init(Diagnostics &diag);
+    bool readTable(std::uint32_t atomId, std::size_t entrySize, std::string &table, Diagnostics &diag);
+    bool enterChunk(std::uint32_t chunkIndex);
+    void position(std::uint32_t sampleIndex);
+
+    Mp4Track &m_track;
+    bool m_initialized;
+    bool m_hasSyncSampleTable;
+    std::uint32_t m_sampleCount;
+    std::vector<std::uint64_t> m_chunkOffsets;
+    std::vector<std::tuple<std::uint32_t, std::uint32_t, std::uint32_t>> m_sampleToChunkTable;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> m_timeToSampleTable;
+    std::vector<std::uint32_t> m_syncSamples;
+    std::uint32_t m_nextSample;
+    std::size_t m_sampleToChunkEntry;
+    std::uint32_t m_chunkIndex;
+    std::uint32_t m_samplesPerChunk;
+    std::uint32_t m_sampleInChunk;
+    std::uint64_t m_nextOffset;
+    std::size_t m_timeToSampleEntry;
+    std::uint32_t m_sampleInTimeToSampleEntry;
+    std::uint64_t m_nextDecodingTime;
+    std::size_t m_syncSampleEntry;
+    std::uint64_t m_readAhead;
+    std::string m_buffer;
+    std::uint64_t m_bufferOffset;
+    Mp4Sample m_sample;
+};
+
+/*!
+ * \brief Returns the current sample.
+ * \remarks Only valid after next() returned true.
+ */
+inline const Mp4Sample &Mp4SampleCursor::sample() const
+{
+    return m_sample;
+}
+
+/*!
+ * \brief Returns the number of bytes data() reads at once if the file is not memory-mapped.
+ * \sa setReadAhead()
+ */
+inline std::uint64_t Mp4SampleCursor::readAhead() const
+{
+    return m_readAhead;
+}
+
+/*!
+ * \brief Sets the number of bytes data() reads at once if the file is not memory-mapped.
+ *
+ * When data() needs to read, it reads at least \a readAhead bytes starting at the current sample. Subsequent samples
+ * within that range (usually the next chunks of the track, possibly interleaved with chunks of other tracks) are then
+ * served from the buffer. Zero means only the current sample is read. The default is 1 MiB.
+ */
+inline void Mp4SampleCursor::setReadAhead(std::uint64_t readAhead)
+{
+    m_readAhead = readAhead;
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_MP4SAMPLECURSOR_H
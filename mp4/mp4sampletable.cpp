@@ -0,0 +1,433 @@
+#include "./mp4sampletable.h"
+#include "./mp4atom.h"
+#include "./mp4ids.h"
+
+#include "../diagnostics.h"
+#include "../exceptions.h"
+
+#include <c++utilities/conversion/binaryconversion.h>
+
+#include <algorithm>
+#include <istream>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+namespace {
+
+/*!
+ * \brief Returns the sum of \a count big-endian sample sizes of \a fieldSize bits stored at \a data.
+ * \remarks The loop is kept trivial so the compiler can vectorize it.
+ */
+template <std::uint8_t fieldSize> std::uint64_t sumSampleSizes(const char *data, std::size_t count)
+{
+    std::uint64_t sum = 0;
+    for (std::size_t i = 0; i != count; ++i) {
+        if constexpr (fieldSize == 8) {
+            sum += static_cast<std::uint8_t>(data[i]);
+        } else if constexpr (fieldSize == 16) {
+            sum += BE::toUInt16(data + i * 2);
+        } else {
+            sum += BE::toUInt32(data + i * 4);
+        }
+    }
+    return sum;
+}
+
+/*!
+ * \brief Returns the sum of the sample counts of \a count "stts"-entries stored at \a data.
+ * \remarks The loop is kept trivial so the compiler can vectorize it.
+ */
+std::uint64_t sumTimeToSampleCounts(const char *data, std::size_t count)
+{
+    std::uint64_t sum = 0;
+    for (std::size_t i = 0; i != count; ++i) {
+        sum += BE::toUInt32(data + i * 8);
+    }
+    return sum;
+}
+
+} // namespace
+
+/*!
+ * \class TagParser::Mp4SampleTable
+ * \brief The Mp4SampleTable class provides access to the sample table of an MP4 track without loading it into memory.
+ *
+ * Only the location and the number of entries of the "stsz"/"stz2"-, "stsc"- and "stts"-atoms are determined when
+ * parsing. Entries are decoded from the stream when they are accessed. A block of the tables is buffered so accessing
+ * consecutive samples causes only one read per block. Looking up chunks and decoding times continues from the previously
+ * looked up entry; hence iterating over the samples in order is cheap even though these tables are run-length encoded.
+ *
+ * \remarks The stream must be passed explicitly because the input stream of a track might change (e.g. when applying
+ *          changes the original file is read via a backup stream). It must provide the same data as the stream which
+ *          has been used for parsing.
+ */
+
+/*!
+ * \brief Constructs a new, empty sample table.
+ */
+Mp4SampleTable::Mp4SampleTable()
+    : m_sampleSizeOffset(0)
+    , m_sampleCount(0)
+    , m_sampleSizeCount(0)
+    , m_constantSampleSize(0)
+    , m_fieldSize(0)
+    , m_sampleToChunkOffset(0)
+    , m_sampleToChunkEntryCount(0)
+    , m_chunkCount(0)
+    , m_sampleToChunkEntry(0)
+    , m_sampleToChunkFirstSample(0)
+    , m_timeToSampleOffset(0)
+    , m_timeToSampleEntryCount(0)
+    , m_timeToSampleEntry(0)
+    , m_timeToSampleFirstSample(0)
+    , m_timeToSampleFirstTime(0)
+    , m_blockOffset(0)
+    , m_blockLength(0)
+{
+}
+
+/*!
+ * \brief Determines the location of the tables within the specified atoms.
+ * \param stream Specifies the stream to read the headers of the atoms from.
+ * \param sampleSizeAtom Specifies the "stsz"- or "stz2"-atom.
+ * \param sampleToChunkAtom Specifies the "stsc"-atom; might be nullptr.
+ * \param timeToSampleAtom Specifies the "stts"-atom; might be nullptr.
+ * \param chunkCount Specifies the number of chunks denoted by the "stco"/"co64"-atom.
+ * \remarks Issues are reported via \a diag; tables which can not be read are considered empty.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+void Mp4SampleTable::parse(std::istream &stream, Mp4Atom *sampleSizeAtom, Mp4Atom *sampleToChunkAtom, Mp4Atom *timeToSampleAtom,
+    std::uint32_t chunkCount, Diagnostics &diag)
+{
+    static const string context("parsing MP4 sample table");
+    *this = Mp4SampleTable();
+    m_chunkCount = chunkCount;
+    char buffer[12];
+
+    // read header of stsz/stz2 atom
+    if (sampleSizeAtom) {
+        if (sampleSizeAtom->dataSize() < 12) {
+            diag.emplace_back(DiagLevel::Critical,
+                "The stsz atom is truncated. There are no sample sizes present. The size of the track can not be determined.", context);
+        } else {
+            stream.seekg(static_cast<streamoff>(sampleSizeAtom->dataOffset()));
+            stream.read(buffer, 12);
+            m_sampleSizeOffset = sampleSizeAtom->dataOffset() + 12;
+            m_sampleCount = BE::toUInt32(buffer + 8);
+            if (sampleSizeAtom->id() == Mp4AtomIds::CompactSampleSize) {
+                m_fieldSize = static_cast<std::uint8_t>(buffer[7]);
+            } else {
+                m_constantSampleSize = BE::toUInt32(buffer + 4);
+                m_fieldSize = 32;
+            }
+            if (m_constantSampleSize) {
+                m_sampleSizeCount = m_sampleCount;
+            } else {
+                switch (m_fieldSize) {
+                case 4:
+                case 8:
+                case 16:
+                case 32: {
+                    const auto tableSize = sampleSizeAtom->dataSize() - 12;
+                    const auto calculatedTableSize = (static_cast<std::uint64_t>(m_sampleCount) * m_fieldSize + 7) / 8;
+                    m_sampleSizeCount = m_sampleCount;
+                    if (calculatedTableSize < tableSize) {
+                        diag.emplace_back(
+                            DiagLevel::Critical, "The stsz atom stores more entries as denoted. The additional entries will be ignored.", context);
+                    } else if (calculatedTableSize > tableSize) {
+                        diag.emplace_back(DiagLevel::Critical, "The stsz atom is truncated. It stores less entries as denoted.", context);
+                        m_sampleSizeCount = static_cast<std::uint32_t>(tableSize * 8 / m_fieldSize);
+                    }
+                    break;
+                }
+                default:
+                    diag.emplace_back(DiagLevel::Critical,
+                        "The fieldsize used to store the sample sizes is not supported. The sample count and size of the track can not be "
+                        "determined.",
+                        context);
+                    m_sampleCount = 0;
+                }
+            }
+        }
+    }
+
+    // read header of stsc atom
+    if (sampleToChunkAtom && sampleToChunkAtom->dataSize() >= 8) {
+        stream.seekg(static_cast<streamoff>(sampleToChunkAtom->dataOffset() + 4));
+        stream.read(buffer, 4);
+        m_sampleToChunkOffset = sampleToChunkAtom->dataOffset() + 8;
+        m_sampleToChunkEntryCount = static_cast<std::uint32_t>(min<std::uint64_t>(BE::toUInt32(buffer), (sampleToChunkAtom->dataSize() - 8) / 12));
+    }
+
+    // read header of stts atom
+    if (timeToSampleAtom && timeToSampleAtom->dataSize() >= 8) {
+        stream.seekg(static_cast<streamoff>(timeToSampleAtom->dataOffset() + 4));
+        stream.read(buffer, 4);
+        m_timeToSampleOffset = timeToSampleAtom->dataOffset() + 8;
+        m_timeToSampleEntryCount = static_cast<std::uint32_t>(min<std::uint64_t>(BE::toUInt32(buffer), (timeToSampleAtom->dataSize() - 8) / 8));
+    }
+}
+
+/*!
+ * \brief Returns \a size bytes at the specified \a offset from the buffered block, reading a new block if required.
+ * \remarks The block is not read beyond \a tableEnd to avoid reading beyond the end of the file.
+ */
+const char *Mp4SampleTable::read(std::istream &stream, std::uint64_t offset, std::size_t size, std::uint64_t tableEnd)
+{
+    if (offset < m_blockOffset || offset + size > m_blockOffset + m_blockLength) {
+        if (!m_block) {
+            m_block = make_unique<char[]>(blockSize);
+        }
+        m_blockOffset = offset;
+        m_blockLength = static_cast<std::size_t>(min<std::uint64_t>(blockSize, tableEnd - offset));
+        stream.seekg(static_cast<streamoff>(offset));
+        stream.read(m_block.get(), static_cast<streamsize>(m_blockLength));
+    }
+    return m_block.get() + (offset - m_blockOffset);
+}
+
+/*!
+ * \brief Returns the size of the sample with the specified \a sampleIndex.
+ * \throws Throws InvalidDataException if the size of the sample can not be determined.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+std::uint32_t Mp4SampleTable::sampleSize(std::istream &stream, std::uint32_t sampleIndex)
+{
+    if (m_constantSampleSize) {
+        return m_constantSampleSize;
+    }
+    if (sampleIndex >= m_sampleSizeCount) {
+        throw InvalidDataException();
+    }
+    const auto tableEnd = m_sampleSizeOffset + (static_cast<std::uint64_t>(m_sampleSizeCount) * m_fieldSize + 7) / 8;
+    switch (m_fieldSize) {
+    case 4: {
+        const auto byte = static_cast<std::uint8_t>(*read(stream, m_sampleSizeOffset + sampleIndex / 2, 1, tableEnd));
+        return sampleIndex % 2 ? (byte & 0x0F) : (byte >> 4);
+    }
+    case 8:
+        return static_cast<std::uint8_t>(*read(stream, m_sampleSizeOffset + sampleIndex, 1, tableEnd));
+    case 16:
+        return BE::toUInt16(read(stream, m_sampleSizeOffset + static_cast<std::uint64_t>(sampleIndex) * 2, 2, tableEnd));
+    default:
+        return BE::toUInt32(read(stream, m_sampleSizeOffset + static_cast<std::uint64_t>(sampleIndex) * 4, 4, tableEnd));
+    }
+}
+
+/*!
+ * \brief Returns the total size of \a count samples starting at \a firstSampleIndex.
+ * \throws Throws InvalidDataException if the size of a sample can not be determined (see hasSampleSizes()).
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+std::uint64_t Mp4SampleTable::accumulateSampleSizes(std::istream &stream, std::uint32_t firstSampleIndex, std::uint32_t count)
+{
+    if (m_constantSampleSize) {
+        return static_cast<std::uint64_t>(m_constantSampleSize) * count;
+    }
+    if (!hasSampleSizes(firstSampleIndex, count)) {
+        throw InvalidDataException();
+    }
+    std::uint64_t sum = 0;
+    if (m_fieldSize == 4) {
+        for (std::uint32_t sampleIndex = firstSampleIndex, end = firstSampleIndex + count; sampleIndex != end; ++sampleIndex) {
+            sum += sampleSize(stream, sampleIndex);
+        }
+        return sum;
+    }
+    // sum the sizes block by block
+    const auto bytesPerSample = static_cast<std::size_t>(m_fieldSize / 8);
+    const auto tableEnd = m_sampleSizeOffset + static_cast<std::uint64_t>(m_sampleSizeCount) * bytesPerSample;
+    for (auto sampleIndex = static_cast<std::uint64_t>(firstSampleIndex); count;) {
+        const auto samplesInBlock = static_cast<std::uint32_t>(min<std::size_t>(count, blockSize / bytesPerSample));
+        const auto *const data = read(stream, m_sampleSizeOffset + sampleIndex * bytesPerSample, samplesInBlock * bytesPerSample, tableEnd);
+        switch (m_fieldSize) {
+        case 8:
+            sum += sumSampleSizes<8>(data, samplesInBlock);
+            break;
+        case 16:
+            sum += sumSampleSizes<16>(data, samplesInBlock);
+            break;
+        default:
+            sum += sumSampleSizes<32>(data, samplesInBlock);
+        }
+        sampleIndex += samplesInBlock;
+        count -= samplesInBlock;
+    }
+    return sum;
+}
+
+/*!
+ * \brief Appends the sizes of \a chunkCount chunks of \a samplesPerChunk samples each to \a chunkSizes.
+ * \param firstSampleIndex Specifies the index of the first sample of the first chunk.
+ * \remarks This expands one entry of the "stsc"-atom. If all samples have the same size no sample sizes need to be read.
+ * \throws Throws InvalidDataException if the size of a sample can not be determined (see hasSampleSizes()).
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+void Mp4SampleTable::addChunkSizes(std::istream &stream, std::vector<std::uint64_t> &chunkSizes, std::uint32_t firstSampleIndex,
+    std::uint32_t chunkCount, std::uint32_t samplesPerChunk)
+{
+    if (m_constantSampleSize) {
+        chunkSizes.insert(chunkSizes.end(), chunkCount, static_cast<std::uint64_t>(m_constantSampleSize) * samplesPerChunk);
+        return;
+    }
+    if (!hasSampleSizes(firstSampleIndex, static_cast<std::uint64_t>(chunkCount) * samplesPerChunk)) {
+        throw InvalidDataException();
+    }
+    for (; chunkCount; --chunkCount, firstSampleIndex += samplesPerChunk) {
+        chunkSizes.push_back(accumulateSampleSizes(stream, firstSampleIndex, samplesPerChunk));
+    }
+}
+
+/*!
+ * \brief Returns the index of the chunk containing the sample with the specified \a sampleIndex.
+ * \remarks Unlike within the "stsc"-atom the index of the first chunk is zero.
+ * \throws Throws InvalidDataException if the "stsc"-atom does not cover the sample.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+std::uint32_t Mp4SampleTable::chunkIndex(std::istream &stream, std::uint32_t sampleIndex)
+{
+    const auto tableEnd = m_sampleToChunkOffset + static_cast<std::uint64_t>(m_sampleToChunkEntryCount) * 12;
+    if (sampleIndex < m_sampleToChunkFirstSample) {
+        m_sampleToChunkEntry = 0;
+        m_sampleToChunkFirstSample = 0;
+    }
+    for (; m_sampleToChunkEntry < m_sampleToChunkEntryCount; ++m_sampleToChunkEntry) {
+        const auto entryOffset = m_sampleToChunkOffset + static_cast<std::uint64_t>(m_sampleToChunkEntry) * 12;
+        const auto *const entry = read(stream, entryOffset, 8, tableEnd);
+        const auto firstChunk = BE::toUInt32(entry);
+        const auto samplesPerChunk = BE::toUInt32(entry + 4);
+        const auto nextFirstChunk = m_sampleToChunkEntry + 1 < m_sampleToChunkEntryCount
+            ? BE::toUInt32(read(stream, entryOffset + 12, 4, tableEnd))
+            : m_chunkCount + 1;
+        const auto entrySampleCount
+            = nextFirstChunk > firstChunk ? static_cast<std::uint64_t>(nextFirstChunk - firstChunk) * samplesPerChunk : std::uint64_t(0);
+        if (sampleIndex < m_sampleToChunkFirstSample + entrySampleCount) {
+            return firstChunk - 1 + static_cast<std::uint32_t>((sampleIndex - m_sampleToChunkFirstSample) / samplesPerChunk);
+        }
+        m_sampleToChunkFirstSample += entrySampleCount;
+    }
+    throw InvalidDataException();
+}
+
+/*!
+ * \brief Returns the decoding time of the sample with the specified \a sampleIndex in the time scale of the track.
+ * \throws Throws InvalidDataException if the "stts"-atom does not cover the sample.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+std::uint64_t Mp4SampleTable::decodingTime(std::istream &stream, std::uint32_t sampleIndex)
+{
+    const auto tableEnd = m_timeToSampleOffset + static_cast<std::uint64_t>(m_timeToSampleEntryCount) * 8;
+    if (sampleIndex < m_timeToSampleFirstSample) {
+        m_timeToSampleEntry = 0;
+        m_timeToSampleFirstSample = m_timeToSampleFirstTime = 0;
+    }
+    for (; m_timeToSampleEntry < m_timeToSampleEntryCount; ++m_timeToSampleEntry) {
+        const auto *const entry = read(stream, m_timeToSampleOffset + static_cast<std::uint64_t>(m_timeToSampleEntry) * 8, 8, tableEnd);
+        const auto entrySampleCount = BE::toUInt32(entry);
+        const auto sampleDelta = BE::toUInt32(entry + 4);
+        if (sampleIndex < m_timeToSampleFirstSample + entrySampleCount) {
+            return m_timeToSampleFirstTime + (sampleIndex - m_timeToSampleFirstSample) * sampleDelta;
+        }
+        m_timeToSampleFirstSample += entrySampleCount;
+        m_timeToSampleFirstTime += static_cast<std::uint64_t>(entrySampleCount) * sampleDelta;
+    }
+    throw InvalidDataException();
+}
+
+/*!
+ * \brief Returns the maximum number of bytes the samples decoded within one window of \a windowDuration take.
+ *
+ * The decoding time line is divided into consecutive windows of \a windowDuration (in the time scale of the track)
+ * starting at zero. The samples of each run of the "stts"-atom are summed up window by window so no sample needs to be
+ * visited individually unless the sizes are stored in the 4-bit format.
+ *
+ * \remarks This only reads the "stts"- and "stsz"/"stz2"-atoms; the media data is not accessed. The entries of the
+ *          "stts"-atom are read in blocks into a separate buffer so reading the sample sizes does not evict them.
+ * \throws Throws InvalidDataException if the size of a sample can not be determined (see hasSampleSizes()) or if
+ *          \a windowDuration is zero.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+std::uint64_t Mp4SampleTable::peakWindowSize(std::istream &stream, std::uint64_t windowDuration)
+{
+    if (!windowDuration) {
+        throw InvalidDataException();
+    }
+    constexpr auto entriesPerBlock = blockSize / 8;
+    auto entries = make_unique<char[]>(blockSize);
+    std::uint64_t peak = 0, windowSum = 0, windowEnd = windowDuration, time = 0;
+    std::uint32_t sampleIndex = 0;
+    for (std::uint32_t entryIndex = 0; entryIndex < m_timeToSampleEntryCount && sampleIndex < m_sampleCount;) {
+        const auto entryCount = static_cast<std::uint32_t>(min<std::uint64_t>(entriesPerBlock, m_timeToSampleEntryCount - entryIndex));
+        stream.seekg(static_cast<streamoff>(m_timeToSampleOffset + static_cast<std::uint64_t>(entryIndex) * 8));
+        stream.read(entries.get(), static_cast<streamsize>(entryCount * 8));
+        for (const auto *entry = entries.get(), *end = entry + entryCount * 8; entry != end && sampleIndex < m_sampleCount; entry += 8) {
+            auto remainingSamples = min(BE::toUInt32(entry), m_sampleCount - sampleIndex);
+            const auto sampleDelta = BE::toUInt32(entry + 4);
+            while (remainingSamples) {
+                if (time >= windowEnd) {
+                    peak = max(peak, windowSum);
+                    windowSum = 0;
+                    windowEnd = (time / windowDuration + 1) * windowDuration;
+                }
+                // take all samples of the run which are decoded before the end of the current window
+                const auto samplesInWindow = sampleDelta
+                    ? static_cast<std::uint32_t>(min<std::uint64_t>(remainingSamples, (windowEnd - time + sampleDelta - 1) / sampleDelta))
+                    : remainingSamples;
+                windowSum += accumulateSampleSizes(stream, sampleIndex, samplesInWindow);
+                sampleIndex += samplesInWindow;
+                remainingSamples -= samplesInWindow;
+                time += static_cast<std::uint64_t>(samplesInWindow) * sampleDelta;
+            }
+        }
+        entryIndex += entryCount;
+    }
+    return max(peak, windowSum);
+}
+
+/*!
+ * \brief Returns the number of samples covered by the "stsc"-atom considering the number of chunks denoted by the
+ *        "stco"/"co64"-atom.
+ * \remarks Entries whose first chunk is not greater than the first chunk of the previous entry do not cover any samples.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+std::uint64_t Mp4SampleTable::sampleToChunkSampleCount(std::istream &stream)
+{
+    const auto tableEnd = m_sampleToChunkOffset + static_cast<std::uint64_t>(m_sampleToChunkEntryCount) * 12;
+    std::uint64_t sampleCount = 0;
+    for (std::uint32_t entryIndex = 0; entryIndex < m_sampleToChunkEntryCount; ++entryIndex) {
+        const auto entryOffset = m_sampleToChunkOffset + static_cast<std::uint64_t>(entryIndex) * 12;
+        const auto *const entry = read(stream, entryOffset, 8, tableEnd);
+        const auto firstChunk = BE::toUInt32(entry);
+        const auto samplesPerChunk = BE::toUInt32(entry + 4);
+        const auto nextFirstChunk
+            = entryIndex + 1 < m_sampleToChunkEntryCount ? BE::toUInt32(read(stream, entryOffset + 12, 4, tableEnd)) : m_chunkCount + 1;
+        if (nextFirstChunk > firstChunk) {
+            sampleCount += static_cast<std::uint64_t>(nextFirstChunk - firstChunk) * samplesPerChunk;
+        }
+    }
+    return sampleCount;
+}
+
+/*!
+ * \brief Returns the number of samples covered by the "stts"-atom.
+ * \remarks The entries are summed up block by block.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+std::uint64_t Mp4SampleTable::timeToSampleSampleCount(std::istream &stream)
+{
+    constexpr auto entriesPerBlock = blockSize / 8;
+    const auto tableEnd = m_timeToSampleOffset + static_cast<std::uint64_t>(m_timeToSampleEntryCount) * 8;
+    std::uint64_t sampleCount = 0;
+    for (std::uint32_t entryIndex = 0; entryIndex < m_timeToSampleEntryCount;) {
+        const auto entryCount = static_cast<std::uint32_t>(min<std::uint64_t>(entriesPerBlock, m_timeToSampleEntryCount - entryIndex));
+        const auto *const entries = read(stream, m_timeToSampleOffset + static_cast<std::uint64_t>(entryIndex) * 8, entryCount * 8, tableEnd);
+        sampleCount += sumTimeToSampleCounts(entries, entryCount);
+        entryIndex += entryCount;
+    }
+    return sampleCount;
+}
+
+} // namespace TagParser
@@ -0,0 +1,102 @@
+#ifndef TAG_PARSER_MP4SAMPLETABLE_H
+#define TAG_PARSER_MP4SAMPLETABLE_H
+
+#include "../global.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <vector>
+
+namespace TagParser {
+
+class Mp4Atom;
+class Diagnostics;
+
+class TAG_PARSER_EXPORT Mp4SampleTable {
+public:
+    Mp4SampleTable();
+
+    void parse(std::istream &stream, Mp4Atom *sampleSizeAtom, Mp4Atom *sampleToChunkAtom, Mp4Atom *timeToSampleAtom, std::uint32_t chunkCount,
+        Diagnostics &diag);
+
+    std::uint32_t sampleCount() const;
+    std::uint32_t sampleSizeCount() const;
+    std::uint32_t constantSampleSize() const;
+    bool hasSampleSizes(std::uint64_t firstSampleIndex, std::uint64_t count) const;
+    std::uint32_t sampleSize(std::istream &stream, std::uint32_t sampleIndex);
+    std::uint64_t accumulateSampleSizes(std::istream &stream, std::uint32_t firstSampleIndex, std::uint32_t count);
+    void addChunkSizes(std::istream &stream, std::vector<std::uint64_t> &chunkSizes, std::uint32_t firstSampleIndex, std::uint32_t chunkCount,
+        std::uint32_t samplesPerChunk);
+    std::uint32_t chunkIndex(std::istream &stream, std::uint32_t sampleIndex);
+    std::uint64_t decodingTime(std::istream &stream, std::uint32_t sampleIndex);
+    std::uint64_t peakWindowSize(std::istream &stream, std::uint64_t windowDuration);
+    std::uint64_t sampleToChunkSampleCount(std::istream &stream);
+    std::uint64_t timeToSampleSampleCount(std::istream &stream);
+
+    /// \brief The size of the block of the tables which is buffered to speed up accessing consecutive entries.
+    static constexpr std::size_t blockSize = 0x1000;
+
+private:
+    const char *read(std::istream &stream, std::uint64_t offset, std::size_t size, std::uint64_t tableEnd);
+
+    std::uint64_t m_sampleSizeOffset;
+    std::uint32_t m_sampleCount;
+    std::uint32_t m_sampleSizeCount;
+    std::uint32_t m_constantSampleSize;
+    std::uint8_t m_fieldSize;
+
+    std::uint64_t m_sampleToChunkOffset;
+    std::uint32_t m_sampleToChunkEntryCount;
+    std::uint32_t m_chunkCount;
+    std::uint32_t m_sampleToChunkEntry;
+    std::uint64_t m_sampleToChunkFirstSample;
+
+    std::uint64_t m_timeToSampleOffset;
+    std::uint32_t m_timeToSampleEntryCount;
+    std::uint32_t m_timeToSampleEntry;
+    std::uint64_t m_timeToSampleFirstSample;
+    std::uint64_t m_timeToSampleFirstTime;
+
+    std::unique_ptr<char[]> m_block;
+    std::uint64_t m_blockOffset;
+    std::size_t m_blockLength;
+};
+
+/*!
+ * \brief Returns the number of samples denoted by the "stsz"/"stz2"-atom.
+ */
+inline std::uint32_t Mp4SampleTable::sampleCount() const
+{
+    return m_sampleCount;
+}
+
+/*!
+ * \brief Returns the number of samples whose size can be determined.
+ * \remarks This is less than sampleCount() if the "stsz"/"stz2"-atom is truncated.
+ */
+inline std::uint32_t Mp4SampleTable::sampleSizeCount() const
+{
+    return m_sampleSizeCount;
+}
+
+/*!
+ * \brief Returns the size all samples have or zero if the samples have different sizes.
+ */
+inline std::uint32_t Mp4SampleTable::constantSampleSize() const
+{
+    return m_constantSampleSize;
+}
+
+/*!
+ * \brief Returns whether the sizes of \a count samples starting at \a firstSampleIndex can be determined.
+ * \remarks If all samples have the same size any number of samples is considered valid.
+ */
+inline bool Mp4SampleTable::hasSampleSizes(std::uint64_t firstSampleIndex, std::uint64_t count) const
+{
+    return m_constantSampleSize || firstSampleIndex + count <= m_sampleSizeCount;
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_MP4SAMPLETABLE_H
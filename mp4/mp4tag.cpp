@@ -4,15 +4,52 @@
 #include "./mp4ids.h"
 
 #include "../exceptions.h"
+#include "../perfecthashmap.h"
+#include "../tagfieldfilter.h"
+#include "../tagtemplate.h"
 
 #include <c++utilities/conversion/stringconversion.h>
 #include <c++utilities/io/binarywriter.h>
 
+#include <algorithm>
+#include <memory>
+
 using namespace std;
 using namespace CppUtilities;
 
 namespace TagParser {
 
+namespace {
+
+/// \brief The IDs of the children of the "ilst"-atom and the known fields they are mapped to.
+constexpr std::pair<std::uint32_t, KnownField> atomIdsAndKnownFields[] = {
+    { Mp4TagAtomIds::Album, KnownField::Album },
+    { Mp4TagAtomIds::Artist, KnownField::Artist },
+    { Mp4TagAtomIds::Comment, KnownField::Comment },
+    { Mp4TagAtomIds::Year, KnownField::RecordDate },
+    { Mp4TagAtomIds::Title, KnownField::Title },
+    { Mp4TagAtomIds::PreDefinedGenre, KnownField::Genre },
+    { Mp4TagAtomIds::Genre, KnownField::Genre },
+    { Mp4TagAtomIds::TrackPosition, KnownField::TrackPosition },
+    { Mp4TagAtomIds::DiskPosition, KnownField::DiskPosition },
+    { Mp4TagAtomIds::Composer, KnownField::Composer },
+    { Mp4TagAtomIds::Encoder, KnownField::Encoder },
+    { Mp4TagAtomIds::Bpm, KnownField::Bpm },
+    { Mp4TagAtomIds::Cover, KnownField::Cover },
+    { Mp4TagAtomIds::Rating, KnownField::Rating },
+    { Mp4TagAtomIds::Grouping, KnownField::Grouping },
+    { Mp4TagAtomIds::Description, KnownField::Description },
+    { Mp4TagAtomIds::Lyrics, KnownField::Lyrics },
+    { Mp4TagAtomIds::RecordLabel, KnownField::RecordLabel },
+    { Mp4TagAtomIds::Performers, KnownField::Performers },
+    { Mp4TagAtomIds::Lyricist, KnownField::Lyricist },
+    { Mp4TagAtomIds::AlbumArtist, KnownField::AlbumArtist },
+};
+constexpr auto knownFieldsByAtomId = makePerfectHashMap(atomIdsAndKnownFields, KnownField::Invalid);
+static_assert(knownFieldsByAtomId.isPerfect(), "atom IDs must be unique");
+
+} // namespace
+
 /*!
  * \class TagParser::Mp4ExtendedFieldId
  * \brief The Mp4ExtendedFieldId specifies parameter for an extended field denoted via Mp4TagAtomIds::Extended.
@@ -169,53 +206,8 @@ Mp4Tag::IdentifierType Mp4Tag::internallyGetFieldId(KnownField field) const
 
 KnownField Mp4Tag::internallyGetKnownField(const IdentifierType &id) const
 {
-    using namespace Mp4TagAtomIds;
-    switch (id) {
-    case Album:
-        return KnownField::Album;
-    case Artist:
-        return KnownField::Artist;
-    case Comment:
-        return KnownField::Comment;
-    case Year:
-        return KnownField::RecordDate;
-    case Title:
-        return KnownField::Title;
-    case PreDefinedGenre:
-    case Genre:
-        return KnownField::Genre;
-    case TrackPosition:
-        return KnownField::TrackPosition;
-    case DiskPosition:
-        return KnownField::DiskPosition;
-    case Composer:
-        return KnownField::Composer;
-    case Encoder:
-        return KnownField::Encoder;
-    case Bpm:
-        return KnownField::Bpm;
-    case Cover:
-        return KnownField::Cover;
-    case Rating:
-        return KnownField::Rating;
-    case Grouping:
-        return KnownField::Grouping;
-    case Description:
-        return KnownField::Description;
-    case Lyrics:
-        return KnownField::Lyrics;
-    case RecordLabel:
-        return KnownField::RecordLabel;
-    case Performers:
-        return KnownField::Performers;
-    case Lyricist:
-        return KnownField::Lyricist;
-    case AlbumArtist:
-        return KnownField::AlbumArtist;
-    default:
-        return KnownField::Invalid;
-    }
-    // do not forget to extend Mp4Tag::internallyGetFieldId() and Mp4TagField::appropriateRawDataType() as well
+    // do not forget to extend atomIdsAndKnownFields, Mp4Tag::internallyGetFieldId() and Mp4TagField::appropriateRawDataType() as well
+    return knownFieldsByAtomId.find(id);
 }
 
 bool Mp4Tag::setValue(KnownField field, const TagValue &value)
@@ -224,10 +216,14 @@ bool Mp4Tag::setValue(KnownField field, const TagValue &value)
     case KnownField::Genre:
         switch (value.type()) {
         case TagDataType::StandardGenreIndex:
-            fields().erase(Mp4TagAtomIds::Genre);
+            if (static_cast<const Mp4Tag *>(this)->fields().count(Mp4TagAtomIds::Genre)) {
+                fields().erase(Mp4TagAtomIds::Genre);
+            }
             return FieldMapBasedTag<Mp4Tag>::setValue(Mp4TagAtomIds::PreDefinedGenre, value);
         default:
-            fields().erase(Mp4TagAtomIds::PreDefinedGenre);
+            if (static_cast<const Mp4Tag *>(this)->fields().count(Mp4TagAtomIds::PreDefinedGenre)) {
+                fields().erase(Mp4TagAtomIds::PreDefinedGenre);
+            }
             return FieldMapBasedTag<Mp4Tag>::setValue(Mp4TagAtomIds::Genre, value);
         }
     case KnownField::EncoderSettings:
@@ -242,6 +238,21 @@ bool Mp4Tag::setValue(KnownField field, const TagValue &value)
     }
 }
 
+/*!
+ * \brief Uses setValue() for fields which need special handling and the default implementation otherwise.
+ */
+bool Mp4Tag::internallyAssignValue(KnownField field, TagValue &&value)
+{
+    switch (field) {
+    case KnownField::Genre:
+    case KnownField::EncoderSettings:
+    case KnownField::RecordLabel:
+        return setValue(field, value);
+    default:
+        return CRTPBase::internallyAssignValue(field, std::move(value));
+    }
+}
+
 bool Mp4Tag::setValues(KnownField field, const std::vector<TagValue> &values)
 {
     const Mp4ExtendedFieldId extendedId(field);
@@ -259,15 +270,15 @@ bool Mp4Tag::setValues(KnownField field, const std::vector<TagValue> &values)
                 ++valuesIterator;
             }
         }
+        for (; range.first != range.second; ++range.first) {
+            range.first->second.setValue(TagValue());
+        }
         for (; valuesIterator != values.cend(); ++valuesIterator) {
             Mp4TagField tagField(Mp4TagAtomIds::Extended, *valuesIterator);
             tagField.setMean(extendedId.mean);
             tagField.setName(extendedId.name);
             fields().insert(std::make_pair(Mp4TagAtomIds::Extended, move(tagField)));
         }
-        for (; range.first != range.second; ++range.first) {
-            range.first->second.setValue(TagValue());
-        }
     }
     return FieldMapBasedTag<Mp4Tag>::setValues(field, values);
 }
@@ -281,6 +292,9 @@ bool Mp4Tag::setValues(KnownField field, const std::vector<TagValue> &values)
  */
 bool Mp4Tag::setValue(const char *mean, const char *name, const TagValue &value)
 {
+    if (this->value(mean, name).isIdentical(value)) {
+        return true;
+    }
     auto range = fields().equal_range(Mp4TagAtomIds::Extended);
     for (auto i = range.first; i != range.second; ++i) {
         if (i->second.mean() == mean && i->second.name() == name) {
@@ -305,11 +319,15 @@ bool Mp4Tag::hasField(KnownField field) const
 /*!
  * \brief Parses tag information from the specified \a metaAtom.
  *
+ * If \a filter is specified, children of the "ilst"-atom it does not include are skipped without reading their data.
+ * Extended fields (denoted via Mp4TagAtomIds::Extended) are always read because their mean and name need to be read
+ * to identify them anyways.
+ *
  * \throws Throws std::ios_base::failure when an IO error occurs.
  * \throws Throws TagParser::Failure or a derived exception when a parsing
  *         error occurs.
  */
-void Mp4Tag::parse(Mp4Atom &metaAtom, Diagnostics &diag)
+void Mp4Tag::parse(Mp4Atom &metaAtom, Diagnostics &diag, const TagFieldFilter *filter)
 {
     static const string context("parsing MP4 tag");
     istream &stream = metaAtom.container().stream();
@@ -358,6 +376,9 @@ void Mp4Tag::parse(Mp4Atom &metaAtom, Diagnostics &diag)
         Mp4TagField tagField;
         try {
             child->parse(diag);
+            if (filter && child->id() != Mp4TagAtomIds::Extended && !filter->includes(knownField(child->id()), child->id())) {
+                continue;
+            }
             tagField.reparse(*child, diag);
             fields().emplace(child->id(), move(tagField));
         } catch (const Failure &) {
@@ -404,6 +425,7 @@ void Mp4Tag::make(ostream &stream, Diagnostics &diag)
  */
 Mp4TagMaker::Mp4TagMaker(Mp4Tag &tag, Diagnostics &diag)
     : m_tag(tag)
+    , m_templateFields(nullptr)
     ,
     // meta head, hdlr atom
     m_metaSize(8 + 37)
@@ -414,9 +436,28 @@ Mp4TagMaker::Mp4TagMaker(Mp4Tag &tag, Diagnostics &diag)
     // ensure there only one genre atom is written (prefer genre as string)
     m_omitPreDefinedGenre(m_tag.fields().count(m_tag.hasField(Mp4TagAtomIds::Genre)))
 {
+    // take the pre-made fields of the template; fields of the tag which are also present in the template are skipped
+    if (m_tag.tagTemplate()) {
+        m_templateFields = &m_tag.tagTemplate()->serializedFields(TagType::Mp4Tag, 0, diag);
+        for (const auto &field : *m_templateFields) {
+            m_ilstSize += field.data.size();
+        }
+    }
+    const auto isOverriddenByTemplate = [this](std::uint32_t id) {
+        if (!m_templateFields) {
+            return false;
+        }
+        return find_if(m_templateFields->cbegin(), m_templateFields->cend(),
+                   [id](const TagTemplateField &field) {
+                       return field.id == id || (id == Mp4TagAtomIds::PreDefinedGenre && field.id == Mp4TagAtomIds::Genre);
+                   })
+            != m_templateFields->cend();
+    };
+
     m_maker.reserve(m_tag.fields().size());
     for (auto &field : m_tag.fields()) {
-        if (!field.second.value().isEmpty() && (!m_omitPreDefinedGenre || field.first != Mp4TagAtomIds::PreDefinedGenre)) {
+        if (!field.second.value().isEmpty() && (!m_omitPreDefinedGenre || field.first != Mp4TagAtomIds::PreDefinedGenre)
+            && !isOverriddenByTemplate(field.first)) {
             try {
                 m_maker.emplace_back(field.second.prepareMaking(diag));
                 m_ilstSize += m_maker.back().requiredSize();
@@ -441,22 +482,47 @@ Mp4TagMaker::Mp4TagMaker(Mp4Tag &tag, Diagnostics &diag)
  *                throw TagParser::Failure or a derived exception.
  */
 void Mp4TagMaker::make(ostream &stream, Diagnostics &diag)
+{
+    // make the tag in memory to write it at once
+    const auto buffer = make_unique<char[]>(static_cast<std::size_t>(m_metaSize));
+    make(buffer.get(), diag);
+    stream.write(buffer.get(), static_cast<streamsize>(m_metaSize));
+}
+
+/*!
+ * \brief Saves the tag (specified when constructing the object) to the specified \a buffer.
+ *
+ * This avoids the overhead of writing the many small parts of the tag to a stream. The caller can write the
+ * \a buffer at once afterwards.
+ *
+ * \remarks The \a buffer must hold at least requiredSize() bytes.
+ * \throws Throws Assumes the data is already validated and thus does NOT
+ *                throw TagParser::Failure or a derived exception.
+ */
+void Mp4TagMaker::make(char *buffer, Diagnostics &diag)
 {
     // write meta head
-    BinaryWriter writer(&stream);
-    writer.writeUInt32BE(static_cast<std::uint32_t>(m_metaSize));
-    writer.writeUInt32BE(Mp4AtomIds::Meta);
+    BE::getBytes(static_cast<std::uint32_t>(m_metaSize), buffer);
+    BE::getBytes(static_cast<std::uint32_t>(Mp4AtomIds::Meta), buffer + 4);
+    buffer += 8;
     // write hdlr atom
     static const std::uint8_t hdlrData[37] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x21, 0x68, 0x64, 0x6C, 0x72, 0x00, 0x00, 0x00, 0x00, 0x00,
         0x00, 0x00, 0x00, 0x6D, 0x64, 0x69, 0x72, 0x61, 0x70, 0x70, 0x6C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
-    stream.write(reinterpret_cast<const char *>(hdlrData), sizeof(hdlrData));
+    buffer = copy(reinterpret_cast<const char *>(hdlrData), reinterpret_cast<const char *>(hdlrData) + sizeof(hdlrData), buffer);
     if (m_ilstSize != 8) {
         // write ilst head
-        writer.writeUInt32BE(static_cast<std::uint32_t>(m_ilstSize));
-        writer.writeUInt32BE(Mp4AtomIds::ItunesList);
+        BE::getBytes(static_cast<std::uint32_t>(m_ilstSize), buffer);
+        BE::getBytes(static_cast<std::uint32_t>(Mp4AtomIds::ItunesList), buffer + 4);
+        buffer += 8;
         // write fields
         for (auto &maker : m_maker) {
-            maker.make(stream);
+            buffer = maker.make(buffer);
+        }
+        // write pre-made fields of the template
+        if (m_templateFields) {
+            for (const auto &field : *m_templateFields) {
+                buffer = copy(field.data.cbegin(), field.data.cend(), buffer);
+            }
         }
     } else {
         // no fields to be written -> no ilst to be written
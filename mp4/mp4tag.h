@@ -9,6 +9,8 @@ namespace TagParser {
 
 class Mp4Atom;
 class Mp4Tag;
+class TagFieldFilter;
+struct TagTemplateField;
 
 struct TAG_PARSER_EXPORT Mp4ExtendedFieldId {
     Mp4ExtendedFieldId(const char *mean = nullptr, const char *name = nullptr, bool updateOnly = false);
@@ -56,7 +58,9 @@ class TAG_PARSER_EXPORT Mp4TagMaker {
 
 public:
     void make(std::ostream &stream, Diagnostics &diag);
+    void make(char *buffer, Diagnostics &diag);
     const Mp4Tag &tag() const;
+    std::vector<Mp4TagFieldMaker> &fieldMakers();
     std::uint64_t requiredSize() const;
 
 private:
@@ -64,6 +68,7 @@ private:
 
     Mp4Tag &m_tag;
     std::vector<Mp4TagFieldMaker> m_maker;
+    const std::vector<TagTemplateField> *m_templateFields;
     std::uint64_t m_metaSize;
     std::uint64_t m_ilstSize;
     bool m_omitPreDefinedGenre;
@@ -77,6 +82,14 @@ inline const Mp4Tag &Mp4TagMaker::tag() const
     return m_tag;
 }
 
+/*!
+ * \brief Returns the makers of the fields of the tag (excluding the fields of the tag's template).
+ */
+inline std::vector<Mp4TagFieldMaker> &Mp4TagMaker::fieldMakers()
+{
+    return m_maker;
+}
+
 /*!
  * \brief Returns the number of bytes which will be written when making the tag.
  */
@@ -92,6 +105,7 @@ template <> class TAG_PARSER_EXPORT FieldMapBasedTagTraits<Mp4Tag> {
 public:
     using FieldType = Mp4TagField;
     using Compare = std::less<typename FieldType::IdentifierType>;
+    using Storage = FlatMultiMap<typename FieldType::IdentifierType, FieldType, Compare>;
 };
 
 class TAG_PARSER_EXPORT Mp4Tag final : public FieldMapBasedTag<Mp4Tag> {
@@ -122,13 +136,14 @@ public:
     bool hasField(KnownField value) const override;
     bool supportsMultipleValues(KnownField) const override;
 
-    void parse(Mp4Atom &metaAtom, Diagnostics &diag);
+    void parse(Mp4Atom &metaAtom, Diagnostics &diag, const TagFieldFilter *filter = nullptr);
     Mp4TagMaker prepareMaking(Diagnostics &diag);
     void make(std::ostream &stream, Diagnostics &diag);
 
 protected:
     IdentifierType internallyGetFieldId(KnownField field) const;
     KnownField internallyGetKnownField(const IdentifierType &id) const;
+    bool internallyAssignValue(KnownField field, TagValue &&value);
 };
 
 /*!
@@ -3,7 +3,9 @@
 #include "./mp4container.h"
 #include "./mp4ids.h"
 
+#include "../abstractattachment.h"
 #include "../exceptions.h"
+#include "../mediafileinfo.h"
 
 #include <c++utilities/conversion/stringbuilder.h>
 #include <c++utilities/io/binaryreader.h>
@@ -140,6 +142,16 @@ void Mp4TagField::reparse(Mp4Atom &ilstChild, Diagnostics &diag)
                     default:;
                     }
                     const auto coverSize = static_cast<streamoff>(dataAtom->dataSize() - 8);
+                    auto &fileInfo = ilstChild.container().fileInfo();
+                    if (fileInfo.parsingFlags() & ParsingFlags::LazyLoadPictures) {
+                        // read the cover only when accessed
+                        const auto coverOffset = static_cast<streamoff>(dataAtom->dataOffset() + 8);
+                        auto dataBlock = make_shared<StreamDataBlock>([&fileInfo]() -> istream & { return fileInfo.inputStream(); },
+                            coverOffset, ios_base::beg, coverOffset + coverSize, ios_base::beg);
+                        dataBlock->setFilePath([&fileInfo] { return fileInfo.hasByteSource() ? string() : fileInfo.path(); });
+                        value().assignLazyData(dataBlock, TagDataType::Picture);
+                        break;
+                    }
                     auto coverData = make_unique<char[]>(static_cast<size_t>(coverSize));
                     stream.read(coverData.get(), coverSize);
                     value().assignData(move(coverData), static_cast<size_t>(coverSize), TagDataType::Picture);
@@ -608,4 +620,52 @@ void Mp4TagFieldMaker::make(ostream &stream)
     }
 }
 
+/*!
+ * \brief Saves the field (specified when constructing the object) to the specified \a buffer.
+ * \returns Returns a pointer to the end of the written field.
+ * \remarks The \a buffer must hold at least requiredSize() bytes.
+ * \throws Throws Assumes the data is already validated and thus does NOT
+ *                throw TagParser::Failure or a derived exception.
+ */
+char *Mp4TagFieldMaker::make(char *buffer)
+{
+    // writes the header of a child atom with the specified size and ID followed by zero-initialized version and flags
+    const auto makeChildHeader = [&buffer](std::size_t size, std::uint32_t id) {
+        BE::getBytes(static_cast<std::uint32_t>(size), buffer);
+        BE::getBytes(id, buffer + 4);
+        BE::getBytes(std::uint32_t(), buffer + 8);
+        buffer += 12;
+    };
+    // size and id of tag atom
+    BE::getBytes(static_cast<std::uint32_t>(m_totalSize), buffer);
+    BE::getBytes(m_field.id(), buffer + 4);
+    buffer += 8;
+    if (!m_field.mean().empty()) {
+        // write "mean"
+        makeChildHeader(12 + m_field.mean().size(), Mp4AtomIds::Mean);
+        buffer = copy(m_field.mean().cbegin(), m_field.mean().cend(), buffer);
+    }
+    if (!m_field.name().empty()) {
+        // write "name"
+        makeChildHeader(12 + m_field.name().size(), Mp4AtomIds::Name);
+        buffer = copy(m_field.name().cbegin(), m_field.name().cend(), buffer);
+    }
+    if (!m_field.value().isEmpty()) { // write data
+        BE::getBytes(static_cast<std::uint32_t>(16 + m_dataSize), buffer); // size of data atom
+        BE::getBytes(static_cast<std::uint32_t>(Mp4AtomIds::Data), buffer + 4); // id of data atom
+        BE::getBytes(m_rawDataType & 0xFFFFFF, buffer + 8); // version (zero) and raw data type
+        BE::getBytes(m_field.countryIndicator(), buffer + 12);
+        BE::getBytes(m_field.languageIndicator(), buffer + 14);
+        buffer += 16;
+        if (m_convertedData.tellp()) {
+            // write converted data
+            buffer += m_convertedData.rdbuf()->sgetn(buffer, static_cast<streamsize>(m_dataSize));
+        } else {
+            // no conversion was needed, write data directly from tag value
+            buffer = copy(m_field.value().dataPointer(), m_field.value().dataPointer() + m_field.value().dataSize(), buffer);
+        }
+    }
+    return buffer;
+}
+
 } // namespace TagParser
@@ -65,6 +65,7 @@ class TAG_PARSER_EXPORT Mp4TagFieldMaker {
 
 public:
     void make(std::ostream &stream);
+    char *make(char *buffer);
     const Mp4TagField &field() const;
     std::uint64_t requiredSize() const;
 
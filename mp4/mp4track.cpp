@@ -8,10 +8,13 @@
 
 #include "../avc/avcconfiguration.h"
 
+#include "../hevc/hevcconfiguration.h"
+
 #include "../mpegaudio/mpegaudioframe.h"
 #include "../mpegaudio/mpegaudioframestream.h"
 
 #include "../exceptions.h"
+#include "../mediafileinfo.h"
 #include "../mediaformat.h"
 
 #include <c++utilities/conversion/stringbuilder.h>
@@ -19,8 +22,14 @@
 #include <c++utilities/io/binarywriter.h>
 #include <c++utilities/io/bitreader.h>
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <iterator>
+#include <limits>
 #include <locale>
+#include <memory>
+#include <random>
 
 using namespace std;
 using namespace CppUtilities;
@@ -66,8 +75,218 @@ constexpr TrackHeaderInfo::TrackHeaderInfo()
 {
 }
 
-/// \brief Dates within MP4 tracks are expressed as the number of seconds since this date.
-const DateTime startDate = DateTime::fromDate(1904, 1, 1);
+/// \brief Dates within MP4 tracks are expressed as the number of seconds since this date (1904-01-01, given as ticks
+///        because DateTime::fromDate() can not be evaluated at compile-time).
+constexpr auto startDate = DateTime(695055ull * 864000000000ull);
+
+namespace {
+
+/*!
+ * \brief The MdatShift struct holds the original offset of an "mdat"-atom and the distance it has been moved by.
+ * \remarks The struct is only used internally by Mp4Track::updateChunkOffsets().
+ */
+struct MdatShift {
+    std::uint64_t oldOffset;
+    std::int64_t delta;
+};
+
+/*!
+ * \brief Returns the shifts of the "mdat"-atoms with the specified offsets sorted by the original offset.
+ */
+std::vector<MdatShift> makeMdatShifts(const std::vector<std::int64_t> &oldMdatOffsets, const std::vector<std::int64_t> &newMdatOffsets)
+{
+    auto shifts = std::vector<MdatShift>();
+    shifts.reserve(oldMdatOffsets.size());
+    for (std::size_t i = 0, size = oldMdatOffsets.size(); i != size; ++i) {
+        shifts.emplace_back(MdatShift{ static_cast<std::uint64_t>(oldMdatOffsets[i]), newMdatOffsets[i] - oldMdatOffsets[i] });
+    }
+    std::stable_sort(shifts.begin(), shifts.end(), [](const MdatShift &lhs, const MdatShift &rhs) { return lhs.oldOffset < rhs.oldOffset; });
+    return shifts;
+}
+
+/*!
+ * \brief Shifts the big-endian chunk offsets within the specified \a table according to the specified \a shifts.
+ *
+ * Each offset is shifted like the closest "mdat"-atom starting before it. Offsets before the first "mdat"-atom are
+ * not altered. Chunk offsets are usually ascending so the "mdat"-atom of the previous offset is checked first and
+ * the (sorted) \a shifts are only searched when crossing the boundary to another "mdat"-atom.
+ */
+template <typename OffsetType> void shiftChunkOffsets(char *table, std::size_t tableSize, const std::vector<MdatShift> &shifts)
+{
+    const auto shiftsEnd = shifts.cend();
+    auto shift = shiftsEnd, nextShift = shiftsEnd;
+    for (char *entry = table, *const end = table + tableSize; entry != end; entry += sizeof(OffsetType)) {
+        std::uint64_t offset;
+        if constexpr (sizeof(OffsetType) == sizeof(std::uint32_t)) {
+            offset = BE::toUInt32(entry);
+        } else {
+            offset = BE::toUInt64(entry);
+        }
+        if (shift == shiftsEnd || offset <= shift->oldOffset || (nextShift != shiftsEnd && offset > nextShift->oldOffset)) {
+            nextShift = std::lower_bound(shifts.cbegin(), shiftsEnd, offset, [](const MdatShift &mdatShift, std::uint64_t chunkOffset) {
+                return mdatShift.oldOffset < chunkOffset;
+            });
+            if (nextShift == shifts.cbegin()) {
+                shift = shiftsEnd;
+                continue;
+            }
+            shift = nextShift - 1;
+        }
+        BE::getBytes(static_cast<OffsetType>(offset + static_cast<std::uint64_t>(shift->delta)), entry);
+    }
+}
+
+/*!
+ * \brief Returns the name of the specified "chroma_format_idc" used by AVC and HEVC or nullptr if unknown.
+ */
+const char *chromaFormatName(ugolomb chromaFormatIndication)
+{
+    switch (chromaFormatIndication) {
+    case 0:
+        return "monochrome";
+    case 1:
+        return "YUV 4:2:0";
+    case 2:
+        return "YUV 4:2:2";
+    case 3:
+        return "YUV 4:4:4";
+    default:
+        return nullptr;
+    }
+}
+
+/*!
+ * \brief Ensures the sample table of a track may have \a entryCount entries.
+ * \throws Throws InvalidDataException if ParseLimits::maxTableEntries is exceeded.
+ */
+void checkSampleTableSize(AbstractContainer &container, std::uint64_t entryCount, Diagnostics &diag, const std::string &context)
+{
+    if (container.exceedsParseLimit(entryCount, container.parseLimits().maxTableEntries, "number of sample table entries", diag, context)) {
+        throw InvalidDataException();
+    }
+}
+
+/*!
+ * \brief Determines the lowest offset and the highest end offset of \a count chunks.
+ * \returns Returns whether computing an end offset has overflowed.
+ * \remarks The loop is kept trivial so the compiler can vectorize it.
+ */
+bool determineChunkBounds(const std::uint64_t *offsets, const std::uint64_t *sizes, std::size_t count, std::uint64_t &begin, std::uint64_t &end)
+{
+    auto minBegin = numeric_limits<std::uint64_t>::max(), maxEnd = std::uint64_t();
+    auto overflow = false;
+    for (std::size_t i = 0; i != count; ++i) {
+        const auto chunkEnd = offsets[i] + sizes[i];
+        minBegin = min(minBegin, offsets[i]);
+        maxEnd = max(maxEnd, chunkEnd);
+        overflow |= chunkEnd < offsets[i];
+    }
+    begin = minBegin;
+    end = maxEnd;
+    return overflow;
+}
+
+/*!
+ * \brief Returns the specified \a atomData (version, flags and entries) with the header of an atom with the specified \a id.
+ */
+std::string makeCompactedAtom(std::uint32_t id, const std::string &atomData)
+{
+    auto atom = std::string(8, '\0');
+    BE::getBytes(static_cast<std::uint32_t>(8 + atomData.size()), atom.data());
+    BE::getBytes(id, atom.data() + 4);
+    return atom.append(atomData);
+}
+
+/*!
+ * \brief Returns the data of the specified "stts"-atom with consecutive runs of the same sample duration merged.
+ * \returns Returns an empty string if the table is truncated.
+ */
+std::string compactTimeToSampleTable(const std::string &atomData)
+{
+    if (atomData.size() < 8 || BE::toUInt32(atomData.data() + 4) > (atomData.size() - 8) / 8) {
+        return std::string();
+    }
+    const auto entryCount = BE::toUInt32(atomData.data() + 4);
+    auto compacted = atomData.substr(0, 8);
+    std::uint32_t newEntryCount = 0, runSampleCount = 0, runSampleDelta = 0;
+    const auto addRun = [&] {
+        if (runSampleCount) {
+            char entry[8];
+            BE::getBytes(runSampleCount, entry);
+            BE::getBytes(runSampleDelta, entry + 4);
+            compacted.append(entry, sizeof(entry));
+            ++newEntryCount;
+        }
+    };
+    for (const auto *entry = atomData.data() + 8, *end = entry + entryCount * 8; entry != end; entry += 8) {
+        const auto sampleCount = BE::toUInt32(entry), sampleDelta = BE::toUInt32(entry + 4);
+        if (!sampleCount) {
+            continue;
+        }
+        if (runSampleCount && sampleDelta == runSampleDelta && sampleCount <= numeric_limits<std::uint32_t>::max() - runSampleCount) {
+            runSampleCount += sampleCount;
+            continue;
+        }
+        addRun();
+        runSampleCount = sampleCount;
+        runSampleDelta = sampleDelta;
+    }
+    addRun();
+    BE::getBytes(newEntryCount, compacted.data() + 4);
+    return compacted;
+}
+
+/*!
+ * \brief Returns the data of the specified "stsc"-atom without entries that continue the previous entry.
+ * \returns Returns an empty string if the table is truncated.
+ */
+std::string compactSampleToChunkTable(const std::string &atomData)
+{
+    if (atomData.size() < 8 || BE::toUInt32(atomData.data() + 4) > (atomData.size() - 8) / 12) {
+        return std::string();
+    }
+    const auto entryCount = BE::toUInt32(atomData.data() + 4);
+    auto compacted = atomData.substr(0, 8);
+    const char *previousEntry = nullptr;
+    std::uint32_t newEntryCount = 0;
+    for (const auto *entry = atomData.data() + 8, *end = entry + entryCount * 12; entry != end; entry += 12) {
+        // an entry with the same number of samples per chunk and sample description index is redundant
+        if (previousEntry && !memcmp(previousEntry + 4, entry + 4, 8)) {
+            continue;
+        }
+        compacted.append(entry, 12);
+        previousEntry = entry;
+        ++newEntryCount;
+    }
+    BE::getBytes(newEntryCount, compacted.data() + 4);
+    return compacted;
+}
+
+/*!
+ * \brief Returns the data of the specified "stsz"-atom denoting a constant sample size if all samples have the same size.
+ * \returns Returns an empty string if the sizes differ or the table is truncated.
+ */
+std::string compactSampleSizeTable(const std::string &atomData)
+{
+    if (atomData.size() < 12 || BE::toUInt32(atomData.data() + 4)) {
+        return std::string();
+    }
+    const auto sampleCount = BE::toUInt32(atomData.data() + 8);
+    if (!sampleCount || sampleCount > (atomData.size() - 12) / 4) {
+        return std::string();
+    }
+    const auto *const sizes = atomData.data() + 12;
+    for (std::size_t i = 1; i != sampleCount; ++i) {
+        if (memcmp(sizes, sizes + i * 4, 4)) {
+            return std::string();
+        }
+    }
+    auto compacted = atomData.substr(0, 12);
+    compacted.replace(4, 4, sizes, 4);
+    return compacted;
+}
+
+} // namespace
 
 /*!
  * \class Mpeg4AudioSpecificConfig
@@ -141,9 +360,12 @@ Mp4Track::Mp4Track(Mp4Atom &trakAtom)
     , m_stcoAtom(nullptr)
     , m_stszAtom(nullptr)
     , m_framesPerSample(1)
+    , m_sampleSizesLoaded(false)
+    , m_chunkSizesComputed(false)
     , m_chunkOffsetSize(4)
     , m_chunkCount(0)
     , m_sampleToChunkEntryCount(0)
+    , m_chunkOffsetTablePromoted(false)
 {
 }
 
@@ -277,6 +499,7 @@ std::vector<std::uint64_t> Mp4Track::readChunkOffsets(bool parseFragments, Diagn
                                     inputStream().seekg(4, ios_base::cur);
                                 }
                             }
+                            loadSampleSizes(); // the sizes of the samples within fragments are appended
                             for (Mp4Atom *trunAtom = trafAtom->childById(Mp4AtomIds::TrackFragmentRun, diag); trunAtom;
                                  trunAtom = trunAtom->siblingById(Mp4AtomIds::TrackFragmentRun, diag)) {
                                 std::uint32_t calculatedDataSize = 8;
@@ -317,6 +540,10 @@ std::vector<std::uint64_t> Mp4Track::readChunkOffsets(bool parseFragments, Diagn
                                         if (flags & 0x000004) { // first-sample-flags present
                                             inputStream().seekg(4, ios_base::cur);
                                         }
+                                        if (flags & 0x000200) { // sample-size present
+                                            checkSampleTableSize(m_trakAtom->container(), m_sampleSizes.size() + sampleCount, diag, context);
+                                            m_trakAtom->container().accountMemory(static_cast<std::uint64_t>(sampleCount) * sizeof(std::uint32_t));
+                                        }
                                         for (std::uint32_t i = 0; i < sampleCount; ++i) {
                                             if (flags & 0x000100) { // sample-duration present
                                                 totalDuration += reader().readUInt32BE();
@@ -352,23 +579,38 @@ std::vector<std::uint64_t> Mp4Track::readChunkOffsets(bool parseFragments, Diagn
 }
 
 /*!
- * \brief Accumulates \a count sample sizes from the specified \a sampleSizeTable starting at the specified \a sampleIndex.
- * \remarks This helper function is used by the addChunkSizeEntries() method.
+ * \brief Returns the sample size table for the track.
+ * \remarks
+ * - If the table contains only one size this is the constant sample size.
+ * - The table is loaded when calling this method the first time so the input stream must still be available. When
+ *   parsing the track only the total size is determined. Use sampleTable() to access sample sizes by index without
+ *   loading the table.
  */
-std::uint64_t Mp4Track::accumulateSampleSizes(size_t &sampleIndex, size_t count, Diagnostics &diag)
+const std::vector<std::uint32_t> &Mp4Track::sampleSizes() const
 {
-    if (sampleIndex + count <= m_sampleSizes.size()) {
-        std::uint64_t sum = 0;
-        for (size_t end = sampleIndex + count; sampleIndex < end; ++sampleIndex) {
-            sum += m_sampleSizes[sampleIndex];
-        }
-        return sum;
-    } else if (m_sampleSizes.size() == 1) {
-        sampleIndex += count;
-        return static_cast<std::uint64_t>(m_sampleSizes.front()) * count;
-    } else {
-        diag.emplace_back(DiagLevel::Critical, "There are not as many sample size entries as samples.", "reading chunk sizes of MP4 track");
-        throw InvalidDataException();
+    loadSampleSizes();
+    return m_sampleSizes;
+}
+
+/*!
+ * \brief Loads the sample sizes from the sample table into m_sampleSizes if not done yet.
+ * \remarks Sample sizes within fragments are appended when parsing so this needs to be called before.
+ */
+void Mp4Track::loadSampleSizes() const
+{
+    if (m_sampleSizesLoaded || !m_istream) {
+        return;
+    }
+    m_sampleSizesLoaded = true;
+    if (const auto constantSampleSize = m_sampleTable.constantSampleSize()) {
+        m_sampleSizes.push_back(constantSampleSize);
+        return;
+    }
+    const auto sampleSizeCount = m_sampleTable.sampleSizeCount();
+    m_trakAtom->container().accountMemory(static_cast<std::uint64_t>(sampleSizeCount) * sizeof(std::uint32_t));
+    m_sampleSizes.reserve(m_sampleSizes.size() + sampleSizeCount);
+    for (std::uint32_t sampleIndex = 0; sampleIndex != sampleSizeCount; ++sampleIndex) {
+        m_sampleSizes.push_back(m_sampleTable.sampleSize(*m_istream, sampleIndex));
     }
 }
 
@@ -376,16 +618,20 @@ std::uint64_t Mp4Track::accumulateSampleSizes(size_t &sampleIndex, size_t count,
  * \brief Adds chunks size entries to the specified \a chunkSizeTable.
  * \param chunkSizeTable Specifies the chunk size table. The chunks sizes will be added to this table.
  * \param count Specifies the number of chunks to be added. The size of \a chunkSizeTable is increased this value.
- * \param sampleIndex Specifies the index of the first sample in the \a sampleSizeTable; is increased by \a count * \a sampleCount.
- * \param sampleSizeTable Specifies the table holding the sample sizes.
+ * \param sampleIndex Specifies the index of the first sample of the first chunk; is increased by \a count * \a sampleCount.
+ * \param sampleCount Specifies the number of samples per chunk.
  * \remarks This helper function is used by the readChunkSizes() method.
  */
 void Mp4Track::addChunkSizeEntries(
     std::vector<std::uint64_t> &chunkSizeTable, size_t count, size_t &sampleIndex, std::uint32_t sampleCount, Diagnostics &diag)
 {
-    for (size_t i = 0; i < count; ++i) {
-        chunkSizeTable.push_back(accumulateSampleSizes(sampleIndex, sampleCount, diag));
+    if (!m_sampleTable.hasSampleSizes(sampleIndex, static_cast<std::uint64_t>(count) * sampleCount)) {
+        diag.emplace_back(DiagLevel::Critical, "There are not as many sample size entries as samples.", "reading chunk sizes of MP4 track");
+        throw InvalidDataException();
     }
+    m_sampleTable.addChunkSizes(
+        *m_istream, chunkSizeTable, static_cast<std::uint32_t>(sampleIndex), static_cast<std::uint32_t>(count), sampleCount);
+    sampleIndex += count * sampleCount;
 }
 
 /*!
@@ -495,6 +741,9 @@ vector<tuple<std::uint32_t, std::uint32_t, std::uint32_t>> Mp4Track::readSampleT
  * \brief Reads the chunk sizes from the stsz (sample sizes) and stsc (samples per chunk) atom.
  * \returns Returns the chunk sizes for the track.
  *
+ * Each entry of the stsc atom is expanded in one go summing the sample sizes block by block (see
+ * Mp4SampleTable::addChunkSizes()). The chunk sizes are cached so subsequent calls don't read the tables again.
+ *
  * \throws Throws InvalidDataException when
  *          - there is no stream assigned.
  *          - the header has been considered as invalid when parsing the header information.
@@ -510,10 +759,15 @@ vector<std::uint64_t> Mp4Track::readChunkSizes(Diagnostics &diag)
         diag.emplace_back(DiagLevel::Critical, "Track has not been parsed or is invalid.", context);
         throw InvalidDataException();
     }
+    // return chunk sizes computed before
+    if (m_chunkSizesComputed) {
+        return m_chunkSizes;
+    }
     // read sample to chunk table
     const auto sampleToChunkTable = readSampleToChunkTable(diag);
     // accumulate chunk sizes from the table
-    vector<std::uint64_t> chunkSizes;
+    auto &chunkSizes = m_chunkSizes;
+    chunkSizes.clear();
     if (!sampleToChunkTable.empty()) {
         // prepare reading
         auto tableIterator = sampleToChunkTable.cbegin();
@@ -546,9 +800,381 @@ vector<std::uint64_t> Mp4Track::readChunkSizes(Diagnostics &diag)
             addChunkSizeEntries(chunkSizes, m_chunkCount + 1 - previousChunkIndex, sampleIndex, samplesPerChunk, diag);
         }
     }
+    m_chunkSizesComputed = true;
     return chunkSizes;
 }
 
+/*!
+ * \brief Reads the decoding times of the first sample of each chunk.
+ * \returns Returns the decoding times in the time scale of the track (see timeScale()).
+ * \remarks The times are determined from the "stsc"-atom and the "stts"-atom.
+ * \throws Throws InvalidDataException when the tables are invalid or do not cover all chunks.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+vector<std::uint64_t> Mp4Track::readChunkDecodingTimes(Diagnostics &diag)
+{
+    static const string context("reading chunk decoding times of MP4 track");
+    if (!isHeaderValid() || !m_istream || !m_stcoAtom) {
+        diag.emplace_back(DiagLevel::Critical, "Track has not been parsed or is invalid.", context);
+        throw InvalidDataException();
+    }
+    const auto sampleToChunkTable = readSampleToChunkTable(diag);
+    auto decodingTimes = vector<std::uint64_t>();
+    decodingTimes.reserve(m_chunkCount);
+    auto sampleIndex = std::uint64_t();
+    for (auto entry = sampleToChunkTable.cbegin(), end = sampleToChunkTable.cend(); entry != end; ++entry) {
+        const auto firstChunkIndex = get<0>(*entry);
+        const auto nextFirstChunkIndex = entry + 1 != end ? get<0>(*(entry + 1)) : m_chunkCount + 1;
+        const auto samplesPerChunk = get<1>(*entry);
+        if (firstChunkIndex != decodingTimes.size() + 1 || nextFirstChunkIndex <= firstChunkIndex || nextFirstChunkIndex > m_chunkCount + 1) {
+            diag.emplace_back(DiagLevel::Critical, "The \"sample to chunk\" table does not cover the chunks consecutively.", context);
+            throw InvalidDataException();
+        }
+        for (auto chunkIndex = firstChunkIndex; chunkIndex != nextFirstChunkIndex; ++chunkIndex, sampleIndex += samplesPerChunk) {
+            if (sampleIndex >= m_sampleTable.sampleCount()) {
+                diag.emplace_back(DiagLevel::Critical, "The \"sample to chunk\" table refers to more samples than the track has.", context);
+                throw InvalidDataException();
+            }
+            decodingTimes.emplace_back(m_sampleTable.decodingTime(*m_istream, static_cast<std::uint32_t>(sampleIndex)));
+        }
+    }
+    if (decodingTimes.size() != m_chunkCount) {
+        diag.emplace_back(DiagLevel::Critical, "The \"sample to chunk\" table does not cover all chunks.", context);
+        throw InvalidDataException();
+    }
+    return decodingTimes;
+}
+
+/*!
+ * \struct TagParser::Mp4TrackFragment
+ * \brief The Mp4TrackFragment struct holds the location and the sizes of the samples of a track within a movie fragment.
+ * \sa Mp4Track::readFragment()
+ */
+
+/*!
+ * \brief Returns the offsets of the "moof"-atoms containing samples of the track in ascending order.
+ *
+ * If the file contains a "mfra"-atom with entries for the track, the offsets are taken from it without reading the
+ * movie fragments (see Mp4Container::parseFragmentIndex()). Otherwise the top-level atoms are walked.
+ *
+ * \remarks The "mfra"-atom only denotes movie fragments containing random access points. Use
+ *          Mp4TrackFragment::nextMovieFragmentOffset to locate the movie fragments in between if there are any.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+std::vector<std::uint64_t> Mp4Track::movieFragmentOffsets(Diagnostics &diag)
+{
+    static const string context("locating movie fragments of MP4 track");
+    auto offsets = vector<std::uint64_t>();
+    auto &container = m_trakAtom->container();
+    if (container.parseFragmentIndex(diag)) {
+        if (const auto *const index = container.fragmentIndex(m_id)) {
+            offsets.reserve(index->size());
+            for (const auto &entry : *index) {
+                offsets.emplace_back(entry.movieFragmentOffset);
+            }
+            sort(offsets.begin(), offsets.end());
+            offsets.erase(unique(offsets.begin(), offsets.end()), offsets.end());
+            return offsets;
+        }
+    }
+    for (Mp4Atom *moofAtom = container.firstElement()->siblingByIdIncludingThis(Mp4AtomIds::MovieFragment, diag); moofAtom;
+         moofAtom = moofAtom->siblingById(Mp4AtomIds::MovieFragment, diag)) {
+        moofAtom->parse(diag);
+        for (Mp4Atom *trafAtom = moofAtom->childById(Mp4AtomIds::TrackFragment, diag); trafAtom;
+             trafAtom = trafAtom->siblingById(Mp4AtomIds::TrackFragment, diag)) {
+            trafAtom->parse(diag);
+            const auto *const tfhdAtom = trafAtom->childById(Mp4AtomIds::TrackFragmentHeader, diag);
+            if (!tfhdAtom || tfhdAtom->dataSize() < 8) {
+                diag.emplace_back(DiagLevel::Critical, "tfhd atom is missing or truncated.", context);
+                continue;
+            }
+            m_istream->seekg(static_cast<streamoff>(tfhdAtom->dataOffset() + 4));
+            if (m_reader.readUInt32BE() == m_id) {
+                offsets.emplace_back(moofAtom->startOffset());
+                break;
+            }
+        }
+    }
+    return offsets;
+}
+
+/*!
+ * \brief Reads the samples of the track within the "moof"-atom at the specified \a movieFragmentOffset.
+ *
+ * Only the specified "moof"-atom is read so the chunk data of fragments can be resolved for each fragment while it is
+ * being used (e.g. when seeking) instead of reading all fragments when parsing (see ParsingFlags::LazyMp4Fragments). The
+ * defaults for the samples are taken from the "tfhd"-atom or the "trex"-atom of the track. If the "tfhd"-atom denotes
+ * no base data offset, the offsets are relative to the start of the "moof"-atom.
+ *
+ * \returns Returns the located samples; the offsets and sizes are empty if the "moof"-atom contains no samples of the track.
+ * \throws Throws InvalidDataException when the track has not been parsed or there is no "moof"-atom at the specified offset.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ * \sa movieFragmentOffsets()
+ */
+Mp4TrackFragment Mp4Track::readFragment(std::uint64_t movieFragmentOffset, Diagnostics &diag)
+{
+    static const string context("reading movie fragment of MP4 track");
+    using namespace Mp4AtomIds;
+    if (!isHeaderValid() || !m_istream) {
+        diag.emplace_back(DiagLevel::Critical, "Track has not been parsed.", context);
+        throw InvalidDataException();
+    }
+
+    // parse only the "moof"-atom at the specified offset (and not the top-level atoms in front of it)
+    auto &container = m_trakAtom->container();
+    auto moofAtom = make_unique<Mp4Atom>(container, movieFragmentOffset);
+    moofAtom->parse(diag);
+    if (moofAtom->id() != MovieFragment) {
+        diag.emplace_back(DiagLevel::Critical, argsToString("There is no moof atom at offset ", movieFragmentOffset, '.'), context);
+        throw InvalidDataException();
+    }
+    auto fragment = Mp4TrackFragment();
+    fragment.movieFragmentOffset = movieFragmentOffset;
+    if (const auto *const nextMoofAtom = moofAtom->siblingById(MovieFragment, diag)) {
+        fragment.nextMovieFragmentOffset = nextMoofAtom->startOffset();
+    }
+
+    // read the defaults of the track from the "trex"-atom
+    BinaryReader &reader = m_reader;
+    std::uint32_t trackDefaultSampleDuration = 0, trackDefaultSampleSize = 0;
+    if (Mp4Atom *const moovAtom = m_trakAtom->parent()) {
+        for (Mp4Atom *trexAtom = moovAtom->subelementByPath(diag, MovieExtends, TrackExtends); trexAtom;
+             trexAtom = trexAtom->siblingById(TrackExtends, diag)) {
+            if (trexAtom->dataSize() < 20) {
+                continue;
+            }
+            m_istream->seekg(static_cast<streamoff>(trexAtom->dataOffset() + 4));
+            if (reader.readUInt32BE() == m_id) {
+                m_istream->seekg(4, ios_base::cur); // skip default-sample-description-index
+                trackDefaultSampleDuration = reader.readUInt32BE();
+                trackDefaultSampleSize = reader.readUInt32BE();
+                break;
+            }
+        }
+    }
+
+    // read the "trun"-atoms of the "traf"-atoms of the track
+    for (Mp4Atom *trafAtom = moofAtom->childById(TrackFragment, diag); trafAtom; trafAtom = trafAtom->siblingById(TrackFragment, diag)) {
+        trafAtom->parse(diag);
+        Mp4Atom *const tfhdAtom = trafAtom->childById(TrackFragmentHeader, diag);
+        if (!tfhdAtom || tfhdAtom->dataSize() < 8) {
+            diag.emplace_back(DiagLevel::Critical, "tfhd atom is missing or truncated.", context);
+            continue;
+        }
+        m_istream->seekg(static_cast<streamoff>(tfhdAtom->dataOffset() + 1));
+        const auto flags = reader.readUInt24BE();
+        if (reader.readUInt32BE() != m_id) {
+            continue;
+        }
+        if (Mp4Atom *const tfdtAtom = fragment.chunkOffsets.empty() ? trafAtom->childById(TrackFragmentBaseMediaDecodeTime, diag) : nullptr) {
+            if (tfdtAtom->dataSize() >= 8) {
+                m_istream->seekg(static_cast<streamoff>(tfdtAtom->dataOffset()));
+                const auto version = reader.readByte();
+                m_istream->seekg(3, ios_base::cur); // skip flags
+                fragment.baseMediaDecodeTime = version == 1 && tfdtAtom->dataSize() >= 12 ? reader.readUInt64BE() : reader.readUInt32BE();
+            }
+            m_istream->seekg(static_cast<streamoff>(tfhdAtom->dataOffset() + 8));
+        }
+        const auto fieldsSize = ((flags & 0x000001) ? 8u : 0u) + ((flags & 0x000002) ? 4u : 0u) + ((flags & 0x000008) ? 4u : 0u)
+            + ((flags & 0x000010) ? 4u : 0u) + ((flags & 0x000020) ? 4u : 0u);
+        if (tfhdAtom->dataSize() < 8 + fieldsSize) {
+            diag.emplace_back(DiagLevel::Critical, "tfhd atom is truncated (presence of fields denoted).", context);
+            continue;
+        }
+        auto baseDataOffset = moofAtom->startOffset();
+        auto defaultSampleDuration = trackDefaultSampleDuration, defaultSampleSize = trackDefaultSampleSize;
+        if (flags & 0x000001) { // base-data-offset present
+            baseDataOffset = reader.readUInt64BE();
+        }
+        if (flags & 0x000002) { // sample-description-index present
+            m_istream->seekg(4, ios_base::cur);
+        }
+        if (flags & 0x000008) { // default-sample-duration present
+            defaultSampleDuration = reader.readUInt32BE();
+        }
+        if (flags & 0x000010) { // default-sample-size present
+            defaultSampleSize = reader.readUInt32BE();
+        }
+
+        // runs without data offset follow the data of the previous run
+        auto nextDataOffset = baseDataOffset;
+        for (Mp4Atom *trunAtom = trafAtom->childById(TrackFragmentRun, diag); trunAtom; trunAtom = trunAtom->siblingById(TrackFragmentRun, diag)) {
+            if (trunAtom->dataSize() < 8) {
+                diag.emplace_back(DiagLevel::Critical, "trun atom is truncated.", context);
+                continue;
+            }
+            m_istream->seekg(static_cast<streamoff>(trunAtom->dataOffset() + 1));
+            const auto runFlags = reader.readUInt24BE();
+            const auto sampleCount = reader.readUInt32BE();
+            const auto headerSize = 8u + ((runFlags & 0x000001) ? 4u : 0u) + ((runFlags & 0x000004) ? 4u : 0u);
+            const auto entrySize = ((runFlags & 0x000100) ? 4u : 0u) + ((runFlags & 0x000200) ? 4u : 0u) + ((runFlags & 0x000400) ? 4u : 0u)
+                + ((runFlags & 0x000800) ? 4u : 0u);
+            if (trunAtom->dataSize() < headerSize + static_cast<std::uint64_t>(entrySize) * sampleCount) {
+                diag.emplace_back(DiagLevel::Critical, "trun atom is truncated (presence of fields denoted).", context);
+                continue;
+            }
+            auto runOffset = nextDataOffset;
+            if (runFlags & 0x000001) { // data offset present
+                runOffset = baseDataOffset + static_cast<std::uint64_t>(static_cast<std::int64_t>(reader.readInt32BE()));
+            }
+            if (runFlags & 0x000004) { // first-sample-flags present
+                m_istream->seekg(4, ios_base::cur);
+            }
+            checkSampleTableSize(container, fragment.sampleSizes.size() + sampleCount, diag, context);
+            container.accountMemory(static_cast<std::uint64_t>(sampleCount) * sizeof(std::uint32_t));
+
+            // read the entries at once
+            auto entries = string(static_cast<std::size_t>(entrySize) * sampleCount, '\0');
+            m_istream->read(entries.data(), static_cast<streamsize>(entries.size()));
+            auto runSize = std::uint64_t();
+            fragment.sampleSizes.reserve(fragment.sampleSizes.size() + sampleCount);
+            const char *entry = entries.data();
+            for (std::uint32_t i = 0; i != sampleCount; ++i) {
+                if (runFlags & 0x000100) { // sample-duration present
+                    fragment.duration += BE::toUInt32(entry);
+                    entry += 4;
+                } else {
+                    fragment.duration += defaultSampleDuration;
+                }
+                if (runFlags & 0x000200) { // sample-size present
+                    fragment.sampleSizes.emplace_back(BE::toUInt32(entry));
+                    entry += 4;
+                } else {
+                    fragment.sampleSizes.emplace_back(defaultSampleSize);
+                }
+                runSize += fragment.sampleSizes.back();
+                entry += ((runFlags & 0x000400) ? 4u : 0u) + ((runFlags & 0x000800) ? 4u : 0u); // skip sample flags and composition time offset
+            }
+            fragment.chunkOffsets.emplace_back(runOffset);
+            fragment.chunkSizes.emplace_back(runSize);
+            nextDataOffset = runOffset + runSize;
+        }
+    }
+    return fragment;
+}
+
+/*!
+ * \brief Validates the sample table of the track against the specified \a mediaDataRanges without reading the media data.
+ *
+ * The following is validated:
+ * - the "stsc"-atom covers as many samples as the "stsz"/"stz2"-atom and the "stts"-atom denote
+ * - the chunk offsets and sizes can be determined for all chunks (see readChunkOffsets() and readChunkSizes())
+ * - every chunk lies within one of the \a mediaDataRanges
+ *
+ * The bounds of all chunks are determined in one pass over the chunk offsets and sizes. Only if they do not lie within a
+ * single range, the range of each chunk is looked up. If \a spotCheckCount is not zero, the last byte of that many
+ * randomly picked chunks (and of the last chunk) is read to ensure the data is actually readable.
+ *
+ * \param mediaDataRanges Specifies the begin and end offsets of the media data in ascending order.
+ * \remarks Chunks of fragments are not validated.
+ * \throws Throws std::ios_base::failure when an IO error occurs (except when a chunk can not be read by a spot check).
+ */
+void Mp4Track::validateSampleTable(
+    const std::vector<std::pair<std::uint64_t, std::uint64_t>> &mediaDataRanges, std::size_t spotCheckCount, Diagnostics &diag)
+{
+    const auto context = argsToString("validating sample table of MP4 track ", m_id);
+    if (!isHeaderValid() || !m_istream || !m_stcoAtom) {
+        diag.emplace_back(DiagLevel::Critical, "Track has not been parsed or is invalid.", context);
+        return;
+    }
+
+    // validate the sample counts of the tables
+    const auto sampleCount = static_cast<std::uint64_t>(m_sampleTable.sampleCount());
+    if (m_stscAtom) {
+        if (const auto coveredSampleCount = m_sampleTable.sampleToChunkSampleCount(*m_istream); coveredSampleCount != sampleCount) {
+            diag.emplace_back(DiagLevel::Critical,
+                argsToString("The stsc atom covers ", coveredSampleCount, " samples but the stsz atom denotes ", sampleCount, " samples."), context);
+        }
+    }
+    if (m_stblAtom->childById(Mp4AtomIds::DecodingTimeToSample, diag)) {
+        if (const auto coveredSampleCount = m_sampleTable.timeToSampleSampleCount(*m_istream); coveredSampleCount != sampleCount) {
+            diag.emplace_back(DiagLevel::Critical,
+                argsToString("The stts atom covers ", coveredSampleCount, " samples but the stsz atom denotes ", sampleCount, " samples."), context);
+        }
+    }
+
+    // read the chunk offsets and sizes
+    auto chunkOffsets = vector<std::uint64_t>(), chunkSizes = vector<std::uint64_t>();
+    try {
+        chunkOffsets = readChunkOffsets(false, diag);
+        chunkSizes = readChunkSizes(diag);
+    } catch (const Failure &) {
+        diag.emplace_back(DiagLevel::Critical, "The chunk offsets and sizes can not be determined.", context);
+        return;
+    }
+    if (chunkOffsets.size() != chunkSizes.size()) {
+        diag.emplace_back(DiagLevel::Critical,
+            argsToString("The sizes of ", chunkSizes.size(), " chunks have been determined but there are ", chunkOffsets.size(), " chunk offsets."),
+            context);
+    }
+    const auto chunkCount = min(chunkOffsets.size(), chunkSizes.size());
+    if (!chunkCount) {
+        return;
+    }
+
+    // check whether all chunks lie within one range at once, otherwise look up the range of each chunk
+    // -> the range containing an offset is the last one beginning at or before it
+    const auto rangeOf = [&mediaDataRanges](std::uint64_t offset) {
+        const auto range = upper_bound(mediaDataRanges.cbegin(), mediaDataRanges.cend(), offset,
+            [](std::uint64_t value, const pair<std::uint64_t, std::uint64_t> &range) { return value < range.first; });
+        return range != mediaDataRanges.cbegin() ? range - 1 : mediaDataRanges.cend();
+    };
+    auto chunksBegin = std::uint64_t(), chunksEnd = std::uint64_t();
+    const auto overflow = determineChunkBounds(chunkOffsets.data(), chunkSizes.data(), chunkCount, chunksBegin, chunksEnd);
+    const auto boundsRange = rangeOf(chunksBegin);
+    auto invalidChunks = vector<bool>();
+    if (overflow || boundsRange == mediaDataRanges.cend() || chunksEnd > boundsRange->second) {
+        auto invalidChunkCount = std::size_t();
+        invalidChunks.resize(chunkCount);
+        for (std::size_t i = 0; i != chunkCount; ++i) {
+            const auto chunkEnd = chunkOffsets[i] + chunkSizes[i];
+            const auto range = rangeOf(chunkOffsets[i]);
+            if (range != mediaDataRanges.cend() && chunkEnd >= chunkOffsets[i] && chunkEnd <= range->second) {
+                continue;
+            }
+            if (!invalidChunkCount++) {
+                diag.emplace_back(DiagLevel::Critical,
+                    argsToString("Chunk ", i + 1, " at ", chunkOffsets[i], " with a size of ", chunkSizes[i], " bytes is not within an mdat atom."),
+                    context);
+            }
+            invalidChunks[i] = true;
+        }
+        if (invalidChunkCount > 1) {
+            diag.emplace_back(
+                DiagLevel::Critical, argsToString(invalidChunkCount, " of ", chunkCount, " chunks are not within an mdat atom."), context);
+        }
+    }
+
+    // read the last byte of some chunks
+    if (!spotCheckCount) {
+        return;
+    }
+    // -> read in ascending order so the reads are sparse but forward
+    auto chunkIndices = vector<std::size_t>();
+    chunkIndices.reserve(spotCheckCount + 1);
+    auto randomEngine = mt19937(random_device()());
+    auto distribution = uniform_int_distribution<std::size_t>(0, chunkCount - 1);
+    for (std::size_t i = 0; i != spotCheckCount; ++i) {
+        chunkIndices.emplace_back(distribution(randomEngine));
+    }
+    chunkIndices.emplace_back(chunkCount - 1);
+    sort(chunkIndices.begin(), chunkIndices.end());
+    chunkIndices.erase(unique(chunkIndices.begin(), chunkIndices.end()), chunkIndices.end());
+    for (const auto i : chunkIndices) {
+        if (!chunkSizes[i] || (!invalidChunks.empty() && invalidChunks[i])) {
+            continue;
+        }
+        try {
+            char lastByte;
+            m_istream->seekg(static_cast<streamoff>(chunkOffsets[i] + chunkSizes[i] - 1));
+            m_istream->read(&lastByte, 1);
+        } catch (const std::ios_base::failure &) {
+            m_istream->clear();
+            diag.emplace_back(DiagLevel::Critical, argsToString("Chunk ", i + 1, " at ", chunkOffsets[i], " can not be read."), context);
+        }
+    }
+}
+
 /*!
  * \brief Reads the MPEG-4 elementary stream descriptor for the track.
  * \sa mpeg4ElementaryStreamInfo()
@@ -884,7 +1510,9 @@ std::unique_ptr<Mpeg4VideoSpecificConfig> Mp4Track::parseVideoSpecificConfig(
  *
  * \throws Throws std::ios_base::failure when an IO error occurs.
  *
- * \remarks This method needs to be fixed.
+ * \remarks
+ * - Each chunk offset is shifted like the closest "mdat"-atom starting before it.
+ * - The table is read into memory, updated there and written back at once so big tables are updated quickly.
  */
 void Mp4Track::updateChunkOffsets(const vector<std::int64_t> &oldMdatOffsets, const vector<std::int64_t> &newMdatOffsets)
 {
@@ -894,50 +1522,39 @@ void Mp4Track::updateChunkOffsets(const vector<std::int64_t> &oldMdatOffsets, co
     if (oldMdatOffsets.size() == 0 || oldMdatOffsets.size() != newMdatOffsets.size()) {
         throw InvalidDataException();
     }
-    static const unsigned int stcoDataBegin = 8;
-    std::uint64_t startPos = m_stcoAtom->dataOffset() + stcoDataBegin;
-    std::uint64_t endPos = startPos + m_stcoAtom->dataSize() - stcoDataBegin;
-    m_istream->seekg(static_cast<streamoff>(startPos));
-    m_ostream->seekp(static_cast<streamoff>(startPos));
-    vector<std::int64_t>::size_type i;
-    vector<std::int64_t>::size_type size;
-    auto currentPos = static_cast<std::uint64_t>(m_istream->tellg());
+    std::size_t entrySize;
     switch (m_stcoAtom->id()) {
-    case Mp4AtomIds::ChunkOffset: {
-        std::uint32_t off;
-        while ((currentPos + 4) <= endPos) {
-            off = m_reader.readUInt32BE();
-            for (i = 0, size = oldMdatOffsets.size(); i < size; ++i) {
-                if (off > static_cast<std::uint64_t>(oldMdatOffsets[i])) {
-                    off += (newMdatOffsets[i] - oldMdatOffsets[i]);
-                    break;
-                }
-            }
-            m_ostream->seekp(static_cast<streamoff>(currentPos));
-            m_writer.writeUInt32BE(off);
-            currentPos += static_cast<std::uint64_t>(m_istream->gcount());
-        }
+    case Mp4AtomIds::ChunkOffset:
+        entrySize = 4;
         break;
-    }
-    case Mp4AtomIds::ChunkOffset64: {
-        std::uint64_t off;
-        while ((currentPos + 8) <= endPos) {
-            off = m_reader.readUInt64BE();
-            for (i = 0, size = oldMdatOffsets.size(); i < size; ++i) {
-                if (off > static_cast<std::uint64_t>(oldMdatOffsets[i])) {
-                    off += (newMdatOffsets[i] - oldMdatOffsets[i]);
-                    break;
-                }
-            }
-            m_ostream->seekp(static_cast<streamoff>(currentPos));
-            m_writer.writeUInt64BE(off);
-            currentPos += static_cast<std::uint64_t>(m_istream->gcount());
-        }
+    case Mp4AtomIds::ChunkOffset64:
+        entrySize = 8;
         break;
-    }
     default:
         throw InvalidDataException();
     }
+
+    // read the whole table at once
+    static const unsigned int stcoDataBegin = 8;
+    const auto startPos = m_stcoAtom->dataOffset() + stcoDataBegin;
+    const auto dataSize = m_stcoAtom->dataSize() > stcoDataBegin ? m_stcoAtom->dataSize() - stcoDataBegin : 0;
+    const auto tableSize = static_cast<std::size_t>(dataSize - dataSize % entrySize);
+    if (!tableSize) {
+        return;
+    }
+    auto table = make_unique<char[]>(tableSize);
+    m_istream->seekg(static_cast<streamoff>(startPos));
+    m_istream->read(table.get(), static_cast<streamsize>(tableSize));
+
+    // shift the offsets within the buffer and write the table back at once
+    const auto mdatShifts = makeMdatShifts(oldMdatOffsets, newMdatOffsets);
+    if (entrySize == 4) {
+        shiftChunkOffsets<std::uint32_t>(table.get(), tableSize, mdatShifts);
+    } else {
+        shiftChunkOffsets<std::uint64_t>(table.get(), tableSize, mdatShifts);
+    }
+    m_ostream->seekp(static_cast<streamoff>(startPos));
+    m_ostream->write(table.get(), static_cast<streamsize>(tableSize));
 }
 
 /*!
@@ -1009,6 +1626,37 @@ void Mp4Track::updateChunkOffset(std::uint32_t chunkIndex, std::uint64_t offset)
     }
 }
 
+/*!
+ * \brief Sets the offsets of the "mdat"-atoms within the original and within the new file.
+ *
+ * If set, makeTrack() writes the chunk offsets already shifted like updateChunkOffsets() would do so the chunk offset
+ * table doesn't need to be updated after the media data has been written. Pass empty vectors to disable this.
+ *
+ * \throws Throws InvalidDataException if \a oldMdatOffsets holds not the same number of offsets as \a newMdatOffsets.
+ */
+void Mp4Track::setChunkOffsetShift(const std::vector<std::int64_t> &oldMdatOffsets, const std::vector<std::int64_t> &newMdatOffsets)
+{
+    if (oldMdatOffsets.size() != newMdatOffsets.size()) {
+        throw InvalidDataException();
+    }
+    m_oldMdatOffsets = oldMdatOffsets;
+    m_newMdatOffsets = newMdatOffsets;
+}
+
+/*!
+ * \brief Decodes the SPS/PPS of the AVC configuration if not done yet and adds the information to the track.
+ *
+ * This is only required when the track has been parsed using ParsingFlags::LazyDecodeParameterSets. Then the pixel
+ * size, cropping, chroma format and pixel aspect ratio are only determined when calling this function.
+ */
+void Mp4Track::decodeParameterSets(Diagnostics &diag)
+{
+    if (m_avcConfig && m_avcConfig->hasUndecodedParameterSets()) {
+        m_avcConfig->decodeParameterSets(diag);
+        addInfo(*m_avcConfig, *this);
+    }
+}
+
 /*!
  * \brief Adds the information from the specified \a avcConfig to the specified \a track.
  */
@@ -1020,20 +1668,8 @@ void Mp4Track::addInfo(const AvcConfiguration &avcConfig, AbstractTrack &track)
         track.m_version = static_cast<double>(spsInfo.levelIndication) / 10;
         track.m_cropping = spsInfo.cropping;
         track.m_pixelSize = spsInfo.pictureSize;
-        switch (spsInfo.chromaFormatIndication) {
-        case 0:
-            track.m_chromaFormat = "monochrome";
-            break;
-        case 1:
-            track.m_chromaFormat = "YUV 4:2:0";
-            break;
-        case 2:
-            track.m_chromaFormat = "YUV 4:2:2";
-            break;
-        case 3:
-            track.m_chromaFormat = "YUV 4:4:4";
-            break;
-        default:;
+        if (const auto *const chromaFormat = chromaFormatName(spsInfo.chromaFormatIndication)) {
+            track.m_chromaFormat = chromaFormat;
         }
         track.m_pixelAspectRatio = spsInfo.pixelAspectRatio;
     } else {
@@ -1042,6 +1678,44 @@ void Mp4Track::addInfo(const AvcConfiguration &avcConfig, AbstractTrack &track)
     }
 }
 
+/*!
+ * \brief Adds the information from the specified \a hevcConfig to the specified \a track.
+ *
+ * The values of the last SPS are preferred over the ones denoted in the configuration itself. The FPS are taken from
+ * the timing info of the SPS or VPS and otherwise from the average frame rate denoted in the configuration.
+ */
+void Mp4Track::addInfo(const HevcConfiguration &hevcConfig, AbstractTrack &track)
+{
+    track.m_version = static_cast<double>(hevcConfig.levelIndication) / 30;
+    if (const auto *const chromaFormat = chromaFormatName(hevcConfig.chromaFormatIndication)) {
+        track.m_chromaFormat = chromaFormat;
+    }
+    if (hevcConfig.averageFrameRate) {
+        track.m_fps = hevcConfig.averageFrameRate / 256u;
+    }
+    if (!hevcConfig.vpsInfos.empty()) {
+        const auto &timingInfo = hevcConfig.vpsInfos.back().timingInfo;
+        if (timingInfo.isPresent && timingInfo.unitsInTick) {
+            track.m_fps = timingInfo.timeScale / timingInfo.unitsInTick;
+        }
+    }
+    if (!hevcConfig.spsInfos.empty()) {
+        const auto &spsInfo = hevcConfig.spsInfos.back();
+        track.m_version = static_cast<double>(spsInfo.profileTierLevel.levelIndication) / 30;
+        track.m_cropping = spsInfo.cropping;
+        track.m_pixelSize = spsInfo.pictureSize;
+        if (const auto *const chromaFormat = chromaFormatName(spsInfo.chromaFormatIndication)) {
+            track.m_chromaFormat = chromaFormat;
+        }
+        if (spsInfo.pixelAspectRatio.isValid()) {
+            track.m_pixelAspectRatio = spsInfo.pixelAspectRatio;
+        }
+        if (spsInfo.timingInfo.isPresent && spsInfo.timingInfo.unitsInTick) {
+            track.m_fps = spsInfo.timingInfo.timeScale / spsInfo.timingInfo.unitsInTick;
+        }
+    }
+}
+
 /*!
  * \brief Adds the information from the specified \a av1Config to the specified \a track.
  * \todo Provide implementation
@@ -1058,8 +1732,11 @@ void Mp4Track::addInfo(const Av1Configuration &av1Config, AbstractTrack &track)
  *
  * This allows to invoke makeTrack() also when the input stream is going to be
  * modified (eg. to apply changed tags without rewriting the file).
+ *
+ * If \a includingSampleTableChildren is set, the children of the "stbl"-atom are buffered as well. That is required
+ * if the chunk offset table is going to be made (see setChunkOffsetShift()) after the input stream has been modified.
  */
-void Mp4Track::bufferTrackAtoms(Diagnostics &diag)
+void Mp4Track::bufferTrackAtoms(Diagnostics &diag, bool includingSampleTableChildren)
 {
     CPP_UTILITIES_UNUSED(diag)
 
@@ -1075,10 +1752,144 @@ void Mp4Track::bufferTrackAtoms(Diagnostics &diag)
     if (m_minfAtom) {
         for (Mp4Atom *childAtom = m_minfAtom->firstChild(); childAtom; childAtom = childAtom->nextSibling()) {
             childAtom->makeBuffer();
+            // note: The children are copied one by one when making the sample table with compacted atoms.
+            if ((!includingSampleTableChildren && m_compactedAtoms.empty()) || childAtom->id() != Mp4AtomIds::SampleTable) {
+                continue;
+            }
+            for (Mp4Atom *stblChild = childAtom->firstChild(); stblChild; stblChild = stblChild->nextSibling()) {
+                stblChild->makeBuffer();
+            }
         }
     }
 }
 
+/*!
+ * \brief Compacts the atoms of the track to be written when calling makeTrack().
+ *
+ * The atoms denoted by \a strippedAtomIds are omitted (except for mandatory ones) and the "stts"-, "stsc"- and "stsz"-atoms
+ * are normalized if that makes them smaller. If \a stripUnusedSampleGroups is set, "sgpd"- and "sbgp"-atoms are omitted if
+ * there is no corresponding "sbgp"-atom/"sgpd"-atom with the same grouping type.
+ *
+ * The compacted atoms are held in memory until discardCompactedAtoms() is called (or until compactAtoms() is called again).
+ *
+ * \sa Mp4Container::isMovieAtomCompactionEnabled()
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+void Mp4Track::compactAtoms(const std::vector<std::uint32_t> &strippedAtomIds, bool stripUnusedSampleGroups, Diagnostics &diag)
+{
+    static const string context("compacting MP4 track");
+    using namespace Mp4AtomIds;
+    discardCompactedAtoms();
+    const auto contains = [](const vector<std::uint32_t> &ids, std::uint32_t id) { return find(ids.cbegin(), ids.cend(), id) != ids.cend(); };
+    const auto isStripped = [&](const Mp4Atom *atom) { return contains(strippedAtomIds, atom->id()); };
+    const auto readData = [this](Mp4Atom *atom) {
+        auto data = std::string(static_cast<std::size_t>(atom->dataSize()), '\0');
+        if (const auto &buffer = atom->buffer()) {
+            std::copy(buffer.get() + atom->headerSize(), buffer.get() + atom->totalSize(), data.data());
+        } else {
+            m_istream->seekg(static_cast<streamoff>(atom->dataOffset()));
+            m_istream->read(data.data(), static_cast<streamsize>(data.size()));
+        }
+        return data;
+    };
+
+    // omit the stripped children of the "trak"- and the "minf"-atom
+    for (Mp4Atom *trakChild = m_trakAtom->firstChild(); trakChild; trakChild = trakChild->nextSibling()) {
+        if (trakChild->id() != Media && trakChild->id() != TrackHeader && isStripped(trakChild)) {
+            m_compactedAtoms.emplace_back(trakChild, std::string());
+        }
+    }
+    if (!m_minfAtom || !m_stblAtom) {
+        return;
+    }
+    for (Mp4Atom *minfChild = m_minfAtom->firstChild(); minfChild; minfChild = minfChild->nextSibling()) {
+        if (minfChild->id() != SampleTable && minfChild->id() != DataInformation && isStripped(minfChild)) {
+            m_compactedAtoms.emplace_back(minfChild, std::string());
+        }
+    }
+
+    // determine the grouping types of the sample groups
+    auto sampleToGroupTypes = vector<std::uint32_t>(), sampleGroupDescriptionTypes = vector<std::uint32_t>();
+    const auto groupingType = [&](Mp4Atom *atom) {
+        const auto data = atom->dataSize() >= 8 ? readData(atom) : std::string(8, '\0');
+        return BE::toUInt32(data.data() + 4);
+    };
+    try {
+        for (Mp4Atom *stblChild = m_stblAtom->firstChild(); stblChild; stblChild = stblChild->nextSibling()) {
+            stblChild->parse(diag);
+            if (!stripUnusedSampleGroups) {
+                continue;
+            } else if (stblChild->id() == SampleToGroup) {
+                sampleToGroupTypes.emplace_back(groupingType(stblChild));
+            } else if (stblChild->id() == SampleGroupDescription) {
+                sampleGroupDescriptionTypes.emplace_back(groupingType(stblChild));
+            }
+        }
+    } catch (const Failure &) {
+        diag.emplace_back(DiagLevel::Warning, "Unable to parse the children of the \"stbl\"-atom; not compacting them.", context);
+        return;
+    }
+
+    // normalize the sample tables and omit the stripped children of the "stbl"-atom
+    for (Mp4Atom *stblChild = m_stblAtom->firstChild(); stblChild; stblChild = stblChild->nextSibling()) {
+        auto compacted = std::string();
+        switch (stblChild->id()) {
+        case DecodingTimeToSample:
+            compacted = compactTimeToSampleTable(readData(stblChild));
+            break;
+        case SampleToChunk:
+            compacted = compactSampleToChunkTable(readData(stblChild));
+            break;
+        case SampleSize:
+            compacted = compactSampleSizeTable(readData(stblChild));
+            break;
+        case SampleDescription:
+        case CompactSampleSize:
+        case ChunkOffset:
+        case ChunkOffset64:
+            continue;
+        case SampleToGroup:
+        case SampleGroupDescription:
+            if (stripUnusedSampleGroups
+                && !contains(stblChild->id() == SampleToGroup ? sampleGroupDescriptionTypes : sampleToGroupTypes, groupingType(stblChild))) {
+                m_compactedAtoms.emplace_back(stblChild, std::string());
+                continue;
+            }
+            [[fallthrough]];
+        default:
+            if (isStripped(stblChild)) {
+                m_compactedAtoms.emplace_back(stblChild, std::string());
+            }
+            continue;
+        }
+        if (!compacted.empty() && compacted.size() + 8 < stblChild->totalSize()) {
+            m_compactedAtoms.emplace_back(stblChild, makeCompactedAtom(stblChild->id(), compacted));
+        }
+    }
+}
+
+/*!
+ * \brief Discards the atoms compacted via compactAtoms() so the atoms are written as they are again.
+ */
+void Mp4Track::discardCompactedAtoms()
+{
+    m_compactedAtoms.clear();
+}
+
+/*!
+ * \brief Returns the compacted version of the specified \a atom (which is empty if the atom is omitted).
+ * \returns Returns nullptr if the atom has not been compacted.
+ */
+const std::string *Mp4Track::compactedAtom(const Mp4Atom *atom) const
+{
+    for (const auto &[compactedAtom, data] : m_compactedAtoms) {
+        if (compactedAtom == atom) {
+            return &data;
+        }
+    }
+    return nullptr;
+}
+
 /*!
  * \brief Returns the number of bytes written when calling makeTrack().
  */
@@ -1124,6 +1935,12 @@ std::uint64_t Mp4Track::requiredSize(Diagnostics &diag) const
         // take 36 bytes for a self-made dinf atom into account if the file lacks one
         size += 36;
     }
+    // ... additional 4 bytes per chunk offset when promoting the stco atom to a co64 atom
+    size += promotedChunkOffsetEntryCount() * 4;
+    // ... minus the bytes saved by compacting atoms
+    for (const auto &[atom, data] : m_compactedAtoms) {
+        size -= atom->totalSize() - data.size();
+    }
     return size;
 }
 
@@ -1150,6 +1967,10 @@ void Mp4Track::makeTrack(Diagnostics &diag)
         if (trakChild->id() == Mp4AtomIds::Media || trakChild->id() == Mp4AtomIds::TrackHeader) {
             continue;
         }
+        if (const auto *const compacted = compactedAtom(trakChild)) {
+            outputStream().write(compacted->data(), static_cast<streamsize>(compacted->size()));
+            continue;
+        }
         trakChild->copyPreferablyFromBuffer(outputStream(), diag, nullptr);
     }
 
@@ -1372,6 +2193,10 @@ void Mp4Track::makeMediaInfo(Diagnostics &diag)
             if (childAtom->id() == Mp4AtomIds::DataInformation) {
                 dinfAtomWritten = true;
             }
+            if (const auto *const compacted = compactedAtom(childAtom)) {
+                outputStream().write(compacted->data(), static_cast<streamsize>(compacted->size()));
+                continue;
+            }
             childAtom->copyPreferablyFromBuffer(outputStream(), diag, nullptr);
         }
     }
@@ -1395,7 +2220,24 @@ void Mp4Track::makeMediaInfo(Diagnostics &diag)
     bool stblAtomWritten = false;
     if (m_minfAtom) {
         if (Mp4Atom *const stblAtom = m_minfAtom->childById(Mp4AtomIds::SampleTable, diag)) {
-            stblAtom->copyPreferablyFromBuffer(outputStream(), diag, nullptr);
+            if (promotedChunkOffsetEntryCount() || !m_oldMdatOffsets.empty() || !m_compactedAtoms.empty()) {
+                // copy the children but make the chunk offset table and write the compacted atoms
+                const auto stblStartOffset = outputStream().tellp();
+                writer().writeUInt32BE(0); // write size later
+                writer().writeUInt32BE(Mp4AtomIds::SampleTable);
+                for (Mp4Atom *childAtom = stblAtom->firstChild(); childAtom; childAtom = childAtom->nextSibling()) {
+                    if (childAtom == m_stcoAtom) {
+                        makeChunkOffsetTable(diag);
+                    } else if (const auto *const compacted = compactedAtom(childAtom)) {
+                        outputStream().write(compacted->data(), static_cast<streamsize>(compacted->size()));
+                    } else {
+                        childAtom->copyPreferablyFromBuffer(outputStream(), diag, nullptr);
+                    }
+                }
+                Mp4Atom::seekBackAndWriteAtomSize(outputStream(), stblStartOffset, diag);
+            } else {
+                stblAtom->copyPreferablyFromBuffer(outputStream(), diag, nullptr);
+            }
             stblAtomWritten = true;
         }
     }
@@ -1472,7 +2314,90 @@ void Mp4Track::makeSampleTable(Diagnostics &diag)
     // Mp4Atom::seekBackAndWriteAtomSize(outputStream(), stblStartOffset, diag);
 }
 
+/*!
+ * \brief Returns the number of entries of the "stco"-atom which is going to be promoted to a "co64"-atom.
+ * \returns Returns zero if the table is not going to be promoted.
+ * \sa setChunkOffsetTablePromoted()
+ */
+std::uint64_t Mp4Track::promotedChunkOffsetEntryCount() const
+{
+    if (!m_chunkOffsetTablePromoted || !m_stcoAtom || m_stcoAtom->id() != Mp4AtomIds::ChunkOffset || m_stcoAtom->dataSize() < 8) {
+        return 0;
+    }
+    return (m_stcoAtom->dataSize() - 8) / 4;
+}
+
+/*!
+ * \brief Makes the chunk offset table ("stco"-atom or "co64"-atom) for the track.
+ *
+ * The table is promoted to a "co64"-atom if setChunkOffsetTablePromoted() has been enabled and the chunk offsets are
+ * updated according to setChunkOffsetShift(). The whole table is read and written at once.
+ */
+void Mp4Track::makeChunkOffsetTable(Diagnostics &diag)
+{
+    const auto promotedEntryCount = promotedChunkOffsetEntryCount();
+    const auto readEntrySize = std::size_t(m_stcoAtom->id() == Mp4AtomIds::ChunkOffset64 ? 8 : 4);
+    const auto writeEntrySize = promotedEntryCount ? std::size_t(8) : readEntrySize;
+    const auto entryCount = static_cast<std::size_t>(m_stcoAtom->dataSize() < 8 ? 0 : (m_stcoAtom->dataSize() - 8) / readEntrySize);
+    const auto oldTableSize = entryCount * readEntrySize;
+    const auto newTableSize = entryCount * writeEntrySize;
+    auto table = make_unique<char[]>(newTableSize);
+    const auto oldTable = table.get() + newTableSize - oldTableSize;
+    std::uint32_t versionAndFlags, denotedEntryCount;
+    if (const auto &buffer = m_stcoAtom->buffer(); buffer && m_stcoAtom->dataSize() >= 8) {
+        // read the table from the buffer if the atom has been buffered (see bufferTrackAtoms())
+        const auto *const data = buffer.get() + m_stcoAtom->headerSize();
+        versionAndFlags = BE::toUInt32(data);
+        denotedEntryCount = BE::toUInt32(data + 4);
+        std::copy(data + 8, data + 8 + oldTableSize, oldTable);
+    } else {
+        m_istream->seekg(static_cast<streamoff>(m_stcoAtom->dataOffset()));
+        versionAndFlags = m_reader.readUInt32BE();
+        denotedEntryCount = m_reader.readUInt32BE();
+        m_istream->read(oldTable, static_cast<streamsize>(oldTableSize));
+    }
+
+    // widen the entries in place, starting from the front where the widened entries don't overlap the remaining ones
+    if (promotedEntryCount) {
+        for (std::size_t i = 0; i != entryCount; ++i) {
+            BE::getBytes(static_cast<std::uint64_t>(BE::toUInt32(oldTable + i * 4)), table.get() + i * 8);
+        }
+    }
+
+    // apply the shift of the media data
+    if (!m_oldMdatOffsets.empty()) {
+        const auto mdatShifts = makeMdatShifts(m_oldMdatOffsets, m_newMdatOffsets);
+        if (writeEntrySize == 4) {
+            shiftChunkOffsets<std::uint32_t>(table.get(), newTableSize, mdatShifts);
+        } else {
+            shiftChunkOffsets<std::uint64_t>(table.get(), newTableSize, mdatShifts);
+        }
+    }
+
+    const auto tableStartOffset = outputStream().tellp();
+    m_writer.writeUInt32BE(0); // write size later
+    m_writer.writeUInt32BE(writeEntrySize == 8 ? Mp4AtomIds::ChunkOffset64 : Mp4AtomIds::ChunkOffset);
+    m_writer.writeUInt32BE(promotedEntryCount ? 0 : versionAndFlags);
+    m_writer.writeUInt32BE(denotedEntryCount);
+    outputStream().write(table.get(), static_cast<streamsize>(newTableSize));
+    Mp4Atom::seekBackAndWriteAtomSize(outputStream(), tableStartOffset, diag);
+}
+
 void Mp4Track::internalParseHeader(Diagnostics &diag)
+{
+    parseDescription(diag);
+    parseSampleInformation(diag);
+}
+
+/*!
+ * \brief Parses the atoms of the track and the information of the track header, the media header and the sample description.
+ *
+ * This is the first part of internalParseHeader(). It parses the atoms of the track and therefore modifies the element tree
+ * of the container.
+ *
+ * \sa Mp4Container::parseTracksConcurrently()
+ */
+void Mp4Track::parseDescription(Diagnostics &diag)
 {
     static const string context("parsing MP4 track");
     using namespace Mp4AtomIds;
@@ -1749,7 +2674,8 @@ void Mp4Track::internalParseHeader(Diagnostics &diag)
                     m_istream->seekg(static_cast<streamoff>(avcConfigAtom->dataOffset()));
                     m_avcConfig = make_unique<TagParser::AvcConfiguration>();
                     try {
-                        m_avcConfig->parse(reader, avcConfigAtom->dataSize(), diag);
+                        m_avcConfig->parse(reader, avcConfigAtom->dataSize(), diag,
+                            !(m_trakAtom->container().fileInfo().parsingFlags() & ParsingFlags::LazyDecodeParameterSets));
                         addInfo(*m_avcConfig, *this);
                     } catch (const TruncatedDataException &) {
                         diag.emplace_back(DiagLevel::Critical, "AVC configuration is truncated.", context);
@@ -1758,6 +2684,20 @@ void Mp4Track::internalParseHeader(Diagnostics &diag)
                     }
                 }
 
+                // parse HEVC configuration
+                if (auto *const hevcConfigAtom = esDescParentAtom->childById(Mp4AtomIds::HevcConfiguration, diag)) {
+                    m_istream->seekg(static_cast<streamoff>(hevcConfigAtom->dataOffset()));
+                    m_hevcConfig = make_unique<TagParser::HevcConfiguration>();
+                    try {
+                        m_hevcConfig->parse(reader, hevcConfigAtom->dataSize(), diag);
+                        addInfo(*m_hevcConfig, *this);
+                    } catch (const TruncatedDataException &) {
+                        diag.emplace_back(DiagLevel::Critical, "HEVC configuration is truncated.", context);
+                    } catch (const Failure &) {
+                        diag.emplace_back(DiagLevel::Critical, "HEVC configuration is invalid.", context);
+                    }
+                }
+
                 // parse AV1 configuration
                 if (auto *const av1ConfigAtom = esDescParentAtom->childById(Mp4AtomIds::Av1Configuration, diag)) {
                     m_istream->seekg(static_cast<streamoff>(av1ConfigAtom->dataOffset()));
@@ -1841,85 +2781,48 @@ void Mp4Track::internalParseHeader(Diagnostics &diag)
         }
     }
 
-    // read stsz atom which holds the sample size table
+    // determine the location of the sample table; only the sample sizes are accumulated to determine the size of the track
     m_sampleSizes.clear();
-    m_size = m_sampleCount = 0;
-    std::uint64_t actualSampleSizeTableSize = m_stszAtom->dataSize();
-    if (actualSampleSizeTableSize < 12) {
-        diag.emplace_back(DiagLevel::Critical,
-            "The stsz atom is truncated. There are no sample sizes present. The size of the track can not be determined.", context);
-    } else {
-        actualSampleSizeTableSize -= 12; // subtract size of version and flags
-        m_istream->seekg(static_cast<streamoff>(m_stszAtom->dataOffset() + 4)); // seek to beg, skip size, name, version and flags
-        std::uint32_t fieldSize;
-        std::uint32_t constantSize;
-        if (m_stszAtom->id() == Mp4AtomIds::CompactSampleSize) {
-            constantSize = 0;
-            m_istream->seekg(3, ios_base::cur); // seek reserved bytes
-            fieldSize = reader.readByte();
-            m_sampleCount = reader.readUInt32BE();
-        } else {
-            constantSize = reader.readUInt32BE();
-            m_sampleCount = reader.readUInt32BE();
-            fieldSize = 32;
-        }
-        if (constantSize) {
-            m_sampleSizes.push_back(constantSize);
-            m_size = constantSize * m_sampleCount;
-        } else {
-            auto actualSampleCount = m_sampleCount;
-            const auto calculatedSampleSizeTableSize = static_cast<std::uint64_t>(ceil((0.125 * fieldSize) * m_sampleCount));
-            if (calculatedSampleSizeTableSize < actualSampleSizeTableSize) {
-                diag.emplace_back(
-                    DiagLevel::Critical, "The stsz atom stores more entries as denoted. The additional entries will be ignored.", context);
-            } else if (calculatedSampleSizeTableSize > actualSampleSizeTableSize) {
-                diag.emplace_back(DiagLevel::Critical, "The stsz atom is truncated. It stores less entries as denoted.", context);
-                actualSampleCount = static_cast<std::uint64_t>(floor(static_cast<double>(actualSampleSizeTableSize) / (0.125 * fieldSize)));
-            }
-            m_sampleSizes.reserve(actualSampleCount);
-            std::uint32_t i = 1;
-            switch (fieldSize) {
-            case 4:
-                for (; i <= actualSampleCount; i += 2) {
-                    std::uint8_t val = reader.readByte();
-                    m_sampleSizes.push_back(val >> 4);
-                    m_sampleSizes.push_back(val & 0xF0);
-                    m_size += (val >> 4) + (val & 0xF0);
-                }
-                if (i <= actualSampleCount + 1) {
-                    m_sampleSizes.push_back(reader.readByte() >> 4);
-                    m_size += m_sampleSizes.back();
-                }
-                break;
-            case 8:
-                for (; i <= actualSampleCount; ++i) {
-                    m_sampleSizes.push_back(reader.readByte());
-                    m_size += m_sampleSizes.back();
-                }
-                break;
-            case 16:
-                for (; i <= actualSampleCount; ++i) {
-                    m_sampleSizes.push_back(reader.readUInt16BE());
-                    m_size += m_sampleSizes.back();
-                }
-                break;
-            case 32:
-                for (; i <= actualSampleCount; ++i) {
-                    m_sampleSizes.push_back(reader.readUInt32BE());
-                    m_size += m_sampleSizes.back();
-                }
-                break;
-            default:
-                diag.emplace_back(DiagLevel::Critical,
-                    "The fieldsize used to store the sample sizes is not supported. The sample count and size of the track can not be determined.",
-                    context);
-            }
+    m_sampleSizesLoaded = false;
+    m_sampleTable.parse(*m_istream, m_stszAtom, m_stscAtom, m_stblAtom->childById(DecodingTimeToSample, diag), m_chunkCount, diag);
+    checkSampleTableSize(m_trakAtom->container(),
+        max<std::uint64_t>(m_sampleTable.constantSampleSize() ? 0 : m_sampleTable.sampleSizeCount(), m_chunkCount), diag, context);
+    m_sampleCount = m_sampleTable.sampleCount();
+}
+
+/*!
+ * \brief Determines the size, duration and bitrates of the track from the sample table and the track fragments.
+ *
+ * This is the second part of internalParseHeader(). Except for the track fragments of fragmented files no atoms are parsed and
+ * all data is read via inputStream(). So it can be called concurrently for different tracks of a file which is not fragmented
+ * when each track has its own input stream.
+ *
+ * \sa Mp4Container::parseTracksConcurrently()
+ */
+void Mp4Track::parseSampleInformation(Diagnostics &diag)
+{
+    static const string context("parsing MP4 track");
+    using namespace Mp4AtomIds;
+    BinaryReader &reader = m_reader;
+
+    m_size = m_sampleTable.accumulateSampleSizes(*m_istream, 0, m_sampleTable.sampleSizeCount());
+
+    // skip reading the fragments if they are resolved lazily via the "mfra"-atom; only determine the duration from the last one
+    std::uint64_t totalDuration = 0;
+    auto &container = m_trakAtom->container();
+    const auto *const fragmentIndex
+        = container.fileInfo().parsingFlags() & ParsingFlags::LazyMp4Fragments ? container.fragmentIndex(m_id) : nullptr;
+    if (fragmentIndex && !fragmentIndex->empty() && m_duration.isNull()) {
+        const auto &lastEntry = fragmentIndex->back();
+        try {
+            totalDuration = lastEntry.time + readFragment(lastEntry.movieFragmentOffset, diag).duration;
+        } catch (const Failure &) {
+            diag.emplace_back(DiagLevel::Warning, "Unable to read the last movie fragment denoted by the mfra atom.", context);
         }
     }
 
     // no sample sizes found, search for trun atoms
-    std::uint64_t totalDuration = 0;
-    for (Mp4Atom *moofAtom = m_trakAtom->container().firstElement()->siblingByIdIncludingThis(MovieFragment, diag); moofAtom;
+    for (Mp4Atom *moofAtom = fragmentIndex ? nullptr : container.firstElement()->siblingByIdIncludingThis(MovieFragment, diag); moofAtom;
          moofAtom = moofAtom->siblingById(MovieFragment, diag)) {
         moofAtom->parse(diag);
         for (Mp4Atom *trafAtom = moofAtom->childById(TrackFragment, diag); trafAtom; trafAtom = trafAtom->siblingById(TrackFragment, diag)) {
@@ -1977,6 +2880,7 @@ void Mp4Track::internalParseHeader(Diagnostics &diag)
                                 m_istream->seekg(4, ios_base::cur);
                             }
                         }
+                        loadSampleSizes(); // the sizes of the samples within fragments are appended
                         for (Mp4Atom *trunAtom = trafAtom->childById(TrackFragmentRun, diag); trunAtom;
                              trunAtom = trunAtom->siblingById(TrackFragmentRun, diag)) {
                             std::uint32_t calculatedDataSize = 8;
@@ -2017,6 +2921,10 @@ void Mp4Track::internalParseHeader(Diagnostics &diag)
                                     if (flags & 0x000004) { // first-sample-flags present
                                         m_istream->seekg(4, ios_base::cur);
                                     }
+                                    if (flags & 0x000200) { // sample-size present
+                                        checkSampleTableSize(m_trakAtom->container(), m_sampleSizes.size() + sampleCount, diag, context);
+                                        m_trakAtom->container().accountMemory(static_cast<std::uint64_t>(sampleCount) * sizeof(std::uint32_t));
+                                    }
                                     for (std::uint32_t i = 0; i < sampleCount; ++i) {
                                         if (flags & 0x000100) { // sample-duration present
                                             totalDuration += reader.readUInt32BE();
@@ -2064,6 +2972,16 @@ void Mp4Track::internalParseHeader(Diagnostics &diag)
         m_bitrate = (static_cast<double>(m_size) * 0.0078125) / m_duration.totalSeconds();
     }
 
+    // calculate peak bitrate over windows of one second from the "stts"- and "stsz"-atoms unless denoted by "esds"
+    if (m_maxBitrate < 0.01 && m_maxBitrate > -0.01 && m_timeScale && m_sampleTable.sampleCount()
+        && !(m_trakAtom->container().fileInfo().parsingFlags() & ParsingFlags::SkipTrackStatistics)) {
+        try {
+            m_maxBitrate = static_cast<double>(m_sampleTable.peakWindowSize(*m_istream, m_timeScale)) * 0.0078125;
+        } catch (const Failure &) {
+            diag.emplace_back(DiagLevel::Debug, "Unable to determine the peak bitrate from the sample table.", context);
+        }
+    }
+
     // read stsc atom (only number of entries)
     m_istream->seekg(static_cast<streamoff>(m_stscAtom->dataOffset() + 4));
     m_sampleToChunkEntryCount = reader.readUInt32BE();
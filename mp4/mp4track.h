@@ -1,9 +1,13 @@
 #ifndef TAG_PARSER_MP4TRACK_H
 #define TAG_PARSER_MP4TRACK_H
 
+#include "./mp4sampletable.h"
+
 #include "../abstracttrack.h"
 
 #include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 namespace TagParser {
@@ -12,6 +16,7 @@ class Mp4Atom;
 class Mpeg4Descriptor;
 struct AvcConfiguration;
 struct Av1Configuration;
+struct HevcConfiguration;
 struct TrackHeaderInfo;
 
 class TAG_PARSER_EXPORT Mpeg4AudioSpecificConfig {
@@ -115,7 +120,39 @@ inline bool Mpeg4ElementaryStreamInfo::upstream() const
     return decCfgDescFlags & 0x02;
 }
 
+struct TAG_PARSER_EXPORT Mp4FragmentIndexEntry {
+    /// \brief The presentation time of the random access point in the time scale of the track.
+    std::uint64_t time = 0;
+    /// \brief The offset of the "moof"-atom containing the random access point.
+    std::uint64_t movieFragmentOffset = 0;
+    /// \brief The number of the "traf"-atom within the "moof"-atom (starting at 1).
+    std::uint32_t trackFragmentNumber = 0;
+    /// \brief The number of the "trun"-atom within the "traf"-atom (starting at 1).
+    std::uint32_t trackRunNumber = 0;
+    /// \brief The number of the sample within the "trun"-atom (starting at 1).
+    std::uint32_t sampleNumber = 0;
+};
+
+struct TAG_PARSER_EXPORT Mp4TrackFragment {
+    /// \brief The offset of the "moof"-atom.
+    std::uint64_t movieFragmentOffset = 0;
+    /// \brief The offset of the next "moof"-atom (regardless of the tracks it contains); zero if there is none.
+    std::uint64_t nextMovieFragmentOffset = 0;
+    /// \brief The offsets of the sample data of the "trun"-atoms of the track (the samples of each run are stored contiguously).
+    std::vector<std::uint64_t> chunkOffsets;
+    /// \brief The sizes of the sample data of the "trun"-atoms of the track.
+    std::vector<std::uint64_t> chunkSizes;
+    /// \brief The sizes of the samples of the track.
+    std::vector<std::uint32_t> sampleSizes;
+    /// \brief The decoding time of the first sample in the time scale of the track as denoted by the "tfdt"-atom; zero if not present.
+    std::uint64_t baseMediaDecodeTime = 0;
+    /// \brief The accumulated duration of the samples in the time scale of the track.
+    std::uint64_t duration = 0;
+};
+
 class TAG_PARSER_EXPORT Mp4Track final : public AbstractTrack {
+    friend class Mp4Container;
+
 public:
     Mp4Track(Mp4Atom &trakAtom);
     ~Mp4Track() override;
@@ -124,12 +161,15 @@ public:
     // getter methods specific for MP4 tracks
     Mp4Atom &trakAtom();
     const std::vector<std::uint32_t> &sampleSizes() const;
+    Mp4SampleTable &sampleTable();
     unsigned int chunkOffsetSize() const;
     std::uint32_t chunkCount() const;
     std::uint32_t sampleToChunkEntryCount() const;
     const Mpeg4ElementaryStreamInfo *mpeg4ElementaryStreamInfo() const;
     const AvcConfiguration *avcConfiguration() const;
+    const HevcConfiguration *hevcConfiguration() const;
     const Av1Configuration *av1Configuration() const;
+    void decodeParameterSets(Diagnostics &diag);
 
     // methods to parse configuration details from the track header
     static std::unique_ptr<Mpeg4ElementaryStreamInfo> parseMpeg4ElementaryStreamInfo(
@@ -143,15 +183,25 @@ public:
     std::vector<std::uint64_t> readChunkOffsets(bool parseFragments, Diagnostics &diag);
     std::vector<std::tuple<std::uint32_t, std::uint32_t, std::uint32_t>> readSampleToChunkTable(Diagnostics &diag);
     std::vector<std::uint64_t> readChunkSizes(TagParser::Diagnostics &diag);
+    std::vector<std::uint64_t> readChunkDecodingTimes(Diagnostics &diag);
+    std::vector<std::uint64_t> movieFragmentOffsets(Diagnostics &diag);
+    Mp4TrackFragment readFragment(std::uint64_t movieFragmentOffset, Diagnostics &diag);
+    void validateSampleTable(
+        const std::vector<std::pair<std::uint64_t, std::uint64_t>> &mediaDataRanges, std::size_t spotCheckCount, Diagnostics &diag);
 
     // methods to make the track header
-    void bufferTrackAtoms(Diagnostics &diag);
+    void bufferTrackAtoms(Diagnostics &diag, bool includingSampleTableChildren = false);
+    void compactAtoms(const std::vector<std::uint32_t> &strippedAtomIds, bool stripUnusedSampleGroups, Diagnostics &diag);
+    void discardCompactedAtoms();
     std::uint64_t requiredSize(Diagnostics &diag) const;
     void makeTrack(Diagnostics &diag);
     void makeTrackHeader(Diagnostics &diag);
     void makeMedia(Diagnostics &diag);
     void makeMediaInfo(Diagnostics &diag);
     void makeSampleTable(Diagnostics &diag);
+    bool isChunkOffsetTablePromoted() const;
+    void setChunkOffsetTablePromoted(bool promoted);
+    void setChunkOffsetShift(const std::vector<std::int64_t> &oldMdatOffsets, const std::vector<std::int64_t> &newMdatOffsets);
 
     // methods to update chunk offsets
     void updateChunkOffsets(const std::vector<std::int64_t> &oldMdatOffsets, const std::vector<std::int64_t> &newMdatOffsets);
@@ -159,6 +209,7 @@ public:
     void updateChunkOffset(std::uint32_t chunkIndex, std::uint64_t offset);
 
     static void addInfo(const AvcConfiguration &avcConfig, AbstractTrack &track);
+    static void addInfo(const HevcConfiguration &hevcConfig, AbstractTrack &track);
     static void addInfo(const Av1Configuration &av1Config, AbstractTrack &track);
 
 protected:
@@ -166,10 +217,15 @@ protected:
 
 private:
     // private helper methods
-    std::uint64_t accumulateSampleSizes(std::size_t &sampleIndex, std::size_t count, Diagnostics &diag);
+    void parseDescription(Diagnostics &diag);
+    void parseSampleInformation(Diagnostics &diag);
     void addChunkSizeEntries(
         std::vector<std::uint64_t> &chunkSizeTable, std::size_t count, std::size_t &sampleIndex, std::uint32_t sampleCount, Diagnostics &diag);
     TrackHeaderInfo verifyPresentTrackHeader() const;
+    void loadSampleSizes() const;
+    std::uint64_t promotedChunkOffsetEntryCount() const;
+    void makeChunkOffsetTable(Diagnostics &diag);
+    const std::string *compactedAtom(const Mp4Atom *atom) const;
 
     Mp4Atom *m_trakAtom;
     Mp4Atom *m_tkhdAtom;
@@ -183,12 +239,21 @@ private:
     Mp4Atom *m_stcoAtom;
     Mp4Atom *m_stszAtom;
     std::uint16_t m_framesPerSample;
-    std::vector<std::uint32_t> m_sampleSizes;
+    mutable Mp4SampleTable m_sampleTable;
+    mutable std::vector<std::uint32_t> m_sampleSizes;
+    mutable bool m_sampleSizesLoaded;
+    std::vector<std::uint64_t> m_chunkSizes;
+    bool m_chunkSizesComputed;
     unsigned int m_chunkOffsetSize;
     std::uint32_t m_chunkCount;
     std::uint32_t m_sampleToChunkEntryCount;
+    bool m_chunkOffsetTablePromoted;
+    std::vector<std::int64_t> m_oldMdatOffsets;
+    std::vector<std::int64_t> m_newMdatOffsets;
+    std::vector<std::pair<const Mp4Atom *, std::string>> m_compactedAtoms;
     std::unique_ptr<Mpeg4ElementaryStreamInfo> m_esInfo;
     std::unique_ptr<AvcConfiguration> m_avcConfig;
+    std::unique_ptr<HevcConfiguration> m_hevcConfig;
     std::unique_ptr<Av1Configuration> m_av1Config;
 };
 
@@ -201,15 +266,14 @@ inline Mp4Atom &Mp4Track::trakAtom()
 }
 
 /*!
- * \brief Returns the sample size table for the track.
- * \remarks If the table contains only one size this is the constant
- *          sample size.
- * \remarks The table is empty if the track denotes 64-bit sample sizes.
- * \sa sampleSizes64()
+ * \brief Returns the sample table of the track.
+ *
+ * The sample table allows accessing sample sizes, chunk indices and decoding times by sample index without loading
+ * whole tables into memory. Pass inputStream() to its accessors.
  */
-inline const std::vector<std::uint32_t> &Mp4Track::sampleSizes() const
+inline Mp4SampleTable &Mp4Track::sampleTable()
 {
-    return m_sampleSizes;
+    return m_sampleTable;
 }
 
 /*!
@@ -222,6 +286,31 @@ inline unsigned int Mp4Track::chunkOffsetSize() const
     return m_chunkOffsetSize;
 }
 
+/*!
+ * \brief Returns whether the "stco"-atom is replaced by a "co64"-atom when making the track.
+ * \sa setChunkOffsetTablePromoted()
+ */
+inline bool Mp4Track::isChunkOffsetTablePromoted() const
+{
+    return m_chunkOffsetTablePromoted;
+}
+
+/*!
+ * \brief Sets whether the "stco"-atom is replaced by a "co64"-atom when making the track.
+ *
+ * The 32-bit chunk offsets of the "stco"-atom overflow when the media data is moved beyond 4 GiB. If enabled,
+ * makeTrack() writes the chunk offsets as 64-bit values (keeping their values) so updateChunkOffsets() can shift them
+ * afterwards. requiredSize() takes the bigger table into account.
+ *
+ * \remarks
+ * - Has no effect if the track already uses a "co64"-atom.
+ * - This is done automatically by Mp4Container when rewriting a file if necessary.
+ */
+inline void Mp4Track::setChunkOffsetTablePromoted(bool promoted)
+{
+    m_chunkOffsetTablePromoted = promoted;
+}
+
 /*!
  * \brief Returns the number of chunks denoted by the stco atom.
  */
@@ -261,6 +350,17 @@ inline const AvcConfiguration *Mp4Track::avcConfiguration() const
     return m_avcConfig.get();
 }
 
+/*!
+ * \brief Returns the HEVC configuration.
+ * \remarks
+ *  - The track must be parsed before this information becomes available.
+ *  - The track keeps ownership over the returned object.
+ */
+inline const HevcConfiguration *Mp4Track::hevcConfiguration() const
+{
+    return m_hevcConfig.get();
+}
+
 /*!
  * \brief Returns the AV1 configuration.
  * \remarks
@@ -55,6 +55,7 @@ std::string Mpeg4Descriptor::idToString() const
  */
 void Mpeg4Descriptor::internalParse(Diagnostics &diag)
 {
+    container().countParsedElement();
     if (maxTotalSize() < minimumElementSize()) {
         diag.emplace_back(DiagLevel::Critical,
             "Descriptor is smaller than 2 byte and hence invalid. The maximum size within the encloding element is " % numberToString(maxTotalSize())
@@ -86,9 +87,10 @@ void Mpeg4Descriptor::internalParse(Diagnostics &diag)
         return;
     }
     if (parent()) {
-        m_nextSibling.reset(new Mpeg4Descriptor(*(parent()), startOffset() + totalSize()));
+        m_nextSibling.reset(new (container().elementArena()) Mpeg4Descriptor(*(parent()), startOffset() + totalSize()));
     } else {
-        m_nextSibling.reset(new Mpeg4Descriptor(container(), startOffset() + totalSize(), maxTotalSize() - totalSize()));
+        m_nextSibling.reset(
+            new (container().elementArena()) Mpeg4Descriptor(container(), startOffset() + totalSize(), maxTotalSize() - totalSize()));
     }
 }
 
@@ -6,6 +6,14 @@
 #include <c++utilities/conversion/stringconversion.h>
 #include <c++utilities/io/binaryreader.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TAG_PARSER_MPEG_AUDIO_SCAN_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define TAG_PARSER_MPEG_AUDIO_SCAN_NEON
+#include <arm_neon.h>
+#endif
+
 using namespace std;
 using namespace CppUtilities;
 
@@ -47,21 +55,40 @@ const std::uint16_t MpegAudioFrame::s_bitrateTable[0x2][0x3][0xF] = { { { 0, 32,
  *         no valid frame header.
  */
 void MpegAudioFrame::parseHeader(BinaryReader &reader, Diagnostics &diag)
+{
+    throwOnParsingError(tryParseHeader(reader, diag));
+}
+
+/*!
+ * \brief Parses the header read using the specified \a reader like parseHeader() but returns parsing errors instead of
+ *        throwing.
+ * \returns Returns ParsingError::InvalidData if the data read from the stream is no valid frame header.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ * \remarks This is used when skipping junk (see MpegAudioFrameStream) where many positions are checked.
+ */
+ParsingError MpegAudioFrame::tryParseHeader(BinaryReader &reader, Diagnostics &diag)
 {
     // read MPEG audio frame header
     m_header = reader.readUInt32BE();
     if (!isValid()) {
-        diag.emplace_back(DiagLevel::Critical,
-            "Frame 0x" % numberToString(m_header, 16) % " at 0x" % numberToString<std::int64_t>(reader.stream()->tellg() - 4l, 16) + " is invalid.",
-            "parsing MPEG audio frame header");
-        throw InvalidDataException();
+        static const auto context = std::string("parsing MPEG audio frame header");
+        diag.emplace_back(
+            DiagLevel::Critical,
+            [&] {
+                return "Frame 0x" % numberToString(m_header, 16) % " at 0x" % numberToString<std::int64_t>(reader.stream()->tellg() - 4l, 16)
+                    + " is invalid.";
+            },
+            context);
+        return ParsingError::InvalidData;
     }
 
     // read XING header (see https://www.codeproject.com/Articles/8295/MPEG-Audio-Frame-Header#XINGHeader)
-    if (size() < s_xingHeaderOffset - 4 + 8) {
-        return;
+    // -> it is located behind the side information whose size depends on the MPEG version and the channel mode
+    const auto xingHeaderOffset = sideInformationOffset();
+    if (size() < xingHeaderOffset + 8) {
+        return ParsingError::None;
     }
-    reader.stream()->seekg(s_xingHeaderOffset - 4, ios_base::cur);
+    reader.stream()->seekg(xingHeaderOffset - 4, ios_base::cur);
     m_xingHeader = reader.readUInt64BE();
     if (isXingHeaderAvailable()) {
         m_xingHeaderFlags = static_cast<XingHeaderFlags>(m_xingHeader & 0xffffffffuL);
@@ -72,12 +99,79 @@ void MpegAudioFrame::parseHeader(BinaryReader &reader, Diagnostics &diag)
             m_xingBytesfield = reader.readUInt32BE();
         }
         if (isXingTocFieldPresent()) {
-            reader.stream()->seekg(64, ios_base::cur);
+            reader.read(reinterpret_cast<char *>(m_xingToc.data()), static_cast<std::streamsize>(m_xingToc.size()));
         }
         if (isXingQualityIndicatorFieldPresent()) {
             m_xingQualityIndicator = reader.readUInt32BE();
         }
+        const auto lameTagOffset = xingHeaderOffset + 8 + (isXingFramefieldPresent() ? 4 : 0) + (isXingBytesfieldPresent() ? 4 : 0)
+            + (isXingTocFieldPresent() ? 100 : 0) + (isXingQualityIndicatorFieldPresent() ? 4 : 0);
+        if (size() >= lameTagOffset + 36) {
+            parseLameTag(reader);
+        }
+    }
+    return ParsingError::None;
+}
+
+/*!
+ * \brief Parses the LAME tag which might follow the Xing header.
+ * \remarks See http://gabriel.mp3-tech.org/mp3infotag.html for the format.
+ */
+void MpegAudioFrame::parseLameTag(BinaryReader &reader)
+{
+    auto tag = std::array<char, 36>();
+    reader.read(tag.data(), static_cast<std::streamsize>(tag.size()));
+    if (tag[0] != 'L' || (std::string_view(tag.data(), 4) != "LAME" && std::string_view(tag.data(), 4) != "Lavf"
+                             && std::string_view(tag.data(), 4) != "Lavc")) {
+        return;
+    }
+    std::copy(tag.cbegin(), tag.cbegin() + static_cast<std::ptrdiff_t>(m_lameEncoder.size()), m_lameEncoder.begin());
+    const auto *const delayAndPadding = reinterpret_cast<const std::uint8_t *>(tag.data() + 21);
+    m_encoderDelay = static_cast<std::uint16_t>((delayAndPadding[0] << 4) | (delayAndPadding[1] >> 4));
+    m_encoderPadding = static_cast<std::uint16_t>(((delayAndPadding[1] & 0x0F) << 8) | delayAndPadding[2]);
+}
+
+/*!
+ * \brief Returns the index of the first sync word (11 set bits) within the specified \a buffer.
+ * \returns Returns \a size if the buffer contains no sync word.
+ * \remarks
+ * - A position is only considered if the byte following it is within the buffer as well. So the last byte of the
+ *   buffer needs to be checked again when scanning consecutive blocks.
+ * - The buffer is scanned 16 bytes at a time using SSE2 or NEON if available.
+ */
+std::size_t MpegAudioFrame::findSyncWord(const char *buffer, std::size_t size)
+{
+    if (size < 2) {
+        return size;
+    }
+    const auto *const data = reinterpret_cast<const unsigned char *>(buffer);
+    auto i = std::size_t();
+#if defined(TAG_PARSER_MPEG_AUDIO_SCAN_SSE2)
+    // compare 16 positions at a time with their following bytes; the exact position is determined by the loop below
+    const auto firstByte = _mm_set1_epi8(static_cast<char>(0xFF));
+    const auto secondByteMask = _mm_set1_epi8(static_cast<char>(0xE0));
+    for (; i + 16 < size; i += 16) {
+        const auto first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const auto second = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 1)), secondByteMask);
+        if (_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, firstByte), _mm_cmpeq_epi8(second, secondByteMask)))) {
+            break;
+        }
+    }
+#elif defined(TAG_PARSER_MPEG_AUDIO_SCAN_NEON)
+    for (; i + 16 < size; i += 16) {
+        const auto first = vceqq_u8(vld1q_u8(data + i), vdupq_n_u8(0xFF));
+        const auto second = vcgeq_u8(vld1q_u8(data + i + 1), vdupq_n_u8(0xE0));
+        if (vmaxvq_u8(vandq_u8(first, second))) {
+            break;
+        }
     }
+#endif
+    for (const auto end = size - 1; i < end; ++i) {
+        if (data[i] == 0xFF && data[i + 1] >= 0xE0) {
+            return i;
+        }
+    }
+    return size;
 }
 
 /*!
@@ -200,22 +294,34 @@ std::uint32_t MpegAudioFrame::sampleCount() const
     return 0;
 }
 
+/*!
+ * \brief Returns the offset of the data following the side information from the start of the frame.
+ * \remarks This is where the Xing header is located.
+ */
+std::uint32_t MpegAudioFrame::sideInformationOffset() const
+{
+    const auto isMono = channelMode() == MpegChannelMode::SingleChannel;
+    const auto sideInformationSize = mpegVersion() == 1.0 ? (isMono ? 17u : 32u) : (isMono ? 9u : 17u);
+    return 4u + (isProtectedByCrc() ? 2u : 0u) + sideInformationSize;
+}
+
 /*!
  * \brief Returns the size if known; otherwise retruns 0.
  */
 std::uint32_t MpegAudioFrame::size() const
 {
+    const auto frequency = samplingFrequency();
+    if (!frequency) {
+        return 0;
+    }
+    // the bitrate table is in kbit/s (1000 bit/s); layer 1 frames consist of 4 byte slots
+    const auto bitsPerSecond = static_cast<std::uint32_t>(bitrate()) * 1000u;
     switch (m_header & 0x60000u) {
     case 0x60000u: // layer 1
-        return static_cast<std::uint32_t>(
-                   ((static_cast<double>(bitrate()) * 1024.0 / 8.0) / static_cast<double>(samplingFrequency())) * static_cast<double>(sampleCount())
-                   + static_cast<double>(paddingSize()))
-            * 4;
+        return (sampleCount() / 32u * bitsPerSecond / frequency) * 4u + paddingSize();
     case 0x40000u: // layer 2
     case 0x20000u: // layer 3
-        return static_cast<std::uint32_t>(
-            ((static_cast<double>(bitrate()) * 1024.0 / 8.0) / static_cast<double>(samplingFrequency())) * static_cast<double>(sampleCount())
-            + static_cast<double>(paddingSize()));
+        return sampleCount() / 8u * bitsPerSecond / frequency + paddingSize();
     default:
         return 0;
     }
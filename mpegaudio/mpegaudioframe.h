@@ -2,9 +2,15 @@
 #define TAG_PARSER_MP3FRAMEAUDIOSTREAM_H
 
 #include "../diagnostics.h"
+#include "../exceptions.h"
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <cstdint>
-#include <iostream>
+#include <istream>
+#include <ostream>
+#include <string_view>
 
 namespace CppUtilities {
 class BinaryReader;
@@ -36,10 +42,14 @@ enum class XingHeaderFlags {
 class TAG_PARSER_EXPORT MpegAudioFrame {
 public:
     constexpr MpegAudioFrame();
+    constexpr explicit MpegAudioFrame(std::uint32_t header);
 
     void parseHeader(CppUtilities::BinaryReader &reader, Diagnostics &diag);
+    ParsingError tryParseHeader(CppUtilities::BinaryReader &reader, Diagnostics &diag);
+    static std::size_t findSyncWord(const char *buffer, std::size_t size);
 
     constexpr bool isValid() const;
+    constexpr std::uint32_t header() const;
     double mpegVersion() const;
     int layer() const;
     constexpr bool isProtectedByCrc() const;
@@ -51,6 +61,7 @@ public:
     constexpr bool isOriginal() const;
     std::uint32_t sampleCount() const;
     std::uint32_t size() const;
+    std::uint32_t sideInformationOffset() const;
     constexpr bool isXingHeaderAvailable() const;
     constexpr XingHeaderFlags xingHeaderFlags() const;
     constexpr bool isXingFramefieldPresent() const;
@@ -60,9 +71,18 @@ public:
     constexpr std::uint32_t xingFrameCount() const;
     constexpr std::uint32_t xingBytesfield() const;
     constexpr std::uint32_t xingQualityIndicator() const;
+    constexpr const std::array<std::uint8_t, 100> &xingToc() const;
+    constexpr bool isLameTagAvailable() const;
+    std::string_view lameEncoder() const;
+    constexpr std::uint16_t encoderDelay() const;
+    constexpr std::uint16_t encoderPadding() const;
+
+    /// \brief The offset of the VBRI header from the start of the frame (it is always behind 32 bytes of side information).
+    static constexpr std::uint32_t vbriHeaderOffset = 0x24;
 
 private:
-    static constexpr std::uint64_t s_xingHeaderOffset = 0x24;
+    void parseLameTag(CppUtilities::BinaryReader &reader);
+
     static constexpr std::uint32_t s_sync = 0xFFE00000u;
     static const std::uint16_t s_bitrateTable[0x2][0x3][0xF];
     std::uint32_t m_header;
@@ -71,6 +91,10 @@ private:
     std::uint32_t m_xingFramefield;
     std::uint32_t m_xingBytesfield;
     std::uint32_t m_xingQualityIndicator;
+    std::array<std::uint8_t, 100> m_xingToc;
+    std::array<char, 9> m_lameEncoder;
+    std::uint16_t m_encoderDelay;
+    std::uint16_t m_encoderPadding;
 };
 
 /*!
@@ -83,6 +107,28 @@ constexpr MpegAudioFrame::MpegAudioFrame()
     , m_xingFramefield(0)
     , m_xingBytesfield(0)
     , m_xingQualityIndicator(0)
+    , m_xingToc()
+    , m_lameEncoder()
+    , m_encoderDelay(0)
+    , m_encoderPadding(0)
+{
+}
+
+/*!
+ * \brief Constructs a new frame from the specified (already read) \a header.
+ * \remarks This allows walking through frames within a buffer. The Xing header is not taken into account.
+ */
+constexpr MpegAudioFrame::MpegAudioFrame(std::uint32_t header)
+    : m_header(header)
+    , m_xingHeader(0)
+    , m_xingHeaderFlags(XingHeaderFlags::None)
+    , m_xingFramefield(0)
+    , m_xingBytesfield(0)
+    , m_xingQualityIndicator(0)
+    , m_xingToc()
+    , m_lameEncoder()
+    , m_encoderDelay(0)
+    , m_encoderPadding(0)
 {
 }
 
@@ -94,6 +140,14 @@ constexpr bool MpegAudioFrame::isValid() const
     return (m_header & s_sync) == s_sync;
 }
 
+/*!
+ * \brief Returns the raw header of the frame.
+ */
+constexpr std::uint32_t MpegAudioFrame::header() const
+{
+    return m_header;
+}
+
 /*!
  * \brief Returns an indication whether the frame is protected by CRC.
  */
@@ -107,7 +161,7 @@ constexpr bool MpegAudioFrame::isProtectedByCrc() const
  */
 inline std::uint16_t MpegAudioFrame::bitrate() const
 {
-    if (mpegVersion() > 0.0 && layer() > 0) {
+    if (mpegVersion() > 0.0 && layer() > 0 && (m_header & 0xf000u) != 0xf000u) {
         return s_bitrateTable[mpegVersion() == 1.0 ? 0 : 1][layer() - 1][(m_header & 0xf000u) >> 12];
     } else {
         return 0;
@@ -157,7 +211,7 @@ constexpr XingHeaderFlags operator&(XingHeaderFlags lhs, XingHeaderFlags rhs)
  */
 constexpr bool MpegAudioFrame::isXingHeaderAvailable() const
 {
-    return ((m_xingHeader & 0x58696e6700000000uL) == 0x58696e6700000000uL) || ((m_xingHeader & 0x496e666f00000000uL) == 0x496e666f00000000uL);
+    return (m_xingHeader >> 32) == 0x58696e67u /* Xing */ || (m_xingHeader >> 32) == 0x496e666fu /* Info */;
 }
 
 /*!
@@ -181,7 +235,7 @@ constexpr bool MpegAudioFrame::isXingFramefieldPresent() const
  */
 constexpr bool MpegAudioFrame::isXingBytesfieldPresent() const
 {
-    return (isXingHeaderAvailable()) ? ((m_xingHeaderFlags & XingHeaderFlags::HasFramesField) == XingHeaderFlags::HasFramesField) : false;
+    return (isXingHeaderAvailable()) ? ((m_xingHeaderFlags & XingHeaderFlags::HasBytesField) == XingHeaderFlags::HasBytesField) : false;
 }
 
 /*!
@@ -224,6 +278,54 @@ constexpr std::uint32_t MpegAudioFrame::xingQualityIndicator() const
     return m_xingQualityIndicator;
 }
 
+/*!
+ * \brief Returns the Xing TOC if present; otherwise all entries are 0.
+ *
+ * Entry \a i is the position of the frame at \a i percent of the duration in 1/256 of xingBytesfield(), relative to the
+ * start of this frame.
+ *
+ * \sa isXingTocFieldPresent()
+ */
+constexpr const std::array<std::uint8_t, 100> &MpegAudioFrame::xingToc() const
+{
+    return m_xingToc;
+}
+
+/*!
+ * \brief Returns whether a LAME tag (also written e.g. by FFmpeg) follows the Xing header.
+ */
+constexpr bool MpegAudioFrame::isLameTagAvailable() const
+{
+    return m_lameEncoder[0] != 0;
+}
+
+/*!
+ * \brief Returns the encoder version denoted by the LAME tag (e.g. "LAME3.100") if present; otherwise returns an empty string.
+ */
+inline std::string_view MpegAudioFrame::lameEncoder() const
+{
+    const auto end = std::find(m_lameEncoder.cbegin(), m_lameEncoder.cend(), '\0');
+    return std::string_view(m_lameEncoder.data(), static_cast<std::size_t>(end - m_lameEncoder.cbegin()));
+}
+
+/*!
+ * \brief Returns the number of samples the encoder added at the beginning if denoted by the LAME tag; otherwise returns 0.
+ * \remarks A gapless player skips these samples.
+ */
+constexpr std::uint16_t MpegAudioFrame::encoderDelay() const
+{
+    return m_encoderDelay;
+}
+
+/*!
+ * \brief Returns the number of samples the encoder added at the end if denoted by the LAME tag; otherwise returns 0.
+ * \remarks A gapless player skips these samples.
+ */
+constexpr std::uint16_t MpegAudioFrame::encoderPadding() const
+{
+    return m_encoderPadding;
+}
+
 } // namespace TagParser
 
 #endif // TAG_PARSER_MP3FRAMEAUDIOSTREAM_H
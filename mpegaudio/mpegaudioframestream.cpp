@@ -2,14 +2,203 @@
 
 #include "../exceptions.h"
 #include "../mediaformat.h"
+#include "../tailprobe.h"
 
+#include <c++utilities/conversion/binaryconversion.h>
+
+#include <algorithm>
+#include <array>
+#include <memory>
 #include <sstream>
+#include <limits>
+#include <thread>
+#include <vector>
 
 using namespace std;
 using namespace CppUtilities;
 
 namespace TagParser {
 
+namespace {
+
+/// \brief The size of the segments the audio data is split into when computing the exact duration.
+constexpr std::size_t segmentSize = 0x400000;
+/// \brief The number of bytes read beyond the end of a segment to check the frames crossing its end.
+constexpr std::size_t segmentOverlap = 0x4000;
+/// \brief The number of consecutive frames needed to consider a sync word within a segment as frame boundary.
+constexpr std::size_t syncFrameCount = 3;
+
+/*!
+ * \brief The SegmentScan struct holds the result of scanning the frames starting within a segment.
+ */
+struct SegmentScan {
+    std::uint64_t firstFrameOffset = 0;
+    std::uint64_t nextFrameOffset = 0;
+    std::uint64_t frameCount = 0;
+    std::uint64_t sampleCount = 0;
+    std::vector<std::uint64_t> frameOffsets;
+};
+
+/*!
+ * \brief The FrameScanner struct walks through the frames within a buffered segment.
+ *
+ * A segment might start in the middle of a frame. So frame boundaries are only assumed at sync words which are
+ * followed by further frames with the properties of the first frame of the stream.
+ */
+struct FrameScanner {
+    bool isMatching(const MpegAudioFrame &frame) const;
+    bool isSyncPoint(std::size_t index) const;
+    std::size_t findSyncPoint(std::size_t index, std::size_t end) const;
+    SegmentScan scan(std::size_t begin, std::size_t end, bool synchronized) const;
+
+    const MpegAudioFrame &reference;
+    const char *buffer;
+    std::size_t bufferSize;
+    std::uint64_t bufferOffset;
+    bool collectFrameOffsets;
+};
+
+/*!
+ * \brief Returns whether \a frame is valid and has the same properties as the reference frame.
+ */
+bool FrameScanner::isMatching(const MpegAudioFrame &frame) const
+{
+    return frame.isValid() && frame.size() >= 4 && frame.mpegVersion() == reference.mpegVersion() && frame.layer() == reference.layer()
+        && frame.samplingFrequency() == reference.samplingFrequency();
+}
+
+/*!
+ * \brief Returns whether the frame at \a index and the frames following it are matching.
+ * \remarks Frames beyond the buffer are assumed to be matching.
+ */
+bool FrameScanner::isSyncPoint(std::size_t index) const
+{
+    for (auto i = std::size_t(); i != syncFrameCount && index + 4 <= bufferSize; ++i) {
+        const auto frame = MpegAudioFrame(BE::toUInt32(buffer + index));
+        if (!isMatching(frame)) {
+            return false;
+        }
+        index += frame.size();
+    }
+    return true;
+}
+
+/*!
+ * \brief Returns the index of the first sync point within [\a index, \a end) or \a end if there is none.
+ */
+std::size_t FrameScanner::findSyncPoint(std::size_t index, std::size_t end) const
+{
+    const auto scanEnd = std::min(bufferSize, end + 1);
+    while (index < end) {
+        const auto candidate = index + MpegAudioFrame::findSyncWord(buffer + index, scanEnd - index);
+        if (candidate >= end) {
+            break;
+        }
+        if (isSyncPoint(candidate)) {
+            return candidate;
+        }
+        index = candidate + 1;
+    }
+    return end;
+}
+
+/*!
+ * \brief Walks through the frames starting within [\a begin, \a end).
+ * \remarks If not \a synchronized, the first frame is searched instead of being expected at \a begin.
+ */
+SegmentScan FrameScanner::scan(std::size_t begin, std::size_t end, bool synchronized) const
+{
+    auto result = SegmentScan();
+    auto index = synchronized ? begin : findSyncPoint(begin, end);
+    result.firstFrameOffset = bufferOffset + index;
+    while (index < end && index + 4 <= bufferSize) {
+        const auto frame = MpegAudioFrame(BE::toUInt32(buffer + index));
+        if (!isMatching(frame)) {
+            index = findSyncPoint(index + 1, end);
+            continue;
+        }
+        if (collectFrameOffsets) {
+            result.frameOffsets.emplace_back(bufferOffset + index);
+        }
+        ++result.frameCount;
+        result.sampleCount += frame.sampleCount();
+        index += frame.size();
+    }
+    result.nextFrameOffset = bufferOffset + index;
+    return result;
+}
+
+/*!
+ * \brief Walks through the frames within [\a startOffset, \a endOffset) of the specified \a stream.
+ *
+ * The range is split into segments which are read sequentially but scanned by \a threadCount threads in parallel.
+ * Each segment is synchronized on its own. If a segment has not been synchronized on the frame the previous segment
+ * ended with, it is scanned again starting from that frame.
+ *
+ * \remarks The offsets of all frames are only collected if \a collectFrameOffsets is set.
+ */
+SegmentScan scanFrames(std::istream &stream, const MpegAudioFrame &firstFrame, std::uint64_t startOffset, std::uint64_t endOffset,
+    std::size_t threadCount, bool collectFrameOffsets)
+{
+    auto total = SegmentScan();
+    total.firstFrameOffset = total.nextFrameOffset = startOffset;
+    if (startOffset >= endOffset || !firstFrame.samplingFrequency()) {
+        return total;
+    }
+    const auto segmentCount = (endOffset - startOffset + segmentSize - 1) / segmentSize;
+    auto buffers = vector<unique_ptr<char[]>>(static_cast<std::size_t>(min<std::uint64_t>(threadCount, segmentCount)));
+    auto scanners = vector<FrameScanner>();
+    auto results = vector<SegmentScan>(buffers.size());
+    auto workers = vector<thread>();
+    scanners.reserve(buffers.size());
+    workers.reserve(buffers.size());
+    for (auto &buffer : buffers) {
+        buffer = make_unique<char[]>(segmentSize + segmentOverlap);
+    }
+    for (auto segment = std::uint64_t(); segment < segmentCount; segment += buffers.size()) {
+        // read the segments of this batch
+        const auto batchSize = static_cast<std::size_t>(min<std::uint64_t>(buffers.size(), segmentCount - segment));
+        scanners.clear();
+        for (auto i = std::size_t(); i != batchSize; ++i) {
+            const auto segmentOffset = startOffset + (segment + i) * segmentSize;
+            const auto bufferSize = static_cast<std::size_t>(min<std::uint64_t>(segmentSize + segmentOverlap, endOffset - segmentOffset));
+            stream.seekg(static_cast<streamoff>(segmentOffset), ios_base::beg);
+            stream.read(buffers[i].get(), static_cast<streamsize>(bufferSize));
+            scanners.emplace_back(FrameScanner{ firstFrame, buffers[i].get(), bufferSize, segmentOffset, collectFrameOffsets });
+        }
+
+        // scan the segments; the first one is continued from the frame the previous batch ended with
+        const auto segmentEnd = [&](std::size_t i) { return min(segmentSize, scanners[i].bufferSize); };
+        const auto continuedScan = [&](std::size_t i) {
+            const auto begin = min<std::uint64_t>(total.nextFrameOffset - scanners[i].bufferOffset, segmentEnd(i));
+            return scanners[i].scan(static_cast<std::size_t>(begin), segmentEnd(i), true);
+        };
+        for (auto i = std::size_t(1); i < batchSize; ++i) {
+            workers.emplace_back([&, i] { results[i] = scanners[i].scan(0, segmentEnd(i), false); });
+        }
+        results[0] = continuedScan(0);
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+
+        // sum up the results, re-scanning segments which are not continuing the previous one
+        for (auto i = std::size_t(); i != batchSize; ++i) {
+            auto &result = results[i];
+            if (result.firstFrameOffset != total.nextFrameOffset) {
+                result = continuedScan(i);
+            }
+            total.frameCount += result.frameCount;
+            total.sampleCount += result.sampleCount;
+            total.nextFrameOffset = result.nextFrameOffset;
+            total.frameOffsets.insert(total.frameOffsets.end(), result.frameOffsets.cbegin(), result.frameOffsets.cend());
+        }
+    }
+    return total;
+}
+
+} // namespace
+
 /*!
  * \class TagParser::MpegAudioFrameStream
  * \brief Implementation of TagParser::AbstractTrack MPEG audio streams.
@@ -33,24 +222,35 @@ void MpegAudioFrameStream::internalParseHeader(Diagnostics &diag)
     if (!m_istream) {
         throw NoDataFoundException();
     }
-    // get size
-    m_istream->seekg(-128, ios_base::end);
-    if (m_reader.readUInt24BE() == 0x544147) {
-        m_size = static_cast<std::uint64_t>(m_istream->tellg()) - 3u - m_startOffset;
+    // get size: the audio data ends in front of the tags at the end of the file
+    // note: Not possible if the stream is forward-only; the Xing/VBRI header might denote it though.
+    if (m_forwardOnly) {
+        m_size = 0;
     } else {
-        m_size = static_cast<std::uint64_t>(m_istream->tellg()) + 125u - m_startOffset;
+        auto localTailProbe = TailProbe();
+        const auto *tailProbe = m_tailProbe;
+        if (!tailProbe || !tailProbe->probed) {
+            localTailProbe.probe(*m_istream);
+            tailProbe = &localTailProbe;
+        }
+        m_size = tailProbe->audioEndOffset > m_startOffset ? tailProbe->audioEndOffset - m_startOffset : 0;
     }
     m_istream->seekg(static_cast<streamoff>(m_startOffset), ios_base::beg);
+    m_seekTable.clear();
+    m_encoderDelay = m_encoderPadding = 0;
+    m_vbriHeaderAvailable = false;
     // parse frames until the first valid, non-empty frame is reached
-    for (size_t invalidByteskipped = 0; m_frames.size() < 200 && invalidByteskipped <= 0x600u;) {
+    // -> only report the first invalid byte; messages for further junk bytes are discarded without constructing them
+    // -> skip junk by scanning for the next sync word within a buffer rather than parsing the header at each position
+    const auto endOffset = m_dataEndOffset = m_forwardOnly ? numeric_limits<std::uint64_t>::max() : m_startOffset + m_size;
+    auto junkDiag = Diagnostics();
+    junkDiag.setLevelThreshold(worstDiagLevel);
+    auto frameOffset = std::uint64_t();
+    for (size_t invalidByteskipped = 0; m_frames.size() < 200 && invalidByteskipped <= m_maxJunkSize;) {
         MpegAudioFrame &frame = invalidByteskipped > 0 ? m_frames.back() : m_frames.emplace_back();
-        try {
-            frame.parseHeader(m_reader, diag);
-        } catch (const InvalidDataException &e) {
-            if (++invalidByteskipped > 1) {
-                diag.pop_back();
-            }
-            m_istream->seekg(-3, ios_base::cur);
+        const auto headerOffset = frameOffset = static_cast<std::uint64_t>(m_istream->tellg());
+        if (frame.tryParseHeader(m_reader, invalidByteskipped ? junkDiag : diag) != ParsingError::None) {
+            invalidByteskipped += 1 + findNextSyncWord(headerOffset + 1, endOffset, m_maxJunkSize - invalidByteskipped);
             continue;
         }
         if (invalidByteskipped > 1) {
@@ -69,7 +269,12 @@ void MpegAudioFrameStream::internalParseHeader(Diagnostics &diag)
         return;
     }
     const MpegAudioFrame &frame = m_frames.back();
+    m_firstFrameOffset = frameOffset;
     addInfo(frame, *this);
+    if (frame.isLameTagAvailable()) {
+        m_encoderDelay = frame.encoderDelay();
+        m_encoderPadding = frame.encoderPadding();
+    }
     if (frame.isXingBytesfieldPresent()) {
         std::uint32_t xingSize = frame.xingBytesfield();
         if (m_size && xingSize != m_size) {
@@ -79,10 +284,264 @@ void MpegAudioFrameStream::internalParseHeader(Diagnostics &diag)
             m_size = xingSize;
         }
     }
-    m_bitrate = frame.isXingFramefieldPresent() ? ((static_cast<double>(m_size) * 8.0)
-                    / (static_cast<double>(frame.xingFrameCount() * frame.sampleCount()) / static_cast<double>(frame.samplingFrequency())) / 1024.0)
-                                                : frame.bitrate();
-    m_duration = TimeSpan::fromSeconds(static_cast<double>(m_size) / (m_bytesPerSecond = static_cast<std::uint32_t>(m_bitrate * 125)));
+    if (m_forwardOnly && !m_size && frame.isXingFramefieldPresent()) {
+        // compute the duration from the frame count if the size is unknown
+        m_bitrate = frame.bitrate();
+        m_bytesPerSecond = static_cast<std::uint32_t>(m_bitrate * 125);
+        m_duration = TimeSpan::fromSeconds(
+            static_cast<double>(frame.xingFrameCount() * frame.sampleCount()) / static_cast<double>(frame.samplingFrequency()));
+    } else {
+        m_bitrate = frame.isXingFramefieldPresent() ? ((static_cast<double>(m_size) * 8.0)
+                        / (static_cast<double>(frame.xingFrameCount() * frame.sampleCount()) / static_cast<double>(frame.samplingFrequency()))
+                        / 1024.0)
+                                                    : frame.bitrate();
+        m_duration = TimeSpan::fromSeconds(static_cast<double>(m_size) / (m_bytesPerSecond = static_cast<std::uint32_t>(m_bitrate * 125)));
+    }
+    if (frame.isXingHeaderAvailable()) {
+        makeXingSeekTable(frame);
+    } else {
+        parseVbriHeader(frame, diag);
+    }
+    if (m_forwardOnly) {
+        m_dataEndOffset = m_startOffset + m_size;
+        if (!m_size) {
+            diag.emplace_back(DiagLevel::Information,
+                "The input is forward-only and there is no Xing/VBRI header denoting the size of the MPEG audio frames. Hence the size can not "
+                "be determined and the duration is only known if the Xing header denotes the frame count.",
+                context);
+        }
+        if (m_exactDurationEnabled) {
+            diag.emplace_back(DiagLevel::Information, "The input is forward-only so the exact duration is not determined.", context);
+        }
+        return;
+    }
+    if (m_exactDurationEnabled) {
+        // don't count the frame containing the Xing/VBRI header as it contains no audio
+        const auto hasHeaderFrame = frame.isXingHeaderAvailable() || m_vbriHeaderAvailable;
+        computeExactDuration(frame, hasHeaderFrame ? frameOffset + frame.size() : frameOffset, endOffset, diag);
+    }
+}
+
+/*!
+ * \brief Populates the seek table from the TOC of the Xing header of the specified \a frame.
+ */
+void MpegAudioFrameStream::makeXingSeekTable(const MpegAudioFrame &frame)
+{
+    if (!frame.isXingTocFieldPresent() || m_duration.isNull()) {
+        return;
+    }
+    const auto &toc = frame.xingToc();
+    const auto bytes = frame.isXingBytesfieldPresent() ? frame.xingBytesfield() : m_size;
+    m_seekTable.reserve(toc.size());
+    for (auto i = std::size_t(); i != toc.size(); ++i) {
+        auto &point = m_seekTable.emplace_back();
+        point.time = TimeSpan(m_duration.totalTicks() / static_cast<std::int64_t>(toc.size()) * static_cast<std::int64_t>(i));
+        point.offset = m_firstFrameOffset + toc[i] * bytes / 256;
+    }
+}
+
+/*!
+ * \brief Parses the Fraunhofer VBRI header which might be present in the specified \a frame instead of a Xing header.
+ * \remarks Updates the size, duration and bitrate and populates the seek table if the header is present.
+ */
+void MpegAudioFrameStream::parseVbriHeader(const MpegAudioFrame &frame, Diagnostics &diag)
+{
+    static const string context("parsing VBRI header");
+    constexpr auto vbriHeaderSize = 26u;
+    if (frame.size() < MpegAudioFrame::vbriHeaderOffset + vbriHeaderSize) {
+        return;
+    }
+    m_istream->seekg(static_cast<streamoff>(m_firstFrameOffset + MpegAudioFrame::vbriHeaderOffset), ios_base::beg);
+    auto header = std::array<char, vbriHeaderSize>();
+    m_istream->read(header.data(), header.size());
+    if (BE::toUInt32(header.data()) != 0x56425249u /* VBRI */) {
+        return;
+    }
+    m_vbriHeaderAvailable = true;
+    m_encoderDelay = BE::toUInt16(header.data() + 6);
+    const auto bytes = BE::toUInt32(header.data() + 10);
+    const auto frameCount = BE::toUInt32(header.data() + 14);
+    const auto tocEntryCount = BE::toUInt16(header.data() + 18);
+    const auto tocScale = BE::toUInt16(header.data() + 20);
+    const auto tocEntrySize = BE::toUInt16(header.data() + 22);
+    const auto framesPerTocEntry = BE::toUInt16(header.data() + 24);
+    if (!frameCount || !frame.samplingFrequency()) {
+        diag.emplace_back(DiagLevel::Warning, "The VBRI header denotes no frames and is ignored.", context);
+        return;
+    }
+    if (bytes) {
+        m_size = bytes;
+    }
+    m_duration = TimeSpan::fromSeconds(static_cast<double>(frameCount) * frame.sampleCount() / frame.samplingFrequency());
+    m_bitrate = static_cast<double>(m_size) * 8.0 / m_duration.totalSeconds() / 1024.0;
+    m_bytesPerSecond = static_cast<std::uint32_t>(m_bitrate * 125);
+
+    // read TOC; each entry denotes the (scaled) size of the next "framesPerTocEntry" frames
+    if (!tocEntryCount || !framesPerTocEntry || tocEntrySize < 1 || tocEntrySize > 4) {
+        return;
+    }
+    if (frame.size() < MpegAudioFrame::vbriHeaderOffset + vbriHeaderSize + static_cast<std::uint32_t>(tocEntryCount) * tocEntrySize) {
+        diag.emplace_back(DiagLevel::Warning, "The TOC of the VBRI header exceeds the frame and is ignored.", context);
+        return;
+    }
+    auto toc = std::vector<char>(static_cast<std::size_t>(tocEntryCount) * tocEntrySize);
+    m_istream->read(toc.data(), static_cast<streamsize>(toc.size()));
+    m_seekTable.reserve(tocEntryCount + 1u);
+    auto offset = m_firstFrameOffset;
+    for (auto i = std::size_t(); i <= tocEntryCount; ++i) {
+        auto &point = m_seekTable.emplace_back();
+        point.time = TimeSpan::fromSeconds(static_cast<double>(i * framesPerTocEntry) * frame.sampleCount() / frame.samplingFrequency());
+        point.offset = offset;
+        if (i == tocEntryCount) {
+            break;
+        }
+        auto entry = std::uint32_t();
+        for (const auto *byte = toc.data() + i * tocEntrySize, *end = byte + tocEntrySize; byte != end; ++byte) {
+            entry = (entry << 8) | static_cast<std::uint8_t>(*byte);
+        }
+        offset += static_cast<std::uint64_t>(entry) * tocScale;
+    }
+}
+
+/*!
+ * \brief Returns the absolute offset of the frame to start decoding from to play from the specified \a time.
+ * \remarks Interpolates between the entries of the seekTable(). If there is no seek table, the offset is estimated
+ *          from the bitrate.
+ */
+std::uint64_t MpegAudioFrameStream::seekOffset(TimeSpan time) const
+{
+    if (time.isNegative() || time.isNull()) {
+        return m_firstFrameOffset;
+    }
+    if (m_seekTable.empty()) {
+        const auto offset = m_firstFrameOffset + static_cast<std::uint64_t>(time.totalSeconds() * m_bytesPerSecond);
+        return min(offset, max(m_dataEndOffset, m_firstFrameOffset));
+    }
+    // find the last point not after the specified time and interpolate up to the next point (or the end of the stream)
+    const auto next = upper_bound(
+        m_seekTable.cbegin(), m_seekTable.cend(), time, [](TimeSpan value, const MpegAudioSeekPoint &point) { return value < point.time; });
+    const auto &point = *(next - 1);
+    const auto nextTime = next != m_seekTable.cend() ? next->time : m_duration;
+    const auto nextOffset = next != m_seekTable.cend() ? next->offset : m_firstFrameOffset + m_size;
+    if (nextTime <= point.time || nextOffset <= point.offset) {
+        return point.offset;
+    }
+    const auto fraction = min(1.0, static_cast<double>((time - point.time).totalTicks()) / static_cast<double>((nextTime - point.time).totalTicks()));
+    return point.offset + static_cast<std::uint64_t>(fraction * static_cast<double>(nextOffset - point.offset));
+}
+
+/*!
+ * \brief Returns the number of threads to use for scanning frames.
+ */
+std::size_t MpegAudioFrameStream::effectiveThreadCount() const
+{
+    return m_exactDurationThreadCount ? m_exactDurationThreadCount : max<std::size_t>(thread::hardware_concurrency(), 1);
+}
+
+/*!
+ * \brief Determines the duration by walking through the frames within [\a startOffset, \a endOffset).
+ */
+void MpegAudioFrameStream::computeExactDuration(const MpegAudioFrame &firstFrame, std::uint64_t startOffset, std::uint64_t endOffset, Diagnostics &diag)
+{
+    static const string context("computing exact duration of MPEG audio frames");
+    const auto total = scanFrames(*m_istream, firstFrame, startOffset, endOffset, effectiveThreadCount(), false);
+    if (!total.sampleCount) {
+        diag.emplace_back(DiagLevel::Warning, "No frames found; the duration is estimated from the first frame.", context);
+        return;
+    }
+    m_sampleCount = total.frameCount;
+    m_duration = TimeSpan::fromSeconds(static_cast<double>(total.sampleCount) / static_cast<double>(firstFrame.samplingFrequency()));
+    m_bitrate = static_cast<double>(m_size) * 8.0 / m_duration.totalSeconds() / 1024.0;
+    m_bytesPerSecond = static_cast<std::uint32_t>(m_bitrate * 125);
+}
+
+/*!
+ * \brief Makes a Xing frame containing a TOC for the stream.
+ *
+ * The frame is supposed to be inserted at the start of the stream (the start offset specified when constructing the
+ * track). It denotes the number of frames, the size of the stream and a TOC so players can seek without scanning.
+ * Determining these values requires walking through all frames (see setExactDurationThreadCount()).
+ *
+ * \returns Returns the frame or an empty string if a Xing or VBRI header is already present.
+ * \throws Throws InvalidDataException if no frames could be found.
+ * \remarks The header must have been parsed before.
+ */
+std::string MpegAudioFrameStream::makeXingFrame(Diagnostics &diag)
+{
+    static const string context("making Xing frame");
+    if (m_frames.empty() || !m_frames.back().isValid()) {
+        diag.emplace_back(DiagLevel::Critical, "No valid MPEG audio frame has been found.", context);
+        throw InvalidDataException();
+    }
+    const auto &firstFrame = m_frames.back();
+    if (firstFrame.isXingHeaderAvailable() || m_vbriHeaderAvailable) {
+        return std::string();
+    }
+    const auto total = scanFrames(*m_istream, firstFrame, m_firstFrameOffset, m_dataEndOffset, effectiveThreadCount(), true);
+    if (!total.frameCount) {
+        diag.emplace_back(DiagLevel::Critical, "No MPEG audio frames have been found.", context);
+        throw InvalidDataException();
+    }
+
+    // use the format of the first frame with the lowest bitrate big enough to hold the Xing header (frames, bytes and TOC)
+    // -> omit the CRC and the padding
+    constexpr auto xingSize = 8u + 4u + 4u + 100u;
+    auto xingFrame = MpegAudioFrame();
+    for (auto bitrateIndex = 1u; bitrateIndex != 0xFu; ++bitrateIndex) {
+        xingFrame = MpegAudioFrame((firstFrame.header() & ~0xF200u) | 0x10000u | (bitrateIndex << 12));
+        if (xingFrame.size() >= xingFrame.sideInformationOffset() + xingSize) {
+            break;
+        }
+    }
+    const auto frameSize = xingFrame.size();
+    const auto xingOffset = xingFrame.sideInformationOffset();
+    if (frameSize < xingOffset + xingSize) {
+        diag.emplace_back(DiagLevel::Critical, "The format of the MPEG audio frames does not allow a frame big enough for the Xing header.", context);
+        throw InvalidDataException();
+    }
+
+    // make the frame; offsets within the TOC are relative to the start of the Xing frame
+    auto frame = std::string(frameSize, '\0');
+    auto *const xing = frame.data() + xingOffset;
+    const auto bytes = frameSize + (m_dataEndOffset - m_startOffset);
+    BE::getBytes(xingFrame.header(), frame.data());
+    BE::getBytes(static_cast<std::uint32_t>(0x58696e67u) /* Xing */, xing);
+    BE::getBytes(static_cast<std::uint32_t>(XingHeaderFlags::HasFramesField | XingHeaderFlags::HasBytesField | XingHeaderFlags::HasTocField), xing + 4);
+    BE::getBytes(static_cast<std::uint32_t>(min<std::uint64_t>(total.frameCount, numeric_limits<std::uint32_t>::max())), xing + 8);
+    BE::getBytes(static_cast<std::uint32_t>(min<std::uint64_t>(bytes, numeric_limits<std::uint32_t>::max())), xing + 12);
+    for (auto i = std::size_t(); i != 100; ++i) {
+        const auto frameIndex = static_cast<std::size_t>(total.frameCount * i / 100);
+        const auto offset = frameSize + (total.frameOffsets[frameIndex] - m_startOffset);
+        xing[16 + i] = static_cast<char>(min<std::uint64_t>(offset * 256 / bytes, 255));
+    }
+    return frame;
+}
+
+/*!
+ * \brief Looks for the next sync word starting at the specified \a offset.
+ * \returns Returns the number of bytes skipped. The stream is positioned at the sync word if one has been found
+ *          within \a maxJunkSize bytes before \a endOffset; otherwise \a maxJunkSize is returned.
+ */
+std::size_t MpegAudioFrameStream::findNextSyncWord(std::uint64_t offset, std::uint64_t endOffset, std::size_t maxJunkSize)
+{
+    // read one byte more than positions are checked so the byte following the last position is available
+    auto buffer = std::array<char, 0x1001>();
+    for (auto skipped = std::size_t(); skipped < maxJunkSize;) {
+        const auto blockOffset = offset + skipped;
+        if (blockOffset + 1 >= endOffset) {
+            break;
+        }
+        const auto positions = static_cast<std::size_t>(
+            std::min<std::uint64_t>({ maxJunkSize - skipped, buffer.size() - 1, endOffset - blockOffset - 1 }));
+        m_istream->seekg(static_cast<streamoff>(blockOffset), ios_base::beg);
+        m_istream->read(buffer.data(), static_cast<streamsize>(positions + 1));
+        if (const auto index = MpegAudioFrame::findSyncWord(buffer.data(), positions + 1); index < positions) {
+            m_istream->seekg(static_cast<streamoff>(blockOffset + index), ios_base::beg);
+            return skipped + index;
+        }
+        skipped += positions;
+    }
+    return maxJunkSize;
 }
 
 } // namespace TagParser
@@ -6,9 +6,24 @@
 #include "../abstracttrack.h"
 
 #include <list>
+#include <string>
+#include <vector>
 
 namespace TagParser {
 
+struct TailProbe;
+
+/*!
+ * \brief The MpegAudioSeekPoint struct maps a time within an MPEG audio stream to the offset of the frame
+ *        to start decoding from.
+ */
+struct TAG_PARSER_EXPORT MpegAudioSeekPoint {
+    /// \brief The time relative to the start of the stream.
+    CppUtilities::TimeSpan time;
+    /// \brief The absolute offset within the file.
+    std::uint64_t offset = 0;
+};
+
 class TAG_PARSER_EXPORT MpegAudioFrameStream final : public AbstractTrack {
 public:
     MpegAudioFrameStream(std::iostream &stream, std::uint64_t startOffset);
@@ -17,12 +32,48 @@ public:
     TrackType type() const override;
 
     static void addInfo(const MpegAudioFrame &frame, AbstractTrack &track);
+    std::size_t maxJunkSize() const;
+    void setMaxJunkSize(std::size_t maxJunkSize);
+    bool isExactDurationEnabled() const;
+    void setExactDurationEnabled(bool enabled);
+    bool isForwardOnly() const;
+    void setForwardOnly(bool forwardOnly);
+    const TailProbe *tailProbe() const;
+    void setTailProbe(const TailProbe *tailProbe);
+    std::size_t exactDurationThreadCount() const;
+    void setExactDurationThreadCount(std::size_t threadCount);
+    bool isVbriHeaderAvailable() const;
+    const std::vector<MpegAudioSeekPoint> &seekTable() const;
+    std::uint64_t seekOffset(CppUtilities::TimeSpan time) const;
+    std::uint16_t encoderDelay() const;
+    std::uint16_t encoderPadding() const;
+    std::string makeXingFrame(Diagnostics &diag);
+
+    /// \brief The default for maxJunkSize().
+    static constexpr std::size_t defaultMaxJunkSize = 0x600;
 
 protected:
     void internalParseHeader(Diagnostics &diag) override;
 
 private:
+    std::size_t findNextSyncWord(std::uint64_t offset, std::uint64_t endOffset, std::size_t maxJunkSize);
+    void parseVbriHeader(const MpegAudioFrame &frame, Diagnostics &diag);
+    void makeXingSeekTable(const MpegAudioFrame &frame);
+    void computeExactDuration(const MpegAudioFrame &firstFrame, std::uint64_t startOffset, std::uint64_t endOffset, Diagnostics &diag);
+    std::size_t effectiveThreadCount() const;
+
     std::list<MpegAudioFrame> m_frames;
+    const TailProbe *m_tailProbe;
+    std::vector<MpegAudioSeekPoint> m_seekTable;
+    std::uint64_t m_firstFrameOffset;
+    std::uint64_t m_dataEndOffset;
+    std::size_t m_maxJunkSize;
+    std::size_t m_exactDurationThreadCount;
+    std::uint16_t m_encoderDelay;
+    std::uint16_t m_encoderPadding;
+    bool m_exactDurationEnabled;
+    bool m_vbriHeaderAvailable;
+    bool m_forwardOnly;
 };
 
 /*!
@@ -30,6 +81,16 @@ private:
  */
 inline MpegAudioFrameStream::MpegAudioFrameStream(std::iostream &stream, std::uint64_t startOffset)
     : AbstractTrack(stream, startOffset)
+    , m_tailProbe(nullptr)
+    , m_firstFrameOffset(0)
+    , m_dataEndOffset(0)
+    , m_maxJunkSize(defaultMaxJunkSize)
+    , m_exactDurationThreadCount(0)
+    , m_encoderDelay(0)
+    , m_encoderPadding(0)
+    , m_exactDurationEnabled(false)
+    , m_vbriHeaderAvailable(false)
+    , m_forwardOnly(false)
 {
     m_mediaType = MediaType::Audio;
 }
@@ -43,6 +104,154 @@ inline TrackType MpegAudioFrameStream::type() const
     return TrackType::MpegAudioFrameStream;
 }
 
+/*!
+ * \brief Returns the number of junk bytes which are skipped at most when looking for the first valid frame.
+ * \sa setMaxJunkSize()
+ */
+inline std::size_t MpegAudioFrameStream::maxJunkSize() const
+{
+    return m_maxJunkSize;
+}
+
+/*!
+ * \brief Sets the number of junk bytes which are skipped at most when looking for the first valid frame.
+ *
+ * Files might contain junk (e.g. remains of broken ID3v2 or APE tags) before the first frame. The default is
+ * defaultMaxJunkSize. A bigger value allows recovering from bigger junk but makes detecting that a file contains
+ * no frames at all slower.
+ *
+ * \remarks The setting is applied next time parsing the header.
+ */
+inline void MpegAudioFrameStream::setMaxJunkSize(std::size_t maxJunkSize)
+{
+    m_maxJunkSize = maxJunkSize;
+}
+
+/*!
+ * \brief Returns whether the duration is determined by walking through all frames.
+ * \sa setExactDurationEnabled()
+ */
+inline bool MpegAudioFrameStream::isExactDurationEnabled() const
+{
+    return m_exactDurationEnabled;
+}
+
+/*!
+ * \brief Sets whether the duration is determined by walking through all frames.
+ *
+ * By default the duration is computed from the frame count of the Xing header or, if not present, estimated from the
+ * bitrate of the first frame. The latter is inaccurate for files with a variable bitrate. If enabled, the headers of
+ * all frames are read instead to sum up their sample counts. This requires reading the whole file. The file is split
+ * into segments which are scanned in parallel (see setExactDurationThreadCount()).
+ *
+ * \remarks
+ * - The setting is applied next time parsing the header.
+ * - The sampleCount() is set to the number of frames in this case.
+ */
+inline void MpegAudioFrameStream::setExactDurationEnabled(bool enabled)
+{
+    m_exactDurationEnabled = enabled;
+}
+
+/*!
+ * \brief Returns whether the stream is only read forward.
+ * \sa setForwardOnly()
+ */
+inline bool MpegAudioFrameStream::isForwardOnly() const
+{
+    return m_forwardOnly;
+}
+
+/*!
+ * \brief Sets whether the stream is only read forward (see ByteSource::isForwardOnly()).
+ *
+ * In this case the end of the stream is not checked for an ID3v1 tag to determine the size and the exact duration is
+ * never determined. So the size and duration are only known if denoted by the Xing/VBRI header.
+ *
+ * \remarks The setting is applied next time parsing the header.
+ */
+inline void MpegAudioFrameStream::setForwardOnly(bool forwardOnly)
+{
+    m_forwardOnly = forwardOnly;
+}
+
+/*!
+ * \brief Returns the probe of the end of the stream used to determine where the audio data ends.
+ * \sa setTailProbe()
+ */
+inline const TailProbe *MpegAudioFrameStream::tailProbe() const
+{
+    return m_tailProbe;
+}
+
+/*!
+ * \brief Sets the probe of the end of the stream used to determine where the audio data ends.
+ *
+ * This allows sharing the probe with other consumers (see MediaFileInfo::tailProbe()). If not set or not yet probed,
+ * the end of the stream is probed when parsing the header.
+ *
+ * \remarks The \a tailProbe must outlive the stream or be unset before.
+ */
+inline void MpegAudioFrameStream::setTailProbe(const TailProbe *tailProbe)
+{
+    m_tailProbe = tailProbe;
+}
+
+/*!
+ * \brief Returns the number of threads used to scan the frames when isExactDurationEnabled() is set.
+ *
+ * A value of zero means the number of hardware threads is used. This is the default.
+ *
+ * \sa setExactDurationThreadCount()
+ */
+inline std::size_t MpegAudioFrameStream::exactDurationThreadCount() const
+{
+    return m_exactDurationThreadCount;
+}
+
+/*!
+ * \brief Sets the number of threads used to scan the frames when isExactDurationEnabled() is set.
+ * \sa exactDurationThreadCount()
+ */
+inline void MpegAudioFrameStream::setExactDurationThreadCount(std::size_t threadCount)
+{
+    m_exactDurationThreadCount = threadCount;
+}
+
+/*!
+ * \brief Returns whether a Fraunhofer VBRI header is present in the first frame.
+ */
+inline bool MpegAudioFrameStream::isVbriHeaderAvailable() const
+{
+    return m_vbriHeaderAvailable;
+}
+
+/*!
+ * \brief Returns the seek table denoted by the TOC of the Xing header or the VBRI header.
+ * \remarks The table is empty if neither a Xing header with TOC nor a VBRI header is present.
+ * \sa seekOffset()
+ */
+inline const std::vector<MpegAudioSeekPoint> &MpegAudioFrameStream::seekTable() const
+{
+    return m_seekTable;
+}
+
+/*!
+ * \brief Returns the number of samples the encoder added at the beginning if denoted by the LAME tag or the VBRI header.
+ */
+inline std::uint16_t MpegAudioFrameStream::encoderDelay() const
+{
+    return m_encoderDelay;
+}
+
+/*!
+ * \brief Returns the number of samples the encoder added at the end if denoted by the LAME tag.
+ */
+inline std::uint16_t MpegAudioFrameStream::encoderPadding() const
+{
+    return m_encoderPadding;
+}
+
 } // namespace TagParser
 
 #endif // MPEGAUDIOFRAMESTREAM_H
@@ -3,13 +3,29 @@
 #include "../flac/flacmetadata.h"
 
 #include "../backuphelper.h"
+#include "../bytesource.h"
+#include "../exceptions.h"
 #include "../mediafileinfo.h"
+#include "../mediapayloadhash.h"
 #include "../progressfeedback.h"
 
+#include <c++utilities/conversion/binaryconversion.h>
 #include <c++utilities/conversion/stringbuilder.h>
 #include <c++utilities/io/copy.h>
 
+#ifdef PLATFORM_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <limits>
 #include <memory>
+#include <string_view>
+#include <thread>
 
 using namespace std;
 using namespace CppUtilities;
@@ -45,9 +61,14 @@ const char *OggVorbisComment::typeName() const
  */
 OggContainer::OggContainer(MediaFileInfo &fileInfo, std::uint64_t startOffset)
     : GenericContainer<MediaFileInfo, OggVorbisComment, OggStream, OggPage>(fileInfo, startOffset)
-    , m_iterator(fileInfo.stream(), startOffset, fileInfo.size())
+    , m_iterator(fileInfo.inputStream(), startOffset, fileInfo.size())
+    , m_pageIndex(fileInfo.inputStream(), startOffset, fileInfo.size())
     , m_validateChecksums(false)
+    , m_pagesSkipped(false)
+    , m_rewriteThreadCount(1)
 {
+    m_iterator.setMappedData(&fileInfo.mappedData());
+    m_pageIndex.setMappedData(&fileInfo.mappedData());
 }
 
 OggContainer::~OggContainer()
@@ -159,6 +180,7 @@ bool OggContainer::removeTag(Tag *tag)
         if (static_cast<Tag *>(existingTag.get()) == tag) {
             existingTag->removeAllFields();
             existingTag->oggParams().removed = true;
+            m_modified = true;
             return true;
         }
     }
@@ -180,19 +202,390 @@ void OggContainer::removeAllTags()
     for (auto &existingTag : m_tags) {
         existingTag->removeAllFields();
         existingTag->oggParams().removed = true;
+        m_modified = true;
+    }
+}
+
+/// \cond
+namespace {
+
+/*!
+ * \brief The PageRange struct holds a range of OGG pages verified via verifyPageRange() and the results.
+ */
+struct PageRange {
+    /// \brief offset the range begins at
+    std::uint64_t begin = 0;
+    /// \brief end offset of the range; the last page verified is the last one starting before it
+    std::uint64_t end = 0;
+    /// \brief whether the first page needs to be searched because \a begin is not known to be the offset of a page
+    bool sync = false;
+    /// \brief offset of the first page which has been verified (or \a end if none has been found)
+    std::uint64_t firstPageOffset = 0;
+    /// \brief end offset of the last page which has been verified
+    std::uint64_t verifiedEnd = 0;
+    /// \brief whether \a verifiedEnd is not known to be the offset of a page (because no further page has been found)
+    bool syncRequired = false;
+    /// \brief number of pages verified
+    std::uint64_t pageCount = 0;
+    /// \brief number of pages whose checksum does not match
+    std::uint64_t corruptPageCount = 0;
+    /// \brief diagnostic messages for the range
+    Diagnostics diag;
+    /// \brief unexpected exception which occurred when verifying the range
+    exception_ptr exception;
+};
+
+/*!
+ * \brief Verifies the checksums of the pages within the specified \a range reading from the specified \a source.
+ *
+ * If the range needs to be synced, pages are only considered found if their checksum matches. This prevents mistaking
+ * data which happens to contain the capture pattern for a page. Pages which can not be verified because their checksum
+ * is wrong are verified by the caller when merging the results (see OggContainer::verifyChecksums()).
+ *
+ * \remarks This function only uses positional reads on \a source so it is called for multiple ranges at the same time.
+ */
+void verifyPageRange(ByteSource &source, std::uint64_t streamEnd, PageRange &range)
+{
+    static const string context("verifying checksums of OGG pages");
+    constexpr auto windowSize = std::size_t(0x100000);
+    auto &diag = range.diag;
+    const auto contiguousData = source.contiguousData();
+    auto window = string();
+    auto windowOffset = std::uint64_t();
+    // returns the specified bytes from the source; they are only valid until the next call
+    const auto bytesAt = [&](std::uint64_t offset, std::size_t count) -> const char * {
+        if (offset > streamEnd || count > streamEnd - offset) {
+            return nullptr;
+        }
+        if (!contiguousData.empty()) {
+            return offset + count <= contiguousData.size() ? contiguousData.data() + offset : nullptr;
+        }
+        if (offset < windowOffset || offset + count > windowOffset + window.size()) {
+            window.resize(static_cast<std::size_t>(min<std::uint64_t>(max(windowSize, count), streamEnd - offset)));
+            window.resize(source.read(offset, window.data(), window.size()));
+            windowOffset = offset;
+            if (count > window.size()) {
+                return nullptr;
+            }
+        }
+        return window.data() + (offset - windowOffset);
+    };
+    // returns the page at the specified offset if it is complete; pageSize is set to zero if the capture pattern is absent
+    const auto pageAt = [&](std::uint64_t offset, std::uint32_t &pageSize) -> const char * {
+        pageSize = 0;
+        const auto *const header = bytesAt(offset, 27);
+        if (!header || memcmp(header, "OggS", 4)) {
+            return nullptr;
+        }
+        const auto segmentTableSize = static_cast<std::uint8_t>(header[26]);
+        const auto *const segmentTable = bytesAt(offset + 27, segmentTableSize);
+        pageSize = 27u + segmentTableSize;
+        if (!segmentTable) {
+            return nullptr;
+        }
+        for (auto i = std::size_t(); i != segmentTableSize; ++i) {
+            pageSize += static_cast<std::uint8_t>(segmentTable[i]);
+        }
+        return bytesAt(offset, pageSize);
+    };
+    // returns the offset of the first page with a matching checksum starting at or after the specified offset and before limit
+    const auto findPage = [&](std::uint64_t offset, std::uint64_t limit) {
+        for (; offset < limit && streamEnd - offset >= 27;) {
+            const auto blockSize = static_cast<std::size_t>(min<std::uint64_t>(windowSize, streamEnd - offset));
+            for (auto i = std::size_t();;) {
+                // note: The block is requested again after checking a candidate as this might have invalidated it.
+                const auto *const block = bytesAt(offset, blockSize);
+                if (!block) {
+                    return limit;
+                }
+                i = string_view(block, blockSize).find("OggS", i);
+                if (i == string_view::npos || offset + i >= limit) {
+                    break;
+                }
+                auto pageSize = std::uint32_t();
+                if (const auto *const page = pageAt(offset + i, pageSize); page && OggPage::computeChecksum(page) == LE::toUInt32(page + 22)) {
+                    return offset + i;
+                }
+                ++i;
+            }
+            // continue with the next block; it overlaps so a capture pattern crossing the boundary is found
+            offset += blockSize - 3;
+        }
+        return limit;
+    };
+
+    // verify one page after another until the end of the range
+    auto offset = range.sync ? findPage(range.begin, range.end) : range.begin;
+    range.firstPageOffset = offset;
+    range.syncRequired = offset == range.end && range.sync;
+    while (offset < range.end) {
+        auto pageSize = std::uint32_t();
+        const auto *const page = pageAt(offset, pageSize);
+        if (!page && pageSize) {
+            diag.emplace_back(DiagLevel::Critical, argsToString("The OGG page at ", offset, " is truncated."), context);
+            offset = streamEnd;
+            break;
+        }
+        if (!page) {
+            diag.emplace_back(DiagLevel::Critical, argsToString("There is no OGG page at ", offset, "; skipping until the next page."), context);
+            if ((offset = findPage(offset + 1, range.end)) == range.end) {
+                range.syncRequired = true;
+            }
+            continue;
+        }
+        ++range.pageCount;
+        const auto denotedChecksum = LE::toUInt32(page + 22), actualChecksum = OggPage::computeChecksum(page);
+        if (denotedChecksum != actualChecksum) {
+            ++range.corruptPageCount;
+            diag.emplace_back(DiagLevel::Critical,
+                argsToString("The denoted checksum ", denotedChecksum, " of the OGG page at ", offset, " does not match the computed checksum ",
+                    actualChecksum, '.'),
+                context);
+        }
+        offset += pageSize;
+    }
+    range.verifiedEnd = offset;
+}
+
+#ifdef PLATFORM_UNIX
+/*!
+ * \brief The FileDescriptorGuard struct closes the file descriptor it holds when being destroyed.
+ */
+struct FileDescriptorGuard {
+    ~FileDescriptorGuard()
+    {
+        if (fileDescriptor >= 0) {
+            ::close(fileDescriptor);
+        }
+    }
+    int fileDescriptor = -1;
+};
+#endif
+
+} // namespace
+/// \endcond
+
+/*!
+ * \brief Verifies the checksums of all pages concurrently.
+ *
+ * The file is split into ranges which are verified on \a threadCount threads (or as many as there are hardware threads if
+ * zero) using positional reads from the memory-mapped file or from a file descriptor opened for this purpose. Each range
+ * but the first begins at the first page found within it; the checksums are computed via slicing-by-8 (like
+ * OggPage::computeChecksum()). Pages which have not been verified by any range (e.g. a corrupted page at the beginning of
+ * a range) are verified when merging the results of the ranges in file order.
+ *
+ * Corrupted pages, truncated pages and data which is not part of a page are reported via \a diag along with their offsets.
+ *
+ * \remarks
+ * - This does not require the header to be parsed and does not build a page table. It is independent of
+ *   isChecksumValidationEnabled().
+ * - If the file is neither memory-mapped nor can be opened again (e.g. when reading from a byte source), the pages are
+ *   verified on the calling thread only.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+void OggContainer::verifyChecksums(Diagnostics &diag, std::size_t threadCount)
+{
+    static const string context("verifying checksums of OGG pages");
+
+    // determine how to read the pages (see MatroskaContainer::validateClusters())
+    auto source = unique_ptr<ByteSource>();
+    auto concurrent = true;
+#ifdef PLATFORM_UNIX
+    auto fileDescriptor = FileDescriptorGuard();
+#endif
+    if (const auto mapping = mappedData(); !mapping.empty()) {
+        source = make_unique<MemoryByteSource>(mapping);
+#ifdef PLATFORM_UNIX
+    } else if (!fileInfo().hasByteSource() && !fileInfo().path().empty()
+        && (fileDescriptor.fileDescriptor = ::open(BasicFileInfo::pathForOpen(fileInfo().path()), O_RDONLY | O_CLOEXEC)) >= 0) {
+        source = make_unique<FileDescriptorByteSource>(fileDescriptor.fileDescriptor);
+#endif
+    } else {
+        source = make_unique<BufferedRangeByteSource>(stream(), 0, 0);
+        concurrent = false;
+    }
+    threadCount = concurrent ? (threadCount ? threadCount : max<std::size_t>(thread::hardware_concurrency(), 1)) : 1;
+
+    // split the file into ranges of equal size (but at least 1 MiB)
+    const auto streamEnd = fileInfo().size();
+    auto ranges = vector<PageRange>();
+    if (startOffset() < streamEnd) {
+        const auto rangeSize = max<std::uint64_t>((streamEnd - startOffset()) / (threadCount * 4), 0x100000);
+        for (auto rangeBegin = startOffset(); rangeBegin < streamEnd; rangeBegin += rangeSize) {
+            auto &range = ranges.emplace_back();
+            range.begin = rangeBegin;
+            range.end = streamEnd - rangeBegin > rangeSize ? rangeBegin + rangeSize : streamEnd;
+            range.sync = rangeBegin != startOffset();
+        }
+    }
+
+    // verify the ranges concurrently
+    threadCount = min(threadCount, ranges.size());
+    auto nextRange = atomic<std::size_t>(0);
+    const auto work = [&] {
+        for (auto i = nextRange++; i < ranges.size(); i = nextRange++) {
+            auto &range = ranges[i];
+            range.diag.setFlags(diag.flags());
+            range.diag.setLevelThreshold(diag.levelThreshold());
+            try {
+                verifyPageRange(*source, streamEnd, range);
+            } catch (...) {
+                range.exception = current_exception();
+            }
+        }
+    };
+    auto workers = vector<thread>();
+    workers.reserve(threadCount > 1 ? threadCount - 1 : 0);
+    for (auto i = std::size_t(1); i < threadCount; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    // merge the results in file order
+    // -> verify the pages between the last page verified so far and the first page of the next range on the calling thread
+    std::uint64_t pageCount = 0, corruptPageCount = 0, verifiedEnd = startOffset();
+    auto syncRequired = false;
+    const auto mergeRange = [&](PageRange &range) {
+        for (auto &message : range.diag) {
+            diag.push_back(std::move(message));
+        }
+        if (range.exception) {
+            rethrow_exception(range.exception);
+        }
+        pageCount += range.pageCount;
+        corruptPageCount += range.corruptPageCount;
+        if (range.verifiedEnd > verifiedEnd) {
+            verifiedEnd = range.verifiedEnd;
+            syncRequired = range.syncRequired;
+        }
+    };
+    for (auto &range : ranges) {
+        if (verifiedEnd < range.firstPageOffset) {
+            auto gap = PageRange();
+            gap.begin = verifiedEnd;
+            gap.end = range.firstPageOffset;
+            gap.sync = syncRequired;
+            gap.diag.setFlags(diag.flags());
+            gap.diag.setLevelThreshold(diag.levelThreshold());
+            verifyPageRange(*source, streamEnd, gap);
+            mergeRange(gap);
+        }
+        mergeRange(range);
+    }
+    diag.emplace_back(DiagLevel::Information,
+        argsToString("Verified the checksums of ", pageCount, " pages (", corruptPageCount, " corrupted) split into ", ranges.size(),
+            " ranges on ", max<std::size_t>(threadCount, 1), " threads."),
+        context);
+}
+
+/*!
+ * \brief Adds the data of the pages after the header packets of each stream to the specified \a hasher.
+ *
+ * The header packets (e.g. the identification, comment and setup headers of Vorbis streams or the metadata blocks of
+ * FLAC streams) are located on pages with a granule position of zero (or -1 for pages a long header packet is continued
+ * on). So the pages of a stream are skipped until a page with another granule position is encountered; from there on
+ * the data of all pages of the stream is added in file order. The page headers are not added because the sequence
+ * numbers and checksums change when the comment grows or shrinks.
+ *
+ * \remarks A data page on which no packet ends directly after the headers (which only happens for huge first packets)
+ *          is skipped as well. This does not affect the hash of files which only differ in their comments.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+void OggContainer::hashMediaPayload(MediaPayloadHasher &hasher, Diagnostics &diag, AbortableProgressFeedback &progress)
+{
+    CPP_UTILITIES_UNUSED(diag)
+    auto dataStarted = unordered_map<std::uint32_t, bool>();
+    auto percentage = std::uint8_t();
+    const auto size = fileInfo().size();
+    for (m_iterator.removeFilter(), m_iterator.reset(); m_iterator; m_iterator.nextPage()) {
+        const auto page = m_iterator.currentPage();
+        if (auto &started = dataStarted[page.streamSerialNumber()]; !started) {
+            const auto granulePosition = page.absoluteGranulePosition();
+            if (!(started = granulePosition && granulePosition != numeric_limits<std::uint64_t>::max())) {
+                continue;
+            }
+        }
+        hasher.addRange(stream(), page.dataOffset(), page.dataOffset() + page.dataSize());
+        if (const auto currentPercentage = static_cast<std::uint8_t>(page.startOffset() * 100 / size); currentPercentage != percentage) {
+            progress.stopIfAborted();
+            progress.updateStepPercentage(percentage = currentPercentage);
+        }
     }
 }
 
 void OggContainer::internalParseHeader(Diagnostics &diag)
+{
+    m_pagesSkipped = false;
+    parsePages(0, diag);
+}
+
+/*!
+ * \brief Takes the pages into account which have been appended to the file.
+ *
+ * The page table is kept and the pages following the last complete page are fetched. The sizes of the streams are
+ * updated accordingly and the durations are determined again if the tracks have already been parsed.
+ *
+ * \returns Returns false if a new stream has been appended (e.g. chained streams); the file needs to be parsed from
+ *          scratch in this case.
+ */
+bool OggContainer::internalResumeParsing(Diagnostics &diag)
+{
+    m_iterator.setStreamSize(fileInfo().size());
+    m_pageIndex.setStreamSize(fileInfo().size());
+    const auto trackCount = m_tracks.size();
+    parsePages(m_iterator.pages().size(), diag);
+    if (m_tracks.size() != trackCount) {
+        return false;
+    }
+    if (areTracksParsed()) {
+        for (auto &stream : m_tracks) {
+            stream->updateDuration();
+            if (stream->duration() > m_duration) {
+                m_duration = stream->duration();
+            }
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief Iterates through the pages starting at the page with the specified \a firstPage index.
+ * \remarks Pages before \a firstPage must have been fetched before and are not checked again.
+ */
+void OggContainer::parsePages(OggPageTable::size_type firstPage, Diagnostics &diag)
 {
     static const string context("parsing OGG bitstream header");
-    bool pagesSkipped = false;
+    m_iterator.setMemoryAccount(memoryAccount());
 
     // iterate through pages using OggIterator helper class
     try {
         // ensure iterator is setup properly
-        for (m_iterator.removeFilter(), m_iterator.reset(); m_iterator; m_iterator.nextPage()) {
-            const OggPage &page = m_iterator.currentPage();
+        const auto maxParsingOffset = fileInfo().maxParsingOffset();
+        const auto forwardOnly = fileInfo().isForwardOnly();
+        m_iterator.removeFilter();
+        if (firstPage) {
+            m_iterator.setPageIndex(firstPage - 1);
+            m_iterator.nextPage();
+        } else {
+            m_iterator.reset();
+        }
+        for (; m_iterator; m_iterator.nextPage()) {
+            const auto page = m_iterator.currentPage();
+            if (maxParsingOffset && page.startOffset() >= maxParsingOffset) {
+                m_pagesSkipped = true;
+                diag.emplace_back(DiagLevel::Information,
+                    argsToString("Pages beyond the max. parsing offset (", maxParsingOffset,
+                        ") have been skipped. Hence track sizes can not be computed. Maybe not even all tracks could be detected."),
+                    context);
+                break;
+            }
+            if (exceedsParseLimit(m_iterator.pages().size(), parseLimits().maxTableEntries, "number of OGG pages", diag, context)) {
+                m_pagesSkipped = true;
+                break;
+            }
             if (m_validateChecksums && page.checksum() != OggPage::computeChecksum(stream(), page.startOffset())) {
                 diag.emplace_back(DiagLevel::Warning,
                     argsToString(
@@ -220,14 +613,25 @@ void OggContainer::internalParseHeader(Diagnostics &diag)
                 ++stream->m_currentSequenceNumber;
             }
 
+            // stop at the first page containing media data if the input is forward-only
+            // note: The header packets (including the comments) precede the media data. Pages of header packets have a granule
+            //       position of zero (or none at all if no packet ends on the page).
+            if (forwardOnly && page.absoluteGranulePosition() && page.absoluteGranulePosition() != numeric_limits<std::uint64_t>::max()) {
+                m_pagesSkipped = true;
+                diag.emplace_back(DiagLevel::Information,
+                    "The input is forward-only so only the header pages have been parsed. Hence track sizes and durations can not be determined.",
+                    context);
+                break;
+            }
+
             // skip pages in the middle of a big file (still more than 100 MiB to parse) if no new track has been seen since the last 20 MiB
             if (!fileInfo().isForcingFullParse() && (fileInfo().size() - page.startOffset()) > (100 * 0x100000)
                 && (page.startOffset() - lastNewStreamOffset) > (20 * 0x100000)) {
-                if (m_iterator.resyncAt(fileInfo().size() - (20 * 0x100000))) {
-                    const OggPage &resyncedPage = m_iterator.currentPage();
+                if (m_iterator.resyncAt(fileInfo().size() - (20 * 0x100000), true)) {
+                    const auto resyncedPage = m_iterator.currentPage();
                     // prevent warning about missing pages
                     stream->m_currentSequenceNumber = resyncedPage.sequenceNumber() + 1;
-                    pagesSkipped = true;
+                    m_pagesSkipped = true;
                     diag.emplace_back(DiagLevel::Information,
                         argsToString("Pages in the middle of the file (", dataSizeToString(resyncedPage.startOffset() - page.startOffset()),
                             ") have been skipped to improve parsing speed. Hence track sizes can not be computed. Maybe not even all tracks could be "
@@ -250,8 +654,13 @@ void OggContainer::internalParseHeader(Diagnostics &diag)
             DiagLevel::Critical, argsToString("Capture pattern \"OggS\" at ", m_iterator.currentSegmentOffset(), " expected."), context);
     }
 
+    // add fetched pages to the index
+    for (OggPageTable::size_type i = firstPage, count = m_iterator.pages().size(); i < count; ++i) {
+        m_pageIndex.add(m_iterator.pages()[i]);
+    }
+
     // invalidate stream sizes in case pages have been skipped
-    if (pagesSkipped) {
+    if (m_pagesSkipped) {
         for (auto &stream : m_tracks) {
             stream->m_size = 0;
         }
@@ -262,22 +671,27 @@ void OggContainer::internalParseTags(Diagnostics &diag)
 {
     // tracks needs to be parsed before because tags are stored at stream level
     parseTracks(diag);
+    const auto parsingFlags = fileInfo().parsingFlags();
+    const auto sharingFlags = (parsingFlags & ParsingFlags::ShareTagValueData ? VorbisCommentFlags::ShareValueData : VorbisCommentFlags::None)
+        | (parsingFlags & ParsingFlags::LazyLoadPictures ? VorbisCommentFlags::LazyLoadCovers : VorbisCommentFlags::None);
     for (auto &comment : m_tags) {
         OggParameter &params = comment->oggParams();
         m_iterator.setPageIndex(params.firstPageIndex);
         m_iterator.setSegmentIndex(params.firstSegmentIndex);
         switch (params.streamFormat) {
         case GeneralMediaFormat::Vorbis:
-            comment->parse(m_iterator, VorbisCommentFlags::None, diag);
+            comment->parse(m_iterator, sharingFlags, diag, &fileInfo().tagFieldFilter());
             break;
         case GeneralMediaFormat::Opus:
             // skip header (has already been detected by OggStream)
             m_iterator.ignore(8);
-            comment->parse(m_iterator, VorbisCommentFlags::NoSignature | VorbisCommentFlags::NoFramingByte, diag);
+            comment->parse(
+                m_iterator, VorbisCommentFlags::NoSignature | VorbisCommentFlags::NoFramingByte | sharingFlags, diag, &fileInfo().tagFieldFilter());
             break;
         case GeneralMediaFormat::Flac:
             m_iterator.ignore(4);
-            comment->parse(m_iterator, VorbisCommentFlags::NoSignature | VorbisCommentFlags::NoFramingByte, diag);
+            comment->parse(
+                m_iterator, VorbisCommentFlags::NoSignature | VorbisCommentFlags::NoFramingByte | sharingFlags, diag, &fileInfo().tagFieldFilter());
             break;
         default:
             diag.emplace_back(DiagLevel::Critical, "Stream format not supported.", "parsing tags from OGG streams");
@@ -320,20 +734,19 @@ void OggContainer::internalParseTracks(Diagnostics &diag)
 }
 
 /*!
- * \brief Writes the specified \a comment with the given \a params to the specified \a buffer and
- *        adds the number of bytes written to \a newSegmentSizes.
+ * \brief Appends the specified \a comment with the given \a params to the specified \a buffer and
+ *        adds the number of bytes appended to \a newSegmentSizes.
  */
-void OggContainer::makeVorbisCommentSegment(stringstream &buffer, CopyHelper<65307> &copyHelper, vector<std::uint32_t> &newSegmentSizes,
-    VorbisComment *comment, OggParameter *params, Diagnostics &diag)
+void OggContainer::makeVorbisCommentSegment(
+    std::string &buffer, vector<std::uint32_t> &newSegmentSizes, VorbisComment *comment, OggParameter *params, Diagnostics &diag)
 {
-    const auto offset = buffer.tellp();
+    const auto offset = buffer.size();
     switch (params->streamFormat) {
     case GeneralMediaFormat::Vorbis:
         comment->make(buffer, VorbisCommentFlags::None, diag);
         break;
     case GeneralMediaFormat::Opus:
-        BE::getBytes(static_cast<std::uint64_t>(0x4F70757354616773u), copyHelper.buffer());
-        buffer.write(copyHelper.buffer(), 8);
+        buffer.append("OpusTags", 8);
         comment->make(buffer, VorbisCommentFlags::NoSignature | VorbisCommentFlags::NoFramingByte, diag);
         break;
     case GeneralMediaFormat::Flac: {
@@ -343,38 +756,103 @@ void OggContainer::makeVorbisCommentSegment(stringstream &buffer, CopyHelper<653
         header.setType(FlacMetaDataBlockType::VorbisComment);
 
         // write the header later, when the size is known
-        buffer.write(copyHelper.buffer(), 4);
+        buffer.append(4, '\0');
 
         comment->make(buffer, VorbisCommentFlags::NoSignature | VorbisCommentFlags::NoFramingByte, diag);
 
         // finally make the header
-        header.setDataSize(static_cast<std::uint32_t>(buffer.tellp() - offset - 4));
+        header.setDataSize(static_cast<std::uint32_t>(buffer.size() - offset - 4));
         if (header.dataSize() > 0xFFFFFF) {
             diag.emplace_back(
                 DiagLevel::Critical, "Size of Vorbis comment exceeds size limit for FLAC \"METADATA_BLOCK_HEADER\".", "making Vorbis Comment");
         }
-        buffer.seekp(offset);
-        header.makeHeader(buffer);
-        buffer.seekp(header.dataSize(), ios_base::cur);
+        header.makeHeader(buffer.data() + offset);
         break;
     }
     default:;
     }
-    newSegmentSizes.push_back(static_cast<std::uint32_t>(buffer.tellp() - offset));
+    newSegmentSizes.push_back(static_cast<std::uint32_t>(buffer.size() - offset));
 }
 
+/// \cond
+namespace {
+
+/*!
+ * \brief The RenumberedPage struct denotes a page within a block whose sequence number and checksum need to be updated.
+ */
+struct RenumberedPage {
+    std::uint32_t offset;
+    std::uint32_t sequenceNumber;
+};
+
+/*!
+ * \brief Updates the sequence numbers and the checksums of the pages within [\a begin, \a end) in the specified \a block.
+ */
+void renumberPageRange(char *block, const RenumberedPage *begin, const RenumberedPage *end)
+{
+    for (; begin != end; ++begin) {
+        OggPage::updateSequenceNumber(block + begin->offset, begin->sequenceNumber);
+    }
+}
+
+/*!
+ * \brief Updates the sequence numbers and the checksums of the specified \a pages in the specified \a block using up to \a threadCount threads.
+ */
+void renumberPages(char *block, const vector<RenumberedPage> &pages, std::size_t threadCount)
+{
+    // use additional threads only if there are enough pages to make it worthwhile
+    constexpr std::size_t minPagesPerThread = 16;
+    threadCount = min(threadCount, max<std::size_t>(pages.size() / minPagesPerThread, 1));
+    const auto pagesPerThread = (pages.size() + threadCount - 1) / threadCount;
+    const auto *const begin = pages.data(), *const end = pages.data() + pages.size();
+
+    // run workers; the current thread processes the first range
+    auto threads = vector<thread>();
+    threads.reserve(threadCount - 1);
+    for (std::size_t worker = 1; worker < threadCount && begin + worker * pagesPerThread < end; ++worker) {
+        const auto *const rangeBegin = begin + worker * pagesPerThread;
+        threads.emplace_back(renumberPageRange, block, rangeBegin, min(rangeBegin + pagesPerThread, end));
+    }
+    renumberPageRange(block, begin, min(begin + pagesPerThread, end));
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+} // namespace
+/// \endcond
+
 void OggContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFeedback &progress)
 {
     const string context("making OGG file");
+    m_iterator.setMemoryAccount(memoryAccount());
+    if (fileInfo().isForcingInPlace()) {
+        diag.emplace_back(DiagLevel::Critical, "Applying changes in-place is not supported for OGG files.", context);
+        throw RewriteRequiredException();
+    }
+    if (m_seeklessOutput) {
+        // the checksums of the pages are updated after writing them
+        diag.emplace_back(DiagLevel::Critical, "Writing OGG files to a seekless output is not supported.", context);
+        throw NotImplementedException();
+    }
     progress.updateStep("Prepare for rewriting OGG file ...");
     parseTags(diag); // tags need to be parsed before the file can be rewritten
     string backupPath;
     NativeFileStream backupStream;
+    m_applyChangesResult.setLayout(true, 0, 0);
+    if (m_planningFile) {
+        // the size of the comments is not computed upfront so the size of the file is assumed unchanged
+        m_applyChangesResult.bytesCopied = m_applyChangesResult.fileSizeAfter = fileInfo().size();
+        return;
+    }
 
     if (fileInfo().saveFilePath().empty()) {
         // move current file to temp dir and reopen it as backupStream, recreate original file
         try {
-            BackupHelper::createBackupFile(fileInfo().backupDirectory(), fileInfo().path(), backupPath, fileInfo().stream(), backupStream);
+            auto backupTimer = ApplyPhaseTimer(fileInfo().statistics(), ApplyPhase::Backup);
+            m_applyChangesResult.backupCopied = BackupHelper::createBackupFile(fileInfo().backupDirectory(), fileInfo().path(), backupPath,
+                fileInfo().stream(), backupStream, fileInfo().backupStrategy(), fileInfo().durabilityPolicy());
+            backupTimer.stop();
             // recreate original file, define buffer variables
             fileInfo().stream().open(BasicFileInfo::pathForOpen(fileInfo().path()), ios_base::out | ios_base::binary | ios_base::trunc);
         } catch (const std::ios_base::failure &failure) {
@@ -409,20 +887,53 @@ void OggContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFeedback
 
         // define misc variables
         CopyHelper<65307> copyHelper;
+        string pageBuffer;
         vector<std::uint64_t> updatedPageOffsets;
         unordered_map<std::uint32_t, std::uint32_t> pageSequenceNumberBySerialNo;
 
+        // copy runs of unchanged pages as one range so the data can be copied by the kernel in one go
+        rangeCopier().open(backupStream, backupPath.empty() ? fileInfo().path() : backupPath, stream(),
+            fileInfo().saveFilePath().empty() ? fileInfo().path() : fileInfo().saveFilePath());
+        std::uint64_t pendingStart = 0, pendingEnd = 0;
+        const auto flushPendingPages = [&] {
+            if (pendingEnd > pendingStart) {
+                backupStream.seekg(static_cast<streamoff>(pendingStart));
+                rangeCopier().copy(backupStream, stream(), pendingEnd - pendingStart);
+            }
+            pendingStart = pendingEnd = 0;
+        };
+
+        // update sequence numbers and checksums of runs of renumbered pages in blocks (possibly using multiple threads)
+        constexpr std::uint64_t maxRenumberBlockSize = 0x400000;
+        const auto threadCount = m_rewriteThreadCount ? m_rewriteThreadCount : max<std::size_t>(thread::hardware_concurrency(), 1);
+        std::uint64_t renumberStart = 0, renumberEnd = 0;
+        vector<RenumberedPage> renumberedPages;
+        vector<char> renumberBlock;
+        const auto flushRenumberedPages = [&] {
+            if (renumberedPages.empty()) {
+                return;
+            }
+            renumberBlock.resize(static_cast<std::size_t>(renumberEnd - renumberStart));
+            backupStream.seekg(static_cast<streamoff>(renumberStart));
+            backupStream.read(renumberBlock.data(), static_cast<streamsize>(renumberBlock.size()));
+            renumberPages(renumberBlock.data(), renumberedPages, threadCount);
+            stream().write(renumberBlock.data(), static_cast<streamsize>(renumberBlock.size()));
+            renumberedPages.clear();
+        };
+
         // iterate through all pages of the original file
         for (m_iterator.setStream(backupStream), m_iterator.removeFilter(), m_iterator.reset(); m_iterator; m_iterator.nextPage()) {
-            const OggPage &currentPage = m_iterator.currentPage();
+            const auto currentPage = m_iterator.currentPage();
             const auto pageSize = currentPage.totalSize();
             std::uint32_t &pageSequenceNumber = pageSequenceNumberBySerialNo[currentPage.streamSerialNumber()];
             // check whether the Vorbis Comment is present in this Ogg page
             if (currentComment && m_iterator.currentPageIndex() >= currentParams->firstPageIndex
                 && m_iterator.currentPageIndex() <= currentParams->lastPageIndex && !currentPage.segmentSizes().empty()) {
+                flushPendingPages();
+                flushRenumberedPages();
                 // page needs to be rewritten (not just copied)
-                // -> write segments to a buffer first
-                stringstream buffer(ios_base::in | ios_base::out | ios_base::binary);
+                // -> write segments to a buffer first (reusing the buffer of previous pages)
+                pageBuffer.clear();
                 vector<std::uint32_t> newSegmentSizes;
                 newSegmentSizes.reserve(currentPage.segmentSizes().size());
                 std::uint64_t segmentOffset = m_iterator.currentSegmentOffset();
@@ -439,7 +950,7 @@ void OggContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFeedback
                         if (!currentParams->removed
                             && ((m_iterator.currentPageIndex() == currentParams->firstPageIndex
                                 && m_iterator.currentSegmentIndex() == currentParams->firstSegmentIndex))) {
-                            makeVorbisCommentSegment(buffer, copyHelper, newSegmentSizes, currentComment, currentParams, diag);
+                            makeVorbisCommentSegment(pageBuffer, newSegmentSizes, currentComment, currentParams, diag);
                         }
 
                         // proceed with next comment?
@@ -454,15 +965,17 @@ void OggContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFeedback
                         }
                     } else {
                         // copy other segments unchanged
+                        const auto bufferOffset = pageBuffer.size();
+                        pageBuffer.resize(bufferOffset + segmentSize);
                         backupStream.seekg(static_cast<streamoff>(segmentOffset));
-                        copyHelper.copy(backupStream, buffer, segmentSize);
+                        backupStream.read(pageBuffer.data() + bufferOffset, static_cast<streamsize>(segmentSize));
                         newSegmentSizes.push_back(segmentSize);
 
                         // check whether there is a new comment to be inserted into the current page
                         if (m_iterator.currentPageIndex() == currentParams->lastPageIndex
                             && currentParams->firstSegmentIndex == numeric_limits<size_t>::max()) {
                             if (!currentParams->removed) {
-                                makeVorbisCommentSegment(buffer, copyHelper, newSegmentSizes, currentComment, currentParams, diag);
+                                makeVorbisCommentSegment(pageBuffer, newSegmentSizes, currentComment, currentParams, diag);
                             }
                             // proceed with next comment
                             if (++tagIterator != tagEnd) {
@@ -480,6 +993,7 @@ void OggContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFeedback
                 // write buffered data to actual stream
                 auto newSegmentSizesIterator = newSegmentSizes.cbegin(), newSegmentSizesEnd = newSegmentSizes.cend();
                 bool continuePreviousSegment = false;
+                const char *pageData = pageBuffer.data();
                 if (newSegmentSizesIterator != newSegmentSizesEnd) {
                     std::uint32_t bytesLeft = *newSegmentSizesIterator;
                     // write pages until all data in the buffer is written
@@ -536,7 +1050,8 @@ void OggContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFeedback
                         stream().put(static_cast<char>(segmentSizesWritten));
                         stream().seekp(segmentSizesWritten, ios_base::cur);
                         // -> write actual page data
-                        copyHelper.copy(buffer, stream(), currentSize);
+                        stream().write(pageData, static_cast<streamsize>(currentSize));
+                        pageData += currentSize;
 
                         ++pageSequenceNumber;
                     }
@@ -545,21 +1060,31 @@ void OggContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFeedback
             } else {
                 if (pageSequenceNumber != m_iterator.currentPageIndex()) {
                     // just update page sequence number
-                    backupStream.seekg(static_cast<streamoff>(currentPage.startOffset()));
-                    updatedPageOffsets.push_back(static_cast<std::uint64_t>(stream().tellp())); // memorize offset to update checksum later
-                    copyHelper.copy(backupStream, stream(), 27);
-                    stream().seekp(-9, ios_base::cur);
-                    writer().writeUInt32LE(pageSequenceNumber);
-                    stream().seekp(5, ios_base::cur);
-                    copyHelper.copy(backupStream, stream(), pageSize - 27);
+                    // -> deferred to read subsequent pages as one block and update their checksums right away
+                    flushPendingPages();
+                    if (renumberedPages.empty() || renumberEnd != currentPage.startOffset()
+                        || renumberEnd - renumberStart + pageSize > maxRenumberBlockSize) {
+                        flushRenumberedPages();
+                        renumberStart = currentPage.startOffset();
+                    }
+                    renumberedPages.emplace_back(
+                        RenumberedPage{ static_cast<std::uint32_t>(currentPage.startOffset() - renumberStart), pageSequenceNumber });
+                    renumberEnd = currentPage.startOffset() + pageSize;
                 } else {
-                    // copy page unchanged
-                    backupStream.seekg(static_cast<streamoff>(currentPage.startOffset()));
-                    copyHelper.copy(backupStream, stream(), pageSize);
+                    // copy page unchanged (deferred to copy subsequent unchanged pages at once)
+                    flushRenumberedPages();
+                    if (pendingEnd != currentPage.startOffset()) {
+                        flushPendingPages();
+                        pendingStart = currentPage.startOffset();
+                    }
+                    pendingEnd = currentPage.startOffset() + pageSize;
                 }
                 ++pageSequenceNumber;
             }
         }
+        flushPendingPages();
+        flushRenumberedPages();
+        rangeCopier().close();
 
         // report new size
         fileInfo().reportSizeChanged(static_cast<std::uint64_t>(stream().tellp()));
@@ -583,11 +1108,14 @@ void OggContainer::internalMakeFile(Diagnostics &diag, AbortableProgressFeedback
         // prevent deferring final write operations (to catch and handle possible errors here)
         fileInfo().stream().flush();
 
-        // clear iterator
+        // clear iterator and index
         m_iterator.clear(fileInfo().stream(), startOffset(), fileInfo().size());
+        m_pageIndex.clear(fileInfo().stream(), startOffset(), fileInfo().size());
 
     } catch (...) {
+        rangeCopier().close();
         m_iterator.setStream(fileInfo().stream());
+        m_pageIndex.setStream(fileInfo().stream());
         BackupHelper::handleFailureAfterFileModified(fileInfo(), backupPath, fileInfo().stream(), backupStream, diag, context);
     }
 }
@@ -3,6 +3,7 @@
 
 #include "./oggiterator.h"
 #include "./oggpage.h"
+#include "./oggpageindex.h"
 #include "./oggstream.h"
 
 #include "../vorbis/vorbiscomment.h"
@@ -12,10 +13,6 @@
 #include <tuple>
 #include <unordered_map>
 
-namespace CppUtilities {
-template <std::size_t bufferSize> class CopyHelper;
-}
-
 namespace TagParser {
 
 class MediaFileInfo;
@@ -135,6 +132,11 @@ public:
 
     bool isChecksumValidationEnabled() const;
     void setChecksumValidationEnabled(bool enabled);
+    std::size_t rewriteThreadCount() const;
+    void setRewriteThreadCount(std::size_t threadCount);
+    OggPageIndex &pageIndex();
+    void verifyChecksums(Diagnostics &diag, std::size_t threadCount = 0);
+    void hashMediaPayload(MediaPayloadHasher &hasher, Diagnostics &diag, AbortableProgressFeedback &progress) override;
     void reset() override;
 
     OggVorbisComment *createTag(const TagTarget &target) override;
@@ -147,18 +149,23 @@ protected:
     void internalParseHeader(Diagnostics &diag) override;
     void internalParseTags(Diagnostics &diag) override;
     void internalParseTracks(Diagnostics &diag) override;
+    bool internalResumeParsing(Diagnostics &diag) override;
     void internalMakeFile(Diagnostics &diag, AbortableProgressFeedback &progress) override;
 
 private:
+    void parsePages(OggPageTable::size_type firstPage, Diagnostics &diag);
     void announceComment(
         std::size_t pageIndex, std::size_t segmentIndex, bool lastMetaDataBlock, GeneralMediaFormat mediaFormat = GeneralMediaFormat::Vorbis);
-    void makeVorbisCommentSegment(std::stringstream &buffer, CppUtilities::CopyHelper<65307> &copyHelper, std::vector<std::uint32_t> &newSegmentSizes,
-        VorbisComment *comment, OggParameter *params, Diagnostics &diag);
+    void makeVorbisCommentSegment(
+        std::string &buffer, std::vector<std::uint32_t> &newSegmentSizes, VorbisComment *comment, OggParameter *params, Diagnostics &diag);
 
     std::unordered_map<std::uint32_t, std::vector<std::unique_ptr<OggStream>>::size_type> m_streamsBySerialNo;
 
     OggIterator m_iterator;
+    OggPageIndex m_pageIndex;
     bool m_validateChecksums;
+    bool m_pagesSkipped;
+    std::size_t m_rewriteThreadCount;
 };
 
 /*!
@@ -183,6 +190,47 @@ inline void OggContainer::setChecksumValidationEnabled(bool enabled)
     m_validateChecksums = enabled;
 }
 
+/*!
+ * \brief Returns the number of threads used to update the sequence numbers and checksums of pages when rewriting the file.
+ *
+ * When tags grow or shrink so that the number of pages changes, all subsequent pages of the stream need to be
+ * renumbered which also requires updating their checksums. These pages are read in blocks which are processed
+ * by the specified number of threads before being written in order.
+ *
+ * A value of zero means the number of hardware threads is used. The default is one (no additional threads).
+ *
+ * \remarks Since the checksums are updated via OggPage::updateSequenceNumber() the costs per page are small and do not
+ *          depend on the page size. Hence using multiple threads only pays off for a huge number of pages.
+ * \sa setRewriteThreadCount()
+ */
+inline std::size_t OggContainer::rewriteThreadCount() const
+{
+    return m_rewriteThreadCount;
+}
+
+/*!
+ * \brief Sets the number of threads used to update the sequence numbers and checksums of pages when rewriting the file.
+ * \sa rewriteThreadCount()
+ */
+inline void OggContainer::setRewriteThreadCount(std::size_t threadCount)
+{
+    m_rewriteThreadCount = threadCount;
+}
+
+/*!
+ * \brief Returns the index of the OGG pages.
+ *
+ * The index contains the pages fetched when parsing the header and is extended lazily when looking up pages. It can
+ * be used to find the page containing a certain granule position (for seeking) and may be persisted to speed up
+ * subsequent lookups.
+ *
+ * \remarks The index is cleared when the file is rewritten.
+ */
+inline OggPageIndex &OggContainer::pageIndex()
+{
+    return m_pageIndex;
+}
+
 } // namespace TagParser
 
 #endif // TAG_PARSER_OGGCONTAINER_H
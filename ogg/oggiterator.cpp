@@ -4,8 +4,10 @@
 
 #include <c++utilities/io/binaryreader.h>
 
-#include <iostream>
+#include <algorithm>
+#include <istream>
 #include <limits>
+#include <ostream>
 
 using namespace std;
 using namespace CppUtilities;
@@ -22,7 +24,8 @@ namespace TagParser {
  *
  * To go on call the appropriate methods. Parsing exceptions and IO exceptions might occur during iteration.
  *
- * The internal buffer of OGG pages might be accessed using the pages() method.
+ * The internal buffer of OGG pages might be accessed using the pages() method. The pages are stored within an
+ * OggPageTable so holding the pages of long streams does not require an allocation per page.
  */
 
 /*!
@@ -46,7 +49,7 @@ void OggIterator::clear(istream &stream, std::uint64_t startOffset, std::uint64_
 void OggIterator::reset()
 {
     for (m_page = m_segment = m_offset = 0; m_page < m_pages.size() || fetchNextPage(); ++m_page) {
-        const OggPage &page = m_pages[m_page];
+        const auto page = m_pages[m_page];
         if (!page.segmentSizes().empty() && matchesFilter(page)) {
             // page is not empty and matches ID filter if set
             m_offset = page.startOffset() + page.headerSize();
@@ -63,7 +66,7 @@ void OggIterator::reset()
 void OggIterator::nextPage()
 {
     while (++m_page < m_pages.size() || fetchNextPage()) {
-        const OggPage &page = m_pages[m_page];
+        const auto page = m_pages[m_page];
         if (!page.segmentSizes().empty() && matchesFilter(page)) {
             // page is not empty and matches ID filter if set
             m_segment = m_bytesRead = 0;
@@ -80,7 +83,7 @@ void OggIterator::nextPage()
  */
 void OggIterator::nextSegment()
 {
-    const OggPage &page = m_pages[m_page];
+    const auto page = m_pages[m_page];
     if (matchesFilter(page) && ++m_segment < page.segmentSizes().size()) {
         // current page has next segment
         m_bytesRead = 0;
@@ -98,7 +101,7 @@ void OggIterator::nextSegment()
 void OggIterator::previousPage()
 {
     while (m_page) {
-        const OggPage &page = m_pages[--m_page];
+        const auto page = m_pages[--m_page];
         if (matchesFilter(page)) {
             m_offset = page.dataOffset(m_segment = page.segmentSizes().size() - 1);
             return;
@@ -112,7 +115,7 @@ void OggIterator::previousPage()
  */
 void OggIterator::previousSegment()
 {
-    const OggPage &page = m_pages[m_page];
+    const auto page = m_pages[m_page];
     if (m_segment && matchesFilter(page)) {
         m_offset -= page.segmentSizes()[m_segment--];
     } else {
@@ -136,13 +139,17 @@ void OggIterator::read(char *buffer, size_t count)
     size_t bytesRead = 0;
     while (*this && count) {
         const auto available = currentSegmentSize() - m_bytesRead;
-        stream().seekg(static_cast<streamoff>(currentCharacterOffset()));
+        const auto bytesToRead = count <= available ? count : available;
+        if (const char *const data = mappedData(currentCharacterOffset(), bytesToRead)) {
+            std::copy(data, data + bytesToRead, buffer + bytesRead);
+        } else {
+            stream().seekg(static_cast<streamoff>(currentCharacterOffset()));
+            stream().read(buffer + bytesRead, static_cast<streamoff>(bytesToRead));
+        }
         if (count <= available) {
-            stream().read(buffer + bytesRead, static_cast<streamoff>(count));
             m_bytesRead += count;
             return;
         }
-        stream().read(buffer + bytesRead, available);
         nextSegment();
         bytesRead += available;
         count -= available;
@@ -170,13 +177,17 @@ size_t OggIterator::readAll(char *buffer, size_t max)
     size_t bytesRead = 0;
     while (*this && max) {
         const std::uint32_t available = currentSegmentSize() - m_bytesRead;
-        stream().seekg(static_cast<streamoff>(currentCharacterOffset()));
+        const auto bytesToRead = max <= available ? max : available;
+        if (const char *const data = mappedData(currentCharacterOffset(), bytesToRead)) {
+            std::copy(data, data + bytesToRead, buffer + bytesRead);
+        } else {
+            stream().seekg(static_cast<streamoff>(currentCharacterOffset()));
+            stream().read(buffer + bytesRead, static_cast<streamoff>(bytesToRead));
+        }
         if (max <= available) {
-            stream().read(buffer + bytesRead, static_cast<streamoff>(max));
             m_bytesRead += max;
             return bytesRead + max;
         } else {
-            stream().read(buffer + bytesRead, available);
             nextSegment();
             bytesRead += available;
             max -= available;
@@ -185,6 +196,63 @@ size_t OggIterator::readAll(char *buffer, size_t max)
     return bytesRead;
 }
 
+/*!
+ * \brief Reads the remaining bytes of the current packet into one buffer.
+ *
+ * The spans of the packet within the current and the following pages are gathered first. Then the data of each span is
+ * copied at once. This is much cheaper than reading a packet piece by piece via read() which has to check the segment
+ * boundaries for every single call.
+ *
+ * \remarks
+ * - A packet ends with a segment which is not the last one of its page or whose next page is not flagged as continued.
+ * - Might increase the current page index and/or the current segment index. The iterator is positioned at the end of
+ *   the last segment of the packet (like after reading the packet via read()).
+ * \returns Returns the buffer and its size.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+std::pair<std::unique_ptr<char[]>, std::size_t> OggIterator::readPacket()
+{
+    // gather spans of the packet
+    auto spans = std::vector<std::pair<std::uint64_t, std::uint32_t>>();
+    auto packetSize = std::size_t();
+    while (*this) {
+        if (const auto available = currentSegmentSize() - m_bytesRead) {
+            spans.emplace_back(currentCharacterOffset(), available);
+            packetSize += available;
+            m_bytesRead += available;
+        }
+        if (m_segment + 1 < m_pages[m_page].segmentSizes().size()) {
+            break;
+        }
+        // go to the next page only if it continues the packet; otherwise stay at the last segment of the packet
+        const auto page = m_page, segment = m_segment;
+        const auto offset = m_offset;
+        const auto bytesRead = m_bytesRead;
+        nextSegment();
+        if (!*this || !m_pages[m_page].isContinued()) {
+            m_page = page;
+            m_segment = segment;
+            m_offset = offset;
+            m_bytesRead = bytesRead;
+            break;
+        }
+    }
+
+    // read the data of the spans
+    auto buffer = make_unique<char[]>(packetSize);
+    auto *out = buffer.get();
+    for (const auto &[offset, size] : spans) {
+        if (const char *const data = mappedData(offset, size)) {
+            std::copy(data, data + size, out);
+        } else {
+            stream().seekg(static_cast<streamoff>(offset));
+            stream().read(out, static_cast<streamoff>(size));
+        }
+        out += size;
+    }
+    return make_pair(move(buffer), packetSize);
+}
+
 /*!
  * \brief Advances the position of the next character to be read from the OGG stream by \a count bytes.
  * \remarks
@@ -230,46 +298,64 @@ void OggIterator::ignore(size_t count)
  * If a page could be found, it is appended to pages() and the iterator position is set to the first segment of
  * that page. If no page could be found, this method does not alter the iterator.
  *
+ * The stream is read block-wise (or not at all if mapped data has been set) and candidate pages are validated from
+ * the buffer. If \a verifyChecksum is true, candidates are only accepted if their checksum matches as well. This
+ * prevents mistaking data which happens to contain the capture pattern for a page.
+ *
  * \returns Returns an indication whether a page could be found.
  * \throws Throws std::ios_base::failure when an IO error occurs.
  * \throws Throws Failure when a parsing error occurs.
  */
-bool OggIterator::resyncAt(std::uint64_t offset)
+bool OggIterator::resyncAt(std::uint64_t offset, bool verifyChecksum)
 {
     // check whether offset is valid
     if (offset >= streamSize() || offset < (m_pages.empty() ? m_startOffset : m_pages.back().startOffset() + m_pages.back().totalSize())) {
         return false;
     }
 
-    // find capture pattern 'OggS'
-    stream().seekg(static_cast<streamoff>(offset));
-    std::uint8_t lettersFound = 0;
-    for (std::uint64_t bytesAvailable = max<std::uint64_t>(streamSize() - offset, 65307ul); bytesAvailable >= 27; --bytesAvailable) {
-        switch (static_cast<char>(stream().get())) {
-        case 'O':
-            lettersFound = 1;
-            break;
-        case 'g':
-            lettersFound = lettersFound == 1 || lettersFound == 2 ? lettersFound + 1 : 0;
-            break;
-        case 'S':
-            if (lettersFound == 3) {
-                // capture pattern found
-                const auto currentOffset = stream().tellg();
-                // -> try to parse an OGG page at this position
-                try {
-                    m_pages.emplace_back(stream(), static_cast<std::uint64_t>(stream().tellg()) - 4,
-                        bytesAvailable > numeric_limits<std::int32_t>::max() ? numeric_limits<std::int32_t>::max()
-                                                                             : static_cast<std::int32_t>(bytesAvailable));
-                    setPageIndex(m_pages.size() - 1);
-                    return true;
-                } catch (const Failure &) {
-                    stream().seekg(currentOffset);
+    // search the capture pattern 'OggS' block-wise (or within the mapped data at once)
+    // note: A block contains the header of pages starting within the first searchSize bytes so candidates can be
+    //       validated from the buffer.
+    const auto *const mapped = mappedData(offset, streamSize() - offset);
+    const auto searchSize = mapped ? static_cast<std::size_t>(streamSize() - offset) : static_cast<std::size_t>(0x10000);
+    auto buffer = std::unique_ptr<char[]>();
+    for (auto blockOffset = offset; streamSize() - blockOffset >= 27; blockOffset += searchSize) {
+        const auto blockSize = static_cast<std::size_t>(min<std::uint64_t>(streamSize() - blockOffset, searchSize + OggPage::maxHeaderSize()));
+        const auto *block = mapped ? mapped + (blockOffset - offset) : nullptr;
+        if (!block) {
+            if (!buffer) {
+                buffer = make_unique<char[]>(searchSize + OggPage::maxHeaderSize());
+            }
+            stream().seekg(static_cast<streamoff>(blockOffset));
+            stream().read(buffer.get(), static_cast<streamsize>(blockSize));
+            block = buffer.get();
+        }
+        const auto blockData = std::string_view(block, blockSize);
+        for (auto i = blockData.find("OggS"); i < searchSize && i != std::string_view::npos; i = blockData.find("OggS", i + 1)) {
+            // -> try to parse an OGG page at this position
+            const auto pageOffset = blockOffset + i;
+            const auto bytesAvailable = streamSize() - pageOffset;
+            if (m_fetchedPage.tryParseHeader(block + i, pageOffset,
+                    bytesAvailable > numeric_limits<std::int32_t>::max() ? numeric_limits<std::int32_t>::max()
+                                                                         : static_cast<std::int32_t>(bytesAvailable))
+                != ParsingError::None) {
+                continue;
+            }
+            // -> skip the page if its checksum does not match (the page is checked from the buffer if it is contained completely)
+            if (verifyChecksum) {
+                const auto pageSize = m_fetchedPage.totalSize();
+                const auto checksum = i + pageSize <= blockSize ? OggPage::computeChecksum(block + i)
+                                                                : OggPage::computeChecksum(stream(), pageOffset);
+                if (checksum != m_fetchedPage.checksum()) {
+                    continue;
                 }
             }
-            [[fallthrough]];
-        default:
-            lettersFound = 0;
+            addFetchedPage();
+            setPageIndex(m_pages.size() - 1);
+            return true;
+        }
+        if (blockSize <= searchSize) {
+            break;
         }
     }
     return false;
@@ -291,13 +377,31 @@ bool OggIterator::fetchNextPage()
         m_offset = m_pages.empty() ? m_startOffset : m_pages.back().startOffset() + m_pages.back().totalSize();
         if (m_offset < m_streamSize) {
             const std::uint64_t bytesAvailable = m_streamSize - m_offset;
-            m_pages.emplace_back(*m_stream, m_offset,
-                bytesAvailable > numeric_limits<std::int32_t>::max() ? numeric_limits<std::int32_t>::max()
-                                                                     : static_cast<std::int32_t>(bytesAvailable));
+            const auto maxSize = bytesAvailable > numeric_limits<std::int32_t>::max() ? numeric_limits<std::int32_t>::max()
+                                                                                      : static_cast<std::int32_t>(bytesAvailable);
+            if (const char *const header = mappedData(m_offset, min<std::uint64_t>(bytesAvailable, OggPage::maxHeaderSize()))) {
+                m_fetchedPage.parseHeader(header, m_offset, maxSize);
+            } else {
+                m_fetchedPage.parseHeader(*m_stream, m_offset, maxSize);
+            }
+            // parse into the same OggPage object to avoid allocating the segment sizes for each page
+            addFetchedPage();
             return true;
         }
     }
     return false;
 }
 
+/*!
+ * \brief Adds the fetched page to the page table accounting its memory.
+ * \throws Throws MemoryLimitExceededException if the limit of the memory account would be exceeded.
+ */
+void OggIterator::addFetchedPage()
+{
+    if (m_memoryAccount) {
+        m_memoryAccount->allocate(OggPageTable::memoryUsage(m_fetchedPage.segmentSizes().size()));
+    }
+    m_pages.push_back(m_fetchedPage);
+}
+
 } // namespace TagParser
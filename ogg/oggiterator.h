@@ -1,9 +1,14 @@
 #ifndef TAG_PARSER_OGGITERATOR_H
 #define TAG_PARSER_OGGITERATOR_H
 
-#include "./oggpage.h"
+#include "./oggpagetable.h"
+
+#include "../memoryaccount.h"
 
 #include <iosfwd>
+#include <memory>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace TagParser {
@@ -15,18 +20,21 @@ public:
     void clear(std::istream &stream, std::uint64_t startOffset, std::uint64_t streamSize);
     std::istream &stream();
     void setStream(std::istream &stream);
+    void setMappedData(const std::string_view *mappedData);
+    void setMemoryAccount(MemoryAccount *account);
     std::uint64_t startOffset() const;
     std::uint64_t streamSize() const;
+    void setStreamSize(std::uint64_t streamSize);
     void reset();
     void nextPage();
     void nextSegment();
     void previousPage();
     void previousSegment();
-    const std::vector<OggPage> &pages() const;
-    const OggPage &currentPage() const;
+    const OggPageTable &pages() const;
+    OggPageView currentPage() const;
     std::uint64_t currentPageOffset() const;
-    std::vector<OggPage>::size_type currentPageIndex() const;
-    void setPageIndex(std::vector<OggPage>::size_type index);
+    OggPageTable::size_type currentPageIndex() const;
+    void setPageIndex(OggPageTable::size_type index);
     void setSegmentIndex(std::vector<std::uint32_t>::size_type index);
     std::vector<std::uint32_t>::size_type currentSegmentIndex() const;
     std::uint64_t currentSegmentOffset() const;
@@ -38,9 +46,10 @@ public:
     bool isLastPageFetched() const;
     void read(char *buffer, std::size_t count);
     std::size_t readAll(char *buffer, std::size_t max);
+    std::pair<std::unique_ptr<char[]>, std::size_t> readPacket();
     void ignore(std::size_t count = 1);
     bool bytesRemaining(std::size_t atLeast) const;
-    bool resyncAt(std::uint64_t offset);
+    bool resyncAt(std::uint64_t offset, bool verifyChecksum = false);
 
     operator bool() const;
     OggIterator &operator++();
@@ -50,13 +59,18 @@ public:
 
 private:
     bool fetchNextPage();
-    bool matchesFilter(const OggPage &page);
+    void addFetchedPage();
+    bool matchesFilter(const OggPageView &page);
+    const char *mappedData(std::uint64_t offset, std::uint64_t size) const;
 
     std::istream *m_stream;
+    const std::string_view *m_mappedData;
+    MemoryAccount *m_memoryAccount;
     std::uint64_t m_startOffset;
     std::uint64_t m_streamSize;
-    std::vector<OggPage> m_pages;
-    std::vector<OggPage>::size_type m_page;
+    OggPageTable m_pages;
+    OggPage m_fetchedPage;
+    OggPageTable::size_type m_page;
     std::vector<std::uint32_t>::size_type m_segment;
     std::uint64_t m_offset;
     std::uint32_t m_bytesRead;
@@ -69,6 +83,8 @@ private:
  */
 inline OggIterator::OggIterator(std::istream &stream, std::uint64_t startOffset, std::uint64_t streamSize)
     : m_stream(&stream)
+    , m_mappedData(nullptr)
+    , m_memoryAccount(nullptr)
     , m_startOffset(startOffset)
     , m_streamSize(streamSize)
     , m_page(0)
@@ -100,6 +116,26 @@ inline void OggIterator::setStream(std::istream &stream)
     m_stream = &stream;
 }
 
+/*!
+ * \brief Sets the memory-mapped data of the stream to be used instead of the stream for reading if possible.
+ * \remarks
+ * - The specified view is only referenced and must outlive the iterator. It is supposed to be updated when
+ *   the mapping becomes unavailable, e.g. it should be BasicFileInfo::mappedData().
+ * - The mapped data must be the same as the data of the stream to keep the iterator in a sane state.
+ */
+inline void OggIterator::setMappedData(const std::string_view *mappedData)
+{
+    m_mappedData = mappedData;
+}
+
+/*!
+ * \brief Sets the account the fetched pages are accounted in; nullptr disables accounting.
+ */
+inline void OggIterator::setMemoryAccount(MemoryAccount *account)
+{
+    m_memoryAccount = account;
+}
+
 /*!
  * \brief Returns the start offset (which has been specified when constructing the iterator).
  */
@@ -117,9 +153,18 @@ inline std::uint64_t OggIterator::streamSize() const
 }
 
 /*!
- * \brief Returns a vector of containing the OGG pages that have been fetched yet.
+ * \brief Sets the stream size, e.g. after data has been appended to the stream.
+ * \remarks The fetched pages are kept so subsequent pages are fetched from the end of the last fetched page.
  */
-inline const std::vector<OggPage> &OggIterator::pages() const
+inline void OggIterator::setStreamSize(std::uint64_t streamSize)
+{
+    m_streamSize = streamSize;
+}
+
+/*!
+ * \brief Returns the table containing the OGG pages that have been fetched yet.
+ */
+inline const OggPageTable &OggIterator::pages() const
 {
     return m_pages;
 }
@@ -128,7 +173,7 @@ inline const std::vector<OggPage> &OggIterator::pages() const
  * \brief Returns the current OGG page.
  * \remarks Calling this method when the iterator is invalid causes undefined behaviour.
  */
-inline const OggPage &OggIterator::currentPage() const
+inline OggPageView OggIterator::currentPage() const
 {
     return m_pages[m_page];
 }
@@ -160,7 +205,7 @@ inline OggIterator::operator bool() const
 /*!
  * \brief Returns the index of the current page if the iterator is valid; otherwise an undefined index is returned.
  */
-inline std::vector<OggPage>::size_type OggIterator::currentPageIndex() const
+inline OggPageTable::size_type OggIterator::currentPageIndex() const
 {
     return m_page;
 }
@@ -169,9 +214,9 @@ inline std::vector<OggPage>::size_type OggIterator::currentPageIndex() const
  * \brief Sets the current page index.
  * \remarks This method should never be called with an \a index out of range (which is defined by the number of fetched pages), since this would cause undefined behaviour.
  */
-inline void OggIterator::setPageIndex(std::vector<OggPage>::size_type index)
+inline void OggIterator::setPageIndex(OggPageTable::size_type index)
 {
-    const OggPage &page = m_pages[m_page = index];
+    const auto page = m_pages[m_page = index];
     m_segment = 0;
     m_offset = page.startOffset() + page.headerSize();
 }
@@ -183,7 +228,7 @@ inline void OggIterator::setPageIndex(std::vector<OggPage>::size_type index)
  */
 inline void OggIterator::setSegmentIndex(std::vector<std::uint32_t>::size_type index)
 {
-    const OggPage &page = m_pages[m_page];
+    const auto page = m_pages[m_page];
     m_offset = page.dataOffset(m_segment = index);
 }
 
@@ -311,11 +356,21 @@ inline OggIterator OggIterator::operator--(int)
 /*!
  * \brief Returns whether the specified \a page matches the current filter.
  */
-inline bool OggIterator::matchesFilter(const OggPage &page)
+inline bool OggIterator::matchesFilter(const OggPageView &page)
 {
     return !m_hasIdFilter || m_idFilter == page.streamSerialNumber();
 }
 
+/*!
+ * \brief Returns a pointer to \a size bytes at the specified \a offset within the mapped data or nullptr if not mapped.
+ */
+inline const char *OggIterator::mappedData(std::uint64_t offset, std::uint64_t size) const
+{
+    return m_mappedData && !m_mappedData->empty() && offset <= m_mappedData->size() && size <= m_mappedData->size() - offset
+        ? m_mappedData->data() + offset
+        : nullptr;
+}
+
 } // namespace TagParser
 
 #endif // TAG_PARSER_OGGITERATOR_H
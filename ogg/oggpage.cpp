@@ -3,7 +3,9 @@
 #include "../exceptions.h"
 
 #include <c++utilities/conversion/binaryconversion.h>
-#include <c++utilities/io/binaryreader.h>
+
+#include <algorithm>
+#include <istream>
 
 using namespace std;
 using namespace CppUtilities;
@@ -23,37 +25,80 @@ namespace TagParser {
  */
 void OggPage::parseHeader(istream &stream, std::uint64_t startOffset, std::int32_t maxSize)
 {
-    // prepare reading
+    throwOnParsingError(tryParseHeader(stream, startOffset, maxSize));
+}
+
+/*!
+ * \brief Parses the header from the specified \a buffer which contains the page at the specified \a startOffset.
+ * \remarks The \a buffer must contain at least \a maxSize or maxHeaderSize() bytes, whichever is less.
+ * \throws Throws InvalidDataException if the capture pattern is not present.
+ * \throws Throws TruncatedDataException if the header is truncated (according to \a maxSize).
+ */
+void OggPage::parseHeader(const char *buffer, std::uint64_t startOffset, std::int32_t maxSize)
+{
+    throwOnParsingError(tryParseHeader(buffer, startOffset, maxSize));
+}
+
+/*!
+ * \brief Parses the header read from the specified \a stream at the specified \a startOffset like parseHeader() but
+ *        returns parsing errors instead of throwing.
+ * \returns Returns ParsingError::InvalidData if the capture pattern is not present and ParsingError::TruncatedData if
+ *          the header is truncated (according to \a maxSize).
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+ParsingError OggPage::tryParseHeader(istream &stream, std::uint64_t startOffset, std::int32_t maxSize)
+{
+    if (maxSize < 27) {
+        return ParsingError::TruncatedData;
+    }
+    // read fixed-size part and segment table at once
+    char buffer[maxHeaderSize()];
     stream.seekg(static_cast<streamoff>(startOffset));
-    BinaryReader reader(&stream);
+    stream.read(buffer, 27);
+    if (const auto segmentCount = static_cast<std::uint8_t>(buffer[26]); segmentCount && maxSize - 27 >= segmentCount) {
+        stream.read(buffer + 27, segmentCount);
+    }
+    return tryParseHeader(buffer, startOffset, maxSize);
+}
+
+/*!
+ * \brief Parses the header from the specified \a buffer like parseHeader() but returns parsing errors instead of
+ *        throwing.
+ * \returns Returns ParsingError::InvalidData if the capture pattern is not present and ParsingError::TruncatedData if
+ *          the header is truncated (according to \a maxSize).
+ * \remarks This is used when searching for pages (see OggIterator::resyncAt()) where most candidates are invalid.
+ */
+ParsingError OggPage::tryParseHeader(const char *buffer, std::uint64_t startOffset, std::int32_t maxSize)
+{
     if (maxSize < 27) {
-        throw TruncatedDataException();
+        return ParsingError::TruncatedData;
     } else {
         maxSize -= 27;
     }
     // read header values
-    if (reader.readUInt32LE() != 0x5367674f) {
-        throw InvalidDataException();
+    if (LE::toUInt32(buffer) != 0x5367674f) {
+        return ParsingError::InvalidData;
     }
     m_startOffset = startOffset;
-    m_streamStructureVersion = reader.readByte();
-    m_headerTypeFlag = reader.readByte();
-    m_absoluteGranulePosition = reader.readUInt64LE();
-    m_streamSerialNumber = reader.readUInt32LE();
-    m_sequenceNumber = reader.readUInt32LE();
-    m_checksum = reader.readUInt32LE();
-    m_segmentCount = reader.readByte();
+    m_streamStructureVersion = static_cast<std::uint8_t>(buffer[4]);
+    m_headerTypeFlag = static_cast<std::uint8_t>(buffer[5]);
+    m_absoluteGranulePosition = LE::toUInt64(buffer + 6);
+    m_streamSerialNumber = LE::toUInt32(buffer + 14);
+    m_sequenceNumber = LE::toUInt32(buffer + 18);
+    m_checksum = LE::toUInt32(buffer + 22);
+    m_segmentCount = static_cast<std::uint8_t>(buffer[26]);
     m_segmentSizes.clear();
     if (m_segmentCount > 0) {
         if (maxSize < m_segmentCount) {
-            throw TruncatedDataException();
+            return ParsingError::TruncatedData;
         } else {
             maxSize -= m_segmentCount;
         }
         // read segment size tabe
         m_segmentSizes.push_back(0);
+        const auto *const segmentTable = reinterpret_cast<const std::uint8_t *>(buffer + 27);
         for (std::uint8_t i = 0; i < m_segmentCount;) {
-            std::uint8_t entry = reader.readByte();
+            const std::uint8_t entry = segmentTable[i];
             maxSize -= entry;
             m_segmentSizes.back() += entry;
             if (++i < m_segmentCount && entry < 0xff) {
@@ -62,48 +107,171 @@ void OggPage::parseHeader(istream &stream, std::uint64_t startOffset, std::int32
         }
         // check whether the maximum size is exceeded
         if (maxSize < 0) {
-            throw TruncatedDataException();
+            return ParsingError::TruncatedData;
+        }
+    }
+    return ParsingError::None;
+}
+
+/// \cond
+namespace {
+
+/*!
+ * \brief The Crc32Tables struct holds the lookup tables for computing the CRC-32 used by OGG via slicing-by-8.
+ *
+ * OGG uses the polynomial 0x04C11DB7 without reflecting the input/output, an initial value of zero and no final XOR. The
+ * first table is the usual byte-wise lookup table (equal to BinaryReader::crc32Table); table k is used for a byte which
+ * is followed by k further bytes within the current 8-byte block.
+ */
+struct Crc32Tables {
+    constexpr Crc32Tables()
+        : values()
+    {
+        for (std::uint32_t i = 0; i != 256; ++i) {
+            auto crc = i << 24;
+            for (auto bit = 0; bit != 8; ++bit) {
+                crc = (crc & 0x80000000u) ? ((crc << 1) ^ 0x04C11DB7u) : (crc << 1);
+            }
+            values[0][i] = crc;
+        }
+        for (std::size_t table = 1; table != 8; ++table) {
+            for (std::size_t i = 0; i != 256; ++i) {
+                values[table][i] = (values[table - 1][i] << 8) ^ values[0][values[table - 1][i] >> 24];
+            }
         }
     }
+    std::uint32_t values[8][256];
+};
+
+constexpr Crc32Tables crc32Tables;
+
+/*!
+ * \brief Updates the specified \a crc with \a size bytes from \a data processing 8 bytes per iteration.
+ */
+std::uint32_t updateCrc32(std::uint32_t crc, const char *data, std::size_t size)
+{
+    const auto *bytes = reinterpret_cast<const std::uint8_t *>(data);
+    const auto &t = crc32Tables.values;
+    for (; size >= 8; bytes += 8, size -= 8) {
+        crc ^= (static_cast<std::uint32_t>(bytes[0]) << 24) | (static_cast<std::uint32_t>(bytes[1]) << 16)
+            | (static_cast<std::uint32_t>(bytes[2]) << 8) | static_cast<std::uint32_t>(bytes[3]);
+        crc = t[7][crc >> 24] ^ t[6][(crc >> 16) & 0xFF] ^ t[5][(crc >> 8) & 0xFF] ^ t[4][crc & 0xFF] ^ t[3][bytes[4]] ^ t[2][bytes[5]]
+            ^ t[1][bytes[6]] ^ t[0][bytes[7]];
+    }
+    for (; size; ++bytes, --size) {
+        crc = (crc << 8) ^ t[0][((crc >> 24) & 0xFF) ^ *bytes];
+    }
+    return crc;
+}
+
+/*!
+ * \brief Updates the specified \a crc with the page header in \a header treating the denoted checksum as zero.
+ */
+std::uint32_t updateCrc32WithHeader(std::uint32_t crc, const char *header, std::size_t headerSize)
+{
+    static constexpr char zeroChecksum[4] = { 0, 0, 0, 0 };
+    crc = updateCrc32(crc, header, 22);
+    crc = updateCrc32(crc, zeroChecksum, 4);
+    return updateCrc32(crc, header + 26, headerSize - 26);
 }
 
+/*!
+ * \brief Returns \a a * \a b modulo the CRC polynomial (with bit 31 being the coefficient of x^31).
+ */
+constexpr std::uint32_t multiplyModPolynomial(std::uint32_t a, std::uint32_t b)
+{
+    auto product = std::uint32_t();
+    for (auto bit = 31; bit >= 0; --bit) {
+        product = (product & 0x80000000u) ? ((product << 1) ^ 0x04C11DB7u) : (product << 1);
+        if ((a >> bit) & 1) {
+            product ^= b;
+        }
+    }
+    return product;
+}
+
+/*!
+ * \brief The ZeroShiftTable struct holds x^(8 * 2^k) modulo the CRC polynomial for k = 0 to 31.
+ *
+ * Appending n zero bytes to a message multiplies its CRC (with an initial value of zero) by x^(8 * n). So the CRC
+ * after appending n zero bytes can be computed by multiplying with the entries corresponding to the bits set in n.
+ */
+struct ZeroShiftTable {
+    constexpr ZeroShiftTable()
+        : values()
+    {
+        values[0] = 0x100u;
+        for (std::size_t k = 1; k != 32; ++k) {
+            values[k] = multiplyModPolynomial(values[k - 1], values[k - 1]);
+        }
+    }
+    std::uint32_t values[32];
+};
+
+constexpr ZeroShiftTable zeroShiftTable;
+
+/*!
+ * \brief Returns the CRC of a message with the specified \a crc after appending \a count zero bytes.
+ */
+std::uint32_t appendZeroBytes(std::uint32_t crc, std::uint32_t count)
+{
+    for (std::size_t k = 0; count; ++k, count >>= 1) {
+        if (count & 1) {
+            crc = multiplyModPolynomial(crc, zeroShiftTable.values[k]);
+        }
+    }
+    return crc;
+}
+
+} // namespace
+/// \endcond
+
 /*!
  * \brief Computes the actual checksum of the page read from the specified \a stream
  *        at the specified \a startOffset.
+ *
+ * The page is read block-wise and the checksum is computed via slicing-by-8 so each byte of the page is only read once.
  */
 std::uint32_t OggPage::computeChecksum(istream &stream, std::uint64_t startOffset)
 {
+    // read fixed-size part and segment table
+    char buffer[0x4000];
     stream.seekg(static_cast<streamoff>(startOffset));
-    std::uint32_t crc = 0x0;
-    std::uint8_t value, segmentTableSize = 0, segmentTableIndex = 0;
-    for (std::uint32_t i = 0, segmentLength = 27; i != segmentLength; ++i) {
-        switch (i) {
-        case 22:
-            // bytes 22, 23, 24, 25 hold denoted checksum and must be set to zero
-            stream.seekg(4, ios_base::cur);
-            [[fallthrough]];
-        case 23:
-        case 24:
-        case 25:
-            value = 0;
-            break;
-        case 26:
-            // byte 26 holds the number of segment sizes
-            segmentLength += (segmentTableSize = (value = static_cast<std::uint8_t>(stream.get())));
-            break;
-        default:
-            value = static_cast<std::uint8_t>(stream.get());
-            if (i > 26 && segmentTableIndex < segmentTableSize) {
-                // bytes 27 to (27 + segment size count) hold page size
-                segmentLength += value;
-                ++segmentTableIndex;
-            }
-        }
-        crc = (crc << 8) ^ BinaryReader::crc32Table[((crc >> 24) & 0xFF) ^ value];
+    stream.read(buffer, 27);
+    const auto segmentTableSize = static_cast<std::uint8_t>(buffer[26]);
+    stream.read(buffer + 27, segmentTableSize);
+    const auto headerSize = static_cast<std::size_t>(27) + segmentTableSize;
+    auto dataSize = std::size_t();
+    for (auto i = std::size_t(27); i != headerSize; ++i) {
+        dataSize += static_cast<std::uint8_t>(buffer[i]);
+    }
+    auto crc = updateCrc32WithHeader(0, buffer, headerSize);
+
+    // read page data block-wise
+    while (dataSize) {
+        const auto blockSize = min(dataSize, sizeof(buffer));
+        stream.read(buffer, static_cast<streamsize>(blockSize));
+        crc = updateCrc32(crc, buffer, blockSize);
+        dataSize -= blockSize;
     }
     return crc;
 }
 
+/*!
+ * \brief Computes the actual checksum of the page contained by the specified \a buffer.
+ * \remarks The \a buffer must contain the entire page (at least totalSize() bytes).
+ */
+std::uint32_t OggPage::computeChecksum(const char *buffer)
+{
+    const auto segmentTableSize = static_cast<std::uint8_t>(buffer[26]);
+    const auto headerSize = static_cast<std::size_t>(27) + segmentTableSize;
+    auto dataSize = std::size_t();
+    for (auto i = std::size_t(27); i != headerSize; ++i) {
+        dataSize += static_cast<std::uint8_t>(buffer[i]);
+    }
+    return updateCrc32(updateCrc32WithHeader(0, buffer, headerSize), buffer + headerSize, dataSize);
+}
+
 /*!
  * \brief Updates the checksum of the page read from the specified \a stream
  *        at the specified \a startOffset.
@@ -116,6 +284,44 @@ void OggPage::updateChecksum(iostream &stream, std::uint64_t startOffset)
     stream.write(buff, sizeof(buff));
 }
 
+/*!
+ * \brief Returns the checksum of a page of \a totalSize bytes and the specified \a checksum after changing its sequence number
+ *        from \a oldSequenceNumber to \a newSequenceNumber.
+ *
+ * The CRC used by OGG is linear and has no initial value or final XOR. Hence the checksum of the modified page is the
+ * denoted \a checksum XOR the checksum of a page which only contains the changed bits of the sequence number. The
+ * latter is computed from the four changed bytes and the number of bytes following them so the costs do not depend
+ * on the page size.
+ *
+ * \remarks The result is only correct if the denoted \a checksum is correct.
+ */
+std::uint32_t OggPage::computeChecksumForSequenceNumber(
+    std::uint32_t checksum, std::uint32_t oldSequenceNumber, std::uint32_t newSequenceNumber, std::uint32_t totalSize)
+{
+    char delta[4];
+    LE::getBytes(oldSequenceNumber ^ newSequenceNumber, delta);
+    return checksum ^ appendZeroBytes(updateCrc32(0, delta, sizeof(delta)), totalSize - 22);
+}
+
+/*!
+ * \brief Sets the sequence number of the page contained by the specified \a buffer to \a sequenceNumber and updates
+ *        its checksum accordingly.
+ * \remarks
+ * - The \a buffer must contain at least the page header; the page data is not read.
+ * - The checksum is updated via computeChecksumForSequenceNumber() so it is only correct if it has been correct before.
+ */
+void OggPage::updateSequenceNumber(char *buffer, std::uint32_t sequenceNumber)
+{
+    const auto segmentTableSize = static_cast<std::uint8_t>(buffer[26]);
+    auto totalSize = static_cast<std::uint32_t>(27) + segmentTableSize;
+    for (auto i = std::uint32_t(27); i != 27u + segmentTableSize; ++i) {
+        totalSize += static_cast<std::uint8_t>(buffer[i]);
+    }
+    const auto checksum = computeChecksumForSequenceNumber(LE::toUInt32(buffer + 22), LE::toUInt32(buffer + 18), sequenceNumber, totalSize);
+    LE::getBytes(sequenceNumber, buffer + 18);
+    LE::getBytes(checksum, buffer + 22);
+}
+
 /*!
  * \brief Writes the segment size denotation for the specified segment \a size to the specified stream.
  * \return Returns the number of bytes written.
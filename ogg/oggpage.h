@@ -1,6 +1,7 @@
 #ifndef TAG_PARSER_OGGPAGE_H
 #define TAG_PARSER_OGGPAGE_H
 
+#include "../exceptions.h"
 #include "../global.h"
 
 #include <cstdint>
@@ -14,10 +15,18 @@ class TAG_PARSER_EXPORT OggPage {
 public:
     OggPage();
     OggPage(std::istream &stream, std::uint64_t startOffset, std::int32_t maxSize);
+    OggPage(const char *buffer, std::uint64_t startOffset, std::int32_t maxSize);
 
     void parseHeader(std::istream &stream, std::uint64_t startOffset, std::int32_t maxSize);
+    void parseHeader(const char *buffer, std::uint64_t startOffset, std::int32_t maxSize);
+    ParsingError tryParseHeader(std::istream &stream, std::uint64_t startOffset, std::int32_t maxSize);
+    ParsingError tryParseHeader(const char *buffer, std::uint64_t startOffset, std::int32_t maxSize);
     static std::uint32_t computeChecksum(std::istream &stream, std::uint64_t startOffset);
+    static std::uint32_t computeChecksum(const char *buffer);
     static void updateChecksum(std::iostream &stream, std::uint64_t startOffset);
+    static std::uint32_t computeChecksumForSequenceNumber(
+        std::uint32_t checksum, std::uint32_t oldSequenceNumber, std::uint32_t newSequenceNumber, std::uint32_t totalSize);
+    static void updateSequenceNumber(char *buffer, std::uint32_t sequenceNumber);
 
     std::uint64_t startOffset() const;
     std::uint8_t streamStructureVersion() const;
@@ -37,6 +46,7 @@ public:
     std::uint32_t totalSize() const;
     std::uint64_t dataOffset(std::uint8_t segmentIndex = 0) const;
     static std::uint32_t makeSegmentSizeDenotation(std::ostream &stream, std::uint32_t size);
+    static constexpr std::uint32_t maxHeaderSize();
 
 private:
     std::uint64_t m_startOffset;
@@ -75,6 +85,24 @@ inline OggPage::OggPage(std::istream &stream, std::uint64_t startOffset, std::in
     parseHeader(stream, startOffset, maxSize);
 }
 
+/*!
+ * \brief Constructs a new OggPage and instantly parses the header from the specified \a buffer
+ *        which contains the page at the specified \a startOffset.
+ */
+inline OggPage::OggPage(const char *buffer, std::uint64_t startOffset, std::int32_t maxSize)
+    : OggPage()
+{
+    parseHeader(buffer, startOffset, maxSize);
+}
+
+/*!
+ * \brief Returns the maximum size of a page header (fixed-size part plus segment table with 255 entries).
+ */
+constexpr std::uint32_t OggPage::maxHeaderSize()
+{
+    return 27 + 0xFF;
+}
+
 /*!
  * \brief Returns the start offset of the page.
  *
@@ -0,0 +1,334 @@
+#include "./oggpageindex.h"
+
+#include "../diagnostics.h"
+#include "../exceptions.h"
+
+#include <c++utilities/io/binaryreader.h>
+#include <c++utilities/io/binarywriter.h>
+
+#include <algorithm>
+#include <istream>
+#include <limits>
+#include <ostream>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+/// \brief The magic number of persisted indexes ("TPOI").
+constexpr std::uint32_t indexMagic = 0x54504F49;
+/// \brief The version of the format of persisted indexes.
+constexpr std::uint16_t indexVersion = 1;
+/// \brief The max. size of an OGG page.
+constexpr std::uint64_t maxPageSize = 65307;
+/// \brief The number of bytes read at once when indexing pages.
+constexpr std::uint64_t chunkSize = 0x40000;
+
+/*!
+ * \class TagParser::OggPageIndex
+ * \brief The OggPageIndex class maps offsets of OGG pages to their stream serial number, sequence number and granule position.
+ *
+ * Unlike OggIterator, which fetches pages one after another, the index is filled lazily by probing the stream at
+ * arbitrary offsets. This allows determining the last page of a stream (and hence the duration) and finding the page
+ * containing a certain granule position via bisection so only O(log n) parts of the stream need to be read.
+ *
+ * Pages found by probing are re-synced by looking for the capture pattern. The checksum of the first page found after
+ * re-syncing is validated to avoid mistaking a capture pattern within the payload for a page.
+ *
+ * The index can be persisted via save() and load() so subsequent seeks into the same file do not need to read
+ * the file at all.
+ */
+
+/*!
+ * \brief Clears the index and assigns the specified \a stream of \a streamSize bytes at the specified \a startOffset.
+ */
+void OggPageIndex::clear(std::istream &stream, std::uint64_t startOffset, std::uint64_t streamSize)
+{
+    m_stream = &stream;
+    m_startOffset = startOffset;
+    m_streamSize = streamSize;
+    m_entries.clear();
+}
+
+/// \cond
+namespace {
+template <typename PageType> OggPageIndexEntry makeEntry(const PageType &page)
+{
+    auto entry = OggPageIndexEntry();
+    entry.offset = page.startOffset();
+    entry.granulePosition = page.absoluteGranulePosition();
+    entry.streamSerialNumber = page.streamSerialNumber();
+    entry.sequenceNumber = page.sequenceNumber();
+    entry.totalSize = page.totalSize();
+    entry.headerTypeFlag = page.headerTypeFlag();
+    return entry;
+}
+} // namespace
+/// \endcond
+
+/*!
+ * \brief Adds the specified \a page to the index.
+ */
+void OggPageIndex::add(const OggPage &page)
+{
+    insert(makeEntry(page));
+}
+
+/*!
+ * \brief Adds the specified \a page (e.g. a page fetched via OggIterator) to the index.
+ */
+void OggPageIndex::add(const OggPageView &page)
+{
+    insert(makeEntry(page));
+}
+
+/*!
+ * \brief Inserts the specified \a entry keeping the entries ordered by their offset.
+ */
+void OggPageIndex::insert(const OggPageIndexEntry &entry)
+{
+    const auto pos = lower_bound(m_entries.begin(), m_entries.end(), entry.offset,
+        [](const OggPageIndexEntry &existingEntry, std::uint64_t offset) { return existingEntry.offset < offset; });
+    if (pos == m_entries.end() || pos->offset != entry.offset) {
+        m_entries.insert(pos, entry);
+    }
+}
+
+/*!
+ * \brief Returns the first page of the stream with the specified \a streamSerialNumber.
+ */
+std::optional<OggPageIndexEntry> OggPageIndex::firstPage(std::uint32_t streamSerialNumber)
+{
+    for (const auto &entry : m_entries) {
+        if (entry.streamSerialNumber == streamSerialNumber && (entry.headerTypeFlag & 0x02)) {
+            return entry;
+        }
+    }
+    auto match = std::optional<OggPageIndexEntry>();
+    indexPages(m_startOffset, m_streamSize, streamSerialNumber, &match, nullptr);
+    return match;
+}
+
+/*!
+ * \brief Returns the last page denoting a granule position of the stream with the specified \a streamSerialNumber.
+ * \remarks Only the end of the stream is read (block-wise backwards until a page of the stream is found).
+ */
+std::optional<OggPageIndexEntry> OggPageIndex::lastPage(std::uint32_t streamSerialNumber)
+{
+    // check whether the last page is already known
+    for (auto i = m_entries.crbegin(), end = m_entries.crend(); i != end; ++i) {
+        if (i->streamSerialNumber == streamSerialNumber && (i->headerTypeFlag & 0x04) && i->granulePosition != noGranulePosition) {
+            return *i;
+        }
+    }
+    // index pages block-wise from the end until a page of the stream is found
+    auto match = std::optional<OggPageIndexEntry>();
+    for (auto endOffset = m_streamSize; endOffset > m_startOffset && !match;) {
+        const auto beginOffset = endOffset - m_startOffset > chunkSize ? endOffset - chunkSize : m_startOffset;
+        indexPages(beginOffset, endOffset, streamSerialNumber, nullptr, &match);
+        endOffset = beginOffset;
+    }
+    return match;
+}
+
+/*!
+ * \brief Returns the first page of the stream with the specified \a streamSerialNumber with a granule position of at least
+ *        \a granulePosition; this is the page on which the packet containing the specified granule position ends.
+ *
+ * Pages already present in the index are used to narrow down the range to be searched. Then the range is bisected by
+ * probing it. The granule positions of pages on which no packet ends are ignored when bisecting.
+ */
+std::optional<OggPageIndexEntry> OggPageIndex::findPage(std::uint32_t streamSerialNumber, std::uint64_t granulePosition)
+{
+    // narrow down the range via known pages
+    auto lowerBound = m_startOffset, upperBound = m_streamSize;
+    auto candidate = std::optional<OggPageIndexEntry>();
+    for (const auto &entry : m_entries) {
+        if (entry.streamSerialNumber != streamSerialNumber || entry.granulePosition == noGranulePosition) {
+            continue;
+        }
+        if (entry.granulePosition < granulePosition) {
+            lowerBound = max(lowerBound, entry.offset);
+        } else if (entry.offset < upperBound) {
+            upperBound = entry.offset;
+            candidate = entry;
+        }
+    }
+
+    // bisect the range
+    constexpr auto probeSize = 2 * maxPageSize;
+    while (upperBound > lowerBound && upperBound - lowerBound > 2 * probeSize) {
+        const auto middle = lowerBound + (upperBound - lowerBound) / 2;
+        auto match = std::optional<OggPageIndexEntry>();
+        indexPages(middle, middle + probeSize, streamSerialNumber, &match, nullptr);
+        if (!match) {
+            // no page of the stream near the middle; fall back to scanning the whole range
+            break;
+        }
+        if (match->granulePosition < granulePosition) {
+            lowerBound = match->offset;
+        } else {
+            upperBound = match->offset;
+            candidate = match;
+        }
+    }
+
+    // scan the remaining range
+    auto match = std::optional<OggPageIndexEntry>();
+    indexPages(lowerBound, upperBound + 1, streamSerialNumber, &match, nullptr, granulePosition);
+    return match ? match : candidate;
+}
+
+/*!
+ * \brief Indexes the pages starting within the specified range.
+ * \param beginOffset Specifies the offset to start looking for pages (which needs not to be the start of a page).
+ * \param endOffset Specifies the offset pages must start before.
+ * \param streamSerialNumber Specifies the stream serial number pages are matched against.
+ * \param firstMatch Assigned to the first matching page with a granule position of at least \a minGranulePosition;
+ *        the indexing stops when found if \a lastMatch is nullptr.
+ * \param lastMatch Assigned to the last matching page with a granule position.
+ * \returns Returns the number of pages found.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+std::size_t OggPageIndex::indexPages(std::uint64_t beginOffset, std::uint64_t endOffset, std::uint32_t streamSerialNumber,
+    std::optional<OggPageIndexEntry> *firstMatch, std::optional<OggPageIndexEntry> *lastMatch, std::uint64_t minGranulePosition)
+{
+    auto pagesFound = std::size_t();
+    auto offset = max(beginOffset, m_startOffset);
+    auto synced = false;
+    endOffset = min(endOffset, m_streamSize);
+    while (offset < endOffset) {
+        // read the chunk (and the max. size of a page which might start at the end of the chunk)
+        const auto windowSize = min(m_streamSize - offset, chunkSize + maxPageSize);
+        const char *window;
+        if (m_mappedData && !m_mappedData->empty() && offset <= m_mappedData->size() && windowSize <= m_mappedData->size() - offset) {
+            window = m_mappedData->data() + offset;
+        } else {
+            m_buffer.resize(static_cast<std::size_t>(windowSize));
+            m_stream->seekg(static_cast<streamoff>(offset));
+            m_stream->read(m_buffer.data(), static_cast<streamsize>(windowSize));
+            window = m_buffer.data();
+        }
+
+        // index pages starting within the chunk
+        const auto scanEnd = min(endOffset - offset, chunkSize);
+        auto pos = std::uint64_t();
+        while (pos < scanEnd) {
+            // find capture pattern if not synced
+            if (!synced) {
+                const auto *const begin = window + pos, *const end = window + min(scanEnd + 3, windowSize);
+                const auto *const capturePattern = search(begin, end, "OggS", "OggS" + 4);
+                if (capturePattern == end) {
+                    pos = scanEnd;
+                    break;
+                }
+                pos += static_cast<std::uint64_t>(capturePattern - begin);
+                if (pos >= scanEnd) {
+                    break;
+                }
+            }
+
+            // parse page
+            const auto available = windowSize - pos;
+            const auto remaining = m_streamSize - offset - pos;
+            auto page = OggPage();
+            if (available < min<std::uint64_t>(remaining, OggPage::maxHeaderSize())
+                || page.tryParseHeader(window + pos, offset + pos,
+                       remaining > numeric_limits<std::int32_t>::max() ? numeric_limits<std::int32_t>::max() : static_cast<std::int32_t>(remaining))
+                    != ParsingError::None) {
+                synced = false;
+                ++pos;
+                continue;
+            }
+            // -> validate the checksum of the first page after re-syncing
+            if (!synced && page.totalSize() <= available && OggPage::computeChecksum(window + pos) != page.checksum()) {
+                ++pos;
+                continue;
+            }
+            synced = true;
+            add(page);
+            ++pagesFound;
+
+            // check whether the page matches
+            if (page.streamSerialNumber() == streamSerialNumber && page.absoluteGranulePosition() != noGranulePosition) {
+                const auto &entry = *lower_bound(m_entries.cbegin(), m_entries.cend(), page.startOffset(),
+                    [](const OggPageIndexEntry &existingEntry, std::uint64_t offset) { return existingEntry.offset < offset; });
+                if (lastMatch) {
+                    *lastMatch = entry;
+                }
+                if (firstMatch && !*firstMatch && page.absoluteGranulePosition() >= minGranulePosition) {
+                    *firstMatch = entry;
+                    if (!lastMatch) {
+                        return pagesFound;
+                    }
+                }
+            }
+            pos += page.totalSize();
+        }
+        offset += pos;
+    }
+    return pagesFound;
+}
+
+/*!
+ * \brief Writes the index to the specified \a stream so it can be restored via load().
+ */
+void OggPageIndex::save(std::ostream &stream) const
+{
+    auto writer = BinaryWriter(&stream);
+    writer.writeUInt32BE(indexMagic);
+    writer.writeUInt16BE(indexVersion);
+    writer.writeUInt64BE(m_startOffset);
+    writer.writeUInt64BE(m_streamSize);
+    writer.writeUInt64BE(m_entries.size());
+    for (const auto &entry : m_entries) {
+        writer.writeUInt64BE(entry.offset);
+        writer.writeUInt64BE(entry.granulePosition);
+        writer.writeUInt32BE(entry.streamSerialNumber);
+        writer.writeUInt32BE(entry.sequenceNumber);
+        writer.writeUInt32BE(entry.totalSize);
+        writer.writeByte(entry.headerTypeFlag);
+    }
+}
+
+/*!
+ * \brief Restores an index previously written via save() from the specified \a stream.
+ * \returns Returns whether the index could be restored. The index is left unchanged if the persisted index is invalid
+ *          or has been created for a stream with a different start offset or size.
+ */
+bool OggPageIndex::load(std::istream &stream, Diagnostics &diag)
+{
+    static const string context("loading OGG page index");
+    const auto exceptions = stream.exceptions();
+    stream.exceptions(ios_base::failbit | ios_base::badbit);
+    auto reader = BinaryReader(&stream);
+    auto loaded = false;
+    try {
+        if (reader.readUInt32BE() != indexMagic || reader.readUInt16BE() != indexVersion) {
+            diag.emplace_back(DiagLevel::Warning, "The persisted OGG page index is invalid and will be ignored.", context);
+        } else if (reader.readUInt64BE() != m_startOffset || reader.readUInt64BE() != m_streamSize) {
+            diag.emplace_back(DiagLevel::Warning, "The persisted OGG page index has been created for another stream and will be ignored.", context);
+        } else {
+            auto entries = vector<OggPageIndexEntry>(static_cast<std::size_t>(min<std::uint64_t>(reader.readUInt64BE(), m_streamSize / 27)));
+            for (auto &entry : entries) {
+                entry.offset = reader.readUInt64BE();
+                entry.granulePosition = reader.readUInt64BE();
+                entry.streamSerialNumber = reader.readUInt32BE();
+                entry.sequenceNumber = reader.readUInt32BE();
+                entry.totalSize = reader.readUInt32BE();
+                entry.headerTypeFlag = reader.readByte();
+            }
+            for (const auto &entry : entries) {
+                insert(entry);
+            }
+            loaded = true;
+        }
+    } catch (const std::ios_base::failure &) {
+        diag.emplace_back(DiagLevel::Warning, "The persisted OGG page index is truncated and will be ignored.", context);
+    }
+    stream.exceptions(exceptions);
+    return loaded;
+}
+
+} // namespace TagParser
@@ -0,0 +1,135 @@
+#ifndef TAG_PARSER_OGGPAGEINDEX_H
+#define TAG_PARSER_OGGPAGEINDEX_H
+
+#include "./oggpagetable.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace TagParser {
+
+class Diagnostics;
+
+/*!
+ * \brief The OggPageIndexEntry struct holds the position of an OGG page within an OggPageIndex.
+ */
+struct TAG_PARSER_EXPORT OggPageIndexEntry {
+    /// \brief The start offset of the page.
+    std::uint64_t offset = 0;
+    /// \brief The absolute granule position of the page (OggPageIndex::noGranulePosition if no packet ends on the page).
+    std::uint64_t granulePosition = 0;
+    /// \brief The serial number of the stream the page belongs to.
+    std::uint32_t streamSerialNumber = 0;
+    /// \brief The sequence number of the page within its stream.
+    std::uint32_t sequenceNumber = 0;
+    /// \brief The total size of the page.
+    std::uint32_t totalSize = 0;
+    /// \brief The header type flag of the page (see OggPage::headerTypeFlag()).
+    std::uint8_t headerTypeFlag = 0;
+};
+
+class TAG_PARSER_EXPORT OggPageIndex {
+public:
+    OggPageIndex(std::istream &stream, std::uint64_t startOffset, std::uint64_t streamSize);
+
+    void clear(std::istream &stream, std::uint64_t startOffset, std::uint64_t streamSize);
+    void setStream(std::istream &stream);
+    void setMappedData(const std::string_view *mappedData);
+    std::uint64_t startOffset() const;
+    std::uint64_t streamSize() const;
+    void setStreamSize(std::uint64_t streamSize);
+    const std::vector<OggPageIndexEntry> &entries() const;
+
+    void add(const OggPage &page);
+    void add(const OggPageView &page);
+    std::optional<OggPageIndexEntry> firstPage(std::uint32_t streamSerialNumber);
+    std::optional<OggPageIndexEntry> lastPage(std::uint32_t streamSerialNumber);
+    std::optional<OggPageIndexEntry> findPage(std::uint32_t streamSerialNumber, std::uint64_t granulePosition);
+
+    void save(std::ostream &stream) const;
+    bool load(std::istream &stream, Diagnostics &diag);
+
+    /// \brief The granule position denoted by pages on which no packet ends.
+    static constexpr std::uint64_t noGranulePosition = static_cast<std::uint64_t>(-1);
+
+private:
+    void insert(const OggPageIndexEntry &entry);
+    std::size_t indexPages(std::uint64_t beginOffset, std::uint64_t endOffset, std::uint32_t streamSerialNumber,
+        std::optional<OggPageIndexEntry> *firstMatch, std::optional<OggPageIndexEntry> *lastMatch, std::uint64_t minGranulePosition = 0);
+
+    std::istream *m_stream;
+    const std::string_view *m_mappedData;
+    std::uint64_t m_startOffset;
+    std::uint64_t m_streamSize;
+    std::vector<OggPageIndexEntry> m_entries;
+    std::vector<char> m_buffer;
+};
+
+/*!
+ * \brief Constructs a new, empty index for the specified \a stream of \a streamSize bytes at the specified \a startOffset.
+ */
+inline OggPageIndex::OggPageIndex(std::istream &stream, std::uint64_t startOffset, std::uint64_t streamSize)
+    : m_stream(&stream)
+    , m_mappedData(nullptr)
+    , m_startOffset(startOffset)
+    , m_streamSize(streamSize)
+{
+}
+
+/*!
+ * \brief Sets the stream to read pages from.
+ * \remarks The new stream must have the same data as the old stream to keep the index in a sane state.
+ */
+inline void OggPageIndex::setStream(std::istream &stream)
+{
+    m_stream = &stream;
+}
+
+/*!
+ * \brief Sets the memory-mapped data of the stream to be used instead of the stream for reading if possible.
+ * \remarks Same as OggIterator::setMappedData().
+ */
+inline void OggPageIndex::setMappedData(const std::string_view *mappedData)
+{
+    m_mappedData = mappedData;
+}
+
+/*!
+ * \brief Returns the start offset (which has been specified when constructing the index).
+ */
+inline std::uint64_t OggPageIndex::startOffset() const
+{
+    return m_startOffset;
+}
+
+/*!
+ * \brief Returns the stream size (which has been specified when constructing the index).
+ */
+inline std::uint64_t OggPageIndex::streamSize() const
+{
+    return m_streamSize;
+}
+
+/*!
+ * \brief Sets the stream size, e.g. after data has been appended to the stream.
+ * \remarks The indexed pages are kept.
+ */
+inline void OggPageIndex::setStreamSize(std::uint64_t streamSize)
+{
+    m_streamSize = streamSize;
+}
+
+/*!
+ * \brief Returns the pages which have been indexed so far ordered by their offset.
+ */
+inline const std::vector<OggPageIndexEntry> &OggPageIndex::entries() const
+{
+    return m_entries;
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_OGGPAGEINDEX_H
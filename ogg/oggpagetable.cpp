@@ -0,0 +1,73 @@
+#include "./oggpagetable.h"
+
+using namespace std;
+
+namespace TagParser {
+
+/*!
+ * \class TagParser::OggSegmentSizes
+ * \brief The OggSegmentSizes class is a lightweight view for the segment sizes of a page stored within an OggPageTable.
+ */
+
+/*!
+ * \class TagParser::OggPageView
+ * \brief The OggPageView class is a lightweight view for a page stored within an OggPageTable.
+ */
+
+/*!
+ * \class TagParser::OggPageTable
+ * \brief The OggPageTable class stores the headers of OGG pages in a memory-compact way.
+ *
+ * Long streams consist of a huge number of pages. Instead of storing an OggPage object (which allocates its segment
+ * sizes on the heap) per page, the table stores the header fields of all pages in flat arrays. The segment sizes of
+ * all pages are stored in one arena. Since a segment is at most 255 * 255 bytes long, 16-bit integers suffice for
+ * the segment sizes.
+ *
+ * Pages are accessed via OggPageView which provides the same accessors as OggPage.
+ */
+
+/*!
+ * \brief Removes all pages from the table.
+ */
+void OggPageTable::clear()
+{
+    m_offsets.clear();
+    m_granulePositions.clear();
+    m_headers.clear();
+    m_segmentSizes.clear();
+}
+
+/*!
+ * \brief Reserves space for the specified number of pages.
+ */
+void OggPageTable::reserve(size_type pageCount)
+{
+    m_offsets.reserve(pageCount);
+    m_granulePositions.reserve(pageCount);
+    m_headers.reserve(pageCount);
+}
+
+/*!
+ * \brief Appends the specified \a page to the table.
+ */
+void OggPageTable::push_back(const OggPage &page)
+{
+    const auto &segmentSizes = page.segmentSizes();
+    m_offsets.push_back(page.startOffset());
+    m_granulePositions.push_back(page.absoluteGranulePosition());
+    m_headers.push_back(PageHeader{ page.streamSerialNumber(), page.sequenceNumber(), page.checksum(),
+        static_cast<std::uint32_t>(m_segmentSizes.size()), static_cast<std::uint16_t>(page.dataSize()), page.segmentTableSize(),
+        page.headerTypeFlag(), page.streamStructureVersion() });
+    m_segmentSizes.insert(m_segmentSizes.end(), segmentSizes.cbegin(), segmentSizes.cend());
+}
+
+/*!
+ * \brief Returns the number of bytes allocated by the table.
+ */
+std::size_t OggPageTable::memoryUsage() const
+{
+    return m_offsets.capacity() * sizeof(std::uint64_t) + m_granulePositions.capacity() * sizeof(std::uint64_t)
+        + m_headers.capacity() * sizeof(PageHeader) + m_segmentSizes.capacity() * sizeof(std::uint16_t);
+}
+
+} // namespace TagParser
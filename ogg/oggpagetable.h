@@ -0,0 +1,369 @@
+#ifndef TAG_PARSER_OGGPAGETABLE_H
+#define TAG_PARSER_OGGPAGETABLE_H
+
+#include "./oggpage.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+namespace TagParser {
+
+class OggPageTable;
+
+/*!
+ * \brief The OggSegmentSizes class provides read-only access to the segment sizes of a page stored within an OggPageTable.
+ */
+class TAG_PARSER_EXPORT OggSegmentSizes {
+public:
+    using size_type = std::size_t;
+    using const_iterator = const std::uint16_t *;
+
+    constexpr OggSegmentSizes(const std::uint16_t *begin, const std::uint16_t *end);
+
+    constexpr const_iterator begin() const;
+    constexpr const_iterator end() const;
+    constexpr size_type size() const;
+    constexpr bool empty() const;
+    constexpr std::uint32_t operator[](size_type index) const;
+
+private:
+    const std::uint16_t *m_begin;
+    const std::uint16_t *m_end;
+};
+
+/*!
+ * \brief Constructs a view for the segment sizes within [\a begin, \a end).
+ */
+constexpr OggSegmentSizes::OggSegmentSizes(const std::uint16_t *begin, const std::uint16_t *end)
+    : m_begin(begin)
+    , m_end(end)
+{
+}
+
+/*!
+ * \brief Returns a pointer to the first segment size.
+ */
+constexpr OggSegmentSizes::const_iterator OggSegmentSizes::begin() const
+{
+    return m_begin;
+}
+
+/*!
+ * \brief Returns a pointer behind the last segment size.
+ */
+constexpr OggSegmentSizes::const_iterator OggSegmentSizes::end() const
+{
+    return m_end;
+}
+
+/*!
+ * \brief Returns the number of segments.
+ */
+constexpr OggSegmentSizes::size_type OggSegmentSizes::size() const
+{
+    return static_cast<size_type>(m_end - m_begin);
+}
+
+/*!
+ * \brief Returns whether there are no segments.
+ */
+constexpr bool OggSegmentSizes::empty() const
+{
+    return m_begin == m_end;
+}
+
+/*!
+ * \brief Returns the size of the segment with the specified \a index.
+ */
+constexpr std::uint32_t OggSegmentSizes::operator[](size_type index) const
+{
+    return m_begin[index];
+}
+
+/*!
+ * \brief The OggPageView class provides read-only access to a page stored within an OggPageTable.
+ *
+ * It has the same accessors as OggPage. The view refers to the page by its index so it stays valid when further
+ * pages are appended to the table. The segment sizes returned by segmentSizes() are invalidated in this case, though.
+ */
+class TAG_PARSER_EXPORT OggPageView {
+public:
+    OggPageView(const OggPageTable &table, std::size_t index);
+
+    std::uint64_t startOffset() const;
+    std::uint8_t streamStructureVersion() const;
+    std::uint8_t headerTypeFlag() const;
+    bool isContinued() const;
+    bool isFirstpage() const;
+    bool isLastPage() const;
+    std::uint64_t absoluteGranulePosition() const;
+    std::uint32_t streamSerialNumber() const;
+    bool matchesStreamSerialNumber(std::uint32_t streamSerialNumber) const;
+    std::uint32_t sequenceNumber() const;
+    std::uint32_t checksum() const;
+    std::uint8_t segmentTableSize() const;
+    OggSegmentSizes segmentSizes() const;
+    std::uint32_t headerSize() const;
+    std::uint32_t dataSize() const;
+    std::uint32_t totalSize() const;
+    std::uint64_t dataOffset(std::uint8_t segmentIndex = 0) const;
+
+private:
+    const OggPageTable *m_table;
+    std::size_t m_index;
+};
+
+class TAG_PARSER_EXPORT OggPageTable {
+    friend class OggPageView;
+
+public:
+    using size_type = std::size_t;
+
+    size_type size() const;
+    bool empty() const;
+    void clear();
+    void reserve(size_type pageCount);
+    void push_back(const OggPage &page);
+    OggPageView operator[](size_type index) const;
+    OggPageView front() const;
+    OggPageView back() const;
+    std::size_t memoryUsage() const;
+    static constexpr std::size_t memoryUsage(std::size_t segmentCount);
+
+private:
+    /// \brief The PageHeader struct holds the 32-bit and 8-bit header fields of a page.
+    struct PageHeader {
+        std::uint32_t streamSerialNumber;
+        std::uint32_t sequenceNumber;
+        std::uint32_t checksum;
+        std::uint32_t firstSegment;
+        std::uint16_t dataSize;
+        std::uint8_t segmentTableSize;
+        std::uint8_t headerTypeFlag;
+        std::uint8_t streamStructureVersion;
+    };
+
+    std::vector<std::uint64_t> m_offsets;
+    std::vector<std::uint64_t> m_granulePositions;
+    std::vector<PageHeader> m_headers;
+    std::vector<std::uint16_t> m_segmentSizes;
+};
+
+/*!
+ * \brief Returns the number of bytes a page with \a segmentCount segments occupies within the table.
+ * \remarks Used to account pages before they are added (see MemoryAccount); the spare capacity of the vectors is not
+ *          taken into account.
+ */
+constexpr std::size_t OggPageTable::memoryUsage(std::size_t segmentCount)
+{
+    return 2 * sizeof(std::uint64_t) + sizeof(PageHeader) + segmentCount * sizeof(std::uint16_t);
+}
+
+/*!
+ * \brief Returns the number of pages in the table.
+ */
+inline OggPageTable::size_type OggPageTable::size() const
+{
+    return m_offsets.size();
+}
+
+/*!
+ * \brief Returns whether the table contains no pages.
+ */
+inline bool OggPageTable::empty() const
+{
+    return m_offsets.empty();
+}
+
+/*!
+ * \brief Returns a view for the page with the specified \a index.
+ * \remarks Calling this method with an \a index out of range causes undefined behaviour.
+ */
+inline OggPageView OggPageTable::operator[](size_type index) const
+{
+    return OggPageView(*this, index);
+}
+
+/*!
+ * \brief Returns a view for the first page.
+ * \remarks Calling this method on an empty table causes undefined behaviour.
+ */
+inline OggPageView OggPageTable::front() const
+{
+    return OggPageView(*this, 0);
+}
+
+/*!
+ * \brief Returns a view for the last page.
+ * \remarks Calling this method on an empty table causes undefined behaviour.
+ */
+inline OggPageView OggPageTable::back() const
+{
+    return OggPageView(*this, m_offsets.size() - 1);
+}
+
+/*!
+ * \brief Constructs a view for the page with the specified \a index within the specified \a table.
+ */
+inline OggPageView::OggPageView(const OggPageTable &table, std::size_t index)
+    : m_table(&table)
+    , m_index(index)
+{
+}
+
+/*!
+ * \brief Returns the start offset of the page.
+ * \sa OggPage::startOffset()
+ */
+inline std::uint64_t OggPageView::startOffset() const
+{
+    return m_table->m_offsets[m_index];
+}
+
+/*!
+ * \brief Returns the stream structure version.
+ * \sa OggPage::streamStructureVersion()
+ */
+inline std::uint8_t OggPageView::streamStructureVersion() const
+{
+    return m_table->m_headers[m_index].streamStructureVersion;
+}
+
+/*!
+ * \brief Returns the header type flag.
+ * \sa OggPage::headerTypeFlag()
+ */
+inline std::uint8_t OggPageView::headerTypeFlag() const
+{
+    return m_table->m_headers[m_index].headerTypeFlag;
+}
+
+/*!
+ * \brief Returns whether this page is a continued packed (true) or a fresh packed (false).
+ */
+inline bool OggPageView::isContinued() const
+{
+    return headerTypeFlag() & 0x01;
+}
+
+/*!
+ * \brief Returns whether this page is the first page of the logical bitstream.
+ */
+inline bool OggPageView::isFirstpage() const
+{
+    return headerTypeFlag() & 0x02;
+}
+
+/*!
+ * \brief Returns whether this page is the last page of the logical bitstream.
+ */
+inline bool OggPageView::isLastPage() const
+{
+    return headerTypeFlag() & 0x04;
+}
+
+/*!
+ * \brief Returns the absolute granule position.
+ * \sa OggPage::absoluteGranulePosition()
+ */
+inline std::uint64_t OggPageView::absoluteGranulePosition() const
+{
+    return m_table->m_granulePositions[m_index];
+}
+
+/*!
+ * \brief Returns the stream serial number.
+ * \sa OggPage::streamSerialNumber()
+ */
+inline std::uint32_t OggPageView::streamSerialNumber() const
+{
+    return m_table->m_headers[m_index].streamSerialNumber;
+}
+
+/*!
+ * \brief Returns whether the stream serial number of the page matches the specified one.
+ */
+inline bool OggPageView::matchesStreamSerialNumber(std::uint32_t streamSerialNumber) const
+{
+    return this->streamSerialNumber() == streamSerialNumber;
+}
+
+/*!
+ * \brief Returns the page sequence number.
+ * \sa OggPage::sequenceNumber()
+ */
+inline std::uint32_t OggPageView::sequenceNumber() const
+{
+    return m_table->m_headers[m_index].sequenceNumber;
+}
+
+/*!
+ * \brief Returns the page checksum denoted by the header.
+ * \sa OggPage::checksum()
+ */
+inline std::uint32_t OggPageView::checksum() const
+{
+    return m_table->m_headers[m_index].checksum;
+}
+
+/*!
+ * \brief Returns the size of the segment table.
+ * \sa OggPage::segmentTableSize()
+ */
+inline std::uint8_t OggPageView::segmentTableSize() const
+{
+    return m_table->m_headers[m_index].segmentTableSize;
+}
+
+/*!
+ * \brief Returns the sizes of the segments of the page in byte.
+ * \remarks The returned view is invalidated when further pages are appended to the table.
+ * \sa OggPage::segmentSizes()
+ */
+inline OggSegmentSizes OggPageView::segmentSizes() const
+{
+    const auto *const segmentSizes = m_table->m_segmentSizes.data();
+    const auto nextIndex = m_index + 1;
+    return OggSegmentSizes(segmentSizes + m_table->m_headers[m_index].firstSegment,
+        segmentSizes + (nextIndex < m_table->m_headers.size() ? m_table->m_headers[nextIndex].firstSegment : m_table->m_segmentSizes.size()));
+}
+
+/*!
+ * \brief Returns the header size in byte.
+ */
+inline std::uint32_t OggPageView::headerSize() const
+{
+    return 27 + segmentTableSize();
+}
+
+/*!
+ * \brief Returns the data size in byte.
+ */
+inline std::uint32_t OggPageView::dataSize() const
+{
+    return m_table->m_headers[m_index].dataSize;
+}
+
+/*!
+ * \brief Returns the total size of the page in byte.
+ */
+inline std::uint32_t OggPageView::totalSize() const
+{
+    return headerSize() + dataSize();
+}
+
+/*!
+ * \brief Returns the data offset of the segment with the specified \a segmentIndex.
+ * \sa OggPage::dataOffset()
+ */
+inline std::uint64_t OggPageView::dataOffset(std::uint8_t segmentIndex) const
+{
+    const auto segmentSizes = this->segmentSizes();
+    return startOffset() + headerSize() + std::accumulate(segmentSizes.begin(), segmentSizes.begin() + segmentIndex, std::uint64_t());
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_OGGPAGETABLE_H
@@ -14,11 +14,10 @@
 
 #include <c++utilities/chrono/timespan.h>
 
-#include <functional>
-#include <iostream>
+#include <istream>
+#include <ostream>
 
 using namespace std;
-using namespace std::placeholders;
 using namespace CppUtilities;
 
 namespace TagParser {
@@ -31,11 +30,12 @@ namespace TagParser {
 /*!
  * \brief Constructs a new track for the \a stream at the specified \a startOffset.
  */
-OggStream::OggStream(OggContainer &container, vector<OggPage>::size_type startPage)
+OggStream::OggStream(OggContainer &container, OggPageTable::size_type startPage)
     : AbstractTrack(container.stream(), container.m_iterator.pages()[startPage].startOffset())
     , m_startPage(startPage)
     , m_container(container)
     , m_currentSequenceNumber(0)
+    , m_preSkip(0)
 {
 }
 
@@ -52,7 +52,7 @@ void OggStream::internalParseHeader(Diagnostics &diag)
 
     // read basic information from first page
     OggIterator &iterator = m_container.m_iterator;
-    const OggPage &firstPage = iterator.pages()[m_startPage];
+    const auto firstPage = iterator.pages()[m_startPage];
     m_version = firstPage.streamStructureVersion();
     m_id = firstPage.streamSerialNumber();
 
@@ -287,23 +287,38 @@ void OggStream::internalParseHeader(Diagnostics &diag)
 
 void OggStream::calculateDurationViaSampleCount(std::uint16_t preSkip)
 {
-    // define predicate for finding pages of this stream by its stream serial number
-    const auto pred = bind(&OggPage::matchesStreamSerialNumber, _1, m_id);
-
     // determine sample count
     const auto &iterator = m_container.m_iterator;
-    if (!m_sampleCount && iterator.isLastPageFetched()) {
-        const auto &pages = iterator.pages();
-        const auto firstPage = find_if(pages.cbegin(), pages.cend(), pred);
-        const auto lastPage = find_if(pages.crbegin(), pages.crend(), pred);
-        if (firstPage != pages.cend() && lastPage != pages.crend()) {
-            m_sampleCount = lastPage->absoluteGranulePosition() - firstPage->absoluteGranulePosition();
-            // must apply "pre-skip" here to calculate effective sample count and duration?
-            if (m_sampleCount > preSkip) {
-                m_sampleCount -= preSkip;
-            } else {
-                m_sampleCount = 0;
+    m_preSkip = preSkip;
+    if (!m_sampleCount) {
+        if (iterator.isLastPageFetched()) {
+            // find first and last page of this stream by its stream serial number
+            const auto &pages = iterator.pages();
+            const auto id = static_cast<std::uint32_t>(m_id);
+            auto firstPage = OggPageTable::size_type(0), lastPage = pages.size();
+            while (firstPage != pages.size() && !pages[firstPage].matchesStreamSerialNumber(id)) {
+                ++firstPage;
+            }
+            while (lastPage != firstPage && !pages[lastPage - 1].matchesStreamSerialNumber(id)) {
+                --lastPage;
+            }
+            if (firstPage != pages.size()) {
+                m_sampleCount = pages[lastPage - 1].absoluteGranulePosition() - pages[firstPage].absoluteGranulePosition();
             }
+        } else if (!m_container.fileInfo().isForwardOnly()) {
+            // probe the end of the stream via the page index if not all pages have been fetched
+            auto &pageIndex = m_container.m_pageIndex;
+            const auto firstPage = pageIndex.firstPage(static_cast<std::uint32_t>(m_id));
+            const auto lastPage = pageIndex.lastPage(static_cast<std::uint32_t>(m_id));
+            if (firstPage && lastPage && lastPage->granulePosition > firstPage->granulePosition) {
+                m_sampleCount = lastPage->granulePosition - firstPage->granulePosition;
+            }
+        }
+        // must apply "pre-skip" here to calculate effective sample count and duration?
+        if (m_sampleCount > preSkip) {
+            m_sampleCount -= preSkip;
+        } else {
+            m_sampleCount = 0;
         }
     }
 
@@ -313,4 +328,18 @@ void OggStream::calculateDurationViaSampleCount(std::uint16_t preSkip)
     }
 }
 
+/*!
+ * \brief Determines the sample count and duration again after pages have been appended to the stream.
+ * \remarks Does nothing if the sampling frequency is unknown.
+ * \sa OggContainer::internalResumeParsing()
+ */
+void OggStream::updateDuration()
+{
+    if (m_samplingFrequency == 0.0) {
+        return;
+    }
+    m_sampleCount = 0;
+    calculateDurationViaSampleCount(m_preSkip);
+}
+
 } // namespace TagParser
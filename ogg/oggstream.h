@@ -1,7 +1,7 @@
 #ifndef TAG_PARSER_OGGSTREAM_H
 #define TAG_PARSER_OGGSTREAM_H
 
-#include "./oggpage.h"
+#include "./oggpagetable.h"
 
 #include "../abstracttrack.h"
 
@@ -14,7 +14,7 @@ class TAG_PARSER_EXPORT OggStream final : public AbstractTrack {
     friend class OggContainer;
 
 public:
-    OggStream(OggContainer &container, std::vector<OggPage>::size_type startPage);
+    OggStream(OggContainer &container, OggPageTable::size_type startPage);
     ~OggStream() override;
 
     TrackType type() const override;
@@ -25,10 +25,12 @@ protected:
 
 private:
     void calculateDurationViaSampleCount(std::uint16_t preSkip = 0);
+    void updateDuration();
 
     std::size_t m_startPage;
     OggContainer &m_container;
     std::uint32_t m_currentSequenceNumber;
+    std::uint16_t m_preSkip;
 };
 
 inline std::size_t OggStream::startPage() const
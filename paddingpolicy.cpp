@@ -0,0 +1,252 @@
+#include "./paddingpolicy.h"
+#include "./diagnostics.h"
+#include "./exceptions.h"
+
+#include "./id3/id3v2frameids.h"
+#include "./id3/id3v2tag.h"
+#include "./matroska/matroskatag.h"
+#include "./mp4/mp4ids.h"
+#include "./mp4/mp4tag.h"
+#include "./vorbis/vorbiscomment.h"
+#include "./wav/riffinfotag.h"
+
+#include <c++utilities/conversion/conversionexception.h>
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <sstream>
+#include <string>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+/// \cond
+namespace {
+
+template <typename TagType> auto findId3v2Hint(TagType &tag) -> decltype(&tag.fields().begin()->second.value())
+{
+    const auto range = tag.fields().equal_range(Id3v2FrameIds::lUserDefinedText);
+    for (auto i = range.first; i != range.second; ++i) {
+        if (i->second.value().description() == PaddingPolicy::hintName()) {
+            return &i->second.value();
+        }
+    }
+    return nullptr;
+}
+
+template <typename TagType> std::uint64_t streamedSize(TagType &tag, Diagnostics &diag)
+{
+    auto buffer = stringstream(ios_base::in | ios_base::out | ios_base::binary);
+    buffer.exceptions(ios_base::badbit | ios_base::failbit);
+    if constexpr (std::is_same_v<TagType, VorbisComment>) {
+        tag.make(buffer, VorbisCommentFlags::None, diag);
+    } else {
+        tag.make(buffer, diag);
+    }
+    return static_cast<std::uint64_t>(buffer.tellp());
+}
+
+} // namespace
+/// \endcond
+
+/*!
+ * \class TagParser::PaddingPolicy
+ * \brief The PaddingPolicy class determines the padding settings when applying changes.
+ *
+ * The padding settings of MediaFileInfo are static. A policy assigned via MediaFileInfo::setPaddingPolicy() is asked
+ * for the settings each time changes are applied instead. It gets the size of the file, the sizes of the old and new
+ * tags and (if storesHint() returns true) the number of times the file has been rewritten so far. This number is
+ * stored within the file's tag as a field named hintName(): a "TXXX"-frame with that description for ID3v2 tags, a
+ * "----"-atom with the iTunes mean for MP4 tags and a field/"SimpleTag" with that name for Vorbis comments and
+ * Matroska tags. It is incremented by MediaFileInfo::applyChanges() whenever the file is rewritten.
+ *
+ * \sa AdaptivePaddingPolicy
+ */
+
+/*!
+ * \brief Destroys the policy.
+ */
+PaddingPolicy::~PaddingPolicy()
+{
+}
+
+/*!
+ * \fn PaddingPolicy::determinePadding()
+ * \brief Returns the padding settings for the file described by \a input; \a settings are the ones configured statically.
+ */
+
+/*!
+ * \brief Returns whether the number of rewrites is supposed to be stored in the tag (see PaddingPolicyInput::rewriteCount).
+ * \remarks The default implementation returns false.
+ */
+bool PaddingPolicy::storesHint() const
+{
+    return false;
+}
+
+/*!
+ * \brief Returns the name of the field used to store the hint.
+ */
+const char *PaddingPolicy::hintName()
+{
+    return "TAGPARSER_PADDING";
+}
+
+/*!
+ * \brief Returns whether the hint can be stored within the specified \a tag.
+ */
+bool PaddingPolicy::supportsHint(const Tag &tag)
+{
+    switch (tag.type()) {
+    case TagType::Id3v2Tag:
+    case TagType::Mp4Tag:
+    case TagType::MatroskaTag:
+    case TagType::VorbisComment:
+    case TagType::OggVorbisComment:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*!
+ * \brief Returns the number of rewrites stored within the specified \a tag or zero if there is no (valid) hint.
+ */
+std::uint64_t PaddingPolicy::readHint(const Tag &tag)
+{
+    const TagValue *hint = nullptr;
+    switch (tag.type()) {
+    case TagType::Id3v2Tag:
+        hint = findId3v2Hint(static_cast<const Id3v2Tag &>(tag));
+        break;
+    case TagType::Mp4Tag:
+        hint = &static_cast<const Mp4Tag &>(tag).value(Mp4TagExtendedMeanIds::iTunes, hintName());
+        break;
+    case TagType::MatroskaTag:
+        hint = &static_cast<const MatroskaTag &>(tag).value(std::string(hintName()));
+        break;
+    case TagType::VorbisComment:
+    case TagType::OggVorbisComment:
+        hint = &static_cast<const VorbisComment &>(tag).value(std::string(hintName()));
+        break;
+    default:;
+    }
+    if (!hint || hint->isEmpty()) {
+        return 0;
+    }
+    try {
+        return static_cast<std::uint64_t>(max<std::int32_t>(hint->toInteger(), 0));
+    } catch (const ConversionException &) {
+        return 0;
+    }
+}
+
+/*!
+ * \brief Stores the specified \a rewriteCount as hint within the specified \a tag.
+ * \returns Returns whether the hint could be stored (see supportsHint()).
+ */
+bool PaddingPolicy::writeHint(Tag &tag, std::uint64_t rewriteCount)
+{
+    const auto value = TagValue(to_string(rewriteCount));
+    switch (tag.type()) {
+    case TagType::Id3v2Tag: {
+        auto &id3v2Tag = static_cast<Id3v2Tag &>(tag);
+        if (auto *const hint = findId3v2Hint(id3v2Tag)) {
+            *hint = value;
+            hint->setDescription(hintName());
+        } else {
+            auto &frame = id3v2Tag.fields().emplace(Id3v2FrameIds::lUserDefinedText, Id3v2Frame(Id3v2FrameIds::lUserDefinedText, value))->second;
+            frame.value().setDescription(hintName());
+        }
+        return true;
+    }
+    case TagType::Mp4Tag:
+        return static_cast<Mp4Tag &>(tag).setValue(Mp4TagExtendedMeanIds::iTunes, hintName(), value);
+    case TagType::MatroskaTag:
+        return static_cast<MatroskaTag &>(tag).setValue(std::string(hintName()), value);
+    case TagType::VorbisComment:
+    case TagType::OggVorbisComment:
+        return static_cast<VorbisComment &>(tag).setValue(std::string(hintName()), value);
+    default:
+        return false;
+    }
+}
+
+/*!
+ * \brief Returns the size the specified \a tag will take when being written (excluding padding).
+ * \remarks Falls back to Tag::size() if the tag can not be made.
+ */
+std::uint64_t PaddingPolicy::requiredSize(Tag &tag)
+{
+    auto diag = Diagnostics();
+    try {
+        switch (tag.type()) {
+        case TagType::Id3v1Tag:
+            return 128;
+        case TagType::Id3v2Tag:
+            return static_cast<Id3v2Tag &>(tag).prepareMaking(diag).requiredSize();
+        case TagType::Mp4Tag:
+            return static_cast<Mp4Tag &>(tag).prepareMaking(diag).requiredSize();
+        case TagType::MatroskaTag:
+            return static_cast<MatroskaTag &>(tag).prepareMaking(diag).requiredSize();
+        case TagType::VorbisComment:
+        case TagType::OggVorbisComment:
+            return streamedSize(static_cast<VorbisComment &>(tag), diag);
+        case TagType::RiffInfoTag:
+            return streamedSize(static_cast<RiffInfoTag &>(tag), diag);
+        default:;
+        }
+    } catch (const Failure &) {
+    } catch (const std::ios_base::failure &) {
+    }
+    return tag.size();
+}
+
+/*!
+ * \class TagParser::AdaptivePaddingPolicy
+ * \brief The AdaptivePaddingPolicy class grows the padding geometrically with each rewrite of a file.
+ *
+ * Files which have never been rewritten get initialPadding() so archived files don't waste much space. Each time a
+ * file is rewritten, the padding grows by growthFactor() (up to paddingLimit()) so files which are retagged often
+ * (e.g. podcast feeds) are soon patched in-place. The padding is also at least twice the size the tags grow by.
+ *
+ * To avoid rewriting files only because of the padding, the minimum padding is zero and the maximum padding is
+ * increased to growthFactor() times the preferred padding (if that's more than the configured maximum).
+ */
+
+/*!
+ * \brief Constructs a new policy.
+ */
+AdaptivePaddingPolicy::AdaptivePaddingPolicy(std::size_t initialPadding, double growthFactor, std::size_t paddingLimit)
+    : m_initialPadding(initialPadding)
+    , m_growthFactor(max(growthFactor, 1.0))
+    , m_paddingLimit(paddingLimit)
+{
+}
+
+/*!
+ * \brief Returns the padding settings; see class description for details.
+ */
+PaddingSettings AdaptivePaddingPolicy::determinePadding(const PaddingPolicyInput &input, const PaddingSettings &settings) const
+{
+    const auto limit = static_cast<double>(m_paddingLimit);
+    const auto grown = min(static_cast<double>(m_initialPadding) * pow(m_growthFactor, static_cast<double>(input.rewriteCount)), limit);
+    const auto growth = input.newTagSize > input.oldTagSize ? input.newTagSize - input.oldTagSize : 0;
+    auto adapted = PaddingSettings();
+    adapted.preferredPadding = static_cast<std::size_t>(min(max(grown, static_cast<double>(growth) * 2.0), limit));
+    adapted.maxPadding = max(settings.maxPadding, static_cast<std::size_t>(min(static_cast<double>(adapted.preferredPadding) * m_growthFactor, limit)));
+    return adapted;
+}
+
+/*!
+ * \brief Returns true; the policy depends on the number of rewrites.
+ */
+bool AdaptivePaddingPolicy::storesHint() const
+{
+    return true;
+}
+
+} // namespace TagParser
@@ -0,0 +1,99 @@
+#ifndef TAG_PARSER_PADDINGPOLICY_H
+#define TAG_PARSER_PADDINGPOLICY_H
+
+#include "./signature.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace TagParser {
+
+class Tag;
+
+/*!
+ * \brief The PaddingSettings struct holds the padding settings of MediaFileInfo.
+ * \sa MediaFileInfo::setMinPadding(), MediaFileInfo::setMaxPadding() and MediaFileInfo::setPreferredPadding()
+ */
+struct TAG_PARSER_EXPORT PaddingSettings {
+    /// \brief The minimum padding (see MediaFileInfo::minPadding()).
+    std::size_t minPadding = 0;
+    /// \brief The maximum padding (see MediaFileInfo::maxPadding()).
+    std::size_t maxPadding = 0;
+    /// \brief The padding used when the file is rewritten anyways (see MediaFileInfo::preferredPadding()).
+    std::size_t preferredPadding = 0;
+};
+
+/*!
+ * \brief The PaddingPolicyInput struct holds the information a PaddingPolicy determines the padding from.
+ */
+struct TAG_PARSER_EXPORT PaddingPolicyInput {
+    /// \brief The format of the file the changes are applied to.
+    ContainerFormat containerFormat = ContainerFormat::Unknown;
+    /// \brief The size of the file before applying changes.
+    std::uint64_t fileSize = 0;
+    /// \brief The size of the tags as parsed from the file.
+    std::uint64_t oldTagSize = 0;
+    /// \brief The size of the tags to be written (excluding padding).
+    std::uint64_t newTagSize = 0;
+    /// \brief The number of times the file has been rewritten as stored in the hint (see PaddingPolicy::readHint()).
+    std::uint64_t rewriteCount = 0;
+};
+
+class TAG_PARSER_EXPORT PaddingPolicy {
+public:
+    virtual ~PaddingPolicy();
+
+    virtual PaddingSettings determinePadding(const PaddingPolicyInput &input, const PaddingSettings &settings) const = 0;
+    virtual bool storesHint() const;
+
+    static const char *hintName();
+    static bool supportsHint(const Tag &tag);
+    static std::uint64_t readHint(const Tag &tag);
+    static bool writeHint(Tag &tag, std::uint64_t rewriteCount);
+    static std::uint64_t requiredSize(Tag &tag);
+};
+
+class TAG_PARSER_EXPORT AdaptivePaddingPolicy : public PaddingPolicy {
+public:
+    explicit AdaptivePaddingPolicy(std::size_t initialPadding = 0x400, double growthFactor = 2.0, std::size_t paddingLimit = 0x100000);
+
+    PaddingSettings determinePadding(const PaddingPolicyInput &input, const PaddingSettings &settings) const override;
+    bool storesHint() const override;
+
+    std::size_t initialPadding() const;
+    double growthFactor() const;
+    std::size_t paddingLimit() const;
+
+private:
+    std::size_t m_initialPadding;
+    double m_growthFactor;
+    std::size_t m_paddingLimit;
+};
+
+/*!
+ * \brief Returns the padding used for files which have not been rewritten yet.
+ */
+inline std::size_t AdaptivePaddingPolicy::initialPadding() const
+{
+    return m_initialPadding;
+}
+
+/*!
+ * \brief Returns the factor the padding grows by with each rewrite.
+ */
+inline double AdaptivePaddingPolicy::growthFactor() const
+{
+    return m_growthFactor;
+}
+
+/*!
+ * \brief Returns the padding the policy never exceeds.
+ */
+inline std::size_t AdaptivePaddingPolicy::paddingLimit() const
+{
+    return m_paddingLimit;
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_PADDINGPOLICY_H
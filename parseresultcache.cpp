@@ -0,0 +1,761 @@
+#include "./parseresultcache.h"
+#include "./abstractattachment.h"
+#include "./abstractchapter.h"
+#include "./exceptions.h"
+#include "./mediafileinfo.h"
+#include "./tagvalue.h"
+
+#include <c++utilities/conversion/conversionexception.h>
+#include <c++utilities/conversion/stringbuilder.h>
+#include <c++utilities/io/binaryreader.h>
+#include <c++utilities/io/binarywriter.h>
+#include <c++utilities/io/nativefilestream.h>
+
+#ifdef PLATFORM_UNIX
+#include <sys/stat.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <streambuf>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+/// \cond
+namespace {
+
+constexpr std::uint32_t cacheMagic = 0x54505243; // "TPRC"
+constexpr std::uint32_t resultMagic = 0x54505052; // "TPPR"
+constexpr std::uint16_t formatVersion = 2;
+
+/*!
+ * \brief The MemoryStreamBuffer class allows reading from a buffer via std::istream without copying it.
+ */
+class MemoryStreamBuffer : public std::streambuf {
+public:
+    explicit MemoryStreamBuffer(const char *data, std::size_t size);
+    const char *current() const;
+
+protected:
+    pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type position, std::ios_base::openmode which) override;
+};
+
+MemoryStreamBuffer::MemoryStreamBuffer(const char *data, std::size_t size)
+{
+    auto *const begin = const_cast<char *>(data);
+    setg(begin, begin, begin + size);
+}
+
+const char *MemoryStreamBuffer::current() const
+{
+    return gptr();
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which)
+{
+    if (!(which & ios_base::in)) {
+        return pos_type(off_type(-1));
+    }
+    auto *const base = direction == ios_base::beg ? eback() : (direction == ios_base::cur ? gptr() : egptr());
+    if (offset < eback() - base || offset > egptr() - base) {
+        return pos_type(off_type(-1));
+    }
+    setg(eback(), base + offset, egptr());
+    return pos_type(gptr() - eback());
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekpos(pos_type position, std::ios_base::openmode which)
+{
+    return seekoff(off_type(position), ios_base::beg, which);
+}
+
+std::uint64_t fnv1a(std::uint64_t hash, const char *data, std::size_t size)
+{
+    for (const char *const end = data + size; data != end; ++data) {
+        hash ^= static_cast<unsigned char>(*data);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+void writeTimeSpan(BinaryWriter &writer, TimeSpan timeSpan)
+{
+    writer.writeInt64BE(timeSpan.totalTicks());
+}
+
+TimeSpan readTimeSpan(BinaryReader &reader)
+{
+    return TimeSpan(reader.readInt64BE());
+}
+
+template <typename Enum> void writeEnum(BinaryWriter &writer, Enum value)
+{
+    writer.writeUInt64BE(static_cast<std::uint64_t>(value));
+}
+
+template <typename Enum> Enum readEnum(BinaryReader &reader)
+{
+    return static_cast<Enum>(reader.readUInt64BE());
+}
+
+void writeLocale(BinaryWriter &writer, const Locale &locale)
+{
+    writer.writeUInt32BE(static_cast<std::uint32_t>(locale.size()));
+    for (const auto &detail : locale) {
+        writeEnum(writer, detail.format);
+        writer.writeLengthPrefixedString(detail);
+    }
+}
+
+Locale readLocale(BinaryReader &reader)
+{
+    auto locale = Locale();
+    for (auto count = reader.readUInt32BE(); count; --count) {
+        const auto format = readEnum<LocaleFormat>(reader);
+        locale.emplace_back(reader.readLengthPrefixedString(), format);
+    }
+    return locale;
+}
+
+/*!
+ * \brief Writes the specified \a tagFields (if not nullptr).
+ *
+ * The fixed-size part of all records is followed by a single blob containing the IDs and values of all records. So
+ * the records can be deserialized without copying the blob (see readTagFields()).
+ */
+void writeTagFields(BinaryWriter &writer, const TagFieldList *tagFields)
+{
+    writer.writeByte(tagFields ? 1 : 0);
+    if (!tagFields) {
+        return;
+    }
+    const auto &records = tagFields->records();
+    auto blobSize = std::uint64_t();
+    writer.writeUInt32BE(static_cast<std::uint32_t>(records.size()));
+    for (const auto &record : records) {
+        writer.writeByte(static_cast<std::uint8_t>(record.tagType));
+        writer.writeByte(static_cast<std::uint8_t>(record.dataType));
+        writer.writeByte(static_cast<std::uint8_t>(record.encoding));
+        writer.writeUInt32BE(record.tagIndex);
+        writer.writeUInt32BE(static_cast<std::uint32_t>(record.field));
+        writer.writeUInt32BE(record.id);
+        writer.writeUInt64BE(record.dataSize);
+        writer.writeUInt32BE(static_cast<std::uint32_t>(record.name.size()));
+        writer.writeUInt32BE(static_cast<std::uint32_t>(record.data.size()));
+        blobSize += record.name.size() + record.data.size();
+    }
+    writer.writeUInt64BE(blobSize);
+    for (const auto &record : records) {
+        writer.write(record.name.data(), static_cast<std::streamsize>(record.name.size()));
+        writer.write(record.data.data(), static_cast<std::streamsize>(record.data.size()));
+    }
+}
+
+/*!
+ * \brief Reads tag fields written via writeTagFields().
+ * \remarks If \a memory is specified, the records point into its buffer which is owned by \a owner. Otherwise the blob is
+ *          read into a new buffer.
+ */
+std::shared_ptr<const TagFieldList> readTagFields(BinaryReader &reader, const MemoryStreamBuffer *memory, const std::shared_ptr<const void> &owner)
+{
+    if (!reader.readByte()) {
+        return nullptr;
+    }
+    auto records = std::vector<TagFieldRecord>();
+    auto sizes = std::vector<std::pair<std::uint32_t, std::uint32_t>>();
+    auto expectedBlobSize = std::uint64_t();
+    for (auto count = reader.readUInt32BE(); count; --count) {
+        auto &record = records.emplace_back();
+        record.tagType = static_cast<TagType>(reader.readByte());
+        record.dataType = static_cast<TagDataType>(reader.readByte());
+        record.encoding = static_cast<TagTextEncoding>(reader.readByte());
+        record.tagIndex = reader.readUInt32BE();
+        record.field = static_cast<KnownField>(reader.readUInt32BE());
+        record.id = reader.readUInt32BE();
+        record.dataSize = static_cast<std::size_t>(reader.readUInt64BE());
+        const auto nameSize = reader.readUInt32BE();
+        const auto dataSize = reader.readUInt32BE();
+        sizes.emplace_back(nameSize, dataSize);
+        expectedBlobSize += nameSize + static_cast<std::uint64_t>(dataSize);
+    }
+    const auto blobSize = reader.readUInt64BE();
+    if (blobSize != expectedBlobSize) {
+        throw InvalidDataException();
+    }
+
+    const char *blob = nullptr;
+    auto buffer = std::shared_ptr<const void>();
+    if (memory) {
+        blob = memory->current();
+        reader.stream()->seekg(static_cast<std::streamoff>(blobSize), ios_base::cur);
+        buffer = owner;
+    } else {
+        auto data = make_unique<char[]>(static_cast<std::size_t>(blobSize));
+        reader.read(data.get(), static_cast<std::streamsize>(blobSize));
+        blob = data.get();
+        buffer = std::move(data);
+    }
+    for (std::size_t index = 0; index != records.size(); ++index) {
+        const auto [nameSize, dataSize] = sizes[index];
+        records[index].name = std::string_view(nameSize ? blob : nullptr, nameSize);
+        records[index].data = std::string_view(dataSize ? blob + nameSize : nullptr, dataSize);
+        blob += nameSize + dataSize;
+    }
+    return TagFieldList::fromRecords(std::move(records), buffer, static_cast<std::size_t>(blobSize));
+}
+
+void writeResult(BinaryWriter &writer, const CachedParseResult &result)
+{
+    writeEnum(writer, result.containerFormat);
+    writeEnum(writer, result.parsingFlags);
+    writer.writeLengthPrefixedString(result.mimeType);
+    writeTimeSpan(writer, result.duration);
+    writer.writeUInt32BE(static_cast<std::uint32_t>(result.tracks.size()));
+    for (const auto &track : result.tracks) {
+        writer.writeUInt64BE(track.id);
+        writer.writeUInt32BE(track.trackNumber);
+        writeEnum(writer, track.mediaType);
+        writeEnum(writer, track.format.general);
+        writer.writeByte(track.format.sub);
+        writer.writeByte(track.format.extension);
+        writeEnum(writer, track.flags);
+        writer.writeLengthPrefixedString(track.name);
+        writeLocale(writer, track.locale);
+        writeTimeSpan(writer, track.duration);
+        writer.writeFloat64BE(track.bitrate);
+        writer.writeUInt32BE(track.samplingFrequency);
+        writer.writeUInt16BE(track.channelCount);
+        writer.writeUInt16BE(track.bitsPerSample);
+        writer.writeUInt32BE(track.pixelSize.width());
+        writer.writeUInt32BE(track.pixelSize.height());
+        writer.writeUInt32BE(track.fps);
+    }
+    writer.writeUInt32BE(static_cast<std::uint32_t>(result.tags.size()));
+    for (const auto &tag : result.tags) {
+        writeEnum(writer, tag.type);
+        writer.writeUInt32BE(static_cast<std::uint32_t>(tag.fields.size()));
+        for (const auto &field : tag.fields) {
+            writeEnum(writer, field.field);
+            writer.writeLengthPrefixedString(field.value);
+        }
+    }
+    writer.writeUInt32BE(static_cast<std::uint32_t>(result.chapters.size()));
+    for (const auto &chapter : result.chapters) {
+        writer.writeUInt64BE(chapter.id);
+        writer.writeUInt32BE(chapter.depth);
+        writer.writeUInt32BE(static_cast<std::uint32_t>(chapter.names.size()));
+        for (const auto &name : chapter.names) {
+            writer.writeLengthPrefixedString(name);
+        }
+        writeTimeSpan(writer, chapter.startTime);
+        writeTimeSpan(writer, chapter.endTime);
+    }
+    writer.writeUInt32BE(static_cast<std::uint32_t>(result.attachments.size()));
+    for (const auto &attachment : result.attachments) {
+        writer.writeUInt64BE(attachment.id);
+        writer.writeLengthPrefixedString(attachment.name);
+        writer.writeLengthPrefixedString(attachment.mimeType);
+        writer.writeLengthPrefixedString(attachment.description);
+        writer.writeUInt64BE(attachment.dataSize);
+    }
+    writeTagFields(writer, result.tagFields.get());
+}
+
+CachedParseResult readResult(BinaryReader &reader, const MemoryStreamBuffer *memory = nullptr, const std::shared_ptr<const void> &owner = nullptr)
+{
+    auto result = CachedParseResult();
+    result.containerFormat = readEnum<ContainerFormat>(reader);
+    result.parsingFlags = readEnum<ParsingFlags>(reader);
+    result.mimeType = reader.readLengthPrefixedString();
+    result.duration = readTimeSpan(reader);
+    for (auto count = reader.readUInt32BE(); count; --count) {
+        auto &track = result.tracks.emplace_back();
+        track.id = reader.readUInt64BE();
+        track.trackNumber = reader.readUInt32BE();
+        track.mediaType = readEnum<MediaType>(reader);
+        track.format.general = readEnum<GeneralMediaFormat>(reader);
+        track.format.sub = reader.readByte();
+        track.format.extension = reader.readByte();
+        track.flags = readEnum<TrackFlags>(reader);
+        track.name = reader.readLengthPrefixedString();
+        track.locale = readLocale(reader);
+        track.duration = readTimeSpan(reader);
+        track.bitrate = reader.readFloat64BE();
+        track.samplingFrequency = reader.readUInt32BE();
+        track.channelCount = reader.readUInt16BE();
+        track.bitsPerSample = reader.readUInt16BE();
+        const auto width = reader.readUInt32BE();
+        track.pixelSize = Size(width, reader.readUInt32BE());
+        track.fps = reader.readUInt32BE();
+    }
+    for (auto count = reader.readUInt32BE(); count; --count) {
+        auto &tag = result.tags.emplace_back();
+        tag.type = readEnum<TagType>(reader);
+        for (auto fieldCount = reader.readUInt32BE(); fieldCount; --fieldCount) {
+            auto &field = tag.fields.emplace_back();
+            field.field = readEnum<KnownField>(reader);
+            field.value = reader.readLengthPrefixedString();
+        }
+    }
+    for (auto count = reader.readUInt32BE(); count; --count) {
+        auto &chapter = result.chapters.emplace_back();
+        chapter.id = reader.readUInt64BE();
+        chapter.depth = reader.readUInt32BE();
+        for (auto nameCount = reader.readUInt32BE(); nameCount; --nameCount) {
+            chapter.names.emplace_back(reader.readLengthPrefixedString());
+        }
+        chapter.startTime = readTimeSpan(reader);
+        chapter.endTime = readTimeSpan(reader);
+    }
+    for (auto count = reader.readUInt32BE(); count; --count) {
+        auto &attachment = result.attachments.emplace_back();
+        attachment.id = reader.readUInt64BE();
+        attachment.name = reader.readLengthPrefixedString();
+        attachment.mimeType = reader.readLengthPrefixedString();
+        attachment.description = reader.readLengthPrefixedString();
+        attachment.dataSize = reader.readUInt64BE();
+    }
+    result.tagFields = readTagFields(reader, memory, owner);
+    return result;
+}
+
+} // namespace
+/// \endcond
+
+/*!
+ * \brief Creates a cacheable track from the specified \a track which has already been parsed.
+ */
+CachedTrack CachedTrack::fromTrack(const AbstractTrack &track)
+{
+    auto cachedTrack = CachedTrack();
+    cachedTrack.id = track.id();
+    cachedTrack.trackNumber = track.trackNumber();
+    cachedTrack.mediaType = track.mediaType();
+    cachedTrack.format = track.format();
+    cachedTrack.flags = track.flags();
+    cachedTrack.name = track.name();
+    cachedTrack.locale = track.locale();
+    cachedTrack.duration = track.duration();
+    cachedTrack.bitrate = track.bitrate();
+    cachedTrack.samplingFrequency = track.samplingFrequency();
+    cachedTrack.channelCount = track.channelCount();
+    cachedTrack.bitsPerSample = track.bitsPerSample();
+    cachedTrack.pixelSize = track.pixelSize();
+    cachedTrack.fps = track.fps();
+    return cachedTrack;
+}
+
+/*!
+ * \brief Appends the specified \a chapter with the specified \a depth followed by its nested chapters to \a chapters.
+ */
+void CachedChapter::appendChapter(std::vector<CachedChapter> &chapters, const AbstractChapter &chapter, std::uint32_t depth)
+{
+    auto &cachedChapter = chapters.emplace_back();
+    cachedChapter.id = chapter.id();
+    cachedChapter.depth = depth;
+    cachedChapter.names.reserve(chapter.names().size());
+    for (const auto &name : chapter.names()) {
+        cachedChapter.names.emplace_back(name);
+    }
+    cachedChapter.startTime = chapter.startTime();
+    cachedChapter.endTime = chapter.endTime();
+    for (size_t index = 0, count = chapter.nestedChapterCount(); index != count; ++index) {
+        appendChapter(chapters, *chapter.nestedChapter(index), depth + 1);
+    }
+}
+
+/*!
+ * \brief Determines the identity of the file with the specified \a path via the file system.
+ * \remarks On platforms where device, inode and modification time are not available this falls back to fromContent().
+ * \throws Throws std::ios_base::failure when the file can not be accessed.
+ */
+FileIdentity FileIdentity::fromFileSystem(const std::string &path)
+{
+#ifdef PLATFORM_UNIX
+    struct stat status;
+    if (::stat(path.data(), &status) != 0) {
+        throw std::ios_base::failure(argsToString("Unable to stat \"", path, "\": ", std::strerror(errno)));
+    }
+    auto identity = FileIdentity();
+    identity.device = static_cast<std::uint64_t>(status.st_dev);
+    identity.inode = static_cast<std::uint64_t>(status.st_ino);
+    identity.size = static_cast<std::uint64_t>(status.st_size);
+#ifdef PLATFORM_LINUX
+    identity.modificationTime = static_cast<std::int64_t>(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+#else
+    identity.modificationTime = static_cast<std::int64_t>(status.st_mtime) * 1000000000;
+#endif
+    return identity;
+#else
+    return fromContent(path);
+#endif
+}
+
+/*!
+ * \brief Determines the identity of the file with the specified \a path via its size and a hash of the first and
+ *        last \a hashedSize bytes.
+ * \remarks This works even if the file has been copied to another device but misses changes in the middle of the
+ *          file which do not affect its size.
+ * \throws Throws std::ios_base::failure when the file can not be read.
+ */
+FileIdentity FileIdentity::fromContent(const std::string &path, std::size_t hashedSize)
+{
+    auto file = NativeFileStream();
+    file.exceptions(ios_base::failbit | ios_base::badbit);
+    file.open(path, ios_base::in | ios_base::binary);
+    file.seekg(0, ios_base::end);
+    auto identity = FileIdentity();
+    identity.size = static_cast<std::uint64_t>(file.tellg());
+
+    const auto headSize = static_cast<std::size_t>(min<std::uint64_t>(hashedSize, identity.size));
+    const auto tailSize = static_cast<std::size_t>(min<std::uint64_t>(hashedSize, identity.size - headSize));
+    auto buffer = make_unique<char[]>(max<std::size_t>(headSize, 1));
+    auto hash = fnv1a(0xcbf29ce484222325ull, reinterpret_cast<const char *>(&identity.size), sizeof(identity.size));
+    file.seekg(0);
+    file.read(buffer.get(), static_cast<streamsize>(headSize));
+    hash = fnv1a(hash, buffer.get(), headSize);
+    file.seekg(static_cast<streamoff>(identity.size - tailSize));
+    file.read(buffer.get(), static_cast<streamsize>(tailSize));
+    identity.contentHash = fnv1a(hash, buffer.get(), tailSize);
+    return identity;
+}
+
+/*!
+ * \brief Creates a cacheable result from the specified \a fileInfo which has already been parsed.
+ * \param withTagFields Specifies whether tagFields is determined as well (see TagFieldList::fromTags()). This is
+ *                      useful to pass the result to another process (see serialize()) but makes it considerably bigger.
+ */
+CachedParseResult CachedParseResult::fromFileInfo(const MediaFileInfo &fileInfo, bool withTagFields)
+{
+    auto result = CachedParseResult();
+    result.containerFormat = fileInfo.containerFormat();
+    result.parsingFlags = fileInfo.parsingFlags();
+    result.mimeType = fileInfo.mimeType();
+    result.duration = fileInfo.duration();
+
+    const auto tracks = fileInfo.tracks();
+    result.tracks.reserve(tracks.size());
+    for (const auto *const track : tracks) {
+        result.tracks.emplace_back(CachedTrack::fromTrack(*track));
+    }
+
+    const auto tags = fileInfo.tags();
+    result.tags.reserve(tags.size());
+    for (const auto *const tag : tags) {
+        auto &cachedTag = result.tags.emplace_back();
+        cachedTag.type = tag->type();
+        for (auto field = firstKnownField; field != KnownField::Invalid; field = nextKnownField(field)) {
+            for (const auto *const value : tag->values(field)) {
+                if (value->isEmpty()) {
+                    continue;
+                }
+                try {
+                    cachedTag.fields.emplace_back(CachedTagField{ field, value->toString(TagTextEncoding::Utf8) });
+                } catch (const ConversionException &) {
+                    // values which can not be represented as string (e.g. pictures) are not cached
+                }
+            }
+        }
+    }
+
+    for (const auto *const chapter : fileInfo.chapters()) {
+        CachedChapter::appendChapter(result.chapters, *chapter);
+    }
+
+    const auto attachments = fileInfo.attachments();
+    result.attachments.reserve(attachments.size());
+    for (const auto *const attachment : attachments) {
+        auto &cachedAttachment = result.attachments.emplace_back();
+        cachedAttachment.id = attachment->id();
+        cachedAttachment.name = attachment->name();
+        cachedAttachment.mimeType = attachment->mimeType();
+        cachedAttachment.description = attachment->description();
+        cachedAttachment.dataSize = attachment->data() ? static_cast<std::uint64_t>(attachment->data()->size()) : 0;
+    }
+
+    if (withTagFields) {
+        result.tagFields = TagFieldList::fromTags(tags);
+    }
+    return result;
+}
+
+/*!
+ * \brief Returns the result in a compact, versioned binary form, e.g. to pass it to another process.
+ *
+ * The format is the one used for the entries of the ParseResultCache file. It starts with a magic number and the
+ * version of the format so deserialize() can reject data written by an incompatible version. The IDs and values of
+ * the tagFields are stored as one blob after the fixed-size part of all records so deserialize() can refer to them
+ * without copying.
+ */
+std::string CachedParseResult::serialize() const
+{
+    auto stream = std::stringstream(ios_base::out | ios_base::binary);
+    stream.exceptions(ios_base::failbit | ios_base::badbit);
+    auto writer = BinaryWriter(&stream);
+    writer.writeUInt32BE(resultMagic);
+    writer.writeUInt16BE(formatVersion);
+    writeResult(writer, *this);
+    return stream.str();
+}
+
+/*!
+ * \brief Restores a result from the specified \a data which has been returned by serialize().
+ *
+ * If \a owner is specified, the records of tagFields point into \a data instead of a copy. So \a data is not
+ * copied but kept alive via \a owner, e.g. a std::shared_ptr<std::string> holding the received message or a
+ * shared memory mapping. Otherwise the tagFields are copied into a buffer which is owned by them.
+ *
+ * \throws Throws InvalidDataException if \a data is not a serialized result, VersionNotSupportedException if it has
+ *         been written by an incompatible version and TruncatedDataException if it is truncated.
+ */
+CachedParseResult CachedParseResult::deserialize(const char *data, std::size_t size, const std::shared_ptr<const void> &owner)
+{
+    auto buffer = MemoryStreamBuffer(data, size);
+    auto stream = std::istream(&buffer);
+    stream.exceptions(ios_base::failbit | ios_base::badbit);
+    auto reader = BinaryReader(&stream);
+    try {
+        if (reader.readUInt32BE() != resultMagic) {
+            throw InvalidDataException();
+        }
+        if (reader.readUInt16BE() != formatVersion) {
+            throw VersionNotSupportedException();
+        }
+        return readResult(reader, owner ? &buffer : nullptr, owner);
+    } catch (const std::ios_base::failure &) {
+        throw TruncatedDataException();
+    }
+}
+
+/*!
+ * \class TagParser::ParseResultCache
+ * \brief The ParseResultCache class caches parsing results of many files persistently.
+ *
+ * Entries are keyed by the path of the file and store the FileIdentity the file had when it has been parsed. An
+ * entry is only used if the identity of the file is still the same. Hence re-scanning a big library of mostly
+ * unchanged files does not require opening, let alone parsing, most of the files.
+ *
+ * All functions are thread-safe so one cache can be shared between the threads of a BatchParser.
+ */
+
+/*!
+ * \brief Constructs an empty cache which determines the identity of files as specified by \a identityMode.
+ */
+ParseResultCache::ParseResultCache(IdentityMode identityMode)
+    : m_identityMode(identityMode)
+{
+}
+
+/*!
+ * \brief Determines the identity of the file with the specified \a path according to identityMode().
+ * \throws Throws std::ios_base::failure when the file can not be accessed.
+ */
+FileIdentity ParseResultCache::identify(const std::string &path) const
+{
+    return m_identityMode == IdentityMode::Content ? FileIdentity::fromContent(path) : FileIdentity::fromFileSystem(path);
+}
+
+/*!
+ * \brief Returns the result cached for the file with the specified \a path if its \a identity is still the same.
+ */
+std::optional<CachedParseResult> ParseResultCache::find(const std::string &path, const FileIdentity &identity) const
+{
+    const auto guard = lock_guard<mutex>(m_mutex);
+    const auto entry = m_entries.find(path);
+    if (entry == m_entries.end() || entry->second.identity != identity) {
+        return std::nullopt;
+    }
+    return entry->second.result;
+}
+
+/*!
+ * \brief Stores the \a result for the file with the specified \a path and \a identity replacing any existing entry.
+ */
+void ParseResultCache::store(const std::string &path, const FileIdentity &identity, const CachedParseResult &result)
+{
+    const auto guard = lock_guard<mutex>(m_mutex);
+    m_entries[path] = Entry{ identity, result };
+}
+
+/*!
+ * \brief Removes the entry for the file with the specified \a path.
+ * \returns Returns whether an entry has been removed.
+ */
+bool ParseResultCache::remove(const std::string &path)
+{
+    const auto guard = lock_guard<mutex>(m_mutex);
+    return m_entries.erase(path);
+}
+
+/*!
+ * \brief Removes the entries for all files within the specified \a directory (including its sub directories).
+ * \returns Returns the number of entries which have been removed.
+ */
+std::size_t ParseResultCache::removeDirectory(const std::string &directory)
+{
+    const auto prefix = directory.empty() || directory.back() == '/' ? directory : directory + "/";
+    const auto guard = lock_guard<mutex>(m_mutex);
+    auto removed = std::size_t();
+    for (auto entry = m_entries.begin(); entry != m_entries.end();) {
+        if (entry->first.compare(0, prefix.size(), prefix) == 0) {
+            entry = m_entries.erase(entry);
+            ++removed;
+        } else {
+            ++entry;
+        }
+    }
+    return removed;
+}
+
+/*!
+ * \brief Removes all entries.
+ */
+void ParseResultCache::clear()
+{
+    const auto guard = lock_guard<mutex>(m_mutex);
+    m_entries.clear();
+}
+
+/*!
+ * \brief Returns the number of entries.
+ */
+std::size_t ParseResultCache::size() const
+{
+    const auto guard = lock_guard<mutex>(m_mutex);
+    return m_entries.size();
+}
+
+/*!
+ * \brief Returns the parsing results for the file with the specified \a path.
+ *
+ * If an entry for the file exists, its identity is unchanged and it has not been parsed with more restrictive
+ * \a flags, the cached result is returned without opening the file. Otherwise the file is parsed via MediaFileInfo
+ * using the specified \a flags and the result is stored.
+ *
+ * \a cacheHit is set to whether the result has been taken from the cache (if not nullptr).
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+CachedParseResult ParseResultCache::parse(const std::string &path, Diagnostics &diag, ParsingFlags flags, bool *cacheHit)
+{
+    const auto identity = identify(path);
+    if (auto cached = find(path, identity);
+        cached && !(static_cast<std::uint64_t>(cached->parsingFlags) & ~static_cast<std::uint64_t>(flags))) {
+        if (cacheHit) {
+            *cacheHit = true;
+        }
+        return std::move(cached.value());
+    }
+    if (cacheHit) {
+        *cacheHit = false;
+    }
+    MediaFileInfo fileInfo(path);
+    fileInfo.setParsingFlags(flags);
+    fileInfo.open(true);
+    fileInfo.parseEverything(diag);
+    auto result = CachedParseResult::fromFileInfo(fileInfo);
+    store(path, identity, result);
+    return result;
+}
+
+/*!
+ * \brief Loads the entries from the cache file with the specified \a path.
+ * \remarks
+ * - Does nothing if the file does not exist.
+ * - If the file is invalid or has been written by an incompatible version, a warning is added to \a diag and
+ *   the entries read so far are kept.
+ */
+void ParseResultCache::load(const std::string &path, Diagnostics &diag)
+{
+    auto file = NativeFileStream();
+    file.open(path, ios_base::in | ios_base::binary);
+    if (!file.is_open()) {
+        return;
+    }
+    load(file, diag);
+}
+
+/*!
+ * \brief Loads the entries from the specified \a stream.
+ * \sa load(const std::string &, Diagnostics &)
+ */
+void ParseResultCache::load(std::istream &stream, Diagnostics &diag)
+{
+    static const string context("loading parse result cache");
+    const auto exceptions = stream.exceptions();
+    stream.exceptions(ios_base::failbit | ios_base::badbit);
+    auto reader = BinaryReader(&stream);
+    try {
+        if (reader.readUInt32BE() != cacheMagic) {
+            diag.emplace_back(DiagLevel::Warning, "The cache file is invalid and will be ignored.", context);
+            stream.exceptions(exceptions);
+            return;
+        }
+        if (const auto version = reader.readUInt16BE(); version != formatVersion) {
+            diag.emplace_back(DiagLevel::Warning, argsToString("The cache file has version ", version, " which is not supported and will be ignored."),
+                context);
+            stream.exceptions(exceptions);
+            return;
+        }
+        for (auto count = reader.readUInt64BE(); count; --count) {
+            auto path = reader.readLengthPrefixedString();
+            auto entry = Entry();
+            entry.identity.device = reader.readUInt64BE();
+            entry.identity.inode = reader.readUInt64BE();
+            entry.identity.size = reader.readUInt64BE();
+            entry.identity.modificationTime = reader.readInt64BE();
+            entry.identity.contentHash = reader.readUInt64BE();
+            entry.result = readResult(reader);
+            const auto guard = lock_guard<mutex>(m_mutex);
+            m_entries[std::move(path)] = std::move(entry);
+        }
+    } catch (const std::ios_base::failure &) {
+        diag.emplace_back(DiagLevel::Warning, "The cache file is truncated; only the entries read so far are used.", context);
+    }
+    stream.exceptions(exceptions);
+}
+
+/*!
+ * \brief Saves the entries to the cache file with the specified \a path.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+void ParseResultCache::save(const std::string &path) const
+{
+    auto file = NativeFileStream();
+    file.exceptions(ios_base::failbit | ios_base::badbit);
+    file.open(path, ios_base::out | ios_base::trunc | ios_base::binary);
+    save(file);
+    file.flush();
+}
+
+/*!
+ * \brief Saves the entries to the specified \a stream.
+ * \throws Throws std::ios_base::failure when an IO error occurs and exceptions are enabled for \a stream.
+ */
+void ParseResultCache::save(std::ostream &stream) const
+{
+    auto writer = BinaryWriter(&stream);
+    writer.writeUInt32BE(cacheMagic);
+    writer.writeUInt16BE(formatVersion);
+    const auto guard = lock_guard<mutex>(m_mutex);
+    writer.writeUInt64BE(m_entries.size());
+    for (const auto &[path, entry] : m_entries) {
+        writer.writeLengthPrefixedString(path);
+        writer.writeUInt64BE(entry.identity.device);
+        writer.writeUInt64BE(entry.identity.inode);
+        writer.writeUInt64BE(entry.identity.size);
+        writer.writeInt64BE(entry.identity.modificationTime);
+        writer.writeUInt64BE(entry.identity.contentHash);
+        writeResult(writer, entry.result);
+    }
+}
+
+} // namespace TagParser
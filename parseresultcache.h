@@ -0,0 +1,203 @@
+#ifndef TAG_PARSER_PARSERESULTCACHE_H
+#define TAG_PARSER_PARSERESULTCACHE_H
+
+#include "./abstracttrack.h"
+#include "./diagnostics.h"
+#include "./localehelper.h"
+#include "./mediaformat.h"
+#include "./settings.h"
+#include "./signature.h"
+#include "./size.h"
+#include "./tag.h"
+#include "./tagfieldlist.h"
+
+#include <c++utilities/chrono/timespan.h>
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace TagParser {
+
+class MediaFileInfo;
+class AbstractChapter;
+
+/*!
+ * \brief The FileIdentity struct identifies a particular version of a file.
+ *
+ * A file is considered unchanged if its identity is unchanged. The identity is either determined via the file
+ * system (device, inode, size and modification time) or via a hash of the beginning and the end of the file.
+ */
+struct TAG_PARSER_EXPORT FileIdentity {
+    static FileIdentity fromFileSystem(const std::string &path);
+    static FileIdentity fromContent(const std::string &path, std::size_t hashedSize = 0x10000);
+    bool operator==(const FileIdentity &other) const;
+    bool operator!=(const FileIdentity &other) const;
+
+    /// \brief The ID of the device containing the file.
+    std::uint64_t device = 0;
+    /// \brief The inode of the file.
+    std::uint64_t inode = 0;
+    /// \brief The size of the file in byte.
+    std::uint64_t size = 0;
+    /// \brief The modification time of the file in nanoseconds since the epoch.
+    std::int64_t modificationTime = 0;
+    /// \brief The hash of the beginning and the end of the file (only set by fromContent()).
+    std::uint64_t contentHash = 0;
+};
+
+/*!
+ * \brief Returns whether the identity equals \a other.
+ */
+inline bool FileIdentity::operator==(const FileIdentity &other) const
+{
+    return device == other.device && inode == other.inode && size == other.size && modificationTime == other.modificationTime
+        && contentHash == other.contentHash;
+}
+
+/*!
+ * \brief Returns whether the identity does not equal \a other.
+ */
+inline bool FileIdentity::operator!=(const FileIdentity &other) const
+{
+    return !(*this == other);
+}
+
+/*!
+ * \brief The CachedTrack struct holds the properties of a track stored within a CachedParseResult.
+ */
+struct TAG_PARSER_EXPORT CachedTrack {
+    static CachedTrack fromTrack(const AbstractTrack &track);
+
+    std::uint64_t id = 0;
+    std::uint32_t trackNumber = 0;
+    MediaType mediaType = MediaType::Unknown;
+    MediaFormat format;
+    TrackFlags flags = TrackFlags::None;
+    std::string name;
+    Locale locale;
+    CppUtilities::TimeSpan duration;
+    double bitrate = 0.0;
+    std::uint32_t samplingFrequency = 0;
+    std::uint16_t channelCount = 0;
+    std::uint16_t bitsPerSample = 0;
+    Size pixelSize;
+    std::uint32_t fps = 0;
+};
+
+/*!
+ * \brief The CachedTagField struct holds a field value of a tag stored within a CachedParseResult.
+ * \remarks Only values which are convertible to a string are cached (e.g. no pictures).
+ */
+struct TAG_PARSER_EXPORT CachedTagField {
+    KnownField field = KnownField::Invalid;
+    /// \brief The value converted to UTF-8.
+    std::string value;
+};
+
+/*!
+ * \brief The CachedTag struct holds a tag stored within a CachedParseResult.
+ */
+struct TAG_PARSER_EXPORT CachedTag {
+    TagType type = TagType::Unspecified;
+    std::vector<CachedTagField> fields;
+};
+
+/*!
+ * \brief The CachedChapter struct holds a chapter stored within a CachedParseResult.
+ * \remarks Nested chapters follow their parent and have a greater depth.
+ */
+struct TAG_PARSER_EXPORT CachedChapter {
+    static void appendChapter(std::vector<CachedChapter> &chapters, const AbstractChapter &chapter, std::uint32_t depth = 0);
+
+    std::uint64_t id = 0;
+    std::uint32_t depth = 0;
+    std::vector<std::string> names;
+    CppUtilities::TimeSpan startTime;
+    CppUtilities::TimeSpan endTime;
+};
+
+/*!
+ * \brief The CachedAttachment struct holds the meta-data of an attachment stored within a CachedParseResult.
+ */
+struct TAG_PARSER_EXPORT CachedAttachment {
+    std::uint64_t id = 0;
+    std::string name;
+    std::string mimeType;
+    std::string description;
+    std::uint64_t dataSize = 0;
+};
+
+/*!
+ * \brief The CachedParseResult struct holds the parsing results of a MediaFileInfo object in a serializable form.
+ */
+struct TAG_PARSER_EXPORT CachedParseResult {
+    static CachedParseResult fromFileInfo(const MediaFileInfo &fileInfo, bool withTagFields = false);
+    std::string serialize() const;
+    static CachedParseResult deserialize(const char *data, std::size_t size, const std::shared_ptr<const void> &owner = nullptr);
+
+    ContainerFormat containerFormat = ContainerFormat::Unknown;
+    /// \brief The flags the file has been parsed with (so it is known which parts are missing).
+    ParsingFlags parsingFlags = ParsingFlags::None;
+    std::string mimeType;
+    CppUtilities::TimeSpan duration;
+    std::vector<CachedTrack> tracks;
+    std::vector<CachedTag> tags;
+    std::vector<CachedChapter> chapters;
+    std::vector<CachedAttachment> attachments;
+    /// \brief The values of the tags including their native IDs and raw data; nullptr if not determined (see fromFileInfo()).
+    std::shared_ptr<const TagFieldList> tagFields;
+};
+
+class TAG_PARSER_EXPORT ParseResultCache {
+public:
+    /// \brief Specifies how the identity of files is determined.
+    enum class IdentityMode {
+        FileSystem, /**< use device, inode, size and modification time (see FileIdentity::fromFileSystem()) */
+        Content, /**< use a hash of the beginning and the end of the file (see FileIdentity::fromContent()) */
+    };
+
+    explicit ParseResultCache(IdentityMode identityMode = IdentityMode::FileSystem);
+
+    IdentityMode identityMode() const;
+    FileIdentity identify(const std::string &path) const;
+    std::optional<CachedParseResult> find(const std::string &path, const FileIdentity &identity) const;
+    void store(const std::string &path, const FileIdentity &identity, const CachedParseResult &result);
+    bool remove(const std::string &path);
+    std::size_t removeDirectory(const std::string &directory);
+    void clear();
+    std::size_t size() const;
+    CachedParseResult parse(const std::string &path, Diagnostics &diag, ParsingFlags flags = ParsingFlags::None, bool *cacheHit = nullptr);
+
+    void load(const std::string &path, Diagnostics &diag);
+    void load(std::istream &stream, Diagnostics &diag);
+    void save(const std::string &path) const;
+    void save(std::ostream &stream) const;
+
+private:
+    struct Entry {
+        FileIdentity identity;
+        CachedParseResult result;
+    };
+
+    IdentityMode m_identityMode;
+    std::unordered_map<std::string, Entry> m_entries;
+    mutable std::mutex m_mutex;
+};
+
+/*!
+ * \brief Returns how the identity of files is determined.
+ */
+inline ParseResultCache::IdentityMode ParseResultCache::identityMode() const
+{
+    return m_identityMode;
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_PARSERESULTCACHE_H
@@ -0,0 +1,450 @@
+#ifndef TAG_PARSER_PERFECTHASHMAP_H
+#define TAG_PARSER_PERFECTHASHMAP_H
+
+#include "./global.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace TagParser {
+
+/*!
+ * \brief The PerfectHashTraits struct provides hashing and comparing keys of a PerfectHashMap.
+ * \remarks The hash is supposed to be well-distributed within its high bits and to change completely with the seed.
+ */
+template <typename KeyType> struct PerfectHashTraits;
+
+/*!
+ * \brief Hashes numeric IDs such as the IDs of ID3v2 frames and MP4 atoms.
+ */
+template <> struct PerfectHashTraits<std::uint32_t> {
+    static constexpr std::uint64_t hash(std::uint32_t key, std::uint64_t seed)
+    {
+        return ((static_cast<std::uint64_t>(key) << 1 | 1u) ^ seed) * 0x9E3779B97F4A7C15u;
+    }
+    static constexpr bool equal(std::uint32_t lhs, std::uint32_t rhs)
+    {
+        return lhs == rhs;
+    }
+};
+
+/*!
+ * \brief Hashes strings such as Matroska codec IDs (case-sensitive).
+ */
+template <> struct PerfectHashTraits<std::string_view> {
+    static constexpr std::uint64_t hash(std::string_view key, std::uint64_t seed)
+    {
+        auto hash = 0xcbf29ce484222325u ^ seed;
+        for (const auto c : key) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3u;
+        }
+        return hash * 0x9E3779B97F4A7C15u;
+    }
+    static constexpr bool equal(std::string_view lhs, std::string_view rhs)
+    {
+        return lhs == rhs;
+    }
+};
+
+/*!
+ * \brief Hashes and compares ASCII strings case-insensitively, e.g. Vorbis comment field names.
+ */
+struct CaseInsensitivePerfectHashTraits {
+    static constexpr char toUpper(char c)
+    {
+        return c >= 'a' && c <= 'z' ? static_cast<char>(c - ('a' - 'A')) : c;
+    }
+    static constexpr std::uint64_t hash(std::string_view key, std::uint64_t seed)
+    {
+        auto hash = 0xcbf29ce484222325u ^ seed;
+        for (const auto c : key) {
+            hash = (hash ^ static_cast<unsigned char>(toUpper(c))) * 0x100000001b3u;
+        }
+        return hash * 0x9E3779B97F4A7C15u;
+    }
+    static constexpr bool equal(std::string_view lhs, std::string_view rhs)
+    {
+        if (lhs.size() != rhs.size()) {
+            return false;
+        }
+        for (auto i = std::size_t(); i != lhs.size(); ++i) {
+            if (toUpper(lhs[i]) != toUpper(rhs[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+/*!
+ * \class TagParser::PerfectHashMap
+ * \brief The PerfectHashMap class is an immutable map which is built at compile-time and resolves a key with one hash
+ *        computation and one comparison.
+ *
+ * The entries are stored within an array of the specified \a capacity (a power of two). The constructor tries seeds
+ * for the hash function until no two keys are mapped to the same slot. So a lookup only needs to check a single slot.
+ * Since the map is supposed to be constructed in a constexpr context it is just static data: there is no
+ * initialization at runtime and no locking is required to access it.
+ *
+ * \remarks
+ * - Use makePerfectHashMap() to construct the map with a suitable capacity and check isPerfect() via static_assert
+ *   (it is false if no seed without collisions has been found or if keys are duplicated).
+ * - This is used to translate between IDs and KnownField values and between different versions of IDs.
+ */
+template <typename KeyType, typename ValueType, std::size_t capacity, typename TraitsType = PerfectHashTraits<KeyType>> class PerfectHashMap {
+    static_assert(capacity && !(capacity & (capacity - 1)), "capacity must be a power of two");
+
+public:
+    using value_type = std::pair<KeyType, ValueType>;
+
+    constexpr PerfectHashMap(const value_type *entries, std::size_t size, ValueType defaultValue);
+
+    constexpr bool isPerfect() const;
+    constexpr ValueType find(KeyType key) const;
+
+    /// \brief The number of seeds which are tried at most when constructing the map.
+    static constexpr std::uint64_t maxSeedCount = 0x2000;
+
+private:
+    static constexpr std::size_t slot(KeyType key, std::uint64_t seed);
+    constexpr bool tryInsertAll(const value_type *entries, std::size_t size, std::uint64_t seed);
+
+    std::array<KeyType, capacity> m_keys;
+    std::array<ValueType, capacity> m_values;
+    std::array<bool, capacity> m_occupied;
+    ValueType m_default;
+    std::uint64_t m_seed;
+    bool m_perfect;
+};
+
+/*!
+ * \brief Constructs the map from the specified \a entries; keys not contained by \a entries are mapped to \a defaultValue.
+ */
+template <typename KeyType, typename ValueType, std::size_t capacity, typename TraitsType>
+constexpr PerfectHashMap<KeyType, ValueType, capacity, TraitsType>::PerfectHashMap(
+    const value_type *entries, std::size_t size, ValueType defaultValue)
+    : m_keys()
+    , m_values()
+    , m_occupied()
+    , m_default(defaultValue)
+    , m_seed(0)
+    , m_perfect(false)
+{
+    if (size > capacity) {
+        return;
+    }
+    for (; m_seed != maxSeedCount; ++m_seed) {
+        if ((m_perfect = tryInsertAll(entries, size, m_seed))) {
+            return;
+        }
+    }
+}
+
+/*!
+ * \brief Returns whether all keys are mapped to different slots (and hence all keys can be found).
+ */
+template <typename KeyType, typename ValueType, std::size_t capacity, typename TraitsType>
+constexpr bool PerfectHashMap<KeyType, ValueType, capacity, TraitsType>::isPerfect() const
+{
+    return m_perfect;
+}
+
+/*!
+ * \brief Returns the value for the specified \a key or the default value if \a key is not contained.
+ */
+template <typename KeyType, typename ValueType, std::size_t capacity, typename TraitsType>
+constexpr ValueType PerfectHashMap<KeyType, ValueType, capacity, TraitsType>::find(KeyType key) const
+{
+    const auto index = slot(key, m_seed);
+    return m_occupied[index] && TraitsType::equal(m_keys[index], key) ? m_values[index] : m_default;
+}
+
+/*!
+ * \brief Returns the slot for the specified \a key using the high bits of its hash.
+ */
+template <typename KeyType, typename ValueType, std::size_t capacity, typename TraitsType>
+constexpr std::size_t PerfectHashMap<KeyType, ValueType, capacity, TraitsType>::slot(KeyType key, std::uint64_t seed)
+{
+    auto bits = 0u;
+    for (auto remaining = capacity; remaining > 1; remaining >>= 1) {
+        ++bits;
+    }
+    return bits ? static_cast<std::size_t>(TraitsType::hash(key, seed) >> (64u - bits)) : 0u;
+}
+
+/*!
+ * \brief Inserts all \a entries using the specified \a seed.
+ * \returns Returns whether all entries could be inserted without collision.
+ */
+template <typename KeyType, typename ValueType, std::size_t capacity, typename TraitsType>
+constexpr bool PerfectHashMap<KeyType, ValueType, capacity, TraitsType>::tryInsertAll(
+    const value_type *entries, std::size_t size, std::uint64_t seed)
+{
+    for (auto &occupied : m_occupied) {
+        occupied = false;
+    }
+    for (auto i = std::size_t(); i != size; ++i) {
+        const auto index = slot(entries[i].first, seed);
+        if (m_occupied[index]) {
+            return false;
+        }
+        m_occupied[index] = true;
+        m_keys[index] = entries[i].first;
+        m_values[index] = entries[i].second;
+    }
+    return true;
+}
+
+/*!
+ * \class TagParser::DisplacedPerfectHashMap
+ * \brief The DisplacedPerfectHashMap class is a PerfectHashMap for bigger sets of keys.
+ *
+ * Finding a single seed without collisions becomes infeasible at compile-time for more than roughly a hundred
+ * keys unless the capacity is huge. Hence the keys are first distributed over \a bucketCount buckets and a seed
+ * ("displacement") is searched for each bucket individually, starting with the biggest bucket. So a lookup needs
+ * two hash computations to determine the slot but still only one comparison. The capacity can be kept close to the
+ * number of keys.
+ *
+ * \remarks Use makeDisplacedPerfectHashMap() to construct the map and check isPerfect() via static_assert.
+ */
+template <typename KeyType, typename ValueType, std::size_t bucketCount, std::size_t capacity,
+    typename TraitsType = PerfectHashTraits<KeyType>>
+class DisplacedPerfectHashMap {
+    static_assert(bucketCount && !(bucketCount & (bucketCount - 1)), "bucket count must be a power of two");
+    static_assert(capacity && !(capacity & (capacity - 1)), "capacity must be a power of two");
+
+public:
+    using value_type = std::pair<KeyType, ValueType>;
+
+    constexpr DisplacedPerfectHashMap(const value_type *entries, std::size_t size, ValueType defaultValue);
+
+    constexpr bool isPerfect() const;
+    constexpr ValueType find(KeyType key) const;
+
+    /// \brief The number of seeds which are tried at most for each bucket when constructing the map.
+    static constexpr std::uint16_t maxSeedCount = 0x4000;
+
+private:
+    static constexpr std::size_t highBits(std::uint64_t hash, std::size_t range);
+    static constexpr std::size_t bucket(KeyType key);
+    static constexpr std::size_t slot(KeyType key, std::uint16_t seed);
+
+    std::array<KeyType, capacity> m_keys;
+    std::array<ValueType, capacity> m_values;
+    std::array<bool, capacity> m_occupied;
+    std::array<std::uint16_t, bucketCount> m_seeds;
+    ValueType m_default;
+    bool m_perfect;
+};
+
+/*!
+ * \brief Constructs the map from the specified \a entries; keys not contained by \a entries are mapped to \a defaultValue.
+ */
+template <typename KeyType, typename ValueType, std::size_t bucketCount, std::size_t capacity, typename TraitsType>
+constexpr DisplacedPerfectHashMap<KeyType, ValueType, bucketCount, capacity, TraitsType>::DisplacedPerfectHashMap(
+    const value_type *entries, std::size_t size, ValueType defaultValue)
+    : m_keys()
+    , m_values()
+    , m_occupied()
+    , m_seeds()
+    , m_default(defaultValue)
+    , m_perfect(false)
+{
+    if (size > capacity) {
+        return;
+    }
+
+    // distribute entries over buckets
+    auto bucketSizes = std::array<std::size_t, bucketCount>();
+    auto buckets = std::array<std::size_t, capacity>();
+    auto maxBucketSize = std::size_t();
+    for (auto i = std::size_t(); i != size; ++i) {
+        buckets[i] = bucket(entries[i].first);
+        if (++bucketSizes[buckets[i]] > maxBucketSize) {
+            maxBucketSize = bucketSizes[buckets[i]];
+        }
+    }
+
+    // find a seed for each bucket placing all of its entries into free slots, starting with the biggest buckets
+    auto slots = std::array<std::size_t, capacity>();
+    for (auto bucketSize = maxBucketSize; bucketSize; --bucketSize) {
+        for (auto b = std::size_t(); b != bucketCount; ++b) {
+            if (bucketSizes[b] != bucketSize) {
+                continue;
+            }
+            auto found = false;
+            for (auto seed = std::uint16_t(1); !found && seed != maxSeedCount; ++seed) {
+                found = true;
+                for (auto i = std::size_t(), placed = std::size_t(); found && i != size; ++i) {
+                    if (buckets[i] != b) {
+                        continue;
+                    }
+                    const auto index = slot(entries[i].first, seed);
+                    if (m_occupied[index]) {
+                        found = false;
+                        break;
+                    }
+                    for (auto j = std::size_t(); j != placed; ++j) {
+                        if (slots[j] == index) {
+                            found = false;
+                            break;
+                        }
+                    }
+                    slots[placed++] = index;
+                }
+                if (found) {
+                    m_seeds[b] = seed;
+                }
+            }
+            if (!found) {
+                return;
+            }
+            for (auto i = std::size_t(); i != size; ++i) {
+                if (buckets[i] == b) {
+                    const auto index = slot(entries[i].first, m_seeds[b]);
+                    m_occupied[index] = true;
+                    m_keys[index] = entries[i].first;
+                    m_values[index] = entries[i].second;
+                }
+            }
+        }
+    }
+    m_perfect = true;
+}
+
+/*!
+ * \brief Returns whether a seed has been found for all buckets (and hence all keys can be found).
+ */
+template <typename KeyType, typename ValueType, std::size_t bucketCount, std::size_t capacity, typename TraitsType>
+constexpr bool DisplacedPerfectHashMap<KeyType, ValueType, bucketCount, capacity, TraitsType>::isPerfect() const
+{
+    return m_perfect;
+}
+
+/*!
+ * \brief Returns the value for the specified \a key or the default value if \a key is not contained.
+ */
+template <typename KeyType, typename ValueType, std::size_t bucketCount, std::size_t capacity, typename TraitsType>
+constexpr ValueType DisplacedPerfectHashMap<KeyType, ValueType, bucketCount, capacity, TraitsType>::find(KeyType key) const
+{
+    const auto seed = m_seeds[bucket(key)];
+    if (!seed) {
+        return m_default;
+    }
+    const auto index = slot(key, seed);
+    return m_occupied[index] && TraitsType::equal(m_keys[index], key) ? m_values[index] : m_default;
+}
+
+/*!
+ * \brief Returns the high bits of the specified \a hash as number within [0, \a range) (\a range must be a power of two).
+ */
+template <typename KeyType, typename ValueType, std::size_t bucketCount, std::size_t capacity, typename TraitsType>
+constexpr std::size_t DisplacedPerfectHashMap<KeyType, ValueType, bucketCount, capacity, TraitsType>::highBits(
+    std::uint64_t hash, std::size_t range)
+{
+    auto bits = 0u;
+    for (; range > 1; range >>= 1) {
+        ++bits;
+    }
+    return bits ? static_cast<std::size_t>(hash >> (64u - bits)) : 0u;
+}
+
+/*!
+ * \brief Returns the bucket for the specified \a key.
+ */
+template <typename KeyType, typename ValueType, std::size_t bucketCount, std::size_t capacity, typename TraitsType>
+constexpr std::size_t DisplacedPerfectHashMap<KeyType, ValueType, bucketCount, capacity, TraitsType>::bucket(KeyType key)
+{
+    return highBits(TraitsType::hash(key, 0), bucketCount);
+}
+
+/*!
+ * \brief Returns the slot for the specified \a key using the specified \a seed of its bucket.
+ */
+template <typename KeyType, typename ValueType, std::size_t bucketCount, std::size_t capacity, typename TraitsType>
+constexpr std::size_t DisplacedPerfectHashMap<KeyType, ValueType, bucketCount, capacity, TraitsType>::slot(KeyType key, std::uint16_t seed)
+{
+    return highBits(TraitsType::hash(key, seed), capacity);
+}
+
+/*!
+ * \brief Returns the capacity used by makePerfectHashMap() for the specified number of entries.
+ * \remarks Using four times the number of entries keeps the number of seeds to try at compile-time low.
+ */
+constexpr std::size_t perfectHashMapCapacity(std::size_t size)
+{
+    auto capacity = std::size_t(1);
+    while (capacity < size * 4) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+/*!
+ * \brief Makes a PerfectHashMap for the specified \a entries.
+ * \remarks The TraitsType defaults to PerfectHashTraits<KeyType>.
+ */
+template <typename TraitsType = void, typename KeyType, typename ValueType, std::size_t size>
+constexpr auto makePerfectHashMap(const std::pair<KeyType, ValueType> (&entries)[size], ValueType defaultValue)
+{
+    using Traits = std::conditional_t<std::is_void_v<TraitsType>, PerfectHashTraits<KeyType>, TraitsType>;
+    return PerfectHashMap<KeyType, ValueType, perfectHashMapCapacity(size), Traits>(entries, size, defaultValue);
+}
+
+/*!
+ * \brief Makes a PerfectHashMap for the specified \a entries with keys and values swapped.
+ * \remarks This allows using the same entries to translate in both directions.
+ */
+template <typename TraitsType = void, typename KeyType, typename ValueType, std::size_t size>
+constexpr auto makeReversedPerfectHashMap(const std::pair<KeyType, ValueType> (&entries)[size], KeyType defaultValue)
+{
+    using Traits = std::conditional_t<std::is_void_v<TraitsType>, PerfectHashTraits<ValueType>, TraitsType>;
+    auto reversedEntries = std::array<std::pair<ValueType, KeyType>, size>();
+    for (auto i = std::size_t(); i != size; ++i) {
+        reversedEntries[i].first = entries[i].second;
+        reversedEntries[i].second = entries[i].first;
+    }
+    return PerfectHashMap<ValueType, KeyType, perfectHashMapCapacity(size), Traits>(reversedEntries.data(), size, defaultValue);
+}
+
+/*!
+ * \brief Makes a DisplacedPerfectHashMap for the specified \a entries.
+ * \remarks Uses a bucket for every four entries and a capacity of at least 1.5 times the number of entries.
+ */
+template <typename TraitsType = void, typename KeyType, typename ValueType, std::size_t size>
+constexpr auto makeDisplacedPerfectHashMap(const std::array<std::pair<KeyType, ValueType>, size> &entries, ValueType defaultValue)
+{
+    using Traits = std::conditional_t<std::is_void_v<TraitsType>, PerfectHashTraits<KeyType>, TraitsType>;
+    constexpr auto roundUp = [](std::size_t n) {
+        auto powerOfTwo = std::size_t(1);
+        while (powerOfTwo < n) {
+            powerOfTwo <<= 1;
+        }
+        return powerOfTwo;
+    };
+    return DisplacedPerfectHashMap<KeyType, ValueType, roundUp(size / 4 + 1), roundUp(size + size / 2), Traits>(
+        entries.data(), size, defaultValue);
+}
+
+/*!
+ * \brief Makes a DisplacedPerfectHashMap for the specified \a entries.
+ * \remarks Same as the overload taking an std::array; allows specifying the entries as plain array.
+ */
+template <typename TraitsType = void, typename KeyType, typename ValueType, std::size_t size>
+constexpr auto makeDisplacedPerfectHashMap(const std::pair<KeyType, ValueType> (&entries)[size], ValueType defaultValue)
+{
+    auto entriesArray = std::array<std::pair<KeyType, ValueType>, size>();
+    for (auto i = std::size_t(); i != size; ++i) {
+        entriesArray[i].first = entries[i].first;
+        entriesArray[i].second = entries[i].second;
+    }
+    return makeDisplacedPerfectHashMap<TraitsType>(entriesArray, defaultValue);
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_PERFECTHASHMAP_H
@@ -4,6 +4,7 @@
 #include "./exceptions.h"
 
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <string>
@@ -20,6 +21,8 @@ public:
     const std::string &step() const;
     std::uint8_t stepPercentage() const;
     std::uint8_t overallPercentage() const;
+    std::uint64_t stepCount() const;
+    void setThrottling(std::uint8_t minPercentageDelta, std::chrono::steady_clock::duration minInterval = std::chrono::steady_clock::duration::zero());
     void updateStep(const std::string &step, std::uint8_t stepPercentage = 0);
     void updateStep(std::string &&step, std::uint8_t stepPercentage = 0);
     void updateStepPercentage(std::uint8_t stepPercentage);
@@ -27,11 +30,20 @@ public:
     void updateOverallPercentage(std::uint8_t overallPercentage);
 
 private:
+    void reportStep();
+    void reportPercentage();
+
     Callback m_callback;
     Callback m_percentageOnlyCallback;
     std::string m_step;
-    std::uint8_t m_stepPercentage;
-    std::uint8_t m_overallPercentage;
+    std::atomic<std::uint8_t> m_stepPercentage;
+    std::atomic<std::uint8_t> m_overallPercentage;
+    std::atomic<std::uint64_t> m_stepCount;
+    std::uint8_t m_minPercentageDelta;
+    std::uint8_t m_reportedStepPercentage;
+    std::uint8_t m_reportedOverallPercentage;
+    std::chrono::steady_clock::duration m_minInterval;
+    std::chrono::steady_clock::time_point m_lastReport;
 };
 
 /*!
@@ -45,6 +57,11 @@ inline BasicProgressFeedback<ActualProgressFeedback>::BasicProgressFeedback(cons
     , m_percentageOnlyCallback(percentageOnlyCallback)
     , m_stepPercentage(0)
     , m_overallPercentage(0)
+    , m_stepCount(0)
+    , m_minPercentageDelta(0)
+    , m_reportedStepPercentage(0)
+    , m_reportedOverallPercentage(0)
+    , m_minInterval(std::chrono::steady_clock::duration::zero())
 {
 }
 
@@ -59,11 +76,18 @@ inline BasicProgressFeedback<ActualProgressFeedback>::BasicProgressFeedback(Call
     , m_percentageOnlyCallback(percentageOnlyCallback)
     , m_stepPercentage(0)
     , m_overallPercentage(0)
+    , m_stepCount(0)
+    , m_minPercentageDelta(0)
+    , m_reportedStepPercentage(0)
+    , m_reportedOverallPercentage(0)
+    , m_minInterval(std::chrono::steady_clock::duration::zero())
 {
 }
 
 /*!
  * \brief Returns the name of the current step (initially empty).
+ * \remarks In contrast to the percentages and the stepCount() the step must not be read from another thread while the operation
+ *          is ongoing. Use the callbacks to obtain it.
  */
 template <typename ActualProgressFeedback> inline const std::string &BasicProgressFeedback<ActualProgressFeedback>::step() const
 {
@@ -72,20 +96,53 @@ template <typename ActualProgressFeedback> inline const std::string &BasicProgre
 
 /*!
  * \brief Returns the percentage of the current step (initially 0, supposed to be a value from 0 to 100).
- * \remarks A percentage of 0 means that the percentage is currently unknown; 100 means finished.
+ * \remarks
+ * - A percentage of 0 means that the percentage is currently unknown; 100 means finished.
+ * - Can be polled from another thread without locking (also when callbacks are throttled or not specified at all).
  */
 template <typename ActualProgressFeedback> inline std::uint8_t BasicProgressFeedback<ActualProgressFeedback>::stepPercentage() const
 {
-    return m_stepPercentage;
+    return m_stepPercentage.load(std::memory_order_relaxed);
 }
 
 /*!
  * \brief Returns the overall percentage (initially 0, supposed to be a value from 0 to 100).
- * \remarks A percentage of 0 means that the percentage is currently unknown; 100 means finished.
+ * \remarks
+ * - A percentage of 0 means that the percentage is currently unknown; 100 means finished.
+ * - Can be polled from another thread without locking (also when callbacks are throttled or not specified at all).
  */
 template <typename ActualProgressFeedback> inline std::uint8_t BasicProgressFeedback<ActualProgressFeedback>::overallPercentage() const
 {
-    return m_overallPercentage;
+    return m_overallPercentage.load(std::memory_order_relaxed);
+}
+
+/*!
+ * \brief Returns the number of steps the operation has entered so far.
+ * \remarks Can be polled from another thread without locking to detect when the operation moves on to the next step.
+ */
+template <typename ActualProgressFeedback> inline std::uint64_t BasicProgressFeedback<ActualProgressFeedback>::stepCount() const
+{
+    return m_stepCount.load(std::memory_order_relaxed);
+}
+
+/*!
+ * \brief Limits how often the percentage-only callback is invoked.
+ *
+ * When only percentages change, the callback is only invoked if a percentage changed by at least \a minPercentageDelta and at
+ * least \a minInterval elapsed since the callback has been invoked the last time. Reaching 100 percent is always reported. Updates
+ * which do not change any percentage are not reported at all. Pass zero for both arguments to report every update (the default).
+ *
+ * \remarks
+ * - This is useful if the callbacks are expensive (e.g. when they notify a GUI or a remote peer) because copy loops update the
+ *   percentage very frequently.
+ * - Changing the step is always reported.
+ * - Must not be called while the operation is ongoing.
+ */
+template <typename ActualProgressFeedback>
+inline void BasicProgressFeedback<ActualProgressFeedback>::setThrottling(std::uint8_t minPercentageDelta, std::chrono::steady_clock::duration minInterval)
+{
+    m_minPercentageDelta = minPercentageDelta;
+    m_minInterval = minInterval;
 }
 
 /*!
@@ -96,10 +153,8 @@ template <typename ActualProgressFeedback>
 inline void BasicProgressFeedback<ActualProgressFeedback>::updateStep(const std::string &step, std::uint8_t stepPercentage)
 {
     m_step = step;
-    m_stepPercentage = stepPercentage;
-    if (m_callback) {
-        m_callback(*static_cast<ActualProgressFeedback *>(this));
-    }
+    m_stepPercentage.store(stepPercentage, std::memory_order_relaxed);
+    reportStep();
 }
 
 /*!
@@ -109,11 +164,9 @@ inline void BasicProgressFeedback<ActualProgressFeedback>::updateStep(const std:
 template <typename ActualProgressFeedback>
 inline void BasicProgressFeedback<ActualProgressFeedback>::updateStep(std::string &&step, std::uint8_t stepPercentage)
 {
-    m_step = step;
-    m_stepPercentage = stepPercentage;
-    if (m_callback) {
-        m_callback(*static_cast<ActualProgressFeedback *>(this));
-    }
+    m_step = std::move(step);
+    m_stepPercentage.store(stepPercentage, std::memory_order_relaxed);
+    reportStep();
 }
 
 /*!
@@ -123,12 +176,8 @@ inline void BasicProgressFeedback<ActualProgressFeedback>::updateStep(std::strin
 template <typename ActualProgressFeedback>
 inline void BasicProgressFeedback<ActualProgressFeedback>::updateStepPercentage(std::uint8_t stepPercentage)
 {
-    m_stepPercentage = stepPercentage;
-    if (m_percentageOnlyCallback) {
-        m_percentageOnlyCallback(*static_cast<ActualProgressFeedback *>(this));
-    } else if (m_callback) {
-        m_callback(*static_cast<ActualProgressFeedback *>(this));
-    }
+    m_stepPercentage.store(stepPercentage, std::memory_order_relaxed);
+    reportPercentage();
 }
 
 /*!
@@ -149,14 +198,66 @@ inline void BasicProgressFeedback<ActualProgressFeedback>::updateStepPercentageF
 template <typename ActualProgressFeedback>
 inline void BasicProgressFeedback<ActualProgressFeedback>::updateOverallPercentage(std::uint8_t overallPercentage)
 {
-    m_overallPercentage = overallPercentage;
-    if (m_percentageOnlyCallback) {
-        m_percentageOnlyCallback(*static_cast<ActualProgressFeedback *>(this));
-    } else if (m_callback) {
+    m_overallPercentage.store(overallPercentage, std::memory_order_relaxed);
+    reportPercentage();
+}
+
+/*!
+ * \brief Invokes the first callback specified on construction after the step has changed.
+ */
+template <typename ActualProgressFeedback> inline void BasicProgressFeedback<ActualProgressFeedback>::reportStep()
+{
+    m_stepCount.fetch_add(1, std::memory_order_relaxed);
+    m_reportedStepPercentage = m_stepPercentage.load(std::memory_order_relaxed);
+    m_reportedOverallPercentage = m_overallPercentage.load(std::memory_order_relaxed);
+    if (m_minInterval != std::chrono::steady_clock::duration::zero()) {
+        m_lastReport = std::chrono::steady_clock::now();
+    }
+    if (m_callback) {
         m_callback(*static_cast<ActualProgressFeedback *>(this));
     }
 }
 
+/*!
+ * \brief Invokes the second callback specified on construction (or the first if only one has been specified) after a percentage
+ *        has changed unless the update is throttled.
+ * \sa setThrottling()
+ */
+template <typename ActualProgressFeedback> inline void BasicProgressFeedback<ActualProgressFeedback>::reportPercentage()
+{
+    const auto &callback = m_percentageOnlyCallback ? m_percentageOnlyCallback : m_callback;
+    if (!callback) {
+        return;
+    }
+    const auto stepPercentage = m_stepPercentage.load(std::memory_order_relaxed);
+    const auto overallPercentage = m_overallPercentage.load(std::memory_order_relaxed);
+    if (m_minPercentageDelta || m_minInterval != std::chrono::steady_clock::duration::zero()) {
+        const auto stepDelta = stepPercentage > m_reportedStepPercentage ? stepPercentage - m_reportedStepPercentage
+                                                                         : m_reportedStepPercentage - stepPercentage;
+        const auto overallDelta = overallPercentage > m_reportedOverallPercentage ? overallPercentage - m_reportedOverallPercentage
+                                                                                  : m_reportedOverallPercentage - overallPercentage;
+        if (!stepDelta && !overallDelta) {
+            return;
+        }
+        const auto finished = (stepDelta && stepPercentage >= 100) || (overallDelta && overallPercentage >= 100);
+        if (!finished) {
+            if (stepDelta < m_minPercentageDelta && overallDelta < m_minPercentageDelta) {
+                return;
+            }
+            if (m_minInterval != std::chrono::steady_clock::duration::zero()) {
+                const auto now = std::chrono::steady_clock::now();
+                if (now - m_lastReport < m_minInterval) {
+                    return;
+                }
+                m_lastReport = now;
+            }
+        }
+        m_reportedStepPercentage = stepPercentage;
+        m_reportedOverallPercentage = overallPercentage;
+    }
+    callback(*static_cast<ActualProgressFeedback *>(this));
+}
+
 class ProgressFeedback : public BasicProgressFeedback<ProgressFeedback> {
 public:
     ProgressFeedback(const Callback &callback, const Callback &percentageOnlyCallback = Callback());
@@ -190,12 +291,17 @@ public:
 
     bool isAborted() const;
     void tryToAbort();
+    std::chrono::steady_clock::time_point deadline() const;
+    void setDeadline(std::chrono::steady_clock::time_point deadline);
+    void setTimeLimit(std::chrono::steady_clock::duration timeLimit);
+    bool isDeadlineExceeded() const;
     void stopIfAborted() const;
     void nextStepOrStop(const std::string &step, std::uint8_t stepPercentage = 0);
     void nextStepOrStop(std::string &&step, std::uint8_t stepPercentage = 0);
 
 private:
     std::atomic_bool m_aborted;
+    std::chrono::steady_clock::time_point m_deadline;
 };
 
 /*!
@@ -206,6 +312,7 @@ private:
 inline AbortableProgressFeedback::AbortableProgressFeedback(const Callback &callback, const Callback &percentageOnlyCallback)
     : BasicProgressFeedback<AbortableProgressFeedback>(callback, percentageOnlyCallback)
     , m_aborted(false)
+    , m_deadline(std::chrono::steady_clock::time_point::max())
 {
 }
 
@@ -221,11 +328,12 @@ inline AbortableProgressFeedback::AbortableProgressFeedback(Callback &&callback,
 }
 
 /*!
- * \brief Returns whether the operation has been aborted via tryToAbort().
+ * \brief Returns whether the operation has been aborted via tryToAbort() or the deadline has been exceeded.
+ * \remarks Copy loops call this for every buffer they copy so the operation stops quickly also when copying huge files.
  */
 inline bool AbortableProgressFeedback::isAborted() const
 {
-    return m_aborted.load();
+    return m_aborted.load() || isDeadlineExceeded();
 }
 
 /*!
@@ -238,6 +346,48 @@ inline void AbortableProgressFeedback::tryToAbort()
     return m_aborted.store(true);
 }
 
+/*!
+ * \brief Returns the point in time after which the operation is considered aborted.
+ * \remarks Defaults to std::chrono::steady_clock::time_point::max() which means there is no deadline.
+ */
+inline std::chrono::steady_clock::time_point AbortableProgressFeedback::deadline() const
+{
+    return m_deadline;
+}
+
+/*!
+ * \brief Sets the point in time after which the operation is considered aborted.
+ *
+ * This allows limiting the wall time of an operation like MediaFileInfo::applyChanges(). Once the \a deadline has been
+ * exceeded the operation is aborted as if tryToAbort() had been called; when a file is being rewritten the original file
+ * is restored.
+ *
+ * \remarks Must not be called while the operation is ongoing.
+ */
+inline void AbortableProgressFeedback::setDeadline(std::chrono::steady_clock::time_point deadline)
+{
+    m_deadline = deadline;
+}
+
+/*!
+ * \brief Sets the deadline to \a timeLimit from now.
+ * \sa setDeadline()
+ */
+inline void AbortableProgressFeedback::setTimeLimit(std::chrono::steady_clock::duration timeLimit)
+{
+    const auto now = std::chrono::steady_clock::now();
+    m_deadline = timeLimit < std::chrono::steady_clock::time_point::max() - now ? now + timeLimit : std::chrono::steady_clock::time_point::max();
+}
+
+/*!
+ * \brief Returns whether a deadline has been set and exceeded.
+ * \remarks Allows telling whether an OperationAbortedException has been caused by the deadline.
+ */
+inline bool AbortableProgressFeedback::isDeadlineExceeded() const
+{
+    return m_deadline != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() >= m_deadline;
+}
+
 /*!
  * \brief Throws an OperationAbortedException if aborted.
  * \remarks Supposed to be called only by the operation itself.
@@ -0,0 +1,269 @@
+#include "./seeklessoutputstream.h"
+
+#ifdef PLATFORM_UNIX
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace TagParser {
+
+/*!
+ * \class TagParser::SeeklessOutputStream
+ * \brief The SeeklessOutputStream class writes strictly forward to another stream or to a file descriptor.
+ *
+ * It is meant to write files to outputs which can not seek like pipes, sockets or uploads to object stores (see
+ * MediaFileInfo::writeChanges()). Seeking is only possible to obtain the current position (so tellp() works). To patch
+ * sizes and offsets which are only known after writing a structure, the bytes can be held back in memory via hold()
+ * and written via release(). While holding, it is possible to seek back to any position after the one hold() has been
+ * called at.
+ *
+ * \remarks The stream has std::ios_base::badbit and std::ios_base::failbit set as exception mask so writing and seeking
+ *          failures are reported as std::ios_base::failure. Call flush() after writing to ensure everything has
+ *          been written to the target.
+ */
+
+/*!
+ * \brief Constructs a new stream writing to the specified \a target stream.
+ * \remarks The \a target stream must outlive the stream.
+ */
+SeeklessOutputStream::SeeklessOutputStream(std::ostream &target, std::size_t bufferSize)
+    : std::ostream(nullptr)
+    , m_buffer(&target, -1, bufferSize)
+{
+    rdbuf(&m_buffer);
+    exceptions(ios_base::badbit | ios_base::failbit);
+}
+
+#ifdef PLATFORM_UNIX
+/*!
+ * \brief Constructs a new stream writing to the specified \a fileDescriptor (e.g. a pipe or a socket).
+ * \remarks The \a fileDescriptor is not closed by the stream.
+ */
+SeeklessOutputStream::SeeklessOutputStream(int fileDescriptor, std::size_t bufferSize)
+    : std::ostream(nullptr)
+    , m_buffer(nullptr, fileDescriptor, bufferSize)
+{
+    rdbuf(&m_buffer);
+    exceptions(ios_base::badbit | ios_base::failbit);
+}
+#endif
+
+/*!
+ * \brief Holds the bytes written from now on back in memory so it is possible to seek back and overwrite them.
+ * \remarks Does nothing if already holding.
+ */
+void SeeklessOutputStream::hold()
+{
+    if (!m_buffer.hold()) {
+        setstate(ios_base::badbit);
+    }
+}
+
+/*!
+ * \brief Writes the bytes held back since hold() has been called; afterwards it is not possible to seek back anymore.
+ * \remarks Does nothing if not holding.
+ */
+void SeeklessOutputStream::release()
+{
+    if (!m_buffer.release()) {
+        setstate(ios_base::badbit);
+    }
+}
+
+/// \cond
+
+SeeklessOutputBuffer::SeeklessOutputBuffer(std::ostream *target, int fileDescriptor, std::size_t bufferSize)
+    : m_target(target)
+    , m_fileDescriptor(fileDescriptor)
+    , m_bufferSize(bufferSize ? bufferSize : 1)
+    , m_bytesWritten(0)
+    , m_heldPosition(0)
+    , m_holding(false)
+{
+    m_buffer = make_unique<char[]>(m_bufferSize);
+    setp(m_buffer.get(), m_buffer.get() + m_bufferSize);
+}
+
+std::uint64_t SeeklessOutputBuffer::bytesWritten() const
+{
+    return m_bytesWritten + (m_holding ? m_held.size() : static_cast<std::uint64_t>(pptr() - pbase()));
+}
+
+bool SeeklessOutputBuffer::isHolding() const
+{
+    return m_holding;
+}
+
+bool SeeklessOutputBuffer::hold()
+{
+    if (m_holding) {
+        return true;
+    }
+    if (!flushPutArea()) {
+        return false;
+    }
+    // write everything via overflow()/xsputn() while holding so the position within the held bytes can be tracked
+    setp(nullptr, nullptr);
+    m_holding = true;
+    m_heldPosition = 0;
+    return true;
+}
+
+bool SeeklessOutputBuffer::release()
+{
+    if (!m_holding) {
+        return true;
+    }
+    const auto success = writeToTarget(m_held.data(), m_held.size());
+    m_bytesWritten += m_held.size();
+    m_held.clear();
+    m_holding = false;
+    setp(m_buffer.get(), m_buffer.get() + m_bufferSize);
+    return success;
+}
+
+std::uint64_t SeeklessOutputBuffer::currentPosition() const
+{
+    return m_bytesWritten + (m_holding ? m_heldPosition : static_cast<std::uint64_t>(pptr() - pbase()));
+}
+
+SeeklessOutputBuffer::int_type SeeklessOutputBuffer::overflow(int_type ch)
+{
+    if (traits_type::eq_int_type(ch, traits_type::eof())) {
+        return m_holding || flushPutArea() ? traits_type::not_eof(ch) : traits_type::eof();
+    }
+    const auto c = traits_type::to_char_type(ch);
+    if (m_holding) {
+        writeHeld(&c, 1);
+        return ch;
+    }
+    if (!flushPutArea()) {
+        return traits_type::eof();
+    }
+    *pptr() = c;
+    pbump(1);
+    return ch;
+}
+
+streamsize SeeklessOutputBuffer::xsputn(const char_type *data, streamsize count)
+{
+    if (count <= 0) {
+        return 0;
+    }
+    const auto size = static_cast<std::size_t>(count);
+    if (m_holding) {
+        writeHeld(data, size);
+        return count;
+    }
+    // take what fits into the buffer, write large chunks directly
+    if (size <= static_cast<std::size_t>(epptr() - pptr())) {
+        memcpy(pptr(), data, size);
+        pbump(static_cast<int>(size));
+        return count;
+    }
+    if (!flushPutArea()) {
+        return 0;
+    }
+    if (size >= m_bufferSize) {
+        if (!writeToTarget(data, size)) {
+            return 0;
+        }
+        m_bytesWritten += size;
+        return count;
+    }
+    memcpy(pptr(), data, size);
+    pbump(static_cast<int>(size));
+    return count;
+}
+
+SeeklessOutputBuffer::pos_type SeeklessOutputBuffer::seekoff(off_type off, ios_base::seekdir dir, ios_base::openmode which)
+{
+    if (!(which & ios_base::out) || (which & ios_base::in)) {
+        return pos_type(off_type(-1));
+    }
+    const auto current = static_cast<off_type>(currentPosition());
+    const auto end = static_cast<off_type>(bytesWritten());
+    const auto newPosition = off + (dir == ios_base::beg ? 0 : (dir == ios_base::cur ? current : end));
+    if (newPosition == current) {
+        return pos_type(current);
+    }
+    // seeking is only possible within the held bytes
+    const auto heldBegin = static_cast<off_type>(m_bytesWritten);
+    if (!m_holding || newPosition < heldBegin || newPosition > end) {
+        return pos_type(off_type(-1));
+    }
+    m_heldPosition = static_cast<std::size_t>(newPosition - heldBegin);
+    return pos_type(newPosition);
+}
+
+SeeklessOutputBuffer::pos_type SeeklessOutputBuffer::seekpos(pos_type pos, ios_base::openmode which)
+{
+    return seekoff(off_type(pos), ios_base::beg, which);
+}
+
+int SeeklessOutputBuffer::sync()
+{
+    // held bytes can not be written before release() is called
+    if (m_holding) {
+        return 0;
+    }
+    if (!flushPutArea()) {
+        return -1;
+    }
+    return m_target && !m_target->flush() ? -1 : 0;
+}
+
+bool SeeklessOutputBuffer::flushPutArea()
+{
+    if (m_holding) {
+        return true;
+    }
+    const auto size = static_cast<std::size_t>(pptr() - pbase());
+    const auto success = writeToTarget(pbase(), size);
+    m_bytesWritten += size;
+    setp(m_buffer.get(), m_buffer.get() + m_bufferSize);
+    return success;
+}
+
+bool SeeklessOutputBuffer::writeToTarget(const char *data, std::size_t count)
+{
+    if (!count) {
+        return true;
+    }
+    if (m_target) {
+        return static_cast<bool>(m_target->write(data, static_cast<streamsize>(count)));
+    }
+#ifdef PLATFORM_UNIX
+    while (count) {
+        const auto bytesWritten = ::write(m_fileDescriptor, data, count);
+        if (bytesWritten < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += bytesWritten;
+        count -= static_cast<std::size_t>(bytesWritten);
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void SeeklessOutputBuffer::writeHeld(const char *data, std::size_t count)
+{
+    // overwrite held bytes after seeking back, append otherwise
+    const auto overwritten = min(count, m_held.size() - m_heldPosition);
+    m_held.replace(m_heldPosition, overwritten, data, count);
+    m_heldPosition += count;
+}
+
+/// \endcond
+
+} // namespace TagParser
@@ -0,0 +1,83 @@
+#ifndef TAG_PARSER_SEEKLESSOUTPUTSTREAM_H
+#define TAG_PARSER_SEEKLESSOUTPUTSTREAM_H
+
+#include "./global.h"
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+namespace TagParser {
+
+/// \cond
+class TAG_PARSER_EXPORT SeeklessOutputBuffer : public std::streambuf {
+public:
+    explicit SeeklessOutputBuffer(std::ostream *target, int fileDescriptor, std::size_t bufferSize);
+
+    std::uint64_t bytesWritten() const;
+    bool hold();
+    bool release();
+    bool isHolding() const;
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char_type *data, std::streamsize count) override;
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+    int sync() override;
+
+private:
+    std::uint64_t currentPosition() const;
+    bool flushPutArea();
+    bool writeToTarget(const char *data, std::size_t count);
+    void writeHeld(const char *data, std::size_t count);
+
+    std::ostream *m_target;
+    int m_fileDescriptor;
+    std::unique_ptr<char[]> m_buffer;
+    std::size_t m_bufferSize;
+    std::uint64_t m_bytesWritten;
+    std::string m_held;
+    std::size_t m_heldPosition;
+    bool m_holding;
+};
+/// \endcond
+
+class TAG_PARSER_EXPORT SeeklessOutputStream : public std::ostream {
+public:
+    explicit SeeklessOutputStream(std::ostream &target, std::size_t bufferSize = 0x10000);
+#ifdef PLATFORM_UNIX
+    explicit SeeklessOutputStream(int fileDescriptor, std::size_t bufferSize = 0x10000);
+#endif
+    SeeklessOutputStream(const SeeklessOutputStream &) = delete;
+
+    std::uint64_t bytesWritten() const;
+    void hold();
+    void release();
+    bool isHolding() const;
+
+private:
+    SeeklessOutputBuffer m_buffer;
+};
+
+/*!
+ * \brief Returns the number of bytes written to the stream so far (including the bytes which are held back).
+ */
+inline std::uint64_t SeeklessOutputStream::bytesWritten() const
+{
+    return m_buffer.bytesWritten();
+}
+
+/*!
+ * \brief Returns whether the bytes written to the stream are currently held back (see hold()).
+ */
+inline bool SeeklessOutputStream::isHolding() const
+{
+    return m_buffer.isHolding();
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_SEEKLESSOUTPUTSTREAM_H
@@ -0,0 +1,620 @@
+#include "../batchparser.h"
+#include "../diagnostics.h"
+#include "../librarywatcher.h"
+#include "../mediafileinfo.h"
+#include "../parseresultcache.h"
+#include "../progressfeedback.h"
+#include "../tag.h"
+#include "../tagvalue.h"
+
+#include <c++utilities/conversion/stringbuilder.h>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+using namespace CppUtilities;
+using namespace TagParser;
+
+/*!
+ * \file service.cpp
+ * \brief Serves parse and edit requests via a Unix domain socket so clients do not pay the startup costs for each file.
+ *
+ * The service keeps a ParseResultCache (optionally loaded from and saved to a file), keeps it up to date via
+ * LibraryWatcher and reuses MediaFileInfo objects (and their element arenas) between requests. So clients which used
+ * to spawn a process per file only pay for the files which actually changed.
+ *
+ * The protocol is line-based so it can be used from scripts (e.g. via socat). Each request is a line of tab-separated
+ * arguments. Each response starts with "ok" or "error<TAB><message>", is followed by tab-separated lines and is
+ * terminated by a line only containing ".". Tabs, line breaks and backslashes within arguments and values are escaped
+ * as "\t", "\n" and "\\". The following requests are supported:
+ * - parse<TAB><path>: returns the container, the tracks, the tags, the chapters and the attachments of the file
+ * - edit<TAB><path><TAB><field>=<value>...: sets the specified fields (e.g. "title=foo"; an empty value removes the field)
+ *   and applies the changes (the cache is updated without parsing the file again)
+ * - scan<TAB><path>...: parses the specified files concurrently via BatchParser to warm up the cache
+ * - watch<TAB><directory>: keeps the cache entries of the files within the directory up to date
+ * - stats: returns the number of requests, cache hits and misses, the number of cached entries and pooled objects
+ * - save: saves the cache to the file specified via --cache
+ * - shutdown: stops the service (after saving the cache)
+ */
+
+namespace {
+
+/// \brief The names of the fields used within requests and responses (in the order of KnownField).
+constexpr const char *fieldNames[] = { "title", "album", "artist", "genre", "year", "comment", "bpm", "bps", "lyricist", "trackPosition",
+    "diskPosition", "partNumber", "totalParts", "encoder", "recordDate", "performers", "length", "language", "encoderSettings", "lyrics",
+    "synchronizedLyrics", "grouping", "recordLabel", "cover", "composer", "rating", "description", "vendor", "albumArtist", "releaseDate" };
+static_assert(sizeof(fieldNames) / sizeof(fieldNames[0]) == knownFieldArraySize, "a name for each known field required");
+
+/// \brief The max. number of MediaFileInfo objects kept for reuse.
+constexpr std::size_t maxPooledFileInfos = 64;
+
+/// \brief The write end of the pipe the signal handler uses to stop the service.
+int stopPipe = -1;
+
+void handleStopSignal(int)
+{
+    const char byte = 0;
+    const auto res = ::write(stopPipe, &byte, 1);
+    CPP_UTILITIES_UNUSED(res);
+}
+
+const char *fieldName(KnownField field)
+{
+    return field == KnownField::Invalid ? "invalid" : fieldNames[static_cast<unsigned int>(field)];
+}
+
+KnownField fieldFromName(std::string_view name)
+{
+    for (auto field = firstKnownField; field != KnownField::Invalid; field = nextKnownField(field)) {
+        if (name == fieldNames[static_cast<unsigned int>(field)]) {
+            return field;
+        }
+    }
+    return KnownField::Invalid;
+}
+
+const char *tagTypeName(TagType type)
+{
+    switch (type) {
+    case TagType::Id3v1Tag:
+        return "ID3v1";
+    case TagType::Id3v2Tag:
+        return "ID3v2";
+    case TagType::Mp4Tag:
+        return "MP4";
+    case TagType::MatroskaTag:
+        return "Matroska";
+    case TagType::VorbisComment:
+    case TagType::OggVorbisComment:
+        return "VorbisComment";
+    case TagType::RiffInfoTag:
+        return "RIFF-INFO";
+    default:
+        return "unspecified";
+    }
+}
+
+std::string escape(std::string_view value)
+{
+    auto escaped = std::string();
+    escaped.reserve(value.size());
+    for (const auto c : value) {
+        switch (c) {
+        case '\\':
+            escaped += "\\\\";
+            break;
+        case '\t':
+            escaped += "\\t";
+            break;
+        case '\n':
+            escaped += "\\n";
+            break;
+        default:
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::vector<std::string> splitRequest(std::string_view line)
+{
+    auto args = std::vector<std::string>(1);
+    for (auto i = std::size_t(); i != line.size(); ++i) {
+        if (line[i] == '\t') {
+            args.emplace_back();
+        } else if (line[i] == '\\' && i + 1 != line.size()) {
+            const auto next = line[++i];
+            args.back() += next == 't' ? '\t' : (next == 'n' ? '\n' : next);
+        } else if (line[i] != '\r') {
+            args.back() += line[i];
+        }
+    }
+    return args;
+}
+
+struct ServiceOptions {
+    std::string socketPath;
+    std::string cachePath;
+    std::vector<std::string> watchedDirectories;
+    unsigned int parallelism = 0;
+};
+
+class Service {
+public:
+    explicit Service(const ServiceOptions &options);
+    int run();
+
+private:
+    std::unique_ptr<MediaFileInfo> acquireFileInfo(const std::string &path);
+    void releaseFileInfo(std::unique_ptr<MediaFileInfo> &&fileInfo);
+    void serveConnection(int connection);
+    std::string handleRequest(const std::vector<std::string> &args);
+    std::string parse(const std::string &path);
+    std::string edit(const std::vector<std::string> &args);
+    std::string scan(const std::vector<std::string> &args);
+    std::string watch(const std::string &directory);
+    std::string stats() const;
+    std::string save();
+    void watchLibrary();
+    void stop();
+
+    ServiceOptions m_options;
+    ParseResultCache m_cache;
+    LibraryWatcher m_watcher;
+    std::mutex m_watcherMutex;
+    BatchParser m_parser;
+    std::mutex m_parserMutex;
+    std::vector<std::unique_ptr<MediaFileInfo>> m_pool;
+    mutable std::mutex m_poolMutex;
+    std::unordered_set<int> m_connections;
+    std::mutex m_connectionsMutex;
+    std::atomic<bool> m_stopping;
+    std::chrono::steady_clock::time_point m_startTime;
+    std::atomic<std::uint64_t> m_requests, m_cacheHits, m_cacheMisses, m_edits, m_errors, m_refreshedFiles;
+};
+
+Service::Service(const ServiceOptions &options)
+    : m_options(options)
+    , m_watcher(m_cache)
+    , m_parser(options.parallelism)
+    , m_stopping(false)
+    , m_startTime(chrono::steady_clock::now())
+    , m_requests(0)
+    , m_cacheHits(0)
+    , m_cacheMisses(0)
+    , m_edits(0)
+    , m_errors(0)
+    , m_refreshedFiles(0)
+{
+    m_parser.setAsyncReadingEnabled(true);
+    m_parser.setSetupCallback([](MediaFileInfo &fileInfo) { fileInfo.setElementArenaEnabled(true); });
+}
+
+/*!
+ * \brief Returns a MediaFileInfo object for the specified \a path reusing a pooled one if possible.
+ */
+std::unique_ptr<MediaFileInfo> Service::acquireFileInfo(const std::string &path)
+{
+    auto fileInfo = std::unique_ptr<MediaFileInfo>();
+    {
+        const auto guard = lock_guard<mutex>(m_poolMutex);
+        if (!m_pool.empty()) {
+            fileInfo = std::move(m_pool.back());
+            m_pool.pop_back();
+        }
+    }
+    if (fileInfo) {
+        // keeps the element arena for the next file
+        fileInfo->reset(path);
+    } else {
+        fileInfo = make_unique<MediaFileInfo>(path);
+        fileInfo->setElementArenaEnabled(true);
+        fileInfo->setParseResultCache(&m_cache);
+    }
+    return fileInfo;
+}
+
+/*!
+ * \brief Returns the specified \a fileInfo to the pool.
+ */
+void Service::releaseFileInfo(std::unique_ptr<MediaFileInfo> &&fileInfo)
+{
+    fileInfo->close();
+    fileInfo->clearParsingResults();
+    const auto guard = lock_guard<mutex>(m_poolMutex);
+    if (m_pool.size() < maxPooledFileInfos) {
+        m_pool.emplace_back(std::move(fileInfo));
+    }
+}
+
+std::string Service::parse(const std::string &path)
+{
+    const auto identity = m_cache.identify(path);
+    auto result = m_cache.find(path, identity);
+    const auto cacheHit = result.has_value();
+    if (cacheHit) {
+        ++m_cacheHits;
+    } else {
+        ++m_cacheMisses;
+        auto diag = Diagnostics();
+        auto fileInfo = acquireFileInfo(path);
+        try {
+            fileInfo->open(true);
+            fileInfo->parseEverything(diag);
+            result = CachedParseResult::fromFileInfo(*fileInfo);
+        } catch (...) {
+            releaseFileInfo(std::move(fileInfo));
+            throw;
+        }
+        releaseFileInfo(std::move(fileInfo));
+        m_cache.store(path, identity, *result);
+    }
+
+    auto response = argsToString("ok\ncached\t", cacheHit ? 1 : 0, "\ncontainer\t", containerFormatName(result->containerFormat), "\nmimetype\t",
+        escape(result->mimeType), "\nduration\t", result->duration.totalSeconds(), '\n');
+    for (const auto &track : result->tracks) {
+        response += argsToString("track\t", track.id, '\t', mediaTypeName(track.mediaType), '\t', track.format.name(), '\t', escape(track.name),
+            '\t', track.duration.totalSeconds(), '\t', track.bitrate, '\t', track.samplingFrequency, '\t', track.channelCount, '\t',
+            track.pixelSize.width(), 'x', track.pixelSize.height(), '\n');
+    }
+    for (const auto &tag : result->tags) {
+        for (const auto &field : tag.fields) {
+            response += argsToString("tag\t", tagTypeName(tag.type), '\t', fieldName(field.field), '\t', escape(field.value), '\n');
+        }
+    }
+    for (const auto &chapter : result->chapters) {
+        response += argsToString("chapter\t", chapter.depth, '\t', chapter.startTime.totalSeconds(), '\t', chapter.endTime.totalSeconds(), '\t',
+            escape(chapter.names.empty() ? std::string() : chapter.names.front()), '\n');
+    }
+    for (const auto &attachment : result->attachments) {
+        response += argsToString("attachment\t", attachment.id, '\t', escape(attachment.name), '\t', escape(attachment.mimeType), '\t',
+            attachment.dataSize, '\n');
+    }
+    return response;
+}
+
+std::string Service::edit(const std::vector<std::string> &args)
+{
+    if (args.size() < 3) {
+        throw std::invalid_argument("no fields specified");
+    }
+    auto values = std::vector<std::pair<KnownField, std::string_view>>();
+    for (auto arg = args.cbegin() + 2; arg != args.cend(); ++arg) {
+        const auto separator = arg->find('=');
+        const auto field = separator == std::string::npos ? KnownField::Invalid : fieldFromName(std::string_view(*arg).substr(0, separator));
+        if (field == KnownField::Invalid) {
+            throw std::invalid_argument("invalid field specification \"" % *arg + '"');
+        }
+        values.emplace_back(field, std::string_view(*arg).substr(separator + 1));
+    }
+
+    auto diag = Diagnostics();
+    auto progress = AbortableProgressFeedback(AbortableProgressFeedback::Callback{});
+    auto fileInfo = acquireFileInfo(args[1]);
+    try {
+        fileInfo->open(false);
+        fileInfo->parseEverything(diag);
+        fileInfo->createAppropriateTags();
+        for (auto *const tag : fileInfo->tags()) {
+            for (const auto &[field, value] : values) {
+                tag->setValue(field, value.empty() ? TagValue() : TagValue(value.data(), value.size(), TagTextEncoding::Utf8));
+            }
+        }
+        fileInfo->applyChanges(diag, progress);
+    } catch (...) {
+        releaseFileInfo(std::move(fileInfo));
+        throw;
+    }
+    releaseFileInfo(std::move(fileInfo));
+    ++m_edits;
+
+    auto response = std::string("ok\n");
+    for (const auto &message : diag) {
+        if (message.level() >= DiagLevel::Warning) {
+            response += argsToString("diag\t", message.levelName(), '\t', escape(message.message()), '\n');
+        }
+    }
+    return response;
+}
+
+std::string Service::scan(const std::vector<std::string> &args)
+{
+    auto paths = std::vector<std::string>();
+    auto identities = std::vector<FileIdentity>();
+    for (auto arg = args.cbegin() + 1; arg != args.cend(); ++arg) {
+        try {
+            auto identity = m_cache.identify(*arg);
+            if (!m_cache.find(*arg, identity)) {
+                paths.emplace_back(*arg);
+                identities.emplace_back(identity);
+            }
+        } catch (const std::ios_base::failure &) {
+            // report the file as failed below
+            paths.emplace_back(*arg);
+            identities.emplace_back();
+        }
+    }
+    auto failed = std::string();
+    // the batch parser can only run one batch at a time
+    const auto guard = lock_guard<mutex>(m_parserMutex);
+    m_parser.parse(paths, [&](BatchParserResult &result) {
+        if (result.exception) {
+            failed += argsToString("failed\t", escape(result.path), '\n');
+        } else {
+            m_cache.store(result.path, identities[result.index], CachedParseResult::fromFileInfo(*result.fileInfo));
+        }
+    });
+    return argsToString("ok\nskipped\t", args.size() - 1 - paths.size(), "\nparsed\t", paths.size(), '\n', failed);
+}
+
+std::string Service::watch(const std::string &directory)
+{
+    auto diag = Diagnostics();
+    const auto guard = lock_guard<mutex>(m_watcherMutex);
+    if (!m_watcher.watch(directory, diag)) {
+        return argsToString("error\t", escape(diag.empty() ? "unable to watch directory" : diag.back().message()), '\n');
+    }
+    return argsToString("ok\nwatches\t", m_watcher.watchCount(), '\n');
+}
+
+std::string Service::stats() const
+{
+    const auto uptime = chrono::duration_cast<chrono::seconds>(chrono::steady_clock::now() - m_startTime).count();
+    auto pooledFileInfos = std::size_t();
+    {
+        const auto guard = lock_guard<mutex>(m_poolMutex);
+        pooledFileInfos = m_pool.size();
+    }
+    return argsToString("ok\nuptime\t", uptime, "\nrequests\t", m_requests.load(), "\ncacheHits\t", m_cacheHits.load(), "\ncacheMisses\t",
+        m_cacheMisses.load(), "\nedits\t", m_edits.load(), "\nerrors\t", m_errors.load(), "\nrefreshedFiles\t", m_refreshedFiles.load(),
+        "\ncachedEntries\t", m_cache.size(), "\npooledFileInfos\t", pooledFileInfos, '\n');
+}
+
+std::string Service::save()
+{
+    if (m_options.cachePath.empty()) {
+        throw std::invalid_argument("no cache file specified");
+    }
+    m_cache.save(m_options.cachePath);
+    return "ok\n";
+}
+
+std::string Service::handleRequest(const std::vector<std::string> &args)
+{
+    ++m_requests;
+    const auto &command = args.front();
+    try {
+        if (command == "parse" && args.size() == 2) {
+            return parse(args[1]);
+        } else if (command == "edit" && args.size() >= 2) {
+            return edit(args);
+        } else if (command == "scan") {
+            return scan(args);
+        } else if (command == "watch" && args.size() == 2) {
+            return watch(args[1]);
+        } else if (command == "stats") {
+            return stats();
+        } else if (command == "save") {
+            return save();
+        } else if (command == "shutdown") {
+            stop();
+            return "ok\n";
+        }
+        ++m_errors;
+        return argsToString("error\tinvalid request \"", escape(command), "\"\n");
+    } catch (const std::exception &error) {
+        ++m_errors;
+        return argsToString("error\t", escape(error.what()), '\n');
+    } catch (...) {
+        ++m_errors;
+        return "error\tunable to parse or apply changes\n";
+    }
+}
+
+void Service::serveConnection(int connection)
+{
+    auto buffer = std::string();
+    char chunk[0x1000];
+    for (;;) {
+        const auto bytesRead = ::read(connection, chunk, sizeof(chunk));
+        if (bytesRead < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytesRead <= 0) {
+            break;
+        }
+        buffer.append(chunk, static_cast<std::size_t>(bytesRead));
+        for (auto lineEnd = buffer.find('\n'); lineEnd != std::string::npos; lineEnd = buffer.find('\n')) {
+            auto response = handleRequest(splitRequest(std::string_view(buffer).substr(0, lineEnd)));
+            buffer.erase(0, lineEnd + 1);
+            response += ".\n";
+            for (auto *data = response.data(), *end = data + response.size(); data != end;) {
+                const auto bytesWritten = ::write(connection, data, static_cast<std::size_t>(end - data));
+                if (bytesWritten < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (bytesWritten <= 0) {
+                    return;
+                }
+                data += bytesWritten;
+            }
+        }
+    }
+}
+
+/*!
+ * \brief Refreshes the cache when watched files change until the service is stopped.
+ */
+void Service::watchLibrary()
+{
+    while (!m_stopping.load()) {
+        auto changes = LibraryChanges();
+        {
+            const auto guard = lock_guard<mutex>(m_watcherMutex);
+            changes = m_watcher.readChanges();
+        }
+        if (changes.isEmpty()) {
+            this_thread::sleep_for(chrono::milliseconds(200));
+            continue;
+        }
+        if (changes.overflowed) {
+            cerr << "Events have been lost; the cache might contain outdated entries until the files are scanned again.\n";
+        }
+        const auto guard = lock_guard<mutex>(m_parserMutex);
+        m_refreshedFiles += m_watcher.refresh(changes, m_parser);
+    }
+}
+
+void Service::stop()
+{
+    m_stopping.store(true);
+    handleStopSignal(0);
+}
+
+int Service::run()
+{
+    // load the cache
+    if (!m_options.cachePath.empty()) {
+        auto diag = Diagnostics();
+        m_cache.load(m_options.cachePath, diag);
+        for (const auto &message : diag) {
+            cerr << message.message() << '\n';
+        }
+    }
+    for (const auto &directory : m_options.watchedDirectories) {
+        if (const auto response = watch(directory); response.compare(0, 2, "ok")) {
+            cerr << "Unable to watch \"" << directory << "\": " << response.substr(6);
+        }
+    }
+
+    // listen on the socket
+    auto address = sockaddr_un();
+    address.sun_family = AF_UNIX;
+    if (m_options.socketPath.size() >= sizeof(address.sun_path)) {
+        throw runtime_error("socket path is too long");
+    }
+    std::strcpy(address.sun_path, m_options.socketPath.data());
+    const auto listenSocket = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    ::unlink(m_options.socketPath.data());
+    if (listenSocket < 0 || ::bind(listenSocket, reinterpret_cast<const sockaddr *>(&address), sizeof(address))
+        || ::listen(listenSocket, SOMAXCONN)) {
+        throw runtime_error(argsToString("unable to listen on \"", m_options.socketPath, "\": ", std::strerror(errno)));
+    }
+    int pipeFileDescriptors[2];
+    if (::pipe(pipeFileDescriptors)) {
+        throw runtime_error(argsToString("unable to create pipe: ", std::strerror(errno)));
+    }
+    stopPipe = pipeFileDescriptors[1];
+    ::signal(SIGINT, handleStopSignal);
+    ::signal(SIGTERM, handleStopSignal);
+    ::signal(SIGPIPE, SIG_IGN);
+    cerr << "Listening on \"" << m_options.socketPath << "\"\n";
+
+    // accept connections until stopped
+    auto watcherThread = thread(&Service::watchLibrary, this);
+    auto connectionThreads = std::vector<thread>();
+    pollfd pollInfo[2] = { { listenSocket, POLLIN, 0 }, { pipeFileDescriptors[0], POLLIN, 0 } };
+    while (!m_stopping.load()) {
+        if (::poll(pollInfo, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (pollInfo[1].revents) {
+            break;
+        }
+        const auto connection = ::accept4(listenSocket, nullptr, nullptr, SOCK_CLOEXEC);
+        if (connection < 0) {
+            continue;
+        }
+        {
+            const auto guard = lock_guard<mutex>(m_connectionsMutex);
+            m_connections.emplace(connection);
+        }
+        connectionThreads.emplace_back([this, connection] {
+            serveConnection(connection);
+            const auto guard = lock_guard<mutex>(m_connectionsMutex);
+            m_connections.erase(connection);
+            ::close(connection);
+        });
+    }
+
+    // stop serving connections and save the cache
+    m_stopping.store(true);
+    ::close(listenSocket);
+    ::unlink(m_options.socketPath.data());
+    {
+        const auto guard = lock_guard<mutex>(m_connectionsMutex);
+        for (const auto connection : m_connections) {
+            ::shutdown(connection, SHUT_RDWR);
+        }
+    }
+    for (auto &connectionThread : connectionThreads) {
+        connectionThread.join();
+    }
+    watcherThread.join();
+    if (!m_options.cachePath.empty()) {
+        m_cache.save(m_options.cachePath);
+    }
+    return 0;
+}
+
+void printUsage(const char *executable)
+{
+    cerr << "Usage: " << executable << " <socket path> [--cache <cache file>] [--watch <directory>]... [--threads <count>]\n"
+         << "Serves parse and edit requests via the specified Unix domain socket (see the documentation of service.cpp).\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    auto options = ServiceOptions();
+    for (auto i = 1; i < argc; ++i) {
+        const auto arg = string_view(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg == "--cache" && i + 1 < argc) {
+            options.cachePath = argv[++i];
+        } else if (arg == "--watch" && i + 1 < argc) {
+            options.watchedDirectories.emplace_back(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.parallelism = static_cast<unsigned int>(std::stoul(argv[++i]));
+        } else if (options.socketPath.empty() && !arg.empty() && arg.front() != '-') {
+            options.socketPath = arg;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.socketPath.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    try {
+        return Service(options).run();
+    } catch (const std::exception &error) {
+        cerr << "Unable to run service: " << error.what() << '\n';
+        return 2;
+    }
+}
@@ -38,9 +38,86 @@ enum class TagCreationFlags : std::uint64_t {
     = 1 << 4, /**< keep version of existing ID3v2 tags so TagSettings::id3v2version is only used when creating a *new* ID3v2 tag */
 };
 
+/*!
+ * \brief The ParsingFlags enum contains options to control which parts of a file are parsed by MediaFileInfo.
+ * \sa MediaFileInfo::setParsingFlags()
+ */
+enum class ParsingFlags : std::uint64_t {
+    None = 0, /**< no flags present; everything is parsed */
+    SkipTracks = 1 << 0, /**< MediaFileInfo::parseTracks() does nothing (except for FLAC files where tags are stored within the track) */
+    SkipTags = 1 << 1, /**< MediaFileInfo::parseTags() does nothing */
+    SkipChapters = 1 << 2, /**< MediaFileInfo::parseChapters() does nothing */
+    SkipAttachments = 1 << 3, /**< MediaFileInfo::parseAttachments() does nothing */
+    SkipTrackStatistics = 1 << 4, /**< track statistics (e.g. from Matroska "statistics tags") are not determined */
+    ShareTagValueData = 1 << 5, /**< big ID3v2 and Vorbis comment values (e.g. cover art and lyrics) refer to the shared parse buffer instead of owning a copy (see TagValue::assignSharedData()); useful when only reading tags */
+    LazyLoadPictures = 1 << 6, /**< cover art of ID3v2 tags, MP4 tags and FLAC "METADATA_BLOCK_PICTURE"s is only read when accessed (see TagValue::assignLazyData()); the file must not be closed before accessing it; compressed ID3v2 pictures are kept compressed in memory and only inflated when accessed; covers of OGG streams are kept Base64-encoded in memory and only decoded when accessed */
+    LazyDecodeParameterSets = 1 << 7, /**< the SPS/PPS of AVC configurations are only kept as raw NAL units so the pixel size, cropping, chroma format and pixel aspect ratio of AVC tracks are only determined when calling Mp4Track::decodeParameterSets() or MatroskaTrack::decodeParameterSets() (profile and level are determined from the AVC configuration itself); useful when only reading tags */
+    BufferMp4MovieAtom = 1 << 8, /**< the "moov"-atom of MP4 files is read at once and the track information is parsed from memory (see Mp4Container::maxBufferedMovieAtomSize); useful when reading from storage with high latency */
+    VerifyCrc32Checksums = 1 << 9, /**< the checksums of "CRC-32"-elements of the level 1 elements of Matroska files (except "Cluster"-elements) are verified when parsing the header; mismatches are reported as warnings (see EbmlElement::verifyCrc32()) */
+    ParallelMp4TrackParsing = 1 << 10, /**< the sample information (e.g. sizes and bitrates) of the tracks of MP4 files is determined concurrently (see Mp4Container::parseTracksConcurrently()); useful for files with many tracks */
+    LazyMp4Fragments = 1 << 11, /**< the movie fragments of MP4 files are not read when parsing the tracks if the file contains a "mfra"-atom; the fragments are located via that index (see Mp4Container::parseFragmentIndex()) and read on demand via Mp4Track::readFragment() so the size and sample count of the tracks only cover the samples denoted by the "moov"-atom; useful for long fragmented recordings */
+    QuickProbe = SkipChapters | SkipAttachments
+        | SkipTrackStatistics, /**< only container format, tracks and tags are parsed (useful to obtain the duration and main tag fields) */
+    ReadTagsOnly = SkipTracks | SkipChapters | SkipAttachments | SkipTrackStatistics | ShareTagValueData
+        | LazyLoadPictures, /**< only container format and tags are parsed and tag values are not copied while parsing (useful with MediaFileInfo::parseTagFields()) */
+};
+
+/*!
+ * \brief The ParseLimits struct specifies limits to reject files which would make parsing excessively slow or expensive.
+ *
+ * The limits are checked before the corresponding structures are built so corrupt or malicious files (e.g. files with a
+ * fake entry count) are rejected early. Exceeding a limit is reported via a critical message and makes the phase fail
+ * (with ParsingStatus::CriticalFailure) as well as applying changes. A value of zero means unlimited (the default).
+ *
+ * \sa MediaFileInfo::setParseLimits()
+ */
+struct TAG_PARSER_EXPORT ParseLimits {
+    /// \brief The max. number of elements (MP4 atoms, MPEG-4 descriptors and EBML elements) parsed per file.
+    std::uint64_t maxElements = 0;
+    /// \brief The max. number of entries of a table (MP4 sample tables, the OGG page table and Matroska cue points).
+    std::uint64_t maxTableEntries = 0;
+    /// \brief The max. size of a single tag in bytes (ID3v2 tags, MP4 "meta" atoms and Matroska "Tag" elements).
+    std::uint64_t maxTagSize = 0;
+    /// \brief The max. size of a single attachment in bytes (Matroska "AttachedFile" elements).
+    std::uint64_t maxAttachmentSize = 0;
+};
+
+/*!
+ * \brief The BackupStrategy enum specifies how the original file is preserved while applying changes.
+ * \sa MediaFileInfo::setBackupStrategy()
+ */
+enum class BackupStrategy {
+    Rename, /**< the original file is renamed to the backup file when rewriting; it is copied if renaming is not possible */
+    Clone, /**< the original file is cloned (reflinked) to the backup file when rewriting so the original inode is kept; falls back to Rename; when applying changes in-place the file is cloned to a backup file first if the file system supports it ("clone-then-patch", see BackupHelper::createCloneBackupFile()) */
+    Journal, /**< like Rename but when applying changes in-place the bytes to be overwritten are saved to a journal file first */
+    TemporaryFile, /**< the new file is written into an anonymous file (O_TMPFILE) next to the original file which replaces the original file atomically when done; no backup file is created and nothing needs to be cleaned up after a crash (see BackupHelper::TemporaryFile); falls back to Rename on platforms and file systems not supporting it */
+};
+
+/*!
+ * \brief The DurabilityPolicy enum specifies how the written data is synced to the disk after applying changes.
+ * \sa MediaFileInfo::setDurabilityPolicy()
+ */
+enum class DurabilityPolicy {
+    Default, /**< like DataSync when applying changes in-place is enforced (see MediaFileInfo::setForceInPlace()); otherwise like None */
+    None, /**< nothing is synced; the kernel writes the data back eventually */
+    WrittenRanges, /**< the dirty pages (so only the ranges which have been written) are written back via sync_file_range() without syncing metadata or flushing the disk cache; cheap when applying changes in-place but no guarantee on power loss (falls back to DataSync on platforms other than Linux) */
+    DataSync, /**< the file is synced via fdatasync() (so metadata is only synced as far as required to read the data back) */
+    FullSync, /**< the file is synced via fsync(); when rewriting the file, the directories are synced as well after renaming the original file to the backup file and after writing the new file */
+};
+
+/*!
+ * \brief The MatroskaParseStrategy enum specifies how the top-level elements of a Matroska segment are located.
+ * \sa MediaFileInfo::setMatroskaParseStrategy()
+ */
+enum class MatroskaParseStrategy {
+    Sequential, /**< the segment is walked through; clusters are skipped on files bigger than MediaFileInfo::matroskaMaxFullParseSize() (the default) */
+    SeekHeadFirst, /**< elements denoted by "SeekHead" elements are used first, the end of the segment is probed for "Tags" if not found and clusters are only scanned as last resort (see MediaFileInfo::matroskaClusterScanBudget()) */
+};
+
 } // namespace TagParser
 
 CPP_UTILITIES_MARK_FLAG_ENUM_CLASS(TagParser, TagParser::TagCreationFlags);
+CPP_UTILITIES_MARK_FLAG_ENUM_CLASS(TagParser, TagParser::ParsingFlags);
 
 namespace TagParser {
 
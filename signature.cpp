@@ -1,9 +1,12 @@
 #include "./signature.h"
 #include "./matroska/matroskatagid.h"
+#include "./mpegaudio/mpegaudioframe.h"
 
 #include <c++utilities/conversion/binaryconversion.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 
 using namespace CppUtilities;
 
@@ -242,6 +245,165 @@ ContainerFormat parseSignature(const char *buffer, int bufferSize)
     return ContainerFormat::Unknown;
 }
 
+/// \cond
+namespace {
+
+/*!
+ * \brief Returns whether the signature of the specified \a format consists of only 16 bit (or less) and is therefore
+ *        likely to occur by chance.
+ */
+constexpr bool hasShortSignature(ContainerFormat format)
+{
+    switch (format) {
+    case ContainerFormat::Ac3Frames:
+    case ContainerFormat::Adts:
+    case ContainerFormat::Jpeg:
+    case ContainerFormat::Lha:
+    case ContainerFormat::Lzw:
+    case ContainerFormat::MpegAudioFrames:
+    case ContainerFormat::PortableExecutable:
+    case ContainerFormat::Utf16Text:
+    case ContainerFormat::WindowsBitmap:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*!
+ * \brief Returns the size of the MPEG audio or ADTS frame with the sync word at \a data or zero if the header is invalid.
+ * \remarks The \a format is set to ContainerFormat::Adts or ContainerFormat::MpegAudioFrames; \a size must be at least 6.
+ */
+std::uint32_t syncFrameSize(const char *data, ContainerFormat &format)
+{
+    const auto *const bytes = reinterpret_cast<const unsigned char *>(data);
+    if ((bytes[1] & AdtsMask) == (Adts & 0xFFu)) {
+        // ADTS (the layer is always zero): the frame length is stored within the header (13 bit)
+        format = ContainerFormat::Adts;
+        const auto frameLength = ((bytes[3] & 0x3u) << 11) | (static_cast<std::uint32_t>(bytes[4]) << 3) | (bytes[5] >> 5);
+        return ((bytes[2] >> 2) & 0xFu) < 13 && frameLength >= 7 ? frameLength : 0;
+    }
+    format = ContainerFormat::MpegAudioFrames;
+    return MpegAudioFrame(BE::toUInt32(data)).size();
+}
+
+/*!
+ * \brief Returns the confidence for the sync word at \a offset which is high if another frame of the same kind follows
+ *        at the position denoted by the header.
+ * \remarks The \a format is set to the format of the frame or to ContainerFormat::Unknown if the header is invalid.
+ */
+SignatureConfidence rateSyncWord(const char *buffer, std::size_t bufferSize, std::size_t offset, ContainerFormat &format)
+{
+    format = ContainerFormat::Unknown;
+    if (bufferSize - offset < 6) {
+        return SignatureConfidence::Low;
+    }
+    auto frameFormat = ContainerFormat::Unknown, nextFrameFormat = ContainerFormat::Unknown;
+    const auto frameSize = syncFrameSize(buffer + offset, frameFormat);
+    if (!frameSize) {
+        return SignatureConfidence::Low;
+    }
+    format = frameFormat;
+    const auto nextOffset = offset + frameSize;
+    if (nextOffset + 6 > bufferSize) {
+        return SignatureConfidence::Low;
+    }
+    const auto *const next = reinterpret_cast<const unsigned char *>(buffer + nextOffset);
+    return next[0] == 0xFF && next[1] >= 0xE0 && syncFrameSize(buffer + nextOffset, nextFrameFormat) && nextFrameFormat == frameFormat
+        ? SignatureConfidence::High
+        : SignatureConfidence::Low;
+}
+
+} // namespace
+/// \endcond
+
+/*!
+ * \brief Probes the specified \a buffer for all known signatures.
+ * \param buffer Specifies the buffer to probe, usually the head of a file (e.g. the first 4 KiB).
+ * \param bufferSize Specifies the size of \a buffer.
+ * \return Returns the candidates ordered by their confidence (descending) and offset (ascending). Hence the first
+ *          candidate denotes the most likely container format. The list is empty if no signature has been found.
+ *
+ * In contrast to parseSignature() ID3v2 tags and zero bytes in front of the container are skipped like
+ * MediaFileInfo::parseContainerFormat() does (each ID3v2 tag is reported as candidate, too). If an ID3v2 tag exceeds
+ * the \a buffer only the tags are reported. Additionally, the first sync word of MPEG audio and ADTS frames is searched
+ * (using SSE2/NEON if available, see MpegAudioFrame::findSyncWord()) and rated higher if another frame follows at the
+ * position denoted by the header. Signatures of at least 24 bit found within the data after the container offset
+ * are reported with a low confidence (once per format).
+ */
+std::vector<SignatureCandidate> probeSignatures(const char *buffer, std::size_t bufferSize)
+{
+    auto candidates = std::vector<SignatureCandidate>();
+    const auto signatureAt = [&](std::size_t offset) {
+        return parseSignature(buffer + offset, static_cast<int>(std::min<std::size_t>(bufferSize - offset, 16)));
+    };
+    const auto addCandidate = [&](ContainerFormat format, std::size_t offset, SignatureConfidence confidence) {
+        if (std::none_of(candidates.cbegin(), candidates.cend(), [format](const SignatureCandidate &c) { return c.format == format; })) {
+            candidates.emplace_back(SignatureCandidate{ format, offset, confidence });
+        }
+    };
+
+    // skip ID3v2 tags and zero bytes in front of the container
+    auto offset = std::size_t();
+    for (;;) {
+        auto end = offset;
+        for (; end < bufferSize && !buffer[end]; ++end)
+            ;
+        if (end - offset >= 4) {
+            offset = end;
+        }
+        if (bufferSize - offset < 10 || signatureAt(offset) != ContainerFormat::Id2v2Tag) {
+            break;
+        }
+        candidates.emplace_back(SignatureCandidate{ ContainerFormat::Id2v2Tag, offset, SignatureConfidence::High });
+        offset += toNormalInt(BE::toUInt32(buffer + offset + 6)) + ((buffer[offset + 5] & 0x10) ? 20u : 10u);
+        if (offset >= bufferSize) {
+            return candidates;
+        }
+    }
+
+    // check the signature at the container offset
+    auto syncFormat = ContainerFormat::Unknown;
+    const auto format = offset < bufferSize ? signatureAt(offset) : ContainerFormat::Unknown;
+    if (format == ContainerFormat::Adts || format == ContainerFormat::MpegAudioFrames) {
+        const auto confidence = rateSyncWord(buffer, bufferSize, offset, syncFormat);
+        if (syncFormat == format) {
+            addCandidate(format, offset, confidence == SignatureConfidence::High ? SignatureConfidence::High : SignatureConfidence::Medium);
+        }
+    } else if (format != ContainerFormat::Unknown) {
+        addCandidate(format, offset, hasShortSignature(format) ? SignatureConfidence::Medium : SignatureConfidence::High);
+    }
+    if (bufferSize >= 0x107 && !std::memcmp(buffer + 0x101, "ustar", 6)) { // magic number including the terminating zero
+        addCandidate(ContainerFormat::Tar, 0, SignatureConfidence::High);
+    }
+
+    // search for the first sync words of MPEG audio and ADTS frames after the container offset
+    auto mpegAudioFound = false, adtsFound = false;
+    for (auto i = offset + 1; i < bufferSize && !(mpegAudioFound && adtsFound); ++i) {
+        i += MpegAudioFrame::findSyncWord(buffer + i, bufferSize - i);
+        if (i >= bufferSize) {
+            break;
+        }
+        const auto confidence = rateSyncWord(buffer, bufferSize, i, syncFormat);
+        if ((syncFormat == ContainerFormat::Adts && !adtsFound) || (syncFormat == ContainerFormat::MpegAudioFrames && !mpegAudioFound)) {
+            (syncFormat == ContainerFormat::Adts ? adtsFound : mpegAudioFound) = true;
+            addCandidate(syncFormat, i, confidence == SignatureConfidence::High ? SignatureConfidence::Medium : SignatureConfidence::Low);
+        }
+    }
+
+    // search for further (long) signatures after the container offset
+    for (auto i = offset + 1; i + 16 <= bufferSize; ++i) {
+        if (const auto furtherFormat = signatureAt(i); furtherFormat != ContainerFormat::Unknown && !hasShortSignature(furtherFormat)) {
+            addCandidate(furtherFormat, i, SignatureConfidence::Low);
+        }
+    }
+
+    std::stable_sort(candidates.begin(), candidates.end(), [](const SignatureCandidate &lhs, const SignatureCandidate &rhs) {
+        return lhs.confidence != rhs.confidence ? lhs.confidence > rhs.confidence : lhs.offset < rhs.offset;
+    });
+    return candidates;
+}
+
 /*!
  * \brief Returns the abbreviation of the container format as C-style string considering
  *        the specified media type and version.
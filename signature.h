@@ -3,7 +3,9 @@
 
 #include "./mediaformat.h"
 
+#include <cstddef>
 #include <cstdint>
+#include <vector>
 
 namespace TagParser {
 
@@ -66,7 +68,29 @@ enum class ContainerFormat : unsigned int {
     Zip, /**< ZIP archive */
 };
 
+/*!
+ * \brief Specifies how likely a SignatureCandidate denotes the actual container format.
+ */
+enum class SignatureConfidence : std::uint8_t {
+    Low, /**< a signature found within the data after the container offset or a sync word without following frame */
+    Medium, /**< a short (16-bit) signature or a sync word at the container offset or a confirmed sync word after it */
+    High, /**< a signature of at least 24 bit or a confirmed sync word at the container offset */
+};
+
+/*!
+ * \brief The SignatureCandidate struct holds a container format found by probeSignatures().
+ */
+struct TAG_PARSER_EXPORT SignatureCandidate {
+    /// \brief The container format denoted by the signature.
+    ContainerFormat format = ContainerFormat::Unknown;
+    /// \brief The offset of the signature within the probed buffer.
+    std::size_t offset = 0;
+    /// \brief How likely the signature denotes the actual container format.
+    SignatureConfidence confidence = SignatureConfidence::Low;
+};
+
 TAG_PARSER_EXPORT ContainerFormat parseSignature(const char *buffer, int bufferSize);
+TAG_PARSER_EXPORT std::vector<SignatureCandidate> probeSignatures(const char *buffer, std::size_t bufferSize);
 TAG_PARSER_EXPORT const char *containerFormatName(ContainerFormat containerFormat);
 TAG_PARSER_EXPORT const char *containerFormatAbbreviation(
     ContainerFormat containerFormat, MediaType mediaType = MediaType::Unknown, unsigned int version = 0);
@@ -0,0 +1,82 @@
+#include "./stringpool.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace TagParser {
+
+/*!
+ * \class TagParser::StringPool
+ * \brief The StringPool class stores each distinct string only once ("string interning").
+ *
+ * This is useful for strings which occur over and over again when processing many files, e.g. the names of Vorbis
+ * comment fields and Matroska "SimpleTag"s such as "TITLE" and "ARTIST". Strings returned by intern() stay valid until
+ * the pool is cleared or destroyed and equal strings interned via the same pool always have the same address. So such
+ * strings can be compared by just comparing their data() pointers and grouped by hashing the pointer.
+ *
+ * The strings are stored in an ElementArena so adding strings does not lead to one allocation per string. A pool can be
+ * used per batch of files or the process-wide pool returned by global() can be used.
+ *
+ * \remarks All functions are thread-safe.
+ * \sa TagFieldList::fromTags()
+ */
+
+/*!
+ * \brief Returns the interned copy of the specified \a str; it is added to the pool if not present yet.
+ * \remarks Returns an empty string view (with data() being nullptr) if \a str is empty.
+ */
+std::string_view StringPool::intern(std::string_view str)
+{
+    if (str.empty()) {
+        return std::string_view();
+    }
+    const auto guard = lock_guard<mutex>(m_mutex);
+    if (const auto i = m_strings.find(str); i != m_strings.end()) {
+        return *i;
+    }
+    auto *const data = static_cast<char *>(m_arena.allocate(str.size()));
+    copy(str.begin(), str.end(), data);
+    return *m_strings.emplace(data, str.size()).first;
+}
+
+/*!
+ * \brief Returns the number of distinct strings within the pool.
+ */
+std::size_t StringPool::size() const
+{
+    const auto guard = lock_guard<mutex>(m_mutex);
+    return m_strings.size();
+}
+
+/*!
+ * \brief Returns the number of bytes used to store the strings of the pool.
+ */
+std::size_t StringPool::allocatedBytes() const
+{
+    const auto guard = lock_guard<mutex>(m_mutex);
+    return m_arena.allocatedBytes();
+}
+
+/*!
+ * \brief Removes all strings from the pool.
+ * \remarks Invalidates all strings returned by intern() so far.
+ */
+void StringPool::clear()
+{
+    const auto guard = lock_guard<mutex>(m_mutex);
+    m_strings.clear();
+    m_arena.clear();
+}
+
+/*!
+ * \brief Returns the process-wide pool.
+ * \remarks Strings added to this pool are only released when the process exits.
+ */
+StringPool &StringPool::global()
+{
+    static auto pool = StringPool();
+    return pool;
+}
+
+} // namespace TagParser
@@ -0,0 +1,41 @@
+#ifndef TAG_PARSER_STRINGPOOL_H
+#define TAG_PARSER_STRINGPOOL_H
+
+#include "./elementarena.h"
+
+#include <cstddef>
+#include <mutex>
+#include <string_view>
+#include <unordered_set>
+
+namespace TagParser {
+
+class TAG_PARSER_EXPORT StringPool {
+public:
+    StringPool();
+    StringPool(const StringPool &) = delete;
+    StringPool &operator=(const StringPool &) = delete;
+
+    std::string_view intern(std::string_view str);
+    std::size_t size() const;
+    std::size_t allocatedBytes() const;
+    void clear();
+
+    static StringPool &global();
+
+private:
+    std::unordered_set<std::string_view> m_strings;
+    ElementArena m_arena;
+    mutable std::mutex m_mutex;
+};
+
+/*!
+ * \brief Constructs an empty pool.
+ */
+inline StringPool::StringPool()
+{
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_STRINGPOOL_H
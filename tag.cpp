@@ -1,9 +1,12 @@
 #include "./tag.h"
+#include "./tagtemplate.h"
 
 using namespace std;
 
 namespace TagParser {
 
+std::atomic<std::uint64_t> Tag::m_targetRevision(0);
+
 /*!
  * \class TagParser::Tag
  * \brief The Tag class is used to store, read and write tag information.
@@ -20,6 +23,7 @@ namespace TagParser {
  */
 Tag::Tag()
     : m_size(0)
+    , m_modified(true)
 {
 }
 
@@ -99,6 +103,98 @@ unsigned int Tag::insertValues(const Tag &from, bool overwrite)
     return count;
 }
 
+/*!
+ * \brief Moves all compatible values \a from another Tag into this tag.
+ *
+ * Works like the overload taking a const reference but the values are moved out of \a from (which is left with
+ * empty values for the inserted fields). This avoids copying big values like cover art, e.g. when converting an
+ * ID3v1 tag into an ID3v2 tag which is going to be removed anyways. The values are assigned via assignValues(), so
+ * the text encoding is converted if required and calling ensureTextValuesAreProperlyEncoded() is not necessary.
+ *
+ * \return Returns the number of values that have been inserted.
+ * \throws Throws CppUtilities::ConversionException if a text value can not be converted.
+ */
+unsigned int Tag::insertValues(Tag &&from, bool overwrite)
+{
+    if (&from == this) {
+        return 0;
+    }
+    auto values = std::vector<std::pair<KnownField, TagValue>>();
+    for (int i = static_cast<int>(KnownField::Invalid) + 1, last = static_cast<int>(KnownField::Description); i <= last; ++i) {
+        const auto field = static_cast<KnownField>(i);
+        if (!overwrite && !value(field).isEmpty()) {
+            continue;
+        }
+        // taking the value also empties fields of \a from which share the ID (e.g. KnownField::Year and KnownField::RecordDate)
+        if (auto otherValue = from.takeValue(field); !otherValue.isEmpty()) {
+            values.emplace_back(field, std::move(otherValue));
+        }
+    }
+    return values.empty() ? 0 : assignValues(std::move(values));
+}
+
+/*!
+ * \brief Moves the value of the specified \a field out of the tag leaving an empty value behind.
+ * \remarks The tag is marked as modified if the value is not empty.
+ */
+TagValue Tag::takeValue(KnownField field)
+{
+    // value() returns either a reference to a value stored by this tag or TagValue::empty()
+    const auto &value = this->value(field);
+    if (value.isEmpty()) {
+        return TagValue();
+    }
+    m_modified = true;
+    return std::exchange(const_cast<TagValue &>(value), TagValue());
+}
+
+/*!
+ * \brief Assigns the specified \a values to the corresponding fields at once.
+ *
+ * This is equivalent to calling setValue() for each of the specified field/value pairs (in the specified order).
+ * However, the text encoding of all values is validated and converted (like TagValue::convertDataEncodingForTag()
+ * does) before any value is assigned. So calling ensureTextValuesAreProperlyEncoded() afterwards is not required.
+ *
+ * \returns Returns the number of values which could be assigned.
+ * \throws Throws CppUtilities::ConversionException if a text value can not be converted. No values are assigned in
+ *         this case.
+ * \remarks The default implementation just invokes setValue(). Subclasses (e.g. FieldMapBasedTag) override this to
+ *          move the values in and to avoid repeated allocations.
+ */
+unsigned int Tag::assignValues(std::vector<std::pair<KnownField, TagValue>> &&values)
+{
+    convertValuesForTag(values);
+    unsigned int count = 0;
+    for (const auto &[field, value] : values) {
+        if (setValue(field, value)) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+/*!
+ * \brief Assigns the specified \a tagTemplate whose fields are merged into the tag when making it.
+ *
+ * This allows serialising fields which are written into the tags of many files only once. Fields of the tag which are
+ * also present in the template are not written. Pass nullptr to remove the template.
+ *
+ * \returns Returns whether the template could be assigned; this is only supported by the tag types mentioned in
+ *          TagTemplate::isTagTypeSupported().
+ * \sa TagTemplate
+ */
+bool Tag::setTagTemplate(const std::shared_ptr<const TagTemplate> &tagTemplate)
+{
+    if (tagTemplate && !TagTemplate::isTagTypeSupported(type())) {
+        return false;
+    }
+    if (m_template != tagTemplate) {
+        m_template = tagTemplate;
+        m_modified = true;
+    }
+    return true;
+}
+
 /*!
  * \fn Tag::type()
  * \brief Returns the type of the tag as TagParser::TagType.
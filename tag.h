@@ -6,12 +6,19 @@
 
 #include <c++utilities/io/binaryreader.h>
 
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace TagParser {
 
+class TagTemplate;
+
 /*!
  * \brief Specifies the tag type.
  *
@@ -24,7 +31,8 @@ enum class TagType : unsigned int {
     Mp4Tag = 0x04, /**< The tag is a TagParser::Mp4Tag. */
     MatroskaTag = 0x08, /**< The tag is a TagParser::MatroskaTag. */
     VorbisComment = 0x10, /**< The tag is a TagParser::VorbisComment. */
-    OggVorbisComment = 0x20 /**< The tag is a TagParser::OggVorbisComment. */
+    OggVorbisComment = 0x20, /**< The tag is a TagParser::OggVorbisComment. */
+    RiffInfoTag = 0x40 /**< The tag is a TagParser::RiffInfoTag. */
 };
 
 /*!
@@ -125,6 +133,7 @@ public:
     virtual bool supportsTarget() const;
     const TagTarget &target() const;
     void setTarget(const TagTarget &target);
+    static std::uint64_t targetRevision();
     virtual TagTargetLevel targetLevel() const;
     const char *targetLevelName() const;
     bool isTargetingLevel(TagTargetLevel tagTargetLevel) const;
@@ -136,14 +145,27 @@ public:
     virtual bool supportsMimeType(KnownField field) const;
     virtual bool supportsMultipleValues(KnownField field) const;
     virtual unsigned int insertValues(const Tag &from, bool overwrite);
+    virtual unsigned int insertValues(Tag &&from, bool overwrite);
+    virtual unsigned int assignValues(std::vector<std::pair<KnownField, TagValue>> &&values);
     virtual void ensureTextValuesAreProperlyEncoded() = 0;
+    bool isModified() const;
+    void setModified(bool modified);
+    const std::shared_ptr<const TagTemplate> &tagTemplate() const;
+    bool setTagTemplate(const std::shared_ptr<const TagTemplate> &tagTemplate);
 
 protected:
     Tag();
+    template <typename IdentifierType> void convertValuesForTag(std::vector<std::pair<IdentifierType, TagValue>> &values) const;
+    TagValue takeValue(KnownField field);
 
     std::string m_version;
     std::uint32_t m_size;
     TagTarget m_target;
+    bool m_modified;
+    std::shared_ptr<const TagTemplate> m_template;
+
+private:
+    static std::atomic<std::uint64_t> m_targetRevision;
 };
 
 inline TagType Tag::type() const
@@ -188,7 +210,81 @@ inline const TagTarget &Tag::target() const
 
 inline void Tag::setTarget(const TagTarget &target)
 {
+    if (m_target == target) {
+        return;
+    }
     m_target = target;
+    m_modified = true;
+    m_targetRevision.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*!
+ * \brief Converts the text of the specified \a values to an encoding supported by the tag.
+ *
+ * This is like calling TagValue::convertDataEncodingForTag() for each value but whether an encoding can be used is
+ * only determined once for all values.
+ *
+ * \throws Throws CppUtilities::ConversionException if a value can not be converted.
+ */
+template <typename IdentifierType> void Tag::convertValuesForTag(std::vector<std::pair<IdentifierType, TagValue>> &values) const
+{
+    enum : std::uint8_t { Unknown, Supported, Unsupported };
+    auto encodings = std::array<std::uint8_t, static_cast<std::size_t>(TagTextEncoding::Unspecified) + 1>();
+    const auto proposedEncoding = proposedTextEncoding();
+    for (auto &fieldValue : values) {
+        auto &value = fieldValue.second;
+        if (value.type() != TagDataType::Text) {
+            continue;
+        }
+        auto &encoding = encodings[static_cast<std::size_t>(value.dataEncoding())];
+        if (encoding == Unknown) {
+            encoding = canEncodingBeUsed(value.dataEncoding()) ? Supported : Unsupported;
+        }
+        if (encoding == Unsupported) {
+            value.convertDataEncoding(proposedEncoding);
+        }
+    }
+}
+
+/*!
+ * \brief Returns whether the tag has been modified since it has been parsed.
+ *
+ * Newly created tags are considered modified. Assigning a value which is identical to the present value (see
+ * TagValue::isIdentical()) or the present target does not mark the tag as modified. Obtaining mutable access
+ * to the fields (e.g. via FieldMapBasedTag::fields()) does because the changes made that way can not be tracked.
+ *
+ * \sa MediaFileInfo::changes()
+ */
+inline bool Tag::isModified() const
+{
+    return m_modified;
+}
+
+/*!
+ * \brief Sets whether the tag is considered modified.
+ * \remarks This is done by MediaFileInfo after parsing the tag and may be used to enforce writing the tag.
+ */
+inline void Tag::setModified(bool modified)
+{
+    m_modified = modified;
+}
+
+/*!
+ * \brief Returns the template whose fields are merged into the tag when making it.
+ * \sa setTagTemplate()
+ */
+inline const std::shared_ptr<const TagTemplate> &Tag::tagTemplate() const
+{
+    return m_template;
+}
+
+/*!
+ * \brief Returns a counter which is incremented whenever the target of any tag is changed via setTarget().
+ * \remarks This is used by containers to detect whether an index of their tags by target needs to be rebuilt.
+ */
+inline std::uint64_t Tag::targetRevision()
+{
+    return m_targetRevision.load(std::memory_order_relaxed);
 }
 
 inline TagTargetLevel Tag::targetLevel() const
@@ -0,0 +1,84 @@
+#include "./tagfieldfilter.h"
+#include "./caseinsensitivecomparer.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace TagParser {
+
+/*!
+ * \class TagParser::TagFieldFilter
+ * \brief The TagFieldFilter class specifies the fields to be read when parsing tags.
+ *
+ * Fields can be specified as KnownField or via their format-specific identifiers, e.g. MP4 atom IDs and ID3v2 frame
+ * IDs (see addId()) or Vorbis comment field names and Matroska tag names (see addName()). Fields which are not included
+ * are skipped when parsing without reading their data. This speeds up reading only a few fields of tags with many
+ * (or big) fields.
+ *
+ * \remarks
+ * - An empty filter includes all fields.
+ * - Tags which have been parsed with a filter lack the fields not included. Hence changes can not be applied.
+ * \sa MediaFileInfo::setTagFieldFilter()
+ */
+
+/*!
+ * \brief Constructs a filter which includes the specified \a fields.
+ */
+TagFieldFilter::TagFieldFilter(std::initializer_list<KnownField> fields)
+{
+    for (const auto field : fields) {
+        addField(field);
+    }
+}
+
+/*!
+ * \brief Includes the specified \a field.
+ */
+void TagFieldFilter::addField(KnownField field)
+{
+    if (field != KnownField::Invalid) {
+        m_fields.set(static_cast<std::size_t>(field));
+    }
+}
+
+/*!
+ * \brief Includes the field with the specified \a id, e.g. an MP4 atom ID or an ID3v2 frame ID.
+ */
+void TagFieldFilter::addId(std::uint32_t id)
+{
+    if (find(m_ids.cbegin(), m_ids.cend(), id) == m_ids.cend()) {
+        m_ids.emplace_back(id);
+    }
+}
+
+/*!
+ * \brief Includes the field with the specified \a name, e.g. a Vorbis comment field name or a Matroska tag name.
+ * \remarks Names are compared case-insensitively (as Vorbis comment field names are case-insensitive).
+ */
+void TagFieldFilter::addName(std::string_view name)
+{
+    m_names.emplace_back(name);
+}
+
+/*!
+ * \brief Returns whether the specified \a field or the field with the specified \a id is included.
+ * \remarks Returns always true if the filter is empty.
+ */
+bool TagFieldFilter::includes(KnownField field, std::uint32_t id) const
+{
+    return includes(field) || find(m_ids.cbegin(), m_ids.cend(), id) != m_ids.cend();
+}
+
+/*!
+ * \brief Returns whether the specified \a field or the field with the specified \a name is included.
+ * \remarks Returns always true if the filter is empty.
+ */
+bool TagFieldFilter::includes(KnownField field, std::string_view name) const
+{
+    return includes(field) || any_of(m_names.cbegin(), m_names.cend(), [name](const std::string &includedName) {
+        return includedName.size() == name.size() && CaseInsensitiveCharComparer::equals(includedName.data(), name.data(), name.size());
+    });
+}
+
+} // namespace TagParser
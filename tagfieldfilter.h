@@ -0,0 +1,71 @@
+#ifndef TAG_PARSER_TAGFIELDFILTER_H
+#define TAG_PARSER_TAGFIELDFILTER_H
+
+#include "./tag.h"
+
+#include <bitset>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace TagParser {
+
+class TAG_PARSER_EXPORT TagFieldFilter {
+public:
+    explicit TagFieldFilter();
+    explicit TagFieldFilter(std::initializer_list<KnownField> fields);
+
+    bool isEmpty() const;
+    void clear();
+    void addField(KnownField field);
+    void addId(std::uint32_t id);
+    void addName(std::string_view name);
+    bool includes(KnownField field) const;
+    bool includes(KnownField field, std::uint32_t id) const;
+    bool includes(KnownField field, std::string_view name) const;
+
+private:
+    std::bitset<knownFieldArraySize> m_fields;
+    std::vector<std::uint32_t> m_ids;
+    std::vector<std::string> m_names;
+};
+
+/*!
+ * \brief Constructs an empty filter which includes all fields.
+ */
+inline TagFieldFilter::TagFieldFilter()
+{
+}
+
+/*!
+ * \brief Returns whether no fields have been added so all fields are included.
+ */
+inline bool TagFieldFilter::isEmpty() const
+{
+    return m_fields.none() && m_ids.empty() && m_names.empty();
+}
+
+/*!
+ * \brief Removes all fields so all fields are included again.
+ */
+inline void TagFieldFilter::clear()
+{
+    m_fields.reset();
+    m_ids.clear();
+    m_names.clear();
+}
+
+/*!
+ * \brief Returns whether the specified \a field is included.
+ * \remarks Returns always true if the filter is empty.
+ */
+inline bool TagFieldFilter::includes(KnownField field) const
+{
+    return isEmpty() || (field != KnownField::Invalid && m_fields.test(static_cast<std::size_t>(field)));
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_TAGFIELDFILTER_H
@@ -0,0 +1,312 @@
+#include "./tagfieldlist.h"
+#include "./stringpool.h"
+
+#include "./id3/id3v2tag.h"
+#include "./matroska/matroskatag.h"
+#include "./mp4/mp4tag.h"
+#include "./vorbis/vorbiscomment.h"
+#include "./wav/riffinfotag.h"
+
+#include <algorithm>
+#include <type_traits>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+/// \cond
+namespace {
+
+/*!
+ * \brief The TagFieldVisitor struct invokes a callback for a record of each value of a tag.
+ * \remarks The string views of the records point into the tag.
+ */
+struct TagFieldVisitor {
+    void visit(const Tag &tag, TagFieldRecord record);
+    void append(TagFieldRecord record, const TagValue &value);
+    template <class TagClass> void appendFields(const TagClass &tag, TagFieldRecord record);
+    void appendKnownFields(const Tag &tag, TagFieldRecord record);
+
+    FunctionRef<void(const TagFieldRecord &record)> callback;
+    std::size_t maxDataSize = 0;
+};
+
+/*!
+ * \brief The TagFieldListBuilder struct collects the records of a TagFieldList.
+ *
+ * The string views of the collected records point into the tags until copyData() copies the data of all records into
+ * a single buffer.
+ */
+struct TagFieldListBuilder {
+    void append(const TagFieldRecord &record);
+    std::unique_ptr<char[]> copyData();
+
+    std::vector<TagFieldRecord> records;
+    StringPool *namePool = nullptr;
+    std::size_t dataSize = 0;
+};
+
+/*!
+ * \brief Assigns the native ID of \a field to \a record.
+ */
+template <class FieldType> inline void assignId(TagFieldRecord &record, const FieldType &field)
+{
+    if constexpr (std::is_integral_v<typename FieldType::IdentifierType>) {
+        record.id = field.id();
+    } else {
+        record.name = field.id();
+    }
+}
+
+/*!
+ * \brief Assigns the native ID of \a field to \a record; the name of extended fields is assigned as well.
+ */
+inline void assignId(TagFieldRecord &record, const Mp4TagField &field)
+{
+    record.id = field.id();
+    record.name = field.name();
+}
+
+/*!
+ * \brief Invokes \a callback for the value of \a field.
+ */
+template <class FieldType, class Callback> inline void forEachValue(const FieldType &field, Callback &&callback)
+{
+    callback(field.value());
+}
+
+/*!
+ * \brief Invokes \a callback for all values of \a frame.
+ */
+template <class Callback> inline void forEachValue(const Id3v2Frame &frame, Callback &&callback)
+{
+    callback(frame.value());
+    for (const auto &value : frame.additionalValues()) {
+        callback(value);
+    }
+}
+
+/*!
+ * \brief Invokes the callback for all values of the specified \a tag.
+ */
+void TagFieldVisitor::visit(const Tag &tag, TagFieldRecord record)
+{
+    record.tagType = tag.type();
+    switch (record.tagType) {
+    case TagType::Id3v2Tag:
+        appendFields(static_cast<const Id3v2Tag &>(tag), record);
+        break;
+    case TagType::Mp4Tag:
+        appendFields(static_cast<const Mp4Tag &>(tag), record);
+        break;
+    case TagType::MatroskaTag:
+        appendFields(static_cast<const MatroskaTag &>(tag), record);
+        break;
+    case TagType::VorbisComment:
+    case TagType::OggVorbisComment: {
+        const auto &vorbisComment = static_cast<const VorbisComment &>(tag);
+        record.field = KnownField::Vendor;
+        append(record, vorbisComment.vendor());
+        appendFields(vorbisComment, record);
+        break;
+    }
+    case TagType::RiffInfoTag:
+        appendFields(static_cast<const RiffInfoTag &>(tag), record);
+        break;
+    default:
+        appendKnownFields(tag, record);
+    }
+}
+
+/*!
+ * \brief Invokes the callback for a record of \a value unless it is empty.
+ * \remarks The data of \a value is loaded if it has been assigned lazily unless it exceeds the maximum data size.
+ */
+void TagFieldVisitor::append(TagFieldRecord record, const TagValue &value)
+{
+    if (value.isEmpty()) {
+        return;
+    }
+    record.dataType = value.type();
+    record.encoding = value.dataEncoding();
+    record.dataSize = value.dataSize();
+    if (record.dataSize <= maxDataSize) {
+        record.data = std::string_view(value.dataPointer(), record.dataSize);
+    }
+    callback(record);
+}
+
+/*!
+ * \brief Invokes the callback for all values of all fields of the specified field map based \a tag.
+ */
+template <class TagClass> void TagFieldVisitor::appendFields(const TagClass &tag, TagFieldRecord record)
+{
+    for (const auto &[id, field] : tag.fields()) {
+        record.field = tag.knownField(id);
+        assignId(record, field);
+        forEachValue(field, [&](const TagValue &value) { append(record, value); });
+    }
+}
+
+/*!
+ * \brief Invokes the callback for all values of all known fields of the specified \a tag (used for tags without native IDs).
+ */
+void TagFieldVisitor::appendKnownFields(const Tag &tag, TagFieldRecord record)
+{
+    for (auto field = firstKnownField; field != KnownField::Invalid; field = nextKnownField(field)) {
+        record.field = field;
+        for (const auto *const value : tag.values(field)) {
+            append(record, *value);
+        }
+    }
+}
+
+/*!
+ * \brief Appends the specified \a record.
+ */
+void TagFieldListBuilder::append(const TagFieldRecord &record)
+{
+    auto &appended = records.emplace_back(record);
+    if (namePool) {
+        appended.name = namePool->intern(appended.name);
+    } else {
+        dataSize += appended.name.size();
+    }
+    dataSize += appended.data.size();
+}
+
+/*!
+ * \brief Copies the data of all records into a single buffer and lets the records point into it.
+ */
+std::unique_ptr<char[]> TagFieldListBuilder::copyData()
+{
+    auto buffer = make_unique<char[]>(dataSize);
+    auto *offset = buffer.get();
+    const auto copyView = [&offset](std::string_view &view) {
+        if (view.empty()) {
+            return;
+        }
+        const auto source = view;
+        view = std::string_view(offset, source.size());
+        offset = copy(source.begin(), source.end(), offset);
+    };
+    for (auto &record : records) {
+        if (!namePool) {
+            copyView(record.name);
+        }
+        copyView(record.data);
+    }
+    return buffer;
+}
+
+} // namespace
+/// \endcond
+
+/*!
+ * \brief Returns the value converted to a string using the specified \a encoding.
+ * \returns Returns an empty string if the data of the value has not been copied into the list.
+ * \throws Throws CppUtilities::ConversionException if the value is not convertible to a string.
+ */
+std::string TagFieldRecord::toString(TagTextEncoding encoding) const
+{
+    if (data.empty()) {
+        return std::string();
+    }
+    return TagValue(data.data(), data.size(), dataType, this->encoding).toString(encoding);
+}
+
+/*!
+ * \class TagParser::TagFieldList
+ * \brief The TagFieldList class holds the values of the fields of tags as flat, immutable list.
+ *
+ * Each value is stored as a TagFieldRecord which consists of the tag type, the native ID of the field, the
+ * corresponding KnownField and the raw data of the value. The native IDs and values of all records are stored within
+ * a single buffer (textual IDs might be stored in a StringPool instead). So in contrast to the tag objects (or a MediaFileSnapshot) there are no objects per field, no
+ * nested TagValue objects and no description/MIME type strings. This makes the list cheap to keep around (e.g. for
+ * indexing a library) and it can be shared between threads like a MediaFileSnapshot.
+ *
+ * Use MediaFileInfo::parseTagFields() to parse only the tags of a file and obtain the list.
+ *
+ * \remarks
+ * - Empty values are omitted. Nested fields of Matroska tags are omitted as well.
+ * - Values exceeding the maximum data size passed to fromTags() are recorded without their data so e.g. big cover art
+ *   does not need to be loaded (see ParsingFlags::LazyLoadPictures).
+ */
+
+/*!
+ * \brief Creates a list of the values of the specified \a tags.
+ * \param maxDataSize Specifies the maximum size of values which data is copied into the list.
+ * \param namePool Specifies a pool to intern the textual IDs in (instead of copying them into the buffer of the list).
+ *                 This avoids storing the same names for every file and allows comparing the names of records by
+ *                 pointer; the pool must outlive the list then.
+ * \remarks Values which have been assigned lazily are loaded unless they exceed \a maxDataSize; so the file the tags
+ *          have been parsed from must still be open.
+ * \throws Throws std::ios_base::failure when an IO error occurs when loading data.
+ */
+std::shared_ptr<const TagFieldList> TagFieldList::fromTags(const std::vector<Tag *> &tags, std::size_t maxDataSize, StringPool *namePool)
+{
+    auto builder = TagFieldListBuilder();
+    builder.namePool = namePool;
+    for (std::size_t index = 0; index != tags.size(); ++index) {
+        forEachRecord(
+            *tags[index], [&builder](const TagFieldRecord &record) { builder.append(record); }, maxDataSize, static_cast<std::uint32_t>(index));
+    }
+
+    auto list = std::shared_ptr<TagFieldList>(new TagFieldList());
+    list->m_buffer = builder.copyData();
+    list->m_dataSize = builder.dataSize;
+    list->m_records = std::move(builder.records);
+    list->m_records.shrink_to_fit();
+    return list;
+}
+
+/*!
+ * \brief Invokes the specified \a callback for the record of each value of the specified \a tag.
+ * \param maxDataSize Specifies the maximum size of values which data is assigned to the records.
+ * \param tagIndex Specifies the value for TagFieldRecord::tagIndex.
+ *
+ * This yields the same records as fromTags() but without creating a list: The names and values of the records point
+ * into \a tag so nothing is copied or allocated.
+ *
+ * \remarks Values which have been assigned lazily are loaded unless they exceed \a maxDataSize; so the file the tag
+ *          has been parsed from must still be open.
+ * \throws Throws std::ios_base::failure when an IO error occurs when loading data.
+ */
+void TagFieldList::forEachRecord(
+    const Tag &tag, FunctionRef<void(const TagFieldRecord &record)> callback, std::size_t maxDataSize, std::uint32_t tagIndex)
+{
+    auto record = TagFieldRecord();
+    record.tagIndex = tagIndex;
+    TagFieldVisitor{ callback, maxDataSize }.visit(tag, record);
+}
+
+/*!
+ * \brief Creates a list of the specified \a records which IDs and values point into the specified \a buffer.
+ *
+ * The list keeps a reference to \a buffer so the records stay valid as long as the list exists. This allows
+ * creating a list without copying the data, e.g. when deserializing a CachedParseResult (see
+ * CachedParseResult::deserialize()).
+ *
+ * \remarks It is up to the caller to ensure the string views of the \a records point into \a buffer.
+ */
+std::shared_ptr<const TagFieldList> TagFieldList::fromRecords(
+    std::vector<TagFieldRecord> &&records, const std::shared_ptr<const void> &buffer, std::size_t bufferSize)
+{
+    auto list = std::shared_ptr<TagFieldList>(new TagFieldList());
+    list->m_buffer = buffer;
+    list->m_dataSize = bufferSize;
+    list->m_records = std::move(records);
+    return list;
+}
+
+/*!
+ * \brief Returns the first record for the specified \a field or nullptr if there is none.
+ */
+const TagFieldRecord *TagFieldList::find(KnownField field) const
+{
+    const auto i = find_if(m_records.cbegin(), m_records.cend(), [field](const TagFieldRecord &record) { return record.field == field; });
+    return i != m_records.cend() ? &*i : nullptr;
+}
+
+} // namespace TagParser
@@ -0,0 +1,108 @@
+#ifndef TAG_PARSER_TAGFIELDLIST_H
+#define TAG_PARSER_TAGFIELDLIST_H
+
+#include "./functionref.h"
+#include "./tag.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace TagParser {
+
+class StringPool;
+
+/*!
+ * \brief The TagFieldRecord struct holds a single value of a tag field stored within a TagFieldList.
+ * \remarks The string views point into the buffer of the TagFieldList and are valid as long as the list exists.
+ */
+struct TAG_PARSER_EXPORT TagFieldRecord {
+    std::string toString(TagTextEncoding encoding = TagTextEncoding::Utf8) const;
+
+    /// \brief The type of the tag the field belongs to.
+    TagType tagType = TagType::Unspecified;
+    /// \brief The index of the tag the field belongs to within the tags passed to TagFieldList::fromTags().
+    std::uint32_t tagIndex = 0;
+    /// \brief The field or KnownField::Invalid if the native ID is not mapped to a known field.
+    KnownField field = KnownField::Invalid;
+    /// \brief The numeric native ID (ID3v2, MP4 and RIFF INFO tags); zero if the tag uses textual IDs.
+    std::uint32_t id = 0;
+    /// \brief The textual native ID (Vorbis comments and Matroska tags) or the name of extended MP4 fields.
+    /// \remarks Points into the StringPool passed to TagFieldList::fromTags() if one has been passed.
+    std::string_view name;
+    /// \brief The type of the value.
+    TagDataType dataType = TagDataType::Undefined;
+    /// \brief The encoding of the value if it is text.
+    TagTextEncoding encoding = TagTextEncoding::Unspecified;
+    /// \brief The size of the value in bytes; also set if the data has not been copied (see TagFieldList::fromTags()).
+    std::size_t dataSize = 0;
+    /// \brief The raw data of the value; empty if the value exceeds the maximum data size.
+    std::string_view data;
+};
+
+class TAG_PARSER_EXPORT TagFieldList {
+public:
+    TagFieldList(const TagFieldList &) = delete;
+    TagFieldList &operator=(const TagFieldList &) = delete;
+
+    static std::shared_ptr<const TagFieldList> fromTags(
+        const std::vector<Tag *> &tags, std::size_t maxDataSize = defaultMaxDataSize, StringPool *namePool = nullptr);
+    static std::shared_ptr<const TagFieldList> fromRecords(
+        std::vector<TagFieldRecord> &&records, const std::shared_ptr<const void> &buffer, std::size_t bufferSize);
+    static void forEachRecord(const Tag &tag, FunctionRef<void(const TagFieldRecord &record)> callback,
+        std::size_t maxDataSize = defaultMaxDataSize, std::uint32_t tagIndex = 0);
+
+    const std::vector<TagFieldRecord> &records() const;
+    std::size_t size() const;
+    bool isEmpty() const;
+    const TagFieldRecord *find(KnownField field) const;
+    std::size_t dataSize() const;
+
+    /// \brief The default maximum size of values which data is copied into the list.
+    static constexpr std::size_t defaultMaxDataSize = 0x10000;
+
+private:
+    TagFieldList() = default;
+
+    std::vector<TagFieldRecord> m_records;
+    std::shared_ptr<const void> m_buffer;
+    std::size_t m_dataSize = 0;
+};
+
+/*!
+ * \brief Returns the records in the order of the tags and the order the fields are stored within each tag.
+ */
+inline const std::vector<TagFieldRecord> &TagFieldList::records() const
+{
+    return m_records;
+}
+
+/*!
+ * \brief Returns the number of records.
+ */
+inline std::size_t TagFieldList::size() const
+{
+    return m_records.size();
+}
+
+/*!
+ * \brief Returns whether there are no records.
+ */
+inline bool TagFieldList::isEmpty() const
+{
+    return m_records.empty();
+}
+
+/*!
+ * \brief Returns the size of the buffer holding the IDs and values of all records in bytes.
+ */
+inline std::size_t TagFieldList::dataSize() const
+{
+    return m_dataSize;
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_TAGFIELDLIST_H
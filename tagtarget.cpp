@@ -64,17 +64,12 @@ string TagTarget::toString(TagTargetLevel tagTargetLevel) const
         levelString += "level ";
         levelString += numberToString(level());
     }
-    const char *defaultLevelName;
-    if (!levelName().empty() || *(defaultLevelName = tagTargetLevelName(tagTargetLevel))) {
+    if (const auto name = levelName(tagTargetLevel); !name.empty()) {
         if (!levelString.empty()) {
             levelString += ' ';
         }
         levelString += '\'';
-        if (!levelName().empty()) {
-            levelString += levelName();
-        } else {
-            levelString += defaultLevelName;
-        }
+        levelString += name;
         levelString += '\'';
     }
     list<string> parts;
@@ -6,6 +6,7 @@
 #include <cstdint>
 #include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace TagParser {
@@ -28,6 +29,7 @@ public:
     std::uint64_t level() const;
     void setLevel(std::uint64_t level);
     const std::string &levelName() const;
+    std::string_view levelName(TagTargetLevel tagTargetLevel) const;
     void setLevelName(const std::string &levelName);
     const IdContainerType &tracks() const;
     IdContainerType &tracks();
@@ -90,6 +92,15 @@ inline const std::string &TagTarget::levelName() const
     return m_levelName;
 }
 
+/*!
+ * \brief Returns the level name or the name of the specified \a tagTargetLevel if no level name is assigned.
+ * \remarks Refers either to the stored level name or to a static string so nothing is copied.
+ */
+inline std::string_view TagTarget::levelName(TagTargetLevel tagTargetLevel) const
+{
+    return m_levelName.empty() ? std::string_view(tagTargetLevelName(tagTargetLevel)) : std::string_view(m_levelName);
+}
+
 /*!
  * \brief Sets the level name.
  */
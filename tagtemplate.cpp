@@ -0,0 +1,213 @@
+#include "./tagtemplate.h"
+#include "./diagnostics.h"
+#include "./exceptions.h"
+
+#include "./id3/id3v2tag.h"
+#include "./mp4/mp4tag.h"
+#include "./vorbis/vorbiscomment.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace TagParser {
+
+/*!
+ * \class TagParser::TagTemplate
+ * \brief The TagTemplate class holds fields which are supposed to be written into the tags of many files.
+ *
+ * When the same album-level fields (possibly including a big cover) are written into many files, the fields would be
+ * serialised (converted, encoded and Base64-encoded) again for each file. A template contains these fields and
+ * serialises them only once per tag format (and version) via serializedFields(). Assign the template to the tags of
+ * each file via Tag::setTagTemplate() and set the per-file fields (e.g. the track number) as usual. When making the tags
+ * the serialised fields of the template are merged into the tag:
+ * - Fields of the tag which are also present in the template are not written, so the template takes precedence.
+ * - The template's fields are not visible via the tag's accessors (e.g. Tag::value()).
+ * - Only ID3v2 tags, MP4 tags and Vorbis comments (also within OGG and FLAC streams) support templates.
+ *
+ * \remarks
+ * - The template must not be modified once it is assigned to a tag. Share it via std::shared_ptr<const TagTemplate>
+ *   (e.g. among the threads of a BatchWriter). Then serializedFields() is thread-safe.
+ * - The diagnostic messages which occur when serialising the fields are only added to the \a diag object passed to
+ *   the first call of serializedFields() for a particular tag format.
+ */
+
+/*!
+ * \brief Constructs an empty template.
+ */
+TagTemplate::TagTemplate()
+{
+}
+
+/*!
+ * \brief Returns whether templates can be assigned to tags of the specified \a tagType.
+ */
+bool TagTemplate::isTagTypeSupported(TagType tagType)
+{
+    switch (tagType) {
+    case TagType::Id3v2Tag:
+    case TagType::Mp4Tag:
+    case TagType::VorbisComment:
+    case TagType::OggVorbisComment:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*!
+ * \brief Assigns the specified \a value to the specified \a field.
+ * \returns Returns whether the field could be assigned; checking whether the tag formats support the field is deferred
+ *          until the fields are serialised.
+ */
+bool TagTemplate::setValue(KnownField field, const TagValue &value)
+{
+    return setValues(field, { value });
+}
+
+/*!
+ * \brief Assigns the specified \a values to the specified \a field.
+ * \remarks Empty values are skipped. Any previously assigned values of \a field are replaced.
+ */
+bool TagTemplate::setValues(KnownField field, const std::vector<TagValue> &values)
+{
+    if (field == KnownField::Invalid) {
+        return false;
+    }
+    m_values.erase(remove_if(m_values.begin(), m_values.end(), [field](const auto &value) { return value.first == field; }), m_values.end());
+    for (const auto &value : values) {
+        if (!value.isEmpty()) {
+            m_values.emplace_back(field, value);
+        }
+    }
+    m_serializedFields.clear();
+    return true;
+}
+
+/*!
+ * \brief Returns the values assigned to the specified \a field.
+ */
+std::vector<const TagValue *> TagTemplate::values(KnownField field) const
+{
+    auto values = std::vector<const TagValue *>();
+    for (const auto &value : m_values) {
+        if (value.first == field) {
+            values.emplace_back(&value.second);
+        }
+    }
+    return values;
+}
+
+/*!
+ * \brief Returns whether values are assigned to the specified \a field.
+ */
+bool TagTemplate::hasField(KnownField field) const
+{
+    return find_if(m_values.cbegin(), m_values.cend(), [field](const auto &value) { return value.first == field; }) != m_values.cend();
+}
+
+/// \cond
+template <typename TagImplementation>
+static void assignTemplateValues(TagImplementation &tag, const std::vector<std::pair<KnownField, TagValue>> &values)
+{
+    for (auto i = values.cbegin(), end = values.cend(); i != end;) {
+        const auto field = i->first;
+        auto fieldValues = std::vector<TagValue>();
+        for (; i != end && i->first == field; ++i) {
+            fieldValues.emplace_back(i->second);
+        }
+        tag.setValues(field, fieldValues);
+    }
+}
+/// \endcond
+
+/*!
+ * \brief Returns the fields serialised for the specified \a tagType and \a version.
+ *
+ * The fields are only serialised on the first call for a particular tag type and version. The \a version is the major
+ * version for ID3v2 tags and ignored otherwise. ID3v2 frames are ordered like the frames of an Id3v2Tag (see
+ * FrameComparer).
+ *
+ * \throws Throws NotImplementedException if \a tagType is not supported (see isTagTypeSupported()).
+ */
+const std::vector<TagTemplateField> &TagTemplate::serializedFields(TagType tagType, std::uint8_t version, Diagnostics &diag) const
+{
+    static const string context("serialising tag template");
+    if (tagType == TagType::OggVorbisComment) {
+        tagType = TagType::VorbisComment;
+    }
+    if (tagType != TagType::Id3v2Tag) {
+        version = 0;
+    }
+
+    const auto lock = lock_guard<mutex>(m_mutex);
+    const auto key = make_pair(tagType, version);
+    if (const auto cached = m_serializedFields.find(key); cached != m_serializedFields.end()) {
+        return cached->second;
+    }
+    auto fields = std::vector<TagTemplateField>();
+    switch (tagType) {
+    case TagType::Id3v2Tag: {
+        auto tag = Id3v2Tag();
+        tag.setVersion(version, 0);
+        assignTemplateValues(tag, m_values);
+        auto maker = tag.prepareMaking(diag);
+        fields.reserve(maker.frameMakers().size());
+        for (auto &frameMaker : maker.frameMakers()) {
+            auto &field = fields.emplace_back();
+            field.id = frameMaker.field().id();
+            field.data.resize(frameMaker.requiredSize());
+            frameMaker.make(field.data.data());
+        }
+        break;
+    }
+    case TagType::Mp4Tag: {
+        auto tag = Mp4Tag();
+        assignTemplateValues(tag, m_values);
+        auto maker = tag.prepareMaking(diag);
+        fields.reserve(maker.fieldMakers().size());
+        for (auto &fieldMaker : maker.fieldMakers()) {
+            auto &field = fields.emplace_back();
+            field.id = fieldMaker.field().id();
+            field.data.resize(static_cast<std::size_t>(fieldMaker.requiredSize()));
+            fieldMaker.make(field.data.data());
+        }
+        break;
+    }
+    case TagType::VorbisComment: {
+        auto tag = VorbisComment();
+        assignTemplateValues(tag, m_values);
+        fields.reserve(tag.fields().size());
+        for (auto &[id, vorbisField] : tag.fields()) {
+            auto field = TagTemplateField();
+            try {
+                if (vorbisField.make(field.data, VorbisCommentFlags::None, diag)) {
+                    field.name = id;
+                    fields.emplace_back(std::move(field));
+                }
+            } catch (const Failure &) {
+            }
+        }
+        break;
+    }
+    default:
+        diag.emplace_back(DiagLevel::Critical, "Templates are not supported for the tag format.", context);
+        throw NotImplementedException();
+    }
+    return m_serializedFields.emplace(key, std::move(fields)).first->second;
+}
+
+/*!
+ * \brief Returns the total number of bytes of the fields serialised for the specified \a tagType and \a version.
+ * \sa serializedFields()
+ */
+std::uint64_t TagTemplate::serializedSize(TagType tagType, std::uint8_t version, Diagnostics &diag) const
+{
+    auto size = std::uint64_t();
+    for (const auto &field : serializedFields(tagType, version, diag)) {
+        size += field.data.size();
+    }
+    return size;
+}
+
+} // namespace TagParser
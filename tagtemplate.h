@@ -0,0 +1,58 @@
+#ifndef TAG_PARSER_TAGTEMPLATE_H
+#define TAG_PARSER_TAGTEMPLATE_H
+
+#include "./tag.h"
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace TagParser {
+
+class Diagnostics;
+
+/*!
+ * \brief The TagTemplateField struct holds a field of a TagTemplate serialised for a particular tag format.
+ */
+struct TAG_PARSER_EXPORT TagTemplateField {
+    /// \brief The ID of the ID3v2 frame or MP4 atom; 0 for Vorbis comments.
+    std::uint32_t id = 0;
+    /// \brief The ID of the Vorbis comment field; empty for other formats.
+    std::string name;
+    /// \brief The serialised field including its header as it is written into the tag.
+    std::string data;
+};
+
+class TAG_PARSER_EXPORT TagTemplate {
+public:
+    TagTemplate();
+
+    static bool isTagTypeSupported(TagType tagType);
+    bool setValue(KnownField field, const TagValue &value);
+    bool setValues(KnownField field, const std::vector<TagValue> &values);
+    std::vector<const TagValue *> values(KnownField field) const;
+    bool hasField(KnownField field) const;
+    std::size_t fieldCount() const;
+    const std::vector<TagTemplateField> &serializedFields(TagType tagType, std::uint8_t version, Diagnostics &diag) const;
+    std::uint64_t serializedSize(TagType tagType, std::uint8_t version, Diagnostics &diag) const;
+
+private:
+    std::vector<std::pair<KnownField, TagValue>> m_values;
+    mutable std::mutex m_mutex;
+    mutable std::map<std::pair<TagType, std::uint8_t>, std::vector<TagTemplateField>> m_serializedFields;
+};
+
+/*!
+ * \brief Returns the number of values (not the number of distinct fields) the template contains.
+ */
+inline std::size_t TagTemplate::fieldCount() const
+{
+    return m_values.size();
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_TAGTEMPLATE_H
@@ -1,7 +1,9 @@
 #include "./tagvalue.h"
 
+#include "./abstractattachment.h"
 #include "./caseinsensitivecomparer.h"
 #include "./tag.h"
+#include "./textcodec.h"
 
 #include "./id3/id3genres.h"
 
@@ -46,25 +48,6 @@ const char *tagDataTypeString(TagDataType dataType)
     }
 }
 
-/*!
- * \brief Returns the encoding parameter (name of the character set and bytes per character) for the specified \a tagTextEncoding.
- */
-pair<const char *, float> encodingParameter(TagTextEncoding tagTextEncoding)
-{
-    switch (tagTextEncoding) {
-    case TagTextEncoding::Latin1:
-        return make_pair("ISO-8859-1", 1.0f);
-    case TagTextEncoding::Utf8:
-        return make_pair("UTF-8", 1.0f);
-    case TagTextEncoding::Utf16LittleEndian:
-        return make_pair("UTF-16LE", 2.0f);
-    case TagTextEncoding::Utf16BigEndian:
-        return make_pair("UTF-16BE", 2.0f);
-    default:
-        return make_pair(nullptr, 0.0f);
-    }
-}
-
 /*!
  * \class TagParser::TagValue
  * \brief The TagValue class wraps values of different types. It is meant to be assigned to a tag field.
@@ -103,9 +86,15 @@ TagValue::TagValue(const TagValue &other)
     , m_descEncoding(other.m_descEncoding)
     , m_flags(TagValueFlags::None)
 {
-    if (!other.isEmpty()) {
-        m_ptr = make_unique<char[]>(m_size);
-        std::copy(other.m_ptr.get(), other.m_ptr.get() + other.m_size, m_ptr.get());
+    if (other.isEmpty()) {
+        return;
+    }
+    if (other.m_lazyData) {
+        m_lazyData = other.m_lazyData;
+    } else if (other.m_sharedData) {
+        m_sharedData = other.m_sharedData;
+    } else {
+        std::copy(other.dataPointer(), other.dataPointer() + other.m_size, allocateData(m_size));
     }
 }
 
@@ -127,9 +116,16 @@ TagValue &TagValue::operator=(const TagValue &other)
     m_descEncoding = other.m_descEncoding;
     if (other.isEmpty()) {
         m_ptr.reset();
+        m_sharedData.reset();
+        m_lazyData.reset();
+        m_dataInline = false;
+    } else if (other.m_lazyData || other.m_sharedData) {
+        m_ptr.reset();
+        m_sharedData = other.m_sharedData;
+        m_lazyData = other.m_lazyData;
+        m_dataInline = false;
     } else {
-        m_ptr = make_unique<char[]>(m_size);
-        std::copy(other.m_ptr.get(), other.m_ptr.get() + other.m_size, m_ptr.get());
+        std::copy(other.dataPointer(), other.dataPointer() + other.m_size, allocateData(m_size));
     }
     return *this;
 }
@@ -195,13 +191,11 @@ bool TagValue::compareTo(const TagValue &other, TagValueComparisionFlags options
             }
         } else {
             const auto utfEncodingToUse = pickUtfEncoding(m_descEncoding, other.m_descEncoding);
-            StringData str1, str2;
+            pair<unique_ptr<char[]>, size_t> str1, str2;
             const char *data1, *data2;
             size_t size1, size2;
             if (m_descEncoding != utfEncodingToUse) {
-                const auto inputParameter = encodingParameter(m_descEncoding), outputParameter = encodingParameter(utfEncodingToUse);
-                str1 = convertString(
-                    inputParameter.first, outputParameter.first, m_desc.data(), m_desc.size(), outputParameter.second / inputParameter.second);
+                str1 = TextCodec::transcode(m_descEncoding, utfEncodingToUse, m_desc.data(), m_desc.size());
                 data1 = str1.first.get();
                 size1 = str1.second;
             } else {
@@ -209,9 +203,7 @@ bool TagValue::compareTo(const TagValue &other, TagValueComparisionFlags options
                 size1 = m_desc.size();
             }
             if (other.m_descEncoding != utfEncodingToUse) {
-                const auto inputParameter = encodingParameter(other.m_descEncoding), outputParameter = encodingParameter(utfEncodingToUse);
-                str2 = convertString(inputParameter.first, outputParameter.first, other.m_desc.data(), other.m_desc.size(),
-                    outputParameter.second / inputParameter.second);
+                str2 = TextCodec::transcode(other.m_descEncoding, utfEncodingToUse, other.m_desc.data(), other.m_desc.size());
                 data2 = str2.first.get();
                 size2 = str2.second;
             } else {
@@ -246,7 +238,7 @@ bool TagValue::compareTo(const TagValue &other, TagValueComparisionFlags options
                 data1 = str1.data();
                 size1 = str1.size();
             } else {
-                data1 = m_ptr.get();
+                data1 = dataPointer();
                 size1 = m_size;
             }
             if (other.m_encoding != utfEncodingToUse) {
@@ -254,7 +246,7 @@ bool TagValue::compareTo(const TagValue &other, TagValueComparisionFlags options
                 data2 = str2.data();
                 size2 = str2.size();
             } else {
-                data2 = other.m_ptr.get();
+                data2 = other.dataPointer();
                 size2 = other.m_size;
             }
             return compareData(data1, size1, data2, size2, options & TagValueComparisionFlags::CaseInsensitive);
@@ -314,9 +306,136 @@ void TagValue::clearMetadata()
     m_type = TagDataType::Undefined;
 }
 
+/// \cond
+namespace {
+
+/*!
+ * \brief The TextUnits struct provides access to the code units of text in any of the encodings supported by TagValue.
+ *
+ * This allows parsing numbers directly from the raw data without converting UTF-16 to a string first. All characters
+ * relevant for parsing numbers are ASCII characters so Latin-1 and UTF-8 can be treated the same way.
+ */
+struct TextUnits {
+    explicit TextUnits(const char *data, std::size_t size, TagTextEncoding encoding);
+    char16_t operator[](std::size_t index) const;
+
+    const unsigned char *data;
+    std::size_t size;
+    bool utf16;
+    bool bigEndian;
+};
+
+TextUnits::TextUnits(const char *data, std::size_t size, TagTextEncoding encoding)
+    : data(reinterpret_cast<const unsigned char *>(data))
+    , utf16(encoding == TagTextEncoding::Utf16LittleEndian || encoding == TagTextEncoding::Utf16BigEndian)
+    , bigEndian(encoding == TagTextEncoding::Utf16BigEndian)
+{
+    this->size = utf16 ? size / 2 : size;
+}
+
+inline char16_t TextUnits::operator[](std::size_t index) const
+{
+    if (!utf16) {
+        return data[index];
+    }
+    const auto *const unit = data + index * 2;
+    return static_cast<char16_t>(bigEndian ? ((unit[0] << 8) | unit[1]) : ((unit[1] << 8) | unit[0]));
+}
+
+/*!
+ * \brief Parses the 32-bit integer within [\a begin, \a end) of the specified \a text.
+ * \remarks Behaves like CppUtilities::stringToNumber(): spaces are ignored, a null character terminates the number
+ *          and an empty string yields zero.
+ * \throws Throws ConversionException if the text contains invalid characters or the number exceeds the limits.
+ */
+std::int32_t parseInteger(const TextUnits &text, std::size_t begin, std::size_t end)
+{
+    auto i = begin;
+    for (; i != end && text[i] == ' '; ++i)
+        ;
+    if (i == end) {
+        return 0;
+    }
+    const auto negative = text[i] == '-';
+    if (negative) {
+        ++i;
+    }
+    const auto limit = static_cast<std::int64_t>(numeric_limits<std::int32_t>::max()) + (negative ? 1 : 0);
+    auto result = std::int64_t();
+    for (; i != end; ++i) {
+        const auto unit = text[i];
+        if (!unit) {
+            break;
+        }
+        if (unit == ' ') {
+            continue;
+        }
+        if (unit < '0' || unit > '9') {
+            throw ConversionException("The string is no valid number.");
+        }
+        if ((result = result * 10 + (unit - '0')) > limit) {
+            throw ConversionException("The number exceeds the limits of a 32-bit integer.");
+        }
+    }
+    return static_cast<std::int32_t>(negative ? -result : result);
+}
+
+/*!
+ * \brief Parses a position in set like "9/11" within the specified \a text.
+ * \remarks Behaves like the PositionInSet constructor taking a string.
+ */
+PositionInSet parsePositionInSet(const TextUnits &text)
+{
+    auto separator = std::size_t();
+    for (; separator != text.size && text[separator] != '/'; ++separator)
+        ;
+    if (separator == text.size || separator == text.size - 1) {
+        return PositionInSet(parseInteger(text, 0, text.size));
+    } else if (separator == 0) {
+        return PositionInSet(0, parseInteger(text, 1, text.size));
+    }
+    return PositionInSet(parseInteger(text, 0, separator), parseInteger(text, separator + 1, text.size));
+}
+
+/*!
+ * \brief Parses a date of the form "YYYY", "YYYY-MM" or "YYYY-MM-DD" within the specified \a text.
+ * \returns Returns whether \a text is such a date; other forms are left to DateTime::fromIsoStringGmt().
+ */
+bool parseSimpleDate(const TextUnits &text, DateTime &date)
+{
+    if (text.size != 4 && text.size != 7 && text.size != 10) {
+        return false;
+    }
+    int parts[3] = { 0, 1, 1 };
+    for (std::size_t i = 0, part = 0; i != text.size; ++i) {
+        const auto unit = text[i];
+        if (i == 4 || i == 7) {
+            if (unit != '-') {
+                return false;
+            }
+            ++part;
+            parts[part] = 0;
+        } else if (unit >= '0' && unit <= '9') {
+            parts[part] = parts[part] * 10 + (unit - '0');
+        } else {
+            return false;
+        }
+    }
+    const auto [year, month, day] = parts;
+    if (year < 1 || month < 1 || month > 12 || day < 1 || day > DateTime::daysInMonth(year, month)) {
+        return false;
+    }
+    date = DateTime::fromDate(year, month, day);
+    return true;
+}
+
+} // namespace
+/// \endcond
+
 /*!
  * \brief Converts the value of the current TagValue object to its equivalent
  *        integer representation.
+ * \remarks Text is parsed directly from the assigned data (also if it is UTF-16 encoded) without any allocations.
  * \throws Throws ConversionException on failure.
  */
 std::int32_t TagValue::toInteger() const
@@ -325,27 +444,19 @@ std::int32_t TagValue::toInteger() const
         return 0;
     }
     switch (m_type) {
-    case TagDataType::Text:
-        switch (m_encoding) {
-        case TagTextEncoding::Unspecified:
-        case TagTextEncoding::Latin1:
-        case TagTextEncoding::Utf8:
-            return bufferToNumber<std::int32_t>(m_ptr.get(), m_size);
-        case TagTextEncoding::Utf16LittleEndian:
-        case TagTextEncoding::Utf16BigEndian:
-            u16string u16str(reinterpret_cast<char16_t *>(m_ptr.get()), m_size / 2);
-            ensureHostByteOrder(u16str, m_encoding);
-            return stringToNumber<std::int32_t>(u16str);
-        }
+    case TagDataType::Text: {
+        const auto text = TextUnits(dataPointer(), m_size, m_encoding);
+        return parseInteger(text, 0, text.size);
+    }
     case TagDataType::PositionInSet:
         if (m_size == sizeof(PositionInSet)) {
-            return *reinterpret_cast<std::int32_t *>(m_ptr.get());
+            return *reinterpret_cast<const std::int32_t *>(dataPointer());
         }
         throw ConversionException("Can not convert assigned data to integer because the data size is not appropriate.");
     case TagDataType::Integer:
     case TagDataType::StandardGenreIndex:
         if (m_size == sizeof(std::int32_t)) {
-            return *reinterpret_cast<std::int32_t *>(m_ptr.get());
+            return *reinterpret_cast<const std::int32_t *>(dataPointer());
         }
         throw ConversionException("Can not convert assigned data to integer because the data size is not appropriate.");
     default:
@@ -383,7 +494,7 @@ int TagValue::toStandardGenreIndex() const
         if (m_size != sizeof(std::int32_t)) {
             throw ConversionException("The assigned index/integer is of unappropriate size.");
         }
-        index = static_cast<int>(*reinterpret_cast<std::int32_t *>(m_ptr.get()));
+        index = static_cast<int>(*reinterpret_cast<const std::int32_t *>(dataPointer()));
         break;
     default:
         throw ConversionException(argsToString("Can not convert ", tagDataTypeString(m_type), " to genre index."));
@@ -397,6 +508,7 @@ int TagValue::toStandardGenreIndex() const
 /*!
  * \brief Converts the value of the current TagValue object to its equivalent
  *        PositionInSet representation.
+ * \remarks Text is parsed directly from the assigned data (also if it is UTF-16 encoded) without any allocations.
  * \throws Throws ConversionException on failure.
  */
 PositionInSet TagValue::toPositionInSet() const
@@ -406,25 +518,15 @@ PositionInSet TagValue::toPositionInSet() const
     }
     switch (m_type) {
     case TagDataType::Text:
-        switch (m_encoding) {
-        case TagTextEncoding::Unspecified:
-        case TagTextEncoding::Latin1:
-        case TagTextEncoding::Utf8:
-            return PositionInSet(string(m_ptr.get(), m_size));
-        case TagTextEncoding::Utf16LittleEndian:
-        case TagTextEncoding::Utf16BigEndian:
-            u16string u16str(reinterpret_cast<char16_t *>(m_ptr.get()), m_size / 2);
-            ensureHostByteOrder(u16str, m_encoding);
-            return PositionInSet(u16str);
-        }
+        return parsePositionInSet(TextUnits(dataPointer(), m_size, m_encoding));
     case TagDataType::Integer:
     case TagDataType::PositionInSet:
         switch (m_size) {
         case sizeof(std::int32_t):
-            return PositionInSet(*(reinterpret_cast<std::int32_t *>(m_ptr.get())));
+            return PositionInSet(*(reinterpret_cast<const std::int32_t *>(dataPointer())));
         case 2 * sizeof(std::int32_t):
             return PositionInSet(
-                *(reinterpret_cast<std::int32_t *>(m_ptr.get())), *(reinterpret_cast<std::int32_t *>(m_ptr.get() + sizeof(std::int32_t))));
+                *(reinterpret_cast<const std::int32_t *>(dataPointer())), *(reinterpret_cast<const std::int32_t *>(dataPointer() + sizeof(std::int32_t))));
         default:
             throw ConversionException("The size of the assigned data is not appropriate.");
         }
@@ -450,9 +552,9 @@ TimeSpan TagValue::toTimeSpan() const
     case TagDataType::TimeSpan:
         switch (m_size) {
         case sizeof(std::int32_t):
-            return TimeSpan(*(reinterpret_cast<std::int32_t *>(m_ptr.get())));
+            return TimeSpan(*(reinterpret_cast<const std::int32_t *>(dataPointer())));
         case sizeof(std::int64_t):
-            return TimeSpan(*(reinterpret_cast<std::int64_t *>(m_ptr.get())));
+            return TimeSpan(*(reinterpret_cast<const std::int64_t *>(dataPointer())));
         default:
             throw ConversionException("The size of the assigned integer is not appropriate for conversion to time span.");
         }
@@ -464,6 +566,8 @@ TimeSpan TagValue::toTimeSpan() const
 /*!
  * \brief Converts the value of the current TagValue object to its equivalent
  *        DateTime representation.
+ * \remarks Plain dates like "2008" or "2008-05-21" (the most common values of year/date fields) are parsed directly
+ *          from the assigned data without any allocations.
  * \throws Throws ConversionException on failure.
  */
 DateTime TagValue::toDateTime() const
@@ -473,6 +577,9 @@ DateTime TagValue::toDateTime() const
     }
     switch (m_type) {
     case TagDataType::Text: {
+        if (auto date = DateTime(); parseSimpleDate(TextUnits(dataPointer(), m_size, m_encoding), date)) {
+            return date;
+        }
         const auto str = toString(m_encoding == TagTextEncoding::Utf8 ? TagTextEncoding::Utf8 : TagTextEncoding::Latin1);
         try {
             return DateTime::fromIsoStringGmt(str.data());
@@ -483,9 +590,9 @@ DateTime TagValue::toDateTime() const
     case TagDataType::Integer:
     case TagDataType::DateTime:
         if (m_size == sizeof(std::int32_t)) {
-            return DateTime(*(reinterpret_cast<std::uint32_t *>(m_ptr.get())));
+            return DateTime(*(reinterpret_cast<const std::uint32_t *>(dataPointer())));
         } else if (m_size == sizeof(std::int64_t)) {
-            return DateTime(*(reinterpret_cast<std::uint64_t *>(m_ptr.get())));
+            return DateTime(*(reinterpret_cast<const std::uint64_t *>(dataPointer())));
         } else {
             throw ConversionException("The size of the assigned integer is not appropriate for conversion to date time.");
         }
@@ -509,34 +616,8 @@ void TagValue::convertDataEncoding(TagTextEncoding encoding)
         return;
     }
     if (type() == TagDataType::Text) {
-        StringData encodedData;
-        switch (encoding) {
-        case TagTextEncoding::Utf8:
-            // use pre-defined methods when encoding to UTF-8
-            switch (dataEncoding()) {
-            case TagTextEncoding::Latin1:
-                encodedData = convertLatin1ToUtf8(m_ptr.get(), m_size);
-                break;
-            case TagTextEncoding::Utf16LittleEndian:
-                encodedData = convertUtf16LEToUtf8(m_ptr.get(), m_size);
-                break;
-            case TagTextEncoding::Utf16BigEndian:
-                encodedData = convertUtf16BEToUtf8(m_ptr.get(), m_size);
-                break;
-            default:;
-            }
-            break;
-        default: {
-            // otherwise, determine input and output parameter to use general covertString method
-            const auto inputParameter = encodingParameter(dataEncoding());
-            const auto outputParameter = encodingParameter(encoding);
-            encodedData
-                = convertString(inputParameter.first, outputParameter.first, m_ptr.get(), m_size, outputParameter.second / inputParameter.second);
-        }
-        }
-        // can't just move the encoded data because it needs to be deleted with free
-        m_ptr = make_unique<char[]>(m_size = encodedData.second);
-        copy(encodedData.first.get(), encodedData.first.get() + encodedData.second, m_ptr.get());
+        const auto *const data = static_cast<const TagValue *>(this)->dataPointer(); // avoid copying shared data
+        assignTranscodedText(data, m_size, dataEncoding(), encoding);
     }
     m_encoding = encoding;
 }
@@ -564,31 +645,7 @@ void TagValue::convertDescriptionEncoding(TagTextEncoding encoding)
         m_descEncoding = encoding;
         return;
     }
-    StringData encodedData;
-    switch (encoding) {
-    case TagTextEncoding::Utf8:
-        // use pre-defined methods when encoding to UTF-8
-        switch (dataEncoding()) {
-        case TagTextEncoding::Latin1:
-            encodedData = convertLatin1ToUtf8(m_ptr.get(), m_size);
-            break;
-        case TagTextEncoding::Utf16LittleEndian:
-            encodedData = convertUtf16LEToUtf8(m_ptr.get(), m_size);
-            break;
-        case TagTextEncoding::Utf16BigEndian:
-            encodedData = convertUtf16BEToUtf8(m_ptr.get(), m_size);
-            break;
-        default:;
-        }
-        break;
-    default: {
-        // otherwise, determine input and output parameter to use general covertString method
-        const auto inputParameter = encodingParameter(m_descEncoding);
-        const auto outputParameter = encodingParameter(encoding);
-        encodedData = convertString(
-            inputParameter.first, outputParameter.first, m_desc.data(), m_desc.size(), outputParameter.second / inputParameter.second);
-    }
-    }
+    const auto encodedData = TextCodec::transcode(m_descEncoding, encoding, m_desc.data(), m_desc.size());
     m_desc.assign(encodedData.first.get(), encodedData.second);
     m_descEncoding = encoding;
 }
@@ -615,34 +672,11 @@ void TagValue::toString(string &result, TagTextEncoding encoding) const
     switch (m_type) {
     case TagDataType::Text:
         if (encoding == TagTextEncoding::Unspecified || dataEncoding() == TagTextEncoding::Unspecified || encoding == dataEncoding()) {
-            result.assign(m_ptr.get(), m_size);
+            result.assign(dataPointer(), m_size);
         } else {
-            StringData encodedData;
-            switch (encoding) {
-            case TagTextEncoding::Utf8:
-                // use pre-defined methods when encoding to UTF-8
-                switch (dataEncoding()) {
-                case TagTextEncoding::Latin1:
-                    encodedData = convertLatin1ToUtf8(m_ptr.get(), m_size);
-                    break;
-                case TagTextEncoding::Utf16LittleEndian:
-                    encodedData = convertUtf16LEToUtf8(m_ptr.get(), m_size);
-                    break;
-                case TagTextEncoding::Utf16BigEndian:
-                    encodedData = convertUtf16BEToUtf8(m_ptr.get(), m_size);
-                    break;
-                default:;
-                }
-                break;
-            default: {
-                // otherwise, determine input and output parameter to use general covertString method
-                const auto inputParameter = encodingParameter(dataEncoding());
-                const auto outputParameter = encodingParameter(encoding);
-                encodedData
-                    = convertString(inputParameter.first, outputParameter.first, m_ptr.get(), m_size, outputParameter.second / inputParameter.second);
-            }
-            }
-            result.assign(encodedData.first.get(), encodedData.second);
+            // transcode directly into the result to avoid an intermediate buffer
+            result.resize(TextCodec::maxTranscodedSize(dataEncoding(), encoding, m_size));
+            result.resize(TextCodec::transcode(dataEncoding(), encoding, dataPointer(), m_size, result.data()));
         }
         return;
     case TagDataType::Integer:
@@ -672,8 +706,7 @@ void TagValue::toString(string &result, TagTextEncoding encoding) const
         throw ConversionException(argsToString("Can not convert ", tagDataTypeString(m_type), " to string."));
     }
     if (encoding == TagTextEncoding::Utf16LittleEndian || encoding == TagTextEncoding::Utf16BigEndian) {
-        auto encodedData = encoding == TagTextEncoding::Utf16LittleEndian ? convertUtf8ToUtf16LE(result.data(), result.size())
-                                                                          : convertUtf8ToUtf16BE(result.data(), result.size());
+        const auto encodedData = TextCodec::transcode(TagTextEncoding::Utf8, encoding, result.data(), result.size());
         result.assign(encodedData.first.get(), encodedData.second);
     }
 }
@@ -699,33 +732,9 @@ void TagValue::toWString(std::u16string &result, TagTextEncoding encoding) const
     switch (m_type) {
     case TagDataType::Text:
         if (encoding == TagTextEncoding::Unspecified || encoding == dataEncoding()) {
-            result.assign(reinterpret_cast<const char16_t *>(m_ptr.get()), m_size / sizeof(char16_t));
+            result.assign(reinterpret_cast<const char16_t *>(dataPointer()), m_size / sizeof(char16_t));
         } else {
-            StringData encodedData;
-            switch (encoding) {
-            case TagTextEncoding::Utf8:
-                // use pre-defined methods when encoding to UTF-8
-                switch (dataEncoding()) {
-                case TagTextEncoding::Latin1:
-                    encodedData = convertLatin1ToUtf8(m_ptr.get(), m_size);
-                    break;
-                case TagTextEncoding::Utf16LittleEndian:
-                    encodedData = convertUtf16LEToUtf8(m_ptr.get(), m_size);
-                    break;
-                case TagTextEncoding::Utf16BigEndian:
-                    encodedData = convertUtf16BEToUtf8(m_ptr.get(), m_size);
-                    break;
-                default:;
-                }
-                break;
-            default: {
-                // otherwise, determine input and output parameter to use general covertString method
-                const auto inputParameter = encodingParameter(dataEncoding());
-                const auto outputParameter = encodingParameter(encoding);
-                encodedData
-                    = convertString(inputParameter.first, outputParameter.first, m_ptr.get(), m_size, outputParameter.second / inputParameter.second);
-            }
-            }
+            const auto encodedData = TextCodec::transcode(dataEncoding(), encoding, dataPointer(), m_size);
             result.assign(reinterpret_cast<const char16_t *>(encodedData.first.get()), encodedData.second / sizeof(char16_t));
         }
         return;
@@ -753,12 +762,78 @@ void TagValue::toWString(std::u16string &result, TagTextEncoding encoding) const
         throw ConversionException(argsToString("Can not convert ", tagDataTypeString(m_type), " to string."));
     }
     if (encoding == TagTextEncoding::Utf16LittleEndian || encoding == TagTextEncoding::Utf16BigEndian) {
-        auto encodedData = encoding == TagTextEncoding::Utf16LittleEndian ? convertUtf8ToUtf16LE(regularStrRes.data(), result.size())
-                                                                          : convertUtf8ToUtf16BE(regularStrRes.data(), result.size());
+        const auto encodedData = TextCodec::transcode(TagTextEncoding::Utf8, encoding, regularStrRes.data(), regularStrRes.size());
         result.assign(reinterpret_cast<const char16_t *>(encodedData.first.get()), encodedData.second / sizeof(const char16_t));
     }
 }
 
+/*!
+ * \brief Returns the value of the current TagValue object as std::string_view.
+ * \param buffer Specifies the string to store the result in if the value needs to be converted.
+ * \param encoding Specifies the encoding to to be used; set to TagTextEncoding::Unspecified to use the
+ *        present encoding without any character set conversion.
+ * \remarks
+ * - If the value is text which is already stored in the specified \a encoding (or the name of a standard
+ *   genre and \a encoding is not UTF-16) the returned view refers to the stored data and \a buffer is not
+ *   touched. Otherwise the value is converted via toString() into \a buffer and the view refers to it.
+ * - The view is invalidated when the value or \a buffer is modified or destroyed.
+ * \throws Throws ConversionException on failure.
+ * \sa toString()
+ */
+std::string_view TagValue::toStringView(std::string &buffer, TagTextEncoding encoding) const
+{
+    if (isEmpty()) {
+        return std::string_view();
+    }
+    switch (m_type) {
+    case TagDataType::Text:
+        if (encoding == TagTextEncoding::Unspecified || dataEncoding() == TagTextEncoding::Unspecified || encoding == dataEncoding()) {
+            return std::string_view(dataPointer(), m_size);
+        }
+        break;
+    case TagDataType::StandardGenreIndex:
+        if (encoding == TagTextEncoding::Utf16LittleEndian || encoding == TagTextEncoding::Utf16BigEndian) {
+            break;
+        }
+        if (const auto genreIndex = toInteger(); Id3Genres::isEmptyGenre(genreIndex)) {
+            return std::string_view();
+        } else if (const char *genreName = Id3Genres::stringFromIndex(genreIndex)) {
+            return std::string_view(genreName);
+        }
+        break;
+    default:;
+    }
+    toString(buffer, encoding);
+    return buffer;
+}
+
+/*!
+ * \brief Returns the value of the current TagValue object as std::u16string_view.
+ * \param buffer Specifies the string to store the result in if the value needs to be converted.
+ * \remarks
+ * - If the value is text which is already stored in the specified \a encoding the returned view refers to
+ *   the stored data and \a buffer is not touched. Otherwise (or if the stored data is not suitably aligned)
+ *   the value is converted via toWString() into \a buffer and the view refers to it.
+ * - The view is invalidated when the value or \a buffer is modified or destroyed.
+ * - Use this only, if \a encoding is an UTF-16 encoding.
+ * \throws Throws ConversionException on failure.
+ * \sa toWString()
+ */
+std::u16string_view TagValue::toWStringView(std::u16string &buffer, TagTextEncoding encoding) const
+{
+    if (isEmpty()) {
+        return std::u16string_view();
+    }
+    if (m_type == TagDataType::Text && (encoding == TagTextEncoding::Unspecified || encoding == dataEncoding())) {
+        const auto *const data = dataPointer();
+        if (reinterpret_cast<std::uintptr_t>(data) % alignof(char16_t) == 0) {
+            return std::u16string_view(reinterpret_cast<const char16_t *>(data), m_size / sizeof(char16_t));
+        }
+    }
+    toWString(buffer, encoding);
+    return buffer;
+}
+
 /*!
  * \brief Assigns a copy of the given \a text.
  * \param text Specifies the text to be assigned.
@@ -776,44 +851,44 @@ void TagValue::assignText(const char *text, std::size_t textSize, TagTextEncodin
 
     stripBom(text, textSize, textEncoding);
     if (!textSize) {
-        m_size = 0;
-        m_ptr.reset();
+        clearData();
         return;
     }
 
     if (convertTo == TagTextEncoding::Unspecified || textEncoding == convertTo) {
-        m_ptr = make_unique<char[]>(m_size = textSize);
-        copy(text, text + textSize, m_ptr.get());
+        copy(text, text + textSize, allocateData(textSize));
         return;
     }
 
-    StringData encodedData;
-    switch (textEncoding) {
-    case TagTextEncoding::Utf8:
-        // use pre-defined methods when encoding to UTF-8
-        switch (convertTo) {
-        case TagTextEncoding::Latin1:
-            encodedData = convertUtf8ToLatin1(text, textSize);
-            break;
-        case TagTextEncoding::Utf16LittleEndian:
-            encodedData = convertUtf8ToUtf16LE(text, textSize);
-            break;
-        case TagTextEncoding::Utf16BigEndian:
-            encodedData = convertUtf8ToUtf16BE(text, textSize);
-            break;
-        default:;
-        }
-        break;
-    default: {
-        // otherwise, determine input and output parameter to use general covertString method
-        const auto inputParameter = encodingParameter(textEncoding);
-        const auto outputParameter = encodingParameter(convertTo);
-        encodedData = convertString(inputParameter.first, outputParameter.first, text, textSize, outputParameter.second / inputParameter.second);
+    assignTranscodedText(text, textSize, textEncoding, convertTo);
+}
+
+/*!
+ * \brief Assigns \a text converted from \a textEncoding to \a encoding as data.
+ * \remarks
+ * - The text is transcoded directly into the inline storage or into the buffer which is taken over afterwards so no
+ *   further copy is needed. The buffer might be bigger than the transcoded text as it is sized for the worst case.
+ * - \a text may point to the currently assigned data.
+ * \throws Throws a ConversionException if the conversion fails.
+ */
+void TagValue::assignTranscodedText(const char *text, std::size_t textSize, TagTextEncoding textEncoding, TagTextEncoding encoding)
+{
+    if (TextCodec::maxTranscodedSize(textEncoding, encoding, textSize) <= inlineDataCapacity) {
+        char buffer[inlineDataCapacity];
+        const auto size = TextCodec::transcode(textEncoding, encoding, text, textSize, buffer);
+        std::copy(buffer, buffer + size, allocateData(size));
+        return;
     }
+    auto encodedData = TextCodec::transcode(textEncoding, encoding, text, textSize);
+    if (encodedData.second <= inlineDataCapacity) {
+        std::copy(encodedData.first.get(), encodedData.first.get() + encodedData.second, allocateData(encodedData.second));
+        return;
     }
-    // can't just move the encoded data because it needs to be deleted with free
-    m_ptr = make_unique<char[]>(m_size = encodedData.second);
-    copy(encodedData.first.get(), encodedData.first.get() + encodedData.second, m_ptr.get());
+    m_ptr = std::move(encodedData.first);
+    m_size = encodedData.second;
+    m_sharedData.reset();
+    m_lazyData.reset();
+    m_dataInline = false;
 }
 
 /*!
@@ -822,9 +897,7 @@ void TagValue::assignText(const char *text, std::size_t textSize, TagTextEncodin
  */
 void TagValue::assignInteger(int value)
 {
-    m_size = sizeof(value);
-    m_ptr = make_unique<char[]>(m_size);
-    std::copy(reinterpret_cast<const char *>(&value), reinterpret_cast<const char *>(&value) + m_size, m_ptr.get());
+    std::copy(reinterpret_cast<const char *>(&value), reinterpret_cast<const char *>(&value) + sizeof(value), allocateData(sizeof(value)));
     m_type = TagDataType::Integer;
     m_encoding = TagTextEncoding::Latin1;
 }
@@ -842,15 +915,11 @@ void TagValue::assignData(const char *data, size_t length, TagDataType type, Tag
     if (type == TagDataType::Text) {
         stripBom(data, length, encoding);
     }
-    if (length > m_size) {
-        m_ptr = make_unique<char[]>(length);
-    }
     if (length) {
-        std::copy(data, data + length, m_ptr.get());
+        std::copy(data, data + length, allocateData(length));
     } else {
-        m_ptr.reset();
+        clearData();
     }
-    m_size = length;
     m_type = type;
     m_encoding = encoding;
 }
@@ -873,6 +942,102 @@ void TagValue::assignData(unique_ptr<char[]> &&data, size_t length, TagDataType
     m_type = type;
     m_encoding = encoding;
     m_ptr = move(data);
+    m_sharedData.reset();
+    m_lazyData.reset();
+    m_dataInline = false;
+}
+
+/*!
+ * \brief Assigns the specified \a data which is part of the specified shared \a buffer without copying it.
+ *
+ * The value keeps a reference to \a buffer until another value is assigned. Copies of the value refer to the same
+ * buffer. This allows parsing big values such as cover art and lyrics without copying them out of the parse buffer.
+ *
+ * \param buffer Specifies the buffer \a data is part of.
+ * \param data Specifies the data to be assigned; it must stay valid and unchanged as long as \a buffer is alive.
+ * \param length Specifies the length of the data.
+ * \param type Specifies the type of the data as TagDataType.
+ * \param encoding Specifies the encoding of the data as TagTextEncoding. The
+ *                 encoding will only be considered if a text is assigned.
+ * \remarks
+ * - Strips the BOM of the specified \a data if \a type is TagDataType::Text.
+ * - Data not exceeding inlineDataCapacity is copied as this is cheaper than keeping a reference.
+ * - The data is copied when accessed via the non-const dataPointer() overload so the buffer is never modified.
+ */
+void TagValue::assignSharedData(const std::shared_ptr<const void> &buffer, const char *data, size_t length, TagDataType type, TagTextEncoding encoding)
+{
+    if (!buffer || length <= inlineDataCapacity) {
+        assignData(data, length, type, encoding);
+        return;
+    }
+    if (type == TagDataType::Text) {
+        stripBom(data, length, encoding);
+    }
+    m_ptr.reset();
+    m_sharedData = std::shared_ptr<const char>(buffer, data);
+    m_lazyData.reset();
+    m_dataInline = false;
+    m_size = length;
+    m_type = type;
+    m_encoding = encoding;
+}
+
+/*!
+ * \brief Assigns the data of the specified \a dataBlock without reading it yet.
+ *
+ * The data is only read from the stream of \a dataBlock when it is accessed for the first time (e.g. via dataPointer()) or
+ * when loadData() is called. This allows parsing big values such as cover art without reading them if they are never
+ * accessed. Copies of the value share \a dataBlock so the data is read at most once.
+ *
+ * \param dataBlock Specifies the data block to read the data from.
+ * \param type Specifies the type of the data as TagDataType.
+ * \param encoding Specifies the encoding of the data as TagTextEncoding. The
+ *                 encoding will only be considered if a text is assigned.
+ * \remarks
+ * - The stream of \a dataBlock must still be readable (and contain the same data as when the value has been assigned)
+ *   when the data is accessed. Otherwise accessing the data throws std::ios_base::failure.
+ * - Does not strip the BOM so for consistency the caller must ensure there is no BOM present.
+ */
+void TagValue::assignLazyData(const std::shared_ptr<const StreamDataBlock> &dataBlock, TagDataType type, TagTextEncoding encoding)
+{
+    const auto size = dataBlock ? static_cast<std::size_t>(dataBlock->size()) : 0;
+    if (!size) {
+        clearData();
+    } else {
+        m_ptr.reset();
+        m_sharedData.reset();
+        m_lazyData = dataBlock;
+        m_dataInline = false;
+        m_size = size;
+    }
+    m_type = type;
+    m_encoding = encoding;
+}
+
+/*!
+ * \brief Loads the data assigned via assignLazyData() if not done yet.
+ * \remarks Does nothing if the data has already been loaded (or has not been assigned via assignLazyData() in the first place).
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ */
+void TagValue::loadData() const
+{
+    if (!m_lazyData) {
+        return;
+    }
+    if (!m_lazyData->buffer()) {
+        m_lazyData->makeBuffer();
+    }
+    m_sharedData = std::shared_ptr<const char>(m_lazyData, m_lazyData->buffer().get());
+    m_lazyData.reset();
+}
+
+/*!
+ * \brief Replaces the shared data with an own copy of it.
+ */
+void TagValue::detachSharedData()
+{
+    const auto sharedData = std::move(m_sharedData); // keep buffer alive while copying
+    std::copy(sharedData.get(), sharedData.get() + m_size, allocateData(m_size));
 }
 
 /*!
@@ -924,6 +1089,29 @@ void TagValue::ensureHostByteOrder(u16string &u16str, TagTextEncoding currentEnc
     }
 }
 
+/*!
+ * \brief Returns whether the current instance is identical to \a other.
+ *
+ * In contrast to compareTo() no conversions are made: the type, the encodings, the raw data and all meta-data
+ * (including the native data) must be the same. Hence a value is only considered identical if it would be
+ * serialized in the same way. This is used to avoid marking tags as modified when a value is re-assigned.
+ *
+ * \remarks Data which has not been loaded yet is only loaded if the sizes are equal and the data does not refer to
+ *          the same block anyways.
+ */
+bool TagValue::isIdentical(const TagValue &other) const
+{
+    if (m_type != other.m_type || m_encoding != other.m_encoding || m_descEncoding != other.m_descEncoding || m_size != other.m_size
+        || m_flags != other.m_flags || m_desc != other.m_desc || m_mimeType != other.m_mimeType || m_locale != other.m_locale
+        || m_nativeData != other.m_nativeData) {
+        return false;
+    }
+    if ((m_lazyData && m_lazyData == other.m_lazyData) || (m_sharedData && m_sharedData == other.m_sharedData)) {
+        return true;
+    }
+    return compareData(other);
+}
+
 /*!
  * \brief Returns whether 2 data buffers are equal. In case one of the sizes is zero, no pointer is dereferenced.
  */
@@ -935,21 +1123,7 @@ bool TagValue::compareData(const char *data1, std::size_t size1, const char *dat
     if (!size1) {
         return true;
     }
-    if (ignoreCase) {
-        for (auto i1 = data1, i2 = data2, end = data1 + size1; i1 != end; ++i1, ++i2) {
-            if (CaseInsensitiveCharComparer::toLower(static_cast<unsigned char>(*i1))
-                != CaseInsensitiveCharComparer::toLower(static_cast<unsigned char>(*i2))) {
-                return false;
-            }
-        }
-    } else {
-        for (auto i1 = data1, i2 = data2, end = data1 + size1; i1 != end; ++i1, ++i2) {
-            if (*i1 != *i2) {
-                return false;
-            }
-        }
-    }
-    return true;
+    return ignoreCase ? CaseInsensitiveCharComparer::equals(data1, data2, size1) : !std::memcmp(data1, data2, size1);
 }
 
 /*!
@@ -15,12 +15,14 @@
 #include <iosfwd>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 
 namespace TagParser {
 
 class Tag;
 class Id3v2Frame;
+class StreamDataBlock;
 
 /*!
  * \brief Specifies the text encoding.
@@ -132,6 +134,8 @@ public:
     void toString(std::string &result, TagTextEncoding encoding = TagTextEncoding::Unspecified) const;
     std::u16string toWString(TagTextEncoding encoding = TagTextEncoding::Unspecified) const;
     void toWString(std::u16string &result, TagTextEncoding encoding = TagTextEncoding::Unspecified) const;
+    std::string_view toStringView(std::string &buffer, TagTextEncoding encoding = TagTextEncoding::Unspecified) const;
+    std::u16string_view toWStringView(std::u16string &buffer, TagTextEncoding encoding = TagTextEncoding::Unspecified) const;
     std::int32_t toInteger() const;
     int toStandardGenreIndex() const;
     PositionInSet toPositionInSet() const;
@@ -169,6 +173,14 @@ public:
     void assignData(const char *data, std::size_t length, TagDataType type = TagDataType::Binary, TagTextEncoding encoding = TagTextEncoding::Latin1);
     void assignData(std::unique_ptr<char[]> &&data, std::size_t length, TagDataType type = TagDataType::Binary,
         TagTextEncoding encoding = TagTextEncoding::Latin1);
+    void assignSharedData(const std::shared_ptr<const void> &buffer, const char *data, std::size_t length, TagDataType type = TagDataType::Binary,
+        TagTextEncoding encoding = TagTextEncoding::Latin1);
+    bool isDataShared() const;
+    void assignLazyData(const std::shared_ptr<const StreamDataBlock> &dataBlock, TagDataType type = TagDataType::Binary,
+        TagTextEncoding encoding = TagTextEncoding::Latin1);
+    bool isDataLoaded() const;
+    void loadData() const;
+    const std::shared_ptr<const StreamDataBlock> &lazyData() const;
     void assignPosition(PositionInSet value);
     void assignTimeSpan(CppUtilities::TimeSpan value);
     void assignDateTime(CppUtilities::DateTime value);
@@ -181,12 +193,22 @@ public:
             * = nullptr>
     static std::vector<std::string> toStrings(const ContainerType &values, TagTextEncoding encoding = TagTextEncoding::Utf8);
     bool compareTo(const TagValue &other, TagValueComparisionFlags options = TagValueComparisionFlags::None) const;
+    bool isIdentical(const TagValue &other) const;
     bool compareData(const TagValue &other, bool ignoreCase = false) const;
     static bool compareData(const std::string &data1, const std::string &data2, bool ignoreCase = false);
     static bool compareData(const char *data1, std::size_t size1, const char *data2, std::size_t size2, bool ignoreCase = false);
 
+    /// \brief The maximum size of data which is stored inline (without allocating memory on the heap).
+    static constexpr std::size_t inlineDataCapacity = 16;
+
 private:
+    char *allocateData(std::size_t size);
+    void assignTranscodedText(const char *text, std::size_t textSize, TagTextEncoding textEncoding, TagTextEncoding encoding);
+    void detachSharedData();
+
     std::unique_ptr<char[]> m_ptr;
+    mutable std::shared_ptr<const char> m_sharedData;
+    mutable std::shared_ptr<const StreamDataBlock> m_lazyData;
     std::size_t m_size;
     std::string m_desc;
     std::string m_mimeType;
@@ -196,6 +218,8 @@ private:
     TagTextEncoding m_encoding;
     TagTextEncoding m_descEncoding;
     TagValueFlags m_flags;
+    bool m_dataInline = false;
+    alignas(std::uint64_t) char m_inlineData[inlineDataCapacity];
 };
 
 /*!
@@ -244,6 +268,8 @@ inline TagValue::TagValue(const char *text, std::size_t textSize, TagTextEncodin
  * \remarks Strips the BOM of the specified \a text.
  */
 inline TagValue::TagValue(const char *text, TagTextEncoding textEncoding, TagTextEncoding convertTo)
+    : m_descEncoding(TagTextEncoding::Latin1)
+    , m_flags(TagValueFlags::None)
 {
     assignText(text, std::strlen(text), textEncoding, convertTo);
 }
@@ -293,8 +319,7 @@ inline TagValue::TagValue(const char *data, std::size_t length, TagDataType type
         if (type == TagDataType::Text) {
             stripBom(data, m_size, encoding);
         }
-        m_ptr = std::make_unique<char[]>(m_size);
-        std::copy(data, data + m_size, m_ptr.get());
+        std::copy(data, data + m_size, allocateData(m_size));
     }
 }
 
@@ -477,7 +502,7 @@ inline std::u16string TagValue::toWString(TagTextEncoding encoding) const
  */
 inline bool TagValue::isNull() const
 {
-    return m_ptr == nullptr;
+    return !m_dataInline && m_ptr == nullptr && m_sharedData == nullptr && m_lazyData == nullptr;
 }
 
 /*!
@@ -491,7 +516,7 @@ inline bool TagValue::isNull() const
  */
 inline bool TagValue::isEmpty() const
 {
-    return m_ptr == nullptr || m_size == 0;
+    return isNull() || m_size == 0;
 }
 
 /*!
@@ -504,6 +529,9 @@ inline void TagValue::clearData()
 {
     m_size = 0;
     m_ptr.reset();
+    m_sharedData.reset();
+    m_lazyData.reset();
+    m_dataInline = false;
 }
 
 /*!
@@ -531,14 +559,73 @@ inline std::size_t TagValue::dataSize() const
  * \remarks The instance keeps ownership over the data which will be invalidated when the
  *          TagValue gets destroyed or another value is assigned.
  * \remarks The raw data is not null terminated. See dataSize().
+ * \remarks If the data is shared (see isDataShared()) it is copied first so it can be modified without affecting
+ *          other values. Use the const overload to avoid the copy.
+ * \remarks If the data has not been loaded yet (see isDataLoaded()) it is loaded first.
  */
 inline char *TagValue::dataPointer()
 {
-    return m_ptr.get();
+    if (m_lazyData) {
+        loadData();
+    }
+    if (m_sharedData) {
+        detachSharedData();
+    }
+    return m_dataInline ? m_inlineData : m_ptr.get();
 }
 
 inline const char *TagValue::dataPointer() const
 {
+    if (m_lazyData) {
+        loadData();
+    }
+    return m_dataInline ? m_inlineData : (m_sharedData ? m_sharedData.get() : m_ptr.get());
+}
+
+/*!
+ * \brief Returns whether the data refers to a buffer which is shared with other values.
+ * \sa assignSharedData()
+ */
+inline bool TagValue::isDataShared() const
+{
+    return m_sharedData != nullptr;
+}
+
+/*!
+ * \brief Returns whether the data has been loaded.
+ * \remarks Returns only false if data has been assigned via assignLazyData() and has not been accessed since then.
+ * \sa loadData()
+ */
+inline bool TagValue::isDataLoaded() const
+{
+    return m_lazyData == nullptr;
+}
+
+/*!
+ * \brief Returns the data block assigned via assignLazyData() if the data has not been loaded yet; otherwise nullptr.
+ * \remarks This allows extracting big data such as cover art without loading it (see StreamDataBlock::extractTo()).
+ */
+inline const std::shared_ptr<const StreamDataBlock> &TagValue::lazyData() const
+{
+    return m_lazyData;
+}
+
+/*!
+ * \brief Makes room for \a size bytes of data discarding the currently assigned data.
+ * \returns Returns a pointer to the (uninitialized) memory the data is supposed to be written to.
+ * \remarks Data not exceeding inlineDataCapacity is stored inline so short values like numbers, dates and short
+ *          texts do not require a heap allocation.
+ */
+inline char *TagValue::allocateData(std::size_t size)
+{
+    m_size = size;
+    m_sharedData.reset();
+    m_lazyData.reset();
+    if ((m_dataInline = size <= inlineDataCapacity)) {
+        m_ptr.reset();
+        return m_inlineData;
+    }
+    m_ptr.reset(new char[size]);
     return m_ptr.get();
 }
 
@@ -747,7 +834,7 @@ std::vector<std::string> TagValue::toStrings(const ContainerType &values, TagTex
  */
 inline bool TagValue::compareData(const TagValue &other, bool ignoreCase) const
 {
-    return compareData(m_ptr.get(), m_size, other.m_ptr.get(), other.m_size, ignoreCase);
+    return compareData(dataPointer(), m_size, other.dataPointer(), other.m_size, ignoreCase);
 }
 
 /*!
@@ -0,0 +1,124 @@
+#include "./tailprobe.h"
+
+#include <c++utilities/conversion/binaryconversion.h>
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+/*!
+ * \class TagParser::TailProbe
+ * \brief The TailProbe struct holds the tags located at the end of a file found by reading the end of the file once.
+ *
+ * Various places need to know which tags are located at the end of a file, e.g. MediaFileInfo to parse the ID3v1 tag
+ * and MpegAudioFrameStream as well as AdtsStream to determine where the audio data ends. Probing the end of the file
+ * once and sharing the result avoids seeking to the end of the file multiple times which is expensive on remote
+ * storage.
+ *
+ * The following tags are detected (in the order they are usually located from the end of the file):
+ * - ID3v1 tag
+ * - Lyrics3 tag (version 1 and 2, only in front of an ID3v1 tag as required by the specification)
+ * - APEv2 tag (via its footer; in front of or behind the Lyrics3 tag)
+ *
+ * \sa MediaFileInfo::tailProbe()
+ */
+
+/*!
+ * \brief Probes the end of the specified \a stream reading at most the last TailProbe::maxSize bytes once.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ * \remarks The stream must be seekable.
+ */
+void TailProbe::probe(std::istream &stream)
+{
+    *this = TailProbe();
+    stream.seekg(0, ios_base::end);
+    fileSize = audioEndOffset = static_cast<std::uint64_t>(stream.tellg());
+    probed = true;
+    if (!fileSize) {
+        return;
+    }
+
+    // read the end of the file at once
+    const auto bufferSize = static_cast<std::size_t>(min<std::uint64_t>(maxSize, fileSize));
+    const auto bufferOffset = fileSize - bufferSize;
+    auto buffer = string(bufferSize, '\0');
+    stream.seekg(static_cast<streamoff>(bufferOffset), ios_base::beg);
+    stream.read(buffer.data(), static_cast<streamsize>(bufferSize));
+    // returns the buffered bytes at the specified file offset if the range is buffered completely
+    const auto bytesAt = [&](std::uint64_t offset, std::size_t count) -> const char * {
+        return offset >= bufferOffset && offset + count <= fileSize ? buffer.data() + (offset - bufferOffset) : nullptr;
+    };
+
+    // check for ID3v1 tag
+    auto &end = audioEndOffset;
+    if (const auto *const id3v1 = end >= 128 ? bytesAt(end - 128, 128) : nullptr; id3v1 && !memcmp(id3v1, "TAG", 3)) {
+        id3v1TagData.assign(id3v1, 128);
+        end -= 128;
+    }
+
+    // check for Lyrics3 and APEv2 tags in front of it
+    for (auto found = true; found;) {
+        found = false;
+        if (hasId3v1Tag() && !hasLyrics3Tag() && end >= 20) {
+            const auto *const lyrics3End = bytesAt(end - 9, 9);
+            if (lyrics3End && !memcmp(lyrics3End, "LYRICS200", 9)) {
+                // version 2: the size of the tag (excluding the size and "LYRICS200") precedes the end marker as 6 digits
+                const auto *const sizeDigits = bytesAt(end - 15, 6);
+                auto size = std::uint64_t();
+                auto validSize = sizeDigits != nullptr;
+                for (auto i = std::size_t(); validSize && i != 6; ++i) {
+                    if (sizeDigits[i] < '0' || sizeDigits[i] > '9') {
+                        validSize = false;
+                        break;
+                    }
+                    size = size * 10 + static_cast<std::uint64_t>(sizeDigits[i] - '0');
+                }
+                if (validSize && size >= 11 && size + 15 <= end) {
+                    const auto *const begin = bytesAt(end - size - 15, 11);
+                    if (!begin || !memcmp(begin, "LYRICSBEGIN", 11)) {
+                        lyrics3TagSize = size + 15;
+                    }
+                }
+            } else if (lyrics3End && !memcmp(lyrics3End, "LYRICSEND", 9)) {
+                // version 1: the tag has no size field but is limited to 5100 bytes of lyrics
+                const auto searchBegin = end - min<std::uint64_t>(end, 5100 + 11 + 9);
+                const auto *const searchArea = bytesAt(searchBegin, static_cast<std::size_t>(end - searchBegin));
+                if (searchArea) {
+                    const auto searchSize = static_cast<std::size_t>(end - searchBegin - 9);
+                    const auto *const searchEnd = searchArea + searchSize;
+                    const auto *const marker = "LYRICSBEGIN";
+                    const auto *const begin = find_end(searchArea, searchEnd, marker, marker + 11);
+                    if (begin != searchEnd) {
+                        lyrics3TagSize = static_cast<std::uint64_t>(searchArea + searchSize + 9 - begin);
+                    }
+                }
+            }
+            if (hasLyrics3Tag()) {
+                end = lyrics3TagOffset = end - lyrics3TagSize;
+                found = true;
+                continue;
+            }
+        }
+        if (!hasApeTag() && end >= 32) {
+            const auto *const footer = bytesAt(end - 32, 32);
+            if (footer && !memcmp(footer, "APETAGEX", 8)) {
+                // the size includes the footer but not the header
+                const auto size = static_cast<std::uint64_t>(LE::toUInt32(footer + 12));
+                const auto flags = LE::toUInt32(footer + 20);
+                const auto totalSize = size + ((flags & 0x80000000u) ? 32 : 0);
+                if (size >= 32 && totalSize <= end) {
+                    apeTagSize = totalSize;
+                    end = apeTagOffset = end - totalSize;
+                    found = true;
+                }
+            }
+        }
+    }
+}
+
+} // namespace TagParser
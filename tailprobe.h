@@ -0,0 +1,75 @@
+#ifndef TAG_PARSER_TAILPROBE_H
+#define TAG_PARSER_TAILPROBE_H
+
+#include "./global.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+namespace TagParser {
+
+struct TAG_PARSER_EXPORT TailProbe {
+    void probe(std::istream &stream);
+    bool hasId3v1Tag() const;
+    std::uint64_t id3v1TagOffset() const;
+    bool hasApeTag() const;
+    bool hasLyrics3Tag() const;
+
+    /// \brief The number of bytes read from the end of the file at most.
+    static constexpr std::size_t maxSize = 0x10000;
+
+    /// \brief Whether probe() has been called.
+    bool probed = false;
+    /// \brief The size of the file at the time probe() has been called.
+    std::uint64_t fileSize = 0;
+    /// \brief The offset the audio data ends at (in front of the tags located at the end of the file).
+    std::uint64_t audioEndOffset = 0;
+    /// \brief The 128 bytes of the ID3v1 tag; empty if there is no ID3v1 tag.
+    std::string id3v1TagData;
+    /// \brief The offset of the APEv2 tag (including its header if present).
+    std::uint64_t apeTagOffset = 0;
+    /// \brief The size of the APEv2 tag (including its header if present and its footer); zero if there is no APEv2 tag.
+    std::uint64_t apeTagSize = 0;
+    /// \brief The offset of the Lyrics3 tag.
+    std::uint64_t lyrics3TagOffset = 0;
+    /// \brief The size of the Lyrics3 tag; zero if there is no Lyrics3 tag.
+    std::uint64_t lyrics3TagSize = 0;
+};
+
+/*!
+ * \brief Returns whether an ID3v1 tag has been found.
+ */
+inline bool TailProbe::hasId3v1Tag() const
+{
+    return !id3v1TagData.empty();
+}
+
+/*!
+ * \brief Returns the offset of the ID3v1 tag.
+ * \remarks Only meaningful if hasId3v1Tag() returns true.
+ */
+inline std::uint64_t TailProbe::id3v1TagOffset() const
+{
+    return fileSize - 128;
+}
+
+/*!
+ * \brief Returns whether an APEv2 tag has been found.
+ */
+inline bool TailProbe::hasApeTag() const
+{
+    return apeTagSize != 0;
+}
+
+/*!
+ * \brief Returns whether a Lyrics3 tag (version 1 or 2) has been found.
+ */
+inline bool TailProbe::hasLyrics3Tag() const
+{
+    return lyrics3TagSize != 0;
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_TAILPROBE_H
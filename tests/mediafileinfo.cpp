@@ -1,16 +1,56 @@
 #include "./helper.h"
 
 #include "../abstracttrack.h"
+#include "../avc/avcconfiguration.h"
+#include "../batchparser.h"
+#include "../batchwriter.h"
+#include "../bytesource.h"
+#include "../exceptions.h"
+#include "../filerangecopier.h"
+#include "../flac/flacstream.h"
+#include "../id3/id3batchconverter.h"
+#include "../id3/id3v2tag.h"
+#include "../librarywatcher.h"
+#include "../matroska/matroskacontainer.h"
+#include "../matroska/matroskaid.h"
+#include "../matroska/matroskatag.h"
+#include "../matroska/matroskatagid.h"
 #include "../mediafileinfo.h"
+#include "../mediafileinfotask.h"
+#include "../mediafilesnapshot.h"
+#include "../mp4/mp4chapter.h"
+#include "../mp4/mp4container.h"
+#include "../mp4/mp4ids.h"
+#include "../mp4/mp4samplecursor.h"
+#include "../ogg/oggcontainer.h"
+#include "../ogg/oggiterator.h"
+#include "../parseresultcache.h"
+#include "../progressfeedback.h"
+#include "../seeklessoutputstream.h"
 #include "../tag.h"
+#include "../tagfieldfilter.h"
+#include "../tagfieldlist.h"
+#include "../tailprobe.h"
+#include "../trackcolumns.h"
+#include "../wav/riffinfotag.h"
+#include "../wav/waveaudiostream.h"
 
+#include <c++utilities/conversion/binaryconversion.h>
+#include <c++utilities/conversion/stringbuilder.h>
+#include <c++utilities/io/binaryreader.h>
+#include <c++utilities/io/misc.h>
 #include <c++utilities/tests/testutils.h>
 using namespace CppUtilities;
 
 #include <cppunit/TestFixture.h>
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <algorithm>
 #include <cstdio>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <tuple>
 
 using namespace std;
 using namespace CppUtilities::Literals;
@@ -28,6 +68,66 @@ class MediaFileInfoTests : public TestFixture {
     CPPUNIT_TEST(testFileSystemMethods);
     CPPUNIT_TEST(testParsingUnsupportedFile);
     CPPUNIT_TEST(testFullParseAndFurtherProperties);
+    CPPUNIT_TEST(testVisitors);
+    CPPUNIT_TEST(testMemoryMapping);
+    CPPUNIT_TEST(testParsingFromByteSource);
+    CPPUNIT_TEST(testParsingFlags);
+    CPPUNIT_TEST(testLazyParameterSetDecoding);
+    CPPUNIT_TEST(testTagFieldFilter);
+    CPPUNIT_TEST(testBatchParsing);
+    CPPUNIT_TEST(testTrackColumns);
+    CPPUNIT_TEST(testBatchWriting);
+    CPPUNIT_TEST(testId3BatchConversion);
+    CPPUNIT_TEST(testParseResultCache);
+    CPPUNIT_TEST(testLibraryWatcher);
+    CPPUNIT_TEST(testForcingInPlace);
+    CPPUNIT_TEST(testOggPageIndex);
+    CPPUNIT_TEST(testMatroskaSeekHeadFirst);
+    CPPUNIT_TEST(testMatroskaFullParseThreshold);
+    CPPUNIT_TEST(testMatroskaIndexValidation);
+    CPPUNIT_TEST(testMatroskaClusterValidation);
+    CPPUNIT_TEST(testMatroskaResync);
+    CPPUNIT_TEST(testMatroskaSegmentParsingThreads);
+    CPPUNIT_TEST(testMatroskaUnknownClusterSize);
+    CPPUNIT_TEST(testMatroskaTrackStatistics);
+    CPPUNIT_TEST(testMp4SampleTableValidation);
+    CPPUNIT_TEST(testMp4MovieAtomCompaction);
+    CPPUNIT_TEST(testElementTraversal);
+    CPPUNIT_TEST(testLazyPictures);
+    CPPUNIT_TEST(testSnapshot);
+    CPPUNIT_TEST(testStatistics);
+    CPPUNIT_TEST(testSkippingUnmodified);
+    CPPUNIT_TEST(testMemoryLimit);
+    CPPUNIT_TEST(testParseLimits);
+    CPPUNIT_TEST(testApplyChangesResult);
+    CPPUNIT_TEST(testPaddingPolicy);
+    CPPUNIT_TEST(testResumingParsing);
+#ifdef TAG_PARSER_HAS_COROUTINES
+    CPPUNIT_TEST(testStepwiseParsing);
+#endif
+    CPPUNIT_TEST(testForwardOnlyParsing);
+    CPPUNIT_TEST(testVirtualFile);
+    CPPUNIT_TEST(testSeeklessOutput);
+    CPPUNIT_TEST(testBlockShifting);
+    CPPUNIT_TEST(testBlockShiftingUndone);
+    CPPUNIT_TEST(testAppendedId3v2Tag);
+    CPPUNIT_TEST(testDataExtraction);
+    CPPUNIT_TEST(testTailProbe);
+    CPPUNIT_TEST(testBufferingMp4MovieAtom);
+    CPPUNIT_TEST(testParallelMp4TrackParsing);
+    CPPUNIT_TEST(testMp4FragmentIndex);
+    CPPUNIT_TEST(testMp4FragmentedRewrite);
+    CPPUNIT_TEST(testMp4Faststart);
+    CPPUNIT_TEST(testMp4SegmentIndexGeneration);
+    CPPUNIT_TEST(testMp4SampleCursor);
+    CPPUNIT_TEST(testMp4Chapters);
+    CPPUNIT_TEST(testBufferingMatroskaMasterElements);
+    CPPUNIT_TEST(testBufferingId3v2Tag);
+    CPPUNIT_TEST(testOggResync);
+    CPPUNIT_TEST(testOggChecksumVerification);
+    CPPUNIT_TEST(testMediaPayloadHash);
+    CPPUNIT_TEST(testFlacSeekTable);
+    CPPUNIT_TEST(testWaveTagWriting);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -40,6 +140,66 @@ public:
     void testPartialParsingAndTagCreationOfMp4File();
 
     void testFullParseAndFurtherProperties();
+    void testVisitors();
+    void testMemoryMapping();
+    void testParsingFromByteSource();
+    void testParsingFlags();
+    void testLazyParameterSetDecoding();
+    void testTagFieldFilter();
+    void testBatchParsing();
+    void testTrackColumns();
+    void testBatchWriting();
+    void testId3BatchConversion();
+    void testParseResultCache();
+    void testLibraryWatcher();
+    void testForcingInPlace();
+    void testOggPageIndex();
+    void testMatroskaSeekHeadFirst();
+    void testMatroskaFullParseThreshold();
+    void testMatroskaIndexValidation();
+    void testMatroskaClusterValidation();
+    void testMatroskaResync();
+    void testMatroskaSegmentParsingThreads();
+    void testMatroskaUnknownClusterSize();
+    void testMatroskaTrackStatistics();
+    void testMp4SampleTableValidation();
+    void testMp4MovieAtomCompaction();
+    void testElementTraversal();
+    void testLazyPictures();
+    void testSnapshot();
+    void testStatistics();
+    void testSkippingUnmodified();
+    void testMemoryLimit();
+    void testParseLimits();
+    void testApplyChangesResult();
+    void testPaddingPolicy();
+    void testResumingParsing();
+#ifdef TAG_PARSER_HAS_COROUTINES
+    void testStepwiseParsing();
+#endif
+    void testForwardOnlyParsing();
+    void testVirtualFile();
+    void testSeeklessOutput();
+    void testBlockShifting();
+    void testBlockShiftingUndone();
+    void testAppendedId3v2Tag();
+    void testDataExtraction();
+    void testTailProbe();
+    void testBufferingMp4MovieAtom();
+    void testParallelMp4TrackParsing();
+    void testMp4FragmentIndex();
+    void testMp4FragmentedRewrite();
+    void testMp4Faststart();
+    void testMp4SegmentIndexGeneration();
+    void testMp4SampleCursor();
+    void testMp4Chapters();
+    void testBufferingMatroskaMasterElements();
+    void testBufferingId3v2Tag();
+    void testOggResync();
+    void testOggChecksumVerification();
+    void testMediaPayloadHash();
+    void testFlacSeekTable();
+    void testWaveTagWriting();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(MediaFileInfoTests);
@@ -185,7 +345,3226 @@ void MediaFileInfoTests::testFullParseAndFurtherProperties()
     file.tracks().back()->setLocale(Locale("eng"sv, LocaleFormat::ISO_639_2_B));
     CPPUNIT_ASSERT_EQUAL(unordered_set<string>({ "eng" }), file.availableLanguages());
     CPPUNIT_ASSERT_EQUAL(unordered_set<string>({}), file.availableLanguages(MediaType::Text));
+    const auto languageIds = file.availableLanguageIds();
+    CPPUNIT_ASSERT_EQUAL(1_st, languageIds.size());
+    CPPUNIT_ASSERT(languageIds.front() == LocaleId::fromIsoCode("eng"));
+    CPPUNIT_ASSERT_EQUAL("eng"s, std::string(languageIds.front().isoCode()));
+    CPPUNIT_ASSERT_EQUAL("English"s, languageIds.front().name());
+    CPPUNIT_ASSERT(file.availableLanguageIds(MediaType::Text).empty());
+    CPPUNIT_ASSERT(LocaleId::fromIsoCode("ger") == Locale("deu"sv, LocaleFormat::ISO_639_2_T).id());
+    CPPUNIT_ASSERT(!LocaleId::fromIsoCode("und").isValid());
+    CPPUNIT_ASSERT(!Locale("de-DE"sv, LocaleFormat::BCP_47).id().isValid());
     CPPUNIT_ASSERT_EQUAL("ID: 2422994868, type: Video"s, file.tracks()[0]->label());
     CPPUNIT_ASSERT_EQUAL("ID: 3653291187, type: Audio, language: English"s, file.tracks()[1]->label());
     CPPUNIT_ASSERT_EQUAL("MS-MPEG-4-480p / MP3-2ch-eng"s, file.technicalSummary());
 }
+
+/*!
+ * \brief Tests whether the visitor functions yield the same elements as the functions returning lists.
+ */
+void MediaFileInfoTests::testVisitors()
+{
+    for (const auto *const testFile : { "matroska_wave1/test1.mkv", "mtx-test-data/mp3/id3-tag-and-xing-header.mp3" }) {
+        Diagnostics diag;
+        MediaFileInfo file(testFilePath(testFile));
+        file.open(true);
+        file.parseEverything(diag);
+
+        auto tracks = vector<AbstractTrack *>();
+        file.forEachTrack([&tracks](AbstractTrack &track) { tracks.push_back(&track); });
+        CPPUNIT_ASSERT(tracks == file.tracks());
+        auto tags = vector<Tag *>();
+        file.forEachTag([&tags](Tag &tag) { tags.push_back(&tag); });
+        CPPUNIT_ASSERT(!tags.empty());
+        CPPUNIT_ASSERT(tags == file.tags());
+        auto chapterCount = 0_st, attachmentCount = 0_st;
+        file.forEachChapter([&chapterCount](AbstractChapter &) { ++chapterCount; });
+        file.forEachAttachment([&attachmentCount](AbstractAttachment &) { ++attachmentCount; });
+        CPPUNIT_ASSERT_EQUAL(file.chapters().size(), chapterCount);
+        CPPUNIT_ASSERT_EQUAL(file.attachments().size(), attachmentCount);
+
+        // the records yielded by forEachField() match the records of a TagFieldList but point into the tags
+        const auto list = TagFieldList::fromTags(tags);
+        auto index = 0_st;
+        file.forEachField([&](Tag &tag, const TagFieldRecord &record) {
+            CPPUNIT_ASSERT(index < list->size());
+            const auto &expected = list->records()[index++];
+            CPPUNIT_ASSERT_EQUAL(tags[record.tagIndex], &tag);
+            CPPUNIT_ASSERT_EQUAL(expected.tagIndex, record.tagIndex);
+            CPPUNIT_ASSERT(expected.field == record.field);
+            CPPUNIT_ASSERT_EQUAL(expected.id, record.id);
+            CPPUNIT_ASSERT_EQUAL(expected.name, record.name);
+            CPPUNIT_ASSERT_EQUAL(expected.data, record.data);
+            CPPUNIT_ASSERT(expected.data.empty() || expected.data.data() != record.data.data());
+        });
+        CPPUNIT_ASSERT_EQUAL(list->size(), index);
+        CPPUNIT_ASSERT(index > 0);
+    }
+}
+
+void MediaFileInfoTests::testMemoryMapping()
+{
+    Diagnostics diag;
+    MediaFileInfo file(testFilePath("matroska_wave1/test1.mkv"));
+    CPPUNIT_ASSERT(!file.isMemoryMappingEnabled());
+    file.setMemoryMappingEnabled(true);
+    file.open(true);
+#ifdef PLATFORM_UNIX
+    CPPUNIT_ASSERT(file.isMapped());
+    CPPUNIT_ASSERT_EQUAL(file.size(), static_cast<std::uint64_t>(file.mappedData().size()));
+#endif
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.containerParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tagsParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tracksParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(2_st, file.trackCount());
+    CPPUNIT_ASSERT_EQUAL(1_st, file.matroskaTags().size());
+    CPPUNIT_ASSERT_EQUAL(Diagnostics(), diag);
+
+    // mapping is released when disabling it or closing the file
+    file.setMemoryMappingEnabled(false);
+    CPPUNIT_ASSERT(!file.isMapped());
+    file.setMemoryMappingEnabled(true);
+    file.reopen(true);
+    file.close();
+    CPPUNIT_ASSERT(!file.isMapped());
+}
+
+void MediaFileInfoTests::testParsingFromByteSource()
+{
+    const auto path = testFilePath("matroska_wave1/test1.mkv");
+    const auto data = readFile(path, 0x1000000);
+    Diagnostics diag;
+    MediaFileInfo file(path);
+    file.setByteSource(make_shared<MemoryByteSource>(data));
+    CPPUNIT_ASSERT(file.hasByteSource());
+    CPPUNIT_ASSERT(file.isOpen());
+    CPPUNIT_ASSERT(file.isMapped());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(data.size()), file.size());
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.containerParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tagsParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tracksParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(ContainerFormat::Matroska, file.containerFormat());
+    CPPUNIT_ASSERT_EQUAL(2_st, file.trackCount());
+    CPPUNIT_ASSERT_EQUAL(1_st, file.matroskaTags().size());
+    CPPUNIT_ASSERT_EQUAL(Diagnostics(), diag);
+    AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+    CPPUNIT_ASSERT_THROW(file.applyChanges(diag, progress), NotImplementedException);
+    diag.pop_back();
+
+    // reading buffered from a non-contiguous source yields the same results
+    struct ChunkedSource : public MemoryByteSource {
+        using MemoryByteSource::MemoryByteSource;
+        std::string_view contiguousData() const override
+        {
+            return std::string_view();
+        }
+    };
+    diag.clear();
+    file.setByteSource(make_shared<ChunkedSource>(data));
+    CPPUNIT_ASSERT(!file.isMapped());
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tracksParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(2_st, file.trackCount());
+    CPPUNIT_ASSERT_EQUAL(Diagnostics(), diag);
+
+    // reverting to the file
+    file.setByteSource(nullptr);
+    CPPUNIT_ASSERT(!file.hasByteSource());
+    CPPUNIT_ASSERT(!file.isOpen());
+}
+
+void MediaFileInfoTests::testParsingFlags()
+{
+    Diagnostics diag;
+    MediaFileInfo file(testFilePath("matroska_wave1/test1.mkv"));
+    file.setParsingFlags(ParsingFlags::QuickProbe);
+    file.open(true);
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.containerParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tagsParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tracksParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::NotParsedYet, file.chaptersParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::NotParsedYet, file.attachmentsParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(2_st, file.trackCount());
+
+    // skipped parts can be parsed later
+    file.setParsingFlags(ParsingFlags::None);
+    file.parseChapters(diag);
+    file.parseAttachments(diag);
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.chaptersParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.attachmentsParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(Diagnostics(), diag);
+
+    // limit parsing to the EBML header
+    file.clearParsingResults();
+    file.setMaxParsingOffset(1);
+    file.parseContainerFormat(diag);
+    CPPUNIT_ASSERT_EQUAL(ContainerFormat::Matroska, file.containerFormat());
+    CPPUNIT_ASSERT_EQUAL(1_st, diag.size());
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::Information, diag.level());
+}
+
+void MediaFileInfoTests::testLazyParameterSetDecoding()
+{
+    const auto videoTrack = [](MediaFileInfo &file) {
+        for (auto *const track : file.tracks()) {
+            if (track->mediaType() == MediaType::Video) {
+                return track;
+            }
+        }
+        CPPUNIT_FAIL("no video track found");
+        return static_cast<AbstractTrack *>(nullptr);
+    };
+    for (const auto *const testFile : { "mtx-test-data/mp4/1080p-DTS-HD-7.1.mp4", "matroska_wave1/test2.mkv" }) {
+        // parse the SPS/PPS right away to get the reference values
+        Diagnostics diag;
+        MediaFileInfo referenceFile(testFilePath(testFile));
+        referenceFile.open(true);
+        referenceFile.parseTracks(diag);
+        const auto *const referenceTrack = videoTrack(referenceFile);
+        CPPUNIT_ASSERT_EQUAL(GeneralMediaFormat::Avc, referenceTrack->format().general);
+        CPPUNIT_ASSERT(referenceTrack->chromaFormat());
+
+        // only keep the raw NAL units; profile and level are still taken from the AVC configuration itself
+        MediaFileInfo file(testFilePath(testFile));
+        file.setParsingFlags(ParsingFlags::LazyDecodeParameterSets);
+        file.open(true);
+        file.parseTracks(diag);
+        auto *const track = videoTrack(file);
+        CPPUNIT_ASSERT_EQUAL(referenceTrack->format().sub, track->format().sub);
+        CPPUNIT_ASSERT_EQUAL(referenceTrack->version(), track->version());
+        CPPUNIT_ASSERT(!track->chromaFormat());
+        auto *const mp4Track = dynamic_cast<Mp4Track *>(track);
+        if (mp4Track) {
+            const auto *const avcConfig = mp4Track->avcConfiguration();
+            CPPUNIT_ASSERT(avcConfig);
+            CPPUNIT_ASSERT(avcConfig->hasUndecodedParameterSets());
+            CPPUNIT_ASSERT(avcConfig->spsInfos.empty());
+            CPPUNIT_ASSERT(avcConfig->ppsInfos.empty());
+            mp4Track->decodeParameterSets(diag);
+            CPPUNIT_ASSERT(!avcConfig->hasUndecodedParameterSets());
+            CPPUNIT_ASSERT(!avcConfig->spsInfos.empty());
+        } else {
+            auto *const matroskaTrack = dynamic_cast<MatroskaTrack *>(track);
+            CPPUNIT_ASSERT(matroskaTrack);
+            matroskaTrack->decodeParameterSets(diag);
+        }
+
+        // decoding on request yields the same values as decoding right away
+        CPPUNIT_ASSERT_EQUAL(string(referenceTrack->chromaFormat()), string(track->chromaFormat()));
+        CPPUNIT_ASSERT_EQUAL(referenceTrack->pixelSize(), track->pixelSize());
+        CPPUNIT_ASSERT_EQUAL(referenceTrack->cropping().toString(), track->cropping().toString());
+        CPPUNIT_ASSERT_EQUAL(referenceTrack->pixelAspectRatio().toString(), track->pixelAspectRatio().toString());
+        CPPUNIT_ASSERT_EQUAL(referenceTrack->format().sub, track->format().sub);
+        CPPUNIT_ASSERT_EQUAL(referenceTrack->version(), track->version());
+
+        // decoding again is a no-op
+        if (mp4Track) {
+            mp4Track->decodeParameterSets(diag);
+        } else {
+            static_cast<MatroskaTrack *>(track)->decodeParameterSets(diag);
+        }
+        CPPUNIT_ASSERT_EQUAL(referenceTrack->pixelSize(), track->pixelSize());
+        CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+    }
+}
+
+void MediaFileInfoTests::testTagFieldFilter()
+{
+    for (const auto *const testFile : { "mtx-test-data/mp4/10-DanseMacabreOp.40.m4a", "mtx-test-data/mp3/id3-tag-and-xing-header.mp3",
+             "flac/test.flac", "matroska_wave1/test1.mkv" }) {
+        // parse all fields to get the reference values
+        Diagnostics diag;
+        AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+        MediaFileInfo referenceFile(testFilePath(testFile));
+        referenceFile.open(true);
+        referenceFile.parseEverything(diag);
+        const auto referenceTags = referenceFile.tags();
+        CPPUNIT_ASSERT(!referenceTags.empty());
+
+        // parse only the title (the fields of ID3v1 tags are fixed and hence not filtered)
+        const auto path = workingCopyPath(testFile);
+        const auto data = readFile(path, 0x1000000);
+        MediaFileInfo file(path);
+        file.setTagFieldFilter(TagFieldFilter{ KnownField::Title });
+        file.open();
+        file.parseEverything(diag);
+        CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tagsParsingStatus());
+        auto tags = file.tags();
+        CPPUNIT_ASSERT_EQUAL(referenceTags.size(), tags.size());
+        auto titleFound = false;
+        auto referenceFieldCount = 0u, fieldCount = 0u;
+        for (std::size_t i = 0; i != tags.size(); ++i) {
+            CPPUNIT_ASSERT_EQUAL(referenceTags[i]->type(), tags[i]->type());
+            if (tags[i]->type() == TagType::Id3v1Tag) {
+                continue;
+            }
+            const auto &title = tags[i]->value(KnownField::Title);
+            CPPUNIT_ASSERT_EQUAL(referenceTags[i]->value(KnownField::Title), title);
+            CPPUNIT_ASSERT(tags[i]->value(KnownField::Artist).isEmpty());
+            CPPUNIT_ASSERT(tags[i]->value(KnownField::Album).isEmpty());
+            CPPUNIT_ASSERT(tags[i]->fieldCount() <= referenceTags[i]->fieldCount());
+            titleFound = titleFound || !title.isEmpty();
+            referenceFieldCount += referenceTags[i]->fieldCount();
+            fieldCount += tags[i]->fieldCount();
+        }
+        CPPUNIT_ASSERT(titleFound);
+        CPPUNIT_ASSERT(fieldCount < referenceFieldCount);
+
+        // applying changes must be refused and leave the file untouched as the other fields are missing
+        tags.front()->setValue(KnownField::Title, TagValue("filtered title"s));
+        CPPUNIT_ASSERT_THROW(file.applyChanges(diag, progress), NotImplementedException);
+        file.close();
+        CPPUNIT_ASSERT(data == readFile(path, 0x1000000));
+
+        // parse all fields again when the filter has been cleared
+        file.setTagFieldFilter(TagFieldFilter());
+        file.clearParsingResults();
+        file.open(true);
+        file.parseEverything(diag);
+        tags = file.tags();
+        CPPUNIT_ASSERT_EQUAL(referenceTags.size(), tags.size());
+        for (std::size_t i = 0; i != tags.size(); ++i) {
+            CPPUNIT_ASSERT_EQUAL(referenceTags[i]->fieldCount(), tags[i]->fieldCount());
+            CPPUNIT_ASSERT_EQUAL(referenceTags[i]->value(KnownField::Artist), tags[i]->value(KnownField::Artist));
+        }
+        file.close();
+        std::remove(path.data());
+    }
+}
+
+void MediaFileInfoTests::testTrackColumns()
+{
+    const auto paths = std::vector<std::string>{ testFilePath("matroska_wave1/test1.mkv"), testFilePath("mtx-test-data/mp4/10-DanseMacabreOp.40.m4a"),
+        testFilePath("matroska_wave1/test2.mkv"), "/does/not/exist", testFilePath("mtx-test-data/ogg/qt4dance_medium.ogg") };
+    const auto checkStringColumn = [](const TrackStringColumn &column, std::size_t rowCount) {
+        CPPUNIT_ASSERT_EQUAL(rowCount, column.rowCount());
+        CPPUNIT_ASSERT_EQUAL(static_cast<std::int64_t>(0), column.offsets.front());
+        CPPUNIT_ASSERT_EQUAL(static_cast<std::int64_t>(column.data.size()), column.offsets.back());
+        CPPUNIT_ASSERT(std::is_sorted(column.offsets.cbegin(), column.offsets.cend()));
+    };
+
+    // exporting the tracks of a single file appends one row per track with the values returned by the getters
+    Diagnostics diag;
+    auto files = std::vector<std::unique_ptr<MediaFileInfo>>();
+    auto expectedColumns = TrackColumns();
+    for (std::size_t index = 0; index != paths.size(); ++index) {
+        auto &file = *files.emplace_back(std::make_unique<MediaFileInfo>(paths[index]));
+        if (index == 3) {
+            CPPUNIT_ASSERT_EQUAL(0_st, file.exportTrackColumns(expectedColumns, static_cast<std::uint32_t>(index)));
+            continue;
+        }
+        file.open(true);
+        file.parseContainerFormat(diag);
+        file.parseTracks(diag);
+        const auto rowCount = expectedColumns.rowCount();
+        CPPUNIT_ASSERT_EQUAL(file.trackCount(), file.exportTrackColumns(expectedColumns, static_cast<std::uint32_t>(index)));
+        const auto tracks = file.tracks();
+        CPPUNIT_ASSERT(!tracks.empty());
+        for (std::size_t i = 0; i != tracks.size(); ++i) {
+            const auto &track = *tracks[i];
+            const auto row = rowCount + i;
+            CPPUNIT_ASSERT_EQUAL(static_cast<std::uint32_t>(index), expectedColumns.fileIndex[row]);
+            CPPUNIT_ASSERT_EQUAL(track.id(), expectedColumns.id[row]);
+            CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(track.mediaType()), expectedColumns.mediaType[row]);
+            CPPUNIT_ASSERT_EQUAL(static_cast<std::uint16_t>(track.format().general), expectedColumns.generalFormat[row]);
+            CPPUNIT_ASSERT_EQUAL(track.format().sub, expectedColumns.subFormat[row]);
+            CPPUNIT_ASSERT_EQUAL(track.sampleCount(), expectedColumns.sampleCount[row]);
+            CPPUNIT_ASSERT_EQUAL(track.duration().totalTicks(), expectedColumns.durationTicks[row]);
+            CPPUNIT_ASSERT_EQUAL(track.samplingFrequency(), expectedColumns.samplingFrequency[row]);
+            CPPUNIT_ASSERT_EQUAL(track.pixelSize().width(), expectedColumns.pixelWidth[row]);
+            CPPUNIT_ASSERT_EQUAL(track.pixelSize().height(), expectedColumns.pixelHeight[row]);
+            CPPUNIT_ASSERT_EQUAL(std::string_view(track.formatId()), expectedColumns.formatId[row]);
+            CPPUNIT_ASSERT_EQUAL(std::string_view(track.name()), expectedColumns.name[row]);
+            CPPUNIT_ASSERT_EQUAL(
+                std::string_view(track.locale().abbreviatedName(LocaleFormat::BCP_47, LocaleFormat::ISO_639_2_B, LocaleFormat::Unknown)),
+                expectedColumns.language[row]);
+        }
+    }
+    checkStringColumn(expectedColumns.formatId, expectedColumns.rowCount());
+    checkStringColumn(expectedColumns.language, expectedColumns.rowCount());
+    checkStringColumn(expectedColumns.name, expectedColumns.rowCount());
+
+    // scanning the files in parallel yields the same rows (although the files are not necessarily in order) and nothing
+    // but the tracks is parsed
+    BatchParser parser(3);
+    auto columns = TrackColumns();
+    auto resultCount = 0_st;
+    parser.scanTrackColumns(paths, columns, [&](BatchParserResult &result) {
+        ++resultCount;
+        CPPUNIT_ASSERT_EQUAL(result.index == 3, static_cast<bool>(result.exception));
+        CPPUNIT_ASSERT_EQUAL(ParsingStatus::NotParsedYet, result.fileInfo->tagsParsingStatus());
+    });
+    CPPUNIT_ASSERT_EQUAL(paths.size(), resultCount);
+    CPPUNIT_ASSERT_EQUAL(expectedColumns.rowCount(), columns.rowCount());
+    checkStringColumn(columns.formatId, columns.rowCount());
+    checkStringColumn(columns.language, columns.rowCount());
+    checkStringColumn(columns.name, columns.rowCount());
+    for (std::size_t expectedRow = 0; expectedRow != expectedColumns.rowCount(); ++expectedRow) {
+        const auto fileIndex = expectedColumns.fileIndex[expectedRow];
+        const auto firstExpectedRow = static_cast<std::size_t>(
+            std::find(expectedColumns.fileIndex.cbegin(), expectedColumns.fileIndex.cend(), fileIndex) - expectedColumns.fileIndex.cbegin());
+        const auto firstRow
+            = static_cast<std::size_t>(std::find(columns.fileIndex.cbegin(), columns.fileIndex.cend(), fileIndex) - columns.fileIndex.cbegin());
+        const auto row = firstRow + (expectedRow - firstExpectedRow);
+        CPPUNIT_ASSERT(row < columns.rowCount());
+        CPPUNIT_ASSERT_EQUAL(fileIndex, columns.fileIndex[row]);
+        CPPUNIT_ASSERT_EQUAL(expectedColumns.id[expectedRow], columns.id[row]);
+        CPPUNIT_ASSERT_EQUAL(expectedColumns.trackType[expectedRow], columns.trackType[row]);
+        CPPUNIT_ASSERT_EQUAL(expectedColumns.generalFormat[expectedRow], columns.generalFormat[row]);
+        CPPUNIT_ASSERT_EQUAL(expectedColumns.sampleCount[expectedRow], columns.sampleCount[row]);
+        CPPUNIT_ASSERT_EQUAL(expectedColumns.durationTicks[expectedRow], columns.durationTicks[row]);
+        CPPUNIT_ASSERT_EQUAL(expectedColumns.formatId[expectedRow], columns.formatId[row]);
+        CPPUNIT_ASSERT_EQUAL(expectedColumns.language[expectedRow], columns.language[row]);
+        CPPUNIT_ASSERT_EQUAL(expectedColumns.name[expectedRow], columns.name[row]);
+    }
+
+    // clearing keeps the buffers so the columns can be reused for the next batch
+    const auto idCapacity = columns.id.capacity(), formatIdCapacity = columns.formatId.data.capacity();
+    columns.clear();
+    CPPUNIT_ASSERT_EQUAL(0_st, columns.rowCount());
+    checkStringColumn(columns.formatId, 0);
+    CPPUNIT_ASSERT_EQUAL(idCapacity, columns.id.capacity());
+    CPPUNIT_ASSERT_EQUAL(formatIdCapacity, columns.formatId.data.capacity());
+    parser.scanTrackColumns(paths, columns);
+    CPPUNIT_ASSERT_EQUAL(expectedColumns.rowCount(), columns.rowCount());
+}
+
+void MediaFileInfoTests::testBatchParsing()
+{
+    const auto paths = std::vector<std::string>{ testFilePath("matroska_wave1/test1.mkv"), testFilePath("mtx-test-data/mp4/10-DanseMacabreOp.40.m4a"),
+        testFilePath("matroska_wave1/test2.mkv"), "/does/not/exist", testFilePath("mtx-test-data/ogg/qt4dance_medium.ogg") };
+    auto results = std::vector<BatchParserResult>(paths.size());
+    auto resultCount = 0_st;
+    BatchParser parser(3);
+    parser.setParsingFlags(ParsingFlags::SkipAttachments);
+    parser.parse(paths, [&](BatchParserResult &result) {
+        ++resultCount;
+        results.at(result.index) = std::move(result);
+    });
+    CPPUNIT_ASSERT_EQUAL(paths.size(), resultCount);
+    for (std::size_t index = 0; index != paths.size(); ++index) {
+        const auto &result = results[index];
+        CPPUNIT_ASSERT_EQUAL(index, result.index);
+        CPPUNIT_ASSERT_EQUAL(paths[index], result.path);
+        CPPUNIT_ASSERT(result.fileInfo);
+        CPPUNIT_ASSERT(!result.fileInfo->isOpen());
+        CPPUNIT_ASSERT(result.fileInfo->parsingFlags() == ParsingFlags::SkipAttachments);
+        if (index == 3) {
+            CPPUNIT_ASSERT(result.exception);
+            CPPUNIT_ASSERT_EQUAL(DiagLevel::Critical, result.diag.level());
+            continue;
+        }
+        CPPUNIT_ASSERT(!result.exception);
+        CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, result.fileInfo->containerParsingStatus());
+        CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, result.fileInfo->tracksParsingStatus());
+        CPPUNIT_ASSERT(result.fileInfo->trackCount() > 0);
+    }
+
+    // adjusting the number of threads to the observed throughput yields the same results
+    parser.setAdaptiveParallelismEnabled(true);
+    resultCount = 0;
+    parser.parse(paths, [&](BatchParserResult &result) {
+        ++resultCount;
+        CPPUNIT_ASSERT_EQUAL(result.index == 3, static_cast<bool>(result.exception));
+        if (!result.exception) {
+            CPPUNIT_ASSERT_EQUAL(results[result.index].fileInfo->trackCount(), result.fileInfo->trackCount());
+#ifndef TAG_PARSER_NO_STATISTICS
+            CPPUNIT_ASSERT(result.fileInfo->statistics());
+            CPPUNIT_ASSERT(result.fileInfo->statistics()->readTime > std::chrono::nanoseconds::zero());
+#endif
+        }
+    });
+    CPPUNIT_ASSERT_EQUAL(paths.size(), resultCount);
+
+#ifdef PLATFORM_UNIX
+    // reading the heads and tails of the files upfront yields the same results
+    parser.setAsyncReadingEnabled(true);
+    parser.parse(paths, [&](BatchParserResult &result) {
+        CPPUNIT_ASSERT_EQUAL(result.index == 3, static_cast<bool>(result.exception));
+        if (!result.exception) {
+            CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, result.fileInfo->tracksParsingStatus());
+            CPPUNIT_ASSERT_EQUAL(results[result.index].fileInfo->trackCount(), result.fileInfo->trackCount());
+        }
+    });
+#endif
+}
+
+void MediaFileInfoTests::testBatchWriting()
+{
+    const auto paths = std::vector<std::string>{ workingCopyPath("matroska_wave1/test1.mkv"), workingCopyPath("matroska_wave1/test2.mkv"),
+        "/does/not/exist" };
+    auto results = std::vector<BatchWriterResult>(paths.size());
+    auto resultCount = 0_st;
+    BatchWriter writer(2);
+    CPPUNIT_ASSERT_EQUAL(BatchWriter::deviceId(paths[0]), BatchWriter::deviceId(paths[1]));
+    writer.apply(
+        paths,
+        [](MediaFileInfo &fileInfo, Diagnostics &) {
+            // the comment of the second file does not fit into the padding so it must be rewritten
+            CPPUNIT_ASSERT(fileInfo.createAppropriateTags());
+            auto *const tag = fileInfo.tags().front();
+            tag->setValue(KnownField::Title, TagValue("batch"s));
+            if (fileInfo.path().find("test2") != std::string::npos) {
+                tag->setValue(KnownField::Comment, TagValue(std::string(0x100000, 'x')));
+            }
+        },
+        [&](BatchWriterResult &result) {
+            ++resultCount;
+            results.at(result.index) = std::move(result);
+        });
+    CPPUNIT_ASSERT_EQUAL(paths.size(), resultCount);
+    CPPUNIT_ASSERT(results[2].exception);
+    CPPUNIT_ASSERT(!results[1].exception);
+    CPPUNIT_ASSERT(results[1].rewritten);
+    for (std::size_t index = 0; index != 2; ++index) {
+        const auto &result = results[index];
+        CPPUNIT_ASSERT(!result.exception);
+        CPPUNIT_ASSERT(result.diag.level() <= DiagLevel::Warning);
+        Diagnostics diag;
+        MediaFileInfo file(result.path);
+        file.open(true);
+        file.parseTags(diag);
+        CPPUNIT_ASSERT(!file.tags().empty());
+        CPPUNIT_ASSERT_EQUAL("batch"s, file.tags().front()->value(KnownField::Title).toString());
+        std::remove((result.path + ".bak").data());
+        std::remove(result.path.data());
+    }
+}
+
+void MediaFileInfoTests::testId3BatchConversion()
+{
+    // parse the file to get the reference values
+    Diagnostics diag;
+    MediaFileInfo referenceFile(testFilePath("mtx-test-data/mp3/id3-tag-and-xing-header.mp3"));
+    referenceFile.open(true);
+    referenceFile.parseEverything(diag);
+    CPPUNIT_ASSERT(referenceFile.id3v1Tag());
+    CPPUNIT_ASSERT_EQUAL(1_st, referenceFile.id3v2Tags().size());
+    const auto artist = referenceFile.id3v2Tags().front()->value(KnownField::Artist);
+    CPPUNIT_ASSERT(!artist.isEmpty());
+    const auto mediaDataOffset = referenceFile.containerOffset();
+    const auto data = readFile(referenceFile.path(), 0x1000000);
+    CPPUNIT_ASSERT(mediaDataOffset > 0);
+    CPPUNIT_ASSERT(data.size() > static_cast<std::size_t>(mediaDataOffset) + 128);
+    referenceFile.close();
+
+    // convert a copy of the file to ID3v2.4 removing the ID3v1 tag; a second copy gets a comment which does not fit
+    // into the padding so it must be left untouched and a non-existent file must be reported as such
+    const auto path = workingCopyPath("mtx-test-data/mp3/id3-tag-and-xing-header.mp3"), tooBigPath = path + ".too-big.mp3";
+    {
+        std::ofstream(tooBigPath, ios_base::out | ios_base::trunc | ios_base::binary).write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+    const auto paths = std::vector<std::string>{ path, tooBigPath, "/does/not/exist" };
+    auto settings = TagCreationSettings();
+    settings.id3v1usage = TagUsage::Never;
+    settings.id3v2MajorVersion = 4;
+    settings.flags -= TagCreationFlags::KeepExistingId3v2Version;
+    auto converter = Id3BatchConverter(settings, 2);
+    converter.setTransformCallback([](Id3BatchConverterResult &result) {
+        CPPUNIT_ASSERT_EQUAL(1_st, result.id3v2Tags.size());
+        CPPUNIT_ASSERT(!result.id3v1Tag);
+        result.id3v2Tags.front()->setValue(KnownField::Title, TagValue("batch conversion"s));
+        if (result.index == 1) {
+            result.id3v2Tags.front()->setValue(KnownField::Comment, TagValue(std::string(static_cast<std::size_t>(result.id3v2RegionSize), 'x')));
+        }
+    });
+    auto results = std::vector<Id3BatchConverterResult>(paths.size());
+    auto resultCount = 0_st;
+    converter.convert(paths, [&](Id3BatchConverterResult &result) {
+        ++resultCount;
+        results.at(result.index) = std::move(result);
+    });
+    CPPUNIT_ASSERT_EQUAL(paths.size(), resultCount);
+    CPPUNIT_ASSERT(!results[0].exception);
+    CPPUNIT_ASSERT(results[0].hadId3v1Tag);
+    CPPUNIT_ASSERT(results[0].modified);
+    CPPUNIT_ASSERT(!results[0].rewriteRequired);
+    CPPUNIT_ASSERT_EQUAL(mediaDataOffset, results[0].id3v2RegionSize);
+    CPPUNIT_ASSERT(results[0].diag.level() <= DiagLevel::Information);
+    CPPUNIT_ASSERT(!results[1].exception);
+    CPPUNIT_ASSERT(!results[1].modified);
+    CPPUNIT_ASSERT(results[1].rewriteRequired);
+    CPPUNIT_ASSERT(results[2].exception);
+    CPPUNIT_ASSERT(!results[2].modified);
+
+    // the converted file has only an ID3v2.4 tag at the same offset and the same media data
+    const auto convertedData = readFile(path, 0x1000000);
+    CPPUNIT_ASSERT_EQUAL(data.size() - 128, convertedData.size());
+    CPPUNIT_ASSERT(convertedData.compare(static_cast<std::size_t>(mediaDataOffset), std::string::npos, data,
+                       static_cast<std::size_t>(mediaDataOffset), data.size() - 128 - static_cast<std::size_t>(mediaDataOffset))
+        == 0);
+    MediaFileInfo file(path);
+    file.open(true);
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT(!file.id3v1Tag());
+    CPPUNIT_ASSERT_EQUAL(1_st, file.id3v2Tags().size());
+    const auto &id3v2Tag = file.id3v2Tags().front();
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(4), id3v2Tag->majorVersion());
+    CPPUNIT_ASSERT_EQUAL("batch conversion"s, id3v2Tag->value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL(artist.toString(), id3v2Tag->value(KnownField::Artist).toString());
+    CPPUNIT_ASSERT_EQUAL(mediaDataOffset, file.containerOffset());
+    file.close();
+
+    // the file whose tag does not fit is untouched
+    CPPUNIT_ASSERT(data == readFile(tooBigPath, 0x1000000));
+    std::remove(path.data());
+    std::remove(tooBigPath.data());
+}
+
+void MediaFileInfoTests::testParseResultCache()
+{
+    Diagnostics diag;
+    const auto path = testFilePath("matroska_wave1/test1.mkv");
+    ParseResultCache cache;
+    auto cacheHit = true;
+    const auto parsed = cache.parse(path, diag, ParsingFlags::None, &cacheHit);
+    CPPUNIT_ASSERT(!cacheHit);
+    CPPUNIT_ASSERT_EQUAL(1_st, cache.size());
+    CPPUNIT_ASSERT_EQUAL(ContainerFormat::Matroska, parsed.containerFormat);
+    CPPUNIT_ASSERT_EQUAL(2_st, parsed.tracks.size());
+    CPPUNIT_ASSERT_EQUAL(1_st, parsed.tags.size());
+    CPPUNIT_ASSERT(!parsed.tags.front().fields.empty());
+
+    // results survive a save/load round trip and are used without parsing the file again
+    std::stringstream buffer(std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+    cache.save(buffer);
+    ParseResultCache loadedCache;
+    loadedCache.load(buffer, diag);
+    CPPUNIT_ASSERT_EQUAL(Diagnostics(), diag);
+    CPPUNIT_ASSERT_EQUAL(1_st, loadedCache.size());
+    const auto cached = loadedCache.parse(path, diag, ParsingFlags::None, &cacheHit);
+    CPPUNIT_ASSERT(cacheHit);
+    CPPUNIT_ASSERT_EQUAL(parsed.mimeType, cached.mimeType);
+    CPPUNIT_ASSERT_EQUAL(parsed.duration, cached.duration);
+    CPPUNIT_ASSERT_EQUAL(parsed.tracks.size(), cached.tracks.size());
+    CPPUNIT_ASSERT_EQUAL(parsed.tracks.front().id, cached.tracks.front().id);
+    CPPUNIT_ASSERT_EQUAL(parsed.tags.front().fields.front().value, cached.tags.front().fields.front().value);
+
+    // entries are not used when the identity changes
+    auto identity = loadedCache.identify(path);
+    CPPUNIT_ASSERT(loadedCache.find(path, identity).has_value());
+    identity.size += 1;
+    CPPUNIT_ASSERT(!loadedCache.find(path, identity).has_value());
+
+    // invalid cache files are ignored
+    std::stringstream invalid("foo");
+    loadedCache.load(invalid, diag);
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::Warning, diag.level());
+
+    // results including the tag fields can be serialized and deserialized without copying the tag fields
+    MediaFileInfo file(path);
+    file.open(true);
+    file.parseEverything(diag);
+    const auto result = CachedParseResult::fromFileInfo(file, true);
+    CPPUNIT_ASSERT(result.tagFields && !result.tagFields->isEmpty());
+    const auto serialized = std::make_shared<const std::string>(result.serialize());
+    const auto deserialized = CachedParseResult::deserialize(serialized->data(), serialized->size(), serialized);
+    CPPUNIT_ASSERT_EQUAL(result.tracks.size(), deserialized.tracks.size());
+    CPPUNIT_ASSERT_EQUAL(result.tags.front().fields.size(), deserialized.tags.front().fields.size());
+    CPPUNIT_ASSERT(deserialized.tagFields);
+    CPPUNIT_ASSERT_EQUAL(result.tagFields->size(), deserialized.tagFields->size());
+    const auto &record = deserialized.tagFields->records().front();
+    CPPUNIT_ASSERT_EQUAL(result.tagFields->records().front().name, record.name);
+    CPPUNIT_ASSERT_EQUAL(result.tagFields->records().front().data, record.data);
+    CPPUNIT_ASSERT(record.name.data() >= serialized->data() && record.name.data() < serialized->data() + serialized->size());
+    CPPUNIT_ASSERT_THROW(CachedParseResult::deserialize(serialized->data(), serialized->size() - 1), TruncatedDataException);
+    CPPUNIT_ASSERT_THROW(CachedParseResult::deserialize("foo", 3), TruncatedDataException);
+}
+
+void MediaFileInfoTests::testLibraryWatcher()
+{
+    if (!LibraryWatcher::isSupported()) {
+        return;
+    }
+    Diagnostics diag;
+    AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+    const auto path = workingCopyPath("matroska_wave1/test1.mkv");
+    ParseResultCache cache;
+    cache.parse(path, diag);
+    LibraryWatcher watcher(cache);
+    CPPUNIT_ASSERT(watcher.watch(BasicFileInfo::containingDirectory(path), diag));
+    CPPUNIT_ASSERT(watcher.watchCount() >= 1);
+    watcher.readChanges();
+    BatchParser parser(1);
+    auto parsedPaths = std::vector<std::string>();
+    const auto collectParsedPaths = [&parsedPaths](BatchParserResult &result) { parsedPaths.emplace_back(result.path); };
+    const auto contains = [](const std::vector<std::string> &paths, const std::string &path) {
+        return std::find(paths.cbegin(), paths.cend(), path) != paths.cend();
+    };
+
+    // changes applied in-process update the cache directly so the file is not parsed again
+    MediaFileInfo file(path);
+    file.setParseResultCache(&cache);
+    file.setBackupDirectory(std::string());
+    file.open();
+    file.parseEverything(diag);
+    file.tags().front()->setValue(KnownField::Title, TagValue("watched"));
+    file.applyChanges(diag, progress);
+    file.close();
+    auto changes = watcher.readChanges(1000);
+    CPPUNIT_ASSERT(contains(changes.changedPaths, path));
+    watcher.refresh(changes, parser, collectParsedPaths);
+    CPPUNIT_ASSERT(!contains(parsedPaths, path));
+    const auto cached = cache.find(path, cache.identify(path));
+    CPPUNIT_ASSERT(cached.has_value());
+    CPPUNIT_ASSERT(std::any_of(cached->tags.cbegin(), cached->tags.cend(), [](const CachedTag &tag) {
+        return std::any_of(tag.fields.cbegin(), tag.fields.cend(),
+            [](const CachedTagField &field) { return field.field == KnownField::Title && field.value == "watched"; });
+    }));
+
+    // files created by others are parsed
+    const auto otherPath = workingCopyPath("matroska_wave1/test2.mkv");
+    changes = watcher.readChanges(1000);
+    CPPUNIT_ASSERT(contains(changes.changedPaths, otherPath));
+    parsedPaths.clear();
+    watcher.refresh(changes, parser, collectParsedPaths);
+    CPPUNIT_ASSERT(contains(parsedPaths, otherPath));
+    CPPUNIT_ASSERT(cache.find(otherPath, cache.identify(otherPath)).has_value());
+
+    // entries of removed files are removed
+    CPPUNIT_ASSERT_EQUAL(0, std::remove(otherPath.data()));
+    changes = watcher.readChanges(1000);
+    CPPUNIT_ASSERT(contains(changes.removedPaths, otherPath));
+    watcher.refresh(changes, parser);
+    CPPUNIT_ASSERT(!cache.find(otherPath, FileIdentity()).has_value());
+    CPPUNIT_ASSERT(!cache.remove(otherPath));
+
+    watcher.unwatchAll();
+    CPPUNIT_ASSERT_EQUAL(0_st, watcher.watchCount());
+    CPPUNIT_ASSERT_EQUAL(0, std::remove(path.data()));
+    std::remove((path + ".bak").data());
+}
+
+void MediaFileInfoTests::testForcingInPlace()
+{
+    Diagnostics diag;
+    AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+    MediaFileInfo file(workingCopyPath("matroska_wave1/test1.mkv"));
+    file.setForceInPlace(true);
+    file.open();
+    file.parseEverything(diag);
+    const auto originalSize = file.size();
+
+    // a tag which does not fit into the existing padding must not lead to a rewrite
+    CPPUNIT_ASSERT(file.createAppropriateTags());
+    file.tags().front()->setValue(KnownField::Comment, TagValue(std::string(0x100000, 'x')));
+    CPPUNIT_ASSERT_THROW(file.applyChanges(diag, progress), RewriteRequiredException);
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::Critical, diag.level());
+
+    // the file has not been touched
+    diag.clear();
+    file.open(true);
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT_EQUAL(originalSize, file.size());
+    CPPUNIT_ASSERT_EQUAL(-1, std::remove((file.path() + ".bak").data()));
+
+    // applying changes in-place can not be combined with a save file path
+    file.setSaveFilePath(file.path() + ".new");
+    CPPUNIT_ASSERT_THROW(file.applyChanges(diag, progress), RewriteRequiredException);
+    std::remove(file.path().data());
+}
+
+void MediaFileInfoTests::testOggPageIndex()
+{
+    // parse all pages to get the reference values
+    Diagnostics diag;
+    MediaFileInfo file(testFilePath("mtx-test-data/opus/v-opus.ogg"));
+    file.setForceFullParse(true);
+    file.open(true);
+    file.parseContainerFormat(diag);
+    file.parseTracks(diag);
+    CPPUNIT_ASSERT_EQUAL(ContainerFormat::Ogg, file.containerFormat());
+    const auto pages = static_cast<OggContainer *>(file.container())->pageIndex().entries();
+    CPPUNIT_ASSERT(pages.size() > 10);
+    const auto duration = file.duration();
+    const auto serialNumber = pages.front().streamSerialNumber;
+    file.close();
+
+    // probe the last page via the index when the pages have not been fetched completely
+    MediaFileInfo limitedFile(file.path());
+    limitedFile.setMaxParsingOffset(0x1000);
+    limitedFile.open(true);
+    limitedFile.parseContainerFormat(diag);
+    limitedFile.parseTracks(diag);
+    CPPUNIT_ASSERT_EQUAL(duration, limitedFile.duration());
+    auto &index = static_cast<OggContainer *>(limitedFile.container())->pageIndex();
+    const auto lastPage = index.lastPage(serialNumber);
+    CPPUNIT_ASSERT(lastPage.has_value());
+    CPPUNIT_ASSERT_EQUAL(pages.back().offset, lastPage->offset);
+    CPPUNIT_ASSERT_EQUAL(pages.back().granulePosition, lastPage->granulePosition);
+
+    // find pages by granule position via bisection
+    for (const auto &page : { pages[pages.size() / 3], pages[pages.size() / 2], pages[pages.size() - 2] }) {
+        const auto foundPage = index.findPage(serialNumber, page.granulePosition);
+        CPPUNIT_ASSERT(foundPage.has_value());
+        CPPUNIT_ASSERT_EQUAL(page.granulePosition, foundPage->granulePosition);
+        CPPUNIT_ASSERT(foundPage->offset <= page.offset);
+    }
+    CPPUNIT_ASSERT(!index.findPage(serialNumber, pages.back().granulePosition + 1).has_value());
+
+    // persist the index and restore it
+    stringstream buffer(ios_base::in | ios_base::out | ios_base::binary);
+    index.save(buffer);
+    OggPageIndex restoredIndex(limitedFile.stream(), index.startOffset(), index.streamSize());
+    CPPUNIT_ASSERT(restoredIndex.load(buffer, diag));
+    CPPUNIT_ASSERT_EQUAL(index.entries().size(), restoredIndex.entries().size());
+    OggPageIndex otherIndex(limitedFile.stream(), index.startOffset(), index.streamSize() + 1);
+    buffer.seekg(0);
+    CPPUNIT_ASSERT(!otherIndex.load(buffer, diag));
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::Warning, diag.level());
+}
+
+void MediaFileInfoTests::testMatroskaSeekHeadFirst()
+{
+    // tracks and tags are found without walking through clusters
+    Diagnostics diag;
+    MediaFileInfo file(testFilePath("matroska_wave1/test1.mkv"));
+    file.setMatroskaParseStrategy(MatroskaParseStrategy::SeekHeadFirst);
+    file.setMatroskaClusterScanBudget(0);
+    file.open(true);
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.containerParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tagsParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tracksParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(2_st, file.trackCount());
+    CPPUNIT_ASSERT_EQUAL(1_st, file.matroskaTags().size());
+    CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+}
+
+void MediaFileInfoTests::testMatroskaFullParseThreshold()
+{
+    // the threshold is initialized from the global default but can be set per file
+    MediaFileInfo file(testFilePath("matroska_wave1/test1.mkv"));
+    CPPUNIT_ASSERT_EQUAL(MatroskaContainer::maxFullParseSize(), file.matroskaMaxFullParseSize());
+    file.setMatroskaMaxFullParseSize(0);
+    CPPUNIT_ASSERT_EQUAL(0_uint64, file.matroskaMaxFullParseSize());
+
+    // parsing with a generous time budget walks through the clusters if required
+    Diagnostics diag;
+    file.setMatroskaFullParseTimeBudget(TimeSpan::fromMinutes(10.0));
+    file.open(true);
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tagsParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(2_st, file.trackCount());
+    CPPUNIT_ASSERT_EQUAL(1_st, file.matroskaTags().size());
+    CPPUNIT_ASSERT_EQUAL(Diagnostics(), diag);
+}
+
+void MediaFileInfoTests::testMatroskaIndexValidation()
+{
+    MediaFileInfo file(testFilePath("matroska_wave1/test1.mkv"));
+    Diagnostics diag;
+    file.open(true);
+    file.parseContainerFormat(diag);
+    auto *const container = dynamic_cast<MatroskaContainer *>(file.container());
+    CPPUNIT_ASSERT(container);
+
+    // the full validation and the sampled validation agree on a valid index
+    container->validateIndex(diag);
+    CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+    diag.clear();
+    container->validateIndexSample(diag, 0.99, 0.05);
+    CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+    diag.clear();
+    container->validateIndexSample(diag, 1.0);
+    CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+
+    // streaming validation is opt-in
+    CPPUNIT_ASSERT(!container->isStreamingIndexValidationEnabled());
+    container->setStreamingIndexValidationEnabled(true);
+    CPPUNIT_ASSERT(container->isStreamingIndexValidationEnabled());
+}
+
+void MediaFileInfoTests::testMatroskaClusterValidation()
+{
+    const auto path = workingCopyPath("matroska_wave1/test1.mkv");
+    MediaFileInfo file(path);
+    Diagnostics diag;
+
+    // a valid file passes when reading via a file descriptor and from the memory-mapped file, regardless of the number of threads
+    for (const auto mapping : { false, true }) {
+        file.setMemoryMappingEnabled(mapping);
+        file.open(true);
+        file.parseContainerFormat(diag);
+        auto *const container = dynamic_cast<MatroskaContainer *>(file.container());
+        CPPUNIT_ASSERT(container);
+        for (const auto threadCount : { 1_st, 4_st }) {
+            diag.clear();
+            container->validateClusters(diag, threadCount);
+            CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+        }
+        file.close();
+        file.clearParsingResults();
+    }
+
+    // break the ID of the second child of the first cluster
+    file.setMemoryMappingEnabled(false);
+    file.open(true);
+    file.parseContainerFormat(diag);
+    auto *container = dynamic_cast<MatroskaContainer *>(file.container());
+    CPPUNIT_ASSERT(container);
+    auto *const cluster = container->firstElement()->subelementByPath(diag, MatroskaIds::Segment, MatroskaIds::Cluster);
+    CPPUNIT_ASSERT(cluster);
+    CPPUNIT_ASSERT(cluster->firstChild());
+    CPPUNIT_ASSERT(cluster->firstChild()->nextSibling());
+    const auto brokenOffset = cluster->firstChild()->nextSibling()->startOffset();
+    file.close();
+    file.clearParsingResults();
+    {
+        std::fstream stream(path, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+        stream.seekp(static_cast<std::streamoff>(brokenOffset));
+        stream.put('\0');
+    }
+
+    // the defect is reported regardless of the number of threads
+    file.open(true);
+    file.parseContainerFormat(diag);
+    container = dynamic_cast<MatroskaContainer *>(file.container());
+    CPPUNIT_ASSERT(container);
+    for (const auto threadCount : { 1_st, 4_st }) {
+        diag.clear();
+        container->validateClusters(diag, threadCount);
+        CPPUNIT_ASSERT_EQUAL(DiagLevel::Critical, diag.level());
+        CPPUNIT_ASSERT(std::any_of(diag.cbegin(), diag.cend(), [brokenOffset](const DiagMessage &message) {
+            return message.message().find(numberToString(brokenOffset)) != std::string::npos;
+        }));
+    }
+    file.close();
+    std::remove(path.data());
+}
+
+void MediaFileInfoTests::testMatroskaResync()
+{
+    const auto path = workingCopyPath("matroska_wave1/test1.mkv");
+    MediaFileInfo file(path);
+    Diagnostics diag;
+    const auto parseLevel1Elements = [&file, &diag] {
+        file.open(true);
+        file.parseContainerFormat(diag);
+        auto *const container = dynamic_cast<MatroskaContainer *>(file.container());
+        CPPUNIT_ASSERT(container);
+        auto *const segment = container->firstElement()->siblingById(MatroskaIds::Segment, diag);
+        CPPUNIT_ASSERT(segment);
+        auto elements = std::vector<std::pair<std::uint32_t, std::uint64_t>>();
+        for (auto *element = segment->firstChild(); element; element = element->nextSibling()) {
+            element->parse(diag);
+            elements.emplace_back(element->id(), element->startOffset());
+        }
+        file.close();
+        file.clearParsingResults();
+        return elements;
+    };
+    const auto isLevel1Id = [](std::uint32_t id) {
+        switch (id) {
+        case EbmlIds::Header:
+        case MatroskaIds::Segment:
+        case MatroskaIds::SegmentInfo:
+        case MatroskaIds::Tracks:
+        case MatroskaIds::Cues:
+        case MatroskaIds::Tags:
+        case MatroskaIds::SeekHead:
+        case MatroskaIds::Cluster:
+        case MatroskaIds::Attachments:
+        case MatroskaIds::Chapters:
+            return true;
+        default:
+            return false;
+        }
+    };
+
+    // break the ID of a level 1 element followed by another level 1 element within the skipping limit; the bytes between
+    // the two must not contain the ID of a level 1 element itself so the scan is expected to stop at the next element
+    const auto referenceElements = parseLevel1Elements();
+    CPPUNIT_ASSERT_EQUAL(Diagnostics(), diag);
+    CPPUNIT_ASSERT(referenceElements.size() > 2);
+    auto brokenIndex = referenceElements.size();
+    auto input = std::ifstream(path, std::ios_base::in | std::ios_base::binary);
+    for (std::size_t i = 0; i + 1 < referenceElements.size() && brokenIndex == referenceElements.size(); ++i) {
+        const auto begin = referenceElements[i].second, end = referenceElements[i + 1].second;
+        if (end - begin >= EbmlElement::bytesToBeSkipped) {
+            continue;
+        }
+        auto data = std::string(static_cast<std::size_t>(end - begin + 3), '\0');
+        input.seekg(static_cast<std::streamoff>(begin));
+        input.read(data.data(), static_cast<std::streamsize>(data.size()));
+        brokenIndex = i;
+        for (std::size_t offset = 1; offset != data.size() - 3; ++offset) {
+            if (isLevel1Id(BE::toUInt32(data.data() + offset))) {
+                brokenIndex = referenceElements.size();
+                break;
+            }
+        }
+    }
+    CPPUNIT_ASSERT(brokenIndex < referenceElements.size());
+    const auto brokenOffset = referenceElements[brokenIndex].second;
+    const auto skippedBytes = referenceElements[brokenIndex + 1].second - brokenOffset;
+    {
+        std::fstream stream(path, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+        stream.seekp(static_cast<std::streamoff>(brokenOffset));
+        stream.put('\0');
+    }
+
+    // parsing resumes at the next level 1 element, no matter whether the file is scanned from the stream or the mapping
+    auto expectedElements = referenceElements;
+    expectedElements.erase(expectedElements.begin() + static_cast<std::ptrdiff_t>(brokenIndex));
+    const auto skippedMessage = argsToString(skippedBytes, " bytes have been skipped");
+    for (const auto mapping : { false, true }) {
+        file.setMemoryMappingEnabled(mapping);
+        diag.clear();
+        CPPUNIT_ASSERT(expectedElements == parseLevel1Elements());
+        CPPUNIT_ASSERT_EQUAL(DiagLevel::Critical, diag.level());
+        CPPUNIT_ASSERT(std::any_of(diag.cbegin(), diag.cend(), [&skippedMessage](const DiagMessage &message) {
+            return message.level() == DiagLevel::Warning && message.message() == skippedMessage;
+        }));
+    }
+    std::remove(path.data());
+}
+
+void MediaFileInfoTests::testMatroskaSegmentParsingThreads()
+{
+    // concatenate two files to get a file with two segments
+    const auto segmentFiles = { testFilePath("matroska_wave1/test1.mkv"), testFilePath("matroska_wave1/test2.mkv") };
+    const auto path = workingCopyPath("matroska_wave1/test1.mkv");
+    {
+        std::ofstream output(path, ios_base::out | ios_base::trunc | ios_base::binary);
+        for (const auto &segmentFile : segmentFiles) {
+            output << std::ifstream(segmentFile, ios_base::in | ios_base::binary).rdbuf();
+        }
+        CPPUNIT_ASSERT(output.good());
+    }
+
+    // gather the track IDs and the number of tags of the files on their own
+    Diagnostics diag;
+    auto expectedTrackIds = std::vector<std::uint64_t>();
+    auto expectedTagCount = 0_st;
+    for (const auto &segmentFile : segmentFiles) {
+        MediaFileInfo file(segmentFile);
+        file.open(true);
+        file.parseEverything(diag);
+        for (const auto *const track : file.tracks()) {
+            expectedTrackIds.emplace_back(track->id());
+        }
+        expectedTagCount += file.matroskaTags().size();
+    }
+    CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+
+    const auto parse = [&path](bool mapping, std::size_t threadCount, Diagnostics &diag) {
+        MediaFileInfo file(path);
+        CPPUNIT_ASSERT_EQUAL(1_st, file.matroskaSegmentParsingThreadCount());
+        file.setMemoryMappingEnabled(mapping);
+        file.setMatroskaSegmentParsingThreadCount(threadCount);
+        file.open(true);
+        file.parseEverything(diag);
+        CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.containerParsingStatus());
+        CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tracksParsingStatus());
+        CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tagsParsingStatus());
+        auto trackIds = std::vector<std::uint64_t>();
+        for (const auto *const track : file.tracks()) {
+            trackIds.emplace_back(track->id());
+        }
+        return std::make_tuple(file.container()->segmentCount(), trackIds, file.matroskaTags().size());
+    };
+
+    // when parsing concurrently each segment is searched on its own and the results are merged in segment order
+    for (const auto threadCount : { 2_st, 4_st, 0_st }) {
+        diag.clear();
+        const auto [segmentCount, trackIds, tagCount] = parse(true, threadCount, diag);
+#ifdef PLATFORM_UNIX
+        CPPUNIT_ASSERT_EQUAL(2_st, segmentCount);
+        CPPUNIT_ASSERT(expectedTrackIds == trackIds);
+        CPPUNIT_ASSERT_EQUAL(expectedTagCount, tagCount);
+#endif
+        CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+    }
+
+    // segments are parsed sequentially with one thread or without mapping, regardless of the number of threads
+    diag.clear();
+    const auto sequentialResult = parse(true, 1, diag);
+    CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+    CPPUNIT_ASSERT(std::get<0>(sequentialResult) >= 1);
+    CPPUNIT_ASSERT(std::equal(std::get<1>(sequentialResult).cbegin(), std::get<1>(sequentialResult).cend(), expectedTrackIds.cbegin()));
+    diag.clear();
+    CPPUNIT_ASSERT(sequentialResult == parse(false, 4, diag));
+    CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+    std::remove(path.data());
+}
+
+void MediaFileInfoTests::testMatroskaUnknownClusterSize()
+{
+    const auto path = workingCopyPath("matroska_wave1/test1.mkv");
+    MediaFileInfo file(path);
+    Diagnostics diag;
+    const auto parseClusters = [&file, &diag] {
+        file.open(true);
+        file.parseEverything(diag);
+        auto *const container = dynamic_cast<MatroskaContainer *>(file.container());
+        CPPUNIT_ASSERT(container);
+        auto *const segment = container->firstElement()->siblingById(MatroskaIds::Segment, diag);
+        CPPUNIT_ASSERT(segment);
+        auto clusters = std::vector<std::tuple<std::uint64_t, std::uint64_t, std::uint32_t>>();
+        for (auto *cluster = segment->childById(MatroskaIds::Cluster, diag); cluster; cluster = cluster->siblingById(MatroskaIds::Cluster, diag)) {
+            clusters.emplace_back(cluster->startOffset(), cluster->endOffset(), cluster->headerSize());
+        }
+        const auto duration = file.duration();
+        file.close();
+        file.clearParsingResults();
+        return std::make_pair(clusters, duration);
+    };
+    const auto [referenceClusters, referenceDuration] = parseClusters();
+    CPPUNIT_ASSERT(referenceClusters.size() > 1);
+    CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+
+    // denote the size of the clusters as unknown (like live recorders do) keeping the data at its place: the ID is followed
+    // by the 1-byte "unknown size" denotation and a "Void"-element taking the remaining bytes of the former size denotation
+    auto modifiedClusterCount = 0_st;
+    {
+        std::fstream stream(path, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+        for (const auto &[startOffset, endOffset, headerSize] : referenceClusters) {
+            const auto remainingSize = headerSize - 4u - 1u;
+            if (remainingSize < 2 || remainingSize - 2 > 0x7E) {
+                continue;
+            }
+            auto header = std::string("\xFF\xEC", 2);
+            header += static_cast<char>(0x80 | (remainingSize - 2));
+            header.append(remainingSize - 2, '\0');
+            stream.seekp(static_cast<std::streamoff>(startOffset + 4));
+            stream.write(header.data(), static_cast<std::streamsize>(header.size()));
+            ++modifiedClusterCount;
+        }
+        CPPUNIT_ASSERT(stream.good());
+    }
+    CPPUNIT_ASSERT(modifiedClusterCount > 1);
+
+    // the end of the clusters is still found at the same offsets when reading from the stream and from the mapping
+    for (const auto mapping : { false, true }) {
+        file.setMemoryMappingEnabled(mapping);
+        diag.clear();
+        const auto [clusters, duration] = parseClusters();
+        CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+        CPPUNIT_ASSERT_EQUAL(referenceClusters.size(), clusters.size());
+        for (std::size_t i = 0; i != clusters.size(); ++i) {
+            CPPUNIT_ASSERT_EQUAL(std::get<0>(referenceClusters[i]), std::get<0>(clusters[i]));
+            CPPUNIT_ASSERT_EQUAL(std::get<1>(referenceClusters[i]), std::get<1>(clusters[i]));
+        }
+        CPPUNIT_ASSERT_EQUAL(referenceDuration, duration);
+    }
+    std::remove(path.data());
+}
+
+void MediaFileInfoTests::testMatroskaTrackStatistics()
+{
+    const auto path = workingCopyPath("matroska_wave1/test1.mkv");
+    MediaFileInfo file(path);
+    Diagnostics diag;
+    file.open();
+    file.parseEverything(diag);
+    auto *const container = dynamic_cast<MatroskaContainer *>(file.container());
+    CPPUNIT_ASSERT(container);
+
+    // the statistics do not depend on the number of threads
+    auto statistics = std::vector<std::string>();
+    for (const auto threadCount : { 1_st, 4_st }) {
+        diag.clear();
+        container->generateTrackStatistics(diag, threadCount);
+        CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+        auto currentStatistics = std::vector<std::string>();
+        for (const auto &track : container->tracks()) {
+            CPPUNIT_ASSERT(track->sampleCount() > 0);
+            CPPUNIT_ASSERT(track->duration().totalTicks() > 0);
+            for (const auto &tag : container->tags()) {
+                if (tag->target().level() == 50 && tag->target().tracks() == TagTarget::IdContainerType{ track->id() }) {
+                    currentStatistics.emplace_back(tag->value(MatroskaTagIds::TrackSpecific::numberOfFrames()).toString());
+                    currentStatistics.emplace_back(tag->value(MatroskaTagIds::TrackSpecific::numberOfBytes()).toString());
+                    currentStatistics.emplace_back(tag->value(MatroskaTagIds::TrackSpecific::duration()).toString());
+                }
+            }
+        }
+        CPPUNIT_ASSERT_EQUAL(3 * container->trackCount(), currentStatistics.size());
+        if (!statistics.empty()) {
+            CPPUNIT_ASSERT(statistics == currentStatistics);
+        }
+        statistics = move(currentStatistics);
+    }
+
+    // the statistics are written via the usual tag handling
+    CPPUNIT_ASSERT_EQUAL(numberToString(container->tracks().front()->sampleCount()), statistics.front());
+    AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+    file.applyChanges(diag, progress);
+    file.clearParsingResults();
+    diag.clear();
+    file.parseEverything(diag);
+    auto *const reparsedContainer = dynamic_cast<MatroskaContainer *>(file.container());
+    CPPUNIT_ASSERT(reparsedContainer);
+    for (std::size_t i = 0; i != reparsedContainer->trackCount(); ++i) {
+        const auto &track = reparsedContainer->tracks()[i];
+        CPPUNIT_ASSERT_EQUAL(statistics[i * 3 + 0], numberToString(track->sampleCount()));
+        CPPUNIT_ASSERT_EQUAL(statistics[i * 3 + 1], numberToString(track->size()));
+    }
+
+    // readStatisticsFromTags() only applies tags targeting the track
+    using namespace MatroskaTagIds::TrackSpecific;
+    auto &track = *reparsedContainer->tracks().front();
+    const auto sampleCount = track.sampleCount();
+    auto tags = std::vector<std::unique_ptr<MatroskaTag>>();
+    auto &tag = *tags.emplace_back(std::make_unique<MatroskaTag>());
+    tag.setTarget(TagTarget(50, { track.id() + 1 }));
+    tag.setValue(numberOfFrames(), TagValue("1234"));
+    tag.setValue(numberOfBytes(), TagValue("56789", TagTextEncoding::Utf8));
+    tag.setValue(MatroskaTagIds::TrackSpecific::duration(), TagValue(TimeSpan::fromSeconds(12.5)));
+    tag.setValue(MatroskaTagIds::TrackSpecific::bitrate(), TagValue("128000"));
+    diag.clear();
+    track.readStatisticsFromTags(tags, diag);
+    CPPUNIT_ASSERT_EQUAL(sampleCount, track.sampleCount());
+    tag.setTarget(TagTarget(50, { track.id() }));
+    track.readStatisticsFromTags(tags, diag);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(1234), track.sampleCount());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(56789), track.size());
+    CPPUNIT_ASSERT_EQUAL(TimeSpan::fromSeconds(12.5), track.duration());
+    CPPUNIT_ASSERT_EQUAL(128.0, track.bitrate());
+    CPPUNIT_ASSERT_EQUAL(Diagnostics(), diag);
+
+    // readStatisticsFromTag() applies the tag regardless of its target; invalid values are ignored and reported
+    tag.setTarget(TagTarget(50, { track.id() + 1 }));
+    tag.setValue(numberOfFrames(), TagValue("not a number"));
+    tag.setValue(numberOfBytes(), TagValue("4321"));
+    track.readStatisticsFromTag(tag, diag);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(1234), track.sampleCount());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(4321), track.size());
+    CPPUNIT_ASSERT_EQUAL(1_st, diag.size());
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::Warning, diag.level());
+    file.close();
+    std::remove(path.data());
+}
+
+void MediaFileInfoTests::testMp4SampleTableValidation()
+{
+    const auto path = workingCopyPath("mtx-test-data/mp4/alac/othertest-itunes.m4a");
+    MediaFileInfo file(path);
+    Diagnostics diag;
+
+    // a valid file passes, also when reading some chunks
+    file.open(true);
+    file.parseContainerFormat(diag);
+    file.parseTracks(diag);
+    auto *container = dynamic_cast<Mp4Container *>(file.container());
+    CPPUNIT_ASSERT(container);
+    for (const auto spotCheckCount : { 0_st, 8_st }) {
+        diag.clear();
+        container->validateSampleTables(diag, spotCheckCount);
+        CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+    }
+
+    // move the first chunk beyond the end of the file
+    auto *const stcoAtom = container->firstElement()->subelementByPath(diag, Mp4AtomIds::Movie, Mp4AtomIds::Track, Mp4AtomIds::Media,
+        Mp4AtomIds::MediaInformation, Mp4AtomIds::SampleTable, Mp4AtomIds::ChunkOffset);
+    CPPUNIT_ASSERT(stcoAtom);
+    const auto firstChunkOffset = stcoAtom->dataOffset() + 8;
+    file.close();
+    file.clearParsingResults();
+    {
+        std::fstream stream(path, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+        stream.seekp(static_cast<std::streamoff>(firstChunkOffset));
+        stream.write("\xFF\xFF\xFF\x00", 4);
+    }
+
+    // the chunk is reported
+    file.open(true);
+    file.parseContainerFormat(diag);
+    file.parseTracks(diag);
+    container = dynamic_cast<Mp4Container *>(file.container());
+    CPPUNIT_ASSERT(container);
+    diag.clear();
+    container->validateSampleTables(diag, 8);
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::Critical, diag.level());
+    CPPUNIT_ASSERT(std::any_of(diag.cbegin(), diag.cend(), [](const DiagMessage &message) {
+        return message.message().find("Chunk 1 at 4294967040") != std::string::npos;
+    }));
+    file.close();
+    std::remove(path.data());
+}
+
+void MediaFileInfoTests::testMp4MovieAtomCompaction()
+{
+    Diagnostics diag;
+    AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+    MediaFileInfo file(workingCopyPath("mtx-test-data/aac/he-aacv2-ps.m4a"));
+    file.setForceRewrite(true);
+    file.open();
+    file.parseEverything(diag);
+    auto *container = dynamic_cast<Mp4Container *>(file.container());
+    CPPUNIT_ASSERT(container);
+    CPPUNIT_ASSERT(!container->isMovieAtomCompactionEnabled());
+    CPPUNIT_ASSERT(container->strippedAtomIds() == std::vector<std::uint32_t>({ Mp4AtomIds::Free, Mp4AtomIds::Skip }));
+    const auto movieAtomSize = container->firstElement()->siblingByIdIncludingThis(Mp4AtomIds::Movie, diag)->totalSize();
+    auto sampleCounts = std::vector<std::uint64_t>(), sizes = std::vector<std::uint64_t>();
+    auto chunkSizes = std::vector<std::vector<std::uint64_t>>();
+    for (const auto &track : container->tracks()) {
+        sampleCounts.emplace_back(track->sampleCount());
+        sizes.emplace_back(track->size());
+        chunkSizes.emplace_back(track->readChunkSizes(diag));
+    }
+
+    // the compacted movie atom is not bigger and the sample tables describe the same samples and chunks
+    container->setMovieAtomCompactionEnabled(true);
+    file.applyChanges(diag, progress);
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+    file.open();
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+    container = dynamic_cast<Mp4Container *>(file.container());
+    CPPUNIT_ASSERT(container);
+    CPPUNIT_ASSERT(container->firstElement()->siblingByIdIncludingThis(Mp4AtomIds::Movie, diag)->totalSize() <= movieAtomSize);
+    CPPUNIT_ASSERT_EQUAL(sampleCounts.size(), container->trackCount());
+    for (std::size_t i = 0; i != container->trackCount(); ++i) {
+        auto *const track = container->tracks()[i].get();
+        CPPUNIT_ASSERT_EQUAL(sampleCounts[i], track->sampleCount());
+        CPPUNIT_ASSERT_EQUAL(sizes[i], track->size());
+        CPPUNIT_ASSERT(chunkSizes[i] == track->readChunkSizes(diag));
+    }
+    file.close();
+    std::remove(file.path().data());
+    std::remove((file.path() + ".bak").data());
+}
+
+void MediaFileInfoTests::testElementTraversal()
+{
+    for (const auto elementArenaEnabled : { false, true }) {
+        MediaFileInfo file(testFilePath("matroska_wave1/test1.mkv"));
+        Diagnostics diag;
+        file.setElementArenaEnabled(elementArenaEnabled);
+        file.open(true);
+        file.parseContainerFormat(diag);
+        auto *const container = dynamic_cast<MatroskaContainer *>(file.container());
+        CPPUNIT_ASSERT(container);
+        CPPUNIT_ASSERT_EQUAL(elementArenaEnabled, container->isElementArenaEnabled());
+        container->validateElementStructure(diag);
+        CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+
+        // visit all elements and all elements but the children of clusters
+        auto elementCount = 0_st, clusterCount = 0_st, elementCountWithoutClusterChildren = 0_st;
+        auto *const firstElement = container->firstElement();
+        CPPUNIT_ASSERT(firstElement->traverseSubsequentElements(diag, [&](EbmlElement &element) {
+            ++elementCount;
+            clusterCount += element.id() == MatroskaIds::Cluster;
+            return ElementTraversal::Continue;
+        }));
+        CPPUNIT_ASSERT(firstElement->traverseSubsequentElements(diag, [&](EbmlElement &element) {
+            ++elementCountWithoutClusterChildren;
+            return element.id() == MatroskaIds::Cluster ? ElementTraversal::SkipChildren : ElementTraversal::Continue;
+        }));
+        CPPUNIT_ASSERT(clusterCount > 0);
+        CPPUNIT_ASSERT(elementCountWithoutClusterChildren + clusterCount <= elementCount);
+
+        // stop at the first cluster
+        EbmlElement *firstCluster = nullptr;
+        CPPUNIT_ASSERT(!firstElement->traverseSubsequentElements(diag, [&](EbmlElement &element) {
+            if (element.id() != MatroskaIds::Cluster) {
+                return ElementTraversal::Continue;
+            }
+            firstCluster = &element;
+            return ElementTraversal::Stop;
+        }));
+        CPPUNIT_ASSERT(firstCluster);
+        CPPUNIT_ASSERT_EQUAL(firstCluster, firstElement->subelementByPath(diag, MatroskaIds::Segment, MatroskaIds::Cluster));
+        CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+
+        // resetting the file info keeps the settings and re-uses the blocks of the arena
+        if (!elementArenaEnabled) {
+            continue;
+        }
+        const auto blockCount = container->elementArena()->blockCount();
+        file.reset(testFilePath("matroska_wave1/test1.mkv"));
+        CPPUNIT_ASSERT(!file.isOpen());
+        CPPUNIT_ASSERT(!file.container());
+        CPPUNIT_ASSERT(file.isElementArenaEnabled());
+        file.open(true);
+        file.parseContainerFormat(diag);
+        auto *const reusingContainer = dynamic_cast<MatroskaContainer *>(file.container());
+        CPPUNIT_ASSERT(reusingContainer);
+        CPPUNIT_ASSERT_EQUAL(blockCount, reusingContainer->elementArena()->blockCount());
+        reusingContainer->validateElementStructure(diag);
+        CPPUNIT_ASSERT_EQUAL(blockCount, reusingContainer->elementArena()->blockCount());
+        CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+    }
+}
+
+void MediaFileInfoTests::testLazyPictures()
+{
+    Diagnostics diag;
+    MediaFileInfo eagerFile(testFilePath("mtx-test-data/mp4/alac/othertest-itunes.m4a"));
+    eagerFile.open(true);
+    eagerFile.parseTags(diag);
+    const auto eagerTags = eagerFile.tags();
+    CPPUNIT_ASSERT_EQUAL(1_st, eagerTags.size());
+    const auto &eagerCover = eagerTags.front()->value(KnownField::Cover);
+    CPPUNIT_ASSERT(eagerCover.isDataLoaded());
+
+    // the cover is only read when accessed
+    MediaFileInfo lazyFile(testFilePath("mtx-test-data/mp4/alac/othertest-itunes.m4a"));
+    lazyFile.setParsingFlags(ParsingFlags::LazyLoadPictures);
+    lazyFile.open(true);
+    lazyFile.parseTags(diag);
+    const auto lazyTags = lazyFile.tags();
+    CPPUNIT_ASSERT_EQUAL(1_st, lazyTags.size());
+    CPPUNIT_ASSERT_EQUAL("Sad Song"s, lazyTags.front()->value(KnownField::Title).toString());
+    const auto &lazyCover = lazyTags.front()->value(KnownField::Cover);
+    CPPUNIT_ASSERT(!lazyCover.isDataLoaded());
+    CPPUNIT_ASSERT_EQUAL(TagDataType::Picture, lazyCover.type());
+    CPPUNIT_ASSERT_EQUAL("image/jpeg"s, lazyCover.mimeType());
+    CPPUNIT_ASSERT_EQUAL(0x58f3_st, lazyCover.dataSize());
+
+    // copies share the data block so the data is read only once
+    const auto copy = lazyCover;
+    CPPUNIT_ASSERT(!copy.isDataLoaded());
+    CPPUNIT_ASSERT_EQUAL(eagerCover, lazyCover);
+    CPPUNIT_ASSERT(lazyCover.isDataLoaded());
+    CPPUNIT_ASSERT_EQUAL(0xFFD8FFE000104A46ul, BE::toUInt64(copy.dataPointer()));
+    CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+}
+
+void MediaFileInfoTests::testSnapshot()
+{
+    Diagnostics diag;
+    auto file = make_unique<MediaFileInfo>(testFilePath("mtx-test-data/mp4/alac/othertest-itunes.m4a"));
+    file->setParsingFlags(ParsingFlags::LazyLoadPictures);
+    file->open(true);
+    file->parseEverything(diag);
+    const auto snapshot = MediaFileSnapshot::fromFileInfo(*file);
+    CPPUNIT_ASSERT_EQUAL(file->path(), snapshot->path());
+    CPPUNIT_ASSERT_EQUAL(ContainerFormat::Mp4, snapshot->containerFormat());
+    CPPUNIT_ASSERT_EQUAL(file->duration(), snapshot->duration());
+    CPPUNIT_ASSERT_EQUAL(file->trackCount(), snapshot->tracks().size());
+
+    // the snapshot is still usable after the file has been closed and destroyed; lazily loaded data has been loaded
+    file.reset();
+    CPPUNIT_ASSERT_EQUAL(1_st, snapshot->tags().size());
+    CPPUNIT_ASSERT_EQUAL(TagType::Mp4Tag, snapshot->tags().front().type);
+    CPPUNIT_ASSERT_EQUAL("Sad Song"s, snapshot->tagValue(KnownField::Title).toString());
+    const auto &cover = snapshot->tags().front().value(KnownField::Cover);
+    CPPUNIT_ASSERT(cover.isDataLoaded());
+    CPPUNIT_ASSERT_EQUAL(0x58f3_st, cover.dataSize());
+    CPPUNIT_ASSERT_EQUAL(0xFFD8FFE000104A46ul, BE::toUInt64(cover.dataPointer()));
+    CPPUNIT_ASSERT(snapshot->tagValue(KnownField::Lyricist).isEmpty());
+    CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+}
+
+void MediaFileInfoTests::testStatistics()
+{
+    Diagnostics diag;
+    AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+    MediaFileInfo file(workingCopyPath("matroska_wave1/test1.mkv"));
+    CPPUNIT_ASSERT(!file.isStatisticsEnabled());
+    file.setStatisticsEnabled(true);
+#ifndef TAG_PARSER_NO_STATISTICS
+    const auto *const statistics = file.statistics();
+    CPPUNIT_ASSERT(statistics);
+    file.open();
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT(statistics->bytesRead > 0);
+    CPPUNIT_ASSERT(statistics->readCalls > 0);
+    CPPUNIT_ASSERT(statistics->seeks > 0);
+    CPPUNIT_ASSERT_EQUAL(0_st, statistics->parsedElements.size() - statistics->parsedElements.count(ContainerFormat::Matroska));
+    CPPUNIT_ASSERT(statistics->parsedElements.at(ContainerFormat::Matroska) > 10);
+    CPPUNIT_ASSERT(statistics->parseTime(ParsePhase::ContainerFormat).count() > 0);
+    CPPUNIT_ASSERT(statistics->totalParseTime() >= statistics->parseTime(ParsePhase::Tags));
+    CPPUNIT_ASSERT_EQUAL(0ul, static_cast<unsigned long>(statistics->bytesWritten));
+    CPPUNIT_ASSERT(!dynamic_cast<CountingStreamBuffer *>(file.stream().rdbuf()));
+
+    // rewriting the file copies the media data and patches the rest
+    file.setForceRewrite(true);
+    CPPUNIT_ASSERT(file.createAppropriateTags());
+    file.tags().front()->setValue(KnownField::Title, TagValue("statistics test"));
+    file.applyChanges(diag, progress);
+    CPPUNIT_ASSERT(statistics->bytesCopied > 0);
+    CPPUNIT_ASSERT(statistics->bytesPatched > 0);
+    CPPUNIT_ASSERT(statistics->bytesWritten >= statistics->bytesPatched);
+    CPPUNIT_ASSERT(statistics->applyChangesTime.count() > 0);
+    CPPUNIT_ASSERT(statistics->applyTime(ApplyPhase::Layout).count() > 0);
+    CPPUNIT_ASSERT(statistics->applyTime(ApplyPhase::Backup).count() > 0);
+    CPPUNIT_ASSERT(statistics->applyChangesTime
+        >= statistics->applyTime(ApplyPhase::Layout) + statistics->applyTime(ApplyPhase::Backup) + statistics->applyTime(ApplyPhase::Copy));
+    CPPUNIT_ASSERT(!dynamic_cast<CountingStreamBuffer *>(file.stream().rdbuf()));
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+
+    // the times are appended to the technical summary
+    const auto summary = file.technicalSummary();
+    CPPUNIT_ASSERT(summary.find("parsing: container format ") != std::string::npos);
+    CPPUNIT_ASSERT(summary.find("applying changes: ") != std::string::npos);
+    CPPUNIT_ASSERT(summary.find("backup ") != std::string::npos);
+
+    file.resetStatistics();
+    CPPUNIT_ASSERT_EQUAL(0ul, static_cast<unsigned long>(statistics->bytesRead));
+
+    // tracing records every operation so the trace adds up to the counters
+    const auto &trace = statistics->ioTrace;
+    file.setIoTracingEnabled(true);
+    file.clearParsingResults();
+    file.open(true);
+    file.parseContainerFormat(diag);
+    CPPUNIT_ASSERT(!trace.isEmpty());
+    auto tracedBytesRead = std::uint64_t();
+    for (const auto &event : trace.events()) {
+        tracedBytesRead += event.operation == IoOperation::Read ? event.size : 0;
+    }
+    CPPUNIT_ASSERT_EQUAL(statistics->bytesRead, tracedBytesRead);
+
+    // the trace survives saving and loading and can be replayed
+    auto traceStream = std::stringstream();
+    trace.write(traceStream);
+    const auto loadedTrace = IoTrace::read(traceStream);
+    CPPUNIT_ASSERT_EQUAL(trace.events().size(), loadedTrace.events().size());
+    CPPUNIT_ASSERT_EQUAL(trace.events().back().offset, loadedTrace.events().back().offset);
+    const auto ssd = loadedTrace.replay(IoLatencyModel::localSsd()), hdd = loadedTrace.replay(IoLatencyModel::hdd());
+    CPPUNIT_ASSERT(ssd.requests > 0);
+    CPPUNIT_ASSERT_EQUAL(0ul, static_cast<unsigned long>(ssd.bytesFetched % IoLatencyModel::localSsd().blockSize));
+    CPPUNIT_ASSERT(hdd.time > ssd.time);
+    file.setIoTracingEnabled(false);
+    file.setStatisticsEnabled(false);
+    CPPUNIT_ASSERT(!file.statistics());
+    std::remove((file.path() + ".bak").data());
+#else
+    CPPUNIT_ASSERT(!file.statistics());
+#endif
+}
+
+void MediaFileInfoTests::testSkippingUnmodified()
+{
+    Diagnostics diag;
+    AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+    MediaFileInfo file(workingCopyPath("matroska_wave1/test1.mkv"));
+    file.setSkipUnmodified(true);
+    file.open();
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT(!file.isModified());
+
+    // assigning the present values is not considered a modification
+    const auto tags = file.tags();
+    CPPUNIT_ASSERT(!tags.empty());
+    auto *const tag = tags.front();
+    const auto title = TagValue(tag->value(KnownField::Title));
+    tag->setValue(KnownField::Title, title);
+    tag->setTarget(TagTarget(tag->target()));
+    file.tracks().front()->setName(std::string(file.tracks().front()->name()));
+    CPPUNIT_ASSERT(!file.isModified());
+
+    // the file is left untouched and the parsing results are kept
+    const auto originalSize = file.size();
+    file.applyChanges(diag, progress);
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tagsParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(originalSize, file.size());
+    CPPUNIT_ASSERT_EQUAL(-1, std::remove((file.path() + ".bak").data()));
+
+    // actual modifications are tracked per part
+    tag->setValue(KnownField::Title, TagValue("skipping unmodified test"));
+    CPPUNIT_ASSERT(file.changes() == MediaFileChanges::Tags);
+    file.container()->setTitle("skipping unmodified test");
+    CPPUNIT_ASSERT(file.changes() == (MediaFileChanges::Tags | MediaFileChanges::Structure));
+    file.markAsUnmodified(MediaFileChanges::Tags);
+    CPPUNIT_ASSERT(file.changes() == MediaFileChanges::Structure);
+    file.markAsUnmodified();
+    CPPUNIT_ASSERT(!file.isModified());
+    file.close();
+    std::remove(file.path().data());
+}
+
+void MediaFileInfoTests::testMemoryLimit()
+{
+    // the memory allocated for the parsing results is accounted
+    Diagnostics diag;
+    MediaFileInfo file(testFilePath("matroska_wave1/test1.mkv"));
+    file.open(true);
+    file.parseEverything(diag);
+    const auto &account = file.memoryAccount();
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tracksParsingStatus());
+    CPPUNIT_ASSERT(account.peakBytes() > 0);
+    CPPUNIT_ASSERT(account.totalBytes() >= account.peakBytes());
+    CPPUNIT_ASSERT(!account.isLimitExceeded());
+    const auto peak = account.peakBytes();
+    file.clearParsingResults();
+    CPPUNIT_ASSERT_EQUAL(0ul, static_cast<unsigned long>(account.totalBytes()));
+
+    // exceeding the limit aborts parsing with a critical message
+    diag.clear();
+    file.setMemoryLimit(peak / 2);
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT(account.isLimitExceeded());
+    CPPUNIT_ASSERT(account.peakBytes() <= peak / 2);
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::Critical, diag.level());
+    CPPUNIT_ASSERT(file.tracksParsingStatus() == ParsingStatus::CriticalFailure || file.tagsParsingStatus() == ParsingStatus::CriticalFailure);
+
+    // the same applies to the page table of Ogg files
+    diag.clear();
+    MediaFileInfo oggFile(testFilePath("mtx-test-data/ogg/qt4dance_medium.ogg"));
+    oggFile.setMemoryLimit(1024);
+    oggFile.open(true);
+    oggFile.parseEverything(diag);
+    CPPUNIT_ASSERT(oggFile.memoryAccount().isLimitExceeded());
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::CriticalFailure, oggFile.tracksParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::Critical, diag.level());
+}
+
+void MediaFileInfoTests::testParseLimits()
+{
+    // exceeding the max. number of elements makes parsing fail
+    Diagnostics diag;
+    auto limits = ParseLimits();
+    limits.maxElements = 10;
+    MediaFileInfo file(testFilePath("matroska_wave1/test1.mkv"));
+    file.setParseLimits(limits);
+    file.open(true);
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT(file.container());
+    CPPUNIT_ASSERT(file.container()->isParseLimitExceeded());
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::Critical, diag.level());
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::CriticalFailure, file.tracksParsingStatus());
+
+    // the limits are reset when the parsing results are cleared
+    diag.clear();
+    file.clearParsingResults();
+    file.setParseLimits(ParseLimits());
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT(!file.container()->isParseLimitExceeded());
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tracksParsingStatus());
+
+    // exceeding the max. number of table entries makes parsing the Ogg page table fail
+    diag.clear();
+    limits = ParseLimits();
+    limits.maxTableEntries = 2;
+    MediaFileInfo oggFile(testFilePath("mtx-test-data/ogg/qt4dance_medium.ogg"));
+    oggFile.setParseLimits(limits);
+    oggFile.open(true);
+    oggFile.parseEverything(diag);
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::CriticalFailure, oggFile.tracksParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::Critical, diag.level());
+
+    // ID3v2 tags exceeding the max. tag size are skipped
+    diag.clear();
+    limits = ParseLimits();
+    limits.maxTagSize = 16;
+    MediaFileInfo mp3File(testFilePath("mtx-test-data/mp3/id3-tag-and-xing-header.mp3"));
+    mp3File.setParseLimits(limits);
+    mp3File.open(true);
+    mp3File.parseEverything(diag);
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::CriticalFailure, mp3File.tagsParsingStatus());
+    CPPUNIT_ASSERT(!mp3File.hasId3v2Tag());
+}
+
+void MediaFileInfoTests::testApplyChangesResult()
+{
+    Diagnostics diag;
+    AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+    MediaFileInfo file(workingCopyPath("matroska_wave1/test1.mkv"));
+    CPPUNIT_ASSERT(file.applyChangesResult().strategy == ApplyChangesStrategy::None);
+
+    // rewriting the file copies the media data and uses the preferred padding
+    file.setForceRewrite(true);
+    file.setPreferredPadding(0x1000);
+    file.setMaxPadding(0x10000);
+    file.open();
+    file.parseEverything(diag);
+    const auto originalSize = file.size();
+    CPPUNIT_ASSERT(file.createAppropriateTags());
+    file.tags().front()->setValue(KnownField::Title, TagValue("result test"));
+
+    // planning the changes predicts the rewrite without touching the file
+    auto plan = file.planChanges(diag, progress);
+    CPPUNIT_ASSERT(plan.strategy == ApplyChangesStrategy::Rewrite);
+    CPPUNIT_ASSERT(plan.backupCreated);
+    CPPUNIT_ASSERT(plan.bytesCopied > 0);
+    CPPUNIT_ASSERT_EQUAL(0x1000ul, static_cast<unsigned long>(plan.paddingAfter));
+    CPPUNIT_ASSERT(file.applyChangesResult().strategy == ApplyChangesStrategy::None);
+    CPPUNIT_ASSERT_EQUAL(originalSize, file.size());
+
+    file.applyChanges(diag, progress);
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+    const auto &result = file.applyChangesResult();
+    CPPUNIT_ASSERT_EQUAL(plan.fileSizeAfter, result.fileSizeAfter);
+    CPPUNIT_ASSERT(result.backupCreated);
+    CPPUNIT_ASSERT(result.containerFormat == ContainerFormat::Matroska);
+    CPPUNIT_ASSERT(result.strategy == ApplyChangesStrategy::Rewrite);
+    CPPUNIT_ASSERT_EQUAL(originalSize, result.fileSizeBefore);
+    CPPUNIT_ASSERT_EQUAL(file.size(), result.fileSizeAfter);
+    CPPUNIT_ASSERT_EQUAL(0x1000ul, static_cast<unsigned long>(result.paddingAfter));
+    CPPUNIT_ASSERT(!result.backupCopied);
+#ifndef TAG_PARSER_NO_STATISTICS
+    // the I/O is counted although statistics are disabled
+    CPPUNIT_ASSERT(!file.statistics());
+    CPPUNIT_ASSERT(result.bytesCopied > 0);
+    CPPUNIT_ASSERT(result.bytesPatched > 0);
+#endif
+
+    // changing the title again is absorbed by the padding
+    file.setForceRewrite(false);
+    file.open();
+    file.parseEverything(diag);
+    file.tags().front()->setValue(KnownField::Title, TagValue("result test with a longer title"));
+    plan = file.planChanges(diag, progress);
+    CPPUNIT_ASSERT(plan.strategy == ApplyChangesStrategy::PaddingReuse);
+    CPPUNIT_ASSERT(!plan.backupCreated);
+    CPPUNIT_ASSERT_EQUAL(0ul, static_cast<unsigned long>(plan.bytesCopied));
+    file.applyChanges(diag, progress);
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+    CPPUNIT_ASSERT(result.strategy == ApplyChangesStrategy::PaddingReuse);
+    CPPUNIT_ASSERT_EQUAL(0x1000ul, static_cast<unsigned long>(result.paddingBefore));
+    CPPUNIT_ASSERT(result.paddingAfter < result.paddingBefore);
+    CPPUNIT_ASSERT_EQUAL(result.fileSizeBefore, result.fileSizeAfter);
+    CPPUNIT_ASSERT_EQUAL(plan.paddingAfter, result.paddingAfter);
+    CPPUNIT_ASSERT_EQUAL(0ul, static_cast<unsigned long>(result.bytesCopied));
+    CPPUNIT_ASSERT(!result.backupCreated);
+#ifndef TAG_PARSER_NO_STATISTICS
+    CPPUNIT_ASSERT(result.bytesPatched > 0);
+    CPPUNIT_ASSERT(result.bytesPatched < result.fileSizeAfter);
+#endif
+    std::remove((file.path() + ".bak").data());
+}
+
+void MediaFileInfoTests::testPaddingPolicy()
+{
+    Diagnostics diag;
+    AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+    MediaFileInfo file(workingCopyPath("matroska_wave1/test1.mkv"));
+    const auto policy = std::make_shared<AdaptivePaddingPolicy>(0x400, 2.0, 0x10000);
+    file.setPaddingPolicy(policy);
+    file.setForceRewrite(true);
+    file.open();
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT(file.createAppropriateTags());
+    file.tags().front()->setValue(KnownField::Title, TagValue("padding policy test"));
+
+    // the first rewrite uses the initial padding grown once and stores the number of rewrites
+    file.applyChanges(diag, progress);
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+    CPPUNIT_ASSERT(file.applyChangesResult().strategy == ApplyChangesStrategy::Rewrite);
+    CPPUNIT_ASSERT_EQUAL(0x800ul, static_cast<unsigned long>(file.applyChangesResult().paddingAfter));
+    CPPUNIT_ASSERT_EQUAL(0ul, static_cast<unsigned long>(file.preferredPadding()));
+    file.open();
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT_EQUAL(1ul, static_cast<unsigned long>(PaddingPolicy::readHint(*file.tags().front())));
+
+    // the next rewrite grows the padding further
+    file.applyChanges(diag, progress);
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+    CPPUNIT_ASSERT_EQUAL(0x1000ul, static_cast<unsigned long>(file.applyChangesResult().paddingAfter));
+
+    // small changes are absorbed by the padding without touching the hint
+    file.setForceRewrite(false);
+    file.open();
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT_EQUAL(2ul, static_cast<unsigned long>(PaddingPolicy::readHint(*file.tags().front())));
+    file.tags().front()->setValue(KnownField::Title, TagValue("padding policy test with a longer title"));
+    file.applyChanges(diag, progress);
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+    CPPUNIT_ASSERT(file.applyChangesResult().strategy == ApplyChangesStrategy::PaddingReuse);
+    file.open();
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT_EQUAL(2ul, static_cast<unsigned long>(PaddingPolicy::readHint(*file.tags().front())));
+    std::remove((file.path() + ".bak").data());
+}
+
+void MediaFileInfoTests::testResumingParsing()
+{
+    for (const auto *const testFile : { "mtx-test-data/opus/v-opus.ogg", "matroska_wave1/test1.mkv" }) {
+        // parse the complete file to get the reference values
+        Diagnostics diag;
+        MediaFileInfo completeFile(testFilePath(testFile));
+        completeFile.open(true);
+        completeFile.parseEverything(diag);
+        const auto duration = completeFile.duration();
+        const auto trackCount = completeFile.trackCount();
+        const auto data = readFile(completeFile.path(), 0x1000000);
+        completeFile.close();
+
+        // simulate a file which is still being written by writing only the first half (cutting a page/element)
+        const auto path = workingCopyPath(testFile);
+        const auto firstPartSize = data.size() / 2 + 7;
+        {
+            std::ofstream(path, ios_base::out | ios_base::trunc | ios_base::binary).write(data.data(), static_cast<std::streamsize>(firstPartSize));
+        }
+        MediaFileInfo file(path);
+        file.open(true);
+        file.parseEverything(diag);
+        CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(firstPartSize), file.size());
+        CPPUNIT_ASSERT_EQUAL(trackCount, file.trackCount());
+        const auto *const track = file.tracks().front();
+        CPPUNIT_ASSERT(!file.resumeParsing(diag));
+
+        // append the rest and resume
+        {
+            std::ofstream(path, ios_base::out | ios_base::app | ios_base::binary)
+                .write(data.data() + firstPartSize, static_cast<std::streamsize>(data.size() - firstPartSize));
+        }
+        CPPUNIT_ASSERT(file.resumeParsing(diag));
+        CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(data.size()), file.size());
+        CPPUNIT_ASSERT_EQUAL(trackCount, file.trackCount());
+        CPPUNIT_ASSERT_EQUAL(duration, file.duration());
+        CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tracksParsingStatus());
+        if (file.containerFormat() == ContainerFormat::Ogg) {
+            // the Ogg page table is extended so the track objects are kept
+            CPPUNIT_ASSERT_EQUAL(track, static_cast<const AbstractTrack *>(file.tracks().front()));
+            CPPUNIT_ASSERT(static_cast<OggContainer *>(file.container())->pageIndex().entries().size() > 10);
+        }
+        file.close();
+        std::remove(path.data());
+    }
+}
+
+#ifdef TAG_PARSER_HAS_COROUTINES
+void MediaFileInfoTests::testStepwiseParsing()
+{
+    // parse the complete file to get the reference values
+    Diagnostics diag;
+    AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+    MediaFileInfo completeFile(testFilePath("matroska_wave1/test1.mkv"));
+    completeFile.open(true);
+    completeFile.parseEverything(diag);
+
+    // drive the task to completion, each step parsing one more part of the file
+    MediaFileInfo file(completeFile.path());
+    file.open(true);
+    auto task = parseEverythingStepwise(file, diag, progress);
+    CPPUNIT_ASSERT(!task.isDone());
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::NotParsedYet, file.containerParsingStatus());
+    CPPUNIT_ASSERT(task.resume());
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.containerParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::NotParsedYet, file.tracksParsingStatus());
+    auto steps = 1_st;
+    for (; task.resume(); ++steps) {
+    }
+    CPPUNIT_ASSERT_EQUAL(5_st, ++steps);
+    CPPUNIT_ASSERT(task.isDone());
+    CPPUNIT_ASSERT(!task.resume());
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tracksParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tagsParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.attachmentsParsingStatus());
+    CPPUNIT_ASSERT_EQUAL(completeFile.trackCount(), file.trackCount());
+    CPPUNIT_ASSERT_EQUAL(completeFile.tags().size(), file.tags().size());
+    CPPUNIT_ASSERT_EQUAL(completeFile.duration(), file.duration());
+
+    // abort between the steps so resume() rethrows the exception the task failed with
+    file.clearParsingResults();
+    task = parseEverythingStepwise(file, diag, progress);
+    CPPUNIT_ASSERT(task.resume());
+    progress.tryToAbort();
+    CPPUNIT_ASSERT_THROW(task.resume(), OperationAbortedException);
+    CPPUNIT_ASSERT(task.isDone());
+    CPPUNIT_ASSERT(!task.resume());
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::NotParsedYet, file.tracksParsingStatus());
+
+    // abort right away so even the first step is not performed
+    file.clearParsingResults();
+    task = applyChangesStepwise(file, diag, progress);
+    CPPUNIT_ASSERT_THROW(task.resume(), OperationAbortedException);
+    CPPUNIT_ASSERT(task.isDone());
+    CPPUNIT_ASSERT_EQUAL(ParsingStatus::NotParsedYet, file.containerParsingStatus());
+}
+#endif
+
+void MediaFileInfoTests::testForwardOnlyParsing()
+{
+    for (const auto *const testFile : { "mtx-test-data/opus/v-opus.ogg", "matroska_wave1/test1.mkv" }) {
+        // parse the file normally to get the reference values
+        Diagnostics diag;
+        MediaFileInfo referenceFile(testFilePath(testFile));
+        referenceFile.open(true);
+        referenceFile.parseEverything(diag);
+        const auto data = readFile(referenceFile.path(), 0x1000000);
+        referenceFile.close();
+
+        // parse the file from a stream which is only read forward, once with known and once with unknown size
+        for (const auto size : { static_cast<std::uint64_t>(data.size()), ForwardOnlyByteSource::unknownSize }) {
+            auto input = std::istringstream(data);
+            const auto source = make_shared<ForwardOnlyByteSource>(input, size, 0x10000);
+            MediaFileInfo file(referenceFile.path());
+            file.setByteSource(source);
+            CPPUNIT_ASSERT(file.isForwardOnly());
+            diag.clear();
+            file.parseEverything(diag);
+            CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.containerParsingStatus());
+            CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tracksParsingStatus());
+            CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tagsParsingStatus());
+            CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+            CPPUNIT_ASSERT_EQUAL(referenceFile.trackCount(), file.trackCount());
+            CPPUNIT_ASSERT_EQUAL(referenceFile.tags().size(), file.tags().size());
+            CPPUNIT_ASSERT(referenceFile.tags().front()->value(KnownField::Title) == file.tags().front()->value(KnownField::Title));
+            if (file.containerFormat() == ContainerFormat::Ogg) {
+                // only the header pages are read; the duration can not be determined without the last page
+                CPPUNIT_ASSERT(source->bytesReceived() < data.size());
+                CPPUNIT_ASSERT(file.duration().isNull());
+            } else {
+                CPPUNIT_ASSERT_EQUAL(referenceFile.duration(), file.duration());
+                CPPUNIT_ASSERT(source->retainedSize() > 0);
+            }
+        }
+    }
+
+    // reading data which is neither within the lookbehind buffer nor retained is not possible
+    auto input = std::istringstream(std::string(0x100, 'x'));
+    auto source = ForwardOnlyByteSource(input, ForwardOnlyByteSource::unknownSize, 0x10);
+    char buffer[0x10];
+    CPPUNIT_ASSERT_EQUAL(0x10_st, source.read(0x80, buffer, sizeof(buffer)));
+    CPPUNIT_ASSERT_THROW(source.read(0x40, buffer, sizeof(buffer)), std::ios_base::failure);
+    CPPUNIT_ASSERT_EQUAL(0x10_st, source.read(0x84, buffer, sizeof(buffer)));
+    CPPUNIT_ASSERT_EQUAL(0x8_st, source.read(0xF8, buffer, sizeof(buffer)));
+    CPPUNIT_ASSERT(source.isEndReached());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(0x100), source.size());
+}
+
+void MediaFileInfoTests::testVirtualFile()
+{
+    for (const auto *const testFile : { "mtx-test-data/mp3/id3-tag-and-xing-header.mp3", "flac/test.flac" }) {
+        Diagnostics diag;
+        MediaFileInfo file(testFilePath(testFile));
+        file.open(true);
+        file.parseEverything(diag);
+        CPPUNIT_ASSERT(!file.tags().empty());
+        for (auto *const tag : file.tags()) {
+            tag->setValue(KnownField::Title, TagValue("virtual title"));
+        }
+        const auto virtualFile = file.makeVirtualFile(diag);
+        CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+
+        // the media data is referenced rather than copied
+        const auto fileRange = find_if(
+            virtualFile.segments.cbegin(), virtualFile.segments.cend(), [](const auto &segment) { return segment.isFileRange(); });
+        CPPUNIT_ASSERT(fileRange != virtualFile.segments.cend());
+        CPPUNIT_ASSERT(fileRange->fileOffset > 0);
+        CPPUNIT_ASSERT(fileRange->fileRangeSize > file.size() / 2);
+
+        // the concatenated segments form a valid file with the new tags; the original file is not modified
+        const auto originalData = readFile(file.path(), 0x1000000);
+        auto originalStream = std::istringstream(originalData);
+        auto virtualStream = std::ostringstream();
+        virtualFile.write(originalStream, virtualStream);
+        const auto virtualData = virtualStream.str();
+        CPPUNIT_ASSERT_EQUAL(virtualFile.size(), static_cast<std::uint64_t>(virtualData.size()));
+        MediaFileInfo virtualFileInfo(file.path());
+        virtualFileInfo.setByteSource(make_shared<MemoryByteSource>(virtualData));
+        diag.clear();
+        virtualFileInfo.parseEverything(diag);
+        CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, virtualFileInfo.tagsParsingStatus());
+        CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, virtualFileInfo.tracksParsingStatus());
+        CPPUNIT_ASSERT_EQUAL(file.containerFormat(), virtualFileInfo.containerFormat());
+        CPPUNIT_ASSERT_EQUAL(file.trackCount(), virtualFileInfo.trackCount());
+        CPPUNIT_ASSERT_EQUAL(file.duration(), virtualFileInfo.duration());
+        CPPUNIT_ASSERT(!virtualFileInfo.tags().empty());
+        CPPUNIT_ASSERT_EQUAL("virtual title"s, virtualFileInfo.tags().front()->value(KnownField::Title).toString());
+        CPPUNIT_ASSERT_EQUAL(originalData, readFile(file.path(), 0x1000000));
+    }
+
+    // container formats are not supported
+    Diagnostics diag;
+    MediaFileInfo file(testFilePath("matroska_wave1/test1.mkv"));
+    file.open(true);
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT_THROW(file.makeVirtualFile(diag), NotImplementedException);
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::Critical, diag.level());
+}
+
+void MediaFileInfoTests::testSeeklessOutput()
+{
+    // the output stream only supports obtaining the current position
+    auto output = std::ostringstream();
+    auto stream = SeeklessOutputStream(output, 0x10);
+    stream << "header";
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::streamoff>(6), static_cast<std::streamoff>(stream.tellp()));
+    CPPUNIT_ASSERT_THROW(stream.seekp(0), std::ios_base::failure);
+    stream.clear();
+    // seeking back is possible within held back bytes
+    stream.hold();
+    stream << "size" << std::string(0x20, '-');
+    stream.seekp(6);
+    stream << "SIZE";
+    stream.seekp(0, std::ios_base::end);
+    CPPUNIT_ASSERT_EQUAL(""s, output.str().substr(6));
+    stream.release();
+    stream << "tail";
+    stream.flush();
+    CPPUNIT_ASSERT_EQUAL("headerSIZE" + std::string(0x20, '-') + "tail", output.str());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(output.str().size()), stream.bytesWritten());
+
+    for (const auto *const testFile :
+        { "matroska_wave1/test1.mkv", "mtx-test-data/aac/he-aacv2-ps.m4a", "mtx-test-data/mp3/id3-tag-and-xing-header.mp3" }) {
+        Diagnostics diag;
+        AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+        MediaFileInfo file(testFilePath(testFile));
+        file.open(true);
+        file.parseEverything(diag);
+        const auto originalData = readFile(file.path(), 0x1000000);
+        file.createAppropriateTags();
+        CPPUNIT_ASSERT(!file.tags().empty());
+        file.tags().front()->setValue(KnownField::Title, TagValue("seekless title"));
+        auto fileOutput = std::ostringstream();
+        auto seeklessOutput = SeeklessOutputStream(fileOutput);
+        file.writeChanges(seeklessOutput, diag, progress);
+        CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+        CPPUNIT_ASSERT_EQUAL(originalData, readFile(file.path(), 0x1000000));
+        CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tagsParsingStatus());
+
+        // the output is a valid file with the new tag
+        const auto data = fileOutput.str();
+        CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(data.size()), seeklessOutput.bytesWritten());
+        MediaFileInfo writtenFile(file.path());
+        writtenFile.setByteSource(make_shared<MemoryByteSource>(data));
+        diag.clear();
+        writtenFile.parseEverything(diag);
+        CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, writtenFile.containerParsingStatus());
+        CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, writtenFile.tracksParsingStatus());
+        CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, writtenFile.tagsParsingStatus());
+        CPPUNIT_ASSERT_EQUAL(file.containerFormat(), writtenFile.containerFormat());
+        CPPUNIT_ASSERT_EQUAL(file.trackCount(), writtenFile.trackCount());
+        CPPUNIT_ASSERT_EQUAL(file.duration(), writtenFile.duration());
+        CPPUNIT_ASSERT(!writtenFile.tags().empty());
+        CPPUNIT_ASSERT_EQUAL("seekless title"s, writtenFile.tags().front()->value(KnownField::Title).toString());
+        if (file.containerFormat() == ContainerFormat::Mp4) {
+            // the chunk offsets have been adjusted for the new layout
+            CPPUNIT_ASSERT_EQUAL(file.tracks().front()->sampleCount(), writtenFile.tracks().front()->sampleCount());
+        }
+    }
+
+    // Ogg files are not supported as the page checksums are updated after writing the pages
+    Diagnostics diag;
+    AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+    MediaFileInfo file(testFilePath("mtx-test-data/opus/v-opus.ogg"));
+    file.open(true);
+    file.parseEverything(diag);
+    auto oggOutput = std::ostringstream();
+    auto seeklessOutput = SeeklessOutputStream(oggOutput);
+    CPPUNIT_ASSERT_THROW(file.writeChanges(seeklessOutput, diag, progress), NotImplementedException);
+    CPPUNIT_ASSERT(oggOutput.str().empty());
+}
+
+void MediaFileInfoTests::testBlockShifting()
+{
+    const auto title = std::string(0x2345, 't');
+    for (const auto *const testFile : { "mtx-test-data/mp3/id3-tag-and-xing-header.mp3", "mtx-test-data/aac/he-aacv2-ps.m4a" }) {
+        Diagnostics diag;
+        AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+        MediaFileInfo file(workingCopyPath(testFile));
+        file.setBlockShiftingEnabled(true);
+        file.setPreferredPadding(0x200);
+        file.setMaxPadding(0x20000);
+        file.open();
+        file.parseEverything(diag);
+        const auto trackCount = file.trackCount();
+        const auto duration = file.duration();
+        const auto sampleCount = file.tracks().front()->sampleCount();
+        CPPUNIT_ASSERT(file.createAppropriateTags());
+        file.tags().front()->setValue(KnownField::Title, TagValue(title));
+
+        // the tag does not fit into the padding so the media data is shifted (or the file is rewritten if the file
+        // system does not support inserting blocks)
+        CPPUNIT_ASSERT(file.planChanges(diag, progress).strategy == ApplyChangesStrategy::Rewrite);
+        file.applyChanges(diag, progress);
+        CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+        const auto result = file.applyChangesResult();
+        CPPUNIT_ASSERT(result.strategy == ApplyChangesStrategy::BlockShift || result.strategy == ApplyChangesStrategy::Rewrite);
+        if (result.strategy == ApplyChangesStrategy::BlockShift) {
+            CPPUNIT_ASSERT(!result.backupCreated);
+            CPPUNIT_ASSERT(result.paddingAfter >= 0x200);
+            CPPUNIT_ASSERT(result.paddingAfter < 0x200 + FileRangeCopier::maxShiftBlockSize);
+            CPPUNIT_ASSERT_EQUAL(0ul, static_cast<unsigned long>(result.bytesCopied));
+        }
+
+        // the file is still valid and the media data is referenced correctly
+        file.open();
+        diag.clear();
+        file.parseEverything(diag);
+        CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+        CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tracksParsingStatus());
+        CPPUNIT_ASSERT_EQUAL(trackCount, file.trackCount());
+        CPPUNIT_ASSERT_EQUAL(duration, file.duration());
+        CPPUNIT_ASSERT_EQUAL(sampleCount, file.tracks().front()->sampleCount());
+        CPPUNIT_ASSERT(!file.tags().empty());
+        CPPUNIT_ASSERT_EQUAL(title, file.tags().front()->value(KnownField::Title).toString());
+        std::remove((file.path() + ".bak").data());
+    }
+}
+
+void MediaFileInfoTests::testBlockShiftingUndone()
+{
+    // abort after the media data has been shifted and the new tags have been written (MP3) or before writing anything (MP4)
+    const auto title = std::string(0x2345, 't');
+    for (const auto &[testFile, abortingStep] : { std::pair("mtx-test-data/mp3/id3-tag-and-xing-header.mp3", "Writing ID3v2 tag ..."),
+             std::pair("mtx-test-data/aac/he-aacv2-ps.m4a", "Preparing streams ...") }) {
+        Diagnostics diag;
+        AbortableProgressFeedback progress([step = std::string(abortingStep)](AbortableProgressFeedback &feedback) {
+            if (feedback.step() == step) {
+                feedback.tryToAbort();
+            }
+        });
+        MediaFileInfo file(workingCopyPath(testFile));
+        const auto originalData = readFile(file.path(), 0x1000000);
+        file.setBlockShiftingEnabled(true);
+        file.setPreferredPadding(0x200);
+        file.setMaxPadding(0x20000);
+        file.open();
+        file.parseEverything(diag);
+        CPPUNIT_ASSERT(file.createAppropriateTags());
+        file.tags().front()->setValue(KnownField::Title, TagValue(title));
+        CPPUNIT_ASSERT_THROW(file.applyChanges(diag, progress), OperationAbortedException);
+
+        // the shifting has been undone and the bytes in front of the media data have been restored from the journal (or the
+        // backup has been restored if the file system does not support inserting blocks)
+        const auto shifted = std::any_of(
+            diag.cbegin(), diag.cend(), [](const auto &message) { return message.message().find("Shifted the ") == 0; });
+        CPPUNIT_ASSERT(std::any_of(
+            diag.cbegin(), diag.cend(), [](const auto &message) { return message.message() == "The original file has been restored."; }));
+        CPPUNIT_ASSERT(std::none_of(diag.cbegin(), diag.cend(),
+            [](const auto &message) { return message.message().find("Unable to shift the data") != std::string::npos; }));
+        CPPUNIT_ASSERT_EQUAL_MESSAGE(shifted ? "shifting undone" : "backup restored", originalData, readFile(file.path(), 0x1000000));
+        CPPUNIT_ASSERT_MESSAGE("journal removed", !std::ifstream(file.path() + ".bak.journal").is_open());
+        std::remove((file.path() + ".bak").data());
+    }
+}
+
+void MediaFileInfoTests::testAppendedId3v2Tag()
+{
+    // applies the specified title as ID3v2.4 tag and checks whether the tag has been appended with footer
+    const auto path = workingCopyPath("mtx-test-data/mp3/id3-tag-and-xing-header.mp3");
+    const auto originalData = readFile(path, 0x1000000);
+    const auto applyTitle = [&path](const std::string &title, ElementPosition tagPosition, bool forceTagPosition) {
+        Diagnostics diag;
+        AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+        MediaFileInfo file(path);
+        file.setTagPosition(tagPosition);
+        file.setForceTagPosition(forceTagPosition);
+        file.open();
+        file.parseEverything(diag);
+        const auto streamOffset = file.containerOffset();
+        const auto duration = file.duration();
+        CPPUNIT_ASSERT(file.createAppropriateTags());
+        auto *const tag = std::find_if(file.id3v2Tags().cbegin(), file.id3v2Tags().cend(), [](const auto &id3v2Tag) {
+            return id3v2Tag->fieldCount();
+        })->get();
+        tag->setVersion(4, 0);
+        tag->setValue(KnownField::Title, TagValue(title));
+        file.applyChanges(diag, progress);
+        CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+        const auto result = file.applyChangesResult();
+
+        file.clearParsingResults();
+        file.open(true);
+        file.parseEverything(diag);
+        CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+        const auto appendedTag = std::find_if(
+            file.id3v2Tags().cbegin(), file.id3v2Tags().cend(), [](const auto &id3v2Tag) { return id3v2Tag->hasFooter(); });
+        CPPUNIT_ASSERT_MESSAGE("footer found", appendedTag != file.id3v2Tags().cend());
+        CPPUNIT_ASSERT_EQUAL(title, (*appendedTag)->value(KnownField::Title).toString());
+        CPPUNIT_ASSERT_EQUAL_MESSAGE("stream offset unchanged", streamOffset, file.containerOffset());
+        CPPUNIT_ASSERT_EQUAL(duration, file.duration());
+        CPPUNIT_ASSERT(result.strategy != ApplyChangesStrategy::Rewrite);
+        return streamOffset;
+    };
+
+    // append the tag when requested explicitly; the space in front of the frames is filled with a padding-only tag
+    const auto streamOffset = applyTitle("appended title", ElementPosition::AfterData, true);
+    const auto frames = originalData.substr(streamOffset, 0x1000);
+    CPPUNIT_ASSERT_EQUAL(frames, readFile(path, 0x1000000).substr(streamOffset, 0x1000));
+
+    // keep the existing appended tag
+    applyTitle("kept appended title", ElementPosition::Keep, false);
+
+    // append the tag when it does not fit in front of the frames anymore and the tag position is not forced
+    applyTitle(std::string(0x10000, 'a'), ElementPosition::BeforeData, false);
+    CPPUNIT_ASSERT_EQUAL(frames, readFile(path, 0x1000000).substr(streamOffset, 0x1000));
+
+    // the tag is made in front of the frames again if the tag position is forced
+    Diagnostics diag;
+    AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+    MediaFileInfo file(path);
+    file.setTagPosition(ElementPosition::BeforeData);
+    file.setForceTagPosition(true);
+    file.open();
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT(!file.id3v2Tags().empty());
+    for (const auto &id3v2Tag : file.id3v2Tags()) {
+        id3v2Tag->setValue(KnownField::Title, TagValue("prepended title"));
+    }
+    file.applyChanges(diag, progress);
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+    file.clearParsingResults();
+    file.open(true);
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+    CPPUNIT_ASSERT(std::none_of(file.id3v2Tags().cbegin(), file.id3v2Tags().cend(), [](const auto &id3v2Tag) { return id3v2Tag->hasFooter(); }));
+    CPPUNIT_ASSERT_EQUAL("prepended title"s, file.tags().front()->value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL(frames, readFile(path, 0x1000000).substr(file.containerOffset(), 0x1000));
+    file.close();
+    std::remove(path.data());
+    std::remove((path + ".bak").data());
+}
+
+void MediaFileInfoTests::testDataExtraction()
+{
+    // a lazily loaded cover is extracted without loading it
+    Diagnostics diag;
+    AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+    MediaFileInfo coverFile(testFilePath("mtx-test-data/mp4/alac/othertest-itunes.m4a"));
+    coverFile.open(true);
+    coverFile.parseTags(diag);
+    const auto &eagerCover = coverFile.tags().front()->value(KnownField::Cover);
+    MediaFileInfo lazyFile(testFilePath("mtx-test-data/mp4/alac/othertest-itunes.m4a"));
+    lazyFile.setParsingFlags(ParsingFlags::LazyLoadPictures);
+    lazyFile.open(true);
+    lazyFile.parseTags(diag);
+    const auto &lazyCover = lazyFile.tags().front()->value(KnownField::Cover);
+    CPPUNIT_ASSERT(lazyCover.lazyData());
+    CPPUNIT_ASSERT_EQUAL(lazyFile.path(), lazyCover.lazyData()->filePath());
+    MediaFileInfo file(workingCopyPath("matroska_wave1/test1.mkv"));
+    const auto extractedPath = file.path() + ".extracted";
+    lazyCover.lazyData()->extractTo(extractedPath);
+    CPPUNIT_ASSERT(!lazyCover.isDataLoaded());
+    CPPUNIT_ASSERT_EQUAL(std::string(eagerCover.dataPointer(), eagerCover.dataSize()), readFile(extractedPath, 0x100000));
+
+    // an attachment added from a file is written and extracted without buffering it
+    const auto attachmentData = readFile(testFilePath("matroska_wave1/logo3_256x256.png"), 0x100000);
+    file.setForceRewrite(true);
+    file.open();
+    file.parseEverything(diag);
+    auto *const attachment = file.container()->createAttachment();
+    CPPUNIT_ASSERT(attachment);
+    attachment->setFile(testFilePath("matroska_wave1/logo3_256x256.png"), diag);
+    attachment->setMimeType("image/png");
+    file.applyChanges(diag, progress);
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+    file.open(true);
+    file.parseEverything(diag);
+    const auto attachments = file.attachments();
+    CPPUNIT_ASSERT_EQUAL(1_st, attachments.size());
+    const auto *const data = attachments.front()->data();
+    CPPUNIT_ASSERT(data);
+    CPPUNIT_ASSERT(!data->buffer());
+    CPPUNIT_ASSERT_EQUAL(file.path(), data->filePath());
+    data->extractTo(extractedPath);
+    CPPUNIT_ASSERT(!data->buffer());
+    CPPUNIT_ASSERT_EQUAL(attachmentData, readFile(extractedPath, 0x100000));
+    std::remove(extractedPath.data());
+    std::remove((file.path() + ".bak").data());
+}
+
+void MediaFileInfoTests::testTailProbe()
+{
+    // detect APEv2, Lyrics3v2 and ID3v1 tags at the end of the data
+    const auto audioData = std::string(1000, 'x');
+    auto apeTag = std::string(16, 'i') + "APETAGEX";
+    apeTag.append("\xD0\x07\x00\x00\x30\x00\x00\x00\x01\x00\x00\x00\x00\x00\x00\x00", 16);
+    apeTag.append(8, '\0');
+    const auto lyrics3Tag = std::string("LYRICSBEGININD0000210") + "000021LYRICS200";
+    const auto id3v1Tag = "TAG" + std::string(125, '\0');
+    auto input = std::istringstream(audioData + apeTag + lyrics3Tag + id3v1Tag);
+    auto tailProbe = TailProbe();
+    tailProbe.probe(input);
+    CPPUNIT_ASSERT(tailProbe.probed);
+    CPPUNIT_ASSERT(tailProbe.hasId3v1Tag());
+    CPPUNIT_ASSERT_EQUAL(id3v1Tag, tailProbe.id3v1TagData);
+    CPPUNIT_ASSERT(tailProbe.hasLyrics3Tag());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(audioData.size() + apeTag.size()), tailProbe.lyrics3TagOffset);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(lyrics3Tag.size()), tailProbe.lyrics3TagSize);
+    CPPUNIT_ASSERT(tailProbe.hasApeTag());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(audioData.size()), tailProbe.apeTagOffset);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(apeTag.size()), tailProbe.apeTagSize);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(audioData.size()), tailProbe.audioEndOffset);
+
+    // a Lyrics3 tag is not considered without ID3v1 tag
+    input = std::istringstream(audioData + lyrics3Tag);
+    tailProbe.probe(input);
+    CPPUNIT_ASSERT(!tailProbe.hasId3v1Tag());
+    CPPUNIT_ASSERT(!tailProbe.hasLyrics3Tag());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(audioData.size() + lyrics3Tag.size()), tailProbe.audioEndOffset);
+
+    // the probe is shared between parsing the ID3v1 tag and determining the size of the MPEG audio stream
+    Diagnostics diag;
+    MediaFileInfo file(testFilePath("mtx-test-data/mp3/id3-tag-and-xing-header.mp3"));
+    file.open(true);
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT(file.id3v1Tag());
+    const auto &fileTailProbe = file.tailProbe();
+    CPPUNIT_ASSERT(fileTailProbe.probed);
+    CPPUNIT_ASSERT(fileTailProbe.hasId3v1Tag());
+    CPPUNIT_ASSERT_EQUAL(file.size() - 128, fileTailProbe.audioEndOffset);
+    const auto tracks = file.tracks();
+    CPPUNIT_ASSERT_EQUAL(1_st, tracks.size());
+    CPPUNIT_ASSERT_EQUAL(fileTailProbe.audioEndOffset - tracks.front()->startOffset(), tracks.front()->size());
+}
+
+void MediaFileInfoTests::testBufferingMp4MovieAtom()
+{
+    // parsing the track information from the buffered "moov"-atom yields the same results
+    for (const auto *const testFile : { "mtx-test-data/aac/he-aacv2-ps.m4a", "mtx-test-data/mp4/alac/othertest-itunes.m4a" }) {
+        Diagnostics diag;
+        MediaFileInfo referenceFile(testFilePath(testFile));
+        referenceFile.open(true);
+        referenceFile.parseEverything(diag);
+        MediaFileInfo file(testFilePath(testFile));
+        file.setParsingFlags(ParsingFlags::BufferMp4MovieAtom);
+        file.open(true);
+        file.parseEverything(diag);
+        CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tracksParsingStatus());
+        CPPUNIT_ASSERT_EQUAL(referenceFile.technicalSummary(), file.technicalSummary());
+        CPPUNIT_ASSERT_EQUAL(referenceFile.duration(), file.duration());
+        const auto referenceTracks = referenceFile.tracks(), tracks = file.tracks();
+        CPPUNIT_ASSERT_EQUAL(referenceTracks.size(), tracks.size());
+        for (std::size_t i = 0; i != tracks.size(); ++i) {
+            CPPUNIT_ASSERT_EQUAL(referenceTracks[i]->sampleCount(), tracks[i]->sampleCount());
+            CPPUNIT_ASSERT_EQUAL(static_cast<std::istream *>(&file.inputStream()), &tracks[i]->inputStream());
+        }
+        CPPUNIT_ASSERT_EQUAL(&file.inputStream(), &file.container()->stream());
+        CPPUNIT_ASSERT_EQUAL(referenceFile.tags().size(), file.tags().size());
+    }
+}
+
+void MediaFileInfoTests::testParallelMp4TrackParsing()
+{
+    // parsing the tracks concurrently yields the same results and messages, also when reading from the buffered "moov"-atom or the mapped file
+    for (const auto *const testFile : { "mtx-test-data/mp4/1080p-DTS-HD-7.1.mp4", "mp4/android-8.1-camera-recoding.mp4" }) {
+        Diagnostics referenceDiag;
+        MediaFileInfo referenceFile(testFilePath(testFile));
+        referenceFile.open(true);
+        referenceFile.parseTracks(referenceDiag);
+        for (const auto flags : { ParsingFlags::ParallelMp4TrackParsing, ParsingFlags::ParallelMp4TrackParsing | ParsingFlags::BufferMp4MovieAtom }) {
+            for (const auto mapping : { false, true }) {
+                Diagnostics diag;
+                MediaFileInfo file(testFilePath(testFile));
+                file.setParsingFlags(flags);
+                file.setMemoryMappingEnabled(mapping);
+                file.open(true);
+                file.parseTracks(diag);
+                CPPUNIT_ASSERT_EQUAL(ParsingStatus::Ok, file.tracksParsingStatus());
+                CPPUNIT_ASSERT_EQUAL(referenceFile.technicalSummary(), file.technicalSummary());
+                CPPUNIT_ASSERT_EQUAL(referenceDiag.size(), diag.size());
+                const auto referenceTracks = referenceFile.tracks(), tracks = file.tracks();
+                CPPUNIT_ASSERT_EQUAL(referenceTracks.size(), tracks.size());
+                CPPUNIT_ASSERT(tracks.size() > 1);
+                for (std::size_t i = 0; i != tracks.size(); ++i) {
+                    CPPUNIT_ASSERT(tracks[i]->isHeaderValid());
+                    CPPUNIT_ASSERT_EQUAL(referenceTracks[i]->sampleCount(), tracks[i]->sampleCount());
+                    CPPUNIT_ASSERT_EQUAL(referenceTracks[i]->size(), tracks[i]->size());
+                    CPPUNIT_ASSERT_EQUAL(referenceTracks[i]->maxBitrate(), tracks[i]->maxBitrate());
+                    CPPUNIT_ASSERT_EQUAL(static_cast<std::istream *>(&file.inputStream()), &tracks[i]->inputStream());
+                }
+            }
+        }
+    }
+}
+
+void MediaFileInfoTests::testMp4FragmentIndex()
+{
+    // locate the movie fragments by walking the top-level atoms and read them one by one
+    Diagnostics diag;
+    const auto path = workingCopyPath("mtx-test-data/mp4/dash/dragon-age-inquisition-H1LkM6IVlm4-video.mp4");
+    MediaFileInfo referenceFile(path);
+    referenceFile.open(true);
+    referenceFile.parseTracks(diag);
+    auto *const referenceContainer = dynamic_cast<Mp4Container *>(referenceFile.container());
+    CPPUNIT_ASSERT(referenceContainer);
+    CPPUNIT_ASSERT(!referenceContainer->parseFragmentIndex(diag));
+    auto &referenceTrack = *referenceContainer->tracks().front();
+    const auto offsets = referenceTrack.movieFragmentOffsets(diag);
+    CPPUNIT_ASSERT(offsets.size() > 1);
+    auto fragmentTimes = std::vector<std::uint64_t>();
+    auto fragmentSampleCount = std::uint64_t(), fragmentSize = std::uint64_t(), totalDuration = std::uint64_t();
+    for (const auto offset : offsets) {
+        const auto fragment = referenceTrack.readFragment(offset, diag);
+        CPPUNIT_ASSERT_EQUAL(offset, fragment.movieFragmentOffset);
+        CPPUNIT_ASSERT(fragment.nextMovieFragmentOffset == 0 || fragment.nextMovieFragmentOffset > offset);
+        CPPUNIT_ASSERT_EQUAL(fragment.chunkOffsets.size(), fragment.chunkSizes.size());
+        fragmentTimes.emplace_back(totalDuration);
+        fragmentSampleCount += fragment.sampleSizes.size();
+        fragmentSize += accumulate(fragment.chunkSizes.cbegin(), fragment.chunkSizes.cend(), std::uint64_t());
+        totalDuration += fragment.duration;
+    }
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+    CPPUNIT_ASSERT_EQUAL(referenceTrack.size(), fragmentSize);
+    referenceFile.close();
+
+    // append a "mfra"-atom denoting all movie fragments
+    auto tfra = std::string();
+    const auto appendUInt = [&tfra](std::uint64_t value, std::size_t size) {
+        while (size--) {
+            tfra.push_back(static_cast<char>((value >> (size * 8)) & 0xFF));
+        }
+    };
+    const auto tfraSize = 8 + 16 + offsets.size() * 19, mfraSize = 8 + tfraSize + 16;
+    appendUInt(mfraSize, 4);
+    appendUInt(Mp4AtomIds::MovieFragmentRandomAccess, 4);
+    appendUInt(tfraSize, 4);
+    appendUInt(Mp4AtomIds::TrackFragmentRandomAccess, 4);
+    appendUInt(0x01000000, 4); // version 1 to use 64-bit times and offsets
+    appendUInt(referenceTrack.id(), 4);
+    appendUInt(0, 4); // traf, trun and sample numbers are one byte
+    appendUInt(offsets.size(), 4);
+    for (std::size_t i = 0; i != offsets.size(); ++i) {
+        appendUInt(fragmentTimes[i], 8);
+        appendUInt(offsets[i], 8);
+        appendUInt(0x010101, 3);
+    }
+    appendUInt(16, 4);
+    appendUInt(Mp4AtomIds::MovieFragmentRandomAccessOffset, 4);
+    appendUInt(0, 4);
+    appendUInt(mfraSize, 4);
+    std::ofstream(path, ios_base::out | ios_base::app | ios_base::binary).write(tfra.data(), static_cast<std::streamsize>(tfra.size()));
+
+    // the fragments are located via the "mfra"-atom and not read when parsing the tracks lazily
+    MediaFileInfo file(path);
+    file.setParsingFlags(ParsingFlags::LazyMp4Fragments);
+    file.open(true);
+    file.parseTracks(diag);
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+    auto *const container = dynamic_cast<Mp4Container *>(file.container());
+    CPPUNIT_ASSERT(container);
+    const auto *const index = container->fragmentIndex(referenceTrack.id());
+    CPPUNIT_ASSERT(index);
+    CPPUNIT_ASSERT_EQUAL(offsets.size(), index->size());
+    CPPUNIT_ASSERT_EQUAL(fragmentTimes.back(), index->back().time);
+    CPPUNIT_ASSERT_EQUAL(1u, index->back().sampleNumber);
+    auto &track = *container->tracks().front();
+    CPPUNIT_ASSERT_EQUAL(referenceTrack.sampleCount(), track.sampleCount() + fragmentSampleCount);
+    CPPUNIT_ASSERT_EQUAL(referenceTrack.duration(), track.duration());
+    CPPUNIT_ASSERT(offsets == track.movieFragmentOffsets(diag));
+    const auto lastFragment = track.readFragment(offsets.back(), diag);
+    CPPUNIT_ASSERT_EQUAL(totalDuration, fragmentTimes.back() + lastFragment.duration);
+    CPPUNIT_ASSERT_THROW(track.readFragment(offsets.back() + 1, diag), Failure);
+    file.close();
+    std::remove(path.data());
+}
+
+void MediaFileInfoTests::testMp4FragmentedRewrite()
+{
+    // returns the chunk offsets (including the ones of the movie fragments), the chunk sizes, the sample sizes of the
+    // movie fragments and the data of all chunks of the first track
+    struct Chunks {
+        std::vector<std::uint64_t> offsets, sizes;
+        std::vector<std::uint32_t> fragmentSampleSizes;
+        std::string data;
+    };
+    const auto readChunks = [](MediaFileInfo &file, Diagnostics &diag) {
+        auto *const container = dynamic_cast<Mp4Container *>(file.container());
+        CPPUNIT_ASSERT(container);
+        CPPUNIT_ASSERT_EQUAL("dash"s, container->documentType());
+        auto &track = *container->tracks().front();
+        auto chunks = Chunks{ track.readChunkOffsets(true, diag), track.readChunkSizes(diag), {}, {} };
+        for (const auto offset : track.movieFragmentOffsets(diag)) {
+            const auto fragment = track.readFragment(offset, diag);
+            chunks.sizes.insert(chunks.sizes.end(), fragment.chunkSizes.cbegin(), fragment.chunkSizes.cend());
+            chunks.fragmentSampleSizes.insert(chunks.fragmentSampleSizes.end(), fragment.sampleSizes.cbegin(), fragment.sampleSizes.cend());
+        }
+        CPPUNIT_ASSERT_EQUAL(chunks.offsets.size(), chunks.sizes.size());
+        auto &stream = file.stream();
+        for (std::size_t i = 0; i != chunks.offsets.size(); ++i) {
+            auto buffer = std::string(chunks.sizes[i], '\0');
+            stream.seekg(static_cast<std::streamoff>(chunks.offsets[i]));
+            stream.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            chunks.data += buffer;
+        }
+        return chunks;
+    };
+
+    Diagnostics diag;
+    AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+    MediaFileInfo file(workingCopyPath("mtx-test-data/mp4/dash/dragon-age-inquisition-H1LkM6IVlm4-video.mp4"));
+    file.open();
+    file.parseEverything(diag);
+    const auto originalChunks = readChunks(file, diag);
+    CPPUNIT_ASSERT(!originalChunks.fragmentSampleSizes.empty());
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+
+    // rewrite the file with changed tags so the movie fragments are made anew
+    file.setForceRewrite(true);
+    CPPUNIT_ASSERT(file.createAppropriateTags());
+    file.tags().front()->setValue(KnownField::Title, TagValue("fragmented rewrite test"s));
+    file.applyChanges(diag, progress);
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+    CPPUNIT_ASSERT(file.applyChangesResult().strategy == ApplyChangesStrategy::Rewrite);
+
+    // the offsets within the movie fragments refer to the same samples within the new file
+    file.clearParsingResults();
+    file.open();
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+    CPPUNIT_ASSERT_EQUAL("fragmented rewrite test"s, file.tags().front()->value(KnownField::Title).toString());
+    const auto newChunks = readChunks(file, diag);
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+    CPPUNIT_ASSERT_EQUAL(originalChunks.offsets.size(), newChunks.offsets.size());
+    CPPUNIT_ASSERT(std::is_sorted(newChunks.offsets.cbegin(), newChunks.offsets.cend()));
+    CPPUNIT_ASSERT(originalChunks.sizes == newChunks.sizes);
+    CPPUNIT_ASSERT(originalChunks.fragmentSampleSizes == newChunks.fragmentSampleSizes);
+    CPPUNIT_ASSERT_MESSAGE("sample data is byte-identical", originalChunks.data == newChunks.data);
+    file.close();
+    std::remove(file.path().data());
+    std::remove((file.path() + ".bak").data());
+}
+
+void MediaFileInfoTests::testMp4Faststart()
+{
+    // returns the IDs of the top-level atoms and the chunk offsets of all tracks
+    const auto readLayout = [](MediaFileInfo &file, Diagnostics &diag) {
+        auto *const container = dynamic_cast<Mp4Container *>(file.container());
+        CPPUNIT_ASSERT(container);
+        auto atomIds = std::vector<std::uint32_t>();
+        for (auto *atom = container->firstElement(); atom; atom = atom->nextSibling()) {
+            atom->parse(diag);
+            atomIds.emplace_back(atom->id());
+        }
+        auto chunkOffsets = std::vector<std::vector<std::uint64_t>>();
+        for (const auto &track : container->tracks()) {
+            chunkOffsets.emplace_back(track->readChunkOffsets(false, diag));
+        }
+        return std::make_pair(atomIds, chunkOffsets);
+    };
+    // returns the data of all chunks of all tracks
+    const auto readChunkData = [](MediaFileInfo &file, const std::vector<std::vector<std::uint64_t>> &chunkOffsets, Diagnostics &diag) {
+        auto *const container = dynamic_cast<Mp4Container *>(file.container());
+        auto data = std::string();
+        for (std::size_t i = 0; i != container->trackCount(); ++i) {
+            const auto chunkSizes = container->tracks()[i]->readChunkSizes(diag);
+            CPPUNIT_ASSERT_EQUAL(chunkOffsets[i].size(), chunkSizes.size());
+            for (std::size_t j = 0; j != chunkSizes.size(); ++j) {
+                auto buffer = std::string(chunkSizes[j], '\0');
+                file.stream().seekg(static_cast<std::streamoff>(chunkOffsets[i][j]));
+                file.stream().read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                data += buffer;
+            }
+        }
+        return data;
+    };
+    const auto indexOf = [](const std::vector<std::uint32_t> &atomIds, std::uint32_t atomId) {
+        return std::find(atomIds.cbegin(), atomIds.cend(), atomId) - atomIds.cbegin();
+    };
+
+    // make a file with the "moov"-atom at the end
+    Diagnostics diag;
+    AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+    MediaFileInfo file(workingCopyPath("mtx-test-data/aac/he-aacv2-ps.m4a"));
+    file.setTagPosition(ElementPosition::AfterData);
+    file.setIndexPosition(ElementPosition::AfterData);
+    file.setForceTagPosition(true);
+    file.setForceIndexPosition(true);
+    file.setForceRewrite(true);
+    file.open();
+    file.parseEverything(diag);
+    file.applyChanges(diag, progress);
+    file.setForceRewrite(false);
+    file.clearParsingResults();
+    file.open();
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+    const auto [originalAtomIds, originalChunkOffsets] = readLayout(file, diag);
+    CPPUNIT_ASSERT(indexOf(originalAtomIds, Mp4AtomIds::Movie) > indexOf(originalAtomIds, Mp4AtomIds::MediaData));
+    const auto originalChunkData = readChunkData(file, originalChunkOffsets, diag);
+    const auto originalDuration = file.duration();
+
+    // move the "moov"-atom in front of the media data; the chunk offsets refer to the same data afterwards
+    file.makeFaststart(diag, progress);
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+    CPPUNIT_ASSERT(file.tagPosition() == ElementPosition::AfterData);
+    CPPUNIT_ASSERT(file.forceTagPosition());
+    file.clearParsingResults();
+    file.open();
+    file.parseEverything(diag);
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+    const auto [atomIds, chunkOffsets] = readLayout(file, diag);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint32_t>(Mp4AtomIds::FileType), atomIds.front());
+    CPPUNIT_ASSERT(indexOf(atomIds, Mp4AtomIds::Movie) < indexOf(atomIds, Mp4AtomIds::MediaData));
+    CPPUNIT_ASSERT_EQUAL(originalChunkOffsets.size(), chunkOffsets.size());
+    CPPUNIT_ASSERT(originalChunkOffsets != chunkOffsets);
+    CPPUNIT_ASSERT_MESSAGE("sample data is byte-identical", originalChunkData == readChunkData(file, chunkOffsets, diag));
+    CPPUNIT_ASSERT_EQUAL(originalDuration, file.duration());
+    file.close();
+    std::remove(file.path().data());
+    std::remove((file.path() + ".bak").data());
+}
+
+void MediaFileInfoTests::testMp4SegmentIndexGeneration()
+{
+    // a "sidx"-atom referring to all movie fragments is made in front of the first one (when rewriting and when not)
+    for (const auto forceRewrite : { false, true }) {
+        Diagnostics diag;
+        AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+        MediaFileInfo file(workingCopyPath("mtx-test-data/mp4/dash/dragon-age-inquisition-H1LkM6IVlm4-video.mp4"));
+        file.setForceRewrite(forceRewrite);
+        file.setMinPadding(0x200);
+        file.open();
+        file.parseEverything(diag);
+        auto *container = dynamic_cast<Mp4Container *>(file.container());
+        CPPUNIT_ASSERT(container);
+        CPPUNIT_ASSERT(!container->isSegmentIndexGenerationEnabled());
+        const auto durations = [&] {
+            auto &track = *container->tracks().front();
+            auto fragmentDurations = std::vector<std::uint64_t>();
+            for (const auto offset : track.movieFragmentOffsets(diag)) {
+                fragmentDurations.emplace_back(track.readFragment(offset, diag).duration);
+            }
+            return fragmentDurations;
+        }();
+        container->setSegmentIndexGenerationEnabled(true);
+        file.applyChanges(diag, progress);
+        CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+
+        file.open(true);
+        file.parseEverything(diag);
+        CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+        container = dynamic_cast<Mp4Container *>(file.container());
+        CPPUNIT_ASSERT(container);
+        auto *const sidxAtom = container->firstElement()->siblingByIdIncludingThis(Mp4AtomIds::SegmentIndex, diag);
+        CPPUNIT_ASSERT(sidxAtom);
+        CPPUNIT_ASSERT(!sidxAtom->siblingById(Mp4AtomIds::SegmentIndex, diag));
+        auto *const firstMoofAtom = sidxAtom->siblingById(Mp4AtomIds::MovieFragment, diag);
+        CPPUNIT_ASSERT(firstMoofAtom);
+        CPPUNIT_ASSERT(!firstMoofAtom->siblingById(Mp4AtomIds::SegmentIndex, diag));
+        auto &track = *container->tracks().front();
+        const auto offsets = track.movieFragmentOffsets(diag);
+        CPPUNIT_ASSERT_EQUAL(durations.size(), offsets.size());
+        CPPUNIT_ASSERT_EQUAL(firstMoofAtom->startOffset(), offsets.front());
+
+        // the references match the movie fragments of the new file
+        auto &stream = file.stream();
+        BinaryReader reader(&stream);
+        stream.seekg(static_cast<std::streamoff>(sidxAtom->dataOffset()));
+        CPPUNIT_ASSERT_EQUAL(0x01000000u, reader.readUInt32BE());
+        CPPUNIT_ASSERT_EQUAL(static_cast<std::uint32_t>(track.id()), reader.readUInt32BE());
+        CPPUNIT_ASSERT_EQUAL(track.timeScale(), reader.readUInt32BE());
+        reader.readUInt64BE(); // earliest presentation time
+        CPPUNIT_ASSERT_EQUAL(sidxAtom->endOffset(), offsets.front() - reader.readUInt64BE());
+        reader.readUInt16BE(); // reserved
+        CPPUNIT_ASSERT_EQUAL(offsets.size(), static_cast<std::size_t>(reader.readUInt16BE()));
+        auto segmentOffset = offsets.front();
+        for (std::size_t i = 0; i != offsets.size(); ++i) {
+            CPPUNIT_ASSERT_EQUAL(offsets[i], segmentOffset);
+            segmentOffset += reader.readUInt32BE();
+            CPPUNIT_ASSERT_EQUAL(durations[i], static_cast<std::uint64_t>(reader.readUInt32BE()));
+            reader.readUInt32BE(); // stream access point
+        }
+        file.close();
+        std::remove(file.path().data());
+        std::remove((file.path() + ".bak").data());
+    }
+}
+
+void MediaFileInfoTests::testMp4SampleCursor()
+{
+    Diagnostics diag;
+    MediaFileInfo file(testFilePath("mtx-test-data/mp4/1080p-DTS-HD-7.1.mp4"));
+    file.open(true);
+    file.parseTracks(diag);
+    auto *const container = dynamic_cast<Mp4Container *>(file.container());
+    CPPUNIT_ASSERT(container);
+    auto &track = *container->tracks().front();
+    CPPUNIT_ASSERT_EQUAL(GeneralMediaFormat::Avc, track.format().general);
+
+    // the samples add up to the chunks and the AVC samples consist of length-prefixed NAL units
+    const auto chunkOffsets = track.readChunkOffsets(false, diag);
+    const auto chunkSizes = track.readChunkSizes(diag);
+    auto cursor = Mp4SampleCursor(track);
+    auto unbufferedCursor = Mp4SampleCursor(track);
+    unbufferedCursor.setReadAhead(0);
+    auto sampleCount = std::uint64_t(), syncSampleCount = std::uint64_t(), lastDecodingTime = std::uint64_t();
+    auto chunkIndex = std::size_t(), chunkSize = std::uint64_t();
+    while (cursor.next(diag)) {
+        const auto &sample = cursor.sample();
+        CPPUNIT_ASSERT_EQUAL(sampleCount, static_cast<std::uint64_t>(sample.index));
+        CPPUNIT_ASSERT(!sampleCount || sample.decodingTime > lastDecodingTime);
+        CPPUNIT_ASSERT(sampleCount || sample.isSync);
+        if (chunkIndex + 1 < chunkOffsets.size() && sample.offset == chunkOffsets[chunkIndex + 1]) {
+            CPPUNIT_ASSERT_EQUAL(chunkSizes[chunkIndex], chunkSize);
+            ++chunkIndex;
+            chunkSize = 0;
+        }
+        chunkSize += sample.size;
+        if (sampleCount < 50) {
+            const auto data = std::string(cursor.data(diag));
+            CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(sample.size), data.size());
+            CPPUNIT_ASSERT(BE::toUInt32(data.data()) + 4 <= data.size());
+            CPPUNIT_ASSERT(unbufferedCursor.next(diag));
+            CPPUNIT_ASSERT_EQUAL(data, std::string(unbufferedCursor.data(diag)));
+        }
+        lastDecodingTime = sample.decodingTime;
+        syncSampleCount += sample.isSync;
+        ++sampleCount;
+    }
+    CPPUNIT_ASSERT_EQUAL(track.sampleCount(), sampleCount);
+    CPPUNIT_ASSERT_EQUAL(chunkOffsets.size() - 1, chunkIndex);
+    CPPUNIT_ASSERT_EQUAL(chunkSizes.back(), chunkSize);
+    CPPUNIT_ASSERT(syncSampleCount > 1);
+    CPPUNIT_ASSERT(syncSampleCount < sampleCount);
+
+    // seeking positions the cursor at the previous sync sample
+    CPPUNIT_ASSERT(cursor.seek(lastDecodingTime / 2, diag));
+    CPPUNIT_ASSERT(cursor.next(diag));
+    CPPUNIT_ASSERT(cursor.sample().isSync);
+    CPPUNIT_ASSERT(cursor.sample().index > 0);
+    CPPUNIT_ASSERT(cursor.sample().decodingTime <= lastDecodingTime / 2);
+    const auto keyframe = cursor.sample();
+    CPPUNIT_ASSERT(cursor.next(diag));
+    CPPUNIT_ASSERT_EQUAL(keyframe.index + 1, cursor.sample().index);
+    cursor.reset();
+    CPPUNIT_ASSERT(cursor.next(diag));
+    CPPUNIT_ASSERT_EQUAL(0u, cursor.sample().index);
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+}
+
+void MediaFileInfoTests::testMp4Chapters()
+{
+    // compose a minimal MP4 file with an empty track referring to a chapter text track and/or a "chpl"-atom
+    const auto uint32 = [](std::uint32_t value) {
+        auto bytes = std::string(4, '\0');
+        BE::getBytes(value, bytes.data());
+        return bytes;
+    };
+    const auto atom = [&uint32](const char *id, const std::string &data) { return uint32(static_cast<std::uint32_t>(8 + data.size())) + id + data; };
+    const auto fullAtom = [&atom](const char *id, const std::string &data) { return atom(id, std::string(4, '\0') + data); };
+    const auto track = [&](std::uint32_t id, const char *handler, const std::string &reference, const std::string &sampleTable) {
+        return atom("trak",
+            fullAtom("tkhd", uint32(0) + uint32(0) + uint32(id) + uint32(0) + uint32(3000) + std::string(60, '\0')) + reference
+                + atom("mdia",
+                    fullAtom("mdhd", uint32(0) + uint32(0) + uint32(1000) + uint32(3000) + "\x55\xC4\0\0"s)
+                        + fullAtom("hdlr", uint32(0) + handler + std::string(13, '\0')) + atom("minf", atom("stbl", sampleTable))));
+    };
+    const auto emptySampleTable = fullAtom("stsd", uint32(0)) + fullAtom("stts", uint32(0)) + fullAtom("stsc", uint32(0))
+        + fullAtom("stsz", uint32(0) + uint32(0)) + fullAtom("stco", uint32(0));
+    // note: The text samples are prefixed with their size; the 2nd one is UTF-16 encoded and the 3rd one has a UTF-8 BOM.
+    const auto textSamples = std::vector<std::string>{ "\0\x05Intro"s, "\0\x08\xFE\xFF\0M\0i\0d"s, "\0\x06\xEF\xBB\xBF"s + "End" };
+    // note: The 2nd sample is near the 1st one; the 3rd one is further apart than the default max. gap of Mp4SampleCursor::gather().
+    const auto gaps = std::vector<std::size_t>{ 0, 4, 0x10001 };
+    const auto chapterSampleTable = [&](const std::vector<std::uint64_t> &offsets) {
+        auto sampleSizes = std::string(), chunkOffsets = std::string();
+        for (std::size_t i = 0; i != textSamples.size(); ++i) {
+            sampleSizes += uint32(static_cast<std::uint32_t>(textSamples[i].size()));
+            chunkOffsets += uint32(static_cast<std::uint32_t>(offsets[i]));
+        }
+        return fullAtom("stsd", uint32(0)) + fullAtom("stts", uint32(1) + uint32(3) + uint32(1000))
+            + fullAtom("stsc", uint32(1) + uint32(1) + uint32(1) + uint32(1)) + fullAtom("stsz", uint32(0) + uint32(3) + sampleSizes)
+            + fullAtom("stco", uint32(3) + chunkOffsets);
+    };
+    const auto makeFile = [&](bool withChapterTrack, const std::string &chapterList) {
+        const auto fileType = atom("ftyp", "M4A "s + uint32(0) + "M4A isom");
+        const auto makeMovie = [&](const std::vector<std::uint64_t> &offsets) {
+            return atom("moov",
+                fullAtom("mvhd", uint32(0) + uint32(0) + uint32(1000) + uint32(3000) + std::string(80, '\0'))
+                    + track(1, "soun", withChapterTrack ? atom("tref", atom("chap", uint32(2))) : std::string(), emptySampleTable)
+                    + (withChapterTrack ? track(2, "text", std::string(), chapterSampleTable(offsets)) : std::string())
+                    + (chapterList.empty() ? std::string() : atom("udta", atom("chpl", chapterList))));
+        };
+        // note: The size of the "moov"-atom does not depend on the offsets so they can be determined using placeholders.
+        auto offsets = std::vector<std::uint64_t>(textSamples.size());
+        const auto mediaDataOffset = fileType.size() + makeMovie(offsets).size() + 8;
+        auto mediaData = std::string();
+        for (std::size_t i = 0; i != textSamples.size(); ++i) {
+            mediaData.append(gaps[i], 'x');
+            offsets[i] = mediaDataOffset + mediaData.size();
+            mediaData += textSamples[i];
+        }
+        return std::make_pair(fileType + makeMovie(offsets) + atom("mdat", mediaData), offsets);
+    };
+    const auto chapterListEntry = [](std::uint64_t startTime, std::string_view title) {
+        auto entry = std::string(8, '\0');
+        BE::getBytes(startTime, entry.data());
+        entry += static_cast<char>(title.size());
+        entry += title;
+        return entry;
+    };
+    const auto chapterListEntries = chapterListEntry(0, "One") + chapterListEntry(15000000, "Two");
+
+    const auto path = workingCopyPath("unsupported.bin");
+    MediaFileInfo file(path);
+    Diagnostics diag;
+    const auto parse = [&](const std::string &data) -> Mp4Container & {
+        file.close();
+        file.clearParsingResults();
+        diag.clear();
+        std::ofstream(path, ios_base::out | ios_base::trunc | ios_base::binary).write(data.data(), static_cast<std::streamsize>(data.size()));
+        file.open(true);
+        file.parseContainerFormat(diag);
+        file.parseTracks(diag);
+        auto *const container = dynamic_cast<Mp4Container *>(file.container());
+        CPPUNIT_ASSERT(container);
+        return *container;
+    };
+    const auto checkChapter = [](const Mp4Chapter *chapter, std::uint64_t id, const char *name, TimeSpan start, TimeSpan end) {
+        CPPUNIT_ASSERT(chapter);
+        CPPUNIT_ASSERT_EQUAL(id, chapter->id());
+        CPPUNIT_ASSERT_EQUAL(1_st, chapter->names().size());
+        CPPUNIT_ASSERT_EQUAL(std::string(name), static_cast<const std::string &>(chapter->names().front()));
+        CPPUNIT_ASSERT_EQUAL(start, chapter->startTime());
+        CPPUNIT_ASSERT_EQUAL(end, chapter->endTime());
+    };
+
+    // chapters are read from the chapter track (in favour of the "chpl"-atom); the samples close to each other are read at once
+    const auto [fileWithChapterTrack, sampleOffsets] = makeFile(true, "\0\0\0\0\x02"s + chapterListEntries);
+    file.setStatisticsEnabled(true);
+    file.setIoTracingEnabled(true);
+    auto *container = &parse(fileWithChapterTrack);
+    CPPUNIT_ASSERT_EQUAL(2_st, container->trackCount());
+#ifndef TAG_PARSER_NO_STATISTICS
+    const auto &trace = file.statistics()->ioTrace;
+    const auto firstChapterEvent = trace.events().size();
+#endif
+    file.parseChapters(diag);
+    CPPUNIT_ASSERT_EQUAL(3_st, container->chapterCount());
+    checkChapter(container->chapter(0), 1, "Intro", TimeSpan(), TimeSpan::fromSeconds(1.0));
+    checkChapter(container->chapter(1), 2, "Mid", TimeSpan::fromSeconds(1.0), TimeSpan::fromSeconds(2.0));
+    checkChapter(container->chapter(2), 3, "End", TimeSpan::fromSeconds(2.0), TimeSpan::fromSeconds(3.0));
+    CPPUNIT_ASSERT(container->chapter(0)->isTextSample());
+    CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+#ifndef TAG_PARSER_NO_STATISTICS
+    auto sampleReads = std::vector<std::pair<std::uint64_t, std::uint64_t>>();
+    for (auto i = trace.events().cbegin() + static_cast<std::ptrdiff_t>(firstChapterEvent), end = trace.events().cend(); i != end; ++i) {
+        if (i->operation == IoOperation::Read && i->offset >= sampleOffsets.front()) {
+            sampleReads.emplace_back(i->offset, i->size);
+        }
+    }
+    CPPUNIT_ASSERT_EQUAL(2_st, sampleReads.size());
+    CPPUNIT_ASSERT_EQUAL(sampleOffsets[0], sampleReads[0].first);
+    CPPUNIT_ASSERT_EQUAL(sampleOffsets[1] + textSamples[1].size() - sampleOffsets[0], sampleReads[0].second);
+    CPPUNIT_ASSERT_EQUAL(sampleOffsets[2], sampleReads[1].first);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(textSamples[2].size()), sampleReads[1].second);
+#endif
+    file.setIoTracingEnabled(false);
+    file.setStatisticsEnabled(false);
+
+    // gathering provides the same data regardless of whether the samples are read at once or one by one
+    for (const auto maxGap : { 0_uint64, 4_uint64, 0x10000_uint64, 0x10001_uint64 }) {
+        auto cursor = Mp4SampleCursor(*container->tracks().at(1));
+        auto samples = std::vector<std::string>();
+        CPPUNIT_ASSERT_EQUAL(3_st,
+            cursor.gather([&samples](const Mp4Sample &, std::string_view data) { samples.emplace_back(data); }, diag, maxGap));
+        CPPUNIT_ASSERT(textSamples == samples);
+    }
+
+    // the "chpl"-atom is read if there is no chapter track; the reserved bytes are only present in version 1
+    for (const auto &chapterList : { "\0\0\0\0\x02"s + chapterListEntries, "\x01\0\0\0\0\0\0\0\x02"s + chapterListEntries }) {
+        container = &parse(makeFile(false, chapterList).first);
+        file.parseChapters(diag);
+        CPPUNIT_ASSERT_EQUAL(2_st, container->chapterCount());
+        checkChapter(container->chapter(0), 1, "One", TimeSpan(), TimeSpan::fromSeconds(1.5));
+        checkChapter(container->chapter(1), 2, "Two", TimeSpan::fromSeconds(1.5), TimeSpan::fromSeconds(3.0));
+        CPPUNIT_ASSERT(!container->chapter(0)->isTextSample());
+        CPPUNIT_ASSERT(diag.level() < DiagLevel::Critical);
+    }
+
+    // the complete chapters of a truncated "chpl"-atom are read
+    container = &parse(makeFile(false, "\0\0\0\0\x03"s + chapterListEntries + chapterListEntry(20000000, "Three").substr(0, 10)).first);
+    file.parseChapters(diag);
+    CPPUNIT_ASSERT_EQUAL(2_st, container->chapterCount());
+    checkChapter(container->chapter(1), 2, "Two", TimeSpan::fromSeconds(1.5), TimeSpan::fromSeconds(3.0));
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::Critical, diag.level());
+    CPPUNIT_ASSERT(std::any_of(diag.cbegin(), diag.cend(), [](const DiagMessage &message) {
+        return message.message() == "\"chpl\"-atom is truncated after 2 of 3 chapters.";
+    }));
+
+    // a "chpl"-atom lacking even the number of chapters is rejected
+    container = &parse(makeFile(false, "\0\0\0\0"s).first);
+    file.parseChapters(diag);
+    CPPUNIT_ASSERT_EQUAL(0_st, container->chapterCount());
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::Critical, diag.level());
+    file.close();
+    std::remove(path.data());
+}
+
+void MediaFileInfoTests::testBufferingMatroskaMasterElements()
+{
+    // parsing from buffered master elements (done when not memory-mapped) yields the same results as parsing the mapped file
+    for (const auto *const testFile : { "matroska_wave1/test1.mkv", "mtx-test-data/mkv/handbrake-chapters-2.mkv", "mkv/nested-tags.mkv" }) {
+        Diagnostics referenceDiag, diag;
+        MediaFileInfo referenceFile(testFilePath(testFile));
+        referenceFile.setMemoryMappingEnabled(true);
+        referenceFile.open(true);
+        referenceFile.parseEverything(referenceDiag);
+        MediaFileInfo file(testFilePath(testFile));
+        file.open(true);
+        file.parseEverything(diag);
+        CPPUNIT_ASSERT_EQUAL(referenceDiag.level(), diag.level());
+        CPPUNIT_ASSERT_EQUAL(referenceFile.technicalSummary(), file.technicalSummary());
+        CPPUNIT_ASSERT_EQUAL(referenceFile.duration(), file.duration());
+        CPPUNIT_ASSERT_EQUAL(referenceFile.chapters().size(), file.chapters().size());
+        const auto referenceTags = referenceFile.tags(), tags = file.tags();
+        CPPUNIT_ASSERT_EQUAL(referenceTags.size(), tags.size());
+        for (std::size_t i = 0; i != tags.size(); ++i) {
+            CPPUNIT_ASSERT_EQUAL(referenceTags[i]->fieldCount(), tags[i]->fieldCount());
+            CPPUNIT_ASSERT(referenceTags[i]->value(KnownField::Title) == tags[i]->value(KnownField::Title));
+        }
+    }
+
+    // the buffer of a parent covers its children
+    Diagnostics diag;
+    MediaFileInfo file(testFilePath("matroska_wave1/test1.mkv"));
+    file.open(true);
+    file.parseContainerFormat(diag);
+    auto *const segment = static_cast<MatroskaContainer *>(file.container())->firstElement()->siblingByIdIncludingThis(MatroskaIds::Segment, diag);
+    CPPUNIT_ASSERT(segment);
+    auto *const tracks = segment->childById(MatroskaIds::Tracks, diag);
+    CPPUNIT_ASSERT(tracks);
+    const auto tracksBuffer = EbmlMasterBuffer(*tracks);
+    CPPUNIT_ASSERT(tracksBuffer.isActive());
+    auto *const trackEntry = tracks->childById(MatroskaIds::TrackEntry, diag);
+    CPPUNIT_ASSERT(trackEntry);
+    CPPUNIT_ASSERT(!EbmlMasterBuffer(*trackEntry).isActive());
+}
+
+void MediaFileInfoTests::testBufferingId3v2Tag()
+{
+    // parsing the frames from the buffered tag (done when not memory-mapped) yields the same results as parsing the mapped file
+    for (const auto *const testFile : { "mtx-test-data/mp3/id3-tag-and-xing-header.mp3", "misc/multiple_id3v2_4_values.mp3" }) {
+        for (const auto flags : { ParsingFlags::None, ParsingFlags::LazyLoadPictures }) {
+            Diagnostics referenceDiag, diag;
+            MediaFileInfo referenceFile(testFilePath(testFile));
+            referenceFile.setMemoryMappingEnabled(true);
+            referenceFile.open(true);
+            referenceFile.parseTags(referenceDiag);
+            MediaFileInfo file(testFilePath(testFile));
+            file.setParsingFlags(flags);
+            file.open(true);
+            file.parseTags(diag);
+            CPPUNIT_ASSERT_EQUAL(referenceDiag.level(), diag.level());
+            const auto &referenceTags = referenceFile.id3v2Tags(), &tags = file.id3v2Tags();
+            CPPUNIT_ASSERT_EQUAL(referenceTags.size(), tags.size());
+            CPPUNIT_ASSERT(!tags.empty());
+            for (std::size_t i = 0; i != tags.size(); ++i) {
+                CPPUNIT_ASSERT_EQUAL(referenceTags[i]->size(), tags[i]->size());
+                CPPUNIT_ASSERT_EQUAL(referenceTags[i]->paddingSize(), tags[i]->paddingSize());
+                CPPUNIT_ASSERT_EQUAL(referenceTags[i]->fieldCount(), tags[i]->fieldCount());
+                for (const auto field : { KnownField::Title, KnownField::Artist, KnownField::Album, KnownField::Cover }) {
+                    CPPUNIT_ASSERT(referenceTags[i]->value(field) == tags[i]->value(field));
+                }
+            }
+        }
+    }
+}
+
+void MediaFileInfoTests::testOggResync()
+{
+    // resyncing within a file finds the next page
+    auto file = ifstream(testFilePath("mtx-test-data/ogg/qt4dance_medium.ogg"), ios_base::in | ios_base::binary);
+    file.exceptions(ios_base::badbit | ios_base::failbit);
+    file.seekg(0, ios_base::end);
+    const auto fileSize = static_cast<std::uint64_t>(file.tellg());
+    auto reference = OggIterator(file, 0, fileSize);
+    reference.reset();
+    reference.nextPage();
+    CPPUNIT_ASSERT(reference);
+    const auto secondPageOffset = reference.currentPageOffset();
+    auto iterator = OggIterator(file, 0, fileSize);
+    CPPUNIT_ASSERT(iterator.resyncAt(1, true));
+    CPPUNIT_ASSERT_EQUAL(secondPageOffset, iterator.currentPageOffset());
+    CPPUNIT_ASSERT_EQUAL(1_st, iterator.pages().size());
+    CPPUNIT_ASSERT(!iterator.resyncAt(secondPageOffset + 1, true));
+
+    // data happening to contain the capture pattern in front of a valid page is only skipped when verifying the checksum
+    auto data = "OggS"s + string(22, '\1') + '\0';
+    const auto fakePageSize = data.size();
+    data.resize(fakePageSize + static_cast<std::size_t>(secondPageOffset));
+    file.seekg(0);
+    file.read(data.data() + fakePageSize, static_cast<streamsize>(secondPageOffset));
+    const auto mappedData = std::string_view(data);
+    for (const auto mapped : { false, true }) {
+        auto stream = istringstream(data);
+        auto dataIterator = OggIterator(stream, 0, data.size());
+        if (mapped) {
+            dataIterator.setMappedData(&mappedData);
+        }
+        CPPUNIT_ASSERT(dataIterator.resyncAt(0));
+        CPPUNIT_ASSERT_EQUAL(0_st, static_cast<std::size_t>(dataIterator.currentPageOffset()));
+        dataIterator.clear(stream, 0, data.size());
+        CPPUNIT_ASSERT(dataIterator.resyncAt(0, true));
+        CPPUNIT_ASSERT_EQUAL(fakePageSize, static_cast<std::size_t>(dataIterator.currentPageOffset()));
+    }
+}
+
+void MediaFileInfoTests::testOggChecksumVerification()
+{
+    const auto path = workingCopyPath("mtx-test-data/ogg/qt4dance_medium.ogg");
+    MediaFileInfo file(path);
+    Diagnostics diag;
+
+    // a valid file passes when reading via a file descriptor and from the memory-mapped file, regardless of the number of threads
+    for (const auto mapping : { false, true }) {
+        file.setMemoryMappingEnabled(mapping);
+        file.open(true);
+        file.parseContainerFormat(diag);
+        auto *const container = dynamic_cast<OggContainer *>(file.container());
+        CPPUNIT_ASSERT(container);
+        for (const auto threadCount : { 1_st, 4_st }) {
+            diag.clear();
+            container->verifyChecksums(diag, threadCount);
+            CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+        }
+        file.close();
+        file.clearParsingResults();
+    }
+
+    // break the data of a page in the middle of the file
+    auto corruptPageOffset = std::uint64_t(), corruptByteOffset = std::uint64_t();
+    {
+        std::fstream stream(path, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+        stream.exceptions(std::ios_base::badbit | std::ios_base::failbit);
+        stream.seekg(0, std::ios_base::end);
+        const auto fileSize = static_cast<std::uint64_t>(stream.tellg());
+        auto iterator = OggIterator(stream, 0, fileSize);
+        for (iterator.reset(); iterator && iterator.currentPageOffset() < fileSize / 2; iterator.nextPage()) {
+        }
+        CPPUNIT_ASSERT(iterator);
+        CPPUNIT_ASSERT(iterator.currentPage().dataSize());
+        corruptPageOffset = iterator.currentPageOffset();
+        corruptByteOffset = corruptPageOffset + iterator.currentPage().headerSize();
+        stream.seekg(static_cast<std::streamoff>(corruptByteOffset));
+        const auto byte = static_cast<char>(stream.get());
+        stream.seekp(static_cast<std::streamoff>(corruptByteOffset));
+        stream.put(static_cast<char>(~byte));
+    }
+
+    // the corrupted page is reported regardless of the number of threads
+    file.setMemoryMappingEnabled(false);
+    file.open(true);
+    file.parseContainerFormat(diag);
+    auto *const container = dynamic_cast<OggContainer *>(file.container());
+    CPPUNIT_ASSERT(container);
+    for (const auto threadCount : { 1_st, 4_st }) {
+        diag.clear();
+        container->verifyChecksums(diag, threadCount);
+        CPPUNIT_ASSERT_EQUAL(DiagLevel::Critical, diag.level());
+        CPPUNIT_ASSERT_EQUAL(1_st, static_cast<std::size_t>(std::count_if(diag.cbegin(), diag.cend(), [](const DiagMessage &message) {
+            return message.level() == DiagLevel::Critical;
+        })));
+        CPPUNIT_ASSERT(std::any_of(diag.cbegin(), diag.cend(), [corruptPageOffset](const DiagMessage &message) {
+            return message.message().find("OGG page at " + numberToString(corruptPageOffset)) != std::string::npos;
+        }));
+    }
+    file.close();
+    std::remove(path.data());
+}
+
+void MediaFileInfoTests::testMediaPayloadHash()
+{
+    Diagnostics diag;
+    AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+    for (const auto *const testFile : { "matroska_wave1/test1.mkv", "mtx-test-data/mp4/10-DanseMacabreOp.40.m4a", "mtx-test-data/opus/v-opus.ogg",
+             "flac/test.flac", "mtx-test-data/mp3/id3-tag-and-xing-header.mp3" }) {
+        const auto path = workingCopyPath(testFile);
+        MediaFileInfo file(path);
+        file.setBackupDirectory(std::string());
+        file.open();
+        const auto hash = file.hashMediaPayload(diag, progress, 1);
+        CPPUNIT_ASSERT_MESSAGE(testFile, hash.size > 0);
+        CPPUNIT_ASSERT_EQUAL(16_st, hash.toString().size());
+
+        // the hash does not depend on the number of threads
+        CPPUNIT_ASSERT_MESSAGE(testFile, hash == file.hashMediaPayload(diag, progress, 4));
+
+        // the hash does not change when the tags grow (so the media data is moved and Ogg pages are renumbered)
+        file.parseEverything(diag);
+        file.createAppropriateTags();
+        for (auto *const tag : file.tags()) {
+            tag->setValue(KnownField::Title, TagValue(std::string(0x4000, 'x'), TagTextEncoding::Utf8, TagTextEncoding::Utf8));
+        }
+        file.applyChanges(diag, progress);
+        file.close();
+        file.clearParsingResults();
+        file.open(true);
+        CPPUNIT_ASSERT_MESSAGE(testFile, hash == file.hashMediaPayload(diag, progress, 1));
+        file.close();
+        std::remove(path.data());
+        std::remove((path + ".bak").data());
+    }
+}
+
+void MediaFileInfoTests::testFlacSeekTable()
+{
+    // make a raw FLAC stream (mono, 8 kHz, 16 bit) with six frames of 4096 samples but no "METADATA_BLOCK_SEEKTABLE"
+    // note: Only the frame headers (including the CRC-8) are valid; the body of frame 2 contains a frame header with an invalid
+    //       CRC-8 and one with a valid CRC-8 but a non-continuous frame number which must not be taken as frames.
+    const auto path = workingCopyPath("unsupported.bin");
+    const auto headers = { "\xFF\xF8\xC0\x00\x00\x07"s, "\xFF\xF8\xC0\x00\x01\x00"s, "\xFF\xF8\xC0\x00\x02\x09"s, "\xFF\xF8\xC0\x00\x03\x0E"s,
+        "\xFF\xF8\xC0\x00\x04\x1B"s, "\xFF\xF8\xC0\x00\x05\x1C"s };
+    auto frames = std::string();
+    for (const auto &header : headers) {
+        frames += header + std::string(30, '\0');
+    }
+    frames.replace(2 * 36 + 6, 12, "\xFF\xF8\xC0\x00\x03\x00\xFF\xF8\xC0\x00\x09\x38"s);
+    const auto metaData = "fLaC\0\0\0\x22"s // STREAMINFO
+        "\x10\x00\x10\x00\0\0\0\0\0\0\x01\xF4\x00\xF0\x00\x00\x60\x00"s
+        + std::string(16, '\0') + "\x81\0\x01\0"s + std::string(0x100, '\0'); // last block: PADDING of 0x104 bytes
+    const auto streamOffset = static_cast<std::uint32_t>(metaData.size());
+    CPPUNIT_ASSERT_EQUAL(302u, streamOffset);
+    {
+        const auto originalData = metaData + frames;
+        std::ofstream(path, ios_base::out | ios_base::trunc | ios_base::binary)
+            .write(originalData.data(), static_cast<streamsize>(originalData.size()));
+    }
+
+    MediaFileInfo file(path);
+    file.setBackupDirectory(std::string());
+    file.setMaxPadding(0x1000);
+    Diagnostics diag;
+    AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+    const auto parse = [&file, &diag, streamOffset]() -> const FlacStream & {
+        file.open();
+        file.parseEverything(diag);
+        CPPUNIT_ASSERT_EQUAL(ContainerFormat::Flac, file.containerFormat());
+        const auto *const flacStream = dynamic_cast<const FlacStream *>(file.tracks().front());
+        CPPUNIT_ASSERT(flacStream);
+        CPPUNIT_ASSERT_EQUAL(8000u, flacStream->samplingFrequency());
+        CPPUNIT_ASSERT_EQUAL(24576_uint64, flacStream->sampleCount());
+        CPPUNIT_ASSERT_EQUAL(streamOffset, flacStream->streamOffset());
+        return *flacStream;
+    };
+    const auto applyChanges = [&file, &diag, &progress] {
+        file.applyChanges(diag, progress);
+        CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+        CPPUNIT_ASSERT_EQUAL(ApplyChangesStrategy::InPlace, file.applyChangesResult().strategy);
+        file.close();
+        file.clearParsingResults();
+    };
+    const auto seekPoint = [](std::uint64_t sample, std::uint64_t offset) {
+        auto point = std::string(18, '\0');
+        BE::getBytes(sample, point.data());
+        BE::getBytes(offset, point.data() + 8);
+        BE::getBytes(static_cast<std::uint16_t>(4096), point.data() + 16);
+        return point;
+    };
+
+    // a seek point is made for each frame containing a multiple of a second, so for the frames containing sample 0, 8000,
+    // 16000 and 24000; the seek table is written in front of the padding which absorbs it so the frames are not moved
+    CPPUNIT_ASSERT(!parse().hasSeekTable());
+    file.setFlacSeekPointInterval(TimeSpan::fromSeconds(1.0));
+    applyChanges();
+    CPPUNIT_ASSERT(std::any_of(diag.cbegin(), diag.cend(), [](const DiagMessage &message) {
+        return message.message() == "Made seek table with 4 seek points from 6 frames.";
+    }));
+    const auto flacStream = &parse();
+    CPPUNIT_ASSERT(flacStream->hasSeekTable());
+    CPPUNIT_ASSERT_EQUAL(0x104u - 4u - 18u * 4u, flacStream->paddingSize());
+    const auto fileData = readFile(path, 0x10000);
+    CPPUNIT_ASSERT_EQUAL(metaData.substr(0, 42), fileData.substr(0, 42));
+    CPPUNIT_ASSERT_EQUAL("\x03\0\0\x48"s + seekPoint(0, 0) + seekPoint(4096, 36) + seekPoint(12288, 3 * 36) + seekPoint(20480, 5 * 36),
+        fileData.substr(42, 4 + 18 * 4));
+    CPPUNIT_ASSERT_EQUAL("\x81\0\0\xB4"s, fileData.substr(42 + 4 + 18 * 4, 4)); // last block: PADDING of 184 bytes
+    CPPUNIT_ASSERT_EQUAL(frames, fileData.substr(streamOffset));
+
+    // the present seek table is kept as-is when applying changes again
+    diag.clear();
+    applyChanges();
+    parse();
+    CPPUNIT_ASSERT_EQUAL(fileData, readFile(path, 0x10000));
+    for (const auto &message : diag) {
+        CPPUNIT_ASSERT(message.message().find("seek table") == std::string::npos);
+    }
+    file.close();
+    std::remove(path.data());
+}
+
+void MediaFileInfoTests::testWaveTagWriting()
+{
+    // make a RIFF/WAVE file with an "INFO" list and an "id3 " chunk in front of an odd-sized "data" chunk
+    const auto path = workingCopyPath("unsupported.bin");
+    const auto audioData = "\x01\x02\x03\x04\x05\x06\x07"s;
+    const auto originalData = "RIFF\x64\0\0\0WAVE"s // RIFF chunk of 100 bytes
+        "fmt \x10\0\0\0\x01\0\x01\0\x40\x1F\0\0\x80\x3E\0\0\x02\0\x10\0" // PCM, 1 channel, 8 kHz, 16 bit
+        "LIST\x10\0\0\0INFOINAM\x04\0\0\0old\0" // at offset 36
+        "id3 \x18\0\0\0ID3\x04\0\0\0\0\0\x0ETIT2\0\0\0\x04\0\0\0old" // at offset 60
+        "data\x07\0\0\0"
+        + audioData + '\0'; // at offset 92, followed by the pad byte
+    CPPUNIT_ASSERT_EQUAL(108_st, originalData.size());
+    {
+        std::ofstream(path, ios_base::out | ios_base::trunc | ios_base::binary).write(originalData.data(), 108);
+    }
+
+    MediaFileInfo file(path);
+    file.setBackupDirectory(std::string());
+    Diagnostics diag;
+    AbortableProgressFeedback progress(AbortableProgressFeedback::Callback{});
+    const auto parse = [&file, &diag]() -> const WaveAudioStream & {
+        file.open();
+        file.parseEverything(diag);
+        CPPUNIT_ASSERT_EQUAL(ContainerFormat::RiffWave, file.containerFormat());
+        CPPUNIT_ASSERT_EQUAL(1_st, file.trackCount());
+        const auto *const waveStream = dynamic_cast<const WaveAudioStream *>(file.tracks().front());
+        CPPUNIT_ASSERT(waveStream);
+        CPPUNIT_ASSERT(!waveStream->isTruncated());
+        CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(file.size()), waveStream->riffEndOffset());
+        CPPUNIT_ASSERT(waveStream->infoTag());
+        CPPUNIT_ASSERT_EQUAL(1_st, file.id3v2Tags().size());
+        return *waveStream;
+    };
+    const auto chunkIds = [](const WaveAudioStream &waveStream) {
+        auto ids = std::string();
+        for (const auto &chunk : waveStream.chunks()) {
+            ids += interpretIntegerAsString<std::uint32_t>(chunk.id);
+        }
+        return ids;
+    };
+    const auto checkAudioData = [&path, &audioData] {
+        const auto data = readFile(path, 0x10000);
+        CPPUNIT_ASSERT_EQUAL("data\x07\0\0\0"s + audioData + '\0', data.substr(92, 16));
+    };
+    const auto applyChanges = [&file, &diag, &progress] {
+        file.applyChanges(diag, progress);
+        CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+        file.close();
+        file.clearParsingResults();
+    };
+
+    // the existing tags are read
+    const auto *waveStream = &parse();
+    CPPUNIT_ASSERT_EQUAL("fmt LISTid3 data"s, chunkIds(*waveStream));
+    CPPUNIT_ASSERT_EQUAL("old"s, waveStream->infoTag()->value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL("old"s, file.id3v2Tags().front()->value(KnownField::Title).toString());
+
+    // the tag chunks in front of "data" are turned into "JUNK" chunks and new tag chunks are appended; "data" is not moved
+    waveStream->infoTag()->setValue(KnownField::Title, TagValue(std::string(0x100, 'x')));
+    waveStream->infoTag()->setValue(KnownField::Artist, TagValue("ab"));
+    file.id3v2Tags().front()->setValue(KnownField::Title, TagValue("abc"));
+    applyChanges();
+    CPPUNIT_ASSERT_EQUAL(ApplyChangesStrategy::InPlace, file.applyChangesResult().strategy);
+    waveStream = &parse();
+    CPPUNIT_ASSERT_EQUAL("fmt JUNKJUNKdataLISTid3 "s, chunkIds(*waveStream));
+    const auto &chunks = waveStream->chunks();
+    CPPUNIT_ASSERT_EQUAL(36_st, static_cast<std::size_t>(chunks[1].offset));
+    CPPUNIT_ASSERT_EQUAL(60_st, static_cast<std::size_t>(chunks[2].offset));
+    CPPUNIT_ASSERT_EQUAL(92_st, static_cast<std::size_t>(chunks[3].offset));
+    checkAudioData();
+
+    // odd-sized sub chunks and chunks are followed by a pad byte: "INAM" (0x102 bytes) and "IART" (3 bytes) are padded
+    CPPUNIT_ASSERT_EQUAL(108_st, static_cast<std::size_t>(chunks[4].offset));
+    CPPUNIT_ASSERT_EQUAL(4u + 8u + 0x102u + 8u + 4u, chunks[4].dataSize);
+    CPPUNIT_ASSERT_EQUAL(chunks[4].endOffset(), chunks[5].offset);
+    CPPUNIT_ASSERT_EQUAL(std::string(0x100, 'x'), waveStream->infoTag()->value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL("ab"s, waveStream->infoTag()->value(KnownField::Artist).toString());
+    CPPUNIT_ASSERT_EQUAL("abc"s, file.id3v2Tags().front()->value(KnownField::Title).toString());
+    const auto id3ChunkSize = chunks[5].dataSize;
+    const auto sizeBeforeShrinking = file.size();
+
+    // shrinking the tags truncates the file; the "id3 " chunk has now the other parity so both cases are covered
+    waveStream->infoTag()->setValue(KnownField::Title, TagValue("short"));
+    file.id3v2Tags().front()->setValue(KnownField::Title, TagValue("abcd"));
+    applyChanges();
+    waveStream = &parse();
+    CPPUNIT_ASSERT_EQUAL("fmt JUNKJUNKdataLISTid3 "s, chunkIds(*waveStream));
+    CPPUNIT_ASSERT_EQUAL(id3ChunkSize + 1, waveStream->chunks()[5].dataSize);
+    CPPUNIT_ASSERT_EQUAL(waveStream->chunks()[5].endOffset(), static_cast<std::uint64_t>(file.size()));
+    CPPUNIT_ASSERT(file.size() < sizeBeforeShrinking);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(file.size()), static_cast<std::uint64_t>(readFile(path, 0x10000).size()));
+    CPPUNIT_ASSERT_EQUAL("short"s, waveStream->infoTag()->value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL("abcd"s, file.id3v2Tags().front()->value(KnownField::Title).toString());
+    checkAudioData();
+
+    // writing to a different file leaves the original file untouched
+    const auto originalFileData = readFile(path, 0x10000);
+    const auto savePath = path + "-saved.wav";
+    file.id3v2Tags().front()->setValue(KnownField::Title, TagValue("saved"));
+    file.setSaveFilePath(savePath);
+    applyChanges();
+    CPPUNIT_ASSERT_EQUAL(ApplyChangesStrategy::Rewrite, file.applyChangesResult().strategy);
+    CPPUNIT_ASSERT_EQUAL(savePath, file.path());
+    CPPUNIT_ASSERT_EQUAL(originalFileData, readFile(path, 0x10000));
+    waveStream = &parse();
+    CPPUNIT_ASSERT_EQUAL("fmt JUNKJUNKdataLISTid3 "s, chunkIds(*waveStream));
+    CPPUNIT_ASSERT_EQUAL("short"s, waveStream->infoTag()->value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL("saved"s, file.id3v2Tags().front()->value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL(originalFileData.substr(92, 16), readFile(savePath, 0x10000).substr(92, 16));
+    file.close();
+    std::remove(path.data());
+    std::remove(savePath.data());
+}
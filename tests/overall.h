@@ -17,6 +17,7 @@ using namespace CppUtilities;
 #include <cppunit/TestFixture.h>
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <iostream>
 #include <queue>
 #include <string>
 
@@ -30,6 +31,7 @@ enum class TagStatus { Original, TestMetaDataPresent, Removed };
 namespace SimpleTestFlags {
 enum TestFlag {
     RemoveTag = 0x1,
+    UseRewriteThreads = 0x2,
 };
 }
 
@@ -50,6 +52,15 @@ class OverallTests : public TestFixture {
     CPPUNIT_TEST(testFlacMaking);
     CPPUNIT_TEST(testMkvMakingWithDifferentSettings);
     CPPUNIT_TEST(testMkvMakingNestedTags);
+    CPPUNIT_TEST(testMkvIndexGeneration);
+    CPPUNIT_TEST(testMkvFinalizing);
+    CPPUNIT_TEST(testMkvSeekHeadReservation);
+    CPPUNIT_TEST(testMkvCrc32);
+    CPPUNIT_TEST(testMkvTagPatching);
+    CPPUNIT_TEST(testMp4TagFieldPatching);
+    CPPUNIT_TEST(testMp4UserDataPatching);
+    CPPUNIT_TEST(testMp4ChunkCopyThreads);
+    CPPUNIT_TEST(testMp4Interleaving);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -115,7 +126,16 @@ public:
     void testFlacParsing();
     void testMkvMakingWithDifferentSettings();
     void testMkvMakingNestedTags();
+    void testMkvIndexGeneration();
+    void testMkvFinalizing();
+    void testMkvSeekHeadReservation();
+    void testMkvCrc32();
+    void testMkvTagPatching();
     void testMp4Making();
+    void testMp4TagFieldPatching();
+    void testMp4UserDataPatching();
+    void testMp4ChunkCopyThreads();
+    void testMp4Interleaving();
     void testMp3Making();
     void testOggMaking();
     void testFlacMaking();
@@ -3,6 +3,9 @@
 #include "./overall.h"
 
 #include "../abstracttrack.h"
+#include "../matroska/ebmlid.h"
+#include "../matroska/matroskablockcursor.h"
+#include "../matroska/matroskachaptercursor.h"
 #include "../matroska/matroskacontainer.h"
 #include "../mp4/mp4ids.h"
 #include "../mpegaudio/mpegaudioframe.h"
@@ -12,8 +15,10 @@
 #include <c++utilities/conversion/stringconversion.h>
 #include <c++utilities/io/misc.h>
 
+#include <algorithm>
 #include <cstring>
 #include <fstream>
+#include <map>
 
 using namespace CppUtilities;
 
@@ -458,6 +463,43 @@ void OverallTests::checkMkvTestfileHandbrakeChapters()
             CPPUNIT_FAIL(argsToString("unknown chapter ID ", chapter->id()));
         }
     }
+    auto cursor = MatroskaChapterCursor(*static_cast<MatroskaContainer *>(m_fileInfo.container()));
+    auto cursorDiag = Diagnostics();
+    auto visitedChapterIds = vector<std::uint64_t>();
+    while (cursor.next(cursorDiag)) {
+        CPPUNIT_ASSERT(cursor.editionEntry());
+        if (const auto *const chapter = cursor.chapter()) {
+            CPPUNIT_ASSERT_EQUAL(0_st, cursor.depth());
+            visitedChapterIds.emplace_back(chapter->id());
+        }
+    }
+    CPPUNIT_ASSERT_EQUAL(2_st, visitedChapterIds.size());
+    CPPUNIT_ASSERT_EQUAL(chapters[0]->id(), visitedChapterIds[0]);
+    CPPUNIT_ASSERT_EQUAL(chapters[1]->id(), visitedChapterIds[1]);
+    auto blockCursor = MatroskaBlockCursor(*static_cast<MatroskaContainer *>(m_fileInfo.container()));
+    auto lastTimestamps = std::map<std::uint64_t, std::int64_t>();
+    auto blockCount = 0_st, keyframeCount = 0_st;
+    while (blockCursor.next(cursorDiag)) {
+        const auto &block = blockCursor.block();
+        CPPUNIT_ASSERT(block.trackNumber == 1 || block.trackNumber == 2);
+        CPPUNIT_ASSERT(!block.frames.empty());
+        CPPUNIT_ASSERT(block.offset > blockCursor.clusterOffset());
+        if (block.trackNumber == 2) {
+            // timestamps of the audio track must not decrease (unlike the ones of the video track due to B-frames)
+            const auto [lastTimestamp, inserted] = lastTimestamps.emplace(block.trackNumber, block.timestamp);
+            CPPUNIT_ASSERT(inserted || lastTimestamp->second <= block.timestamp);
+            lastTimestamp->second = block.timestamp;
+        }
+        keyframeCount += block.isKeyframe;
+        ++blockCount;
+    }
+    CPPUNIT_ASSERT(blockCount > 0);
+    CPPUNIT_ASSERT(keyframeCount > 0);
+    if (blockCursor.seek(15000, cursorDiag)) {
+        CPPUNIT_ASSERT(blockCursor.next(cursorDiag));
+    }
+    blockCursor.reset();
+    CPPUNIT_ASSERT(blockCursor.next(cursorDiag));
     const auto tags = m_fileInfo.tags();
     switch (m_tagStatus) {
     case TagStatus::Original:
@@ -616,6 +658,8 @@ void OverallTests::setMkvTestMetaData()
     trackIds.emplace_back(m_fileInfo.tracks().at(0)->id());
     Tag *newTag = container->createTag(TagTarget(30, trackIds));
     CPPUNIT_ASSERT_MESSAGE("create tag", newTag);
+    CPPUNIT_ASSERT_EQUAL(newTag, static_cast<Tag *>(container->tagByTarget(TagTarget(30, trackIds))));
+    CPPUNIT_ASSERT_EQUAL(newTag, static_cast<Tag *>(container->createTag(TagTarget(30, trackIds))));
     newTag->setValue(KnownField::Album, m_testAlbum);
     newTag->setValue(KnownField::PartNumber, m_testPartNumber);
     newTag->setValue(KnownField::TotalParts, m_testTotalParts);
@@ -746,3 +790,412 @@ void OverallTests::testMkvMakingNestedTags()
     m_fileInfo.setIndexPosition(ElementPosition::BeforeData);
     makeFile(workingCopyPath("mkv/nested-tags.mkv"), &OverallTests::noop, &OverallTests::checkMkvTestfileNestedTags);
 }
+
+/*!
+ * \brief Tests generating a "Cues"-element for Matroska files which have none.
+ */
+void OverallTests::testMkvIndexGeneration()
+{
+    cerr << endl << "Matroska maker - generate index" << endl;
+    m_fileInfo.setForceFullParse(true);
+    m_fileInfo.setForceRewrite(false);
+    m_fileInfo.setIndexPosition(ElementPosition::BeforeData);
+    m_fileInfo.setMinPadding(0);
+    m_fileInfo.setMaxPadding(numeric_limits<size_t>::max());
+    for (const char *const testFile : { "matroska_wave1/test1.mkv", "matroska_wave1/test2.mkv", "matroska_wave1/test3.mkv",
+             "matroska_wave1/test4.mkv", "matroska_wave1/test5.mkv", "matroska_wave1/test6.mkv", "matroska_wave1/test7.mkv",
+             "matroska_wave1/test8.mkv" }) {
+        const auto path = workingCopyPath(testFile);
+        m_diag.clear();
+        m_fileInfo.setPath(path);
+        m_fileInfo.reopen(true);
+        m_fileInfo.parseEverything(m_diag);
+        auto *container = static_cast<MatroskaContainer *>(m_fileInfo.container());
+        CPPUNIT_ASSERT(container);
+        if (container->determineIndexPosition(m_diag) == ElementPosition::Keep) {
+            cerr << "- generating index for " << testFile << endl;
+            container->setIndexGenerationEnabled(true);
+            m_fileInfo.applyChanges(m_diag, m_progress);
+            m_fileInfo.clearParsingResults();
+            m_fileInfo.parseEverything(m_diag);
+            container = static_cast<MatroskaContainer *>(m_fileInfo.container());
+            CPPUNIT_ASSERT(container);
+            CPPUNIT_ASSERT_EQUAL(ElementPosition::BeforeData, container->determineIndexPosition(m_diag));
+            Diagnostics indexDiag;
+            container->validateIndex(indexDiag);
+            CPPUNIT_ASSERT(indexDiag.level() <= DiagLevel::Information);
+        }
+        m_fileInfo.close();
+        remove(path.c_str());
+        remove((path + ".bak").c_str());
+    }
+}
+
+/*!
+ * \brief Tests finalizing "matroska_wave1/test4.mkv" which has clusters of unknown size and no "Cues"-element.
+ * \remarks The file is finalized in-place and when rewriting it. In both cases the collected cue points must refer to
+ *          the start of a "Cluster"-element.
+ */
+void OverallTests::testMkvFinalizing()
+{
+    cerr << endl << "Matroska maker - finalize" << endl;
+    m_fileInfo.setForceFullParse(true);
+    m_fileInfo.setIndexPosition(ElementPosition::Keep);
+    m_fileInfo.setMinPadding(0);
+    m_fileInfo.setMaxPadding(numeric_limits<size_t>::max());
+    for (const auto forceRewrite : { false, true }) {
+        const auto path = workingCopyPath("matroska_wave1/test4.mkv");
+        m_diag.clear();
+        m_fileInfo.setForceRewrite(forceRewrite);
+        m_fileInfo.setPath(path);
+        m_fileInfo.reopen(true);
+        m_fileInfo.parseEverything(m_diag);
+        auto *container = static_cast<MatroskaContainer *>(m_fileInfo.container());
+        CPPUNIT_ASSERT(container);
+        container->setFinalizingEnabled(true);
+        m_fileInfo.applyChanges(m_diag, m_progress);
+        CPPUNIT_ASSERT(std::any_of(m_diag.cbegin(), m_diag.cend(),
+            [](const auto &message) { return message.message().find("Generated index with ") == 0; }));
+
+        // reparse the finalized file
+        auto diag = Diagnostics();
+        m_fileInfo.clearParsingResults();
+        m_fileInfo.parseEverything(diag);
+        CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+        container = static_cast<MatroskaContainer *>(m_fileInfo.container());
+        CPPUNIT_ASSERT(container);
+        auto *const segmentElement = container->firstElement()->siblingById(MatroskaIds::Segment, diag);
+        CPPUNIT_ASSERT(segmentElement);
+        auto clusterOffsets = vector<std::uint64_t>();
+        for (auto *cluster = segmentElement->childById(MatroskaIds::Cluster, diag); cluster;
+             cluster = cluster->siblingById(MatroskaIds::Cluster, diag)) {
+            clusterOffsets.emplace_back(cluster->startOffset() - segmentElement->dataOffset());
+        }
+        CPPUNIT_ASSERT(!clusterOffsets.empty());
+
+        // check whether each cue point refers to a cluster containing a video frame
+        auto videoTrackNumber = std::uint64_t();
+        for (const auto *const track : m_fileInfo.tracks()) {
+            if (track->mediaType() == MediaType::Video) {
+                videoTrackNumber = track->trackNumber();
+            }
+        }
+        CPPUNIT_ASSERT(videoTrackNumber);
+        auto *const cuesElement = segmentElement->childById(MatroskaIds::Cues, diag);
+        CPPUNIT_ASSERT(cuesElement);
+        auto cuePointCount = 0_st;
+        for (auto *cuePoint = cuesElement->childById(MatroskaIds::CuePoint, diag); cuePoint;
+             cuePoint = cuePoint->siblingById(MatroskaIds::CuePoint, diag), ++cuePointCount) {
+            auto *const positions = cuePoint->childById(MatroskaIds::CueTrackPositions, diag);
+            CPPUNIT_ASSERT(positions);
+            auto *const track = positions->childById(MatroskaIds::CueTrack, diag);
+            auto *const clusterPosition = positions->childById(MatroskaIds::CueClusterPosition, diag);
+            CPPUNIT_ASSERT(track);
+            CPPUNIT_ASSERT(clusterPosition);
+            CPPUNIT_ASSERT_EQUAL(videoTrackNumber, track->readUInteger());
+            CPPUNIT_ASSERT(std::find(clusterOffsets.cbegin(), clusterOffsets.cend(), clusterPosition->readUInteger()) != clusterOffsets.cend());
+        }
+        CPPUNIT_ASSERT(cuePointCount > 0);
+        CPPUNIT_ASSERT(cuePointCount <= clusterOffsets.size());
+        Diagnostics indexDiag;
+        container->validateIndex(indexDiag);
+        CPPUNIT_ASSERT(indexDiag.level() <= DiagLevel::Information);
+        m_fileInfo.close();
+        remove(path.c_str());
+        remove((path + ".bak").c_str());
+    }
+}
+
+/*!
+ * \brief Tests whether adding a tag is done in-place when space has been reserved after the "SeekHead"-element.
+ */
+void OverallTests::testMkvSeekHeadReservation()
+{
+    cerr << endl << "Matroska maker - reserve space after \"SeekHead\"-element" << endl;
+    const auto path = workingCopyPath("matroska_wave1/test1.mkv");
+    const auto firstClusterOffset = [this] {
+        const auto *const container = static_cast<MatroskaContainer *>(m_fileInfo.container());
+        CPPUNIT_ASSERT(container);
+        auto *const segmentElement = container->firstElement()->siblingById(MatroskaIds::Segment, m_diag);
+        CPPUNIT_ASSERT(segmentElement);
+        const auto *const clusterElement = segmentElement->childById(MatroskaIds::Cluster, m_diag);
+        CPPUNIT_ASSERT(clusterElement);
+        return clusterElement->startOffset();
+    };
+    m_diag.clear();
+    m_fileInfo.setPath(path);
+    m_fileInfo.setTagPosition(ElementPosition::AfterData);
+    m_fileInfo.setIndexPosition(ElementPosition::Keep);
+    m_fileInfo.setMinPadding(0);
+    m_fileInfo.setMaxPadding(0);
+    m_fileInfo.setPreferredPadding(0);
+
+    // rewrite the file without tags so the "SeekHead"-element has no entry for a "Tags"-element
+    m_fileInfo.setForceRewrite(true);
+    m_fileInfo.reopen(true);
+    m_fileInfo.parseEverything(m_diag);
+    auto *container = static_cast<MatroskaContainer *>(m_fileInfo.container());
+    CPPUNIT_ASSERT(container);
+    container->setSeekHeadReservationEnabled(true);
+    m_fileInfo.removeAllTags();
+    m_fileInfo.applyChanges(m_diag, m_progress);
+    m_fileInfo.clearParsingResults();
+    m_fileInfo.parseEverything(m_diag);
+    CPPUNIT_ASSERT_EQUAL(0_st, m_fileInfo.tags().size());
+    const auto clusterOffset = firstClusterOffset();
+
+    // add a tag which must not move the clusters although there is no padding
+    m_fileInfo.setForceRewrite(false);
+    container = static_cast<MatroskaContainer *>(m_fileInfo.container());
+    container->setSeekHeadReservationEnabled(true);
+    CPPUNIT_ASSERT(m_fileInfo.createAppropriateTags());
+    m_fileInfo.tags().front()->setValue(KnownField::Title, TagValue("reserved"s));
+    m_fileInfo.applyChanges(m_diag, m_progress);
+    m_fileInfo.clearParsingResults();
+    m_fileInfo.parseEverything(m_diag);
+    CPPUNIT_ASSERT_EQUAL(1_st, m_fileInfo.tags().size());
+    CPPUNIT_ASSERT_EQUAL("reserved"s, m_fileInfo.tags().front()->value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL(clusterOffset, firstClusterOffset());
+    CPPUNIT_ASSERT(m_diag.level() <= DiagLevel::Information);
+
+    m_fileInfo.close();
+    remove(path.c_str());
+    remove((path + ".bak").c_str());
+}
+
+/*!
+ * \brief Tests verifying and regenerating the checksums of "CRC-32"-elements.
+ */
+void OverallTests::testMkvCrc32()
+{
+    cerr << endl << "Matroska maker - verify and regenerate CRC-32 checksums" << endl;
+
+    // check the checksum computation itself against the check value of the CRC-32 of ISO 3309
+    CPPUNIT_ASSERT_EQUAL(0xCBF43926u, EbmlElement::updateCrc32(0, "123456789", 9));
+    CPPUNIT_ASSERT_EQUAL(0xCBF43926u, EbmlElement::updateCrc32(EbmlElement::updateCrc32(0, "1234", 4), "56789", 5));
+
+    // verify the checksums of a file which contains "CRC-32"-elements
+    const auto path = workingCopyPath("matroska_wave1/test2.mkv");
+    const auto parsingFlags = m_fileInfo.parsingFlags();
+    m_diag.clear();
+    m_fileInfo.setPath(path);
+    m_fileInfo.setParsingFlags(parsingFlags | ParsingFlags::VerifyCrc32Checksums);
+    m_fileInfo.setForceRewrite(true);
+    m_fileInfo.reopen(true);
+    m_fileInfo.parseEverything(m_diag);
+    CPPUNIT_ASSERT(m_diag.level() <= DiagLevel::Information);
+    auto *container = static_cast<MatroskaContainer *>(m_fileInfo.container());
+    CPPUNIT_ASSERT(container);
+    auto *segmentElement = container->firstElement()->siblingById(MatroskaIds::Segment, m_diag);
+    CPPUNIT_ASSERT(segmentElement);
+    CPPUNIT_ASSERT(segmentElement->firstChild());
+    CPPUNIT_ASSERT_EQUAL(static_cast<EbmlElement::IdentifierType>(EbmlIds::Crc32), segmentElement->firstChild()->id());
+
+    // modify the tag which requires rewriting the file and check whether the checksums are still valid
+    CPPUNIT_ASSERT_EQUAL(1_st, m_fileInfo.tags().size());
+    m_fileInfo.tags().front()->setValue(KnownField::Title, TagValue("test title"s));
+    m_fileInfo.applyChanges(m_diag, m_progress);
+    CPPUNIT_ASSERT(m_diag.level() <= DiagLevel::Information);
+    m_fileInfo.clearParsingResults();
+    m_fileInfo.parseEverything(m_diag);
+    CPPUNIT_ASSERT(m_diag.level() <= DiagLevel::Information);
+    container = static_cast<MatroskaContainer *>(m_fileInfo.container());
+    CPPUNIT_ASSERT(container);
+    segmentElement = container->firstElement()->siblingById(MatroskaIds::Segment, m_diag);
+    CPPUNIT_ASSERT(segmentElement);
+    CPPUNIT_ASSERT(segmentElement->verifyCrc32(m_diag));
+    CPPUNIT_ASSERT_EQUAL("test title"s, m_fileInfo.tags().front()->value(KnownField::Title).toString());
+
+    m_fileInfo.setParsingFlags(parsingFlags);
+    m_fileInfo.close();
+    remove(path.c_str());
+    remove((path + ".bak").c_str());
+}
+
+/*!
+ * \brief Tests overwriting only the changed "Tag"-elements (see MatroskaContainer::setTagPatchingEnabled()).
+ */
+void OverallTests::testMkvTagPatching()
+{
+    cerr << endl << "Matroska maker - patch only changed tags" << endl;
+    const auto path = workingCopyPath("matroska_wave1/test1.mkv");
+    const auto firstTitle = "tag patching test - title of the first tag "s, lastTitle = "tag patching test - title of the last tag"s;
+    const auto comment = "tag patching test - a comment which makes the tags exceed 127 bytes so the size of the \"Tags\"-element "
+                         "is denoted using two bytes"s;
+    const auto tagsLayout = [this] {
+        auto *const container = static_cast<MatroskaContainer *>(m_fileInfo.container());
+        CPPUNIT_ASSERT(container);
+        auto *const segmentElement = container->firstElement()->siblingById(MatroskaIds::Segment, m_diag);
+        CPPUNIT_ASSERT(segmentElement);
+        auto *const tagsElement = segmentElement->childById(MatroskaIds::Tags, m_diag);
+        CPPUNIT_ASSERT(tagsElement);
+        auto *const voidElement = tagsElement->nextSibling();
+        CPPUNIT_ASSERT(voidElement);
+        voidElement->parse(m_diag);
+        CPPUNIT_ASSERT_EQUAL(static_cast<EbmlElement::IdentifierType>(EbmlIds::Void), voidElement->id());
+        return make_pair(tagsElement, voidElement);
+    };
+    const auto tagElements = [this, &tagsLayout] {
+        auto tags = vector<EbmlElement *>();
+        for (auto *child = tagsLayout().first->firstChild(); child; child = child->nextSibling()) {
+            child->parse(m_diag);
+            tags.emplace_back(child);
+        }
+        return tags;
+    };
+    const auto reparse = [this] {
+        m_fileInfo.clearParsingResults();
+        m_fileInfo.reopen(true);
+        m_fileInfo.parseEverything(m_diag);
+        CPPUNIT_ASSERT_EQUAL(2_st, m_fileInfo.tags().size());
+        static_cast<MatroskaContainer *>(m_fileInfo.container())->setTagPatchingEnabled(true);
+    };
+    const auto &result = m_fileInfo.applyChangesResult();
+    m_diag.clear();
+    m_fileInfo.setPath(path);
+    m_fileInfo.setTagPosition(ElementPosition::BeforeData);
+    m_fileInfo.setIndexPosition(ElementPosition::AfterData);
+    m_fileInfo.setMinPadding(0);
+    m_fileInfo.setMaxPadding(numeric_limits<size_t>::max());
+    m_fileInfo.setPreferredPadding(512);
+
+    // rewrite the file with two tags followed by a "Void"-element
+    m_fileInfo.setForceRewrite(true);
+    m_fileInfo.reopen(true);
+    m_fileInfo.parseEverything(m_diag);
+    auto *container = static_cast<MatroskaContainer *>(m_fileInfo.container());
+    CPPUNIT_ASSERT(container);
+    m_fileInfo.removeAllTags();
+    auto *tag = container->createTag(TagTarget(50));
+    tag->setValue(KnownField::Title, TagValue(firstTitle + "ABCD"));
+    tag->setValue(KnownField::Comment, TagValue(comment));
+    container->createTag(TagTarget(30))->setValue(KnownField::Title, TagValue(lastTitle));
+    m_fileInfo.applyChanges(m_diag, m_progress);
+    CPPUNIT_ASSERT(result.strategy == ApplyChangesStrategy::Rewrite);
+    m_fileInfo.setForceRewrite(false);
+    reparse();
+    auto [tagsElement, voidElement] = tagsLayout();
+    const auto tagsOffset = tagsElement->startOffset(), tagsSize = tagsElement->totalSize(), voidSize = voidElement->totalSize();
+    const auto fileSize = m_fileInfo.size();
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(2), tagsElement->sizeLength());
+    CPPUNIT_ASSERT_EQUAL(2_st, tagElements().size());
+
+    // change a field keeping the size of the tag so only the tag is overwritten
+    m_fileInfo.tags().front()->setValue(KnownField::Title, TagValue(firstTitle + "WXYZ"));
+    const auto firstTagSize = tagElements().front()->totalSize();
+    m_fileInfo.applyChanges(m_diag, m_progress);
+    CPPUNIT_ASSERT(result.strategy == ApplyChangesStrategy::InPlace);
+    CPPUNIT_ASSERT_EQUAL(fileSize, result.fileSizeAfter);
+#ifndef TAG_PARSER_NO_STATISTICS
+    CPPUNIT_ASSERT(result.bytesPatched <= firstTagSize);
+#endif
+    reparse();
+    CPPUNIT_ASSERT_EQUAL(firstTitle + "WXYZ", m_fileInfo.tags().front()->value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL(comment, m_fileInfo.tags().front()->value(KnownField::Comment).toString());
+    CPPUNIT_ASSERT_EQUAL(lastTitle, m_fileInfo.tags().back()->value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL(tagsSize, tagsLayout().first->totalSize());
+    CPPUNIT_ASSERT_EQUAL(firstTagSize, tagElements().front()->totalSize());
+
+    // shrink the first tag so the remaining space becomes a "Void"-element within the "Tags"-element
+    m_fileInfo.tags().front()->setValue(KnownField::Title, TagValue(firstTitle + "WX"));
+    m_fileInfo.applyChanges(m_diag, m_progress);
+    CPPUNIT_ASSERT(result.strategy == ApplyChangesStrategy::InPlace);
+    reparse();
+    CPPUNIT_ASSERT_EQUAL(firstTitle + "WX", m_fileInfo.tags().front()->value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL(lastTitle, m_fileInfo.tags().back()->value(KnownField::Title).toString());
+    auto tags = tagElements();
+    CPPUNIT_ASSERT_EQUAL(3_st, tags.size());
+    CPPUNIT_ASSERT_EQUAL(firstTagSize - 2, tags[0]->totalSize());
+    CPPUNIT_ASSERT_EQUAL(static_cast<EbmlElement::IdentifierType>(EbmlIds::Void), tags[1]->id());
+    CPPUNIT_ASSERT_EQUAL(2_st, static_cast<std::size_t>(tags[1]->totalSize()));
+    CPPUNIT_ASSERT_EQUAL(tagsSize, tagsLayout().first->totalSize());
+
+    // grow the first tag by one byte so the size of the tag is denoted using one more byte instead of leaving one byte
+    m_fileInfo.tags().front()->setValue(KnownField::Title, TagValue(firstTitle + "WXY"));
+    m_fileInfo.applyChanges(m_diag, m_progress);
+    CPPUNIT_ASSERT(result.strategy == ApplyChangesStrategy::InPlace);
+    reparse();
+    CPPUNIT_ASSERT_EQUAL(firstTitle + "WXY", m_fileInfo.tags().front()->value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL(lastTitle, m_fileInfo.tags().back()->value(KnownField::Title).toString());
+    tags = tagElements();
+    CPPUNIT_ASSERT_EQUAL(2_st, tags.size());
+    CPPUNIT_ASSERT_EQUAL(firstTagSize, tags[0]->totalSize());
+    CPPUNIT_ASSERT(tags[0]->sizeLength() > EbmlElement::calculateSizeDenotationLength(tags[0]->dataSize()));
+    CPPUNIT_ASSERT_EQUAL(static_cast<EbmlElement::IdentifierType>(MatroskaIds::Tag), tags[1]->id());
+    CPPUNIT_ASSERT_EQUAL(tagsSize, tagsLayout().first->totalSize());
+
+    // grow the last tag so it uses the "Void"-element following the "Tags"-element whose size is patched
+    m_fileInfo.tags().back()->setValue(KnownField::Title, TagValue(lastTitle + " (10 more)"));
+    m_fileInfo.applyChanges(m_diag, m_progress);
+    CPPUNIT_ASSERT(result.strategy == ApplyChangesStrategy::PaddingReuse);
+    CPPUNIT_ASSERT_EQUAL(voidSize, result.paddingBefore);
+    CPPUNIT_ASSERT_EQUAL(voidSize - 10, result.paddingAfter);
+    CPPUNIT_ASSERT_EQUAL(fileSize, result.fileSizeAfter);
+    reparse();
+    CPPUNIT_ASSERT_EQUAL(firstTitle + "WXY", m_fileInfo.tags().front()->value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL(lastTitle + " (10 more)", m_fileInfo.tags().back()->value(KnownField::Title).toString());
+    tie(tagsElement, voidElement) = tagsLayout();
+    CPPUNIT_ASSERT_EQUAL(tagsOffset, tagsElement->startOffset());
+    CPPUNIT_ASSERT_EQUAL(tagsSize + 10, tagsElement->totalSize());
+    CPPUNIT_ASSERT_EQUAL(voidSize - 10, voidElement->totalSize());
+    CPPUNIT_ASSERT(m_diag.level() <= DiagLevel::Information);
+
+    // insert a "CRC-32"-element into the "Tags"-element taking the space from the "Void"-element following it
+    {
+        const auto idLength = tagsElement->idLength(), sizeLength = tagsElement->sizeLength();
+        const auto tagsDataOffset = tagsElement->dataOffset();
+        auto tagsData = string(static_cast<std::size_t>(tagsElement->dataSize()), '\0');
+        const auto newVoidSize = voidElement->totalSize() - EbmlElement::crc32ElementSize;
+        CPPUNIT_ASSERT(newVoidSize > 64 + 9);
+        m_fileInfo.close();
+        auto file = fstream(path, ios_base::in | ios_base::out | ios_base::binary);
+        file.exceptions(ios_base::failbit | ios_base::badbit);
+        file.seekg(static_cast<streamoff>(tagsDataOffset));
+        file.read(tagsData.data(), static_cast<streamsize>(tagsData.size()));
+        char buff[9];
+        file.seekp(static_cast<streamoff>(tagsOffset + idLength));
+        file.write(buff, EbmlElement::makeSizeDenotation(tagsData.size() + EbmlElement::crc32ElementSize, buff, sizeLength));
+        EbmlElement::makeCrc32Element(buff, EbmlElement::updateCrc32(0, tagsData.data(), tagsData.size()));
+        file.write(buff, EbmlElement::crc32ElementSize);
+        file.write(tagsData.data(), static_cast<streamsize>(tagsData.size()));
+        file.put(static_cast<char>(EbmlIds::Void));
+        BE::getBytes(static_cast<std::uint64_t>((newVoidSize - 9) | 0x100000000000000), buff);
+        file.write(buff, 8);
+    }
+    reparse();
+    CPPUNIT_ASSERT(tagsLayout().first->verifyCrc32(m_diag));
+
+    // change a field and check whether the checksum has been updated
+    m_fileInfo.tags().front()->setValue(KnownField::Title, TagValue(firstTitle + "XYZ"));
+    m_fileInfo.applyChanges(m_diag, m_progress);
+    CPPUNIT_ASSERT(result.strategy == ApplyChangesStrategy::InPlace);
+    reparse();
+    CPPUNIT_ASSERT_EQUAL(firstTitle + "XYZ", m_fileInfo.tags().front()->value(KnownField::Title).toString());
+    tie(tagsElement, voidElement) = tagsLayout();
+    CPPUNIT_ASSERT_EQUAL(static_cast<EbmlElement::IdentifierType>(EbmlIds::Crc32), tagsElement->firstChild()->id());
+    CPPUNIT_ASSERT(tagsElement->verifyCrc32(m_diag));
+    CPPUNIT_ASSERT(m_diag.level() <= DiagLevel::Information);
+
+    // change the track as well which must not be dropped by only patching the tags
+    m_fileInfo.tags().front()->setValue(KnownField::Title, TagValue(firstTitle + "ZYX"));
+    m_fileInfo.tracks().front()->setName("tag patching test track");
+    m_fileInfo.applyChanges(m_diag, m_progress);
+    reparse();
+    CPPUNIT_ASSERT_EQUAL(firstTitle + "ZYX", m_fileInfo.tags().front()->value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL("tag patching test track"s, m_fileInfo.tracks().front()->name());
+
+    // grow the last tag beyond the "Void"-element so the file is made as usual
+    m_fileInfo.tags().back()->setValue(KnownField::Title, TagValue(lastTitle + string(1024, '+')));
+    m_fileInfo.applyChanges(m_diag, m_progress);
+    CPPUNIT_ASSERT(result.strategy == ApplyChangesStrategy::Rewrite);
+    reparse();
+    CPPUNIT_ASSERT_EQUAL(firstTitle + "ZYX", m_fileInfo.tags().front()->value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL(lastTitle + string(1024, '+'), m_fileInfo.tags().back()->value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL("tag patching test track"s, m_fileInfo.tracks().front()->name());
+    CPPUNIT_ASSERT(tagsLayout().first->verifyCrc32(m_diag));
+    CPPUNIT_ASSERT(m_diag.level() <= DiagLevel::Information);
+
+    m_fileInfo.close();
+    remove(path.c_str());
+    remove((path + ".bak").c_str());
+}
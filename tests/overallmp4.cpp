@@ -5,6 +5,12 @@
 #include "../mp4/mp4container.h"
 #include "../mp4/mp4ids.h"
 #include "../mp4/mp4tag.h"
+#include "../mp4/mp4track.h"
+
+#include <c++utilities/io/misc.h>
+
+#include <map>
+#include <tuple>
 
 using namespace CppUtilities;
 
@@ -602,3 +608,347 @@ void OverallTests::testMp4Making()
         makeFile(workingCopyPath("mtx-test-data/mp4/1080p-DTS-HD-7.1.mp4"), modifyRoutine, &OverallTests::checkMp4Testfile6);
     }
 }
+
+/*!
+ * \brief Tests overwriting only the changed fields of the tag (see Mp4Container::setTagFieldPatchingEnabled()).
+ */
+void OverallTests::testMp4TagFieldPatching()
+{
+    cerr << endl << "MP4 maker - patch only changed tag fields" << endl;
+    const auto path = workingCopyPath("mtx-test-data/mp4/10-DanseMacabreOp.40.m4a");
+    const auto title = "tag field patching test - title"s, comment = "tag field patching test - comment"s;
+    // -> returns the "moov"-, "udta"-, "meta"- and "ilst"-atom as well as the "free"-atom following the "moov"-atom
+    const auto atoms = [this] {
+        auto *const container = static_cast<Mp4Container *>(m_fileInfo.container());
+        CPPUNIT_ASSERT(container);
+        auto *const movieAtom = container->firstElement()->siblingByIdIncludingThis(Mp4AtomIds::Movie, m_diag);
+        CPPUNIT_ASSERT(movieAtom);
+        auto *const userDataAtom = movieAtom->childById(Mp4AtomIds::UserData, m_diag);
+        CPPUNIT_ASSERT(userDataAtom);
+        auto *const metaAtom = userDataAtom->childById(Mp4AtomIds::Meta, m_diag);
+        CPPUNIT_ASSERT(metaAtom);
+        auto *const listAtom = metaAtom->childById(Mp4AtomIds::ItunesList, m_diag);
+        CPPUNIT_ASSERT(listAtom);
+        auto *const freeAtom = movieAtom->nextSibling();
+        CPPUNIT_ASSERT(freeAtom);
+        freeAtom->parse(m_diag);
+        CPPUNIT_ASSERT_EQUAL(static_cast<Mp4Atom::IdentifierType>(Mp4AtomIds::Free), freeAtom->id());
+        return vector<Mp4Atom *>{ movieAtom, userDataAtom, metaAtom, listAtom, freeAtom };
+    };
+    const auto sizes = [&atoms] {
+        auto sizes = vector<std::uint64_t>();
+        for (const auto *const atom : atoms()) {
+            sizes.emplace_back(atom->totalSize());
+        }
+        return sizes;
+    };
+    const auto reparse = [this] {
+        m_fileInfo.clearParsingResults();
+        m_fileInfo.reopen(true);
+        m_fileInfo.parseEverything(m_diag);
+        CPPUNIT_ASSERT_EQUAL(1_st, m_fileInfo.tags().size());
+        static_cast<Mp4Container *>(m_fileInfo.container())->setTagFieldPatchingEnabled(true);
+    };
+    const auto &result = m_fileInfo.applyChangesResult();
+    m_diag.clear();
+    m_fileInfo.setPath(path);
+    m_fileInfo.setTagPosition(ElementPosition::BeforeData);
+    m_fileInfo.setIndexPosition(ElementPosition::BeforeData);
+    m_fileInfo.setForceTagPosition(false);
+    m_fileInfo.setForceIndexPosition(false);
+    m_fileInfo.setMinPadding(0);
+    m_fileInfo.setMaxPadding(numeric_limits<size_t>::max());
+    m_fileInfo.setPreferredPadding(512);
+
+    // rewrite the file with a tag consisting of three fields followed by a "free"-atom
+    m_fileInfo.setForceRewrite(true);
+    m_fileInfo.reopen(true);
+    m_fileInfo.parseEverything(m_diag);
+    m_fileInfo.removeAllTags();
+    CPPUNIT_ASSERT(m_fileInfo.createAppropriateTags());
+    m_fileInfo.tags().front()->setValue(KnownField::Album, TagValue("ABCD"s));
+    m_fileInfo.tags().front()->setValue(KnownField::Comment, TagValue(comment));
+    m_fileInfo.tags().front()->setValue(KnownField::Title, TagValue(title));
+    m_fileInfo.applyChanges(m_diag, m_progress);
+    CPPUNIT_ASSERT(result.strategy == ApplyChangesStrategy::Rewrite);
+    m_fileInfo.setForceRewrite(false);
+    reparse();
+    const auto originalSizes = sizes();
+    const auto fileSize = m_fileInfo.size();
+    auto *listAtom = atoms()[3];
+    CPPUNIT_ASSERT(listAtom->lastChild());
+    CPPUNIT_ASSERT_EQUAL(static_cast<Mp4Atom::IdentifierType>(Mp4TagAtomIds::Title), listAtom->lastChild()->id());
+
+    // change a field keeping its size so only the field is overwritten
+    m_fileInfo.tags().front()->setValue(KnownField::Album, TagValue("WXYZ"s));
+    m_fileInfo.applyChanges(m_diag, m_progress);
+    CPPUNIT_ASSERT(result.strategy == ApplyChangesStrategy::InPlace);
+    CPPUNIT_ASSERT_EQUAL(fileSize, result.fileSizeAfter);
+#ifndef TAG_PARSER_NO_STATISTICS
+    CPPUNIT_ASSERT(result.bytesPatched <= originalSizes[3]);
+#endif
+    reparse();
+    CPPUNIT_ASSERT_EQUAL("WXYZ"s, m_fileInfo.tags().front()->value(KnownField::Album).toString());
+    CPPUNIT_ASSERT_EQUAL(comment, m_fileInfo.tags().front()->value(KnownField::Comment).toString());
+    CPPUNIT_ASSERT_EQUAL(title, m_fileInfo.tags().front()->value(KnownField::Title).toString());
+    CPPUNIT_ASSERT(originalSizes == sizes());
+
+    // shrink the last field so the "free"-atom following the "moov"-atom grows
+    m_fileInfo.tags().front()->setValue(KnownField::Title, TagValue(title.substr(0, title.size() - 5)));
+    m_fileInfo.applyChanges(m_diag, m_progress);
+    CPPUNIT_ASSERT(result.strategy == ApplyChangesStrategy::PaddingReuse);
+    CPPUNIT_ASSERT_EQUAL(originalSizes[4], result.paddingBefore);
+    CPPUNIT_ASSERT_EQUAL(originalSizes[4] + 5, result.paddingAfter);
+    CPPUNIT_ASSERT_EQUAL(fileSize, result.fileSizeAfter);
+    reparse();
+    CPPUNIT_ASSERT_EQUAL(title.substr(0, title.size() - 5), m_fileInfo.tags().front()->value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL("WXYZ"s, m_fileInfo.tags().front()->value(KnownField::Album).toString());
+    auto newSizes = sizes();
+    for (std::size_t i = 0; i != 4; ++i) {
+        CPPUNIT_ASSERT_EQUAL(originalSizes[i] - 5, newSizes[i]);
+    }
+    CPPUNIT_ASSERT_EQUAL(originalSizes[4] + 5, newSizes[4]);
+
+    // grow the last field so it uses the "free"-atom; the sizes of the "ilst"-, "meta"-, "udta"- and "moov"-atom are patched
+    m_fileInfo.tags().front()->setValue(KnownField::Title, TagValue(title + " (sixteen bytes)"));
+    m_fileInfo.applyChanges(m_diag, m_progress);
+    CPPUNIT_ASSERT(result.strategy == ApplyChangesStrategy::PaddingReuse);
+    CPPUNIT_ASSERT_EQUAL(originalSizes[4] + 5, result.paddingBefore);
+    CPPUNIT_ASSERT_EQUAL(originalSizes[4] - 16, result.paddingAfter);
+    CPPUNIT_ASSERT_EQUAL(fileSize, result.fileSizeAfter);
+    reparse();
+    CPPUNIT_ASSERT_EQUAL(title + " (sixteen bytes)", m_fileInfo.tags().front()->value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL(comment, m_fileInfo.tags().front()->value(KnownField::Comment).toString());
+    newSizes = sizes();
+    for (std::size_t i = 0; i != 4; ++i) {
+        CPPUNIT_ASSERT_EQUAL(originalSizes[i] + 16, newSizes[i]);
+    }
+    CPPUNIT_ASSERT_EQUAL(originalSizes[4] - 16, newSizes[4]);
+    CPPUNIT_ASSERT(m_diag.level() <= DiagLevel::Information);
+
+    // change the track as well which must not be dropped by only patching the tag fields
+    m_fileInfo.tags().front()->setValue(KnownField::Album, TagValue("ZYXW"s));
+    m_fileInfo.tracks().front()->setName("tag field patching test track");
+    m_fileInfo.applyChanges(m_diag, m_progress);
+    reparse();
+    CPPUNIT_ASSERT_EQUAL("ZYXW"s, m_fileInfo.tags().front()->value(KnownField::Album).toString());
+    CPPUNIT_ASSERT_EQUAL("tag field patching test track"s, m_fileInfo.tracks().front()->name());
+
+    // grow the last field beyond the "free"-atom so the file is made as usual
+    m_fileInfo.tags().front()->setValue(KnownField::Title, TagValue(title + string(1024, '+')));
+    m_fileInfo.applyChanges(m_diag, m_progress);
+    CPPUNIT_ASSERT(result.strategy == ApplyChangesStrategy::Rewrite);
+    reparse();
+    CPPUNIT_ASSERT_EQUAL(title + string(1024, '+'), m_fileInfo.tags().front()->value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL("ZYXW"s, m_fileInfo.tags().front()->value(KnownField::Album).toString());
+    CPPUNIT_ASSERT_EQUAL("tag field patching test track"s, m_fileInfo.tracks().front()->name());
+    CPPUNIT_ASSERT(m_diag.level() <= DiagLevel::Information);
+
+    m_fileInfo.close();
+    remove(path.c_str());
+    remove((path + ".bak").c_str());
+}
+
+/*!
+ * \brief Tests writing only the user data atom (see Mp4Container::setUserDataPatchingEnabled()).
+ */
+void OverallTests::testMp4UserDataPatching()
+{
+    cerr << endl << "MP4 maker - patch only the user data atom" << endl;
+    const auto path = workingCopyPath("mtx-test-data/mp4/10-DanseMacabreOp.40.m4a");
+    const auto reparse = [this] {
+        m_fileInfo.clearParsingResults();
+        m_fileInfo.reopen(true);
+        m_fileInfo.parseEverything(m_diag);
+        CPPUNIT_ASSERT_EQUAL(1_st, m_fileInfo.tags().size());
+        static_cast<Mp4Container *>(m_fileInfo.container())->setUserDataPatchingEnabled(true);
+    };
+    const auto &result = m_fileInfo.applyChangesResult();
+    m_diag.clear();
+    m_fileInfo.setPath(path);
+    m_fileInfo.setTagPosition(ElementPosition::BeforeData);
+    m_fileInfo.setIndexPosition(ElementPosition::BeforeData);
+    m_fileInfo.setForceTagPosition(false);
+    m_fileInfo.setForceIndexPosition(false);
+    m_fileInfo.setMinPadding(0);
+    m_fileInfo.setMaxPadding(numeric_limits<size_t>::max());
+    m_fileInfo.setPreferredPadding(512);
+
+    // rewrite the file so the user data atom is the last child of the movie atom which is followed by a "free"-atom
+    m_fileInfo.setForceRewrite(true);
+    m_fileInfo.reopen(true);
+    m_fileInfo.parseEverything(m_diag);
+    m_fileInfo.removeAllTags();
+    CPPUNIT_ASSERT(m_fileInfo.createAppropriateTags());
+    m_fileInfo.tags().front()->setValue(KnownField::Title, TagValue("user data patching test - title"s));
+    m_fileInfo.applyChanges(m_diag, m_progress);
+    CPPUNIT_ASSERT(result.strategy == ApplyChangesStrategy::Rewrite);
+    m_fileInfo.setForceRewrite(false);
+    reparse();
+    const auto fileSize = m_fileInfo.size();
+    const auto trackName = m_fileInfo.tracks().front()->name();
+
+    // change only the tag so only the user data atom is written
+    m_fileInfo.tags().front()->setValue(KnownField::Album, TagValue("user data patching test - album"s));
+    m_fileInfo.applyChanges(m_diag, m_progress);
+    CPPUNIT_ASSERT(result.strategy != ApplyChangesStrategy::Rewrite);
+    CPPUNIT_ASSERT_EQUAL(fileSize, result.fileSizeAfter);
+    reparse();
+    CPPUNIT_ASSERT_EQUAL("user data patching test - album"s, m_fileInfo.tags().front()->value(KnownField::Album).toString());
+    CPPUNIT_ASSERT_EQUAL(trackName, m_fileInfo.tracks().front()->name());
+
+    // change the track as well which must not be dropped by only patching the user data atom
+    m_fileInfo.tags().front()->setValue(KnownField::Album, TagValue("user data patching test - changed album"s));
+    m_fileInfo.tracks().front()->setName("user data patching test track");
+    m_fileInfo.applyChanges(m_diag, m_progress);
+    reparse();
+    CPPUNIT_ASSERT_EQUAL("user data patching test - changed album"s, m_fileInfo.tags().front()->value(KnownField::Album).toString());
+    CPPUNIT_ASSERT_EQUAL("user data patching test - title"s, m_fileInfo.tags().front()->value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL("user data patching test track"s, m_fileInfo.tracks().front()->name());
+    CPPUNIT_ASSERT(m_diag.level() <= DiagLevel::Information);
+
+    m_fileInfo.close();
+    remove(path.c_str());
+    remove((path + ".bak").c_str());
+}
+
+/*!
+ * \brief Tests copying chunks using multiple threads when writing chunk-by-chunk (see Mp4Container::setChunkCopyThreadCount()).
+ * \remarks The resulting file must be identical to the one written by the current thread alone.
+ */
+void OverallTests::testMp4ChunkCopyThreads()
+{
+    cerr << endl << "MP4 maker - copy chunks using multiple threads" << endl;
+    // -> writes the file chunk-by-chunk by removing and adding the last track again and returns the contents of the new file
+    const auto writeChunkByChunk = [this](std::size_t threadCount) {
+        const auto path = workingCopyPath("mp4/android-8.1-camera-recoding.mp4");
+        m_diag.clear();
+        m_fileInfo.setPath(path);
+        m_fileInfo.setForceRewrite(false);
+        m_fileInfo.reopen(true);
+        m_fileInfo.parseEverything(m_diag);
+        auto *const container = static_cast<Mp4Container *>(m_fileInfo.container());
+        CPPUNIT_ASSERT(container);
+        CPPUNIT_ASSERT_EQUAL(3_st, container->trackCount());
+        auto sampleCounts = vector<std::uint64_t>();
+        for (const auto *const track : m_fileInfo.tracks()) {
+            sampleCounts.emplace_back(track->sampleCount());
+        }
+        container->setChunkCopyThreadCount(threadCount);
+        auto *const track = container->track(2);
+        CPPUNIT_ASSERT(container->removeTrack(track));
+        CPPUNIT_ASSERT(container->addTrack(track));
+        m_fileInfo.applyChanges(m_diag, m_progress);
+        CPPUNIT_ASSERT(m_fileInfo.applyChangesResult().strategy == ApplyChangesStrategy::Rewrite);
+
+        // reparse the new file
+        auto diag = Diagnostics();
+        m_fileInfo.clearParsingResults();
+        m_fileInfo.reopen(true);
+        m_fileInfo.parseEverything(diag);
+        CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+        const auto tracks = m_fileInfo.tracks();
+        CPPUNIT_ASSERT_EQUAL(sampleCounts.size(), tracks.size());
+        for (std::size_t i = 0; i != tracks.size(); ++i) {
+            CPPUNIT_ASSERT_EQUAL(sampleCounts[i], tracks[i]->sampleCount());
+        }
+        m_fileInfo.close();
+        const auto data = readFile(path, 0x10000000);
+        remove(path.c_str());
+        remove((path + ".bak").c_str());
+        return data;
+    };
+    const auto sequentialData = writeChunkByChunk(1);
+    CPPUNIT_ASSERT(sequentialData == writeChunkByChunk(4));
+    CPPUNIT_ASSERT(sequentialData == writeChunkByChunk(0));
+}
+
+/*!
+ * \brief Tests interleaving chunks by their decoding time when writing chunk-by-chunk (see Mp4Container::setInterleaveDuration()).
+ * \remarks The chunks must be ordered by interleave period and track and contain the same samples as without interleaving.
+ */
+void OverallTests::testMp4Interleaving()
+{
+    cerr << endl << "MP4 maker - interleave chunks by decoding time" << endl;
+    // -> writes the file chunk-by-chunk by removing and adding the last track again and returns the contents of the new file
+    //    as well as the data of each track
+    const auto writeChunkByChunk = [this](TimeSpan interleaveDuration, std::size_t threadCount) {
+        const auto path = workingCopyPath("mp4/android-8.1-camera-recoding.mp4");
+        m_diag.clear();
+        m_fileInfo.setPath(path);
+        m_fileInfo.setForceRewrite(false);
+        m_fileInfo.reopen(true);
+        m_fileInfo.parseEverything(m_diag);
+        auto *container = static_cast<Mp4Container *>(m_fileInfo.container());
+        CPPUNIT_ASSERT(container);
+        CPPUNIT_ASSERT_EQUAL(3_st, container->trackCount());
+        container->setInterleaveDuration(interleaveDuration);
+        container->setChunkCopyThreadCount(threadCount);
+        auto *const lastTrack = container->track(2);
+        CPPUNIT_ASSERT(container->removeTrack(lastTrack));
+        CPPUNIT_ASSERT(container->addTrack(lastTrack));
+        m_fileInfo.applyChanges(m_diag, m_progress);
+        CPPUNIT_ASSERT(m_fileInfo.applyChangesResult().strategy == ApplyChangesStrategy::Rewrite);
+
+        // reparse the new file and read the chunks of each track
+        auto diag = Diagnostics();
+        m_fileInfo.clearParsingResults();
+        m_fileInfo.reopen(true);
+        m_fileInfo.parseEverything(diag);
+        CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+        container = static_cast<Mp4Container *>(m_fileInfo.container());
+        CPPUNIT_ASSERT(container);
+        CPPUNIT_ASSERT_EQUAL(3_st, container->trackCount());
+        auto chunks = vector<tuple<vector<std::uint64_t>, vector<std::uint64_t>, vector<std::uint64_t>>>();
+        for (const auto &track : container->tracks()) {
+            chunks.emplace_back(track->readChunkOffsets(false, diag), track->readChunkSizes(diag), track->readChunkDecodingTimes(diag));
+            CPPUNIT_ASSERT(track->timeScale());
+        }
+        CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+        m_fileInfo.close();
+        const auto data = readFile(path, 0x10000000);
+        auto trackData = vector<string>(chunks.size());
+        // -> the interleave period and the track index of the chunks by their offset
+        auto chunkOrder = map<std::uint64_t, pair<std::uint64_t, std::size_t>>();
+        for (std::size_t trackIndex = 0; trackIndex != chunks.size(); ++trackIndex) {
+            const auto &[offsets, sizes, decodingTimes] = chunks[trackIndex];
+            const auto timeScale = static_cast<double>(container->tracks()[trackIndex]->timeScale());
+            CPPUNIT_ASSERT_EQUAL(offsets.size(), sizes.size());
+            CPPUNIT_ASSERT_EQUAL(offsets.size(), decodingTimes.size());
+            for (std::size_t chunkIndex = 0; chunkIndex != offsets.size(); ++chunkIndex) {
+                CPPUNIT_ASSERT(offsets[chunkIndex] + sizes[chunkIndex] <= data.size());
+                trackData[trackIndex].append(data, static_cast<std::size_t>(offsets[chunkIndex]), static_cast<std::size_t>(sizes[chunkIndex]));
+                const auto period = interleaveDuration.totalTicks() > 0
+                    ? static_cast<std::uint64_t>(static_cast<double>(decodingTimes[chunkIndex]) / timeScale / interleaveDuration.totalSeconds())
+                    : std::uint64_t();
+                chunkOrder.emplace(offsets[chunkIndex], make_pair(period, trackIndex));
+            }
+        }
+        remove(path.c_str());
+        remove((path + ".bak").c_str());
+        return make_tuple(data, trackData, chunkOrder);
+    };
+
+    // write the file without interleaving to get the reference data of the tracks
+    const auto [referenceData, referenceTrackData, referenceChunkOrder] = writeChunkByChunk(TimeSpan(), 1);
+    for (const auto &trackData : referenceTrackData) {
+        CPPUNIT_ASSERT(!trackData.empty());
+    }
+
+    // write the file interleaving chunks by half a second and by one hour (which is longer than the file so each track
+    // is written as a whole)
+    for (const auto interleaveDuration : { TimeSpan::fromMilliseconds(500), TimeSpan::fromHours(1) }) {
+        const auto [data, trackData, chunkOrder] = writeChunkByChunk(interleaveDuration, 1);
+        CPPUNIT_ASSERT_EQUAL(referenceData.size(), data.size());
+        CPPUNIT_ASSERT(referenceTrackData == trackData);
+        // -> chunks must be sorted by interleave period first and by track second
+        CPPUNIT_ASSERT(!chunkOrder.empty());
+        auto previous = chunkOrder.cbegin()->second;
+        for (const auto &[offset, position] : chunkOrder) {
+            CPPUNIT_ASSERT(previous <= position);
+            previous = position;
+        }
+        // -> reading chunks ahead using multiple threads must not change the order
+        CPPUNIT_ASSERT(data == get<0>(writeChunkByChunk(interleaveDuration, 4)));
+    }
+}
@@ -2,6 +2,7 @@
 #include "./overall.h"
 
 #include "../abstracttrack.h"
+#include "../ogg/oggcontainer.h"
 #include "../tag.h"
 #include "../vorbis/vorbiscomment.h"
 
@@ -111,6 +112,11 @@ void OverallTests::checkOggTestMetaData()
 
 void OverallTests::setOggTestMetaData()
 {
+    // rewrite pages using multiple threads if the test condition is set
+    if (m_fileInfo.containerFormat() == ContainerFormat::Ogg && (m_mode & SimpleTestFlags::UseRewriteThreads)) {
+        static_cast<OggContainer *>(m_fileInfo.container())->setRewriteThreadCount(4);
+    }
+
     // ensure a tag exists
     auto *const tag = m_fileInfo.createVorbisComment();
 
@@ -149,10 +155,15 @@ void OverallTests::testOggMaking()
     m_fileInfo.setForceFullParse(true);
 
     // do the test under different conditions
-    for (m_mode = 0; m_mode != 0x2; ++m_mode) {
+    for (m_mode = 0; m_mode != 0x4; ++m_mode) {
         using namespace SimpleTestFlags;
 
-        // no need to setup test conditions because the Ogg maker
+        // skip irrelevant conditions
+        if ((m_mode & RemoveTag) && (m_mode & UseRewriteThreads)) {
+            continue;
+        }
+
+        // no need to setup further test conditions because the Ogg maker
         // doesn't take those settings into account (currently)
 
         // print test conditions
@@ -162,6 +173,9 @@ void OverallTests::testOggMaking()
         } else {
             testConditions.emplace_back("modifying tag");
         }
+        if (m_mode & UseRewriteThreads) {
+            testConditions.emplace_back("using multiple threads");
+        }
         cerr << endl << "OGG maker - testmode " << m_mode << ": " << joinStrings(testConditions, ", ") << endl;
 
         // do actual tests
@@ -1,6 +1,7 @@
 #include "./helper.h"
 
 #include "../id3/id3genres.h"
+#include "../tagtarget.h"
 #include "../tagvalue.h"
 
 #include <c++utilities/chrono/format.h>
@@ -29,6 +30,9 @@ class TagValueTests : public TestFixture {
     CPPUNIT_TEST(testDateTime);
     CPPUNIT_TEST(testString);
     CPPUNIT_TEST(testEqualityOperator);
+    CPPUNIT_TEST(testInlineData);
+    CPPUNIT_TEST(testSharedData);
+    CPPUNIT_TEST(testStringViews);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -43,6 +47,9 @@ public:
     void testDateTime();
     void testString();
     void testEqualityOperator();
+    void testInlineData();
+    void testSharedData();
+    void testStringViews();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(TagValueTests);
@@ -173,9 +180,16 @@ void TagValueTests::testString()
     CPPUNIT_ASSERT_EQUAL_MESSAGE("conversion to pos", PositionInSet(4, 15), TagValue("4 / 15", 6, TagTextEncoding::Utf8).toPositionInSet());
     CPPUNIT_ASSERT_EQUAL_MESSAGE(
         "conversion to pos", PositionInSet(15), TagValue("\0\x31\0\x35", 4, TagTextEncoding::Utf16BigEndian).toPositionInSet());
+    CPPUNIT_ASSERT_EQUAL_MESSAGE("conversion to pos from UTF-16 LE", PositionInSet(0, 12),
+        TagValue("/\0\x31\0\x32\0", 6, TagTextEncoding::Utf16LittleEndian).toPositionInSet());
+    CPPUNIT_ASSERT_THROW_MESSAGE(
+        "failing conversion to int (overflow)", TagValue("2147483648", 10, TagTextEncoding::Utf8).toInteger(), ConversionException);
+    CPPUNIT_ASSERT_EQUAL_MESSAGE("conversion to int (minimum)", numeric_limits<std::int32_t>::min(),
+        TagValue("-2147483648", 11, TagTextEncoding::Utf8).toInteger());
     CPPUNIT_ASSERT_THROW_MESSAGE("failing conversion pos", TagValue("a4 / 15", 7, TagTextEncoding::Utf8).toPositionInSet(), ConversionException);
     CPPUNIT_ASSERT_EQUAL_MESSAGE(
         "conversion to date", DateTime::fromDate(2004, 4, 15), TagValue("2004-04-15", 10, TagTextEncoding::Utf8).toDateTime());
+    CPPUNIT_ASSERT_EQUAL_MESSAGE("conversion to date (year only)", DateTime::fromDate(2004), TagValue("2004", 4, TagTextEncoding::Utf8).toDateTime());
     CPPUNIT_ASSERT_EQUAL_MESSAGE("conversion to date from UTF-16", DateTime::fromDate(2015, 4, 15),
         TagValue("\0\x32\0\x30\0\x31\0\x35\0\x2d\0\x30\0\x34\0\x2d\0\x31\0\x35", 20, TagTextEncoding::Utf16BigEndian).toDateTime());
     CPPUNIT_ASSERT_THROW_MESSAGE("failing conversion to date", TagValue("_", 1, TagTextEncoding::Utf8).toDateTime(), ConversionException);
@@ -188,6 +202,29 @@ void TagValueTests::testString()
     CPPUNIT_ASSERT_EQUAL_MESSAGE("conversion to genre from name", 2, TagValue("Country", 7, TagTextEncoding::Latin1).toStandardGenreIndex());
     CPPUNIT_ASSERT_THROW_MESSAGE(
         "failing conversion to genre", TagValue("Kountry", 7, TagTextEncoding::Latin1).toStandardGenreIndex(), ConversionException);
+
+    // conversion of longer texts (processed blockwise) with characters outside of ASCII and the BMP
+    const auto longText = "Some longer text with umlauts (\xc3\xa4\xc3\xb6\xc3\xbc) and an emoji (\xf0\x9f\x98\x80) in the middle"s;
+    for (const auto encoding : { TagTextEncoding::Utf16LittleEndian, TagTextEncoding::Utf16BigEndian }) {
+        auto value = TagValue(longText, TagTextEncoding::Utf8, encoding);
+        CPPUNIT_ASSERT_EQUAL_MESSAGE("UTF-8 to UTF-16 and back", longText, value.toString(TagTextEncoding::Utf8));
+        value.convertDataEncoding(
+            encoding == TagTextEncoding::Utf16LittleEndian ? TagTextEncoding::Utf16BigEndian : TagTextEncoding::Utf16LittleEndian);
+        value.convertDataEncoding(TagTextEncoding::Utf8);
+        CPPUNIT_ASSERT_EQUAL_MESSAGE("UTF-16 byte order swapped and back to UTF-8", longText, value.toString());
+    }
+    auto latin1Value = TagValue("Longer Latin-1 text: \xe4\xf6\xfc\xdf\xff"s, TagTextEncoding::Latin1);
+    latin1Value.convertDataEncoding(TagTextEncoding::Utf16BigEndian);
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(
+        "Latin-1 to UTF-16", "\0\xe4\0\xf6\0\xfc\0\xdf\0\xff"s, latin1Value.toString(TagTextEncoding::Unspecified).substr(42));
+    latin1Value.convertDataEncoding(TagTextEncoding::Latin1);
+    CPPUNIT_ASSERT_EQUAL_MESSAGE("UTF-16 to Latin-1", "Longer Latin-1 text: \xe4\xf6\xfc\xdf\xff"s, latin1Value.toString());
+    CPPUNIT_ASSERT_THROW_MESSAGE(
+        "invalid UTF-8", TagValue("\xc0\x80", 2, TagTextEncoding::Utf8, TagTextEncoding::Utf16LittleEndian), ConversionException);
+    CPPUNIT_ASSERT_THROW_MESSAGE(
+        "unpaired surrogate", TagValue("\0\xd8\x31\0", 4, TagTextEncoding::Utf16LittleEndian).toString(TagTextEncoding::Utf8), ConversionException);
+    CPPUNIT_ASSERT_THROW_MESSAGE("character not representable in Latin-1",
+        TagValue("\xf0\x9f\x98\x80", 4, TagTextEncoding::Utf8).toString(TagTextEncoding::Latin1), ConversionException);
 }
 
 void TagValueTests::testEqualityOperator()
@@ -211,6 +248,13 @@ void TagValueTests::testEqualityOperator()
     const TagValue fooTagValue("foo", 3, TagDataType::Text), fOoTagValue("fOo", 3, TagDataType::Text);
     CPPUNIT_ASSERT_MESSAGE("string comparison case-sensitive by default"s, fooTagValue != fOoTagValue);
     CPPUNIT_ASSERT_MESSAGE("case-insensitive string comparision"s, fooTagValue.compareTo(fOoTagValue, TagValueComparisionFlags::CaseInsensitive));
+    const TagValue longTagValue("Some Longer Title \xc4 (Remastered)"s, TagTextEncoding::Latin1);
+    const TagValue longTagValueOtherCase("sOME lONGER tITLE \xc4 (rEMASTERED)"s, TagTextEncoding::Latin1);
+    const TagValue longTagValueOtherUmlaut("Some Longer Title \xe4 (Remastered)"s, TagTextEncoding::Latin1);
+    CPPUNIT_ASSERT_MESSAGE(
+        "case-insensitive comparision of longer strings"s, longTagValue.compareTo(longTagValueOtherCase, TagValueComparisionFlags::CaseInsensitive));
+    CPPUNIT_ASSERT_MESSAGE(
+        "only ASCII letters are folded"s, !longTagValue.compareTo(longTagValueOtherUmlaut, TagValueComparisionFlags::CaseInsensitive));
 
     // meta-data
     TagValue withDescription(15);
@@ -226,4 +270,134 @@ void TagValueTests::testEqualityOperator()
     withDescription2.setDescription("Test");
     CPPUNIT_ASSERT_MESSAGE("meta-data case must match by default"s, withDescription != withDescription2);
     CPPUNIT_ASSERT_MESSAGE("meta-data case ignored"s, withDescription.compareTo(withDescription2, TagValueComparisionFlags::CaseInsensitive));
+
+    // identity as used to detect modifications
+    CPPUNIT_ASSERT_MESSAGE("copies are identical"s, withDescription2.isIdentical(TagValue(withDescription2)));
+    CPPUNIT_ASSERT_MESSAGE("equal values of different types are not identical"s,
+        !TagValue("15", 2, TagTextEncoding::Latin1).isIdentical(TagValue(15)));
+    CPPUNIT_ASSERT_MESSAGE("equal strings of different encodings are not identical"s,
+        !TagValue("\0\x31\0\x35", 4, TagTextEncoding::Utf16BigEndian).isIdentical(TagValue("15", 2, TagTextEncoding::Latin1)));
+    CPPUNIT_ASSERT_MESSAGE("empty values are identical"s, TagValue().isIdentical(TagValue::empty()));
+}
+
+void TagValueTests::testInlineData()
+{
+    // short values are stored inline, long values on the heap; both must behave the same
+    const auto shortText = "2020"s, longText = string(TagValue::inlineDataCapacity + 1, 'x');
+    for (const auto &text : { shortText, longText }) {
+        TagValue value(text, TagTextEncoding::Utf8);
+        CPPUNIT_ASSERT(!value.isNull());
+        CPPUNIT_ASSERT_EQUAL(text, value.toString());
+
+        // copying preserves the data and the copy is independent of the original
+        TagValue copy(value);
+        CPPUNIT_ASSERT_EQUAL(text, copy.toString());
+        CPPUNIT_ASSERT(copy.dataPointer() != value.dataPointer());
+        copy.dataPointer()[0] = 'y';
+        CPPUNIT_ASSERT_EQUAL(text, value.toString());
+        copy = value;
+        CPPUNIT_ASSERT_EQUAL(value, copy);
+
+        // moving preserves the data
+        TagValue moved(std::move(copy));
+        CPPUNIT_ASSERT_EQUAL(text, moved.toString());
+        TagValue moveAssigned;
+        moveAssigned = std::move(moved);
+        CPPUNIT_ASSERT_EQUAL(text, moveAssigned.toString());
+
+        // clearing turns the value into a null value again
+        moveAssigned.clearData();
+        CPPUNIT_ASSERT(moveAssigned.isNull());
+        CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(0), moveAssigned.dataSize());
+    }
+
+    // assigning an empty value clears the data
+    TagValue value(42);
+    value.assignText(string());
+    CPPUNIT_ASSERT(value.isNull());
+    value.assignPosition(PositionInSet(3, 12));
+    CPPUNIT_ASSERT_EQUAL(PositionInSet(3, 12), value.toPositionInSet());
+}
+
+void TagValueTests::testSharedData()
+{
+    const auto text = string(TagValue::inlineDataCapacity * 2, 'x');
+    auto buffer = std::make_shared<string>("prefix" + text);
+    const auto *const data = buffer->data() + 6;
+
+    // the value refers to the buffer instead of copying the data
+    TagValue value;
+    value.assignSharedData(buffer, data, text.size(), TagDataType::Text, TagTextEncoding::Utf8);
+    CPPUNIT_ASSERT(value.isDataShared());
+    CPPUNIT_ASSERT_EQUAL(text, value.toString());
+    CPPUNIT_ASSERT_EQUAL(data, static_cast<const TagValue &>(value).dataPointer());
+    CPPUNIT_ASSERT_EQUAL(2l, buffer.use_count());
+
+    // copies share the buffer as well
+    TagValue copy(value);
+    CPPUNIT_ASSERT(copy.isDataShared());
+    CPPUNIT_ASSERT_EQUAL(3l, buffer.use_count());
+    CPPUNIT_ASSERT_EQUAL(value, copy);
+
+    // obtaining a mutable pointer detaches the value from the buffer
+    copy.dataPointer()[0] = 'y';
+    CPPUNIT_ASSERT(!copy.isDataShared());
+    CPPUNIT_ASSERT_EQUAL(2l, buffer.use_count());
+    CPPUNIT_ASSERT_EQUAL(text, value.toString());
+    CPPUNIT_ASSERT_EQUAL('y', copy.toString().front());
+
+    // the value keeps the buffer alive
+    buffer.reset();
+    CPPUNIT_ASSERT_EQUAL(text, value.toString());
+    value.clearData();
+    CPPUNIT_ASSERT(!value.isDataShared());
+    CPPUNIT_ASSERT(value.isNull());
+
+    // short data is copied into the value instead
+    auto shortBuffer = std::make_shared<string>("2020");
+    value.assignSharedData(shortBuffer, shortBuffer->data(), shortBuffer->size(), TagDataType::Text, TagTextEncoding::Utf8);
+    CPPUNIT_ASSERT(!value.isDataShared());
+    CPPUNIT_ASSERT_EQUAL(1l, shortBuffer.use_count());
+    CPPUNIT_ASSERT_EQUAL("2020"s, value.toString());
+}
+
+void TagValueTests::testStringViews()
+{
+    // text already stored in the requested encoding is not copied
+    auto buffer = string();
+    const auto text = TagValue("some longer text exceeding the inline capacity", TagTextEncoding::Utf8);
+    const auto view = text.toStringView(buffer);
+    CPPUNIT_ASSERT_EQUAL(static_cast<const char *>(text.dataPointer()), view.data());
+    CPPUNIT_ASSERT_EQUAL("some longer text exceeding the inline capacity"s, string(view));
+    CPPUNIT_ASSERT_EQUAL(view.data(), text.toStringView(buffer, TagTextEncoding::Utf8).data());
+    CPPUNIT_ASSERT(buffer.empty());
+
+    // genre names are static
+    auto genre = TagValue();
+    genre.assignStandardGenreIndex(2);
+    CPPUNIT_ASSERT_EQUAL("Country"sv, genre.toStringView(buffer));
+    CPPUNIT_ASSERT(buffer.empty());
+
+    // the buffer is only used when a conversion is needed
+    CPPUNIT_ASSERT_EQUAL("15"sv, TagValue(15).toStringView(buffer));
+    CPPUNIT_ASSERT_EQUAL("15"s, buffer);
+    const auto utf16 = TagValue("\0\x31\0\x35"s, TagTextEncoding::Utf16BigEndian);
+    CPPUNIT_ASSERT_EQUAL("15"sv, utf16.toStringView(buffer, TagTextEncoding::Utf8));
+    auto wideBuffer = u16string();
+    CPPUNIT_ASSERT(utf16.toWStringView(wideBuffer) == u16string_view(reinterpret_cast<const char16_t *>("\0\x31\0\x35"), 2));
+    CPPUNIT_ASSERT(TagValue().toStringView(buffer).empty());
+    CPPUNIT_ASSERT(TagValue().toWStringView(wideBuffer).empty());
+
+    // same for locales and tag targets
+    buffer.clear();
+    auto locale = Locale("eng"sv, LocaleFormat::ISO_639_2_B);
+    CPPUNIT_ASSERT_EQUAL(static_cast<const char *>(locale.front().data()), locale.toStringView(buffer).data());
+    CPPUNIT_ASSERT(buffer.empty());
+    locale.emplace_back("US"sv, LocaleFormat::DomainCountry);
+    CPPUNIT_ASSERT_EQUAL("eng, US"sv, locale.toStringView(buffer));
+    CPPUNIT_ASSERT_EQUAL(locale.toString(), buffer);
+    auto target = TagTarget();
+    CPPUNIT_ASSERT_EQUAL("track, song, chapter"sv, target.levelName(TagTargetLevel::Track));
+    target.setLevelName("custom");
+    CPPUNIT_ASSERT_EQUAL("custom"sv, target.levelName(TagTargetLevel::Track));
 }
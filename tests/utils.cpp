@@ -1,28 +1,60 @@
 #include "./helper.h"
 
+#include "../aac/aacframe.h"
+#include "../aac/aacframeanalyzer.h"
+#include "../adts/adtsframe.h"
+#include "../adts/adtsstream.h"
 #include "../aspectratio.h"
 #include "../backuphelper.h"
+#include "../base64.h"
+#include "../bytesource.h"
+#include "../concurrencycontroller.h"
 #include "../diagnostics.h"
+#include "../elementarena.h"
 #include "../exceptions.h"
+#include "../filerangecopier.h"
+#include "../flatmultimap.h"
+#include "../hevc/hevcconfiguration.h"
+#include "../id3/id3v2tag.h"
+#include "../ivf/ivfstream.h"
 #include "../margin.h"
+#include "../matroska/matroskacues.h"
+#include "../matroska/matroskatrack.h"
 #include "../mediafileinfo.h"
 #include "../mediaformat.h"
+#include "../mediapayloadhash.h"
+#include "../mp4/mp4ids.h"
+#include "../mp4/mp4tag.h"
+#include "../mpegaudio/mpegaudioframe.h"
+#include "../ogg/oggpagetable.h"
 #include "../positioninset.h"
 #include "../progressfeedback.h"
 #include "../signature.h"
 #include "../size.h"
+#include "../stringpool.h"
+#include "../tagfieldlist.h"
 #include "../tagtarget.h"
+#include "../tagtemplate.h"
+#include "../vorbis/vorbiscomment.h"
+#include "../vorbis/vorbiscommentids.h"
 
+#include <c++utilities/conversion/binaryconversion.h>
+#include <c++utilities/conversion/conversionexception.h>
 #include <c++utilities/conversion/stringbuilder.h>
+#include <c++utilities/io/binaryreader.h>
 #include <c++utilities/tests/testutils.h>
 using namespace CppUtilities;
 
 #include <cppunit/TestFixture.h>
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <regex>
+#include <sstream>
 
+#include <sys/stat.h>
 #include <unistd.h>
 
 using namespace std;
@@ -45,7 +77,41 @@ class UtilitiesTests : public TestFixture {
     CPPUNIT_TEST(testProgressFeedback);
     CPPUNIT_TEST(testAbortableProgressFeedback);
     CPPUNIT_TEST(testDiagnostics);
+    CPPUNIT_TEST(testDiagnosticSinks);
     CPPUNIT_TEST(testBackupFile);
+    CPPUNIT_TEST(testJournal);
+    CPPUNIT_TEST(testTemporaryFile);
+    CPPUNIT_TEST(testDirectRangeCopy);
+    CPPUNIT_TEST(testPreallocation);
+    CPPUNIT_TEST(testCoalescingByteSource);
+    CPPUNIT_TEST(testOggPageChecksum);
+    CPPUNIT_TEST(testOggPageTable);
+    CPPUNIT_TEST(testNonThrowingParsing);
+    CPPUNIT_TEST(testMatroskaCuePositionUpdater);
+    CPPUNIT_TEST(testElementArena);
+    CPPUNIT_TEST(testFlatMultiMap);
+    CPPUNIT_TEST(testTagInsertValues);
+    CPPUNIT_TEST(testAssigningTagValues);
+    CPPUNIT_TEST(testMovingTagValues);
+    CPPUNIT_TEST(testMakingVorbisComment);
+    CPPUNIT_TEST(testMakingTagsIntoBuffer);
+    CPPUNIT_TEST(testMakingId3v2TagInParallel);
+    CPPUNIT_TEST(testTagFieldList);
+    CPPUNIT_TEST(testStringPool);
+    CPPUNIT_TEST(testBase64);
+    CPPUNIT_TEST(testMediaPayloadHasher);
+    CPPUNIT_TEST(testTagTemplate);
+    CPPUNIT_TEST(testConcurrencyController);
+    CPPUNIT_TEST(testMpegAudioFrameSize);
+    CPPUNIT_TEST(testXingHeader);
+    CPPUNIT_TEST(testId3v2Unsynchronisation);
+    CPPUNIT_TEST(testId3v2FrameFlags);
+    CPPUNIT_TEST(testAacHuffmanCodebooks);
+    CPPUNIT_TEST(testAacSbrFillElements);
+    CPPUNIT_TEST(testAacFrameAnalyzer);
+    CPPUNIT_TEST(testAdtsFrameWalk);
+    CPPUNIT_TEST(testIvfFrameIndex);
+    CPPUNIT_TEST(testHevcConfiguration);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -63,7 +129,41 @@ public:
     void testProgressFeedback();
     void testAbortableProgressFeedback();
     void testDiagnostics();
+    void testDiagnosticSinks();
     void testBackupFile();
+    void testJournal();
+    void testTemporaryFile();
+    void testDirectRangeCopy();
+    void testPreallocation();
+    void testCoalescingByteSource();
+    void testOggPageChecksum();
+    void testOggPageTable();
+    void testNonThrowingParsing();
+    void testMatroskaCuePositionUpdater();
+    void testElementArena();
+    void testFlatMultiMap();
+    void testTagInsertValues();
+    void testAssigningTagValues();
+    void testMovingTagValues();
+    void testMakingVorbisComment();
+    void testMakingTagsIntoBuffer();
+    void testMakingId3v2TagInParallel();
+    void testTagFieldList();
+    void testStringPool();
+    void testBase64();
+    void testMediaPayloadHasher();
+    void testTagTemplate();
+    void testConcurrencyController();
+    void testMpegAudioFrameSize();
+    void testXingHeader();
+    void testId3v2Unsynchronisation();
+    void testId3v2FrameFlags();
+    void testAacHuffmanCodebooks();
+    void testAacSbrFillElements();
+    void testAacFrameAnalyzer();
+    void testAdtsFrameWalk();
+    void testIvfFrameIndex();
+    void testHevcConfiguration();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(UtilitiesTests);
@@ -127,6 +227,30 @@ void UtilitiesTests::testSignature()
     CPPUNIT_ASSERT_EQUAL("xz compressed file"s, string(containerFormatName(containerFormat)));
     CPPUNIT_ASSERT_EQUAL("xz"s, string(containerFormatAbbreviation(containerFormat)));
     CPPUNIT_ASSERT_EQUAL(string(), string(containerFormatSubversion(containerFormat)));
+
+    // probe head with ID3v2 tag, junk and two MPEG-1 layer 3 frames (128 kbit/s, 44.1 kHz, 417 byte)
+    auto head = "ID3\x04\x00\x00\x00\x00\x00\x0A"s + string(10, '\0') + "junk!!";
+    const auto frame = "\xFF\xFB\x90\x64"s + string(413, '\0');
+    head += frame;
+    head += frame;
+    auto candidates = probeSignatures(head.data(), head.size());
+    CPPUNIT_ASSERT_EQUAL(2_st, candidates.size());
+    CPPUNIT_ASSERT_EQUAL(ContainerFormat::Id2v2Tag, candidates[0].format);
+    CPPUNIT_ASSERT_EQUAL(0_st, candidates[0].offset);
+    CPPUNIT_ASSERT(candidates[0].confidence == SignatureConfidence::High);
+    CPPUNIT_ASSERT_EQUAL(ContainerFormat::MpegAudioFrames, candidates[1].format);
+    CPPUNIT_ASSERT_EQUAL(26_st, candidates[1].offset);
+    CPPUNIT_ASSERT(candidates[1].confidence == SignatureConfidence::Medium);
+
+    // probe head starting with the frames and head ending within the ID3v2 tag
+    candidates = probeSignatures(head.data() + 26, head.size() - 26);
+    CPPUNIT_ASSERT_EQUAL(1_st, candidates.size());
+    CPPUNIT_ASSERT_EQUAL(ContainerFormat::MpegAudioFrames, candidates[0].format);
+    CPPUNIT_ASSERT(candidates[0].confidence == SignatureConfidence::High);
+    candidates = probeSignatures(head.data(), 15);
+    CPPUNIT_ASSERT_EQUAL(1_st, candidates.size());
+    CPPUNIT_ASSERT_EQUAL(ContainerFormat::Id2v2Tag, candidates[0].format);
+    CPPUNIT_ASSERT(probeSignatures(reinterpret_cast<const char *>(xzHead), 0).empty());
 }
 
 void UtilitiesTests::testMargin()
@@ -167,6 +291,35 @@ void UtilitiesTests::testMediaFormat()
     CPPUNIT_ASSERT_EQUAL("MPEG-4 AAC-LC"s, string(aac.abbreviation()));
     CPPUNIT_ASSERT_EQUAL("HE-AAC"s, string(aac.shortAbbreviation()));
     CPPUNIT_ASSERT_EQUAL("Spectral Band Replication / HE-AAC"s, string(aac.extensionName()));
+
+    // Matroska codec IDs: full ID first, then first two parts, then first part
+    const auto sbr = MatroskaTrack::codecIdToMediaFormat("A_AAC/MPEG4/SBR");
+    CPPUNIT_ASSERT(sbr == GeneralMediaFormat::Aac);
+    CPPUNIT_ASSERT_EQUAL(static_cast<unsigned char>(SubFormats::AacMpeg4LowComplexityProfile), sbr.sub);
+    CPPUNIT_ASSERT_EQUAL(static_cast<unsigned char>(ExtensionFormats::SpectralBandReplication), sbr.extension);
+    const auto layer3 = MatroskaTrack::codecIdToMediaFormat("A_MPEG/L3");
+    CPPUNIT_ASSERT(layer3 == GeneralMediaFormat::Mpeg1Audio);
+    CPPUNIT_ASSERT_EQUAL(static_cast<unsigned char>(SubFormats::Mpeg1Layer3), layer3.sub);
+    CPPUNIT_ASSERT_EQUAL(static_cast<unsigned char>(SubFormats::Mpeg1Layer3), MatroskaTrack::codecIdToMediaFormat("A_MPEG/L3/").sub);
+    CPPUNIT_ASSERT(MatroskaTrack::codecIdToMediaFormat("V_MPEG4/ISO/AVC") == GeneralMediaFormat::Avc);
+    CPPUNIT_ASSERT(MatroskaTrack::codecIdToMediaFormat("V_MPEGH/ISO/HEVC") == GeneralMediaFormat::Hevc);
+    CPPUNIT_ASSERT(MatroskaTrack::codecIdToMediaFormat("V_MS/VFW/FOURCC") == GeneralMediaFormat::MicrosoftVideoCodecManager);
+    CPPUNIT_ASSERT(MatroskaTrack::codecIdToMediaFormat("A_MS/ACM") == GeneralMediaFormat::MicrosoftAudioCodecManager);
+    const auto dtsExpress = MatroskaTrack::codecIdToMediaFormat("A_DTS/EXPRESS/X");
+    CPPUNIT_ASSERT(dtsExpress == GeneralMediaFormat::Dts);
+    CPPUNIT_ASSERT_EQUAL(static_cast<unsigned char>(SubFormats::DtsExpress), dtsExpress.sub);
+    const auto unknownAacProfile = MatroskaTrack::codecIdToMediaFormat("A_AAC/MPEG4/UNKNOWN");
+    CPPUNIT_ASSERT(unknownAacProfile == GeneralMediaFormat::Aac);
+    CPPUNIT_ASSERT_EQUAL(static_cast<unsigned char>(0), unknownAacProfile.sub);
+    CPPUNIT_ASSERT_EQUAL(static_cast<unsigned char>(0), MatroskaTrack::codecIdToMediaFormat("A_AAC/MPEG4/LC/SBR").extension);
+    CPPUNIT_ASSERT(MatroskaTrack::codecIdToMediaFormat("V_VP9/X") == GeneralMediaFormat::Vp9);
+    CPPUNIT_ASSERT(!MatroskaTrack::codecIdToMediaFormat("A_MS"));
+    CPPUNIT_ASSERT(!MatroskaTrack::codecIdToMediaFormat("X_FOO/BAR"));
+    CPPUNIT_ASSERT(!MatroskaTrack::codecIdToMediaFormat(std::string_view()));
+
+    // MP4 FourCCs
+    CPPUNIT_ASSERT(FourccIds::fourccToMediaFormat(FourccIds::Avc1) == GeneralMediaFormat::Avc);
+    CPPUNIT_ASSERT(FourccIds::fourccToMediaFormat(FourccIds::Opus) == GeneralMediaFormat::Opus);
 }
 
 void UtilitiesTests::testPositionInSet()
@@ -233,6 +386,28 @@ void UtilitiesTests::testProgressFeedback()
     CPPUNIT_ASSERT_EQUAL("foo"s, step);
     CPPUNIT_ASSERT_EQUAL(75u, stepPercentage);
     CPPUNIT_ASSERT_EQUAL(25u, overallPercentage);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(1), progress.stepCount());
+
+    // throttle percentage-only updates by delta
+    auto percentageUpdates = 0u;
+    ProgressFeedback throttledProgress([&](const ProgressFeedback &) {}, [&](const ProgressFeedback &) { ++percentageUpdates; });
+    throttledProgress.setThrottling(10);
+    throttledProgress.updateStep("bar");
+    for (auto i = 0; i <= 1000; ++i) {
+        throttledProgress.updateStepPercentageFromFraction(i / 1000.0);
+    }
+    CPPUNIT_ASSERT_EQUAL(10u, percentageUpdates);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(100), throttledProgress.stepPercentage());
+
+    // throttle percentage-only updates by time; reaching 100 percent is reported nevertheless
+    percentageUpdates = 0;
+    throttledProgress.setThrottling(0, std::chrono::hours(1));
+    throttledProgress.updateStep("baz");
+    for (auto i = 0; i <= 100; ++i) {
+        throttledProgress.updateStepPercentage(static_cast<std::uint8_t>(i));
+    }
+    CPPUNIT_ASSERT_EQUAL(1u, percentageUpdates);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(3), throttledProgress.stepCount());
 }
 
 void UtilitiesTests::testAbortableProgressFeedback()
@@ -276,6 +451,19 @@ void UtilitiesTests::testAbortableProgressFeedback()
     CPPUNIT_ASSERT_EQUAL("bar"s, step);
     CPPUNIT_ASSERT_EQUAL(33u, stepPercentage);
     CPPUNIT_ASSERT_EQUAL(25u, overallPercentage);
+
+    // test deadline
+    AbortableProgressFeedback limitedProgress(AbortableProgressFeedback::Callback{});
+    CPPUNIT_ASSERT(limitedProgress.deadline() == std::chrono::steady_clock::time_point::max());
+    limitedProgress.setTimeLimit(std::chrono::hours(1));
+    CPPUNIT_ASSERT(!limitedProgress.isDeadlineExceeded());
+    CPPUNIT_ASSERT(!limitedProgress.isAborted());
+    limitedProgress.setTimeLimit(std::chrono::steady_clock::duration::max());
+    CPPUNIT_ASSERT_MESSAGE("huge time limit does not overflow", !limitedProgress.isAborted());
+    limitedProgress.setDeadline(std::chrono::steady_clock::now() - std::chrono::seconds(1));
+    CPPUNIT_ASSERT(limitedProgress.isDeadlineExceeded());
+    CPPUNIT_ASSERT(limitedProgress.isAborted());
+    CPPUNIT_ASSERT_THROW(limitedProgress.stopIfAborted(), OperationAbortedException);
 }
 
 void UtilitiesTests::testDiagnostics()
@@ -288,6 +476,75 @@ void UtilitiesTests::testDiagnostics()
     diag.emplace_back(DiagLevel::Critical, "critical msg", "context");
     CPPUNIT_ASSERT_EQUAL(DiagLevel::Critical, diag.level());
     CPPUNIT_ASSERT(diag.has(DiagLevel::Critical));
+    CPPUNIT_ASSERT(!diag.front().creationTime().isNull());
+
+    // messages below the threshold are not constructed at all
+    auto cheapDiag = Diagnostics();
+    auto formatted = 0_st;
+    const auto formatMessage = [&formatted] {
+        ++formatted;
+        return "formatted msg"s;
+    };
+    cheapDiag.setLevelThreshold(DiagLevel::Warning);
+    cheapDiag.setFlags(DiagnosticsFlags::Cheap);
+    cheapDiag.emplace_back(DiagLevel::Information, formatMessage, "context");
+    CPPUNIT_ASSERT_EQUAL(0_st, formatted);
+    CPPUNIT_ASSERT(cheapDiag.empty());
+    cheapDiag.emplace_back(DiagLevel::Warning, formatMessage, "context");
+    cheapDiag.emplace_back(DiagLevel::Critical, "critical msg", "context"s);
+    CPPUNIT_ASSERT_EQUAL(1_st, formatted);
+    CPPUNIT_ASSERT_EQUAL(2_st, cheapDiag.size());
+
+    // contexts are interned and timestamps omitted; messages compare equal to regular ones nevertheless
+    CPPUNIT_ASSERT_EQUAL("formatted msg"s, cheapDiag.front().message());
+    CPPUNIT_ASSERT_EQUAL(&cheapDiag.front().context(), &cheapDiag.back().context());
+    CPPUNIT_ASSERT_EQUAL(&DiagMessage::internContext("context"), &cheapDiag.back().context());
+    CPPUNIT_ASSERT(cheapDiag.back().creationTime().isNull());
+    CPPUNIT_ASSERT_EQUAL(diag.back(), cheapDiag.back());
+}
+
+void UtilitiesTests::testDiagnosticSinks()
+{
+    // counting sink keeps only the first critical messages
+    auto countingSink = CountingDiagSink(2);
+    auto diag = Diagnostics();
+    diag.setSink(&countingSink);
+    for (auto i = 0; i != 100; ++i) {
+        diag.emplace_back(DiagLevel::Warning, "warning msg", "context");
+    }
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::Warning, diag.level());
+    CPPUNIT_ASSERT(!diag.has(DiagLevel::Critical));
+    for (auto i = 0; i != 3; ++i) {
+        diag.emplace_back(DiagLevel::Critical, argsToString("critical msg ", i), "context");
+    }
+    CPPUNIT_ASSERT(diag.empty());
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::Critical, diag.level());
+    CPPUNIT_ASSERT(diag.has(DiagLevel::Warning));
+    CPPUNIT_ASSERT(diag.has(DiagLevel::Critical));
+    CPPUNIT_ASSERT_EQUAL(100_st, countingSink.count(DiagLevel::Warning));
+    CPPUNIT_ASSERT_EQUAL(3_st, countingSink.count(DiagLevel::Critical));
+    CPPUNIT_ASSERT_EQUAL(0_st, countingSink.count(DiagLevel::Information));
+    CPPUNIT_ASSERT_EQUAL(103_st, countingSink.totalCount());
+    CPPUNIT_ASSERT_EQUAL(2_st, countingSink.keptMessages().size());
+    CPPUNIT_ASSERT_EQUAL("critical msg 0"s, countingSink.keptMessages().front().message());
+    CPPUNIT_ASSERT_EQUAL("critical msg 1"s, countingSink.keptMessages().back().message());
+
+    // ring buffer sink keeps only the most recent messages
+    auto ringBufferSink = RingBufferDiagSink(3);
+    diag.setSink(&ringBufferSink);
+    for (auto i = 0; i != 5; ++i) {
+        diag.push_back(DiagMessage(DiagLevel::Information, argsToString("msg ", i), "context"));
+    }
+    const auto messages = ringBufferSink.messages();
+    CPPUNIT_ASSERT_EQUAL(3_st, messages.size());
+    CPPUNIT_ASSERT_EQUAL("msg 2"s, messages[0].message());
+    CPPUNIT_ASSERT_EQUAL("msg 4"s, messages[2].message());
+
+    // messages are stored again when removing the sink
+    diag.setSink(nullptr);
+    diag.emplace_back(DiagLevel::Debug, "debug msg", "context");
+    CPPUNIT_ASSERT_EQUAL(1_st, diag.size());
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::Critical, diag.level());
 }
 
 void UtilitiesTests::testBackupFile()
@@ -365,8 +622,9 @@ void UtilitiesTests::testBackupFile()
         CPPUNIT_ASSERT_EQUAL("The original file has been restored."s, diag.back().message());
     }
 
-    // restore after error
-    createBackupFile(string(), file.path(), backupPath1, file.stream(), backupStream1);
+    // restore after error (syncing the backup file to the disk)
+    createBackupFile(string(), file.path(), backupPath1, file.stream(), backupStream1, BackupStrategy::Rename, DurabilityPolicy::FullSync);
+    CPPUNIT_ASSERT_EQUAL(workingDir + "/unsupported.bin.bak", backupPath1);
     try {
         throw Failure();
     } catch (...) {
@@ -392,3 +650,1479 @@ void UtilitiesTests::testBackupFile()
 
     CPPUNIT_ASSERT_EQUAL(0, remove(file.path().data()));
 }
+
+void UtilitiesTests::testJournal()
+{
+    using namespace BackupHelper;
+
+    // setup testfile and read its original contents
+    MediaFileInfo file(workingCopyPath("unsupported.bin"));
+    file.setBackupDirectory(string());
+    file.open();
+    stringstream originalContents;
+    originalContents << file.stream().rdbuf();
+    const auto originalSize = static_cast<std::uint64_t>(originalContents.str().size());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(41), originalSize);
+    file.close();
+
+    // create journal leaving out the range [10, 20) (like the 'make' methods do for the media data)
+    const auto readFile = [&file] {
+        NativeFileStream stream;
+        stream.open(file.path(), ios_base::in | ios_base::binary);
+        stringstream contents;
+        contents << stream.rdbuf();
+        return contents.str();
+    };
+    string journalPath;
+    file.stream().open(file.path(), ios_base::in | ios_base::out | ios_base::binary);
+    createJournal(string(), file.path(), journalPath, file.stream(), originalSize, { { 10, 20 } });
+    CPPUNIT_ASSERT_EQUAL(file.containingDirectory() + "/unsupported.bin.bak.journal", journalPath);
+
+    // modify the file in-place outside of the untouched range and let it grow
+    const auto modify = [&file] {
+        file.stream().seekp(0);
+        file.stream().write("0123456789", 10);
+        file.stream().seekp(20);
+        file.stream() << string(40, 'x');
+        file.stream().flush();
+    };
+    modify();
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(60), readFile().size());
+
+    // restore the original file
+    restoreOriginalFileFromJournal(file.path(), journalPath, file.stream());
+    CPPUNIT_ASSERT_EQUAL(originalContents.str(), readFile());
+    CPPUNIT_ASSERT_EQUAL_MESSAGE("journal removed", -1, remove(journalPath.data()));
+
+    // restore after error
+    file.stream().open(file.path(), ios_base::in | ios_base::out | ios_base::binary);
+    createJournal(string(), file.path(), journalPath, file.stream(), originalSize, { { 10, 20 } });
+    modify();
+    try {
+        throw Failure();
+    } catch (...) {
+        Diagnostics diag;
+        NativeFileStream backupStream;
+        CPPUNIT_ASSERT_THROW(handleFailureAfterFileModified(file, string(), journalPath, file.stream(), backupStream, diag, "test"), Failure);
+        CPPUNIT_ASSERT_EQUAL("Applying new tag information failed."s, diag.front().message());
+        CPPUNIT_ASSERT_EQUAL("The original file has been restored."s, diag.back().message());
+    }
+    CPPUNIT_ASSERT_EQUAL(originalContents.str(), readFile());
+
+    CPPUNIT_ASSERT_EQUAL(0, remove(file.path().data()));
+}
+
+void UtilitiesTests::testTemporaryFile()
+{
+    using namespace BackupHelper;
+
+    const auto path = workingCopyPath("unsupported.bin");
+    const auto readFile = [&path] {
+        NativeFileStream stream;
+        stream.open(path, ios_base::in | ios_base::binary);
+        stringstream contents;
+        contents << stream.rdbuf();
+        return contents.str();
+    };
+    const auto originalContents = readFile();
+    TemporaryFile temporaryFile;
+    if (!temporaryFile.create(path)) {
+        // not supported by the platform or file system
+        CPPUNIT_ASSERT_EQUAL(0, remove(path.data()));
+        return;
+    }
+    CPPUNIT_ASSERT(temporaryFile.isCreated());
+
+    // discarding keeps the original file
+    NativeFileStream outputStream;
+    outputStream.exceptions(ios_base::failbit | ios_base::badbit);
+    outputStream.open(temporaryFile.path(), ios_base::out | ios_base::binary | ios_base::trunc);
+    outputStream << "discarded";
+    outputStream.close();
+    temporaryFile.discard();
+    CPPUNIT_ASSERT(!temporaryFile.isCreated());
+    CPPUNIT_ASSERT_EQUAL(originalContents, readFile());
+
+    // replacing the original file; the stream remains usable and no other files are left behind
+    CPPUNIT_ASSERT(temporaryFile.create(path));
+    outputStream.open(temporaryFile.path(), ios_base::in | ios_base::out | ios_base::binary | ios_base::trunc);
+    outputStream << "new contents";
+    outputStream.flush();
+    CPPUNIT_ASSERT(temporaryFile.replaceOriginalFile(path, DurabilityPolicy::FullSync));
+    CPPUNIT_ASSERT(!temporaryFile.isCreated());
+    CPPUNIT_ASSERT_EQUAL("new contents"s, readFile());
+    outputStream << " appended";
+    outputStream.close();
+    CPPUNIT_ASSERT_EQUAL("new contents appended"s, readFile());
+    CPPUNIT_ASSERT_EQUAL_MESSAGE("no link left behind", -1, remove((path + ".tmp").data()));
+
+    // replacing fails after discarding
+    CPPUNIT_ASSERT_THROW(temporaryFile.replaceOriginalFile(path), std::ios_base::failure);
+
+    CPPUNIT_ASSERT_EQUAL(0, remove(path.data()));
+}
+
+void UtilitiesTests::testDirectRangeCopy()
+{
+    // create a file big enough to be copied via direct I/O by repeating a testfile
+    const auto path = workingCopyPath("mtx-test-data/mp3/id3-tag-and-xing-header.mp3"), targetPath = path + ".copy";
+    auto data = std::string();
+    {
+        NativeFileStream stream;
+        stream.exceptions(ios_base::failbit | ios_base::badbit);
+        stream.open(path, ios_base::in | ios_base::binary);
+        stringstream contents;
+        contents << stream.rdbuf();
+        const auto testFileData = contents.str();
+        CPPUNIT_ASSERT(!testFileData.empty());
+        while (data.size() < FileRangeCopier::minDirectCopySize + FileRangeCopier::directCopyBlockSize * 3 / 2) {
+            data += testFileData;
+        }
+        stream.close();
+        stream.open(path, ios_base::out | ios_base::binary | ios_base::trunc);
+        stream.write(data.data(), static_cast<streamsize>(data.size()));
+        stream.close();
+        stream.open(targetPath, ios_base::out | ios_base::binary | ios_base::trunc);
+    }
+
+    // copy a range whose source and target offsets are neither aligned nor aligned to each other without the kernel
+    NativeFileStream source, target;
+    source.exceptions(ios_base::failbit | ios_base::badbit);
+    target.exceptions(ios_base::failbit | ios_base::badbit);
+    source.open(path, ios_base::in | ios_base::binary);
+    target.open(targetPath, ios_base::in | ios_base::out | ios_base::binary);
+    FileRangeCopier copier;
+    CPPUNIT_ASSERT(copier.isKernelCopyEnabled());
+    copier.setKernelCopyEnabled(false);
+    const auto prefix = "prefix"s;
+    const auto sourceOffset = FileRangeCopier::directIoAlignment + 5, count = data.size() - sourceOffset - 77;
+    const auto opened = copier.open(source, path, target, targetPath);
+    target.write(prefix.data(), static_cast<streamsize>(prefix.size()));
+    source.seekg(static_cast<streamoff>(sourceOffset));
+    copier.copy(source, target, count);
+    CPPUNIT_ASSERT_EQUAL(static_cast<streamoff>(sourceOffset + count), static_cast<streamoff>(source.tellg()));
+    CPPUNIT_ASSERT_EQUAL(static_cast<streamoff>(prefix.size() + count), static_cast<streamoff>(target.tellp()));
+    copier.close();
+    source.close();
+    target.close();
+
+    // the kernel must not have been used; whether direct I/O is used depends on the file system of the working directory
+    const auto &statistics = copier.statistics();
+    CPPUNIT_ASSERT_EQUAL(0_uint64, statistics.bytesCloned);
+    CPPUNIT_ASSERT_EQUAL(0_uint64, statistics.bytesCopiedByKernel);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(count), statistics.bytesCopiedDirectly + statistics.bytesCopiedByUserspace);
+    if (opened && !statistics.bytesCopiedDirectly) {
+        cerr << "- direct I/O is not supported by the file system of the working directory" << endl;
+    }
+
+    // the copy must be identical
+    {
+        NativeFileStream stream;
+        stream.exceptions(ios_base::failbit | ios_base::badbit);
+        stream.open(targetPath, ios_base::in | ios_base::binary);
+        stringstream contents;
+        contents << stream.rdbuf();
+        CPPUNIT_ASSERT(contents.str() == prefix + data.substr(static_cast<std::size_t>(sourceOffset), static_cast<std::size_t>(count)));
+    }
+    CPPUNIT_ASSERT_EQUAL(0, remove(path.data()));
+    CPPUNIT_ASSERT_EQUAL(0, remove(targetPath.data()));
+}
+
+void UtilitiesTests::testPreallocation()
+{
+    const auto path = workingCopyPath("mtx-test-data/mp3/id3-tag-and-xing-header.mp3"), targetPath = path + ".copy";
+    NativeFileStream source, target;
+    source.exceptions(ios_base::failbit | ios_base::badbit);
+    target.exceptions(ios_base::failbit | ios_base::badbit);
+    source.open(path, ios_base::in | ios_base::binary);
+    stringstream contents;
+    contents << source.rdbuf();
+    const auto data = contents.str();
+    CPPUNIT_ASSERT(!data.empty());
+    source.seekg(0);
+    target.open(targetPath, ios_base::in | ios_base::out | ios_base::binary | ios_base::trunc);
+
+    // preallocate much more space than needed which must not change the size of the file
+    constexpr auto preallocatedSize = std::uint64_t(0x1000000);
+    FileRangeCopier copier;
+    const auto opened = copier.open(source, path, target, targetPath);
+    CPPUNIT_ASSERT(copier.preallocate(preallocatedSize));
+    struct stat status = {};
+    CPPUNIT_ASSERT_EQUAL(0, ::stat(targetPath.data(), &status));
+    CPPUNIT_ASSERT_EQUAL(static_cast<off_t>(0), status.st_size);
+    const auto preallocated = static_cast<std::uint64_t>(status.st_blocks) * 512 >= preallocatedSize;
+    if (opened && !preallocated) {
+        cerr << "- preallocating is not supported by the file system of the working directory" << endl;
+    }
+
+    // copy the file; the space which has not been used is released when closing the copier
+    copier.copy(source, target, data.size());
+    copier.close();
+    source.close();
+    target.close();
+    CPPUNIT_ASSERT_EQUAL(0, ::stat(targetPath.data(), &status));
+    CPPUNIT_ASSERT_EQUAL(static_cast<off_t>(data.size()), status.st_size);
+    if (preallocated) {
+        CPPUNIT_ASSERT(static_cast<std::uint64_t>(status.st_blocks) * 512 < preallocatedSize);
+    }
+    target.open(targetPath, ios_base::in | ios_base::binary);
+    contents.str(std::string());
+    contents << target.rdbuf();
+    CPPUNIT_ASSERT(data == contents.str());
+    target.close();
+    CPPUNIT_ASSERT_EQUAL(0, remove(path.data()));
+    CPPUNIT_ASSERT_EQUAL(0, remove(targetPath.data()));
+}
+
+void UtilitiesTests::testCoalescingByteSource()
+{
+    string data(1000, '\0');
+    for (size_t i = 0; i != data.size(); ++i) {
+        data[i] = static_cast<char>(i % 251);
+    }
+    CoalescingByteSource source(make_shared<MemoryByteSource>(data), 100, 200, 100);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(1000), source.size());
+    char buffer[300];
+
+    // first read fetches head and tail
+    CPPUNIT_ASSERT_EQUAL(10_st, source.read(5, buffer, 10));
+    CPPUNIT_ASSERT_EQUAL(data.substr(5, 10), string(buffer, 10));
+    CPPUNIT_ASSERT_EQUAL(2_uint64, source.statistics().roundTrips);
+    CPPUNIT_ASSERT_EQUAL(300_uint64, source.statistics().bytesFetched);
+    CPPUNIT_ASSERT_EQUAL(1_uint64, source.statistics().cacheHits);
+    CPPUNIT_ASSERT_EQUAL(50_st, source.read(950, buffer, 100));
+    CPPUNIT_ASSERT_EQUAL(data.substr(950, 50), string(buffer, 50));
+    CPPUNIT_ASSERT_EQUAL(2_uint64, source.statistics().roundTrips);
+
+    // reads spanning multiple missing blocks need only one round trip
+    CPPUNIT_ASSERT_EQUAL(300_st, source.read(250, buffer, 300));
+    CPPUNIT_ASSERT_EQUAL(data.substr(250, 300), string(buffer, 300));
+    CPPUNIT_ASSERT_EQUAL(3_uint64, source.statistics().roundTrips);
+    CPPUNIT_ASSERT_EQUAL(700_uint64, source.statistics().bytesFetched);
+    CPPUNIT_ASSERT_EQUAL(0_st, source.read(1000, buffer, 1));
+
+    source.resetStatistics();
+    source.clearCache();
+    CPPUNIT_ASSERT_EQUAL(0_uint64, source.statistics().roundTrips);
+
+    // head and tail can be fetched by the caller
+    const auto ranges = source.prefetchRanges();
+    CPPUNIT_ASSERT_EQUAL(2_st, ranges.size());
+    CPPUNIT_ASSERT_EQUAL(0_uint64, ranges[0].first);
+    CPPUNIT_ASSERT_EQUAL(200_st, ranges[0].second);
+    CPPUNIT_ASSERT_EQUAL(900_uint64, ranges[1].first);
+    CPPUNIT_ASSERT_EQUAL(100_st, ranges[1].second);
+    for (const auto &[offset, length] : ranges) {
+        source.insertPrefetchedRange(offset, data.data() + offset, length);
+    }
+    CPPUNIT_ASSERT(source.prefetchRanges().empty());
+    CPPUNIT_ASSERT_EQUAL(10_st, source.read(990, buffer, 10));
+    CPPUNIT_ASSERT_EQUAL(data.substr(990, 10), string(buffer, 10));
+    CPPUNIT_ASSERT_EQUAL(2_uint64, source.statistics().roundTrips);
+    CPPUNIT_ASSERT_EQUAL(1_uint64, source.statistics().cacheHits);
+}
+
+void UtilitiesTests::testOggPageChecksum()
+{
+    // make a page with 3 segments (255 + 255 + 10 bytes) and an arbitrary checksum denoted
+    string page("OggS\x00\x02\x01\x02\x03\x04\x05\x06\x07\x08\x11\x22\x33\x44\x01\x00\x00\x00\xAA\xBB\xCC\xDD\x03\xFF\xFF\x0A"s);
+    for (auto i = 0; i != 520; ++i) {
+        page += static_cast<char>(i * 7);
+    }
+
+    // compute the expected checksum bit by bit
+    auto expectedChecksum = std::uint32_t();
+    for (size_t i = 0; i != page.size(); ++i) {
+        expectedChecksum ^= static_cast<std::uint32_t>(i >= 22 && i < 26 ? 0 : static_cast<std::uint8_t>(page[i])) << 24;
+        for (auto bit = 0; bit != 8; ++bit) {
+            expectedChecksum = (expectedChecksum & 0x80000000u) ? ((expectedChecksum << 1) ^ 0x04C11DB7u) : (expectedChecksum << 1);
+        }
+    }
+
+    // check computing the checksum from a buffer and from a stream
+    CPPUNIT_ASSERT_EQUAL(expectedChecksum, OggPage::computeChecksum(page.data()));
+    stringstream stream(ios_base::in | ios_base::out | ios_base::binary);
+    stream << "prefix" << page;
+    CPPUNIT_ASSERT_EQUAL(expectedChecksum, OggPage::computeChecksum(stream, 6));
+
+    // check updating the checksum
+    OggPage::updateChecksum(stream, 6);
+    const auto updatedPage = stream.str().substr(6);
+    CPPUNIT_ASSERT_EQUAL(expectedChecksum, LE::toUInt32(updatedPage.data() + 22));
+    const OggPage parsedPage(updatedPage.data(), 6, static_cast<std::int32_t>(updatedPage.size()));
+    CPPUNIT_ASSERT_EQUAL(expectedChecksum, parsedPage.checksum());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint32_t>(page.size()), parsedPage.totalSize());
+
+    // check updating the sequence number via CRC delta
+    auto renumberedPage = updatedPage;
+    OggPage::updateSequenceNumber(renumberedPage.data(), 0x12345678u);
+    CPPUNIT_ASSERT_EQUAL(0x12345678u, LE::toUInt32(renumberedPage.data() + 18));
+    CPPUNIT_ASSERT_EQUAL(OggPage::computeChecksum(renumberedPage.data()), LE::toUInt32(renumberedPage.data() + 22));
+    CPPUNIT_ASSERT_EQUAL(expectedChecksum,
+        OggPage::computeChecksumForSequenceNumber(LE::toUInt32(renumberedPage.data() + 22), 0x12345678u, 1u, parsedPage.totalSize()));
+}
+
+void UtilitiesTests::testNonThrowingParsing()
+{
+    // the non-throwing variants return the error corresponding to the exception thrown by the throwing variants
+    throwOnParsingError(ParsingError::None);
+    CPPUNIT_ASSERT_THROW(throwOnParsingError(ParsingError::InvalidData), InvalidDataException);
+    CPPUNIT_ASSERT_THROW(throwOnParsingError(ParsingError::TruncatedData), TruncatedDataException);
+
+    // make an OGG page with one segment of 5 bytes, a page without capture pattern and a truncated page
+    const auto page = "OggS\x00\x02\x00\x00\x00\x00\x00\x00\x00\x00\x11\x22\x33\x44\x07\x00\x00\x00\x00\x00\x00\x00\x01\x05"s + string(5, 'x');
+    const auto junk = "OggX"s + page.substr(4);
+    auto parsedPage = OggPage();
+    CPPUNIT_ASSERT_EQUAL(ParsingError::InvalidData, parsedPage.tryParseHeader(junk.data(), 0, static_cast<std::int32_t>(junk.size())));
+    CPPUNIT_ASSERT_EQUAL(ParsingError::TruncatedData, parsedPage.tryParseHeader(page.data(), 0, 20));
+    CPPUNIT_ASSERT_EQUAL(ParsingError::TruncatedData, parsedPage.tryParseHeader(page.data(), 0, static_cast<std::int32_t>(page.size() - 1)));
+    CPPUNIT_ASSERT_THROW(parsedPage.parseHeader(junk.data(), 0, static_cast<std::int32_t>(junk.size())), InvalidDataException);
+    CPPUNIT_ASSERT_THROW(parsedPage.parseHeader(page.data(), 0, 20), TruncatedDataException);
+    CPPUNIT_ASSERT_EQUAL(ParsingError::None, parsedPage.tryParseHeader(page.data(), 10, static_cast<std::int32_t>(page.size())));
+    CPPUNIT_ASSERT_EQUAL(10_uint64, parsedPage.startOffset());
+    CPPUNIT_ASSERT_EQUAL(7u, parsedPage.sequenceNumber());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint32_t>(page.size()), parsedPage.totalSize());
+    stringstream pageStream(ios_base::in | ios_base::out | ios_base::binary);
+    pageStream << junk << page;
+    CPPUNIT_ASSERT_EQUAL(ParsingError::InvalidData, parsedPage.tryParseHeader(pageStream, 0, static_cast<std::int32_t>(junk.size())));
+    CPPUNIT_ASSERT_EQUAL(ParsingError::None, parsedPage.tryParseHeader(pageStream, junk.size(), static_cast<std::int32_t>(page.size())));
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(junk.size()), parsedPage.startOffset());
+
+    // make an MPEG-1 layer 3 frame (128 kbit/s, 44.1 kHz, 417 bytes) preceded by junk
+    stringstream frameStream(ios_base::in | ios_base::out | ios_base::binary);
+    frameStream.exceptions(ios_base::failbit | ios_base::badbit);
+    frameStream << "junk"s << "\xFF\xFB\x90\x00"s << string(413, '\0');
+    auto reader = BinaryReader(&frameStream);
+    auto frame = MpegAudioFrame();
+    Diagnostics diag;
+    CPPUNIT_ASSERT_EQUAL(ParsingError::InvalidData, frame.tryParseHeader(reader, diag));
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::Critical, diag.level());
+    frameStream.seekg(0);
+    CPPUNIT_ASSERT_THROW(frame.parseHeader(reader, diag), InvalidDataException);
+    frameStream.seekg(4);
+    diag.clear();
+    CPPUNIT_ASSERT_EQUAL(ParsingError::None, frame.tryParseHeader(reader, diag));
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::None, diag.level());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint16_t>(128), frame.bitrate());
+    CPPUNIT_ASSERT_EQUAL(417u, frame.size());
+}
+
+void UtilitiesTests::testOggPageTable()
+{
+    // make a page with 4 segments (255 + 10 + 0 + 3 bytes) and an empty page
+    string page("OggS\x00\x02\x10\x00\x00\x00\x00\x00\x00\x00\x11\x22\x33\x44\x05\x00\x00\x00\xAA\xBB\xCC\xDD\x04\xFF\x0A\x00\x03"s);
+    page.append(268, '\0');
+    const auto emptyPage = "OggS\x00\x04\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x11\x22\x33\x44\x06\x00\x00\x00\xAA\xBB\xCC\xDD\x00"s;
+
+    OggPageTable table;
+    CPPUNIT_ASSERT(table.empty());
+    OggPage parsedPage(page.data(), 100, static_cast<std::int32_t>(page.size()));
+    table.push_back(parsedPage);
+    parsedPage.parseHeader(emptyPage.data(), 100 + page.size(), static_cast<std::int32_t>(emptyPage.size()));
+    table.push_back(parsedPage);
+    CPPUNIT_ASSERT_EQUAL(2_st, table.size());
+
+    const auto first = table.front();
+    CPPUNIT_ASSERT_EQUAL(100_uint64, first.startOffset());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(0x02), first.headerTypeFlag());
+    CPPUNIT_ASSERT(first.isFirstpage());
+    CPPUNIT_ASSERT_EQUAL(0x10_uint64, first.absoluteGranulePosition());
+    CPPUNIT_ASSERT(first.matchesStreamSerialNumber(0x44332211u));
+    CPPUNIT_ASSERT_EQUAL(5u, first.sequenceNumber());
+    CPPUNIT_ASSERT_EQUAL(0xDDCCBBAAu, first.checksum());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(4), first.segmentTableSize());
+    const auto segmentSizes = first.segmentSizes();
+    CPPUNIT_ASSERT_EQUAL(3_st, segmentSizes.size());
+    CPPUNIT_ASSERT_EQUAL(265u, segmentSizes[0]);
+    CPPUNIT_ASSERT_EQUAL(0u, segmentSizes[1]);
+    CPPUNIT_ASSERT_EQUAL(3u, segmentSizes[2]);
+    CPPUNIT_ASSERT_EQUAL(31u, first.headerSize());
+    CPPUNIT_ASSERT_EQUAL(268u, first.dataSize());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint32_t>(page.size()), first.totalSize());
+    CPPUNIT_ASSERT_EQUAL(100_uint64 + 31 + 265, first.dataOffset(1));
+
+    const auto last = table.back();
+    CPPUNIT_ASSERT(last.isLastPage());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(-1), last.absoluteGranulePosition());
+    CPPUNIT_ASSERT(last.segmentSizes().empty());
+    CPPUNIT_ASSERT_EQUAL(27u, last.totalSize());
+
+    table.clear();
+    CPPUNIT_ASSERT(table.empty());
+}
+
+void UtilitiesTests::testMatroskaCuePositionUpdater()
+{
+    MatroskaCuePositionUpdater updater;
+    CPPUNIT_ASSERT(!updater.hasCues());
+    CPPUNIT_ASSERT_EQUAL(0_uint64, updater.totalSize());
+
+    // add cue points for two clusters (ordered by their positions)
+    updater.addCuePoint(0, 1, 100, 10);
+    updater.addCuePoint(0, 2, 100, 50);
+    updater.addCuePoint(1000, 1, 200, 10);
+    CPPUNIT_ASSERT(updater.hasCues());
+    CPPUNIT_ASSERT_EQUAL(3_st, updater.generatedCuePointCount());
+    const auto initialSize = updater.totalSize();
+
+    // updates not changing the length of the positions don't alter the size
+    CPPUNIT_ASSERT(!updater.updateOffsets(100, 110));
+    CPPUNIT_ASSERT(!updater.updateRelativeOffsets(100, 50, 60));
+    CPPUNIT_ASSERT(!updater.updateOffsets(300, 0x10000));
+    CPPUNIT_ASSERT_EQUAL(initialSize, updater.totalSize());
+
+    // moving the second cluster behind 64 KiB requires two more bytes
+    CPPUNIT_ASSERT(updater.updateOffsets(200, 0x10000));
+    CPPUNIT_ASSERT_EQUAL(initialSize + 2, updater.totalSize());
+
+    // the written element has the computed size
+    stringstream stream(ios_base::in | ios_base::out | ios_base::binary);
+    Diagnostics diag;
+    updater.make(stream, diag);
+    CPPUNIT_ASSERT_EQUAL(Diagnostics(), diag);
+    CPPUNIT_ASSERT_EQUAL(updater.totalSize(), static_cast<std::uint64_t>(stream.str().size()));
+
+    updater.clear();
+    CPPUNIT_ASSERT(!updater.hasCues());
+}
+
+void UtilitiesTests::testElementArena()
+{
+    ElementArena arena;
+    CPPUNIT_ASSERT_EQUAL(0_st, arena.blockCount());
+
+    // small allocations are placed one after another within the same block
+    auto *const first = static_cast<char *>(arena.allocate(10));
+    auto *const second = static_cast<char *>(arena.allocate(20));
+    CPPUNIT_ASSERT_EQUAL(1_st, arena.blockCount());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::ptrdiff_t>(ElementArena::alignment), second - first);
+    CPPUNIT_ASSERT_EQUAL(0_st, reinterpret_cast<std::uintptr_t>(second) % ElementArena::alignment);
+
+    // oversized allocations get a dedicated block
+    arena.allocate(ElementArena::blockSize);
+    CPPUNIT_ASSERT_EQUAL(2_st, arena.blockCount());
+    CPPUNIT_ASSERT(arena.allocate(1) > second);
+
+    // elements remember whether they have been allocated within an arena
+    auto *const arenaElement = ElementArena::allocateElement(8, &arena);
+    auto *const heapElement = ElementArena::allocateElement(8, nullptr);
+    CPPUNIT_ASSERT_EQUAL(0_st, reinterpret_cast<std::uintptr_t>(arenaElement) % ElementArena::alignment);
+    ElementArena::deallocateElement(arenaElement);
+    ElementArena::deallocateElement(heapElement);
+
+    // rewinding keeps the regular block and starts over at its beginning
+    arena.rewind();
+    CPPUNIT_ASSERT_EQUAL(1_st, arena.blockCount());
+    CPPUNIT_ASSERT_EQUAL(0_st, arena.allocatedBytes());
+    CPPUNIT_ASSERT_EQUAL(static_cast<void *>(first), arena.allocate(10));
+    CPPUNIT_ASSERT_EQUAL(1_st, arena.blockCount());
+
+    arena.clear();
+    CPPUNIT_ASSERT_EQUAL(0_st, arena.blockCount());
+    CPPUNIT_ASSERT_EQUAL(0_st, arena.allocatedBytes());
+}
+
+void UtilitiesTests::testFlatMultiMap()
+{
+    FlatMultiMap<int, string> map;
+    CPPUNIT_ASSERT(map.empty());
+
+    // elements are ordered by key and elements with equivalent keys keep their insertion order
+    map.emplace(2, "b1");
+    map.insert(make_pair(1, "a"s));
+    map.emplace(3, "c");
+    map.emplace(2, "b2");
+    CPPUNIT_ASSERT_EQUAL(4_st, map.size());
+    const auto expected = vector<pair<int, string>>{ { 1, "a" }, { 2, "b1" }, { 2, "b2" }, { 3, "c" } };
+    CPPUNIT_ASSERT(equal(map.cbegin(), map.cend(), expected.cbegin(), expected.cend()));
+
+    // lookup
+    CPPUNIT_ASSERT_EQUAL(2_st, map.count(2));
+    CPPUNIT_ASSERT_EQUAL(0_st, map.count(4));
+    CPPUNIT_ASSERT(map.find(4) == map.end());
+    CPPUNIT_ASSERT_EQUAL("b1"s, map.find(2)->second);
+    const auto [first, last] = map.equal_range(2);
+    CPPUNIT_ASSERT_EQUAL(2, static_cast<int>(last - first));
+    CPPUNIT_ASSERT_EQUAL("b2"s, (last - 1)->second);
+
+    // removal
+    CPPUNIT_ASSERT_EQUAL(2_st, map.erase(2));
+    CPPUNIT_ASSERT_EQUAL(0_st, map.erase(2));
+    CPPUNIT_ASSERT_EQUAL("c"s, map.erase(map.find(1))->second);
+    CPPUNIT_ASSERT_EQUAL(1_st, map.size());
+    map.clear();
+    CPPUNIT_ASSERT(map.empty());
+}
+
+void UtilitiesTests::testTagInsertValues()
+{
+    // known fields are looked up via their ID
+    Id3v2Tag id3v2Tag;
+    CPPUNIT_ASSERT(id3v2Tag.value(KnownField::Title).isEmpty());
+    id3v2Tag.setValue(KnownField::Title, TagValue("title"));
+    CPPUNIT_ASSERT_EQUAL("title"s, id3v2Tag.value(KnownField::Title).toString());
+    id3v2Tag.setValue(KnownField::Title, TagValue("other title"));
+    CPPUNIT_ASSERT_EQUAL("other title"s, id3v2Tag.value(KnownField::Title).toString());
+    id3v2Tag.setValue(KnownField::RecordDate, TagValue("2020"));
+    CPPUNIT_ASSERT_EQUAL_MESSAGE("fields sharing an ID"s, "2020"s, id3v2Tag.value(KnownField::Year).toString());
+    CPPUNIT_ASSERT(id3v2Tag.value(KnownField::Invalid).isEmpty());
+    const auto copy = Id3v2Tag(id3v2Tag);
+    id3v2Tag.removeAllFields();
+    CPPUNIT_ASSERT(id3v2Tag.value(KnownField::Title).isEmpty());
+    CPPUNIT_ASSERT_EQUAL("other title"s, copy.value(KnownField::Title).toString());
+
+    // inserting values from a tag of a different type
+    VorbisComment vorbisComment;
+    vorbisComment.setValue(KnownField::Title, TagValue("kept"));
+    CPPUNIT_ASSERT_EQUAL_MESSAGE("present fields and fields sharing the ID of inserted fields are skipped"s, 1u,
+        vorbisComment.insertValues(copy, false));
+    CPPUNIT_ASSERT_EQUAL("kept"s, vorbisComment.value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL("2020"s, vorbisComment.value(KnownField::RecordDate).toString());
+    CPPUNIT_ASSERT_EQUAL(3u, vorbisComment.insertValues(copy, true));
+    CPPUNIT_ASSERT_EQUAL("other title"s, vorbisComment.value(KnownField::Title).toString());
+
+    // a pre-defined genre of an MP4 tag is considered the genre like the textual genre
+    auto genreIndex = TagValue();
+    genreIndex.assignStandardGenreIndex(2);
+    auto id3v2GenreTag = Id3v2Tag();
+    id3v2GenreTag.setValue(KnownField::Genre, TagValue("Jazz"));
+    auto mp4Tag = Mp4Tag();
+    mp4Tag.setValue(KnownField::Genre, genreIndex);
+    CPPUNIT_ASSERT_EQUAL(TagDataType::StandardGenreIndex, mp4Tag.value(KnownField::Genre).type());
+    CPPUNIT_ASSERT_EQUAL_MESSAGE("pre-defined genre is present"s, 0u, mp4Tag.insertValues(id3v2GenreTag, false));
+    CPPUNIT_ASSERT_EQUAL(TagDataType::StandardGenreIndex, mp4Tag.value(KnownField::Genre).type());
+    CPPUNIT_ASSERT_EQUAL(1u, mp4Tag.insertValues(id3v2GenreTag, true));
+    CPPUNIT_ASSERT_EQUAL("Jazz"s, mp4Tag.value(KnownField::Genre).toString());
+    CPPUNIT_ASSERT_MESSAGE("pre-defined genre replaced"s, !mp4Tag.hasField(Mp4TagAtomIds::PreDefinedGenre));
+    auto vorbisGenreComment = VorbisComment();
+    mp4Tag.setValue(KnownField::Genre, genreIndex);
+    CPPUNIT_ASSERT_EQUAL(1u, vorbisGenreComment.insertValues(mp4Tag, false));
+    CPPUNIT_ASSERT_EQUAL("Country"s, vorbisGenreComment.value(KnownField::Genre).toString());
+}
+
+void UtilitiesTests::testAssigningTagValues()
+{
+    Id3v2Tag tag;
+    tag.setVersion(3, 0);
+    tag.setValue(KnownField::Album, TagValue("album"));
+    tag.setModified(false);
+
+    // values are assigned like setValue() does but text is converted to a supported encoding
+    auto values = std::vector<std::pair<KnownField, TagValue>>();
+    values.emplace_back(KnownField::Title, TagValue("title", TagTextEncoding::Utf8));
+    values.emplace_back(KnownField::Album, TagValue("album"));
+    values.emplace_back(KnownField::Comment, TagValue());
+    CPPUNIT_ASSERT_EQUAL_MESSAGE("empty value for absent field not assigned"s, 2u, tag.assignValues(std::move(values)));
+    CPPUNIT_ASSERT(tag.isModified());
+    CPPUNIT_ASSERT_EQUAL(TagTextEncoding::Utf16LittleEndian, tag.value(KnownField::Title).dataEncoding());
+    CPPUNIT_ASSERT_EQUAL("title"s, tag.value(KnownField::Title).toString(TagTextEncoding::Utf8));
+    CPPUNIT_ASSERT_EQUAL(2u, tag.fieldCount());
+
+    // identical values don't modify the tag; native IDs can be used as well
+    tag.setModified(false);
+    auto identicalValues = std::vector<std::pair<KnownField, TagValue>>();
+    identicalValues.emplace_back(KnownField::Album, TagValue("album"));
+    CPPUNIT_ASSERT_EQUAL(1u, tag.assignValues(std::move(identicalValues)));
+    CPPUNIT_ASSERT(!tag.isModified());
+    auto nativeValues = std::vector<std::pair<std::uint32_t, TagValue>>();
+    nativeValues.emplace_back(Id3v2FrameIds::lArtist, TagValue("artist"));
+    CPPUNIT_ASSERT_EQUAL(1u, tag.assignValues(std::move(nativeValues)));
+    CPPUNIT_ASSERT_EQUAL("artist"s, tag.value(KnownField::Artist).toString());
+}
+
+void UtilitiesTests::testMovingTagValues()
+{
+    const auto cover = std::string(1000, 'c');
+    VorbisComment vorbisComment;
+    vorbisComment.setValue(KnownField::Title, TagValue("title", TagTextEncoding::Utf8));
+    vorbisComment.setValue(KnownField::Cover, TagValue(cover.data(), cover.size(), TagDataType::Picture));
+    vorbisComment.setValue(KnownField::RecordDate, TagValue("2008"));
+    const auto *const coverData = vorbisComment.value(KnownField::Cover).dataPointer();
+
+    // values are moved into a tag of another type (so the cover data is not copied)
+    Id3v2Tag id3v2Tag;
+    id3v2Tag.setVersion(3, 0);
+    id3v2Tag.setValue(KnownField::Title, TagValue("present"));
+    CPPUNIT_ASSERT_EQUAL(2u, id3v2Tag.insertValues(std::move(vorbisComment), false));
+    CPPUNIT_ASSERT_EQUAL("present"s, id3v2Tag.value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL("title"s, vorbisComment.value(KnownField::Title).toString(TagTextEncoding::Utf8));
+    CPPUNIT_ASSERT_EQUAL(static_cast<const char *>(coverData), static_cast<const char *>(id3v2Tag.value(KnownField::Cover).dataPointer()));
+    CPPUNIT_ASSERT(vorbisComment.value(KnownField::Cover).isEmpty());
+    CPPUNIT_ASSERT_EQUAL("2008"s, id3v2Tag.value(KnownField::RecordDate).toString());
+    CPPUNIT_ASSERT(vorbisComment.value(KnownField::Year).isEmpty());
+
+    // fields are moved into a tag of the same type leaving the other tag without fields
+    Id3v2Tag other;
+    other.setVersion(3, 0);
+    CPPUNIT_ASSERT_EQUAL(3, other.insertFields(std::move(id3v2Tag), true));
+    CPPUNIT_ASSERT_EQUAL(0u, id3v2Tag.fieldCount());
+    CPPUNIT_ASSERT_EQUAL("present"s, other.value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL(static_cast<const char *>(coverData), static_cast<const char *>(other.value(KnownField::Cover).dataPointer()));
+}
+
+void UtilitiesTests::testMakingVorbisComment()
+{
+    const auto cover = std::string(1000, 'c');
+    Diagnostics diag;
+    VorbisComment vorbisComment;
+    vorbisComment.setVendor(TagValue("vendor"));
+    vorbisComment.setValue(KnownField::Title, TagValue("title"));
+    vorbisComment.setValue(KnownField::Cover, TagValue(cover.data(), cover.size(), TagDataType::Picture));
+    vorbisComment.setValue(KnownField::Comment, TagValue());
+
+    // the comment is appended to the buffer; making it via a stream yields the same bytes
+    auto buffer = "prefix"s;
+    vorbisComment.make(buffer, VorbisCommentFlags::None, diag);
+    auto stream = stringstream(ios_base::in | ios_base::out | ios_base::binary);
+    vorbisComment.make(stream, VorbisCommentFlags::None, diag);
+    CPPUNIT_ASSERT_EQUAL("prefix"s, buffer.substr(0, 6));
+    CPPUNIT_ASSERT_EQUAL(stream.str(), buffer.substr(6));
+    CPPUNIT_ASSERT_EQUAL('\x01', buffer.back());
+    CPPUNIT_ASSERT_EQUAL(2u, LE::toUInt32(buffer.data() + 6 + 7 + 4 + 6));
+
+    // the comment can be parsed again
+    VorbisComment parsedComment;
+    parsedComment.parse(buffer.data() + 6, buffer.size() - 6, VorbisCommentFlags::None, diag);
+    CPPUNIT_ASSERT_EQUAL("vendor"s, parsedComment.vendor().toString());
+    CPPUNIT_ASSERT_EQUAL("title"s, parsedComment.value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL(cover.size(), parsedComment.value(KnownField::Cover).dataSize());
+
+    // signature and framing byte are omitted according to the flags
+    buffer.clear();
+    vorbisComment.make(buffer, VorbisCommentFlags::NoSignature | VorbisCommentFlags::NoFramingByte | VorbisCommentFlags::NoCovers, diag);
+    CPPUNIT_ASSERT_EQUAL(6u, LE::toUInt32(buffer.data()));
+    CPPUNIT_ASSERT_EQUAL(1u, LE::toUInt32(buffer.data() + 4 + 6));
+    CPPUNIT_ASSERT_EQUAL(4 + 6 + 4 + 4 + "TITLE=title"s.size(), buffer.size());
+    CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+}
+
+void UtilitiesTests::testMakingTagsIntoBuffer()
+{
+    const auto cover = std::string(1000, '\xFF');
+    Diagnostics diag;
+
+    // making ID3v2 tags into a buffer yields the same bytes as making them via a stream (also when unsynchronising frames)
+    for (const auto version : { 2, 3, 4 }) {
+        Id3v2Tag id3v2Tag;
+        id3v2Tag.setVersion(static_cast<std::uint8_t>(version), 0);
+        id3v2Tag.setValue(KnownField::Title, TagValue("title"));
+        id3v2Tag.setValue(KnownField::Cover, TagValue(cover.data(), cover.size(), TagDataType::Picture));
+        if (version == 4) {
+            for (auto &[id, frame] : id3v2Tag.fields()) {
+                frame.setFlag(0x2);
+            }
+        }
+        auto maker = id3v2Tag.prepareMaking(diag);
+        auto stream = stringstream(ios_base::in | ios_base::out | ios_base::binary);
+        maker.make(stream, 100, diag);
+        auto buffer = std::string(static_cast<std::size_t>(maker.requiredSize()) + 100, '\x01');
+        maker.make(buffer.data(), 100, diag);
+        CPPUNIT_ASSERT_EQUAL(stream.str(), buffer);
+        CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(stream.str().size()), maker.requiredSize() + 100);
+    }
+
+    // making MP4 tags into a buffer yields the same bytes as making them via a stream
+    Mp4Tag mp4Tag;
+    mp4Tag.setValue(KnownField::Title, TagValue("title"));
+    mp4Tag.setValue(KnownField::TrackPosition, TagValue(PositionInSet(3, 10)));
+    mp4Tag.setValue(KnownField::Cover, TagValue(cover.data(), cover.size(), TagDataType::Picture));
+    mp4Tag.setValue(Mp4TagExtendedMeanIds::iTunes, "ISRC", TagValue("isrc"));
+    auto streamed = stringstream(ios_base::in | ios_base::out | ios_base::binary);
+    mp4Tag.prepareMaking(diag).make(streamed, diag);
+    auto maker = mp4Tag.prepareMaking(diag);
+    auto buffer = std::string(static_cast<std::size_t>(maker.requiredSize()), '\x01');
+    maker.make(buffer.data(), diag);
+    CPPUNIT_ASSERT_EQUAL(streamed.str(), buffer);
+    CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+}
+
+void UtilitiesTests::testMakingId3v2TagInParallel()
+{
+    const auto cover = std::string(1000, '\xFF');
+    for (const auto version : { 3, 4 }) {
+        // create a tag with many frames which need to be converted to UTF-16 or compressed and an encrypted frame which
+        // can not be made (and is hence skipped emitting a critical message)
+        Id3v2Tag id3v2Tag;
+        id3v2Tag.setVersion(static_cast<std::uint8_t>(version), 0);
+        id3v2Tag.setValue(KnownField::Title, TagValue("title"));
+        id3v2Tag.setValue(KnownField::Cover, TagValue(cover.data(), cover.size(), TagDataType::Picture));
+        for (auto i = 0; i != 32; ++i) {
+            auto value = TagValue(argsToString("comment ", i, ' ', std::string(200, 'c')), TagTextEncoding::Utf8);
+            value.setDescription(argsToString("description ", i), TagTextEncoding::Utf8);
+            id3v2Tag.fields().insert(std::make_pair(
+                Id3v2FrameIds::lComment, Id3v2Frame(Id3v2FrameIds::lComment, value, 0, static_cast<std::uint16_t>(i % 2 ? 0x0080 : 0))));
+        }
+        id3v2Tag.fields().insert(std::make_pair(Id3v2FrameIds::lArtist, Id3v2Frame(Id3v2FrameIds::lArtist, TagValue("encrypted"), 0, 0x0040)));
+
+        // make the tag sequentially to get the reference data
+        const auto makeTag = [&id3v2Tag](std::size_t threadCount, Diagnostics &diag) {
+            id3v2Tag.setMakingThreadCount(threadCount);
+            auto stream = stringstream(ios_base::in | ios_base::out | ios_base::binary);
+            id3v2Tag.make(stream, 0, diag);
+            return stream.str();
+        };
+        Diagnostics referenceDiag;
+        const auto referenceData = makeTag(1, referenceDiag);
+        CPPUNIT_ASSERT_EQUAL(DiagLevel::Critical, referenceDiag.level());
+
+        // making the tag using multiple threads yields the same bytes and messages in the same order
+        for (const auto threadCount : { 4_st, 0_st }) {
+            Diagnostics diag;
+            CPPUNIT_ASSERT_EQUAL(referenceData, makeTag(threadCount, diag));
+            CPPUNIT_ASSERT_EQUAL(referenceDiag.size(), diag.size());
+            for (std::size_t i = 0; i != diag.size(); ++i) {
+                CPPUNIT_ASSERT_EQUAL(referenceDiag[i].level(), diag[i].level());
+                CPPUNIT_ASSERT_EQUAL(referenceDiag[i].message(), diag[i].message());
+                CPPUNIT_ASSERT_EQUAL(referenceDiag[i].context(), diag[i].context());
+            }
+        }
+
+        // the tag can be read back without the encrypted frame
+        Diagnostics diag;
+        auto stream = stringstream(referenceData, ios_base::in | ios_base::out | ios_base::binary);
+        Id3v2Tag parsedTag;
+        parsedTag.parse(stream, referenceData.size(), diag);
+        CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+        CPPUNIT_ASSERT_EQUAL("title"s, parsedTag.value(KnownField::Title).toString());
+        CPPUNIT_ASSERT(parsedTag.value(KnownField::Artist).isEmpty());
+        const auto comments = parsedTag.values(KnownField::Comment);
+        CPPUNIT_ASSERT_EQUAL(32_st, comments.size());
+        CPPUNIT_ASSERT_EQUAL("comment 31 "s + std::string(200, 'c'), comments.back()->toString(TagTextEncoding::Utf8));
+    }
+}
+
+void UtilitiesTests::testTagFieldList()
+{
+    const auto cover = std::string(1000, 'c');
+    Id3v2Tag id3v2Tag;
+    id3v2Tag.setVersion(4, 0);
+    id3v2Tag.setValue(KnownField::Title, TagValue("title"));
+    id3v2Tag.setValue(KnownField::Cover, TagValue(cover.data(), cover.size(), TagDataType::Picture));
+    VorbisComment vorbisComment;
+    vorbisComment.setVendor(TagValue("vendor"));
+    vorbisComment.setValue("FOO", TagValue("bar"));
+
+    const auto list = TagFieldList::fromTags({ &id3v2Tag, &vorbisComment }, 100);
+    CPPUNIT_ASSERT_EQUAL(4_st, list->size());
+    CPPUNIT_ASSERT_EQUAL(5_st + 6 + 3 + 3, list->dataSize());
+
+    // values exceeding the maximum data size are recorded without data
+    const auto *const coverRecord = list->find(KnownField::Cover);
+    CPPUNIT_ASSERT(coverRecord);
+    CPPUNIT_ASSERT_EQUAL(TagType::Id3v2Tag, coverRecord->tagType);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint32_t>(Id3v2FrameIds::lCover), coverRecord->id);
+    CPPUNIT_ASSERT_EQUAL(cover.size(), coverRecord->dataSize);
+    CPPUNIT_ASSERT(coverRecord->data.empty());
+    const auto *const titleRecord = list->find(KnownField::Title);
+    CPPUNIT_ASSERT(titleRecord);
+    CPPUNIT_ASSERT_EQUAL("title"s, titleRecord->toString());
+
+    // textual IDs are stored as well; the records don't refer to the tags
+    vorbisComment.removeAllFields();
+    const auto &records = list->records();
+    CPPUNIT_ASSERT_EQUAL(1u, records.back().tagIndex);
+    CPPUNIT_ASSERT_EQUAL(KnownField::Invalid, records.back().field);
+    CPPUNIT_ASSERT_EQUAL("FOO"sv, records.back().name);
+    CPPUNIT_ASSERT_EQUAL("bar"sv, records.back().data);
+    CPPUNIT_ASSERT_EQUAL("vendor"s, list->find(KnownField::Vendor)->toString());
+}
+
+void UtilitiesTests::testStringPool()
+{
+    StringPool pool;
+    const auto title = pool.intern("TITLE");
+    CPPUNIT_ASSERT_EQUAL("TITLE"sv, title);
+    CPPUNIT_ASSERT_EQUAL(title.data(), pool.intern(std::string("TITLE")).data());
+    CPPUNIT_ASSERT(title.data() != pool.intern("ARTIST").data());
+    CPPUNIT_ASSERT(pool.intern(std::string_view()).empty());
+    CPPUNIT_ASSERT_EQUAL(2_st, pool.size());
+
+    // names of tag field lists are interned so records of different lists can be compared by pointer
+    VorbisComment vorbisComment;
+    vorbisComment.setValue("FOO", TagValue("bar"));
+    const auto first = TagFieldList::fromTags({ &vorbisComment }, TagFieldList::defaultMaxDataSize, &pool);
+    const auto second = TagFieldList::fromTags({ &vorbisComment }, TagFieldList::defaultMaxDataSize, &pool);
+    CPPUNIT_ASSERT_EQUAL(3_st, first->dataSize());
+    CPPUNIT_ASSERT_EQUAL(first->records().front().name.data(), second->records().front().name.data());
+    CPPUNIT_ASSERT_EQUAL(pool.intern("FOO").data(), first->records().front().name.data());
+
+    pool.clear();
+    CPPUNIT_ASSERT_EQUAL(0_st, pool.size());
+}
+
+void UtilitiesTests::testBase64()
+{
+    // test vectors of RFC 4648
+    const auto encode = [](std::string_view data) { return Base64::encode(reinterpret_cast<const std::uint8_t *>(data.data()), data.size()); };
+    const auto decode = [](std::string_view encoded) {
+        const auto [buffer, size] = Base64::decode(encoded.data(), encoded.size());
+        return string(reinterpret_cast<const char *>(buffer.get()), size);
+    };
+    CPPUNIT_ASSERT_EQUAL(""s, encode(""));
+    CPPUNIT_ASSERT_EQUAL("Zg=="s, encode("f"));
+    CPPUNIT_ASSERT_EQUAL("Zm8="s, encode("fo"));
+    CPPUNIT_ASSERT_EQUAL("Zm9vYmFy"s, encode("foobar"));
+    CPPUNIT_ASSERT_EQUAL("foob"s, decode("Zm9vYg=="));
+    CPPUNIT_ASSERT_EQUAL("fooba"s, decode("Zm9vYmE="));
+    CPPUNIT_ASSERT_EQUAL(""s, decode(""));
+
+    // round trip with sizes covering the vectorized code paths and the remaining bytes
+    auto data = string();
+    for (auto size = 0; size != 300; ++size) {
+        const auto encoded = encode(data);
+        CPPUNIT_ASSERT_EQUAL(Base64::encodedSize(data.size()), encoded.size());
+        CPPUNIT_ASSERT_EQUAL(data, decode(encoded));
+        data.push_back(static_cast<char>(size * 37 + 11));
+    }
+
+    // invalid data is rejected also within vectorized blocks
+    auto encoded = encode(data);
+    encoded[100] = '*';
+    CPPUNIT_ASSERT_THROW(decode(encoded), ConversionException);
+    encoded[100] = '\xC3';
+    CPPUNIT_ASSERT_THROW(decode(encoded), ConversionException);
+    CPPUNIT_ASSERT_THROW(decode("Zm9"), ConversionException);
+    CPPUNIT_ASSERT_THROW(decode("Z=9v"), ConversionException);
+}
+
+void UtilitiesTests::testMediaPayloadHasher()
+{
+    // test vectors of the reference implementation
+    CPPUNIT_ASSERT_EQUAL(0xEF46DB3751D8E999ull, static_cast<unsigned long long>(MediaPayloadHasher::xxHash64("", 0)));
+    CPPUNIT_ASSERT_EQUAL(0x44BC2CF5AD770999ull, static_cast<unsigned long long>(MediaPayloadHasher::xxHash64("abc", 3)));
+
+    // hash depends neither on the number of threads nor on how the payload is added
+    auto data = string(MediaPayloadHasher::blockSize * 5 + 123, '\0');
+    for (auto i = std::size_t(); i != data.size(); ++i) {
+        data[i] = static_cast<char>(i * 31 + (i >> 9));
+    }
+    auto hasher = MediaPayloadHasher();
+    hasher.add(data.data(), data.size());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(data.size()), hasher.size());
+    const auto hash = hasher.finish();
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(data.size()), hash.size);
+    CPPUNIT_ASSERT_EQUAL(0_st, hasher.size());
+    auto parallelHasher = MediaPayloadHasher(3);
+    auto stream = stringstream(data);
+    parallelHasher.addRange(stream, 0, 1000);
+    parallelHasher.add(data.data() + 1000, MediaPayloadHasher::blockSize * 2);
+    parallelHasher.addRange(stream, 1000 + MediaPayloadHasher::blockSize * 2, data.size());
+    CPPUNIT_ASSERT(hash == parallelHasher.finish());
+
+    // other payload leads to other hash
+    data[MediaPayloadHasher::blockSize + 1] ^= 1;
+    hasher.add(data.data(), data.size());
+    CPPUNIT_ASSERT(hash != hasher.finish());
+    CPPUNIT_ASSERT_EQUAL(16_st, hash.toString().size());
+}
+
+void UtilitiesTests::testTagTemplate()
+{
+    const auto cover = std::string(1000, '\xFF');
+    auto tagTemplate = make_shared<TagTemplate>();
+    tagTemplate->setValue(KnownField::Album, TagValue("album"));
+    tagTemplate->setValue(KnownField::Artist, TagValue("artist"));
+    tagTemplate->setValue(KnownField::Cover, TagValue(cover.data(), cover.size(), TagDataType::Picture));
+    CPPUNIT_ASSERT_EQUAL(3_st, tagTemplate->fieldCount());
+    CPPUNIT_ASSERT(tagTemplate->hasField(KnownField::Cover));
+    Diagnostics diag;
+
+    // ID3v2 tags using the template yield the same bytes as tags containing all fields (frames of the template take precedence)
+    for (const auto version : { 2, 3, 4 }) {
+        Id3v2Tag templatedTag, completeTag;
+        for (auto *const tag : { &templatedTag, &completeTag }) {
+            tag->setVersion(static_cast<std::uint8_t>(version), 0);
+            tag->setValue(KnownField::Title, TagValue("title"));
+            tag->setValue(KnownField::TrackPosition, TagValue(PositionInSet(3, 10)));
+        }
+        templatedTag.setValue(KnownField::Album, TagValue("old album"));
+        CPPUNIT_ASSERT(templatedTag.setTagTemplate(tagTemplate));
+        completeTag.setValue(KnownField::Album, TagValue("album"));
+        completeTag.setValue(KnownField::Artist, TagValue("artist"));
+        completeTag.setValue(KnownField::Cover, TagValue(cover.data(), cover.size(), TagDataType::Picture));
+        auto templatedStream = stringstream(ios_base::in | ios_base::out | ios_base::binary);
+        auto completeStream = stringstream(ios_base::in | ios_base::out | ios_base::binary);
+        templatedTag.make(templatedStream, 0, diag);
+        completeTag.make(completeStream, 0, diag);
+        CPPUNIT_ASSERT_EQUAL(completeStream.str(), templatedStream.str());
+        CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(templatedStream.str().size()), templatedTag.prepareMaking(diag).requiredSize());
+    }
+
+    // fields of MP4 tags and Vorbis comments are merged in as well
+    Mp4Tag mp4Tag, completeMp4Tag;
+    mp4Tag.setValue(KnownField::Title, TagValue("title"));
+    mp4Tag.setValue(KnownField::Album, TagValue("old album"));
+    CPPUNIT_ASSERT(mp4Tag.setTagTemplate(tagTemplate));
+    completeMp4Tag.setValue(KnownField::Title, TagValue("title"));
+    completeMp4Tag.setValue(KnownField::Album, TagValue("album"));
+    completeMp4Tag.setValue(KnownField::Artist, TagValue("artist"));
+    completeMp4Tag.setValue(KnownField::Cover, TagValue(cover.data(), cover.size(), TagDataType::Picture));
+    auto mp4Maker = mp4Tag.prepareMaking(diag);
+    CPPUNIT_ASSERT_EQUAL(completeMp4Tag.prepareMaking(diag).requiredSize(), mp4Maker.requiredSize());
+    auto mp4Buffer = std::string(static_cast<std::size_t>(mp4Maker.requiredSize()), '\0');
+    mp4Maker.make(mp4Buffer.data(), diag);
+    CPPUNIT_ASSERT(mp4Buffer.find("album") != std::string::npos);
+    CPPUNIT_ASSERT(mp4Buffer.find("old album") == std::string::npos);
+
+    VorbisComment vorbisComment;
+    vorbisComment.setValue(KnownField::Title, TagValue("title"));
+    vorbisComment.setValue(KnownField::Album, TagValue("old album"));
+    CPPUNIT_ASSERT(vorbisComment.setTagTemplate(tagTemplate));
+    auto buffer = std::string();
+    vorbisComment.make(buffer, VorbisCommentFlags::None, diag);
+    VorbisComment parsedComment;
+    parsedComment.parse(buffer.data(), buffer.size(), VorbisCommentFlags::None, diag);
+    CPPUNIT_ASSERT_EQUAL(4u, parsedComment.fieldCount());
+    CPPUNIT_ASSERT_EQUAL("title"s, parsedComment.value(KnownField::Title).toString());
+    CPPUNIT_ASSERT_EQUAL("album"s, parsedComment.value(KnownField::Album).toString());
+    CPPUNIT_ASSERT_EQUAL("artist"s, parsedComment.value(KnownField::Artist).toString());
+    CPPUNIT_ASSERT_EQUAL(cover.size(), parsedComment.value(KnownField::Cover).dataSize());
+    buffer.clear();
+    vorbisComment.make(buffer, VorbisCommentFlags::NoCovers, diag);
+    CPPUNIT_ASSERT(buffer.find(VorbisCommentIds::cover()) == std::string::npos);
+
+    // the fields are only serialised once per format
+    CPPUNIT_ASSERT_EQUAL(&tagTemplate->serializedFields(TagType::VorbisComment, 0, diag),
+        &tagTemplate->serializedFields(TagType::OggVorbisComment, 0, diag));
+    CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+}
+
+void UtilitiesTests::testConcurrencyController()
+{
+    // simulate a storage which serves \a capacity files concurrently within 10 ms; further files are queued
+    auto controller = ConcurrencyController(64, 4);
+    auto now = std::chrono::steady_clock::now();
+    const auto simulate = [&](unsigned int capacity, double ioShare, std::size_t fileCount) {
+        for (std::size_t i = 0; i != fileCount; ++i) {
+            const auto workers = controller.parallelism();
+            const auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::duration<double, std::milli>(10.0 * std::max(1.0, static_cast<double>(workers) / capacity)));
+            now += latency / workers;
+            controller.addSample(latency, std::chrono::duration_cast<std::chrono::nanoseconds>(latency * ioShare), now);
+        }
+    };
+    CPPUNIT_ASSERT_EQUAL(64u, controller.maxParallelism());
+    CPPUNIT_ASSERT_EQUAL(ConcurrencyController::initialParallelism, controller.parallelism());
+
+    // the number of workers settles slightly above the capacity of the storage and follows when it changes
+    simulate(16, 0.9, 2000);
+    CPPUNIT_ASSERT(controller.parallelism() >= 16);
+    CPPUNIT_ASSERT(controller.parallelism() <= 24);
+    CPPUNIT_ASSERT(controller.ioRatio() > 0.8);
+    simulate(4, 0.9, 2000);
+    CPPUNIT_ASSERT(controller.parallelism() >= 4);
+    CPPUNIT_ASSERT(controller.parallelism() <= 8);
+    simulate(32, 0.9, 3000);
+    CPPUNIT_ASSERT(controller.parallelism() >= 32);
+    CPPUNIT_ASSERT(controller.parallelism() <= 40);
+    CPPUNIT_ASSERT(controller.throughput() > 0.0);
+
+    // CPU-bound files are not processed by more workers than specified for the CPU
+    simulate(32, 0.1, 1000);
+    CPPUNIT_ASSERT_EQUAL(4u, controller.parallelism());
+}
+
+void UtilitiesTests::testMpegAudioFrameSize()
+{
+    // layer 1 frames consist of 4 byte slots so the padding is 4 bytes: MPEG-1 layer 1, 384 kbit/s, 44.1 kHz
+    constexpr auto layer1Frame = MpegAudioFrame(0xFFFFC000u);
+    CPPUNIT_ASSERT_EQUAL(1, layer1Frame.layer());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint16_t>(384), layer1Frame.bitrate());
+    CPPUNIT_ASSERT_EQUAL(384u, layer1Frame.sampleCount());
+    CPPUNIT_ASSERT_EQUAL(0u, layer1Frame.paddingSize());
+    CPPUNIT_ASSERT_EQUAL(416u, layer1Frame.size());
+    constexpr auto paddedLayer1Frame = MpegAudioFrame(0xFFFFC200u);
+    CPPUNIT_ASSERT_EQUAL(4u, paddedLayer1Frame.paddingSize());
+    CPPUNIT_ASSERT_EQUAL(420u, paddedLayer1Frame.size());
+
+    // layer 2 and 3 frames are padded by one byte: MPEG-1 layer 2, 192 kbit/s, 48 kHz
+    constexpr auto layer2Frame = MpegAudioFrame(0xFFFDA400u);
+    CPPUNIT_ASSERT_EQUAL(2, layer2Frame.layer());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint16_t>(192), layer2Frame.bitrate());
+    CPPUNIT_ASSERT_EQUAL(48000u, layer2Frame.samplingFrequency());
+    CPPUNIT_ASSERT_EQUAL(576u, layer2Frame.size());
+    CPPUNIT_ASSERT_EQUAL(1u, MpegAudioFrame(0xFFFDA600u).paddingSize());
+    CPPUNIT_ASSERT_EQUAL(577u, MpegAudioFrame(0xFFFDA600u).size());
+
+    // MPEG-1 layer 3, 128 kbit/s, 44.1 kHz
+    CPPUNIT_ASSERT_EQUAL(417u, MpegAudioFrame(0xFFFB9000u).size());
+    CPPUNIT_ASSERT_EQUAL(418u, MpegAudioFrame(0xFFFB9200u).size());
+
+    // MPEG-2 layer 3 frames contain only 576 samples: 64 kbit/s, 22.05 kHz
+    constexpr auto lsfFrame = MpegAudioFrame(0xFFF38000u);
+    CPPUNIT_ASSERT_EQUAL(2.0, lsfFrame.mpegVersion());
+    CPPUNIT_ASSERT_EQUAL(3, lsfFrame.layer());
+    CPPUNIT_ASSERT_EQUAL(576u, lsfFrame.sampleCount());
+    CPPUNIT_ASSERT_EQUAL(22050u, lsfFrame.samplingFrequency());
+    CPPUNIT_ASSERT_EQUAL(208u, lsfFrame.size());
+    CPPUNIT_ASSERT_EQUAL(209u, MpegAudioFrame(0xFFF38200u).size());
+
+    // the size is unknown for the reserved bitrate index and sampling frequency
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint16_t>(0), MpegAudioFrame(0xFFFBF000u).bitrate());
+    CPPUNIT_ASSERT_EQUAL(0u, MpegAudioFrame(0xFFFBF000u).size());
+    CPPUNIT_ASSERT_EQUAL(0u, MpegAudioFrame(0xFFFB9C00u).samplingFrequency());
+    CPPUNIT_ASSERT_EQUAL(0u, MpegAudioFrame(0xFFFB9E00u).size());
+}
+
+void UtilitiesTests::testXingHeader()
+{
+    // make MPEG-1 layer 3 frames (128 kbit/s, 44.1 kHz, 417 bytes) with the specified Xing header behind the side information
+    const auto uint32 = [](std::uint32_t value) {
+        auto bytes = std::string(4, '\0');
+        BE::getBytes(value, bytes.data());
+        return bytes;
+    };
+    const auto makeFrame = [](const std::string &header, std::size_t sideInformationSize, const std::string &xingHeader) {
+        auto frame = header + std::string(sideInformationSize, '\0') + xingHeader;
+        frame.resize(417, '\0');
+        return frame;
+    };
+    Diagnostics diag;
+    const auto parseFrame = [&diag](const std::string &data) {
+        stringstream stream(data, ios_base::in | ios_base::binary);
+        stream.exceptions(ios_base::failbit | ios_base::badbit);
+        auto reader = BinaryReader(&stream);
+        auto frame = MpegAudioFrame();
+        CPPUNIT_ASSERT_EQUAL(ParsingError::None, frame.tryParseHeader(reader, diag));
+        CPPUNIT_ASSERT(frame.isXingHeaderAvailable());
+        return frame;
+    };
+    auto toc = std::string(100, '\0');
+    for (std::size_t i = 0; i != toc.size(); ++i) {
+        toc[i] = static_cast<char>(i * 2);
+    }
+
+    // all fields present
+    auto frame = parseFrame(makeFrame("\xFF\xFB\x90\x00"s, 32, "Xing"s + uint32(0x0F) + uint32(1000) + uint32(417000) + toc + uint32(50)));
+    CPPUNIT_ASSERT_EQUAL(36u, frame.sideInformationOffset());
+    CPPUNIT_ASSERT(frame.isXingFramefieldPresent());
+    CPPUNIT_ASSERT(frame.isXingBytesfieldPresent());
+    CPPUNIT_ASSERT(frame.isXingTocFieldPresent());
+    CPPUNIT_ASSERT(frame.isXingQualityIndicatorFieldPresent());
+    CPPUNIT_ASSERT_EQUAL(1000u, frame.xingFrameCount());
+    CPPUNIT_ASSERT_EQUAL(417000u, frame.xingBytesfield());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(2), frame.xingToc()[1]);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(198), frame.xingToc()[99]);
+    CPPUNIT_ASSERT_EQUAL(50u, frame.xingQualityIndicator());
+
+    // the frames field but no bytes field present; so the TOC directly follows the frames field
+    frame = parseFrame(makeFrame("\xFF\xFB\x90\x00"s, 32, "Xing"s + uint32(0x05) + uint32(1000) + toc));
+    CPPUNIT_ASSERT(frame.isXingFramefieldPresent());
+    CPPUNIT_ASSERT(!frame.isXingBytesfieldPresent());
+    CPPUNIT_ASSERT(frame.isXingTocFieldPresent());
+    CPPUNIT_ASSERT(!frame.isXingQualityIndicatorFieldPresent());
+    CPPUNIT_ASSERT_EQUAL(1000u, frame.xingFrameCount());
+    CPPUNIT_ASSERT_EQUAL(0u, frame.xingBytesfield());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(0), frame.xingToc()[0]);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(2), frame.xingToc()[1]);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(198), frame.xingToc()[99]);
+
+    // the bytes field but no frames field present ("Info" header of a mono frame which has only 17 bytes of side information)
+    frame = parseFrame(makeFrame("\xFF\xFB\x90\xC0"s, 17, "Info"s + uint32(0x02) + uint32(417000)));
+    CPPUNIT_ASSERT_EQUAL(21u, frame.sideInformationOffset());
+    CPPUNIT_ASSERT(!frame.isXingFramefieldPresent());
+    CPPUNIT_ASSERT(frame.isXingBytesfieldPresent());
+    CPPUNIT_ASSERT(!frame.isXingTocFieldPresent());
+    CPPUNIT_ASSERT_EQUAL(0u, frame.xingFrameCount());
+    CPPUNIT_ASSERT_EQUAL(417000u, frame.xingBytesfield());
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::None, diag.level());
+}
+void UtilitiesTests::testId3v2Unsynchronisation()
+{
+    // a 0x00 byte is inserted after 0xFF bytes followed by 0xE0 or higher, by 0x00 or by the end of the data
+    const auto cases = std::vector<std::pair<std::string, std::string>>{
+        { "abc"s, "abc"s },
+        { "\xFF\x12"s, "\xFF\x12"s },
+        { "\xFF\xE0"s, "\xFF\x00\xE0"s },
+        { "\xFF\xFB\x90"s, "\xFF\x00\xFB\x90"s },
+        { "\xFF\x00"s, "\xFF\x00\x00"s },
+        { "a\xFF"s, "a\xFF\x00"s },
+        { "\xFF\xFF"s, "\xFF\x00\xFF\x00"s },
+        { "\xFF\xE0 sync \xFF\x01 no sync \xFF"s, "\xFF\x00\xE0 sync \xFF\x01 no sync \xFF\x00"s },
+    };
+    for (const auto &[data, unsynchronised] : cases) {
+        CPPUNIT_ASSERT_EQUAL(unsynchronised.size(), Id3v2Frame::unsynchronisedSize(data.data(), data.size()));
+
+        // -> write into a buffer
+        auto buffer = std::string(unsynchronised.size(), '\x01');
+        CPPUNIT_ASSERT_EQUAL(buffer.data() + buffer.size(), Id3v2Frame::writeUnsynchronised(buffer.data(), data.data(), data.size()));
+        CPPUNIT_ASSERT_EQUAL(unsynchronised, buffer);
+
+        // -> write via a stream
+        auto stream = stringstream(ios_base::in | ios_base::out | ios_base::binary);
+        auto writer = BinaryWriter(&stream);
+        Id3v2Frame::writeUnsynchronised(writer, data.data(), data.size());
+        CPPUNIT_ASSERT_EQUAL(unsynchronised, stream.str());
+
+        // -> remove the unsynchronisation again
+        CPPUNIT_ASSERT_EQUAL(data.size(), Id3v2Frame::removeUnsynchronisation(buffer.data(), buffer.size()));
+        buffer.resize(data.size());
+        CPPUNIT_ASSERT_EQUAL(data, buffer);
+    }
+}
+
+void UtilitiesTests::testId3v2FrameFlags()
+{
+    Diagnostics diag;
+    const auto title = std::string(100, 't');
+    const auto makeFrame = [&diag](Id3v2Frame &frame, std::uint8_t version, std::uint32_t headerExtension = 4 + 1) {
+        auto maker = frame.prepareMaking(version, diag);
+        auto buffer = std::string(maker.requiredSize(), '\0');
+        CPPUNIT_ASSERT_EQUAL(buffer.data() + buffer.size(), maker.make(buffer.data()));
+        // -> the frame size covers the group byte and the data length indicator
+        const auto frameSize = version >= 4 ? toNormalInt(BE::toUInt32(buffer.data() + 4)) : BE::toUInt32(buffer.data() + 4);
+        CPPUNIT_ASSERT_EQUAL(static_cast<std::uint32_t>(buffer.size() - 10), frameSize);
+        CPPUNIT_ASSERT_EQUAL(headerExtension + maker.dataSize(), frameSize);
+        return buffer;
+    };
+    const auto parseFrame = [&diag](const std::string &buffer, std::uint8_t version) {
+        auto stream = stringstream(buffer, ios_base::in | ios_base::out | ios_base::binary);
+        auto reader = BinaryReader(&stream);
+        auto frame = Id3v2Frame();
+        frame.parse(reader, version, static_cast<std::uint32_t>(buffer.size()), diag);
+        return frame;
+    };
+
+    // a compressed frame with group information using the ID3v2.3 layout of the flags (compression 0x80, grouping 0x20)
+    // -> ID3v2.3: the data length indicator (decompressed size) precedes the group byte
+    auto frame = Id3v2Frame(Id3v2FrameIds::lTitle, TagValue(title), 0x42, 0x8000 | 0x2000 | 0x0080 | 0x0020);
+    const auto v3 = makeFrame(frame, 3);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint16_t>(0x8000 | 0x2000 | 0x0080 | 0x0020), BE::toUInt16(v3.data() + 8));
+    const auto decompressedSize = BE::toUInt32(v3.data() + 10);
+    CPPUNIT_ASSERT(decompressedSize >= title.size());
+    CPPUNIT_ASSERT_EQUAL('\x42', v3[14]);
+    // -> ID3v2.4: the flags are converted (status flags shifted, grouping 0x40, compression 0x08, data length indicator
+    //    0x01) and the group byte precedes the synchsafe data length indicator
+    const auto v4 = makeFrame(frame, 4);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint16_t>(0x4000 | 0x1000 | 0x0040 | 0x0008 | 0x0001), BE::toUInt16(v4.data() + 8));
+    CPPUNIT_ASSERT_EQUAL('\x42', v4[10]);
+    CPPUNIT_ASSERT(toNormalInt(BE::toUInt32(v4.data() + 11)) >= title.size());
+
+    // the frames can be read back
+    for (const auto &[buffer, version] : { std::make_pair(v3, 3), std::make_pair(v4, 4) }) {
+        auto parsedFrame = parseFrame(buffer, static_cast<std::uint8_t>(version));
+        CPPUNIT_ASSERT(parsedFrame.isCompressed());
+        CPPUNIT_ASSERT(parsedFrame.hasGroupInformation());
+        CPPUNIT_ASSERT(parsedFrame.hasDataLengthIndicator());
+        CPPUNIT_ASSERT(parsedFrame.toDiscardWhenUnknownAndTagIsAltered() || version >= 4);
+        CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(0x42), parsedFrame.group());
+        CPPUNIT_ASSERT_EQUAL(title, parsedFrame.value().toString());
+
+        // -> the frame parsed from one version is made with the flags of the other version
+        const auto otherVersion = static_cast<std::uint8_t>(version >= 4 ? 3 : 4);
+        const auto otherBuffer = makeFrame(parsedFrame, otherVersion);
+        CPPUNIT_ASSERT_EQUAL(BE::toUInt16((otherVersion >= 4 ? v4 : v3).data() + 8), BE::toUInt16(otherBuffer.data() + 8));
+        CPPUNIT_ASSERT_EQUAL(title, parseFrame(otherBuffer, otherVersion).value().toString());
+    }
+
+    // the data length indicator flag is set whenever a data length indicator is written
+    frame = Id3v2Frame(Id3v2FrameIds::lTitle, TagValue(title), 0, 0x0080);
+    const auto compressedV4 = makeFrame(frame, 4, 4);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint16_t>(0x0008 | 0x0001), BE::toUInt16(compressedV4.data() + 8));
+    CPPUNIT_ASSERT_EQUAL(title, parseFrame(compressedV4, 4).value().toString());
+    CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+}
+
+void UtilitiesTests::testAacHuffmanCodebooks()
+{
+    // ADTS frame (AAC-LC, 44.1 kHz, mono) with a single channel element consisting of three scale factor bands coded via
+    // codebook 3 (quadruple 1, 0, 2, 0), codebook 4 (quadruple 1, 1, 0, 1) and codebook 5 (pairs 1, -2 and 0, 0) followed
+    // by the end element; codebooks 3 and 4 are unsigned so the codewords are followed by the sign bits of non-zero values
+    const auto frameData = "\xFF\xF1\x50\x40\x02\x7F\xFC\x00\xC8\x01\x8C\x28\x15\x0A\xA0\xFA\xE2\x7D\xEE"s;
+    auto frame = AdtsFrame();
+    frame.parseHeader(frameData.data());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint16_t>(frameData.size()), frame.totalSize());
+    auto parser = AacFrameElementParser(frame.mpeg4AudioObjectId(), frame.mpeg4SamplingFrequencyIndex(), 0xFF, frame.mpeg4ChannelConfig());
+
+    // the end element is only found at the end of the frame if all codewords have been decoded via the right codebook
+    parser.parse(frame, frameData.data() + frame.headerSize(), frame.dataSize());
+    const auto &statistics = parser.statistics();
+    CPPUNIT_ASSERT_EQUAL(1_uint64, statistics.frameCount);
+    CPPUNIT_ASSERT_EQUAL(0_uint64, statistics.incompleteFrameCount);
+    CPPUNIT_ASSERT_EQUAL(1_uint64, statistics.singleChannelElementCount);
+
+    // the last byte contains the end element, so the frame is incomplete without it
+    CPPUNIT_ASSERT_THROW(parser.parse(frame, frameData.data() + frame.headerSize(), frame.dataSize() - 1u), std::ios_base::failure);
+    CPPUNIT_ASSERT_EQUAL(2_uint64, statistics.frameCount);
+    CPPUNIT_ASSERT_EQUAL(1_uint64, statistics.incompleteFrameCount);
+    CPPUNIT_ASSERT_EQUAL(2_uint64, statistics.singleChannelElementCount);
+}
+
+void UtilitiesTests::testAacSbrFillElements()
+{
+    // ADTS frames (AAC-LC, 44.1 kHz, mono) with a single channel element followed by a fill element containing SBR data, with
+    // and without SBR header, and a frame with just a single channel element; each frame is smaller than the previous one
+    const auto framesData = "\xFF\xF1\x50\x40\x01\xFF\xFC\x00\xC8\x00\x06\x3D\xAC\x00\xE0"
+                            "\xFF\xF1\x50\x40\x01\xBF\xFC\x00\xC8\x00\x06\x1D\x70"
+                            "\xFF\xF1\x50\x40\x01\x7F\xFC\x00\xC8\x00\x07"s;
+    stringstream stream(framesData, ios_base::in | ios_base::binary);
+    stream.exceptions(ios_base::failbit | ios_base::badbit);
+    auto reader = BinaryReader(&stream);
+    auto frame = AdtsFrame();
+    frame.parseHeader(reader);
+    auto parser = AacFrameElementParser(frame.mpeg4AudioObjectId(), frame.mpeg4SamplingFrequencyIndex(), 0xFF, frame.mpeg4ChannelConfig());
+
+    // constructing the SBR info is not implemented yet; the failure must not leave an SBR info behind which is used for the
+    // next SBR data of the same element (the whole frame is read from the stream in any case)
+    for (const auto frameSize : { 15, 13 }) {
+        CPPUNIT_ASSERT_EQUAL(static_cast<std::uint16_t>(frameSize), frame.totalSize());
+        CPPUNIT_ASSERT_THROW(parser.parse(frame, stream, frame.dataSize()), NotImplementedException);
+        frame.parseHeader(reader);
+    }
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint16_t>(11), frame.totalSize());
+    parser.parse(frame, stream, frame.dataSize());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::streamoff>(framesData.size()), static_cast<std::streamoff>(stream.tellg()));
+
+    const auto &statistics = parser.statistics();
+    CPPUNIT_ASSERT_EQUAL(3_uint64, statistics.frameCount);
+    CPPUNIT_ASSERT_EQUAL(2_uint64, statistics.incompleteFrameCount);
+    CPPUNIT_ASSERT_EQUAL(3_uint64, statistics.singleChannelElementCount);
+    CPPUNIT_ASSERT_EQUAL(2_uint64, statistics.fillElementCount);
+    CPPUNIT_ASSERT_EQUAL(2_uint64, statistics.sbrElementCount);
+    CPPUNIT_ASSERT_EQUAL(2_uint64, statistics.sbrFrameCount);
+    CPPUNIT_ASSERT_EQUAL(0_uint64, statistics.psElementCount);
+    CPPUNIT_ASSERT_EQUAL(0_uint64, statistics.psFrameCount);
+}
+
+void UtilitiesTests::testAacFrameAnalyzer()
+{
+    // ADTS frames (AAC-LC, 44.1 kHz, mono) with a single channel element followed by a fill element containing a fill nibble;
+    // the first task parses more frames than syntax elements are supported per frame, so the element counts must be reset per frame
+    const auto frameData = "\xFF\xF1\x50\x40\x01\xBF\xFC\x00\xC8\x00\x06\x11\x0E"s;
+    auto framesData = std::string();
+    for (auto i = 0; i != 100; ++i) {
+        framesData += frameData;
+    }
+    auto analyzer = AacFrameAnalyzer(2);
+    analyzer.setFramesPerTask(64);
+    const auto checkStatistics = [](const AacFrameStatistics &statistics) {
+        CPPUNIT_ASSERT_EQUAL(100_uint64, statistics.frameCount);
+        CPPUNIT_ASSERT_EQUAL(0_uint64, statistics.incompleteFrameCount);
+        CPPUNIT_ASSERT_EQUAL(100_uint64, statistics.singleChannelElementCount);
+        CPPUNIT_ASSERT_EQUAL(100_uint64, statistics.fillElementCount);
+        CPPUNIT_ASSERT_EQUAL(0_uint64, statistics.sbrElementCount);
+    };
+    Diagnostics diag;
+    checkStatistics(analyzer.analyze(framesData.data(), framesData.size(), diag));
+    stringstream stream(framesData, ios_base::in | ios_base::binary);
+    stream.exceptions(ios_base::failbit | ios_base::badbit);
+    checkStatistics(analyzer.analyze(stream, framesData.size(), diag));
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::None, diag.level());
+
+    // bytes in front of the first frame are skipped
+    framesData.insert(0, 3, '\0');
+    checkStatistics(analyzer.analyze(framesData.data(), framesData.size(), diag));
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::Warning, diag.level());
+    CPPUNIT_ASSERT_EQUAL("3 bytes not belonging to any ADTS frame have been skipped."s, diag.back().message());
+}
+
+void UtilitiesTests::testAdtsFrameWalk()
+{
+    // ADTS frame (AAC-LC, 44.1 kHz, mono, one raw data block) also used in testAacHuffmanCodebooks()
+    const auto frameData = "\xFF\xF1\x50\x40\x02\x7F\xFC\x00\xC8\x01\x8C\x28\x15\x0A\xA0\xFA\xE2\x7D\xEE"s;
+    const auto id3v1Tag = "TAG"s + std::string(125, '\0');
+
+    // walk through more frames than fit into one block followed by an ID3v1 tag (which must not count as audio data) and
+    // through the same frames with the last one being truncated (which must not count as frame)
+    constexpr auto frameCount = std::size_t(5000);
+    static_assert(frameCount * 19 > AdtsStream::blockSize, "frames exceed the first block");
+    for (const auto truncated : { false, true }) {
+        auto data = std::string();
+        for (auto i = std::size_t(); i != frameCount; ++i) {
+            data += frameData;
+        }
+        if (truncated) {
+            data.resize(data.size() - 7);
+        }
+        const auto audioSize = data.size();
+        data += id3v1Tag;
+        auto stream = stringstream(data, ios_base::in | ios_base::out | ios_base::binary);
+        auto track = AdtsStream(stream, 0);
+        Diagnostics diag;
+        track.parseHeader(diag);
+        CPPUNIT_ASSERT(track.isHeaderValid());
+        CPPUNIT_ASSERT(diag.level() <= DiagLevel::Information);
+        CPPUNIT_ASSERT_EQUAL(44100u, track.samplingFrequency());
+        CPPUNIT_ASSERT_EQUAL(static_cast<std::uint16_t>(1), track.channelCount());
+        CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(audioSize), track.size());
+        const auto expectedSampleCount = static_cast<std::uint64_t>((truncated ? frameCount - 1 : frameCount) * 1024);
+        CPPUNIT_ASSERT_EQUAL(expectedSampleCount, track.sampleCount());
+        CPPUNIT_ASSERT_EQUAL(TimeSpan::fromSeconds(static_cast<double>(expectedSampleCount) / 44100.0), track.duration());
+        CPPUNIT_ASSERT_EQUAL(static_cast<double>(audioSize) * 8.0 / track.duration().totalSeconds() / 1024.0, track.bitrate());
+    }
+}
+
+void UtilitiesTests::testIvfFrameIndex()
+{
+    // make a 320x240 VP8 stream at 30 fps with 200 frames of 1000 bytes where every 10th frame is a keyframe; the frames
+    // exceed the 64 KiB chunks the stream is read in
+    constexpr auto frameCount = std::uint32_t(200), frameSize = std::uint32_t(1000);
+    const auto makeStream = [](std::uint32_t denotedFrameCount) {
+        const auto append = [](std::string &data, std::uint64_t value, std::size_t byteCount) {
+            for (std::size_t i = 0; i != byteCount; ++i, value >>= 8) {
+                data += static_cast<char>(value & 0xFF);
+            }
+        };
+        auto data = "DKIF"s;
+        append(data, 0, 2); // version
+        append(data, 32, 2); // header length
+        data += "VP80";
+        append(data, 320, 2);
+        append(data, 240, 2);
+        append(data, 30, 4); // rate
+        append(data, 1, 4); // scale
+        append(data, denotedFrameCount, 4);
+        append(data, 0, 4); // unused
+        for (auto i = std::uint32_t(); i != frameCount; ++i) {
+            append(data, frameSize, 4);
+            append(data, i, 8);
+            data += (i % 10) ? '\x01' : '\x00'; // VP8 frame tag with "key frame" bit (0 means keyframe)
+            data.append(frameSize - 1, '\0');
+        }
+        return data;
+    };
+    const auto firstFrameOffset = std::uint64_t(32), frameDistance = std::uint64_t(IvfFrame::headerSize + frameSize);
+
+    // no frame index is built by default and the frame count denoted in the header is used
+    Diagnostics diag;
+    auto data = makeStream(frameCount);
+    auto stream = stringstream(data, ios_base::in | ios_base::out | ios_base::binary);
+    auto track = IvfStream(stream, 0);
+    track.parseHeader(diag);
+    CPPUNIT_ASSERT(track.isHeaderValid());
+    CPPUNIT_ASSERT_EQUAL(GeneralMediaFormat::Vp8, track.format().general);
+    CPPUNIT_ASSERT_EQUAL(Size(320, 240), track.pixelSize());
+    CPPUNIT_ASSERT(track.frames().empty());
+    CPPUNIT_ASSERT(!track.isFrameIndexComplete());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(frameCount), track.sampleCount());
+    CPPUNIT_ASSERT_EQUAL(TimeSpan::fromSeconds(200.0 / 30.0), track.duration());
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::None, diag.level());
+
+    // a sufficient budget indexes all frames
+    track.setFrameIndexBudget(0x1000000);
+    track.parseHeader(diag);
+    CPPUNIT_ASSERT(track.isFrameIndexComplete());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(frameCount), track.frames().size());
+    auto keyframeCount = std::size_t();
+    for (std::size_t i = 0; i != track.frames().size(); ++i) {
+        const auto &frame = track.frames()[i];
+        CPPUNIT_ASSERT_EQUAL(firstFrameOffset + i * frameDistance, frame.startOffset());
+        CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(i), frame.timestamp());
+        CPPUNIT_ASSERT_EQUAL(frameSize, frame.size());
+        CPPUNIT_ASSERT_EQUAL(!(i % 10), frame.isKeyframe());
+        keyframeCount += frame.isKeyframe();
+    }
+    CPPUNIT_ASSERT_EQUAL(20_st, keyframeCount);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(frameCount), track.sampleCount());
+    CPPUNIT_ASSERT_EQUAL(TimeSpan::fromSeconds(200.0 / 30.0), track.duration());
+    CPPUNIT_ASSERT_EQUAL(200000.0 * 0.008 / (200.0 / 30.0), track.bitrate());
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::None, diag.level());
+
+    // an exhausted budget stops after the first chunk and the frame count is extrapolated (regardless of the header)
+    data = makeStream(0);
+    stream.str(data);
+    stream.clear();
+    track.setFrameIndexBudget(1);
+    track.parseHeader(diag);
+    CPPUNIT_ASSERT(!track.isFrameIndexComplete());
+    CPPUNIT_ASSERT_EQUAL(65_st, track.frames().size());
+    CPPUNIT_ASSERT_EQUAL(firstFrameOffset + 64 * frameDistance, track.frames().back().startOffset());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(frameCount), track.sampleCount());
+    CPPUNIT_ASSERT_EQUAL(TimeSpan::fromSeconds(200.0 / 30.0), track.duration());
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::Information, diag.level());
+
+    // a truncated last frame is ignored and a mismatching frame count in the header is reported
+    diag.clear();
+    data = makeStream(frameCount);
+    data.resize(data.size() - 10);
+    stream.str(data);
+    stream.clear();
+    track.setFrameIndexBudget(0x1000000);
+    track.parseHeader(diag);
+    CPPUNIT_ASSERT(track.isFrameIndexComplete());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(frameCount - 1), track.frames().size());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(frameCount - 1), track.sampleCount());
+    CPPUNIT_ASSERT_EQUAL(TimeSpan::fromSeconds(199.0 / 30.0), track.duration());
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::Warning, diag.level());
+    CPPUNIT_ASSERT_EQUAL(2_st, diag.size());
+}
+
+void UtilitiesTests::testHevcConfiguration()
+{
+    // "hvcC" as written for a 1080p x265 encode (Main, level 4, 4:2:0, SAR 1:1, 25 fps) with 16x16 minimum coding blocks
+    // so the picture is coded as 1920x1088 and cropped by 4 chroma rows; contains a VPS, SPS and PPS with emulation prevention bytes
+    const auto hvcC = "\x01\x01\x60\x00\x00\x00\x90\x00\x00\x00\x00\x00\x78\xF0\x00\xFC"
+                      "\xFD\xF8\xF8\x00\x00\x0F\x03\xA0\x00\x01\x00\x21\x40\x01\x0C\x01"
+                      "\xFF\xFF\x01\x60\x00\x00\x03\x00\x90\x00\x00\x03\x00\x00\x03\x00"
+                      "\x78\x95\xC0\xC0\x00\x00\x03\x00\x40\x00\x00\x06\x54\xA1\x00\x01"
+                      "\x00\x2F\x42\x01\x01\x01\x60\x00\x00\x03\x00\x90\x00\x00\x03\x00"
+                      "\x00\x03\x00\x78\xA0\x03\xC0\x80\x11\x07\xCB\x96\x57\x4E\x4D\xAF"
+                      "\x01\x6A\x02\x02\x02\x08\x00\x00\x03\x00\x08\x00\x00\x03\x00\xC8"
+                      "\x40\xA2\x00\x01\x00\x07\x44\x01\xC1\x72\xB4\x62\x40"s;
+    CPPUNIT_ASSERT_EQUAL(125_st, hvcC.size());
+    Diagnostics diag;
+    const auto parse = [&diag](const std::string &data, std::uint64_t maxSize) {
+        stringstream stream(data, ios_base::in | ios_base::binary);
+        BinaryReader reader(&stream);
+        auto config = HevcConfiguration();
+        config.parse(reader, maxSize, diag);
+        return config;
+    };
+
+    // values of the configuration record itself
+    const auto config = parse(hvcC, hvcC.size());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(1), config.configurationVersion);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(1), config.profileIndication);
+    CPPUNIT_ASSERT_EQUAL(0x60000000u, config.profileCompatibilityFlags);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(120), config.levelIndication);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(1), config.chromaFormatIndication);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(0), config.bitDepthLumaMinus8);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(1), config.temporalLayerCount);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(4), config.naluSizeLength);
+    CPPUNIT_ASSERT(diag.empty());
+
+    // values of the VPS
+    CPPUNIT_ASSERT_EQUAL(1_st, config.vpsInfos.size());
+    const auto &vps = config.vpsInfos.front();
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint16_t>(33), vps.size);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(120), vps.profileTierLevel.levelIndication);
+    CPPUNIT_ASSERT(vps.timingInfo.isPresent);
+    CPPUNIT_ASSERT_EQUAL(25u, vps.timingInfo.timeScale / vps.timingInfo.unitsInTick);
+
+    // values of the SPS: picture size, cropping, chroma format, level, PAR and frame rate
+    CPPUNIT_ASSERT_EQUAL(1_st, config.spsInfos.size());
+    const auto &sps = config.spsInfos.front();
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint16_t>(47), sps.size);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(1), sps.profileTierLevel.profileIndication);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(120), sps.profileTierLevel.levelIndication);
+    CPPUNIT_ASSERT_EQUAL(static_cast<ugolomb>(1), sps.chromaFormatIndication);
+    CPPUNIT_ASSERT_EQUAL(static_cast<ugolomb>(0), sps.bitDepthLumaMinus8);
+    CPPUNIT_ASSERT_EQUAL(0u, sps.cropping.left());
+    CPPUNIT_ASSERT_EQUAL(0u, sps.cropping.right());
+    CPPUNIT_ASSERT_EQUAL(0u, sps.cropping.top());
+    CPPUNIT_ASSERT_EQUAL(4u, sps.cropping.bottom());
+    CPPUNIT_ASSERT_EQUAL(1920u, sps.pictureSize.width());
+    CPPUNIT_ASSERT_EQUAL(1080u, sps.pictureSize.height());
+    CPPUNIT_ASSERT(sps.vuiPresent);
+    CPPUNIT_ASSERT(sps.pixelAspectRatio.isValid());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint16_t>(1), sps.pixelAspectRatio.numerator);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint16_t>(1), sps.pixelAspectRatio.denominator);
+    CPPUNIT_ASSERT(sps.timingInfo.isPresent);
+    CPPUNIT_ASSERT_EQUAL(1u, sps.timingInfo.unitsInTick);
+    CPPUNIT_ASSERT_EQUAL(25u, sps.timingInfo.timeScale);
+
+    // a config exceeding the specified size is rejected, no matter whether the fixed part or a NAL unit is truncated
+    CPPUNIT_ASSERT_THROW(parse(hvcC, 22), TruncatedDataException);
+    CPPUNIT_ASSERT_THROW(parse(hvcC, hvcC.size() - 1), TruncatedDataException);
+    CPPUNIT_ASSERT_THROW(parse(hvcC, 23 + 3 + 2 + 32), TruncatedDataException);
+
+    // a truncated SPS is ignored (but the config itself is still usable)
+    auto truncatedSps = hvcC.substr(0, 22) + '\x01' + hvcC.substr(0x3D, 5 + 20);
+    truncatedSps[26] = '\x00';
+    truncatedSps[27] = '\x14';
+    const auto configWithTruncatedSps = parse(truncatedSps, truncatedSps.size());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint8_t>(120), configWithTruncatedSps.levelIndication);
+    CPPUNIT_ASSERT(configWithTruncatedSps.vpsInfos.empty());
+    CPPUNIT_ASSERT(configWithTruncatedSps.spsInfos.empty());
+    CPPUNIT_ASSERT_EQUAL(DiagLevel::Debug, diag.level());
+}
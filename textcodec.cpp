@@ -0,0 +1,465 @@
+#include "./textcodec.h"
+#include "./tagvalue.h"
+
+#include <c++utilities/conversion/conversionexception.h>
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#define TAG_PARSER_TEXTCODEC_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define TAG_PARSER_TEXTCODEC_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+/// \cond
+namespace TextCodec {
+
+namespace {
+
+/// \brief The number of input bytes converted at a time by the block functions.
+constexpr std::size_t blockSize = 16;
+
+/*!
+ * \brief Returns whether \a encoding is one of the UTF-16 encodings.
+ */
+constexpr bool isUtf16(TagTextEncoding encoding)
+{
+    return encoding == TagTextEncoding::Utf16LittleEndian || encoding == TagTextEncoding::Utf16BigEndian;
+}
+
+#if defined(TAG_PARSER_TEXTCODEC_SSE2)
+
+/*!
+ * \brief Returns whether the block at \a input consists of ASCII characters only.
+ */
+inline bool isAsciiBlock(const char *input)
+{
+    return !_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input)));
+}
+
+/*!
+ * \brief Widens the bytes of the block at \a input to UTF-16 code units at \a output (2 * blockSize bytes).
+ */
+template <bool bigEndian> inline void widenBlock(const char *input, char *output)
+{
+    const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input)), zero = _mm_setzero_si128();
+    auto *const units = reinterpret_cast<__m128i *>(output);
+    _mm_storeu_si128(units, bigEndian ? _mm_unpacklo_epi8(zero, bytes) : _mm_unpacklo_epi8(bytes, zero));
+    _mm_storeu_si128(units + 1, bigEndian ? _mm_unpackhi_epi8(zero, bytes) : _mm_unpackhi_epi8(bytes, zero));
+}
+
+/*!
+ * \brief Loads the UTF-16 code units of the block at \a input in host byte order (assuming a little-endian host).
+ */
+template <bool bigEndian> inline __m128i loadUnits(const char *input)
+{
+    const auto units = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input));
+    return bigEndian ? _mm_or_si128(_mm_slli_epi16(units, 8), _mm_srli_epi16(units, 8)) : units;
+}
+
+/*!
+ * \brief Narrows the UTF-16 code units of the block at \a input to bytes at \a output (blockSize / 2 bytes) if all of
+ *        them are less than 0x80 (\a latin1 not set) or 0x100 (\a latin1 set).
+ * \returns Returns whether the block has been converted.
+ */
+template <bool bigEndian, bool latin1> inline bool narrowBlock(const char *input, char *output)
+{
+    const auto units = loadUnits<bigEndian>(input);
+    const auto excess = _mm_and_si128(units, _mm_set1_epi16(static_cast<short>(latin1 ? 0xFF00 : 0xFF80)));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(excess, _mm_setzero_si128())) != 0xFFFF) {
+        return false;
+    }
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(output), _mm_packus_epi16(units, units));
+    return true;
+}
+
+/*!
+ * \brief Swaps the bytes of the UTF-16 code units of the block at \a input and stores them at \a output.
+ */
+inline void swapBlock(const char *input, char *output)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(output), loadUnits<true>(input));
+}
+
+#elif defined(TAG_PARSER_TEXTCODEC_NEON)
+
+inline bool isAsciiBlock(const char *input)
+{
+    return vmaxvq_u8(vld1q_u8(reinterpret_cast<const std::uint8_t *>(input))) < 0x80;
+}
+
+template <bool bigEndian> inline void widenBlock(const char *input, char *output)
+{
+    const auto bytes = vld1q_u8(reinterpret_cast<const std::uint8_t *>(input)), zero = vdupq_n_u8(0);
+    auto *const units = reinterpret_cast<std::uint8_t *>(output);
+    vst1q_u8(units, bigEndian ? vzip1q_u8(zero, bytes) : vzip1q_u8(bytes, zero));
+    vst1q_u8(units + 16, bigEndian ? vzip2q_u8(zero, bytes) : vzip2q_u8(bytes, zero));
+}
+
+template <bool bigEndian> inline uint16x8_t loadUnits(const char *input)
+{
+    const auto bytes = vld1q_u8(reinterpret_cast<const std::uint8_t *>(input));
+    return vreinterpretq_u16_u8(bigEndian ? vrev16q_u8(bytes) : bytes);
+}
+
+template <bool bigEndian, bool latin1> inline bool narrowBlock(const char *input, char *output)
+{
+    const auto units = loadUnits<bigEndian>(input);
+    if (vmaxvq_u16(units) >= (latin1 ? 0x100 : 0x80)) {
+        return false;
+    }
+    vst1_u8(reinterpret_cast<std::uint8_t *>(output), vmovn_u16(units));
+    return true;
+}
+
+inline void swapBlock(const char *input, char *output)
+{
+    vst1q_u8(reinterpret_cast<std::uint8_t *>(output), vrev16q_u8(vld1q_u8(reinterpret_cast<const std::uint8_t *>(input))));
+}
+
+#else
+
+inline bool isAsciiBlock(const char *input)
+{
+    std::uint64_t words[2];
+    std::memcpy(words, input, sizeof(words));
+    return !((words[0] | words[1]) & 0x8080808080808080ull);
+}
+
+template <bool bigEndian> inline void widenBlock(const char *input, char *output)
+{
+    for (const auto *const end = input + blockSize; input != end; ++input, output += 2) {
+        output[bigEndian ? 0 : 1] = 0;
+        output[bigEndian ? 1 : 0] = *input;
+    }
+}
+
+template <bool bigEndian, bool latin1> inline bool narrowBlock(const char *input, char *output)
+{
+    for (std::size_t i = 0; i != blockSize; i += 2) {
+        const auto high = static_cast<std::uint8_t>(input[i + (bigEndian ? 0 : 1)]);
+        const auto low = static_cast<std::uint8_t>(input[i + (bigEndian ? 1 : 0)]);
+        if (high || (!latin1 && low >= 0x80)) {
+            return false;
+        }
+    }
+    for (std::size_t i = 0; i != blockSize; i += 2) {
+        output[i / 2] = input[i + (bigEndian ? 1 : 0)];
+    }
+    return true;
+}
+
+inline void swapBlock(const char *input, char *output)
+{
+    for (std::size_t i = 0; i != blockSize; i += 2) {
+        output[i] = input[i + 1];
+        output[i + 1] = input[i];
+    }
+}
+
+#endif
+
+/*!
+ * \brief Returns whether the block at \a input contains UTF-16 surrogates (which are validated individually).
+ */
+template <bool bigEndian> inline bool hasSurrogates(const char *input)
+{
+    for (std::size_t i = bigEndian ? 0 : 1; i < blockSize; i += 2) {
+        if ((static_cast<std::uint8_t>(input[i]) & 0xF8) == 0xD8) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * \brief Reads the UTF-16 code unit at \a input.
+ */
+template <bool bigEndian> inline std::uint16_t readUnit(const char *input)
+{
+    const auto first = static_cast<std::uint8_t>(input[0]), second = static_cast<std::uint8_t>(input[1]);
+    return static_cast<std::uint16_t>(bigEndian ? (first << 8 | second) : (second << 8 | first));
+}
+
+/*!
+ * \brief Writes the UTF-16 code \a unit to \a output.
+ */
+template <bool bigEndian> inline void writeUnit(std::uint16_t unit, char *output)
+{
+    output[bigEndian ? 0 : 1] = static_cast<char>(unit >> 8);
+    output[bigEndian ? 1 : 0] = static_cast<char>(unit & 0xFF);
+}
+
+/*!
+ * \brief Decodes the character at \a input which is encoded using \a encoding and advances \a input.
+ * \throws Throws ConversionException if \a input does not point to a valid character.
+ */
+template <TagTextEncoding encoding> char32_t decode(const char *&input, const char *end)
+{
+    if constexpr (encoding == TagTextEncoding::Latin1) {
+        return static_cast<std::uint8_t>(*input++);
+    } else if constexpr (encoding == TagTextEncoding::Utf8) {
+        const auto lead = static_cast<std::uint8_t>(*input);
+        if (lead < 0x80) {
+            ++input;
+            return lead;
+        }
+        // determine length and range of the second byte (to reject overlong forms, surrogates and values beyond U+10FFFF)
+        auto length = std::size_t();
+        auto min = std::uint8_t(0x80), max = std::uint8_t(0xBF);
+        auto codePoint = char32_t();
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            length = 2;
+            codePoint = lead & 0x1F;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            length = 3;
+            codePoint = lead & 0x0F;
+            min = lead == 0xE0 ? 0xA0 : 0x80;
+            max = lead == 0xED ? 0x9F : 0xBF;
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            length = 4;
+            codePoint = lead & 0x07;
+            min = lead == 0xF0 ? 0x90 : 0x80;
+            max = lead == 0xF4 ? 0x8F : 0xBF;
+        } else {
+            throw ConversionException("Invalid UTF-8 lead byte.");
+        }
+        if (static_cast<std::size_t>(end - input) < length) {
+            throw ConversionException("Truncated UTF-8 sequence.");
+        }
+        for (std::size_t i = 1; i != length; ++i) {
+            const auto byte = static_cast<std::uint8_t>(input[i]);
+            if (i == 1 ? (byte < min || byte > max) : (byte & 0xC0) != 0x80) {
+                throw ConversionException("Invalid UTF-8 sequence.");
+            }
+            codePoint = codePoint << 6 | (byte & 0x3F);
+        }
+        input += length;
+        return codePoint;
+    } else {
+        constexpr auto bigEndian = encoding == TagTextEncoding::Utf16BigEndian;
+        if (end - input < 2) {
+            throw ConversionException("Truncated UTF-16 code unit.");
+        }
+        const auto unit = readUnit<bigEndian>(input);
+        input += 2;
+        if (unit < 0xD800 || unit > 0xDFFF) {
+            return unit;
+        }
+        if (unit > 0xDBFF || end - input < 2) {
+            throw ConversionException("Unpaired UTF-16 surrogate.");
+        }
+        const auto trail = readUnit<bigEndian>(input);
+        if (trail < 0xDC00 || trail > 0xDFFF) {
+            throw ConversionException("Unpaired UTF-16 surrogate.");
+        }
+        input += 2;
+        return 0x10000 + ((static_cast<char32_t>(unit) - 0xD800) << 10 | (static_cast<char32_t>(trail) - 0xDC00));
+    }
+}
+
+/*!
+ * \brief Encodes the specified \a codePoint using \a encoding at \a output.
+ * \returns Returns the position after the encoded character.
+ * \throws Throws ConversionException if \a codePoint can not be represented using \a encoding.
+ */
+template <TagTextEncoding encoding> char *encode(char32_t codePoint, char *output)
+{
+    if constexpr (encoding == TagTextEncoding::Latin1) {
+        if (codePoint > 0xFF) {
+            throw ConversionException("The character can not be represented in Latin-1.");
+        }
+        *output++ = static_cast<char>(codePoint);
+    } else if constexpr (encoding == TagTextEncoding::Utf8) {
+        if (codePoint < 0x80) {
+            *output++ = static_cast<char>(codePoint);
+        } else if (codePoint < 0x800) {
+            *output++ = static_cast<char>(0xC0 | codePoint >> 6);
+            *output++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else if (codePoint < 0x10000) {
+            *output++ = static_cast<char>(0xE0 | codePoint >> 12);
+            *output++ = static_cast<char>(0x80 | (codePoint >> 6 & 0x3F));
+            *output++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else {
+            *output++ = static_cast<char>(0xF0 | codePoint >> 18);
+            *output++ = static_cast<char>(0x80 | (codePoint >> 12 & 0x3F));
+            *output++ = static_cast<char>(0x80 | (codePoint >> 6 & 0x3F));
+            *output++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    } else {
+        constexpr auto bigEndian = encoding == TagTextEncoding::Utf16BigEndian;
+        if (codePoint < 0x10000) {
+            writeUnit<bigEndian>(static_cast<std::uint16_t>(codePoint), output);
+            output += 2;
+        } else {
+            codePoint -= 0x10000;
+            writeUnit<bigEndian>(static_cast<std::uint16_t>(0xD800 | codePoint >> 10), output);
+            writeUnit<bigEndian>(static_cast<std::uint16_t>(0xDC00 | (codePoint & 0x3FF)), output + 2);
+            output += 4;
+        }
+    }
+    return output;
+}
+
+/*!
+ * \brief Converts as many blocks at \a input as possible and advances \a input and \a output accordingly.
+ * \remarks Stops at the first block containing a character which needs to be converted individually.
+ */
+template <TagTextEncoding inputEncoding, TagTextEncoding outputEncoding>
+inline void convertBlocks(const char *&input, const char *end, char *&output)
+{
+    for (; static_cast<std::size_t>(end - input) >= blockSize; input += blockSize) {
+        if constexpr (!isUtf16(inputEncoding)) {
+            // convert bytes; any Latin-1 character maps to one UTF-16 code unit, otherwise only ASCII characters are trivial
+            if constexpr (inputEncoding != TagTextEncoding::Latin1 || !isUtf16(outputEncoding)) {
+                if (!isAsciiBlock(input)) {
+                    return;
+                }
+            }
+            if constexpr (isUtf16(outputEncoding)) {
+                widenBlock<outputEncoding == TagTextEncoding::Utf16BigEndian>(input, output);
+                output += blockSize * 2;
+            } else {
+                std::memcpy(output, input, blockSize);
+                output += blockSize;
+            }
+        } else if constexpr (isUtf16(outputEncoding)) {
+            // swap the byte order of UTF-16 code units
+            if (hasSurrogates<inputEncoding == TagTextEncoding::Utf16BigEndian>(input)) {
+                return;
+            }
+            swapBlock(input, output);
+            output += blockSize;
+        } else {
+            // convert UTF-16 code units to bytes
+            if (!narrowBlock<inputEncoding == TagTextEncoding::Utf16BigEndian, outputEncoding == TagTextEncoding::Latin1>(input, output)) {
+                return;
+            }
+            output += blockSize / 2;
+        }
+    }
+}
+
+/*!
+ * \brief Converts \a size bytes at \a input encoded using \a inputEncoding to \a outputEncoding at \a output.
+ * \returns Returns the number of bytes written to \a output.
+ */
+template <TagTextEncoding inputEncoding, TagTextEncoding outputEncoding>
+std::size_t transcode(const char *input, std::size_t size, char *output)
+{
+    const auto *const outputBegin = output;
+    for (const auto *const end = input + size; input != end;) {
+        convertBlocks<inputEncoding, outputEncoding>(input, end, output);
+        if (input != end) {
+            output = encode<outputEncoding>(decode<inputEncoding>(input, end), output);
+        }
+    }
+    return static_cast<std::size_t>(output - outputBegin);
+}
+
+/*!
+ * \brief Converts \a size bytes at \a input encoded using \a inputEncoding to the specified \a outputEncoding at \a output.
+ */
+template <TagTextEncoding inputEncoding>
+std::size_t transcodeFrom(TagTextEncoding outputEncoding, const char *input, std::size_t size, char *output)
+{
+    switch (outputEncoding) {
+    case TagTextEncoding::Latin1:
+        return transcode<inputEncoding, TagTextEncoding::Latin1>(input, size, output);
+    case TagTextEncoding::Utf8:
+        return transcode<inputEncoding, TagTextEncoding::Utf8>(input, size, output);
+    case TagTextEncoding::Utf16LittleEndian:
+        return transcode<inputEncoding, TagTextEncoding::Utf16LittleEndian>(input, size, output);
+    case TagTextEncoding::Utf16BigEndian:
+        return transcode<inputEncoding, TagTextEncoding::Utf16BigEndian>(input, size, output);
+    default:
+        throw ConversionException("The output encoding is not supported.");
+    }
+}
+
+} // namespace
+
+/*!
+ * \brief Returns whether \a encoding can be converted from and to.
+ */
+bool isSupported(TagTextEncoding encoding)
+{
+    switch (encoding) {
+    case TagTextEncoding::Latin1:
+    case TagTextEncoding::Utf8:
+    case TagTextEncoding::Utf16LittleEndian:
+    case TagTextEncoding::Utf16BigEndian:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*!
+ * \brief Returns the maximum number of bytes transcode() writes when converting \a size bytes.
+ */
+std::size_t maxTranscodedSize(TagTextEncoding inputEncoding, TagTextEncoding outputEncoding, std::size_t size)
+{
+    if (inputEncoding == outputEncoding) {
+        return size;
+    }
+    if (isUtf16(inputEncoding)) {
+        // a code unit takes up to 3 bytes in UTF-8 (a surrogate pair takes 4 bytes), 1 byte in Latin-1 and 2 bytes in UTF-16
+        return outputEncoding == TagTextEncoding::Utf8 ? size / 2 * 3 : (outputEncoding == TagTextEncoding::Latin1 ? size / 2 : size);
+    }
+    // a byte takes up to 2 bytes in UTF-8 (when converted from Latin-1) and 2 bytes in UTF-16; UTF-8 never grows in Latin-1
+    return outputEncoding == TagTextEncoding::Latin1 ? size : size * 2;
+}
+
+/*!
+ * \brief Converts \a size bytes at \a input encoded using \a inputEncoding to \a outputEncoding.
+ * \param output Specifies the buffer to write the converted text to. It must be at least maxTranscodedSize() bytes long.
+ * \returns Returns the number of bytes written to \a output.
+ * \throws Throws CppUtilities::ConversionException if an encoding is not supported, if \a input is invalid or if it
+ *         contains characters which can not be represented using \a outputEncoding.
+ */
+std::size_t transcode(TagTextEncoding inputEncoding, TagTextEncoding outputEncoding, const char *input, std::size_t size, char *output)
+{
+    if (inputEncoding == outputEncoding && isSupported(inputEncoding)) {
+        std::memcpy(output, input, size);
+        return size;
+    }
+    switch (inputEncoding) {
+    case TagTextEncoding::Latin1:
+        return transcodeFrom<TagTextEncoding::Latin1>(outputEncoding, input, size, output);
+    case TagTextEncoding::Utf8:
+        return transcodeFrom<TagTextEncoding::Utf8>(outputEncoding, input, size, output);
+    case TagTextEncoding::Utf16LittleEndian:
+        return transcodeFrom<TagTextEncoding::Utf16LittleEndian>(outputEncoding, input, size, output);
+    case TagTextEncoding::Utf16BigEndian:
+        return transcodeFrom<TagTextEncoding::Utf16BigEndian>(outputEncoding, input, size, output);
+    default:
+        throw ConversionException("The input encoding is not supported.");
+    }
+}
+
+/*!
+ * \brief Converts \a size bytes at \a input encoded using \a inputEncoding to \a outputEncoding.
+ * \returns Returns a buffer of maxTranscodedSize() bytes and the number of bytes which have actually been written to it.
+ * \throws Throws CppUtilities::ConversionException in the same cases as the overload writing to a specified buffer.
+ */
+std::pair<std::unique_ptr<char[]>, std::size_t> transcode(
+    TagTextEncoding inputEncoding, TagTextEncoding outputEncoding, const char *input, std::size_t size)
+{
+    auto buffer = std::unique_ptr<char[]>(new char[max<std::size_t>(maxTranscodedSize(inputEncoding, outputEncoding, size), 1)]);
+    const auto transcodedSize = transcode(inputEncoding, outputEncoding, input, size, buffer.get());
+    return make_pair(std::move(buffer), transcodedSize);
+}
+
+} // namespace TextCodec
+/// \endcond
+
+} // namespace TagParser
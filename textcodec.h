@@ -0,0 +1,43 @@
+#ifndef TAG_PARSER_TEXTCODEC_H
+#define TAG_PARSER_TEXTCODEC_H
+
+#include "./global.h"
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace TagParser {
+
+enum class TagTextEncoding : unsigned int;
+
+/// \cond
+
+/*!
+ * \brief The TextCodec namespace contains the transcoder used to convert text between the encodings used by the tag
+ *        formats (Latin-1, UTF-8, UTF-16LE and UTF-16BE).
+ *
+ * The functions produce the same results as the corresponding functions of c++utilities (which use iconv) but don't
+ * allocate intermediate buffers. Runs of ASCII characters (and any Latin-1 characters when converting from Latin-1 to
+ * UTF-16 or vice versa) are converted 16 bytes at a time via SSE2 or NEON (aarch64) if available; other characters
+ * are converted one after another.
+ *
+ * Invalid input (e.g. malformed UTF-8 sequences, unpaired surrogates or a truncated UTF-16 code unit) and characters
+ * which can not be represented in the output encoding lead to a CppUtilities::ConversionException.
+ */
+namespace TextCodec {
+
+TAG_PARSER_EXPORT bool isSupported(TagTextEncoding encoding);
+TAG_PARSER_EXPORT std::size_t maxTranscodedSize(TagTextEncoding inputEncoding, TagTextEncoding outputEncoding, std::size_t size);
+TAG_PARSER_EXPORT std::size_t transcode(
+    TagTextEncoding inputEncoding, TagTextEncoding outputEncoding, const char *input, std::size_t size, char *output);
+TAG_PARSER_EXPORT std::pair<std::unique_ptr<char[]>, std::size_t> transcode(
+    TagTextEncoding inputEncoding, TagTextEncoding outputEncoding, const char *input, std::size_t size);
+
+} // namespace TextCodec
+
+/// \endcond
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_TEXTCODEC_H
@@ -0,0 +1,78 @@
+#ifndef TAG_PARSER_TRACEPOINTS_H
+#define TAG_PARSER_TRACEPOINTS_H
+
+/*!
+ * \file tracepoints.h
+ * \brief Defines macros for static tracepoints (USDT probes) within the phases of parsing and applying changes.
+ *
+ * The probes are only compiled in when configuring with `-DENABLE_USDT=ON` (which requires `sys/sdt.h` from SystemTap).
+ * An inactive probe boils down to a single `nop` instruction so the probes can be left in production builds. They are
+ * provided by "tagparser" and come in pairs of "<name>_begin" and "<name>_end"; the end probe also fires if the phase
+ * is aborted by an exception. The following probes are defined:
+ *
+ * - parse_container_format, parse_tracks, parse_tags, parse_chapters, parse_attachments and apply_changes (fired by
+ *   MediaFileInfo) with the arguments path (`const char *`), file size, container format (ContainerFormat as int),
+ *   number of parsed elements and number of tracks
+ * - container_parse_header and container_make_file (fired by AbstractContainer around internalParseHeader() and
+ *   internalMakeFile() of all containers) with the arguments start offset, number of parsed elements, number of
+ *   tracks and number of tags
+ * - create_backup_file and restore_backup_file with the arguments original path and backup path (both `const char *`)
+ *
+ * The element counts of end probes are the ones at the end of the phase. For instance, the time spent on parsing tags
+ * can be profiled via:
+ * ```
+ * bpftrace -e 'usdt:/usr/lib/libtagparser.so:tagparser:parse_tags_begin { @start[tid] = nsecs; }
+ *              usdt:/usr/lib/libtagparser.so:tagparser:parse_tags_end /@start[tid]/ {
+ *                  @ms = hist((nsecs - @start[tid]) / 1000000); @elements = hist(arg3); delete(@start[tid]); }'
+ * ```
+ */
+
+#ifdef TAG_PARSER_USE_USDT
+
+#include <sys/sdt.h>
+
+#include <utility>
+
+namespace TagParser {
+
+/// \cond
+template <typename Function> class TracepointScope {
+public:
+    explicit TracepointScope(Function &&atExit)
+        : m_atExit(std::move(atExit))
+    {
+    }
+    TracepointScope(const TracepointScope &) = delete;
+    ~TracepointScope()
+    {
+        m_atExit();
+    }
+
+private:
+    Function m_atExit;
+};
+/// \endcond
+
+} // namespace TagParser
+
+/*!
+ * \brief Fires the probe with the specified \a name passing the specified arguments.
+ */
+#define TAG_PARSER_TRACEPOINT(name, ...) STAP_PROBEV(tagparser, name, __VA_ARGS__)
+
+/*!
+ * \brief Fires the probe "<name>_begin" and the probe "<name>_end" when leaving the current scope.
+ * \remarks The arguments are evaluated again for the end probe.
+ */
+#define TAG_PARSER_TRACEPOINT_SCOPE(name, ...)                                                                                                       \
+    TAG_PARSER_TRACEPOINT(name##_begin, __VA_ARGS__);                                                                                                \
+    const auto name##TracepointScope = ::TagParser::TracepointScope([&] { TAG_PARSER_TRACEPOINT(name##_end, __VA_ARGS__); })
+
+#else
+
+#define TAG_PARSER_TRACEPOINT(name, ...)
+#define TAG_PARSER_TRACEPOINT_SCOPE(name, ...)
+
+#endif
+
+#endif // TAG_PARSER_TRACEPOINTS_H
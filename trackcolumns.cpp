@@ -0,0 +1,178 @@
+#include "./trackcolumns.h"
+#include "./abstracttrack.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+/// \cond
+namespace {
+
+/*!
+ * \brief Appends all elements of \a other to \a column.
+ */
+template <typename ValueType> inline void appendColumn(std::vector<ValueType> &column, const std::vector<ValueType> &other)
+{
+    column.insert(column.end(), other.cbegin(), other.cend());
+}
+
+} // namespace
+/// \endcond
+
+/*!
+ * \brief Appends the specified \a value as new row.
+ */
+void TrackStringColumn::append(std::string_view value)
+{
+    data.insert(data.end(), value.begin(), value.end());
+    offsets.push_back(static_cast<std::int64_t>(data.size()));
+}
+
+/*!
+ * \brief Appends all rows of \a other.
+ */
+void TrackStringColumn::append(const TrackStringColumn &other)
+{
+    const auto base = static_cast<std::int64_t>(data.size());
+    data.insert(data.end(), other.data.cbegin(), other.data.cend());
+    offsets.reserve(offsets.size() + other.rowCount());
+    for (auto i = other.offsets.cbegin() + 1, end = other.offsets.cend(); i != end; ++i) {
+        offsets.push_back(base + *i);
+    }
+}
+
+/*!
+ * \brief Removes all rows but keeps the allocated buffers.
+ */
+void TrackStringColumn::clear()
+{
+    offsets.resize(1);
+    data.clear();
+}
+
+/*!
+ * \brief Appends the properties of the specified \a track as new row.
+ * \param fileIndex Specifies the value for the fileIndex column, e.g. the index of the file within a batch.
+ * \remarks The members of \a track are read directly so no strings are copied into temporary objects.
+ */
+void TrackColumns::append(const AbstractTrack &track, std::uint32_t fileIndex)
+{
+    this->fileIndex.push_back(fileIndex);
+    id.push_back(track.m_id);
+    trackNumber.push_back(track.m_trackNumber);
+    trackType.push_back(static_cast<std::uint8_t>(track.type()));
+    mediaType.push_back(static_cast<std::uint8_t>(track.m_mediaType));
+    generalFormat.push_back(static_cast<std::uint16_t>(track.m_format.general));
+    subFormat.push_back(track.m_format.sub);
+    formatExtension.push_back(track.m_format.extension);
+    flags.push_back(static_cast<std::uint64_t>(track.m_flags));
+    size.push_back(track.m_size);
+    sampleCount.push_back(track.m_sampleCount);
+    durationTicks.push_back(track.m_duration.totalTicks());
+    bitrate.push_back(track.m_bitrate);
+    maxBitrate.push_back(track.m_maxBitrate);
+    samplingFrequency.push_back(track.m_samplingFrequency);
+    channelCount.push_back(track.m_channelCount);
+    bitsPerSample.push_back(track.m_bitsPerSample);
+    pixelWidth.push_back(track.m_pixelSize.width());
+    pixelHeight.push_back(track.m_pixelSize.height());
+    fps.push_back(track.m_fps);
+    formatId.append(track.m_formatId);
+    language.append(track.m_locale.abbreviatedName(LocaleFormat::BCP_47, LocaleFormat::ISO_639_2_B, LocaleFormat::Unknown));
+    name.append(track.m_name);
+}
+
+/*!
+ * \brief Appends all rows of \a other, e.g. to merge the columns gathered by several threads.
+ */
+void TrackColumns::append(const TrackColumns &other)
+{
+    appendColumn(fileIndex, other.fileIndex);
+    appendColumn(id, other.id);
+    appendColumn(trackNumber, other.trackNumber);
+    appendColumn(trackType, other.trackType);
+    appendColumn(mediaType, other.mediaType);
+    appendColumn(generalFormat, other.generalFormat);
+    appendColumn(subFormat, other.subFormat);
+    appendColumn(formatExtension, other.formatExtension);
+    appendColumn(flags, other.flags);
+    appendColumn(size, other.size);
+    appendColumn(sampleCount, other.sampleCount);
+    appendColumn(durationTicks, other.durationTicks);
+    appendColumn(bitrate, other.bitrate);
+    appendColumn(maxBitrate, other.maxBitrate);
+    appendColumn(samplingFrequency, other.samplingFrequency);
+    appendColumn(channelCount, other.channelCount);
+    appendColumn(bitsPerSample, other.bitsPerSample);
+    appendColumn(pixelWidth, other.pixelWidth);
+    appendColumn(pixelHeight, other.pixelHeight);
+    appendColumn(fps, other.fps);
+    formatId.append(other.formatId);
+    language.append(other.language);
+    name.append(other.name);
+}
+
+/*!
+ * \brief Reserves space for the specified number of rows within the fixed-width columns.
+ */
+void TrackColumns::reserve(std::size_t rowCount)
+{
+    fileIndex.reserve(rowCount);
+    id.reserve(rowCount);
+    trackNumber.reserve(rowCount);
+    trackType.reserve(rowCount);
+    mediaType.reserve(rowCount);
+    generalFormat.reserve(rowCount);
+    subFormat.reserve(rowCount);
+    formatExtension.reserve(rowCount);
+    flags.reserve(rowCount);
+    size.reserve(rowCount);
+    sampleCount.reserve(rowCount);
+    durationTicks.reserve(rowCount);
+    bitrate.reserve(rowCount);
+    maxBitrate.reserve(rowCount);
+    samplingFrequency.reserve(rowCount);
+    channelCount.reserve(rowCount);
+    bitsPerSample.reserve(rowCount);
+    pixelWidth.reserve(rowCount);
+    pixelHeight.reserve(rowCount);
+    fps.reserve(rowCount);
+    formatId.offsets.reserve(rowCount + 1);
+    language.offsets.reserve(rowCount + 1);
+    name.offsets.reserve(rowCount + 1);
+}
+
+/*!
+ * \brief Removes all rows but keeps the allocated buffers so the object can be reused for the next batch.
+ */
+void TrackColumns::clear()
+{
+    fileIndex.clear();
+    id.clear();
+    trackNumber.clear();
+    trackType.clear();
+    mediaType.clear();
+    generalFormat.clear();
+    subFormat.clear();
+    formatExtension.clear();
+    flags.clear();
+    size.clear();
+    sampleCount.clear();
+    durationTicks.clear();
+    bitrate.clear();
+    maxBitrate.clear();
+    samplingFrequency.clear();
+    channelCount.clear();
+    bitsPerSample.clear();
+    pixelWidth.clear();
+    pixelHeight.clear();
+    fps.clear();
+    formatId.clear();
+    language.clear();
+    name.clear();
+}
+
+} // namespace TagParser
@@ -0,0 +1,138 @@
+#ifndef TAG_PARSER_TRACKCOLUMNS_H
+#define TAG_PARSER_TRACKCOLUMNS_H
+
+#include "./global.h"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace TagParser {
+
+class AbstractTrack;
+
+/*!
+ * \brief The TrackStringColumn struct holds variable-length strings in the layout of an Arrow "large_utf8" array.
+ *
+ * The string at row \a i consists of the bytes [offsets[i], offsets[i + 1]) of data. Hence \a offsets always contains
+ * one element more than the column has rows and its first element is zero.
+ */
+struct TAG_PARSER_EXPORT TrackStringColumn {
+    TrackStringColumn();
+
+    std::size_t rowCount() const;
+    std::string_view operator[](std::size_t row) const;
+    void append(std::string_view value);
+    void append(const TrackStringColumn &other);
+    void clear();
+
+    /// \brief The start offsets of the strings within data followed by the end offset of the last string.
+    std::vector<std::int64_t> offsets;
+    /// \brief The concatenated UTF-8 encoded strings (not null-terminated).
+    std::vector<char> data;
+};
+
+/*!
+ * \brief Constructs an empty column.
+ */
+inline TrackStringColumn::TrackStringColumn()
+    : offsets{ 0 }
+{
+}
+
+/*!
+ * \brief Returns the number of strings within the column.
+ */
+inline std::size_t TrackStringColumn::rowCount() const
+{
+    return offsets.size() - 1;
+}
+
+/*!
+ * \brief Returns the string at the specified \a row.
+ */
+inline std::string_view TrackStringColumn::operator[](std::size_t row) const
+{
+    return std::string_view(data.data() + offsets[row], static_cast<std::size_t>(offsets[row + 1] - offsets[row]));
+}
+
+/*!
+ * \brief The TrackColumns struct holds the properties of many tracks as columns.
+ *
+ * Each track is stored as one row; the value of a property for the track at row \a i is the element \a i of the
+ * corresponding column. The fixed-width columns are plain contiguous arrays so they can be handed over as Arrow value
+ * buffers (or copied via a single memcpy) and string columns use the layout of Arrow "large_utf8" arrays. All columns are
+ * non-nullable; properties which are not known are stored as zero or an empty string, as returned by the getters of
+ * AbstractTrack.
+ *
+ * The buffers are provided by the caller who might reuse the same object for several batches: clear() keeps the
+ * allocated capacity.
+ *
+ * \sa MediaFileInfo::exportTrackColumns() and BatchParser::scanTrackColumns()
+ */
+struct TAG_PARSER_EXPORT TrackColumns {
+    std::size_t rowCount() const;
+    void append(const AbstractTrack &track, std::uint32_t fileIndex);
+    void append(const TrackColumns &other);
+    void reserve(std::size_t rowCount);
+    void clear();
+
+    /// \brief The index of the file the track belongs to (as passed to append()).
+    std::vector<std::uint32_t> fileIndex;
+    /// \brief The ID of the track (see AbstractTrack::id()).
+    std::vector<std::uint64_t> id;
+    /// \brief The number of the track (see AbstractTrack::trackNumber()).
+    std::vector<std::uint32_t> trackNumber;
+    /// \brief The TrackType of the track.
+    std::vector<std::uint8_t> trackType;
+    /// \brief The MediaType of the track.
+    std::vector<std::uint8_t> mediaType;
+    /// \brief The GeneralMediaFormat of the track.
+    std::vector<std::uint16_t> generalFormat;
+    /// \brief The sub format of the track (see MediaFormat::sub).
+    std::vector<std::uint8_t> subFormat;
+    /// \brief The format extension of the track (see MediaFormat::extension).
+    std::vector<std::uint8_t> formatExtension;
+    /// \brief The TrackFlags of the track.
+    std::vector<std::uint64_t> flags;
+    /// \brief The size of the track in byte.
+    std::vector<std::uint64_t> size;
+    /// \brief The number of samples/frames of the track.
+    std::vector<std::uint64_t> sampleCount;
+    /// \brief The duration of the track in ticks (see CppUtilities::TimeSpan::totalTicks()).
+    std::vector<std::int64_t> durationTicks;
+    /// \brief The average bitrate of the track in kbit/s.
+    std::vector<double> bitrate;
+    /// \brief The maximum bitrate of the track in kbit/s.
+    std::vector<double> maxBitrate;
+    /// \brief The sampling frequency of the track in Hz.
+    std::vector<std::uint32_t> samplingFrequency;
+    /// \brief The number of channels of the track.
+    std::vector<std::uint16_t> channelCount;
+    /// \brief The number of bits per sample of the track.
+    std::vector<std::uint16_t> bitsPerSample;
+    /// \brief The width of the pictures of the track in pixel.
+    std::vector<std::uint32_t> pixelWidth;
+    /// \brief The height of the pictures of the track in pixel.
+    std::vector<std::uint32_t> pixelHeight;
+    /// \brief The number of frames per second of the track.
+    std::vector<std::uint32_t> fps;
+    /// \brief The format ID of the track (e.g. the Matroska codec ID or the MP4 sample entry ID).
+    TrackStringColumn formatId;
+    /// \brief The language of the track as BCP-47 tag or ISO-639-2 code, whichever is present.
+    TrackStringColumn language;
+    /// \brief The name of the track.
+    TrackStringColumn name;
+};
+
+/*!
+ * \brief Returns the number of tracks stored within the columns.
+ */
+inline std::size_t TrackColumns::rowCount() const
+{
+    return fileIndex.size();
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_TRACKCOLUMNS_H
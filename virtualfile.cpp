@@ -0,0 +1,88 @@
+#include "./virtualfile.h"
+
+#include <c++utilities/io/copy.h>
+
+#include <istream>
+#include <ostream>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+/*!
+ * \class TagParser::VirtualFile
+ * \brief The VirtualFile struct describes a modified version of a file without writing it.
+ *
+ * It consists of segments which are either held in memory (e.g. the new tags) or refer to ranges of the original file
+ * (e.g. the media data). Concatenating the segments yields the file applyChanges() would write (except for the padding
+ * which is omitted). So a server can inject tags on download by sending the segments one after another, e.g. using
+ * sendfile() or splice() for the ranges of the original file, without copying the media data or writing anything to
+ * disk.
+ *
+ * \sa MediaFileInfo::makeVirtualFile()
+ */
+
+/*!
+ * \brief Appends the specified \a data; it is merged into the last segment if that one is held in memory as well.
+ */
+void VirtualFile::appendData(std::string &&data)
+{
+    if (data.empty()) {
+        return;
+    }
+    if (!segments.empty() && !segments.back().isFileRange()) {
+        segments.back().data.append(data);
+        return;
+    }
+    segments.emplace_back().data = move(data);
+}
+
+/*!
+ * \brief Appends the range of the original file at the specified \a offset; it is merged into the last segment if that
+ *        one refers to the directly preceding range.
+ */
+void VirtualFile::appendFileRange(std::uint64_t offset, std::uint64_t size)
+{
+    if (!size) {
+        return;
+    }
+    if (!segments.empty() && segments.back().isFileRange() && segments.back().fileOffset + segments.back().fileRangeSize == offset) {
+        segments.back().fileRangeSize += size;
+        return;
+    }
+    auto &segment = segments.emplace_back();
+    segment.fileOffset = offset;
+    segment.fileRangeSize = size;
+}
+
+/*!
+ * \brief Returns the size of the virtual file.
+ */
+std::uint64_t VirtualFile::size() const
+{
+    auto size = std::uint64_t();
+    for (const auto &segment : segments) {
+        size += segment.size();
+    }
+    return size;
+}
+
+/*!
+ * \brief Writes the virtual file to the specified \a target stream reading the ranges from the \a originalFile.
+ * \remarks This is meant for callers which can not make use of the segments directly.
+ */
+void VirtualFile::write(std::istream &originalFile, std::ostream &target) const
+{
+    CopyHelper<0x10000> copyHelper;
+    for (const auto &segment : segments) {
+        if (!segment.isFileRange()) {
+            target.write(segment.data.data(), static_cast<streamsize>(segment.data.size()));
+            continue;
+        }
+        originalFile.seekg(static_cast<streamoff>(segment.fileOffset));
+        copyHelper.copy(originalFile, target, segment.fileRangeSize);
+    }
+}
+
+} // namespace TagParser
@@ -0,0 +1,59 @@
+#ifndef TAG_PARSER_VIRTUALFILE_H
+#define TAG_PARSER_VIRTUALFILE_H
+
+#include "./global.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace TagParser {
+
+/*!
+ * \brief The VirtualFileSegment struct describes a part of a VirtualFile.
+ *
+ * A segment either holds bytes in memory (e.g. the new tags) or refers to a range of the original file (e.g. the media
+ * data).
+ */
+struct TAG_PARSER_EXPORT VirtualFileSegment {
+    bool isFileRange() const;
+    std::uint64_t size() const;
+
+    /// \brief The bytes of the segment; empty if the segment refers to a range of the original file.
+    std::string data;
+    /// \brief The offset of the range within the original file (only relevant if data is empty).
+    std::uint64_t fileOffset = 0;
+    /// \brief The size of the range within the original file (only relevant if data is empty).
+    std::uint64_t fileRangeSize = 0;
+};
+
+/*!
+ * \brief Returns whether the segment refers to a range of the original file.
+ */
+inline bool VirtualFileSegment::isFileRange() const
+{
+    return data.empty();
+}
+
+/*!
+ * \brief Returns the number of bytes the segment contributes to the virtual file.
+ */
+inline std::uint64_t VirtualFileSegment::size() const
+{
+    return isFileRange() ? fileRangeSize : data.size();
+}
+
+struct TAG_PARSER_EXPORT VirtualFile {
+    void appendData(std::string &&data);
+    void appendFileRange(std::uint64_t offset, std::uint64_t size);
+    std::uint64_t size() const;
+    void write(std::istream &originalFile, std::ostream &target) const;
+
+    /// \brief The segments making up the file in order.
+    std::vector<VirtualFileSegment> segments;
+};
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_VIRTUALFILE_H
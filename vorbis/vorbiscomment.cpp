@@ -5,12 +5,17 @@
 
 #include "../diagnostics.h"
 #include "../exceptions.h"
+#include "../perfecthashmap.h"
+#include "../tagfieldfilter.h"
+#include "../tagtemplate.h"
 
 #include <c++utilities/io/binaryreader.h>
 #include <c++utilities/io/binarywriter.h>
 #include <c++utilities/io/copy.h>
 
-#include <map>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
 #include <memory>
 
 using namespace std;
@@ -18,6 +23,37 @@ using namespace CppUtilities;
 
 namespace TagParser {
 
+namespace {
+
+/// \brief The field IDs and the known fields they are mapped to; the IDs are case-insensitive.
+constexpr std::pair<std::string_view, KnownField> fieldIdsAndKnownFields[] = {
+    { VorbisCommentIds::album(), KnownField::Album },
+    { VorbisCommentIds::artist(), KnownField::Artist },
+    { VorbisCommentIds::comment(), KnownField::Comment },
+    { VorbisCommentIds::cover(), KnownField::Cover },
+    { VorbisCommentIds::date(), KnownField::RecordDate },
+    { VorbisCommentIds::year(), KnownField::RecordDate },
+    { VorbisCommentIds::title(), KnownField::Title },
+    { VorbisCommentIds::genre(), KnownField::Genre },
+    { VorbisCommentIds::trackNumber(), KnownField::TrackPosition },
+    { VorbisCommentIds::diskNumber(), KnownField::DiskPosition },
+    { VorbisCommentIds::partNumber(), KnownField::PartNumber },
+    { VorbisCommentIds::composer(), KnownField::Composer },
+    { VorbisCommentIds::encoder(), KnownField::Encoder },
+    { VorbisCommentIds::encoderSettings(), KnownField::EncoderSettings },
+    { VorbisCommentIds::description(), KnownField::Description },
+    { VorbisCommentIds::grouping(), KnownField::Grouping },
+    { VorbisCommentIds::label(), KnownField::RecordLabel },
+    { VorbisCommentIds::performer(), KnownField::Performers },
+    { VorbisCommentIds::lyricist(), KnownField::Lyricist },
+    { VorbisCommentIds::lyrics(), KnownField::Lyrics },
+    { VorbisCommentIds::albumArtist(), KnownField::AlbumArtist },
+};
+constexpr auto knownFieldsByFieldId = makePerfectHashMap<CaseInsensitivePerfectHashTraits>(fieldIdsAndKnownFields, KnownField::Invalid);
+static_assert(knownFieldsByFieldId.isPerfect(), "field IDs must be unique");
+
+} // namespace
+
 /*!
  * \class TagParser::VorbisComment
  * \brief Implementation of TagParser::Tag for Vorbis comments.
@@ -33,6 +69,20 @@ const TagValue &VorbisComment::value(KnownField field) const
     }
 }
 
+/*!
+ * \brief Assigns the vendor via setVendor() and uses the default implementation for other fields.
+ */
+bool VorbisComment::internallyAssignValue(KnownField field, TagValue &&value)
+{
+    switch (field) {
+    case KnownField::Vendor:
+        setVendor(value);
+        return true;
+    default:
+        return CRTPBase::internallyAssignValue(field, std::move(value));
+    }
+}
+
 bool VorbisComment::setValue(KnownField field, const TagValue &value)
 {
     switch (field) {
@@ -98,44 +148,68 @@ VorbisComment::IdentifierType VorbisComment::internallyGetFieldId(KnownField fie
 
 KnownField VorbisComment::internallyGetKnownField(const IdentifierType &id) const
 {
-    using namespace VorbisCommentIds;
-    // clang-format off
-    static const map<string, KnownField, CaseInsensitiveStringComparer> fieldMap({
-         { album(), KnownField::Album },
-         { artist(), KnownField::Artist },
-         { comment(), KnownField::Comment },
-         { cover(), KnownField::Cover },
-         { date(), KnownField::RecordDate },
-         { year(), KnownField::RecordDate },
-         { title(), KnownField::Title },
-         { genre(), KnownField::Genre },
-         { trackNumber(), KnownField::TrackPosition },
-         { diskNumber(), KnownField::DiskPosition },
-         { partNumber(), KnownField::PartNumber },
-         { composer(), KnownField::Composer },
-         { encoder(), KnownField::Encoder },
-         { encoderSettings(), KnownField::EncoderSettings },
-         { description(), KnownField::Description },
-         { grouping(), KnownField::Grouping },
-         { label(), KnownField::RecordLabel },
-         { performer(), KnownField::Performers },
-         { lyricist(), KnownField::Lyricist },
-         { lyrics(), KnownField::Lyrics },
-         { albumArtist(), KnownField::AlbumArtist },
-    });
-    // clang-format on
-    const auto knownField(fieldMap.find(id));
-    return knownField != fieldMap.cend() ? knownField->second : KnownField::Invalid;
+    return knownFieldsByFieldId.find(id);
+}
+
+/// \cond
+namespace {
+
+/*!
+ * \brief Resolves known fields of the specified \a filter to field IDs (stored in \a idFilter) so fields can be skipped by their ID.
+ * \returns Returns the filter to be used when parsing fields or nullptr if all fields are included.
+ */
+const TagFieldFilter *resolveIdFilter(const TagFieldFilter *filter, TagFieldFilter &idFilter)
+{
+    if (!filter || filter->isEmpty()) {
+        return nullptr;
+    }
+    idFilter = *filter;
+    for (const auto &[id, field] : fieldIdsAndKnownFields) {
+        if (filter->includes(field)) {
+            idFilter.addName(id);
+        }
+    }
+    return &idFilter;
+}
+
+} // namespace
+/// \endcond
+
+/*!
+ * \brief Turns "YEAR" into "DATE" (unless "DATE" exists).
+ * \remarks "DATE" is an official field and "YEAR" only an inofficial one but present in some files. In consistency with
+ *          MediaInfo and VLC player it is treated like "DATE" here.
+ */
+void VorbisComment::treatYearAsDate()
+{
+    if (fields().find(VorbisCommentIds::date()) != fields().end()) {
+        return;
+    }
+    auto [first, end] = fields().equal_range(VorbisCommentIds::year());
+    auto yearFields = std::vector<VorbisCommentField>();
+    yearFields.reserve(static_cast<std::size_t>(std::distance(first, end)));
+    for (; first != end; ++first) {
+        yearFields.emplace_back(std::move(first->second));
+    }
+    fields().erase(VorbisCommentIds::year());
+    for (auto &field : yearFields) {
+        fields().insert(std::pair(VorbisCommentIds::date(), std::move(field)));
+    }
 }
 
 /*!
  * \brief Internal implementation for parsing.
  */
-template <class StreamType> void VorbisComment::internalParse(StreamType &stream, std::uint64_t maxSize, VorbisCommentFlags flags, Diagnostics &diag)
+template <class StreamType>
+void VorbisComment::internalParse(StreamType &stream, std::uint64_t maxSize, VorbisCommentFlags flags, Diagnostics &diag, const TagFieldFilter *filter)
 {
     // prepare parsing
     static const string context("parsing Vorbis comment");
     std::uint64_t startOffset = static_cast<std::uint64_t>(stream.tellg());
+
+    // resolve known fields of the filter to field IDs so fields can be skipped by their ID
+    auto idFilter = TagFieldFilter();
+    filter = resolveIdFilter(filter, idFilter);
     try {
         // read signature: 0x3 + "vorbis"
         char sig[8];
@@ -170,8 +244,10 @@ template <class StreamType> void VorbisComment::internalParse(StreamType &stream
                 // read fields
                 VorbisCommentField field;
                 try {
-                    field.parse(stream, maxSize, diag);
-                    fields().emplace(field.id(), move(field));
+                    field.parse(stream, maxSize, diag, flags, filter);
+                    if (!filter || filter->includes(KnownField::Invalid, field.id())) {
+                        fields().emplace(field.id(), move(field));
+                    }
                 } catch (const TruncatedDataException &) {
                     throw;
                 } catch (const Failure &) {
@@ -182,16 +258,7 @@ template <class StreamType> void VorbisComment::internalParse(StreamType &stream
                 stream.ignore(); // skip framing byte
             }
             m_size = static_cast<std::uint32_t>(static_cast<std::uint64_t>(stream.tellg()) - startOffset);
-            // turn "YEAR" into "DATE" (unless "DATE" exists)
-            // note: "DATE" is an official field and "YEAR" only an inofficial one but present in some files. In consistency with
-            //       MediaInfo and VLC player it is treated like "DATE" here.
-            if (fields().find(VorbisCommentIds::date()) == fields().end()) {
-                const auto [first, end] = fields().equal_range(VorbisCommentIds::year());
-                for (auto i = first; i != end; ++i) {
-                    fields().insert(std::pair(VorbisCommentIds::date(), std::move(i->second)));
-                }
-                fields().erase(first, end);
-            }
+            treatYearAsDate();
         } else {
             diag.emplace_back(DiagLevel::Critical, "Signature is invalid.", context);
             throw InvalidDataException();
@@ -206,25 +273,104 @@ template <class StreamType> void VorbisComment::internalParse(StreamType &stream
 /*!
  * \brief Parses tag information using the specified OGG \a iterator.
  *
+ * The remaining data of the current packet is read at once and the fields are parsed from that buffer (see
+ * OggIterator::readPacket()). If \a filter is specified fields it does not include are skipped.
+ *
  * \throws Throws std::ios_base::failure when an IO error occurs.
  * \throws Throws TagParser::Failure or a derived exception when a parsing
  *         error occurs.
  */
-void VorbisComment::parse(OggIterator &iterator, VorbisCommentFlags flags, Diagnostics &diag)
+void VorbisComment::parse(OggIterator &iterator, VorbisCommentFlags flags, Diagnostics &diag, const TagFieldFilter *filter)
 {
-    internalParse(iterator, iterator.streamSize(), flags, diag);
+    // read the whole packet at once to parse the fields from one contiguous buffer
+    auto [packet, packetSize] = iterator.readPacket();
+    const auto *const data = packet.get();
+    parse(data, packetSize, flags, diag, filter, std::shared_ptr<const void>(packet.release(), std::default_delete<char[]>()));
 }
 
 /*!
- * \brief Parses tag information using the specified OGG \a iterator.
+ * \brief Parses tag information from the specified \a stream.
+ *
+ * If \a filter is specified fields it does not include are skipped without reading their data.
  *
  * \throws Throws std::ios_base::failure when an IO error occurs.
  * \throws Throws TagParser::Failure or a derived exception when a parsing
  *         error occurs.
  */
-void VorbisComment::parse(istream &stream, std::uint64_t maxSize, VorbisCommentFlags flags, Diagnostics &diag)
+void VorbisComment::parse(istream &stream, std::uint64_t maxSize, VorbisCommentFlags flags, Diagnostics &diag, const TagFieldFilter *filter)
+{
+    internalParse(stream, maxSize, flags, diag, filter);
+}
+
+/*!
+ * \brief Parses tag information from the specified \a buffer of \a size bytes.
+ *
+ * If \a filter is specified fields it does not include are skipped. If \a flags contain VorbisCommentFlags::ShareValueData
+ * and \a sharedBuffer is specified, values refer to \a sharedBuffer (which \a buffer must be part of) instead of owning
+ * a copy.
+ *
+ * \throws Throws TagParser::Failure or a derived exception when a parsing
+ *         error occurs.
+ */
+void VorbisComment::parse(const char *buffer, std::size_t size, VorbisCommentFlags flags, Diagnostics &diag, const TagFieldFilter *filter,
+    const std::shared_ptr<const void> &sharedBuffer)
 {
-    internalParse(stream, maxSize, flags, diag);
+    // prepare parsing
+    static const string context("parsing Vorbis comment");
+    auto idFilter = TagFieldFilter();
+    filter = resolveIdFilter(filter, idFilter);
+    std::uint64_t maxSize = size;
+    const char *i = buffer;
+    try {
+        // check signature: 0x3 + "vorbis"
+        if (!(flags & VorbisCommentFlags::NoSignature)) {
+            CHECK_MAX_SIZE(7)
+            if (memcmp(i, "\x03vorbis", 7)) {
+                diag.emplace_back(DiagLevel::Critical, "Signature is invalid.", context);
+                throw InvalidDataException();
+            }
+            i += 7;
+        }
+        // read vendor (length prefixed string)
+        CHECK_MAX_SIZE(4)
+        const auto vendorSize = LE::toUInt32(i);
+        i += 4;
+        if (vendorSize > maxSize) {
+            diag.emplace_back(DiagLevel::Critical, "Vendor information is truncated.", context);
+            throw TruncatedDataException();
+        }
+        m_vendor.assignData(i, vendorSize, TagDataType::Text, TagTextEncoding::Utf8);
+        i += vendorSize;
+        maxSize -= vendorSize;
+        // read fields
+        CHECK_MAX_SIZE(4)
+        const auto fieldCount = LE::toUInt32(i);
+        i += 4;
+        for (std::uint32_t index = 0; index < fieldCount; ++index) {
+            VorbisCommentField field;
+            const auto remainingSize = maxSize;
+            try {
+                field.parse(i, maxSize, diag, flags, filter, sharedBuffer);
+                if (!filter || filter->includes(KnownField::Invalid, field.id())) {
+                    fields().emplace(field.id(), move(field));
+                }
+            } catch (const TruncatedDataException &) {
+                throw;
+            } catch (const Failure &) {
+                // nothing to do here since notifications will be added anyways
+            }
+            i += remainingSize - maxSize;
+        }
+        if (!(flags & VorbisCommentFlags::NoFramingByte) && maxSize) {
+            ++i; // skip framing byte
+        }
+        m_size = static_cast<std::uint32_t>(i - buffer);
+        treatYearAsDate();
+    } catch (const TruncatedDataException &) {
+        m_size = static_cast<std::uint32_t>(i - buffer);
+        diag.emplace_back(DiagLevel::Critical, "Vorbis comment is truncated.", context);
+        throw;
+    }
 }
 
 /*!
@@ -235,6 +381,22 @@ void VorbisComment::parse(istream &stream, std::uint64_t maxSize, VorbisCommentF
  *                error occurs.
  */
 void VorbisComment::make(std::ostream &stream, VorbisCommentFlags flags, Diagnostics &diag)
+{
+    auto buffer = string();
+    make(buffer, flags, diag);
+    stream.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+}
+
+/*!
+ * \brief Appends tag information to the specified \a buffer.
+ *
+ * The buffer is grown at once according to the sizes of the assigned values so fields are usually appended without
+ * reallocating the buffer.
+ *
+ * \throws Throws TagParser::Failure or a derived exception when a making
+ *                error occurs.
+ */
+void VorbisComment::make(std::string &buffer, VorbisCommentFlags flags, Diagnostics &diag)
 {
     // prepare making
     static const string context("making Vorbis comment");
@@ -244,39 +406,65 @@ void VorbisComment::make(std::ostream &stream, VorbisCommentFlags flags, Diagnos
     } catch (const ConversionException &) {
         diag.emplace_back(DiagLevel::Warning, "Can not convert the assigned vendor to string.", context);
     }
-    BinaryWriter writer(&stream);
+    // take the pre-made fields of the template; fields of the tag which are also present in the template are skipped
+    const auto *const templateFields = tagTemplate() ? &tagTemplate()->serializedFields(TagType::VorbisComment, 0, diag) : nullptr;
+    const auto isOverriddenByTemplate = [templateFields](const std::string &id) {
+        return templateFields && find_if(templateFields->cbegin(), templateFields->cend(), [&id](const TagTemplateField &field) {
+            return CaseInsensitiveCharComparer::compare(field.name.data(), field.name.size(), id.data(), id.size()) == 0;
+        }) != templateFields->cend();
+    };
+    // reserve the required size (covers are Base64-encoded "METADATA_BLOCK_PICTURE" structs so add the size of the encoding overhead)
+    auto requiredSize = buffer.size() + 7 + 4 + vendor.size() + 4 + 1;
+    if (templateFields) {
+        for (const auto &field : *templateFields) {
+            requiredSize += field.data.size();
+        }
+    }
+    for (const auto &[id, field] : fields()) {
+        const auto dataSize = field.value().dataSize();
+        requiredSize += 4 + id.size() + 1 + (field.value().type() == TagDataType::Picture ? (dataSize + 0x100) / 3 * 4 + 4 : dataSize);
+    }
+    buffer.reserve(requiredSize);
     if (!(flags & VorbisCommentFlags::NoSignature)) {
         // write signature
         static const char sig[7] = { 0x03, 0x76, 0x6F, 0x72, 0x62, 0x69, 0x73 };
-        stream.write(sig, sizeof(sig));
+        buffer.append(sig, sizeof(sig));
     }
     // write vendor
-    writer.writeUInt32LE(vendor.size());
-    writer.writeString(vendor);
+    char sizeBuffer[4];
+    LE::getBytes(static_cast<std::uint32_t>(vendor.size()), sizeBuffer);
+    buffer.append(sizeBuffer, sizeof(sizeBuffer));
+    buffer.append(vendor);
     // write field count later
-    const auto fieldCountOffset = stream.tellp();
-    writer.writeUInt32LE(0);
+    const auto fieldCountOffset = buffer.size();
+    buffer.append(4, '\0');
     // write fields
     std::uint32_t fieldsWritten = 0;
-    for (auto i : fields()) {
+    for (auto &i : fields()) {
         VorbisCommentField &field = i.second;
-        if (!field.value().isEmpty()) {
+        if (!field.value().isEmpty() && !isOverriddenByTemplate(i.first)) {
             try {
-                if (field.make(writer, flags, diag)) {
+                if (field.make(buffer, flags, diag)) {
                     ++fieldsWritten;
                 }
             } catch (const Failure &) {
             }
         }
     }
+    // write pre-made fields of the template
+    if (templateFields) {
+        for (const auto &field : *templateFields) {
+            if (!(flags & VorbisCommentFlags::NoCovers) || field.name != VorbisCommentIds::cover()) {
+                buffer.append(field.data);
+                ++fieldsWritten;
+            }
+        }
+    }
     // write field count
-    const auto framingByteOffset = stream.tellp();
-    stream.seekp(fieldCountOffset);
-    writer.writeUInt32LE(fieldsWritten);
-    stream.seekp(framingByteOffset);
+    LE::getBytes(fieldsWritten, buffer.data() + fieldCountOffset);
     // write framing byte
     if (!(flags & VorbisCommentFlags::NoFramingByte)) {
-        stream.put(0x01);
+        buffer += '\x01';
     }
 }
 
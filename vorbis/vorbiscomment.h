@@ -12,6 +12,7 @@ namespace TagParser {
 class OggIterator;
 class VorbisComment;
 class Diagnostics;
+class TagFieldFilter;
 
 /*!
  * \brief Defines traits for the TagField implementation of the VorbisComment class.
@@ -20,6 +21,7 @@ template <> class TAG_PARSER_EXPORT FieldMapBasedTagTraits<VorbisComment> {
 public:
     using FieldType = VorbisCommentField;
     using Compare = CaseInsensitiveStringComparer;
+    using Storage = FlatMultiMap<typename FieldType::IdentifierType, FieldType, Compare>;
 };
 
 class TAG_PARSER_EXPORT VorbisComment : public FieldMapBasedTag<VorbisComment> {
@@ -38,9 +40,12 @@ public:
     using FieldMapBasedTag<VorbisComment>::setValue;
     bool setValue(KnownField field, const TagValue &value) override;
 
-    void parse(OggIterator &iterator, VorbisCommentFlags flags, Diagnostics &diag);
-    void parse(std::istream &stream, std::uint64_t maxSize, VorbisCommentFlags flags, Diagnostics &diag);
+    void parse(OggIterator &iterator, VorbisCommentFlags flags, Diagnostics &diag, const TagFieldFilter *filter = nullptr);
+    void parse(std::istream &stream, std::uint64_t maxSize, VorbisCommentFlags flags, Diagnostics &diag, const TagFieldFilter *filter = nullptr);
+    void parse(const char *buffer, std::size_t size, VorbisCommentFlags flags, Diagnostics &diag, const TagFieldFilter *filter = nullptr,
+        const std::shared_ptr<const void> &sharedBuffer = nullptr);
     void make(std::ostream &stream, VorbisCommentFlags flags, Diagnostics &diag);
+    void make(std::string &buffer, VorbisCommentFlags flags, Diagnostics &diag);
 
     const TagValue &vendor() const;
     void setVendor(const TagValue &vendor);
@@ -49,9 +54,12 @@ public:
 protected:
     IdentifierType internallyGetFieldId(KnownField field) const;
     KnownField internallyGetKnownField(const IdentifierType &id) const;
+    bool internallyAssignValue(KnownField field, TagValue &&value);
 
 private:
-    template <class StreamType> void internalParse(StreamType &stream, std::uint64_t maxSize, VorbisCommentFlags flags, Diagnostics &diag);
+    template <class StreamType>
+    void internalParse(StreamType &stream, std::uint64_t maxSize, VorbisCommentFlags flags, Diagnostics &diag, const TagFieldFilter *filter);
+    void treatYearAsDate();
 
 private:
     TagValue m_vendor;
@@ -84,7 +92,10 @@ inline const TagValue &VorbisComment::vendor() const
  */
 inline void VorbisComment::setVendor(const TagValue &vendor)
 {
-    m_vendor = vendor;
+    if (!m_vendor.isIdentical(vendor)) {
+        m_vendor = vendor;
+        m_modified = true;
+    }
 }
 
 /*!
@@ -7,8 +7,11 @@
 
 #include "../id3/id3v2frame.h"
 
+#include "../abstractattachment.h"
+#include "../base64.h"
 #include "../diagnostics.h"
 #include "../exceptions.h"
+#include "../tagfieldfilter.h"
 
 #include <c++utilities/conversion/binaryconversion.h>
 #include <c++utilities/conversion/stringbuilder.h>
@@ -16,8 +19,10 @@
 #include <c++utilities/io/binaryreader.h>
 #include <c++utilities/io/binarywriter.h>
 
-#include <iostream>
+#include <cstring>
+#include <istream>
 #include <memory>
+#include <ostream>
 
 using namespace std;
 using namespace CppUtilities;
@@ -44,10 +49,138 @@ VorbisCommentField::VorbisCommentField(const IdentifierType &id, const TagValue
 {
 }
 
+namespace {
+
+/// \brief The number of bytes read at a time to determine the ID of a field before reading its data.
+constexpr std::uint32_t idChunkSize = 0x20;
+
+/*!
+ * \brief Skips \a count bytes of the specified \a iterator.
+ */
+void skip(OggIterator &iterator, std::uint64_t count)
+{
+    iterator.ignore(static_cast<std::size_t>(count));
+}
+
+/*!
+ * \brief Skips \a count bytes of the specified \a stream.
+ */
+void skip(std::istream &stream, std::uint64_t count)
+{
+    stream.seekg(static_cast<std::streamoff>(count), std::ios_base::cur);
+}
+
+/*!
+ * \brief The Base64DataBlock class provides the picture data of a cover which is decoded when accessed.
+ * \remarks The encoded data is kept alive via the shared buffer it is part of so the stream the field has been parsed
+ *          from is not required.
+ */
+class Base64DataBlock : public StreamDataBlock {
+public:
+    explicit Base64DataBlock(
+        std::shared_ptr<const void> sharedBuffer, const char *encoded, std::size_t encodedSize, std::size_t skip, std::size_t size);
+
+    void makeBuffer() const override;
+    void copyTo(std::ostream &stream) const override;
+
+private:
+    std::shared_ptr<const void> m_sharedBuffer;
+    const char *m_encoded;
+    std::size_t m_encodedSize;
+    std::size_t m_skip;
+};
+
+/*!
+ * \brief Constructs a block for \a size bytes of the decoded data after skipping the first \a skip bytes.
+ */
+Base64DataBlock::Base64DataBlock(
+    std::shared_ptr<const void> sharedBuffer, const char *encoded, std::size_t encodedSize, std::size_t skip, std::size_t size)
+    : m_sharedBuffer(std::move(sharedBuffer))
+    , m_encoded(encoded)
+    , m_encodedSize(encodedSize)
+    , m_skip(skip)
+{
+    m_endOffset = static_cast<std::streamoff>(size);
+}
+
+/*!
+ * \brief Decodes the data.
+ * \throws Throws std::ios_base::failure if the data can not be decoded (like any failure to read lazy-loaded data).
+ */
+void Base64DataBlock::makeBuffer() const
+{
+    const auto bufferSize = static_cast<std::size_t>(size());
+    try {
+        auto buffer = make_unique<char[]>(Base64::decodedSize(m_encoded, m_encodedSize));
+        auto *const decoded = reinterpret_cast<std::uint8_t *>(buffer.get());
+        if (Base64::decode(m_encoded, m_encodedSize, decoded) < m_skip + bufferSize) {
+            throw std::ios_base::failure("The Base64 data of the cover is truncated.");
+        }
+        memmove(buffer.get(), buffer.get() + m_skip, bufferSize);
+        m_buffer = std::move(buffer);
+    } catch (const ConversionException &) {
+        throw std::ios_base::failure("Unable to decode the Base64 data of the cover.");
+    }
+}
+
+/*!
+ * \brief Decodes the data (if not done yet) and writes it to the specified \a stream.
+ */
+void Base64DataBlock::copyTo(std::ostream &stream) const
+{
+    if (!buffer()) {
+        makeBuffer();
+    }
+    stream.write(buffer().get(), size());
+}
+
+/*!
+ * \brief Parses the "METADATA_BLOCK_PICTURE" encoded as \a encoded assigning the picture data lazily to \a value.
+ *
+ * Only the head of the block (up to the picture data) is decoded. The picture data is decoded when it is accessed.
+ *
+ * \returns Returns the picture type.
+ * \throws Throws TruncatedDataException if the block is truncated and ConversionException if \a encoded is not valid Base64.
+ */
+std::uint32_t parseLazyCover(TagValue &value, const char *encoded, std::size_t encodedSize, const std::shared_ptr<const void> &sharedBuffer)
+{
+    const auto blockSize = Base64::decodedSize(encoded, encodedSize);
+    auto head = std::string();
+    const auto decodeHead = [&](std::size_t size) {
+        if (size > blockSize) {
+            throw TruncatedDataException();
+        }
+        const auto groupCount = (size + 2) / 3;
+        head.resize(groupCount * 3);
+        head.resize(Base64::decode(encoded, groupCount * 4, reinterpret_cast<std::uint8_t *>(head.data())));
+        return head.data();
+    };
+    // decode the head step by step as the sizes of the MIME type and description are only known after decoding them
+    const auto mimeTypeSize = BE::toUInt32(decodeHead(8) + 4);
+    const auto descriptionSize = BE::toUInt32(decodeHead(static_cast<std::size_t>(12) + mimeTypeSize) + 8 + mimeTypeSize);
+    const auto headSize = static_cast<std::size_t>(32) + mimeTypeSize + descriptionSize;
+    const auto *const data = decodeHead(headSize);
+    const auto dataSize = BE::toUInt32(data + headSize - 4);
+    if (dataSize > blockSize - headSize) {
+        throw TruncatedDataException();
+    }
+    value.setMimeType(string(data + 8, mimeTypeSize));
+    value.setDescription(string(data + 12 + mimeTypeSize, descriptionSize));
+    // start decoding the picture data at the group it begins in
+    const auto groupOffset = headSize / 3 * 4;
+    value.assignLazyData(
+        make_shared<Base64DataBlock>(sharedBuffer, encoded + groupOffset, encodedSize - groupOffset, headSize % 3, dataSize), TagDataType::Picture);
+    return BE::toUInt32(data);
+}
+
+} // namespace
+
 /*!
  * \brief Internal implementation for parsing.
  */
-template <class StreamType> void VorbisCommentField::internalParse(StreamType &stream, std::uint64_t &maxSize, Diagnostics &diag)
+template <class StreamType>
+void VorbisCommentField::internalParse(
+    StreamType &stream, std::uint64_t &maxSize, Diagnostics &diag, VorbisCommentFlags flags, const TagFieldFilter *filter)
 {
     static const string context("parsing Vorbis comment  field");
     char buff[4];
@@ -63,7 +196,23 @@ template <class StreamType> void VorbisCommentField::internalParse(StreamType &s
             maxSize -= size;
             // read data
             auto data = make_unique<char[]>(size);
-            stream.read(data.get(), size);
+            std::uint32_t bytesRead = 0;
+            if (filter && !filter->isEmpty()) {
+                // read only the ID first and skip the data if the field is not included
+                const char *separator = nullptr;
+                while (!separator && bytesRead < size) {
+                    const auto chunkSize = min(idChunkSize, size - bytesRead);
+                    stream.read(data.get() + bytesRead, chunkSize);
+                    separator = reinterpret_cast<const char *>(memchr(data.get() + bytesRead, '=', chunkSize));
+                    bytesRead += chunkSize;
+                }
+                if (separator && !filter->includes(KnownField::Invalid, string_view(data.get(), static_cast<std::size_t>(separator - data.get())))) {
+                    setId(string(data.get(), static_cast<std::size_t>(separator - data.get())));
+                    skip(stream, size - bytesRead);
+                    return;
+                }
+            }
+            stream.read(data.get() + bytesRead, size - bytesRead);
             std::uint32_t idSize = 0;
             for (const char *i = data.get(), *end = data.get() + size; i != end && *i != '='; ++i, ++idSize)
                 ;
@@ -76,7 +225,7 @@ template <class StreamType> void VorbisCommentField::internalParse(StreamType &s
             } else if (id() == VorbisCommentIds::cover()) {
                 // extract cover value
                 try {
-                    auto decoded = decodeBase64(data.get() + idSize + 1, size - idSize - 1);
+                    auto decoded = Base64::decode(data.get() + idSize + 1, size - idSize - 1);
                     stringstream bufferStream(ios_base::in | ios_base::out | ios_base::binary);
                     bufferStream.exceptions(ios_base::failbit | ios_base::badbit);
                     bufferStream.rdbuf()->pubsetbuf(reinterpret_cast<char *>(decoded.first.get()), decoded.second);
@@ -96,7 +245,13 @@ template <class StreamType> void VorbisCommentField::internalParse(StreamType &s
                 }
             } else if (id().size() + 1 < size) {
                 // extract other values (as string)
-                setValue(TagValue(string(data.get() + idSize + 1, size - idSize - 1), TagTextEncoding::Utf8));
+                if (flags & VorbisCommentFlags::ShareValueData) {
+                    const auto *const valueData = data.get() + idSize + 1;
+                    value().assignSharedData(std::shared_ptr<const void>(data.release(), std::default_delete<char[]>()), valueData,
+                        size - idSize - 1, TagDataType::Text, TagTextEncoding::Utf8);
+                } else {
+                    value().assignText(data.get() + idSize + 1, size - idSize - 1, TagTextEncoding::Utf8);
+                }
             }
         } else {
             diag.emplace_back(DiagLevel::Critical, "Field is truncated.", context);
@@ -118,7 +273,7 @@ template <class StreamType> void VorbisCommentField::internalParse(StreamType &s
 void VorbisCommentField::parse(OggIterator &iterator, Diagnostics &diag)
 {
     std::uint64_t maxSize = iterator.streamSize() - iterator.currentCharacterOffset();
-    internalParse(iterator, maxSize, diag);
+    internalParse(iterator, maxSize, diag, VorbisCommentFlags::None, nullptr);
 }
 
 /*!
@@ -127,13 +282,16 @@ void VorbisCommentField::parse(OggIterator &iterator, Diagnostics &diag)
  * The currentCharacterOffset() of the iterator is expected to be
  * at the beginning of the field to be parsed.
  *
+ * If \a filter is specified and does not include the ID of the field (see TagFieldFilter::addName()) only the ID is
+ * read and the data is skipped. The value remains empty in this case.
+ *
  * \throws Throws std::ios_base::failure when an IO error occurs.
  * \throws Throws TagParser::Failure or a derived exception when a parsing
  *         error occurs.
  */
-void VorbisCommentField::parse(OggIterator &iterator, std::uint64_t &maxSize, Diagnostics &diag)
+void VorbisCommentField::parse(OggIterator &iterator, std::uint64_t &maxSize, Diagnostics &diag, VorbisCommentFlags flags, const TagFieldFilter *filter)
 {
-    internalParse(iterator, maxSize, diag);
+    internalParse(iterator, maxSize, diag, flags, filter);
 }
 
 /*!
@@ -142,13 +300,94 @@ void VorbisCommentField::parse(OggIterator &iterator, std::uint64_t &maxSize, Di
  * The position of the current character in the input stream is expected to be
  * at the beginning of the field to be parsed.
  *
+ * If \a filter is specified and does not include the ID of the field (see TagFieldFilter::addName()) only the ID is
+ * read and the data is skipped. The value remains empty in this case.
+ *
  * \throws Throws std::ios_base::failure when an IO error occurs.
  * \throws Throws TagParser::Failure or a derived exception when a parsing
  *         error occurs.
  */
-void VorbisCommentField::parse(istream &stream, std::uint64_t &maxSize, Diagnostics &diag)
+void VorbisCommentField::parse(istream &stream, std::uint64_t &maxSize, Diagnostics &diag, VorbisCommentFlags flags, const TagFieldFilter *filter)
+{
+    internalParse(stream, maxSize, diag, flags, filter);
+}
+
+/*!
+ * \brief Parses a field from the specified \a buffer.
+ *
+ * \a maxSize specifies the number of bytes available within \a buffer and is decreased by the size of the field.
+ *
+ * Unlike the stream-based overloads, the field data is not copied into a buffer of its own first. If \a flags contain
+ * VorbisCommentFlags::ShareValueData and \a sharedBuffer is specified, text values refer to \a sharedBuffer (which
+ * \a buffer must be part of). The data of covers always refers to the buffer the cover has been decoded into. If
+ * \a flags contain VorbisCommentFlags::LazyLoadCovers and \a sharedBuffer is specified, the picture data of covers is
+ * only decoded when accessed.
+ *
+ * \throws Throws TagParser::Failure or a derived exception when a parsing
+ *         error occurs.
+ */
+void VorbisCommentField::parse(const char *buffer, std::uint64_t &maxSize, Diagnostics &diag, VorbisCommentFlags flags,
+    const TagFieldFilter *filter, const std::shared_ptr<const void> &sharedBuffer)
 {
-    internalParse(stream, maxSize, diag);
+    static const string context("parsing Vorbis comment  field");
+    if (maxSize < 4) {
+        diag.emplace_back(DiagLevel::Critical, "Field expected.", context);
+        throw TruncatedDataException();
+    }
+    maxSize -= 4;
+    const auto size = LE::toUInt32(buffer);
+    if (!size) {
+        return;
+    }
+    if (size > maxSize) {
+        diag.emplace_back(DiagLevel::Critical, "Field is truncated.", context);
+        throw TruncatedDataException();
+    }
+    maxSize -= size;
+
+    // extract id
+    const auto *const data = buffer + 4;
+    const auto *const separator = reinterpret_cast<const char *>(memchr(data, '=', size));
+    const auto idSize = static_cast<std::uint32_t>(separator ? separator - data : size);
+    setId(string(data, idSize));
+    if (separator && filter && !filter->isEmpty() && !filter->includes(KnownField::Invalid, string_view(data, idSize))) {
+        return;
+    }
+    if (!idSize) {
+        diag.emplace_back(DiagLevel::Critical, "The field ID is empty.", context);
+        throw InvalidDataException();
+    }
+
+    // extract value
+    const auto *const valueData = data + idSize + 1;
+    const auto valueSize = size - idSize - (separator ? 1 : 0);
+    if (id() == VorbisCommentIds::cover()) {
+        try {
+            if ((flags & VorbisCommentFlags::LazyLoadCovers) && sharedBuffer) {
+                setTypeInfo(parseLazyCover(value(), valueData, valueSize, sharedBuffer));
+                return;
+            }
+            auto decoded = Base64::decode(valueData, valueSize);
+            const auto *const decodedData = reinterpret_cast<const char *>(decoded.first.get());
+            const auto decodedSize = decoded.second;
+            FlacMetaDataBlockPicture pictureBlock(value());
+            pictureBlock.parse(
+                decodedData, decodedSize, std::shared_ptr<const void>(decoded.first.release(), std::default_delete<std::uint8_t[]>()));
+            setTypeInfo(pictureBlock.pictureType());
+        } catch (const TruncatedDataException &) {
+            diag.emplace_back(DiagLevel::Critical, "METADATA_BLOCK_PICTURE is truncated.", context);
+            throw;
+        } catch (const ConversionException &) {
+            diag.emplace_back(DiagLevel::Critical, "Base64 coding of METADATA_BLOCK_PICTURE is invalid.", context);
+            throw InvalidDataException();
+        }
+    } else if (valueSize && separator) {
+        if ((flags & VorbisCommentFlags::ShareValueData) && sharedBuffer) {
+            value().assignSharedData(sharedBuffer, valueData, valueSize, TagDataType::Text, TagTextEncoding::Utf8);
+        } else {
+            value().assignText(valueData, valueSize, TagTextEncoding::Utf8);
+        }
+    }
 }
 
 /*!
@@ -161,6 +400,24 @@ void VorbisCommentField::parse(istream &stream, std::uint64_t &maxSize, Diagnost
  *          when specific \a flags are set.)
  */
 bool VorbisCommentField::make(BinaryWriter &writer, VorbisCommentFlags flags, Diagnostics &diag)
+{
+    auto buffer = string();
+    if (!make(buffer, flags, diag)) {
+        return false;
+    }
+    writer.writeString(buffer);
+    return true;
+}
+
+/*!
+ * \brief Appends the field to the specified \a buffer.
+ *
+ * \throws Throws TagParser::Failure or a derived exception when a making
+ *                error occurs. Nothing has been appended to \a buffer in this case.
+ * \returns Returns whether the field has been written. (Some fields might be skipped
+ *          when specific \a flags are set.)
+ */
+bool VorbisCommentField::make(std::string &buffer, VorbisCommentFlags flags, Diagnostics &diag)
 {
     static const string context("making Vorbis comment  field");
     if (id().empty()) {
@@ -189,7 +446,7 @@ bool VorbisCommentField::make(BinaryWriter &writer, VorbisCommentFlags flags, Di
                 bufferStream.rdbuf()->pubsetbuf(buffer.get(), requiredSize);
 
                 pictureBlock.make(bufferStream);
-                valueString = encodeBase64(reinterpret_cast<std::uint8_t *>(buffer.get()), requiredSize);
+                valueString = Base64::encode(reinterpret_cast<std::uint8_t *>(buffer.get()), requiredSize);
             } catch (const Failure &) {
                 diag.emplace_back(DiagLevel::Critical, "Unable to make METADATA_BLOCK_PICTURE struct from the assigned value.", context);
                 throw;
@@ -207,10 +464,12 @@ bool VorbisCommentField::make(BinaryWriter &writer, VorbisCommentFlags flags, Di
             diag.emplace_back(DiagLevel::Critical, "Assigned value exceeds the maximum size.", context);
             throw InvalidDataException();
         }
-        writer.writeUInt32LE(static_cast<std::uint32_t>(size));
-        writer.writeString(id());
-        writer.writeChar('=');
-        writer.writeString(valueString);
+        const auto sizeOffset = buffer.size();
+        buffer.resize(sizeOffset + 4);
+        LE::getBytes(static_cast<std::uint32_t>(size), buffer.data() + sizeOffset);
+        buffer.append(id());
+        buffer += '=';
+        buffer.append(valueString);
     } catch (const ConversionException &) {
         diag.emplace_back(DiagLevel::Critical, "Assigned value can not be converted appropriately.", context);
         throw InvalidDataException();
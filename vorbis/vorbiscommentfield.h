@@ -17,7 +17,9 @@ enum class VorbisCommentFlags : std::uint8_t {
     None = 0x0, /**< Regular parsing/making. */
     NoSignature = 0x1, /**< Skips the signature when parsing and making. */
     NoFramingByte = 0x2, /**< Doesn't expect the framing bit to be present when parsing; does not make the framing bit when making. */
-    NoCovers = 0x4 /**< Skips all covers when making. */
+    NoCovers = 0x4, /**< Skips all covers when making. */
+    ShareValueData = 0x8, /**< Lets parsed values refer to the shared buffer of the field instead of copying (see ParsingFlags::ShareTagValueData). */
+    LazyLoadCovers = 0x10, /**< Decodes the picture data of covers only when accessed (see ParsingFlags::LazyLoadPictures); only effective when parsing from a shared buffer. */
 };
 
 constexpr bool operator&(VorbisCommentFlags lhs, VorbisCommentFlags rhs)
@@ -43,6 +45,7 @@ public:
 };
 
 class OggIterator;
+class TagFieldFilter;
 
 class TAG_PARSER_EXPORT VorbisCommentField : public TagField<VorbisCommentField> {
     friend class TagField<VorbisCommentField>;
@@ -52,9 +55,14 @@ public:
     VorbisCommentField(const IdentifierType &id, const TagValue &value);
 
     void parse(OggIterator &iterator, Diagnostics &diag);
-    void parse(OggIterator &iterator, std::uint64_t &maxSize, Diagnostics &diag);
-    void parse(std::istream &stream, std::uint64_t &maxSize, Diagnostics &diag);
+    void parse(OggIterator &iterator, std::uint64_t &maxSize, Diagnostics &diag, VorbisCommentFlags flags = VorbisCommentFlags::None,
+        const TagFieldFilter *filter = nullptr);
+    void parse(std::istream &stream, std::uint64_t &maxSize, Diagnostics &diag, VorbisCommentFlags flags = VorbisCommentFlags::None,
+        const TagFieldFilter *filter = nullptr);
+    void parse(const char *buffer, std::uint64_t &maxSize, Diagnostics &diag, VorbisCommentFlags flags = VorbisCommentFlags::None,
+        const TagFieldFilter *filter = nullptr, const std::shared_ptr<const void> &sharedBuffer = nullptr);
     bool make(CppUtilities::BinaryWriter &writer, VorbisCommentFlags flags, Diagnostics &diag);
+    bool make(std::string &buffer, VorbisCommentFlags flags, Diagnostics &diag);
     bool isAdditionalTypeInfoUsed() const;
     bool supportsNestedFields() const;
 
@@ -63,7 +71,8 @@ public:
 
 private:
     void reset();
-    template <class StreamType> void internalParse(StreamType &stream, std::uint64_t &maxSize, Diagnostics &diag);
+    template <class StreamType>
+    void internalParse(StreamType &stream, std::uint64_t &maxSize, Diagnostics &diag, VorbisCommentFlags flags, const TagFieldFilter *filter);
 };
 
 /*!
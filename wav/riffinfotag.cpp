@@ -0,0 +1,170 @@
+#include "./riffinfotag.h"
+
+#include "../diagnostics.h"
+#include "../exceptions.h"
+#include "../perfecthashmap.h"
+
+#include <c++utilities/conversion/stringbuilder.h>
+#include <c++utilities/io/binarywriter.h>
+
+#include <limits>
+#include <memory>
+#include <sstream>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+namespace {
+
+/// \brief The IDs of the sub chunks of the "INFO" list and the known fields they are mapped to.
+constexpr std::pair<std::uint32_t, KnownField> subChunkIdsAndKnownFields[] = {
+    { RiffInfoIds::Album, KnownField::Album },
+    { RiffInfoIds::Artist, KnownField::Artist },
+    { RiffInfoIds::Comment, KnownField::Comment },
+    { RiffInfoIds::CreationDate, KnownField::RecordDate },
+    { RiffInfoIds::Genre, KnownField::Genre },
+    { RiffInfoIds::Language, KnownField::Language },
+    { RiffInfoIds::Software, KnownField::Encoder },
+    { RiffInfoIds::Subject, KnownField::Description },
+    { RiffInfoIds::Title, KnownField::Title },
+    { RiffInfoIds::TrackNumber, KnownField::TrackPosition },
+};
+constexpr auto knownFieldsBySubChunkId = makePerfectHashMap(subChunkIdsAndKnownFields, KnownField::Invalid);
+static_assert(knownFieldsBySubChunkId.isPerfect(), "sub chunk IDs must be unique");
+
+} // namespace
+
+/*!
+ * \class TagParser::RiffInfoTag
+ * \brief Implementation of TagParser::Tag for the "INFO" list of RIFF files (e.g. WAVE files).
+ *
+ * The fields are the sub chunks of the "LIST" chunk with the form type "INFO". Their values are plain text
+ * terminated by a null character.
+ */
+
+RiffInfoTag::IdentifierType RiffInfoTag::internallyGetFieldId(KnownField field) const
+{
+    using namespace RiffInfoIds;
+    switch (field) {
+    case KnownField::Album:
+        return Album;
+    case KnownField::Artist:
+        return Artist;
+    case KnownField::Comment:
+        return Comment;
+    case KnownField::RecordDate:
+    case KnownField::Year:
+        return CreationDate;
+    case KnownField::Genre:
+        return Genre;
+    case KnownField::Language:
+        return Language;
+    case KnownField::Encoder:
+        return Software;
+    case KnownField::Description:
+        return Subject;
+    case KnownField::Title:
+        return Title;
+    case KnownField::TrackPosition:
+        return TrackNumber;
+    default:
+        return 0;
+    }
+}
+
+KnownField RiffInfoTag::internallyGetKnownField(const IdentifierType &id) const
+{
+    return knownFieldsBySubChunkId.find(id);
+}
+
+/*!
+ * \brief Parses the "INFO" list from the specified \a stream.
+ *
+ * The \a stream is expected to be positioned at the form type of the "LIST" chunk and \a listSize specifies the size
+ * of the chunk data (as denoted in the chunk header). The list is read at once; sub chunks exceeding the list are not
+ * read.
+ *
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ * \throws Throws TagParser::Failure or a derived exception when a parsing error occurs.
+ */
+void RiffInfoTag::parse(istream &stream, std::uint32_t listSize, Diagnostics &diag)
+{
+    static const string context("parsing RIFF INFO list");
+    if (listSize < 4) {
+        diag.emplace_back(DiagLevel::Critical, "\"LIST\" chunk is truncated.", context);
+        throw TruncatedDataException();
+    }
+    if (listSize > maxListSize) {
+        diag.emplace_back(DiagLevel::Critical, argsToString("\"INFO\" list exceeds the maximum size of ", maxListSize, " bytes."), context);
+        throw InvalidDataException();
+    }
+    auto buffer = make_unique<char[]>(listSize);
+    stream.read(buffer.get(), static_cast<streamsize>(listSize));
+    if (BE::toUInt32(buffer.get()) != 0x494E464Fu) {
+        diag.emplace_back(DiagLevel::Critical, "\"LIST\" chunk is not an \"INFO\" list.", context);
+        throw NoDataFoundException();
+    }
+    m_size = listSize + 8;
+    for (std::uint32_t offset = 4; offset < listSize;) {
+        if (listSize - offset < 8) {
+            diag.emplace_back(DiagLevel::Warning, "\"INFO\" list contains trailing bytes which are ignored.", context);
+            break;
+        }
+        const auto *const subChunk = buffer.get() + offset;
+        const auto id = BE::toUInt32(subChunk);
+        const auto size = LE::toUInt32(subChunk + 4);
+        offset += 8;
+        if (size > listSize - offset) {
+            diag.emplace_back(DiagLevel::Critical,
+                argsToString("Sub chunk \"", RiffInfoTagField::fieldIdToString(id), "\" is truncated; it and subsequent sub chunks are ignored."),
+                context);
+            break;
+        }
+        RiffInfoTagField field;
+        field.parse(id, subChunk + 8, size);
+        fields().emplace(id, std::move(field));
+        offset += size;
+        // skip pad byte (unless it is missing which is tolerated at the end of the list)
+        if ((size & 1) && offset < listSize) {
+            ++offset;
+        }
+    }
+}
+
+/*!
+ * \brief Writes the tag as "LIST" chunk (including the chunk header) to the specified \a stream.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ * \throws Throws TagParser::Failure or a derived exception when a making error occurs.
+ */
+void RiffInfoTag::make(ostream &stream, Diagnostics &diag)
+{
+    static const string context("making RIFF INFO list");
+    stringstream buffer(ios_base::in | ios_base::out | ios_base::binary);
+    buffer.exceptions(ios_base::failbit | ios_base::badbit);
+    BinaryWriter writer(&buffer);
+    writer.writeUInt32BE(0x494E464Fu);
+    for (auto &[id, field] : fields()) {
+        if (field.value().isEmpty()) {
+            continue;
+        }
+        try {
+            field.make(writer, diag);
+        } catch (const Failure &) {
+            diag.emplace_back(DiagLevel::Warning, argsToString("Unable to make field \"", field.idToString(), "\"; it is skipped."), context);
+        }
+    }
+    const auto listSize = static_cast<std::uint64_t>(buffer.tellp());
+    if (listSize > numeric_limits<std::uint32_t>::max() - 8) {
+        diag.emplace_back(DiagLevel::Critical, "\"INFO\" list exceeds the maximum size.", context);
+        throw InvalidDataException();
+    }
+    writer.setStream(&stream);
+    writer.writeUInt32BE(0x4C495354u);
+    writer.writeUInt32LE(static_cast<std::uint32_t>(listSize));
+    stream << buffer.rdbuf();
+    m_size = static_cast<std::uint32_t>(listSize + 8);
+}
+
+} // namespace TagParser
@@ -0,0 +1,61 @@
+#ifndef TAG_PARSER_RIFFINFOTAG_H
+#define TAG_PARSER_RIFFINFOTAG_H
+
+#include "./riffinfotagfield.h"
+
+#include "../fieldbasedtag.h"
+
+#include <functional>
+
+namespace TagParser {
+
+class RiffInfoTag;
+class Diagnostics;
+
+/*!
+ * \brief Defines traits for the TagField implementation of the RiffInfoTag class.
+ */
+template <> class TAG_PARSER_EXPORT FieldMapBasedTagTraits<RiffInfoTag> {
+public:
+    using FieldType = RiffInfoTagField;
+    using Compare = std::less<typename FieldType::IdentifierType>;
+    using Storage = FlatMultiMap<typename FieldType::IdentifierType, FieldType, Compare>;
+};
+
+class TAG_PARSER_EXPORT RiffInfoTag : public FieldMapBasedTag<RiffInfoTag> {
+    friend class FieldMapBasedTag<RiffInfoTag>;
+
+public:
+    RiffInfoTag();
+
+    static constexpr TagType tagType = TagType::RiffInfoTag;
+    static constexpr const char *tagName = "RIFF INFO";
+    static constexpr TagTextEncoding defaultTextEncoding = TagTextEncoding::Utf8;
+    bool canEncodingBeUsed(TagTextEncoding encoding) const override;
+
+    void parse(std::istream &stream, std::uint32_t listSize, Diagnostics &diag);
+    void make(std::ostream &stream, Diagnostics &diag);
+
+    /// \brief The maximum size of an "INFO" list which is read; bigger lists are skipped.
+    static constexpr std::uint32_t maxListSize = 0x1000000;
+
+protected:
+    IdentifierType internallyGetFieldId(KnownField field) const;
+    KnownField internallyGetKnownField(const IdentifierType &id) const;
+};
+
+/*!
+ * \brief Constructs a new RIFF INFO tag.
+ */
+inline RiffInfoTag::RiffInfoTag()
+{
+}
+
+inline bool RiffInfoTag::canEncodingBeUsed(TagTextEncoding encoding) const
+{
+    return encoding == TagTextEncoding::Utf8;
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_RIFFINFOTAG_H
@@ -0,0 +1,121 @@
+#include "./riffinfotagfield.h"
+
+#include "../diagnostics.h"
+#include "../exceptions.h"
+
+#include <c++utilities/conversion/stringbuilder.h>
+#include <c++utilities/io/binarywriter.h>
+
+#include <limits>
+
+using namespace std;
+using namespace CppUtilities;
+
+namespace TagParser {
+
+/// \cond
+namespace {
+
+/*!
+ * \brief Returns whether the specified \a data is valid UTF-8.
+ * \remarks The encoding of "INFO" sub chunks is not specified. Most applications use UTF-8 nowadays but older files
+ *          often use the system's code page. So the text is treated as Latin-1 unless it is valid UTF-8.
+ */
+bool isValidUtf8(const unsigned char *data, std::size_t size)
+{
+    for (const auto *const end = data + size; data != end;) {
+        const auto leadByte = *data++;
+        auto continuationBytes = 0;
+        if (leadByte < 0x80) {
+            continue;
+        } else if ((leadByte & 0xE0) == 0xC0 && leadByte >= 0xC2) {
+            continuationBytes = 1;
+        } else if ((leadByte & 0xF0) == 0xE0) {
+            continuationBytes = 2;
+        } else if ((leadByte & 0xF8) == 0xF0 && leadByte <= 0xF4) {
+            continuationBytes = 3;
+        } else {
+            return false;
+        }
+        for (; continuationBytes; --continuationBytes) {
+            if (data == end || (*data++ & 0xC0) != 0x80) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+/// \endcond
+
+/*!
+ * \class TagParser::RiffInfoTagField
+ * \brief The RiffInfoTagField class is used by RiffInfoTag to store the fields.
+ */
+
+/*!
+ * \brief Constructs a new RiffInfoTagField.
+ */
+RiffInfoTagField::RiffInfoTagField()
+{
+}
+
+/*!
+ * \brief Constructs a new RiffInfoTagField with the specified \a id and \a value.
+ */
+RiffInfoTagField::RiffInfoTagField(IdentifierType id, const TagValue &value)
+    : TagField<RiffInfoTagField>(id, value)
+{
+}
+
+/*!
+ * \brief Parses the field with the specified \a id from the \a size bytes of sub chunk data at \a data.
+ * \remarks The terminating null character(s) are stripped.
+ */
+void RiffInfoTagField::parse(IdentifierType id, const char *data, std::uint32_t size)
+{
+    setId(id);
+    for (; size && !data[size - 1]; --size)
+        ;
+    if (!size) {
+        value().clearDataAndMetadata();
+        return;
+    }
+    value().assignText(data, size,
+        isValidUtf8(reinterpret_cast<const unsigned char *>(data), size) ? TagTextEncoding::Utf8 : TagTextEncoding::Latin1);
+}
+
+/*!
+ * \brief Writes the field as sub chunk (including the terminating null character and the pad byte) using the
+ *        specified \a writer.
+ * \remarks The value is always written as UTF-8.
+ * \throws Throws std::ios_base::failure when an IO error occurs.
+ * \throws Throws TagParser::Failure or a derived exception when a making error occurs.
+ */
+void RiffInfoTagField::make(BinaryWriter &writer, Diagnostics &diag)
+{
+    static const string context("making RIFF INFO field");
+    string valueString;
+    try {
+        valueString = value().toString(TagTextEncoding::Utf8);
+    } catch (const ConversionException &) {
+        diag.emplace_back(
+            DiagLevel::Critical, argsToString("Unable to convert the value of \"", fieldIdToString(id()), "\" to string."), context);
+        throw InvalidDataException();
+    }
+    if (valueString.size() >= numeric_limits<std::uint32_t>::max() - 1) {
+        diag.emplace_back(DiagLevel::Critical, "Assigned value exceeds the maximum size.", context);
+        throw InvalidDataException();
+    }
+    const auto size = static_cast<std::uint32_t>(valueString.size() + 1);
+    writer.writeUInt32BE(id());
+    writer.writeUInt32LE(size);
+    writer.writeString(valueString);
+    writer.writeChar('\0');
+    if (size & 1) {
+        writer.writeChar('\0');
+    }
+}
+
+} // namespace TagParser
@@ -0,0 +1,115 @@
+#ifndef TAG_PARSER_RIFFINFOTAGFIELD_H
+#define TAG_PARSER_RIFFINFOTAGFIELD_H
+
+#include "../generictagfield.h"
+
+#include <c++utilities/conversion/binaryconversion.h>
+#include <c++utilities/conversion/conversionexception.h>
+#include <c++utilities/conversion/stringconversion.h>
+
+#include <cstdint>
+#include <cstring>
+
+namespace CppUtilities {
+class BinaryWriter;
+}
+
+namespace TagParser {
+
+/*!
+ * \brief Encapsulates the IDs of the sub chunks of a RIFF "INFO" list.
+ */
+namespace RiffInfoIds {
+enum KnownValue : std::uint32_t {
+    Album = 0x49505244, /**< IPRD (product) */
+    Artist = 0x49415254, /**< IART */
+    Comment = 0x49434D54, /**< ICMT */
+    Copyright = 0x49434F50, /**< ICOP */
+    CreationDate = 0x49435244, /**< ICRD */
+    Engineer = 0x49454E47, /**< IENG */
+    Genre = 0x49474E52, /**< IGNR */
+    Keywords = 0x494B4559, /**< IKEY */
+    Language = 0x494C4E47, /**< ILNG */
+    Software = 0x49534654, /**< ISFT */
+    Subject = 0x4953424A, /**< ISBJ */
+    Title = 0x494E414D, /**< INAM */
+    TrackNumber = 0x4954524B, /**< ITRK */
+};
+}
+
+class RiffInfoTagField;
+class Diagnostics;
+
+/*!
+ * \brief Defines traits for the TagField implementation of the RiffInfoTagField class.
+ */
+template <> class TAG_PARSER_EXPORT TagFieldTraits<RiffInfoTagField> {
+public:
+    using IdentifierType = std::uint32_t;
+    using TypeInfoType = std::uint32_t;
+};
+
+class TAG_PARSER_EXPORT RiffInfoTagField : public TagField<RiffInfoTagField> {
+    friend class TagField<RiffInfoTagField>;
+
+public:
+    RiffInfoTagField();
+    RiffInfoTagField(IdentifierType id, const TagValue &value);
+
+    void parse(IdentifierType id, const char *data, std::uint32_t size);
+    void make(CppUtilities::BinaryWriter &writer, Diagnostics &diag);
+    bool isAdditionalTypeInfoUsed() const;
+    bool supportsNestedFields() const;
+
+    static IdentifierType fieldIdFromString(const char *idString, std::size_t idStringSize = std::string::npos);
+    static std::string fieldIdToString(IdentifierType id);
+
+private:
+    void reset();
+};
+
+/*!
+ * \brief Returns whether the additional type info is used.
+ */
+inline bool RiffInfoTagField::isAdditionalTypeInfoUsed() const
+{
+    return false;
+}
+
+/*!
+ * \brief Returns whether nested fields are supported.
+ */
+inline bool RiffInfoTagField::supportsNestedFields() const
+{
+    return false;
+}
+
+/*!
+ * \brief Converts the specified ID string representation to an actual ID.
+ */
+inline RiffInfoTagField::IdentifierType RiffInfoTagField::fieldIdFromString(const char *idString, std::size_t idStringSize)
+{
+    if ((idStringSize != std::string::npos ? idStringSize : std::strlen(idString)) != 4) {
+        throw CppUtilities::ConversionException("RIFF INFO ID must be exactly 4 chars");
+    }
+    return CppUtilities::BE::toUInt32(idString);
+}
+
+/*!
+ * \brief Returns the string representation for the specified \a id.
+ */
+inline std::string RiffInfoTagField::fieldIdToString(IdentifierType id)
+{
+    return CppUtilities::interpretIntegerAsString<std::uint32_t>(id);
+}
+
+/*!
+ * \brief Resets RIFF INFO-specific values. Called via clear().
+ */
+inline void RiffInfoTagField::reset()
+{
+}
+
+} // namespace TagParser
+
+#endif // TAG_PARSER_RIFFINFOTAGFIELD_H
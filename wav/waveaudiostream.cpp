@@ -2,12 +2,16 @@
 
 #include "../mpegaudio/mpegaudioframestream.h"
 
+#include "../diagnostics.h"
 #include "../exceptions.h"
 #include "../mediaformat.h"
 
+#include <c++utilities/conversion/stringbuilder.h>
 #include <c++utilities/conversion/stringconversion.h>
 #include <c++utilities/io/binaryreader.h>
 
+#include <algorithm>
+
 using namespace std;
 using namespace CppUtilities;
 
@@ -105,6 +109,10 @@ MediaFormat WaveFormatHeader::format() const
  * \class TagParser::WaveAudioStream
  * \brief Implementation of TagParser::AbstractTrack for the
  *        RIFF WAVE container format.
+ *
+ * When parsing the header all top-level chunks are indexed in one pass (see chunks()) so they can be located without
+ * walking the file again. The "INFO" list is parsed as RiffInfoTag. The "id3 " chunk is parsed by MediaFileInfo as
+ * ID3v2 tag.
  */
 
 /*!
@@ -113,6 +121,8 @@ MediaFormat WaveFormatHeader::format() const
 WaveAudioStream::WaveAudioStream(iostream &stream, std::uint64_t startOffset)
     : AbstractTrack(stream, startOffset)
     , m_dataOffset(0)
+    , m_riffEndOffset(0)
+    , m_truncated(false)
 {
     m_mediaType = MediaType::Audio;
 }
@@ -129,6 +139,41 @@ TrackType WaveAudioStream::type() const
     return TrackType::WaveAudioStream;
 }
 
+/*!
+ * \brief Returns the first top-level chunk with the specified \a id (and \a listType) or nullptr if there is none.
+ */
+const WaveChunk *WaveAudioStream::chunk(std::uint32_t id, std::uint32_t listType) const
+{
+    const auto i = find_if(m_chunks.cbegin(), m_chunks.cend(), [&](const WaveChunk &chunk) { return chunk.id == id && chunk.listType == listType; });
+    return i != m_chunks.cend() ? &*i : nullptr;
+}
+
+/*!
+ * \brief Creates a new "INFO" tag for the stream.
+ * \remarks Just returns the current tag if already present.
+ */
+RiffInfoTag *WaveAudioStream::createInfoTag()
+{
+    if (!m_infoTag) {
+        m_infoTag = make_unique<RiffInfoTag>();
+    }
+    return m_infoTag.get();
+}
+
+/*!
+ * \brief Removes the assigned "INFO" tag if one is assigned; does nothing otherwise.
+ * \returns Returns whether there were an "INFO" tag assigned.
+ */
+bool WaveAudioStream::removeInfoTag()
+{
+    if (!m_infoTag) {
+        return false;
+    }
+    m_infoTag.reset();
+    m_flags |= TrackFlags::Modified;
+    return true;
+}
+
 /*!
  * \brief Adds the information from the specified \a waveHeader to the specified \a track.
  */
@@ -153,29 +198,87 @@ void WaveAudioStream::internalParseHeader(Diagnostics &diag)
     if (m_reader.readUInt32BE() != 0x52494646u) {
         throw NoDataFoundException();
     }
-    m_istream->seekg(static_cast<streamoff>(m_startOffset + 8));
+    const auto riffSize = m_reader.readUInt32LE();
     if (m_reader.readUInt32BE() != 0x57415645u) {
         throw NoDataFoundException();
     }
-    while (!m_dataOffset) {
-        const auto segmentId = m_reader.readUInt32BE();
-        auto restHeaderLen = m_reader.readUInt32LE();
-        switch (segmentId) {
-        case 0x666D7420u: { // format segment
+
+    // determine where the chunks end; reading beyond the RIFF chunk or the end of the file is avoided
+    m_istream->seekg(0, ios_base::end);
+    const auto streamSize = static_cast<std::uint64_t>(m_istream->tellg());
+    auto riffEnd = m_startOffset + 8 + riffSize;
+    m_truncated = false;
+    if (riffEnd > streamSize) {
+        diag.emplace_back(DiagLevel::Warning,
+            argsToString("The RIFF chunk denotes a size of ", riffSize, " bytes which exceeds the file; the file is probably truncated."), context);
+        riffEnd = streamSize;
+        m_truncated = true;
+    }
+
+    // index all top-level chunks in one pass
+    m_chunks.clear();
+    m_infoTag.reset();
+    for (auto offset = m_startOffset + 12; offset + 8 <= riffEnd;) {
+        m_istream->seekg(static_cast<streamoff>(offset));
+        auto &chunk = m_chunks.emplace_back();
+        chunk.offset = offset;
+        chunk.id = m_reader.readUInt32BE();
+        chunk.dataSize = m_reader.readUInt32LE();
+        const auto available = riffEnd - offset - 8;
+        const auto truncated = chunk.dataSize > available;
+        if (truncated) {
+            diag.emplace_back(DiagLevel::Warning,
+                argsToString("Chunk \"", interpretIntegerAsString<std::uint32_t>(chunk.id), "\" at offset ", offset,
+                    " exceeds the RIFF chunk; it is truncated to ", available, " bytes."),
+                context);
+            chunk.dataSize = static_cast<std::uint32_t>(available);
+        }
+        switch (chunk.id) {
+        case 0x666D7420u: { // format chunk
             WaveFormatHeader waveHeader;
-            const auto bytesRead = waveHeader.parse(m_reader, restHeaderLen, diag);
+            waveHeader.parse(m_reader, chunk.dataSize, diag);
             addInfo(waveHeader, *this);
-            restHeaderLen -= bytesRead;
-        } break;
-        case 0x64617461u: // data segment
-            m_dataOffset = static_cast<std::uint64_t>(m_istream->tellg());
-            m_size = restHeaderLen;
-            m_sampleCount = m_size / m_chunkSize;
-            m_duration = TimeSpan::fromSeconds(static_cast<double>(m_sampleCount) / static_cast<double>(m_samplingFrequency));
+            break;
+        }
+        case 0x64617461u: // data chunk
+            if (!m_dataOffset) {
+                m_dataOffset = offset + 8;
+                m_size = chunk.dataSize;
+            }
+            break;
+        case 0x4C495354u: // list chunk
+            if (chunk.dataSize >= 4) {
+                chunk.listType = m_reader.readUInt32BE();
+                if (chunk.listType == 0x494E464Fu && !m_infoTag) {
+                    auto infoTag = make_unique<RiffInfoTag>();
+                    m_istream->seekg(-4, ios_base::cur);
+                    try {
+                        infoTag->parse(*m_istream, chunk.dataSize, diag);
+                        m_infoTag = move(infoTag);
+                    } catch (const Failure &) {
+                        diag.emplace_back(DiagLevel::Critical, "Unable to parse \"INFO\" list.", context);
+                    }
+                }
+            }
             break;
         default:;
         }
-        m_istream->seekg(restHeaderLen, ios_base::cur);
+        if (truncated) {
+            m_truncated = true;
+            break;
+        }
+        offset = chunk.endOffset();
+    }
+    m_riffEndOffset = m_chunks.empty() ? m_startOffset + 12 : min(m_chunks.back().endOffset(), riffEnd);
+    if (!m_dataOffset) {
+        diag.emplace_back(DiagLevel::Critical, "The \"data\" chunk is missing.", context);
+        return;
+    }
+    if (m_chunkSize) {
+        m_sampleCount = m_size / m_chunkSize;
+    }
+    if (m_samplingFrequency) {
+        m_duration = TimeSpan::fromSeconds(static_cast<double>(m_sampleCount) / static_cast<double>(m_samplingFrequency));
     }
     if (m_format.general != GeneralMediaFormat::Mpeg1Audio || !m_dataOffset) {
         return;
@@ -1,8 +1,13 @@
 #ifndef TAG_PARSER_WAVEAUDIOSTREAM_H
 #define TAG_PARSER_WAVEAUDIOSTREAM_H
 
+#include "./riffinfotag.h"
+
 #include "../abstracttrack.h"
 
+#include <memory>
+#include <vector>
+
 namespace TagParser {
 
 class TAG_PARSER_EXPORT WaveFormatHeader {
@@ -48,12 +53,52 @@ constexpr std::uint32_t WaveFormatHeader::bitrate() const
     return bitsPerSample * sampleRate * channelCount;
 }
 
+/*!
+ * \brief The WaveChunk struct holds the position of a top-level chunk of a RIFF/WAVE file.
+ */
+struct TAG_PARSER_EXPORT WaveChunk {
+    constexpr std::uint64_t totalSize() const;
+    constexpr std::uint64_t endOffset() const;
+
+    /// \brief The absolute offset of the chunk header.
+    std::uint64_t offset = 0;
+    /// \brief The ID (FourCC) of the chunk, e.g. 0x64617461 for "data".
+    std::uint32_t id = 0;
+    /// \brief The size of the chunk data as denoted in the chunk header (excluding the pad byte).
+    std::uint32_t dataSize = 0;
+    /// \brief The form type of a "LIST" chunk, e.g. 0x494E464F for "INFO"; zero for other chunks.
+    std::uint32_t listType = 0;
+};
+
+/*!
+ * \brief Returns the size of the chunk including its header and the pad byte.
+ */
+constexpr std::uint64_t WaveChunk::totalSize() const
+{
+    return 8 + static_cast<std::uint64_t>(dataSize) + (dataSize & 1);
+}
+
+/*!
+ * \brief Returns the absolute offset of the end of the chunk (including the pad byte).
+ */
+constexpr std::uint64_t WaveChunk::endOffset() const
+{
+    return offset + totalSize();
+}
+
 class TAG_PARSER_EXPORT WaveAudioStream final : public AbstractTrack {
 public:
     WaveAudioStream(std::iostream &stream, std::uint64_t startOffset);
     ~WaveAudioStream() override;
 
     TrackType type() const override;
+    const std::vector<WaveChunk> &chunks() const;
+    const WaveChunk *chunk(std::uint32_t id, std::uint32_t listType = 0) const;
+    std::uint64_t riffEndOffset() const;
+    bool isTruncated() const;
+    RiffInfoTag *infoTag() const;
+    RiffInfoTag *createInfoTag();
+    bool removeInfoTag();
 
     static void addInfo(const WaveFormatHeader &waveHeader, AbstractTrack &track);
 
@@ -62,8 +107,49 @@ protected:
 
 private:
     std::uint64_t m_dataOffset;
+    std::uint64_t m_riffEndOffset;
+    bool m_truncated;
+    std::vector<WaveChunk> m_chunks;
+    std::unique_ptr<RiffInfoTag> m_infoTag;
 };
 
+/*!
+ * \brief Returns all top-level chunks of the RIFF chunk in the order they are present in the file.
+ * \remarks The chunks are determined when parsing the header. Chunks exceeding the RIFF chunk (or the file) are
+ *          truncated accordingly; the walk stops at them.
+ */
+inline const std::vector<WaveChunk> &WaveAudioStream::chunks() const
+{
+    return m_chunks;
+}
+
+/*!
+ * \brief Returns the absolute offset of the end of the RIFF chunk as determined when parsing the header.
+ * \remarks This is the end of the last chunk; might be less than the size denoted in the RIFF header if the file is
+ *          truncated.
+ */
+inline std::uint64_t WaveAudioStream::riffEndOffset() const
+{
+    return m_riffEndOffset;
+}
+
+/*!
+ * \brief Returns whether the RIFF chunk or one of its chunks exceeds the file.
+ * \remarks Tags can not be written to truncated files.
+ */
+inline bool WaveAudioStream::isTruncated() const
+{
+    return m_truncated;
+}
+
+/*!
+ * \brief Returns the tag parsed from the "INFO" list or nullptr if there is none.
+ */
+inline RiffInfoTag *WaveAudioStream::infoTag() const
+{
+    return m_infoTag.get();
+}
+
 } // namespace TagParser
 
 #endif // TAG_PARSER_WAVEAUDIOSTREAM_H